@@ -1,27 +1,36 @@
 #include "benchmark/tpcc/Database.h"
+#include "core/AsyncReplica.h"
 #include "core/Coordinator.h"
 #include "core/Macros.h"
+#include "core/Sweep.h"
 
-DEFINE_bool(operation_replication, false, "use operation replication");
-DEFINE_string(query, "neworder", "tpcc query, mixed, neworder, payment");
+DEFINE_string(query, "neworder",
+              "tpcc query, standard (the TPC-C mix, Silo only), mixed, "
+              "neworder, payment");
 DEFINE_int32(neworder_dist, 10, "new order distributed.");
 DEFINE_int32(payment_dist, 15, "payment distributed.");
 DEFINE_int32(n_district, 10, "no. of districts in a warehouse");
 DEFINE_bool(write_to_w_ytd, true, "by default, we run standard tpc-c.");
 DEFINE_bool(payment_look_up, false, "look up C_ID on secondary index.");
+DEFINE_bool(commutative_ytd, false, "Payment adds to W_YTD and D_YTD.");
+DEFINE_bool(reference_item, false, "the item table is a read-only array.");
 
-int main(int argc, char *argv[]) {
-
-  google::InitGoogleLogging(argv[0]);
-  google::InstallFailureSignalHandler();
-  google::ParseCommandLineFlags(&argc, &argv, true);
-
-  coco::tpcc::Context context;
+// sets up context from the flags
+void setup_context(coco::tpcc::Context &context) {
   SETUP_CONTEXT(context);
 
-  context.operation_replication = FLAGS_operation_replication;
-
-  if (FLAGS_query == "mixed") {
+  if (FLAGS_query == "standard") {
+    // OrderStatus, Delivery and StockLevel scan ordered tables, NewOrder
+    // inserts orders and Delivery deletes new orders, see inserts_orders
+    CHECK(context.protocol == "Silo")
+        << "the standard mix requires scans, inserts and deletes, which "
+        << context.protocol << " does not support.";
+    CHECK(!context.mvcc) << "mvcc tables do not support scans.";
+    CHECK(!FLAGS_operation_replication)
+        << "operation replication only supports NewOrder and Payment.";
+    CHECK(!context.repair) << "repairs do not renumber inserted orders.";
+    context.workloadType = coco::tpcc::TPCCWorkloadType::STANDARD;
+  } else if (FLAGS_query == "mixed") {
     context.workloadType = coco::tpcc::TPCCWorkloadType::MIXED;
   } else if (FLAGS_query == "neworder") {
     context.workloadType = coco::tpcc::TPCCWorkloadType::NEW_ORDER_ONLY;
@@ -36,12 +45,85 @@ int main(int argc, char *argv[]) {
   context.n_district = FLAGS_n_district;
   context.write_to_w_ytd = FLAGS_write_to_w_ytd;
   context.payment_look_up = FLAGS_payment_look_up;
+  context.commutative_ytd = FLAGS_commutative_ytd;
+  context.reference_item = FLAGS_reference_item;
 
-  coco::tpcc::Database db;
-  db.initialize(context);
+  // see CommutativeUpdate
+  if (context.commutative_ytd) {
+    CHECK(context.protocol == "Silo" || context.protocol == "SiloGC")
+        << "only Silo and SiloGC apply additions to fields.";
+    CHECK(!context.operation_replication)
+        << "operation replication writes W_YTD and D_YTD.";
+    CHECK(!context.mvcc && context.pmem_path.empty() &&
+          context.anti_cache_path.empty())
+        << "additions are applied to in-memory rows.";
+    CHECK(context.log_path.empty() && context.async_replica.empty())
+        << "additions are not logged.";
+  }
+
+  // the skewed keys of a phase are the warehouses, see WorkloadPhases
+  coco::WorkloadPhases::global().init(context.phases, context.partition_num);
+}
+
+// the flags the tables are loaded with, see Sweep
+std::vector<std::string> load_flags() {
+  auto flags = coco::Sweep::load_flags();
+  flags.insert(flags.end(), {"n_district", "reference_item"});
+  return flags;
+}
 
-  coco::Coordinator c(FLAGS_id, db, context);
-  c.connectToPeers();
-  c.start();
+int main(int argc, char *argv[]) {
+
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  coco::Sweep sweep(FLAGS_sweep);
+  CHECK(!sweep.enabled() ||
+        (!FLAGS_dump_image && !FLAGS_async_replica_role && !FLAGS_recover))
+      << "a sweep runs coordinators, from the tables it loads.";
+
+  // a database lives with the context it is loaded with
+  std::vector<std::unique_ptr<coco::tpcc::Context>> contexts;
+  std::unique_ptr<coco::tpcc::Database> db;
+
+  for (auto i = 0u; i < sweep.size(); i++) {
+    sweep.apply(i, [](const char *flag, const char *value) {
+      return google::SetCommandLineOption(flag, value);
+    });
+    contexts.push_back(std::make_unique<coco::tpcc::Context>());
+    auto &context = *contexts.back();
+    setup_context(context);
+
+    bool reload = sweep.changes(i, load_flags());
+    if (reload) {
+      db.reset();
+      db = std::make_unique<coco::tpcc::Database>();
+      db->initialize(context);
+    }
+
+    // see DatabaseImage
+    if (context.dump_image) {
+      return 0;
+    }
+
+    // see AsyncReplica
+    if (context.async_replica_role) {
+      coco::AsyncReplica<coco::tpcc::Database>(*db, context).start();
+      return 0;
+    }
+
+    coco::Coordinator c(FLAGS_id, *db, context);
+    c.connectToPeers();
+    c.start();
+    sweep.add_run(i, reload, c.get_run_statistics(), c.get_run_seconds());
+  }
+
+  if (sweep.enabled() && FLAGS_id == 0) {
+    LOG(INFO) << "sweep of " << sweep.size() << " runs:\n" << sweep.to_table();
+    if (!FLAGS_sweep_path.empty()) {
+      sweep.write(FLAGS_sweep_path);
+    }
+  }
   return 0;
-}
\ No newline at end of file
+}
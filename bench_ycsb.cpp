@@ -1,24 +1,33 @@
 #include "benchmark/ycsb/Database.h"
+#include "core/AsyncReplica.h"
 #include "core/Coordinator.h"
 #include "core/Macros.h"
+#include "core/Sweep.h"
+
+#include <thread>
 
 DEFINE_int32(read_write_ratio, 80, "read write ratio");
 DEFINE_int32(read_only_ratio, 0, "read only transaction ratio");
 DEFINE_int32(cross_ratio, 0, "cross partition transaction ratio");
-DEFINE_int32(keys, 200000, "keys in a partition.");
+DEFINE_int64(keys, 200000, "keys in a partition.");
 DEFINE_double(zipf, 0, "skew factor");
 DEFINE_string(skew_pattern, "both", "skew pattern: both, read, write");
 DEFINE_bool(two_partitions, false, "dist transactions access two partitions.");
 DEFINE_bool(pwv_ycsb_star, false, "ycsb keys dependency.");
 DEFINE_bool(global_key_space, false, "ycsb global key space.");
+DEFINE_string(workload, "",
+              "ycsb core workload, A to F, or empty for the ratios above.");
+DEFINE_int32(insert_keys, 0,
+             "keys a partition reserves for inserts, --keys if 0 with D or E.");
+DEFINE_int32(scan_length, 100, "max. no. of rows a scan of workload E reads.");
+DEFINE_int32(load_threads, 0,
+             "threads that load the tables, 0 for all cores of the node.");
+DEFINE_int32(field_size, 10,
+             "bytes of a ycsb field, 10, 100 or 400 for 100 B, 1 KB or 4 KB "
+             "rows.");
 
-int main(int argc, char *argv[]) {
-
-  google::InitGoogleLogging(argv[0]);
-  google::InstallFailureSignalHandler();
-  google::ParseCommandLineFlags(&argc, &argv, true);
-
-  coco::ycsb::Context context;
+// sets up context from the flags
+void setup_context(coco::ycsb::Context &context) {
   SETUP_CONTEXT(context);
 
   if (FLAGS_skew_pattern == "both") {
@@ -35,10 +44,64 @@ int main(int argc, char *argv[]) {
   context.readOnlyTransaction = FLAGS_read_only_ratio;
   context.crossPartitionProbability = FLAGS_cross_ratio;
   context.keysPerPartition = FLAGS_keys;
+  context.loadThreads = FLAGS_load_threads > 0
+                            ? FLAGS_load_threads
+                            : std::thread::hardware_concurrency();
   context.two_partitions = FLAGS_two_partitions;
   context.pwv_ycsb_star = FLAGS_pwv_ycsb_star;
   context.global_key_space = FLAGS_global_key_space;
 
+  if (FLAGS_workload.empty()) {
+    context.workload = coco::ycsb::YCSBWorkload::CUSTOM;
+  } else if (FLAGS_workload == "A") {
+    context.workload = coco::ycsb::YCSBWorkload::A;
+  } else if (FLAGS_workload == "B") {
+    context.workload = coco::ycsb::YCSBWorkload::B;
+  } else if (FLAGS_workload == "C") {
+    context.workload = coco::ycsb::YCSBWorkload::C;
+  } else if (FLAGS_workload == "D") {
+    context.workload = coco::ycsb::YCSBWorkload::D;
+  } else if (FLAGS_workload == "E") {
+    context.workload = coco::ycsb::YCSBWorkload::E;
+  } else if (FLAGS_workload == "F") {
+    context.workload = coco::ycsb::YCSBWorkload::F;
+  } else {
+    CHECK(false);
+  }
+
+  if (context.workload != coco::ycsb::YCSBWorkload::CUSTOM) {
+    CHECK(!context.two_partitions && !context.global_key_space)
+        << "the core workloads place keys on their own.";
+    CHECK(!FLAGS_operation_replication)
+        << "operation replication only supports ReadModifyWrite.";
+    CHECK(context.procedure < 0) << "--procedure replaces the workload.";
+  }
+
+  // D and E insert, see KeySpace
+  if (context.workload == coco::ycsb::YCSBWorkload::D ||
+      context.workload == coco::ycsb::YCSBWorkload::E) {
+    context.insertsPerPartition =
+        FLAGS_insert_keys > 0 ? FLAGS_insert_keys : FLAGS_keys;
+    CHECK(context.insertsPerPartition >= context.keysPerTransaction)
+        << "a transaction inserts up to " << context.keysPerTransaction
+        << " keys, see --insert_keys.";
+  }
+
+  // D reads the latest keys, whose ranks are zipfian
+  if (context.workload == coco::ycsb::YCSBWorkload::D) {
+    CHECK(FLAGS_zipf > 0) << "workload D needs a skew factor, see --zipf.";
+  }
+
+  if (context.workload == coco::ycsb::YCSBWorkload::E) {
+    CHECK(context.protocol == "Silo" || context.protocol == "SiloGC" ||
+          context.protocol == "SiloSI" || context.protocol == "Star")
+        << "workload E requires scans, which " << context.protocol
+        << " does not support.";
+    CHECK(!context.mvcc) << "mvcc tables do not support scans.";
+    CHECK(FLAGS_scan_length > 0);
+    context.maxScanLength = FLAGS_scan_length;
+  }
+
   if (FLAGS_zipf > 0) {
     context.isUniform = false;
     if (context.global_key_space) {
@@ -49,11 +112,90 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  coco::ycsb::Database db;
-  db.initialize(context);
+  coco::WorkloadPhases::global().init(
+      context.phases, context.global_key_space
+                          ? context.keysPerPartition * context.partition_num
+                          : context.keysPerPartition);
+}
+
+// the flags the tables are loaded with, see Sweep
+std::vector<std::string> load_flags() {
+  auto flags = coco::Sweep::load_flags();
+  flags.insert(flags.end(),
+               {"keys", "insert_keys", "workload", "global_key_space"});
+  return flags;
+}
+
+// the rows of Database are 100 B, 1 KB or 4 KB, see YCSBRecord
+template <class Database> void run(coco::Sweep &sweep) {
+
+  // a database lives with the context it is loaded with
+  std::vector<std::unique_ptr<coco::ycsb::Context>> contexts;
+  std::unique_ptr<Database> db;
+
+  for (auto i = 0u; i < sweep.size(); i++) {
+    sweep.apply(i, [](const char *flag, const char *value) {
+      return google::SetCommandLineOption(flag, value);
+    });
+    contexts.push_back(std::make_unique<coco::ycsb::Context>());
+    auto &context = *contexts.back();
+    setup_context(context);
+
+    bool reload = sweep.changes(i, load_flags());
+    if (reload) {
+      db.reset();
+      db = std::make_unique<Database>();
+      db->initialize(context);
+    }
+
+    // see DatabaseImage
+    if (context.dump_image) {
+      return;
+    }
+
+    // see AsyncReplica
+    if (context.async_replica_role) {
+      coco::AsyncReplica<Database>(*db, context).start();
+      return;
+    }
+
+    coco::Coordinator c(FLAGS_id, *db, context);
+    c.connectToPeers();
+    c.start();
+    sweep.add_run(i, reload, c.get_run_statistics(), c.get_run_seconds());
+  }
+
+  if (sweep.enabled() && FLAGS_id == 0) {
+    LOG(INFO) << "sweep of " << sweep.size() << " runs:\n" << sweep.to_table();
+    if (!FLAGS_sweep_path.empty()) {
+      sweep.write(FLAGS_sweep_path);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
 
-  coco::Coordinator c(FLAGS_id, db, context);
-  c.connectToPeers();
-  c.start();
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  coco::Sweep sweep(FLAGS_sweep);
+  CHECK(!sweep.enabled() ||
+        (!FLAGS_dump_image && !FLAGS_async_replica_role && !FLAGS_recover))
+      << "a sweep runs coordinators, from the tables it loads.";
+  for (auto &parameter : sweep.get_parameters()) {
+    CHECK(parameter.flag != "field_size")
+        << "--field_size selects the database, it is not swept.";
+  }
+
+  if (FLAGS_field_size == 10) {
+    run<coco::ycsb::Database>(sweep);
+  } else if (FLAGS_field_size == 100) {
+    run<coco::ycsb::BasicDatabase<coco::ycsb::value_1k>>(sweep);
+  } else if (FLAGS_field_size == 400) {
+    run<coco::ycsb::BasicDatabase<coco::ycsb::value_4k>>(sweep);
+  } else {
+    CHECK(false) << "--field_size is 10, 100 or 400.";
+  }
   return 0;
 }
\ No newline at end of file
@@ -9,7 +9,16 @@
 namespace coco {
 namespace tpcc {
 
-enum class TPCCWorkloadType { NEW_ORDER_ONLY, PAYMENT_ONLY, MIXED };
+// MIXED is half NewOrder and half Payment, STANDARD is the TPC-C mix, i.e.,
+// 45% NewOrder, 43% Payment, and 4% each of OrderStatus, Delivery and
+// StockLevel. In the other workloads, NewOrder inserts its order only if the
+// protocol supports it, see inserts_orders.
+enum class TPCCWorkloadType {
+  NEW_ORDER_ONLY,
+  PAYMENT_ONLY,
+  MIXED,
+  STANDARD
+};
 
 class Context : public coco::Context {
 public:
@@ -39,6 +48,10 @@ public:
 
   bool write_to_w_ytd = true;
   bool payment_look_up = false;
+  // Payment adds to W_YTD and D_YTD instead of writing them
+  bool commutative_ytd = false;
+  // the item table is a ReferenceTable, NewOrder reads it without metadata
+  bool reference_item = false;
 };
 } // namespace tpcc
 } // namespace coco
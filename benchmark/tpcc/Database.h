@@ -18,6 +18,8 @@
 #include "benchmark/tpcc/Storage.h"
 #include "common/Operation.h"
 #include "common/Time.h"
+#include "core/DatabaseImage.h"
+#include "core/NumaPlacement.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
 
@@ -39,6 +41,101 @@ public:
     return tbl_vecs[table_id][partition_id];
   }
 
+  // the tables of all partitions replicated on this node
+  std::vector<ITable *> local_tables(const Partitioner &partitioner) {
+    std::vector<ITable *> tables;
+    for (auto &partitions : tbl_vecs) {
+      for (auto table : partitions) {
+        if (partitioner.is_partition_replicated_on_me(table->partitionID())) {
+          tables.push_back(table);
+        }
+      }
+    }
+    return tables;
+  }
+
+  // the tables of a partition, see Migrator
+  std::vector<ITable *> partition_tables(std::size_t partition_id) {
+    std::vector<ITable *> tables;
+    for (auto &partitions : tbl_vecs) {
+      if (partition_id < partitions.size()) {
+        tables.push_back(partitions[partition_id]);
+      }
+    }
+    return tables;
+  }
+
+  template <class KeyType, class ValueType>
+  using TypedTable = Table<997, KeyType, ValueType>;
+
+  template <class KeyType, class ValueType>
+  TypedTable<KeyType, ValueType> &typed_table(std::size_t table_id,
+                                              std::size_t partition_id) {
+    DCHECK(mvcc == false) << "mvcc tables are not typed tables.";
+    DCHECK(evictable == false) << "evictable tables are not typed tables.";
+    DCHECK(persistent == false) << "persistent tables are not typed tables.";
+    return static_cast<TypedTable<KeyType, ValueType> &>(
+        *find_table(table_id, partition_id));
+  }
+
+  template <class KeyType, class ValueType>
+  OrderedTable<KeyType, ValueType> &ordered_table(std::size_t table_id,
+                                                  std::size_t partition_id) {
+    DCHECK(mvcc == false) << "mvcc tables are not ordered tables.";
+    return static_cast<OrderedTable<KeyType, ValueType> &>(
+        *find_table(table_id, partition_id));
+  }
+
+  // call func with the concrete table type, so that the table access can be
+  // inlined; fall back to ITable when tables are mvcc, evictable or
+  // persistent tables.
+  template <class Func>
+  auto visit_table(std::size_t table_id, std::size_t partition_id, Func func) {
+    if (mvcc || evictable || persistent) {
+      return func(*find_table(table_id, partition_id));
+    }
+
+    switch (table_id) {
+    case warehouse::tableID:
+      return func(typed_table<warehouse::key, warehouse::value>(
+          table_id, partition_id));
+    case district::tableID:
+      return func(
+          typed_table<district::key, district::value>(table_id, partition_id));
+    case customer::tableID:
+      return func(
+          typed_table<customer::key, customer::value>(table_id, partition_id));
+    case customer_name_idx::tableID:
+      return func(
+          typed_table<customer_name_idx::key, customer_name_idx::value>(
+              table_id, partition_id));
+    case history::tableID:
+      return func(
+          typed_table<history::key, history::value>(table_id, partition_id));
+    case new_order::tableID:
+      return func(ordered_table<new_order::key, new_order::value>(
+          table_id, partition_id));
+    case order::tableID:
+      return func(
+          ordered_table<order::key, order::value>(table_id, partition_id));
+    case order_line::tableID:
+      return func(ordered_table<order_line::key, order_line::value>(
+          table_id, partition_id));
+    case item::tableID:
+      if (reference_item) {
+        return func(static_cast<ReferenceTable<item::key, item::value> &>(
+            *find_table(table_id, partition_id)));
+      }
+      return func(typed_table<item::key, item::value>(table_id, partition_id));
+    case stock::tableID:
+      return func(
+          typed_table<stock::key, stock::value>(table_id, partition_id));
+    default:
+      CHECK(false) << "table id " << table_id << " does not exist.";
+      return func(*find_table(table_id, partition_id));
+    }
+  }
+
   ITable *tbl_warehouse(std::size_t partition_id) {
     DCHECK(partition_id < tbl_warehouse_vec.size());
     return tbl_warehouse_vec[partition_id].get();
@@ -84,21 +181,38 @@ public:
     return tbl_item_vec[partition_id].get();
   }
 
+  // the item of key read with no metadata, see ReferenceTable
+  const item::value *find_item(const item::key &key) const {
+    DCHECK(reference_item);
+    return static_cast<const ReferenceTable<item::key, item::value> &>(
+               *tbl_item_vec[0])
+        .find(key);
+  }
+
   ITable *tbl_stock(std::size_t partition_id) {
     DCHECK(partition_id < tbl_stock_vec.size());
     return tbl_stock_vec[partition_id].get();
   }
 
+  // the partitions of a table kept from a former run are not loaded again,
+  // see PersistentTable
   template <class InitFunc>
-  void initTables(const std::string &name, InitFunc initFunc,
-                  std::size_t partitionNum, std::size_t threadsNum,
-                  Partitioner *partitioner) {
+  void initTables(const std::string &name, std::size_t tableID,
+                  InitFunc initFunc, std::size_t partitionNum,
+                  std::size_t threadsNum, Partitioner *partitioner,
+                  const NumaPlacement *numa) {
 
     std::vector<int> all_parts;
 
     for (auto i = 0u; i < partitionNum; i++) {
-      if (partitioner == nullptr ||
-          partitioner->is_partition_replicated_on_me(i)) {
+      // a rebuilt replica is streamed from its master, see ReplicaRebuilder
+      if (partitioner != nullptr && rebuild_replicas &&
+          !partitioner->has_master_partition(i)) {
+        continue;
+      }
+      if ((partitioner == nullptr ||
+           partitioner->is_partition_replicated_on_me(i)) &&
+          !find_table(tableID, i)->is_restored()) {
         all_parts.push_back(i);
       }
     }
@@ -109,6 +223,12 @@ public:
       v.emplace_back([=]() {
         for (auto i = threadID; i < all_parts.size(); i += threadsNum) {
           auto partitionID = all_parts[i];
+          // the memory of a partition is allocated on the node that first
+          // touches it
+          if (numa != nullptr) {
+            NumaPlacement::pin_thread(
+                pthread_self(), numa->cpus(numa->partition_node(partitionID)));
+          }
           initFunc(partitionID);
         }
       });
@@ -128,13 +248,23 @@ public:
     std::size_t coordinator_id = context.coordinator_id;
     std::size_t partitionNum = context.partition_num;
     std::size_t threadsNum = context.worker_num;
+    mvcc = context.mvcc;
+    evictable = !context.anti_cache_path.empty();
+    persistent = !context.pmem_path.empty();
+    reference_item = context.reference_item;
+    rebuild_replicas = context.rebuilds_replicas();
 
     auto partitioner = PartitionerFactory::create_partitioner(
         context.partitioner, coordinator_id, context.coordinator_num);
 
+    std::unique_ptr<NumaPlacement> numa;
+    if (context.numa) {
+      numa = std::make_unique<NumaPlacement>(context);
+    }
+
     auto now = std::chrono::steady_clock::now();
 
-    LOG(INFO) << "creating hash tables for database...";
+    LOG(INFO) << "creating tables for database...";
 
     for (auto partitionID = 0u; partitionID < partitionNum; partitionID++) {
       auto warehouseTableID = warehouse::tableID;
@@ -165,17 +295,19 @@ public:
 
       auto newOrderTableID = new_order::tableID;
       tbl_new_order_vec.push_back(
-          TableFactory::create_table<997, new_order::key, new_order::value>(
+          TableFactory::create_ordered_table<997, new_order::key,
+                                             new_order::value>(
               context, newOrderTableID, partitionID));
 
       auto orderTableID = order::tableID;
       tbl_order_vec.push_back(
-          TableFactory::create_table<997, order::key, order::value>(
+          TableFactory::create_ordered_table<997, order::key, order::value>(
               context, orderTableID, partitionID));
 
       auto orderLineTableID = order_line::tableID;
       tbl_order_line_vec.push_back(
-          TableFactory::create_table<997, order_line::key, order_line::value>(
+          TableFactory::create_ordered_table<997, order_line::key,
+                                             order_line::value>(
               context, orderLineTableID, partitionID));
 
       auto stockTableID = stock::tableID;
@@ -184,8 +316,14 @@ public:
               context, stockTableID, partitionID));
     }
     auto itemTableID = item::tableID;
-    tbl_item_vec.push_back(
-        std::make_unique<Table<997, item::key, item::value>>(itemTableID, 0));
+    if (reference_item) {
+      tbl_item_vec.push_back(
+          std::make_unique<ReferenceTable<item::key, item::value>>(itemTableID,
+                                                                   0));
+    } else {
+      tbl_item_vec.push_back(
+          std::make_unique<Table<997, item::key, item::value>>(itemTableID, 0));
+    }
 
     // there are 10 tables in tpcc
     tbl_vecs.resize(10);
@@ -214,72 +352,117 @@ public:
     std::transform(tbl_stock_vec.begin(), tbl_stock_vec.end(),
                    std::back_inserter(tbl_vecs[9]), tFunc);
 
-    DLOG(INFO) << "hash tables created in "
+    DLOG(INFO) << "tables created in "
                << std::chrono::duration_cast<std::chrono::milliseconds>(
                       std::chrono::steady_clock::now() - now)
                       .count()
                << " milliseconds.";
 
+    // Payment adds to W_YTD and D_YTD, see CommutativeUpdate
+    if (context.commutative_ytd) {
+      for (auto partitionID = 0u; partitionID < partitionNum; partitionID++) {
+        tbl_warehouse_vec[partitionID]->set_additive_fields(
+            1ull << warehouse::value::W_YTD_field);
+        tbl_district_vec[partitionID]->set_additive_fields(
+            1ull << district::value::D_YTD_field);
+      }
+    }
+
+    // see DatabaseImage
+    if (!context.image_path.empty() && !context.dump_image) {
+      DatabaseImage::load_all(image_tables(*partitioner), context.image_path,
+                              threadsNum, numa.get());
+      for (auto table : image_tables(*partitioner)) {
+        table->set_loaded();
+      }
+      return;
+    }
+
     using std::placeholders::_1;
     initTables(
-        "warehouse",
+        "warehouse", warehouse::tableID,
         [&context, this](std::size_t partitionID) {
           warehouseInit(context, partitionID);
         },
-        partitionNum, threadsNum, partitioner.get());
+        partitionNum, threadsNum, partitioner.get(), numa.get());
     initTables(
-        "district",
+        "district", district::tableID,
         [&context, this](std::size_t partitionID) {
           districtInit(context, partitionID);
         },
-        partitionNum, threadsNum, partitioner.get());
+        partitionNum, threadsNum, partitioner.get(), numa.get());
     initTables(
-        "customer",
+        "customer", customer::tableID,
         [&context, this](std::size_t partitionID) {
           customerInit(context, partitionID);
         },
-        partitionNum, threadsNum, partitioner.get());
+        partitionNum, threadsNum, partitioner.get(), numa.get());
     initTables(
-        "customer_name_idx",
+        "customer_name_idx", customer_name_idx::tableID,
         [&context, this](std::size_t partitionID) {
           customerNameIdxInit(context, partitionID);
         },
-        partitionNum, threadsNum, partitioner.get());
-    /*    initTables("history",
-                   [&context, this](std::size_t partitionID) {
-                     historyInit(context, partitionID);
-                   },
-                   partitionNum, threadsNum, partitioner.get());
-        initTables("new_order",
-                   [&context, this](std::size_t partitionID) {
-                     newOrderInit(context, partitionID);
-                   },
-                   partitionNum, threadsNum, partitioner.get());
-        initTables("order",
-                   [&context, this](std::size_t partitionID) {
-                     orderInit(context, partitionID);
-                   },
-                   partitionNum, threadsNum, partitioner.get());
-        initTables("order_line",
-                   [&context, this](std::size_t partitionID) {
-                     orderLineInit(context, partitionID);
-                   },
-                   partitionNum, threadsNum, partitioner.get());*/
+        partitionNum, threadsNum, partitioner.get(), numa.get());
+    initTables(
+        "history", history::tableID,
+        [&context, this](std::size_t partitionID) {
+          historyInit(context, partitionID);
+        },
+        partitionNum, threadsNum, partitioner.get(), numa.get());
+    initTables(
+        "new_order", new_order::tableID,
+        [&context, this](std::size_t partitionID) {
+          newOrderInit(context, partitionID);
+        },
+        partitionNum, threadsNum, partitioner.get(), numa.get());
+    initTables(
+        "order", order::tableID,
+        [&context, this](std::size_t partitionID) {
+          orderInit(context, partitionID);
+        },
+        partitionNum, threadsNum, partitioner.get(), numa.get());
+    initTables(
+        "order_line", order_line::tableID,
+        [&context, this](std::size_t partitionID) {
+          orderLineInit(context, partitionID);
+        },
+        partitionNum, threadsNum, partitioner.get(), numa.get());
     initTables(
-        "item",
+        "item", item::tableID,
         [&context, this](std::size_t partitionID) {
           itemInit(context, partitionID);
         },
-        1, 1, nullptr);
+        1, 1, nullptr, nullptr);
     initTables(
-        "stock",
+        "stock", stock::tableID,
         [&context, this](std::size_t partitionID) {
           stockInit(context, partitionID);
         },
-        partitionNum, threadsNum, partitioner.get());
+        partitionNum, threadsNum, partitioner.get(), numa.get());
+
+    if (context.dump_image) {
+      DatabaseImage::dump_all(image_tables(*partitioner), context.image_path,
+                              threadsNum, numa.get());
+    }
+
+    for (auto table : image_tables(*partitioner)) {
+      table->set_loaded();
+    }
   }
 
-  void apply_operation(const Operation &operation) {
+  // the tables initialized on this node, the item table is on every node
+  std::vector<ITable *> image_tables(const Partitioner &partitioner) {
+    auto tables = local_tables(partitioner);
+    if (!partitioner.is_partition_replicated_on_me(0)) {
+      tables.push_back(tbl_item_vec[0].get());
+    }
+    return tables;
+  }
+
+  // replays a NewOrder or a Payment, write(tid, func) is called for each row
+  // and func sets its fields, see OperationReplication.
+  template <class Func>
+  void apply_operation(const Operation &operation, Func write) {
 
     Decoder dec(operation.data);
     bool is_neworder;
@@ -287,98 +470,105 @@ public:
 
     if (is_neworder) {
       // district
-      auto districtTableID = district::tableID;
       district::key district_key;
-      dec >> district_key.D_W_ID >> district_key.D_ID;
-
-      auto row =
-          tbl_district_vec[district_key.D_W_ID - 1]->search(&district_key);
-      MetaDataType &tid = *std::get<0>(row);
-      tid.store(operation.tid);
-      district::value &district_value =
-          *static_cast<district::value *>(std::get<1>(row));
-      dec >> district_value.D_NEXT_O_ID;
+      float D_YTD;
+      int32_t D_NEXT_O_ID;
+      dec >> district_key.D_W_ID >> district_key.D_ID >> D_YTD >> D_NEXT_O_ID;
+      apply_district(district_key, D_YTD, D_NEXT_O_ID, write);
 
       // stock
-      auto stockTableID = stock::tableID;
       while (dec.size() > 0) {
         stock::key stock_key;
-        dec >> stock_key.S_W_ID >> stock_key.S_I_ID;
+        int16_t S_QUANTITY;
+        float S_YTD;
+        int32_t S_ORDER_CNT, S_REMOTE_CNT;
+        dec >> stock_key.S_W_ID >> stock_key.S_I_ID >> S_QUANTITY >> S_YTD >>
+            S_ORDER_CNT >> S_REMOTE_CNT;
 
         auto row = tbl_stock_vec[stock_key.S_W_ID - 1]->search(&stock_key);
-        MetaDataType &tid = *std::get<0>(row);
-        tid.store(operation.tid);
         stock::value &stock_value =
             *static_cast<stock::value *>(std::get<1>(row));
-
-        dec >> stock_value.S_QUANTITY >> stock_value.S_YTD >>
-            stock_value.S_ORDER_CNT >> stock_value.S_REMOTE_CNT;
+        write(*std::get<0>(row), [&]() {
+          stock_value.S_QUANTITY = S_QUANTITY;
+          stock_value.S_YTD = S_YTD;
+          stock_value.S_ORDER_CNT = S_ORDER_CNT;
+          stock_value.S_REMOTE_CNT = S_REMOTE_CNT;
+        });
       }
     } else {
-      {
+      bool write_to_w_ytd;
+      dec >> write_to_w_ytd;
+
+      if (write_to_w_ytd) {
         // warehouse
-        auto warehouseTableID = warehouse::tableID;
         warehouse::key warehouse_key;
-        dec >> warehouse_key.W_ID;
+        float W_YTD;
+        dec >> warehouse_key.W_ID >> W_YTD;
 
         auto row =
             tbl_warehouse_vec[warehouse_key.W_ID - 1]->search(&warehouse_key);
-        MetaDataType &tid = *std::get<0>(row);
-        tid.store(operation.tid);
-
         warehouse::value &warehouse_value =
             *static_cast<warehouse::value *>(std::get<1>(row));
-
-        dec >> warehouse_value.W_YTD;
+        write(*std::get<0>(row), [&]() { warehouse_value.W_YTD = W_YTD; });
       }
 
       {
         // district
-        auto districtTableID = district::tableID;
         district::key district_key;
-        dec >> district_key.D_W_ID >> district_key.D_ID;
-
-        auto row =
-            tbl_district_vec[district_key.D_W_ID - 1]->search(&district_key);
-        MetaDataType &tid = *std::get<0>(row);
-        tid.store(operation.tid);
-
-        district::value &district_value =
-            *static_cast<district::value *>(std::get<1>(row));
-
-        dec >> district_value.D_YTD;
+        float D_YTD;
+        int32_t D_NEXT_O_ID;
+        dec >> district_key.D_W_ID >> district_key.D_ID >> D_YTD >>
+            D_NEXT_O_ID;
+        apply_district(district_key, D_YTD, D_NEXT_O_ID, write);
       }
 
       {
-        // custoemer
-        auto customerTableID = customer::tableID;
+        // customer
         customer::key customer_key;
-        dec >> customer_key.C_W_ID >> customer_key.C_D_ID >> customer_key.C_ID;
+        float C_BALANCE, C_YTD_PAYMENT;
+        int32_t C_PAYMENT_CNT;
+        bool bad_credit;
+        dec >> customer_key.C_W_ID >> customer_key.C_D_ID >>
+            customer_key.C_ID >> C_BALANCE >> C_YTD_PAYMENT >> C_PAYMENT_CNT >>
+            bad_credit;
+
+        // the new C_DATA of a customer with bad credit
+        char C_DATA[501] = {0};
+        if (bad_credit) {
+          dec.read_n_bytes(C_DATA, 500);
+        }
 
         auto row =
             tbl_customer_vec[customer_key.C_W_ID - 1]->search(&customer_key);
-        MetaDataType &tid = *std::get<0>(row);
-        tid.store(operation.tid);
-
         customer::value &customer_value =
             *static_cast<customer::value *>(std::get<1>(row));
-
-        char C_DATA[501];
-        const char *old_C_DATA = customer_value.C_DATA.c_str();
-        uint32_t total_written;
-        dec >> total_written;
-        dec.read_n_bytes(C_DATA, total_written);
-        std::memcpy(C_DATA + total_written, old_C_DATA, 500 - total_written);
-        C_DATA[500] = 0;
-        customer_value.C_DATA.assign(C_DATA);
-
-        dec >> customer_value.C_BALANCE >> customer_value.C_YTD_PAYMENT >>
-            customer_value.C_PAYMENT_CNT;
+        write(*std::get<0>(row), [&]() {
+          customer_value.C_BALANCE = C_BALANCE;
+          customer_value.C_YTD_PAYMENT = C_YTD_PAYMENT;
+          customer_value.C_PAYMENT_CNT = C_PAYMENT_CNT;
+          if (bad_credit) {
+            customer_value.C_DATA.assign(C_DATA);
+          }
+        });
       }
     }
   }
 
 private:
+  // NewOrder and Payment both write D_YTD and D_NEXT_O_ID of a district
+  template <class Func>
+  void apply_district(const district::key &district_key, float D_YTD,
+                      int32_t D_NEXT_O_ID, Func &write) {
+    auto row =
+        tbl_district_vec[district_key.D_W_ID - 1]->search(&district_key);
+    district::value &district_value =
+        *static_cast<district::value *>(std::get<1>(row));
+    write(*std::get<0>(row), [&]() {
+      district_value.D_YTD = D_YTD;
+      district_value.D_NEXT_O_ID = D_NEXT_O_ID;
+    });
+  }
+
   void warehouseInit(const Context &context, std::size_t partitionID) {
 
     Random random;
@@ -404,6 +594,7 @@ private:
 
     Random random;
     ITable *table = tbl_district_vec[partitionID].get();
+    table->reserve(context.n_district);
 
     // For each row in the WAREHOUSE table, context.n_district rows in the
     // DISTRICT table
@@ -433,6 +624,7 @@ private:
 
     Random random;
     ITable *table = tbl_customer_vec[partitionID].get();
+    table->reserve(context.n_district * 3000);
 
     // For each row in the WAREHOUSE table, context.n_district rows in the
     // DISTRICT table For each row in the DISTRICT table, 3,000 rows in the
@@ -538,6 +730,7 @@ private:
 
     Random random;
     ITable *table = tbl_history_vec[partitionID].get();
+    table->reserve(context.n_district * 3000);
 
     // For each row in the WAREHOUSE table, context.n_district rows in the
     // DISTRICT table For each row in the DISTRICT table, 3,000 rows in the
@@ -569,6 +762,7 @@ private:
 
     Random random;
     ITable *table = tbl_new_order_vec[partitionID].get();
+    table->reserve(context.n_district * 900);
 
     // For each row in the WAREHOUSE table, context.n_district rows in the
     // DISTRICT table For each row in the DISTRICT table, 3,000 rows in the
@@ -594,6 +788,7 @@ private:
 
     Random random;
     ITable *table = tbl_order_vec[partitionID].get();
+    table->reserve(context.n_district * 3000);
 
     // For each row in the WAREHOUSE table, context.n_district rows in the
     // DISTRICT table For each row in the DISTRICT table, 3,000 rows in the
@@ -637,6 +832,7 @@ private:
 
     Random random;
     ITable *table = tbl_order_line_vec[partitionID].get();
+    table->reserve(context.n_district * 3000 * 15);
 
     // For each row in the WAREHOUSE table, context.n_district rows in the
     // DISTRICT table For each row in the DISTRICT table, 3,000 rows in the
@@ -690,6 +886,7 @@ private:
 
     Random random;
     ITable *table = tbl_item_vec[partitionID].get();
+    table->reserve(100000);
 
     std::string i_original = "ORIGINAL";
 
@@ -730,6 +927,7 @@ private:
 
     Random random;
     ITable *table = tbl_stock_vec[partitionID].get();
+    table->reserve(100000);
 
     std::string s_original = "ORIGINAL";
 
@@ -744,16 +942,16 @@ private:
       stock::value value;
 
       value.S_QUANTITY = random.uniform_dist(10, 100);
-      value.S_DIST_01.assign(random.a_string(24, 24));
-      value.S_DIST_02.assign(random.a_string(24, 24));
-      value.S_DIST_03.assign(random.a_string(24, 24));
-      value.S_DIST_04.assign(random.a_string(24, 24));
-      value.S_DIST_05.assign(random.a_string(24, 24));
-      value.S_DIST_06.assign(random.a_string(24, 24));
-      value.S_DIST_07.assign(random.a_string(24, 24));
-      value.S_DIST_08.assign(random.a_string(24, 24));
-      value.S_DIST_09.assign(random.a_string(24, 24));
-      value.S_DIST_10.assign(random.a_string(24, 24));
+      value.S_DIST_01.assign(rand_dist_info(random));
+      value.S_DIST_02.assign(rand_dist_info(random));
+      value.S_DIST_03.assign(rand_dist_info(random));
+      value.S_DIST_04.assign(rand_dist_info(random));
+      value.S_DIST_05.assign(rand_dist_info(random));
+      value.S_DIST_06.assign(rand_dist_info(random));
+      value.S_DIST_07.assign(rand_dist_info(random));
+      value.S_DIST_08.assign(rand_dist_info(random));
+      value.S_DIST_09.assign(rand_dist_info(random));
+      value.S_DIST_10.assign(rand_dist_info(random));
       value.S_YTD = 0;
       value.S_ORDER_CNT = 0;
       value.S_REMOTE_CNT = 0;
@@ -780,6 +978,11 @@ private:
   }
 
 private:
+  bool mvcc = false;
+  bool evictable = false;
+  bool persistent = false;
+  bool reference_item = false;
+  bool rebuild_replicas = false; // see ReplicaRebuilder
   std::vector<std::vector<ITable *>> tbl_vecs;
 
   std::vector<std::unique_ptr<ITable>> tbl_warehouse_vec;
@@ -0,0 +1,87 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "benchmark/tpcc/Random.h"
+#include "common/DictString.h"
+
+#include <string>
+#include <vector>
+
+namespace coco {
+namespace tpcc {
+
+/*
+ * Most of the memory of TPC-C is in the strings of customer and stock. With
+ * -DCOCO_TPCC_DICTIONARY (cmake -DCOCO_TPCC_DICTIONARY=ON), C_LAST and
+ * S_DIST_xx are dictionary encoded, see DictString, which takes 12 bytes off
+ * a customer and 200 bytes off a stock row.
+ *
+ * C_LAST takes the 1000 names of rand_last_name. S_DIST_xx is a random
+ * string in the spec and only read after it is loaded, so it is drawn from
+ * DIST_INFO_NUM random strings generated from a fixed seed instead, the same
+ * on every node.
+ */
+
+class LastNames {
+public:
+  static const StringDictionary<16> &get() {
+    static StringDictionary<16> dictionary(names());
+    return dictionary;
+  }
+
+private:
+  static std::vector<std::string> names() {
+    Random random;
+    std::vector<std::string> names;
+    for (auto i = 0; i < 1000; i++) {
+      names.push_back(random.rand_last_name(i));
+    }
+    return names;
+  }
+};
+
+class DistInfos {
+public:
+  static constexpr std::size_t DIST_INFO_NUM = 4096;
+  static constexpr uint64_t DIST_INFO_SEED = 0x5d157;
+
+  static const StringDictionary<24> &get() {
+    static StringDictionary<24> dictionary(infos());
+    return dictionary;
+  }
+
+private:
+  static std::vector<std::string> infos() {
+    Random random(DIST_INFO_SEED);
+    std::vector<std::string> infos;
+    for (auto i = 0u; i < DIST_INFO_NUM; i++) {
+      infos.push_back(random.a_string(24, 24));
+    }
+    return infos;
+  }
+};
+
+#ifdef COCO_TPCC_DICTIONARY
+using LastNameString = DictString<16, LastNames>;
+using DistInfoString = DictString<24, DistInfos>;
+#else
+using LastNameString = FixedString<16>;
+using DistInfoString = FixedString<24>;
+#endif
+
+// a value of S_DIST_xx
+inline std::string rand_dist_info(Random &random) {
+#ifdef COCO_TPCC_DICTIONARY
+  auto &dictionary = DistInfos::get();
+  return dictionary.decode(random.uniform_dist(0, dictionary.size() - 1))
+      .toString();
+#else
+  return random.a_string(24, 24);
+#endif
+}
+
+} // namespace tpcc
+} // namespace coco
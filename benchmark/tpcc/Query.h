@@ -6,12 +6,26 @@
 
 #include "benchmark/tpcc/Context.h"
 #include "benchmark/tpcc/Random.h"
+#include "common/Encoder.h"
 #include "common/FixedString.h"
+#include "common/StringPiece.h"
+#include "core/WorkloadPhases.h"
 #include <string>
 
 namespace coco {
 namespace tpcc {
 
+// a remote warehouse, uniform or around the hotspot of the current phase, see
+// WorkloadPhases
+inline int32_t remote_warehouse(const Context &context, Random &random) {
+  auto &phases = WorkloadPhases::global();
+  if (phases.is_uniform(true)) {
+    return random.uniform_dist(1, context.partition_num);
+  }
+  return 1 + phases.skewed(Zipf::globalZipf(), context.partition_num,
+                           random.next_double());
+}
+
 struct NewOrderQuery {
   bool isRemote() const {
     for (auto i = 0; i < O_OL_CNT; i++) {
@@ -90,11 +104,12 @@ public:
 
       if (i == 0) {
         int x = random.uniform_dist(1, 100);
-        if (x <= context.newOrderCrossPartitionProbability &&
+        if (x <= WorkloadPhases::global().cross_ratio(
+                     context.newOrderCrossPartitionProbability) &&
             context.partition_num > 1) {
           int32_t OL_SUPPLY_W_ID = W_ID;
           while (OL_SUPPLY_W_ID == W_ID) {
-            OL_SUPPLY_W_ID = random.uniform_dist(1, context.partition_num);
+            OL_SUPPLY_W_ID = remote_warehouse(context, random);
           }
           query.INFO[i].OL_SUPPLY_W_ID = OL_SUPPLY_W_ID;
         } else {
@@ -143,7 +158,8 @@ public:
 
     int x = random.uniform_dist(1, 100);
 
-    if (x <= context.paymentCrossPartitionProbability &&
+    if (x <= WorkloadPhases::global().cross_ratio(
+                 context.paymentCrossPartitionProbability) &&
         context.partition_num > 1) {
       // If x <= 15 a customer is selected from a random district number (C_D_ID
       // is randomly selected within [1 .. context.n_district]), and a random
@@ -153,7 +169,7 @@ public:
       int32_t C_W_ID = W_ID;
 
       while (C_W_ID == W_ID) {
-        C_W_ID = random.uniform_dist(1, context.partition_num);
+        C_W_ID = remote_warehouse(context, random);
       }
 
       query.C_W_ID = C_W_ID;
@@ -193,5 +209,180 @@ public:
     return query;
   }
 };
+struct DeliveryQuery {
+  int32_t W_ID;
+  int32_t O_CARRIER_ID;
+};
+
+class makeDeliveryQuery {
+public:
+  DeliveryQuery operator()(const Context &context, int32_t W_ID,
+                           Random &random) const {
+    DeliveryQuery query;
+
+    // W_ID is constant over the whole measurement interval
+
+    query.W_ID = W_ID;
+
+    // The carrier number (O_CARRIER_ID) is randomly selected within [1 .. 10].
+
+    query.O_CARRIER_ID = random.uniform_dist(1, 10);
+    return query;
+  }
+};
+
+struct OrderStatusQuery {
+  int32_t W_ID;
+  int32_t D_ID;
+  int32_t C_ID;
+  FixedString<16> C_LAST;
+};
+
+class makeOrderStatusQuery {
+public:
+  OrderStatusQuery operator()(const Context &context, int32_t W_ID,
+                              Random &random) const {
+    OrderStatusQuery query;
+
+    // W_ID is constant over the whole measurement interval
+
+    query.W_ID = W_ID;
+
+    // The district number (D_ID) is randomly selected within [1
+    // ..context.n_district] from the home warehouse.
+
+    query.D_ID = random.uniform_dist(1, context.n_district);
+
+    // The customer is randomly selected 60% of the time by last name (C_W_ID,
+    // C_D_ID, C_LAST) and 40% of the time by number (C_W_ID, C_D_ID, C_ID).
+
+    int y = random.uniform_dist(1, 100);
+
+    if (y <= 60) {
+      std::string last_name =
+          random.rand_last_name(random.non_uniform_distribution(255, 0, 999));
+      query.C_LAST.assign(last_name);
+      query.C_ID = 0;
+    } else {
+      query.C_ID = random.non_uniform_distribution(1023, 1, 3000);
+    }
+    return query;
+  }
+};
+
+struct StockLevelQuery {
+  int32_t W_ID;
+  int32_t D_ID;
+  int16_t THRESHOLD;
+};
+
+class makeStockLevelQuery {
+public:
+  StockLevelQuery operator()(const Context &context, int32_t W_ID,
+                             Random &random) const {
+    StockLevelQuery query;
+
+    // Each terminal must use a unique value of (W_ID, D_ID) that is constant
+    // over the whole measurement. Here D_ID is randomly selected within [1
+    // ..context.n_district], since terminals are not modeled.
+
+    query.W_ID = W_ID;
+    query.D_ID = random.uniform_dist(1, context.n_district);
+
+    // The threshold of minimum quantity in stock (threshold) is selected at
+    // random within [10 .. 20].
+
+    query.THRESHOLD = random.uniform_dist(10, 20);
+    return query;
+  }
+};
+
+/*
+ * The queries a client submits, see IngressServer, each field as it is in the
+ * query, in order. The queries are checked against the database, so that a
+ * client cannot make a transaction read a row that does not exist.
+ *
+ * NewOrder:  [ W_ID (32) | D_ID (32) | C_ID (32) | O_OL_CNT (8) |
+ *              O_OL_CNT x [ OL_I_ID (32) | OL_SUPPLY_W_ID (32) |
+ *                           OL_QUANTITY (8) ] ]
+ * Payment:   [ W_ID (32) | D_ID (32) | C_ID (32) | C_D_ID (32) |
+ *              C_W_ID (32) | H_AMOUNT (32, float) ]
+ *
+ * An OL_I_ID of 0 is the unused item that rolls the order back. A payment is
+ * always by C_ID, as a customer last name may not be in the index.
+ */
+
+class decodeQuery {
+protected:
+  static bool in_range(int32_t v, int32_t min, int32_t max) {
+    return v >= min && v <= max;
+  }
+
+  static bool valid_warehouse(const Context &context, int32_t W_ID) {
+    return in_range(W_ID, 1, static_cast<int32_t>(context.partition_num));
+  }
+
+  static bool valid_district(const Context &context, int32_t D_ID) {
+    return in_range(D_ID, 1, context.n_district);
+  }
+};
+
+class decodeNewOrderQuery : public decodeQuery {
+public:
+  static constexpr std::size_t HEADER_SIZE = sizeof(int32_t) * 3 + 1;
+  static constexpr std::size_t INFO_SIZE = sizeof(int32_t) * 2 + 1;
+
+  bool operator()(const Context &context, StringPiece args,
+                  NewOrderQuery &query) const {
+    if (args.size() < HEADER_SIZE) {
+      return false;
+    }
+    Decoder dec(args);
+    dec >> query.W_ID >> query.D_ID >> query.C_ID >> query.O_OL_CNT;
+    if (!valid_warehouse(context, query.W_ID) ||
+        !valid_district(context, query.D_ID) ||
+        !in_range(query.C_ID, 1, 3000) || !in_range(query.O_OL_CNT, 1, 15) ||
+        args.size() != HEADER_SIZE + query.O_OL_CNT * INFO_SIZE) {
+      return false;
+    }
+
+    for (auto i = 0; i < query.O_OL_CNT; i++) {
+      auto &info = query.INFO[i];
+      dec >> info.OL_I_ID >> info.OL_SUPPLY_W_ID >> info.OL_QUANTITY;
+      if (!in_range(info.OL_I_ID, 0, 100000) ||
+          !valid_warehouse(context, info.OL_SUPPLY_W_ID) ||
+          !in_range(info.OL_QUANTITY, 1, 10)) {
+        return false;
+      }
+      for (auto k = 0; k < i; k++) {
+        if (query.INFO[k].OL_I_ID == info.OL_I_ID) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+};
+
+class decodePaymentQuery : public decodeQuery {
+public:
+  static constexpr std::size_t SIZE = sizeof(int32_t) * 5 + sizeof(float);
+
+  bool operator()(const Context &context, StringPiece args,
+                  PaymentQuery &query) const {
+    if (args.size() != SIZE) {
+      return false;
+    }
+    Decoder dec(args);
+    dec >> query.W_ID >> query.D_ID >> query.C_ID >> query.C_D_ID >>
+        query.C_W_ID >> query.H_AMOUNT;
+    return valid_warehouse(context, query.W_ID) &&
+           valid_district(context, query.D_ID) &&
+           in_range(query.C_ID, 1, 3000) &&
+           valid_warehouse(context, query.C_W_ID) &&
+           valid_district(context, query.C_D_ID) && query.H_AMOUNT >= 1 &&
+           query.H_AMOUNT <= 5000;
+  }
+};
 } // namespace tpcc
 } // namespace coco
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "benchmark/tpcc/Dictionary.h"
 #include "common/ClassOf.h"
 #include "common/FixedString.h"
 #include "common/Hash.h"
@@ -44,7 +45,7 @@ DO_STRUCT(district, DISTRICT_KEY_FIELDS, DISTRICT_VALUE_FIELDS,
   x(int32_t, C_W_ID) y(int32_t, C_D_ID) y(int32_t, C_ID)
 #define CUSTOMER_VALUE_FIELDS(x, y)                                            \
   x(FixedString<16>, C_FIRST) y(FixedString<2>, C_MIDDLE)                      \
-      y(FixedString<16>, C_LAST) y(FixedString<20>, C_STREET_1)                \
+      y(LastNameString, C_LAST) y(FixedString<20>, C_STREET_1)                 \
           y(FixedString<20>, C_STREET_2) y(FixedString<20>, C_CITY)            \
               y(FixedString<2>, C_STATE) y(FixedString<9>, C_ZIP)              \
                   y(FixedString<16>, C_PHONE) y(uint64_t, C_SINCE)             \
@@ -107,12 +108,12 @@ DO_STRUCT(item, ITEM_KEY_FIELDS, ITEM_VALUE_FIELDS, NAMESPACE_FIELDS)
 
 #define STOCK_KEY_FIELDS(x, y) x(int32_t, S_W_ID) y(int32_t, S_I_ID)
 #define STOCK_VALUE_FIELDS(x, y)                                               \
-  x(int16_t, S_QUANTITY) y(FixedString<24>, S_DIST_01)                         \
-      y(FixedString<24>, S_DIST_02) y(FixedString<24>, S_DIST_03)              \
-          y(FixedString<24>, S_DIST_04) y(FixedString<24>, S_DIST_05)          \
-              y(FixedString<24>, S_DIST_06) y(FixedString<24>, S_DIST_07)      \
-                  y(FixedString<24>, S_DIST_08) y(FixedString<24>, S_DIST_09)  \
-                      y(FixedString<24>, S_DIST_10) y(float, S_YTD)            \
+  x(int16_t, S_QUANTITY) y(DistInfoString, S_DIST_01)                          \
+      y(DistInfoString, S_DIST_02) y(DistInfoString, S_DIST_03)                \
+          y(DistInfoString, S_DIST_04) y(DistInfoString, S_DIST_05)            \
+              y(DistInfoString, S_DIST_06) y(DistInfoString, S_DIST_07)        \
+                  y(DistInfoString, S_DIST_08) y(DistInfoString, S_DIST_09)    \
+                      y(DistInfoString, S_DIST_10) y(float, S_YTD)             \
                           y(int32_t, S_ORDER_CNT) y(int32_t, S_REMOTE_CNT)     \
                               y(FixedString<50>, S_DATA)
 
@@ -125,6 +126,10 @@ public:
   std::string operator()(const tpcc::warehouse::value &v) {
     return Serializer<decltype(v.W_YTD)>()(v.W_YTD);
   }
+
+  void operator()(const tpcc::warehouse::value &v, std::string &out) {
+    Serializer<decltype(v.W_YTD)>()(v.W_YTD, out);
+  }
 };
 
 template <> class Deserializer<tpcc::warehouse::value> {
@@ -148,6 +153,11 @@ public:
     return Serializer<decltype(v.D_YTD)>()(v.D_YTD) +
            Serializer<decltype(v.D_NEXT_O_ID)>()(v.D_NEXT_O_ID);
   }
+
+  void operator()(const tpcc::district::value &v, std::string &out) {
+    Serializer<decltype(v.D_YTD)>()(v.D_YTD, out);
+    Serializer<decltype(v.D_NEXT_O_ID)>()(v.D_NEXT_O_ID, out);
+  }
 };
 
 template <> class Deserializer<tpcc::district::value> {
@@ -178,6 +188,13 @@ public:
            Serializer<decltype(v.C_YTD_PAYMENT)>()(v.C_YTD_PAYMENT) +
            Serializer<decltype(v.C_PAYMENT_CNT)>()(v.C_PAYMENT_CNT);
   }
+
+  void operator()(const tpcc::customer::value &v, std::string &out) {
+    Serializer<decltype(v.C_DATA)>()(v.C_DATA, out);
+    Serializer<decltype(v.C_BALANCE)>()(v.C_BALANCE, out);
+    Serializer<decltype(v.C_YTD_PAYMENT)>()(v.C_YTD_PAYMENT, out);
+    Serializer<decltype(v.C_PAYMENT_CNT)>()(v.C_PAYMENT_CNT, out);
+  }
 };
 
 template <> class Deserializer<tpcc::customer::value> {
@@ -217,6 +234,13 @@ public:
            Serializer<decltype(v.S_ORDER_CNT)>()(v.S_ORDER_CNT) +
            Serializer<decltype(v.S_REMOTE_CNT)>()(v.S_REMOTE_CNT);
   }
+
+  void operator()(const tpcc::stock::value &v, std::string &out) {
+    Serializer<decltype(v.S_QUANTITY)>()(v.S_QUANTITY, out);
+    Serializer<decltype(v.S_YTD)>()(v.S_YTD, out);
+    Serializer<decltype(v.S_ORDER_CNT)>()(v.S_ORDER_CNT, out);
+    Serializer<decltype(v.S_REMOTE_CNT)>()(v.S_REMOTE_CNT, out);
+  }
 };
 
 template <> class Deserializer<tpcc::stock::value> {
@@ -28,6 +28,7 @@ struct Storage {
   stock::value stock_values[15];
 
   new_order::key new_order_key;
+  new_order::value new_order_value;
 
   order::key order_key;
   order::value order_value;
@@ -37,6 +38,25 @@ struct Storage {
 
   history::key h_key;
   history::value h_value;
+
+  // delivery, one order per district
+
+  new_order::key delivery_new_order_keys[10];
+  new_order::value delivery_new_order_values[10];
+
+  order::key delivery_order_keys[10];
+  order::value delivery_order_values[10];
+
+  order_line::key delivery_order_line_keys[10][15];
+  order_line::value delivery_order_line_values[10][15];
+
+  customer::key delivery_customer_keys[10];
+  customer::value delivery_customer_values[10];
+
+  // stock level, the distinct items of the last 20 orders
+
+  stock::key stock_level_keys[300];
+  stock::value stock_level_values[300];
 };
 } // namespace tpcc
 } // namespace coco
\ No newline at end of file
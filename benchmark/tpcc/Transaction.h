@@ -16,9 +16,24 @@
 #include "core/Partitioner.h"
 #include "core/Table.h"
 
+#include <algorithm>
+
 namespace coco {
 namespace tpcc {
 
+// NewOrder inserts the rows of its order and Delivery deletes the NEW-ORDER row
+// it delivers once the tables have tombstones, see Tombstone, i.e., with Silo,
+// Scar and TwoPL. Otherwise, the tables keep their loaded orders. So do they
+// with repairs, which renumber an order after its rows are inserted, and with
+// operation replication, whose operations do not carry the rows.
+inline bool inserts_orders(Database &db, const Context &context,
+                           std::size_t partition_id) {
+  return db.find_table(new_order::tableID, partition_id)
+             ->get_tombstone()
+             .enabled() &&
+         !context.repair && !context.operation_replication;
+}
+
 template <class Transaction> class NewOrder : public Transaction {
 public:
   using DatabaseType = Database;
@@ -26,6 +41,9 @@ public:
   using RandomType = typename DatabaseType::RandomType;
   using StorageType = Storage;
 
+  // see Statistics::procedures
+  static constexpr uint32_t procedure = 0;
+
   NewOrder(std::size_t coordinator_id, std::size_t partition_id,
            DatabaseType &db, const ContextType &context, RandomType &random,
            Partitioner &partitioner, Storage &storage)
@@ -71,7 +89,10 @@ public:
     auto customerTableID = customer::tableID;
     storage.customer_key = customer::key(W_ID, D_ID, C_ID);
     this->search_for_read(customerTableID, W_ID - 1, storage.customer_key,
-                          storage.customer_value);
+                          storage.customer_value,
+                          (1ull << customer::value::C_DISCOUNT_field) |
+                              (1ull << customer::value::C_LAST_field) |
+                              (1ull << customer::value::C_CREDIT_field));
 
     auto itemTableID = item::tableID;
     auto stockTableID = stock::tableID;
@@ -98,8 +119,15 @@ public:
         return TransactionResult::ABORT_NORETRY;
       }
 
-      this->search_local_index(itemTableID, 0, storage.item_keys[i],
-                               storage.item_values[i]);
+      if (context.reference_item) {
+        // no metadata is read and nothing is validated, see ReferenceTable
+        auto value = db.find_item(storage.item_keys[i]);
+        DCHECK(value != nullptr);
+        storage.item_values[i] = *value;
+      } else {
+        this->search_local_index(itemTableID, 0, storage.item_keys[i],
+                                 storage.item_values[i]);
+      }
 
       // The row in the STOCK table with matching S_I_ID (equals OL_I_ID) and
       // S_W_ID (equals OL_SUPPLY_W_ID) is selected.
@@ -117,18 +145,27 @@ public:
     float W_TAX = storage.warehouse_value.W_YTD;
 
     float D_TAX = storage.district_value.D_TAX;
-    int32_t D_NEXT_O_ID = storage.district_value.D_NEXT_O_ID;
-
-    storage.district_value.D_NEXT_O_ID += 1;
+    int32_t D_NEXT_O_ID = next_order_id();
 
     this->update(districtTableID, W_ID - 1, storage.district_key,
                  storage.district_value);
+    if (context.repair) {
+      // a newer D_NEXT_O_ID read at commit renumbers the order
+      this->on_repair(storage.district_key, [this]() {
+        int32_t O_ID = next_order_id();
+        storage.new_order_key.NO_O_ID = O_ID;
+        storage.order_key.O_ID = O_ID;
+        for (int i = 0; i < query.O_OL_CNT; i++) {
+          storage.order_line_keys[i].OL_O_ID = O_ID;
+        }
+      });
+    }
 
     if (context.operation_replication) {
       Encoder encoder(this->operation.data);
       this->operation.partition_id = this->partition_id;
       encoder << true << storage.district_key.D_W_ID
-              << storage.district_key.D_ID
+              << storage.district_key.D_ID << storage.district_value.D_YTD
               << storage.district_value.D_NEXT_O_ID;
     }
 
@@ -149,6 +186,21 @@ public:
     storage.order_value.O_C_ID = query.C_ID;
     storage.order_value.O_ALL_LOCAL = !query.isRemote();
 
+    auto newOrderTableID = new_order::tableID;
+    auto orderTableID = order::tableID;
+    bool inserts = inserts_orders(db, context, W_ID - 1);
+    if (inserts) {
+      // the key is present only if another order took D_NEXT_O_ID first, in
+      // which case the district fails validation anyway
+      storage.new_order_value.NO_DUMMY = 0;
+      if (!this->insert(newOrderTableID, W_ID - 1, storage.new_order_key,
+                        storage.new_order_value) ||
+          !this->insert(orderTableID, W_ID - 1, storage.order_key,
+                        storage.order_value)) {
+        return TransactionResult::ABORT;
+      }
+    }
+
     float total_amount = 0;
 
     auto orderLineTableID = order_line::tableID;
@@ -161,30 +213,14 @@ public:
 
       float I_PRICE = storage.item_values[i].I_PRICE;
 
-      // S_QUANTITY, the quantity in stock, S_DIST_xx, where xx represents the
-      // district number, and S_DATA are retrieved. If the retrieved value for
-      // S_QUANTITY exceeds OL_QUANTITY by 10 or more, then S_QUANTITY is
-      // decreased by OL_QUANTITY; otherwise S_QUANTITY is updated to
-      // (S_QUANTITY - OL_QUANTITY)+91. S_YTD is increased by OL_QUANTITY and
-      // S_ORDER_CNT is incremented by 1. If the order-line is remote, then
-      // S_REMOTE_CNT is incremented by 1.
-
-      if (storage.stock_values[i].S_QUANTITY >= OL_QUANTITY + 10) {
-        storage.stock_values[i].S_QUANTITY -= OL_QUANTITY;
-      } else {
-        storage.stock_values[i].S_QUANTITY =
-            storage.stock_values[i].S_QUANTITY - OL_QUANTITY + 91;
-      }
-
-      storage.stock_values[i].S_YTD += OL_QUANTITY;
-      storage.stock_values[i].S_ORDER_CNT++;
-
-      if (OL_SUPPLY_W_ID != W_ID) {
-        storage.stock_values[i].S_REMOTE_CNT++;
-      }
+      update_stock(i);
 
       this->update(stockTableID, OL_SUPPLY_W_ID - 1, storage.stock_keys[i],
                    storage.stock_values[i]);
+      if (context.repair) {
+        this->on_repair(storage.stock_keys[i],
+                        [this, i]() { update_stock(i); });
+      }
 
       if (context.operation_replication) {
         Encoder encoder(this->operation.data);
@@ -251,6 +287,16 @@ public:
           break;
         }
         total_amount += OL_AMOUNT * (1 - C_DISCOUNT) * (1 + W_TAX + D_TAX);
+
+        // A new row is inserted into the ORDER-LINE table to reflect the item
+        // on the order.
+
+        if (inserts &&
+            !this->insert(orderLineTableID, W_ID - 1,
+                          storage.order_line_keys[i],
+                          storage.order_line_values[i])) {
+          return TransactionResult::ABORT;
+        }
       }
     }
 
@@ -258,7 +304,58 @@ public:
   }
 
   void reset_query() override {
-    query = makeNewOrderQuery()(context, partition_id, random);
+    query = makeNewOrderQuery()(context, partition_id + 1, random);
+  }
+
+  // the order goes to district D_ID instead, see ConflictRouter
+  void set_district(int32_t D_ID) { query.D_ID = D_ID; }
+
+  // a query a client submitted, see IngressServer
+  void set_query(const NewOrderQuery &query) { this->query = query; }
+
+  // draws a new query on partition_id, see TransactionPool
+  void renew(std::size_t partition_id) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    reset_query();
+  }
+
+private:
+  // the order takes D_NEXT_O_ID of the district
+  int32_t next_order_id() {
+    int32_t D_NEXT_O_ID = storage.district_value.D_NEXT_O_ID;
+    storage.district_value.D_NEXT_O_ID += 1;
+    return D_NEXT_O_ID;
+  }
+
+  void update_stock(int i) {
+    int32_t W_ID = this->partition_id + 1;
+    int8_t OL_QUANTITY = query.INFO[i].OL_QUANTITY;
+    int32_t OL_SUPPLY_W_ID = query.INFO[i].OL_SUPPLY_W_ID;
+
+    // S_QUANTITY, the quantity in stock, S_DIST_xx, where xx represents the
+    // district number, and S_DATA are retrieved. If the retrieved value for
+    // S_QUANTITY exceeds OL_QUANTITY by 10 or more, then S_QUANTITY is
+    // decreased by OL_QUANTITY; otherwise S_QUANTITY is updated to
+    // (S_QUANTITY - OL_QUANTITY)+91. S_YTD is increased by OL_QUANTITY and
+    // S_ORDER_CNT is incremented by 1. If the order-line is remote, then
+    // S_REMOTE_CNT is incremented by 1.
+
+    if (storage.stock_values[i].S_QUANTITY >= OL_QUANTITY + 10) {
+      storage.stock_values[i].S_QUANTITY -= OL_QUANTITY;
+    } else {
+      storage.stock_values[i].S_QUANTITY =
+          storage.stock_values[i].S_QUANTITY - OL_QUANTITY + 91;
+    }
+
+    storage.stock_values[i].S_YTD += OL_QUANTITY;
+    storage.stock_values[i].S_ORDER_CNT++;
+
+    if (OL_SUPPLY_W_ID != W_ID) {
+      storage.stock_values[i].S_REMOTE_CNT++;
+    }
   }
 
 private:
@@ -277,6 +374,8 @@ public:
   using RandomType = typename DatabaseType::RandomType;
   using StorageType = Storage;
 
+  static constexpr uint32_t procedure = 1;
+
   Payment(std::size_t coordinator_id, std::size_t partition_id,
           DatabaseType &db, const ContextType &context, RandomType &random,
           Partitioner &partitioner, Storage &storage)
@@ -305,8 +404,13 @@ public:
       // W_NAME, W_STREET_1, W_STREET_2, W_CITY, W_STATE, and W_ZIP are
       // retrieved and W_YTD,
       storage.warehouse_key = warehouse::key(W_ID);
-      this->search_for_update(warehouseTableID, W_ID - 1, storage.warehouse_key,
-                              storage.warehouse_value);
+      if (context.commutative_ytd) {
+        this->search_for_read(warehouseTableID, W_ID - 1,
+                              storage.warehouse_key, storage.warehouse_value);
+      } else {
+        this->search_for_update(warehouseTableID, W_ID - 1,
+                                storage.warehouse_key, storage.warehouse_value);
+      }
     }
 
     // The row in the DISTRICT table with matching D_W_ID and D_ID is selected.
@@ -315,8 +419,13 @@ public:
 
     auto districtTableID = district::tableID;
     storage.district_key = district::key(W_ID, D_ID);
-    this->search_for_update(districtTableID, W_ID - 1, storage.district_key,
+    if (context.commutative_ytd) {
+      this->search_for_read(districtTableID, W_ID - 1, storage.district_key,
                             storage.district_value);
+    } else {
+      this->search_for_update(districtTableID, W_ID - 1, storage.district_key,
+                              storage.district_value);
+    }
 
     // The row in the CUSTOMER table with matching C_W_ID, C_D_ID, and C_ID is
     // selected and C_DISCOUNT, the customer's discount rate, C_LAST, the
@@ -345,29 +454,54 @@ public:
       return TransactionResult::ABORT;
     }
 
+    if (context.operation_replication) {
+      this->operation.partition_id = this->partition_id;
+      Encoder encoder(this->operation.data);
+      encoder << false << context.write_to_w_ytd;
+    }
+
     if (context.write_to_w_ytd) {
       // the warehouse's year-to-date balance, is increased by H_ AMOUNT.
       storage.warehouse_value.W_YTD += H_AMOUNT;
-      this->update(warehouseTableID, W_ID - 1, storage.warehouse_key,
-                   storage.warehouse_value);
+      if (context.commutative_ytd) {
+        this->add_to_field(warehouseTableID, W_ID - 1, storage.warehouse_key,
+                           warehouse::value::W_YTD_field, H_AMOUNT);
+      } else {
+        this->update(warehouseTableID, W_ID - 1, storage.warehouse_key,
+                     storage.warehouse_value);
+        if (context.repair) {
+          this->on_repair(storage.warehouse_key, [this, H_AMOUNT]() {
+            storage.warehouse_value.W_YTD += H_AMOUNT;
+          });
+        }
+      }
 
       if (context.operation_replication) {
-        this->operation.partition_id = this->partition_id;
         Encoder encoder(this->operation.data);
-        encoder << false << storage.warehouse_key.W_ID
-                << storage.warehouse_value.W_YTD;
+        encoder << storage.warehouse_key.W_ID << storage.warehouse_value.W_YTD;
       }
     }
 
     // the district's year-to-date balance, is increased by H_AMOUNT.
     storage.district_value.D_YTD += H_AMOUNT;
-    this->update(districtTableID, W_ID - 1, storage.district_key,
-                 storage.district_value);
+    if (context.commutative_ytd) {
+      this->add_to_field(districtTableID, W_ID - 1, storage.district_key,
+                         district::value::D_YTD_field, H_AMOUNT);
+    } else {
+      this->update(districtTableID, W_ID - 1, storage.district_key,
+                   storage.district_value);
+      if (context.repair) {
+        this->on_repair(storage.district_key, [this, H_AMOUNT]() {
+          storage.district_value.D_YTD += H_AMOUNT;
+        });
+      }
+    }
 
     if (context.operation_replication) {
       Encoder encoder(this->operation.data);
       encoder << storage.district_key.D_W_ID << storage.district_key.D_ID
-              << storage.district_value.D_YTD;
+              << storage.district_value.D_YTD
+              << storage.district_value.D_NEXT_O_ID;
     }
 
     char C_DATA[501];
@@ -411,13 +545,16 @@ public:
 
     if (context.operation_replication) {
       Encoder encoder(this->operation.data);
+      // the whole C_DATA is replicated, the prefix alone would depend on
+      // the C_DATA of the replica
+      bool bad_credit = total_written > 0;
       encoder << storage.customer_key.C_W_ID << storage.customer_key.C_D_ID
-              << storage.customer_key.C_ID;
-      encoder << uint32_t(total_written);
-      encoder.write_n_bytes(C_DATA, total_written);
-      encoder << storage.customer_value.C_BALANCE
+              << storage.customer_key.C_ID << storage.customer_value.C_BALANCE
               << storage.customer_value.C_YTD_PAYMENT
-              << storage.customer_value.C_PAYMENT_CNT;
+              << storage.customer_value.C_PAYMENT_CNT << bad_credit;
+      if (bad_credit) {
+        encoder.write_n_bytes(C_DATA, 500);
+      }
     }
 
     char H_DATA[25];
@@ -437,7 +574,28 @@ public:
   }
 
   void reset_query() override {
-    query = makePaymentQuery()(context, partition_id, random);
+    query = makePaymentQuery()(context, partition_id + 1, random);
+  }
+
+  // the payment goes to district D_ID instead, and so does a customer of the
+  // home warehouse, see ConflictRouter
+  void set_district(int32_t D_ID) {
+    query.D_ID = D_ID;
+    if (query.C_W_ID == query.W_ID) {
+      query.C_D_ID = D_ID;
+    }
+  }
+
+  // a query a client submitted, see IngressServer
+  void set_query(const PaymentQuery &query) { this->query = query; }
+
+  // draws a new query on partition_id, see TransactionPool
+  void renew(std::size_t partition_id) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    reset_query();
   }
 
 private:
@@ -449,5 +607,425 @@ private:
   PaymentQuery query;
 };
 
+template <class Transaction> class OrderStatus : public Transaction {
+public:
+  using DatabaseType = Database;
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+  using StorageType = Storage;
+
+  static constexpr uint32_t procedure = 2;
+
+  OrderStatus(std::size_t coordinator_id, std::size_t partition_id,
+              DatabaseType &db, const ContextType &context, RandomType &random,
+              Partitioner &partitioner, Storage &storage)
+      : Transaction(coordinator_id, partition_id, partitioner), db(db),
+        context(context), random(random), storage(storage),
+        partition_id(partition_id),
+        query(makeOrderStatusQuery()(context, partition_id + 1, random)) {}
+
+  virtual ~OrderStatus() override = default;
+
+  TransactionResult execute(std::size_t worker_id) override {
+
+    int32_t W_ID = this->partition_id + 1;
+
+    // The input data (see Clause 2.6.3.2) are communicated to the SUT.
+
+    int32_t D_ID = query.D_ID;
+    int32_t C_ID = query.C_ID;
+
+    // Case 2, the customer is selected based on customer last name. The row
+    // at position n/2 rounded up of the rows sorted by C_FIRST is kept in the
+    // CUSTOMER_NAME_IDX table.
+
+    auto customerNameIdxTableID = customer_name_idx::tableID;
+
+    if (C_ID == 0) {
+      storage.customer_name_idx_key =
+          customer_name_idx::key(W_ID, D_ID, query.C_LAST);
+      this->search_for_read(customerNameIdxTableID, W_ID - 1,
+                            storage.customer_name_idx_key,
+                            storage.customer_name_idx_value);
+
+      if (this->process_requests(worker_id)) {
+        return TransactionResult::ABORT;
+      }
+      C_ID = storage.customer_name_idx_value.C_ID;
+      CHECK(C_ID > 0) << "Invalid C_ID read from index";
+    }
+
+    // The row in the CUSTOMER table with matching C_W_ID, C_D_ID, and C_ID is
+    // selected and C_BALANCE, C_FIRST, C_MIDDLE, and C_LAST are retrieved.
+
+    auto customerTableID = customer::tableID;
+    storage.customer_key = customer::key(W_ID, D_ID, C_ID);
+    this->search_for_read(customerTableID, W_ID - 1, storage.customer_key,
+                          storage.customer_value,
+                          (1ull << customer::value::C_BALANCE_field) |
+                              (1ull << customer::value::C_FIRST_field) |
+                              (1ull << customer::value::C_MIDDLE_field) |
+                              (1ull << customer::value::C_LAST_field));
+
+    if (this->process_requests(worker_id)) {
+      return TransactionResult::ABORT;
+    }
+
+    // The row in the ORDER table with matching O_W_ID (equals C_W_ID), O_D_ID
+    // (equals C_D_ID), O_C_ID (equals C_ID), and with the largest existing
+    // O_ID, is selected. There is no index on O_C_ID, so all orders of the
+    // district are scanned.
+
+    auto orderTableID = order::tableID;
+    int32_t O_ID = 0;
+    this->template scan<order::key, order::value>(
+        orderTableID, W_ID - 1, order::key(W_ID, D_ID, 0),
+        order::key(W_ID, D_ID + 1, 0),
+        [this, C_ID, &O_ID](const order::key &key, const order::value &value) {
+          if (value.O_C_ID == C_ID) {
+            O_ID = key.O_ID;
+            storage.order_value = value;
+          }
+          return true;
+        });
+
+    if (O_ID == 0) {
+      return TransactionResult::READY_TO_COMMIT;
+    }
+
+    // All rows in the ORDER-LINE table with matching OL_W_ID (equals O_W_ID),
+    // OL_D_ID (equals O_D_ID), and OL_O_ID (equals O_ID) are selected and the
+    // corresponding sets of OL_I_ID, OL_SUPPLY_W_ID, OL_QUANTITY, OL_AMOUNT,
+    // and OL_DELIVERY_D are retrieved.
+
+    auto orderLineTableID = order_line::tableID;
+    int n_order_lines = 0;
+    this->template scan<order_line::key, order_line::value>(
+        orderLineTableID, W_ID - 1, order_line::key(W_ID, D_ID, O_ID, 0),
+        order_line::key(W_ID, D_ID, O_ID + 1, 0),
+        [this, &n_order_lines](const order_line::key &key,
+                               const order_line::value &value) {
+          storage.order_line_values[n_order_lines++] = value;
+          return n_order_lines < 15;
+        });
+
+    return TransactionResult::READY_TO_COMMIT;
+  }
+
+  void reset_query() override {
+    query = makeOrderStatusQuery()(context, partition_id + 1, random);
+  }
+
+  // draws a new query on partition_id, see TransactionPool
+  void renew(std::size_t partition_id) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    reset_query();
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  RandomType &random;
+  Storage &storage;
+  std::size_t partition_id;
+  OrderStatusQuery query;
+};
+
+template <class Transaction> class Delivery : public Transaction {
+public:
+  using DatabaseType = Database;
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+  using StorageType = Storage;
+
+  static constexpr uint32_t procedure = 3;
+
+  Delivery(std::size_t coordinator_id, std::size_t partition_id,
+           DatabaseType &db, const ContextType &context, RandomType &random,
+           Partitioner &partitioner, Storage &storage)
+      : Transaction(coordinator_id, partition_id, partitioner), db(db),
+        context(context), random(random), storage(storage),
+        partition_id(partition_id),
+        query(makeDeliveryQuery()(context, partition_id + 1, random)) {}
+
+  virtual ~Delivery() override = default;
+
+  TransactionResult execute(std::size_t worker_id) override {
+
+    int32_t W_ID = this->partition_id + 1;
+
+    // The input data (see Clause 2.7.3.2) are communicated to the SUT.
+    // For a given warehouse number (W_ID), for each of the districts (D_W_ID,
+    // D_ID) within that warehouse, and for a given carrier number
+    // (O_CARRIER_ID):
+
+    auto newOrderTableID = new_order::tableID;
+    auto orderTableID = order::tableID;
+    auto orderLineTableID = order_line::tableID;
+    auto customerTableID = customer::tableID;
+
+    int32_t O_IDs[10];
+    bool deletes = inserts_orders(db, context, W_ID - 1);
+
+    for (int i = 0; i < context.n_district; i++) {
+      int32_t D_ID = i + 1;
+
+      // The row in the NEW-ORDER table with matching NO_W_ID (equals W_ID) and
+      // NO_D_ID (equals D_ID) and with the lowest NO_O_ID value is selected.
+      // If no matching row is found, then the delivery of an order for this
+      // district is skipped.
+
+      O_IDs[i] = 0;
+      this->template scan<new_order::key, new_order::value>(
+          newOrderTableID, W_ID - 1, new_order::key(W_ID, D_ID, 0),
+          new_order::key(W_ID, D_ID + 1, 0),
+          [&O_IDs, i](const new_order::key &key,
+                      const new_order::value &value) {
+            O_IDs[i] = key.NO_O_ID;
+            return false;
+          });
+
+      if (O_IDs[i] == 0) {
+        continue;
+      }
+
+      // The selected row in the NEW-ORDER table is deleted.
+
+      if (deletes) {
+        storage.delivery_new_order_keys[i] =
+            new_order::key(W_ID, D_ID, O_IDs[i]);
+        this->search_for_update(newOrderTableID, W_ID - 1,
+                                storage.delivery_new_order_keys[i],
+                                storage.delivery_new_order_values[i]);
+      }
+
+      // The row in the ORDER table with matching O_W_ID (equals W_ ID), O_D_ID
+      // (equals D_ID), and O_ID (equals NO_O_ID) is selected, O_C_ID, the
+      // customer number, is retrieved, and O_CARRIER_ID is updated.
+
+      storage.delivery_order_keys[i] = order::key(W_ID, D_ID, O_IDs[i]);
+      this->search_for_update(orderTableID, W_ID - 1,
+                              storage.delivery_order_keys[i],
+                              storage.delivery_order_values[i]);
+    }
+
+    if (this->process_requests(worker_id)) {
+      return TransactionResult::ABORT;
+    }
+
+    for (int i = 0; i < context.n_district; i++) {
+      if (O_IDs[i] == 0) {
+        continue;
+      }
+      // another delivery took the order first
+      if (deletes && this->is_absent(&storage.delivery_new_order_keys[i])) {
+        return TransactionResult::ABORT;
+      }
+      int32_t D_ID = i + 1;
+      const order::value &order_value = storage.delivery_order_values[i];
+
+      // All rows in the ORDER-LINE table with matching OL_W_ID (equals
+      // O_W_ID), OL_D_ID (equals O_D_ID), and OL_O_ID (equals O_ID) are
+      // selected.
+
+      for (int k = 0; k < order_value.O_OL_CNT; k++) {
+        storage.delivery_order_line_keys[i][k] =
+            order_line::key(W_ID, D_ID, O_IDs[i], k + 1);
+        this->search_for_update(orderLineTableID, W_ID - 1,
+                                storage.delivery_order_line_keys[i][k],
+                                storage.delivery_order_line_values[i][k]);
+      }
+
+      // The row in the CUSTOMER table with matching C_W_ID (equals W_ID),
+      // C_D_ID (equals D_ID), and C_ID (equals O_C_ID) is selected.
+
+      storage.delivery_customer_keys[i] =
+          customer::key(W_ID, D_ID, static_cast<int32_t>(order_value.O_C_ID));
+      this->search_for_update(customerTableID, W_ID - 1,
+                              storage.delivery_customer_keys[i],
+                              storage.delivery_customer_values[i]);
+    }
+
+    if (this->process_requests(worker_id)) {
+      return TransactionResult::ABORT;
+    }
+
+    uint64_t OL_DELIVERY_D = Time::now();
+
+    for (int i = 0; i < context.n_district; i++) {
+      if (O_IDs[i] == 0) {
+        continue;
+      }
+
+      if (deletes) {
+        this->remove(newOrderTableID, W_ID - 1,
+                     storage.delivery_new_order_keys[i]);
+      }
+
+      order::value &order_value = storage.delivery_order_values[i];
+      order_value.O_CARRIER_ID = query.O_CARRIER_ID;
+      this->update(orderTableID, W_ID - 1, storage.delivery_order_keys[i],
+                   order_value);
+
+      // All OL_DELIVERY_D, the delivery dates, are updated to the current
+      // system time as returned by the operating system and the sum of all
+      // OL_AMOUNT is retrieved.
+
+      float OL_AMOUNT_SUM = 0;
+      for (int k = 0; k < order_value.O_OL_CNT; k++) {
+        order_line::value &order_line_value =
+            storage.delivery_order_line_values[i][k];
+        order_line_value.OL_DELIVERY_D = OL_DELIVERY_D;
+        OL_AMOUNT_SUM += order_line_value.OL_AMOUNT;
+        this->update(orderLineTableID, W_ID - 1,
+                     storage.delivery_order_line_keys[i][k], order_line_value);
+      }
+
+      // C_BALANCE is increased by the sum of all order-line amounts (OL_AMOUNT)
+      // previously retrieved. C_DELIVERY_CNT is incremented by 1.
+
+      customer::value &customer_value = storage.delivery_customer_values[i];
+      customer_value.C_BALANCE += OL_AMOUNT_SUM;
+      customer_value.C_DELIVERY_CNT += 1;
+      this->update(customerTableID, W_ID - 1,
+                   storage.delivery_customer_keys[i], customer_value);
+    }
+
+    return TransactionResult::READY_TO_COMMIT;
+  }
+
+  void reset_query() override {
+    query = makeDeliveryQuery()(context, partition_id + 1, random);
+  }
+
+  // draws a new query on partition_id, see TransactionPool
+  void renew(std::size_t partition_id) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    reset_query();
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  RandomType &random;
+  Storage &storage;
+  std::size_t partition_id;
+  DeliveryQuery query;
+};
+
+template <class Transaction> class StockLevel : public Transaction {
+public:
+  using DatabaseType = Database;
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+  using StorageType = Storage;
+
+  static constexpr uint32_t procedure = 4;
+
+  StockLevel(std::size_t coordinator_id, std::size_t partition_id,
+             DatabaseType &db, const ContextType &context, RandomType &random,
+             Partitioner &partitioner, Storage &storage)
+      : Transaction(coordinator_id, partition_id, partitioner), db(db),
+        context(context), random(random), storage(storage),
+        partition_id(partition_id),
+        query(makeStockLevelQuery()(context, partition_id + 1, random)) {}
+
+  virtual ~StockLevel() override = default;
+
+  TransactionResult execute(std::size_t worker_id) override {
+
+    int32_t W_ID = this->partition_id + 1;
+
+    // The input data (see Clause 2.8.3.2) are communicated to the SUT.
+
+    int32_t D_ID = query.D_ID;
+
+    // The row in the DISTRICT table with matching D_W_ID and D_ID is selected
+    // and D_NEXT_O_ID is retrieved.
+
+    auto districtTableID = district::tableID;
+    storage.district_key = district::key(W_ID, D_ID);
+    this->search_for_read(districtTableID, W_ID - 1, storage.district_key,
+                          storage.district_value);
+
+    if (this->process_requests(worker_id)) {
+      return TransactionResult::ABORT;
+    }
+
+    int32_t D_NEXT_O_ID = storage.district_value.D_NEXT_O_ID;
+
+    // All rows in the ORDER-LINE table with matching OL_W_ID (equals W_ID),
+    // OL_D_ID (equals D_ID), and OL_O_ID (lower than D_NEXT_O_ID and greater
+    // than or equal to D_NEXT_O_ID minus 20) are selected.
+
+    auto orderLineTableID = order_line::tableID;
+    int32_t I_IDs[300];
+    int n_items = 0;
+    this->template scan<order_line::key, order_line::value>(
+        orderLineTableID, W_ID - 1,
+        order_line::key(W_ID, D_ID, D_NEXT_O_ID - 20, 0),
+        order_line::key(W_ID, D_ID, D_NEXT_O_ID, 0),
+        [&I_IDs, &n_items](const order_line::key &key,
+                           const order_line::value &value) {
+          I_IDs[n_items++] = value.OL_I_ID;
+          return n_items < 300;
+        });
+
+    std::sort(I_IDs, I_IDs + n_items);
+    n_items = std::unique(I_IDs, I_IDs + n_items) - I_IDs;
+
+    // All rows in the STOCK table with matching S_I_ID (equals OL_I_ID) and
+    // S_W_ID (equals W_ID) from the list of distinct item numbers and with
+    // S_QUANTITY lower than threshold are counted (giving low_stock).
+
+    auto stockTableID = stock::tableID;
+    for (int i = 0; i < n_items; i++) {
+      storage.stock_level_keys[i] = stock::key(W_ID, I_IDs[i]);
+      this->search_for_read(stockTableID, W_ID - 1, storage.stock_level_keys[i],
+                            storage.stock_level_values[i]);
+    }
+
+    if (this->process_requests(worker_id)) {
+      return TransactionResult::ABORT;
+    }
+
+    int low_stock = 0;
+    for (int i = 0; i < n_items; i++) {
+      if (storage.stock_level_values[i].S_QUANTITY < query.THRESHOLD) {
+        low_stock++;
+      }
+    }
+
+    return TransactionResult::READY_TO_COMMIT;
+  }
+
+  void reset_query() override {
+    query = makeStockLevelQuery()(context, partition_id + 1, random);
+  }
+
+  // draws a new query on partition_id, see TransactionPool
+  void renew(std::size_t partition_id) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    reset_query();
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  RandomType &random;
+  Storage &storage;
+  std::size_t partition_id;
+  StockLevelQuery query;
+};
+
 } // namespace tpcc
 } // namespace coco
@@ -10,6 +10,9 @@
 #include "benchmark/tpcc/Storage.h"
 #include "benchmark/tpcc/Transaction.h"
 #include "core/Partitioner.h"
+#include "core/Procedure.h"
+#include "core/TransactionPool.h"
+#include "core/TransactionStream.h"
 
 namespace coco {
 
@@ -26,35 +29,133 @@ public:
   Workload(std::size_t coordinator_id, DatabaseType &db, RandomType &random,
            Partitioner &partitioner)
       : coordinator_id(coordinator_id), db(db), random(random),
-        partitioner(partitioner) {}
+        partitioner(partitioner),
+        procedures(coordinator_id, random, partitioner) {}
 
-  std::unique_ptr<TransactionType> next_transaction(const ContextType &context,
-                                                    std::size_t partition_id,
-                                                    StorageType &storage) {
+  // the districts, see ConflictRouter
+  static std::size_t hot_rows(const ContextType &context) {
+    return context.n_district;
+  }
+
+  // with a pool, the transaction is renewed from one of the same type if
+  // the pool has any, see TransactionPool. With a hot row, NewOrder and
+  // Payment are drawn on that district. With --procedure, it is the
+  // registered procedure, see ProcedureRegistry. With a stream, it is
+  // recorded or replayed, see TransactionStream.
+  std::unique_ptr<TransactionType>
+  next_transaction(const ContextType &context, std::size_t partition_id,
+                   StorageType &storage,
+                   TransactionPool<TransactionType> *pool = nullptr,
+                   std::size_t hot_row = 0) {
+
+    if (stream != nullptr) {
+      stream->next(random, partition_id, hot_row);
+    }
+    if (context.procedure >= 0) {
+      return procedures.generated(context, context.procedure, partition_id,
+                                  pool);
+    }
 
     int x = random.uniform_dist(1, 100);
     std::unique_ptr<TransactionType> p;
 
     if (context.workloadType == TPCCWorkloadType::MIXED) {
       if (x <= 50) {
-        p = std::make_unique<NewOrder<Transaction>>(
-            coordinator_id, partition_id, db, context, random, partitioner,
-            storage);
+        p = make<NewOrder<Transaction>>(context, partition_id, storage, pool);
+      } else {
+        p = make<Payment<Transaction>>(context, partition_id, storage, pool);
+      }
+    } else if (context.workloadType == TPCCWorkloadType::STANDARD) {
+      if (x <= 45) {
+        p = make<NewOrder<Transaction>>(context, partition_id, storage, pool);
+      } else if (x <= 88) {
+        p = make<Payment<Transaction>>(context, partition_id, storage, pool);
+      } else if (x <= 92) {
+        p = make<OrderStatus<Transaction>>(context, partition_id, storage,
+                                           pool);
+      } else if (x <= 96) {
+        p = make<Delivery<Transaction>>(context, partition_id, storage, pool);
       } else {
-        p = std::make_unique<Payment<Transaction>>(coordinator_id, partition_id,
-                                                   db, context, random,
-                                                   partitioner, storage);
+        p = make<StockLevel<Transaction>>(context, partition_id, storage,
+                                          pool);
       }
     } else if (context.workloadType == TPCCWorkloadType::NEW_ORDER_ONLY) {
-      p = std::make_unique<NewOrder<Transaction>>(coordinator_id, partition_id,
-                                                  db, context, random,
-                                                  partitioner, storage);
+      p = make<NewOrder<Transaction>>(context, partition_id, storage, pool);
     } else {
-      p = std::make_unique<Payment<Transaction>>(coordinator_id, partition_id,
-                                                 db, context, random,
-                                                 partitioner, storage);
+      p = make<Payment<Transaction>>(context, partition_id, storage, pool);
     }
 
+    if (hot_row > 0) {
+      if (auto t = dynamic_cast<NewOrder<Transaction> *>(p.get())) {
+        t->set_district(hot_row);
+      } else if (auto t = dynamic_cast<Payment<Transaction> *>(p.get())) {
+        t->set_district(hot_row);
+      }
+    }
+
+    return p;
+  }
+
+  // a transaction a client submitted, see IngressServer, NewOrder (0) or
+  // Payment (1), see decodeNewOrderQuery and decodePaymentQuery for their
+  // args, or a registered procedure, see ProcedureRegistry. nullptr unless
+  // the query is valid and its home warehouse is on a partition of this
+  // coordinator.
+  std::unique_ptr<TransactionType>
+  submitted_transaction(const ContextType &context, uint32_t procedure,
+                        StringPiece args, StorageType &storage,
+                        TransactionPool<TransactionType> *pool = nullptr) {
+    if (procedure >= FIRST_PROCEDURE_ID) {
+      return procedures.submitted(context, procedure, args, pool);
+    }
+    if (procedure == 0) {
+      NewOrderQuery query;
+      if (decodeNewOrderQuery()(context, args, query)) {
+        return make_submitted<NewOrder<Transaction>>(context, query, storage,
+                                                     pool);
+      }
+    } else if (procedure == 1) {
+      PaymentQuery query;
+      if (decodePaymentQuery()(context, args, query)) {
+        return make_submitted<Payment<Transaction>>(context, query, storage,
+                                                    pool);
+      }
+    }
+    return nullptr;
+  }
+
+  // the stream of the executor, see TransactionStream::open
+  void set_stream(TransactionStream *stream) { this->stream = stream; }
+
+private:
+  template <class T, class Query>
+  std::unique_ptr<TransactionType>
+  make_submitted(const ContextType &context, const Query &query,
+                 StorageType &storage, TransactionPool<TransactionType> *pool) {
+    std::size_t partition_id = query.W_ID - 1;
+    if (!partitioner.has_master_partition(partition_id)) {
+      return nullptr;
+    }
+    auto p = make<T>(context, partition_id, storage, pool);
+    static_cast<T &>(*p).set_query(query);
+    return p;
+  }
+
+  template <class T>
+  std::unique_ptr<TransactionType>
+  make(const ContextType &context, std::size_t partition_id,
+       StorageType &storage, TransactionPool<TransactionType> *pool) {
+    if (pool != nullptr) {
+      auto p = pool->template take<T>();
+      if (p != nullptr) {
+        static_cast<T &>(*p).renew(partition_id);
+        return p;
+      }
+    }
+    std::unique_ptr<TransactionType> p = std::make_unique<T>(
+        coordinator_id, partition_id, db, context, random, partitioner,
+        storage);
+    p->procedure_id = T::procedure;
     return p;
   }
 
@@ -63,6 +164,8 @@ private:
   DatabaseType &db;
   RandomType &random;
   Partitioner &partitioner;
+  ProcedureRegistry<TransactionType, DatabaseType> procedures;
+  TransactionStream *stream = nullptr;
 };
 
 } // namespace tpcc
@@ -15,26 +15,35 @@ enum class PartitionStrategy { RANGE, ROUND_ROBIN };
 
 enum class YCSBSkewPattern { BOTH, READ, WRITE };
 
+// CUSTOM is ReadModifyWrite with the ratios below, A to F are the core
+// workloads of YCSB, see CoreTransaction
+enum class YCSBWorkload { CUSTOM, A, B, C, D, E, F };
+
 class Context : public coco::Context {
 public:
+  // the loaded keys and the rows reserved for inserts, see KeySpace
+  std::size_t getKeySpacePerPartition() const {
+    return keysPerPartition + insertsPerPartition;
+  }
+
   std::size_t getPartitionID(std::size_t key) const {
-    DCHECK(key >= 0 && key < partition_num * keysPerPartition);
+    DCHECK(key >= 0 && key < partition_num * getKeySpacePerPartition());
 
     if (strategy == PartitionStrategy::ROUND_ROBIN) {
       return key % partition_num;
     } else {
-      return key / keysPerPartition;
+      return key / getKeySpacePerPartition();
     }
   }
 
   std::size_t getGlobalKeyID(std::size_t key, std::size_t partitionID) const {
-    DCHECK(key >= 0 && key < keysPerPartition && partitionID >= 0 &&
+    DCHECK(key >= 0 && key < getKeySpacePerPartition() && partitionID >= 0 &&
            partitionID < partition_num);
 
     if (strategy == PartitionStrategy::ROUND_ROBIN) {
       return key * partition_num + partitionID;
     } else {
-      return partitionID * keysPerPartition + key;
+      return partitionID * getKeySpacePerPartition() + key;
     }
   }
 
@@ -55,6 +64,7 @@ public:
   }
 
 public:
+  YCSBWorkload workload = YCSBWorkload::CUSTOM;
   YCSBSkewPattern skewPattern = YCSBSkewPattern::BOTH;
 
   int readWriteRatio = 0;            // out of 100
@@ -63,6 +73,9 @@ public:
 
   std::size_t keysPerTransaction = 10;
   std::size_t keysPerPartition = 200000;
+  std::size_t insertsPerPartition = 0; // see KeySpace
+  std::size_t maxScanLength = 100;     // workload E
+  std::size_t loadThreads = 0;         // 0 for worker_num
 
   bool isUniform = true;
   bool two_partitions = false;
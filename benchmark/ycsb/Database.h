@@ -5,15 +5,19 @@
 #pragma once
 
 #include "benchmark/ycsb/Context.h"
+#include "benchmark/ycsb/KeySpace.h"
 #include "benchmark/ycsb/Random.h"
 #include "benchmark/ycsb/Schema.h"
 #include "benchmark/ycsb/Storage.h"
 #include "common/Operation.h"
+#include "core/DatabaseImage.h"
+#include "core/NumaPlacement.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstring>
 #include <glog/logging.h>
 #include <thread>
 #include <unordered_map>
@@ -21,12 +25,16 @@
 
 namespace coco {
 namespace ycsb {
-class Database {
+
+// the rows of ycsb are Value, either ycsb::value or a YCSBRecord, see
+// --field_size
+template <class Value> class BasicDatabase {
 public:
   using MetaDataType = std::atomic<uint64_t>;
   using ContextType = Context;
   using RandomType = Random;
-  using StorageType = Storage;
+  using ValueType = Value;
+  using StorageType = BasicStorage<Value>;
 
   ITable *find_table(std::size_t table_id, std::size_t partition_id) {
     DCHECK(table_id < tbl_vecs.size());
@@ -34,35 +42,154 @@ public:
     return tbl_vecs[table_id][partition_id];
   }
 
-  template <class InitFunc>
-  void initTables(const std::string &name, InitFunc initFunc,
-                  std::size_t partitionNum, std::size_t threadsNum,
-                  Partitioner *partitioner) {
+  // the tables of all partitions replicated on this node
+  std::vector<ITable *> local_tables(const Partitioner &partitioner) {
+    std::vector<ITable *> tables;
+    for (auto &partitions : tbl_vecs) {
+      for (auto table : partitions) {
+        if (partitioner.is_partition_replicated_on_me(table->partitionID())) {
+          tables.push_back(table);
+        }
+      }
+    }
+    return tables;
+  }
+
+  // the tables of a partition, see Migrator
+  std::vector<ITable *> partition_tables(std::size_t partition_id) {
+    std::vector<ITable *> tables;
+    for (auto &partitions : tbl_vecs) {
+      if (partition_id < partitions.size()) {
+        tables.push_back(partitions[partition_id]);
+      }
+    }
+    return tables;
+  }
+
+  template <class KeyType, class ValueType>
+  using TypedTable = Table<9973, KeyType, ValueType>;
+
+  template <class KeyType, class ValueType>
+  TypedTable<KeyType, ValueType> &typed_table(std::size_t table_id,
+                                              std::size_t partition_id) {
+    DCHECK(mvcc == false) << "mvcc tables are not typed tables.";
+    DCHECK(evictable == false) << "evictable tables are not typed tables.";
+    DCHECK(persistent == false) << "persistent tables are not typed tables.";
+    DCHECK(ordered == false) << "ordered tables are not typed tables.";
+    return static_cast<TypedTable<KeyType, ValueType> &>(
+        *find_table(table_id, partition_id));
+  }
+
+  template <class KeyType, class ValueType>
+  OrderedTable<KeyType, ValueType> &ordered_table(std::size_t table_id,
+                                                  std::size_t partition_id) {
+    DCHECK(mvcc == false) << "mvcc tables are not ordered tables.";
+    DCHECK(ordered) << "ordered tables are only for scans.";
+    return static_cast<OrderedTable<KeyType, ValueType> &>(
+        *find_table(table_id, partition_id));
+  }
+
+  // call func with the concrete table type, so that the table access can be
+  // inlined; fall back to ITable when tables are mvcc, evictable or
+  // persistent tables.
+  template <class Func>
+  auto visit_table(std::size_t table_id, std::size_t partition_id, Func func) {
+    if (mvcc || evictable || persistent) {
+      return func(*find_table(table_id, partition_id));
+    }
+    DCHECK(table_id == ycsb::tableID);
+    if (ordered) {
+      return func(
+          ordered_table<ycsb::key, ValueType>(table_id, partition_id));
+    }
+    return func(typed_table<ycsb::key, ValueType>(table_id, partition_id));
+  }
+
+  // a partition is loaded in chunks of keys, see initTables
+  static constexpr std::size_t LOAD_CHUNK_KEYS = 1 << 16;
 
-    std::vector<int> all_parts;
+  // calls reserveFunc(partitionID) on each partition of this node, and then
+  // initFunc(partitionID, begin, end) on each chunk of keysNum keys of the
+  // partition, i.e., on [begin, end). A thread takes the next chunk once it
+  // is done with one, so that all threads are busy even if a node has fewer
+  // partitions than threads, e.g., with a billion keys in a few partitions.
+  template <class ReserveFunc, class InitFunc>
+  void initTables(const std::string &name, ReserveFunc reserveFunc,
+                  InitFunc initFunc, std::size_t partitionNum,
+                  std::size_t keysNum, std::size_t threadsNum,
+                  Partitioner *partitioner, const NumaPlacement *numa) {
 
+    std::vector<std::size_t> all_parts;
+
+    // the partitions kept from a former run are not loaded again, see
+    // PersistentTable
     for (auto i = 0u; i < partitionNum; i++) {
-      if (partitioner == nullptr ||
-          partitioner->is_partition_replicated_on_me(i)) {
+      // a rebuilt replica is streamed from its master, see ReplicaRebuilder
+      if (partitioner != nullptr && rebuild_replicas &&
+          !partitioner->has_master_partition(i)) {
+        continue;
+      }
+      if ((partitioner == nullptr ||
+           partitioner->is_partition_replicated_on_me(i)) &&
+          !tbl_ycsb_vec[i]->is_restored()) {
         all_parts.push_back(i);
       }
     }
 
-    std::vector<std::thread> v;
+    struct Chunk {
+      std::size_t partitionID, begin, end;
+    };
+    std::vector<Chunk> chunks;
+    for (auto partitionID : all_parts) {
+      for (std::size_t begin = 0; begin < keysNum; begin += LOAD_CHUNK_KEYS) {
+        chunks.push_back(
+            {partitionID, begin, std::min(begin + LOAD_CHUNK_KEYS, keysNum)});
+      }
+    }
+
     auto now = std::chrono::steady_clock::now();
 
+    // the memory of a partition is allocated on the node that first touches
+    // it
+    auto pin = [numa](std::size_t partitionID) {
+      if (numa != nullptr) {
+        NumaPlacement::pin_thread(
+            pthread_self(), numa->cpus(numa->partition_node(partitionID)));
+      }
+    };
+
+    std::vector<std::thread> v;
     for (auto threadID = 0u; threadID < threadsNum; threadID++) {
-      v.emplace_back([=]() {
+      v.emplace_back([&, threadID]() {
         for (auto i = threadID; i < all_parts.size(); i += threadsNum) {
-          auto partitionID = all_parts[i];
-          initFunc(partitionID);
+          pin(all_parts[i]);
+          reserveFunc(all_parts[i]);
+        }
+      });
+    }
+    for (auto &t : v) {
+      t.join();
+    }
+    v.clear();
+
+    std::atomic<std::size_t> next_chunk(0);
+    for (auto threadID = 0u; threadID < threadsNum; threadID++) {
+      v.emplace_back([&]() {
+        for (;;) {
+          auto i = next_chunk.fetch_add(1);
+          if (i >= chunks.size()) {
+            break;
+          }
+          pin(chunks[i].partitionID);
+          initFunc(chunks[i].partitionID, chunks[i].begin, chunks[i].end);
         }
       });
     }
     for (auto &t : v) {
       t.join();
     }
-    LOG(INFO) << name << " initialization finished in "
+    LOG(INFO) << name << " initialization of " << chunks.size()
+              << " chunks finished in "
               << std::chrono::duration_cast<std::chrono::milliseconds>(
                      std::chrono::steady_clock::now() - now)
                      .count()
@@ -73,16 +200,37 @@ public:
 
     std::size_t coordinator_id = context.coordinator_id;
     std::size_t partitionNum = context.partition_num;
-    std::size_t threadsNum = context.worker_num;
+    std::size_t threadsNum =
+        context.loadThreads > 0 ? context.loadThreads : context.worker_num;
+    mvcc = context.mvcc;
+    rebuild_replicas = context.rebuilds_replicas();
+    evictable = !context.anti_cache_path.empty();
+    persistent = !context.pmem_path.empty();
+    // workload E scans
+    ordered = context.workload == YCSBWorkload::E;
+
+    KeySpace::global().init(partitionNum, context.keysPerPartition,
+                            context.insertsPerPartition);
 
     auto partitioner = PartitionerFactory::create_partitioner(
         context.partitioner, coordinator_id, context.coordinator_num);
 
+    std::unique_ptr<NumaPlacement> numa;
+    if (context.numa) {
+      numa = std::make_unique<NumaPlacement>(context);
+    }
+
     for (auto partitionID = 0u; partitionID < partitionNum; partitionID++) {
       auto ycsbTableID = ycsb::tableID;
-      tbl_ycsb_vec.push_back(
-          TableFactory::create_table<9973, ycsb::key, ycsb::value>(
-              context, ycsbTableID, partitionID));
+      if (ordered) {
+        tbl_ycsb_vec.push_back(
+            TableFactory::create_ordered_table<9973, ycsb::key, ValueType>(
+                context, ycsbTableID, partitionID));
+      } else {
+        tbl_ycsb_vec.push_back(
+            TableFactory::create_table<9973, ycsb::key, ValueType>(
+                context, ycsbTableID, partitionID));
+      }
     }
 
     // there is 1 table in ycsb
@@ -93,84 +241,140 @@ public:
     std::transform(tbl_ycsb_vec.begin(), tbl_ycsb_vec.end(),
                    std::back_inserter(tbl_vecs[0]), tFunc);
 
+    // see DatabaseImage
+    if (!context.image_path.empty() && !context.dump_image) {
+      DatabaseImage::load_all(local_tables(*partitioner), context.image_path,
+                              threadsNum, numa.get());
+      return;
+    }
+
     using std::placeholders::_1;
     initTables(
         "ycsb",
         [&context, this](std::size_t partitionID) {
-          ycsbInit(context, partitionID);
+          tbl_ycsb_vec[partitionID]->reserve(context.getKeySpacePerPartition());
         },
-        partitionNum, threadsNum, partitioner.get());
-  }
-
-  void apply_operation(const Operation &operation) {
-    CHECK(false); // not supported
-  }
-
-private:
-  void ycsbInit(const Context &context, std::size_t partitionID) {
+        [&context, this](std::size_t partitionID, std::size_t begin,
+                         std::size_t end) {
+          ycsbInit(context, partitionID, begin, end);
+        },
+        partitionNum, context.getKeySpacePerPartition(), threadsNum,
+        partitioner.get(), numa.get());
 
-    Random random;
-    ITable *table = tbl_ycsb_vec[partitionID].get();
+    if (context.dump_image) {
+      DatabaseImage::dump_all(local_tables(*partitioner), context.image_path,
+                              threadsNum, numa.get());
+    }
 
-    std::size_t keysPerPartition =
-        context.keysPerPartition; // 5M keys per partition
-    std::size_t partitionNum = context.partition_num;
-    std::size_t totalKeys = keysPerPartition * partitionNum;
+    for (auto table : local_tables(*partitioner)) {
+      table->set_loaded();
+    }
+  }
 
-    if (context.strategy == PartitionStrategy::RANGE) {
+  // the fields a ReadModifyWrite writes to a row, drawn from random
+  static void write_fields(ycsb::value &value, RandomType &random) {
+    value.Y_F01.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F02.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F03.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F04.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F05.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F06.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F07.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F08.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F09.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+    value.Y_F10.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+  }
 
-      // use range partitioning
+  template <std::size_t FieldCount, std::size_t FieldSize>
+  static void write_fields(YCSBRecord<FieldCount, FieldSize> &value,
+                           RandomType &random) {
+    for (auto i = 0u; i < FieldCount; i++) {
+      auto field = random.a_string(FieldSize, FieldSize);
+      std::memcpy(value.field(i), field.data(), FieldSize);
+    }
+  }
 
-      for (auto i = partitionID * keysPerPartition;
-           i < (partitionID + 1) * keysPerPartition; i++) {
+  // the fields a read-modify-write derives from the ones it read, each field
+  // takes the value of the next one, see CoreTransaction
+  static void shift_fields(ycsb::value &value) {
+    auto first = value.Y_F01;
+    value.Y_F01 = value.Y_F02;
+    value.Y_F02 = value.Y_F03;
+    value.Y_F03 = value.Y_F04;
+    value.Y_F04 = value.Y_F05;
+    value.Y_F05 = value.Y_F06;
+    value.Y_F06 = value.Y_F07;
+    value.Y_F07 = value.Y_F08;
+    value.Y_F08 = value.Y_F09;
+    value.Y_F09 = value.Y_F10;
+    value.Y_F10 = first;
+  }
 
-        DCHECK(context.getPartitionID(i) == partitionID);
+  template <std::size_t FieldCount, std::size_t FieldSize>
+  static void shift_fields(YCSBRecord<FieldCount, FieldSize> &value) {
+    std::rotate(value.field(0), value.field(1),
+                value.field(0) + FieldCount * FieldSize);
+  }
 
-        ycsb::key key(i);
-        ycsb::value value;
-        value.Y_F01.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F02.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F03.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F04.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F05.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F06.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F07.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F08.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F09.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F10.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+  // replays the updates of a ReadModifyWrite, each is a key and the seed its
+  // fields are drawn from. write(tid, func) is called for each row and func
+  // sets its fields, see OperationReplication.
+  template <class Func>
+  void apply_operation(const Operation &operation, Func write) {
+
+    Decoder dec(operation.data);
+    ITable *table = tbl_ycsb_vec[operation.partition_id].get();
+
+    while (dec.size() > 0) {
+      ycsb::key key;
+      uint64_t seed;
+      dec >> key.Y_KEY >> seed;
+
+      auto row = table->search(&key);
+      ValueType &value = *static_cast<ValueType *>(std::get<1>(row));
+      write(*std::get<0>(row), [&]() {
+        RandomType random;
+        random.set_seed(seed);
+        write_fields(value, random);
+      });
+    }
+  }
 
-        table->insert(&key, &value);
-      }
+private:
+  // the local keys [begin, end) of a partition, which are loaded keys or
+  // rows reserved for inserts, see KeySpace. The fields are drawn from a seed
+  // of the chunk, so that the rows do not depend on the number of threads.
+  void ycsbInit(const Context &context, std::size_t partitionID,
+                std::size_t begin, std::size_t end) {
 
-    } else {
+    Random random(partitionID << 40 | begin);
+    ITable *table = tbl_ycsb_vec[partitionID].get();
 
-      // use round-robin hash partitioning
+    // with range partitioning, the keys of a partition are consecutive, and
+    // with round-robin hash partitioning, they are partition_num apart
 
-      for (auto i = partitionID; i < totalKeys; i += partitionNum) {
+    for (auto i = begin; i < end; i++) {
 
-        DCHECK(context.getPartitionID(i) == partitionID);
+      ycsb::key key(context.getGlobalKeyID(i, partitionID));
+      DCHECK(context.getPartitionID(key.Y_KEY) == partitionID);
 
-        ycsb::key key(i);
-        ycsb::value value;
-        value.Y_F01.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F02.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F03.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F04.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F05.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F06.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F07.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F08.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F09.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-        value.Y_F10.assign(random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+      ValueType value;
+      write_fields(value, random);
 
-        table->insert(&key, &value);
-      }
+      table->insert(&key, &value);
     }
   }
 
 private:
+  bool mvcc = false;
+  bool rebuild_replicas = false; // see ReplicaRebuilder
+  bool evictable = false;
+  bool persistent = false;
+  bool ordered = false;
   std::vector<std::vector<ITable *>> tbl_vecs;
   std::vector<std::unique_ptr<ITable>> tbl_ycsb_vec;
 };
+
+using Database = BasicDatabase<ycsb::value>;
 } // namespace ycsb
 } // namespace coco
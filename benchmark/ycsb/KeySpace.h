@@ -0,0 +1,76 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <vector>
+
+namespace coco {
+namespace ycsb {
+
+/*
+ * KeySpace is the key space of a partition in the core workloads, which grows
+ * with the inserts of workloads D and E. A partition loads keysPerPartition
+ * keys, with local keys in [0, loaded), and reserves insertsPerPartition rows
+ * after them, see Database::ycsbInit. The protocols have no transactional
+ * insert, so an insert writes the next reserved row of its partition, and
+ * starts over at the first one once all of them are taken.
+ *
+ * The latest distribution of workload D favors the keys that were inserted
+ * last: rank 0 is the last insert, and the ranks past the inserts are the
+ * loaded keys, from the last one down.
+ */
+
+class KeySpace {
+public:
+  void init(std::size_t partition_num, std::size_t loaded,
+            std::size_t reserved) {
+    CHECK(loaded > 0);
+    this->loaded = loaded;
+    this->reserved = reserved;
+    counters = std::vector<Counter>(partition_num);
+  }
+
+  // the local key the next insert into partition_id writes
+  std::size_t insert(std::size_t partition_id) {
+    DCHECK(reserved > 0);
+    DCHECK(partition_id < counters.size());
+    auto n = counters[partition_id].inserts.fetch_add(
+        1, std::memory_order_relaxed);
+    return loaded + n % reserved;
+  }
+
+  // the local key of rank in the latest distribution of partition_id
+  std::size_t latest(std::size_t partition_id, std::size_t rank) const {
+    DCHECK(partition_id < counters.size());
+    uint64_t inserts =
+        counters[partition_id].inserts.load(std::memory_order_relaxed);
+    uint64_t inserted = std::min<uint64_t>(inserts, reserved);
+    if (rank < inserted) {
+      return loaded + (inserts - 1 - rank) % reserved;
+    }
+    return loaded - 1 - (rank - inserted) % loaded;
+  }
+
+  static KeySpace &global() {
+    static KeySpace k;
+    return k;
+  }
+
+private:
+  // a cache line each, the workers of a partition insert into it at once
+  struct alignas(64) Counter {
+    std::atomic<uint64_t> inserts{0};
+  };
+
+  std::size_t loaded = 1;
+  std::size_t reserved = 0;
+  std::vector<Counter> counters;
+};
+} // namespace ycsb
+} // namespace coco
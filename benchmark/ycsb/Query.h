@@ -5,14 +5,35 @@
 #pragma once
 
 #include "benchmark/ycsb/Context.h"
+#include "benchmark/ycsb/KeySpace.h"
 #include "benchmark/ycsb/Random.h"
+#include "common/Encoder.h"
+#include "common/StringPiece.h"
 #include "common/Zipf.h"
+#include "core/WorkloadPhases.h"
+
+#include <algorithm>
 
 namespace coco {
 namespace ycsb {
 
+// the skew and the cross ratio of the current phase, see WorkloadPhases
+inline bool uniform_keys(const Context &context) {
+  return WorkloadPhases::global().is_uniform(context.isUniform);
+}
+
+inline int64_t skewed_key(uint64_t n, Random &random) {
+  return WorkloadPhases::global().skewed(Zipf::globalZipf(), n,
+                                         random.next_double());
+}
+
+inline int cross_ratio(const Context &context) {
+  return WorkloadPhases::global().cross_ratio(
+      context.crossPartitionProbability);
+}
+
 template <std::size_t N> struct YCSBQuery {
-  int32_t Y_KEY[N];
+  int64_t Y_KEY[N];
   bool UPDATE[N];
 };
 
@@ -38,7 +59,7 @@ private:
         }
       }
 
-      int32_t key;
+      int64_t key;
 
       // generate a key in a partition
       bool retry;
@@ -50,17 +71,16 @@ private:
         // case 2: the skew pattern is read, but this is a key for update
         // case 3: the skew pattern is write, but this is a kew for read
 
-        if (context.isUniform ||
+        if (uniform_keys(context) ||
             (context.skewPattern == YCSBSkewPattern::READ && query.UPDATE[i]) ||
             (context.skewPattern == YCSBSkewPattern::WRITE &&
              query.UPDATE[i] == false)) {
-          key = random.uniform_dist(
-              0, static_cast<int>(context.keysPerPartition) - 1);
+          key = random.uniform_dist(0, context.keysPerPartition - 1);
         } else {
-          key = Zipf::globalZipf().value(random.next_double());
+          key = skewed_key(context.keysPerPartition, random);
         }
 
-        if (crossPartition <= context.crossPartitionProbability &&
+        if (crossPartition <= cross_ratio(context) &&
             context.partition_num > 1) {
           auto newPartitionID = partitionID;
           while (newPartitionID == partitionID) {
@@ -86,7 +106,7 @@ private:
     int readOnly = random.uniform_dist(1, 100);
     int crossPartition = random.uniform_dist(1, 100);
     auto newPartitionID = partitionID;
-    if (crossPartition <= context.crossPartitionProbability &&
+    if (crossPartition <= cross_ratio(context) &&
         context.partition_num > 1) {
       newPartitionID = partitionID;
       while (newPartitionID == partitionID) {
@@ -108,18 +128,17 @@ private:
         }
       }
 
-      int32_t key;
+      int64_t key;
 
       // generate a key in a partition
       bool retry;
       do {
         retry = false;
 
-        if (context.isUniform) {
-          key = random.uniform_dist(
-              0, static_cast<int>(context.keysPerPartition) - 1);
+        if (uniform_keys(context)) {
+          key = random.uniform_dist(0, context.keysPerPartition - 1);
         } else {
-          key = Zipf::globalZipf().value(random.next_double());
+          key = skewed_key(context.keysPerPartition, random);
         }
 
         if (2 * i >= N) {
@@ -155,19 +174,18 @@ private:
         }
       }
 
-      int32_t key;
+      int64_t key;
 
       bool retry;
       do {
         retry = false;
 
-        if (context.isUniform) {
-          key =
-              random.uniform_dist(0, static_cast<int>(context.keysPerPartition *
-                                                      context.partition_num) -
-                                         1);
+        if (uniform_keys(context)) {
+          key = random.uniform_dist(
+              0, context.keysPerPartition * context.partition_num - 1);
         } else {
-          key = Zipf::globalZipf().value(random.next_double());
+          key = skewed_key(context.keysPerPartition * context.partition_num,
+                           random);
         }
         query.Y_KEY[i] = key;
 
@@ -199,5 +217,140 @@ public:
     return query;
   }
 };
+
+enum class YCSBOperation { READ, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE };
+
+// a scan reads SCAN_LENGTH rows of the home partition from Y_KEY on
+template <std::size_t N> struct YCSBCoreQuery {
+  int64_t Y_KEY[N];
+  YCSBOperation OP[N];
+  int32_t SCAN_LENGTH[N];
+};
+
+/*
+ * The operations of the core workloads, as in the YCSB paper (Cooper et al.,
+ * "Benchmarking cloud serving systems with YCSB", SoCC 10):
+ *
+ * A: 50% read, 50% update        D: 95% read, 5% insert, latest keys
+ * B: 95% read, 5% update         E: 95% scan, 5% insert
+ * C: 100% read                   F: 50% read, 50% read-modify-write
+ *
+ * Keys are zipfian with --zipf, uniform otherwise, and so are the first keys
+ * of scans, whose lengths are uniform in [1, maxScanLength]. Inserts and
+ * scans are on the home partition, the other keys are on another partition
+ * of a cross partition transaction.
+ */
+
+template <std::size_t N> class makeYCSBCoreQuery {
+public:
+  YCSBCoreQuery<N> operator()(const Context &context, uint32_t partitionID,
+                              Random &random) const {
+    YCSBCoreQuery<N> query;
+    int crossPartition = random.uniform_dist(1, 100);
+
+    for (auto i = 0u; i < N; i++) {
+      query.OP[i] = operation(context.workload, random.uniform_dist(1, 100));
+      query.SCAN_LENGTH[i] = 0;
+
+      bool retry;
+      do {
+        retry = false;
+
+        auto keyPartitionID = partitionID;
+        int64_t key;
+
+        if (query.OP[i] == YCSBOperation::INSERT) {
+          key = KeySpace::global().insert(partitionID);
+        } else {
+          if (context.workload == YCSBWorkload::D) {
+            key = KeySpace::global().latest(
+                partitionID, Zipf::globalZipf().value(random.next_double()));
+          } else if (uniform_keys(context)) {
+            key = random.uniform_dist(0, context.keysPerPartition - 1);
+          } else {
+            key = skewed_key(context.keysPerPartition, random);
+          }
+
+          if (query.OP[i] == YCSBOperation::SCAN) {
+            query.SCAN_LENGTH[i] = std::min<int64_t>(
+                random.uniform_dist(1, context.maxScanLength),
+                context.getKeySpacePerPartition() - key);
+          } else if (crossPartition <= cross_ratio(context) &&
+                     context.partition_num > 1) {
+            while (keyPartitionID == partitionID) {
+              keyPartitionID =
+                  random.uniform_dist(0, context.partition_num - 1);
+            }
+          }
+        }
+
+        query.Y_KEY[i] = context.getGlobalKeyID(key, keyPartitionID);
+
+        // scans may read the keys of other operations
+        if (query.OP[i] != YCSBOperation::SCAN) {
+          for (auto k = 0u; k < i; k++) {
+            if (query.OP[k] != YCSBOperation::SCAN &&
+                query.Y_KEY[k] == query.Y_KEY[i]) {
+              retry = true;
+              break;
+            }
+          }
+        }
+      } while (retry);
+    }
+    return query;
+  }
+
+  // the operation of a draw in [1, 100]
+  static YCSBOperation operation(YCSBWorkload workload, int x) {
+    switch (workload) {
+    case YCSBWorkload::A:
+      return x <= 50 ? YCSBOperation::READ : YCSBOperation::UPDATE;
+    case YCSBWorkload::B:
+      return x <= 95 ? YCSBOperation::READ : YCSBOperation::UPDATE;
+    case YCSBWorkload::C:
+      return YCSBOperation::READ;
+    case YCSBWorkload::D:
+      return x <= 95 ? YCSBOperation::READ : YCSBOperation::INSERT;
+    case YCSBWorkload::E:
+      return x <= 95 ? YCSBOperation::SCAN : YCSBOperation::INSERT;
+    case YCSBWorkload::F:
+      return x <= 50 ? YCSBOperation::READ
+                     : YCSBOperation::READ_MODIFY_WRITE;
+    default:
+      CHECK(false) << "not a core workload.";
+      return YCSBOperation::READ;
+    }
+  }
+};
+
+// a query a client submitted, see IngressServer. The args are N of [ key (64)
+// | update (8) ], and the keys are distinct and in the database.
+template <std::size_t N> class decodeYCSBQuery {
+public:
+  bool operator()(const Context &context, StringPiece args,
+                  YCSBQuery<N> &query) const {
+    if (args.size() != N * (sizeof(int64_t) + sizeof(uint8_t))) {
+      return false;
+    }
+    Decoder dec(args);
+    for (auto i = 0u; i < N; i++) {
+      uint8_t update;
+      dec >> query.Y_KEY[i] >> update;
+      query.UPDATE[i] = update != 0;
+      if (query.Y_KEY[i] < 0 ||
+          static_cast<std::size_t>(query.Y_KEY[i]) >=
+              context.partition_num * context.keysPerPartition) {
+        return false;
+      }
+      for (auto k = 0u; k < i; k++) {
+        if (query.Y_KEY[k] == query.Y_KEY[i]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+};
 } // namespace ycsb
 } // namespace coco
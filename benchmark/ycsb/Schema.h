@@ -10,6 +10,10 @@
 #include "common/Serialization.h"
 #include "core/SchemaDef.h"
 
+#include <array>
+#include <cstring>
+#include <string>
+
 namespace coco {
 namespace ycsb {
 static constexpr auto __BASE_COUNTER__ = __COUNTER__ + 1;
@@ -20,7 +24,7 @@ static constexpr auto YCSB_FIELD_SIZE = 10;
 #undef NAMESPACE_FIELDS
 #define NAMESPACE_FIELDS(x) x(coco) x(ycsb)
 
-#define YCSB_KEY_FIELDS(x, y) x(int32_t, Y_KEY)
+#define YCSB_KEY_FIELDS(x, y) x(int64_t, Y_KEY)
 #define YCSB_VALUE_FIELDS(x, y)                                                \
   x(FixedString<YCSB_FIELD_SIZE>, Y_F01)                                       \
       y(FixedString<YCSB_FIELD_SIZE>, Y_F02)                                   \
@@ -51,6 +55,19 @@ public:
            Serializer<decltype(v.Y_F09)>()(v.Y_F09) +
            Serializer<decltype(v.Y_F10)>()(v.Y_F10);
   }
+
+  void operator()(const ycsb::ycsb::value &v, std::string &out) {
+    Serializer<decltype(v.Y_F01)>()(v.Y_F01, out);
+    Serializer<decltype(v.Y_F02)>()(v.Y_F02, out);
+    Serializer<decltype(v.Y_F03)>()(v.Y_F03, out);
+    Serializer<decltype(v.Y_F04)>()(v.Y_F04, out);
+    Serializer<decltype(v.Y_F05)>()(v.Y_F05, out);
+    Serializer<decltype(v.Y_F06)>()(v.Y_F06, out);
+    Serializer<decltype(v.Y_F07)>()(v.Y_F07, out);
+    Serializer<decltype(v.Y_F08)>()(v.Y_F08, out);
+    Serializer<decltype(v.Y_F09)>()(v.Y_F09, out);
+    Serializer<decltype(v.Y_F10)>()(v.Y_F10, out);
+  }
 };
 
 template <> class Deserializer<ycsb::ycsb::value> {
@@ -88,4 +105,86 @@ public:
   }
 };
 
-} // namespace coco
\ No newline at end of file
+namespace ycsb {
+
+/*
+ * YCSBRecord is a ycsb value of FieldCount fields of FieldSize bytes each,
+ * for rows larger than the 100 bytes of ycsb::value, see --field_size. The
+ * fields are stored back to back without terminators, so that the default
+ * Serializer and Deserializer copy a value with a single memcpy, and
+ * FieldLayout sees each field.
+ */
+
+template <std::size_t FieldCount, std::size_t FieldSize> struct YCSBRecord {
+  static_assert(FieldCount > 0 && FieldCount <= 64,
+                "a delta mask has a bit per field, see FieldDelta.");
+
+  enum { NFIELDS = FieldCount };
+
+  char *field(std::size_t i) { return &data[i * FieldSize]; }
+
+  const char *field(std::size_t i) const { return &data[i * FieldSize]; }
+
+  bool operator==(const YCSBRecord &other) const {
+    return std::memcmp(data, other.data, sizeof(data)) == 0;
+  }
+
+  bool operator!=(const YCSBRecord &other) const { return !(*this == other); }
+
+  static const std::size_t *field_offsets() {
+    static const auto offsets = [] {
+      std::array<std::size_t, FieldCount> a;
+      for (auto i = 0u; i < FieldCount; i++) {
+        a[i] = i * FieldSize;
+      }
+      return a;
+    }();
+    return offsets.data();
+  }
+
+  static const std::size_t *field_sizes() {
+    static const auto sizes = [] {
+      std::array<std::size_t, FieldCount> a;
+      a.fill(FieldSize);
+      return a;
+    }();
+    return sizes.data();
+  }
+
+  // Y_F01, Y_F02, ... as the fields of ycsb::value
+  static const char *const *field_names() {
+    static const auto names = [] {
+      std::array<std::string, FieldCount> a;
+      for (auto i = 0u; i < FieldCount; i++) {
+        a[i] = (i < 9 ? "Y_F0" : "Y_F") + std::to_string(i + 1);
+      }
+      return a;
+    }();
+    static const auto pointers = [] {
+      std::array<const char *, FieldCount> a;
+      for (auto i = 0u; i < FieldCount; i++) {
+        a[i] = names[i].c_str();
+      }
+      return a;
+    }();
+    return pointers.data();
+  }
+
+  static const FieldType *field_types() {
+    static const auto types = [] {
+      std::array<FieldType, FieldCount> a;
+      a.fill(FieldType::BYTES);
+      return a;
+    }();
+    return types.data();
+  }
+
+  char data[FieldCount * FieldSize];
+};
+
+// rows of 1 KB and 4 KB, with ten fields as ycsb::value
+using value_1k = YCSBRecord<10, 100>;
+using value_4k = YCSBRecord<10, 400>;
+} // namespace ycsb
+
+} // namespace coco
@@ -9,10 +9,12 @@
 namespace coco {
 
 namespace ycsb {
-struct Storage {
+template <class Value> struct BasicStorage {
   ycsb::key ycsb_keys[YCSB_FIELD_SIZE];
-  ycsb::value ycsb_values[YCSB_FIELD_SIZE];
+  Value ycsb_values[YCSB_FIELD_SIZE];
 };
 
+using Storage = BasicStorage<ycsb::value>;
+
 } // namespace ycsb
 } // namespace coco
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "common/Time.h"
 #include "glog/logging.h"
 
 #include "benchmark/ycsb/Database.h"
@@ -18,20 +19,23 @@
 namespace coco {
 namespace ycsb {
 
-template <class Transaction> class ReadModifyWrite : public Transaction {
+template <class Transaction, class Value = ycsb::value>
+class ReadModifyWrite : public Transaction {
 
 public:
-  using DatabaseType = Database;
+  using DatabaseType = BasicDatabase<Value>;
   using ContextType = typename DatabaseType::ContextType;
   using RandomType = typename DatabaseType::RandomType;
-  using StorageType = Storage;
+  using StorageType = typename DatabaseType::StorageType;
 
   static constexpr std::size_t keys_num = 10;
+  // see Statistics::procedures
+  static constexpr uint32_t procedure = 0;
 
   ReadModifyWrite(std::size_t coordinator_id, std::size_t partition_id,
                   DatabaseType &db, const ContextType &context,
                   RandomType &random, Partitioner &partitioner,
-                  Storage &storage)
+                  StorageType &storage)
       : Transaction(coordinator_id, partition_id, partitioner), db(db),
         context(context), random(random), storage(storage),
         partition_id(partition_id),
@@ -67,26 +71,14 @@ public:
 
         if (this->execution_phase) {
           RandomType local_random;
-          storage.ycsb_values[i].Y_F01.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F02.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F03.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F04.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F05.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F06.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F07.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F08.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F09.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
-          storage.ycsb_values[i].Y_F10.assign(
-              local_random.a_string(YCSB_FIELD_SIZE, YCSB_FIELD_SIZE));
+          uint64_t seed = local_random.get_seed();
+          DatabaseType::write_fields(storage.ycsb_values[i], local_random);
+
+          if (context.operation_replication) {
+            Encoder encoder(this->operation.data);
+            this->operation.partition_id = this->partition_id;
+            encoder << storage.ycsb_keys[i].Y_KEY << seed;
+          }
         }
 
         this->update(ycsbTableID, context.getPartitionID(key),
@@ -101,14 +93,152 @@ public:
     query = makeYCSBQuery<keys_num>()(context, partition_id, random);
   }
 
+  // a query a client submitted, see IngressServer
+  void set_query(const YCSBQuery<keys_num> &query) { this->query = query; }
+
+  // draws a new query on partition_id, see TransactionPool
+  void renew(std::size_t partition_id) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    reset_query();
+  }
+
 private:
   DatabaseType &db;
   const ContextType &context;
   RandomType &random;
-  Storage &storage;
+  StorageType &storage;
   std::size_t partition_id;
   YCSBQuery<keys_num> query;
 };
+
+// the operations of a core workload, see makeYCSBCoreQuery. An insert writes
+// a reserved row, see KeySpace, and scans need ordered tables and a protocol
+// that supports them.
+template <class Transaction, class Value = ycsb::value>
+class CoreTransaction : public Transaction {
+
+public:
+  using DatabaseType = BasicDatabase<Value>;
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+  using StorageType = typename DatabaseType::StorageType;
+
+  static constexpr std::size_t keys_num = 10;
+  static constexpr uint32_t procedure = 1;
+
+  CoreTransaction(std::size_t coordinator_id, std::size_t partition_id,
+                  DatabaseType &db, const ContextType &context,
+                  RandomType &random, Partitioner &partitioner,
+                  StorageType &storage)
+      : Transaction(coordinator_id, partition_id, partitioner), db(db),
+        context(context), random(random), storage(storage),
+        partition_id(partition_id),
+        query(makeYCSBCoreQuery<keys_num>()(context, partition_id, random)) {}
+
+  virtual ~CoreTransaction() override = default;
+
+  TransactionResult execute(std::size_t worker_id) override {
+
+    DCHECK(context.keysPerTransaction == keys_num);
+
+    int ycsbTableID = ycsb::tableID;
+
+    for (auto i = 0u; i < keys_num; i++) {
+      auto key = query.Y_KEY[i];
+      storage.ycsb_keys[i].Y_KEY = key;
+      switch (query.OP[i]) {
+      case YCSBOperation::READ:
+        this->search_for_read(ycsbTableID, context.getPartitionID(key),
+                              storage.ycsb_keys[i], storage.ycsb_values[i]);
+        break;
+      case YCSBOperation::UPDATE:
+      case YCSBOperation::INSERT:
+      case YCSBOperation::READ_MODIFY_WRITE:
+        this->search_for_update(ycsbTableID, context.getPartitionID(key),
+                                storage.ycsb_keys[i], storage.ycsb_values[i]);
+        break;
+      case YCSBOperation::SCAN:
+        break;
+      }
+    }
+
+    if (this->process_requests(worker_id)) {
+      return TransactionResult::ABORT;
+    }
+
+    // the keys of a partition are partition_num apart with round-robin hash
+    // partitioning, see Context::getGlobalKeyID
+    int32_t stride = context.strategy == PartitionStrategy::ROUND_ROBIN
+                         ? context.partition_num
+                         : 1;
+
+    for (auto i = 0u; i < keys_num; i++) {
+      auto key = query.Y_KEY[i];
+      switch (query.OP[i]) {
+      case YCSBOperation::SCAN: {
+        int rows = 0;
+        this->template scan<ycsb::key, Value>(
+            ycsbTableID, partition_id, ycsb::key(key),
+            ycsb::key(key + query.SCAN_LENGTH[i] * stride),
+            [this, i, &rows](const ycsb::key &, const Value &value) {
+              storage.ycsb_values[i] = value;
+              rows++;
+              return true;
+            });
+        DCHECK(rows == query.SCAN_LENGTH[i]);
+        break;
+      }
+      case YCSBOperation::UPDATE:
+      case YCSBOperation::INSERT:
+        if (this->execution_phase) {
+          RandomType local_random;
+          DatabaseType::write_fields(storage.ycsb_values[i], local_random);
+        }
+        this->update(ycsbTableID, context.getPartitionID(key),
+                     storage.ycsb_keys[i], storage.ycsb_values[i]);
+        break;
+      case YCSBOperation::READ_MODIFY_WRITE:
+        // the new value depends on the one read
+        if (this->execution_phase) {
+          DatabaseType::shift_fields(storage.ycsb_values[i]);
+        }
+        this->update(ycsbTableID, context.getPartitionID(key),
+                     storage.ycsb_keys[i], storage.ycsb_values[i]);
+        break;
+      case YCSBOperation::READ:
+        break;
+      }
+    }
+
+    return TransactionResult::READY_TO_COMMIT;
+  }
+
+  void reset_query() override {
+    query = makeYCSBCoreQuery<keys_num>()(context, partition_id, random);
+  }
+
+  // draws a new query on partition_id, see TransactionPool
+  void renew(std::size_t partition_id) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    reset_query();
+  }
+
+  const YCSBCoreQuery<keys_num> &get_query() const { return query; }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  RandomType &random;
+  StorageType &storage;
+  std::size_t partition_id;
+  YCSBCoreQuery<keys_num> query;
+};
 } // namespace ycsb
 
 } // namespace coco
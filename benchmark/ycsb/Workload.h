@@ -10,33 +10,102 @@
 #include "benchmark/ycsb/Storage.h"
 #include "benchmark/ycsb/Transaction.h"
 #include "core/Partitioner.h"
+#include "core/Procedure.h"
+#include "core/TransactionPool.h"
+#include "core/TransactionStream.h"
 
 namespace coco {
 
 namespace ycsb {
 
-template <class Transaction> class Workload {
+template <class Transaction, class Value = ycsb::value> class Workload {
 public:
   using TransactionType = Transaction;
-  using DatabaseType = Database;
+  using DatabaseType = BasicDatabase<Value>;
   using ContextType = Context;
   using RandomType = Random;
-  using StorageType = Storage;
+  using StorageType = typename DatabaseType::StorageType;
 
   Workload(std::size_t coordinator_id, DatabaseType &db, RandomType &random,
            Partitioner &partitioner)
       : coordinator_id(coordinator_id), db(db), random(random),
-        partitioner(partitioner) {}
+        partitioner(partitioner),
+        procedures(coordinator_id, random, partitioner) {}
 
-  std::unique_ptr<TransactionType> next_transaction(const ContextType &context,
-                                                    std::size_t partition_id,
-                                                    StorageType &storage) {
+  // YCSB declares no hot rows, see ConflictRouter
+  static std::size_t hot_rows(const ContextType &) { return 0; }
 
-    std::unique_ptr<TransactionType> p =
-        std::make_unique<ReadModifyWrite<Transaction>>(
-            coordinator_id, partition_id, db, context, random, partitioner,
-            storage);
+  // with a pool, the transaction is renewed from one of the same type if
+  // the pool has any, see TransactionPool. With --procedure, it is the
+  // registered procedure, see ProcedureRegistry. With --workload, it is a
+  // core workload, see CoreTransaction. With a stream, it is recorded or
+  // replayed, see TransactionStream.
+  std::unique_ptr<TransactionType>
+  next_transaction(const ContextType &context, std::size_t partition_id,
+                   StorageType &storage,
+                   TransactionPool<TransactionType> *pool = nullptr,
+                   std::size_t hot_row = 0) {
 
+    if (stream != nullptr) {
+      stream->next(random, partition_id, hot_row);
+    }
+    if (context.procedure >= 0) {
+      return procedures.generated(context, context.procedure, partition_id,
+                                  pool);
+    }
+    if (context.workload != YCSBWorkload::CUSTOM) {
+      return make<CoreTransaction<Transaction, Value>>(context, partition_id,
+                                                       storage, pool);
+    }
+    return make<ReadModifyWrite<Transaction, Value>>(context, partition_id,
+                                                     storage, pool);
+  }
+
+  // a transaction a client submitted, see IngressServer. The workload's own
+  // procedure is ReadModifyWrite (0), see decodeYCSBQuery for its args, the
+  // others are registered, see ProcedureRegistry. nullptr unless the query is
+  // valid and its first key is on a partition of this coordinator.
+  std::unique_ptr<TransactionType>
+  submitted_transaction(const ContextType &context, uint32_t procedure,
+                        StringPiece args, StorageType &storage,
+                        TransactionPool<TransactionType> *pool = nullptr) {
+    if (procedure >= FIRST_PROCEDURE_ID) {
+      return procedures.submitted(context, procedure, args, pool);
+    }
+    using T = ReadModifyWrite<Transaction, Value>;
+    YCSBQuery<T::keys_num> query;
+    if (procedure != 0 ||
+        !decodeYCSBQuery<T::keys_num>()(context, args, query)) {
+      return nullptr;
+    }
+    auto partition_id = context.getPartitionID(query.Y_KEY[0]);
+    if (!partitioner.has_master_partition(partition_id)) {
+      return nullptr;
+    }
+    auto p = make<T>(context, partition_id, storage, pool);
+    static_cast<T &>(*p).set_query(query);
+    return p;
+  }
+
+  // the stream of the executor, see TransactionStream::open
+  void set_stream(TransactionStream *stream) { this->stream = stream; }
+
+private:
+  template <class T>
+  std::unique_ptr<TransactionType>
+  make(const ContextType &context, std::size_t partition_id,
+       StorageType &storage, TransactionPool<TransactionType> *pool) {
+    if (pool != nullptr) {
+      auto p = pool->template take<T>();
+      if (p != nullptr) {
+        static_cast<T &>(*p).renew(partition_id);
+        return p;
+      }
+    }
+    std::unique_ptr<TransactionType> p = std::make_unique<T>(
+        coordinator_id, partition_id, db, context, random, partitioner,
+        storage);
+    p->procedure_id = T::procedure;
     return p;
   }
 
@@ -45,6 +114,8 @@ private:
   DatabaseType &db;
   RandomType &random;
   Partitioner &partitioner;
+  ProcedureRegistry<TransactionType, DatabaseType> procedures;
+  TransactionStream *stream = nullptr;
 };
 
 } // namespace ycsb
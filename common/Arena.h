@@ -0,0 +1,138 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "SpinLock.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <glog/logging.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <vector>
+
+namespace coco {
+
+/*
+ * Arena hands out memory by bumping a pointer through regions it maps with
+ * mmap, and returns it all at once in clear() or its destructor, so that the
+ * rows of a table sit next to each other instead of all over the heap.
+ *
+ * Regions start at MIN_REGION_SIZE and double up to HUGE_PAGE_SIZE, so that
+ * small tables, e.g., a warehouse, do not take a huge page each. A region of
+ * HUGE_PAGE_SIZE or more comes from the explicit huge pages if the kernel has
+ * any (vm.nr_hugepages), or is aligned to HUGE_PAGE_SIZE and advised to be
+ * backed by transparent huge pages otherwise. A row access is then mostly a
+ * TLB hit. allocate() may be called from different threads.
+ */
+
+class Arena {
+public:
+  static constexpr std::size_t MIN_REGION_SIZE = 64 * 1024;
+  static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  Arena() = default;
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  ~Arena() { clear(); }
+
+  // align must be a power of two, no larger than a page
+  void *allocate(std::size_t size, std::size_t align) {
+    DCHECK((align & (align - 1)) == 0);
+    std::lock_guard<SpinLock> guard(lock);
+    uintptr_t p = (next + align - 1) & ~(uintptr_t)(align - 1);
+    if (next == 0 || p + size > end) {
+      add_region(size);
+      p = next;
+    }
+    next = p + size;
+    allocated_bytes += size;
+    return reinterpret_cast<void *>(p);
+  }
+
+  // not safe with concurrent allocate(), all memory is returned
+  void clear() {
+    for (auto &region : regions) {
+      munmap(region.first, region.second);
+    }
+    regions.clear();
+    next = end = 0;
+    region_size = 0;
+    allocated_bytes = mapped_bytes = huge_page_bytes = 0;
+  }
+
+  // bytes handed out
+  std::size_t allocated() const { return allocated_bytes; }
+
+  // bytes mapped, including the unused tail of the regions
+  std::size_t mapped() const { return mapped_bytes; }
+
+  // bytes mapped on explicit huge pages
+  std::size_t huge_pages() const { return huge_page_bytes; }
+
+private:
+  // lock must be held
+  void add_region(std::size_t size) {
+    std::size_t min_size = MIN_REGION_SIZE, max_size = HUGE_PAGE_SIZE;
+    region_size = std::min(std::max(region_size * 2, min_size), max_size);
+    std::size_t n = std::max(region_size, size);
+    if (n >= HUGE_PAGE_SIZE) {
+      n = (n + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+
+    void *ptr = MAP_FAILED;
+    if (n >= HUGE_PAGE_SIZE) {
+      ptr = mmap(nullptr, n, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (ptr != MAP_FAILED) {
+        huge_page_bytes += n;
+      } else if ((ptr = map_aligned(n)) != MAP_FAILED) {
+        madvise(ptr, n, MADV_HUGEPAGE);
+      }
+    } else {
+      ptr = mmap(nullptr, n, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    CHECK(ptr != MAP_FAILED) << "failed to map " << n << " bytes, errno: "
+                             << errno;
+
+    regions.emplace_back(ptr, n);
+    mapped_bytes += n;
+    next = reinterpret_cast<uintptr_t>(ptr);
+    end = next + n;
+  }
+
+  // maps n bytes at a HUGE_PAGE_SIZE aligned address
+  static void *map_aligned(std::size_t n) {
+    std::size_t padded = n + HUGE_PAGE_SIZE;
+    void *ptr = mmap(nullptr, padded, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      return ptr;
+    }
+    uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t aligned =
+        (begin + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    if (aligned > begin) {
+      munmap(ptr, aligned - begin);
+    }
+    if (begin + padded > aligned + n) {
+      munmap(reinterpret_cast<void *>(aligned + n),
+             begin + padded - aligned - n);
+    }
+    return reinterpret_cast<void *>(aligned);
+  }
+
+private:
+  SpinLock lock;
+  std::vector<std::pair<void *, std::size_t>> regions;
+  uintptr_t next = 0, end = 0;
+  std::size_t region_size = 0;
+  std::size_t allocated_bytes = 0, mapped_bytes = 0, huge_page_bytes = 0;
+};
+
+} // namespace coco
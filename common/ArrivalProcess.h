@@ -0,0 +1,75 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Random.h"
+#include "common/Time.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace coco {
+
+/*
+ * ArrivalProcess drives a worker in open loop, i.e., transactions arrive at a
+ * target rate with exponentially distributed gaps (a Poisson process) no
+ * matter how fast they are served. A transaction starts at its arrival time,
+ * so the time it waits while the worker is behind counts in its latency.
+ *
+ * With a rate of 0 the worker runs in closed loop and every transaction
+ * arrives as soon as the previous one is done.
+ */
+
+class ArrivalProcess {
+public:
+  using TimePoint = Clock::time_point;
+
+  // rate is in transactions per second
+  ArrivalProcess(double rate, uint64_t seed) : rate(rate), random(seed) {}
+
+  bool closed_loop() const { return rate <= 0; }
+
+  // the process starts over at the new rate, e.g., a worker that was parked
+  // does not make up for the arrivals it missed
+  void set_rate(double rate) {
+    this->rate = rate;
+    started = false;
+  }
+
+  // true if the next transaction has arrived, the first one arrives on the
+  // first call
+  bool arrived() {
+    if (closed_loop()) {
+      return true;
+    }
+    auto now = Clock::now();
+    if (!started) {
+      started = true;
+      next_arrival = now;
+    }
+    return now >= next_arrival;
+  }
+
+  // returns the arrival time of the next transaction and schedules the one
+  // after it
+  TimePoint pop() {
+    if (closed_loop()) {
+      return Clock::now();
+    }
+    auto arrival = next_arrival;
+    // 1 - next_double() is in (0, 1]
+    double gap = -std::log(1 - random.next_double()) / rate;
+    next_arrival += std::chrono::duration_cast<TimePoint::duration>(
+        std::chrono::duration<double>(gap));
+    return arrival;
+  }
+
+private:
+  double rate;
+  Random random;
+  bool started = false;
+  TimePoint next_arrival;
+};
+} // namespace coco
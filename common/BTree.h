@@ -0,0 +1,503 @@
+//
+// Created by Yi Lu on 3/24/19.
+//
+
+#pragma once
+
+#include "SpinLock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <glog/logging.h>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  B+ Tree -- overview --
+ *
+ *  An ordered map synchronized with optimistic lock coupling. Every node has
+ *  a version word: bit 1 is the lock bit and a writer adds 2 both to lock and
+ *  to unlock, so a version changes each time the node is modified. Readers
+ *  never write to shared memory, they read a node's version, read its content
+ *  and check that the version is unchanged, restarting from the root
+ *  otherwise. Writers lock the leaf to modify, and a full node is split
+ *  eagerly on the way down with its parent locked, so a split never
+ *  propagates upwards.
+ *
+ *  Leaves are linked left to right for scans. Since inserting or removing a
+ *  key changes the version of the leaf covering it, the versions of the
+ *  leaves visited by a scan are enough to detect phantoms later.
+ *
+ *  A row holds the key and the value side by side and is never moved, so
+ *  references returned by operator[] stay valid for the lifetime of the tree.
+ *  Nodes are never merged and nothing is freed until the tree is destroyed,
+ *  as concurrent readers may still hold a pointer.
+ */
+
+template <class KeyType, class ValueType> class BTree {
+public:
+  using VersionType = std::atomic<uint64_t>;
+
+  BTree() { root.store(allocate_leaf()); }
+
+  BTree(const BTree &) = delete;
+  BTree &operator=(const BTree &) = delete;
+
+  ValueType *find(const KeyType &key) {
+    for (;;) {
+      bool restart = false;
+      uint64_t version;
+      Leaf *leaf = find_leaf(&key, version, restart);
+      if (restart) {
+        continue;
+      }
+      std::size_t i = leaf->lower_bound(key);
+      Row *row = i < leaf->count && leaf->keys[i] == key ? leaf->rows[i]
+                                                         : nullptr;
+      if (check(leaf, version)) {
+        return row == nullptr ? nullptr : &row->value;
+      }
+    }
+  }
+
+  bool contains(const KeyType &key) { return find(key) != nullptr; }
+
+  bool insert(const KeyType &key, const ValueType &value) {
+    bool inserted;
+    find_or_insert(key, inserted, [&value](Row &row) { row.value = value; });
+    return inserted;
+  }
+
+  ValueType &operator[](const KeyType &key) {
+    ValueType *value = find(key);
+    if (value != nullptr) {
+      return *value;
+    }
+    bool inserted;
+    return find_or_insert(key, inserted, [](Row &) {})->value;
+  }
+
+  // the same as operator[], but a missing key is inserted with init(value)
+  // before it is visible to others
+  template <class InitFunc>
+  ValueType &find_or_init(const KeyType &key, InitFunc init) {
+    ValueType *value = find(key);
+    if (value != nullptr) {
+      return *value;
+    }
+    bool inserted;
+    return find_or_insert(key, inserted,
+                          [&init](Row &row) { init(row.value); })
+        ->value;
+  }
+
+  // the row is unlinked from the tree, but its memory is kept until the tree
+  // is destroyed.
+  bool remove(const KeyType &key) {
+    for (;;) {
+      bool restart = false;
+      uint64_t version;
+      Leaf *leaf = find_leaf(&key, version, restart);
+      if (restart || !upgrade(leaf, version)) {
+        continue;
+      }
+      std::size_t i = leaf->lower_bound(key);
+      bool removed = i < leaf->count && leaf->keys[i] == key;
+      if (removed) {
+        std::copy(leaf->keys + i + 1, leaf->keys + leaf->count,
+                  leaf->keys + i);
+        std::copy(leaf->rows + i + 1, leaf->rows + leaf->count,
+                  leaf->rows + i);
+        leaf->count--;
+        n_rows.fetch_sub(1);
+      }
+      unlock(leaf);
+      return removed;
+    }
+  }
+
+  std::size_t size() const { return n_rows.load(); }
+
+  // bytes of the nodes and the rows, including the removed rows
+  std::size_t memory_size() {
+    allocator_lock.lock();
+    std::size_t size = leaves.size() * sizeof(Leaf) +
+                       inners.size() * sizeof(Inner) +
+                       rows.size() * sizeof(Row);
+    allocator_lock.unlock();
+    return size;
+  }
+
+  /*
+   * call func(key, value) on the rows with start <= key < end in key order,
+   * until it returns false. A nullptr bound is unbounded.
+   *
+   * leaf_func(version, value) is called on each leaf visited, before func is
+   * called on its rows. A row inserted into or removed from the range later
+   * changes one of these versions.
+   */
+  template <class Func, class LeafFunc>
+  void scan(const KeyType *start, const KeyType *end, Func func,
+            LeafFunc leaf_func) {
+    KeyType last;
+    bool has_last = false;
+    std::vector<Row *> rows;
+    rows.reserve(LEAF_SIZE);
+
+    // restart after the last key visited
+    for (;;) {
+      bool restart = false;
+      uint64_t version;
+      const KeyType *from = has_last ? &last : start;
+      Leaf *leaf = find_leaf(from, version, restart);
+
+      while (!restart) {
+        rows.clear();
+        bool done = false;
+        std::size_t count = leaf->size();
+        for (auto i = from == nullptr ? 0 : leaf->lower_bound(*from);
+             i < count; i++) {
+          if (end != nullptr && !(leaf->keys[i] < *end)) {
+            done = true;
+            break;
+          }
+          if (!has_last || last < leaf->keys[i]) {
+            rows.push_back(leaf->rows[i]);
+          }
+        }
+        Leaf *next = leaf->next.load();
+        if (!check(leaf, version)) {
+          break;
+        }
+
+        leaf_func(leaf->version, version);
+        for (auto row : rows) {
+          last = row->key;
+          has_last = true;
+          if (!func(row->key, row->value)) {
+            return;
+          }
+        }
+        if (done || next == nullptr) {
+          return;
+        }
+        version = read_lock(next, restart);
+        leaf = next;
+      }
+    }
+  }
+
+  template <class Func>
+  void scan(const KeyType *start, const KeyType *end, Func func) {
+    scan(start, end, func, [](const VersionType &, uint64_t) {});
+  }
+
+  // rows inserted or removed concurrently may or may not be visited.
+  template <class Func> void for_each(Func func) {
+    scan(nullptr, nullptr, [&func](const KeyType &key, ValueType &value) {
+      func(key, value);
+      return true;
+    });
+  }
+
+public:
+  static constexpr std::size_t LEAF_SIZE = 64;
+
+  static constexpr std::size_t INNER_SIZE = 64;
+
+private:
+  static constexpr uint64_t LOCK_BIT = 2;
+
+  struct Row {
+    KeyType key;
+    ValueType value;
+  };
+
+  struct Node {
+    explicit Node(bool is_leaf) : is_leaf(is_leaf) {}
+
+    VersionType version{0};
+    const bool is_leaf;
+    std::size_t count = 0;
+  };
+
+  struct Leaf : Node {
+    Leaf() : Node(true) {}
+
+    // count may be read while the leaf is modified
+    std::size_t size() const {
+      return this->count < LEAF_SIZE ? this->count : LEAF_SIZE;
+    }
+
+    // the first position whose key is not less than key
+    std::size_t lower_bound(const KeyType &key) const {
+      return std::lower_bound(keys, keys + size(), key) - keys;
+    }
+
+    bool is_full() const { return this->count == LEAF_SIZE; }
+
+    KeyType keys[LEAF_SIZE];
+    Row *rows[LEAF_SIZE];
+    std::atomic<Leaf *> next{nullptr};
+  };
+
+  // keys[i] is the largest key in children[i]
+  struct Inner : Node {
+    Inner() : Node(false) {}
+
+    std::size_t size() const {
+      return this->count < INNER_SIZE ? this->count : INNER_SIZE;
+    }
+
+    std::size_t lower_bound(const KeyType &key) const {
+      return std::lower_bound(keys, keys + size(), key) - keys;
+    }
+
+    bool is_full() const { return this->count == INNER_SIZE; }
+
+    // locked, child is the right half of children[lower_bound(key)]
+    void insert(const KeyType &key, Node *child) {
+      std::size_t i = lower_bound(key);
+      std::copy_backward(keys + i, keys + this->count,
+                         keys + this->count + 1);
+      std::copy_backward(children + i + 1, children + this->count + 1,
+                         children + this->count + 2);
+      keys[i] = key;
+      children[i + 1] = child;
+      this->count++;
+    }
+
+    KeyType keys[INNER_SIZE];
+    Node *children[INNER_SIZE + 1];
+  };
+
+  // returns the version, restart is set if the node is locked
+  static uint64_t read_lock(Node *node, bool &restart) {
+    uint64_t version = node->version.load();
+    if (version & LOCK_BIT) {
+      restart = true;
+    }
+    return version;
+  }
+
+  static bool check(Node *node, uint64_t version) {
+    return node->version.load() == version;
+  }
+
+  static bool upgrade(Node *node, uint64_t version) {
+    return node->version.compare_exchange_strong(version, version + LOCK_BIT);
+  }
+
+  static void unlock(Node *node) { node->version.fetch_add(LOCK_BIT); }
+
+  // the leaf covering key, or the leftmost leaf if key is nullptr
+  Leaf *find_leaf(const KeyType *key, uint64_t &version, bool &restart) {
+    Node *node = root.load();
+    version = read_lock(node, restart);
+    if (restart || node != root.load()) {
+      restart = true;
+      return nullptr;
+    }
+    while (!node->is_leaf) {
+      Inner *inner = static_cast<Inner *>(node);
+      Node *child = inner->children[key == nullptr ? 0
+                                                   : inner->lower_bound(*key)];
+      if (!check(inner, version)) {
+        restart = true;
+        return nullptr;
+      }
+      uint64_t child_version = read_lock(child, restart);
+      if (restart || !check(inner, version)) {
+        restart = true;
+        return nullptr;
+      }
+      node = child;
+      version = child_version;
+    }
+    return static_cast<Leaf *>(node);
+  }
+
+  template <class InitFunc>
+  Row *find_or_insert(const KeyType &key, bool &inserted, InitFunc initFunc) {
+    Row *row = nullptr;
+    while (!try_find_or_insert(key, inserted, initFunc, row))
+      ;
+    return row;
+  }
+
+  // returns false if it has to restart
+  template <class InitFunc>
+  bool try_find_or_insert(const KeyType &key, bool &inserted,
+                          InitFunc &initFunc, Row *&row) {
+    bool restart = false;
+    Node *node = root.load();
+    uint64_t version = read_lock(node, restart);
+    if (restart || node != root.load()) {
+      return false;
+    }
+
+    Inner *parent = nullptr;
+    uint64_t parent_version = 0;
+
+    for (;;) {
+      bool is_full = node->is_leaf ? static_cast<Leaf *>(node)->is_full()
+                                   : static_cast<Inner *>(node)->is_full();
+      if (is_full) {
+        split(node, version, parent, parent_version);
+        return false;
+      }
+      if (node->is_leaf) {
+        break;
+      }
+      if (parent != nullptr && !check(parent, parent_version)) {
+        return false;
+      }
+      Inner *inner = static_cast<Inner *>(node);
+      Node *child = inner->children[inner->lower_bound(key)];
+      if (!check(inner, version)) {
+        return false;
+      }
+      parent = inner;
+      parent_version = version;
+      node = child;
+      version = read_lock(node, restart);
+      if (restart) {
+        return false;
+      }
+    }
+
+    Leaf *leaf = static_cast<Leaf *>(node);
+    if (!upgrade(leaf, version)) {
+      return false;
+    }
+    if (parent != nullptr && !check(parent, parent_version)) {
+      unlock(leaf);
+      return false;
+    }
+
+    std::size_t i = leaf->lower_bound(key);
+    inserted = !(i < leaf->count && leaf->keys[i] == key);
+    if (inserted) {
+      row = allocate_row();
+      row->key = key;
+      initFunc(*row);
+      std::copy_backward(leaf->keys + i, leaf->keys + leaf->count,
+                         leaf->keys + leaf->count + 1);
+      std::copy_backward(leaf->rows + i, leaf->rows + leaf->count,
+                         leaf->rows + leaf->count + 1);
+      leaf->keys[i] = key;
+      leaf->rows[i] = row;
+      leaf->count++;
+      n_rows.fetch_add(1);
+    } else {
+      row = leaf->rows[i];
+    }
+    unlock(leaf);
+    return true;
+  }
+
+  // split a full node into its parent, the caller restarts in any case
+  void split(Node *node, uint64_t version, Inner *parent,
+             uint64_t parent_version) {
+    if (parent != nullptr && !upgrade(parent, parent_version)) {
+      return;
+    }
+    if (!upgrade(node, version)) {
+      if (parent != nullptr) {
+        unlock(parent);
+      }
+      return;
+    }
+    // the root was split by someone else
+    if (parent == nullptr && node != root.load()) {
+      unlock(node);
+      return;
+    }
+
+    KeyType separator;
+    Node *right;
+    if (node->is_leaf) {
+      right = split_leaf(static_cast<Leaf *>(node), separator);
+    } else {
+      right = split_inner(static_cast<Inner *>(node), separator);
+    }
+
+    if (parent != nullptr) {
+      parent->insert(separator, right);
+    } else {
+      Inner *new_root = allocate_inner();
+      new_root->count = 1;
+      new_root->keys[0] = separator;
+      new_root->children[0] = node;
+      new_root->children[1] = right;
+      root.store(new_root);
+    }
+
+    unlock(node);
+    if (parent != nullptr) {
+      unlock(parent);
+    }
+  }
+
+  Leaf *split_leaf(Leaf *leaf, KeyType &separator) {
+    Leaf *right = allocate_leaf();
+    std::size_t n = leaf->count / 2;
+    std::copy(leaf->keys + n, leaf->keys + leaf->count, right->keys);
+    std::copy(leaf->rows + n, leaf->rows + leaf->count, right->rows);
+    right->count = leaf->count - n;
+    right->next.store(leaf->next.load());
+    leaf->count = n;
+    leaf->next.store(right);
+    separator = leaf->keys[n - 1];
+    return right;
+  }
+
+  Inner *split_inner(Inner *inner, KeyType &separator) {
+    Inner *right = allocate_inner();
+    std::size_t n = inner->count / 2;
+    std::copy(inner->keys + n + 1, inner->keys + inner->count, right->keys);
+    std::copy(inner->children + n + 1, inner->children + inner->count + 1,
+              right->children);
+    right->count = inner->count - n - 1;
+    inner->count = n;
+    separator = inner->keys[n];
+    return right;
+  }
+
+  Leaf *allocate_leaf() {
+    allocator_lock.lock();
+    leaves.emplace_back();
+    Leaf *leaf = &leaves.back();
+    allocator_lock.unlock();
+    return leaf;
+  }
+
+  Inner *allocate_inner() {
+    allocator_lock.lock();
+    inners.emplace_back();
+    Inner *inner = &inners.back();
+    allocator_lock.unlock();
+    return inner;
+  }
+
+  Row *allocate_row() {
+    allocator_lock.lock();
+    rows.emplace_back();
+    Row *row = &rows.back();
+    allocator_lock.unlock();
+    return row;
+  }
+
+private:
+  std::atomic<Node *> root{nullptr};
+  std::atomic<std::size_t> n_rows{0};
+
+  // std::deque never moves its elements on emplace_back
+  SpinLock allocator_lock;
+  std::deque<Leaf> leaves;
+  std::deque<Inner> inners;
+  std::deque<Row> rows;
+};
+} // namespace coco
@@ -6,67 +6,233 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
+#include <memory>
+#include <mutex>
 #include <stdio.h>
+#include <thread>
+#include <unistd.h>
+
+namespace coco {
+
+/*
+ * BufferedFileWriter appends to a file through a buffer.
+ *
+ * In direct mode, the file is opened with O_DIRECT and preallocated with
+ * fallocate in SEGMENT_SIZE steps. Two BLOCK_SIZE aligned buffers are used:
+ * once one is full, a background thread writes it out while the other one
+ * fills. flush() writes the partial block at the tail padded with zeros and
+ * keeps it in the buffer, so it is rewritten in place by the next flush.
+ * Readers must treat zeros as the end of data; close() truncates the file to
+ * the bytes actually written.
+ */
 
 class BufferedFileWriter {
 
 public:
-  BufferedFileWriter(const char *filename) {
-    fd = open(filename, O_WRONLY | O_CREAT,
+  BufferedFileWriter(const char *filename, bool direct = false)
+      : direct(direct) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (direct) {
+      flags |= O_DIRECT;
+    }
+#else
+    CHECK(!direct) << "O_DIRECT is not supported on this platform.";
+#endif
+    fd = open(filename, flags,
               S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
-    CHECK(fd >= 0);
-    bytes_total = 0;
-  }
+    CHECK(fd >= 0) << "failed to open " << filename << ", errno: " << errno;
 
-  void write(const char *str, long size) {
+    for (auto i = 0u; i < (direct ? 2u : 1u); i++) {
+      void *ptr = nullptr;
+      int err = posix_memalign(&ptr, BLOCK_SIZE, BUFFER_SIZE);
+      CHECK(err == 0);
+      buffers[i].reset(static_cast<char *>(ptr));
+    }
+    buffer = buffers[0].get();
 
-    if (bytes_total + size < BUFFER_SIZE) {
-      memcpy(buffer + bytes_total, str, size);
-      bytes_total += size;
-      return;
+    if (direct) {
+      preallocate(BUFFER_SIZE);
+      flusher = std::thread(&BufferedFileWriter::flusher_loop, this);
     }
+  }
 
-    auto copy_size = BUFFER_SIZE - bytes_total;
+  BufferedFileWriter(const BufferedFileWriter &) = delete;
+  BufferedFileWriter &operator=(const BufferedFileWriter &) = delete;
 
-    memcpy(buffer + bytes_total, str, copy_size);
-    bytes_total += copy_size;
-    flush();
+  ~BufferedFileWriter() {
+    if (fd >= 0) {
+      close();
+    }
+  }
 
-    str += copy_size;
-    size -= copy_size;
+  void write(const char *str, long size) {
+    while (size > 0) {
+      auto copy_size = std::min<std::size_t>(size, BUFFER_SIZE - bytes_total);
+      memcpy(buffer + bytes_total, str, copy_size);
+      bytes_total += copy_size;
+      str += copy_size;
+      size -= copy_size;
 
-    if (size >= BUFFER_SIZE) {
-      int err = ::write(fd, str, size);
-      CHECK(err >= 0);
-      bytes_total = 0;
-    } else {
-      memcpy(buffer, str, size);
-      bytes_total += size;
+      if (bytes_total == BUFFER_SIZE) {
+        if (direct) {
+          flush_async();
+        } else {
+          flush();
+        }
+      }
     }
   }
 
   void flush() {
     DCHECK(fd >= 0);
-    if (bytes_total > 0) {
-      int err = ::write(fd, buffer, bytes_total);
-      CHECK(err >= 0);
+    if (!direct) {
+      write_all(buffer, bytes_total, file_offset);
+      file_offset += bytes_total;
+      bytes_total = 0;
+      return;
     }
-    bytes_total = 0;
+
+    wait_for_flusher();
+    if (bytes_total == 0) {
+      return;
+    }
+    // pad the tail block and keep it, the next flush rewrites it
+    std::size_t aligned_size = round_up(bytes_total, BLOCK_SIZE);
+    memset(buffer + bytes_total, 0, aligned_size - bytes_total);
+    write_all(buffer, aligned_size, file_offset);
+    std::size_t tail_offset = bytes_total / BLOCK_SIZE * BLOCK_SIZE;
+    memmove(buffer, buffer + tail_offset, bytes_total - tail_offset);
+    file_offset += tail_offset;
+    bytes_total -= tail_offset;
+  }
+
+  // flush the buffer and wait until the data is on stable storage
+  void sync() {
+    flush();
+    int err = ::fdatasync(fd);
+    CHECK(err == 0) << "fdatasync failed, errno: " << errno;
   }
 
   void close() {
     flush();
+    if (direct) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+      }
+      cv.notify_all();
+      flusher.join();
+      // drop the padding and whatever was preallocated
+      int err = ::ftruncate(fd, file_offset + bytes_total);
+      CHECK(err == 0) << "ftruncate failed, errno: " << errno;
+    }
     int err = ::close(fd);
     CHECK(err == 0);
+    fd = -1;
   }
 
 public:
   static constexpr uint32_t BUFFER_SIZE = 1024 * 1024 * 4; // 4MB
 
+  static constexpr std::size_t BLOCK_SIZE = 4096;
+
+  static constexpr off_t SEGMENT_SIZE = 1024 * 1024 * 64; // 64MB
+
+private:
+  struct FreeDeleter {
+    void operator()(char *ptr) const { free(ptr); }
+  };
+
+  static std::size_t round_up(std::size_t n, std::size_t alignment) {
+    return (n + alignment - 1) / alignment * alignment;
+  }
+
+  void write_all(const char *buf, std::size_t size, off_t offset) {
+    while (size > 0) {
+      long n = ::pwrite(fd, buf, size, offset);
+      CHECK(n > 0) << "pwrite failed, errno: " << errno;
+      buf += n;
+      size -= n;
+      offset += n;
+    }
+  }
+
+  void preallocate(off_t size) {
+#ifndef __APPLE__
+    if (size <= allocated || !fallocate_supported) {
+      return;
+    }
+    off_t next = (size + SEGMENT_SIZE - 1) / SEGMENT_SIZE * SEGMENT_SIZE;
+    if (::fallocate(fd, 0, allocated, next - allocated) != 0) {
+      LOG(WARNING) << "fallocate failed, errno: " << errno
+                   << ", log segments are not preallocated.";
+      fallocate_supported = false;
+      return;
+    }
+    allocated = next;
+#endif
+  }
+
+  // hand the full buffer to the flusher and continue on the other one
+  void flush_async() {
+    wait_for_flusher();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending_buffer = buffer;
+      pending_offset = file_offset;
+      pending = true;
+    }
+    cv.notify_all();
+    active = 1 - active;
+    buffer = buffers[active].get();
+    file_offset += BUFFER_SIZE;
+    bytes_total = 0;
+    preallocate(file_offset + BUFFER_SIZE);
+  }
+
+  void wait_for_flusher() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return !pending; });
+  }
+
+  void flusher_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      cv.wait(lock, [this]() { return pending || stopped; });
+      if (!pending) {
+        break;
+      }
+      lock.unlock();
+      write_all(pending_buffer, BUFFER_SIZE, pending_offset);
+      lock.lock();
+      pending = false;
+      cv.notify_all();
+    }
+  }
+
 private:
   int fd;
-  char buffer[BUFFER_SIZE];
-  std::size_t bytes_total;
-};
\ No newline at end of file
+  bool direct;
+  std::unique_ptr<char, FreeDeleter> buffers[2];
+  char *buffer;
+  int active = 0;
+  std::size_t bytes_total = 0;
+  // where buffer[0] goes in the file
+  off_t file_offset = 0;
+  off_t allocated = 0;
+  bool fallocate_supported = true;
+
+  std::thread flusher;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool pending = false, stopped = false;
+  const char *pending_buffer = nullptr;
+  off_t pending_offset = 0;
+};
+} // namespace coco
@@ -5,15 +5,30 @@
 #pragma once
 
 #include "common/Message.h"
+#include "common/ReceiveBuffer.h"
 #include "common/Socket.h"
 
+#include <algorithm>
+#include <cstring>
 #include <glog/logging.h>
+#include <memory>
 
 namespace coco {
+/*
+ * BufferedReader receives messages from a socket into a buffer. By default,
+ * each message is copied out of the buffer, which is then reused. With
+ * zero_copy, a received message views its pieces in the buffer instead, see
+ * ReceiveBuffer, and the reader keeps receiving at the tail of the buffer.
+ * Once the tail is used up, the bytes of the last partial message move to
+ * the head of the buffer if no message views it, or to a new buffer.
+ */
+
 class BufferedReader {
 public:
-  BufferedReader(Socket &socket)
-      : socket(&socket), bytes_read(0), bytes_total(0) {}
+  BufferedReader(Socket &socket, bool zero_copy = false)
+      : socket(&socket), zero_copy(zero_copy),
+        buffer(new ReceiveBuffer(BUFFER_SIZE)), bytes_read(0),
+        bytes_total(0) {}
 
   // BufferedReader is not copyable
   BufferedReader(const BufferedReader &) = delete;
@@ -23,25 +38,45 @@ public:
   // BufferedReader is movable
 
   BufferedReader(BufferedReader &&that)
-      : socket(that.socket), bytes_read(that.bytes_read),
-        bytes_total(that.bytes_total) {
+      : socket(that.socket), zero_copy(that.zero_copy), buffer(that.buffer),
+        bytes_read(that.bytes_read), bytes_total(that.bytes_total) {
     that.socket = nullptr;
+    that.buffer = nullptr;
     that.bytes_read = 0;
     that.bytes_total = 0;
   }
 
   BufferedReader &operator=(BufferedReader &&that) {
+    if (buffer != nullptr) {
+      buffer->unref();
+    }
     socket = that.socket;
+    zero_copy = that.zero_copy;
+    buffer = that.buffer;
     bytes_read = that.bytes_read;
     bytes_total = that.bytes_total;
 
     that.socket = nullptr;
+    that.buffer = nullptr;
     that.bytes_read = 0;
     that.bytes_total = 0;
     return *this;
   }
 
+  ~BufferedReader() {
+    if (buffer != nullptr) {
+      buffer->unref();
+    }
+  }
+
   std::unique_ptr<Message> next_message() {
+    return next_message([](uint64_t worker_id) { return new Message(); });
+  }
+
+  // allocFunc is called with the worker id of the message and returns a
+  // cleared Message
+  template <class AllocFunc>
+  std::unique_ptr<Message> next_message(AllocFunc allocFunc) {
     DCHECK(socket != nullptr);
 
     fetch_message();
@@ -49,27 +84,28 @@ public:
       return nullptr;
     }
 
-    // read header and deadbeef;
-    auto header =
-        *reinterpret_cast<Message::header_type *>(buffer + bytes_read);
-    auto deadbeef = *reinterpret_cast<Message::deadbeef_type *>(
-        buffer + bytes_read + sizeof(header));
-
-    // check deadbeaf
-    DCHECK(deadbeef == Message::DEADBEEF);
-    auto message = std::make_unique<Message>();
-    auto length = Message::get_message_length(header);
-    message->resize(length);
+    // the message is in either of the formats on the wire, see Message
+    const char *ptr = buffer->get() + bytes_read;
+    auto length = Message::get_wire_length(ptr);
+    std::unique_ptr<Message> message(
+        allocFunc(Message::get_wire_worker_id(ptr)));
 
     // copy the data
     DCHECK(bytes_read + length <= bytes_total);
-    std::memcpy(message->get_raw_ptr(), buffer + bytes_read, length);
+    bool ok = zero_copy ? message->view_from(buffer, ptr, length)
+                        : message->read_from(ptr, length);
+    CHECK(ok) << "corrupted message";
     bytes_read += length;
     DCHECK(bytes_read <= bytes_total);
 
     return message;
   }
 
+  Socket &get_socket() {
+    DCHECK(socket != nullptr);
+    return *socket;
+  }
+
 private:
   void fetch_message() {
     DCHECK(socket != nullptr);
@@ -79,52 +115,72 @@ private:
       return;
     }
 
-    // copy left bytes
+    // messages viewing the buffer keep their bytes until the tail is used up
+    auto length = next_message_length();
+    if (!zero_copy || bytes_total == buffer->get_size() ||
+        bytes_read + length > buffer->get_size() ||
+        (bytes_read == bytes_total && buffer->is_unique())) {
+      move_left_bytes(length);
+    }
+
+    // read new message
+
+    auto bytes_received = socket->read_async(
+        buffer->get() + bytes_total, buffer->get_size() - bytes_total);
+
+    if (bytes_received > 0) {
+      // successful read
+      bytes_total += bytes_received;
+    }
+  }
+
+  // moves the bytes of the partial message of length bytes to the head
+  void move_left_bytes(uint64_t length) {
     DCHECK(bytes_read <= bytes_total);
     auto bytes_left = bytes_total - bytes_read;
-    bytes_total = 0;
-
-    if (bytes_left > 0 && bytes_read > 0) {
 
+    // a buffer grows to fit a message larger than it
+    if (!buffer->is_unique() || length > buffer->get_size()) {
+      auto size = std::max<std::size_t>(BUFFER_SIZE, length);
+      auto next = new ReceiveBuffer(size);
+      std::memcpy(next->get(), buffer->get() + bytes_read, bytes_left);
+      buffer->unref();
+      buffer = next;
+    } else if (bytes_left > 0 && bytes_read > 0) {
+      char *data = buffer->get();
       if (bytes_left <= bytes_read) { // non overlapping
-        std::memcpy(buffer, buffer + bytes_read, bytes_left);
+        std::memcpy(data, data + bytes_read, bytes_left);
       } else {
         for (auto i = 0u; i < bytes_left; i++) {
-          buffer[i] = buffer[i + bytes_read];
+          data[i] = data[i + bytes_read];
         }
       }
     }
-    bytes_total += bytes_left;
+    bytes_total = bytes_left;
     bytes_read = 0;
+  }
 
-    // read new message
+  // the length of the next message, 0 if its prefix is not read yet
+  uint64_t next_message_length() {
+    auto bytes_left = bytes_total - bytes_read;
+    if (bytes_left < Message::get_compact_prefix_size()) {
+      return 0;
+    }
 
-    auto bytes_received =
-        socket->read_async(buffer + bytes_total, BUFFER_SIZE - bytes_total);
+    // check deadbeaf
+    const char *ptr = buffer->get() + bytes_read;
+    DCHECK(Message::is_deadbeef(Message::get_deadbeef(ptr)));
 
-    if (bytes_received > 0) {
-      // successful read
-      bytes_total += bytes_received;
+    if (bytes_left < Message::get_wire_prefix_size(ptr)) {
+      return 0;
     }
+    return Message::get_wire_length(ptr);
   }
 
   bool has_message() {
-    // check if the buffer has a message header
-    if (bytes_read + Message::get_prefix_size() > bytes_total) {
-      return false;
-    }
-
-    // read header and deadbeef;
-    auto header =
-        *reinterpret_cast<Message::header_type *>(buffer + bytes_read);
-    auto deadbeef = *reinterpret_cast<Message::deadbeef_type *>(
-        buffer + bytes_read + sizeof(header));
-
-    // check deadbeaf
-    DCHECK(deadbeef == Message::DEADBEEF);
-
     // check if the buffer has a message
-    return bytes_read + Message::get_message_length(header) <= bytes_total;
+    auto length = next_message_length();
+    return length > 0 && bytes_read + length <= bytes_total;
   }
 
 public:
@@ -132,7 +188,8 @@ public:
 
 private:
   Socket *socket;
-  char buffer[BUFFER_SIZE];
+  bool zero_copy;
+  ReceiveBuffer *buffer;
   std::size_t bytes_read, bytes_total;
 };
 } // namespace coco
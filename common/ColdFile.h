@@ -0,0 +1,105 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "SpinLock.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace coco {
+
+/*
+ * ColdFile keeps fixed-size values in the slots of a file, e.g., on an NVMe
+ * drive. write() stores a block of values with a single pwrite at the end of
+ * the file, or in the slots freed before, and read() fetches one value back
+ * with pread. The file is scratch space: it is truncated when opened and
+ * removed when closed.
+ */
+
+class ColdFile {
+public:
+  ColdFile(const std::string &filename, std::size_t value_size)
+      : filename(filename), value_size(value_size) {
+    fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+              S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    CHECK(fd >= 0) << "failed to open " << filename << ", errno: " << errno;
+  }
+
+  ColdFile(const ColdFile &) = delete;
+  ColdFile &operator=(const ColdFile &) = delete;
+
+  ~ColdFile() {
+    ::close(fd);
+    unlink(filename.c_str());
+  }
+
+  // writes the n values in data, slots[i] is the slot of the i-th one
+  void write(const char *data, std::size_t n, uint64_t *slots) {
+    std::size_t reused = 0;
+    uint64_t first;
+    {
+      std::lock_guard<SpinLock> guard(lock);
+      for (; reused < n && !free_slots.empty(); reused++) {
+        slots[reused] = free_slots.back();
+        free_slots.pop_back();
+      }
+      first = n_slots;
+      n_slots += n - reused;
+    }
+    for (auto i = 0u; i < reused; i++) {
+      pwrite_all(data + i * value_size, value_size, slots[i]);
+    }
+    for (auto i = reused; i < n; i++) {
+      slots[i] = first + (i - reused);
+    }
+    pwrite_all(data + reused * value_size, (n - reused) * value_size, first);
+  }
+
+  void read(uint64_t slot, void *value) const {
+    auto n = pread(fd, value, value_size, slot * value_size);
+    CHECK(n == static_cast<ssize_t>(value_size))
+        << "failed to read " << filename << ", errno: " << errno;
+  }
+
+  // the slot can be written again
+  void free(uint64_t slot) {
+    std::lock_guard<SpinLock> guard(lock);
+    free_slots.push_back(slot);
+  }
+
+  // the slots in use
+  std::size_t size() {
+    std::lock_guard<SpinLock> guard(lock);
+    return n_slots - free_slots.size();
+  }
+
+private:
+  void pwrite_all(const char *data, std::size_t size, uint64_t slot) {
+    off_t offset = slot * value_size;
+    while (size > 0) {
+      auto n = pwrite(fd, data, size, offset);
+      CHECK(n > 0) << "failed to write " << filename << ", errno: " << errno;
+      data += n;
+      size -= n;
+      offset += n;
+    }
+  }
+
+private:
+  std::string filename;
+  std::size_t value_size;
+  int fd;
+  SpinLock lock;
+  uint64_t n_slots = 0;
+  std::vector<uint64_t> free_slots;
+};
+} // namespace coco
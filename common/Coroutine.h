@@ -0,0 +1,77 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <functional>
+#include <glog/logging.h>
+#include <memory>
+#include <ucontext.h>
+
+namespace coco {
+
+/*
+ * A stackful coroutine on ucontext. resume() runs func on the stack of the
+ * coroutine until func returns or calls Coroutine::yield(), which switches
+ * back to the caller of resume(). The next resume() continues after the
+ * yield.
+ *
+ * yield() outside of a coroutine returns right away, so that code shared with
+ * non-interleaved callers can yield unconditionally. A coroutine must be
+ * resumed by the thread that created it.
+ */
+
+class Coroutine {
+public:
+  static constexpr std::size_t STACK_SIZE = 1 << 20;
+
+  explicit Coroutine(std::function<void()> func)
+      : func(std::move(func)), stack(new char[STACK_SIZE]) {
+    CHECK(getcontext(&context) == 0);
+    context.uc_stack.ss_sp = stack.get();
+    context.uc_stack.ss_size = STACK_SIZE;
+    context.uc_link = &caller;
+    makecontext(&context, entry, 0);
+  }
+
+  Coroutine(const Coroutine &) = delete;
+  Coroutine &operator=(const Coroutine &) = delete;
+
+  void resume() {
+    DCHECK(!finished);
+    Coroutine *previous = current();
+    current() = this;
+    CHECK(swapcontext(&caller, &context) == 0);
+    current() = previous;
+  }
+
+  static void yield() {
+    Coroutine *self = current();
+    if (self != nullptr) {
+      CHECK(swapcontext(&self->context, &self->caller) == 0);
+    }
+  }
+
+  bool done() const { return finished; }
+
+private:
+  static void entry() {
+    Coroutine *self = current();
+    self->func();
+    self->finished = true;
+    // returns to uc_link, i.e., the caller of the last resume()
+  }
+
+  static Coroutine *&current() {
+    static thread_local Coroutine *coroutine = nullptr;
+    return coroutine;
+  }
+
+private:
+  std::function<void()> func;
+  std::unique_ptr<char[]> stack;
+  ucontext_t context, caller;
+  bool finished = false;
+};
+} // namespace coco
@@ -0,0 +1,163 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <glog/logging.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ClassOf.h"
+#include "FixedString.h"
+#include "Serialization.h"
+#include "StringPiece.h"
+
+namespace coco {
+
+/*
+ * A dictionary of the values a string column takes. The codes are the
+ * positions of the values in the list the dictionary is built from, so a
+ * dictionary built the same way on every node gives the same codes, and a row
+ * is replicated, logged or checkpointed as its codes.
+ */
+
+template <std::size_t N> class StringDictionary {
+public:
+  explicit StringDictionary(const std::vector<std::string> &strings) {
+    values.reserve(strings.size());
+    for (auto &s : strings) {
+      FixedString<N> value(s);
+      if (codes.emplace(value, values.size()).second) {
+        values.push_back(value);
+      }
+    }
+  }
+
+  const FixedString<N> &decode(uint32_t code) const {
+    DCHECK(code < values.size());
+    return values[code];
+  }
+
+  uint32_t encode(const FixedString<N> &value) const {
+    auto it = codes.find(value);
+    CHECK(it != codes.end()) << value << " is not in the dictionary.";
+    return it->second;
+  }
+
+  std::size_t size() const { return values.size(); }
+
+private:
+  std::vector<FixedString<N>> values;
+  std::unordered_map<FixedString<N>, uint32_t> codes;
+};
+
+/*
+ * DictString is a FixedString<N> column stored as a 32-bit code of Dictionary,
+ * a class with a static get() that returns its StringDictionary<N>. A read
+ * decodes to a reference to the value in the dictionary, which is never
+ * written, so a column that is only read after it is loaded, e.g., S_DIST_xx
+ * of TPC-C, costs an indexed load. A write looks up the code of the value.
+ */
+
+template <std::size_t N, class Dictionary> class DictString {
+public:
+  using size_type = std::size_t;
+
+  DictString() = default;
+
+  DictString(const FixedString<N> &value) { assign(value); }
+
+  DictString &assign(const char *str) { return assign(std::string(str)); }
+
+  DictString &assign(const std::string &str) {
+    return assign(FixedString<N>(str));
+  }
+
+  DictString &assign(const FixedString<N> &value) {
+    code_ = Dictionary::get().encode(value);
+    return *this;
+  }
+
+  DictString &operator=(const FixedString<N> &value) { return assign(value); }
+
+  const FixedString<N> &decode() const {
+    return Dictionary::get().decode(code_);
+  }
+
+  operator const FixedString<N> &() const { return decode(); }
+
+  uint32_t code() const { return code_; }
+
+  // values of the same dictionary are equal iff their codes are
+  bool operator==(const DictString &that) const { return code_ == that.code_; }
+
+  bool operator!=(const DictString &that) const { return code_ != that.code_; }
+
+  bool operator<(const DictString &that) const {
+    return decode() < that.decode();
+  }
+
+  const char *data() const { return decode().data(); }
+
+  std::size_t hash_code() const { return decode().hash_code(); }
+
+  constexpr size_type length() const { return N; }
+
+  constexpr size_type size() const { return N; }
+
+  std::string toString() const { return decode().toString(); }
+
+private:
+  uint32_t code_ = 0;
+};
+
+template <class C, std::size_t N, class Dictionary>
+inline std::basic_ostream<C> &operator<<(std::basic_ostream<C> &os,
+                                         const DictString<N, Dictionary> &str) {
+  os << str.decode();
+  return os;
+}
+
+template <std::size_t N, class Dictionary>
+class Serializer<DictString<N, Dictionary>> {
+public:
+  std::string operator()(const DictString<N, Dictionary> &v) {
+    return Serializer<uint32_t>()(v.code());
+  }
+
+  void operator()(const DictString<N, Dictionary> &v, std::string &out) {
+    Serializer<uint32_t>()(v.code(), out);
+  }
+};
+
+template <std::size_t N, class Dictionary>
+class Deserializer<DictString<N, Dictionary>> {
+public:
+  std::size_t operator()(StringPiece str,
+                         DictString<N, Dictionary> &result) const {
+    uint32_t code;
+    auto size = Deserializer<uint32_t>()(str, code);
+    result.assign(Dictionary::get().decode(code));
+    return size;
+  }
+};
+
+template <std::size_t N, class Dictionary>
+class ClassOf<DictString<N, Dictionary>> {
+public:
+  static constexpr std::size_t size() { return sizeof(uint32_t); }
+};
+
+} // namespace coco
+
+namespace std {
+template <std::size_t N, class Dictionary>
+struct hash<coco::DictString<N, Dictionary>> {
+  std::size_t operator()(const coco::DictString<N, Dictionary> &k) const {
+    return k.hash_code();
+  }
+};
+} // namespace std
@@ -33,7 +33,8 @@ private:
 
 template <class T> Encoder &operator<<(Encoder &enc, const T &rhs) {
   Serializer<T> serializer;
-  enc.bytes += serializer(rhs);
+  // serialize in place at the end of the buffer
+  serializer(rhs, enc.bytes);
   return enc;
 }
 
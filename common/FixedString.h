@@ -5,6 +5,8 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -27,9 +29,25 @@ public:
 
   FixedString(const std::string &str) { assign(str); }
 
+  // compares 8 chars at a time, the strings are ordered by the first chars
+  // that differ
   int compare(const FixedString &that) const {
+    auto i = 0u;
+    for (; i + sizeof(uint64_t) <= N; i += sizeof(uint64_t)) {
+      uint64_t a, b;
+      std::memcpy(&a, &data_[i], sizeof(a));
+      std::memcpy(&b, &that.data_[i], sizeof(b));
+      if (a != b) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        i += __builtin_clzll(a ^ b) / 8;
+#else
+        i += __builtin_ctzll(a ^ b) / 8;
+#endif
+        return data_[i] < that.data_[i] ? -1 : 1;
+      }
+    }
 
-    for (auto i = 0u; i < N; i++) {
+    for (; i < N; i++) {
       if (data_[i] < that.data_[i]) {
         return -1;
       }
@@ -49,9 +67,12 @@ public:
 
   bool operator>=(const FixedString &that) const { return compare(that) >= 0; }
 
-  bool operator==(const FixedString &that) const { return compare(that) == 0; }
+  // N is a constant, so the compiler inlines memcmp
+  bool operator==(const FixedString &that) const {
+    return std::memcmp(data(), that.data(), N) == 0;
+  }
 
-  bool operator!=(const FixedString &that) const { return compare(that) != 0; }
+  bool operator!=(const FixedString &that) const { return !(*this == that); }
 
   FixedString &assign(const std::string &str) {
     return assign(str, str.length());
@@ -69,14 +90,9 @@ public:
 
   const char *c_str() { return &data_[0]; }
 
-  std::size_t hash_code() const {
-    std::hash<char> h;
-    std::size_t hashCode = 0;
-    for (auto i = 0u; i < N; i++) {
-      hashCode = coco::hash_combine(hashCode, h(data_[i]));
-    }
-    return hashCode;
-  }
+  const char *data() const { return &data_[0]; }
+
+  std::size_t hash_code() const { return coco::hash_bytes(data(), N); }
 
   constexpr size_type length() const { return N; }
 
@@ -104,6 +120,10 @@ inline std::basic_ostream<C> &operator<<(std::basic_ostream<C> &os,
 template <std::size_t N> class Serializer<FixedString<N>> {
 public:
   std::string operator()(const FixedString<N> &v) { return v.toString(); }
+
+  void operator()(const FixedString<N> &v, std::string &out) {
+    out.append(v.data(), N);
+  }
 };
 
 template <std::size_t N> class Deserializer<FixedString<N>> {
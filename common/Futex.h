@@ -0,0 +1,129 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#ifndef __APPLE__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace coco {
+
+/*
+ * Futex waits on a 32-bit word, e.g., the status of the workers or the number
+ * of workers that have finished, until a predicate on the word holds.
+ *
+ * A waiter spins for a few rounds first, since the word usually changes soon
+ * at an epoch boundary, and then parks in the kernel so that an idle thread
+ * does not take a core from other threads. A thread that changes the word must
+ * call wake_all() afterwards.
+ *
+ * On macOS, a parked waiter yields instead.
+ */
+
+class Futex {
+public:
+  static constexpr int SPIN_ROUNDS = 1024;
+
+  // a parked waiter that has to serve requests wakes up this often
+  static constexpr int64_t IDLE_TIMEOUT_US = 100;
+
+  template <class Predicate>
+  static void wait_until(std::atomic<uint32_t> &word, Predicate predicate) {
+    for (auto i = 0; i < SPIN_ROUNDS; i++) {
+      if (predicate(word.load())) {
+        return;
+      }
+      nop_pause();
+    }
+
+    for (;;) {
+      uint32_t value = word.load();
+      if (predicate(value)) {
+        return;
+      }
+      park(word, value, -1);
+    }
+  }
+
+  /*
+   * The same as wait_until, but work() is called in the meantime, e.g.,
+   * process_request(), and returns the number of requests served. The waiter
+   * only parks after SPIN_ROUNDS calls without any, and at most for
+   * IDLE_TIMEOUT_US each time.
+   */
+
+  template <class Predicate, class Work>
+  static void wait_until(std::atomic<uint32_t> &word, Predicate predicate,
+                         Work work) {
+    int idle_rounds = 0;
+    for (;;) {
+      uint32_t value = word.load();
+      if (predicate(value)) {
+        return;
+      }
+      if (work() > 0) {
+        idle_rounds = 0;
+      } else if (++idle_rounds < SPIN_ROUNDS) {
+        nop_pause();
+      } else {
+        park(word, value, IDLE_TIMEOUT_US);
+      }
+    }
+  }
+
+  static void wake_all(std::atomic<uint32_t> &word) {
+#ifndef __APPLE__
+    syscall(SYS_futex, address(word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+            nullptr, 0);
+#endif
+  }
+
+  static void add_and_wake(std::atomic<uint32_t> &word, uint32_t n) {
+    word.fetch_add(n);
+    wake_all(word);
+  }
+
+  static void store_and_wake(std::atomic<uint32_t> &word, uint32_t value) {
+    word.store(value);
+    wake_all(word);
+  }
+
+private:
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "std::atomic<uint32_t> must be usable as a futex word.");
+
+  static void nop_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm volatile("pause" : :);
+#endif
+  }
+
+  // returns once the word is woken up, no longer holds value or the timeout
+  // in microseconds has passed, a negative timeout waits forever
+  static void park(std::atomic<uint32_t> &word, uint32_t value,
+                   int64_t timeout_us) {
+#ifndef __APPLE__
+    struct timespec timeout;
+    timeout.tv_sec = timeout_us / 1000000;
+    timeout.tv_nsec = timeout_us % 1000000 * 1000;
+    syscall(SYS_futex, address(word), FUTEX_WAIT_PRIVATE, value,
+            timeout_us < 0 ? nullptr : &timeout, nullptr, 0);
+#else
+    std::this_thread::yield();
+#endif
+  }
+
+  static uint32_t *address(std::atomic<uint32_t> &word) {
+    return reinterpret_cast<uint32_t *>(&word);
+  }
+};
+} // namespace coco
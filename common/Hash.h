@@ -4,23 +4,82 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <type_traits>
 
 namespace coco {
 
+/*
+ * The hashes of the keys, in the style of wyhash. std::hash is the identity
+ * on integers, so a composite key of sequential ids, e.g., a TPC-C order
+ * line, clusters in HashMap<N> with bucket_number = hash % N. Here each word
+ * is folded in with a 64x64 -> 128 bit multiply, which mixes every bit of
+ * the input into the low bits of the hash.
+ */
+
+static constexpr uint64_t HASH_P0 = 0xa0761d6478bd642fULL;
+static constexpr uint64_t HASH_P1 = 0xe7037ed1a0b428dbULL;
+static constexpr uint64_t HASH_P2 = 0x8ebc6af09c88c6e3ULL;
+
+// the xor of the two halves of a * b
+inline uint64_t hash_mum(uint64_t a, uint64_t b) {
+  __extension__ typedef unsigned __int128 uint128_t;
+  uint128_t r = static_cast<uint128_t>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
 template <typename T>
 inline std::size_t hash_combine(const T &v1, const T &v2) {
-  return v2 ^ (v1 + 0x9e3779b9 + (v2 << 6) + (v2 >> 2));
+  return hash_mum(static_cast<uint64_t>(v1) ^ HASH_P0,
+                  static_cast<uint64_t>(v2) ^ HASH_P1);
 }
 
+// hashes size bytes at data, size is a constant for fixed-width keys, so the
+// loops are unrolled
+inline std::size_t hash_bytes(const void *data, std::size_t size) {
+  auto p = static_cast<const char *>(data);
+  uint64_t h = HASH_P0 ^ size, a, b;
+  for (; size >= 16; size -= 16, p += 16) {
+    std::memcpy(&a, p, sizeof(a));
+    std::memcpy(&b, p + sizeof(a), sizeof(b));
+    h = hash_mum(a ^ HASH_P1, b ^ h);
+  }
+  if (size >= 8) {
+    std::memcpy(&a, p, sizeof(a));
+    h = hash_mum(a ^ HASH_P1, h ^ HASH_P2);
+    size -= 8;
+    p += 8;
+  }
+  if (size > 0) {
+    a = 0;
+    std::memcpy(&a, p, size);
+    h = hash_mum(a ^ HASH_P2, h ^ HASH_P1);
+  }
+  return hash_mum(h, HASH_P2);
+}
+
+// a word of a field, integers are mixed by hash_combine or hash
+template <typename T, typename Enable = void> struct HashWord {
+  std::size_t operator()(const T &v) const { return std::hash<T>()(v); }
+};
+
+template <typename T>
+struct HashWord<T, typename std::enable_if<std::is_integral<T>::value ||
+                                           std::is_enum<T>::value>::type> {
+  std::size_t operator()(const T &v) const {
+    return static_cast<uint64_t>(v);
+  }
+};
+
 template <typename T> inline std::size_t hash(const T &v) {
-  return std::hash<T>()(v);
+  return hash_mum(HashWord<T>()(v) ^ HASH_P0, HASH_P2);
 }
 
 template <typename T, typename... Rest>
-inline std::size_t hash(const T &v, Rest... rest) {
-  std::hash<T> h;
-  return hash_combine(h(v), hash(rest...));
+inline std::size_t hash(const T &v, const Rest &... rest) {
+  return hash_combine(HashWord<T>()(v), hash(rest...));
 }
 
 } // namespace coco
@@ -0,0 +1,206 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <glog/logging.h>
+#include <string>
+
+namespace coco {
+
+/*
+ * Histogram counts non-negative values in log-scaled buckets, in the spirit of
+ * HdrHistogram. Values below 2^(SUB_BUCKET_BITS + 1) are exact, larger ones
+ * fall into one of 2^SUB_BUCKET_BITS sub-buckets per power of two, i.e., a
+ * value is reported within 1% of its true value.
+ *
+ * add() is O(1) and the memory is fixed, so histograms of different workers or
+ * coordinators can be merged, and nth() uses the nearest-rank method like
+ * Percentile.
+ */
+
+class Histogram {
+public:
+  static constexpr int SUB_BUCKET_BITS = 7;
+  static constexpr uint64_t SUB_BUCKET_HALF = 1ull << SUB_BUCKET_BITS;
+  static constexpr uint64_t SUB_BUCKET_COUNT = 2 * SUB_BUCKET_HALF;
+  static constexpr std::size_t BUCKET_COUNT =
+      (64 - SUB_BUCKET_BITS) * SUB_BUCKET_HALF;
+
+  Histogram() { clear(); }
+
+  void add(int64_t value) {
+    uint64_t v = value < 0 ? 0 : value;
+    counts[index_of(v)]++;
+    total++;
+    min_value = std::min(min_value, v);
+    max_value = std::max(max_value, v);
+  }
+
+  void merge(const Histogram &h) {
+    if (h.total == 0) {
+      return;
+    }
+    for (auto i = 0u; i < BUCKET_COUNT; i++) {
+      counts[i] += h.counts[i];
+    }
+    total += h.total;
+    min_value = std::min(min_value, h.min_value);
+    max_value = std::max(max_value, h.max_value);
+  }
+
+  void clear() {
+    std::memset(counts, 0, sizeof(counts));
+    total = 0;
+    min_value = UINT64_MAX;
+    max_value = 0;
+  }
+
+  uint64_t size() const { return total; }
+
+  int64_t nth(double n) const {
+    if (total == 0) {
+      return 0;
+    }
+    DCHECK(n > 0 && n <= 100);
+    uint64_t rank = static_cast<uint64_t>(ceil(n / 100 * total));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (auto i = 0u; i < BUCKET_COUNT; i++) {
+      seen += counts[i];
+      if (seen >= rank) {
+        uint64_t v = std::max(std::min(highest_of(i), max_value), min_value);
+        return static_cast<int64_t>(v);
+      }
+    }
+    return static_cast<int64_t>(max_value);
+  }
+
+  // # of values in the buckets up to the one of v, i.e., the values no greater
+  // than v within 1%
+  uint64_t count_at_most(uint64_t v) const {
+    uint64_t n = 0;
+    for (std::size_t i = 0, last = index_of(v); i <= last; i++) {
+      n += counts[i];
+    }
+    return n;
+  }
+
+  // the sum of the values, each taken as the middle of its bucket
+  double approximate_sum() const {
+    double sum = 0;
+    for (auto i = 0u; i < BUCKET_COUNT; i++) {
+      if (counts[i] != 0) {
+        sum += (lowest_of(i) + highest_of(i)) / 2.0 * counts[i];
+      }
+    }
+    return sum;
+  }
+
+  // same format as Percentile::save_cdf, ~ 1k rows up to the 99th percentile
+  void save_cdf(const std::string &path) const {
+    if (total == 0 || path.empty()) {
+      return;
+    }
+
+    std::ofstream cdf;
+    cdf.open(path);
+
+    cdf << "value\tcdf" << std::endl;
+
+    constexpr int rows = 1000;
+    for (auto i = 1; i <= rows; i++) {
+      cdf << nth(99.0 * i / rows) << "\t" << 1.0 * i / rows << std::endl;
+    }
+
+    cdf.close();
+  }
+
+  /*
+   * The structure of an encoded histogram: (total : uint64_t, min : uint64_t,
+   * max : uint64_t, # of non-empty buckets : uint32_t, [index : uint32_t,
+   * count : uint64_t] ...)
+   */
+
+  void encode(Encoder &encoder) const {
+    uint32_t n = 0;
+    for (auto i = 0u; i < BUCKET_COUNT; i++) {
+      n += counts[i] != 0;
+    }
+    encoder << total << min_value << max_value << n;
+    for (uint32_t i = 0; i < BUCKET_COUNT; i++) {
+      if (counts[i] != 0) {
+        encoder << i << counts[i];
+      }
+    }
+  }
+
+  std::size_t encoded_size() const {
+    std::size_t n = 0;
+    for (auto i = 0u; i < BUCKET_COUNT; i++) {
+      n += counts[i] != 0;
+    }
+    return sizeof(uint64_t) * 3 + sizeof(uint32_t) +
+           n * (sizeof(uint32_t) + sizeof(uint64_t));
+  }
+
+  // merges an encoded histogram into this one
+  void decode_and_merge(Decoder &dec) {
+    uint64_t h_total, h_min, h_max;
+    uint32_t n;
+    dec >> h_total >> h_min >> h_max >> n;
+    for (auto k = 0u; k < n; k++) {
+      uint32_t i;
+      uint64_t count;
+      dec >> i >> count;
+      CHECK(i < BUCKET_COUNT);
+      counts[i] += count;
+    }
+    if (h_total == 0) {
+      return;
+    }
+    total += h_total;
+    min_value = std::min(min_value, h_min);
+    max_value = std::max(max_value, h_max);
+  }
+
+  static std::size_t index_of(uint64_t v) {
+    if (v < SUB_BUCKET_COUNT) {
+      return v;
+    }
+    int shift = 63 - __builtin_clzll(v) - SUB_BUCKET_BITS;
+    return shift * SUB_BUCKET_HALF + (v >> shift);
+  }
+
+  // the smallest value in bucket i
+  static uint64_t lowest_of(std::size_t i) {
+    if (i < SUB_BUCKET_COUNT) {
+      return i;
+    }
+    std::size_t shift = i / SUB_BUCKET_HALF - 1;
+    return (i - shift * SUB_BUCKET_HALF) << shift;
+  }
+
+  // the largest value in bucket i
+  static uint64_t highest_of(std::size_t i) {
+    if (i < SUB_BUCKET_COUNT) {
+      return i;
+    }
+    std::size_t shift = i / SUB_BUCKET_HALF - 1;
+    return lowest_of(i) + (1ull << shift) - 1;
+  }
+
+private:
+  uint64_t counts[BUCKET_COUNT];
+  uint64_t total;
+  uint64_t min_value, max_value;
+};
+} // namespace coco
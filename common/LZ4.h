@@ -0,0 +1,202 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace coco {
+
+/*
+ * A codec of the LZ4 block format, i.e., a sequence of
+ *
+ * | token (literal length 4 bits | match length 4 bits) | literal length + |
+ * | literals | match offset (16 bits) | match length + |
+ *
+ * where a length of 15 in the token continues in the bytes that follow it.
+ * The block ends with literals only, the last match starts at least
+ * MF_LIMIT bytes before the end and the last LAST_LITERALS bytes are
+ * literals, so that the output is readable by any LZ4 decoder.
+ *
+ * The compressor is the greedy single-probe hash table matcher of LZ4, it
+ * skips ahead faster on data that does not compress. Neither side allocates,
+ * messages, checkpoint files and log segments can share it.
+ */
+
+class LZ4 {
+public:
+  static constexpr std::size_t compress_bound(std::size_t size) {
+    return size + size / 255 + 16;
+  }
+
+  // compresses size bytes of src into dest, which has compress_bound(size)
+  // bytes, returns the size of the block
+  static std::size_t compress(const char *src, std::size_t size, char *dest) {
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *ip = base, *anchor = base, *end = base + size;
+    uint8_t *op = reinterpret_cast<uint8_t *>(dest);
+
+    if (size > MF_LIMIT) {
+      uint32_t table[HASH_SIZE] = {};
+      const uint8_t *match_limit = end - MF_LIMIT;
+      const uint8_t *last_literals = end - LAST_LITERALS;
+      std::size_t misses = 0;
+
+      while (ip <= match_limit) {
+        uint32_t sequence = read32(ip);
+        uint32_t &entry = table[hash(sequence)];
+        const uint8_t *ref = base + entry;
+        entry = static_cast<uint32_t>(ip - base);
+
+        if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != sequence) {
+          ip += 1 + (misses++ >> SKIP_TRIGGER);
+          continue;
+        }
+
+        const uint8_t *match_end = ip + MIN_MATCH;
+        ref += MIN_MATCH;
+        while (match_end < last_literals && *match_end == *ref) {
+          match_end++;
+          ref++;
+        }
+
+        uint8_t *token = op++;
+        op = write_literals(token, op, anchor, ip - anchor);
+        uint16_t offset = static_cast<uint16_t>(match_end - ref);
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        op = write_length(token, 0, op, match_end - ip - MIN_MATCH);
+
+        ip = anchor = match_end;
+        misses = 0;
+      }
+    }
+
+    uint8_t *token = op++;
+    op = write_literals(token, op, anchor, end - anchor);
+    return op - reinterpret_cast<uint8_t *>(dest);
+  }
+
+  // decompresses a block of size bytes into dest, returns false unless the
+  // block is well formed and decompresses to exactly raw_size bytes
+  static bool decompress(const char *src, std::size_t size, char *dest,
+                         std::size_t raw_size) {
+    const uint8_t *ip = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *end = ip + size;
+    uint8_t *base = reinterpret_cast<uint8_t *>(dest);
+    uint8_t *op = base, *op_end = base + raw_size;
+
+    while (ip < end) {
+      uint8_t token = *ip++;
+
+      std::size_t literal_length = token >> 4;
+      if (!read_length(ip, end, literal_length) ||
+          literal_length > static_cast<std::size_t>(end - ip) ||
+          literal_length > static_cast<std::size_t>(op_end - op)) {
+        return false;
+      }
+      std::memcpy(op, ip, literal_length);
+      ip += literal_length;
+      op += literal_length;
+
+      // the last sequence has no match
+      if (ip == end) {
+        break;
+      }
+
+      if (end - ip < 2) {
+        return false;
+      }
+      std::size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > static_cast<std::size_t>(op - base)) {
+        return false;
+      }
+
+      std::size_t match_length = token & 15;
+      if (!read_length(ip, end, match_length)) {
+        return false;
+      }
+      match_length += MIN_MATCH;
+      if (match_length > static_cast<std::size_t>(op_end - op)) {
+        return false;
+      }
+
+      const uint8_t *match = op - offset;
+      if (offset >= match_length) {
+        std::memcpy(op, match, match_length);
+        op += match_length;
+      } else {
+        // the match overlaps the bytes it produces
+        for (auto i = 0u; i < match_length; i++) {
+          *op++ = *match++;
+        }
+      }
+    }
+
+    return op == op_end;
+  }
+
+private:
+  static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static uint32_t hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+  }
+
+  static uint8_t *write_length(uint8_t *token, int shift, uint8_t *op,
+                               std::size_t length) {
+    if (length < 15) {
+      *token |= static_cast<uint8_t>(length << shift);
+      return op;
+    }
+    *token |= static_cast<uint8_t>(15 << shift);
+    for (length -= 15; length >= 255; length -= 255) {
+      *op++ = 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+  }
+
+  static uint8_t *write_literals(uint8_t *token, uint8_t *op,
+                                 const uint8_t *literals, std::size_t length) {
+    *token = 0;
+    op = write_length(token, 4, op, length);
+    std::memcpy(op, literals, length);
+    return op + length;
+  }
+
+  // a length of 15 continues in the bytes that follow, up to one below 255
+  static bool read_length(const uint8_t *&ip, const uint8_t *end,
+                          std::size_t &length) {
+    if (length != 15) {
+      return true;
+    }
+    uint8_t b;
+    do {
+      if (ip == end) {
+        return false;
+      }
+      b = *ip++;
+      length += b;
+    } while (b == 255);
+    return true;
+  }
+
+private:
+  static constexpr std::size_t MIN_MATCH = 4;
+  static constexpr std::size_t MF_LIMIT = 12;
+  static constexpr std::size_t LAST_LITERALS = 5;
+  static constexpr std::ptrdiff_t MAX_OFFSET = 65535;
+  static constexpr std::size_t SKIP_TRIGGER = 6;
+  static constexpr int HASH_LOG = 12;
+  static constexpr std::size_t HASH_SIZE = 1 << HASH_LOG;
+};
+} // namespace coco
@@ -6,6 +6,8 @@
 
 #include "glog/logging.h"
 #include <boost/lockfree/spsc_queue.hpp>
+#include <chrono>
+#include <cstdint>
 
 namespace coco {
 
@@ -28,12 +30,47 @@ public:
   using base_type =
       boost::lockfree::spsc_queue<T, boost::lockfree::capacity<N>>;
 
-  void push(const T &value) {
-    while (base_type::write_available() == 0) {
-      nop_pause();
+  // waits while the queue is full, returns the nanoseconds waited
+  uint64_t push(const T &value) {
+    uint64_t waited = 0;
+    if (base_type::write_available() == 0) {
+      auto now = std::chrono::steady_clock::now();
+      while (base_type::write_available() == 0) {
+        nop_pause();
+      }
+      waited = nanoseconds_since(now);
     }
     bool ok = base_type::push(value);
     CHECK(ok);
+    return waited;
+  }
+
+  // returns false instead of waiting if the queue is full
+  bool try_push(const T &value) { return base_type::push(value); }
+
+  // pushes n values with one update of the write index per contiguous run,
+  // waits while the queue is full, returns the nanoseconds waited
+  uint64_t push_n(const T *values, std::size_t n) {
+    auto pushed = base_type::push(values, n);
+    if (pushed == n) {
+      return 0;
+    }
+    auto now = std::chrono::steady_clock::now();
+    for (;;) {
+      values += pushed;
+      n -= pushed;
+      if (n == 0) {
+        break;
+      }
+      nop_pause();
+      pushed = base_type::push(values, n);
+    }
+    return nanoseconds_since(now);
+  }
+
+  // pops up to n values into values, returns the number of values popped
+  std::size_t pop_n(T *values, std::size_t n) {
+    return base_type::pop(values, n);
   }
 
   void wait_till_non_empty() {
@@ -44,7 +81,17 @@ public:
 
   auto capacity() { return N; }
 
+  // the number of values in the queue, called by the producer
+  std::size_t occupancy() { return N - base_type::write_available(); }
+
 private:
   void nop_pause() { __asm volatile("pause" : :); }
+
+  static uint64_t
+  nanoseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
 };
 } // namespace coco
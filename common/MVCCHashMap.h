@@ -4,46 +4,152 @@
 
 #pragma once
 
+#include "Arena.h"
 #include "SpinLock.h"
 #include <atomic>
 #include <glog/logging.h>
-#include <list>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace coco {
 
+/*
+ * VersionArena hands out values of versions from chunks that are never moved,
+ * so that a reference to a version stays valid until the version is vacuumed.
+ * Vacuumed values are reused. Chunks grow from MIN_CHUNK_SIZE to
+ * MAX_CHUNK_SIZE values, since most keys only have a few versions, and are
+ * carved out of the Arena of the map.
+ */
+
+template <class ValueType> class VersionArena {
+public:
+  static constexpr std::size_t MIN_CHUNK_SIZE = 4, MAX_CHUNK_SIZE = 1024;
+
+  VersionArena() = default;
+
+  VersionArena(const VersionArena &) = delete;
+  VersionArena &operator=(const VersionArena &) = delete;
+
+  // the memory of the values goes with the arena
+  ~VersionArena() {
+    if (!std::is_trivially_destructible<ValueType>::value) {
+      for (auto i = 0u; i < chunks.size(); i++) {
+        for (auto j = 0u; j < chunk_sizes[i]; j++) {
+          chunks[i][j].~ValueType();
+        }
+      }
+    }
+  }
+
+  void set_arena(Arena *arena) { this->arena = arena; }
+
+  ValueType *allocate() {
+    if (!free_values.empty()) {
+      ValueType *value = free_values.back();
+      free_values.pop_back();
+      value->~ValueType();
+      new (value) ValueType();
+      return value;
+    }
+    if (chunks.empty() || used == chunk_size) {
+      if (chunks.empty()) {
+        chunk_size = MIN_CHUNK_SIZE;
+      } else if (chunk_size < MAX_CHUNK_SIZE) {
+        chunk_size *= 2;
+      }
+      auto values = static_cast<ValueType *>(arena->allocate(
+          chunk_size * sizeof(ValueType), alignof(ValueType)));
+      for (auto i = 0u; i < chunk_size; i++) {
+        new (&values[i]) ValueType();
+      }
+      chunks.push_back(values);
+      chunk_sizes.push_back(chunk_size);
+      used = 0;
+    }
+    return &chunks.back()[used++];
+  }
+
+  void free(ValueType *value) { free_values.push_back(value); }
+
+private:
+  Arena *arena = nullptr;
+  std::vector<ValueType *> chunks;
+  std::vector<std::size_t> chunk_sizes;
+  std::size_t chunk_size = 0, used = 0;
+  std::vector<ValueType *> free_values;
+};
+
 /*
  *  MVCC Hash Map -- overview --
  *
- *  KeyType -> std::list<std::tuple<uint64_t, ValueType>>,
- *  uint64_t: version, ValueType: value
+ *  KeyType -> VersionChain, a VersionChain keeps the newest version (the
+ *  largest value) inline and the older versions in a vector in increasing
+ *  order of versions. A version is a pair of uint64_t (the version) and a
+ *  pointer to its value in the VersionArena of the bucket.
  *
- *  By default, the first node is a sentinel node, then comes the newest version
- * (the largest value). The upper application (e.g., worker thread) is
- * responsible for data vacuum. Given a vacuum_version, all versions less than
- * or equal to vacuum_version will be garbage collected.
+ *  Superseded versions are reclaimed in bulk with reclaim(), see
+ *  VersionReclaimer. The upper application (e.g., worker thread) can also
+ *  vacuum a key, given a vacuum_version, all versions less than or equal to
+ *  vacuum_version will be garbage collected.
  */
 
 template <std::size_t N, class KeyType, class ValueType> class MVCCHashMap {
 public:
-  using VersionTupleType = std::tuple<uint64_t, ValueType>;
-  using MappedValueType = std::list<VersionTupleType>;
-  using HashMapType = std::unordered_map<KeyType, MappedValueType>;
+  MVCCHashMap() {
+    for (auto i = 0u; i < N; i++) {
+      arenas[i].set_arena(&arena);
+    }
+  }
+
+  struct Version {
+    uint64_t version = 0;
+    ValueType *value = nullptr;
+  };
+
+  struct VersionChain {
+    bool empty() const { return latest.value == nullptr; }
+
+    std::size_t size() const { return empty() ? 0 : older.size() + 1; }
+
+    // newest first
+    template <class Func> Version *find_if(Func func) {
+      if (empty()) {
+        return nullptr;
+      }
+      if (func(latest.version)) {
+        return &latest;
+      }
+      for (auto it = older.rbegin(); it != older.rend(); it++) {
+        if (func(it->version)) {
+          return &*it;
+        }
+      }
+      return nullptr;
+    }
+
+    Version latest;
+    std::vector<Version> older;
+  };
+
+  using HashMapType = std::unordered_map<KeyType, VersionChain>;
   using HasherType = typename HashMapType::hasher;
 
   // if a particular key exists.
   bool contains_key(const KeyType &key) {
     return apply(
-        [&key](HashMapType &map) {
+        [&key](HashMapType &map, VersionArena<ValueType> &) {
           auto it = map.find(key);
 
           if (it == map.end()) {
             return false;
           }
 
-          // check if the list is empty
-          auto &l = it->second;
-          return !l.empty();
+          // check if the chain is empty
+          return !it->second.empty();
         },
         bucket_number(key));
   }
@@ -51,20 +157,16 @@ public:
   // if a particular key with a specific version exists.
   bool contains_key_version(const KeyType &key, uint64_t version) {
     return apply(
-        [&key, version](HashMapType &map) {
+        [&key, version](HashMapType &map, VersionArena<ValueType> &) {
           auto it = map.find(key);
 
           if (it == map.end()) {
             return false;
           }
 
-          auto &l = it->second;
-          for (VersionTupleType &vt : l) {
-            if (get_version(vt) == version) {
-              return true;
-            }
-          }
-          return false;
+          return it->second.find_if([version](uint64_t v) {
+            return v == version;
+          }) != nullptr;
         },
         bucket_number(key));
   }
@@ -72,12 +174,19 @@ public:
   // remove a particular key.
   bool remove_key(const KeyType &key) {
     return apply(
-        [&key](HashMapType &map) {
+        [&key](HashMapType &map, VersionArena<ValueType> &arena) {
           auto it = map.find(key);
 
           if (it == map.end()) {
             return false;
           }
+          auto &chain = it->second;
+          if (!chain.empty()) {
+            arena.free(chain.latest.value);
+          }
+          for (auto &v : chain.older) {
+            arena.free(v.value);
+          }
           map.erase(it);
           return true;
         },
@@ -87,16 +196,29 @@ public:
   // remove a particular key with a specific version.
   bool remove_key_version(const KeyType &key, uint64_t version) {
     return apply(
-        [&key, version](HashMapType &map) {
+        [&key, version](HashMapType &map, VersionArena<ValueType> &arena) {
           auto it = map.find(key);
-          if (it == map.end()) {
+          if (it == map.end() || it->second.empty()) {
             return false;
           }
-          auto &l = it->second;
+          auto &chain = it->second;
+
+          if (chain.latest.version == version) {
+            arena.free(chain.latest.value);
+            if (chain.older.empty()) {
+              chain.latest = Version();
+            } else {
+              chain.latest = chain.older.back();
+              chain.older.pop_back();
+            }
+            return true;
+          }
 
-          for (auto lit = l.begin(); lit != l.end(); lit++) {
-            if (get_version(*lit) == version) {
-              l.erase(lit);
+          for (auto vit = chain.older.begin(); vit != chain.older.end();
+               vit++) {
+            if (vit->version == version) {
+              arena.free(vit->value);
+              chain.older.erase(vit);
               return true;
             }
           }
@@ -106,42 +228,56 @@ public:
   }
 
   // insert a key with a specific version placeholder and return the reference
+  // the versions older than a new version are retired, see reclaim()
   ValueType &insert_key_version_holder(const KeyType &key, uint64_t version) {
+    auto i = bucket_number(key);
+    auto &retired_versions = retired[i];
     return apply_ref(
-        [&key, version](HashMapType &map) -> ValueType & {
-          auto &l = map[key];
-          // always insert to the front if the list is empty
-          if (l.empty()) {
-            l.emplace_front();
-          } else {
-            // make sure the version is larger than the head, making sure the
-            // versions are always monotonically decreasing
-            auto &head = l.front();
-            auto head_version = get_version(head);
+        [&key, version, &retired_versions](
+            HashMapType &map, VersionArena<ValueType> &arena) -> ValueType & {
+          auto &chain = map[key];
+          if (!chain.empty()) {
+            // make sure the version is larger than the latest one, making
+            // sure the versions are always monotonically increasing
+            auto head_version = chain.latest.version;
             CHECK(version > head_version)
                 << "the new version: " << version
                 << " is not larger than the current latest version: "
                 << head_version;
-            l.emplace_front();
+            chain.older.push_back(chain.latest);
+            retired_versions.emplace_back(key, version);
           }
-          // set the version
-          std::get<0>(l.front()) = version;
-          // std::get<0> returns the version
-          return std::get<1>(l.front());
+          chain.latest.version = version;
+          chain.latest.value = arena.allocate();
+          return *chain.latest.value;
         },
         bucket_number(key));
   }
 
+  // call func(key, version, value) on the latest version of each key, the
+  // bucket lock is held during the call.
+  template <class Func> void for_each_latest(Func func) {
+    for (auto i = 0u; i < N; i++) {
+      locks[i].lock();
+      for (auto &kv : maps[i]) {
+        auto &chain = kv.second;
+        if (!chain.empty()) {
+          func(kv.first, chain.latest.version, *chain.latest.value);
+        }
+      }
+      locks[i].unlock();
+    }
+  }
+
   // return the number of versions of a particular key
   std::size_t version_count(const KeyType &key) {
     return apply(
-        [&key](HashMapType &map) -> std::size_t {
+        [&key](HashMapType &map, VersionArena<ValueType> &) -> std::size_t {
           auto it = map.find(key);
           if (it == map.end()) {
             return 0;
           } else {
-            auto &l = it->second;
-            return l.size();
+            return it->second.size();
           }
         },
         bucket_number(key));
@@ -151,18 +287,15 @@ public:
   // nullptr if not exists.
   ValueType *get_key_version(const KeyType &key, uint64_t version) {
     return apply(
-        [&key, version](HashMapType &map) -> ValueType * {
+        [&key, version](HashMapType &map,
+                        VersionArena<ValueType> &) -> ValueType * {
           auto it = map.find(key);
           if (it == map.end()) {
             return nullptr;
           }
-          auto &l = it->second;
-          for (VersionTupleType &vt : l) {
-            if (get_version(vt) == version) {
-              return &get_value(vt);
-            }
-          }
-          return nullptr;
+          auto *v = it->second.find_if(
+              [version](uint64_t vv) { return vv == version; });
+          return v == nullptr ? nullptr : v->value;
         },
         bucket_number(key));
   }
@@ -170,18 +303,15 @@ public:
   // specific version nullptr if not exists.
   ValueType *get_key_version_prev(const KeyType &key, uint64_t version) {
     return apply(
-        [&key, version](HashMapType &map) -> ValueType * {
+        [&key, version](HashMapType &map,
+                        VersionArena<ValueType> &) -> ValueType * {
           auto it = map.find(key);
           if (it == map.end()) {
             return nullptr;
           }
-          auto &l = it->second;
-          for (VersionTupleType &vt : l) {
-            if (get_version(vt) < version) {
-              return &get_value(vt);
-            }
-          }
-          return nullptr;
+          auto *v = it->second.find_if(
+              [version](uint64_t vv) { return vv < version; });
+          return v == nullptr ? nullptr : v->value;
         },
         bucket_number(key));
   }
@@ -189,26 +319,13 @@ public:
   // remove all versions less than or equal to vacuum_version
   std::size_t vacuum_key_versions(const KeyType &key, uint64_t vacuum_version) {
     return apply(
-        [&key, vacuum_version](HashMapType &map) -> std::size_t {
+        [&key, vacuum_version](HashMapType &map,
+                               VersionArena<ValueType> &arena) -> std::size_t {
           auto it = map.find(key);
           if (it == map.end()) {
             return 0;
           }
-
-          std::size_t size = 0;
-          auto &l = it->second;
-          auto lit = l.end();
-
-          while (lit != l.begin()) {
-            lit--;
-            if (get_version(*lit) <= vacuum_version) {
-              lit = l.erase(lit);
-              size++;
-            } else {
-              break;
-            }
-          }
-          return size;
+          return vacuum(it->second, arena, vacuum_version);
         },
         bucket_number(key));
   }
@@ -216,46 +333,135 @@ public:
   // remove all versions except the latest one
   std::size_t vacuum_key_keep_latest(const KeyType &key) {
     return apply(
-        [&key](HashMapType &map) -> std::size_t {
+        [&key](HashMapType &map,
+               VersionArena<ValueType> &arena) -> std::size_t {
           auto it = map.find(key);
           if (it == map.end()) {
             return 0;
           }
 
-          std::size_t size = 0;
-          auto &l = it->second;
-          auto lit = l.begin();
-          if (lit == l.end()) {
-            return 0;
-          }
-
-          lit++;
-          while (lit != l.end()) {
-            lit = l.erase(lit);
-            size++;
+          auto &chain = it->second;
+          std::size_t size = chain.older.size();
+          for (auto &v : chain.older) {
+            arena.free(v.value);
           }
+          chain.older.clear();
           return size;
         },
         bucket_number(key));
   }
 
-private:
-  static uint64_t get_version(std::tuple<uint64_t, ValueType> &t) {
-    return std::get<0>(t);
+  /*
+   * Once a key has a new version v, the versions older than v are only read
+   * by snapshots before v. Given the oldest snapshot still active, the
+   * watermark, reclaim() removes the versions retired by every new version
+   * less than the watermark in bulk, one bucket at a time.
+   */
+
+  std::size_t reclaim(uint64_t watermark) {
+    std::size_t size = 0;
+    for (auto i = 0u; i < N; i++) {
+      locks[i].lock();
+      auto &r = retired[i];
+      std::size_t kept = 0;
+      for (auto k = 0u; k < r.size(); k++) {
+        if (r[k].second < watermark) {
+          auto it = maps[i].find(r[k].first);
+          if (it != maps[i].end()) {
+            size += vacuum(it->second, arenas[i], r[k].second - 1);
+          }
+        } else {
+          r[kept++] = r[k];
+        }
+      }
+      r.erase(r.begin() + kept, r.end());
+      locks[i].unlock();
+    }
+    return size;
+  }
+
+  // the number of keys with a version
+  std::size_t size() {
+    std::size_t size = 0;
+    for (auto i = 0u; i < N; i++) {
+      locks[i].lock();
+      for (auto &kv : maps[i]) {
+        size += !kv.second.empty();
+      }
+      locks[i].unlock();
+    }
+    return size;
+  }
+
+  // the number of versions of all keys
+  std::size_t n_versions() {
+    std::size_t size = 0;
+    for (auto i = 0u; i < N; i++) {
+      locks[i].lock();
+      for (auto &kv : maps[i]) {
+        size += kv.second.size();
+      }
+      locks[i].unlock();
+    }
+    return size;
   }
 
-  static ValueType &get_value(std::tuple<uint64_t, ValueType> &t) {
-    return std::get<1>(t);
+  // bytes of the version chains outside of the arena, estimating a node of a
+  // hash map as its entry and two pointers
+  std::size_t index_size() {
+    std::size_t size = 0;
+    for (auto i = 0u; i < N; i++) {
+      locks[i].lock();
+      size += maps[i].bucket_count() * sizeof(void *) +
+              maps[i].size() * (sizeof(typename HashMapType::value_type) +
+                                2 * sizeof(void *)) +
+              retired[i].capacity() * sizeof(retired[i][0]);
+      for (auto &kv : maps[i]) {
+        size += kv.second.older.capacity() * sizeof(Version);
+      }
+      locks[i].unlock();
+    }
+    return size;
   }
 
+  // bytes of the values of the versions, see Arena
+  std::size_t memory_size() const { return arena.mapped(); }
+
+  // bytes of the values on explicit huge pages
+  std::size_t huge_page_size() const { return arena.huge_pages(); }
+
 private:
+  // remove all versions less than or equal to vacuum_version
+  static std::size_t vacuum(VersionChain &chain,
+                            VersionArena<ValueType> &arena,
+                            uint64_t vacuum_version) {
+    if (chain.empty()) {
+      return 0;
+    }
+
+    std::size_t size = 0;
+    while (size < chain.older.size() &&
+           chain.older[size].version <= vacuum_version) {
+      arena.free(chain.older[size].value);
+      size++;
+    }
+    chain.older.erase(chain.older.begin(), chain.older.begin() + size);
+
+    if (chain.older.empty() && chain.latest.version <= vacuum_version) {
+      arena.free(chain.latest.value);
+      chain.latest = Version();
+      size++;
+    }
+    return size;
+  }
+
   auto bucket_number(const KeyType &key) { return hasher(key) % N; }
 
   template <class ApplyFunc>
   auto &apply_ref(ApplyFunc applyFunc, std::size_t i) {
     DCHECK(i < N) << "index " << i << " is greater than " << N;
     locks[i].lock();
-    auto &result = applyFunc(maps[i]);
+    auto &result = applyFunc(maps[i], arenas[i]);
     locks[i].unlock();
     return result;
   }
@@ -263,7 +469,7 @@ private:
   template <class ApplyFunc> auto apply(ApplyFunc applyFunc, std::size_t i) {
     DCHECK(i < N) << "index " << i << " is greater than " << N;
     locks[i].lock();
-    auto result = applyFunc(maps[i]);
+    auto result = applyFunc(maps[i], arenas[i]);
     locks[i].unlock();
     return result;
   }
@@ -271,6 +477,12 @@ private:
 private:
   HasherType hasher;
   HashMapType maps[N];
+  // the memory of the values of all buckets, outlives arenas
+  Arena arena;
+  // the values of the versions in each bucket, guarded by the bucket lock
+  VersionArena<ValueType> arenas[N];
+  // (key, new version) in each bucket, guarded by the bucket lock
+  std::vector<std::pair<KeyType, uint64_t>> retired[N];
   SpinLock locks[N];
 };
-} // namespace coco
\ No newline at end of file
+} // namespace coco
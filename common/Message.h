@@ -5,8 +5,13 @@
 #pragma once
 
 #include "StringPiece.h"
+#include "common/LZ4.h"
 #include "common/MessagePiece.h"
+#include "common/PieceCodec.h"
+#include "common/ReceiveBuffer.h"
+#include "common/Time.h"
 #include <chrono>
+#include <cstring>
 #include <string>
 
 namespace coco {
@@ -14,15 +19,37 @@ namespace coco {
 /*
  * Message header format
  *
- * | source node id (7 => 128) | dest node id (7 => 128) | worker id (8 => 256)
- * | count (15 => 2^15 = 32768) | length (27 => 2^27 = 134217728) |
+ * | source node id (16) | dest node id (16) | worker id (16) | 0 (16) |
+ * | 0xdeadbeed (32 bits) | count (32 bits) | length (32 bits) |
  *
  * Note that, the header is included in the message size.
  *
  * Message format
  *
- * | Message header (64 bits) | 0xdeadbeef (32 bits) | (message pieces) * |
+ * | Message header (160 bits) | (message pieces) * |
+ *
+ * This is also the extended format on the wire. Most messages fit in the
+ * compact format instead, which frame() writes in place right before the
+ * pieces, so that it costs no copy.
+ *
+ * | source node id (7 => 128) | dest node id (7 => 128) | worker id (8 => 256)
+ * | count (15 => 2^15 = 32768) | length (27 => 2^27 = 134217728) |
+ * | 0xdeadbeef (32 bits) | (message pieces) * |
+ *
+ * Compressed message format on the wire, see --compress_messages
+ *
+ * | compact or extended header | raw length (32 bits) |
+ * | LZ4 block of the message pieces |
+ *
+ * Packed message format on the wire, see --pack_messages and PieceCodec
  *
+ * | compact or extended header | raw length (32 bits) | packed pieces |
+ *
+ * The least significant bits of 0xdeadbeef tell the formats apart, bit 0 is
+ * cleared if the message is compressed, bit 1 if its header is extended and
+ * bit 2 if it is packed. The length in a header on the wire is the length on
+ * the wire, the raw length is the length of the pieces once they are
+ * decompressed or unpacked.
  *
  * Message piece format
  *
@@ -92,118 +119,340 @@ public:
 
   Message() : data(get_prefix_size(), 0) {
     set_message_length(data.size());
-    get_deadbeef_ref() = DEADBEEF;
+    get_deadbeef_ref() = EXTENDED_DEADBEEF;
   }
 
+  Message(const Message &) = delete;
+  Message &operator=(const Message &) = delete;
+
+  Message(Message &&that)
+      : data(std::move(that.data)), time(that.time),
+        last_piece_offset(that.last_piece_offset),
+        view_buffer(that.view_buffer), view_ptr(that.view_ptr),
+        view_size(that.view_size) {
+    that.view_buffer = nullptr;
+    that.clear();
+  }
+
+  ~Message() { drop_view(); }
+
   void resize(std::size_t size) {
     DCHECK(data.size() == get_prefix_size());
     data.resize(size);
     set_message_length(data.size());
-    get_deadbeef_ref() = DEADBEEF;
+    get_deadbeef_ref() = EXTENDED_DEADBEEF;
   }
 
   char *get_raw_ptr() { return &data[0]; }
 
+  // keeps the capacity of data, so that recycled messages do not reallocate
   void clear() {
-    data = std::string(get_prefix_size(), 0);
+    drop_view();
+    data.assign(get_prefix_size(), 0);
     set_message_length(data.size());
-    get_deadbeef_ref() = DEADBEEF;
+    get_deadbeef_ref() = EXTENDED_DEADBEEF;
   }
 
   void flush() {
     auto message_count = get_message_count();
+    last_piece_offset = get_message_length();
     set_message_count(message_count + 1);
     set_message_length(data.length());
-    time = std::chrono::steady_clock::now();
+    time = Clock::now();
+  }
+
+  /*
+   * The entries of multi-key pieces, e.g., the lock requests of keys in the
+   * same table and partition, share one piece. If can_merge(header) is true,
+   * i.e., the last piece only differs from header in the length, an entry can
+   * be appended without a header and merged into the last piece instead of
+   * being flushed as a piece of its own. Only for messages being built.
+   */
+  bool can_merge(uint64_t header) {
+    return get_message_count() > 0 &&
+           MessagePiece::is_same_piece(get_last_piece_header_ref(), header);
   }
 
-  bool check_size() { return get_message_length() == data.size(); }
+  void merge_into_last_piece() {
+    auto &header = get_last_piece_header_ref();
+    header = MessagePiece::set_message_length(header,
+                                              data.size() - last_piece_offset);
+    set_message_length(data.length());
+    time = Clock::now();
+  }
+
+  bool check_size() {
+    return get_message_length() == get_prefix_size() + get_pieces_size();
+  }
 
   bool check_deadbeef() {
     auto deadbeef = get_deadbeef_ref();
-    return deadbeef == DEADBEEF;
+    return deadbeef == EXTENDED_DEADBEEF;
+  }
+
+  /*
+   * Writes the header on the wire in place and returns the offset in data the
+   * message starts from on the wire, see the formats above. The message can
+   * only be sent or recycled afterwards.
+   */
+  std::size_t frame() {
+    auto offset = get_prefix_size() - get_compact_prefix_size();
+    if (!is_compact(data.size() - offset)) {
+      return 0;
+    }
+    write_compact_prefix(&data[offset], data.size() - offset, DEADBEEF);
+    return offset;
+  }
+
+  /*
+   * Writes the compressed form of this message to buffer, see the formats
+   * above. Returns false if it does not make the message any smaller.
+   */
+  bool compress_to(std::string &buffer) {
+    auto raw_length = data.size() - get_prefix_size();
+    auto prefix_size = get_encoded_prefix_size();
+    buffer.resize(prefix_size + sizeof(uint32_t) +
+                  LZ4::compress_bound(raw_length));
+    auto compressed_length =
+        prefix_size + sizeof(uint32_t) +
+        LZ4::compress(&data[0] + get_prefix_size(), raw_length,
+                      &buffer[0] + prefix_size + sizeof(uint32_t));
+    buffer.resize(compressed_length);
+    return write_encoded_prefix(buffer, prefix_size, COMPRESSED_BIT);
+  }
+
+  /*
+   * Writes the packed form of this message to buffer, see the formats above.
+   * Returns false if it does not make the message any smaller.
+   */
+  bool pack_to(std::string &buffer) {
+    auto prefix_size = get_encoded_prefix_size();
+    buffer.assign(prefix_size + sizeof(uint32_t), 0);
+    PieceCodec::pack(&data[0] + get_prefix_size(),
+                     data.size() - get_prefix_size(), buffer);
+    return write_encoded_prefix(buffer, prefix_size, PACKED_BIT);
+  }
+
+  // fills this cleared message with the message of length bytes at ptr in any
+  // of the formats on the wire, returns false if it is corrupted
+  bool read_from(const char *ptr, std::size_t length) {
+    auto deadbeef = get_deadbeef(ptr);
+    auto prefix_size = get_wire_prefix_size(ptr);
+    DCHECK(is_deadbeef(deadbeef) && length >= prefix_size);
+
+    uint64_t header, count;
+    read_prefix(ptr, header, count);
+    ptr += prefix_size;
+    length -= prefix_size;
+    bool ok = true;
+
+    if (!is_compressed(deadbeef) && !is_packed(deadbeef)) {
+      resize(get_prefix_size() + length);
+      std::memcpy(&data[0] + get_prefix_size(), ptr, length);
+    } else {
+      uint32_t raw_length;
+      if (length < sizeof(raw_length)) {
+        return false;
+      }
+      std::memcpy(&raw_length, ptr, sizeof(raw_length));
+      resize(get_prefix_size() + raw_length);
+      if (is_compressed(deadbeef)) {
+        ok = LZ4::decompress(ptr + sizeof(raw_length),
+                             length - sizeof(raw_length),
+                             &data[0] + get_prefix_size(), raw_length);
+      } else {
+        ok = PieceCodec::unpack(ptr + sizeof(raw_length),
+                                length - sizeof(raw_length),
+                                &data[0] + get_prefix_size(), raw_length);
+      }
+    }
+
+    get_header_ref() = header;
+    set_message_count(count);
+    return ok;
+  }
+
+  /*
+   * Like read_from(), but the pieces are left in buffer and the message views
+   * them, holding a reference to buffer until it is cleared or destroyed.
+   * Only the header is kept in data. A compressed or packed message is still
+   * read into data.
+   */
+  bool view_from(ReceiveBuffer *buffer, const char *ptr, std::size_t length) {
+    if (is_compressed(get_deadbeef(ptr)) || is_packed(get_deadbeef(ptr))) {
+      return read_from(ptr, length);
+    }
+
+    DCHECK(data.size() == get_prefix_size() && view_buffer == nullptr);
+    auto prefix_size = get_wire_prefix_size(ptr);
+    DCHECK(length >= prefix_size);
+
+    uint64_t header, count;
+    read_prefix(ptr, header, count);
+    buffer->ref();
+    view_buffer = buffer;
+    view_ptr = ptr + prefix_size;
+    view_size = length - prefix_size;
+
+    get_header_ref() = header;
+    set_message_count(count);
+    set_message_length(get_prefix_size() + view_size);
+    return true;
+  }
+
+  // drops the reference to the buffer the message views, if any
+  void drop_view() {
+    if (view_buffer != nullptr) {
+      view_buffer->unref();
+      view_buffer = nullptr;
+      view_ptr = nullptr;
+      view_size = 0;
+    }
+  }
+
+  const char *get_pieces_ptr() {
+    return view_buffer != nullptr ? view_ptr : &data[0] + get_prefix_size();
+  }
+
+  std::size_t get_pieces_size() {
+    return view_buffer != nullptr ? view_size : data.size() - get_prefix_size();
   }
 
   Iterator begin() {
-    auto eof = &data[0] + data.size();
-    return Iterator(&data[0] + get_prefix_size(), eof);
+    auto eof = get_pieces_ptr() + get_pieces_size();
+    return Iterator(get_pieces_ptr(), eof);
   }
 
   Iterator end() {
-    auto eof = &data[0] + data.size();
+    auto eof = get_pieces_ptr() + get_pieces_size();
     return Iterator(eof, eof);
   }
 
 public:
   void set_source_node_id(uint64_t source_node_id) {
-    DCHECK(source_node_id < (1 << 7));
+    DCHECK(source_node_id < (1 << 16));
     clear_source_node_id();
-    get_header_ref() |= (source_node_id << SOURCE_NODE_ID_OFFSET);
+    get_header_ref() |= (source_node_id << EXTENDED_SOURCE_NODE_ID_OFFSET);
   }
 
   uint64_t get_source_node_id() {
-    return (get_header_ref() >> SOURCE_NODE_ID_OFFSET) & SOURCE_NODE_ID_MASK;
+    return (get_header_ref() >> EXTENDED_SOURCE_NODE_ID_OFFSET) &
+           EXTENDED_ID_MASK;
   }
 
   void set_dest_node_id(uint64_t dest_node_id) {
-    DCHECK(dest_node_id < (1 << 7));
+    DCHECK(dest_node_id < (1 << 16));
     clear_dest_node_id();
-    get_header_ref() |= (dest_node_id << DEST_NODE_ID_OFFSET);
+    get_header_ref() |= (dest_node_id << EXTENDED_DEST_NODE_ID_OFFSET);
   }
 
   uint64_t get_dest_node_id() {
-    return (get_header_ref() >> DEST_NODE_ID_OFFSET) & DEST_NODE_ID_MASK;
+    return (get_header_ref() >> EXTENDED_DEST_NODE_ID_OFFSET) &
+           EXTENDED_ID_MASK;
   }
 
   void set_worker_id(uint64_t worker_id) {
-    DCHECK(worker_id < (1 << 8));
+    DCHECK(worker_id < (1 << 16));
     clear_worker_id();
-    get_header_ref() |= (worker_id << WORKER_ID_OFFSET);
+    get_header_ref() |= (worker_id << EXTENDED_WORKER_ID_OFFSET);
   }
 
   uint64_t get_worker_id() {
-    return (get_header_ref() >> WORKER_ID_OFFSET) & WORKER_ID_MASK;
+    return (get_header_ref() >> EXTENDED_WORKER_ID_OFFSET) & EXTENDED_ID_MASK;
   }
 
-  uint64_t get_message_count() {
-    return (get_header_ref() >> MESSAGE_COUNT_OFFSET) & MESSAGE_COUNT_MASK;
-  }
+  uint64_t get_message_count() { return get_count_ref(); }
 
-  uint64_t get_message_length() {
-    return (get_header_ref() >> MESSAGE_LENGTH_OFFSET) & MESSAGE_LENGTH_MASK;
-  }
+  uint64_t get_message_length() { return get_length_ref(); }
 
 private:
   void clear_source_node_id() {
-    get_header_ref() &= ~(SOURCE_NODE_ID_MASK << SOURCE_NODE_ID_OFFSET);
+    get_header_ref() &= ~(EXTENDED_ID_MASK << EXTENDED_SOURCE_NODE_ID_OFFSET);
   }
 
   void clear_dest_node_id() {
-    get_header_ref() &= ~(DEST_NODE_ID_MASK << DEST_NODE_ID_OFFSET);
+    get_header_ref() &= ~(EXTENDED_ID_MASK << EXTENDED_DEST_NODE_ID_OFFSET);
   }
 
   void clear_worker_id() {
-    get_header_ref() &= ~(WORKER_ID_MASK << WORKER_ID_OFFSET);
+    get_header_ref() &= ~(EXTENDED_ID_MASK << EXTENDED_WORKER_ID_OFFSET);
   }
 
-  void clear_message_count() {
-    get_header_ref() &= ~(MESSAGE_COUNT_MASK << MESSAGE_COUNT_OFFSET);
+  void set_message_count(uint64_t message_count) {
+    DCHECK(message_count < (1ull << 32));
+    get_count_ref() = static_cast<uint32_t>(message_count);
   }
 
-  void clear_message_length() {
-    get_header_ref() &= ~(MESSAGE_LENGTH_MASK << MESSAGE_LENGTH_OFFSET);
+  void set_message_length(uint64_t message_length) {
+    DCHECK(message_length < (1ull << 32));
+    get_length_ref() = static_cast<uint32_t>(message_length);
   }
 
-  void set_message_count(uint64_t message_count) {
-    DCHECK(message_count < (1 << 15));
-    clear_message_count();
-    get_header_ref() |= (message_count << MESSAGE_COUNT_OFFSET);
+  // if the message fits in the compact format with length bytes on the wire
+  bool is_compact(uint64_t length) {
+    return get_source_node_id() <= SOURCE_NODE_ID_MASK &&
+           get_dest_node_id() <= DEST_NODE_ID_MASK &&
+           get_worker_id() <= WORKER_ID_MASK &&
+           get_message_count() <= MESSAGE_COUNT_MASK &&
+           length <= MESSAGE_LENGTH_MASK;
   }
 
-  void set_message_length(uint64_t message_length) {
-    DCHECK(message_length < (1 << 27));
-    clear_message_length();
-    get_header_ref() |= (message_length << MESSAGE_LENGTH_OFFSET);
+  // the prefix of the compressed or packed form of this message
+  std::size_t get_encoded_prefix_size() {
+    auto offset = get_prefix_size() - get_compact_prefix_size();
+    return is_compact(data.size() - offset) ? get_compact_prefix_size()
+                                            : get_prefix_size();
+  }
+
+  // buffer has prefix_size bytes for the prefix, the raw length and the
+  // encoded pieces, returns false if it is no smaller than the message
+  bool write_encoded_prefix(std::string &buffer, std::size_t prefix_size,
+                            uint32_t encoding_bit) {
+    auto raw_length = data.size() - get_prefix_size();
+    if (buffer.size() >= raw_length + prefix_size) {
+      return false;
+    }
+
+    if (prefix_size == get_compact_prefix_size()) {
+      write_compact_prefix(&buffer[0], buffer.size(),
+                           DEADBEEF & ~encoding_bit);
+    } else {
+      std::memcpy(&buffer[0], &data[0], prefix_size);
+      uint32_t deadbeef = EXTENDED_DEADBEEF & ~encoding_bit;
+      uint32_t length = static_cast<uint32_t>(buffer.size());
+      std::memcpy(&buffer[sizeof(header_type)], &deadbeef, sizeof(deadbeef));
+      std::memcpy(&buffer[LENGTH_OFFSET], &length, sizeof(length));
+    }
+    uint32_t length = static_cast<uint32_t>(raw_length);
+    std::memcpy(&buffer[prefix_size], &length, sizeof(length));
+    return true;
+  }
+
+  static void read_prefix(const char *ptr, uint64_t &header, uint64_t &count) {
+    std::memcpy(&header, ptr, sizeof(header));
+    if (is_extended(get_deadbeef(ptr))) {
+      uint32_t extended_count;
+      std::memcpy(&extended_count, ptr + COUNT_OFFSET, sizeof(extended_count));
+      count = extended_count;
+      return;
+    }
+    count = (header >> MESSAGE_COUNT_OFFSET) & MESSAGE_COUNT_MASK;
+    header = (((header >> SOURCE_NODE_ID_OFFSET) & SOURCE_NODE_ID_MASK)
+              << EXTENDED_SOURCE_NODE_ID_OFFSET) |
+             (((header >> DEST_NODE_ID_OFFSET) & DEST_NODE_ID_MASK)
+              << EXTENDED_DEST_NODE_ID_OFFSET) |
+             (((header >> WORKER_ID_OFFSET) & WORKER_ID_MASK)
+              << EXTENDED_WORKER_ID_OFFSET);
+  }
+
+  void write_compact_prefix(char *ptr, uint64_t length, uint32_t deadbeef) {
+    uint64_t header = (get_source_node_id() << SOURCE_NODE_ID_OFFSET) |
+                      (get_dest_node_id() << DEST_NODE_ID_OFFSET) |
+                      (get_worker_id() << WORKER_ID_OFFSET) |
+                      (get_message_count() << MESSAGE_COUNT_OFFSET) |
+                      (length << MESSAGE_LENGTH_OFFSET);
+    std::memcpy(ptr, &header, sizeof(header));
+    std::memcpy(ptr + sizeof(header), &deadbeef, sizeof(deadbeef));
   }
 
 private:
@@ -213,20 +462,94 @@ private:
     return *reinterpret_cast<uint32_t *>(&data[0] + sizeof(header_type));
   }
 
+  uint32_t &get_count_ref() {
+    return *reinterpret_cast<uint32_t *>(&data[0] + COUNT_OFFSET);
+  }
+
+  uint32_t &get_length_ref() {
+    return *reinterpret_cast<uint32_t *>(&data[0] + LENGTH_OFFSET);
+  }
+
+  uint64_t &get_last_piece_header_ref() {
+    return *reinterpret_cast<uint64_t *>(&data[0] + last_piece_offset);
+  }
+
 public:
   std::string data;
-  std::chrono::steady_clock::time_point time;
+  Clock::time_point time;
+
+private:
+  std::size_t last_piece_offset = 0;
+
+  // the pieces of a received message, see view_from()
+  ReceiveBuffer *view_buffer = nullptr;
+  const char *view_ptr = nullptr;
+  std::size_t view_size = 0;
 
 public:
   static constexpr uint32_t get_prefix_size() {
+    return sizeof(header_type) + sizeof(deadbeef_type) + 2 * sizeof(uint32_t);
+  }
+
+  static constexpr uint32_t get_compact_prefix_size() {
     return sizeof(header_type) + sizeof(deadbeef_type);
   }
 
-  static uint64_t get_message_length(uint64_t v) {
-    return (v >> MESSAGE_LENGTH_OFFSET) & MESSAGE_LENGTH_MASK;
+  /*
+   * The following read the prefix of a message on the wire, ptr has at least
+   * get_compact_prefix_size() bytes, and get_wire_prefix_size(ptr) for the
+   * length and the worker id.
+   */
+
+  static uint32_t get_deadbeef(const char *ptr) {
+    uint32_t deadbeef;
+    std::memcpy(&deadbeef, ptr + sizeof(header_type), sizeof(deadbeef));
+    return deadbeef;
+  }
+
+  static bool is_deadbeef(uint32_t deadbeef) {
+    return (deadbeef | COMPRESSED_BIT | EXTENDED_BIT | PACKED_BIT) == DEADBEEF;
+  }
+
+  static bool is_compressed(uint32_t deadbeef) {
+    return (deadbeef & COMPRESSED_BIT) == 0;
+  }
+
+  static bool is_packed(uint32_t deadbeef) {
+    return (deadbeef & PACKED_BIT) == 0;
+  }
+
+  static bool is_extended(uint32_t deadbeef) {
+    return (deadbeef & EXTENDED_BIT) == 0;
+  }
+
+  static std::size_t get_wire_prefix_size(const char *ptr) {
+    return is_extended(get_deadbeef(ptr)) ? get_prefix_size()
+                                          : get_compact_prefix_size();
+  }
+
+  static uint64_t get_wire_length(const char *ptr) {
+    uint64_t header;
+    std::memcpy(&header, ptr, sizeof(header));
+    if (is_extended(get_deadbeef(ptr))) {
+      uint32_t length;
+      std::memcpy(&length, ptr + LENGTH_OFFSET, sizeof(length));
+      return length;
+    }
+    return (header >> MESSAGE_LENGTH_OFFSET) & MESSAGE_LENGTH_MASK;
+  }
+
+  static uint64_t get_wire_worker_id(const char *ptr) {
+    uint64_t header;
+    std::memcpy(&header, ptr, sizeof(header));
+    if (is_extended(get_deadbeef(ptr))) {
+      return (header >> EXTENDED_WORKER_ID_OFFSET) & EXTENDED_ID_MASK;
+    }
+    return (header >> WORKER_ID_OFFSET) & WORKER_ID_MASK;
   }
 
 public:
+  // the compact header
   static constexpr uint64_t SOURCE_NODE_ID_MASK = 0x7f;
   static constexpr uint64_t SOURCE_NODE_ID_OFFSET = 57;
 
@@ -242,6 +565,20 @@ public:
   static constexpr uint64_t MESSAGE_LENGTH_MASK = 0x7ffffffull;
   static constexpr uint64_t MESSAGE_LENGTH_OFFSET = 0;
 
+  // the extended header
+  static constexpr uint64_t EXTENDED_ID_MASK = 0xffff;
+  static constexpr uint64_t EXTENDED_SOURCE_NODE_ID_OFFSET = 48;
+  static constexpr uint64_t EXTENDED_DEST_NODE_ID_OFFSET = 32;
+  static constexpr uint64_t EXTENDED_WORKER_ID_OFFSET = 16;
+
+  static constexpr std::size_t COUNT_OFFSET =
+      sizeof(header_type) + sizeof(deadbeef_type);
+  static constexpr std::size_t LENGTH_OFFSET = COUNT_OFFSET + sizeof(uint32_t);
+
   static constexpr uint32_t DEADBEEF = 0xDEADBEEF;
+  static constexpr uint32_t COMPRESSED_BIT = 1;
+  static constexpr uint32_t EXTENDED_BIT = 2;
+  static constexpr uint32_t PACKED_BIT = 4;
+  static constexpr uint32_t EXTENDED_DEADBEEF = DEADBEEF & ~EXTENDED_BIT;
 };
 } // namespace coco
\ No newline at end of file
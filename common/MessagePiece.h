@@ -11,10 +11,16 @@ namespace coco {
 /*
  * MessagePiece header format
  *
- * | Message type (12 => 4048) | Message length (31 => 2147483648) | table id (5
- * => 32) | partition id (16 => 65536) |
+ * | Message type (12 => 4048) | Message length (23 => 8388608) | coroutine id
+ * (8 => 256) | table id (5 => 32) | partition id (16 => 65536) |
  *
  * Note that, the header is included in the message length.
+ *
+ * A piece is tagged with the current coroutine id of the thread that
+ * constructs it. A worker that interleaves transactions as coroutines sets it
+ * to the coroutine that sends a request, or to the coroutine id of the request
+ * it replies to, so that a response reaches the transaction that waits for
+ * it. Threads that do not interleave always use 0.
  */
 
 class MessagePiece {
@@ -35,6 +41,10 @@ public:
     return (get_header() >> MESSAGE_LENGTH_OFFSET) & MESSAGE_LENGTH_MASK;
   }
 
+  uint64_t get_coroutine_id() const {
+    return (get_header() >> COROUTINE_ID_OFFSET) & COROUTINE_ID_MASK;
+  }
+
   uint64_t get_table_id() const {
     return (get_header() >> TABLE_ID_OFFSET) & TABLE_ID_MASK;
   }
@@ -72,12 +82,13 @@ public:
                                                  std::size_t table_id,
                                                  std::size_t partition_id) {
     DCHECK(message_type < (1ul << 12));
-    DCHECK(message_length < (1ul << 31));
+    DCHECK(message_length < (1ul << 23));
     DCHECK(table_id < (1ul << 5));
     DCHECK(partition_id < (1ul << 16));
 
     return (message_type << MESSAGE_TYPE_OFFSET) +
            (message_length << MESSAGE_LENGTH_OFFSET) +
+           (current_coroutine_id() << COROUTINE_ID_OFFSET) +
            (table_id << TABLE_ID_OFFSET) +
            (partition_id << PARTITION_ID_OFFSET);
   }
@@ -86,11 +97,31 @@ public:
     return (header >> MESSAGE_LENGTH_OFFSET) & MESSAGE_LENGTH_MASK;
   }
 
+  // whether two headers only differ in the message length
+  static bool is_same_piece(uint64_t header, uint64_t that) {
+    uint64_t length_bits = MESSAGE_LENGTH_MASK << MESSAGE_LENGTH_OFFSET;
+    return ((header ^ that) & ~length_bits) == 0;
+  }
+
+  static uint64_t set_message_length(uint64_t header,
+                                     uint64_t message_length) {
+    DCHECK(message_length < (1ul << 23));
+    return (header & ~(MESSAGE_LENGTH_MASK << MESSAGE_LENGTH_OFFSET)) |
+           (message_length << MESSAGE_LENGTH_OFFSET);
+  }
+
+  static uint64_t &current_coroutine_id() {
+    static thread_local uint64_t coroutine_id = 0;
+    return coroutine_id;
+  }
+
 public:
   static constexpr uint64_t MESSAGE_TYPE_MASK = 0xfff;
   static constexpr uint64_t MESSAGE_TYPE_OFFSET = 52;
-  static constexpr uint64_t MESSAGE_LENGTH_MASK = 0x7fffffff;
-  static constexpr uint64_t MESSAGE_LENGTH_OFFSET = 21;
+  static constexpr uint64_t MESSAGE_LENGTH_MASK = 0x7fffff;
+  static constexpr uint64_t MESSAGE_LENGTH_OFFSET = 29;
+  static constexpr uint64_t COROUTINE_ID_MASK = 0xff;
+  static constexpr uint64_t COROUTINE_ID_OFFSET = 21;
   static constexpr uint64_t TABLE_ID_MASK = 0x1f;
   static constexpr uint64_t TABLE_ID_OFFSET = 16;
   static constexpr uint64_t PARTITION_ID_MASK = 0xffff;
@@ -0,0 +1,68 @@
+//
+// Created by Yi Lu on 8/29/18.
+//
+
+#pragma once
+
+#include "common/LockfreeQueue.h"
+#include "common/Message.h"
+#include <glog/logging.h>
+
+namespace coco {
+
+/*
+ * A pool of recycled Message objects.
+ *
+ * A pool connects exactly two threads: one thread returns messages it is done
+ * with by calling put(), and the other thread calls get() to obtain a cleared
+ * message instead of allocating a new one. Recycled messages keep the capacity
+ * of their buffer; messages with an oversized buffer, or returned while the
+ * pool is full, are freed. A received message releases the buffer it views,
+ * if any, when it is returned.
+ */
+
+class MessagePool {
+public:
+  MessagePool() = default;
+
+  MessagePool(const MessagePool &) = delete;
+  MessagePool &operator=(const MessagePool &) = delete;
+
+  ~MessagePool() {
+    while (!queue.empty()) {
+      delete queue.front();
+      queue.pop();
+    }
+  }
+
+  Message *get() {
+    if (!queue.empty()) {
+      Message *message = queue.front();
+      bool ok = queue.pop();
+      CHECK(ok);
+      message->clear();
+      return message;
+    }
+    auto message = new Message();
+    message->data.reserve(RESERVED_SIZE);
+    return message;
+  }
+
+  void put(Message *message) {
+    DCHECK(message != nullptr);
+    // the receive buffer a message views is released right away
+    message->drop_view();
+    if (message->data.capacity() > MAX_RECYCLED_SIZE ||
+        !queue.try_push(message)) {
+      delete message;
+    }
+  }
+
+public:
+  static constexpr std::size_t RESERVED_SIZE = 4096;
+  static constexpr std::size_t MAX_RECYCLED_SIZE = 1024 * 1024;
+
+private:
+  LockfreeQueue<Message *> queue;
+};
+} // namespace coco
@@ -0,0 +1,81 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * NumaTopology lists the cpus of each NUMA node, as reported in
+ * /sys/devices/system/node/node<i>/cpulist. On a machine without NUMA (or on
+ * macOS) there is a single node with all cpus.
+ */
+
+class NumaTopology {
+public:
+  NumaTopology() {
+#ifndef __APPLE__
+    for (auto node = 0;; node++) {
+      std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                       "/cpulist");
+      if (!in.is_open()) {
+        break;
+      }
+      std::string cpulist;
+      std::getline(in, cpulist);
+      node_cpus.push_back(parse_cpulist(cpulist));
+    }
+#endif
+    if (node_cpus.empty()) {
+      node_cpus.resize(1);
+      for (auto i = 0u; i < std::thread::hardware_concurrency(); i++) {
+        node_cpus[0].push_back(i);
+      }
+    }
+  }
+
+  explicit NumaTopology(std::vector<std::vector<int>> node_cpus)
+      : node_cpus(std::move(node_cpus)) {}
+
+  std::size_t node_num() const { return node_cpus.size(); }
+
+  const std::vector<int> &cpus(std::size_t node) const {
+    return node_cpus[node];
+  }
+
+  // parses a cpu list like "0-3,8,10-11"
+  static std::vector<int> parse_cpulist(const std::string &cpulist) {
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+    while (pos < cpulist.size()) {
+      auto end = cpulist.find(',', pos);
+      if (end == std::string::npos) {
+        end = cpulist.size();
+      }
+      auto range = cpulist.substr(pos, end - pos);
+      auto dash = range.find('-');
+      if (range.find_first_not_of(" \n") != std::string::npos) {
+        int first = std::stoi(range.substr(0, dash));
+        int last = first;
+        if (dash != std::string::npos) {
+          last = std::stoi(range.substr(dash + 1));
+        }
+        for (auto cpu = first; cpu <= last; cpu++) {
+          cpus.push_back(cpu);
+        }
+      }
+      pos = end + 1;
+    }
+    return cpus;
+  }
+
+private:
+  std::vector<std::vector<int>> node_cpus;
+};
+} // namespace coco
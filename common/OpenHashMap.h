@@ -0,0 +1,582 @@
+//
+// Created by Yi Lu on 7/14/18.
+//
+
+#pragma once
+
+#include "Arena.h"
+#include "SpinLock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <glog/logging.h>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Open Addressing Hash Map -- overview --
+ *
+ *  The key space is split into N buckets, each of which is an open addressing
+ *  (linear probing) table of pointers to rows. A row holds the key and the
+ *  value side by side, and rows are carved out of per-bucket chunks that are
+ *  never moved or freed until clear(), so references returned by operator[]
+ *  stay valid for the lifetime of the map. The chunks of all buckets come
+ *  from the Arena of the map, i.e., from huge pages once the map is large.
+ *
+ *  Lookups do not take the bucket lock. Slots are published with release
+ *  stores after the row is fully constructed, and a grown slot array is
+ *  swapped in atomically while the old one is retired (kept alive) until
+ *  clear(). Inserts, removes and growth are serialized by the bucket lock.
+ *
+ *  A bucket grows incrementally, so that an insert never rehashes a whole
+ *  bucket under its lock. The grown slot array is swapped in empty, and each
+ *  insert then moves MIGRATE_STEP slots of the old array into it, see
+ *  Bucket::migrate, until the old array is done and dropped. Meanwhile a
+ *  lookup probes the new array and then the old one, a row stays in the old
+ *  array once it is moved, and remove() leaves a tombstone in both.
+ *
+ *  remove() leaves a tombstone in the slot array; the row memory is reclaimed
+ *  by clear() only, since concurrent readers may still hold a reference.
+ */
+
+template <std::size_t N, class KeyType, class ValueType> class OpenHashMap {
+public:
+  using HasherType = std::hash<KeyType>;
+
+  OpenHashMap() = default;
+
+  OpenHashMap(const OpenHashMap &) = delete;
+  OpenHashMap &operator=(const OpenHashMap &) = delete;
+
+  bool remove(const KeyType &key) {
+    std::size_t hash = hasher(key);
+    Bucket &bucket = buckets[bucket_number(hash)];
+    bucket.lock.lock();
+    bool removed = false;
+    if (remove_locked(bucket.slots.load(std::memory_order_relaxed), key,
+                      hash)) {
+      bucket.n_tombstones++;
+      removed = true;
+    }
+    // a row that is already moved is in both arrays
+    if (remove_locked(bucket.old.load(std::memory_order_relaxed), key, hash)) {
+      removed = true;
+    }
+    if (removed) {
+      bucket.n_rows--;
+    }
+    bucket.lock.unlock();
+    return removed;
+  }
+
+  bool contains(const KeyType &key) const {
+    std::size_t hash = hasher(key);
+    return find(buckets[bucket_number(hash)], key, hash) != nullptr;
+  }
+
+  bool insert(const KeyType &key, const ValueType &value) {
+    std::size_t hash = hasher(key);
+    Bucket &bucket = buckets[bucket_number(hash)];
+    bucket.lock.lock();
+    bool inserted = false;
+    if (find(bucket, key, hash) == nullptr) {
+      Row *row = insert_locked(bucket, key, hash, [&value](Row &row) {
+        row.value = value;
+      });
+      inserted = row != nullptr;
+    }
+    bucket.lock.unlock();
+    return inserted;
+  }
+
+  ValueType &operator[](const KeyType &key) {
+    return find_or_insert(key, hasher(key), [](ValueType &) {});
+  }
+
+  // the same as operator[], but a missing key is inserted with init(value)
+  // before it is visible to others
+  template <class InitFunc>
+  ValueType &find_or_init(const KeyType &key, InitFunc init) {
+    return find_or_insert(key, hasher(key), init);
+  }
+
+  /*
+   * One step of a lookup of key, see find_batch: level 0 prefetches the
+   * bucket, level 1 the slot and level 2 the row. A level reads the lines
+   * the level before prefetched, so the levels of a key are issued some
+   * time apart, e.g., a few keys later.
+   */
+  void prefetch(const KeyType &key, std::size_t level) {
+    std::size_t hash = hasher(key);
+    Bucket &bucket = buckets[bucket_number(hash)];
+    if (level == 0) {
+      __builtin_prefetch(&bucket);
+      return;
+    }
+    Slots *slots = bucket.slots.load(std::memory_order_acquire);
+    if (slots == nullptr) {
+      return;
+    }
+    auto &entry = slots->entries[probe_start(hash) & slots->mask];
+    if (level == 1) {
+      __builtin_prefetch(&entry);
+      return;
+    }
+    Row *row = entry.load(std::memory_order_relaxed);
+    if (row != nullptr && row != tombstone()) {
+      __builtin_prefetch(row);
+    }
+  }
+
+  // the value of key, or nullptr if key is missing
+  ValueType *lookup(const KeyType &key) {
+    std::size_t hash = hasher(key);
+    Row *row = find(buckets[bucket_number(hash)], key, hash);
+    return row == nullptr ? nullptr : &row->value;
+  }
+
+  /*
+   * Looks up n keys at once and calls func(i, value) with the value of
+   * *keys[i], inserting missing keys as find_or_init does.
+   *
+   * A lookup is a chain of dependent loads: the bucket, its slot array, the
+   * slot and the row. Instead of walking the chain key by key, each step is
+   * prefetched for all keys of a batch before the next one, so that the cache
+   * misses of different keys overlap.
+   */
+  template <class Func>
+  void find_batch(const KeyType *const *keys, std::size_t n, Func func) {
+    find_batch(keys, n, func, [](ValueType &) {});
+  }
+
+  template <class Func, class InitFunc>
+  void find_batch(const KeyType *const *keys, std::size_t n, Func func,
+                  InitFunc init) {
+    std::size_t hashes[BATCH_SIZE];
+    Slots *slots[BATCH_SIZE];
+    for (std::size_t begin = 0; begin < n; begin += BATCH_SIZE) {
+      std::size_t m = std::min(n - begin, BATCH_SIZE);
+      for (auto i = 0u; i < m; i++) {
+        hashes[i] = hasher(*keys[begin + i]);
+        __builtin_prefetch(&buckets[bucket_number(hashes[i])]);
+      }
+      for (auto i = 0u; i < m; i++) {
+        slots[i] = buckets[bucket_number(hashes[i])].slots.load(
+            std::memory_order_acquire);
+        if (slots[i] != nullptr) {
+          __builtin_prefetch(slots[i]);
+        }
+      }
+      for (auto i = 0u; i < m; i++) {
+        if (slots[i] != nullptr) {
+          __builtin_prefetch(
+              &slots[i]->entries[probe_start(hashes[i]) & slots[i]->mask]);
+        }
+      }
+      for (auto i = 0u; i < m; i++) {
+        if (slots[i] != nullptr) {
+          Row *row = slots[i]
+                         ->entries[probe_start(hashes[i]) & slots[i]->mask]
+                         .load(std::memory_order_relaxed);
+          if (row != nullptr && row != tombstone()) {
+            __builtin_prefetch(row);
+          }
+        }
+      }
+      for (auto i = 0u; i < m; i++) {
+        func(begin + i, find_or_insert(*keys[begin + i], hashes[i], init));
+      }
+    }
+  }
+
+  std::size_t size() {
+    std::size_t totalSize = 0;
+    for (auto i = 0u; i < N; i++) {
+      buckets[i].lock.lock();
+      totalSize += buckets[i].n_rows;
+      buckets[i].lock.unlock();
+    }
+    return totalSize;
+  }
+
+  // lock-free, rows inserted or removed concurrently may or may not be visited.
+  // A bucket that is growing is migrated first, so that no row is visited
+  // twice.
+  template <class Func> void for_each(Func func) {
+    for (auto i = 0u; i < N; i++) {
+      if (buckets[i].old.load(std::memory_order_acquire) != nullptr) {
+        buckets[i].lock.lock();
+        buckets[i].finish_migration();
+        buckets[i].lock.unlock();
+      }
+      Slots *slots = buckets[i].slots.load(std::memory_order_acquire);
+      if (slots == nullptr) {
+        continue;
+      }
+      for (auto j = 0u; j < slots->capacity(); j++) {
+        Row *row = slots->entries[j].load(std::memory_order_acquire);
+        if (row != nullptr && row != tombstone()) {
+          func(row->key, row->value);
+        }
+      }
+    }
+  }
+
+  // not safe to call with concurrent readers, all references are invalidated.
+  void clear() {
+    for (auto i = 0u; i < N; i++) {
+      buckets[i].lock.lock();
+      buckets[i].reset();
+      buckets[i].lock.unlock();
+    }
+    arena.clear();
+  }
+
+  // pre-size the map for n rows in total, assuming keys hash evenly.
+  void reserve(std::size_t n) {
+    std::size_t rows_per_bucket = (n + N - 1) / N;
+    for (auto i = 0u; i < N; i++) {
+      buckets[i].lock.lock();
+      buckets[i].reserve(arena, rows_per_bucket);
+      buckets[i].lock.unlock();
+    }
+  }
+
+  // bytes of the rows and the slot arrays
+  std::size_t memory_size() {
+    std::size_t size = arena.mapped();
+    for (auto i = 0u; i < N; i++) {
+      buckets[i].lock.lock();
+      for (auto &slots : buckets[i].retired) {
+        size += slots->capacity() * sizeof(std::atomic<Row *>);
+      }
+      buckets[i].lock.unlock();
+    }
+    return size;
+  }
+
+  // bytes of the rows on explicit huge pages, see Arena
+  std::size_t huge_page_size() const { return arena.huge_pages(); }
+
+private:
+  static constexpr std::size_t INITIAL_CAPACITY = 16;
+  // slots of the old array an insert moves while a bucket grows
+  static constexpr std::size_t MIGRATE_STEP = 16;
+  // keys looked up together by find_batch
+  static constexpr std::size_t BATCH_SIZE = 16;
+
+  struct Row {
+    KeyType key;
+    ValueType value;
+  };
+
+  struct Slots {
+    explicit Slots(std::size_t capacity)
+        : mask(capacity - 1), entries(new std::atomic<Row *>[capacity]) {
+      DCHECK((capacity & mask) == 0) << "capacity must be a power of two.";
+      for (auto i = 0u; i < capacity; i++) {
+        entries[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+    std::size_t mask;
+    std::unique_ptr<std::atomic<Row *>[]> entries;
+  };
+
+  struct alignas(64) Bucket {
+
+    ~Bucket() { reset(); }
+
+    // lock must be held
+    Row *allocate_row(Arena &arena) {
+      if (chunks.empty() || chunk_used == chunk_size) {
+        add_chunk(arena, std::min(std::max(chunk_size * 2, INITIAL_CAPACITY),
+                                  MAX_CHUNK_SIZE));
+      }
+      return &chunks.back()[chunk_used++];
+    }
+
+    // lock must be held
+    void add_chunk(Arena &arena, std::size_t size) {
+      Row *rows = static_cast<Row *>(
+          arena.allocate(size * sizeof(Row), alignof(Row)));
+      for (auto i = 0u; i < size; i++) {
+        new (&rows[i]) Row;
+      }
+      chunks.push_back(rows);
+      chunk_sizes.push_back(size);
+      chunk_size = size;
+      chunk_used = 0;
+    }
+
+    // lock must be held
+    void reserve(Arena &arena, std::size_t n) {
+      if (n <= n_rows) {
+        return;
+      }
+      std::size_t available =
+          chunks.empty() ? 0 : chunk_size - chunk_used;
+      if (n - n_rows > available) {
+        add_chunk(arena, n - n_rows);
+      }
+      Slots *current = slots.load(std::memory_order_relaxed);
+      std::size_t capacity = capacity_for(n + n_tombstones);
+      if (current == nullptr || capacity > current->capacity()) {
+        rehash(capacity);
+      }
+    }
+
+    // lock must be held
+    void rehash(std::size_t capacity) {
+      finish_migration();
+      Slots *current = slots.load(std::memory_order_relaxed);
+      auto next = std::make_unique<Slots>(capacity);
+      if (current != nullptr) {
+        for (auto i = 0u; i < current->capacity(); i++) {
+          place(current->entries[i].load(std::memory_order_relaxed), *next);
+        }
+      }
+      n_tombstones = 0;
+      // readers may still be probing the old array
+      slots.store(next.get(), std::memory_order_release);
+      retired.push_back(std::move(next));
+    }
+
+    // lock must be held, the rows are moved by later inserts, see migrate
+    void grow(std::size_t capacity) {
+      finish_migration();
+      Slots *current = slots.load(std::memory_order_relaxed);
+      if (current == nullptr) {
+        rehash(capacity);
+        return;
+      }
+      auto next = std::make_unique<Slots>(capacity);
+      n_tombstones = 0;
+      migrated = 0;
+      // the old array is published before the new one, see find
+      old.store(current, std::memory_order_release);
+      slots.store(next.get(), std::memory_order_release);
+      retired.push_back(std::move(next));
+    }
+
+    // lock must be held, moves up to n slots of the old array
+    void migrate(std::size_t n) {
+      Slots *from = old.load(std::memory_order_relaxed);
+      if (from == nullptr) {
+        return;
+      }
+      Slots &to = *slots.load(std::memory_order_relaxed);
+      for (; n > 0 && migrated < from->capacity(); n--, migrated++) {
+        place(from->entries[migrated].load(std::memory_order_relaxed), to);
+      }
+      if (migrated == from->capacity()) {
+        // the moved rows are visible to those that see the old array gone
+        old.store(nullptr, std::memory_order_release);
+      }
+    }
+
+    // lock must be held
+    void finish_migration() {
+      Slots *from = old.load(std::memory_order_relaxed);
+      if (from != nullptr) {
+        migrate(from->capacity());
+      }
+    }
+
+    // lock must be held, the row is absent from to
+    static void place(Row *row, Slots &to) {
+      if (row == nullptr || row == tombstone()) {
+        return;
+      }
+      auto j = probe_start(HasherType()(row->key)) & to.mask;
+      while (to.entries[j].load(std::memory_order_relaxed) != nullptr) {
+        j = (j + 1) & to.mask;
+      }
+      to.entries[j].store(row, std::memory_order_release);
+    }
+
+    // lock must be held, the memory of the rows goes with the arena
+    void reset() {
+      slots.store(nullptr, std::memory_order_relaxed);
+      old.store(nullptr, std::memory_order_relaxed);
+      migrated = 0;
+      retired.clear();
+      if (!std::is_trivially_destructible<Row>::value) {
+        for (auto i = 0u; i < chunks.size(); i++) {
+          for (auto j = 0u; j < chunk_sizes[i]; j++) {
+            chunks[i][j].~Row();
+          }
+        }
+      }
+      chunks.clear();
+      chunk_sizes.clear();
+      chunk_size = 0;
+      chunk_used = 0;
+      n_rows = 0;
+      n_tombstones = 0;
+    }
+
+    SpinLock lock;
+    std::atomic<Slots *> slots{nullptr};
+    // the array the rows are moved from while the bucket grows
+    std::atomic<Slots *> old{nullptr};
+    // the slots of the old array moved so far
+    std::size_t migrated = 0;
+    std::size_t n_rows = 0;
+    std::size_t n_tombstones = 0;
+    // the live slot array is the last one, previous ones are retired
+    std::vector<std::unique_ptr<Slots>> retired;
+    std::vector<Row *> chunks;
+    std::vector<std::size_t> chunk_sizes;
+    std::size_t chunk_size = 0;
+    std::size_t chunk_used = 0;
+  };
+
+  static constexpr std::size_t MAX_CHUNK_SIZE = 4096;
+
+  static Row *tombstone() {
+    return reinterpret_cast<Row *>(static_cast<uintptr_t>(1));
+  }
+
+  // keep the load factor below 1/2, counting tombstones.
+  static std::size_t capacity_for(std::size_t n) {
+    std::size_t capacity = INITIAL_CAPACITY;
+    while (capacity < 2 * n) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  // std::hash is the identity on integers, mix the bits before probing.
+  static std::size_t probe_start(std::size_t hash) {
+    uint64_t h = hash / N;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // the new array is loaded before the old one, so that a row is in either
+  // of them, unless it is inserted or removed concurrently.
+  Row *find(const Bucket &bucket, const KeyType &key, std::size_t hash) const {
+    Slots *slots = bucket.slots.load(std::memory_order_acquire);
+    Slots *old = bucket.old.load(std::memory_order_acquire);
+    Row *row = find(slots, key, hash);
+    if (row == nullptr && old != nullptr) {
+      row = find(old, key, hash);
+    }
+    return row;
+  }
+
+  static Row *find(Slots *slots, const KeyType &key, std::size_t hash) {
+    if (slots == nullptr) {
+      return nullptr;
+    }
+    for (auto i = probe_start(hash) & slots->mask;; i = (i + 1) & slots->mask) {
+      Row *row = slots->entries[i].load(std::memory_order_acquire);
+      if (row == nullptr) {
+        return nullptr;
+      }
+      if (row != tombstone() && row->key == key) {
+        return row;
+      }
+    }
+  }
+
+  // lock must be held, leaves a tombstone in the slot of key
+  static bool remove_locked(Slots *slots, const KeyType &key,
+                            std::size_t hash) {
+    if (slots == nullptr) {
+      return false;
+    }
+    for (auto i = probe_start(hash) & slots->mask;; i = (i + 1) & slots->mask) {
+      Row *row = slots->entries[i].load(std::memory_order_relaxed);
+      if (row == nullptr) {
+        return false;
+      }
+      if (row != tombstone() && row->key == key) {
+        slots->entries[i].store(tombstone(), std::memory_order_release);
+        return true;
+      }
+    }
+  }
+
+  template <class InitFunc>
+  ValueType &find_or_insert(const KeyType &key, std::size_t hash,
+                            InitFunc init) {
+    Bucket &bucket = buckets[bucket_number(hash)];
+    Row *row = find(bucket, key, hash);
+    if (row != nullptr) {
+      return row->value;
+    }
+    bucket.lock.lock();
+    row = find(bucket, key, hash);
+    if (row == nullptr) {
+      row = insert_locked(bucket, key, hash,
+                          [&init](Row &row) { init(row.value); });
+    }
+    bucket.lock.unlock();
+    return row->value;
+  }
+
+  // lock must be held and key must be absent
+  template <class InitFunc>
+  Row *insert_locked(Bucket &bucket, const KeyType &key, std::size_t hash,
+                     InitFunc initFunc) {
+    Slots *slots = bucket.slots.load(std::memory_order_relaxed);
+    if (slots == nullptr ||
+        2 * (bucket.n_rows + bucket.n_tombstones + 1) > slots->capacity()) {
+      bucket.grow(capacity_for(bucket.n_rows + 1));
+      slots = bucket.slots.load(std::memory_order_relaxed);
+    }
+    bucket.migrate(MIGRATE_STEP);
+
+    auto i = probe_start(hash) & slots->mask;
+    for (;; i = (i + 1) & slots->mask) {
+      Row *row = slots->entries[i].load(std::memory_order_relaxed);
+      if (row == nullptr) {
+        break;
+      }
+      if (row == tombstone()) {
+        bucket.n_tombstones--;
+        break;
+      }
+    }
+
+    Row *row = bucket.allocate_row(arena);
+    row->key = key;
+    initFunc(*row);
+    slots->entries[i].store(row, std::memory_order_release);
+    bucket.n_rows++;
+    return row;
+  }
+
+  auto bucket_number(std::size_t hash) const { return hash % N; }
+
+private:
+  HasherType hasher;
+  // declared before the buckets, so that it outlives their rows
+  Arena arena;
+  Bucket buckets[N];
+};
+
+template <std::size_t N, class KeyType, class ValueType>
+constexpr std::size_t OpenHashMap<N, KeyType, ValueType>::INITIAL_CAPACITY;
+
+template <std::size_t N, class KeyType, class ValueType>
+constexpr std::size_t OpenHashMap<N, KeyType, ValueType>::MIGRATE_STEP;
+
+template <std::size_t N, class KeyType, class ValueType>
+constexpr std::size_t OpenHashMap<N, KeyType, ValueType>::MAX_CHUNK_SIZE;
+
+template <std::size_t N, class KeyType, class ValueType>
+constexpr std::size_t OpenHashMap<N, KeyType, ValueType>::BATCH_SIZE;
+
+} // namespace coco
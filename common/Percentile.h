@@ -8,6 +8,7 @@
 #include <cmath>
 #include <fstream>
 #include <glog/logging.h>
+#include <vector>
 
 // The nearest-rank method
 // https://en.wikipedia.org/wiki/Percentile
@@ -0,0 +1,123 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <glog/logging.h>
+#include <linux/perf_event.h>
+#include <memory>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+
+namespace coco {
+
+enum class PerfEvent {
+  CYCLES,
+  INSTRUCTIONS,
+  LLC_MISSES,
+  DTLB_MISSES,
+  NFIELDS
+};
+
+static constexpr std::size_t N_PERF_EVENTS =
+    static_cast<std::size_t>(PerfEvent::NFIELDS);
+
+/*
+ * PerfCounters counts the cycles, instructions, last level cache misses and
+ * data TLB misses of the calling thread in user space with perf_event_open,
+ * as one group, so that the counters are scheduled together and read with a
+ * single read(). A thread opens its counters with open_thread_counters(), and
+ * PhaseTimer charges them to the phases of its transactions. If the kernel
+ * does not allow it, e.g., perf_event_paranoid is 3, the counters are not
+ * opened and read as 0.
+ */
+
+class PerfCounters {
+public:
+  PerfCounters() {
+    static const std::pair<uint32_t, uint64_t> events[N_PERF_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                                 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}};
+
+    for (auto i = 0u; i < N_PERF_EVENTS; i++) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = events[i].first;
+      attr.config = events[i].second;
+      attr.disabled = i == 0;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1,
+                       i == 0 ? -1 : fds[0], 0);
+      if (fds[i] < 0) {
+        LOG(WARNING) << "failed to open hardware counter " << i
+                     << ", errno: " << errno;
+        close_all();
+        return;
+      }
+    }
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  ~PerfCounters() { close_all(); }
+
+  bool is_open() const { return fds[0] >= 0; }
+
+  // the counts since the counters are opened, 0 if they are not
+  void read(uint64_t values[N_PERF_EVENTS]) const {
+    // the structure of a group read: (# of events, values)
+    uint64_t buffer[1 + N_PERF_EVENTS];
+    if (!is_open() ||
+        ::read(fds[0], buffer, sizeof(buffer)) != sizeof(buffer)) {
+      std::memset(values, 0, sizeof(uint64_t) * N_PERF_EVENTS);
+      return;
+    }
+    DCHECK(buffer[0] == N_PERF_EVENTS);
+    std::memcpy(values, buffer + 1, sizeof(uint64_t) * N_PERF_EVENTS);
+  }
+
+  // the counters of the calling thread, nullptr if it has none
+  static PerfCounters *thread_counters() { return thread_ptr().get(); }
+
+  static void open_thread_counters() {
+    auto &counters = thread_ptr();
+    if (counters == nullptr) {
+      counters = std::make_unique<PerfCounters>();
+    }
+  }
+
+private:
+  static std::unique_ptr<PerfCounters> &thread_ptr() {
+    thread_local std::unique_ptr<PerfCounters> counters;
+    return counters;
+  }
+
+  void close_all() {
+    for (auto i = 0u; i < N_PERF_EVENTS; i++) {
+      if (fds[i] >= 0) {
+        close(fds[i]);
+        fds[i] = -1;
+      }
+    }
+  }
+
+private:
+  int fds[N_PERF_EVENTS] = {-1, -1, -1, -1};
+};
+} // namespace coco
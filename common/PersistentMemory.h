@@ -0,0 +1,158 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace coco {
+
+/*
+ * PersistentMemory maps a file on a DAX file system, e.g., persistent memory
+ * or a CXL memory region, so that loads and stores reach the media without
+ * the page cache. With MAP_SYNC, a store is durable once its cache lines are
+ * written back with flush() and ordered with fence(). On a file system
+ * without DAX, the mapping is a shared mapping of the page cache, and the
+ * region is durable once it is synced, i.e., at sync() or when it is closed.
+ *
+ * The file keeps its contents between runs, which is the point of it.
+ */
+
+class PersistentMemory {
+public:
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  explicit PersistentMemory(const std::string &filename) : filename(filename) {
+    fd = open(filename.c_str(), O_RDWR | O_CREAT,
+              S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+    CHECK(fd >= 0) << "failed to open " << filename << ", errno: " << errno;
+    struct stat st;
+    CHECK(fstat(fd, &st) == 0) << "failed to stat " << filename;
+    if (st.st_size > 0) {
+      map(st.st_size);
+    }
+  }
+
+  PersistentMemory(const PersistentMemory &) = delete;
+  PersistentMemory &operator=(const PersistentMemory &) = delete;
+
+  ~PersistentMemory() {
+    unmap();
+    ::close(fd);
+  }
+
+  // the contents of the file, nullptr if it is empty
+  char *data() const { return data_; }
+
+  std::size_t size() const { return size_; }
+
+  bool dax() const { return dax_; }
+
+  // drops the contents, the region is size zero bytes from now on
+  void reset(std::size_t size) {
+    unmap();
+    CHECK(ftruncate(fd, 0) == 0 && ftruncate(fd, size) == 0)
+        << "failed to resize " << filename << ", errno: " << errno;
+    map(size);
+  }
+
+  // writes the region back to the file, not needed with DAX
+  void sync() {
+    if (data_ != nullptr && !dax_) {
+      msync(data_, size_, MS_SYNC);
+    }
+  }
+
+  // writes the cache lines of [p, p + n) back to memory, without waiting
+  static void flush(const void *p, std::size_t n) {
+#if defined(__x86_64__) || defined(__i386__)
+    static const int instruction = flush_instruction();
+    auto line = reinterpret_cast<uintptr_t>(p) & ~(CACHE_LINE_SIZE - 1);
+    auto end = reinterpret_cast<uintptr_t>(p) + n;
+    for (; line < end; line += CACHE_LINE_SIZE) {
+      auto addr = reinterpret_cast<char *>(line);
+      if (instruction == CLWB) {
+        __asm volatile("clwb %0" : "+m"(*addr));
+      } else if (instruction == CLFLUSHOPT) {
+        __asm volatile("clflushopt %0" : "+m"(*addr));
+      } else {
+        __asm volatile("clflush %0" : "+m"(*addr));
+      }
+    }
+#endif
+  }
+
+  // the flushes of this thread are done before the stores after it
+  static void fence() {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm volatile("sfence" : : : "memory");
+#else
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+  }
+
+private:
+  enum { CLFLUSH, CLFLUSHOPT, CLWB };
+
+#if defined(__x86_64__) || defined(__i386__)
+  // clwb keeps the line in the cache, clflushopt and clflush evict it
+  static int flush_instruction() {
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+      if (ebx & (1u << 24)) {
+        return CLWB;
+      }
+      if (ebx & (1u << 23)) {
+        return CLFLUSHOPT;
+      }
+    }
+    return CLFLUSH;
+  }
+#endif
+
+  void map(std::size_t size) {
+    void *p = MAP_FAILED;
+#ifdef MAP_SYNC
+    p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+             MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+#endif
+    dax_ = p != MAP_FAILED;
+    if (!dax_) {
+      p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    CHECK(p != MAP_FAILED)
+        << "failed to map " << filename << ", errno: " << errno;
+    data_ = static_cast<char *>(p);
+    size_ = size;
+  }
+
+  void unmap() {
+    if (data_ != nullptr) {
+      sync();
+      munmap(data_, size_);
+      data_ = nullptr;
+      size_ = 0;
+    }
+  }
+
+private:
+  std::string filename;
+  int fd;
+  char *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool dax_ = false;
+};
+} // namespace coco
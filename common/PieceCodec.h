@@ -0,0 +1,242 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/MessagePiece.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace coco {
+
+/*
+ * A codec of the message pieces of a message, see --pack_messages. Each
+ * piece is
+ *
+ * | tag (varint) | type | coroutine id | table id | partition id | body |
+ *
+ * where tag is (body length << 2 | delta bit << 1 | run bit), and the ids
+ * are varints left out if the run bit is set, i.e., the piece has the same
+ * header as the piece before it but for the length. With the delta bit set,
+ * the body is a sequence of zigzag varints, the difference of each 32-bit
+ * word to the word at the same offset in the piece before it if it has the
+ * same type, e.g., the keys and the tids of lock, validation and replication
+ * requests, and then the last length % 4 bytes as they are. Otherwise, the
+ * body is as it is, when the deltas would not make it any smaller.
+ */
+
+class PieceCodec {
+public:
+  // appends the packed pieces of size bytes at src to dest
+  static void pack(const char *src, std::size_t size, std::string &dest) {
+    const char *end = src + size, *last = nullptr;
+    uint64_t last_header = 0;
+    std::string deltas;
+
+    while (src < end) {
+      uint64_t header;
+      std::memcpy(&header, src, sizeof(header));
+      std::size_t length = MessagePiece::get_message_length(header) -
+                           MessagePiece::get_header_size();
+      const char *body = src + MessagePiece::get_header_size();
+
+      bool run =
+          last != nullptr && MessagePiece::is_same_piece(last_header, header);
+      std::size_t ref_length;
+      const char *ref = reference_of(last, last_header, header, ref_length);
+
+      deltas.clear();
+      write_deltas(deltas, body, length, ref, ref_length);
+      bool delta = deltas.size() < length;
+
+      write_varint(dest, (length << 2) | (delta << 1) | run);
+      if (!run) {
+        write_varint(dest, type_of(header));
+        write_varint(dest, field_of(header, MessagePiece::COROUTINE_ID_OFFSET,
+                                    MessagePiece::COROUTINE_ID_MASK));
+        write_varint(dest, field_of(header, MessagePiece::TABLE_ID_OFFSET,
+                                    MessagePiece::TABLE_ID_MASK));
+        write_varint(dest, field_of(header, MessagePiece::PARTITION_ID_OFFSET,
+                                    MessagePiece::PARTITION_ID_MASK));
+      }
+      if (delta) {
+        dest += deltas;
+      } else {
+        dest.append(body, length);
+      }
+
+      last = body;
+      last_header = header;
+      src = body + length;
+    }
+  }
+
+  // unpacks size bytes at src into dest, returns false unless they are well
+  // formed and unpack to exactly raw_size bytes
+  static bool unpack(const char *src, std::size_t size, char *dest,
+                     std::size_t raw_size) {
+    const uint8_t *ip = reinterpret_cast<const uint8_t *>(src);
+    const uint8_t *end = ip + size;
+    char *op = dest, *op_end = dest + raw_size, *last = nullptr;
+    uint64_t last_header = 0;
+
+    while (ip < end) {
+      uint64_t tag, header;
+      if (!read_varint(ip, end, tag)) {
+        return false;
+      }
+      uint64_t length = tag >> 2;
+      bool delta = tag & 2, run = tag & 1;
+      if (length + MessagePiece::get_header_size() >
+              MessagePiece::MESSAGE_LENGTH_MASK ||
+          length + MessagePiece::get_header_size() >
+              static_cast<std::size_t>(op_end - op)) {
+        return false;
+      }
+
+      if (run) {
+        if (last == nullptr) {
+          return false;
+        }
+        header = last_header;
+      } else {
+        uint64_t type, coroutine_id, table_id, partition_id;
+        if (!read_varint(ip, end, type) ||
+            !read_varint(ip, end, coroutine_id) ||
+            !read_varint(ip, end, table_id) ||
+            !read_varint(ip, end, partition_id) ||
+            type > MessagePiece::MESSAGE_TYPE_MASK ||
+            coroutine_id > MessagePiece::COROUTINE_ID_MASK ||
+            table_id > MessagePiece::TABLE_ID_MASK ||
+            partition_id > MessagePiece::PARTITION_ID_MASK) {
+          return false;
+        }
+        header = (type << MessagePiece::MESSAGE_TYPE_OFFSET) |
+                 (coroutine_id << MessagePiece::COROUTINE_ID_OFFSET) |
+                 (table_id << MessagePiece::TABLE_ID_OFFSET) |
+                 (partition_id << MessagePiece::PARTITION_ID_OFFSET);
+      }
+      header = MessagePiece::set_message_length(
+          header, length + MessagePiece::get_header_size());
+      std::memcpy(op, &header, sizeof(header));
+      char *body = op + MessagePiece::get_header_size();
+
+      if (delta) {
+        std::size_t ref_length;
+        const char *ref = reference_of(last, last_header, header, ref_length);
+        if (!read_deltas(ip, end, body, length, ref, ref_length)) {
+          return false;
+        }
+      } else {
+        if (length > static_cast<std::size_t>(end - ip)) {
+          return false;
+        }
+        std::memcpy(body, ip, length);
+        ip += length;
+      }
+
+      last = body;
+      last_header = header;
+      op = body + length;
+    }
+
+    return op == op_end;
+  }
+
+  static void write_varint(std::string &dest, uint64_t v) {
+    while (v >= 0x80) {
+      dest.push_back(static_cast<char>(v | 0x80));
+      v >>= 7;
+    }
+    dest.push_back(static_cast<char>(v));
+  }
+
+  static bool read_varint(const uint8_t *&ip, const uint8_t *end,
+                          uint64_t &v) {
+    v = 0;
+    for (auto shift = 0; shift < 64; shift += 7) {
+      if (ip == end) {
+        return false;
+      }
+      uint8_t b = *ip++;
+      v |= static_cast<uint64_t>(b & 0x7f) << shift;
+      if (b < 0x80) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  static uint64_t field_of(uint64_t header, uint64_t offset, uint64_t mask) {
+    return (header >> offset) & mask;
+  }
+
+  static uint64_t type_of(uint64_t header) {
+    return field_of(header, MessagePiece::MESSAGE_TYPE_OFFSET,
+                    MessagePiece::MESSAGE_TYPE_MASK);
+  }
+
+  // the body of the last piece if it has the type of header, or nullptr
+  static const char *reference_of(const char *last, uint64_t last_header,
+                                  uint64_t header, std::size_t &length) {
+    if (last == nullptr || type_of(last_header) != type_of(header)) {
+      length = 0;
+      return nullptr;
+    }
+    length = MessagePiece::get_message_length(last_header) -
+             MessagePiece::get_header_size();
+    return last;
+  }
+
+  // the i-th 32-bit word of a body of length bytes, 0 past its end
+  static uint32_t word_of(const char *body, std::size_t length,
+                          std::size_t i) {
+    uint32_t word = 0;
+    if (body != nullptr && (i + 1) * sizeof(word) <= length) {
+      std::memcpy(&word, body + i * sizeof(word), sizeof(word));
+    }
+    return word;
+  }
+
+  static void write_deltas(std::string &dest, const char *body,
+                           std::size_t length, const char *ref,
+                           std::size_t ref_length) {
+    auto n_words = length / sizeof(uint32_t);
+    for (auto i = 0u; i < n_words; i++) {
+      auto d = static_cast<int32_t>(word_of(body, length, i) -
+                                    word_of(ref, ref_length, i));
+      write_varint(dest, (static_cast<uint32_t>(d) << 1) ^
+                             static_cast<uint32_t>(d >> 31));
+    }
+    dest.append(body + n_words * sizeof(uint32_t), length % sizeof(uint32_t));
+  }
+
+  static bool read_deltas(const uint8_t *&ip, const uint8_t *end, char *body,
+                          std::size_t length, const char *ref,
+                          std::size_t ref_length) {
+    auto n_words = length / sizeof(uint32_t);
+    for (auto i = 0u; i < n_words; i++) {
+      uint64_t zigzag;
+      if (!read_varint(ip, end, zigzag) || zigzag > UINT32_MAX) {
+        return false;
+      }
+      uint32_t d = static_cast<uint32_t>(zigzag >> 1) ^
+                   (0u - static_cast<uint32_t>(zigzag & 1));
+      uint32_t word = word_of(ref, ref_length, i) + d;
+      std::memcpy(body + i * sizeof(word), &word, sizeof(word));
+    }
+    std::size_t tail = length % sizeof(uint32_t);
+    if (tail > static_cast<std::size_t>(end - ip)) {
+      return false;
+    }
+    std::memcpy(body + n_words * sizeof(uint32_t), ip, tail);
+    ip += tail;
+    return true;
+  }
+};
+} // namespace coco
@@ -0,0 +1,57 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+/*
+ * USDT probes of provider coco, built in if <sys/sdt.h> is found, see
+ * CMakeLists.txt, and nothing otherwise. A probe is a nop in the binary until
+ * a tracer attaches to it, e.g.,
+ *
+ *   bpftrace -e 'usdt:./bench_tpcc:coco:txn_commit { @[arg1] = hist(arg2); }'
+ *
+ * for the latency histogram of each procedure, or perf probe sdt_coco:*. The
+ * arguments of a probe are only evaluated when it is built in, so they have
+ * no side effects.
+ *
+ *  txn_begin(worker, procedure)            a transaction starts to execute
+ *  txn_commit(worker, procedure, us)       it commits after us microseconds
+ *  txn_abort(worker, procedure, reason)    it aborts, see ProbeAbort
+ *  txn_phase(phase, ns)                    a phase of the commit of a
+ *                                          protocol ends, see PhaseTimer;
+ *                                          LOCK, VALIDATE, and WRITE, which
+ *                                          writes and replicates
+ *  message_send(dest, worker, bytes, n)    a message of n pieces is sent
+ *  message_receive(src, worker, bytes, n)  a message is dispatched to worker
+ *  executor_status(coordinator, status)    a manager sets the ExecutorStatus
+ */
+
+#ifdef COCO_HAS_SDT
+
+#include <sys/sdt.h>
+
+#define COCO_PROBE2(name, a, b) DTRACE_PROBE2(coco, name, a, b)
+#define COCO_PROBE3(name, a, b, c) DTRACE_PROBE3(coco, name, a, b, c)
+#define COCO_PROBE4(name, a, b, c, d) DTRACE_PROBE4(coco, name, a, b, c, d)
+
+#else
+
+#define COCO_PROBE2(name, a, b)                                                \
+  do {                                                                         \
+  } while (0)
+#define COCO_PROBE3(name, a, b, c)                                             \
+  do {                                                                         \
+  } while (0)
+#define COCO_PROBE4(name, a, b, c, d)                                          \
+  do {                                                                         \
+  } while (0)
+
+#endif
+
+namespace coco {
+
+// the reason argument of txn_abort
+enum class ProbeAbort { LOCK, READ_VALIDATION, NO_RETRY };
+
+} // namespace coco
@@ -0,0 +1,55 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace coco {
+
+/*
+ * RateLimiter keeps a single thread under a given throughput by sleeping
+ * whenever it is ahead of schedule. It is checked every CHECK_BYTES bytes, so
+ * the cost of reading the clock is amortized.
+ */
+
+class RateLimiter {
+public:
+  static constexpr std::size_t CHECK_BYTES = 64 * 1024;
+
+  // 0 means unlimited
+  explicit RateLimiter(uint64_t bytes_per_second)
+      : bytes_per_second(bytes_per_second),
+        start(std::chrono::steady_clock::now()) {}
+
+  void consume(std::size_t bytes) {
+    if (bytes_per_second == 0) {
+      return;
+    }
+    bytes_total += bytes;
+    pending += bytes;
+    if (pending < CHECK_BYTES) {
+      return;
+    }
+    pending = 0;
+    auto expected = std::chrono::microseconds(1000000 * bytes_total /
+                                              bytes_per_second);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    if (elapsed < expected) {
+      std::this_thread::sleep_for(expected - elapsed);
+    }
+  }
+
+  uint64_t total_bytes() const { return bytes_total; }
+
+private:
+  uint64_t bytes_per_second;
+  std::chrono::steady_clock::time_point start;
+  uint64_t bytes_total = 0;
+  std::size_t pending = 0;
+};
+} // namespace coco
@@ -0,0 +1,307 @@
+//
+// Created by Yi Lu on 7/24/18.
+//
+
+#pragma once
+
+#ifdef COCO_HAS_RDMA
+
+#include <cerrno>
+#include <cstring>
+#include <glog/logging.h>
+#include <infiniband/verbs.h>
+#include <memory>
+#include <random>
+
+namespace coco {
+
+/*
+ * The RDMA device shared by all connections of a process, i.e., the first
+ * device returned by ibv_get_device_list on port 1.
+ */
+
+class RdmaDevice {
+public:
+  static RdmaDevice &instance(int gid_index) {
+    static RdmaDevice device(gid_index);
+    return device;
+  }
+
+  RdmaDevice(const RdmaDevice &) = delete;
+  RdmaDevice &operator=(const RdmaDevice &) = delete;
+
+  ~RdmaDevice() {
+    ibv_dealloc_pd(pd);
+    ibv_close_device(context);
+  }
+
+private:
+  RdmaDevice(int gid_index) : gid_index(gid_index) {
+    int n = 0;
+    ibv_device **devices = ibv_get_device_list(&n);
+    CHECK(devices != nullptr && n > 0) << "no rdma device is found.";
+    context = ibv_open_device(devices[0]);
+    CHECK(context != nullptr) << "failed to open rdma device "
+                              << ibv_get_device_name(devices[0]);
+    LOG(INFO) << "rdma device " << ibv_get_device_name(devices[0])
+              << " opened.";
+    ibv_free_device_list(devices);
+
+    pd = ibv_alloc_pd(context);
+    CHECK(pd != nullptr);
+    int res = ibv_query_port(context, port_num, &port_attr);
+    CHECK(res == 0);
+    res = ibv_query_gid(context, port_num, gid_index, &gid);
+    CHECK(res == 0);
+  }
+
+public:
+  ibv_context *context;
+  ibv_pd *pd;
+  ibv_port_attr port_attr;
+  ibv_gid gid;
+  uint8_t port_num = 1;
+  int gid_index;
+};
+
+// what a peer needs to connect its queue pair to ours
+struct RdmaEndpoint {
+  uint32_t qp_num;
+  uint32_t psn;
+  uint16_t lid;
+  uint8_t gid[16];
+};
+
+/*
+ * A reliable connected queue pair with stream semantics, implementing the
+ * read_async / write_n_bytes contract of Socket with two-sided SEND/RECV.
+ *
+ * Bytes are sent in chunks of at most CHUNK_SIZE through a ring of
+ * RING_SIZE registered send buffers. The receiver keeps RING_SIZE receives
+ * posted and hands chunks out in completion order; a receive buffer is
+ * re-posted once it has been fully consumed. A sender that outruns the
+ * receiver is throttled by RNR retries.
+ */
+
+class RdmaConnection {
+public:
+  static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+  static constexpr std::size_t RING_SIZE = 64;
+
+  RdmaConnection(int gid_index)
+      : device(RdmaDevice::instance(gid_index)),
+        send_buffers(new char[CHUNK_SIZE * RING_SIZE]),
+        recv_buffers(new char[CHUNK_SIZE * RING_SIZE]) {
+
+    send_cq = ibv_create_cq(device.context, RING_SIZE, nullptr, nullptr, 0);
+    recv_cq = ibv_create_cq(device.context, RING_SIZE, nullptr, nullptr, 0);
+    CHECK(send_cq != nullptr && recv_cq != nullptr);
+
+    send_mr = ibv_reg_mr(device.pd, send_buffers.get(),
+                         CHUNK_SIZE * RING_SIZE, IBV_ACCESS_LOCAL_WRITE);
+    recv_mr = ibv_reg_mr(device.pd, recv_buffers.get(),
+                         CHUNK_SIZE * RING_SIZE, IBV_ACCESS_LOCAL_WRITE);
+    CHECK(send_mr != nullptr && recv_mr != nullptr);
+
+    ibv_qp_init_attr init_attr;
+    memset(&init_attr, 0, sizeof(init_attr));
+    init_attr.send_cq = send_cq;
+    init_attr.recv_cq = recv_cq;
+    init_attr.qp_type = IBV_QPT_RC;
+    init_attr.cap.max_send_wr = RING_SIZE;
+    init_attr.cap.max_recv_wr = RING_SIZE;
+    init_attr.cap.max_send_sge = 1;
+    init_attr.cap.max_recv_sge = 1;
+    qp = ibv_create_qp(device.pd, &init_attr);
+    CHECK(qp != nullptr) << "ibv_create_qp failed, errno: " << errno;
+
+    ibv_qp_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.qp_state = IBV_QPS_INIT;
+    attr.pkey_index = 0;
+    attr.port_num = device.port_num;
+    attr.qp_access_flags = 0;
+    int res = ibv_modify_qp(qp, &attr,
+                            IBV_QP_STATE | IBV_QP_PKEY_INDEX | IBV_QP_PORT |
+                                IBV_QP_ACCESS_FLAGS);
+    CHECK(res == 0) << "failed to move qp to INIT, errno: " << errno;
+
+    // receives can be posted in INIT, before the peer starts sending
+    for (auto i = 0u; i < RING_SIZE; i++) {
+      post_recv(i);
+    }
+
+    psn = std::random_device()() & 0xffffff;
+  }
+
+  RdmaConnection(const RdmaConnection &) = delete;
+  RdmaConnection &operator=(const RdmaConnection &) = delete;
+
+  ~RdmaConnection() {
+    ibv_destroy_qp(qp);
+    ibv_dereg_mr(send_mr);
+    ibv_dereg_mr(recv_mr);
+    ibv_destroy_cq(send_cq);
+    ibv_destroy_cq(recv_cq);
+  }
+
+  RdmaEndpoint local_endpoint() const {
+    RdmaEndpoint endpoint;
+    memset(&endpoint, 0, sizeof(endpoint));
+    endpoint.qp_num = qp->qp_num;
+    endpoint.psn = psn;
+    endpoint.lid = device.port_attr.lid;
+    memcpy(endpoint.gid, device.gid.raw, sizeof(endpoint.gid));
+    return endpoint;
+  }
+
+  void connect(const RdmaEndpoint &remote) {
+    ibv_qp_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.qp_state = IBV_QPS_RTR;
+    attr.path_mtu = device.port_attr.active_mtu;
+    attr.dest_qp_num = remote.qp_num;
+    attr.rq_psn = remote.psn;
+    attr.max_dest_rd_atomic = 1;
+    attr.min_rnr_timer = 12;
+    attr.ah_attr.dlid = remote.lid;
+    attr.ah_attr.sl = 0;
+    attr.ah_attr.src_path_bits = 0;
+    attr.ah_attr.port_num = device.port_num;
+    // RoCE has no lid and is routed by gid
+    attr.ah_attr.is_global = 1;
+    memcpy(attr.ah_attr.grh.dgid.raw, remote.gid, sizeof(remote.gid));
+    attr.ah_attr.grh.sgid_index = device.gid_index;
+    attr.ah_attr.grh.hop_limit = 1;
+    int res = ibv_modify_qp(qp, &attr,
+                            IBV_QP_STATE | IBV_QP_AV | IBV_QP_PATH_MTU |
+                                IBV_QP_DEST_QPN | IBV_QP_RQ_PSN |
+                                IBV_QP_MAX_DEST_RD_ATOMIC |
+                                IBV_QP_MIN_RNR_TIMER);
+    CHECK(res == 0) << "failed to move qp to RTR, errno: " << errno;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.qp_state = IBV_QPS_RTS;
+    attr.timeout = 14;
+    attr.retry_cnt = 7;
+    attr.rnr_retry = 7; // retry forever if the receiver has no buffer
+    attr.sq_psn = psn;
+    attr.max_rd_atomic = 1;
+    res = ibv_modify_qp(qp, &attr,
+                        IBV_QP_STATE | IBV_QP_TIMEOUT | IBV_QP_RETRY_CNT |
+                            IBV_QP_RNR_RETRY | IBV_QP_SQ_PSN |
+                            IBV_QP_MAX_QP_RD_ATOMIC);
+    CHECK(res == 0) << "failed to move qp to RTS, errno: " << errno;
+  }
+
+  // same as recv with MSG_DONTWAIT, -1 and EAGAIN if there is nothing to read
+  long read_async(char *buf, long size) {
+    long n = 0;
+    while (n < size) {
+      if (recv_offset == recv_length) {
+        if (recv_slot >= 0) {
+          post_recv(recv_slot);
+          recv_slot = -1;
+        }
+        ibv_wc wc;
+        int c = ibv_poll_cq(recv_cq, 1, &wc);
+        CHECK(c >= 0);
+        if (c == 0) {
+          break;
+        }
+        CHECK(wc.status == IBV_WC_SUCCESS)
+            << "recv failed: " << ibv_wc_status_str(wc.status);
+        recv_slot = wc.wr_id;
+        recv_length = wc.byte_len;
+        recv_offset = 0;
+      }
+      long len = std::min<long>(size - n, recv_length - recv_offset);
+      const char *chunk = recv_buffers.get() + recv_slot * CHUNK_SIZE;
+      memcpy(buf + n, chunk + recv_offset, len);
+      recv_offset += len;
+      n += len;
+    }
+
+    if (n == 0) {
+      errno = EAGAIN;
+      return -1;
+    }
+    return n;
+  }
+
+  long write_n_bytes(const char *buf, long size) {
+    long n = 0;
+    while (n < size) {
+      std::size_t slot = acquire_send_slot();
+      long len = std::min<long>(size - n, CHUNK_SIZE);
+      char *chunk = send_buffers.get() + slot * CHUNK_SIZE;
+      memcpy(chunk, buf + n, len);
+
+      ibv_sge sge;
+      sge.addr = reinterpret_cast<uint64_t>(chunk);
+      sge.length = len;
+      sge.lkey = send_mr->lkey;
+
+      ibv_send_wr wr, *bad_wr = nullptr;
+      memset(&wr, 0, sizeof(wr));
+      wr.wr_id = slot;
+      wr.sg_list = &sge;
+      wr.num_sge = 1;
+      wr.opcode = IBV_WR_SEND;
+      wr.send_flags = IBV_SEND_SIGNALED;
+      int res = ibv_post_send(qp, &wr, &bad_wr);
+      CHECK(res == 0) << "ibv_post_send failed, errno: " << res;
+      n += len;
+    }
+    return n;
+  }
+
+private:
+  void post_recv(std::size_t slot) {
+    ibv_sge sge;
+    sge.addr = reinterpret_cast<uint64_t>(recv_buffers.get() +
+                                          slot * CHUNK_SIZE);
+    sge.length = CHUNK_SIZE;
+    sge.lkey = recv_mr->lkey;
+
+    ibv_recv_wr wr, *bad_wr = nullptr;
+    memset(&wr, 0, sizeof(wr));
+    wr.wr_id = slot;
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    int res = ibv_post_recv(qp, &wr, &bad_wr);
+    CHECK(res == 0) << "ibv_post_recv failed, errno: " << res;
+  }
+
+  // send buffers are used in fifo order, completions on a RC qp are in order
+  std::size_t acquire_send_slot() {
+    do {
+      ibv_wc wc[RING_SIZE];
+      int c = ibv_poll_cq(send_cq, RING_SIZE, wc);
+      CHECK(c >= 0);
+      for (int i = 0; i < c; i++) {
+        CHECK(wc[i].status == IBV_WC_SUCCESS)
+            << "send failed: " << ibv_wc_status_str(wc[i].status);
+      }
+      send_inflight -= c;
+    } while (send_inflight == RING_SIZE);
+
+    send_inflight++;
+    return send_head++ % RING_SIZE;
+  }
+
+private:
+  RdmaDevice &device;
+  std::unique_ptr<char[]> send_buffers, recv_buffers;
+  ibv_cq *send_cq, *recv_cq;
+  ibv_mr *send_mr, *recv_mr;
+  ibv_qp *qp;
+  uint32_t psn;
+
+  std::size_t send_head = 0, send_inflight = 0;
+  long recv_slot = -1;
+  std::size_t recv_offset = 0, recv_length = 0;
+};
+} // namespace coco
+
+#endif
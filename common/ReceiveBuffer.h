@@ -0,0 +1,52 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <glog/logging.h>
+#include <memory>
+
+namespace coco {
+
+/*
+ * A block of bytes received from a connection, see BufferedReader. The reader
+ * holds a reference while it receives into the block, and so does each
+ * message that views its pieces in the block instead of copying them, see
+ * --zero_copy_receive. The block is freed by whoever drops the last
+ * reference, i.e., once the reader has moved on to another block and the
+ * workers have released the messages.
+ */
+
+class ReceiveBuffer {
+public:
+  explicit ReceiveBuffer(std::size_t size) : data(new char[size]), size(size) {}
+
+  ReceiveBuffer(const ReceiveBuffer &) = delete;
+  ReceiveBuffer &operator=(const ReceiveBuffer &) = delete;
+
+  char *get() { return data.get(); }
+
+  std::size_t get_size() const { return size; }
+
+  void ref() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+  void unref() {
+    auto n = refs.fetch_sub(1, std::memory_order_acq_rel);
+    DCHECK(n > 0);
+    if (n == 1) {
+      delete this;
+    }
+  }
+
+  // if no message views the block, so that the reader can reuse it
+  bool is_unique() const { return refs.load(std::memory_order_acquire) == 1; }
+
+private:
+  std::unique_ptr<char[]> data;
+  std::size_t size;
+  std::atomic<std::size_t> refs{1};
+};
+} // namespace coco
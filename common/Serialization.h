@@ -17,6 +17,11 @@ public:
     memcpy(&result[0], &v, sizeof(T));
     return result;
   }
+
+  // append the bytes of v to out, no temporary string is created.
+  void operator()(const T &v, std::string &out) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
 };
 
 template <class T> class Deserializer {
@@ -32,6 +37,11 @@ public:
   std::string operator()(const std::string &v) {
     return Serializer<std::string::size_type>()(v.size()) + v;
   }
+
+  void operator()(const std::string &v, std::string &out) {
+    Serializer<std::string::size_type>()(v.size(), out);
+    out.append(v);
+  }
 };
 
 template <> class Deserializer<std::string> {
@@ -0,0 +1,236 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <ifaddrs.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace coco {
+
+/*
+ * A single producer single consumer byte ring. head is the # of bytes ever
+ * written and tail the # of bytes ever read, each on a cache line of its own,
+ * followed by the data. It lives in memory shared by two processes, so it has
+ * nothing but the atomics and the bytes.
+ */
+
+class ShmRing {
+public:
+  struct Header {
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+  };
+
+  // capacity is a power of 2, memory holds bytes(capacity)
+  ShmRing(void *memory, std::size_t capacity)
+      : header(static_cast<Header *>(memory)),
+        data(static_cast<char *>(memory) + sizeof(Header)),
+        capacity(capacity) {
+    DCHECK((capacity & (capacity - 1)) == 0);
+  }
+
+  static std::size_t bytes(std::size_t capacity) {
+    return sizeof(Header) + capacity;
+  }
+
+  // on the memory of a new ring, before the peer maps it
+  void init() {
+    header->head.store(0);
+    header->tail.store(0);
+  }
+
+  // writes up to size bytes, the # of bytes written
+  std::size_t write(const char *buf, std::size_t size) {
+    auto head = header->head.load(std::memory_order_relaxed);
+    auto tail = header->tail.load(std::memory_order_acquire);
+    auto n = std::min(size, capacity - (head - tail));
+    copy_in(head, buf, n);
+    header->head.store(head + n, std::memory_order_release);
+    return n;
+  }
+
+  // reads up to size bytes, the # of bytes read
+  std::size_t read(char *buf, std::size_t size) {
+    auto tail = header->tail.load(std::memory_order_relaxed);
+    auto head = header->head.load(std::memory_order_acquire);
+    auto n = std::min<std::size_t>(size, head - tail);
+    copy_out(tail, buf, n);
+    header->tail.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+private:
+  // the ring wraps around at capacity
+  void copy_in(uint64_t offset, const char *buf, std::size_t n) {
+    auto k = offset & (capacity - 1);
+    auto first = std::min(n, capacity - k);
+    std::memcpy(data + k, buf, first);
+    std::memcpy(data, buf + first, n - first);
+  }
+
+  void copy_out(uint64_t offset, char *buf, std::size_t n) const {
+    auto k = offset & (capacity - 1);
+    auto first = std::min(n, capacity - k);
+    std::memcpy(buf, data + k, first);
+    std::memcpy(buf + first, data, n - first);
+  }
+
+private:
+  Header *header;
+  char *data;
+  std::size_t capacity;
+};
+
+// what a peer needs to map the ring we receive from
+struct ShmEndpoint {
+  char name[64];
+};
+
+/*
+ * Two coordinators on the same host, see is_local, talk through shared
+ * memory instead of tcp loopback, implementing the read_async /
+ * write_n_bytes contract of Socket. Each side creates a POSIX shared memory
+ * segment with the ring it receives from and maps the one of its peer to
+ * send to, so both rings have a single producer, the thread writing to the
+ * socket, and a single consumer, the i/o thread reading from it. The bytes
+ * are the same Message framing as on tcp. A segment is unlinked once the peer
+ * has mapped it and goes away with the last mapping.
+ */
+
+class ShmConnection {
+public:
+  static constexpr std::size_t CAPACITY = 4 * 1024 * 1024;
+
+  ShmConnection() {
+    static std::atomic<uint64_t> n_segments(0);
+    std::snprintf(local.name, sizeof(local.name), "/coco.%d.%lu",
+                  static_cast<int>(getpid()),
+                  static_cast<unsigned long>(n_segments.fetch_add(1)));
+    int fd = shm_open(local.name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    CHECK(fd >= 0) << "shm_open " << local.name << " failed, errno: " << errno;
+    CHECK(ftruncate(fd, ShmRing::bytes(CAPACITY)) == 0)
+        << "ftruncate " << local.name << " failed, errno: " << errno;
+    recv_memory = map(fd);
+    recv_ring = ShmRing(recv_memory, CAPACITY);
+    recv_ring.init();
+  }
+
+  ShmConnection(const ShmConnection &) = delete;
+  ShmConnection &operator=(const ShmConnection &) = delete;
+
+  ~ShmConnection() {
+    unlink();
+    munmap(recv_memory, ShmRing::bytes(CAPACITY));
+    if (send_memory != nullptr) {
+      munmap(send_memory, ShmRing::bytes(CAPACITY));
+    }
+  }
+
+  const ShmEndpoint &local_endpoint() const { return local; }
+
+  void connect(const ShmEndpoint &remote) {
+    DCHECK(send_memory == nullptr);
+    int fd = shm_open(remote.name, O_RDWR, 0600);
+    CHECK(fd >= 0) << "shm_open " << remote.name
+                   << " failed, errno: " << errno;
+    send_memory = map(fd);
+    send_ring = ShmRing(send_memory, CAPACITY);
+  }
+
+  // the peer has mapped our segment, its name is no longer needed
+  void unlink() {
+    if (!unlinked) {
+      shm_unlink(local.name);
+      unlinked = true;
+    }
+  }
+
+  // same as recv with MSG_DONTWAIT, -1 and EAGAIN if there is nothing to read
+  long read_async(char *buf, long size) {
+    auto n = recv_ring.read(buf, size);
+    if (n == 0) {
+      errno = EAGAIN;
+      return -1;
+    }
+    return n;
+  }
+
+  // same as send with MSG_DONTWAIT, -1 and EAGAIN if the ring is full
+  long write_async(const char *buf, long size) {
+    auto n = send_ring.write(buf, size);
+    if (n == 0) {
+      errno = EAGAIN;
+      return -1;
+    }
+    return n;
+  }
+
+  // a full ring waits for the i/o thread of the peer to drain it
+  long write_n_bytes(const char *buf, long size) {
+    long n = 0;
+    while (n < size) {
+      auto len = send_ring.write(buf + n, size - n);
+      if (len == 0) {
+        std::this_thread::yield();
+      }
+      n += len;
+    }
+    return n;
+  }
+
+  // true if addr is the loopback or assigned to an interface of this host
+  static bool is_local(const char *addr) {
+    in_addr a;
+    if (inet_pton(AF_INET, addr, &a) != 1) {
+      return false;
+    }
+    if ((ntohl(a.s_addr) >> 24) == 127) {
+      return true;
+    }
+    ifaddrs *interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+      return false;
+    }
+    bool local = false;
+    for (auto *i = interfaces; i != nullptr && !local; i = i->ifa_next) {
+      if (i->ifa_addr != nullptr && i->ifa_addr->sa_family == AF_INET) {
+        auto *in = reinterpret_cast<sockaddr_in *>(i->ifa_addr);
+        local = in->sin_addr.s_addr == a.s_addr;
+      }
+    }
+    freeifaddrs(interfaces);
+    return local;
+  }
+
+private:
+  static void *map(int fd) {
+    void *memory = mmap(nullptr, ShmRing::bytes(CAPACITY),
+                        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CHECK(memory != MAP_FAILED) << "mmap failed, errno: " << errno;
+    ::close(fd);
+    return memory;
+  }
+
+private:
+  ShmEndpoint local;
+  void *recv_memory = nullptr, *send_memory = nullptr;
+  ShmRing recv_ring{nullptr, CAPACITY}, send_ring{nullptr, CAPACITY};
+  bool unlinked = false;
+};
+} // namespace coco
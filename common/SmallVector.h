@@ -0,0 +1,149 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <glog/logging.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace coco {
+
+/*
+ * SmallVector is a std::vector of trivially copyable elements whose first N
+ * elements are stored in the object itself, e.g., the read and write sets of
+ * a transaction, so that a typical transaction neither allocates nor follows
+ * a pointer to its keys. Past N elements, the elements move to the heap and
+ * the capacity doubles as a std::vector's does. clear() keeps the capacity.
+ */
+
+template <class T, std::size_t N> class SmallVector {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SmallVector only holds trivially copyable elements.");
+  static_assert(N > 0, "SmallVector needs an inline capacity.");
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using iterator = T *;
+  using const_iterator = const T *;
+
+  SmallVector() = default;
+
+  SmallVector(const SmallVector &other) { *this = other; }
+
+  SmallVector &operator=(const SmallVector &other) {
+    if (this != &other) {
+      clear();
+      reserve(other.n);
+      std::memcpy(data(), other.data(), other.n * sizeof(T));
+      n = other.n;
+    }
+    return *this;
+  }
+
+  ~SmallVector() {
+    if (heap != nullptr) {
+      std::free(heap);
+    }
+  }
+
+  T *data() { return heap != nullptr ? heap : reinterpret_cast<T *>(buffer); }
+  const T *data() const {
+    return heap != nullptr ? heap : reinterpret_cast<const T *>(buffer);
+  }
+
+  iterator begin() { return data(); }
+  iterator end() { return data() + n; }
+  const_iterator begin() const { return data(); }
+  const_iterator end() const { return data() + n; }
+
+  T &operator[](std::size_t i) {
+    DCHECK(i < n);
+    return data()[i];
+  }
+
+  const T &operator[](std::size_t i) const {
+    DCHECK(i < n);
+    return data()[i];
+  }
+
+  T &front() { return (*this)[0]; }
+  T &back() { return (*this)[n - 1]; }
+  const T &front() const { return (*this)[0]; }
+  const T &back() const { return (*this)[n - 1]; }
+
+  std::size_t size() const { return n; }
+  std::size_t capacity() const { return heap != nullptr ? heap_capacity : N; }
+  bool empty() const { return n == 0; }
+
+  // true if the elements have moved to the heap
+  bool spilled() const { return heap != nullptr; }
+
+  void push_back(const T &value) {
+    if (n == capacity()) {
+      // value may be an element of this vector
+      T copy = value;
+      grow(n + 1);
+      data()[n++] = copy;
+      return;
+    }
+    data()[n++] = value;
+  }
+
+  template <class... Args> T &emplace_back(Args &&... args) {
+    if (n == capacity()) {
+      grow(n + 1);
+    }
+    return *new (data() + n++) T(std::forward<Args>(args)...);
+  }
+
+  void pop_back() {
+    DCHECK(n > 0);
+    n--;
+  }
+
+  // new elements are value-initialized
+  void resize(std::size_t size) {
+    reserve(size);
+    for (auto i = n; i < size; i++) {
+      new (data() + i) T();
+    }
+    n = size;
+  }
+
+  void reserve(std::size_t size) {
+    if (size > capacity()) {
+      grow(size);
+    }
+  }
+
+  void clear() { n = 0; }
+
+private:
+  void grow(std::size_t size) {
+    std::size_t new_capacity = capacity() * 2;
+    if (new_capacity < size) {
+      new_capacity = size;
+    }
+    auto p = static_cast<T *>(std::malloc(new_capacity * sizeof(T)));
+    CHECK(p != nullptr) << "failed to allocate " << new_capacity
+                        << " elements.";
+    std::memcpy(p, data(), n * sizeof(T));
+    if (heap != nullptr) {
+      std::free(heap);
+    }
+    heap = p;
+    heap_capacity = new_capacity;
+  }
+
+private:
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type buffer[N];
+  T *heap = nullptr;
+  std::size_t n = 0, heap_capacity = 0;
+};
+} // namespace coco
@@ -4,14 +4,18 @@
 
 #pragma once
 
+#include "RdmaConnection.h"
+#include "ShmConnection.h"
 #include <arpa/inet.h>
 #include <cstdlib>
 #include <cstring>
 #include <errno.h>
 #include <glog/logging.h>
+#include <memory>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace coco {
@@ -34,6 +38,10 @@ public:
   // Socket is movable
   Socket(Socket &&that) {
     quick_ack = that.quick_ack;
+#ifdef COCO_HAS_RDMA
+    rdma = std::move(that.rdma);
+#endif
+    shm = std::move(that.shm);
 
     DCHECK(that.fd >= 0);
     fd = that.fd;
@@ -42,6 +50,10 @@ public:
 
   Socket &operator=(Socket &&that) {
     quick_ack = that.quick_ack;
+#ifdef COCO_HAS_RDMA
+    rdma = std::move(that.rdma);
+#endif
+    shm = std::move(that.shm);
 
     DCHECK(that.fd >= 0);
     fd = that.fd;
@@ -65,6 +77,62 @@ public:
 
   void set_quick_ack_flag(bool quick_ack) { this->quick_ack = quick_ack; }
 
+  /*
+   * A read busy polls the receive queue of the device for up to us
+   * microseconds before it waits for an interrupt, and so does epoll if all
+   * its sockets are served by the same queue. Returns false and sets errno if
+   * the kernel does not support it (ENOPROTOOPT), or us is larger than
+   * net.core.busy_read without CAP_NET_ADMIN (EPERM).
+   */
+  bool set_busy_poll(int us) {
+#ifdef SO_BUSY_POLL
+    DCHECK(fd >= 0);
+    if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(int)) < 0) {
+      return false;
+    }
+#ifdef SO_PREFER_BUSY_POLL
+    // best effort, the device queue keeps its interrupts otherwise
+    int flag = 1;
+    setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &flag, sizeof(int));
+#endif
+    return true;
+#else
+    errno = ENOPROTOOPT;
+    return false;
+#endif
+  }
+
+  /*
+   * Sets the receive and send buffers to bytes each, so that a burst of
+   * messages does not stall on a full window. The kernel doubles the sizes
+   * and caps them at net.core.rmem_max and net.core.wmem_max. Returns false if
+   * either cannot be set.
+   */
+  bool set_buffer_size(int bytes) {
+    DCHECK(fd >= 0);
+    return setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(int)) >= 0 &&
+           setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(int)) >= 0;
+  }
+
+  // the cpu that processed the last packet received, i.e., the cpu the
+  // interrupts of its device queue go to, or -1 if it is unknown
+  int incoming_cpu() const {
+#ifdef SO_INCOMING_CPU
+    DCHECK(fd >= 0);
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0) {
+      return -1;
+    }
+    return cpu;
+#else
+    return -1;
+#endif
+  }
+
+  // the kernel leaves quick ack mode on its own, so it is set again after
+  // each read that received data. A read that finds nothing has nothing to
+  // acknowledge, and polling reads mostly find nothing.
   void try_quick_ack() {
 #ifndef __APPLE__
     if (quick_ack) {
@@ -78,9 +146,85 @@ public:
 
   int close() {
     DCHECK(fd >= 0);
+#ifdef COCO_HAS_RDMA
+    rdma.reset();
+#endif
+    shm.reset();
     return ::close(fd);
   }
 
+#ifdef COCO_HAS_RDMA
+  /*
+   * Moves the byte stream of this socket onto a RDMA queue pair. The tcp
+   * connection stays open and is only used to exchange endpoints. To avoid
+   * deadlocks, both sides must call begin_rdma on all sockets, then
+   * finish_rdma on all sockets and then wait_rdma on all sockets.
+   */
+
+  void begin_rdma(int gid_index) {
+    DCHECK(fd >= 0);
+    DCHECK(rdma == nullptr);
+    auto connection = std::make_unique<RdmaConnection>(gid_index);
+    RdmaEndpoint endpoint = connection->local_endpoint();
+    write_number(endpoint);
+    rdma = std::move(connection);
+  }
+
+  void finish_rdma() {
+    DCHECK(rdma != nullptr);
+    RdmaEndpoint remote;
+    long size = read_number(remote);
+    CHECK(size == sizeof(remote));
+    rdma->connect(remote);
+    // tell the peer our receive side is up
+    char ready = 1;
+    CHECK(send(fd, &ready, sizeof(ready), 0) == sizeof(ready));
+  }
+
+  // the peer must not send before our queue pair has been connected
+  void wait_rdma() {
+    char ready = 0;
+    long size = read_n_bytes(&ready, sizeof(ready));
+    CHECK(size == sizeof(ready) && ready == 1);
+  }
+#endif
+
+  /*
+   * Moves the byte stream of this socket onto shared memory rings, if the
+   * peer is on the same host, see ShmConnection. Same as with RDMA, the tcp
+   * connection only exchanges the segments, and both sides must call
+   * begin_shm, finish_shm and wait_shm in turn on all sockets.
+   */
+
+  void begin_shm() {
+    DCHECK(fd >= 0);
+    DCHECK(shm == nullptr);
+    auto connection = std::make_unique<ShmConnection>();
+    ShmEndpoint endpoint = connection->local_endpoint();
+    write_number(endpoint);
+    shm = std::move(connection);
+  }
+
+  void finish_shm() {
+    DCHECK(shm != nullptr);
+    ShmEndpoint remote;
+    long size = read_number(remote);
+    CHECK(size == sizeof(remote));
+    shm->connect(remote);
+    // tell the peer we have mapped its segment
+    char ready = 1;
+    CHECK(send(fd, &ready, sizeof(ready), 0) == sizeof(ready));
+  }
+
+  void wait_shm() {
+    char ready = 0;
+    long size = read_n_bytes(&ready, sizeof(ready));
+    CHECK(size == sizeof(ready) && ready == 1);
+    shm->unlink();
+  }
+
+  int get_fd() const { return fd; }
+
   long read_n_bytes(char *buf, long size) {
     DCHECK(fd >= 0);
     long n = 0;
@@ -126,6 +270,47 @@ public:
     return n;
   }
 
+  // write all bytes described by iov, iov is modified on partial writes
+  long write_n_bytes_v(iovec *iov, int iovcnt) {
+    DCHECK(fd >= 0);
+#ifdef COCO_HAS_RDMA
+    if (rdma) {
+      long n = 0;
+      for (int i = 0; i < iovcnt; i++) {
+        n += rdma->write_n_bytes(static_cast<const char *>(iov[i].iov_base),
+                                 iov[i].iov_len);
+      }
+      return n;
+    }
+#endif
+    if (shm) {
+      long n = 0;
+      for (int i = 0; i < iovcnt; i++) {
+        n += shm->write_n_bytes(static_cast<const char *>(iov[i].iov_base),
+                                iov[i].iov_len);
+      }
+      return n;
+    }
+    long n = 0;
+    while (iovcnt > 0) {
+      long bytes_written = ::writev(fd, iov, iovcnt);
+      CHECK(bytes_written >= 0) << "writev failed, errno: " << errno;
+      n += bytes_written;
+      // skip fully written buffers
+      while (iovcnt > 0 &&
+             static_cast<std::size_t>(bytes_written) >= iov->iov_len) {
+        bytes_written -= iov->iov_len;
+        iov++;
+        iovcnt--;
+      }
+      if (iovcnt > 0) {
+        iov->iov_base = static_cast<char *>(iov->iov_base) + bytes_written;
+        iov->iov_len -= bytes_written;
+      }
+    }
+    return n;
+  }
+
   template <class T> long write_number(const T &n) {
     DCHECK(fd >= 0);
     return write_n_bytes(reinterpret_cast<const char *>(&n), sizeof(T));
@@ -145,7 +330,9 @@ public:
     DCHECK(fd >= 0);
     if (size > 0) {
       long recv_size = recv(fd, buf, size, 0);
-      try_quick_ack();
+      if (recv_size > 0) {
+        try_quick_ack();
+      }
       return recv_size;
     }
     return 0;
@@ -153,9 +340,19 @@ public:
 
   long read_async(char *buf, long size) {
     DCHECK(fd >= 0);
+#ifdef COCO_HAS_RDMA
+    if (rdma) {
+      return size > 0 ? rdma->read_async(buf, size) : 0;
+    }
+#endif
+    if (shm) {
+      return size > 0 ? shm->read_async(buf, size) : 0;
+    }
     if (size > 0) {
       long recv_size = recv(fd, buf, size, MSG_DONTWAIT);
-      try_quick_ack();
+      if (recv_size > 0) {
+        try_quick_ack();
+      }
       return recv_size;
     }
     return 0;
@@ -163,12 +360,32 @@ public:
 
   long write(const char *buf, long size) {
     DCHECK(fd >= 0);
+#ifdef COCO_HAS_RDMA
+    if (rdma) {
+      return size > 0 ? rdma->write_n_bytes(buf, size) : 0;
+    }
+#endif
+    if (shm) {
+      return size > 0 ? shm->write_n_bytes(buf, size) : 0;
+    }
     if (size > 0) {
       return send(fd, buf, size, 0);
     }
     return 0;
   }
 
+  // returns -1 with errno EWOULDBLOCK or EAGAIN instead of blocking
+  long write_async(const char *buf, long size) {
+    DCHECK(fd >= 0);
+    if (shm) {
+      return size > 0 ? shm->write_async(buf, size) : 0;
+    }
+    if (size > 0) {
+      return send(fd, buf, size, MSG_DONTWAIT);
+    }
+    return 0;
+  }
+
   static sockaddr_in make_endpoint(const char *addr, int port) {
     sockaddr_in serv;
     memset(&serv, 0, sizeof(serv));
@@ -182,6 +399,10 @@ public:
 private:
   bool quick_ack = false;
   int fd;
+#ifdef COCO_HAS_RDMA
+  std::unique_ptr<RdmaConnection> rdma;
+#endif
+  std::unique_ptr<ShmConnection> shm;
 };
 
 class Listener {
@@ -203,6 +424,9 @@ public:
 
 private:
   void bind(const char *addr, int port) {
+    // a sweep listens again on the port of the run before, see Sweep
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
     sockaddr_in serv = Socket::make_endpoint(addr, port);
     int ret = ::bind(fd, (sockaddr *)(&serv), sizeof(serv));
     CHECK(ret >= 0);
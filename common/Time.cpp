@@ -4,6 +4,81 @@
 
 #include "common/Time.h"
 
+#include <algorithm>
+
 namespace coco {
-  std::chrono::steady_clock::time_point Time::startTime = std::chrono::steady_clock::now();
-}
\ No newline at end of file
+
+namespace {
+int64_t steady_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+Clock::Calibration::Calibration() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (!invariant_tsc()) {
+    return;
+  }
+  // the ticks in 5 ms of steady_clock
+  auto start_ns = steady_ns();
+  auto start_tick = static_cast<int64_t>(__rdtsc());
+  auto end_ns = start_ns;
+  while (end_ns - start_ns < 5000000) {
+    end_ns = steady_ns();
+  }
+  auto end_tick = static_cast<int64_t>(__rdtsc());
+  if (end_tick <= start_tick) {
+    return;
+  }
+  double rate = double(end_ns - start_ns) / (end_tick - start_tick);
+  first_tick = start_tick;
+  first_ns = start_ns;
+  max_segment_ticks = static_cast<int64_t>(1e9 / rate);
+  base_tick = end_tick;
+  base_ns = end_ns;
+  segment_ticks = static_cast<int64_t>(1e7 / rate);
+  ns_per_tick = rate;
+  enabled = true;
+#endif
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+void Clock::Calibration::recalibrate(uint64_t seq) {
+  if (!sequence.compare_exchange_strong(seq, seq + 1,
+                                        std::memory_order_acquire)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // the clock at the same tick as steady_clock, on the current segment
+  auto now_ns = steady_ns();
+  auto tick = static_cast<int64_t>(__rdtsc());
+  auto ticks = tick - base_tick.load(std::memory_order_relaxed);
+  auto end = segment_ticks.load(std::memory_order_relaxed);
+  auto clock_ns = base_ns.load(std::memory_order_relaxed) +
+                  static_cast<int64_t>(
+                      ticks * ns_per_tick.load(std::memory_order_relaxed) +
+                      std::min(ticks, end) *
+                          correction_per_tick.load(std::memory_order_relaxed));
+
+  double rate = double(now_ns - first_ns) / (tick - first_tick);
+  auto length = std::min(2 * end, max_segment_ticks);
+  // never slower than half the frequency, so that now() does not go back
+  double correction = std::max(double(now_ns - clock_ns) / length, -rate / 2);
+
+  base_tick.store(tick, std::memory_order_relaxed);
+  base_ns.store(clock_ns, std::memory_order_relaxed);
+  segment_ticks.store(length, std::memory_order_relaxed);
+  ns_per_tick.store(rate, std::memory_order_relaxed);
+  correction_per_tick.store(correction, std::memory_order_relaxed);
+  sequence.store(seq + 2, std::memory_order_release);
+}
+#endif
+
+Clock::Calibration Clock::calibration;
+
+// after calibration, which is initialized first in this file
+Clock::time_point Time::startTime = Clock::now();
+} // namespace coco
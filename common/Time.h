@@ -4,19 +4,132 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
 
 namespace coco {
 
+/*
+ * Clock is a steady clock for the timestamps on the hot path, e.g., the start
+ * and commit of each transaction, the phases and the flushes of messages. On
+ * a CPU with an invariant TSC, now() reads the TSC and scales it, which costs
+ * a few ns instead of a clock_gettime. Otherwise, it is
+ * std::chrono::steady_clock.
+ *
+ * The scale is piecewise linear in the TSC. Each segment starts where the
+ * previous one ends, so now() is continuous and never goes back. Its slope is
+ * the frequency measured against steady_clock since startup, corrected so
+ * that the clock meets steady_clock again at the end of the segment, where
+ * the first now() starts the next one. The segments get longer, from 10 ms to
+ * 1 s, as the measured frequency gets more precise. Clock tracks steady_clock
+ * within a few us.
+ *
+ * Its time points are a type of their own: a time point of Clock can only be
+ * subtracted from or compared with another one of Clock, never with one of
+ * steady_clock.
+ */
+
+class Clock {
+public:
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<Clock, duration>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (calibration.enabled) {
+      return time_point(duration(calibration.now()));
+    }
+#endif
+    return time_point(std::chrono::duration_cast<duration>(
+        std::chrono::steady_clock::now().time_since_epoch()));
+  }
+
+  // true if now() reads the TSC
+  static bool tsc_enabled() { return calibration.enabled; }
+
+  static bool invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) {
+      return false;
+    }
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+  }
+
+private:
+  struct Calibration {
+    Calibration();
+
+#if defined(__x86_64__) || defined(__i386__)
+    // the ns of steady_clock at the current tick, read under a seqlock
+    int64_t now() {
+      for (;;) {
+        auto seq = sequence.load(std::memory_order_acquire);
+        if (seq & 1) {
+          continue;
+        }
+        auto tick = static_cast<int64_t>(__rdtsc());
+        auto ticks = tick - base_tick.load(std::memory_order_relaxed);
+        auto end = segment_ticks.load(std::memory_order_relaxed);
+        auto ns = base_ns.load(std::memory_order_relaxed) +
+                  static_cast<int64_t>(
+                      ticks * ns_per_tick.load(std::memory_order_relaxed) +
+                      std::min(ticks, end) *
+                          correction_per_tick.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) != seq) {
+          continue;
+        }
+        if (ticks >= end) {
+          recalibrate(seq);
+        }
+        return ns;
+      }
+    }
+
+    // starts the next segment, unless another thread is at it
+    void recalibrate(uint64_t seq);
+#endif
+
+    // false until calibrated, e.g., in the static initializers of other files
+    bool enabled = false;
+
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<int64_t> base_tick{0}, base_ns{0}, segment_ticks{0};
+    // the clock catches up with steady_clock by the end of the segment and
+    // runs at the measured frequency after it
+    std::atomic<double> ns_per_tick{0}, correction_per_tick{0};
+
+    // the first sample, the frequency is measured from it
+    int64_t first_tick = 0, first_ns = 0;
+    int64_t max_segment_ticks = 0;
+  };
+
+  static Calibration calibration;
+};
+
 class Time {
 public:
   static uint64_t now() {
-    auto now = std::chrono::steady_clock::now();
+    auto now = Clock::now();
     return std::chrono::duration_cast<std::chrono::nanoseconds>(now - startTime)
         .count();
   }
 
-  static std::chrono::steady_clock::time_point startTime;
+  static Clock::time_point startTime;
 };
 
 } // namespace coco
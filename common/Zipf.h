@@ -5,35 +5,54 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <glog/logging.h>
+#include <map>
+#include <mutex>
+#include <utility>
 
 namespace coco {
 
+/*
+ * Zipf draws keys in [0, n) with the method of Gray et al. ("Quickly
+ * generating billion-record synthetic databases", SIGMOD 94), which YCSB uses
+ * as well. Each draw takes one std::pow.
+ *
+ * init() needs zeta(n) = sum of 1 / i^theta for i in [1, n]. It is summed up
+ * to EXACT_ZETA_LIMIT keys, and beyond that the tail is approximated with the
+ * Euler-Maclaurin formula, whose error is far below the rounding error of
+ * the sum. zeta is cached per (n, theta), so that a process pays for it once.
+ */
+
 class Zipf {
 public:
-  void init(int n, double theta) {
+  static constexpr int EXACT_ZETA_LIMIT = 1 << 20;
+
+  void init(uint64_t n, double theta) {
     hasInit = true;
 
     n_ = n;
     theta_ = theta;
     alpha_ = 1.0 / (1.0 - theta_);
-    zetan_ = zeta(n_);
-    eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) / (1.0 - zeta(2) / zetan_);
+    zetan_ = cached_zeta(n_, theta_);
+    eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) /
+           (1.0 - zeta(2, theta_) / zetan_);
+    threshold_ = 1 + std::pow(0.5, theta_);
   }
 
-  int value(double u) {
-    CHECK(hasInit);
+  uint64_t value(double u) {
+    DCHECK(hasInit);
 
     double uz = u * zetan_;
-    int v;
+    uint64_t v;
     if (uz < 1) {
       v = 0;
-    } else if (uz < 1 + std::pow(0.5, theta_)) {
+    } else if (uz < threshold_) {
       v = 1;
     } else {
-      v = static_cast<int>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
+      v = static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_));
     }
-    DCHECK(v >= 0 && v < n_);
+    DCHECK(v < n_);
     return v;
   }
 
@@ -42,25 +61,56 @@ public:
     return z;
   }
 
-private:
-  double zeta(int n) {
-    DCHECK(hasInit);
+  static double zeta(uint64_t n, double theta) {
+    if (n <= EXACT_ZETA_LIMIT) {
+      return partial_zeta(1, n, theta);
+    }
 
-    double sum = 0;
+    // sum of f(i) for i in [m, n] ~ the integral of f from m to n + (f(m) +
+    // f(n)) / 2 + (f'(n) - f'(m)) / 12, f(x) = x^-theta
+    double m = EXACT_ZETA_LIMIT, x = n;
+    double integral = theta == 1 ? std::log(x / m)
+                                 : (std::pow(x, 1 - theta) -
+                                    std::pow(m, 1 - theta)) /
+                                       (1 - theta);
+    double ends = (std::pow(m, -theta) + std::pow(x, -theta)) / 2;
+    double slopes =
+        theta * (std::pow(m, -theta - 1) - std::pow(x, -theta - 1)) / 12;
+    return partial_zeta(1, EXACT_ZETA_LIMIT - 1, theta) + integral + ends +
+           slopes;
+  }
 
-    for (auto i = 1; i <= n; i++) {
-      sum += std::pow(1.0 / i, theta_);
+private:
+  // sum of 1 / i^theta for i in [first, last]
+  static double partial_zeta(uint64_t first, uint64_t last, double theta) {
+    double sum = 0;
+    for (auto i = first; i <= last; i++) {
+      sum += std::pow(1.0 / i, theta);
     }
-
     return sum;
   }
 
+  static double cached_zeta(uint64_t n, double theta) {
+    static std::mutex mutex;
+    static std::map<std::pair<uint64_t, double>, double> cache;
+
+    std::lock_guard<std::mutex> guard(mutex);
+    auto key = std::make_pair(n, theta);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+      it = cache.emplace(key, zeta(n, theta)).first;
+    }
+    return it->second;
+  }
+
   bool hasInit = false;
 
-  int n_;
+  uint64_t n_;
   double theta_;
   double alpha_;
   double zetan_;
   double eta_;
+  // the draws below it are key 1
+  double threshold_;
 };
 } // namespace coco
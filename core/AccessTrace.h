@@ -0,0 +1,169 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/BufferedFileWriter.h"
+#include "common/Encoder.h"
+#include "common/StringPiece.h"
+#include "common/Time.h"
+#include "core/Table.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Sampled access trace -- format --
+ *
+ *  With --trace_path, each executor traces one transaction in --trace_rate
+ *  and appends a record per row the transaction read or wrote to its own
+ *  file, <trace_path>/<coordinator id>_<worker id>.trace, so that tracing
+ *  takes no lock. An aborted transaction is traced with its outcome, and a
+ *  retry is another transaction. The records of a transaction are
+ *  contiguous, the reads first.
+ *
+ *  record: [ timestamp (64) | transaction id (64) | key hash (64) |
+ *            coordinator id (32) | worker id (32) | table id (32) |
+ *            partition id (32) | write (8) | outcome (8) ]
+ *
+ *  The timestamp is in nanoseconds since the coordinator started, see Time,
+ *  and the transaction id counts the transactions of the worker.
+ */
+
+enum class AccessOutcome : uint8_t {
+  COMMIT,
+  ABORT_LOCK,
+  ABORT_READ_VALIDATION,
+  ABORT_NO_RETRY
+};
+
+struct AccessTraceRecord {
+  uint64_t timestamp;
+  uint64_t transaction_id;
+  uint64_t key_hash;
+  uint32_t coordinator_id;
+  uint32_t worker_id;
+  uint32_t table_id;
+  uint32_t partition_id;
+  uint8_t write;
+  uint8_t outcome;
+};
+
+class AccessTrace {
+public:
+  static constexpr std::size_t RECORD_SIZE =
+      sizeof(uint64_t) * 3 + sizeof(uint32_t) * 4 + sizeof(uint8_t) * 2;
+
+  AccessTrace(const std::string &trace_path, std::size_t coordinator_id,
+              std::size_t worker_id, std::size_t rate)
+      : coordinator_id(coordinator_id), worker_id(worker_id), rate(rate),
+        writer(file_name(trace_path, coordinator_id, worker_id).c_str()) {
+    CHECK(rate > 0);
+  }
+
+  static std::string file_name(const std::string &trace_path,
+                               std::size_t coordinator_id,
+                               std::size_t worker_id) {
+    return trace_path + "/" + std::to_string(coordinator_id) + "_" +
+           std::to_string(worker_id) + ".trace";
+  }
+
+  // called by the executor once a transaction commits or aborts
+  template <class DatabaseType, class TransactionType>
+  void trace(DatabaseType &db, TransactionType &txn, AccessOutcome outcome) {
+    if (n_transactions++ % rate != 0) {
+      return;
+    }
+    auto timestamp = Time::now();
+    bytes.clear();
+    for (auto &readKey : txn.readSet) {
+      append(db, readKey, timestamp, false, outcome);
+    }
+    for (auto &writeKey : txn.writeSet) {
+      append(db, writeKey, timestamp, true, outcome);
+    }
+    writer.write(bytes.data(), bytes.size());
+  }
+
+  void close() { writer.close(); }
+
+  // FNV-1a of the key
+  static uint64_t key_hash(const void *key, std::size_t size) {
+    auto p = static_cast<const unsigned char *>(key);
+    uint64_t hash = 14695981039346656037ull;
+    for (auto i = 0u; i < size; i++) {
+      hash = (hash ^ p[i]) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+  static void encode(std::string &bytes, const AccessTraceRecord &record) {
+    Encoder enc(bytes);
+    enc << record.timestamp << record.transaction_id << record.key_hash
+        << record.coordinator_id << record.worker_id << record.table_id
+        << record.partition_id << record.write << record.outcome;
+  }
+
+  // returns false if there is no complete record left in bytes
+  static bool next(StringPiece &bytes, AccessTraceRecord &record) {
+    if (bytes.size() < RECORD_SIZE) {
+      return false;
+    }
+    Decoder dec(bytes);
+    dec >> record.timestamp >> record.transaction_id >> record.key_hash >>
+        record.coordinator_id >> record.worker_id >> record.table_id >>
+        record.partition_id >> record.write >> record.outcome;
+    bytes.remove_prefix(RECORD_SIZE);
+    return true;
+  }
+
+  // returns false if the file cannot be read
+  static bool read(const std::string &filename,
+                   std::vector<AccessTraceRecord> &records) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    StringPiece piece(bytes);
+    AccessTraceRecord record;
+    while (next(piece, record)) {
+      records.push_back(record);
+    }
+    return true;
+  }
+
+private:
+  template <class DatabaseType, class KeyType>
+  void append(DatabaseType &db, KeyType &key, uint64_t timestamp, bool write,
+              AccessOutcome outcome) {
+    auto table = db.find_table(key.get_table_id(), key.get_partition_id());
+    AccessTraceRecord record;
+    record.timestamp = timestamp;
+    record.transaction_id = n_transactions - 1;
+    record.key_hash = key_hash(key.get_key(), table->key_size());
+    record.coordinator_id = coordinator_id;
+    record.worker_id = worker_id;
+    record.table_id = key.get_table_id();
+    record.partition_id = key.get_partition_id();
+    record.write = write;
+    record.outcome = static_cast<uint8_t>(outcome);
+    encode(bytes, record);
+  }
+
+private:
+  uint32_t coordinator_id, worker_id;
+  std::size_t rate;
+  uint64_t n_transactions = 0;
+  std::string bytes;
+  BufferedFileWriter writer;
+};
+} // namespace coco
@@ -0,0 +1,106 @@
+//
+// Created by Yi Lu on 3/24/19.
+//
+
+#pragma once
+
+#include "core/EarlyValidation.h"
+#include "core/Table.h"
+
+#include <cstdint>
+#include <glog/logging.h>
+#include <unordered_map>
+
+namespace coco {
+
+/*
+ * With --adaptive_locking, Silo locks the hot rows a transaction reads for
+ * update while it executes, as TwoPL does, and the other rows stay
+ * optimistic, see Silo::lock_for_update. A transaction waits for a hot row
+ * held by others instead of reading it and failing at commit.
+ *
+ * Each worker scores the rows that aborted its transactions, a row is hot
+ * while its score is at least the threshold. Every WINDOW transactions the
+ * scores are halved, so that a row that no longer aborts transactions turns
+ * optimistic again, and the threshold adapts to the aborts of the window:
+ * it goes down while more than HIGH_ABORTS of the transactions abort, i.e.,
+ * more rows are locked, and up while less than LOW_ABORTS abort.
+ *
+ * A row is known by a hash of its table, partition and key, see
+ * EarlyValidation::hash, a collision only locks a cold row.
+ */
+
+class AdaptiveLocking {
+public:
+  static constexpr std::size_t WINDOW = 1024;
+  static constexpr uint32_t MIN_THRESHOLD = 1, MAX_THRESHOLD = 64;
+  static constexpr double HIGH_ABORTS = 0.1, LOW_ABORTS = 0.02;
+
+  explicit AdaptiveLocking(uint32_t threshold = 2) : threshold(threshold) {
+    CHECK(threshold >= MIN_THRESHOLD && threshold <= MAX_THRESHOLD);
+  }
+
+  // called once a transaction aborts because of the row of key
+  void conflict(ITable &table, const void *key) {
+    scores[EarlyValidation::hash(table.tableID(), table.partitionID(), key,
+                                 table.key_size())]++;
+  }
+
+  bool is_hot(ITable &table, const void *key) const {
+    auto it = scores.find(EarlyValidation::hash(
+        table.tableID(), table.partitionID(), key, table.key_size()));
+    return it != scores.end() && it->second >= threshold;
+  }
+
+  // called once a transaction commits or aborts
+  void on_transaction(bool committed) {
+    n_transactions++;
+    if (!committed) {
+      n_aborts++;
+    }
+    if (n_transactions == WINDOW) {
+      adapt();
+    }
+  }
+
+  void on_lock() { n_locks++; }
+
+  uint32_t get_threshold() const { return threshold; }
+
+  uint64_t get_locks() const { return n_locks; }
+
+  std::size_t n_hot() const {
+    std::size_t n = 0;
+    for (auto &score : scores) {
+      n += score.second >= threshold;
+    }
+    return n;
+  }
+
+private:
+  void adapt() {
+    double aborts = double(n_aborts) / n_transactions;
+    if (aborts > HIGH_ABORTS && threshold > MIN_THRESHOLD) {
+      threshold--;
+    } else if (aborts < LOW_ABORTS && threshold < MAX_THRESHOLD) {
+      threshold++;
+    }
+    for (auto it = scores.begin(); it != scores.end();) {
+      it->second /= 2;
+      if (it->second == 0) {
+        it = scores.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    n_transactions = n_aborts = 0;
+  }
+
+private:
+  uint32_t threshold;
+  // the hashes of the rows that aborted transactions and their scores
+  std::unordered_map<uint64_t, uint32_t> scores;
+  std::size_t n_transactions = 0, n_aborts = 0;
+  uint64_t n_locks = 0;
+};
+} // namespace coco
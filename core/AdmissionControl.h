@@ -0,0 +1,111 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <glog/logging.h>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace coco {
+
+/*
+ * With --ingress_target_delay, an IngressServer sheds load once the ingress
+ * queue of an executor has a standing delay, in the manner of CoDel, instead
+ * of admitting requests that would only wait in the queue, see
+ * IngressServer::admit.
+ *
+ * An executor measures the sojourn of each request it pops, the time since
+ * the server received it. Once the sojourn stays above the target for
+ * --ingress_interval, i.e., the queue does not drain between bursts, the
+ * queue is overloaded and takes no new requests. It takes them again once a
+ * request is popped below the target or the queue is found empty. The state
+ * of a queue is written by its executor only and read by the server thread.
+ */
+
+class AdmissionControl {
+public:
+  // the times are in us, no control with a target of 0
+  void init(std::size_t n_queues, uint64_t target, uint64_t interval) {
+    this->n_queues = n_queues;
+    this->target = target;
+    this->interval = interval;
+    // new Queue[] is not aligned to the cache line in C++14
+    void *ptr = nullptr;
+    int err = posix_memalign(&ptr, alignof(Queue), n_queues * sizeof(Queue));
+    CHECK(err == 0);
+    queues.reset(static_cast<Queue *>(ptr));
+    for (auto i = 0u; i < n_queues; i++) {
+      new (&queues[i]) Queue();
+    }
+  }
+
+  bool enabled() const { return target > 0; }
+
+  // called by the consumer of queue i, which popped a request that waited
+  // sojourn us, at now us
+  void on_pop(std::size_t i, uint64_t sojourn, uint64_t now) {
+    DCHECK(i < n_queues);
+    auto &q = queues[i];
+    if (sojourn < target) {
+      q.first_above = 0;
+      set_overloaded(q, false);
+    } else if (q.first_above == 0) {
+      q.first_above = now + interval;
+    } else if (now >= q.first_above) {
+      set_overloaded(q, true);
+    }
+  }
+
+  // called by the consumer of queue i, which found it empty
+  void on_empty(std::size_t i) {
+    DCHECK(i < n_queues);
+    auto &q = queues[i];
+    q.first_above = 0;
+    set_overloaded(q, false);
+  }
+
+  // called by the producer
+  bool overloaded(std::size_t i) const {
+    DCHECK(i < n_queues);
+    return queues[i].overloaded.load(std::memory_order_relaxed);
+  }
+
+  // the # of times a queue became overloaded
+  uint64_t get_n_overloads() const { return n_overloads.load(); }
+
+private:
+  struct alignas(64) Queue {
+    // when the sojourn is above the target for an interval, 0 if it is not
+    uint64_t first_above = 0;
+    std::atomic<bool> overloaded{false};
+  };
+
+  static_assert(std::is_trivially_destructible<Queue>::value,
+                "queues are freed without being destroyed.");
+
+  struct FreeDeleter {
+    void operator()(Queue *ptr) const { free(ptr); }
+  };
+
+  void set_overloaded(Queue &q, bool overloaded) {
+    if (q.overloaded.load(std::memory_order_relaxed) != overloaded) {
+      q.overloaded.store(overloaded, std::memory_order_relaxed);
+      if (overloaded) {
+        n_overloads.fetch_add(1);
+      }
+    }
+  }
+
+private:
+  std::size_t n_queues = 0;
+  uint64_t target = 0, interval = 0;
+  std::unique_ptr<Queue[], FreeDeleter> queues;
+  std::atomic<uint64_t> n_overloads{0};
+};
+} // namespace coco
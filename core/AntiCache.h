@@ -0,0 +1,97 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Table.h"
+
+#include <atomic>
+#include <chrono>
+#include <glog/logging.h>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --anti_cache_path, the tables in --anti_cache_tables are evictable
+ * tables, see EvictableTable, and AntiCache runs in the background on the
+ * partitions this coordinator masters. Each second, it advances the
+ * AccessClock and evicts the rows not accessed in the last
+ * --anti_cache_seconds seconds to a file under the path, e.g., on an NVMe
+ * drive. In between, it reads back the evicted rows transactions looked up.
+ *
+ * A transaction that touches an evicted row aborts, on the row lock or in
+ * its validation, and is retried once the row is back in memory. So the
+ * memory of a table follows its hot rows, and cold rows cost a retry.
+ */
+
+class AntiCache {
+public:
+  static constexpr int64_t FETCH_INTERVAL_US = 100;
+
+  AntiCache(std::size_t coordinator_id, std::vector<ITable *> tables,
+            std::size_t seconds, std::atomic<bool> &stopFlag)
+      : coordinator_id(coordinator_id), tables(std::move(tables)),
+        seconds(seconds), stopFlag(stopFlag) {}
+
+  // returns the number of rows evicted
+  std::size_t evict() {
+    uint32_t now = ++AccessClock::now();
+    if (now <= seconds) {
+      return 0;
+    }
+    std::size_t n = 0;
+    for (auto table : tables) {
+      n += table->evict(now - seconds);
+    }
+    n_evicted += n;
+    return n;
+  }
+
+  // returns the number of rows read back
+  std::size_t fetch() {
+    std::size_t n = 0;
+    for (auto table : tables) {
+      n += table->fetch();
+    }
+    n_fetched += n;
+    return n;
+  }
+
+  void start() {
+    LOG(INFO) << "AntiCache on coordinator " << coordinator_id << " starts, "
+              << tables.size() << " tables.";
+
+    auto next = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (!stopFlag.load()) {
+      if (fetch() == 0) {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(FETCH_INTERVAL_US));
+      }
+      if (std::chrono::steady_clock::now() >= next) {
+        auto n = evict();
+        if (n > 0) {
+          LOG(INFO) << "AntiCache on coordinator " << coordinator_id
+                    << " evicted " << n << " rows, " << n_fetched
+                    << " rows read back so far.";
+        }
+        next += std::chrono::seconds(1);
+      }
+    }
+
+    LOG(INFO) << "AntiCache on coordinator " << coordinator_id << " evicted "
+              << n_evicted << " rows, read back " << n_fetched
+              << " rows, exits.";
+  }
+
+private:
+  std::size_t coordinator_id;
+  std::vector<ITable *> tables;
+  std::size_t seconds;
+  std::atomic<bool> &stopFlag;
+  std::size_t n_evicted = 0;
+  std::size_t n_fetched = 0;
+};
+} // namespace coco
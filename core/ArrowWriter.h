@@ -0,0 +1,365 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/BufferedFileWriter.h"
+#include "common/RateLimiter.h"
+#include "core/FieldLayout.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <glog/logging.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace coco {
+
+/*
+ * FlatBufferBuilder builds the little flatbuffers of the Arrow IPC format,
+ * back to front as the flatbuffers library does, so that an object only
+ * refers to objects built before it, which end up after it in the buffer.
+ * An object is identified by its distance from the end of the buffer.
+ */
+
+class FlatBufferBuilder {
+public:
+  using Offset = uint32_t;
+
+  Offset size() const { return bytes.size(); }
+
+  template <class T> void add(T v) {
+    align(sizeof(T), sizeof(T));
+    prepend(&v, sizeof(T));
+  }
+
+  void add_offset(Offset o) {
+    align(sizeof(Offset), sizeof(Offset));
+    add<Offset>(size() + sizeof(Offset) - o);
+  }
+
+  Offset string(const std::string &s) {
+    align(s.size() + 1, sizeof(uint32_t));
+    bytes.push_back(0);
+    prepend(s.data(), s.size());
+    add<uint32_t>(s.size());
+    return size();
+  }
+
+  // a vector of tables
+  Offset offsets(const std::vector<Offset> &os) {
+    align(os.size() * sizeof(Offset), sizeof(Offset));
+    for (auto it = os.rbegin(); it != os.rend(); it++) {
+      add_offset(*it);
+    }
+    add<uint32_t>(os.size());
+    return size();
+  }
+
+  // a vector of structs of words, e.g., Buffer, of n words each
+  Offset structs(const std::vector<uint64_t> &words, std::size_t n) {
+    align(words.size() * sizeof(uint64_t), sizeof(uint64_t));
+    for (auto it = words.rbegin(); it != words.rend(); it++) {
+      add<uint64_t>(*it);
+    }
+    add<uint32_t>(words.size() / n);
+    return size();
+  }
+
+  void start_table() {
+    fields.clear();
+    table_start = size();
+  }
+
+  template <class T> void field(uint16_t id, T v) {
+    add(v);
+    fields.emplace_back(id, size());
+  }
+
+  void field_offset(uint16_t id, Offset o) {
+    add_offset(o);
+    fields.emplace_back(id, size());
+  }
+
+  // the vtable goes right before the table
+  Offset end_table() {
+    add<int32_t>(0);
+    Offset table = size();
+    uint16_t n = 0;
+    for (auto &f : fields) {
+      n = std::max<uint16_t>(n, f.first + 1);
+    }
+    std::vector<uint16_t> vtable(2 + n, 0);
+    vtable[0] = vtable.size() * sizeof(uint16_t);
+    vtable[1] = table - table_start;
+    for (auto &f : fields) {
+      vtable[2 + f.first] = table - f.second;
+    }
+    for (auto it = vtable.rbegin(); it != vtable.rend(); it++) {
+      add<uint16_t>(*it);
+    }
+    vtables.emplace_back(table, size() - table);
+    return table;
+  }
+
+  // the buffer with root at its start
+  std::string finish(Offset root) {
+    align(sizeof(Offset), min_align);
+    add_offset(root);
+    std::string buffer(bytes.rbegin(), bytes.rend());
+    for (auto &vtable : vtables) {
+      std::memcpy(&buffer[buffer.size() - vtable.first], &vtable.second,
+                  sizeof(int32_t));
+    }
+    return buffer;
+  }
+
+private:
+  // pads so that the next n bytes end aligned
+  void align(std::size_t n, std::size_t alignment) {
+    min_align = std::max(min_align, alignment);
+    auto padding = (alignment - (size() + n) % alignment) % alignment;
+    bytes.append(padding, 0);
+  }
+
+  // the bytes are kept reversed
+  void prepend(const void *data, std::size_t n) {
+    auto p = static_cast<const char *>(data);
+    for (auto i = n; i > 0; i--) {
+      bytes.push_back(p[i - 1]);
+    }
+  }
+
+private:
+  std::string bytes;
+  std::size_t min_align = 1;
+  Offset table_start = 0;
+  std::vector<std::pair<uint16_t, Offset>> fields;
+  // the tables and the offsets of their vtables
+  std::vector<std::pair<Offset, int32_t>> vtables;
+};
+
+/*
+ * ArrowWriter writes the rows of a table partition to a file in the Arrow IPC
+ * file format, e.g., pyarrow.ipc.open_file(), one column per Column of the
+ * table. The rows are written in record batches of BATCH_ROWS rows, so that
+ * only one batch is in memory.
+ *
+ * An integer or a float column keeps its type, a FixedString is a fixed size
+ * binary of its chars without the \0, and any other field is a fixed size
+ * binary of its bytes. No column has nulls. The pairs of metadata, e.g., the
+ * epoch of a snapshot, are the custom metadata of the schema.
+ *
+ * The file is written to <filename>.tmp and renamed once closed.
+ */
+
+class ArrowWriter {
+public:
+  static constexpr std::size_t BATCH_ROWS = 1 << 16;
+
+  ArrowWriter(const std::string &filename, std::vector<Column> columns,
+              std::vector<std::pair<std::string, std::string>> metadata,
+              RateLimiter *limiter = nullptr)
+      : filename(filename), tmp_filename(filename + ".tmp"),
+        writer(tmp_filename.c_str()), columns(std::move(columns)),
+        metadata(std::move(metadata)), limiter(limiter),
+        batch(this->columns.size()) {
+    write(std::string("ARROW1\0\0", 8));
+    FlatBufferBuilder b;
+    write_message(b, MESSAGE_SCHEMA, schema(b), "");
+  }
+
+  void append(const void *key, const void *value) {
+    for (auto i = 0u; i < columns.size(); i++) {
+      auto &column = columns[i];
+      auto row = static_cast<const char *>(column.key ? key : value);
+      batch[i].append(row + column.offset, width(column));
+    }
+    if (++n_batch_rows == BATCH_ROWS) {
+      write_batch();
+    }
+  }
+
+  // the # of rows so far
+  std::size_t size() const { return n_rows; }
+
+  // the bytes written so far
+  std::size_t bytes() const { return offset; }
+
+  void close() {
+    if (n_batch_rows > 0) {
+      write_batch();
+    }
+    // the end of the stream
+    write_word(CONTINUATION);
+    write_word(0);
+
+    FlatBufferBuilder b;
+    auto s = schema(b);
+    auto dictionaries = b.structs({}, 3);
+    auto batches = b.structs(blocks, 3);
+    b.start_table();
+    b.field<int16_t>(0, METADATA_V5);
+    b.field_offset(1, s);
+    b.field_offset(2, dictionaries);
+    b.field_offset(3, batches);
+    auto footer = b.finish(b.end_table());
+    write(footer);
+    write_word(footer.size());
+    write("ARROW1");
+
+    writer.close();
+    int err = std::rename(tmp_filename.c_str(), filename.c_str());
+    CHECK(err == 0) << "failed to rename " << tmp_filename << ", errno: "
+                    << errno;
+  }
+
+private:
+  // Arrow's enums, see Schema.fbs and Message.fbs
+  static constexpr int16_t METADATA_V5 = 4;
+  static constexpr uint8_t MESSAGE_SCHEMA = 1, MESSAGE_RECORD_BATCH = 3;
+  static constexpr uint8_t TYPE_INT = 2, TYPE_FLOATING_POINT = 3,
+                           TYPE_FIXED_SIZE_BINARY = 15;
+  static constexpr int16_t PRECISION_SINGLE = 1, PRECISION_DOUBLE = 2;
+  static constexpr uint32_t CONTINUATION = 0xFFFFFFFF;
+
+  static bool is_int(const Column &column) {
+    return (column.type == FieldType::INT || column.type == FieldType::UINT) &&
+           (column.length == 1 || column.length == 2 || column.length == 4 ||
+            column.length == 8);
+  }
+
+  static bool is_float(const Column &column) {
+    return column.type == FieldType::FLOAT &&
+           (column.length == 4 || column.length == 8);
+  }
+
+  static std::size_t width(const Column &column) {
+    return column.type == FieldType::STRING ? column.length - 1
+                                            : column.length;
+  }
+
+  static std::size_t padded(std::size_t n) { return (n + 7) / 8 * 8; }
+
+  FlatBufferBuilder::Offset schema(FlatBufferBuilder &b) {
+    std::vector<FlatBufferBuilder::Offset> fields, pairs;
+    for (auto &column : columns) {
+      auto name = b.string(column.name);
+      auto children = b.offsets({});
+      uint8_t type_type;
+      b.start_table();
+      if (is_int(column)) {
+        type_type = TYPE_INT;
+        b.field<int32_t>(0, column.length * 8);
+        b.field<uint8_t>(1, column.type == FieldType::INT);
+      } else if (is_float(column)) {
+        type_type = TYPE_FLOATING_POINT;
+        b.field<int16_t>(0, column.length == 4 ? PRECISION_SINGLE
+                                                 : PRECISION_DOUBLE);
+      } else {
+        type_type = TYPE_FIXED_SIZE_BINARY;
+        b.field<int32_t>(0, width(column));
+      }
+      auto type = b.end_table();
+      b.start_table();
+      b.field_offset(0, name);
+      b.field<uint8_t>(1, 0);
+      b.field<uint8_t>(2, type_type);
+      b.field_offset(3, type);
+      b.field_offset(5, children);
+      fields.push_back(b.end_table());
+    }
+    for (auto &pair : metadata) {
+      auto key = b.string(pair.first);
+      auto value = b.string(pair.second);
+      b.start_table();
+      b.field_offset(0, key);
+      b.field_offset(1, value);
+      pairs.push_back(b.end_table());
+    }
+    auto field_vector = b.offsets(fields);
+    auto pair_vector = b.offsets(pairs);
+    b.start_table();
+    b.field<int16_t>(0, 0); // little endian
+    b.field_offset(1, field_vector);
+    b.field_offset(2, pair_vector);
+    return b.end_table();
+  }
+
+  void write_batch() {
+    std::string body;
+    std::vector<uint64_t> nodes, buffers;
+    for (auto i = 0u; i < columns.size(); i++) {
+      nodes.insert(nodes.end(), {n_batch_rows, 0});
+      // no validity bitmap, then the values
+      buffers.insert(buffers.end(), {body.size(), 0, body.size(),
+                                     batch[i].size()});
+      body.append(batch[i]);
+      body.append(padded(body.size()) - body.size(), 0);
+      batch[i].clear();
+    }
+
+    FlatBufferBuilder b;
+    auto node_vector = b.structs(nodes, 2);
+    auto buffer_vector = b.structs(buffers, 2);
+    b.start_table();
+    b.field<int64_t>(0, n_batch_rows);
+    b.field_offset(1, node_vector);
+    b.field_offset(2, buffer_vector);
+    auto block_offset = offset;
+    auto metadata_size = write_message(b, MESSAGE_RECORD_BATCH,
+                                       b.end_table(), body);
+    blocks.insert(blocks.end(), {block_offset, metadata_size, body.size()});
+    n_rows += n_batch_rows;
+    n_batch_rows = 0;
+  }
+
+  // returns the size of the metadata with its prefix
+  std::size_t write_message(FlatBufferBuilder &b, uint8_t header_type,
+                            FlatBufferBuilder::Offset header,
+                            const std::string &body) {
+    b.start_table();
+    b.field<int16_t>(0, METADATA_V5);
+    b.field<uint8_t>(1, header_type);
+    b.field_offset(2, header);
+    b.field<int64_t>(3, body.size());
+    auto message = b.finish(b.end_table());
+    auto size = padded(message.size());
+    write_word(CONTINUATION);
+    write_word(size);
+    write(message);
+    write(std::string(size - message.size(), 0));
+    write(body);
+    return 2 * sizeof(uint32_t) + size;
+  }
+
+  void write_word(uint32_t word) {
+    write(std::string(reinterpret_cast<const char *>(&word), sizeof(word)));
+  }
+
+  void write(const std::string &bytes) {
+    writer.write(bytes.data(), bytes.size());
+    offset += bytes.size();
+    if (limiter != nullptr) {
+      limiter->consume(bytes.size());
+    }
+  }
+
+private:
+  std::string filename, tmp_filename;
+  BufferedFileWriter writer;
+  std::vector<Column> columns;
+  std::vector<std::pair<std::string, std::string>> metadata;
+  RateLimiter *limiter;
+  // the values of each column in the batch
+  std::vector<std::string> batch;
+  std::size_t n_batch_rows = 0, n_rows = 0, offset = 0;
+  // the offset, the metadata size and the body size of each batch
+  std::vector<uint64_t> blocks;
+};
+} // namespace coco
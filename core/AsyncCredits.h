@@ -0,0 +1,139 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/Message.h"
+#include "common/MessagePiece.h"
+#include "core/ControlMessage.h"
+#include "core/Table.h"
+
+#include <cstdint>
+#include <functional>
+#include <glog/logging.h>
+#include <limits>
+#include <vector>
+
+namespace coco {
+
+/*
+ * Credit based flow control of asynchronous replication, see
+ * --async_credits. A worker may have up to credits bytes of asynchronous
+ * messages in flight to each coordinator. Each message it sends ends with a
+ * credit request of its size, and the worker of the same id on the
+ * destination returns the credits in a response on the synchronous lane once
+ * it has handled the message. A message that does not fit in the credits
+ * left is kept in async_messages and sent by a later flush, so a replica that
+ * falls behind slows down replication instead of filling up the outgoing
+ * queues and the dispatchers. A message larger than the credits is sent once
+ * nothing else is in flight.
+ *
+ * Only the worker touches the credits, the responses are handled in its
+ * process_request(). With UNLIMITED credits, a message is never deferred and
+ * the requests only tell when the messages are handled, see in_flight().
+ */
+
+class AsyncCredits {
+public:
+  static constexpr std::size_t UNLIMITED = std::numeric_limits<int64_t>::max();
+
+  AsyncCredits(std::size_t coordinator_num, std::size_t credits)
+      : credits(credits), available(coordinator_num, credits) {}
+
+  bool enabled() const { return credits > 0; }
+
+  // if a destination has not handled all the messages sent to it
+  bool in_flight() const {
+    for (auto i = 0u; i < available.size(); i++) {
+      if (available[i] != static_cast<int64_t>(credits)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // appends a credit request to message and takes its size from the credits
+  // of its destination, returns false if it does not fit unless force is set
+  bool acquire(Message &message, bool force) {
+    auto dest = message.get_dest_node_id();
+    DCHECK(dest < available.size());
+    uint64_t size = message.get_message_length() +
+                    MessagePiece::get_header_size() + sizeof(uint64_t);
+    if (!force && available[dest] < static_cast<int64_t>(size) &&
+        available[dest] != static_cast<int64_t>(credits)) {
+      return false;
+    }
+    available[dest] -= size;
+    new_request_message(message, size);
+    DCHECK(message.get_message_length() == size);
+    return true;
+  }
+
+  int64_t get_available(std::size_t dest) const { return available[dest]; }
+
+  static std::size_t new_request_message(Message &message, uint64_t size) {
+    /*
+     * The structure of an async credit request: (size : uint64_t)
+     */
+
+    // the message is not associated with a table or a partition, use 0.
+    auto message_size = MessagePiece::get_header_size() + sizeof(size);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::ASYNC_CREDIT_REQUEST),
+        message_size, 0, 0);
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder << size;
+    message.flush();
+    return message_size;
+  }
+
+  template <class TransactionType>
+  void set_message_handlers(
+      std::vector<std::function<void(MessagePiece, Message &, ITable &,
+                                     TransactionType *)>> &handlers) {
+
+    handlers[static_cast<int>(ControlMessage::ASYNC_CREDIT_REQUEST)] =
+        [](MessagePiece inputPiece, Message &responseMessage, ITable &table,
+           TransactionType *txn) {
+          /*
+           * The structure of an async credit request: (size : uint64_t)
+           * The structure of an async credit response: (size : uint64_t)
+           */
+          uint64_t size;
+          Decoder dec(inputPiece.toStringPiece());
+          dec >> size;
+
+          auto message_size = MessagePiece::get_header_size() + sizeof(size);
+          auto message_piece_header =
+              MessagePiece::construct_message_piece_header(
+                  static_cast<uint32_t>(ControlMessage::ASYNC_CREDIT_RESPONSE),
+                  message_size, 0, 0);
+
+          Encoder encoder(responseMessage.data);
+          encoder << message_piece_header;
+          encoder << size;
+          responseMessage.flush();
+        };
+
+    handlers[static_cast<int>(ControlMessage::ASYNC_CREDIT_RESPONSE)] =
+        [this](MessagePiece inputPiece, Message &responseMessage,
+               ITable &table, TransactionType *txn) {
+          uint64_t size;
+          Decoder dec(inputPiece.toStringPiece());
+          dec >> size;
+          // the response message goes back to the coordinator that returned
+          // the credits
+          available[responseMessage.get_dest_node_id()] += size;
+        };
+  }
+
+private:
+  std::size_t credits;
+  // may be negative if a flush is forced
+  std::vector<int64_t> available;
+};
+} // namespace coco
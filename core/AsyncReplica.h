@@ -0,0 +1,272 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Histogram.h"
+#include "common/Socket.h"
+#include "core/Context.h"
+#include "core/Partitioner.h"
+#include "core/RedoLog.h"
+#include "core/ReplicaShipper.h"
+#include "core/Table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <deque>
+#include <glog/logging.h>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  With --async_replica_role, this process is an asynchronous replica of
+ *  every partition, e.g., a disaster recovery copy in another region. It
+ *  runs on its own, --servers has its address only, and it is not a peer of
+ *  the coordinators, so it takes no part in the barrier of group commit.
+ *
+ *  1. Each coordinator connects to --async_replica and streams its epochs,
+ *     see ReplicaShipper, which are decompressed by a thread per
+ *     coordinator.
+ *  2. An epoch is applied once it has arrived from every coordinator, and
+ *     the epochs that are ready are applied as one batch: the records are
+ *     bucketed by table partition, and each thread applies a set of table
+ *     partitions. As in Recovery, a record is applied only if its commit
+ *     timestamp is larger than the row's, so the order within a batch does
+ *     not matter.
+ *  3. Every second, the epochs applied and received are logged with the lag,
+ *     the time from an epoch being durable on the last coordinator to being
+ *     applied, which assumes the clocks of the nodes are in sync.
+ */
+
+template <class Database> class AsyncReplica {
+public:
+  AsyncReplica(Database &db, const Context &context)
+      : db(db), context(context),
+        partitioner(PartitionerFactory::create_partitioner(
+            context.partitioner, 0, context.coordinator_num)) {
+    tables = db.local_tables(*partitioner);
+    for (auto i = 0u; i < tables.size(); i++) {
+      table_index[table_key(tables[i]->tableID(), tables[i]->partitionID())] =
+          i;
+    }
+  }
+
+  void start() {
+    std::vector<std::string> addressPort;
+    boost::algorithm::split(addressPort, context.async_replica,
+                            boost::is_any_of(":"));
+    CHECK(addressPort.size() == 2)
+        << "--async_replica is host:port, not " << context.async_replica;
+
+    Listener l(addressPort[0].c_str(), atoi(addressPort[1].c_str()), 100);
+    LOG(INFO) << "AsyncReplica listening on " << context.async_replica;
+
+    // the first coordinator tells how many there are
+    std::vector<Socket> sources;
+    std::size_t coordinator_num = 1;
+    for (auto i = 0u; i < coordinator_num; i++) {
+      Socket socket = l.accept();
+      std::size_t c_id, partition_num;
+      socket.read_number(c_id);
+      socket.read_number(coordinator_num);
+      socket.read_number(partition_num);
+      CHECK(partition_num == context.partition_num)
+          << "the coordinators have " << partition_num << " partitions, not "
+          << context.partition_num << ".";
+      sources.resize(coordinator_num);
+      CHECK(c_id < coordinator_num);
+      sources[c_id] = std::move(socket);
+    }
+    l.close();
+
+    LOG(INFO) << "AsyncReplica connected to " << coordinator_num
+              << " coordinators, " << tables.size() << " tables.";
+    replicate(sources);
+  }
+
+  // applies the streams of sources until all of them are closed
+  void replicate(std::vector<Socket> &sources) {
+    frames.resize(sources.size());
+    n_closed.store(0);
+
+    std::vector<std::thread> readers;
+    for (auto i = 0u; i < sources.size(); i++) {
+      readers.emplace_back([this, &sources, i]() {
+        ReplicationFrame frame;
+        while (ReplicationFrame::read(sources[i], frame)) {
+          std::lock_guard<std::mutex> guard(mutex);
+          frames[i].push_back(std::move(frame));
+        }
+        sources[i].close();
+        n_closed.fetch_add(1);
+      });
+    }
+
+    auto last_report = std::chrono::steady_clock::now();
+    for (;;) {
+      // the frames read before the last stream closed are applied
+      bool closed = n_closed.load() == sources.size();
+      auto batch = next_batch();
+      if (!batch.empty()) {
+        apply(batch);
+      } else if (closed) {
+        break;
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+
+      auto now = std::chrono::steady_clock::now();
+      if (now - last_report >= std::chrono::seconds(1)) {
+        last_report = now;
+        log_lag("", lag);
+        lag.clear();
+      }
+    }
+
+    for (auto &t : readers) {
+      t.join();
+    }
+
+    // an epoch not shipped by every coordinator was never complete
+    std::size_t n_dropped = 0;
+    for (auto &source : frames) {
+      n_dropped += source.size();
+    }
+    log_lag("total ", total_lag);
+    LOG(INFO) << "AsyncReplica dropped " << n_dropped
+              << " frames of incomplete epochs.";
+  }
+
+  uint64_t applied_epochs() const { return n_applied_epochs; }
+
+  uint64_t applied_records() const { return n_applied_records; }
+
+private:
+  static uint64_t table_key(uint64_t table_id, uint64_t partition_id) {
+    return (table_id << 32) | partition_id;
+  }
+
+  // call func(i) for i in [0, n) on worker_num threads
+  template <class Func> void parallel_for(std::size_t n, Func func) {
+    std::size_t threadsNum = context.worker_num;
+    std::vector<std::thread> v;
+    for (auto threadID = 0u; threadID < threadsNum; threadID++) {
+      v.emplace_back([=]() {
+        for (auto i = threadID; i < n; i += threadsNum) {
+          func(i);
+        }
+      });
+    }
+    for (auto &t : v) {
+      t.join();
+    }
+  }
+
+  // the frames of the epochs that arrived from every coordinator
+  std::vector<ReplicationFrame> next_batch() {
+    std::lock_guard<std::mutex> guard(mutex);
+    std::size_t n = frames[0].size();
+    for (auto &source : frames) {
+      n = std::min(n, source.size());
+    }
+    std::vector<ReplicationFrame> batch;
+    for (auto k = 0u; k < n; k++) {
+      for (auto &source : frames) {
+        DCHECK(source.front().epoch == n_applied_epochs + k);
+        batch.push_back(std::move(source.front()));
+        source.pop_front();
+      }
+    }
+    return batch;
+  }
+
+  void apply(const std::vector<ReplicationFrame> &batch) {
+    // records[frame][table]
+    std::vector<std::vector<std::vector<RedoLogRecord>>> records(batch.size());
+    parallel_for(batch.size(), [this, &batch, &records](std::size_t i) {
+      StringPiece piece(batch[i].records);
+      RedoLogRecord record;
+      records[i].resize(tables.size());
+      while (RedoLog::next(piece, record)) {
+        auto it =
+            table_index.find(table_key(record.table_id, record.partition_id));
+        CHECK(it != table_index.end())
+            << "table " << record.table_id << " partition "
+            << record.partition_id << " is missing on the async replica.";
+        records[i][it->second].push_back(record);
+      }
+    });
+
+    std::atomic<std::size_t> n_applied(0);
+    parallel_for(tables.size(), [this, &records, &n_applied](std::size_t i) {
+      ITable &table = *tables[i];
+      std::size_t n = 0;
+      for (auto &frame : records) {
+        for (auto &record : frame[i]) {
+          const void *key = record.key.data();
+          auto &tid = table.search_metadata(key);
+          if (record.commit_ts > tid.load()) {
+            table.deserialize_value(key, record.value);
+            tid.store(record.commit_ts);
+            n++;
+          }
+        }
+      }
+      n_applied.fetch_add(n);
+    });
+    n_applied_records += n_applied.load();
+
+    // the frames of an epoch are next to each other
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    auto n_sources = frames.size();
+    for (auto k = 0u; k < batch.size(); k += n_sources) {
+      uint64_t time = 0;
+      for (auto i = k; i < k + n_sources; i++) {
+        time = std::max(time, batch[i].time);
+      }
+      lag.add(now - time);
+      total_lag.add(now - time);
+    }
+    n_applied_epochs += batch.size() / n_sources;
+  }
+
+  void log_lag(const std::string &prefix, const Histogram &h) {
+    std::size_t n_received = 0;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      for (auto &source : frames) {
+        n_received = std::max(n_received, source.size());
+      }
+    }
+    LOG(INFO) << "AsyncReplica " << prefix << "applied " << n_applied_epochs
+              << " epochs (" << n_applied_epochs + n_received
+              << " received), " << n_applied_records
+              << " records, lag: " << h.nth(50) / 1000.0 << " ms (50%) "
+              << h.nth(99) / 1000.0 << " ms (99%) " << h.nth(100) / 1000.0
+              << " ms (max).";
+  }
+
+private:
+  Database &db;
+  const Context &context;
+  std::unique_ptr<Partitioner> partitioner;
+  std::vector<ITable *> tables;
+  std::unordered_map<uint64_t, std::size_t> table_index;
+  std::mutex mutex;
+  // the frames of each coordinator that are not applied yet
+  std::vector<std::deque<ReplicationFrame>> frames;
+  std::atomic<std::size_t> n_closed{0};
+  uint64_t n_applied_epochs = 0, n_applied_records = 0;
+  // in us, since the epoch was durable on the last coordinator
+  Histogram lag, total_lag;
+};
+} // namespace coco
@@ -0,0 +1,67 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <glog/logging.h>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --barrier=tree, the managers of group commit synchronize the epochs
+ * on a tree of the coordinators instead of through coordinator 0 and all to
+ * all. Coordinator 0 is the root, and coordinator i has the children
+ * i * fanout + 1 to i * fanout + fanout, so that a barrier takes O(log n)
+ * message delays and a manager sends and receives O(fanout) messages in it.
+ *
+ *  - START and EXIT go down the tree, a manager forwards them to its
+ *    children, see Manager::wait4_signal.
+ *  - STOP goes down as the trigger to stop the workers, up once a subtree is
+ *    stopped, and down again once all coordinators are, see
+ *    Manager::stop_barrier.
+ *  - ACK goes up once a subtree is cleaned up, and the release of pipelined
+ *    epochs goes down.
+ *
+ * The replication of a group does not travel with the stop messages along a
+ * tree, so the executors wait until their messages are handled before they
+ * stop, as with --direct_connections.
+ */
+
+class BarrierTree {
+public:
+  BarrierTree(std::size_t node_id, std::size_t n_nodes, std::size_t fanout)
+      : node_id(node_id) {
+    CHECK(fanout > 0);
+    CHECK(node_id < n_nodes);
+    parent_ = node_id == 0 ? 0 : (node_id - 1) / fanout;
+    for (auto i = node_id * fanout + 1;
+         i <= node_id * fanout + fanout && i < n_nodes; i++) {
+      children_.push_back(i);
+    }
+  }
+
+  bool is_root() const { return node_id == 0; }
+
+  // the parent of the root is itself
+  std::size_t parent() const { return parent_; }
+
+  const std::vector<std::size_t> &children() const { return children_; }
+
+  // the edges from the root to the deepest coordinator of n_nodes
+  static std::size_t height(std::size_t n_nodes, std::size_t fanout) {
+    std::size_t height = 0;
+    for (std::size_t last = n_nodes - 1; last > 0; last = (last - 1) / fanout) {
+      height++;
+    }
+    return height;
+  }
+
+private:
+  std::size_t node_id;
+  std::size_t parent_;
+  std::vector<std::size_t> children_;
+};
+} // namespace coco
@@ -0,0 +1,71 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Table.h"
+
+#include <atomic>
+#include <cstdint>
+#include <tuple>
+
+namespace coco {
+
+/*
+ * The local rows of a read set are validated in batches. The keys of up to
+ * BATCH_SIZE consecutive reads of the same table partition are looked up
+ * together with ITable::search_batch, which is a virtual call per batch
+ * instead of per key and overlaps the cache misses of the hash lookups, and
+ * then the tids are checked in the order of the read set. A read set of 100
+ * keys costs about a cache miss per batch rather than per key.
+ */
+
+class BatchValidation {
+public:
+  static constexpr std::size_t BATCH_SIZE = 16;
+
+  // calls check(i, tid) on the tid of each key i of keys with is_local(i),
+  // returns the first i that check fails on, or -1
+  template <class Database, class KeysType, class LocalFunc, class CheckFunc>
+  static int validate(Database &db, const KeysType &keys,
+                      LocalFunc &&is_local, CheckFunc &&check) {
+    int indices[BATCH_SIZE];
+    const void *batch_keys[BATCH_SIZE];
+    std::tuple<std::atomic<uint64_t> *, void *> rows[BATCH_SIZE];
+    ITable *table = nullptr;
+    std::size_t n = 0;
+
+    auto check_batch = [&]() {
+      if (n > 0) {
+        table->search_batch(batch_keys, rows, n);
+      }
+      for (auto k = 0u; k < n; k++) {
+        if (!check(indices[k], *std::get<0>(rows[k]))) {
+          return indices[k];
+        }
+      }
+      n = 0;
+      return -1;
+    };
+
+    for (auto i = 0u; i < keys.size(); i++) {
+      if (!is_local(i)) {
+        continue;
+      }
+      ITable *t =
+          db.find_table(keys[i].get_table_id(), keys[i].get_partition_id());
+      if (t != table || n == BATCH_SIZE) {
+        auto conflict = check_batch();
+        if (conflict >= 0) {
+          return conflict;
+        }
+        table = t;
+      }
+      indices[n] = i;
+      batch_keys[n++] = keys[i].get_key();
+    }
+    return check_batch();
+  }
+};
+} // namespace coco
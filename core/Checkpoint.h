@@ -0,0 +1,146 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#pragma once
+
+#include "common/BufferedFileWriter.h"
+#include "common/RateLimiter.h"
+#include "core/RedoLog.h"
+#include "core/Table.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace coco {
+
+/*
+ *  Checkpoint -- format --
+ *
+ *  A checkpoint of a table partition is the redo log of all its rows, i.e.,
+ *  one record per row carrying the row's timestamp, followed by an epoch
+ *  marker. A checkpoint without the trailing marker is incomplete. It is
+ *  written to a temporary file and renamed, so <log dir>/<table id>_<partition
+ *  id>.ckpt is always the latest complete checkpoint. The checkpoints are
+ *  striped by partition across the directories of --log_path, see
+ *  RedoLog::directory.
+ *
+ *  The marker holds the epoch the checkpoint starts at: it contains all writes
+ *  of earlier epochs, and possibly some later ones. Replaying the log on top
+ *  only applies a record if it is newer than the row (see Recovery).
+ *
+ *  Checkpoints are fuzzy. Each row is read optimistically, i.e., it is read
+ *  again if it is locked or its metadata changes while being serialized, so
+ *  every row is a committed version tagged with its write timestamp. The lock
+ *  bit (63) and Scar's read timestamp delta (bits 48 - 62) are not part of
+ *  the timestamp.
+ */
+
+class Checkpoint {
+public:
+  static std::string file_name(const std::string &log_path,
+                               std::size_t table_id,
+                               std::size_t partition_id) {
+    return RedoLog::directory(log_path, partition_id) + "/" +
+           std::to_string(table_id) + "_" + std::to_string(partition_id) +
+           ".ckpt";
+  }
+
+  static constexpr uint64_t LOCK_BIT = 1ull << 63;
+  static constexpr uint64_t TS_MASK = (1ull << 48) - 1;
+
+  // the write bandwidth is capped by limiter if it is not nullptr
+  static void write(ITable &table, const std::string &filename, uint64_t epoch,
+                    RateLimiter *limiter = nullptr) {
+    std::string tmp_filename = filename + ".tmp";
+    BufferedFileWriter writer(tmp_filename.c_str());
+    std::string bytes;
+
+    table.for_each_row([&](const void *key, ITable::MetaDataType &metadata,
+                           void *value) {
+      bytes.clear();
+      append_row(bytes, table, key, metadata, value);
+      writer.write(bytes.data(), bytes.size());
+      if (limiter != nullptr) {
+        limiter->consume(bytes.size());
+      }
+    });
+
+    bytes.clear();
+    RedoLog::append_epoch(bytes, epoch);
+    writer.write(bytes.data(), bytes.size());
+    writer.sync();
+    writer.close();
+
+    int err = std::rename(tmp_filename.c_str(), filename.c_str());
+    CHECK(err == 0) << "failed to rename " << tmp_filename << ", errno: "
+                    << errno;
+  }
+
+  // appends the record of a committed version of the row to bytes
+  static void append_row(std::string &bytes, ITable &table, const void *key,
+                         ITable::MetaDataType &metadata, void *value) {
+    auto size = bytes.size();
+    for (;;) {
+      uint64_t tid = metadata.load();
+      if (tid & LOCK_BIT) {
+        std::this_thread::yield();
+        continue;
+      }
+      bytes.resize(size);
+      RedoLog::append_record(bytes, table, key, value, tid & TS_MASK);
+      if (metadata.load() == tid) {
+        break;
+      }
+    }
+  }
+
+  // returns false if there is no complete checkpoint
+  static bool load(ITable &table, const std::string &filename,
+                   uint64_t &epoch) {
+    std::string bytes;
+    if (!read_file(filename, bytes)) {
+      return false;
+    }
+
+    // check the trailing marker before touching the table
+    StringPiece piece(bytes);
+    RedoLogRecord record;
+    bool complete = false;
+    while (RedoLog::next(piece, record)) {
+      complete = record.is_epoch();
+    }
+    if (!complete) {
+      LOG(WARNING) << filename << " is incomplete and ignored.";
+      return false;
+    }
+
+    piece = StringPiece(bytes);
+    while (RedoLog::next(piece, record)) {
+      if (record.is_epoch()) {
+        epoch = record.commit_ts;
+        break;
+      }
+      DCHECK(record.table_id == table.tableID());
+      DCHECK(record.partition_id == table.partitionID());
+      table.deserialize_value(record.key.data(), record.value);
+      table.search_metadata(record.key.data()).store(record.commit_ts);
+    }
+    return true;
+  }
+
+  static bool read_file(const std::string &filename, std::string &bytes) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    bytes = ss.str();
+    return true;
+  }
+};
+} // namespace coco
@@ -0,0 +1,87 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#pragma once
+
+#include "common/RateLimiter.h"
+#include "core/Checkpoint.h"
+#include "core/Context.h"
+#include "core/Table.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <glog/logging.h>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * Checkpointer runs in the background and takes a fuzzy checkpoint of every
+ * local table partition each checkpoint_interval seconds, one partition at a
+ * time. Writes are capped at checkpoint_bandwidth MB/s so that the executors
+ * keep most of the memory and disk bandwidth.
+ */
+
+class Checkpointer {
+public:
+  Checkpointer(std::size_t coordinator_id, std::vector<ITable *> tables,
+               const Context &context, std::atomic<bool> &stopFlag,
+               std::function<uint64_t()> durable_epoch)
+      : coordinator_id(coordinator_id), tables(std::move(tables)),
+        context(context), stopFlag(stopFlag),
+        durable_epoch(std::move(durable_epoch)) {}
+
+  void start() {
+    LOG(INFO) << "Checkpointer on coordinator " << coordinator_id
+              << " starts, " << tables.size() << " tables.";
+
+    while (wait_for_next_checkpoint()) {
+      auto start = std::chrono::steady_clock::now();
+      // epochs from now on are replayed on top of the checkpoint
+      uint64_t epoch = durable_epoch();
+      RateLimiter limiter(context.checkpoint_bandwidth * 1024 * 1024);
+
+      std::size_t n = 0;
+      for (; n < tables.size() && !stopFlag.load(); n++) {
+        auto filename = Checkpoint::file_name(
+            context.log_path, tables[n]->tableID(), tables[n]->partitionID());
+        Checkpoint::write(*tables[n], filename, epoch, &limiter);
+      }
+
+      LOG(INFO) << "Checkpointer on coordinator " << coordinator_id
+                << " wrote " << n << " tables (" << limiter.total_bytes()
+                << " bytes) from epoch " << epoch << " in "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count()
+                << " milliseconds.";
+    }
+
+    LOG(INFO) << "Checkpointer on coordinator " << coordinator_id << " exits.";
+  }
+
+private:
+  // returns false if stopped while waiting
+  bool wait_for_next_checkpoint() {
+    auto start = std::chrono::steady_clock::now();
+    auto interval = std::chrono::seconds(context.checkpoint_interval);
+    while (!stopFlag.load()) {
+      if (std::chrono::steady_clock::now() - start >= interval) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+private:
+  std::size_t coordinator_id;
+  std::vector<ITable *> tables;
+  const Context &context;
+  std::atomic<bool> &stopFlag;
+  std::function<uint64_t()> durable_epoch;
+};
+} // namespace coco
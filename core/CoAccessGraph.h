@@ -0,0 +1,223 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <glog/logging.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * The co-access graph of the partitions in an access trace. The weight of
+ * an edge is the number of sampled transactions that access both partitions,
+ * i.e., the distributed transactions it costs to place them apart.
+ *
+ * A trace has a sampled transaction per line, the partition ids it accesses
+ * separated by spaces, e.g., "3 3 7". Lines starting with # are comments.
+ */
+
+class CoAccessGraph {
+public:
+  // the partitions a transaction accesses, in any order and with duplicates
+  void add_transaction(std::vector<uint32_t> partitions) {
+    std::sort(partitions.begin(), partitions.end());
+    partitions.erase(std::unique(partitions.begin(), partitions.end()),
+                     partitions.end());
+    if (partitions.empty()) {
+      return;
+    }
+    if (partitions.back() >= edges.size()) {
+      edges.resize(partitions.back() + 1);
+    }
+    n_transactions++;
+    if (partitions.size() > 1) {
+      n_distributed++;
+    }
+    for (auto i = 0u; i < partitions.size(); i++) {
+      for (auto j = i + 1; j < partitions.size(); j++) {
+        edges[partitions[i]][partitions[j]]++;
+        edges[partitions[j]][partitions[i]]++;
+      }
+    }
+  }
+
+  // returns false if the trace cannot be read
+  bool load(const std::string &filename) {
+    std::ifstream in(filename);
+    if (!in) {
+      return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      std::istringstream ss(line);
+      std::vector<uint32_t> partitions;
+      uint32_t partition_id;
+      while (ss >> partition_id) {
+        partitions.push_back(partition_id);
+      }
+      add_transaction(std::move(partitions));
+    }
+    return true;
+  }
+
+  // the partitions in the trace are 0 to partition_num() - 1
+  std::size_t partition_num() const { return edges.size(); }
+
+  uint64_t weight(std::size_t i, std::size_t j) const {
+    auto it = edges[i].find(j);
+    return it == edges[i].end() ? 0 : it->second;
+  }
+
+  uint64_t transaction_num() const { return n_transactions; }
+
+  uint64_t distributed_num() const { return n_distributed; }
+
+  // the weight of the edges between partitions on different parts
+  uint64_t cut(const std::vector<std::size_t> &parts) const {
+    uint64_t cut = 0;
+    for (auto i = 0u; i < edges.size(); i++) {
+      for (auto &edge : edges[i]) {
+        if (i < edge.first && parts[i] != parts[edge.first]) {
+          cut += edge.second;
+        }
+      }
+    }
+    return cut;
+  }
+
+  /*
+   * Places the partitions on part_num parts of (nearly) the same number of
+   * partitions, with a small cut. It starts from partition id % part_num and
+   * greedily moves or swaps partitions between parts, the largest decrease
+   * of the cut first, till the cut cannot decrease any more, as in
+   * Kernighan-Lin. The result only depends on the graph, so that all
+   * coordinators compute the same placement.
+   */
+  std::vector<std::size_t> partition(std::size_t part_num) const {
+    CHECK(part_num > 0);
+    std::size_t n = edges.size();
+    std::vector<std::size_t> parts(n), sizes(part_num);
+    for (auto i = 0u; i < n; i++) {
+      parts[i] = i % part_num;
+      sizes[parts[i]]++;
+    }
+    if (part_num == 1) {
+      return parts;
+    }
+    std::size_t min_size = n / part_num;
+    std::size_t max_size = (n + part_num - 1) / part_num;
+
+    // conn[i][k], the weight of the edges from partition i to part k
+    std::vector<std::vector<int64_t>> conn(n, std::vector<int64_t>(part_num));
+    for (auto i = 0u; i < n; i++) {
+      for (auto &edge : edges[i]) {
+        conn[i][parts[edge.first]] += edge.second;
+      }
+    }
+
+    auto move = [&](std::size_t i, std::size_t k) {
+      for (auto &edge : edges[i]) {
+        conn[edge.first][parts[i]] -= edge.second;
+        conn[edge.first][k] += edge.second;
+      }
+      sizes[parts[i]]--;
+      sizes[k]++;
+      parts[i] = k;
+    };
+
+    // the partitions on part k by the gain of moving them to part x, so
+    // that a swap looks at the best candidates only
+    std::vector<std::vector<std::vector<std::size_t>>> candidates(
+        part_num, std::vector<std::vector<std::size_t>>(part_num));
+    auto gain = [&](std::size_t i, std::size_t k) {
+      return conn[i][k] - conn[i][parts[i]];
+    };
+
+    for (std::size_t round = 0; round < MAX_ROUNDS * n; round++) {
+      for (auto k = 0u; k < part_num; k++) {
+        for (auto x = 0u; x < part_num; x++) {
+          candidates[k][x].clear();
+        }
+      }
+      for (auto j = 0u; j < n; j++) {
+        for (auto x = 0u; x < part_num; x++) {
+          if (x != parts[j]) {
+            candidates[parts[j]][x].push_back(j);
+          }
+        }
+      }
+      for (auto k = 0u; k < part_num; k++) {
+        for (auto x = 0u; x < part_num; x++) {
+          std::stable_sort(candidates[k][x].begin(), candidates[k][x].end(),
+                           [&](std::size_t a, std::size_t b) {
+                             return gain(a, x) > gain(b, x);
+                           });
+        }
+      }
+
+      int64_t best_gain = 0;
+      std::size_t best_i = 0, best_j = n, best_k = 0;
+
+      for (auto i = 0u; i < n; i++) {
+        auto from = parts[i];
+        for (auto k = 0u; k < part_num; k++) {
+          if (k == from) {
+            continue;
+          }
+          int64_t gain_i = gain(i, k);
+          // a move keeps the parts balanced
+          if (sizes[from] > min_size && sizes[k] < max_size &&
+              gain_i > best_gain) {
+            best_gain = gain_i;
+            best_i = i, best_j = n, best_k = k;
+          }
+          // a swap with j on part k, the edge between them stays cut
+          for (auto j : candidates[k][from]) {
+            int64_t gain_j = gain(j, from);
+            if (gain_i + gain_j <= best_gain) {
+              break;
+            }
+            int64_t w = weight(i, j);
+            if (gain_i + gain_j - 2 * w > best_gain) {
+              best_gain = gain_i + gain_j - 2 * w;
+              best_i = i, best_j = j, best_k = k;
+            }
+            // the candidates after the first non-neighbor gain less
+            if (w == 0) {
+              break;
+            }
+          }
+        }
+      }
+
+      if (best_gain == 0) {
+        break;
+      }
+      auto from = parts[best_i];
+      move(best_i, best_k);
+      if (best_j != n) {
+        move(best_j, from);
+      }
+    }
+    return parts;
+  }
+
+private:
+  // bounds the moves and swaps to MAX_ROUNDS per partition
+  static constexpr std::size_t MAX_ROUNDS = 16;
+
+  std::vector<std::map<uint32_t, uint64_t>> edges;
+  uint64_t n_transactions = 0, n_distributed = 0;
+};
+} // namespace coco
@@ -0,0 +1,195 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Snapshot.h"
+#include "core/Table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace coco {
+
+/*
+ * ColumnarTable is a copy of a table partition with one array per field of
+ * the value, laid out as FieldLayout lists the fields of a DO_STRUCT value,
+ * and one array of keys. Row i of every array is the same row. A scan of one
+ * field, e.g., S_QUANTITY of a warehouse's stock, reads a dense array of that
+ * field only, and the loops of sum() and count_if() are left simple enough
+ * for the compiler to vectorize.
+ */
+
+class ColumnarTable {
+public:
+  explicit ColumnarTable(ITable &table)
+      : tableID_(table.tableID()), partitionID_(table.partitionID()),
+        key_size(table.key_size()), columns(table.field_count()) {
+    for (auto i = 0u; i < columns.size(); i++) {
+      offsets.push_back(table.field_offset(i));
+      lengths.push_back(table.field_length(i));
+    }
+  }
+
+  // copies a row of the table to the end of the arrays
+  void append(const void *key, const void *value) {
+    auto k = static_cast<const char *>(key);
+    keys.insert(keys.end(), k, k + key_size);
+    auto v = static_cast<const char *>(value);
+    for (auto i = 0u; i < columns.size(); i++) {
+      columns[i].insert(columns[i].end(), v + offsets[i],
+                        v + offsets[i] + lengths[i]);
+    }
+    n_rows++;
+  }
+
+  std::size_t size() const { return n_rows; }
+
+  std::size_t field_count() const { return columns.size(); }
+
+  std::size_t tableID() const { return tableID_; }
+
+  std::size_t partitionID() const { return partitionID_; }
+
+  const void *key(std::size_t row) const {
+    DCHECK(row < n_rows);
+    return keys.data() + row * key_size;
+  }
+
+  // the array of field i, T is the type of the field
+  template <class T> const T *column(std::size_t i) const {
+    CHECK(i < columns.size() && sizeof(T) == lengths[i])
+        << "field " << i << " of table " << tableID_ << " is not a "
+        << sizeof(T) << " byte field.";
+    return reinterpret_cast<const T *>(columns[i].data());
+  }
+
+  template <class T> T sum(std::size_t i) const {
+    auto values = column<T>(i);
+    T result = 0;
+    for (auto row = 0u; row < n_rows; row++) {
+      result += values[row];
+    }
+    return result;
+  }
+
+  // the number of rows whose field i satisfies pred, e.g., a comparison
+  template <class T, class Pred>
+  std::size_t count_if(std::size_t i, Pred pred) const {
+    auto values = column<T>(i);
+    std::size_t n = 0;
+    for (auto row = 0u; row < n_rows; row++) {
+      n += pred(values[row]) ? 1 : 0;
+    }
+    return n;
+  }
+
+private:
+  std::size_t tableID_, partitionID_, key_size, n_rows = 0;
+  std::vector<std::size_t> offsets, lengths;
+  std::vector<char> keys;
+  std::vector<std::vector<char>> columns;
+};
+
+/*
+ * ColumnarSnapshot is the set of ColumnarTables copied from the tables of a
+ * pinned Snapshot. It is consistent as of the epoch boundary of the pin and
+ * immutable once published, so that any number of read-only analytical
+ * queries can scan it with no synchronization while transactions commit.
+ *
+ * With --columnar_tables, SnapshotQuery publishes a new copy of these tables
+ * each --snapshot_interval seconds. A query takes latest() once and keeps the
+ * copy alive for as long as it scans it.
+ */
+
+class ColumnarSnapshot {
+public:
+  ColumnarSnapshot(int64_t boundary) : boundary(boundary) {}
+
+  ColumnarTable &add_table(ITable &table) {
+    tables.push_back(std::make_unique<ColumnarTable>(table));
+    return *tables.back();
+  }
+
+  // the epoch boundary the snapshot was pinned at
+  int64_t get_boundary() const { return boundary; }
+
+  // returns nullptr if the table is not in the snapshot
+  const ColumnarTable *find_table(std::size_t table_id,
+                                  std::size_t partition_id) const {
+    for (auto &table : tables) {
+      if (table->tableID() == table_id &&
+          table->partitionID() == partition_id) {
+        return table.get();
+      }
+    }
+    return nullptr;
+  }
+
+  const std::vector<std::unique_ptr<ColumnarTable>> &get_tables() const {
+    return tables;
+  }
+
+  std::size_t size() const {
+    std::size_t n = 0;
+    for (auto &table : tables) {
+      n += table->size();
+    }
+    return n;
+  }
+
+  // copies the tables in table_ids of a pinned snapshot
+  static std::shared_ptr<ColumnarSnapshot>
+  build(Snapshot &snapshot, const std::vector<std::size_t> &table_ids,
+        int64_t boundary) {
+    auto columnar = std::make_shared<ColumnarSnapshot>(boundary);
+    for (auto table : snapshot.get_tables()) {
+      if (std::find(table_ids.begin(), table_ids.end(), table->tableID()) ==
+          table_ids.end()) {
+        continue;
+      }
+      auto &columns = columnar->add_table(*table);
+      snapshot.for_each_row(*table, [&](const void *key, const void *value) {
+        columns.append(key, value);
+      });
+    }
+    return columnar;
+  }
+
+  static void publish(std::size_t coordinator_id,
+                      std::shared_ptr<const ColumnarSnapshot> snapshot) {
+    std::lock_guard<std::mutex> guard(mutex());
+    snapshots()[coordinator_id] = std::move(snapshot);
+  }
+
+  // the last snapshot published on coordinator_id, or nullptr
+  static std::shared_ptr<const ColumnarSnapshot>
+  latest(std::size_t coordinator_id) {
+    std::lock_guard<std::mutex> guard(mutex());
+    return snapshots()[coordinator_id];
+  }
+
+private:
+  static std::mutex &mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::map<std::size_t, std::shared_ptr<const ColumnarSnapshot>> &
+  snapshots() {
+    static std::map<std::size_t, std::shared_ptr<const ColumnarSnapshot>>
+        snapshots;
+    return snapshots;
+  }
+
+private:
+  int64_t boundary;
+  std::vector<std::unique_ptr<ColumnarTable>> tables;
+};
+} // namespace coco
@@ -0,0 +1,220 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/BufferedFileWriter.h"
+#include "common/Encoder.h"
+#include "common/Random.h"
+#include "common/StringPiece.h"
+#include "core/Context.h"
+#include "core/RedoLog.h"
+#include "core/TransactionStream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <glog/logging.h>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Command log -- format --
+ *
+ *  The state after a batch of a deterministic protocol, i.e., Aria, Calvin
+ *  or Bohm, only depends on the transactions of the batch. With
+ *  --command_log, each executor logs what its transactions are generated
+ *  from, see TransactionStream, instead of their write sets. It appends a
+ *  record per batch to <log dir>/<coordinator id>_<worker id>.cmdlog once
+ *  it has generated its transactions, and syncs the file before the batch is
+ *  released, see sync. A transaction rerun in a later batch is not logged
+ *  again, since the replay reruns it the same way.
+ *
+ *  batch: [ BATCH_MARKER (32) | batch size (32) | entry num (32) ]
+ *  entry: [ index (32) | seed (64) | partition id (32) | hot row (32) ]
+ *
+ *  With --recover, load reads the logs of all executors of the coordinator
+ *  before they are truncated, and the executors replay the batches in order
+ *  from the database as loaded: the k-th batch generates the transaction at
+ *  index i from the entry of i in the k-th batch of the logs. Only batches
+ *  logged by every executor are replayed, a later one was never released.
+ *  The batches are logged again as they are replayed.
+ */
+
+class CommandLog {
+public:
+  static constexpr uint32_t BATCH_MARKER = 0x434d444c; // CMDL
+  static constexpr std::size_t BATCH_HEADER_SIZE = sizeof(uint32_t) * 3;
+  static constexpr std::size_t ENTRY_SIZE =
+      sizeof(uint32_t) + TransactionStream::ENTRY_SIZE;
+
+  struct Batch {
+    uint32_t batch_size = 0;
+    std::unordered_map<uint32_t, TransactionStreamEntry> entries;
+  };
+
+  // the batches a coordinator replays
+  using Replay = std::vector<Batch>;
+
+  CommandLog(const std::string &file_name, const Replay &replay)
+      : writer(std::make_unique<BufferedFileWriter>(file_name.c_str())),
+        replay(replay) {}
+
+  // nullptr unless --command_log is set
+  static std::unique_ptr<CommandLog> open(const Context &context,
+                                          std::size_t coordinator_id,
+                                          std::size_t worker_id) {
+    if (!context.command_log) {
+      return nullptr;
+    }
+    return std::make_unique<CommandLog>(
+        file_name(context.log_path, coordinator_id, worker_id),
+        replay_of(coordinator_id));
+  }
+
+  static std::string file_name(const std::string &log_path,
+                               std::size_t coordinator_id,
+                               std::size_t worker_id) {
+    return RedoLog::directory(log_path, worker_id) + "/" +
+           std::to_string(coordinator_id) + "_" + std::to_string(worker_id) +
+           ".cmdlog";
+  }
+
+  // reads the logs of the executors of coordinator_id, before they open
+  // theirs, returns the number of batches to replay
+  static std::size_t load(const Context &context, std::size_t coordinator_id) {
+    std::vector<std::vector<Batch>> logs(context.worker_num);
+    for (auto i = 0u; i < context.worker_num; i++) {
+      read(file_name(context.log_path, coordinator_id, i), logs[i]);
+    }
+
+    std::size_t n = logs.empty() ? 0 : logs[0].size();
+    for (auto &log : logs) {
+      n = std::min(n, log.size());
+    }
+
+    Replay &replay = replay_of(coordinator_id);
+    replay.assign(n, Batch());
+    for (auto k = 0u; k < n; k++) {
+      replay[k].batch_size = logs[0][k].batch_size;
+      for (auto &log : logs) {
+        CHECK(log[k].batch_size == replay[k].batch_size)
+            << "the executors log batch " << k << " with different sizes.";
+        replay[k].entries.insert(log[k].entries.begin(), log[k].entries.end());
+      }
+    }
+    return n;
+  }
+
+  // called before the transactions of a batch of batch_size are generated
+  void begin_batch(std::size_t batch_size) {
+    replaying = n_batches < replay.size();
+    CHECK(!replaying || replay[n_batches].batch_size == batch_size)
+        << "batch " << n_batches << " is logged with "
+        << replay[n_batches].batch_size << " transactions, not " << batch_size;
+    bytes.clear();
+    Encoder enc(bytes);
+    enc << uint32_t(BATCH_MARKER) << static_cast<uint32_t>(batch_size)
+        << uint32_t(0);
+    n_entries = 0;
+  }
+
+  // called before the transaction at index is generated on partition_id.
+  // Logs the seed of random, partition_id and hot_row, or replaces them
+  // with the entry of index while the batch is replayed.
+  void next(std::size_t index, Random &random, std::size_t &partition_id,
+            std::size_t &hot_row) {
+    if (replaying) {
+      auto &entries = replay[n_batches].entries;
+      auto it = entries.find(index);
+      CHECK(it != entries.end())
+          << "transaction " << index << " of batch " << n_batches
+          << " is not logged.";
+      random.set_seed(it->second.seed);
+      partition_id = it->second.partition_id;
+      hot_row = it->second.hot_row;
+    }
+    Encoder enc(bytes);
+    enc << static_cast<uint32_t>(index);
+    TransactionStream::encode(
+        bytes, {random.get_seed(), static_cast<uint32_t>(partition_id),
+                static_cast<uint32_t>(hot_row)});
+    n_entries++;
+  }
+
+  // called once the transactions of the batch are generated
+  void end_batch() {
+    uint32_t n = n_entries;
+    std::memcpy(&bytes[sizeof(uint32_t) * 2], &n, sizeof(n));
+    writer->write(bytes.data(), bytes.size());
+    n_bytes += bytes.size();
+    n_batches++;
+  }
+
+  // called before the batch is released
+  void sync() { writer->sync(); }
+
+  void close() { writer->close(); }
+
+  bool is_replaying() const { return replaying; }
+
+  std::size_t get_bytes() const { return n_bytes; }
+
+  // reads the batches of filename up to a torn one, returns false if the file
+  // cannot be read
+  static bool read(const std::string &filename, std::vector<Batch> &batches) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    StringPiece piece(bytes);
+    while (piece.size() >= BATCH_HEADER_SIZE) {
+      uint32_t marker, batch_size, n;
+      Decoder header(piece);
+      header >> marker >> batch_size >> n;
+      if (marker != uint32_t(BATCH_MARKER) ||
+          piece.size() < BATCH_HEADER_SIZE + n * ENTRY_SIZE) {
+        break;
+      }
+      piece.remove_prefix(BATCH_HEADER_SIZE);
+      Batch batch;
+      batch.batch_size = batch_size;
+      for (auto i = 0u; i < n; i++) {
+        uint32_t index;
+        TransactionStreamEntry entry;
+        Decoder dec(piece);
+        dec >> index >> entry.seed >> entry.partition_id >> entry.hot_row;
+        batch.entries[index] = entry;
+        piece.remove_prefix(ENTRY_SIZE);
+      }
+      batches.push_back(std::move(batch));
+    }
+    return true;
+  }
+
+private:
+  static Replay &replay_of(std::size_t coordinator_id) {
+    static std::mutex mutex;
+    static std::map<std::size_t, Replay> replays;
+    std::lock_guard<std::mutex> guard(mutex);
+    return replays[coordinator_id];
+  }
+
+  std::unique_ptr<BufferedFileWriter> writer;
+  const Replay &replay;
+  std::string bytes;
+  std::size_t n_batches = 0, n_entries = 0, n_bytes = 0;
+  bool replaying = false;
+};
+} // namespace coco
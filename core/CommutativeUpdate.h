@@ -0,0 +1,143 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/Message.h"
+#include "common/MessagePiece.h"
+#include "core/ControlMessage.h"
+#include "core/FieldLayout.h"
+#include "core/Partitioner.h"
+#include "core/Table.h"
+
+#include <functional>
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace coco {
+
+/*
+ * A commutative update adds a delta to a field of a row, e.g., W_YTD in
+ * Payment, with txn.add_to_field(table, partition, key, field, delta). The
+ * transaction neither reads, locks nor validates the row for it, so the
+ * transactions adding to the same row do not conflict. Once the transaction
+ * commits and its locks are released, the addition is applied to the row on
+ * the master and on each replica of the partition, see apply().
+ *
+ * An addition does not change the tid of the row, so the transactions that
+ * read the other fields of the row do not conflict with it either. The
+ * additive fields of a table are set with ITable::set_additive_fields, and a
+ * write of a row leaves them as they are, so that it does not overwrite the
+ * additions since the row was read. In turn, a read of an additive field is
+ * not validated, it sees the additions applied so far.
+ */
+
+struct AdditionKey {
+  std::size_t table_id;
+  std::size_t partition_id;
+  const void *key;
+  uint32_t field;
+  FieldAddition addition;
+};
+
+class CommutativeUpdate {
+public:
+  // applies the additions of txn on all replicas of their partitions, the
+  // others through messages
+  template <class DatabaseType, class TransactionType>
+  static void apply(TransactionType &txn, DatabaseType &db,
+                    const Partitioner &partitioner,
+                    std::vector<std::unique_ptr<Message>> &messages) {
+    for (auto &addition : txn.additionSet) {
+      txn.network_size +=
+          apply(addition, txn.coordinator_id, db, partitioner, messages);
+    }
+  }
+
+  // applies an addition on coordinator_id and sends it to the other replicas
+  // of its partition, returns the size of the messages
+  template <class DatabaseType>
+  static std::size_t apply(const AdditionKey &addition,
+                           std::size_t coordinator_id, DatabaseType &db,
+                           const Partitioner &partitioner,
+                           std::vector<std::unique_ptr<Message>> &messages) {
+    std::size_t network_size = 0;
+    auto table = db.find_table(addition.table_id, addition.partition_id);
+    for (auto k = 0u; k < partitioner.total_coordinators(); k++) {
+      if (!partitioner.is_partition_replicated_on(addition.partition_id, k)) {
+        continue;
+      }
+      if (k == coordinator_id) {
+        table->add_to_field(addition.key, addition.field, addition.addition);
+      } else {
+        network_size += new_addition_message(*messages[k], *table, addition.key,
+                                             addition.field, addition.addition);
+      }
+    }
+    return network_size;
+  }
+
+  static std::size_t new_addition_message(Message &message, ITable &table,
+                                          const void *key, uint32_t field,
+                                          const FieldAddition &addition) {
+
+    /*
+     * The structure of a field addition request: (primary key, field,
+     * addition)
+     */
+
+    auto key_size = table.key_size();
+
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        sizeof(field) + ADDITION_SIZE;
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::FIELD_ADDITION_REQUEST),
+        message_size, table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(key, key_size);
+    encoder << field << addition;
+    message.flush();
+    return message_size;
+  }
+
+  template <class TransactionType>
+  static void set_message_handlers(
+      std::vector<std::function<void(MessagePiece, Message &, ITable &,
+                                     TransactionType *)>> &handlers) {
+
+    handlers[static_cast<int>(ControlMessage::FIELD_ADDITION_REQUEST)] =
+        [](MessagePiece inputPiece, Message &responseMessage, ITable &table,
+           TransactionType *txn) {
+          /*
+           * The structure of a field addition request: (primary key, field,
+           * addition)
+           * The structure of a field addition response: null
+           */
+          auto key_size = table.key_size();
+          DCHECK(inputPiece.get_message_length() ==
+                 MessagePiece::get_header_size() + key_size +
+                     sizeof(uint32_t) + ADDITION_SIZE);
+
+          auto stringPiece = inputPiece.toStringPiece();
+          const void *key = stringPiece.data();
+          stringPiece.remove_prefix(key_size);
+
+          uint32_t field;
+          FieldAddition addition;
+          Decoder dec(stringPiece);
+          dec >> field >> addition;
+          table.add_to_field(key, field, addition);
+        };
+  }
+
+private:
+  // the type and the delta of an encoded addition
+  static constexpr std::size_t ADDITION_SIZE =
+      sizeof(uint8_t) + sizeof(uint64_t);
+};
+} // namespace coco
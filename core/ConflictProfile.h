@@ -0,0 +1,103 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/SpinLock.h"
+#include "common/StringPiece.h"
+#include "core/HotKeySketch.h"
+#include "core/Table.h"
+
+#include <cstdint>
+#include <glog/logging.h>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace coco {
+
+/*
+ * With --conflict_profile=n, each worker counts the rows that abort its
+ * transactions, the first row a transaction fails to lock and the first row
+ * that fails its read validation, in two HotKeySketch. Every n seconds, a
+ * coordinator moves the counts of its workers into its own profile and logs
+ * the TOP rows of each, i.e., the rows that abort the most transactions
+ * since the start of the run.
+ */
+
+class ConflictProfile {
+public:
+  // the rows a worker counts
+  static constexpr std::size_t CAPACITY = 64;
+  static constexpr std::size_t TOP = 10;
+
+  explicit ConflictProfile(std::size_t capacity = CAPACITY)
+      : locks(capacity), validations(capacity) {}
+
+  // called by the worker once a transaction aborts because of key
+  void record(ITable &table, const void *key, bool lock) {
+    auto k = key_of(table, key);
+    std::lock_guard<SpinLock> guard(spin_lock);
+    (lock ? locks : validations).add(k, false);
+  }
+
+  // called by the coordinator, moves the counts recorded so far into profile
+  void collect(ConflictProfile &profile) {
+    std::lock_guard<SpinLock> guard(spin_lock);
+    profile.locks.merge(locks);
+    profile.validations.merge(validations);
+    locks.clear();
+    validations.clear();
+  }
+
+  const HotKeySketch &lock_conflicts() const { return locks; }
+
+  const HotKeySketch &validation_conflicts() const { return validations; }
+
+  void log() const {
+    log("lock", locks);
+    log("read validation", validations);
+  }
+
+  static std::string key_of(ITable &table, const void *key) {
+    std::string k;
+    Encoder encoder(k);
+    encoder << static_cast<uint32_t>(table.tableID())
+            << static_cast<uint32_t>(table.partitionID());
+    encoder.write_n_bytes(key, table.key_size());
+    return k;
+  }
+
+  // e.g., table 0 partition 3 key 0x2a00000000000000
+  static std::string to_string(const std::string &k) {
+    StringPiece piece(k);
+    uint32_t table_id, partition_id;
+    Decoder dec(piece);
+    dec >> table_id >> partition_id;
+    std::ostringstream os;
+    os << "table " << table_id << " partition " << partition_id << " key 0x";
+    const char *digits = "0123456789abcdef";
+    for (auto i = sizeof(uint32_t) * 2; i < k.size(); i++) {
+      auto c = static_cast<unsigned char>(k[i]);
+      os << digits[c >> 4] << digits[c & 15];
+    }
+    return os.str();
+  }
+
+private:
+  static void log(const char *name, const HotKeySketch &sketch) {
+    LOG(INFO) << sketch.total_num() << " aborts on a " << name
+              << " conflict, the top rows:";
+    for (auto &counter : sketch.top(TOP)) {
+      LOG(INFO) << "  " << to_string(counter.key) << ": " << counter.count
+                << " aborts (error " << counter.error << ")";
+    }
+  }
+
+private:
+  SpinLock spin_lock;
+  HotKeySketch locks, validations;
+};
+} // namespace coco
@@ -0,0 +1,78 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Random.h"
+#include "core/Partitioner.h"
+
+#include <cstdint>
+#include <glog/logging.h>
+#include <utility>
+#include <vector>
+
+namespace coco {
+
+/*
+ * A workload may declare n hot rows per partition that most of its writes
+ * go through, e.g., the 10 districts of a TPC-C warehouse, which NewOrder
+ * and Payment update. Hot row k of a partition is its key k + 1 with
+ * regard to the workload, see Workload::next_transaction.
+ *
+ * With --conflict_routing=p, the hot rows of the partitions a node masters
+ * are dealt to its workers, and p% of the transactions a worker starts are
+ * drawn on one of its own hot rows instead of a random one. At p = 100, a
+ * hot row is written by one worker per node only, so its transactions run
+ * one after the other instead of aborting each other. A lower p keeps more
+ * of the arrival order and the uniform choice of rows of the workload, at
+ * the cost of more aborts.
+ */
+
+class ConflictRouter {
+public:
+  ConflictRouter(std::size_t worker_id, std::size_t worker_num,
+                 std::size_t partition_num, std::size_t n_hot_rows,
+                 std::size_t percent, Partitioner &partitioner)
+      : percent(percent) {
+    if (percent == 0 || n_hot_rows == 0) {
+      return;
+    }
+    for (auto i = 0u, k = 0u; i < partition_num; i++) {
+      if (!partitioner.has_master_partition(i)) {
+        continue;
+      }
+      for (auto j = 0u; j < n_hot_rows; j++, k++) {
+        if (k % worker_num == worker_id) {
+          rows.emplace_back(i, j + 1);
+        }
+      }
+    }
+  }
+
+  // returns false if the transaction is not routed, otherwise the
+  // partition and the key of the hot row it is drawn on
+  bool route(Random &random, std::size_t &partition_id, std::size_t &row) {
+    if (rows.empty() || random.uniform_dist(1, 100) > percent) {
+      return false;
+    }
+    auto &r = rows[random.uniform_dist(0, rows.size() - 1)];
+    partition_id = r.first;
+    row = r.second;
+    n_routed++;
+    return true;
+  }
+
+  // the hot rows of this worker, (partition id, key)
+  const std::vector<std::pair<std::size_t, std::size_t>> &get_rows() const {
+    return rows;
+  }
+
+  std::size_t routed() const { return n_routed; }
+
+private:
+  std::size_t percent;
+  std::vector<std::pair<std::size_t, std::size_t>> rows;
+  std::size_t n_routed = 0;
+};
+} // namespace coco
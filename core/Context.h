@@ -23,6 +23,87 @@ public:
     }
   }
 
+  // whether partition i is on coordinator i % coordinator_num, see
+  // DynamicPartitioner and AffinityPartitioner otherwise
+  bool hash_placement() const {
+    return partitioner != "dynamic" &&
+           partitioner.compare(0, 9, "affinity:") != 0;
+  }
+
+  // whether this coordinator streams the partitions it only replicates from
+  // their masters instead of generating them, see ReplicaRebuilder
+  bool rebuilds_replicas() const {
+    std::size_t start = 0;
+    while (start < rebuild_replicas.size()) {
+      auto end = rebuild_replicas.find(',', start);
+      if (end == std::string::npos) {
+        end = rebuild_replicas.size();
+      }
+      if (std::stoul(rebuild_replicas.substr(start, end - start)) ==
+          coordinator_id) {
+        return true;
+      }
+      start = end + 1;
+    }
+    return false;
+  }
+
+  // whether a read-only query can pin a snapshot of the tables, see Snapshot
+  bool supports_snapshots() const {
+    return (protocol == "SiloSI" || protocol == "ScarSI") &&
+           !pipelined_epochs && partitioner != "dynamic";
+  }
+
+  // whether the executors commit and persist in groups, see
+  // group_commit::Executor
+  bool group_commit() const {
+    return protocol == "SiloGC" || protocol == "SiloSI" ||
+           protocol == "ScarGC" || protocol == "ScarSI";
+  }
+
+  // whether the rows of table_id are evicted to disk, see AntiCache
+  bool is_evictable(std::size_t table_id) const {
+    if (anti_cache_path.empty()) {
+      return false;
+    }
+    std::size_t begin = 0;
+    while (begin < anti_cache_tables.size()) {
+      auto end = anti_cache_tables.find(',', begin);
+      if (end == std::string::npos) {
+        end = anti_cache_tables.size();
+      }
+      if (anti_cache_tables.substr(begin, end - begin) ==
+          std::to_string(table_id)) {
+        return true;
+      }
+      begin = end + 1;
+    }
+    return false;
+  }
+
+  // the file the evicted rows of a table partition are written to
+  std::string cold_file(std::size_t table_id, std::size_t partition_id) const {
+    return anti_cache_path + "/" + std::to_string(coordinator_id) + "_" +
+           std::to_string(table_id) + "_" + std::to_string(partition_id) +
+           ".cold";
+  }
+
+  // the file of a persistent table partition, see PersistentTable
+  std::string pmem_file(std::size_t table_id, std::size_t partition_id) const {
+    return pmem_path + "/" + std::to_string(coordinator_id) + "_" +
+           std::to_string(table_id) + "_" + std::to_string(partition_id) +
+           ".pmem";
+  }
+
+  // the replica groups are kept in the name, see CalvinPartitioner. Aria
+  // replicates its inputs to the same replica groups, see AriaExecutor.
+  void set_calvin_partitioner() {
+    if (protocol != "Calvin" && !aria_input_replication) {
+      return;
+    }
+    partitioner = "Calvin:" + replica_group;
+  }
+
 public:
   std::size_t coordinator_id = 0;
   std::size_t partition_num = 0;
@@ -35,31 +116,135 @@ public:
   std::size_t batch_size = 240; // star, calvin, dbx batch size
   std::size_t batch_flush = 10;
   std::size_t group_time = 40; // ms
-  std::size_t sleep_time = 50; // us
+  std::size_t sleep_time = 50;     // us
+  std::size_t deferred_retries = 0; // see RetryQueue
+  std::size_t retry_backoff = 10;   // us
+  bool retry_cache = false;         // see RetryCache
+  bool request_combining = false;   // see RequestCombiner
+  std::size_t conflict_routing = 0; // %, see ConflictRouter
   std::string partitioner;
-  std::size_t delay_time = 0;
+  std::size_t delay_time = 0;     // us, see Delay
+  std::string link_delays;        // us, see LinkDelay
+  std::string jitter;             // see LinkDelay
+  std::size_t link_bandwidth = 0; // MB/s, see DelayLine
   std::string log_path;
+  bool log_direct_io = false;
+  bool command_log = false; // see CommandLog
+  std::string trace_path; // see AccessTrace
+  std::size_t trace_rate = 100;
+  std::string record_path;          // see TransactionStream
+  std::string replay_path;
+  std::size_t conflict_profile = 0; // seconds, see ConflictProfile
+  std::size_t early_validation = 0; // see EarlyValidation
+  bool repair = false;              // see Silo::repair
+  bool adaptive_locking = false;    // see AdaptiveLocking
+  bool thread_arenas = false;       // see ThreadArenas
+  std::size_t memory_report = 0;    // seconds, see MemoryReport
+  std::string anti_cache_path;      // see AntiCache
+  std::string anti_cache_tables;
+  std::size_t anti_cache_seconds = 10;
+  std::string pmem_path;            // see PersistentTable
+  bool message_latency = false;     // see MessageStatistics
+  bool perf_counters = false;       // see PerfCounters
+  std::string timeline_path;        // see Timeline
+  std::string profile_path;         // see Profiler
+  int profile_hz = 99;
+  bool profile_on_signal = false;
+  std::string results_path;         // see RunResults
+  std::string phases;               // see WorkloadPhases
+  std::size_t metrics_port = 0;     // see MetricsServer
+  std::size_t ingress_port = 0;     // see IngressServer
+  std::size_t ingress_max_in_flight = 4096;
+  std::size_t ingress_target_delay = 0; // see AdmissionControl
+  std::size_t ingress_interval = 100000;
+  std::string priorities;           // see Priorities
+  std::string priority_slo;
+  int procedure = -1;               // see Procedure
+  std::string image_path;           // see DatabaseImage
+  bool dump_image = false;
+  bool recover = false;
+  std::size_t checkpoint_interval = 0; // seconds
+  std::size_t checkpoint_bandwidth = 100; // MB/s
+  std::size_t snapshot_interval = 0;      // seconds, see SnapshotQuery
+  std::string columnar_tables;            // see ColumnarSnapshot
+  std::string export_path;                // see ArrowWriter
+  std::string export_tables;
+  std::size_t export_bandwidth = 100;     // MB/s
+  std::string migrations;                // see Migrator
+  std::size_t migration_delay = 5;       // seconds
+  std::size_t migration_bandwidth = 100; // MB/s
+  std::string rebuild_replicas;          // see ReplicaRebuilder
   std::string cdf_path;
+  std::size_t duration = 25; // seconds, including warmup and cooldown
+  std::size_t warmup = 10, cooldown = 5; // seconds
+  double arrival_rate = 0; // txns/s per worker in open loop, 0 for closed loop
+  bool dynamic_workers = false; // see group_commit::WorkerScaling
+  std::size_t min_workers = 1;
   std::size_t cpu_core_id = 0;
 
   std::size_t durable_write_cost = 0;
 
+  std::string network_engine = "poll";
+  std::size_t io_batch_messages = 16; // messages per writev
+  std::size_t io_batch_bytes = 65536; // bytes per writev
+
+  bool compress_messages = false;        // see Message
+  std::size_t compress_threshold = 4096; // bytes
+  bool pack_messages = false;            // see PieceCodec
+  std::size_t prefetch_distance = 0;     // see MessageDispatch
+  bool zero_copy_receive = false;        // see BufferedReader
+  std::size_t flush_bytes = 0;           // see group_commit::FlushPolicy
+  std::size_t flush_age = 100;           // us
+  std::size_t async_credits = 0;         // see AsyncCredits
+  bool direct_connections = false;       // see DirectConnections
+  std::string barrier = "all";           // see BarrierTree
+  std::size_t barrier_fanout = 4;
+  std::size_t clock_skew = 100;          // us, see group_commit::ClockEpochs
+
+  std::string transport = "tcp";
+  int rdma_gid_index = 0;
+  bool shm_transport = true; // see ShmConnection
+  int busy_poll = 0; // microseconds, see Socket::set_busy_poll
+
   bool tcp_no_delay = true;
   bool tcp_quick_ack = false;
+  std::size_t socket_buffer = 0; // KB, see Socket::set_buffer_size
+  bool irq_affinity = false;     // see Socket::incoming_cpu
 
   bool cpu_affinity = true;
+  bool numa = false;             // see NumaPlacement
+  bool partition_serial = false; // see PartitionGate
 
   bool sleep_on_retry = true;
 
+  std::size_t coroutine_num = 1; // transactions per worker, see Executor
+
   bool exact_group_commit = false;
+  bool pipelined_epochs = false;     // see group_commit::Manager
+  std::size_t replica_quorum = 0;    // see ReplicaQuorum
+  bool snapshot_reads = false;       // see SiloGC::snapshot_commit
+  std::size_t split_threshold = 0;   // see SplitCounters
+  bool parallel_apply = false;       // see ReplicationApplier
+  std::string async_replica;         // see ReplicaShipper
+  bool async_replica_role = false;   // see AsyncReplica
+  std::size_t target_latency = 0;    // us, see GroupTimeController
+  std::size_t target_batch_size = 0; // commits per epoch
 
   bool mvcc = false;
   bool bohm_local = false;
   bool bohm_single_spin = false;
 
   bool read_on_replica = false;
+  bool stale_reads = false; // see StaleReads
+  std::size_t hot_keys = 0; // see HotKeys
   bool local_validation = false;
+  bool delta_replication = false; // see FieldLayout
+  bool lock_ordering = false; // see LockOrder
+  std::size_t lock_spin = 1000;
+  std::string wait_policy = "no_wait"; // see TwoPLWait
+  std::string hot_tables;              // see TwoPLReaderIndicator
   bool rts_sync = false;
+  std::size_t rts_lease = 0; // see Scar::replicate_rts
   bool star_sync_in_single_master_phase = false;
   bool star_dynamic_batch_size = true;
   bool parallel_locking_and_validation = true;
@@ -69,6 +254,12 @@ public:
   bool aria_read_only_optmization = true;
   bool aria_reordering_optmization = true;
   bool aria_snapshot_isolation = false;
+  bool aria_partition_affinity = false;
+  bool work_stealing = false;          // see WorkStealing
+  std::size_t aria_target_latency = 0; // us, see AriaBatchController
+  std::size_t aria_min_batch_size = 10;
+  bool aria_input_replication = false; // see AriaExecutor
+  bool aria_generate_ahead = false;    // see AriaExecutor
 
   std::size_t ariaFB_lock_manager;
 
@@ -77,5 +268,11 @@ public:
   bool operation_replication = false;
 
   std::vector<std::string> peers;
+
+  // the command line flags, see RunResults
+  struct Flag {
+    std::string name, type, value;
+  };
+  std::vector<Flag> flags;
 };
 } // namespace coco
@@ -7,12 +7,34 @@
 #include "common/Encoder.h"
 #include "common/Message.h"
 #include "common/MessagePiece.h"
+#include "core/Statistics.h"
 
+#include <string>
 #include <vector>
 
 namespace coco {
 
-enum class ControlMessage { STATISTICS, VECTOR, SIGNAL, ACK, STOP, NFIELDS };
+enum class ControlMessage {
+  STATISTICS,
+  VECTOR,
+  SIGNAL,
+  ACK,
+  STOP,
+  LIVE_STATISTICS,
+  OPERATION_REPLICATION_REQUEST,
+  OPERATION_REPLICATION_RESPONSE,
+  ASYNC_CREDIT_REQUEST,
+  ASYNC_CREDIT_RESPONSE,
+  MIGRATION_ROWS,
+  MIGRATION_DONE,
+  MIGRATION_ACK,
+  HOT_KEY_REQUEST,
+  FIELD_ADDITION_REQUEST,
+  REBUILD_REQUEST,
+  REBUILD_ROWS,
+  REBUILD_DONE,
+  NFIELDS
+};
 
 class ControlMessageFactory {
 
@@ -35,6 +57,26 @@ public:
     return message_size;
   }
 
+  static std::size_t new_live_statistics_message(Message &message,
+                                                 const Statistics &s) {
+    /*
+     * The structure of a live statistics message: (encoded statistics, see
+     * Statistics::encode)
+     */
+
+    // the message is not associated with a table or a partition, use 0.
+    auto message_size = MessagePiece::get_header_size() + s.encoded_size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::LIVE_STATISTICS), message_size, 0,
+        0);
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    s.encode(encoder);
+    message.flush();
+    return message_size;
+  }
+
   static std::size_t new_vector_message(Message &message,
                                         const std::vector<int> &v) {
     /*
@@ -76,30 +118,34 @@ public:
     return message_size;
   }
 
-  static std::size_t new_ack_message(Message &message) {
+  static std::size_t new_ack_message(Message &message, uint64_t epoch = 0) {
     /*
-     * The structure of an ack message: ()
+     * The structure of an ack message: (epoch : uint64_t)
      */
 
-    auto message_size = MessagePiece::get_header_size();
+    auto message_size = MessagePiece::get_header_size() + sizeof(uint64_t);
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(ControlMessage::ACK), message_size, 0, 0);
     Encoder encoder(message.data);
     encoder << message_piece_header;
+    encoder << epoch;
     message.flush();
     return message_size;
   }
 
-  static std::size_t new_stop_message(Message &message) {
+  static std::size_t new_stop_message(Message &message,
+                                      const std::string &events = "") {
     /*
-     * The structure of a stop message: ()
+     * The structure of a stop message: (encoded migration events, see
+     * PartitionMap::encode)
      */
 
-    auto message_size = MessagePiece::get_header_size();
+    auto message_size = MessagePiece::get_header_size() + events.size();
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(ControlMessage::STOP), message_size, 0, 0);
     Encoder encoder(message.data);
     encoder << message_piece_header;
+    encoder.write_n_bytes(events.data(), events.size());
     message.flush();
     return message_size;
   }
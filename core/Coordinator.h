@@ -7,13 +7,36 @@
 #include "common/LockfreeQueue.h"
 #include "common/Message.h"
 #include "common/Socket.h"
+#include "core/AntiCache.h"
+#include "core/Checkpointer.h"
+#include "core/CommandLog.h"
 #include "core/ControlMessage.h"
+#include "core/DirectConnections.h"
 #include "core/Dispatcher.h"
 #include "core/Executor.h"
+#include "core/IngressServer.h"
+#include "core/MemoryReport.h"
+#include "core/MetricsServer.h"
+#include "core/Migrator.h"
+#include "core/ReplicaRebuilder.h"
+#include "core/NumaPlacement.h"
+#include "core/Priorities.h"
+#include "core/Profiler.h"
+#include "core/Recovery.h"
+#include "core/ReplicaShipper.h"
+#include "core/SnapshotQuery.h"
+#include "core/RunResults.h"
+#include "core/Statistics.h"
+#include "core/ThreadArenas.h"
+#include "core/Timeline.h"
+#include "core/VersionReclaimer.h"
 #include "core/Worker.h"
+#include "core/WorkloadPhases.h"
 #include "core/factory/WorkerFactory.h"
 #include <boost/algorithm/string.hpp>
 #include <glog/logging.h>
+#include <map>
+#include <sstream>
 #include <thread>
 #include <vector>
 
@@ -24,12 +47,126 @@ public:
   template <class Database, class Context>
   Coordinator(std::size_t id, Database &db, const Context &context)
       : id(id), coordinator_num(context.peers.size()), peers(context.peers),
-        context(context) {
+        context(context), core_id(context.cpu_core_id) {
     workerStopFlag.store(false);
     ioStopFlag.store(false);
+
+    // before the executors open (and truncate) the redo log or the command
+    // log, a command log is replayed by the executors
+    if (context.recover && context.command_log) {
+      auto n = CommandLog::load(context, id);
+      LOG(INFO) << "Coordinator " << id << " replays " << n
+                << " batches from the command log.";
+    } else if (context.recover) {
+      Recovery<Database>(id, db, context).run();
+    }
+
+    {
+      auto partitioner = PartitionerFactory::create_partitioner(
+          context.partitioner, id, context.coordinator_num);
+      local_tables = db.local_tables(*partitioner);
+      MemoryReport::log(local_tables);
+
+      // the replicas of the partitions stay in memory
+      if (!context.anti_cache_path.empty()) {
+        std::vector<ITable *> tables;
+        for (auto table : local_tables) {
+          if (context.is_evictable(table->tableID()) &&
+              partitioner->has_master_partition(table->partitionID())) {
+            tables.push_back(table);
+          }
+        }
+        antiCache = std::make_unique<AntiCache>(
+            id, std::move(tables), context.anti_cache_seconds, workerStopFlag);
+      }
+    }
+
+    // the workers of mvcc protocols advance the reclaimer, the tables of the
+    // other protocols remove the rows deleted since, see Tombstone
+    reclaimer = std::make_unique<VersionReclaimer>(
+        id, local_tables, context.worker_num, workerStopFlag);
+
+    // the tables of a partition share its gate, see PartitionGate
+    if (context.partition_serial) {
+      auto partitioner = PartitionerFactory::create_partitioner(
+          context.partitioner, id, context.coordinator_num);
+      for (auto i = 0u; i < context.partition_num; i++) {
+        if (!partitioner->has_master_partition(i)) {
+          continue;
+        }
+        partitionGates.push_back(std::make_unique<PartitionGate>());
+        for (auto table : db.partition_tables(i)) {
+          table->set_partition_gate(partitionGates.back().get());
+        }
+      }
+    }
+
+    // the executors take their requests from the server
+    if (context.ingress_port > 0) {
+      IngressServer::of(id).listen(
+          context.ingress_port + id, context.worker_num,
+          context.ingress_max_in_flight,
+          Priorities(context.priorities, context.priority_slo),
+          context.ingress_target_delay, context.ingress_interval);
+    }
+
     LOG(INFO) << "Coordinator initializes " << context.worker_num
               << " workers.";
-    workers = WorkerFactory::create_workers(id, db, context, workerStopFlag);
+    workers = WorkerFactory::create_workers(id, db, context, workerStopFlag,
+                                            reclaimer.get());
+
+    // the migrator comes after the manager
+    if (context.partitioner == "dynamic") {
+      std::vector<std::vector<ITable *>> tables;
+      for (auto i = 0u; i < context.partition_num; i++) {
+        tables.push_back(db.partition_tables(i));
+      }
+      workers.push_back(std::make_shared<Migrator>(
+          id, workers.size(), context, std::move(tables), workerStopFlag));
+    }
+
+    // every coordinator streams partitions to the ones that rebuild
+    if (!context.rebuild_replicas.empty()) {
+      std::vector<std::vector<ITable *>> tables;
+      for (auto i = 0u; i < context.partition_num; i++) {
+        tables.push_back(db.partition_tables(i));
+      }
+      workers.push_back(std::make_shared<ReplicaRebuilder>(
+          id, workers.size(), context, std::move(tables), workerStopFlag));
+    }
+
+    if (context.cpu_affinity && context.numa) {
+      numa = std::make_unique<NumaPlacement>(context);
+      LOG(INFO) << "Coordinator places workers on " << numa->node_num()
+                << " NUMA nodes.";
+    }
+
+    if (context.checkpoint_interval > 0) {
+      CHECK(!context.log_path.empty()) << "checkpoints require --log_path.";
+      auto partitioner = PartitionerFactory::create_partitioner(
+          context.partitioner, id, context.coordinator_num);
+      checkpointer = std::make_unique<Checkpointer>(
+          id, db.local_tables(*partitioner), context, workerStopFlag,
+          [this]() { return durable_epoch(); });
+    }
+
+    // a snapshot covers the partitions this coordinator masters
+    if (context.supports_snapshots()) {
+      auto partitioner = PartitionerFactory::create_partitioner(
+          context.partitioner, id, context.coordinator_num);
+      std::vector<ITable *> tables;
+      for (auto table : db.local_tables(*partitioner)) {
+        if (partitioner->has_master_partition(table->partitionID())) {
+          tables.push_back(table);
+        }
+      }
+      Snapshot::of(id).set_tables(std::move(tables));
+    }
+
+    if (context.snapshot_interval > 0) {
+      snapshotQuery =
+          std::make_unique<SnapshotQuery>(id, context, workerStopFlag);
+    }
 
     // init sockets vector
     inSockets.resize(context.io_thread_num);
@@ -45,6 +182,22 @@ public:
 
   void start() {
 
+    CHECK(!context.thread_arenas || ThreadArenas::available)
+        << "thread arenas require jemalloc.";
+
+    if (!context.timeline_path.empty()) {
+      Timeline::enable();
+    }
+
+    // the threads are sampled once they register, see profile_thread
+    if (!context.profile_path.empty()) {
+      if (context.profile_on_signal) {
+        Profiler::install_signal();
+      } else {
+        Profiler::start(context.profile_hz);
+      }
+    }
+
     // init dispatcher vector
     iDispatchers.resize(context.io_thread_num);
     oDispatchers.resize(context.io_thread_num);
@@ -57,18 +210,36 @@ public:
 
       iDispatchers[i] = std::make_unique<IncomingDispatcher>(
           id, i, context.io_thread_num, inSockets[i], workers, in_queue,
-          ioStopFlag);
+          ioStopFlag, context);
       oDispatchers[i] = std::make_unique<OutgoingDispatcher>(
           id, i, context.io_thread_num, outSockets[i], workers, out_queue,
-          ioStopFlag);
-
-      iDispatcherThreads.emplace_back(&IncomingDispatcher::start,
-                                      iDispatchers[i].get());
-      oDispatcherThreads.emplace_back(&OutgoingDispatcher::start,
-                                      oDispatchers[i].get());
+          ioStopFlag, context);
+
+      iDispatcherThreads.emplace_back([this, i]() {
+        bind_arena("incoming dispatcher " + std::to_string(i));
+        profile_thread("IncomingDispatcher", i);
+        iDispatchers[i]->start();
+      });
+      oDispatcherThreads.emplace_back([this, i]() {
+        bind_arena("outgoing dispatcher " + std::to_string(i));
+        profile_thread("OutgoingDispatcher", i);
+        oDispatchers[i]->start();
+      });
+      // with --irq_affinity, an incoming io thread runs where the
+      // interrupts of its sockets are handled, so the packets it reads are
+      // in the cache of its cpu
+      int cpu = context.irq_affinity ? incoming_cpu(i) : -1;
+      if (cpu >= 0) {
+        LOG(INFO) << "Incoming dispatcher " << i << " runs on cpu " << cpu
+                  << ", where its packets arrive.";
+        NumaPlacement::pin_thread(iDispatcherThreads[i].native_handle(), {cpu});
+      }
       if (context.cpu_affinity) {
-        pin_thread_to_core(iDispatcherThreads[i]);
-        pin_thread_to_core(oDispatcherThreads[i]);
+        // each io thread serves workers on all nodes
+        if (cpu < 0) {
+          pin_thread_to_core(iDispatcherThreads[i], i);
+        }
+        pin_thread_to_core(oDispatcherThreads[i], i);
       }
     }
 
@@ -77,92 +248,189 @@ public:
     LOG(INFO) << "Coordinator starts to run " << workers.size() << " workers.";
 
     for (auto i = 0u; i < workers.size(); i++) {
-      threads.emplace_back(&Worker::start, workers[i].get());
+      threads.emplace_back([this, i]() {
+        bind_arena("worker " + std::to_string(i));
+        // the manager is the last worker
+        profile_thread(i + 1 == workers.size() ? "Manager" : "Executor", i);
+        workers[i]->start();
+      });
       if (context.cpu_affinity) {
-        pin_thread_to_core(threads[i]);
+        pin_thread_to_core(threads[i], numa ? numa->worker_node(i) : 0);
       }
     }
 
+    std::thread checkpointerThread;
+    if (checkpointer) {
+      checkpointerThread =
+          std::thread(&Checkpointer::start, checkpointer.get());
+    }
+
+    std::thread snapshotQueryThread;
+    if (snapshotQuery) {
+      snapshotQueryThread =
+          std::thread(&SnapshotQuery::start, snapshotQuery.get());
+    }
+
+    std::thread reclaimerThread;
+    if (reclaimer) {
+      reclaimerThread = std::thread(&VersionReclaimer::start, reclaimer.get());
+    }
+
+    std::thread antiCacheThread;
+    if (antiCache) {
+      antiCacheThread = std::thread(&AntiCache::start, antiCache.get());
+    }
+
+    std::thread shipperThread;
+    if (!context.async_replica.empty()) {
+      shipperThread =
+          std::thread(&ReplicaShipper::start, &ReplicaShipper::of(id));
+    }
+
     // run timeToRun seconds
-    auto timeToRun = 25, warmup = 10, cooldown = 5;
+    int timeToRun = context.duration, warmup = context.warmup,
+        cooldown = context.cooldown;
     auto startTime = std::chrono::steady_clock::now();
 
-    uint64_t total_commit = 0, total_abort_no_retry = 0, total_abort_lock = 0,
-             total_abort_read_validation = 0, total_local = 0,
-             total_si_in_serializable = 0, total_network_size = 0;
+    // on coordinator 0, the statistics of all coordinators
+    Statistics stats, total_stats;
+    // committed transactions on this coordinator
+    uint64_t total_commit = 0;
+    // the rows that abort transactions on this coordinator
+    ConflictProfile conflicts;
     int count = 0;
 
-    do {
-      std::this_thread::sleep_for(std::chrono::seconds(1));
+    std::unique_ptr<MetricsServer> metrics;
+    if (context.metrics_port > 0) {
+      metrics = std::make_unique<MetricsServer>(id, context.metrics_port + id);
+      metrics->start();
+    }
 
-      uint64_t n_commit = 0, n_abort_no_retry = 0, n_abort_lock = 0,
-               n_abort_read_validation = 0, n_local = 0,
-               n_si_in_serializable = 0, n_network_size = 0;
+    if (context.ingress_port > 0) {
+      IngressServer::of(id).start();
+    }
 
-      for (auto i = 0u; i < workers.size(); i++) {
+    // on coordinator 0, see RunResults
+    std::unique_ptr<RunResults> results;
+    if (id == 0 && !context.results_path.empty()) {
+      results = std::make_unique<RunResults>(context);
+    }
 
-        n_commit += workers[i]->n_commit.load();
-        workers[i]->n_commit.store(0);
+    // the measured statistics and seconds of each phase, see WorkloadPhases
+    auto &phases = WorkloadPhases::global();
+    std::vector<Statistics> phase_stats(phases.size());
+    std::vector<int> phase_seconds(phases.size());
+    phases.set_second(1);
 
-        n_abort_no_retry += workers[i]->n_abort_no_retry.load();
-        workers[i]->n_abort_no_retry.store(0);
+    do {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      update_profiler();
 
-        n_abort_lock += workers[i]->n_abort_lock.load();
-        workers[i]->n_abort_lock.store(0);
+      count++;
+      bool measured = count > warmup && count <= timeToRun - cooldown;
 
-        n_abort_read_validation += workers[i]->n_abort_read_validation.load();
-        workers[i]->n_abort_read_validation.store(0);
+      stats.clear();
+      for (auto i = 0u; i < workers.size(); i++) {
+        workers[i]->collect_statistics(stats);
+      }
+      if (measured) {
+        total_commit += stats.n_commit;
+      }
+      // before the statistics of the other coordinators are merged
+      if (metrics) {
+        std::size_t bytes_in = 0, bytes_out = 0;
+        for (auto i = 0u; i < context.io_thread_num; i++) {
+          bytes_in += iDispatchers[i]->get_network_size();
+          bytes_out += oDispatchers[i]->get_network_size();
+        }
+        if (context.ingress_port > 0) {
+          auto &ingress = IngressServer::of(id);
+          metrics->update_ingress(ingress.get_n_admitted(),
+                                  ingress.get_n_rejected(),
+                                  ingress.get_n_shed());
+        }
+        metrics->update(stats, bytes_in, bytes_out);
+      }
+      gather_statistics(stats);
 
-        n_local += workers[i]->n_local.load();
-        workers[i]->n_local.store(0);
+      log_statistics(id == 0 ? "cluster " : "", stats);
+      if (measured) {
+        total_stats.merge(stats);
+      }
+      if (results) {
+        results->add_second(count, measured, stats);
+      }
+      if (phases.enabled()) {
+        if (measured) {
+          auto phase = phases.phase_of(count);
+          phase_stats[phase].merge(stats);
+          phase_seconds[phase]++;
+        }
+        phases.set_second(count + 1);
+      }
 
-        n_si_in_serializable += workers[i]->n_si_in_serializable.load();
-        workers[i]->n_si_in_serializable.store(0);
+      if (context.message_latency) {
+        MessageStatistics message_statistics(0, 0);
+        for (auto i = 0u; i < workers.size(); i++) {
+          if (workers[i]->message_statistics != nullptr) {
+            workers[i]->message_statistics->collect(message_statistics);
+          }
+        }
+        message_statistics.log();
+      }
 
-        n_network_size += workers[i]->n_network_size.load();
-        workers[i]->n_network_size.store(0);
+      if (context.conflict_profile > 0 &&
+          count % context.conflict_profile == 0) {
+        for (auto i = 0u; i < workers.size(); i++) {
+          workers[i]->conflicts.collect(conflicts);
+        }
+        conflicts.log();
       }
 
-      LOG(INFO) << "commit: " << n_commit << " abort: "
-                << n_abort_no_retry + n_abort_lock + n_abort_read_validation
-                << " (" << n_abort_no_retry << "/" << n_abort_lock << "/"
-                << n_abort_read_validation
-                << "), network size: " << n_network_size
-                << ", avg network size: " << 1.0 * n_network_size / n_commit
-                << ", si_in_serializable: " << n_si_in_serializable << " "
-                << 100.0 * n_si_in_serializable / n_commit << " %"
-                << ", local: " << 100.0 * n_local / n_commit << " %";
-      count++;
-      if (count > warmup && count <= timeToRun - cooldown) {
-        total_commit += n_commit;
-        total_abort_no_retry += n_abort_no_retry;
-        total_abort_lock += n_abort_lock;
-        total_abort_read_validation += n_abort_read_validation;
-        total_local += n_local;
-        total_si_in_serializable += n_si_in_serializable;
-        total_network_size += n_network_size;
+      if (context.memory_report > 0 && count % context.memory_report == 0) {
+        MemoryReport::log(local_tables);
       }
 
     } while (std::chrono::duration_cast<std::chrono::seconds>(
                  std::chrono::steady_clock::now() - startTime)
                  .count() < timeToRun);
 
+    if (!context.profile_path.empty() && Profiler::running()) {
+      dump_profile();
+    }
+
     count = timeToRun - warmup - cooldown;
 
-    LOG(INFO) << "average commit: " << 1.0 * total_commit / count << " abort: "
-              << 1.0 *
-                     (total_abort_no_retry + total_abort_lock +
-                      total_abort_read_validation) /
-                     count
-              << " (" << 1.0 * total_abort_no_retry / count << "/"
-              << 1.0 * total_abort_lock / count << "/"
-              << 1.0 * total_abort_read_validation / count
-              << "), network size: " << total_network_size
-              << ", avg network size: "
-              << 1.0 * total_network_size / total_commit
-              << ", si_in_serializable: " << total_si_in_serializable << " "
-              << 100.0 * total_si_in_serializable / total_commit << " %"
-              << ", local: " << 100.0 * total_local / total_commit << " %";
+    LOG(INFO) << "average commit: " << 1.0 * total_stats.n_commit / count
+              << " abort: " << 1.0 * total_stats.n_abort() / count << " ("
+              << 1.0 * total_stats.n_abort_no_retry / count << "/"
+              << 1.0 * total_stats.n_abort_lock / count << "/"
+              << 1.0 * total_stats.n_abort_read_validation / count << ")";
+    log_statistics(id == 0 ? "total cluster " : "total ", total_stats);
+    log_procedures(id == 0 ? "total cluster " : "total ", total_stats, count);
+    Priorities priorities(context.priorities, context.priority_slo);
+    if (priorities.enabled()) {
+      priorities.log(id == 0 ? "total cluster " : "total ", total_stats, count);
+    }
+    if (results) {
+      results->set_total(total_stats, count);
+    }
+    run_statistics = total_stats;
+    run_seconds = count;
+    for (auto i = 0u; i < phases.size(); i++) {
+      auto seconds = phase_seconds[i];
+      LOG(INFO) << "phase " << i << " (" << phases.get(i).to_string()
+                << ") commit: "
+                << (seconds > 0 ? 1.0 * phase_stats[i].n_commit / seconds : 0)
+                << " over " << seconds << " measured seconds";
+      log_statistics("phase " + std::to_string(i) +
+                         (id == 0 ? " cluster " : " "),
+                     phase_stats[i]);
+      if (results) {
+        results->add_phase(i, phases.get(i).to_string(), phase_stats[i],
+                           seconds);
+      }
+    }
 
     workerStopFlag.store(true);
 
@@ -171,11 +439,56 @@ public:
       threads[i].join();
     }
 
+    if (checkpointerThread.joinable()) {
+      checkpointerThread.join();
+    }
+
+    if (snapshotQueryThread.joinable()) {
+      snapshotQueryThread.join();
+    }
+
+    if (reclaimerThread.joinable()) {
+      reclaimerThread.join();
+    }
+
+    if (antiCacheThread.joinable()) {
+      antiCacheThread.join();
+    }
+
+    // the executors hand back their requests before they exit
+    if (context.ingress_port > 0) {
+      auto &ingress = IngressServer::of(id);
+      ingress.stop();
+      LOG(INFO) << "Coordinator " << id << " admitted "
+                << ingress.get_n_admitted() << ", rejected "
+                << ingress.get_n_rejected() << " and shed "
+                << ingress.get_n_shed() << " client transactions, "
+                << ingress.get_n_overloads() << " queue overloads.";
+    }
+
+    // the epochs of the executors are shipped before they exit
+    if (shipperThread.joinable()) {
+      ReplicaShipper::of(id).stop();
+      shipperThread.join();
+    }
+
+    if (!context.timeline_path.empty()) {
+      Timeline::dump(context.timeline_path + "/" + std::to_string(id) + ".json",
+                     id);
+    }
+
     // gather throughput
-    double sum_commit = gather(1.0 * total_commit / count);
+    std::vector<double> node_commits;
+    double sum_commit = gather(1.0 * total_commit / count, &node_commits);
     if (id == 0) {
       LOG(INFO) << "total commit: " << sum_commit;
     }
+    if (results) {
+      results->set_node_commits(node_commits);
+      results->write(context.results_path);
+      LOG(INFO) << "Coordinator wrote the run results to "
+                << context.results_path;
+    }
 
     // make sure all messages are sent
     std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -192,8 +505,19 @@ public:
     LOG(INFO) << "Coordinator exits.";
   }
 
+  // the measured statistics of the run, of the cluster on coordinator 0,
+  // see Sweep
+  const Statistics &get_run_statistics() const { return run_statistics; }
+
+  int get_run_seconds() const { return run_seconds; }
+
   void connectToPeers() {
 
+    // the async replica is not a peer, see AsyncReplica
+    if (!context.async_replica.empty()) {
+      ReplicaShipper::of(id).connect(id, context);
+    }
+
     // single node test mode
     if (peers.size() == 1) {
       return;
@@ -232,6 +556,7 @@ public:
               socket.set_quick_ack_flag(tcp_quick_ack);
               inSockets[c_id] = std::move(socket);
             }
+            l.close();
 
             LOG(INFO) << "Listener " << listener_id << " on coordinator " << id
                       << " exits.";
@@ -241,44 +566,18 @@ public:
 
     // connect to peers
     auto n = peers.size();
-    constexpr std::size_t retryLimit = 50;
 
     // connect to multiple remote coordinators
     for (auto i = 0u; i < n; i++) {
       if (i == id)
         continue;
-      std::vector<std::string> addressPort = getAddressPort(peers[i]);
       // connnect to multiple remote listeners
       for (auto listener_id = 0u; listener_id < context.io_thread_num;
            listener_id++) {
-        for (auto k = 0u; k < retryLimit; k++) {
-          Socket socket;
-
-          int ret = socket.connect(addressPort[0].c_str(),
-                                   atoi(addressPort[1].c_str()) + listener_id);
-          if (ret == -1) {
-            socket.close();
-            if (k == retryLimit - 1) {
-              LOG(FATAL) << "failed to connect to peers, exiting ...";
-              exit(1);
-            }
-
-            // listener on the other side has not been set up.
-            LOG(INFO) << "Coordinator " << id << " failed to connect " << i
-                      << "(" << peers[i] << ")'s listener " << listener_id
-                      << ", retry in 5 seconds.";
-            std::this_thread::sleep_for(std::chrono::seconds(5));
-            continue;
-          }
-          if (context.tcp_no_delay) {
-            socket.disable_nagle_algorithm();
-          }
-
-          LOG(INFO) << "Coordinator " << id << " connected to " << i;
-          socket.write_number(id);
-          outSockets[listener_id][i] = std::move(socket);
-          break;
-        }
+        Socket socket = connect_to_peer(i, listener_id);
+        LOG(INFO) << "Coordinator " << id << " connected to " << i;
+        socket.write_number(id);
+        outSockets[listener_id][i] = std::move(socket);
       }
     }
 
@@ -287,9 +586,25 @@ public:
     }
 
     LOG(INFO) << "Coordinator " << id << " connected to all peers.";
+
+    if (context.direct_connections) {
+      connect_executors();
+    }
+
+    if (context.transport == "rdma") {
+      setup_rdma();
+    } else {
+      CHECK(context.transport == "tcp")
+          << "unknown transport: " << context.transport;
+      setup_shm();
+      setup_busy_poll();
+      setup_socket_buffers();
+    }
   }
 
-  double gather(double value) {
+  // on coordinator 0, the sum of value over the coordinators, and with
+  // values, value of each coordinator by id
+  double gather(double value, std::vector<double> *values = nullptr) {
 
     auto init_message = [](Message *message, std::size_t coordinator_id,
                            std::size_t dest_node_id) {
@@ -301,6 +616,10 @@ public:
     double sum = value;
 
     if (id == 0) {
+      if (values != nullptr) {
+        values->assign(coordinator_num, 0);
+        (*values)[0] = value;
+      }
       for (std::size_t i = 0; i < coordinator_num - 1; i++) {
 
         in_queue.wait_till_non_empty();
@@ -311,6 +630,13 @@ public:
 
         MessagePiece messagePiece = *(message->begin());
 
+        // late live statistics, see gather_statistics
+        if (messagePiece.get_message_type() ==
+            static_cast<uint32_t>(ControlMessage::LIVE_STATISTICS)) {
+          i--;
+          continue;
+        }
+
         CHECK(messagePiece.get_message_type() ==
               static_cast<uint32_t>(ControlMessage::STATISTICS));
         CHECK(messagePiece.get_message_length() ==
@@ -319,6 +645,9 @@ public:
         double v;
         dec >> v;
         sum += v;
+        if (values != nullptr) {
+          (*values)[message->get_source_node_id()] = v;
+        }
       }
 
     } else {
@@ -330,23 +659,399 @@ public:
     return sum;
   }
 
+  /*
+   * Every second, the other coordinators send their statistics to coordinator
+   * 0, which merges the ones received so far into s. It does not wait, so
+   * statistics arriving late are counted in the next second, and the ones left
+   * when the run ends are dropped by gather.
+   */
+  void gather_statistics(Statistics &s) {
+    if (id != 0) {
+      auto message = std::make_unique<Message>();
+      message->set_source_node_id(id);
+      message->set_dest_node_id(0);
+      message->set_worker_id(0);
+      ControlMessageFactory::new_live_statistics_message(*message, s);
+      out_queue.push(message.release());
+      return;
+    }
+
+    // a statistics message ends the live statistics from a coordinator
+    while (!in_queue.empty()) {
+      Message *front = in_queue.front();
+      if ((*(front->begin())).get_message_type() !=
+          static_cast<uint32_t>(ControlMessage::LIVE_STATISTICS)) {
+        break;
+      }
+      std::unique_ptr<Message> message(front);
+      bool ok = in_queue.pop();
+      CHECK(ok);
+      CHECK(message->get_message_count() == 1);
+      MessagePiece messagePiece = *(message->begin());
+      Decoder dec(messagePiece.toStringPiece());
+      s.decode_and_merge(dec);
+    }
+  }
+
+  void log_statistics(const std::string &prefix, const Statistics &s) {
+    LOG(INFO) << prefix << "commit: " << s.n_commit << " abort: " << s.n_abort()
+              << " (" << s.n_abort_no_retry << "/" << s.n_abort_lock << "/"
+              << s.n_abort_read_validation
+              << "), network size: " << s.n_network_size
+              << ", avg network size: " << 1.0 * s.n_network_size / s.n_commit
+              << ", si_in_serializable: " << s.n_si_in_serializable << " "
+              << 100.0 * s.n_si_in_serializable / s.n_commit << " %"
+              << ", local: " << 100.0 * s.n_local / s.n_commit << " %"
+              << ", latency: " << s.latency.nth(50) << " us (50%) "
+              << s.latency.nth(99) << " us (99%) " << s.latency.nth(99.9)
+              << " us (99.9%), phases (us/txn): execute "
+              << s.phase_us(TransactionPhase::EXECUTE) << " lock "
+              << s.phase_us(TransactionPhase::LOCK) << " validate "
+              << s.phase_us(TransactionPhase::VALIDATE) << " write "
+              << s.phase_us(TransactionPhase::WRITE) << " group commit wait "
+              << s.phase_us(TransactionPhase::GROUP_COMMIT_WAIT)
+              << ", queue stalls: " << s.n_queue_stall << " ("
+              << s.queue_stall_time / 1000 << " us), deferred flushes: "
+              << s.n_deferred_flush
+              << ", max queue occupancy: " << s.queue_occupancy;
+    if (context.perf_counters) {
+      log_phase_events(prefix, s);
+    }
+  }
+
+  // the average commits and aborts per second and the latencies of each
+  // transaction type in s over seconds, see Statistics::procedures
+  void log_procedures(const std::string &prefix, const Statistics &s,
+                      int seconds) {
+    for (auto &p : s.procedures) {
+      auto &t = p.second;
+      auto n = t.n_commit() + t.n_abort();
+      LOG(INFO) << prefix << "procedure " << p.first
+                << " commit: " << 1.0 * t.n_commit() / seconds
+                << " abort: " << 1.0 * t.n_abort() / seconds << " ("
+                << 1.0 * t.n_abort_no_retry / seconds << "/"
+                << 1.0 * t.n_abort_lock / seconds << "/"
+                << 1.0 * t.n_abort_read_validation / seconds
+                << "), abort rate: " << (n == 0 ? 0 : 100.0 * t.n_abort() / n)
+                << " %, latency: " << t.latency.nth(50) << " us (50%) "
+                << t.latency.nth(99) << " us (99%) " << t.latency.nth(99.9)
+                << " us (99.9%)";
+    }
+  }
+
+  // hardware events per committed transaction, see PerfCounters
+  void log_phase_events(const std::string &prefix, const Statistics &s) {
+    static const char *phases[N_TRANSACTION_PHASES] = {
+        "execute", "lock", "validate", "write", "group commit wait"};
+    std::ostringstream os;
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      auto phase = static_cast<TransactionPhase>(i);
+      auto cycles = s.phase_events_per_txn(phase, PerfEvent::CYCLES);
+      if (cycles == 0) {
+        continue;
+      }
+      os << ", " << phases[i] << " " << cycles << " cycles (IPC "
+         << s.phase_events_per_txn(phase, PerfEvent::INSTRUCTIONS) / cycles
+         << ") " << s.phase_events_per_txn(phase, PerfEvent::LLC_MISSES)
+         << " LLC misses "
+         << s.phase_events_per_txn(phase, PerfEvent::DTLB_MISSES)
+         << " dTLB misses";
+    }
+    LOG(INFO) << prefix << "hardware events per txn" << os.str();
+  }
+
 private:
-  void close_sockets() {
-    for (auto i = 0u; i < inSockets.size(); i++) {
-      for (auto j = 0u; j < inSockets[i].size(); j++) {
-        inSockets[i][j].close();
+  // retries until the listener_id-th listener of coordinator i is up
+  Socket connect_to_peer(std::size_t i, std::size_t listener_id) {
+    constexpr std::size_t retryLimit = 50;
+
+    std::vector<std::string> addressPort;
+    boost::algorithm::split(addressPort, peers[i], boost::is_any_of(":"));
+
+    for (auto k = 0u; k < retryLimit; k++) {
+      Socket socket;
+
+      int ret = socket.connect(addressPort[0].c_str(),
+                               atoi(addressPort[1].c_str()) + listener_id);
+      if (ret == -1) {
+        socket.close();
+        if (k == retryLimit - 1) {
+          LOG(FATAL) << "failed to connect to peers, exiting ...";
+          exit(1);
+        }
+
+        // listener on the other side has not been set up.
+        LOG(INFO) << "Coordinator " << id << " failed to connect " << i << "("
+                  << peers[i] << ")'s listener " << listener_id
+                  << ", retry in 5 seconds.";
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+        continue;
+      }
+      if (context.tcp_no_delay) {
+        socket.disable_nagle_algorithm();
+      }
+      return socket;
+    }
+    return Socket();
+  }
+
+  /*
+   * With --direct_connections, executor i connects to executor i on each
+   * peer, through one more listener on the port after the ones of the io
+   * threads. directInSockets[i][j] receives from coordinator j.
+   */
+  void connect_executors() {
+    CHECK(context.transport == "tcp")
+        << "direct connections require the tcp transport.";
+
+    auto n = peers.size();
+    auto worker_num = context.worker_num;
+    directInSockets.resize(worker_num);
+    directOutSockets.resize(worker_num);
+    for (auto i = 0u; i < worker_num; i++) {
+      directInSockets[i].resize(n);
+      directOutSockets[i].resize(n);
+    }
+
+    std::thread listenerThread([this, n, worker_num]() {
+      std::vector<std::string> addressPort;
+      boost::algorithm::split(addressPort, peers[id], boost::is_any_of(":"));
+      Listener l(addressPort[0].c_str(),
+                 atoi(addressPort[1].c_str()) + context.io_thread_num, 100);
+
+      for (std::size_t i = 0; i < (n - 1) * worker_num; i++) {
+        Socket socket = l.accept();
+        std::size_t c_id, w_id;
+        socket.read_number(c_id);
+        socket.read_number(w_id);
+        CHECK(c_id < n && w_id < worker_num);
+        socket.set_quick_ack_flag(context.tcp_quick_ack);
+        directInSockets[w_id][c_id] = std::move(socket);
+      }
+      l.close();
+    });
+
+    for (auto i = 0u; i < n; i++) {
+      if (i == id) {
+        continue;
+      }
+      for (auto w = 0u; w < worker_num; w++) {
+        Socket socket = connect_to_peer(i, context.io_thread_num);
+        socket.write_number(id);
+        socket.write_number(std::size_t(w));
+        directOutSockets[w][i] = std::move(socket);
+      }
+    }
+
+    listenerThread.join();
+
+    // the executors come first in workers
+    for (auto i = 0u; i < worker_num; i++) {
+      workers[i]->direct = std::make_unique<DirectConnections>(
+          id, directInSockets[i], directOutSockets[i], context);
+    }
+
+    LOG(INFO) << "Coordinator " << id << " connected " << worker_num
+              << " executors to all peers.";
+  }
+
+  // the executors come first in workers, then the manager (if any) and the
+  // migrator (if any)
+  uint64_t durable_epoch() {
+    uint64_t epoch = workers[0]->n_durable_epochs.load();
+    for (auto i = 1u; i < context.worker_num; i++) {
+      epoch = std::min(epoch, workers[i]->n_durable_epochs.load());
+    }
+    return epoch;
+  }
+
+  void setup_rdma() {
+#ifdef COCO_HAS_RDMA
+    // completions are polled, there is nothing for epoll to wait on
+    CHECK(context.network_engine == "poll")
+        << "rdma transport requires the poll network engine.";
+
+    // the direct connections stay on tcp
+    for_each_socket(
+        [this](Socket &socket) { socket.begin_rdma(context.rdma_gid_index); },
+        false);
+    for_each_socket([](Socket &socket) { socket.finish_rdma(); }, false);
+    for_each_socket([](Socket &socket) { socket.wait_rdma(); }, false);
+
+    LOG(INFO) << "Coordinator " << id << " switched to rdma transport.";
+#else
+    CHECK(false) << "rdma transport requires building with libibverbs.";
+#endif
+  }
+
+  // co-located peers switch to shared memory, see ShmConnection
+  void setup_shm() {
+    // the rings are polled, there is nothing for epoll to wait on
+    if (!context.shm_transport || context.network_engine != "poll") {
+      return;
+    }
+
+    std::vector<bool> local(peers.size());
+    std::size_t n_local = 0;
+    for (auto i = 0u; i < peers.size(); i++) {
+      std::vector<std::string> addressPort;
+      boost::algorithm::split(addressPort, peers[i], boost::is_any_of(":"));
+      local[i] = i != id && ShmConnection::is_local(addressPort[0].c_str());
+      n_local += local[i];
+    }
+    if (n_local == 0) {
+      return;
+    }
+
+    auto is_local = [&local](std::size_t j) { return local[j]; };
+    for_each_socket([](Socket &socket) { socket.begin_shm(); }, true,
+                    is_local);
+    for_each_socket([](Socket &socket) { socket.finish_shm(); }, true,
+                    is_local);
+    for_each_socket([](Socket &socket) { socket.wait_shm(); }, true, is_local);
+
+    LOG(INFO) << "Coordinator " << id << " talks to " << n_local
+              << " co-located coordinators through shared memory.";
+  }
+
+  void setup_busy_poll() {
+    if (context.busy_poll == 0) {
+      return;
+    }
+
+    int error = 0;
+    for_each_socket([this, &error](Socket &socket) {
+      if (!socket.set_busy_poll(context.busy_poll)) {
+        error = errno;
+      }
+    });
+    if (error == 0) {
+      LOG(INFO) << "Coordinator " << id << " busy polls sockets for "
+                << context.busy_poll << " us.";
+    } else {
+      LOG(WARNING) << "Coordinator " << id
+                   << " failed to set busy poll, errno: " << error
+                   << ", check net.core.busy_read.";
+    }
+  }
+
+  void setup_socket_buffers() {
+    if (context.socket_buffer == 0) {
+      return;
+    }
+
+    bool ok = true;
+    for_each_socket([this, &ok](Socket &socket) {
+      ok = socket.set_buffer_size(context.socket_buffer * 1024) && ok;
+    });
+    LOG_IF(WARNING, !ok) << "Coordinator " << id
+                         << " failed to set socket buffers, check "
+                            "net.core.rmem_max and net.core.wmem_max.";
+  }
+
+  // the cpu most packets of the incoming sockets of io thread i arrive on,
+  // or -1 if the kernel does not tell
+  int incoming_cpu(std::size_t i) {
+    std::map<int, std::size_t> counts;
+    for (auto j = 0u; j < inSockets[i].size(); j++) {
+      if (j != id) {
+        counts[inSockets[i][j].incoming_cpu()]++;
+      }
+    }
+    int cpu = -1;
+    std::size_t n = 0;
+    for (auto &count : counts) {
+      if (count.first >= 0 && count.second > n) {
+        cpu = count.first;
+        n = count.second;
+      }
+    }
+    return cpu;
+  }
+
+  // func(socket) on the sockets connected to each peer j with filter(j), the
+  // direct connections too unless direct is false
+  template <class Func, class Filter = bool (*)(std::size_t)>
+  void for_each_socket(Func func, bool direct = true,
+                       Filter filter = any_peer) {
+    for (auto *sockets :
+         {&inSockets, &outSockets, &directInSockets, &directOutSockets}) {
+      if (!direct &&
+          (sockets == &directInSockets || sockets == &directOutSockets)) {
+        continue;
+      }
+      for (auto i = 0u; i < sockets->size(); i++) {
+        for (auto j = 0u; j < (*sockets)[i].size(); j++) {
+          if (j != id && filter(j)) {
+            func((*sockets)[i][j]);
+          }
+        }
       }
     }
-    for (auto i = 0u; i < outSockets.size(); i++) {
-      for (auto j = 0u; j < outSockets[i].size(); j++) {
-        outSockets[i][j].close();
+  }
+
+  static bool any_peer(std::size_t) { return true; }
+
+  void close_sockets() {
+    for (auto *sockets :
+         {&inSockets, &outSockets, &directInSockets, &directOutSockets}) {
+      for (auto i = 0u; i < sockets->size(); i++) {
+        for (auto j = 0u; j < (*sockets)[i].size(); j++) {
+          (*sockets)[i][j].close();
+        }
       }
     }
   }
 
-  void pin_thread_to_core(std::thread &t) {
+  // called by a thread before it runs, see ThreadArenas
+  void profile_thread(const char *role, std::size_t index) {
+    if (!context.profile_path.empty()) {
+      Profiler::register_thread(id, role, index);
+    }
+  }
+
+  // with --profile_on_signal, a SIGUSR2 starts the profiler and the next one
+  // stops it and writes the profile
+  void update_profiler() {
+    if (context.profile_path.empty() || !context.profile_on_signal) {
+      return;
+    }
+    auto n = Profiler::get_n_signals();
+    if (n == n_profile_signals) {
+      return;
+    }
+    n_profile_signals = n;
+    if (n % 2 == 1) {
+      LOG(INFO) << "Coordinator " << id << " starts to profile.";
+      Profiler::start(context.profile_hz);
+    } else {
+      dump_profile();
+    }
+  }
+
+  // <profile_path>/<id>.pb, or <id>.<n>.pb with --profile_on_signal
+  void dump_profile() {
+    Profiler::stop();
+    auto filename = context.profile_path + "/" + std::to_string(id);
+    if (context.profile_on_signal) {
+      filename += "." + std::to_string(n_profiles++);
+    }
+    Profiler::dump(filename + ".pb", id);
+  }
+
+  void bind_arena(const std::string &name) {
+    if (context.thread_arenas) {
+      ThreadArenas::bind(name);
+    }
+  }
+
+  void pin_thread_to_core(std::thread &t, std::size_t node) {
 #ifndef __APPLE__
-    static std::size_t core_id = context.cpu_core_id;
+    if (numa) {
+      NumaPlacement::pin_thread(t.native_handle(),
+                                {numa->take_cpu(node % numa->node_num())});
+      return;
+    }
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
     CPU_SET(core_id++, &cpuset);
@@ -368,10 +1073,27 @@ private:
   const std::vector<std::string> &peers;
   const Context &context;
   std::vector<std::vector<Socket>> inSockets, outSockets;
+  // see connect_executors
+  std::vector<std::vector<Socket>> directInSockets, directOutSockets;
   std::atomic<bool> workerStopFlag, ioStopFlag;
   std::vector<std::shared_ptr<Worker>> workers;
   std::vector<std::unique_ptr<IncomingDispatcher>> iDispatchers;
   std::vector<std::unique_ptr<OutgoingDispatcher>> oDispatchers;
+  std::unique_ptr<Checkpointer> checkpointer;
+  std::unique_ptr<SnapshotQuery> snapshotQuery;
+  std::vector<std::unique_ptr<PartitionGate>> partitionGates;
+  std::unique_ptr<VersionReclaimer> reclaimer;
+  std::unique_ptr<AntiCache> antiCache;
+  std::unique_ptr<NumaPlacement> numa;
+  // the tables on this node, see MemoryReport
+  std::vector<ITable *> local_tables;
   LockfreeQueue<Message *> in_queue, out_queue;
+  // the next core of pin_thread_to_core
+  std::size_t core_id;
+  // the SIGUSR2 seen so far and the profiles written, see update_profiler
+  uint64_t n_profile_signals = 0;
+  std::size_t n_profiles = 0;
+  Statistics run_statistics;
+  int run_seconds = 0;
 };
 } // namespace coco
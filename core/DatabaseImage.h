@@ -0,0 +1,171 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/BufferedFileWriter.h"
+#include "core/NumaPlacement.h"
+#include "core/Table.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  DatabaseImage -- format --
+ *
+ *  An image of a table partition is a header (magic : uint64_t, key size :
+ *  uint64_t, value size : uint64_t) followed by the rows, each the raw bytes
+ *  of its key and its value, so <image_path>/<table id>_<partition id>.img
+ *  is only meant for the binary that wrote it. The metadata of the rows is
+ *  not kept, a loaded row starts at timestamp 0 like a generated one.
+ *
+ *  With --dump_image, a benchmark generates its database, writes the images of
+ *  the tables on this node and exits. With --image_path alone, the database
+ *  loads the images instead of generating the rows: each image is mapped and
+ *  its rows are inserted into a table reserved for them, a thread per worker,
+ *  so startup is bounded by the disk. The images must be dumped with the same
+ *  flags, e.g., --keys and --partition_num.
+ */
+
+class DatabaseImage {
+public:
+  static constexpr uint64_t MAGIC = 0x636f636f696d6731; // "cocoimg1"
+
+  static std::string file_name(const std::string &image_path,
+                               std::size_t table_id,
+                               std::size_t partition_id) {
+    return image_path + "/" + std::to_string(table_id) + "_" +
+           std::to_string(partition_id) + ".img";
+  }
+
+  static void dump(ITable &table, const std::string &filename) {
+    std::string tmp_filename = filename + ".tmp";
+    BufferedFileWriter writer(tmp_filename.c_str());
+
+    uint64_t header[3] = {MAGIC, table.key_size(), table.value_size()};
+    writer.write(reinterpret_cast<const char *>(header), sizeof(header));
+    table.for_each_row([&](const void *key, ITable::MetaDataType &metadata,
+                           void *value) {
+      writer.write(static_cast<const char *>(key), table.key_size());
+      writer.write(static_cast<const char *>(value), table.value_size());
+    });
+    writer.sync();
+    writer.close();
+
+    int err = std::rename(tmp_filename.c_str(), filename.c_str());
+    CHECK(err == 0) << "failed to rename " << tmp_filename << ", errno: "
+                    << errno;
+  }
+
+  // returns false if there is no image, the table must be empty
+  static bool load(ITable &table, const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    CHECK(fstat(fd, &st) == 0);
+    std::size_t size = st.st_size;
+    CHECK(size >= HEADER_SIZE) << filename << " is not an image.";
+
+    void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd,
+                     0);
+    CHECK(ptr != MAP_FAILED) << "failed to map " << filename
+                             << ", errno: " << errno;
+    close(fd);
+    madvise(ptr, size, MADV_SEQUENTIAL);
+
+    auto header = static_cast<const uint64_t *>(ptr);
+    CHECK(header[0] == MAGIC) << filename << " is not an image.";
+    CHECK(header[1] == table.key_size() && header[2] == table.value_size())
+        << filename << " is an image of another schema.";
+
+    std::size_t row_size = table.key_size() + table.value_size();
+    CHECK((size - HEADER_SIZE) % row_size == 0)
+        << filename << " is truncated.";
+    std::size_t n = (size - HEADER_SIZE) / row_size;
+    table.reserve(n);
+
+    // rows are not aligned in the image, each is copied to an aligned buffer
+    // before insert copies it into the table
+    std::vector<uint64_t> buffer((row_size + 7) / 8);
+    auto copy = reinterpret_cast<char *>(buffer.data());
+    auto row = static_cast<const char *>(ptr) + HEADER_SIZE;
+    for (auto i = 0u; i < n; i++, row += row_size) {
+      std::memcpy(copy, row, row_size);
+      table.insert(copy, copy + table.key_size());
+    }
+    munmap(ptr, size);
+    return true;
+  }
+
+  // calls func(table) on each table with threads threads, each pinned to the
+  // node of the partition if numa is not nullptr
+  template <class Func>
+  static void for_each_table(const std::string &name,
+                             const std::vector<ITable *> &tables,
+                             std::size_t threads, const NumaPlacement *numa,
+                             Func func) {
+    std::vector<std::thread> v;
+    auto now = std::chrono::steady_clock::now();
+    for (auto threadID = 0u; threadID < threads; threadID++) {
+      v.emplace_back([=, &tables]() {
+        for (auto i = threadID; i < tables.size(); i += threads) {
+          if (numa != nullptr) {
+            NumaPlacement::pin_thread(
+                pthread_self(),
+                numa->cpus(numa->partition_node(tables[i]->partitionID())));
+          }
+          func(*tables[i]);
+        }
+      });
+    }
+    for (auto &t : v) {
+      t.join();
+    }
+    LOG(INFO) << name << " " << tables.size() << " table images in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - now)
+                     .count()
+              << " milliseconds.";
+  }
+
+  static void dump_all(const std::vector<ITable *> &tables,
+                       const std::string &image_path, std::size_t threads,
+                       const NumaPlacement *numa) {
+    for_each_table("dumped", tables, threads, numa,
+                   [&image_path](ITable &table) {
+                     dump(table, file_name(image_path, table.tableID(),
+                                           table.partitionID()));
+                   });
+  }
+
+  static void load_all(const std::vector<ITable *> &tables,
+                       const std::string &image_path, std::size_t threads,
+                       const NumaPlacement *numa) {
+    for_each_table("loaded", tables, threads, numa,
+                   [&image_path](ITable &table) {
+                     auto filename = file_name(image_path, table.tableID(),
+                                               table.partitionID());
+                     CHECK(load(table, filename))
+                         << "failed to open " << filename
+                         << ", see --dump_image.";
+                   });
+  }
+
+private:
+  static constexpr std::size_t HEADER_SIZE = 3 * sizeof(uint64_t);
+};
+} // namespace coco
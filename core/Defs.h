@@ -4,8 +4,15 @@
 
 #pragma once
 
+#include <cstddef>
+
 namespace coco {
 
+// the keys a read or write set of a transaction holds inline, enough for a
+// YCSB transaction and a typical NewOrder, see SmallVector
+constexpr std::size_t N_INLINE_READ_KEYS = 32;
+constexpr std::size_t N_INLINE_WRITE_KEYS = 16;
+
 enum class ExecutorStatus {
   START,
   CLEANUP,
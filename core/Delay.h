@@ -4,7 +4,19 @@
 
 #pragma once
 
+#include "common/Time.h"
+#include "core/Context.h"
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <cmath>
+#include <deque>
 #include <glog/logging.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
 namespace coco {
 
@@ -21,7 +33,8 @@ public:
 
   virtual ~Delay() = default;
 
-  virtual int64_t message_delay() const = 0;
+  // the delay of a message sent now to dest_node_id
+  virtual int64_t message_delay(std::size_t dest_node_id) = 0;
 
   virtual bool delay_enabled() const = 0;
 
@@ -41,7 +54,7 @@ public:
 
   virtual ~SameDelay() = default;
 
-  int64_t message_delay() const override { return delay_time; }
+  int64_t message_delay(std::size_t) override { return delay_time; }
 
   bool delay_enabled() const override { return delay_time != 0; }
 
@@ -49,4 +62,164 @@ protected:
   int64_t delay_time;
 };
 
-} // namespace coco
\ No newline at end of file
+/*
+ * LinkDelay has a delay per link, row coordinator_id of --link_delays, e.g.,
+ * "0,100,200;100,0,50;200,50,0" for 3 nodes, or --delay on every link, plus
+ * a random jitter per message, --jitter=normal:20 (a standard deviation of
+ * 20 us) or --jitter=pareto:20 (a long tail, 20 us on average). A delay is
+ * never negative.
+ */
+
+class LinkDelay : public Delay {
+
+public:
+  LinkDelay(std::size_t coordinator_id, std::size_t coordinator_num,
+            int64_t delay_time, const std::string &link_delays,
+            const std::string &jitter, uint64_t seed)
+      : Delay(coordinator_id, coordinator_num),
+        delays(coordinator_num, delay_time), random(seed) {
+
+    if (!link_delays.empty()) {
+      std::vector<std::string> rows, row;
+      boost::algorithm::split(rows, link_delays, boost::is_any_of(";"));
+      CHECK(rows.size() == coordinator_num)
+          << "--link_delays has " << rows.size() << " rows, not "
+          << coordinator_num << ".";
+      boost::algorithm::split(row, rows[coordinator_id],
+                              boost::is_any_of(","));
+      CHECK(row.size() == coordinator_num)
+          << "row " << coordinator_id << " of --link_delays has " << row.size()
+          << " delays, not " << coordinator_num << ".";
+      for (auto i = 0u; i < coordinator_num; i++) {
+        delays[i] = std::stoll(row[i]);
+        CHECK(delays[i] >= 0) << "link delays are not negative.";
+      }
+    }
+
+    if (!jitter.empty()) {
+      auto colon = jitter.find(':');
+      CHECK(colon != std::string::npos)
+          << "--jitter is normal:<us> or pareto:<us>, not " << jitter << ".";
+      distribution = jitter.substr(0, colon);
+      jitter_time = std::stod(jitter.substr(colon + 1));
+      CHECK(distribution == "normal" || distribution == "pareto")
+          << "unknown jitter distribution " << distribution << ".";
+    }
+  }
+
+  int64_t message_delay(std::size_t dest_node_id) override {
+    DCHECK(dest_node_id < coordinator_num);
+    double delay = delays[dest_node_id];
+    if (distribution == "normal") {
+      delay += std::normal_distribution<double>(0, jitter_time)(random);
+    } else if (distribution == "pareto") {
+      // shape 2, so that the mean of the tail is jitter_time
+      double u = 1 - std::uniform_real_distribution<double>(0, 1)(random);
+      delay += jitter_time * (1 / std::sqrt(u) - 1);
+    }
+    return std::max<int64_t>(0, std::llround(delay));
+  }
+
+  bool delay_enabled() const override {
+    return jitter_time > 0 ||
+           std::any_of(delays.begin(), delays.end(),
+                       [](int64_t delay) { return delay > 0; });
+  }
+
+private:
+  std::vector<int64_t> delays;
+  std::string distribution;
+  double jitter_time = 0;
+  std::mt19937_64 random;
+};
+
+class DelayFactory {
+public:
+  static std::unique_ptr<Delay> create_delay(std::size_t coordinator_id,
+                                             const Context &context,
+                                             uint64_t seed) {
+    if (context.link_delays.empty() && context.jitter.empty()) {
+      return std::make_unique<SameDelay>(coordinator_id,
+                                         context.coordinator_num,
+                                         context.delay_time);
+    } else {
+      return std::make_unique<LinkDelay>(
+          coordinator_id, context.coordinator_num, context.delay_time,
+          context.link_delays, context.jitter, seed);
+    }
+  }
+};
+
+/*
+ * A DelayLine holds the messages of an outgoing dispatcher until they
+ * arrive, i.e., their delay since they were flushed has passed and, with a
+ * bandwidth in MB/s, the link had the time to send the bytes before them.
+ * The workers hand their messages over at once, so that a message held back
+ * does not hold back the messages behind it in their queue. The messages to
+ * a node are released in the order they were sent, as TCP delivers them.
+ */
+
+template <class T> class DelayLine {
+public:
+  using clock = Clock;
+
+  DelayLine(std::unique_ptr<Delay> delay, std::size_t coordinator_num,
+            double bandwidth)
+      : delay(std::move(delay)), bandwidth(bandwidth), links(coordinator_num) {}
+
+  bool enabled() const { return delay->delay_enabled() || bandwidth > 0; }
+
+  bool empty() const { return n_held == 0; }
+
+  void push(std::size_t dest_node_id, T item, std::size_t bytes,
+            clock::time_point sent) {
+    auto &link = links[dest_node_id];
+    auto arrival = sent;
+    if (bandwidth > 0) {
+      // 1 MB/s is a byte per us
+      auto bytes_time = std::llround(bytes * 1e3 / bandwidth);
+      link.free =
+          std::max(link.free, sent) + std::chrono::nanoseconds(bytes_time);
+      arrival = link.free;
+    }
+    arrival += std::chrono::microseconds(delay->message_delay(dest_node_id));
+    arrival = std::max(arrival, link.last);
+    link.last = arrival;
+    link.items.emplace_back(arrival, std::move(item));
+    n_held++;
+  }
+
+  // calls func(dest_node_id, item) for each item that arrived, returns the
+  // number of items released
+  template <class Func> std::size_t release(Func &&func) {
+    if (n_held == 0) {
+      return 0;
+    }
+    auto now = clock::now();
+    std::size_t n = 0;
+    for (auto i = 0u; i < links.size(); i++) {
+      auto &items = links[i].items;
+      while (!items.empty() && items.front().first <= now) {
+        func(i, std::move(items.front().second));
+        items.pop_front();
+        n++;
+      }
+    }
+    n_held -= n;
+    return n;
+  }
+
+private:
+  struct Link {
+    std::deque<std::pair<clock::time_point, T>> items;
+    // the last arrival, and when the link is done with the bytes sent
+    clock::time_point last, free;
+  };
+
+  std::unique_ptr<Delay> delay;
+  double bandwidth;
+  std::vector<Link> links;
+  std::size_t n_held = 0;
+};
+
+} // namespace coco
@@ -0,0 +1,143 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/BufferedReader.h"
+#include "common/Message.h"
+#include "common/Socket.h"
+#include "core/Context.h"
+
+#include <deque>
+#include <errno.h>
+#include <glog/logging.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --direct_connections, an executor has its own connections to the
+ * executor of the same id on each peer, and sends and receives its messages
+ * itself instead of through the dispatchers. in[i] receives from coordinator
+ * i and out[i] sends to it. The coordinator and the manager still go through
+ * the dispatchers.
+ *
+ * The sockets are written without blocking. If a peer does not read, most
+ * likely because it is sending to this executor as well, the messages from
+ * the peers are received into a backlog in the meantime, so that two
+ * executors sending to each other do not wait on each other.
+ */
+
+class DirectConnections {
+public:
+  DirectConnections(std::size_t coordinator_id, std::vector<Socket> &in,
+                    std::vector<Socket> &out, const Context &context)
+      : coordinator_id(coordinator_id), out(out),
+        compress_messages(context.compress_messages),
+        compress_threshold(context.compress_threshold),
+        pack_messages(context.pack_messages) {
+    for (auto i = 0u; i < in.size(); i++) {
+      readers.emplace_back(in[i], context.zero_copy_receive);
+    }
+  }
+
+  // allocFunc returns a cleared Message, message is left to the caller
+  template <class AllocFunc> void send(Message *message, AllocFunc allocFunc) {
+    auto dest_node_id = message->get_dest_node_id();
+    DCHECK(dest_node_id < out.size() && dest_node_id != coordinator_id);
+
+    const char *ptr;
+    std::size_t size;
+    if (compress_messages &&
+        message->get_message_length() >= compress_threshold &&
+        message->compress_to(compressed)) {
+      ptr = compressed.data();
+      size = compressed.size();
+    } else if (pack_messages && message->pack_to(compressed)) {
+      ptr = compressed.data();
+      size = compressed.size();
+    } else {
+      auto offset = message->frame();
+      ptr = message->get_raw_ptr() + offset;
+      size = message->data.size() - offset;
+    }
+    network_size += size;
+
+    while (size > 0) {
+      auto n = out[dest_node_id].write_async(ptr, size);
+      if (n > 0) {
+        ptr += n;
+        size -= n;
+        continue;
+      }
+      CHECK(n == -1 && (errno == EWOULDBLOCK || errno == EAGAIN))
+          << "send failed, errno: " << errno;
+      receive_backlog(allocFunc);
+    }
+  }
+
+  // pushFunc is called with each message received, returns the number of
+  // messages
+  template <class AllocFunc, class PushFunc>
+  std::size_t receive(AllocFunc allocFunc, PushFunc pushFunc) {
+    std::size_t n = 0;
+    for (; !backlog.empty() && n < RECEIVE_BATCH_SIZE; n++) {
+      pushFunc(backlog.front());
+      backlog.pop_front();
+    }
+
+    for (auto i = 0u; i < readers.size() && n < RECEIVE_BATCH_SIZE; i++) {
+      if (i == coordinator_id) {
+        continue;
+      }
+      while (n < RECEIVE_BATCH_SIZE) {
+        auto message = readers[i].next_message(allocFunc);
+        if (message == nullptr) {
+          break;
+        }
+        pushFunc(message.release());
+        n++;
+      }
+    }
+    return n;
+  }
+
+  std::size_t get_network_size() const { return network_size; }
+
+private:
+  template <class AllocFunc> void receive_backlog(AllocFunc allocFunc) {
+    for (auto i = 0u; i < readers.size(); i++) {
+      if (i == coordinator_id) {
+        continue;
+      }
+      for (;;) {
+        auto message = readers[i].next_message(allocFunc);
+        if (message == nullptr) {
+          break;
+        }
+        backlog.push_back(message.release());
+      }
+    }
+  }
+
+public:
+  // at most this many messages are received at a time, so that they fit in
+  // the incoming queue of the executor
+  static constexpr std::size_t RECEIVE_BATCH_SIZE = 256;
+
+private:
+  std::size_t coordinator_id;
+  std::vector<Socket> &out;
+  std::vector<BufferedReader> readers;
+  bool compress_messages;
+  std::size_t compress_threshold;
+  bool pack_messages;
+  std::string compressed;
+  // messages received while a send waits, see receive_backlog
+  std::deque<Message *> backlog;
+  std::size_t network_size = 0;
+};
+} // namespace coco
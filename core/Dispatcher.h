@@ -7,12 +7,20 @@
 #include "common/BufferedReader.h"
 #include "common/LockfreeQueue.h"
 #include "common/Message.h"
+#include "common/Probes.h"
 #include "common/Socket.h"
+#include "core/Context.h"
 #include "core/ControlMessage.h"
+#include "core/Delay.h"
+#include "core/NetworkEngine.h"
 #include "core/Worker.h"
 #include <atomic>
+#include <climits>
+#include <string>
 #include <glog/logging.h>
+#include <sys/uio.h>
 #include <thread>
+#include <tuple>
 #include <vector>
 
 namespace coco {
@@ -23,13 +31,14 @@ public:
                      std::size_t io_thread_num, std::vector<Socket> &sockets,
                      const std::vector<std::shared_ptr<Worker>> &workers,
                      LockfreeQueue<Message *> &coordinator_queue,
-                     std::atomic<bool> &stopFlag)
+                     std::atomic<bool> &stopFlag, const Context &context)
       : id(id), group_id(group_id), io_thread_num(io_thread_num),
         network_size(0), workers(workers), coordinator_queue(coordinator_queue),
-        stopFlag(stopFlag) {
+        stopFlag(stopFlag), engine(NetworkEngineFactory::create_network_engine(
+                                context.network_engine)) {
 
     for (auto i = 0u; i < sockets.size(); i++) {
-      buffered_readers.emplace_back(sockets[i]);
+      buffered_readers.emplace_back(sockets[i], context.zero_copy_receive);
     }
   }
 
@@ -46,56 +55,96 @@ public:
               << numCoordinators << ", numWorkers = " << numWorkers
               << ", group id = " << group_id;
 
-    while (!stopFlag.load()) {
+    for (auto i = 0u; i < numCoordinators; i++) {
+      if (i == id) {
+        continue;
+      }
+      engine->add(i, buffered_readers[i].get_socket());
+    }
 
-      for (auto i = 0u; i < numCoordinators; i++) {
-        if (i == id) {
-          continue;
-        }
+    std::vector<std::size_t> ready;
+    std::size_t idle_rounds = 0;
 
-        auto message = buffered_readers[i].next_message();
+    while (!stopFlag.load()) {
 
-        if (message == nullptr) {
-          std::this_thread::yield();
-          continue;
-        }
+      engine->wait_readable(ready);
 
-        network_size += message->get_message_length();
+      std::size_t n_messages = 0;
 
-        // check coordinator message
-        if (is_coordinator_message(message.get())) {
-          coordinator_queue.push(message.release());
-          CHECK(group_id == 0);
-          continue;
+      for (auto i : ready) {
+        // drain the peer, messages may be left in the buffer
+        while (dispatchMessage(buffered_readers[i])) {
+          n_messages++;
         }
+      }
 
-        auto workerId = message->get_worker_id();
-        CHECK(workerId % io_thread_num == group_id);
-        // release the unique ptr
-        workers[workerId]->push_message(message.release());
-        DCHECK(message == nullptr);
+      if (n_messages == 0) {
+        engine->idle(++idle_rounds);
+      } else {
+        idle_rounds = 0;
       }
     }
 
-    LOG(INFO) << "Incoming Dispatcher exits, network size: " << network_size;
+    LOG(INFO) << "Incoming Dispatcher exits, network size: "
+              << get_network_size();
+  }
+
+  bool dispatchMessage(BufferedReader &reader) {
+
+    auto message = reader.next_message([this](uint64_t workerId) {
+      DCHECK(workerId < workers.size());
+      return workers[workerId]->incoming_message_pool.get();
+    });
+
+    if (message == nullptr) {
+      return false;
+    }
+
+    network_size.fetch_add(message->get_message_length(),
+                           std::memory_order_relaxed);
+
+    // check coordinator message
+    if (is_coordinator_message(message.get())) {
+      coordinator_queue.push(message.release());
+      CHECK(group_id == 0);
+      return true;
+    }
+
+    auto workerId = message->get_worker_id();
+    CHECK(workerId % io_thread_num == group_id);
+    COCO_PROBE4(message_receive, message->get_source_node_id(), workerId,
+                message->get_message_length(), message->get_message_count());
+    // the queueing delay starts, see MessageStatistics
+    message->time = Clock::now();
+    // release the unique ptr
+    workers[workerId]->push_message(message.release());
+    DCHECK(message == nullptr);
+    return true;
   }
 
   bool is_coordinator_message(Message *message) {
-    return (*(message->begin())).get_message_type() ==
-           static_cast<uint32_t>(ControlMessage::STATISTICS);
+    auto type = (*(message->begin())).get_message_type();
+    return type == static_cast<uint32_t>(ControlMessage::STATISTICS) ||
+           type == static_cast<uint32_t>(ControlMessage::LIVE_STATISTICS);
   }
 
   std::unique_ptr<Message> fetchMessage(Socket &socket) { return nullptr; }
 
+  // the bytes received so far, read by the metrics server
+  std::size_t get_network_size() const {
+    return network_size.load(std::memory_order_relaxed);
+  }
+
 private:
   std::size_t id;
   std::size_t group_id;
   std::size_t io_thread_num;
-  std::size_t network_size;
+  std::atomic<std::size_t> network_size;
   std::vector<BufferedReader> buffered_readers;
   std::vector<std::shared_ptr<Worker>> workers;
   LockfreeQueue<Message *> &coordinator_queue;
   std::atomic<bool> &stopFlag;
+  std::unique_ptr<NetworkEngine> engine;
 };
 
 class OutgoingDispatcher {
@@ -104,10 +153,25 @@ public:
                      std::size_t io_thread_num, std::vector<Socket> &sockets,
                      const std::vector<std::shared_ptr<Worker>> &workers,
                      LockfreeQueue<Message *> &coordinator_queue,
-                     std::atomic<bool> &stopFlag)
+                     std::atomic<bool> &stopFlag, const Context &context)
       : id(id), group_id(group_id), io_thread_num(io_thread_num),
         network_size(0), sockets(sockets), workers(workers),
-        coordinator_queue(coordinator_queue), stopFlag(stopFlag) {}
+        coordinator_queue(coordinator_queue), stopFlag(stopFlag),
+        engine(NetworkEngineFactory::create_network_engine(
+            context.network_engine)),
+        io_batch_messages(context.io_batch_messages),
+        io_batch_bytes(context.io_batch_bytes),
+        compress_messages(context.compress_messages),
+        compress_threshold(context.compress_threshold),
+        pack_messages(context.pack_messages), pending(sockets.size()),
+        pending_bytes(sockets.size(), 0),
+        // the io threads share the bandwidth of a link
+        delay_line(DelayFactory::create_delay(id, context, group_id),
+                   sockets.size(),
+                   double(context.link_bandwidth) / io_thread_num) {
+    CHECK(io_batch_messages >= 1 && io_batch_messages <= IOV_MAX)
+        << "io_batch_messages must be in [1, " << IOV_MAX << "]";
+  }
 
   void start() {
 
@@ -122,60 +186,181 @@ public:
               << numCoordinators << ", numWorkers = " << numWorkers
               << ", group id = " << group_id;
 
+    std::size_t idle_rounds = 0;
+
     while (!stopFlag.load()) {
 
-      // check coordinator
+      std::size_t n_messages = sendSyncLane();
 
-      if (group_id == 0 && !coordinator_queue.empty()) {
-        std::unique_ptr<Message> message(coordinator_queue.front());
-        bool ok = coordinator_queue.pop();
-        CHECK(ok);
-        sendMessage(message.get());
+      // the async lane goes a worker at a time, the sync messages queued in
+      // the meantime are sent before the next worker's
+      for (auto i = group_id; i < numWorkers; i += io_thread_num) {
+        auto n = collectMessages(workers[i], true);
+        if (n > 0) {
+          sendAllMessages();
+          n_messages += n + sendSyncLane();
+        }
       }
 
-      for (auto i = group_id; i < numWorkers; i += io_thread_num) {
-        dispatchMessage(workers[i]);
+      // held messages are released as soon as they arrive
+      if (n_messages == 0 && delay_line.empty()) {
+        engine->idle(++idle_rounds);
+      } else {
+        idle_rounds = 0;
+        std::this_thread::yield();
       }
-      std::this_thread::yield();
     }
 
-    LOG(INFO) << "Outgoing Dispatcher exits, network size: " << network_size;
+    LOG(INFO) << "Outgoing Dispatcher exits, network size: "
+              << get_network_size();
+  }
+
+  // the bytes sent so far, read by the metrics server
+  std::size_t get_network_size() const {
+    return network_size.load(std::memory_order_relaxed);
   }
 
-  void sendMessage(Message *message) {
+  // sends the messages of the coordinator and the sync lane of each worker
+  std::size_t sendSyncLane() {
+    std::size_t n_messages = 0;
+
+    // check coordinator
+
+    if (group_id == 0 && !coordinator_queue.empty()) {
+      Message *message = coordinator_queue.front();
+      bool ok = coordinator_queue.pop();
+      CHECK(ok);
+      addPendingMessage(message, nullptr);
+      n_messages++;
+    }
+
+    for (auto i = group_id; i < workers.size(); i += io_thread_num) {
+      n_messages += collectMessages(workers[i], false);
+    }
+
+    n_messages += delay_line.release(
+        [this](std::size_t, std::tuple<Message *, Worker *> p) {
+          addPendingMessage(std::get<0>(p), std::get<1>(p));
+        });
+
+    sendAllMessages();
+    return n_messages;
+  }
+
+  std::size_t collectMessages(const std::shared_ptr<Worker> &worker,
+                              bool async) {
+    std::size_t n_messages = 0;
+    while (n_messages < io_batch_messages) {
+      Message *message =
+          async ? worker->pop_async_message() : worker->pop_message();
+      if (message == nullptr) {
+        break;
+      }
+      // with a delay, the message waits in the delay line, see DelayLine
+      if (delay_line.enabled()) {
+        delay_line.push(message->get_dest_node_id(),
+                        std::make_tuple(message, worker.get()),
+                        message->get_message_length(), message->time);
+      } else {
+        addPendingMessage(message, worker.get());
+      }
+      n_messages++;
+    }
+    return n_messages;
+  }
+
+  // messages that are queued for the same node go out in one writev
+  void sendAllMessages() {
+    for (auto i = 0u; i < sockets.size(); i++) {
+      sendMessages(i);
+    }
+  }
+
+  // worker is nullptr if the message comes from the coordinator
+  void addPendingMessage(Message *message, Worker *worker) {
     auto dest_node_id = message->get_dest_node_id();
     DCHECK(dest_node_id >= 0 && dest_node_id < sockets.size() &&
            dest_node_id != id);
     DCHECK(message->get_message_length() == message->data.length())
         << message->get_message_length() << " " << message->data.length();
 
-    sockets[dest_node_id].write_n_bytes(message->get_raw_ptr(),
-                                        message->get_message_length());
+    COCO_PROBE4(message_send, dest_node_id, message->get_worker_id(),
+                message->get_message_length(), message->get_message_count());
+    pending[dest_node_id].emplace_back(message, worker);
+    pending_bytes[dest_node_id] += message->get_message_length();
 
-    network_size += message->get_message_length();
+    if (pending[dest_node_id].size() >= io_batch_messages ||
+        pending_bytes[dest_node_id] >= io_batch_bytes) {
+      sendMessages(dest_node_id);
+    }
   }
 
-  void dispatchMessage(const std::shared_ptr<Worker> &worker) {
-
-    Message *raw_message = worker->pop_message();
-    if (raw_message == nullptr) {
+  void sendMessages(std::size_t dest_node_id) {
+    auto &messages = pending[dest_node_id];
+    if (messages.empty()) {
       return;
     }
-    // wrap the message with a unique pointer.
-    std::unique_ptr<Message> message(raw_message);
-    // send the message
-    sendMessage(message.get());
+
+    iovecs.clear();
+    if (compressed.size() < messages.size()) {
+      compressed.resize(messages.size());
+    }
+
+    for (auto i = 0u; i < messages.size(); i++) {
+      Message *message = std::get<0>(messages[i]);
+      // large messages are compressed here rather than by the workers
+      if (compress_messages &&
+          message->get_message_length() >= compress_threshold &&
+          message->compress_to(compressed[i])) {
+        iovecs.push_back({&compressed[i][0], compressed[i].size()});
+      } else if (pack_messages && message->pack_to(compressed[i])) {
+        iovecs.push_back({&compressed[i][0], compressed[i].size()});
+      } else {
+        auto offset = message->frame();
+        iovecs.push_back({message->get_raw_ptr() + offset,
+                          message->data.size() - offset});
+      }
+      network_size.fetch_add(iovecs.back().iov_len, std::memory_order_relaxed);
+    }
+
+    sockets[dest_node_id].write_n_bytes_v(iovecs.data(), iovecs.size());
+
+    for (auto &p : messages) {
+      Message *message = std::get<0>(p);
+      Worker *worker = std::get<1>(p);
+      if (worker == nullptr) {
+        delete message;
+      } else {
+        // hand the message back to the worker for reuse
+        worker->outgoing_message_pool.put(message);
+      }
+    }
+
+    messages.clear();
+    pending_bytes[dest_node_id] = 0;
   }
 
 private:
   std::size_t id;
   std::size_t group_id;
   std::size_t io_thread_num;
-  std::size_t network_size;
+  std::atomic<std::size_t> network_size;
   std::vector<Socket> &sockets;
   std::vector<std::shared_ptr<Worker>> workers;
   LockfreeQueue<Message *> &coordinator_queue;
   std::atomic<bool> &stopFlag;
+  std::unique_ptr<NetworkEngine> engine;
+  std::size_t io_batch_messages, io_batch_bytes;
+  bool compress_messages;
+  std::size_t compress_threshold;
+  bool pack_messages;
+  // messages waiting to be sent, grouped by destination node
+  std::vector<std::vector<std::tuple<Message *, Worker *>>> pending;
+  std::vector<std::size_t> pending_bytes;
+  std::vector<iovec> iovecs;
+  // the compressed messages of a writev, reused across writevs
+  std::vector<std::string> compressed;
+  DelayLine<std::tuple<Message *, Worker *>> delay_line;
 };
 
 } // namespace coco
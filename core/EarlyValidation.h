@@ -0,0 +1,114 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Partitioner.h"
+#include "core/Table.h"
+
+#include <cstdint>
+#include <glog/logging.h>
+#include <unordered_map>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --early_validation=n, each worker remembers the last n rows that
+ * aborted its transactions, locked or failed read validation, as hot rows.
+ * Each time a transaction has processed its pending reads, the local reads
+ * of hot rows are validated again, see validate(). A transaction whose read
+ * of a hot row is already stale would fail its read validation at commit,
+ * so it aborts right away, before it executes the rest and before its
+ * remote locks and validations are sent.
+ *
+ * Only the hot rows are checked, so a transaction of a cold workload pays a
+ * hash of each local read per check. A row is known by a hash of its table,
+ * partition and key, a collision only costs a check.
+ */
+
+class EarlyValidation {
+public:
+  explicit EarlyValidation(std::size_t capacity) : ring(capacity, 0) {
+    CHECK(capacity > 0);
+  }
+
+  static uint64_t hash(std::size_t table_id, std::size_t partition_id,
+                       const void *key, std::size_t key_size) {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](uint64_t byte) { h = (h ^ byte) * 1099511628211ull; };
+    mix(table_id);
+    mix(partition_id);
+    auto p = static_cast<const unsigned char *>(key);
+    for (auto i = 0u; i < key_size; i++) {
+      mix(p[i]);
+    }
+    return h;
+  }
+
+  // called once a transaction aborts because of the row of key
+  void conflict(ITable &table, const void *key) {
+    auto h = hash(table.tableID(), table.partitionID(), key, table.key_size());
+    if (n_rows == ring.size()) {
+      auto it = hot.find(ring[next]);
+      if (--it->second == 0) {
+        hot.erase(it);
+      }
+    } else {
+      n_rows++;
+    }
+    ring[next] = h;
+    next = (next + 1) % ring.size();
+    hot[h]++;
+  }
+
+  /*
+   * Returns the index of a local read of a hot row in readSet that is stale,
+   * stale(readKey, latest_tid) decides with the current tid of the row, or
+   * -1 if there is none.
+   */
+  template <class DatabaseType, class KeyContainer, class Stale>
+  int validate(DatabaseType &db, const Partitioner &partitioner,
+               const KeyContainer &readSet, Stale stale) {
+    if (hot.empty()) {
+      return -1;
+    }
+    n_checks++;
+    for (auto i = 0u; i < readSet.size(); i++) {
+      auto &readKey = readSet[i];
+      auto partition_id = readKey.get_partition_id();
+      if (readKey.get_local_index_read_bit() ||
+          !partitioner.has_master_partition(partition_id)) {
+        continue;
+      }
+      auto table = db.find_table(readKey.get_table_id(), partition_id);
+      auto h = hash(readKey.get_table_id(), partition_id, readKey.get_key(),
+                    table->key_size());
+      if (hot.count(h) == 0) {
+        continue;
+      }
+      if (stale(readKey, table->search_metadata(readKey.get_key()).load())) {
+        n_aborts++;
+        return int(i);
+      }
+    }
+    return -1;
+  }
+
+  std::size_t n_hot() const { return hot.size(); }
+
+  uint64_t get_checks() const { return n_checks; }
+
+  uint64_t get_aborts() const { return n_aborts; }
+
+private:
+  // the hashes of the last rows that aborted a transaction
+  std::vector<uint64_t> ring;
+  std::size_t next = 0, n_rows = 0;
+  // the rows in ring and their counts
+  std::unordered_map<uint64_t, std::size_t> hot;
+  uint64_t n_checks = 0, n_aborts = 0;
+};
+} // namespace coco
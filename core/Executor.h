@@ -4,12 +4,24 @@
 
 #pragma once
 
+#include "common/ArrivalProcess.h"
+#include "common/Coroutine.h"
 #include "common/FastSleep.h"
-#include "common/Percentile.h"
+#include "common/Futex.h"
+#include "common/Histogram.h"
+#include "common/Probes.h"
+#include "common/Time.h"
+#include "core/AccessTrace.h"
+#include "core/ConflictRouter.h"
 #include "core/ControlMessage.h"
 #include "core/Defs.h"
-#include "core/Delay.h"
+#include "core/AdaptiveLocking.h"
+#include "core/EarlyValidation.h"
+#include "core/MessageDispatch.h"
+#include "core/NumaPlacement.h"
 #include "core/Partitioner.h"
+#include "core/TransactionPool.h"
+#include "core/TransactionStream.h"
 #include "core/Worker.h"
 #include "glog/logging.h"
 
@@ -32,6 +44,9 @@ public:
 
   using StorageType = typename WorkloadType::StorageType;
 
+  // the maximum number of incoming messages handled before a flush
+  static constexpr std::size_t MESSAGE_BATCH_SIZE = 32;
+
   Executor(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
            const ContextType &context, std::atomic<uint32_t> &worker_status,
            std::atomic<uint32_t> &n_complete_workers,
@@ -42,10 +57,12 @@ public:
         partitioner(PartitionerFactory::create_partitioner(
             context.partitioner, coordinator_id, context.coordinator_num)),
         random(reinterpret_cast<uint64_t>(this)),
+        arrivals(context.arrival_rate, reinterpret_cast<uint64_t>(this) + 1),
         protocol(db, context, *partitioner),
         workload(coordinator_id, db, random, *partitioner),
-        delay(std::make_unique<SameDelay>(
-            coordinator_id, context.coordinator_num, context.delay_time)) {
+        router(id, context.worker_num, context.partition_num,
+               WorkloadType::hot_rows(context), context.conflict_routing,
+               *partitioner) {
 
     for (auto i = 0u; i < context.coordinator_num; i++) {
       messages.emplace_back(std::make_unique<Message>());
@@ -55,6 +72,37 @@ public:
     messageHandlers = MessageHandlerType::get_message_handlers();
     message_stats.resize(messageHandlers.size(), 0);
     message_sizes.resize(messageHandlers.size(), 0);
+    if (context.message_latency) {
+      message_statistics = std::make_unique<MessageStatistics>(
+          messageHandlers.size(), context.coroutine_num);
+    }
+
+    if (context.numa) {
+      numa_partitions =
+          NumaPlacement(context).local_partitions(id, *partitioner);
+    }
+    if (context.partition_serial) {
+      // the local partitions are dealt to the workers, see PartitionGate
+      for (auto i = 0u, k = 0u; i < context.partition_num; i++) {
+        if (partitioner->has_master_partition(i) &&
+            k++ % context.worker_num == id) {
+          home_partitions.push_back(i);
+        }
+      }
+    }
+    if (!context.trace_path.empty()) {
+      trace = std::make_unique<AccessTrace>(context.trace_path, coordinator_id,
+                                            id, context.trace_rate);
+    }
+    stream = TransactionStream::open(context, coordinator_id, id);
+    workload.set_stream(stream.get());
+    if (context.early_validation > 0) {
+      early_validation =
+          std::make_unique<EarlyValidation>(context.early_validation);
+    }
+    if (context.adaptive_locking) {
+      adaptive_locking = std::make_unique<AdaptiveLocking>();
+    }
   }
 
   ~Executor() = default;
@@ -63,58 +111,142 @@ public:
 
     LOG(INFO) << "Executor " << id << " starts.";
 
-    StorageType storage;
-    uint64_t last_seed = 0;
+    if (context.perf_counters) {
+      PerfCounters::open_thread_counters();
+    }
 
-    ExecutorStatus status;
+    Futex::wait_until(worker_status, [](uint32_t s) {
+      return static_cast<ExecutorStatus>(s) == ExecutorStatus::START;
+    });
+
+    Futex::add_and_wake(n_started_workers, 1);
 
-    while ((status = static_cast<ExecutorStatus>(worker_status.load())) !=
-           ExecutorStatus::START) {
-      std::this_thread::yield();
+    transactions.resize(context.coroutine_num);
+    if (transactions.size() == 1) {
+      run_transactions(0);
+    } else {
+      run_coroutines();
     }
 
-    n_started_workers.fetch_add(1);
+    Futex::add_and_wake(n_complete_workers, 1);
+
+    // once all workers are stop, we need to process the replication
+    // requests
+
+    Futex::wait_until(
+        worker_status,
+        [](uint32_t s) {
+          return static_cast<ExecutorStatus>(s) == ExecutorStatus::CLEANUP;
+        },
+        [this]() { return process_request(); });
+
+    process_request();
+    Futex::add_and_wake(n_complete_workers, 1);
+
+    LOG(INFO) << "Executor " << id << " exits.";
+  }
+
+  /*
+   * With --coroutines, each of the coroutine_num transactions of a worker runs
+   * in its own coroutine. A transaction yields while it waits for remote
+   * responses, see process_request_and_yield(), and once per transaction, so
+   * that the others make progress during a round trip. Each coroutine keeps
+   * its own random seed, which is swapped in when it is resumed.
+   */
+  void run_coroutines() {
+    std::vector<std::unique_ptr<Coroutine>> coroutines;
+    std::vector<uint64_t> seeds;
+    for (auto i = 0u; i < transactions.size(); i++) {
+      coroutines.emplace_back(
+          std::make_unique<Coroutine>([this, i]() { run_transactions(i); }));
+      seeds.push_back(reinterpret_cast<uint64_t>(coroutines[i].get()));
+    }
+
+    for (std::size_t n_done = 0; n_done < coroutines.size();) {
+      n_done = 0;
+      for (auto i = 0u; i < coroutines.size(); i++) {
+        if (coroutines[i]->done()) {
+          n_done++;
+          continue;
+        }
+        MessagePiece::current_coroutine_id() = i;
+        random.set_seed(seeds[i]);
+        coroutines[i]->resume();
+        seeds[i] = random.get_seed();
+      }
+    }
+    MessagePiece::current_coroutine_id() = 0;
+  }
+
+  // runs transactions[i] until the worker stops
+  void run_transactions(std::size_t i) {
+
+    std::unique_ptr<TransactionType> &transaction = transactions[i];
+    StorageType storage;
+    TransactionPool<TransactionType> pool;
+    uint64_t last_seed = 0;
+
+    ExecutorStatus status;
     bool retry_transaction = false;
 
     do {
+      Coroutine::yield();
       process_request();
 
-      if (!partitioner->is_backup()) {
-        // backup node stands by for replication
+      // backup node stands by for replication, in open loop the worker also
+      // waits for the next transaction to arrive
+      if (!partitioner->is_backup() &&
+          (retry_transaction || arrivals.arrived())) {
         last_seed = random.get_seed();
 
         if (retry_transaction) {
           transaction->reset();
         } else {
 
-          auto partition_id = get_partition_id();
+          // with --conflict_routing, on a hot row of this worker
+          std::size_t partition_id, hot_row = 0;
+          if (!router.route(random, partition_id, hot_row)) {
+            partition_id = get_partition_id();
+          }
 
-          transaction =
-              workload.next_transaction(context, partition_id, storage);
+          pool.put(std::move(transaction));
+          transaction = workload.next_transaction(context, partition_id,
+                                                  storage, &pool, hot_row);
+          transaction->startTime = arrivals.pop();
           setupHandlers(*transaction);
         }
 
+        COCO_PROBE2(txn_begin, id, transaction->procedure_id);
+        transaction->phase_timer.start();
         auto result = transaction->execute(id);
+        transaction->phase_timer.end(TransactionPhase::EXECUTE);
         if (result == TransactionResult::READY_TO_COMMIT) {
           bool commit = protocol.commit(*transaction, messages);
+          record_phases(transaction->phase_timer);
           if (transaction->distributed_transaction) {
             simulate_2pc_durable_cost();
           }
-          n_network_size.fetch_add(transaction->network_size);
+          stats.add(WorkerStats::NETWORK_SIZE, transaction->network_size);
+          if (adaptive_locking != nullptr) {
+            adaptive_locking->on_transaction(commit);
+          }
           if (commit) {
-            n_commit.fetch_add(1);
+            stats.add(WorkerStats::COMMIT);
+            trace_access(*transaction, AccessOutcome::COMMIT);
             if (transaction->si_in_serializable) {
-              n_si_in_serializable.fetch_add(1);
+              stats.add(WorkerStats::SI_IN_SERIALIZABLE);
             }
             if (transaction->local_validated) {
-              n_local.fetch_add(1);
+              stats.add(WorkerStats::LOCAL);
             }
             retry_transaction = false;
             auto latency =
                 std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::steady_clock::now() - transaction->startTime)
+                    Clock::now() - transaction->startTime)
                     .count();
             percentile.add(latency);
+            record_latency(latency, transaction->procedure_id);
+            COCO_PROBE3(txn_commit, id, transaction->procedure_id, latency);
             if (transaction->distributed_transaction) {
               dist_latency.add(latency);
             } else {
@@ -122,11 +254,22 @@ public:
             }
           } else {
             if (transaction->abort_lock) {
-              n_abort_lock.fetch_add(1);
+              stats.add(WorkerStats::ABORT_LOCK);
+              record_abort(transaction->procedure_id,
+                           &ProcedureStatistics::n_abort_lock);
+              trace_access(*transaction, AccessOutcome::ABORT_LOCK);
+              COCO_PROBE3(txn_abort, id, transaction->procedure_id,
+                          static_cast<int>(ProbeAbort::LOCK));
             } else {
               DCHECK(transaction->abort_read_validation);
-              n_abort_read_validation.fetch_add(1);
+              stats.add(WorkerStats::ABORT_READ_VALIDATION);
+              record_abort(transaction->procedure_id,
+                           &ProcedureStatistics::n_abort_read_validation);
+              trace_access(*transaction, AccessOutcome::ABORT_READ_VALIDATION);
+              COCO_PROBE3(txn_abort, id, transaction->procedure_id,
+                          static_cast<int>(ProbeAbort::READ_VALIDATION));
             }
+            record_conflict(*transaction, transaction->abort_lock);
             if (context.sleep_on_retry) {
               std::this_thread::sleep_for(std::chrono::microseconds(
                   random.uniform_dist(0, context.sleep_time)));
@@ -134,29 +277,41 @@ public:
             random.set_seed(last_seed);
             retry_transaction = true;
           }
+        } else if (transaction->abort_read_validation) {
+          // a stale read of a hot row, retried as if at commit, see
+          // EarlyValidation
+          protocol.abort(*transaction, messages);
+          record_phases(transaction->phase_timer);
+          if (adaptive_locking != nullptr) {
+            adaptive_locking->on_transaction(false);
+          }
+          stats.add(WorkerStats::ABORT_READ_VALIDATION);
+          record_abort(transaction->procedure_id,
+                       &ProcedureStatistics::n_abort_read_validation);
+          trace_access(*transaction, AccessOutcome::ABORT_READ_VALIDATION);
+          COCO_PROBE3(txn_abort, id, transaction->procedure_id,
+                      static_cast<int>(ProbeAbort::READ_VALIDATION));
+          record_conflict(*transaction, false);
+          if (context.sleep_on_retry) {
+            std::this_thread::sleep_for(std::chrono::microseconds(
+                random.uniform_dist(0, context.sleep_time)));
+          }
+          random.set_seed(last_seed);
+          retry_transaction = true;
         } else {
           protocol.abort(*transaction, messages);
-          n_abort_no_retry.fetch_add(1);
+          record_phases(transaction->phase_timer);
+          stats.add(WorkerStats::ABORT_NO_RETRY);
+          record_abort(transaction->procedure_id,
+                       &ProcedureStatistics::n_abort_no_retry);
+          trace_access(*transaction, AccessOutcome::ABORT_NO_RETRY);
+          COCO_PROBE3(txn_abort, id, transaction->procedure_id,
+                      static_cast<int>(ProbeAbort::NO_RETRY));
         }
       }
 
       status = static_cast<ExecutorStatus>(worker_status.load());
     } while (status != ExecutorStatus::STOP);
-
-    n_complete_workers.fetch_add(1);
-
-    // once all workers are stop, we need to process the replication
-    // requests
-
-    while (static_cast<ExecutorStatus>(worker_status.load()) !=
-           ExecutorStatus::CLEANUP) {
-      process_request();
-    }
-
-    process_request();
-    n_complete_workers.fetch_add(1);
-
-    LOG(INFO) << "Executor " << id << " exits.";
   }
 
   void onExit() override {
@@ -180,12 +335,51 @@ public:
       }
       percentile.save_cdf(context.cdf_path);
     }
+
+    if (early_validation != nullptr) {
+      LOG(INFO) << "Worker " << id << " early validation: "
+                << early_validation->get_aborts() << " aborts in "
+                << early_validation->get_checks() << " checks, "
+                << early_validation->n_hot() << " hot rows.";
+    }
+
+    if (adaptive_locking != nullptr) {
+      LOG(INFO) << "Worker " << id << " adaptive locking: "
+                << adaptive_locking->get_locks() << " locks in execution, "
+                << adaptive_locking->n_hot() << " hot rows, threshold "
+                << adaptive_locking->get_threshold() << ".";
+    }
+
+    if (trace != nullptr) {
+      trace->close();
+    }
+    if (stream != nullptr) {
+      stream->close();
+    }
   }
 
   std::size_t get_partition_id() {
 
     std::size_t partition_id;
 
+    // with --partition_serial, only the home partitions of this worker
+    if (!home_partitions.empty()) {
+      return home_partitions[random.uniform_dist(0,
+                                                 home_partitions.size() - 1)];
+    }
+
+    if (!context.hash_placement()) {
+      return get_owned_partition_id();
+    }
+
+    // with --numa, only the partitions on the node of this worker
+    if (!numa_partitions.empty()) {
+      partition_id =
+          numa_partitions[random.uniform_dist(0, numa_partitions.size() - 1)];
+      CHECK(partitioner->has_master_partition(partition_id));
+      return partition_id;
+    }
+
     if (context.partitioner == "pb") {
       partition_id = random.uniform_dist(0, context.partition_num - 1);
     } else {
@@ -199,6 +393,25 @@ public:
     return partition_id;
   }
 
+  // the partitions are placed elsewhere than partition id % coordinator_num
+  // (see DynamicPartitioner and AffinityPartitioner), one of the partitions
+  // on this node, or any partition once the node has none
+  std::size_t get_owned_partition_id() {
+    std::size_t n = 0;
+    for (auto i = 0u; i < context.partition_num; i++) {
+      n += partitioner->has_master_partition(i);
+    }
+    if (n == 0) {
+      return random.uniform_dist(0, context.partition_num - 1);
+    }
+    std::size_t k = random.uniform_dist(0, n - 1);
+    for (auto i = 0u;; i++) {
+      if (partitioner->has_master_partition(i) && k-- == 0) {
+        return i;
+      }
+    }
+  }
+
   void push_message(Message *message) override { in_queue.push(message); }
 
   Message *pop_message() override {
@@ -207,15 +420,6 @@ public:
 
     Message *message = out_queue.front();
 
-    if (delay->delay_enabled()) {
-      auto now = std::chrono::steady_clock::now();
-      if (std::chrono::duration_cast<std::chrono::microseconds>(now -
-                                                                message->time)
-              .count() < delay->message_delay()) {
-        return nullptr;
-      }
-    }
-
     bool ok = out_queue.pop();
     CHECK(ok);
 
@@ -225,43 +429,115 @@ public:
   std::size_t process_request() {
 
     std::size_t size = 0;
+    auto current_coroutine_id = MessagePiece::current_coroutine_id();
+    receive_direct();
+    if (!dispatch.is_bound()) {
+      dispatch.bind(messageHandlers);
+      dispatch.prefetch_keys(MessageHandlerType::get_keyed_messages(),
+                             context.prefetch_distance);
+    }
 
-    while (!in_queue.empty()) {
-      std::unique_ptr<Message> message(in_queue.front());
-      bool ok = in_queue.pop();
-      CHECK(ok);
-
-      for (auto it = message->begin(); it != message->end(); it++) {
-
-        MessagePiece messagePiece = *it;
-        auto type = messagePiece.get_message_type();
-        DCHECK(type < messageHandlers.size());
-        ITable *table = db.find_table(messagePiece.get_table_id(),
-                                      messagePiece.get_partition_id());
+    // messages are handled in batches, and the responses to a batch are
+    // flushed together
+    Message *batch[MESSAGE_BATCH_SIZE];
+    std::size_t n;
+
+    while ((n = in_queue.pop_n(batch, MESSAGE_BATCH_SIZE)) > 0) {
+      for (auto i = 0u; i < n; i++) {
+        std::unique_ptr<Message> message(batch[i]);
+
+        dispatch.begin(db, *message);
+        for (auto it = message->begin(); it != message->end(); it++) {
+
+          dispatch.next(db);
+          MessagePiece messagePiece = *it;
+          auto type = messagePiece.get_message_type();
+          DCHECK(type < messageHandlers.size());
+          ITable *table = dispatch.table(db, messagePiece);
+
+          // a response goes to the transaction of the coroutine it is tagged
+          // with, and the pieces sent in reply carry the same tag
+          auto coroutine_id = messagePiece.get_coroutine_id();
+          DCHECK(coroutine_id < transactions.size());
+          MessagePiece::current_coroutine_id() = coroutine_id;
+          auto txn = transactions[coroutine_id].get();
+          auto handle = [&]() {
+            dispatch(type, messagePiece,
+                     *messages[message->get_source_node_id()], *table, txn);
+          };
+          if (message_statistics == nullptr) {
+            handle();
+          } else {
+            message_statistics->handle(
+                type, coroutine_id, message->time,
+                txn ? &txn->pendingResponses : nullptr, handle);
+          }
+          MessagePiece::current_coroutine_id() = current_coroutine_id;
 
-        messageHandlers[type](messagePiece,
-                              *messages[message->get_source_node_id()], *table,
-                              transaction.get());
+          message_stats[type]++;
+          message_sizes[type] += messagePiece.get_message_length();
+        }
 
-        message_stats[type]++;
-        message_sizes[type] += messagePiece.get_message_length();
+        size += message->get_message_count();
+        incoming_message_pool.put(message.release());
       }
-
-      size += message->get_message_count();
       flush_messages();
     }
     return size;
   }
 
+  // used by a transaction that waits for remote responses, the other
+  // coroutines of the worker run in the meantime
+  std::size_t process_request_and_yield() {
+    auto size = process_request();
+    Coroutine::yield();
+    return size;
+  }
+
   virtual void setupHandlers(TransactionType &txn) = 0;
 
 protected:
+  // with --trace_path, samples the rows txn accessed, see AccessTrace
+  void trace_access(TransactionType &txn, AccessOutcome outcome) {
+    if (trace != nullptr) {
+      trace->trace(db, txn, outcome);
+    }
+  }
+
+  // with --conflict_profile, counts the row that aborted txn, and with
+  // --early_validation or --adaptive_locking, the row is hot from now on
+  void record_conflict(TransactionType &txn, bool lock) {
+    if (txn.conflict_key == nullptr) {
+      return;
+    }
+    auto table =
+        db.find_table(txn.conflict_table_id, txn.conflict_partition_id);
+    if (context.conflict_profile > 0) {
+      conflicts.record(*table, txn.conflict_key, lock);
+    }
+    if (early_validation != nullptr) {
+      early_validation->conflict(*table, txn.conflict_key);
+    }
+    if (adaptive_locking != nullptr) {
+      adaptive_locking->conflict(*table, txn.conflict_key);
+    }
+  }
+
   void simulate_2pc_durable_cost() {
     if (context.durable_write_cost > 0) {
       FastSleep::sleep_for(context.durable_write_cost * 2);
     }
   }
 
+  // flushes the requests of the running transaction, whose responses are
+  // timed with --message_latency
+  void flush_requests() {
+    if (message_statistics != nullptr) {
+      message_statistics->on_flush(MessagePiece::current_coroutine_id());
+    }
+    flush_messages();
+  }
+
   void flush_messages() {
 
     for (auto i = 0u; i < messages.size(); i++) {
@@ -275,8 +551,8 @@ protected:
 
       auto message = messages[i].release();
 
-      out_queue.push(message);
-      messages[i] = std::make_unique<Message>();
+      push_outgoing(out_queue, message);
+      messages[i].reset(outgoing_message_pool.get());
       init_message(messages[i].get(), i);
     }
   }
@@ -293,16 +569,24 @@ protected:
   std::atomic<uint32_t> &worker_status;
   std::atomic<uint32_t> &n_complete_workers, &n_started_workers;
   std::unique_ptr<Partitioner> partitioner;
+  std::vector<std::size_t> numa_partitions, home_partitions;
   RandomType random;
+  ArrivalProcess arrivals;
   ProtocolType protocol;
   WorkloadType workload;
-  std::unique_ptr<Delay> delay;
-  Percentile<int64_t> percentile, dist_latency, local_latency;
-  std::unique_ptr<TransactionType> transaction;
+  ConflictRouter router;
+  Histogram percentile, dist_latency, local_latency;
+  std::unique_ptr<AccessTrace> trace;
+  std::unique_ptr<TransactionStream> stream;
+  std::unique_ptr<EarlyValidation> early_validation;
+  std::unique_ptr<AdaptiveLocking> adaptive_locking;
+  // one transaction per coroutine
+  std::vector<std::unique_ptr<TransactionType>> transactions;
   std::vector<std::unique_ptr<Message>> messages;
   std::vector<
       std::function<void(MessagePiece, Message &, ITable &, TransactionType *)>>
       messageHandlers;
+  MessageDispatch<TransactionType *> dispatch;
   std::vector<std::size_t> message_stats, message_sizes;
   LockfreeQueue<Message *> in_queue, out_queue;
 };
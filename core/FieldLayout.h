@@ -0,0 +1,338 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/FixedString.h"
+#include "common/StringPiece.h"
+#include <cstdint>
+#include <cstring>
+#include <glog/logging.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace coco {
+
+// what a field holds, so that an export can type its columns
+enum class FieldType : uint8_t {
+  BYTES,
+  INT,    // a signed integer of the length of the field
+  UINT,   // an unsigned integer
+  FLOAT,  // a float or a double
+  STRING  // a FixedString, i.e., length - 1 chars and a \0
+};
+
+template <class T> struct FieldTypeOf {
+  static constexpr FieldType value =
+      std::is_floating_point<T>::value
+          ? FieldType::FLOAT
+          : std::is_integral<T>::value
+                ? (std::is_signed<T>::value ? FieldType::INT : FieldType::UINT)
+                : FieldType::BYTES;
+};
+
+template <std::size_t N> struct FieldTypeOf<FixedString<N>> {
+  static constexpr FieldType value = FieldType::STRING;
+};
+
+/*
+ * FieldLayout<T> lists the fields of a key or a value type as they are laid
+ * out in memory, with their names and types. A type defined with DO_STRUCT
+ * has one field per member, any other type is a single unnamed field.
+ *
+ * A delta of a row is a bit mask of the changed fields followed by the raw
+ * bytes of these fields, so that a replica can patch its copy of the row
+ * instead of receiving the whole value, see --delta_replication.
+ *
+ * A projection is a bit mask of the fields a transaction reads, e.g., the
+ * discount of a customer in NewOrder, see search_for_read. Only these fields
+ * are copied from the row or sent back by a remote read, the other fields of
+ * the value read are left as they are. A value with a single field is read
+ * as a whole.
+ */
+
+template <class T, class = void> class FieldLayout {
+public:
+  static constexpr std::size_t size() { return 1; }
+
+  static std::size_t offset(std::size_t i) { return 0; }
+
+  static std::size_t length(std::size_t i) { return sizeof(T); }
+
+  static const char *name(std::size_t i) { return nullptr; }
+
+  static FieldType type(std::size_t i) { return FieldTypeOf<T>::value; }
+};
+
+template <class T>
+class FieldLayout<T, decltype(T::field_offsets(), void())> {
+public:
+  static constexpr std::size_t size() { return T::NFIELDS; }
+
+  static std::size_t offset(std::size_t i) { return T::field_offsets()[i]; }
+
+  static std::size_t length(std::size_t i) { return T::field_sizes()[i]; }
+
+  static const char *name(std::size_t i) { return T::field_names()[i]; }
+
+  static FieldType type(std::size_t i) { return T::field_types()[i]; }
+};
+
+// a field of the key or of the value of a row, see ITable::columns
+struct Column {
+  std::string name;
+  FieldType type;
+  bool key;
+  std::size_t offset, length;
+};
+
+// appends the fields of T, an unnamed field is named key or value
+template <class T> void append_columns(std::vector<Column> &columns, bool key) {
+  using LayoutType = FieldLayout<T>;
+  for (auto i = 0u; i < LayoutType::size(); i++) {
+    auto name = LayoutType::name(i);
+    columns.push_back(Column{name ? name : (key ? "key" : "value"),
+                             LayoutType::type(i), key, LayoutType::offset(i),
+                             LayoutType::length(i)});
+  }
+}
+
+// the fields of the key, then the fields of the value
+template <class KeyType, class ValueType> std::vector<Column> row_columns() {
+  std::vector<Column> columns;
+  append_columns<KeyType>(columns, true);
+  append_columns<ValueType>(columns, false);
+  return columns;
+}
+
+template <class T> class FieldDelta {
+public:
+  using LayoutType = FieldLayout<T>;
+
+  static_assert(LayoutType::size() <= 64, "a delta mask has 64 bits.");
+
+  // a bit per field of value that differs from row
+  static uint64_t changed_fields(const T &row, const T &value) {
+    uint64_t mask = 0;
+    for (auto i = 0u; i < LayoutType::size(); i++) {
+      if (std::memcmp(field(row, i), field(value, i), LayoutType::length(i))) {
+        mask |= 1ull << i;
+      }
+    }
+    return mask;
+  }
+
+  // the number of bytes the fields in mask take
+  static std::size_t size(uint64_t mask) {
+    std::size_t n = 0;
+    for (auto i = 0u; i < LayoutType::size(); i++) {
+      if (mask >> i & 1) {
+        n += LayoutType::length(i);
+      }
+    }
+    return n;
+  }
+
+  static void serialize(Encoder &enc, const T &value, uint64_t mask) {
+    for (auto i = 0u; i < LayoutType::size(); i++) {
+      if (mask >> i & 1) {
+        enc.write_n_bytes(field(value, i), LayoutType::length(i));
+      }
+    }
+  }
+
+  static void deserialize(StringPiece stringPiece, T &row, uint64_t mask) {
+    DCHECK(stringPiece.size() == size(mask));
+    const char *data = stringPiece.data();
+    for (auto i = 0u; i < LayoutType::size(); i++) {
+      if (mask >> i & 1) {
+        std::memcpy(field(row, i), data, LayoutType::length(i));
+        data += LayoutType::length(i);
+      }
+    }
+  }
+
+private:
+  static const char *field(const T &value, std::size_t i) {
+    return reinterpret_cast<const char *>(&value) + LayoutType::offset(i);
+  }
+
+  static char *field(T &value, std::size_t i) {
+    return reinterpret_cast<char *>(&value) + LayoutType::offset(i);
+  }
+};
+
+/*
+ * A FieldAddition adds a delta to a numeric field of a row, e.g., the year to
+ * date balance of a warehouse. Additions commute, so a transaction adds to a
+ * field without reading or locking the row, and the addition is applied with
+ * a compare and swap on the field alone, see CommutativeUpdate.
+ */
+
+class FieldAddition {
+public:
+  enum class Type : uint8_t { INT32, INT64, FLOAT, DOUBLE };
+
+  FieldAddition() = default;
+
+  explicit FieldAddition(int32_t delta) : type(Type::INT32) { set(delta); }
+
+  explicit FieldAddition(int64_t delta) : type(Type::INT64) { set(delta); }
+
+  explicit FieldAddition(float delta) : type(Type::FLOAT) { set(delta); }
+
+  explicit FieldAddition(double delta) : type(Type::DOUBLE) { set(delta); }
+
+  std::size_t size() const {
+    return type == Type::INT32 || type == Type::FLOAT ? 4 : 8;
+  }
+
+  // adds the delta to the field of size() bytes at field, atomically
+  void apply(void *field) const {
+    switch (type) {
+    case Type::INT32:
+      add<int32_t, uint32_t>(field);
+      break;
+    case Type::INT64:
+      add<int64_t, uint64_t>(field);
+      break;
+    case Type::FLOAT:
+      add<float, uint32_t>(field);
+      break;
+    case Type::DOUBLE:
+      add<double, uint64_t>(field);
+      break;
+    }
+  }
+
+  // adds the delta of other, an addition of the same type, to this one
+  void merge(const FieldAddition &other) {
+    DCHECK(type == other.type);
+    switch (type) {
+    case Type::INT32:
+      sum<int32_t>(other);
+      break;
+    case Type::INT64:
+      sum<int64_t>(other);
+      break;
+    case Type::FLOAT:
+      sum<float>(other);
+      break;
+    case Type::DOUBLE:
+      sum<double>(other);
+      break;
+    }
+  }
+
+  friend Encoder &operator<<(Encoder &enc, const FieldAddition &addition) {
+    return enc << static_cast<uint8_t>(addition.type) << addition.bits;
+  }
+
+  friend Decoder &operator>>(Decoder &dec, FieldAddition &addition) {
+    uint8_t type;
+    dec >> type >> addition.bits;
+    addition.type = static_cast<Type>(type);
+    return dec;
+  }
+
+private:
+  template <class T> void set(T delta) {
+    std::memcpy(&bits, &delta, sizeof(T));
+  }
+
+  template <class T> void sum(const FieldAddition &other) {
+    T delta, other_delta;
+    std::memcpy(&delta, &bits, sizeof(T));
+    std::memcpy(&other_delta, &other.bits, sizeof(T));
+    delta += other_delta;
+    std::memcpy(&bits, &delta, sizeof(T));
+  }
+
+  template <class T, class Word> void add(void *field) const {
+    static_assert(sizeof(T) == sizeof(Word), "a field is one word.");
+    T delta;
+    std::memcpy(&delta, &bits, sizeof(T));
+    auto word = static_cast<Word *>(field);
+    Word expected = __atomic_load_n(word, __ATOMIC_RELAXED), desired;
+    do {
+      T value;
+      std::memcpy(&value, &expected, sizeof(T));
+      value += delta;
+      std::memcpy(&desired, &value, sizeof(T));
+    } while (!__atomic_compare_exchange_n(word, &expected, desired, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  }
+
+  Type type = Type::INT32;
+  uint64_t bits = 0;
+};
+
+template <class T> class FieldProjection {
+public:
+  using LayoutType = FieldLayout<T>;
+
+  static_assert(LayoutType::size() <= 64, "a projection has 64 bits.");
+
+  // the fields in mask are all the fields
+  static bool is_whole(uint64_t mask) {
+    return LayoutType::size() == 1 ||
+           (~mask & (~0ull >> (64 - LayoutType::size()))) == 0;
+  }
+
+  static std::size_t size(uint64_t mask) {
+    return is_whole(mask) ? sizeof(T) : FieldDelta<T>::size(mask);
+  }
+
+  // the fields in mask of value to size(mask) bytes at dest
+  static void pack(char *dest, const T &value, uint64_t mask) {
+    if (is_whole(mask)) {
+      std::memcpy(dest, &value, sizeof(T));
+      return;
+    }
+    for (auto i = 0u; i < LayoutType::size(); i++) {
+      if (mask >> i & 1) {
+        std::memcpy(dest, field(value, i), LayoutType::length(i));
+        dest += LayoutType::length(i);
+      }
+    }
+  }
+
+  // the fields in mask of value from size(mask) bytes at src
+  static void unpack(T &value, const char *src, uint64_t mask) {
+    if (is_whole(mask)) {
+      std::memcpy(&value, src, sizeof(T));
+      return;
+    }
+    for (auto i = 0u; i < LayoutType::size(); i++) {
+      if (mask >> i & 1) {
+        std::memcpy(field(value, i), src, LayoutType::length(i));
+        src += LayoutType::length(i);
+      }
+    }
+  }
+
+  static void copy(T &dest, const T &src, uint64_t mask) {
+    if (is_whole(mask)) {
+      std::memcpy(&dest, &src, sizeof(T));
+      return;
+    }
+    for (auto i = 0u; i < LayoutType::size(); i++) {
+      if (mask >> i & 1) {
+        std::memcpy(field(dest, i), field(src, i), LayoutType::length(i));
+      }
+    }
+  }
+
+private:
+  static const char *field(const T &value, std::size_t i) {
+    return reinterpret_cast<const char *>(&value) + LayoutType::offset(i);
+  }
+
+  static char *field(T &value, std::size_t i) {
+    return reinterpret_cast<char *>(&value) + LayoutType::offset(i);
+  }
+};
+} // namespace coco
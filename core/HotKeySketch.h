@@ -0,0 +1,123 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <glog/logging.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace coco {
+
+/*
+ * A space-saving sketch of the most frequent keys. It keeps a counter for
+ * at most capacity keys, and a new key replaces the smallest counter, whose
+ * count it inherits as the error. The count of a key is at most count and at
+ * least count - error, and a key that is accessed more than total_num() /
+ * capacity times has a counter.
+ */
+
+class HotKeySketch {
+public:
+  struct Counter {
+    std::string key;
+    uint64_t count;
+    uint64_t error;
+    uint64_t writes; // the writes counted since the key has a counter
+  };
+
+  explicit HotKeySketch(std::size_t capacity) : capacity(capacity) {
+    CHECK(capacity > 0);
+  }
+
+  const Counter &add(const std::string &key, bool write) {
+    total++;
+    std::size_t i;
+    auto it = index.find(key);
+    if (it != index.end()) {
+      i = it->second;
+    } else if (counters.size() < capacity) {
+      i = counters.size();
+      counters.push_back(Counter{key, 0, 0, 0});
+      index[key] = i;
+    } else {
+      i = 0;
+      for (auto k = 1u; k < counters.size(); k++) {
+        if (counters[k].count < counters[i].count) {
+          i = k;
+        }
+      }
+      index.erase(counters[i].key);
+      counters[i] = Counter{key, counters[i].count, counters[i].count, 0};
+      index[key] = i;
+    }
+    counters[i].count++;
+    if (write) {
+      counters[i].writes++;
+    }
+    return counters[i];
+  }
+
+  // nullptr if the key has no counter
+  const Counter *find(const std::string &key) const {
+    auto it = index.find(key);
+    return it == index.end() ? nullptr : &counters[it->second];
+  }
+
+  uint64_t total_num() const { return total; }
+
+  // adds the counters of other, a key without a counter in one of the
+  // sketches keeps the error it has in the other
+  void merge(const HotKeySketch &other) {
+    for (auto &counter : other.counters) {
+      auto it = index.find(counter.key);
+      if (it == index.end()) {
+        index[counter.key] = counters.size();
+        counters.push_back(counter);
+      } else {
+        auto &c = counters[it->second];
+        c.count += counter.count;
+        c.error += counter.error;
+        c.writes += counter.writes;
+      }
+    }
+    total += other.total;
+    if (counters.size() > capacity) {
+      counters = top(capacity);
+      index.clear();
+      for (auto i = 0u; i < counters.size(); i++) {
+        index[counters[i].key] = i;
+      }
+    }
+  }
+
+  // at most n counters, the largest count first
+  std::vector<Counter> top(std::size_t n) const {
+    std::vector<Counter> result(counters);
+    std::sort(result.begin(), result.end(),
+              [](const Counter &a, const Counter &b) {
+                return a.count > b.count;
+              });
+    if (result.size() > n) {
+      result.resize(n);
+    }
+    return result;
+  }
+
+  void clear() {
+    counters.clear();
+    index.clear();
+    total = 0;
+  }
+
+private:
+  std::size_t capacity;
+  std::vector<Counter> counters;
+  std::unordered_map<std::string, std::size_t> index;
+  uint64_t total = 0;
+};
+} // namespace coco
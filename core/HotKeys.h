@@ -0,0 +1,298 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/HashMap.h"
+#include "common/Message.h"
+#include "common/MessagePiece.h"
+#include "core/ControlMessage.h"
+#include "core/HotKeySketch.h"
+#include "core/Partitioner.h"
+#include "core/Table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --hot_keys=n, a coordinator replicates up to n hot, read-mostly keys
+ * of the partitions it masters to all coordinators, so that the remote
+ * transactions read them locally. They are still validated at the master,
+ * as with --read_on_replica, so a copy that is behind only aborts the
+ * transactions that read it.
+ *
+ * The master samples the remote searches and the writes of its partitions in
+ * a HotKeySketch. A key is hot once it has at least 1 / HOT_FRACTION of the
+ * samples, and read-mostly if at most 1 / READ_RATIO of its samples are
+ * writes. A hot key is sent to the coordinators without a replica of its
+ * partition, and from then on each write of the key is, once it is unlocked.
+ * A coordinator applies the copies with the Thomas write rule, since copies
+ * sent by different workers can arrive in any order, and reads a key locally
+ * once it has a copy. A key stays hot till the end of the run.
+ */
+
+class HotKeys {
+public:
+  // one access in SAMPLE_RATE is counted
+  static constexpr std::size_t SAMPLE_RATE = 16;
+  static constexpr uint64_t MIN_SAMPLES = 1024;
+  static constexpr uint64_t HOT_FRACTION = 100;
+  static constexpr uint64_t READ_RATIO = 4;
+  // the sketch counts this many keys per hot key
+  static constexpr std::size_t SKETCH_FACTOR = 8;
+
+  explicit HotKeys(std::size_t capacity)
+      : capacity(capacity), sketch(std::max<std::size_t>(
+                                capacity * SKETCH_FACTOR, HOT_FRACTION)) {}
+
+  // the hot keys of the executors on a coordinator
+  static HotKeys &of(std::size_t coordinator_id, std::size_t capacity) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<HotKeys>> all;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &hot_keys = all[coordinator_id];
+    if (hot_keys == nullptr) {
+      hot_keys = std::make_unique<HotKeys>(capacity);
+    }
+    return *hot_keys;
+  }
+
+  static std::string key_of(ITable &table, const void *key) {
+    std::string k;
+    Encoder encoder(k);
+    encoder << static_cast<uint32_t>(table.tableID())
+            << static_cast<uint32_t>(table.partitionID());
+    encoder.write_n_bytes(key, table.key_size());
+    return k;
+  }
+
+  // a master key that is hot or a remote key that has a copy here
+  bool contains(ITable &table, const void *key) {
+    return n_keys.load(std::memory_order_relaxed) > 0 &&
+           keys.contains(key_of(table, key));
+  }
+
+  // counts an access, returns true if key turns hot
+  bool record(const std::string &key, bool write) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &counter = sketch.add(key, write);
+    if (write || n_promoted >= capacity ||
+        sketch.total_num() < MIN_SAMPLES ||
+        (counter.count - counter.error) * HOT_FRACTION < sketch.total_num() ||
+        counter.writes * READ_RATIO > counter.count || !insert(key)) {
+      return false;
+    }
+    n_promoted++;
+    return true;
+  }
+
+  // the master calls it after a remote search of key
+  template <class Helper>
+  void on_search(ITable &table, const void *key,
+                 const Partitioner &partitioner,
+                 std::vector<std::unique_ptr<Message>> &messages) {
+    if (!sample()) {
+      return;
+    }
+    // a write that unlocks the key from now on replicates it, see on_write
+    auto k = key_of(table, key);
+    if (!record(k, false)) {
+      return;
+    }
+    if (!replicate_row<Helper>(table, key, partitioner, messages)) {
+      // a writer holds the lock, the key may turn hot later
+      std::lock_guard<std::mutex> guard(mutex);
+      keys.remove(k);
+      n_keys.fetch_sub(1);
+      n_promoted--;
+      return;
+    }
+    LOG(INFO) << "a key of table " << table.tableID() << " partition "
+              << table.partitionID() << " is hot, replicated to all nodes.";
+  }
+
+  // the master calls it once a write of key is unlocked
+  template <class Helper>
+  void on_write(ITable &table, const void *key,
+                const Partitioner &partitioner,
+                std::vector<std::unique_ptr<Message>> &messages) {
+    // the unlock and this load are ordered against the insert and the read of
+    // on_search, so that either the write or the promotion sends the row
+    bool sampled = sample();
+    if (!sampled && n_keys.load() == 0) {
+      return;
+    }
+    auto k = key_of(table, key);
+    if (sampled) {
+      record(k, true);
+    }
+    if (n_keys.load() > 0 && keys.contains(k)) {
+      replicate_row<Helper>(table, key, partitioner, messages);
+    }
+  }
+
+  // sends the row to the coordinators without a replica of its partition,
+  // returns false if the row is locked
+  template <class Helper>
+  static bool replicate_row(ITable &table, const void *key,
+                            const Partitioner &partitioner,
+                            std::vector<std::unique_ptr<Message>> &messages) {
+    auto row = table.search(key);
+    auto &tid = *std::get<0>(row);
+    uint64_t last_tid = tid.load();
+    if (Helper::is_locked(last_tid)) {
+      return false;
+    }
+    std::string value(table.value_size(), 0);
+    std::memcpy(&value[0], std::get<1>(row), value.size());
+    if (tid.load() != last_tid) {
+      return false;
+    }
+
+    auto partition_id = table.partitionID();
+    for (auto k = 0u; k < partitioner.total_coordinators(); k++) {
+      if (k == partitioner.master_coordinator(partition_id) ||
+          partitioner.is_partition_replicated_on(partition_id, k)) {
+        continue;
+      }
+      new_hot_key_message(*messages[k], table, key, value.data(), last_tid);
+    }
+    return true;
+  }
+
+  static std::size_t new_hot_key_message(Message &message, ITable &table,
+                                         const void *key, const void *value,
+                                         uint64_t tid) {
+
+    /*
+     * The structure of a hot key request: (primary key, field value, tid)
+     */
+
+    auto key_size = table.key_size();
+    auto field_size = table.field_size();
+
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        field_size + sizeof(tid);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::HOT_KEY_REQUEST), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(key, key_size);
+    table.serialize_value(encoder, value);
+    encoder << tid;
+    message.flush();
+    return message_size;
+  }
+
+  /*
+   * Wraps the handlers of the protocol's search and release lock requests,
+   * i.e., the remote reads and the remote writes once they are unlocked.
+   * Helper::replicate(tid, commit_tid, func) applies a copy.
+   */
+  template <class Helper, class TransactionType>
+  static void set_message_handlers(
+      std::vector<std::function<void(MessagePiece, Message &, ITable &,
+                                     TransactionType *)>> &handlers,
+      HotKeys &hot_keys, const Partitioner &partitioner,
+      std::vector<std::unique_ptr<Message>> &messages, int search_type,
+      int release_type) {
+
+    handlers[static_cast<int>(ControlMessage::HOT_KEY_REQUEST)] =
+        [&hot_keys](MessagePiece inputPiece, Message &responseMessage,
+                    ITable &table, TransactionType *txn) {
+          hot_key_request_handler<Helper>(inputPiece, table, hot_keys);
+        };
+
+    auto search_handler = handlers[search_type];
+    handlers[search_type] = [search_handler, &hot_keys, &partitioner,
+                             &messages](MessagePiece inputPiece,
+                                        Message &responseMessage,
+                                        ITable &table, TransactionType *txn) {
+      search_handler(inputPiece, responseMessage, table, txn);
+      hot_keys.on_search<Helper>(table, inputPiece.toStringPiece().data(),
+                                 partitioner, messages);
+    };
+
+    auto release_handler = handlers[release_type];
+    handlers[release_type] = [release_handler, &hot_keys, &partitioner,
+                              &messages](MessagePiece inputPiece,
+                                         Message &responseMessage,
+                                         ITable &table, TransactionType *txn) {
+      release_handler(inputPiece, responseMessage, table, txn);
+      hot_keys.on_write<Helper>(table, inputPiece.toStringPiece().data(),
+                                partitioner, messages);
+    };
+  }
+
+private:
+  template <class Helper>
+  static void hot_key_request_handler(MessagePiece inputPiece, ITable &table,
+                                      HotKeys &hot_keys) {
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(ControlMessage::HOT_KEY_REQUEST));
+    auto key_size = table.key_size();
+    auto field_size = table.field_size();
+
+    /*
+     * The structure of a hot key request: (primary key, field value, tid)
+     * The structure of a hot key response: null
+     */
+
+    DCHECK(inputPiece.get_message_length() == MessagePiece::get_header_size() +
+                                                  key_size + field_size +
+                                                  sizeof(uint64_t));
+
+    auto stringPiece = inputPiece.toStringPiece();
+    const void *key = stringPiece.data();
+    stringPiece.remove_prefix(key_size);
+    auto valueStringPiece = stringPiece;
+    stringPiece.remove_prefix(field_size);
+
+    uint64_t tid;
+    Decoder dec(stringPiece);
+    dec >> tid;
+    DCHECK(dec.size() == 0);
+
+    Helper::replicate(table.search_metadata(key), tid, [&]() {
+      table.deserialize_value(key, valueStringPiece);
+    });
+    // the transactions here read the key from now on
+    hot_keys.insert(key_of(table, key));
+  }
+
+  bool insert(const std::string &key) {
+    if (!keys.insert(key, true)) {
+      return false;
+    }
+    n_keys.fetch_add(1);
+    return true;
+  }
+
+  static bool sample() {
+    thread_local std::size_t n = 0;
+    return ++n % SAMPLE_RATE == 0;
+  }
+
+private:
+  std::size_t capacity;
+  std::mutex mutex;
+  HotKeySketch sketch;
+  std::size_t n_promoted = 0;
+  HashMap<997, std::string, bool> keys;
+  std::atomic<std::size_t> n_keys{0};
+};
+} // namespace coco
@@ -0,0 +1,506 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/LockfreeQueue.h"
+#include "common/StringPiece.h"
+#include "common/Time.h"
+#include "core/AdmissionControl.h"
+#include "core/Priorities.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Client ingress -- format --
+ *
+ *  With --ingress_port, coordinator i runs the transactions clients submit
+ *  on port ingress_port + i instead of generating them. A request names a
+ *  stored procedure of the workload and carries its args, see
+ *  Workload::submitted_transaction, and is answered once its transaction is
+ *  committed and its epoch durable, or right away if it does not run. A
+ *  client sends its requests in frames over a connection and gets the
+ *  responses in frames too, in the order they are done.
+ *
+ *  frame:    [ size (32) | size bytes of requests or responses ]
+ *  request:  [ id (64) | procedure (32) | args size (32) | args ]
+ *  response: [ id (64) | status (32) ]
+ */
+
+enum class IngressStatus : uint32_t {
+  COMMITTED, // its epoch is durable
+  ABORTED,   // by the transaction itself, e.g., an unused item in NewOrder
+  REJECTED,  // too many transactions in flight or shed, the client may retry
+  INVALID    // an unknown procedure, bad args, or a partition elsewhere
+};
+
+struct IngressRequest {
+  uint64_t id = 0;
+  uint32_t procedure = 0;
+  std::string args;
+  // the connection it came from, and when
+  uint64_t connection = 0;
+  Clock::time_point arrival;
+  IngressStatus status = IngressStatus::COMMITTED;
+};
+
+struct IngressFrame {
+  static constexpr std::size_t HEADER_SIZE = sizeof(uint32_t);
+  static constexpr std::size_t REQUEST_HEADER_SIZE =
+      sizeof(uint64_t) + sizeof(uint32_t) * 2;
+  static constexpr std::size_t RESPONSE_SIZE =
+      sizeof(uint64_t) + sizeof(uint32_t);
+  static constexpr std::size_t MAX_SIZE = 1 << 20;
+
+  // appends a frame of body to bytes
+  static void append(std::string &bytes, const std::string &body) {
+    Encoder enc(bytes);
+    enc << static_cast<uint32_t>(body.size());
+    enc.write_n_bytes(body.data(), body.size());
+  }
+
+  static void add_request(std::string &body, uint64_t id, uint32_t procedure,
+                          const std::string &args) {
+    Encoder enc(body);
+    enc << id << procedure << static_cast<uint32_t>(args.size());
+    enc.write_n_bytes(args.data(), args.size());
+  }
+
+  static void add_response(std::string &body, uint64_t id,
+                           IngressStatus status) {
+    Encoder enc(body);
+    enc << id << static_cast<uint32_t>(status);
+  }
+
+  // removes the next frame from bytes into body, returns false unless bytes
+  // start with a whole frame
+  static bool next(StringPiece &bytes, StringPiece &body) {
+    if (bytes.size() < HEADER_SIZE) {
+      return false;
+    }
+    auto size = size_of(bytes);
+    if (bytes.size() < HEADER_SIZE + size) {
+      return false;
+    }
+    body = StringPiece(bytes.data() + HEADER_SIZE, size);
+    bytes.remove_prefix(HEADER_SIZE + size);
+    return true;
+  }
+
+  // the size of the frame bytes start with, which has a header
+  static uint32_t size_of(StringPiece bytes) {
+    uint32_t size;
+    std::memcpy(&size, bytes.data(), sizeof(size));
+    return size;
+  }
+
+  // removes the next request from body, returns false on a torn one
+  static bool read_request(StringPiece &body, IngressRequest &request) {
+    if (body.size() < REQUEST_HEADER_SIZE) {
+      return false;
+    }
+    uint32_t size;
+    Decoder dec(body);
+    dec >> request.id >> request.procedure >> size;
+    if (body.size() < REQUEST_HEADER_SIZE + size) {
+      return false;
+    }
+    request.args.assign(body.data() + REQUEST_HEADER_SIZE, size);
+    body.remove_prefix(REQUEST_HEADER_SIZE + size);
+    return true;
+  }
+
+  // removes the next response from body, returns false on a torn one
+  static bool read_response(StringPiece &body, uint64_t &id,
+                            IngressStatus &status) {
+    if (body.size() < RESPONSE_SIZE) {
+      return false;
+    }
+    uint32_t s;
+    Decoder dec(body);
+    dec >> id >> s;
+    status = static_cast<IngressStatus>(s);
+    body.remove_prefix(RESPONSE_SIZE);
+    return true;
+  }
+};
+
+/*
+ * An IngressServer admits the requests of the clients of a coordinator and
+ * hands them to the executors. It has its own thread, which polls the
+ * connections, deals the admitted requests round robin to the ingress queue
+ * of each executor, and sends the responses the executors hand back on
+ * their completion queues. Both are single producer, single consumer
+ * queues, and only the server thread counts the requests in flight.
+ *
+ * A request is admitted while fewer than --ingress_max_in_flight are in
+ * flight, i.e., queued, running or waiting for their epoch, and its ingress
+ * queue has room, otherwise it is rejected. The requests of a priority class
+ * above 0 have ingress queues of their own, which the executors pop first,
+ * see Priorities. The completion queues are only
+ * polled every POLL_TIMEOUT_MS when the connections are idle, which is well
+ * below an epoch of group commit. With --dynamic_workers, the requests are
+ * only dealt to the active executors, see set_active.
+ *
+ * With --ingress_target_delay, the requests of class 0 are not dealt to an
+ * executor whose queue has a standing delay, see AdmissionControl, or which
+ * has its share of --ingress_max_in_flight in flight, and are shed, i.e.,
+ * rejected, if no executor takes them. The requests of a priority class above
+ * 0 are never shed.
+ */
+
+class IngressServer {
+public:
+  static IngressServer &of(std::size_t coordinator_id) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<IngressServer>> servers;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &server = servers[coordinator_id];
+    if (server == nullptr) {
+      server = std::make_unique<IngressServer>();
+    }
+    return *server;
+  }
+
+  IngressServer() : stopFlag(false) {}
+
+  IngressServer(const IngressServer &) = delete;
+  IngressServer &operator=(const IngressServer &) = delete;
+
+  ~IngressServer() {
+    stop();
+    for (auto &c : connections) {
+      close(c.second.fd);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    for (auto i = 0u; i < requests.size(); i++) {
+      for (IngressRequest *request; (request = pop(i)) != nullptr;) {
+        delete request;
+      }
+      IngressRequest *request;
+      while (completions[i]->pop(request)) {
+        delete request;
+      }
+    }
+  }
+
+  // binds port, 0 picks a free port, see get_port(). Called before the
+  // executors are created.
+  // target_delay and interval are in us, see AdmissionControl
+  void listen(int port, std::size_t worker_num, std::size_t max_in_flight,
+              const Priorities &priorities = Priorities(),
+              uint64_t target_delay = 0, uint64_t interval = 100000) {
+    this->max_in_flight = max_in_flight;
+    this->priorities = priorities;
+    n_active.store(worker_num);
+    admission.init(worker_num, target_delay, interval);
+    worker_in_flight.assign(worker_num, 0);
+    for (auto i = 0u; i < worker_num; i++) {
+      requests.push_back(std::make_unique<LockfreeQueue<IngressRequest *>>());
+      urgent_requests.push_back(
+          std::make_unique<LockfreeQueue<IngressRequest *>>());
+      completions.push_back(
+          std::make_unique<LockfreeQueue<IngressRequest *>>());
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(fd >= 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    CHECK(bind(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+        << "failed to bind the ingress port " << port << ", errno: " << errno;
+    CHECK(::listen(fd, 64) == 0);
+    set_non_blocking(fd);
+
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr *)&addr, &len);
+    this->port = ntohs(addr.sin_port);
+  }
+
+  int get_port() const { return port; }
+
+  void start() {
+    LOG(INFO) << "Ingress server listens on port " << port;
+    thread = std::thread(&IngressServer::serve, this);
+  }
+
+  void stop() {
+    stopFlag.store(true);
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  // called by the executor worker_id, nullptr if no request is waiting, the
+  // ones of a priority class first
+  IngressRequest *pop(std::size_t worker_id) {
+    for (auto queues : {&urgent_requests, &requests}) {
+      auto &queue = *(*queues)[worker_id];
+      if (!queue.empty()) {
+        auto request = queue.front();
+        queue.pop();
+        if (admission.enabled()) {
+          using namespace std::chrono;
+          auto now = Clock::now();
+          auto sojourn = duration_cast<microseconds>(now - request->arrival);
+          admission.on_pop(
+              worker_id, sojourn.count(),
+              duration_cast<microseconds>(now.time_since_epoch()).count());
+        }
+        return request;
+      }
+    }
+    if (admission.enabled()) {
+      admission.on_empty(worker_id);
+    }
+    return nullptr;
+  }
+
+  // called by the executor worker_id, the request goes back to the server
+  void notify(std::size_t worker_id, IngressRequest *request,
+              IngressStatus status) {
+    request->status = status;
+    completions[worker_id]->push(request);
+  }
+
+  // the requests go to the first n executors only, the others drain their
+  // ingress queues, see WorkerScaling
+  void set_active(std::size_t n) { n_active.store(n); }
+
+  uint64_t get_n_admitted() const { return n_admitted.load(); }
+
+  uint64_t get_n_rejected() const { return n_rejected.load(); }
+
+  // the # of requests shed by admission control, not in get_n_rejected()
+  uint64_t get_n_shed() const { return n_shed.load(); }
+
+  // the # of times the queue of an executor became overloaded
+  uint64_t get_n_overloads() const { return admission.get_n_overloads(); }
+
+private:
+  struct Connection {
+    int fd;
+    std::string in, out;
+    // the body of the next response frame
+    std::string responses;
+  };
+
+  static void set_non_blocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  }
+
+  void serve() {
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> ids;
+    while (!stopFlag.load()) {
+      fds.assign(1, pollfd{fd, POLLIN, 0});
+      ids.assign(1, 0);
+      for (auto &c : connections) {
+        short events = POLLIN | (c.second.out.empty() ? 0 : POLLOUT);
+        fds.push_back(pollfd{c.second.fd, events, 0});
+        ids.push_back(c.first);
+      }
+
+      if (poll(fds.data(), fds.size(), POLL_TIMEOUT_MS) > 0) {
+        if (fds[0].revents & POLLIN) {
+          accept_connections();
+        }
+        for (auto i = 1u; i < fds.size(); i++) {
+          if (fds[i].revents == 0) {
+            continue;
+          }
+          auto &c = connections[ids[i]];
+          if (((fds[i].revents & POLLIN) && !receive(ids[i], c)) ||
+              (fds[i].revents & (POLLERR | POLLNVAL)) || !flush(c)) {
+            close(c.fd);
+            connections.erase(ids[i]);
+          }
+        }
+      }
+
+      complete();
+    }
+  }
+
+  void accept_connections() {
+    for (;;) {
+      int conn = accept(fd, nullptr, nullptr);
+      if (conn < 0) {
+        return;
+      }
+      set_non_blocking(conn);
+      connections[next_connection++] = Connection{conn, "", "", ""};
+    }
+  }
+
+  // reads what the client sent and admits the requests of its whole frames,
+  // false once the connection is closed or broken
+  bool receive(uint64_t id, Connection &c) {
+    char buffer[4096];
+    for (;;) {
+      auto n = recv(c.fd, buffer, sizeof(buffer), 0);
+      if (n == 0) {
+        return false;
+      }
+      if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          return false;
+        }
+        break;
+      }
+      c.in.append(buffer, n);
+    }
+
+    auto now = Clock::now();
+    StringPiece bytes(c.in), body;
+    while (IngressFrame::next(bytes, body)) {
+      while (body.size() > 0) {
+        auto request = new IngressRequest();
+        if (!IngressFrame::read_request(body, *request)) {
+          delete request;
+          return false;
+        }
+        request->connection = id;
+        request->arrival = now;
+        admit(c, request);
+      }
+    }
+    if (bytes.size() >= IngressFrame::HEADER_SIZE &&
+        IngressFrame::size_of(bytes) > IngressFrame::MAX_SIZE) {
+      return false;
+    }
+    c.in.erase(0, c.in.size() - bytes.size());
+    end_responses(c);
+    return true;
+  }
+
+  void admit(Connection &c, IngressRequest *request) {
+    auto worker_num = n_active.load();
+    auto urgent = priorities.of(request->procedure) > 0;
+    auto &queues = urgent ? urgent_requests : requests;
+    auto controlled = admission.enabled() && !urgent;
+    auto shed = false;
+    if (n_in_flight < max_in_flight) {
+      // the share of an executor, rounded up
+      auto worker_max_in_flight = (max_in_flight + worker_num - 1) / worker_num;
+      for (auto k = 0u; k < worker_num; k++) {
+        auto i = (next_worker + k) % worker_num;
+        if (controlled && (admission.overloaded(i) ||
+                           worker_in_flight[i] >= worker_max_in_flight)) {
+          shed = true;
+          continue;
+        }
+        if (queues[i]->try_push(request)) {
+          next_worker = i + 1;
+          n_in_flight++;
+          worker_in_flight[i]++;
+          n_admitted.fetch_add(1);
+          return;
+        }
+      }
+    }
+    (shed ? n_shed : n_rejected).fetch_add(1);
+    IngressFrame::add_response(c.responses, request->id,
+                               IngressStatus::REJECTED);
+    delete request;
+  }
+
+  // answers the requests the executors are done with
+  void complete() {
+    std::vector<Connection *> answered;
+    for (auto i = 0u; i < completions.size(); i++) {
+      IngressRequest *request;
+      while (completions[i]->pop(request)) {
+        n_in_flight--;
+        worker_in_flight[i]--;
+        auto it = connections.find(request->connection);
+        if (it != connections.end()) {
+          IngressFrame::add_response(it->second.responses, request->id,
+                                     request->status);
+          answered.push_back(&it->second);
+        }
+        delete request;
+      }
+    }
+    for (auto c : answered) {
+      end_responses(*c);
+    }
+  }
+
+  // the responses so far go in a frame, which is sent as far as the socket
+  // takes it, the rest once it is writable
+  void end_responses(Connection &c) {
+    if (c.responses.empty()) {
+      return;
+    }
+    IngressFrame::append(c.out, c.responses);
+    c.responses.clear();
+    flush(c);
+  }
+
+  // false once the connection is broken
+  bool flush(Connection &c) {
+    std::size_t sent = 0;
+    while (sent < c.out.size()) {
+      auto n = send(c.fd, c.out.data() + sent, c.out.size() - sent,
+                    MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+          return false;
+        }
+        break;
+      }
+      sent += n;
+    }
+    c.out.erase(0, sent);
+    return true;
+  }
+
+private:
+  static constexpr int POLL_TIMEOUT_MS = 1;
+
+  int fd = -1, port = 0;
+  std::atomic<bool> stopFlag;
+  std::thread thread;
+  std::vector<std::unique_ptr<LockfreeQueue<IngressRequest *>>> requests,
+      urgent_requests, completions;
+  Priorities priorities;
+  // touched by the server thread only
+  std::map<uint64_t, Connection> connections;
+  uint64_t next_connection = 1;
+  std::size_t next_worker = 0, n_in_flight = 0, max_in_flight = 0;
+  std::vector<std::size_t> worker_in_flight;
+  AdmissionControl admission;
+  std::atomic<uint64_t> n_admitted{0}, n_rejected{0}, n_shed{0};
+  std::atomic<std::size_t> n_active{0};
+};
+} // namespace coco
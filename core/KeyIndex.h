@@ -0,0 +1,107 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace coco {
+
+/*
+ * KeyIndex finds the position of a key in a read or write set, e.g., a
+ * SmallVector<SiloRWKey, N>, where keys are compared by address.
+ *
+ * Small sets are scanned. Once a set has more than THRESHOLD keys, the keys
+ * are indexed in an open-addressed hash table with linear probing, which
+ * catches up with the keys appended since the last lookup. Sets only grow
+ * until the transaction is reset, and clear() must be called then.
+ */
+
+class KeyIndex {
+public:
+  static constexpr std::size_t THRESHOLD = 8;
+
+  // returns the position of the first entry of key, or -1 if not found
+  template <class KeySet> int64_t find(const KeySet &keys, const void *key) {
+    if (keys.size() <= THRESHOLD) {
+      for (auto i = 0u; i < keys.size(); i++) {
+        if (keys[i].get_key() == key) {
+          return i;
+        }
+      }
+      return -1;
+    }
+
+    for (; n_indexed < keys.size(); n_indexed++) {
+      insert(keys[n_indexed].get_key(), n_indexed);
+    }
+
+    for (auto i = hash(key);; i = (i + 1) & mask()) {
+      if (slots[i].key == key) {
+        return slots[i].index;
+      }
+      if (slots[i].key == nullptr) {
+        return -1;
+      }
+    }
+  }
+
+  void clear() {
+    if (n_indexed > 0) {
+      slots.assign(slots.size(), Slot());
+      n_indexed = 0;
+    }
+  }
+
+private:
+  struct Slot {
+    const void *key = nullptr;
+    uint32_t index = 0;
+  };
+
+  void insert(const void *key, std::size_t index) {
+    // at most half of the slots are taken
+    if (2 * (n_indexed + 1) > slots.size()) {
+      std::vector<Slot> old(std::max<std::size_t>(4 * THRESHOLD,
+                                                  2 * slots.size()));
+      old.swap(slots);
+      for (auto &slot : old) {
+        if (slot.key != nullptr) {
+          place(slot);
+        }
+      }
+    }
+    Slot slot;
+    slot.key = key;
+    slot.index = static_cast<uint32_t>(index);
+    place(slot);
+  }
+
+  // the first entry of a key is kept
+  void place(const Slot &slot) {
+    for (auto i = hash(slot.key);; i = (i + 1) & mask()) {
+      if (slots[i].key == slot.key) {
+        return;
+      }
+      if (slots[i].key == nullptr) {
+        slots[i] = slot;
+        return;
+      }
+    }
+  }
+
+  std::size_t mask() const { return slots.size() - 1; }
+
+  std::size_t hash(const void *key) const {
+    auto h = reinterpret_cast<uintptr_t>(key) * 0x9E3779B97F4A7C15ull;
+    return (h >> 32) & mask();
+  }
+
+private:
+  std::vector<Slot> slots;
+  std::size_t n_indexed = 0;
+};
+} // namespace coco
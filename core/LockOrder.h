@@ -0,0 +1,82 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Partitioner.h"
+#include "core/Table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <tuple>
+#include <vector>
+
+namespace coco {
+
+/*
+ * LockOrder sorts a write set by (table, partition, key hash) before it is
+ * locked with --lock_ordering. Since every transaction takes its locks in the
+ * same global order, a transaction can wait for a lock held by another one
+ * without a deadlock, instead of aborting right away.
+ *
+ * The metadata of the local rows is looked up and prefetched for writing in
+ * one pass, so that the cache misses overlap before the lock loop runs.
+ */
+
+template <class RWKeyType> class LockOrder {
+public:
+  template <class KeySet, class DatabaseType>
+  void sort_and_prefetch(KeySet &writeSet, DatabaseType &db,
+                         const Partitioner &partitioner) {
+    order.clear();
+    for (auto i = 0u; i < writeSet.size(); i++) {
+      auto &writeKey = writeSet[i];
+      auto table =
+          db.find_table(writeKey.get_table_id(), writeKey.get_partition_id());
+      order.emplace_back(writeKey.get_table_id(), writeKey.get_partition_id(),
+                         hash(writeKey.get_key(), table->key_size()), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    sorted.assign(writeSet.begin(), writeSet.end());
+    tids.resize(writeSet.size());
+    for (auto i = 0u; i < order.size(); i++) {
+      writeSet[i] = sorted[std::get<3>(order[i])];
+
+      auto &writeKey = writeSet[i];
+      auto partitionId = writeKey.get_partition_id();
+      tids[i] = nullptr;
+      if (partitioner.has_master_partition(partitionId)) {
+        auto table = db.find_table(writeKey.get_table_id(), partitionId);
+        tids[i] = &table->search_metadata(writeKey.get_key());
+        __builtin_prefetch(tids[i], 1);
+      }
+    }
+  }
+
+  // the metadata of the i-th key in the sorted write set if it is local
+  std::atomic<uint64_t> &tid(std::size_t i) {
+    DCHECK(i < tids.size() && tids[i] != nullptr);
+    return *tids[i];
+  }
+
+  // FNV-1a
+  static uint64_t hash(const void *key, std::size_t size) {
+    auto bytes = static_cast<const unsigned char *>(key);
+    uint64_t h = 14695981039346656037ull;
+    for (auto i = 0u; i < size; i++) {
+      h = (h ^ bytes[i]) * 1099511628211ull;
+    }
+    return h;
+  }
+
+private:
+  std::vector<std::tuple<std::size_t, std::size_t, uint64_t, std::size_t>>
+      order;
+  std::vector<RWKeyType> sorted;
+  std::vector<std::atomic<uint64_t> *> tids;
+};
+} // namespace coco
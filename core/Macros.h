@@ -13,18 +13,66 @@ DEFINE_int32(id, 0, "coordinator id");
 DEFINE_int32(threads, 1, "the number of threads");
 DEFINE_int32(io, 1, "the number of i/o threads");
 DEFINE_int32(partition_num, 1, "the number of partitions");
-DEFINE_string(partitioner, "hash", "database partitioner (hash, hash2, pb)");
+DEFINE_string(partitioner, "hash",
+              "partitioner (hash, hash2, pb, dynamic, affinity:<trace>)");
+DEFINE_string(migrations, "",
+              "partitions to move with --partitioner=dynamic, e.g., 3:0,5:1");
+DEFINE_int32(migration_delay, 5, "seconds before the partitions move");
+DEFINE_int32(migration_bandwidth, 100,
+             "max migration bandwidth per node in MB/s, 0 for unlimited.");
+DEFINE_string(rebuild_replicas, "",
+              "coordinators that stream their replicas from the masters "
+              "instead of generating them, e.g., 2,3");
 DEFINE_bool(sleep_on_retry, true, "sleep when retry aborted transactions");
 DEFINE_int32(batch_size, 100, "star or calvin batch size");
 DEFINE_int32(group_time, 10, "group commit frequency");
 DEFINE_int32(batch_flush, 50, "batch flush");
 DEFINE_int32(sleep_time, 1000, "retry sleep time");
+DEFINE_int32(deferred_retries, 0,
+             "aborted transactions a worker of group commit defers while "
+             "it runs new ones, 0 to sleep and retry.");
+DEFINE_int32(retry_backoff, 10,
+             "backoff in us of a deferred retry, doubled on each abort.");
+DEFINE_bool(request_combining, false,
+            "the coroutines of a Silo worker share the search requests of a "
+            "remote row.");
+DEFINE_bool(retry_cache, false,
+            "a retry of SiloGC reads the remote rows of the aborted attempt "
+            "from a cache.");
+DEFINE_int32(conflict_routing, 0,
+             "% of transactions drawn on a hot row of their worker, 0 to "
+             "disable.");
+#ifdef COCO_PROTOCOL
+// the binary only runs one protocol, see core/factory/WorkerFactory.h
+DEFINE_string(protocol, COCO_PROTOCOL, "transaction protocol");
+#else
 DEFINE_string(protocol, "Scar", "transaction protocol");
+#endif
 DEFINE_string(replica_group, "1,3", "calvin replica group");
 DEFINE_string(lock_manager, "1,1", "calvin lock manager");
 DEFINE_bool(read_on_replica, false, "read from replicas");
+DEFINE_bool(stale_reads, false,
+            "track the epochs applied on replicas for bounded-staleness "
+            "reads, see StaleReads");
+DEFINE_int32(hot_keys, 0,
+             "hot keys a node replicates to all nodes for reads (Silo).");
 DEFINE_bool(local_validation, false, "local validation");
+DEFINE_bool(delta_replication, false,
+            "replicate only the changed fields of a row (Silo).");
+DEFINE_bool(operation_replication, false,
+            "replicate the operations of single-partition transactions.");
+DEFINE_bool(lock_ordering, false,
+            "lock write sets in a global order and wait for held locks");
+DEFINE_int32(lock_spin, 1000,
+             "spins on a held lock with --lock_ordering or --wait_policy");
+DEFINE_string(wait_policy, "no_wait",
+              "2PL lock conflicts (no_wait, wait_die, wound_wait)");
+DEFINE_string(hot_tables, "",
+              "read-mostly tables with 2PL reader indicators, e.g., 0");
 DEFINE_bool(rts_sync, false, "rts sync");
+DEFINE_int32(rts_lease, 0,
+             "Scar extends a read rts past the commit ts by this lease and "
+             "batches the rts extensions of replicas, 0 to disable.");
 DEFINE_bool(star_sync, false, "synchronous write in the single-master phase");
 DEFINE_bool(star_dynamic_batch_size, true, "dynamic batch size");
 DEFINE_bool(plv, true, "parallel locking and validation");
@@ -33,16 +81,210 @@ DEFINE_bool(same_batch, false,
 DEFINE_bool(aria_read_only, true, "aria read only optimization");
 DEFINE_bool(aria_reordering, true, "aria reordering optimization");
 DEFINE_bool(aria_si, false, "aria snapshot isolation");
+DEFINE_bool(work_stealing, false,
+            "idle aria workers run the transactions of the others.");
+DEFINE_bool(aria_partition_affinity, false,
+            "each aria worker generates transactions on its own partitions.");
+DEFINE_int32(aria_target_latency, 0,
+             "adjust the aria batch size toward this epoch time in us, 0 to "
+             "disable, --batch_size is the largest batch.");
+DEFINE_int32(aria_min_batch_size, 10,
+             "the smallest aria batch with --aria_target_latency.");
+DEFINE_bool(aria_input_replication, false,
+            "the first aria replica group ships the inputs of each batch to "
+            "the others, see --replica_group.");
+DEFINE_bool(aria_generate_ahead, false,
+            "aria workers generate the next batch while the last one "
+            "commits, its read phase still waits for the commit.");
 DEFINE_int32(delay, 0, "delay time in us.");
+DEFINE_string(link_delays, "",
+              "delay in us of each link, a row per node, e.g., 0,100;100,0");
+DEFINE_string(jitter, "",
+              "random delay per message, normal:<us> or pareto:<us>");
+DEFINE_int32(link_bandwidth, 0,
+             "bandwidth of each link in MB/s, 0 for unlimited.");
 DEFINE_string(cdf_path, "", "path to cdf");
-DEFINE_string(log_path, "", "path to disk logging.");
+DEFINE_string(log_path, "",
+              "directories of the redo log separated by ',', e.g., one per "
+              "device, empty to disable.");
+DEFINE_bool(log_direct_io, false, "write the redo log with O_DIRECT.");
+DEFINE_bool(command_log, false,
+            "log the inputs of each batch to --log_path instead of the write "
+            "sets, for deterministic protocols.");
+DEFINE_string(trace_path, "",
+              "directory of the access traces, empty to disable.");
+DEFINE_int32(trace_rate, 100, "one transaction in this many is traced.");
+DEFINE_string(record_path, "",
+              "directory to record the generated transactions to.");
+DEFINE_string(replay_path, "",
+              "directory of recorded transactions to generate again.");
+DEFINE_int32(conflict_profile, 0,
+             "seconds between the logs of the rows that abort transactions.");
+DEFINE_bool(repair, false,
+            "Silo reads a changed row it writes again at commit and "
+            "recomputes the writes instead of aborting.");
+DEFINE_int32(early_validation, 0,
+             "recent conflicting rows whose reads Silo and Scar validate "
+             "during execution, 0 to disable.");
+DEFINE_bool(adaptive_locking, false,
+            "Silo locks the hot rows it reads for update during execution.");
+DEFINE_bool(thread_arenas, false,
+            "each worker and i/o thread has a jemalloc arena of its own.");
+DEFINE_int32(memory_report, 0,
+             "seconds between the memory reports of the tables, 0 to disable.");
+DEFINE_string(anti_cache_path, "",
+              "directory the cold rows are evicted to, empty to disable.");
+DEFINE_string(anti_cache_tables, "",
+              "comma separated ids of the tables whose rows are evicted.");
+DEFINE_int32(anti_cache_seconds, 10,
+             "seconds a row is not accessed before it is evicted.");
+DEFINE_string(pmem_path, "",
+              "DAX directory of the persistent hash tables, empty to disable.");
+DEFINE_bool(message_latency, false,
+            "log the queueing, handling and round trip time per message type.");
+DEFINE_bool(perf_counters, false,
+            "count the hardware events of each transaction phase.");
+DEFINE_string(timeline_path, "",
+              "directory of the epoch timelines, empty to disable.");
+DEFINE_string(profile_path, "",
+              "directory of the cpu profiles, empty to disable.");
+DEFINE_int32(profile_hz, 99, "cpu profile samples per second of a thread.");
+DEFINE_bool(profile_on_signal, false,
+            "profile from one SIGUSR2 to the next instead of the whole run.");
+DEFINE_string(results_path, "",
+              "JSON file of the run results, empty to disable.");
+DEFINE_string(sweep, "",
+              "flag values to run once each, e.g., threads=1..16;zipf=0,0.9, "
+              "see Sweep.");
+DEFINE_string(sweep_path, "", "JSON file of the sweep, empty to disable.");
+DEFINE_string(phases, "",
+              "phases of the workload skew, e.g., 30:zipf=0.9;30:hot=0.5.");
+DEFINE_int32(metrics_port, 0,
+             "base port of the metrics endpoints, 0 to disable.");
+DEFINE_int32(ingress_port, 0,
+             "base port clients submit transactions to, 0 to generate them.");
+DEFINE_int32(ingress_max_in_flight, 4096,
+             "# of client transactions in flight on a coordinator.");
+DEFINE_int32(ingress_target_delay, 0,
+             "target queueing delay (us) of client transactions, 0 to admit "
+             "them up to --ingress_max_in_flight.");
+DEFINE_int32(ingress_interval, 100000,
+             "time (us) above the target delay before shedding.");
+DEFINE_string(priorities, "",
+              "priority classes of procedures, e.g., 1:1, see Priorities.");
+DEFINE_string(priority_slo, "",
+              "latency objectives of priority classes in us, e.g., 1:2000.");
+DEFINE_int32(procedure, -1,
+             "the registered procedure the workers generate, -1 to run the "
+             "workload's own transactions.");
+DEFINE_string(image_path, "",
+              "directory of the database images, empty to generate the rows.");
+DEFINE_bool(dump_image, false,
+            "write the database images to --image_path and exit.");
+DEFINE_bool(recover, false, "recover from the checkpoints and the log.");
+DEFINE_int32(checkpoint_interval, 0,
+             "seconds between fuzzy checkpoints, 0 to disable.");
+DEFINE_int32(checkpoint_bandwidth, 100,
+             "max checkpoint write bandwidth in MB/s, 0 for unlimited.");
+DEFINE_int32(snapshot_interval, 0,
+             "seconds between read-only snapshot queries, 0 to disable.");
+DEFINE_string(columnar_tables, "",
+              "tables the snapshot queries copy to columns, e.g., 0,1");
+DEFINE_string(export_path, "",
+              "directory the snapshot queries export tables to, empty to "
+              "disable.");
+DEFINE_string(export_tables, "", "tables to export, e.g., 0,1, empty for all.");
+DEFINE_int32(export_bandwidth, 100,
+             "max export write bandwidth in MB/s, 0 for unlimited.");
+DEFINE_int32(duration, 25, "seconds to run, including warmup and cooldown");
+DEFINE_int32(warmup, 10, "seconds excluded from the average at the start");
+DEFINE_int32(cooldown, 5, "seconds excluded from the average at the end");
+DEFINE_double(arrival_rate, 0,
+              "transactions per second per worker in open loop, 0 for closed "
+              "loop.");
+DEFINE_bool(dynamic_workers, false,
+            "the executors of group commit are parked and unparked at epoch "
+            "boundaries with the load.");
+DEFINE_int32(min_workers, 1, "executors that are never parked");
+DEFINE_string(network_engine, "poll", "network engine (poll, epoll)");
+DEFINE_int32(io_batch_messages, 16,
+             "max # of messages to the same node coalesced into one writev");
+DEFINE_int32(io_batch_bytes, 65536,
+             "a coalesced writev is issued once this many bytes are queued");
+DEFINE_bool(compress_messages, false,
+            "compress large messages with LZ4 in the IO threads");
+DEFINE_int32(compress_threshold, 4096,
+             "messages of at least this many bytes are compressed");
+DEFINE_int32(prefetch_distance, 0,
+             "pieces of a message whose rows are prefetched ahead of the "
+             "handler, 0 to disable.");
+DEFINE_bool(pack_messages, false,
+            "delta encode the pieces of the messages not compressed, see "
+            "PieceCodec");
+DEFINE_bool(zero_copy_receive, false,
+            "received messages view the receive buffers instead of a copy");
+DEFINE_int32(flush_bytes, 0,
+             "most bytes of async messages buffered per node before a flush, "
+             "0 to flush every batch_flush transactions, see FlushPolicy");
+DEFINE_int32(flush_age, 100,
+             "most microseconds an async message is buffered with "
+             "--flush_bytes");
+DEFINE_int32(async_credits, 0,
+             "bytes of async replication in flight per node, 0 for no limit");
+DEFINE_bool(direct_connections, false,
+            "executors send and receive their messages without the io threads");
+DEFINE_string(barrier, "all",
+              "how the managers synchronize an epoch (all, tree, clock)");
+DEFINE_int32(barrier_fanout, 4, "children per coordinator in the tree barrier");
+DEFINE_int32(clock_skew, 100,
+             "microseconds two clocks may differ by with --barrier=clock");
+DEFINE_string(transport, "tcp", "transport between nodes (tcp, rdma)");
+DEFINE_int32(rdma_gid_index, 0, "gid index of the rdma port");
+DEFINE_bool(shm_transport, true,
+            "co-located nodes talk through shared memory with the poll engine");
+DEFINE_int32(busy_poll, 0,
+             "microseconds a tcp read busy polls the device, 0 to disable");
 DEFINE_bool(tcp_no_delay, true, "TCP Nagle algorithm, true: disable nagle");
 DEFINE_bool(tcp_quick_ack, false, "TCP quick ack mode, true: enable quick ack");
+DEFINE_int32(socket_buffer, 0,
+             "KB of the send and receive buffers of a socket, 0 for default.");
+DEFINE_bool(irq_affinity, false,
+            "pin each incoming io thread to the cpu its packets arrive on.");
 DEFINE_bool(cpu_affinity, true, "pinning each thread to a separate core");
 DEFINE_int32(cpu_core_id, 0, "cpu core id");
+DEFINE_bool(numa, false, "place workers and partitions on NUMA nodes");
+DEFINE_bool(partition_serial, false,
+            "single-partition transactions of Silo run serially per "
+            "partition.");
 DEFINE_int32(durable_write_cost, 0,
              "the cost of durable write in microseconds");
+DEFINE_int32(coroutines, 1,
+             "# of transactions a worker interleaves to hide remote latency.");
 DEFINE_bool(exact_group_commit, false, "dynamically adjust group time.");
+DEFINE_bool(pipelined_epochs, false,
+            "execute the next group during the barrier of the current one.");
+DEFINE_bool(snapshot_reads, false,
+            "read-only transactions of SiloGC commit on the last epoch.");
+DEFINE_int32(split_threshold, 0,
+             "additions to a row by a worker in a group of SiloGC that split "
+             "it for the next group, 0 for none.");
+DEFINE_int32(replica_quorum, 0,
+             "replicas of each partition that acknowledge an epoch of group "
+             "commit, 0 for all.");
+DEFINE_bool(parallel_apply, false,
+            "apply the replication requests of an epoch in cleanup, an "
+            "executor per partition.");
+DEFINE_string(async_replica, "",
+              "host:port of the async replica the epochs of group commit are "
+              "shipped to, empty to disable.");
+DEFINE_bool(async_replica_role, false,
+            "run as the async replica, listening on --async_replica.");
+DEFINE_int32(target_latency, 0,
+             "adjust group time toward this p99 commit latency in us, 0 to "
+             "disable.");
+DEFINE_int32(target_batch_size, 0,
+             "adjust group time toward this many commits per epoch, 0 to "
+             "disable.");
 DEFINE_bool(mvcc, false, "use mvcc storage for BOHM.");
 DEFINE_bool(bohm_local, false, "locality optimization for Bohm.");
 DEFINE_bool(bohm_single_spin, false, "spin optimization for Bohm.");
@@ -50,6 +292,13 @@ DEFINE_int32(ariaFB_lock_manager, 0,
              "# of lock manager in aria's fallback mode.");
 
 #define SETUP_CONTEXT(context)                                                 \
+  {                                                                            \
+    std::vector<google::CommandLineFlagInfo> flags;                            \
+    google::GetAllFlags(&flags);                                               \
+    for (auto &flag : flags) {                                                 \
+      context.flags.push_back({flag.name, flag.type, flag.current_value});     \
+    }                                                                          \
+  }                                                                            \
   boost::algorithm::split(context.peers, FLAGS_servers,                        \
                           boost::is_any_of(";"));                              \
   context.coordinator_num = context.peers.size();                              \
@@ -63,12 +312,26 @@ DEFINE_int32(ariaFB_lock_manager, 0,
   context.group_time = FLAGS_group_time;                                       \
   context.batch_flush = FLAGS_batch_flush;                                     \
   context.sleep_time = FLAGS_sleep_time;                                       \
+  context.deferred_retries = FLAGS_deferred_retries;                           \
+  context.retry_cache = FLAGS_retry_cache;                                     \
+  context.request_combining = FLAGS_request_combining;                         \
+  context.retry_backoff = FLAGS_retry_backoff;                                 \
+  context.conflict_routing = FLAGS_conflict_routing;                           \
   context.protocol = FLAGS_protocol;                                           \
   context.replica_group = FLAGS_replica_group;                                 \
   context.lock_manager = FLAGS_lock_manager;                                   \
   context.read_on_replica = FLAGS_read_on_replica;                             \
+  context.stale_reads = FLAGS_stale_reads;                                     \
+  context.hot_keys = FLAGS_hot_keys;                                           \
   context.local_validation = FLAGS_local_validation;                           \
+  context.delta_replication = FLAGS_delta_replication;                         \
+  context.operation_replication = FLAGS_operation_replication;                 \
+  context.lock_ordering = FLAGS_lock_ordering;                                 \
+  context.lock_spin = FLAGS_lock_spin;                                         \
+  context.wait_policy = FLAGS_wait_policy;                                     \
+  context.hot_tables = FLAGS_hot_tables;                                       \
   context.rts_sync = FLAGS_rts_sync;                                           \
+  context.rts_lease = FLAGS_rts_lease;                                         \
   context.star_sync_in_single_master_phase = FLAGS_star_sync;                  \
   context.star_dynamic_batch_size = FLAGS_star_dynamic_batch_size;             \
   context.parallel_locking_and_validation = FLAGS_plv;                         \
@@ -76,15 +339,109 @@ DEFINE_int32(ariaFB_lock_manager, 0,
   context.aria_read_only_optmization = FLAGS_aria_read_only;                   \
   context.aria_reordering_optmization = FLAGS_aria_reordering;                 \
   context.aria_snapshot_isolation = FLAGS_aria_si;                             \
+  context.work_stealing = FLAGS_work_stealing;                                 \
+  context.aria_partition_affinity = FLAGS_aria_partition_affinity;             \
+  context.aria_target_latency = FLAGS_aria_target_latency;                     \
+  context.aria_min_batch_size = FLAGS_aria_min_batch_size;                     \
+  context.aria_input_replication = FLAGS_aria_input_replication;               \
+  context.aria_generate_ahead = FLAGS_aria_generate_ahead;                     \
   context.delay_time = FLAGS_delay;                                            \
+  context.link_delays = FLAGS_link_delays;                                     \
+  context.jitter = FLAGS_jitter;                                               \
+  context.link_bandwidth = FLAGS_link_bandwidth;                               \
   context.log_path = FLAGS_log_path;                                           \
+  context.log_direct_io = FLAGS_log_direct_io;                                 \
+  context.command_log = FLAGS_command_log;                                     \
+  context.trace_path = FLAGS_trace_path;                                       \
+  context.trace_rate = FLAGS_trace_rate;                                       \
+  context.record_path = FLAGS_record_path;                                     \
+  context.replay_path = FLAGS_replay_path;                                     \
+  context.conflict_profile = FLAGS_conflict_profile;                           \
+  context.early_validation = FLAGS_early_validation;                           \
+  context.repair = FLAGS_repair;                                               \
+  context.adaptive_locking = FLAGS_adaptive_locking;                           \
+  context.thread_arenas = FLAGS_thread_arenas;                                 \
+  context.memory_report = FLAGS_memory_report;                                 \
+  context.anti_cache_path = FLAGS_anti_cache_path;                             \
+  context.anti_cache_tables = FLAGS_anti_cache_tables;                         \
+  context.anti_cache_seconds = FLAGS_anti_cache_seconds;                       \
+  context.pmem_path = FLAGS_pmem_path;                                         \
+  context.message_latency = FLAGS_message_latency;                             \
+  context.perf_counters = FLAGS_perf_counters;                                 \
+  context.timeline_path = FLAGS_timeline_path;                                 \
+  context.profile_path = FLAGS_profile_path;                                   \
+  context.profile_hz = FLAGS_profile_hz;                                       \
+  context.profile_on_signal = FLAGS_profile_on_signal;                         \
+  context.results_path = FLAGS_results_path;                                   \
+  context.phases = FLAGS_phases;                                               \
+  context.metrics_port = FLAGS_metrics_port;                                   \
+  context.ingress_port = FLAGS_ingress_port;                                   \
+  context.ingress_max_in_flight = FLAGS_ingress_max_in_flight;                 \
+  context.ingress_target_delay = FLAGS_ingress_target_delay;                   \
+  context.ingress_interval = FLAGS_ingress_interval;                           \
+  context.priorities = FLAGS_priorities;                                       \
+  context.priority_slo = FLAGS_priority_slo;                                   \
+  context.procedure = FLAGS_procedure;                                         \
+  context.image_path = FLAGS_image_path;                                       \
+  context.dump_image = FLAGS_dump_image;                                       \
+  context.recover = FLAGS_recover;                                             \
+  context.checkpoint_interval = FLAGS_checkpoint_interval;                     \
+  context.checkpoint_bandwidth = FLAGS_checkpoint_bandwidth;                   \
+  context.snapshot_interval = FLAGS_snapshot_interval;                         \
+  context.columnar_tables = FLAGS_columnar_tables;                             \
+  context.export_path = FLAGS_export_path;                                     \
+  context.export_tables = FLAGS_export_tables;                                 \
+  context.export_bandwidth = FLAGS_export_bandwidth;                           \
+  context.migrations = FLAGS_migrations;                                       \
+  context.migration_delay = FLAGS_migration_delay;                             \
+  context.migration_bandwidth = FLAGS_migration_bandwidth;                     \
+  context.rebuild_replicas = FLAGS_rebuild_replicas;                           \
   context.cdf_path = FLAGS_cdf_path;                                           \
+  context.duration = FLAGS_duration;                                           \
+  context.warmup = FLAGS_warmup;                                               \
+  context.cooldown = FLAGS_cooldown;                                           \
+  context.arrival_rate = FLAGS_arrival_rate;                                   \
+  context.dynamic_workers = FLAGS_dynamic_workers;                             \
+  context.min_workers = FLAGS_min_workers;                                     \
+  context.network_engine = FLAGS_network_engine;                               \
+  context.io_batch_messages = FLAGS_io_batch_messages;                         \
+  context.io_batch_bytes = FLAGS_io_batch_bytes;                               \
+  context.compress_messages = FLAGS_compress_messages;                         \
+  context.compress_threshold = FLAGS_compress_threshold;                       \
+  context.prefetch_distance = FLAGS_prefetch_distance;                         \
+  context.pack_messages = FLAGS_pack_messages;                                 \
+  context.zero_copy_receive = FLAGS_zero_copy_receive;                         \
+  context.flush_bytes = FLAGS_flush_bytes;                                     \
+  context.flush_age = FLAGS_flush_age;                                         \
+  context.async_credits = FLAGS_async_credits;                                 \
+  context.direct_connections = FLAGS_direct_connections;                       \
+  context.barrier = FLAGS_barrier;                                             \
+  context.barrier_fanout = FLAGS_barrier_fanout;                               \
+  context.clock_skew = FLAGS_clock_skew;                                       \
+  context.transport = FLAGS_transport;                                         \
+  context.rdma_gid_index = FLAGS_rdma_gid_index;                               \
+  context.shm_transport = FLAGS_shm_transport;                                 \
+  context.busy_poll = FLAGS_busy_poll;                                         \
   context.tcp_no_delay = FLAGS_tcp_no_delay;                                   \
   context.tcp_quick_ack = FLAGS_tcp_quick_ack;                                 \
+  context.socket_buffer = FLAGS_socket_buffer;                                 \
+  context.irq_affinity = FLAGS_irq_affinity;                                   \
   context.cpu_affinity = FLAGS_cpu_affinity;                                   \
   context.cpu_core_id = FLAGS_cpu_core_id;                                     \
+  context.numa = FLAGS_numa;                                                   \
+  context.partition_serial = FLAGS_partition_serial;                           \
   context.durable_write_cost = FLAGS_durable_write_cost;                       \
+  context.coroutine_num = FLAGS_coroutines;                                    \
   context.exact_group_commit = FLAGS_exact_group_commit;                       \
+  context.pipelined_epochs = FLAGS_pipelined_epochs;                           \
+  context.replica_quorum = FLAGS_replica_quorum;                               \
+  context.snapshot_reads = FLAGS_snapshot_reads;                               \
+  context.split_threshold = FLAGS_split_threshold;                             \
+  context.parallel_apply = FLAGS_parallel_apply;                               \
+  context.async_replica = FLAGS_async_replica;                                 \
+  context.async_replica_role = FLAGS_async_replica_role;                       \
+  context.target_latency = FLAGS_target_latency;                               \
+  context.target_batch_size = FLAGS_target_batch_size;                         \
   context.mvcc = FLAGS_mvcc;                                                   \
   context.bohm_local = FLAGS_bohm_local;                                       \
   context.bohm_single_spin = FLAGS_bohm_single_spin;                           \
@@ -93,4 +450,192 @@ DEFINE_int32(ariaFB_lock_manager, 0,
       << "bohm_single_spin must be used in single-node mode.";                 \
   CHECK((context.mvcc ^ (context.protocol == "Bohm")) == 0)                    \
       << "MVCC must be used in Bohm.";                                         \
-  context.set_star_partitioner();
+  CHECK(!context.dump_image || !context.image_path.empty())                    \
+      << "dumping the database images requires --image_path.";                 \
+  CHECK(context.warmup + context.cooldown < context.duration)                  \
+      << "warmup and cooldown must be shorter than the duration.";             \
+  CHECK(context.arrival_rate == 0 ||                                           \
+        (context.protocol != "Aria" && context.protocol != "AriaFB" &&         \
+         context.protocol != "Calvin" && context.protocol != "Star" &&         \
+         context.protocol != "Bohm"))                                          \
+      << context.protocol << " runs batches, it has no open-loop mode.";       \
+  CHECK(context.coroutine_num >= 1 && context.coroutine_num <= 256)            \
+      << "coroutines must be in [1, 256].";                                    \
+  CHECK(context.coroutine_num == 1 || context.protocol == "Silo" ||            \
+        context.protocol == "Scar" || context.protocol == "TwoPL")             \
+      << context.protocol << " does not interleave transactions.";             \
+  CHECK(!context.pipelined_epochs || context.protocol == "SiloGC" ||          \
+        context.protocol == "SiloSI" || context.protocol == "ScarGC" ||        \
+        context.protocol == "ScarSI")                                          \
+      << "pipelined epochs require a group commit protocol.";                  \
+  CHECK(context.replica_quorum == 0 ||                                         \
+        ((context.protocol == "SiloGC" || context.protocol == "SiloSI" ||      \
+          context.protocol == "ScarGC" || context.protocol == "ScarSI") &&     \
+         context.partitioner.compare(0, 4, "hash") == 0 &&                     \
+         !context.read_on_replica))                                            \
+      << "replica quorums require group commit on hash partitions, read "      \
+         "from the masters.";                                                  \
+  CHECK(!context.parallel_apply ||                                             \
+        ((context.protocol == "SiloGC" || context.protocol == "SiloSI" ||      \
+          context.protocol == "ScarGC" || context.protocol == "ScarSI") &&     \
+         !context.pipelined_epochs && !context.operation_replication &&        \
+         context.partitioner != "dynamic"))                                    \
+      << "parallel apply requires group commit without pipelined epochs, "     \
+         "operation replication or the dynamic partitioner.";                  \
+  CHECK(context.async_replica.empty() || context.async_replica_role ||         \
+        context.protocol == "SiloGC" || context.protocol == "SiloSI" ||        \
+        context.protocol == "ScarGC" || context.protocol == "ScarSI")          \
+      << "async replicas require a group commit protocol.";                    \
+  CHECK(!context.async_replica_role ||                                         \
+        (!context.async_replica.empty() && context.coordinator_num == 1 &&     \
+         !context.mvcc))                                                       \
+      << "the async replica listens on --async_replica and holds every "       \
+         "partition, --servers has its address only.";                         \
+  CHECK(!context.delta_replication || context.protocol == "Silo")              \
+      << "delta replication requires synchronous replication (Silo).";         \
+  CHECK(context.hot_keys == 0 || context.protocol == "Silo")                   \
+      << "hot keys are read locally and validated remotely (Silo).";           \
+  CHECK(!context.operation_replication || context.protocol == "Silo" ||        \
+        context.protocol == "SiloGC" || context.protocol == "Scar" ||          \
+        context.protocol == "ScarGC")                                          \
+      << context.protocol << " does not replicate operations.";                \
+  CHECK(context.partitioner != "dynamic" ||                                    \
+        ((context.protocol == "SiloGC" || context.protocol == "SiloSI" ||      \
+          context.protocol == "ScarGC" || context.protocol == "ScarSI") &&     \
+         !context.pipelined_epochs && !context.read_on_replica))               \
+      << "partitions move at the epoch boundaries of group commit.";           \
+  CHECK(context.snapshot_interval == 0 || context.supports_snapshots())        \
+      << "snapshot queries require SiloSI or ScarSI without pipelined "        \
+         "epochs or the dynamic partitioner.";                                 \
+  CHECK(context.columnar_tables.empty() || context.snapshot_interval > 0)      \
+      << "columnar snapshots require --snapshot_interval.";                    \
+  CHECK(context.export_path.empty() || context.snapshot_interval > 0)          \
+      << "table exports require --snapshot_interval.";                         \
+  CHECK(context.deferred_retries == 0 || context.protocol == "SiloGC" ||       \
+        context.protocol == "SiloSI" || context.protocol == "ScarGC" ||        \
+        context.protocol == "ScarSI")                                          \
+      << "deferred retries require a group commit protocol.";                  \
+  CHECK(!context.retry_cache || context.protocol == "SiloGC")                  \
+      << "the retry cache requires SiloGC.";                                   \
+  CHECK(!context.request_combining ||                                          \
+        (context.protocol == "Silo" && context.coroutine_num > 1))             \
+      << "request combining requires Silo and --coroutines.";                  \
+  CHECK(!context.dynamic_workers ||                                            \
+        (context.group_commit() && !context.pipelined_epochs &&                \
+         context.barrier != "clock" && !context.numa &&                        \
+         (context.arrival_rate > 0 || context.ingress_port > 0) &&             \
+         context.min_workers >= 1 &&                                           \
+         context.min_workers <= context.worker_num))                           \
+      << "dynamic workers follow the load of open loop or client "             \
+         "transactions of group commit, without pipelined or clock epochs "    \
+         "or --numa.";                                                         \
+  CHECK(context.profile_path.empty() || context.profile_hz > 0)                \
+      << "profiling requires a positive --profile_hz.";                        \
+  CHECK(context.ingress_target_delay == 0 ||                                   \
+        (context.ingress_port > 0 && context.ingress_interval > 0))            \
+      << "admission control requires --ingress_port and an interval.";         \
+  CHECK(context.ingress_port == 0 ||                                           \
+        ((context.protocol == "SiloGC" || context.protocol == "SiloSI" ||      \
+          context.protocol == "ScarGC" || context.protocol == "ScarSI") &&     \
+         context.deferred_retries == 0))                                       \
+      << "client transactions require a group commit protocol and no "         \
+         "deferred retries.";                                                  \
+  CHECK(context.record_path.empty() || context.replay_path.empty())            \
+      << "a run records or replays its transactions.";                         \
+  CHECK(!context.command_log ||                                                \
+        ((context.protocol == "Aria" || context.protocol == "Calvin" ||        \
+          context.protocol == "Bohm") &&                                       \
+         !context.log_path.empty() && context.replay_path.empty() &&           \
+         context.aria_target_latency == 0))                                    \
+      << "command logging requires a deterministic protocol, --log_path, "     \
+         "fixed batches and no replayed transactions.";                        \
+  CHECK(!context.aria_input_replication ||                                     \
+        (context.protocol == "Aria" && !context.work_stealing &&               \
+         context.aria_target_latency == 0 && context.replay_path.empty()))     \
+      << "input replication requires Aria, no work stealing, fixed batches "   \
+         "and no replayed transactions.";                                      \
+  CHECK(!context.aria_generate_ahead ||                                        \
+        (context.protocol == "Aria" && !context.work_stealing &&               \
+         context.aria_target_latency == 0 &&                                   \
+         !context.aria_input_replication && !context.command_log))             \
+      << "generating aria batches ahead requires Aria, no work stealing, "     \
+         "fixed batches, no input replication and no command log.";            \
+  CHECK((context.record_path.empty() && context.replay_path.empty()) ||        \
+        (context.protocol != "Calvin" && context.protocol != "Bohm" &&         \
+         context.protocol != "Star"))                                          \
+      << "Calvin and Bohm generate the same batches with --same_batch, "       \
+         "and Star draws its partitions per phase.";                           \
+  CHECK(context.conflict_routing <= 100 &&                                     \
+        (context.conflict_routing == 0 || context.partitioner != "dynamic"))   \
+      << "conflict routing is a percentage, on static partitions.";            \
+  CHECK(!context.partition_serial ||                                           \
+        (context.protocol == "Silo" && context.partitioner != "dynamic"))      \
+      << "partition serial execution requires Silo and static partitions.";    \
+  CHECK(context.partitioner.compare(0, 9, "affinity:") != 0 ||                 \
+        context.protocol == "Silo" || context.protocol == "SiloGC" ||          \
+        context.protocol == "SiloSI" || context.protocol == "Scar" ||          \
+        context.protocol == "ScarGC" || context.protocol == "ScarSI" ||        \
+        context.protocol == "TwoPL")                                           \
+      << context.protocol << " places the partitions itself.";                 \
+  CHECK(context.phases.find("cross") == std::string::npos ||                   \
+        context.protocol != "Star")                                            \
+      << "Star sets the cross partition ratio of its phases itself.";          \
+  CHECK(context.anti_cache_path.empty() ||                                     \
+        (context.protocol == "Silo" && !context.mvcc &&                        \
+         !context.partition_serial && context.partitioner != "dynamic"))       \
+      << "evicted rows are locked with the lock bit of Silo, in place.";       \
+  CHECK(context.anti_cache_path.empty() || context.anti_cache_seconds > 0)     \
+      << "rows are evicted after at least one second.";                        \
+  CHECK(context.pmem_path.empty() ||                                           \
+        (!context.mvcc && context.anti_cache_path.empty() &&                   \
+         !context.recover && context.image_path.empty()))                      \
+      << "persistent tables are single version tables in memory, and they "    \
+         "restart from their own files.";                                      \
+  CHECK(context.barrier != "tree" ||                                           \
+        (context.barrier_fanout > 0 && context.group_commit() &&               \
+         context.partitioner != "dynamic" && context.replica_quorum == 0))     \
+      << "the tree barrier synchronizes the epochs of group commit, without "  \
+         "migrations or replica quorums.";                                     \
+  CHECK(context.barrier != "clock" ||                                          \
+        (context.pipelined_epochs && context.partitioner != "dynamic" &&       \
+         context.replica_quorum == 0 && context.target_latency == 0))          \
+      << "clock epochs pipeline the groups of group commit, without "          \
+         "migrations, replica quorums or a target latency.";                   \
+  CHECK(!context.snapshot_reads ||                                             \
+        (context.protocol == "SiloGC" && !context.pipelined_epochs &&          \
+         !context.read_on_replica))                                            \
+      << "snapshot reads see the last epoch of SiloGC on the masters, once "   \
+         "it is done on all coordinators.";                                    \
+  CHECK(context.split_threshold == 0 || context.protocol == "SiloGC")          \
+      << "the slices of hot rows are merged at the end of a group of SiloGC."; \
+  CHECK(context.early_validation == 0 || context.protocol == "Silo" ||         \
+        context.protocol == "Scar")                                            \
+      << "only Silo and Scar validate reads during execution.";                \
+  CHECK(!context.repair ||                                                     \
+        (context.protocol == "Silo" && !context.operation_replication))        \
+      << "Silo repairs the rows it locks, operations are encoded during "      \
+         "execution.";                                                         \
+  CHECK(!context.adaptive_locking || context.protocol == "Silo")               \
+      << "only Silo locks hot rows during execution.";                         \
+  CHECK(context.rts_lease == 0 || context.protocol == "Scar")                  \
+      << "only Scar leases read timestamps.";                                  \
+  CHECK(context.flush_bytes == 0 || context.flush_age > 0)                     \
+      << "an async message is buffered for a while with --flush_bytes.";       \
+  CHECK(context.rebuild_replicas.empty() ||                                    \
+        ((context.protocol == "Silo" || context.protocol == "SiloGC" ||        \
+          context.protocol == "Scar" || context.protocol == "ScarGC") &&       \
+         context.hash_placement() && !context.read_on_replica &&               \
+         !context.delta_replication && !context.operation_replication &&       \
+         !context.recover))                                                    \
+      << "a rebuilt replica is only written by the replication of Silo or "    \
+         "Scar until it is streamed.";                                         \
+  CHECK(context.priorities.empty() || context.group_commit())                  \
+      << "priority classes are scheduled by the executors of group commit.";   \
+  CHECK(!context.stale_reads ||                                                \
+        ((context.protocol == "Silo" || context.protocol == "SiloGC" ||        \
+          context.protocol == "Scar" || context.protocol == "ScarGC") &&       \
+         context.barrier != "clock"))                                          \
+      << "stale reads follow the epochs of group commit of Silo or Scar, "     \
+         "without clock epochs.";                                              \
+  context.set_star_partitioner();                                              \
+  context.set_calvin_partitioner();
@@ -4,10 +4,14 @@
 
 #pragma once
 
+#include "common/Futex.h"
+#include "common/Probes.h"
+#include "core/BarrierTree.h"
 #include "core/Context.h"
 #include "core/ControlMessage.h"
 #include "core/Defs.h"
-#include "core/Delay.h"
+#include "core/PartitionMap.h"
+#include "core/Timeline.h"
 #include "core/Worker.h"
 
 #include <thread>
@@ -18,22 +22,40 @@ class Manager : public Worker {
 public:
   Manager(std::size_t coordinator_id, std::size_t id, const Context &context,
           std::atomic<bool> &stopFlag)
-      : Worker(coordinator_id, id), context(context), stopFlag(stopFlag),
-        delay(std::make_unique<SameDelay>(
-            coordinator_id, context.coordinator_num, context.delay_time)) {
+      : Worker(coordinator_id, id), context(context), stopFlag(stopFlag) {
+
+    if (context.partitioner == "dynamic") {
+      partition_map =
+          &PartitionMap::of(coordinator_id, context.coordinator_num);
+    }
 
     for (auto i = 0u; i < context.coordinator_num; i++) {
       messages.emplace_back(std::make_unique<Message>());
       init_message(messages[i].get(), i);
     }
 
+    if (context.barrier == "tree") {
+      tree = std::make_unique<BarrierTree>(
+          coordinator_id, context.coordinator_num, context.barrier_fanout);
+      downstream = tree->children();
+      upstream = tree->parent();
+      LOG_IF(INFO, coordinator_id == 0)
+          << "Managers synchronize on a barrier tree of height "
+          << BarrierTree::height(context.coordinator_num,
+                                 context.barrier_fanout)
+          << ".";
+    } else if (coordinator_id == 0) {
+      for (auto i = 1u; i < context.coordinator_num; i++) {
+        downstream.push_back(i);
+      }
+    }
+
     worker_status.store(static_cast<uint32_t>(ExecutorStatus::STOP));
   }
 
   virtual void coordinator_start() {
 
     std::size_t n_workers = context.worker_num;
-    std::size_t n_coordinators = context.coordinator_num;
 
     n_started_workers.store(0);
     n_completed_workers.store(0);
@@ -47,8 +69,7 @@ public:
 
     set_worker_status(ExecutorStatus::STOP);
     wait_all_workers_finish();
-    broadcast_stop();
-    wait4_stop(n_coordinators - 1);
+    stop_barrier();
     // process replication
     n_completed_workers.store(0);
     set_worker_status(ExecutorStatus::CLEANUP);
@@ -59,7 +80,6 @@ public:
   virtual void non_coordinator_start() {
 
     std::size_t n_workers = context.worker_num;
-    std::size_t n_coordinators = context.coordinator_num;
 
     ExecutorStatus status = wait4_signal();
     DCHECK(status == ExecutorStatus::START);
@@ -67,11 +87,10 @@ public:
     n_started_workers.store(0);
     set_worker_status(ExecutorStatus::START);
     wait_all_workers_start();
-    wait4_stop(1);
+    wait4_stop_trigger();
     set_worker_status(ExecutorStatus::STOP);
     wait_all_workers_finish();
-    broadcast_stop();
-    wait4_stop(n_coordinators - 2);
+    stop_barrier();
     // process replication
     n_completed_workers.store(0);
     set_worker_status(ExecutorStatus::CLEANUP);
@@ -80,25 +99,33 @@ public:
   }
 
   void wait_all_workers_finish() {
+    TimelineSpan span("wait_all_workers_finish");
     std::size_t n_workers = context.worker_num;
     // wait for all workers to finish
-    while (n_completed_workers.load() < n_workers) {
-      // change to nop_pause()?
-      std::this_thread::yield();
-    }
+    Futex::wait_until(n_completed_workers,
+                      [n_workers](uint32_t n) { return n >= n_workers; });
   }
 
   void wait_all_workers_start() {
+    TimelineSpan span("wait_all_workers_start");
     std::size_t n_workers = context.worker_num;
-    // wait for all workers to finish
-    while (n_started_workers.load() < n_workers) {
-      // change to nop_pause()?
-      std::this_thread::yield();
-    }
+    // wait for all workers to start
+    Futex::wait_until(n_started_workers,
+                      [n_workers](uint32_t n) { return n >= n_workers; });
   }
 
   void set_worker_status(ExecutorStatus status) {
-    worker_status.store(static_cast<uint32_t>(status));
+    if (Timeline::enabled()) {
+      // the span of the previous status ends
+      auto now = Timeline::now();
+      if (status_begin != 0) {
+        Timeline::record(executor_status_name(last_status), status_begin, now);
+      }
+      last_status = status;
+      status_begin = now;
+    }
+    COCO_PROBE2(executor_status, coordinator_id, static_cast<uint32_t>(status));
+    Futex::store_and_wake(worker_status, static_cast<uint32_t>(status));
   }
 
   void signal_worker(ExecutorStatus status) {
@@ -107,11 +134,8 @@ public:
     DCHECK(coordinator_id == 0);
     set_worker_status(status);
 
-    // signal to everyone
-    for (auto i = 0u; i < context.coordinator_num; i++) {
-      if (i == coordinator_id) {
-        continue;
-      }
+    // signal to everyone, or to the children in the barrier tree
+    for (auto i : downstream) {
       ControlMessageFactory::new_signal_message(*messages[i],
                                                 static_cast<uint32_t>(status));
     }
@@ -122,6 +146,7 @@ public:
     // only non-coordinator calls this function
     DCHECK(coordinator_id != 0);
 
+    TimelineSpan span("wait4_signal");
     signal_in_queue.wait_till_non_empty();
 
     std::unique_ptr<Message> message(signal_in_queue.front());
@@ -139,12 +164,19 @@ public:
     Decoder dec(stringPiece);
     dec >> status;
 
+    // the subtree of this coordinator in the barrier tree
+    for (auto i : downstream) {
+      ControlMessageFactory::new_signal_message(*messages[i], status);
+    }
+    flush_messages();
+
     return static_cast<ExecutorStatus>(status);
   }
 
   void wait4_stop(std::size_t n) {
 
     // wait for n stop messages
+    TimelineSpan span("wait4_stop");
 
     for (auto i = 0u; i < n; i++) {
 
@@ -159,19 +191,24 @@ public:
       MessagePiece messagePiece = *(message->begin());
       auto type = static_cast<ControlMessage>(messagePiece.get_message_type());
       CHECK(type == ControlMessage::STOP);
+      PartitionMap::decode(messagePiece.toStringPiece(), migration_events);
     }
   }
 
+  // the coordinator waits for the acks of all, or of its children in the
+  // barrier tree
   void wait4_ack() {
 
-    std::chrono::steady_clock::time_point start;
-
     // only coordinator waits for ack
     DCHECK(coordinator_id == 0);
+    TimelineSpan span("wait4_ack");
 
-    std::size_t n_coordinators = context.coordinator_num;
+    receive_acks(downstream.size());
+  }
 
-    for (auto i = 0u; i < n_coordinators - 1; i++) {
+  void receive_acks(std::size_t n) {
+
+    for (auto i = 0u; i < n; i++) {
 
       ack_in_queue.wait_till_non_empty();
 
@@ -196,30 +233,90 @@ public:
     flush_messages();
   }
 
+  // on a non-coordinator, the stop of the coordinator, or of the parent in
+  // the barrier tree, which is forwarded to the children
+  void wait4_stop_trigger() {
+    wait4_stop(1);
+    for (auto i : downstream) {
+      send_stop(i);
+    }
+  }
+
+  // called once the workers are stopped, returns once all coordinators are.
+  // A stop goes from each coordinator to all others, or up and down the
+  // barrier tree, see BarrierTree.
+  void stop_barrier() {
+    std::size_t n_coordinators = context.coordinator_num;
+
+    if (tree == nullptr) {
+      broadcast_stop();
+      wait4_stop(coordinator_id == 0 ? n_coordinators - 1
+                                     : n_coordinators - 2);
+      return;
+    }
+
+    DCHECK(partition_map == nullptr);
+    if (tree->is_root()) {
+      for (auto i : downstream) {
+        send_stop(i);
+      }
+    }
+    wait4_stop(downstream.size());
+    if (!tree->is_root()) {
+      send_stop(upstream);
+      wait4_stop(1);
+    }
+    for (auto i : downstream) {
+      send_stop(i);
+    }
+  }
+
+  // the migration events announced on this node go out with the stop
   void broadcast_stop() {
 
     std::size_t n_coordinators = context.coordinator_num;
+    std::string events;
+
+    if (partition_map != nullptr) {
+      auto announced = partition_map->take_announced();
+      PartitionMap::encode(events, announced);
+      migration_events.insert(migration_events.end(), announced.begin(),
+                              announced.end());
+    }
 
     for (auto i = 0u; i < n_coordinators; i++) {
       if (i == coordinator_id)
         continue;
-      ControlMessageFactory::new_stop_message(*messages[i]);
+      ControlMessageFactory::new_stop_message(*messages[i], events);
     }
 
     flush_messages();
   }
 
-  void send_ack() {
+  // called once the epoch is cleaned up, before the next one starts, so that
+  // all coordinators switch the partitions at the same point
+  void apply_migration_events() {
+    if (partition_map != nullptr) {
+      partition_map->apply(migration_events);
+    }
+    migration_events.clear();
+  }
+
+  // in the barrier tree, once the children have sent theirs
+  void send_ack(uint64_t epoch = 0) {
 
     // only non-coordinator calls this function
     DCHECK(coordinator_id != 0);
 
-    ControlMessageFactory::new_ack_message(*messages[0]);
+    receive_acks(downstream.size());
+    ControlMessageFactory::new_ack_message(*messages[upstream], epoch);
     flush_messages();
   }
 
   void start() override {
 
+    Timeline::set_thread_name(coordinator_id, "manager");
+
     if (coordinator_id == 0) {
       LOG(INFO) << "Manager(worker id = " << id
                 << ") on the coordinator node started.";
@@ -265,21 +362,16 @@ public:
     }
   }
 
-  Message *pop_message() override {
+  // the control messages go in the async lane, so that they do not overtake
+  // the replication flushed by the workers before them
+  Message *pop_message() override { return nullptr; }
+
+  Message *pop_async_message() override {
     if (out_queue.empty())
       return nullptr;
 
     Message *message = out_queue.front();
 
-    if (delay->delay_enabled()) {
-      auto now = std::chrono::steady_clock::now();
-      if (std::chrono::duration_cast<std::chrono::microseconds>(now -
-                                                                message->time)
-              .count() < delay->message_delay()) {
-        return nullptr;
-      }
-    }
-
     bool ok = out_queue.pop();
     CHECK(ok);
 
@@ -301,7 +393,7 @@ protected:
       auto message = messages[i].release();
 
       out_queue.push(message);
-      messages[i] = std::make_unique<Message>();
+      messages[i].reset(outgoing_message_pool.get());
       init_message(messages[i].get(), i);
     }
   }
@@ -318,13 +410,23 @@ protected:
   LockfreeQueue<Message *> ack_in_queue, vector_in_queue, signal_in_queue,
       stop_in_queue, out_queue;
   std::vector<std::unique_ptr<Message>> messages;
+  // with the dynamic partitioner, the events of the current epoch
+  PartitionMap *partition_map = nullptr;
+  std::vector<MigrationEvent> migration_events;
+  // with --barrier=tree, the tree of the coordinators. The signals, the stops
+  // and the releases go downstream, the acks upstream, see BarrierTree.
+  std::unique_ptr<BarrierTree> tree;
+  std::vector<std::size_t> downstream;
+  std::size_t upstream = 0;
+  // with --timeline_path, the status set last and when, see Timeline
+  ExecutorStatus last_status = ExecutorStatus::STOP;
+  uint64_t status_begin = 0;
 
 public:
   std::atomic<uint32_t> worker_status;
   std::atomic<uint32_t> n_completed_workers;
   std::atomic<uint32_t> n_started_workers;
 
-  std::unique_ptr<Delay> delay;
 };
 
 } // namespace coco
@@ -0,0 +1,115 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Table.h"
+#include "core/ThreadArenas.h"
+
+#include <cstddef>
+#include <glog/logging.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef COCO_HAS_JEMALLOC
+#include <cstdint>
+#include <jemalloc/jemalloc.h>
+#endif
+
+namespace coco {
+
+/*
+ * MemoryReport logs the memory of the tables on a node by table id, once the
+ * tables are loaded and every --memory_report seconds of the run. A table is
+ * its rows, versions, its payload, i.e., the keys and the values, and the
+ * overhead on top of it, see ITable::memory_usage.
+ *
+ * Built with jemalloc, it also logs the bytes the allocator hands out and
+ * maps, and the bytes allocated, active and retained in each of its arenas,
+ * see ThreadArenas.
+ */
+
+class MemoryReport {
+public:
+  // table id -> the memory of its partitions in tables
+  static std::map<std::size_t, std::pair<std::size_t, TableMemory>>
+  collect(const std::vector<ITable *> &tables) {
+    std::map<std::size_t, std::pair<std::size_t, TableMemory>> memory;
+    for (auto table : tables) {
+      auto &m = memory[table->tableID()];
+      m.first++;
+      m.second.merge(table->memory_usage());
+    }
+    return memory;
+  }
+
+  static void log(const std::vector<ITable *> &tables) {
+    std::size_t huge_pages = 0;
+    TableMemory total;
+    for (auto table : tables) {
+      huge_pages += table->huge_page_size();
+    }
+    for (auto &kv : collect(tables)) {
+      auto &m = kv.second.second;
+      if (m.total() == 0) {
+        continue;
+      }
+      total.merge(m);
+      LOG(INFO) << "table " << kv.first << " uses " << mb(m.total())
+                << " MB in " << kv.second.first << " partitions, "
+                << m.rows << " rows, " << m.versions << " versions, "
+                << mb(m.payload) << " MB payload, " << mb(m.overhead)
+                << " MB overhead ("
+                << (m.rows > 0 ? 1.0 * m.overhead / m.rows : 0)
+                << " bytes per row).";
+    }
+    LOG(INFO) << "tables use " << mb(total.total()) << " MB, "
+              << mb(huge_pages) << " MB on explicit huge pages.";
+    log_allocator();
+  }
+
+private:
+  static double mb(std::size_t bytes) { return bytes / 1048576.0; }
+
+#ifdef COCO_HAS_JEMALLOC
+  template <class T> static T read(const std::string &name) {
+    T value = 0;
+    std::size_t size = sizeof(value);
+    return mallctl(name.c_str(), &value, &size, nullptr, 0) == 0 ? value : 0;
+  }
+
+  static void log_allocator() {
+    // the statistics are cached until the epoch is advanced
+    uint64_t epoch = 1;
+    std::size_t size = sizeof(epoch);
+    mallctl("epoch", &epoch, &size, &epoch, size);
+    LOG(INFO) << "jemalloc allocated "
+              << mb(read<std::size_t>("stats.allocated")) << " MB, active "
+              << mb(read<std::size_t>("stats.active")) << " MB, resident "
+              << mb(read<std::size_t>("stats.resident")) << " MB, mapped "
+              << mb(read<std::size_t>("stats.mapped")) << " MB.";
+    auto narenas = read<unsigned>("arenas.narenas");
+    auto page = read<std::size_t>("arenas.page");
+    for (auto i = 0u; i < narenas; i++) {
+      auto prefix = "stats.arenas." + std::to_string(i);
+      auto small = read<std::size_t>(prefix + ".small.allocated");
+      auto large = read<std::size_t>(prefix + ".large.allocated");
+      auto name = ThreadArenas::name(i);
+      if (small + large > 0 || !name.empty()) {
+        LOG(INFO) << "jemalloc arena " << i
+                  << (name.empty() ? "" : " (" + name + ")") << " allocated "
+                  << mb(small) << " MB small, " << mb(large)
+                  << " MB large, active "
+                  << mb(read<std::size_t>(prefix + ".pactive") * page)
+                  << " MB, retained "
+                  << mb(read<std::size_t>(prefix + ".retained")) << " MB.";
+      }
+    }
+  }
+#else
+  static void log_allocator() {}
+#endif
+};
+} // namespace coco
@@ -0,0 +1,160 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/Message.h"
+#include "common/MessagePiece.h"
+#include "core/Table.h"
+
+#include <cstdint>
+#include <functional>
+#include <glog/logging.h>
+#include <vector>
+
+namespace coco {
+
+/*
+ * MessageDispatch calls the message handler of a piece by its message type.
+ *
+ * The handlers of a protocol are static functions, kept as std::function so
+ * that the extension points, e.g., OperationReplication or HotKeys, replace
+ * them with closures. Once an executor has its handlers, bind resolves every
+ * handler that holds a function to the function pointer, so that a piece
+ * costs a direct call through a flat table rather than the type-erased call
+ * of std::function. Only the handlers replaced by closures are called through
+ * std::function.
+ *
+ * The pieces of a message mostly go to the same table, e.g., the replication
+ * requests of a batch, so the table of a piece is looked up only when it is
+ * not the table of the piece before, see table.
+ *
+ * A handler mostly misses in cache on the row of its piece. With
+ * --prefetch_distance, the pieces of a message are handled as a software
+ * pipeline: before a piece is handled, the bucket of the row of the piece
+ * distance pieces ahead is prefetched, its slot two thirds as far ahead and
+ * its row a third as far ahead, see OpenHashMap::prefetch, so that a handler
+ * finds its row in cache. Only the types a protocol keys, i.e., whose pieces
+ * start with a key of their table, see prefetch_keys, are prefetched.
+ *
+ * Arg is the last argument of a handler, i.e., the transaction of the
+ * executor, or the transactions of a batch.
+ */
+
+template <class Arg> class MessageDispatch {
+public:
+  using FunctionType = void (*)(MessagePiece, Message &, ITable &, Arg);
+  using HandlerType =
+      std::function<void(MessagePiece, Message &, ITable &, Arg)>;
+
+  bool is_bound() const { return handlers != nullptr; }
+
+  // called once the handlers are final, handlers must outlive the dispatch
+  void bind(const std::vector<HandlerType> &handlers) {
+    this->handlers = &handlers;
+    functions.assign(handlers.size(), nullptr);
+    for (auto i = 0u; i < handlers.size(); i++) {
+      auto function = handlers[i].template target<FunctionType>();
+      if (function != nullptr) {
+        functions[i] = *function;
+      }
+    }
+  }
+
+  void operator()(uint32_t type, MessagePiece piece, Message &message,
+                  ITable &table, Arg arg) const {
+    DCHECK(type < functions.size());
+    FunctionType function = functions[type];
+    if (function != nullptr) {
+      function(piece, message, table, arg);
+    } else {
+      (*handlers)[type](piece, message, table, arg);
+    }
+  }
+
+  // the pieces of types start with a key of their table, and are prefetched
+  // distance pieces ahead, 0 to disable
+  void prefetch_keys(const std::vector<uint32_t> &types, std::size_t distance) {
+    this->distance = distance;
+    for (auto type : types) {
+      if (type >= keyed.size()) {
+        keyed.resize(type + 1, false);
+      }
+      keyed[type] = true;
+    }
+  }
+
+  // called before the pieces of message are handled
+  template <class Database> void begin(Database &db, Message &message) {
+    if (distance == 0) {
+      return;
+    }
+    end = message.end();
+    for (auto level = 0u; level < PREFETCH_LEVELS; level++) {
+      ahead[level] = message.begin();
+      auto n = distance - distance * level / PREFETCH_LEVELS;
+      for (auto i = 0u; i < n && ahead[level] != end; i++, ++ahead[level]) {
+        if (level == 0) {
+          prefetch(db, *ahead[level], level);
+        }
+      }
+    }
+  }
+
+  // called before each piece of the message is handled
+  template <class Database> void next(Database &db) {
+    if (distance == 0) {
+      return;
+    }
+    for (auto level = 0u; level < PREFETCH_LEVELS; level++) {
+      if (ahead[level] != end) {
+        prefetch(db, *ahead[level], level);
+        ++ahead[level];
+      }
+    }
+  }
+
+  // the table of piece, the same as db.find_table
+  template <class Database>
+  ITable *table(Database &db, const MessagePiece &piece) {
+    auto table_id = piece.get_table_id();
+    auto partition_id = piece.get_partition_id();
+    if (last_table == nullptr || table_id != last_table_id ||
+        partition_id != last_partition_id) {
+      last_table = db.find_table(table_id, partition_id);
+      last_table_id = table_id;
+      last_partition_id = partition_id;
+    }
+    return last_table;
+  }
+
+private:
+  template <class Database>
+  void prefetch(Database &db, MessagePiece &piece, std::size_t level) {
+    auto type = piece.get_message_type();
+    if (type >= keyed.size() || !keyed[type]) {
+      return;
+    }
+    ITable *table =
+        db.find_table(piece.get_table_id(), piece.get_partition_id());
+    auto stringPiece = piece.toStringPiece();
+    if (stringPiece.size() >= table->key_size()) {
+      table->prefetch(stringPiece.data(), level);
+    }
+  }
+
+  static constexpr std::size_t PREFETCH_LEVELS = 3;
+
+  const std::vector<HandlerType> *handlers = nullptr;
+  std::vector<FunctionType> functions;
+  ITable *last_table = nullptr;
+  uint64_t last_table_id = 0, last_partition_id = 0;
+  std::vector<bool> keyed;
+  std::size_t distance = 0;
+  Message::Iterator ahead[PREFETCH_LEVELS] = {{nullptr, nullptr},
+                                              {nullptr, nullptr},
+                                              {nullptr, nullptr}};
+  Message::Iterator end{nullptr, nullptr};
+};
+} // namespace coco
@@ -0,0 +1,141 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Histogram.h"
+#include "common/SpinLock.h"
+#include "common/Time.h"
+
+#include <chrono>
+#include <cstdint>
+#include <glog/logging.h>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --message_latency, an executor keeps three histograms per message
+ * type, in nanoseconds:
+ *
+ *  queue: from the message being received, i.e., pushed to the worker by the
+ *         incoming dispatcher, to its handler being called.
+ *  handle: the time the handler runs.
+ *  round trip: from the transaction flushing its requests to the handler of a
+ *         response returning, for the handlers that decrement the pending
+ *         responses of the transaction, e.g., the lock, read validation and
+ *         search responses.
+ *
+ * The coordinator merges the histograms of its workers and logs them every
+ * second, so that commit latency can be told apart into the network, the
+ * queues and the handlers at the remote nodes.
+ */
+
+class MessageStatistics {
+public:
+  using TimePoint = Clock::time_point;
+
+  struct Histograms {
+    Histogram queue, handle, round_trip;
+  };
+
+  MessageStatistics(std::size_t n_types, std::size_t n_coroutines)
+      : histograms(n_types), flush_times(n_coroutines) {}
+
+  // called by the worker once the transaction of a coroutine flushes requests
+  void on_flush(std::size_t coroutine_id) {
+    DCHECK(coroutine_id < flush_times.size());
+    flush_times[coroutine_id] = Clock::now();
+  }
+
+  // times handler(), which handles a piece of a message received at
+  // received, pending_responses is nullptr if the coroutine has no
+  // transaction yet
+  template <class Func>
+  void handle(uint32_t type, std::size_t coroutine_id, TimePoint received,
+              const std::size_t *pending_responses, Func handler) {
+    auto pending = pending_responses ? *pending_responses : 0;
+    auto start = Clock::now();
+    handler();
+    auto end = Clock::now();
+
+    DCHECK(type < histograms.size());
+    std::lock_guard<SpinLock> guard(lock);
+    auto &h = of(type);
+    h.queue.add(nanoseconds(start - received));
+    h.handle.add(nanoseconds(end - start));
+    if (pending_responses && *pending_responses < pending) {
+      DCHECK(coroutine_id < flush_times.size());
+      h.round_trip.add(nanoseconds(end - flush_times[coroutine_id]));
+    }
+  }
+
+  // called by the coordinator, moves the histograms recorded so far into s
+  void collect(MessageStatistics &s) {
+    std::lock_guard<SpinLock> guard(lock);
+    if (s.histograms.size() < histograms.size()) {
+      s.histograms.resize(histograms.size());
+    }
+    for (auto i = 0u; i < histograms.size(); i++) {
+      if (histograms[i] == nullptr) {
+        continue;
+      }
+      auto &h = s.of(i);
+      h.queue.merge(histograms[i]->queue);
+      h.handle.merge(histograms[i]->handle);
+      h.round_trip.merge(histograms[i]->round_trip);
+      histograms[i]->queue.clear();
+      histograms[i]->handle.clear();
+      histograms[i]->round_trip.clear();
+    }
+  }
+
+  // nullptr if no message of the type is handled
+  const Histograms *find(uint32_t type) const {
+    return type < histograms.size() ? histograms[type].get() : nullptr;
+  }
+
+  void log() const {
+    for (auto i = 0u; i < histograms.size(); i++) {
+      auto h = histograms[i].get();
+      if (h == nullptr || h->handle.size() == 0) {
+        continue;
+      }
+      std::ostringstream round_trip;
+      if (h->round_trip.size() > 0) {
+        round_trip << ", round trip: " << us(h->round_trip, 50) << " us (50%) "
+                   << us(h->round_trip, 99) << " us (99%)";
+      }
+      LOG(INFO) << "message type: " << i << " count: " << h->handle.size()
+                << ", queue: " << us(h->queue, 50) << " us (50%) "
+                << us(h->queue, 99) << " us (99%), handle: "
+                << us(h->handle, 50) << " us (50%) " << us(h->handle, 99)
+                << " us (99%)" << round_trip.str();
+    }
+  }
+
+private:
+  // the histograms of a type are allocated once a message of it is handled
+  Histograms &of(std::size_t type) {
+    if (histograms[type] == nullptr) {
+      histograms[type] = std::make_unique<Histograms>();
+    }
+    return *histograms[type];
+  }
+
+  static int64_t nanoseconds(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+  }
+
+  static double us(const Histogram &h, double n) { return h.nth(n) / 1000.0; }
+
+private:
+  SpinLock lock;
+  std::vector<std::unique_ptr<Histograms>> histograms;
+  std::vector<TimePoint> flush_times;
+};
+} // namespace coco
@@ -0,0 +1,271 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Statistics.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <glog/logging.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <unistd.h>
+
+namespace coco {
+
+/*
+ * With --metrics_port, coordinator i serves its metrics in the Prometheus text
+ * format at http://<host>:<metrics_port + i>/metrics. The coordinator renders
+ * the text once a second from the statistics it collects from its workers
+ * anyway, so a scrape only copies a string under a mutex and never reaches
+ * the workers. The counters are totals since the coordinator started,
+ * including the warmup and the cooldown, and the commit latency is a
+ * cumulative histogram in microseconds.
+ */
+
+class MetricsServer {
+public:
+  // port 0 picks a free port, see get_port()
+  MetricsServer(std::size_t coordinator_id, int port)
+      : coordinator_id(coordinator_id), stopFlag(false) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(fd >= 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    CHECK(bind(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+        << "failed to bind the metrics port " << port << ", errno: " << errno;
+    CHECK(listen(fd, 16) == 0);
+
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr *)&addr, &len);
+    this->port = ntohs(addr.sin_port);
+
+    update(Statistics(), 0, 0);
+  }
+
+  MetricsServer(const MetricsServer &) = delete;
+  MetricsServer &operator=(const MetricsServer &) = delete;
+
+  ~MetricsServer() {
+    stop();
+    close(fd);
+  }
+
+  int get_port() const { return port; }
+
+  void start() {
+    LOG(INFO) << "Coordinator " << coordinator_id
+              << " serves metrics on port " << port;
+    thread = std::thread(&MetricsServer::serve, this);
+  }
+
+  void stop() {
+    stopFlag.store(true);
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  // called by the coordinator every second with the statistics of its
+  // workers in that second and the bytes its dispatchers received and sent
+  // so far
+  void update(const Statistics &s, uint64_t bytes_in, uint64_t bytes_out) {
+    total.merge(s);
+    queue_occupancy = s.queue_occupancy;
+    auto rendered = render(bytes_in, bytes_out);
+    std::lock_guard<std::mutex> guard(text_mutex);
+    text.swap(rendered);
+  }
+
+  // called by the coordinator before update with the client transactions
+  // its IngressServer admitted, rejected and shed so far
+  void update_ingress(uint64_t admitted, uint64_t rejected, uint64_t shed) {
+    has_ingress = true;
+    n_admitted = admitted;
+    n_rejected = rejected;
+    n_shed = shed;
+  }
+
+  std::string get_text() const {
+    std::lock_guard<std::mutex> guard(text_mutex);
+    return text;
+  }
+
+private:
+  std::string render(uint64_t bytes_in, uint64_t bytes_out) const {
+    std::ostringstream os;
+    os.precision(12);
+    auto label = "{coordinator=\"" + std::to_string(coordinator_id) + "\"";
+
+    auto metric = [&](const char *name, const char *type, const char *help) {
+      os << "# HELP " << name << " " << help << "\n"
+         << "# TYPE " << name << " " << type << "\n";
+    };
+    // counters are printed as integers, times as seconds
+    auto sample = [&](const char *name, const std::string &labels,
+                      auto value) {
+      os << name << label << labels << "} " << value << "\n";
+    };
+
+    metric("coco_commits_total", "counter", "Committed transactions.");
+    sample("coco_commits_total", "", total.n_commit);
+
+    metric("coco_aborts_total", "counter", "Aborted transactions by reason.");
+    sample("coco_aborts_total", ",reason=\"no_retry\"",
+           total.n_abort_no_retry);
+    sample("coco_aborts_total", ",reason=\"lock\"", total.n_abort_lock);
+    sample("coco_aborts_total", ",reason=\"read_validation\"",
+           total.n_abort_read_validation);
+
+    metric("coco_commit_latency_us", "histogram",
+           "Commit latency of transactions in microseconds.");
+    for (uint64_t le = 1; le <= LATENCY_BUCKET_MAX; le *= 2) {
+      sample("coco_commit_latency_us_bucket",
+             ",le=\"" + std::to_string(le) + "\"",
+             total.latency.count_at_most(le));
+    }
+    sample("coco_commit_latency_us_bucket", ",le=\"+Inf\"",
+           total.latency.size());
+    sample("coco_commit_latency_us_sum", "", total.latency.approximate_sum());
+    sample("coco_commit_latency_us_count", "", total.latency.size());
+
+    static const char *phases[N_TRANSACTION_PHASES] = {
+        "execute", "lock", "validate", "write", "group_commit_wait"};
+    metric("coco_phase_seconds_total", "counter",
+           "Time of the committed transactions in each phase.");
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      sample("coco_phase_seconds_total",
+             std::string(",phase=\"") + phases[i] + "\"",
+             total.phase_time[i] / 1e9);
+    }
+
+    metric("coco_network_bytes_total", "counter",
+           "Bytes received and sent by the dispatchers.");
+    sample("coco_network_bytes_total", ",direction=\"in\"", bytes_in);
+    sample("coco_network_bytes_total", ",direction=\"out\"", bytes_out);
+
+    metric("coco_transaction_network_bytes_total", "counter",
+           "Bytes sent on behalf of the committed transactions.");
+    sample("coco_transaction_network_bytes_total", "", total.n_network_size);
+
+    metric("coco_queue_stalls_total", "counter",
+           "Times a worker waited for room in an outgoing queue.");
+    sample("coco_queue_stalls_total", "", total.n_queue_stall);
+
+    metric("coco_queue_stall_seconds_total", "counter",
+           "Time workers waited for room in an outgoing queue.");
+    sample("coco_queue_stall_seconds_total", "",
+           total.queue_stall_time / 1e9);
+
+    metric("coco_deferred_flushes_total", "counter",
+           "Asynchronous flushes deferred for credits.");
+    sample("coco_deferred_flushes_total", "", total.n_deferred_flush);
+
+    metric("coco_outgoing_queue_max_occupancy", "gauge",
+           "The most messages seen in an outgoing queue in the last second.");
+    sample("coco_outgoing_queue_max_occupancy", "", queue_occupancy);
+
+    if (has_ingress) {
+      metric("coco_ingress_requests_total", "counter",
+             "Client transactions by admission outcome.");
+      sample("coco_ingress_requests_total", ",outcome=\"admitted\"",
+             n_admitted);
+      sample("coco_ingress_requests_total", ",outcome=\"rejected\"",
+             n_rejected);
+      sample("coco_ingress_requests_total", ",outcome=\"shed\"", n_shed);
+    }
+
+    return os.str();
+  }
+
+  void serve() {
+    while (!stopFlag.load()) {
+      pollfd p{fd, POLLIN, 0};
+      if (poll(&p, 1, POLL_TIMEOUT_MS) <= 0 || !(p.revents & POLLIN)) {
+        continue;
+      }
+      int conn = accept(fd, nullptr, nullptr);
+      if (conn < 0) {
+        continue;
+      }
+      reply(conn);
+      close(conn);
+    }
+  }
+
+  // answers a GET /metrics with the last rendered text, anything else with
+  // a 404
+  void reply(int conn) {
+    timeval timeout{1, 0};
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.size() < MAX_REQUEST_SIZE) {
+      auto n = recv(conn, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        return;
+      }
+      request.append(buffer, n);
+    }
+
+    std::string status = "200 OK", body;
+    if (request.compare(0, 13, "GET /metrics ") == 0) {
+      body = get_text();
+    } else {
+      status = "404 Not Found";
+      body = "see /metrics\n";
+    }
+
+    std::string response = "HTTP/1.1 " + status +
+                           "\r\nContent-Type: text/plain; version=0.0.4"
+                           "\r\nContent-Length: " +
+                           std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+    for (std::size_t sent = 0; sent < response.size();) {
+      auto n = send(conn, response.data() + sent, response.size() - sent,
+                    MSG_NOSIGNAL);
+      if (n <= 0) {
+        return;
+      }
+      sent += n;
+    }
+  }
+
+private:
+  static constexpr uint64_t LATENCY_BUCKET_MAX = 1 << 24; // ~ 17 seconds
+  static constexpr int POLL_TIMEOUT_MS = 100;
+  static constexpr std::size_t MAX_REQUEST_SIZE = 8192;
+
+  std::size_t coordinator_id;
+  int fd, port;
+  std::atomic<bool> stopFlag;
+  std::thread thread;
+  // touched by the coordinator only
+  Statistics total;
+  uint64_t queue_occupancy = 0;
+  bool has_ingress = false;
+  uint64_t n_admitted = 0, n_rejected = 0, n_shed = 0;
+  mutable std::mutex text_mutex;
+  std::string text;
+};
+} // namespace coco
@@ -0,0 +1,369 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/RateLimiter.h"
+#include "core/Checkpoint.h"
+#include "core/Context.h"
+#include "core/ControlMessage.h"
+#include "core/Partitioner.h"
+#include "core/RedoLog.h"
+#include "core/Table.h"
+#include "core/Worker.h"
+
+#include <chrono>
+#include <glog/logging.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --partitioner=dynamic, the migrator moves the partitions in
+ * --migrations, e.g., "3:0,5:1" moves partition 3 to coordinator 0 and
+ * partition 5 to coordinator 1, while the transactions keep running. The
+ * owner of a partition moves it, one partition at a time, once
+ * --migration_delay seconds have passed.
+ *
+ * A move begins at an epoch boundary (see PartitionMap), from then on the
+ * owner replicates its writes to the target. The owner then streams the rows
+ * of the partition to the target's migrator, each row read optimistically as
+ * in a checkpoint, and the target applies a row only if it is newer than its
+ * own, so that the stream and the replication can arrive in any order. Once
+ * the target acknowledges the last row, the move finishes at the next epoch
+ * boundary and the target is the owner.
+ *
+ * A partition is moved once, and only the protocols that replicate at epoch
+ * boundaries, i.e., the group commit ones, can move partitions.
+ */
+
+class Migrator : public Worker {
+public:
+  Migrator(std::size_t coordinator_id, std::size_t id, const Context &context,
+           std::vector<std::vector<ITable *>> tables,
+           std::atomic<bool> &stopFlag)
+      : Worker(coordinator_id, id), context(context), tables(std::move(tables)),
+        stopFlag(stopFlag),
+        map(PartitionMap::of(coordinator_id, context.coordinator_num)) {
+
+    for (auto i = 0u; i < context.coordinator_num; i++) {
+      messages.emplace_back(std::make_unique<Message>());
+      init_message(messages[i].get(), i);
+    }
+
+    std::vector<bool> moved(this->tables.size());
+    for (auto &migration : parse_migrations(context.migrations)) {
+      auto partition_id = migration.first, dest = migration.second;
+      CHECK(partition_id < this->tables.size())
+          << "partition " << partition_id << " does not exist.";
+      CHECK(dest < context.coordinator_num)
+          << "coordinator " << dest << " does not exist.";
+      CHECK(!moved[partition_id])
+          << "partition " << partition_id << " is moved more than once.";
+      moved[partition_id] = true;
+      if (map.owner(partition_id) == coordinator_id && dest != coordinator_id) {
+        moves.push_back(Move{partition_id, dest});
+      }
+    }
+  }
+
+  // "p:c,..." as a list of (partition id, coordinator id)
+  static std::vector<std::pair<std::size_t, std::size_t>>
+  parse_migrations(const std::string &migrations) {
+    std::vector<std::pair<std::size_t, std::size_t>> result;
+    std::istringstream in(migrations);
+    std::string migration;
+    while (std::getline(in, migration, ',')) {
+      auto colon = migration.find(':');
+      CHECK(colon != std::string::npos) << "bad migration: " << migration;
+      result.emplace_back(std::stoul(migration.substr(0, colon)),
+                          std::stoul(migration.substr(colon + 1)));
+    }
+    return result;
+  }
+
+  void start() override {
+
+    LOG(INFO) << "Migrator(worker id = " << id << ") starts, " << moves.size()
+              << " partitions to move.";
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto delay = std::chrono::seconds(context.migration_delay);
+
+    while (!stopFlag.load()) {
+      std::size_t n = process_request();
+      if (next < moves.size() &&
+          std::chrono::steady_clock::now() - startTime >= delay) {
+        n += advance(moves[next]);
+      }
+      if (n == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    LOG(INFO) << "Migrator(worker id = " << id << ") exits, " << next
+              << " partitions moved, " << n_sent_rows << " rows sent, "
+              << n_received_rows << " rows received.";
+  }
+
+  void push_message(Message *message) override { in_queue.push(message); }
+
+  Message *pop_message() override { return nullptr; }
+
+  // the rows go in the async lane, behind the transactions
+  Message *pop_async_message() override {
+    if (out_queue.empty())
+      return nullptr;
+
+    Message *message = out_queue.front();
+    bool ok = out_queue.pop();
+    CHECK(ok);
+    return message;
+  }
+
+  // applies the rows that are newer than the table's, returns the number of
+  // rows in bytes
+  static std::size_t apply_rows(ITable &table, StringPiece bytes) {
+    std::size_t n = 0;
+    RedoLogRecord record;
+    while (RedoLog::next(bytes, record)) {
+      DCHECK(record.table_id == table.tableID());
+      DCHECK(record.partition_id == table.partitionID());
+      auto &metadata = table.search_metadata(record.key.data());
+      uint64_t tid = lock(metadata);
+      if (record.commit_ts > (tid & Checkpoint::TS_MASK)) {
+        table.deserialize_value(record.key.data(), record.value);
+        metadata.store(record.commit_ts);
+      } else {
+        metadata.store(tid);
+      }
+      n++;
+    }
+    return n;
+  }
+
+  static std::size_t new_rows_message(Message &message, ITable &table,
+                                      const std::string &rows) {
+    /*
+     * The structure of a rows message: (redo log records, see RedoLog)
+     */
+
+    auto message_size = MessagePiece::get_header_size() + rows.size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::MIGRATION_ROWS), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(rows.data(), rows.size());
+    message.flush();
+    return message_size;
+  }
+
+  static std::size_t new_done_message(Message &message, ControlMessage type,
+                                      std::size_t partition_id) {
+    /*
+     * The structure of a done or an ack message: ()
+     */
+
+    DCHECK(type == ControlMessage::MIGRATION_DONE ||
+           type == ControlMessage::MIGRATION_ACK);
+    auto message_size = MessagePiece::get_header_size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(type), message_size, 0, partition_id);
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    message.flush();
+    return message_size;
+  }
+
+private:
+  enum class MoveState { IDLE, BEGINNING, STREAMED, ACKED, FINISHING };
+
+  struct Move {
+    std::size_t partition_id;
+    std::size_t dest;
+    MoveState state = MoveState::IDLE;
+    std::size_t rows = 0;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  // returns 1 if the move makes progress
+  std::size_t advance(Move &move) {
+    switch (move.state) {
+    case MoveState::IDLE:
+      LOG(INFO) << "Migrator moves partition " << move.partition_id
+                << " to coordinator " << move.dest << ".";
+      move.start = std::chrono::steady_clock::now();
+      map.announce(MigrationEvent{static_cast<uint32_t>(move.partition_id),
+                                  static_cast<uint32_t>(move.dest), 1});
+      move.state = MoveState::BEGINNING;
+      return 1;
+    case MoveState::BEGINNING:
+      if (map.target(move.partition_id) != static_cast<int32_t>(move.dest)) {
+        return 0;
+      }
+      stream(move);
+      move.state = MoveState::STREAMED;
+      return 1;
+    case MoveState::STREAMED:
+      // till the target acknowledges the rows
+      return 0;
+    case MoveState::ACKED:
+      map.announce(MigrationEvent{static_cast<uint32_t>(move.partition_id),
+                                  static_cast<uint32_t>(move.dest), 0});
+      move.state = MoveState::FINISHING;
+      return 1;
+    case MoveState::FINISHING:
+      if (map.owner(move.partition_id) != move.dest) {
+        return 0;
+      }
+      LOG(INFO) << "Migrator moved partition " << move.partition_id
+                << " to coordinator " << move.dest << ", " << move.rows
+                << " rows in "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - move.start)
+                       .count()
+                << " ms.";
+      next++;
+      return 1;
+    }
+    return 0;
+  }
+
+  void stream(Move &move) {
+    RateLimiter limiter(context.migration_bandwidth * 1024 * 1024);
+    std::string rows;
+
+    for (auto table : tables[move.partition_id]) {
+      table->for_each_row([&](const void *key, ITable::MetaDataType &metadata,
+                              void *value) {
+        Checkpoint::append_row(rows, *table, key, metadata, value);
+        move.rows++;
+        if (rows.size() >= BATCH_BYTES) {
+          new_rows_message(*messages[move.dest], *table, rows);
+          flush_messages();
+          limiter.consume(rows.size());
+          rows.clear();
+          // the target streams to us as well
+          process_request();
+        }
+      });
+      if (!rows.empty()) {
+        new_rows_message(*messages[move.dest], *table, rows);
+        rows.clear();
+      }
+    }
+
+    new_done_message(*messages[move.dest], ControlMessage::MIGRATION_DONE,
+                     move.partition_id);
+    flush_messages();
+    n_sent_rows += move.rows;
+  }
+
+  std::size_t process_request() {
+    std::size_t n = 0;
+
+    while (!in_queue.empty()) {
+      std::unique_ptr<Message> message(in_queue.front());
+      bool ok = in_queue.pop();
+      CHECK(ok);
+
+      for (auto it = message->begin(); it != message->end(); it++) {
+        MessagePiece messagePiece = *it;
+        auto type =
+            static_cast<ControlMessage>(messagePiece.get_message_type());
+        auto partition_id = messagePiece.get_partition_id();
+        switch (type) {
+        case ControlMessage::MIGRATION_ROWS:
+          n_received_rows +=
+              apply_rows(*find_table(messagePiece.get_table_id(), partition_id),
+                         messagePiece.toStringPiece());
+          break;
+        case ControlMessage::MIGRATION_DONE:
+          new_done_message(*messages[message->get_source_node_id()],
+                           ControlMessage::MIGRATION_ACK, partition_id);
+          break;
+        case ControlMessage::MIGRATION_ACK:
+          CHECK(next < moves.size() &&
+                moves[next].partition_id == partition_id &&
+                moves[next].state == MoveState::STREAMED);
+          moves[next].state = MoveState::ACKED;
+          break;
+        default:
+          CHECK(false) << "Message type: " << static_cast<uint32_t>(type);
+          break;
+        }
+      }
+
+      n++;
+      incoming_message_pool.put(message.release());
+    }
+
+    flush_messages();
+    return n;
+  }
+
+  ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    DCHECK(partition_id < tables.size());
+    for (auto table : tables[partition_id]) {
+      if (table->tableID() == table_id) {
+        return table;
+      }
+    }
+    CHECK(false) << "table " << table_id << " does not exist.";
+    return nullptr;
+  }
+
+  static uint64_t lock(ITable::MetaDataType &metadata) {
+    for (;;) {
+      uint64_t tid = metadata.load();
+      if ((tid & Checkpoint::LOCK_BIT) == 0 &&
+          metadata.compare_exchange_weak(tid, tid | Checkpoint::LOCK_BIT)) {
+        return tid;
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  void flush_messages() {
+    for (auto i = 0u; i < messages.size(); i++) {
+      if (i == coordinator_id || messages[i]->get_message_count() == 0) {
+        continue;
+      }
+      auto message = messages[i].release();
+      push_outgoing(out_queue, message);
+      messages[i].reset(outgoing_message_pool.get());
+      init_message(messages[i].get(), i);
+    }
+  }
+
+  void init_message(Message *message, std::size_t dest_node_id) {
+    message->set_source_node_id(coordinator_id);
+    message->set_dest_node_id(dest_node_id);
+    message->set_worker_id(id);
+  }
+
+public:
+  // rows are sent in messages of about this many bytes
+  static constexpr std::size_t BATCH_BYTES = 64 * 1024;
+
+private:
+  const Context &context;
+  std::vector<std::vector<ITable *>> tables;
+  std::atomic<bool> &stopFlag;
+  PartitionMap &map;
+  std::vector<Move> moves;
+  std::size_t next = 0;
+  std::size_t n_sent_rows = 0, n_received_rows = 0;
+  std::vector<std::unique_ptr<Message>> messages;
+  LockfreeQueue<Message *> in_queue, out_queue;
+};
+} // namespace coco
@@ -0,0 +1,123 @@
+//
+// Created by Yi Lu on 8/29/18.
+//
+
+#pragma once
+
+#include "common/Socket.h"
+#include <chrono>
+#include <glog/logging.h>
+#include <memory>
+#include <string>
+#include <sys/epoll.h>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * A network engine tells the dispatchers which peers to read from and how to
+ * back off when there is nothing to do. Message framing and the routing of
+ * messages to i/o threads are not affected by the engine.
+ *
+ * poll:  check every peer in each round and yield when idle (busy polling).
+ * epoll: wait on an epoll instance for readable peers and sleep when the
+ *        outgoing queues stay empty, so idle i/o threads do not burn a core.
+ */
+
+class NetworkEngine {
+public:
+  virtual ~NetworkEngine() = default;
+
+  virtual void add(std::size_t peer_id, Socket &socket) = 0;
+
+  // fill ready with the peers that may have data to read
+  virtual void wait_readable(std::vector<std::size_t> &ready) = 0;
+
+  // called after idle_rounds consecutive rounds without any work
+  virtual void idle(std::size_t idle_rounds) = 0;
+};
+
+class PollNetworkEngine : public NetworkEngine {
+public:
+  void add(std::size_t peer_id, Socket &socket) override {
+    peers.push_back(peer_id);
+  }
+
+  void wait_readable(std::vector<std::size_t> &ready) override {
+    ready = peers;
+  }
+
+  void idle(std::size_t idle_rounds) override { std::this_thread::yield(); }
+
+private:
+  std::vector<std::size_t> peers;
+};
+
+class EpollNetworkEngine : public NetworkEngine {
+public:
+  EpollNetworkEngine() {
+    epoll_fd = epoll_create1(0);
+    CHECK(epoll_fd >= 0) << "epoll_create1 failed, errno: " << errno;
+  }
+
+  ~EpollNetworkEngine() override { ::close(epoll_fd); }
+
+  void add(std::size_t peer_id, Socket &socket) override {
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    // level triggered, the dispatcher drains a peer before waiting again
+    event.events = EPOLLIN;
+    event.data.u64 = peer_id;
+    int res = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket.get_fd(), &event);
+    CHECK(res == 0) << "epoll_ctl failed, errno: " << errno;
+    events.resize(events.size() + 1);
+  }
+
+  void wait_readable(std::vector<std::size_t> &ready) override {
+    ready.clear();
+    if (events.empty()) {
+      return;
+    }
+    int n = epoll_wait(epoll_fd, events.data(), events.size(),
+                       WAIT_TIMEOUT_MS);
+    for (int i = 0; i < n; i++) {
+      ready.push_back(events[i].data.u64);
+    }
+  }
+
+  void idle(std::size_t idle_rounds) override {
+    if (idle_rounds < SPIN_ROUNDS) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(IDLE_SLEEP_US));
+    }
+  }
+
+public:
+  // bounds how long it takes an idle i/o thread to notice the stop flag
+  static constexpr int WAIT_TIMEOUT_MS = 1;
+  static constexpr std::size_t SPIN_ROUNDS = 1000;
+  static constexpr int IDLE_SLEEP_US = 20;
+
+private:
+  int epoll_fd;
+  std::vector<epoll_event> events;
+};
+
+class NetworkEngineFactory {
+public:
+  static std::unique_ptr<NetworkEngine>
+  create_network_engine(const std::string &engine) {
+    if (engine == "poll") {
+      return std::make_unique<PollNetworkEngine>();
+    } else if (engine == "epoll") {
+      return std::make_unique<EpollNetworkEngine>();
+    } else {
+      CHECK(false) << "network engine: " << engine << " is not supported.";
+      return nullptr;
+    }
+  }
+};
+
+} // namespace coco
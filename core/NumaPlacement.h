@@ -0,0 +1,116 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/NumaTopology.h"
+#include "core/Context.h"
+#include "core/Partitioner.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * NumaPlacement spreads the workers and the partitions of a coordinator over
+ * NUMA nodes with --numa.
+ *
+ * Workers are split into contiguous blocks, one per node, and so are the
+ * partitions, by their index among the partitions of a coordinator. A worker
+ * only generates transactions on the partitions of its node, and the loader
+ * thread of a partition runs on its node, so that the memory of the partition
+ * is first touched and allocated there.
+ *
+ * Cpus below --cpu_core_id are left out, and no more nodes than workers are
+ * used.
+ */
+
+class NumaPlacement {
+public:
+  explicit NumaPlacement(const Context &context,
+                         const NumaTopology &topology = NumaTopology())
+      : worker_num(context.worker_num), partition_num(context.partition_num),
+        coordinator_num(context.coordinator_num) {
+
+    for (auto node = 0u; node < topology.node_num(); node++) {
+      std::vector<int> cpus;
+      for (auto cpu : topology.cpus(node)) {
+        if (cpu >= static_cast<int>(context.cpu_core_id)) {
+          cpus.push_back(cpu);
+        }
+      }
+      if (!cpus.empty()) {
+        node_cpus.push_back(std::move(cpus));
+      }
+    }
+    CHECK(!node_cpus.empty()) << "no cpus from --cpu_core_id on.";
+
+    node_cpus.resize(
+        std::max<std::size_t>(1, std::min(node_cpus.size(), worker_num)));
+    next_cpu.resize(node_cpus.size(), 0);
+  }
+
+  std::size_t node_num() const { return node_cpus.size(); }
+
+  // the manager and other threads besides the workers run on node 0
+  std::size_t worker_node(std::size_t worker_id) const {
+    if (worker_id >= worker_num) {
+      return 0;
+    }
+    return worker_id * node_num() / worker_num;
+  }
+
+  std::size_t partition_node(std::size_t partition_id) const {
+    auto partition_num_per_node =
+        (partition_num + coordinator_num - 1) / coordinator_num;
+    auto index = partition_id / coordinator_num;
+    return std::min(index * node_num() / partition_num_per_node,
+                    node_num() - 1);
+  }
+
+  // the partitions mastered by this coordinator on the node of the worker
+  std::vector<std::size_t> local_partitions(std::size_t worker_id,
+                                            const Partitioner &partitioner) {
+    std::vector<std::size_t> partitions;
+    for (auto i = 0u; i < partition_num; i++) {
+      if (partitioner.has_master_partition(i) &&
+          partition_node(i) == worker_node(worker_id)) {
+        partitions.push_back(i);
+      }
+    }
+    return partitions;
+  }
+
+  const std::vector<int> &cpus(std::size_t node) const {
+    return node_cpus[node];
+  }
+
+  // cpus of a node are handed out in order, and reused once all are taken
+  int take_cpu(std::size_t node) {
+    auto &cpus = node_cpus[node];
+    return cpus[next_cpu[node]++ % cpus.size()];
+  }
+
+  static void pin_thread(std::thread::native_handle_type t,
+                         const std::vector<int> &cpus) {
+#ifndef __APPLE__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (auto cpu : cpus) {
+      CPU_SET(cpu, &cpuset);
+    }
+    int rc = pthread_setaffinity_np(t, sizeof(cpu_set_t), &cpuset);
+    CHECK(rc == 0);
+#endif
+  }
+
+private:
+  std::size_t worker_num, partition_num, coordinator_num;
+  std::vector<std::vector<int>> node_cpus;
+  std::vector<std::size_t> next_cpu;
+};
+} // namespace coco
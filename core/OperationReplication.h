@@ -0,0 +1,188 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/Message.h"
+#include "common/MessagePiece.h"
+#include "common/Operation.h"
+#include "core/ControlMessage.h"
+#include "core/Partitioner.h"
+#include "core/Table.h"
+
+#include <functional>
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --operation_replication, a transaction registers its writes as an
+ * operation, a compact logical redo record of the workload (see
+ * txn.operation). If all the writes are in the partition of the operation
+ * and it is mastered on this node, the operation is sent to the replicas of
+ * the partition instead of the values.
+ *
+ * A replica replays an operation with Database::apply_operation(operation,
+ * write), which calls write(tid, func) for each row of the operation, and
+ * func sets the fields of the row. The protocol helper applies func with the
+ * Thomas write rule, i.e., a row that has a newer version is left as it is.
+ * Operations carry the new values of the fields rather than increments, and
+ * the operations on a row write the same fields, so a row ends up as if the
+ * operations were replayed in TID order, even if asynchronous replication
+ * delivers them out of order.
+ */
+
+class OperationReplication {
+public:
+  template <class TransactionType>
+  static bool is_applicable(TransactionType &txn,
+                            const Partitioner &partitioner) {
+    auto &operation = txn.operation;
+    if (operation.data.empty() ||
+        !partitioner.has_master_partition(operation.partition_id)) {
+      return false;
+    }
+
+    // an operation does not replay inserts and deletes, see Tombstone
+    for (auto i = 0u; i < txn.writeSet.size(); i++) {
+      if (txn.writeSet[i].get_partition_id() != operation.partition_id ||
+          txn.writeSet[i].get_insert_bit() ||
+          txn.writeSet[i].get_delete_bit()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // sends the operation of txn to the other replicas of its partition, the
+  // partition is mastered on this node, see is_applicable()
+  template <class TransactionType>
+  static void replicate(TransactionType &txn, uint64_t commit_tid,
+                        const Partitioner &partitioner,
+                        std::vector<std::unique_ptr<Message>> &messages,
+                        bool need_response) {
+    auto &operation = txn.operation;
+    operation.set_tid(commit_tid);
+
+    for (auto k = 0u; k < partitioner.total_coordinators(); k++) {
+
+      // k does not have this partition
+      if (!partitioner.is_partition_replicated_on(operation.partition_id, k)) {
+        continue;
+      }
+
+      // already write
+      if (k == partitioner.master_coordinator(operation.partition_id)) {
+        continue;
+      }
+
+      if (need_response) {
+        txn.pendingResponses++;
+      }
+      txn.network_size +=
+          new_operation_message(*messages[k], operation, need_response);
+    }
+  }
+
+  static std::size_t new_operation_message(Message &message,
+                                           const Operation &operation,
+                                           bool need_response) {
+
+    /*
+     * The structure of an operation replication request: (tid, need
+     * response, operation data)
+     */
+
+    auto message_size = MessagePiece::get_header_size() +
+                        sizeof(operation.tid) + sizeof(need_response) +
+                        operation.data.size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::OPERATION_REPLICATION_REQUEST),
+        message_size, 0, operation.partition_id);
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder << operation.tid << need_response;
+    encoder.write_n_bytes(operation.data.data(), operation.data.size());
+    message.flush();
+    return message_size;
+  }
+
+  // Helper::replicate(tid, commit_tid, func) applies the write of a row
+  template <class Helper, class DatabaseType, class TransactionType>
+  static void set_message_handlers(
+      std::vector<std::function<void(MessagePiece, Message &, ITable &,
+                                     TransactionType *)>> &handlers,
+      DatabaseType &db) {
+
+    handlers[static_cast<int>(ControlMessage::OPERATION_REPLICATION_REQUEST)] =
+        [&db](MessagePiece inputPiece, Message &responseMessage,
+              ITable &table, TransactionType *txn) {
+          operation_request_handler<Helper>(inputPiece, responseMessage, db);
+        };
+
+    handlers[static_cast<int>(ControlMessage::OPERATION_REPLICATION_RESPONSE)] =
+        [](MessagePiece inputPiece, Message &responseMessage, ITable &table,
+           TransactionType *txn) {
+          /*
+           * The structure of an operation replication response: ()
+           */
+          txn->pendingResponses--;
+          txn->network_size += inputPiece.get_message_length();
+        };
+  }
+
+private:
+  template <class Helper, class DatabaseType>
+  static void operation_request_handler(MessagePiece inputPiece,
+                                        Message &responseMessage,
+                                        DatabaseType &db) {
+
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(
+               ControlMessage::OPERATION_REPLICATION_REQUEST));
+
+    /*
+     * The structure of an operation replication request: (tid, need
+     * response, operation data)
+     * The structure of an operation replication response: null
+     */
+
+    Operation operation;
+    bool need_response;
+
+    auto stringPiece = inputPiece.toStringPiece();
+    Decoder dec(stringPiece);
+    dec >> operation.tid >> need_response;
+    stringPiece.remove_prefix(sizeof(operation.tid) + sizeof(need_response));
+
+    operation.partition_id = inputPiece.get_partition_id();
+    operation.data.assign(stringPiece.data(), stringPiece.size());
+
+    uint64_t commit_tid = operation.tid;
+    db.apply_operation(operation,
+                       [commit_tid](std::atomic<uint64_t> &tid,
+                                    const std::function<void()> &func) {
+                         Helper::replicate(tid, commit_tid, func);
+                       });
+
+    if (!need_response) {
+      return;
+    }
+
+    // prepare response message header
+    auto message_size = MessagePiece::get_header_size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::OPERATION_REPLICATION_RESPONSE),
+        message_size, 0, inputPiece.get_partition_id());
+
+    coco::Encoder encoder(responseMessage.data);
+    encoder << message_piece_header;
+    responseMessage.flush();
+  }
+};
+} // namespace coco
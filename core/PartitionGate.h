@@ -0,0 +1,69 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+
+namespace coco {
+
+/*
+ * With --partition_serial, each local partition has a PartitionGate, shared
+ * by all its tables, and is the home partition of one worker. A transaction
+ * on its home partition enters the gate at its first access to the
+ * partition. From then on until it commits or aborts, no other transaction
+ * locks a row of the partition. If the transaction stays on its partition, it
+ * runs H-Store style: no row lock is taken with a CAS and no read is
+ * validated.
+ *
+ * The gate counts the rows of the partition locked by the other
+ * transactions, local or remote, and by cross-partition transactions that
+ * did not enter it. A row lock fails while a transaction is inside the gate,
+ * and a transaction cannot enter while rows are locked. Nothing ever waits
+ * at a gate, so gates cannot deadlock with row locks.
+ */
+
+class PartitionGate {
+public:
+  // returns false if another transaction is inside or a row is locked
+  bool try_enter() {
+    uint64_t expected = 0;
+    return state.compare_exchange_strong(expected, INSIDE_BIT);
+  }
+
+  void leave() {
+    DCHECK(state.load() & INSIDE_BIT);
+    state.fetch_sub(INSIDE_BIT);
+  }
+
+  // called before a row of the partition is locked, returns false while a
+  // transaction is inside the gate
+  bool lock_row() {
+    if (state.fetch_add(1) & INSIDE_BIT) {
+      state.fetch_sub(1);
+      return false;
+    }
+    return true;
+  }
+
+  // called once a row locked after lock_row() is unlocked, or failed to lock
+  void unlock_row() {
+    DCHECK((state.load() & ~INSIDE_BIT) > 0);
+    state.fetch_sub(1);
+  }
+
+  bool is_inside() const { return state.load() & INSIDE_BIT; }
+
+  // the rows of the partition locked
+  uint64_t locked_rows() const { return state.load() & ~INSIDE_BIT; }
+
+public:
+  static constexpr uint64_t INSIDE_BIT = 1ull << 63;
+
+private:
+  std::atomic<uint64_t> state{0};
+};
+} // namespace coco
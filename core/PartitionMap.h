@@ -0,0 +1,138 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/StringPiece.h"
+
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * A partition moves from its owner to a target in two steps. Once the move
+ * begins, the target is a replica of the partition, i.e., the owner keeps
+ * serving it and forwards its writes with the replication, while the
+ * existing rows are streamed to the target (see Migrator). Once the target
+ * has all rows, the move finishes and the target is the owner.
+ */
+
+struct MigrationEvent {
+  uint32_t partition_id;
+  uint32_t coordinator_id; // the target
+  uint32_t begin;          // 1 if the move begins, 0 if it finishes
+};
+
+/*
+ * The owner and the target of each partition, read by DynamicPartitioner.
+ * An owner of -1 is partition_id % coordinator_num, a target of -1 means the
+ * partition is not moving.
+ *
+ * All coordinators change the map at the same point, i.e., between two
+ * epochs of the group commit manager. An event is announced on the
+ * coordinator that moves the partition and piggybacked on its next stop
+ * message. Each coordinator applies the events of an epoch once the epoch is
+ * cleaned up, before the next one starts.
+ */
+
+class PartitionMap {
+public:
+  static constexpr std::size_t MAX_PARTITIONS = 1 << 16;
+
+  explicit PartitionMap(std::size_t coordinator_num)
+      : coordinator_num(coordinator_num),
+        owners(new std::atomic<int32_t>[MAX_PARTITIONS]),
+        targets(new std::atomic<int32_t>[MAX_PARTITIONS]) {
+    for (auto i = 0u; i < MAX_PARTITIONS; i++) {
+      owners[i].store(-1);
+      targets[i].store(-1);
+    }
+  }
+
+  // the map of the partitioners on a coordinator
+  static PartitionMap &of(std::size_t coordinator_id,
+                          std::size_t coordinator_num) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<PartitionMap>> maps;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &map = maps[coordinator_id];
+    if (map == nullptr) {
+      map = std::make_unique<PartitionMap>(coordinator_num);
+    }
+    DCHECK(map->coordinator_num == coordinator_num);
+    return *map;
+  }
+
+  std::size_t owner(std::size_t partition_id) const {
+    DCHECK(partition_id < MAX_PARTITIONS);
+    int32_t owner = owners[partition_id].load(std::memory_order_acquire);
+    return owner < 0 ? partition_id % coordinator_num : owner;
+  }
+
+  // -1 if the partition is not moving
+  int32_t target(std::size_t partition_id) const {
+    DCHECK(partition_id < MAX_PARTITIONS);
+    return targets[partition_id].load(std::memory_order_acquire);
+  }
+
+  // the event goes out with the next stop message
+  void announce(const MigrationEvent &event) {
+    std::lock_guard<std::mutex> guard(mutex);
+    announced.push_back(event);
+  }
+
+  std::vector<MigrationEvent> take_announced() {
+    std::lock_guard<std::mutex> guard(mutex);
+    std::vector<MigrationEvent> events;
+    events.swap(announced);
+    return events;
+  }
+
+  void apply(const std::vector<MigrationEvent> &events) {
+    for (auto &event : events) {
+      DCHECK(event.partition_id < MAX_PARTITIONS);
+      DCHECK(event.coordinator_id < coordinator_num);
+      if (event.begin) {
+        targets[event.partition_id].store(event.coordinator_id,
+                                          std::memory_order_release);
+      } else {
+        owners[event.partition_id].store(event.coordinator_id,
+                                         std::memory_order_release);
+        targets[event.partition_id].store(-1, std::memory_order_release);
+      }
+    }
+  }
+
+  static void encode(std::string &bytes,
+                     const std::vector<MigrationEvent> &events) {
+    Encoder encoder(bytes);
+    for (auto &event : events) {
+      encoder << event.partition_id << event.coordinator_id << event.begin;
+    }
+  }
+
+  static void decode(StringPiece bytes, std::vector<MigrationEvent> &events) {
+    Decoder dec(bytes);
+    while (dec.size() > 0) {
+      MigrationEvent event;
+      dec >> event.partition_id >> event.coordinator_id >> event.begin;
+      events.push_back(event);
+    }
+  }
+
+private:
+  std::size_t coordinator_num;
+  std::unique_ptr<std::atomic<int32_t>[]> owners, targets;
+  std::mutex mutex;
+  std::vector<MigrationEvent> announced;
+};
+} // namespace coco
@@ -4,10 +4,16 @@
 
 #pragma once
 
+#include "core/CoAccessGraph.h"
+#include "core/PartitionMap.h"
+
 #include <glog/logging.h>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <string>
+#include <vector>
 
 namespace coco {
 
@@ -25,6 +31,11 @@ public:
 
   virtual std::size_t replica_num() const = 0;
 
+  // the replicas of a partition, which differ while it moves
+  virtual std::size_t partition_replica_num(std::size_t partition_id) const {
+    return replica_num();
+  }
+
   virtual bool is_replicated() const = 0;
 
   virtual bool has_master_partition(std::size_t partition_id) const = 0;
@@ -92,6 +103,48 @@ public:
 
 using HashPartitioner = HashReplicatedPartitioner<1>;
 
+/*
+ * A hash partitioner whose partitions move between coordinators, see
+ * PartitionMap. A partition is only replicated on its target while it moves.
+ */
+
+class DynamicPartitioner : public Partitioner {
+public:
+  DynamicPartitioner(std::size_t coordinator_id, std::size_t coordinator_num,
+                     const PartitionMap &map)
+      : Partitioner(coordinator_id, coordinator_num), map(map) {}
+
+  ~DynamicPartitioner() override = default;
+
+  std::size_t replica_num() const override { return 1; }
+
+  std::size_t partition_replica_num(std::size_t partition_id) const override {
+    return map.target(partition_id) < 0 ? 1 : 2;
+  }
+
+  bool is_replicated() const override { return true; }
+
+  bool has_master_partition(std::size_t partition_id) const override {
+    return master_coordinator(partition_id) == coordinator_id;
+  }
+
+  std::size_t master_coordinator(std::size_t partition_id) const override {
+    return map.owner(partition_id);
+  }
+
+  bool is_partition_replicated_on(std::size_t partition_id,
+                                  std::size_t coordinator_id) const override {
+    DCHECK(coordinator_id < coordinator_num);
+    return coordinator_id == map.owner(partition_id) ||
+           static_cast<int32_t>(coordinator_id) == map.target(partition_id);
+  }
+
+  bool is_backup() const override { return false; }
+
+private:
+  const PartitionMap &map;
+};
+
 class PrimaryBackupPartitioner : public Partitioner {
 public:
   PrimaryBackupPartitioner(std::size_t coordinator_id,
@@ -205,12 +258,173 @@ public:
     if (coordinator_id == 0)
       return true;
 
-    return coordinator_id == (partition_id % (coordinator_num - 1)) + 1;
+    // the partitioned replica is laid out as in StarSPartitioner, so that
+    // both phases of Star see the same rows on a coordinator
+    auto master_id = partition_id % coordinator_num;
+    if (master_id == 0) {
+      return coordinator_id == partition_id % (coordinator_num - 1) + 1;
+    }
+    return coordinator_id == master_id;
   }
 
   bool is_backup() const override { return coordinator_id != 0; }
 };
 
+/*
+ * The partitions are placed by an access trace, e.g., "affinity:trace.txt",
+ * so that the partitions accessed together are on the same coordinator (see
+ * CoAccessGraph). The partitions beyond the trace are placed as in
+ * HashPartitioner.
+ */
+
+class AffinityPartitioner : public Partitioner {
+public:
+  AffinityPartitioner(std::size_t coordinator_id, std::size_t coordinator_num,
+                      const std::string &trace)
+      : Partitioner(coordinator_id, coordinator_num),
+        placement(placement_of(trace, coordinator_num)) {}
+
+  ~AffinityPartitioner() override = default;
+
+  // the placement is computed once per trace in a process
+  static const std::vector<std::size_t> &
+  placement_of(const std::string &trace, std::size_t coordinator_num) {
+    static std::mutex mutex;
+    static std::map<std::pair<std::string, std::size_t>,
+                    std::vector<std::size_t>>
+        placements;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto key = std::make_pair(trace, coordinator_num);
+    auto it = placements.find(key);
+    if (it != placements.end()) {
+      return it->second;
+    }
+
+    CoAccessGraph graph;
+    CHECK(graph.load(trace)) << "failed to read the access trace " << trace;
+    auto &placement = placements[key];
+    placement = graph.partition(coordinator_num);
+
+    std::vector<std::size_t> hash(placement.size());
+    for (auto i = 0u; i < hash.size(); i++) {
+      hash[i] = i % coordinator_num;
+    }
+    LOG(INFO) << "AffinityPartitioner places " << placement.size()
+              << " partitions of " << graph.transaction_num()
+              << " sampled transactions, " << graph.distributed_num()
+              << " multi-partition, co-accesses across coordinators: "
+              << graph.cut(placement) << " (hash: " << graph.cut(hash) << ")";
+    return placement;
+  }
+
+  std::size_t replica_num() const override { return 1; }
+
+  bool is_replicated() const override { return false; }
+
+  bool has_master_partition(std::size_t partition_id) const override {
+    return master_coordinator(partition_id) == coordinator_id;
+  }
+
+  std::size_t master_coordinator(std::size_t partition_id) const override {
+    if (partition_id < placement.size()) {
+      return placement[partition_id];
+    }
+    return partition_id % coordinator_num;
+  }
+
+  bool is_partition_replicated_on(std::size_t partition_id,
+                                  std::size_t coordinator_id) const override {
+    DCHECK(coordinator_id < coordinator_num);
+    return master_coordinator(partition_id) == coordinator_id;
+  }
+
+  bool is_backup() const override { return false; }
+
+private:
+  const std::vector<std::size_t> &placement;
+};
+
+/*
+ * Calvin replicates the database in replica groups, e.g., "1,3" is a group of
+ * coordinator 0 and a group of coordinators 1 to 3. Each group holds a full
+ * replica, partitioned by partition id % group size over its coordinators,
+ * and runs every transaction. The master of a partition is the coordinator
+ * in the same group.
+ */
+
+class CalvinPartitioner : public Partitioner {
+public:
+  CalvinPartitioner(std::size_t coordinator_id, std::size_t coordinator_num,
+                    const std::string &replica_group)
+      : Partitioner(coordinator_id, coordinator_num) {
+    std::size_t start = 0;
+    for (auto i = 0u; i < replica_group.size();) {
+      auto j = replica_group.find(',', i);
+      if (j == std::string::npos) {
+        j = replica_group.size();
+      }
+      auto size = std::stoul(replica_group.substr(i, j - i));
+      CHECK(size > 0);
+      group_starts.push_back(start);
+      group_sizes.push_back(size);
+      start += size;
+      i = j + 1;
+    }
+    CHECK(start == coordinator_num)
+        << "replica groups " << replica_group << " do not cover "
+        << coordinator_num << " coordinators.";
+    group_id = replica_group_of(coordinator_id);
+  }
+
+  ~CalvinPartitioner() override = default;
+
+  std::size_t replica_num() const override { return group_sizes.size(); }
+
+  bool is_replicated() const override { return group_sizes.size() > 1; }
+
+  bool has_master_partition(std::size_t partition_id) const override {
+    return master_coordinator(partition_id) == coordinator_id;
+  }
+
+  std::size_t master_coordinator(std::size_t partition_id) const override {
+    return group_starts[group_id] + partition_id % group_sizes[group_id];
+  }
+
+  bool is_partition_replicated_on(std::size_t partition_id,
+                                  std::size_t coordinator_id) const override {
+    DCHECK(coordinator_id < coordinator_num);
+    auto g = replica_group_of(coordinator_id);
+    return coordinator_id == group_starts[g] + partition_id % group_sizes[g];
+  }
+
+  bool is_backup() const override { return false; }
+
+  std::size_t replica_group_id() const { return group_id; }
+
+  std::size_t replica_group_size() const { return group_sizes[group_id]; }
+
+  // the coordinator of the same rank in replica group g
+  std::size_t peer(std::size_t g) const {
+    CHECK(group_sizes[g] == group_sizes[group_id])
+        << "replica groups " << group_id << " and " << g
+        << " are of different sizes.";
+    return group_starts[g] + coordinator_id - group_starts[group_id];
+  }
+
+private:
+  std::size_t replica_group_of(std::size_t coordinator_id) const {
+    auto g = 0u;
+    while (coordinator_id >= group_starts[g] + group_sizes[g]) {
+      g++;
+    }
+    return g;
+  }
+
+private:
+  std::vector<std::size_t> group_starts, group_sizes;
+  std::size_t group_id;
+};
+
 class PartitionerFactory {
 public:
   static std::unique_ptr<Partitioner>
@@ -240,6 +454,10 @@ public:
     } else if (part == "hash8") {
       return std::make_unique<HashReplicatedPartitioner<8>>(coordinator_id,
                                                             coordinator_num);
+    } else if (part == "dynamic") {
+      return std::make_unique<DynamicPartitioner>(
+          coordinator_id, coordinator_num,
+          PartitionMap::of(coordinator_id, coordinator_num));
     } else if (part == "pb") {
       return std::make_unique<PrimaryBackupPartitioner>(coordinator_id,
                                                         coordinator_num);
@@ -249,6 +467,12 @@ public:
     } else if (part == "StarC") {
       return std::make_unique<StarCPartitioner>(coordinator_id,
                                                 coordinator_num);
+    } else if (part.compare(0, 9, "affinity:") == 0) {
+      return std::make_unique<AffinityPartitioner>(
+          coordinator_id, coordinator_num, part.substr(9));
+    } else if (part.compare(0, 7, "Calvin:") == 0) {
+      return std::make_unique<CalvinPartitioner>(
+          coordinator_id, coordinator_num, part.substr(7));
     } else {
       CHECK(false);
       return nullptr;
@@ -0,0 +1,116 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "core/Statistics.h"
+
+#include <boost/algorithm/string.hpp>
+#include <cstdint>
+#include <glog/logging.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * Priority classes -- with --priorities, e.g., --priorities=1:1 for the
+ * Payment of TPC-C, the transactions of a procedure are in a class, 0 unless
+ * listed, and the executors of group commit favor the higher ones:
+ *
+ *  - the client requests of a class above 0 are dispatched before the others,
+ *    see IngressServer::pop,
+ *  - a deferred retry of a higher class is retried first, see RetryQueue::pop,
+ *    and a retry of a class above 0 does not sleep with --sleep_on_retry,
+ *  - at commit, a transaction of a class above 0 waits up to --lock_spin for
+ *    a local row locked by others, and one of class 0 aborts at once, i.e.,
+ *    wait-die by class. The holder is committing and soon releases the row.
+ *
+ * With --priority_slo, e.g., 1:2000, a class has a latency objective in us,
+ * and the coordinator logs the share of the commits of each class within it,
+ * see log.
+ */
+
+class Priorities {
+public:
+  Priorities() = default;
+
+  Priorities(const std::string &priorities, const std::string &slos) {
+    for (auto &p : parse(priorities, "--priorities")) {
+      classes[p.first] = p.second;
+    }
+    for (auto &p : parse(slos, "--priority_slo")) {
+      objectives[p.first] = p.second;
+    }
+  }
+
+  bool enabled() const { return !classes.empty(); }
+
+  // the class of procedure_id
+  uint32_t of(uint32_t procedure_id) const {
+    auto it = classes.find(procedure_id);
+    return it == classes.end() ? 0 : it->second;
+  }
+
+  // the latency objective of a class in us, 0 if it has none
+  uint64_t slo(uint32_t priority) const {
+    auto it = objectives.find(priority);
+    return it == objectives.end() ? 0 : it->second;
+  }
+
+  // the statistics of each class, merged from the ones of its procedures
+  std::map<uint32_t, ProcedureStatistics> by_class(const Statistics &s) const {
+    std::map<uint32_t, ProcedureStatistics> result;
+    for (auto &p : s.procedures) {
+      result[of(p.first)].merge(p.second);
+    }
+    return result;
+  }
+
+  void log(const std::string &prefix, const Statistics &s, int seconds) const {
+    for (auto &p : by_class(s)) {
+      auto &t = p.second;
+      auto objective = slo(p.first);
+      auto n = t.n_commit();
+      LOG(INFO) << prefix << "priority " << p.first
+                << " commit: " << 1.0 * n / seconds
+                << " abort: " << 1.0 * t.n_abort() / seconds
+                << ", latency: " << t.latency.nth(50) << " us (50%) "
+                << t.latency.nth(99) << " us (99%)";
+      if (objective > 0) {
+        auto within = t.latency.count_at_most(objective);
+        LOG(INFO) << prefix << "priority " << p.first << " slo " << objective
+                  << " us: " << (n == 0 ? 100 : 100.0 * within / n)
+                  << " % of the commits within";
+      }
+    }
+  }
+
+private:
+  // a list of <uint32>:<uint64> separated by ','
+  static std::vector<std::pair<uint32_t, uint64_t>>
+  parse(const std::string &list, const char *flag) {
+    std::vector<std::pair<uint32_t, uint64_t>> result;
+    std::vector<std::string> items;
+    boost::algorithm::split(items, list, boost::is_any_of(","));
+    for (auto &item : items) {
+      boost::algorithm::trim(item);
+      if (item.empty()) {
+        continue;
+      }
+      auto k = item.find(':');
+      CHECK(k != std::string::npos && k > 0 && k + 1 < item.size())
+          << flag << " is a list of <id>:<value>, not " << item;
+      result.emplace_back(std::stoul(item.substr(0, k)),
+                          std::stoull(item.substr(k + 1)));
+    }
+    return result;
+  }
+
+private:
+  std::map<uint32_t, uint32_t> classes;
+  std::map<uint32_t, uint64_t> objectives;
+};
+} // namespace coco
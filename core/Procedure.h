@@ -0,0 +1,320 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/StringPiece.h"
+#include "common/Time.h"
+#include "core/Defs.h"
+#include "core/Partitioner.h"
+#include "core/TransactionPool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <glog/logging.h>
+#include <memory>
+#include <vector>
+
+namespace coco {
+
+/*
+ * Stored procedures -- a transaction type defined outside of the benchmark
+ * headers. A procedure is a class with
+ *
+ *   static constexpr uint32_t id;  // FIRST_PROCEDURE_ID or above
+ *   using ArgsType = ...;          // its typed args
+ *   using RowsType = ...;          // the keys and values of the rows it uses
+ *
+ *   // the args a client submitted, see IngressServer, false if invalid
+ *   static bool decode(const Context &, StringPiece, ArgsType &);
+ *   // the args of a generated transaction on partition_id, see --procedure
+ *   static void generate(const Context &, std::size_t partition_id,
+ *                        Random &, ArgsType &);
+ *   // sets the keys of rows and declares them with access.read(table_id,
+ *   // partition_id, key, value) or access.write(...), in the same order for
+ *   // the same args
+ *   template <class Access>
+ *   static void declare(const Context &, const ArgsType &, RowsType &,
+ *                       Access &);
+ *   // updates the values of the rows it writes, once the rows are read
+ *   static TransactionResult run(const Context &, const ArgsType &,
+ *                                RowsType &);
+ *
+ * ProcedureTransaction runs a procedure on the transaction base of any
+ * protocol: the declared rows are searched for and read in one round, the
+ * procedure runs on them, and its writes are handed to the protocol. Since
+ * the read and write sets are known from the args, the deterministic
+ * protocols, the batched read requests and routing by partition all see
+ * them before the procedure runs, see ProcedureFootprint.
+ */
+
+// the ids below are the workloads' own transactions
+constexpr uint32_t FIRST_PROCEDURE_ID = 16;
+
+// an Access that searches for the declared rows
+template <class Transaction> class ProcedureSearch {
+public:
+  explicit ProcedureSearch(Transaction &txn) : txn(txn) {}
+
+  template <class KeyType, class ValueType>
+  void read(std::size_t table_id, std::size_t partition_id,
+            const KeyType &key, ValueType &value) {
+    txn.search_for_read(table_id, partition_id, key, value);
+  }
+
+  template <class KeyType, class ValueType>
+  void write(std::size_t table_id, std::size_t partition_id,
+             const KeyType &key, ValueType &value) {
+    txn.search_for_update(table_id, partition_id, key, value);
+  }
+
+private:
+  Transaction &txn;
+};
+
+// an Access that writes the declared rows back
+template <class Transaction> class ProcedureUpdate {
+public:
+  explicit ProcedureUpdate(Transaction &txn) : txn(txn) {}
+
+  template <class KeyType, class ValueType>
+  void read(std::size_t, std::size_t, const KeyType &, ValueType &) {}
+
+  template <class KeyType, class ValueType>
+  void write(std::size_t table_id, std::size_t partition_id,
+             const KeyType &key, ValueType &value) {
+    txn.update(table_id, partition_id, key, value);
+  }
+
+private:
+  Transaction &txn;
+};
+
+// an Access that lists the partitions of the declared rows, the first one is
+// the home partition of a submitted procedure
+class ProcedureFootprint {
+public:
+  struct Row {
+    std::size_t table_id, partition_id;
+    bool write;
+  };
+
+  template <class KeyType, class ValueType>
+  void read(std::size_t table_id, std::size_t partition_id, const KeyType &,
+            ValueType &) {
+    rows.push_back({table_id, partition_id, false});
+  }
+
+  template <class KeyType, class ValueType>
+  void write(std::size_t table_id, std::size_t partition_id, const KeyType &,
+             ValueType &) {
+    rows.push_back({table_id, partition_id, true});
+  }
+
+  std::vector<Row> rows;
+};
+
+template <class Transaction, class Database, class Procedure>
+class ProcedureTransaction : public Transaction {
+public:
+  using DatabaseType = Database;
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+  using ArgsType = typename Procedure::ArgsType;
+
+  ProcedureTransaction(std::size_t coordinator_id, std::size_t partition_id,
+                       const ContextType &context, RandomType &random,
+                       Partitioner &partitioner, const ArgsType &args)
+      : Transaction(coordinator_id, partition_id, partitioner),
+        context(context), random(random), partition_id(partition_id),
+        args(args) {}
+
+  ~ProcedureTransaction() override = default;
+
+  TransactionResult execute(std::size_t worker_id) override {
+    ProcedureSearch<Transaction> search(*this);
+    Procedure::declare(context, args, rows, search);
+    if (this->process_requests(worker_id)) {
+      return TransactionResult::ABORT;
+    }
+
+    auto result = Procedure::run(context, args, rows);
+    if (result != TransactionResult::READY_TO_COMMIT) {
+      return result;
+    }
+    ProcedureUpdate<Transaction> update(*this);
+    Procedure::declare(context, args, rows, update);
+    return TransactionResult::READY_TO_COMMIT;
+  }
+
+  void reset_query() override {
+    Procedure::generate(context, partition_id, random, args);
+  }
+
+  // renews the transaction on partition_id with args, see TransactionPool
+  void renew(std::size_t partition_id, const ArgsType &args) {
+    Transaction::partition_id = partition_id;
+    this->partition_id = partition_id;
+    this->startTime = Clock::now();
+    this->reset();
+    this->args = args;
+  }
+
+  const ArgsType &get_args() const { return args; }
+
+private:
+  const ContextType &context;
+  RandomType &random;
+  std::size_t partition_id;
+  ArgsType args;
+  typename Procedure::RowsType rows;
+};
+
+// specialize for the Context of a workload to register procedures with it,
+// e.g., registry.template add<Transfer>() in apply(registry)
+template <class Context> struct RegisterProcedures {
+  template <class Registry> static void apply(Registry &) {}
+};
+
+/*
+ * The procedures of a workload, by id. A workload has one per executor and
+ * makes the registered procedures through it, on the transaction base of
+ * its protocol, see Workload::next_transaction and
+ * Workload::submitted_transaction.
+ */
+
+template <class Transaction, class Database> class ProcedureRegistry {
+public:
+  using DatabaseType = Database;
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+  using PoolType = TransactionPool<Transaction>;
+
+  ProcedureRegistry(std::size_t coordinator_id, RandomType &random,
+                    Partitioner &partitioner)
+      : coordinator_id(coordinator_id), random(random),
+        partitioner(partitioner) {
+    RegisterProcedures<ContextType>::apply(*this);
+  }
+
+  template <class Procedure> void add() {
+    const uint32_t id = Procedure::id;
+    CHECK(id >= FIRST_PROCEDURE_ID)
+        << "procedure " << id << " takes the id of a workload transaction.";
+    CHECK(!contains(id)) << "procedure " << id << " is registered twice.";
+    if (entries.size() <= id - FIRST_PROCEDURE_ID) {
+      entries.resize(id - FIRST_PROCEDURE_ID + 1);
+    }
+    entries[id - FIRST_PROCEDURE_ID] = {&generate<Procedure>,
+                                        &submit<Procedure>};
+  }
+
+  bool contains(uint32_t id) const { return find(id) != nullptr; }
+
+  std::size_t size() const {
+    std::size_t n = 0;
+    for (auto &entry : entries) {
+      n += entry.generate != nullptr;
+    }
+    return n;
+  }
+
+  // procedure id on partition_id with generated args
+  std::unique_ptr<Transaction> generated(const ContextType &context,
+                                         uint32_t id, std::size_t partition_id,
+                                         PoolType *pool = nullptr) {
+    auto entry = find(id);
+    CHECK(entry != nullptr) << "procedure " << id << " is not registered.";
+    return entry->generate(*this, context, partition_id, pool);
+  }
+
+  // nullptr unless procedure id is registered, args are valid and the home
+  // partition is mastered on this coordinator
+  std::unique_ptr<Transaction> submitted(const ContextType &context,
+                                         uint32_t id, StringPiece args,
+                                         PoolType *pool = nullptr) {
+    auto entry = find(id);
+    if (entry == nullptr) {
+      return nullptr;
+    }
+    return entry->submit(*this, context, args, pool);
+  }
+
+private:
+  using Generate = std::unique_ptr<Transaction> (*)(ProcedureRegistry &,
+                                                    const ContextType &,
+                                                    std::size_t, PoolType *);
+  using Submit = std::unique_ptr<Transaction> (*)(ProcedureRegistry &,
+                                                  const ContextType &,
+                                                  StringPiece, PoolType *);
+
+  struct Entry {
+    Generate generate = nullptr;
+    Submit submit = nullptr;
+  };
+
+  const Entry *find(uint32_t id) const {
+    if (id < FIRST_PROCEDURE_ID || id - FIRST_PROCEDURE_ID >= entries.size()) {
+      return nullptr;
+    }
+    auto &entry = entries[id - FIRST_PROCEDURE_ID];
+    return entry.generate == nullptr ? nullptr : &entry;
+  }
+
+  template <class Procedure>
+  static std::unique_ptr<Transaction>
+  generate(ProcedureRegistry &registry, const ContextType &context,
+           std::size_t partition_id, PoolType *pool) {
+    typename Procedure::ArgsType args;
+    Procedure::generate(context, partition_id, registry.random, args);
+    return registry.make<Procedure>(context, partition_id, args, pool);
+  }
+
+  template <class Procedure>
+  static std::unique_ptr<Transaction>
+  submit(ProcedureRegistry &registry, const ContextType &context,
+         StringPiece bytes, PoolType *pool) {
+    typename Procedure::ArgsType args;
+    if (!Procedure::decode(context, bytes, args)) {
+      return nullptr;
+    }
+    typename Procedure::RowsType rows;
+    ProcedureFootprint footprint;
+    Procedure::declare(context, args, rows, footprint);
+    if (footprint.rows.empty()) {
+      return nullptr;
+    }
+    auto partition_id = footprint.rows[0].partition_id;
+    if (!registry.partitioner.has_master_partition(partition_id)) {
+      return nullptr;
+    }
+    return registry.make<Procedure>(context, partition_id, args, pool);
+  }
+
+  template <class Procedure>
+  std::unique_ptr<Transaction>
+  make(const ContextType &context, std::size_t partition_id,
+       const typename Procedure::ArgsType &args, PoolType *pool) {
+    using T = ProcedureTransaction<Transaction, Database, Procedure>;
+    if (pool != nullptr) {
+      auto p = pool->template take<T>();
+      if (p != nullptr) {
+        static_cast<T &>(*p).renew(partition_id, args);
+        return p;
+      }
+    }
+    std::unique_ptr<Transaction> p = std::make_unique<T>(
+        coordinator_id, partition_id, context, random, partitioner, args);
+    p->procedure_id = Procedure::id;
+    return p;
+  }
+
+private:
+  std::size_t coordinator_id;
+  RandomType &random;
+  Partitioner &partitioner;
+  std::vector<Entry> entries;
+};
+
+} // namespace coco
@@ -0,0 +1,427 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <execinfo.h>
+#include <fstream>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace coco {
+
+/*
+ * With --profile_path, the threads of a coordinator, i.e., its incoming and
+ * outgoing dispatchers, executors and manager, register with the Profiler,
+ * which samples their call stacks on SIGPROF. Each thread has a timer on its
+ * own cpu clock, so that a thread is sampled in proportion to the cpu time it
+ * uses, at most once per kernel tick, and keeps the last CAPACITY samples in
+ * a ring. The sampling runs for the whole run, or with --profile_on_signal
+ * from one SIGUSR2 to the next, see Coordinator::update_profiler.
+ *
+ * A coordinator writes the samples of its threads in the pprof format, i.e.,
+ * an uncompressed profile.proto, with the role and the index of a thread as
+ * labels, e.g., go tool pprof -tagfocus=role=Executor bench_tpcc 0.pb. The
+ * addresses are symbolized by pprof with the binary.
+ */
+
+class Profiler {
+public:
+  static constexpr std::size_t CAPACITY = 1 << 14;
+  static constexpr std::size_t MAX_DEPTH = 32;
+
+  // called by a thread to be sampled, role must outlive the profiler, e.g.,
+  // a string literal
+  static void register_thread(std::size_t coordinator_id, const char *role,
+                              std::size_t index) {
+    // the first backtrace loads the unwinder, which is not signal safe
+    void *pcs[1];
+    backtrace(pcs, 1);
+
+    auto thread = std::make_unique<Thread>();
+    thread->coordinator_id = coordinator_id;
+    thread->role = role;
+    thread->index = index;
+    thread->tid = syscall(SYS_gettid);
+    thread->handle = pthread_self();
+    thread->samples.resize(CAPACITY * (MAX_DEPTH + 1));
+
+    std::lock_guard<std::mutex> guard(mutex());
+    threads().push_back(std::move(thread));
+    thread_state() = threads().back().get();
+    thread_exit().thread = threads().back().get();
+    if (hz() > 0) {
+      arm(*threads().back());
+    }
+  }
+
+  static bool running() {
+    std::lock_guard<std::mutex> guard(mutex());
+    return hz() > 0;
+  }
+
+  // samples the registered threads hz times per second of their cpu time
+  static void start(int hz) {
+    CHECK(hz > 0);
+    std::lock_guard<std::mutex> guard(mutex());
+    if (Profiler::hz() > 0) {
+      return;
+    }
+    static std::once_flag installed;
+    std::call_once(installed, []() {
+      struct sigaction action;
+      std::memset(&action, 0, sizeof(action));
+      action.sa_sigaction = handle;
+      action.sa_flags = SA_SIGINFO | SA_RESTART;
+      sigemptyset(&action.sa_mask);
+      CHECK(sigaction(SIGPROF, &action, nullptr) == 0);
+    });
+    Profiler::hz() = sampled_hz() = hz;
+    start_time() = now();
+    for (auto &thread : threads()) {
+      thread->n.store(0);
+      arm(*thread);
+    }
+  }
+
+  static void stop() {
+    std::lock_guard<std::mutex> guard(mutex());
+    for (auto &thread : threads()) {
+      disarm(*thread);
+    }
+    if (hz() > 0) {
+      duration() = now() - start_time();
+    }
+    hz() = 0;
+  }
+
+  // called once stopped, writes the samples of the threads of a coordinator
+  static void dump(const std::string &filename, std::size_t coordinator_id) {
+    std::lock_guard<std::mutex> guard(mutex());
+    auto profile = encode(coordinator_id);
+    std::ofstream out(filename, std::ios::binary);
+    CHECK(out) << "failed to open " << filename;
+    out.write(profile.data(), profile.size());
+    LOG(INFO) << "Coordinator " << coordinator_id << " wrote a profile to "
+              << filename;
+  }
+
+  // with --profile_on_signal, the # of SIGUSR2 received so far
+  static void install_signal() {
+    signal(SIGUSR2, [](int) { n_signals().fetch_add(1); });
+  }
+
+  static uint64_t get_n_signals() { return n_signals().load(); }
+
+private:
+  struct Thread {
+    std::size_t coordinator_id = 0;
+    const char *role = "";
+    std::size_t index = 0;
+    pid_t tid = 0;
+    pthread_t handle;
+    timer_t timer;
+    bool armed = false, exited = false;
+    // a sample is the depth and the pcs, the leaf first
+    std::vector<uint64_t> samples;
+    std::atomic<uint64_t> n{0};
+  };
+
+  // disarms the timer of a thread once it exits
+  struct ThreadExit {
+    Thread *thread = nullptr;
+
+    ~ThreadExit() {
+      if (thread != nullptr) {
+        std::lock_guard<std::mutex> guard(mutex());
+        disarm(*thread);
+        thread->exited = true;
+        thread_state() = nullptr;
+      }
+    }
+  };
+
+  static void arm(Thread &thread) {
+    if (thread.armed || thread.exited) {
+      return;
+    }
+    clockid_t clock;
+    if (pthread_getcpuclockid(thread.handle, &clock) != 0) {
+      return;
+    }
+    sigevent event;
+    std::memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = thread.tid;
+    if (timer_create(clock, &event, &thread.timer) != 0) {
+      LOG(WARNING) << "failed to create a profiling timer, errno: " << errno;
+      return;
+    }
+    auto period = 1000000000ull / hz();
+    itimerspec spec;
+    spec.it_interval.tv_sec = period / 1000000000;
+    spec.it_interval.tv_nsec = period % 1000000000;
+    spec.it_value = spec.it_interval;
+    timer_settime(thread.timer, 0, &spec, nullptr);
+    thread.armed = true;
+  }
+
+  static void disarm(Thread &thread) {
+    if (thread.armed) {
+      timer_delete(thread.timer);
+      thread.armed = false;
+    }
+  }
+
+  static void handle(int, siginfo_t *, void *) {
+    auto thread = thread_state();
+    if (thread == nullptr) {
+      return;
+    }
+    auto saved_errno = errno;
+    // the handler and the signal frame come first
+    static constexpr int SKIP = 2;
+    void *pcs[MAX_DEPTH + SKIP];
+    int depth = std::max(backtrace(pcs, MAX_DEPTH + SKIP) - SKIP, 0);
+    auto n = thread->n.load(std::memory_order_relaxed);
+    auto sample = &thread->samples[(n % CAPACITY) * (MAX_DEPTH + 1)];
+    sample[0] = depth;
+    for (auto i = 0; i < depth; i++) {
+      sample[i + 1] = reinterpret_cast<uint64_t>(pcs[i + SKIP]);
+    }
+    thread->n.store(n + 1, std::memory_order_release);
+    errno = saved_errno;
+  }
+
+  // a minimal protocol buffer writer for profile.proto
+  class Proto {
+  public:
+    void varint(uint64_t v) {
+      while (v >= 0x80) {
+        bytes.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+      }
+      bytes.push_back(static_cast<char>(v));
+    }
+
+    void number(int field, uint64_t v) {
+      varint(static_cast<uint64_t>(field) << 3);
+      varint(v);
+    }
+
+    void string(int field, const std::string &s) {
+      varint(static_cast<uint64_t>(field) << 3 | 2);
+      varint(s.size());
+      bytes.append(s);
+    }
+
+    void packed(int field, const std::vector<uint64_t> &vs) {
+      Proto p;
+      for (auto v : vs) {
+        p.varint(v);
+      }
+      string(field, p.bytes);
+    }
+
+    std::string bytes;
+  };
+
+  struct Mapping {
+    uint64_t start, limit, offset;
+    std::string filename;
+  };
+
+  // the executable mappings of the process
+  static std::vector<Mapping> read_mappings() {
+    std::vector<Mapping> mappings;
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+      unsigned long long start, limit, offset;
+      char perms[5];
+      int pos = 0;
+      if (sscanf(line.c_str(), "%llx-%llx %4s %llx %*s %*s %n", &start,
+                 &limit, perms, &offset, &pos) < 4 ||
+          perms[2] != 'x' || pos == 0 ||
+          static_cast<std::size_t>(pos) >= line.size()) {
+        continue;
+      }
+      mappings.push_back(Mapping{start, limit, offset, line.substr(pos)});
+    }
+    return mappings;
+  }
+
+  static std::string encode(std::size_t coordinator_id) {
+    std::vector<std::string> strings{""};
+    std::map<std::string, uint64_t> string_ids{{"", 0}};
+    auto intern = [&](const std::string &s) {
+      auto it = string_ids.find(s);
+      if (it != string_ids.end()) {
+        return it->second;
+      }
+      strings.push_back(s);
+      return string_ids[s] = strings.size() - 1;
+    };
+
+    // the # of samples of each thread and stack, the leaf pc is exact and
+    // the others are return addresses, which are moved into the call
+    std::map<std::pair<const Thread *, std::vector<uint64_t>>, uint64_t> stacks;
+    for (auto &thread : threads()) {
+      if (thread->coordinator_id != coordinator_id) {
+        continue;
+      }
+      auto n = thread->n.load(std::memory_order_acquire);
+      for (auto i = n > CAPACITY ? n - CAPACITY : 0; i < n; i++) {
+        auto sample = &thread->samples[(i % CAPACITY) * (MAX_DEPTH + 1)];
+        std::vector<uint64_t> pcs(sample + 1, sample + 1 + sample[0]);
+        for (auto k = 1u; k < pcs.size(); k++) {
+          pcs[k]--;
+        }
+        stacks[{thread.get(), pcs}]++;
+      }
+    }
+
+    Proto profile;
+    auto value_type = [&](int field, const char *type, const char *unit) {
+      Proto p;
+      p.number(1, intern(type));
+      p.number(2, intern(unit));
+      profile.string(field, p.bytes);
+    };
+    value_type(1, "samples", "count");
+    value_type(1, "cpu", "nanoseconds");
+
+    auto period = 1000000000ull / std::max(sampled_hz(), 1);
+    std::map<uint64_t, uint64_t> locations;
+    for (auto &stack : stacks) {
+      Proto sample;
+      std::vector<uint64_t> ids;
+      for (auto pc : stack.first.second) {
+        auto it = locations.emplace(pc, locations.size() + 1).first;
+        ids.push_back(it->second);
+      }
+      sample.packed(1, ids);
+      sample.packed(2, {stack.second, stack.second * period});
+      Proto role, index;
+      role.number(1, intern("role"));
+      role.number(2, intern(stack.first.first->role));
+      sample.string(3, role.bytes);
+      index.number(1, intern("index"));
+      index.number(3, stack.first.first->index);
+      sample.string(3, index.bytes);
+      profile.string(2, sample.bytes);
+    }
+
+    auto mappings = read_mappings();
+    for (auto i = 0u; i < mappings.size(); i++) {
+      Proto p;
+      p.number(1, i + 1);
+      p.number(2, mappings[i].start);
+      p.number(3, mappings[i].limit);
+      p.number(4, mappings[i].offset);
+      p.number(5, intern(mappings[i].filename));
+      profile.string(3, p.bytes);
+    }
+    for (auto &location : locations) {
+      Proto p;
+      p.number(1, location.second);
+      for (auto i = 0u; i < mappings.size(); i++) {
+        if (location.first >= mappings[i].start &&
+            location.first < mappings[i].limit) {
+          p.number(2, i + 1);
+          break;
+        }
+      }
+      p.number(3, location.first);
+      profile.string(4, p.bytes);
+    }
+
+    Proto period_type;
+    period_type.number(1, intern("cpu"));
+    period_type.number(2, intern("nanoseconds"));
+    profile.string(11, period_type.bytes);
+    profile.number(12, period);
+    profile.number(9, start_time());
+    profile.number(10, duration());
+    for (auto &s : strings) {
+      profile.string(6, s);
+    }
+    return profile.bytes;
+  }
+
+  static uint64_t now() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  }
+
+  static std::mutex &mutex() {
+    static std::mutex m;
+    return m;
+  }
+
+  // the threads are kept till the process exits, like their samples
+  static std::vector<std::unique_ptr<Thread>> &threads() {
+    static std::vector<std::unique_ptr<Thread>> ts;
+    return ts;
+  }
+
+  static Thread *&thread_state() {
+    thread_local Thread *thread = nullptr;
+    return thread;
+  }
+
+  static ThreadExit &thread_exit() {
+    thread_local ThreadExit exit;
+    return exit;
+  }
+
+  // 0 unless running
+  static int &hz() {
+    static int h = 0;
+    return h;
+  }
+
+  // the rate of the last start
+  static int &sampled_hz() {
+    static int h = 0;
+    return h;
+  }
+
+  static uint64_t &start_time() {
+    static uint64_t t = 0;
+    return t;
+  }
+
+  static uint64_t &duration() {
+    static uint64_t d = 0;
+    return d;
+  }
+
+  static std::atomic<uint64_t> &n_signals() {
+    static std::atomic<uint64_t> n{0};
+    return n;
+  }
+};
+} // namespace coco
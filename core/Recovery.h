@@ -0,0 +1,195 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#pragma once
+
+#include "core/Checkpoint.h"
+#include "core/Context.h"
+#include "core/Partitioner.h"
+#include "core/RedoLog.h"
+#include "core/Table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <glog/logging.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Recovery rebuilds the local partitions from --log_path after the loader
+ *  has run.
+ *
+ *  1. The checkpoint of each table partition is loaded, in parallel.
+ *  2. The redo logs of all coordinators are read, one thread per file, and
+ *     the records are bucketed by table partition. Only epochs that are
+ *     durable in every log are kept, since a later epoch was never
+ *     acknowledged.
+ *  3. Each thread replays a set of table partitions, walking the logs epoch
+ *     by epoch. A record is applied only if its commit timestamp is larger than
+ *     the row's, so the order of the logs does not matter and records older
+ *     than the checkpoint are skipped.
+ *  4. A new checkpoint is taken, since the logs are truncated once the
+ *     executors start.
+ */
+
+template <class Database> class Recovery {
+public:
+  Recovery(std::size_t coordinator_id, Database &db, const Context &context)
+      : coordinator_id(coordinator_id), db(db), context(context),
+        partitioner(PartitionerFactory::create_partitioner(
+            context.partitioner, coordinator_id, context.coordinator_num)) {}
+
+  void run() {
+    CHECK(!context.log_path.empty()) << "recovery requires --log_path.";
+    CHECK(!context.mvcc) << "mvcc tables are not logged.";
+
+    auto start = std::chrono::steady_clock::now();
+
+    tables = db.local_tables(*partitioner);
+    for (auto i = 0u; i < tables.size(); i++) {
+      table_index[table_key(tables[i]->tableID(), tables[i]->partitionID())] =
+          i;
+    }
+
+    load_checkpoints();
+    read_logs();
+    replay();
+    take_checkpoints();
+
+    LOG(INFO) << "Coordinator " << coordinator_id << " recovered "
+              << tables.size() << " tables in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count()
+              << " milliseconds.";
+  }
+
+private:
+  static uint64_t table_key(uint64_t table_id, uint64_t partition_id) {
+    return (table_id << 32) | partition_id;
+  }
+
+  // call func(i) for i in [0, n) on worker_num threads
+  template <class Func> void parallel_for(std::size_t n, Func func) {
+    std::size_t threadsNum = context.worker_num;
+    std::vector<std::thread> v;
+    for (auto threadID = 0u; threadID < threadsNum; threadID++) {
+      v.emplace_back([=]() {
+        for (auto i = threadID; i < n; i += threadsNum) {
+          func(i);
+        }
+      });
+    }
+    for (auto &t : v) {
+      t.join();
+    }
+  }
+
+  void load_checkpoints() {
+    std::atomic<std::size_t> n_loaded(0);
+    parallel_for(tables.size(), [this, &n_loaded](std::size_t i) {
+      uint64_t epoch;
+      auto filename = Checkpoint::file_name(
+          context.log_path, tables[i]->tableID(), tables[i]->partitionID());
+      if (Checkpoint::load(*tables[i], filename, epoch)) {
+        n_loaded.fetch_add(1);
+      }
+    });
+    LOG(INFO) << "loaded " << n_loaded.load() << " checkpoints.";
+  }
+
+  void read_logs() {
+    for (auto i = 0u; i < context.coordinator_num; i++) {
+      for (auto k = 0u;; k++) {
+        std::string bytes;
+        if (!Checkpoint::read_file(
+                RedoLog::file_name(context.log_path, i, k), bytes)) {
+          break;
+        }
+        logs.push_back(std::move(bytes));
+      }
+    }
+
+    // records of each log by epoch and table
+    records.resize(logs.size());
+    std::vector<std::size_t> n_epochs(logs.size());
+
+    parallel_for(logs.size(), [this, &n_epochs](std::size_t i) {
+      StringPiece piece(logs[i]);
+      RedoLogRecord record;
+      std::vector<std::vector<RedoLogRecord>> epoch(tables.size());
+      while (RedoLog::next(piece, record)) {
+        if (record.is_epoch()) {
+          records[i].push_back(std::move(epoch));
+          epoch.clear();
+          epoch.resize(tables.size());
+          continue;
+        }
+        auto it =
+            table_index.find(table_key(record.table_id, record.partition_id));
+        if (it != table_index.end()) {
+          epoch[it->second].push_back(record);
+        }
+      }
+      // records after the last marker are dropped
+      n_epochs[i] = records[i].size();
+    });
+
+    if (!logs.empty()) {
+      n_durable_epochs = *std::min_element(n_epochs.begin(), n_epochs.end());
+    }
+    LOG(INFO) << "read " << logs.size() << " logs, " << n_durable_epochs
+              << " epochs are durable.";
+  }
+
+  void replay() {
+    std::atomic<std::size_t> n_applied(0);
+
+    parallel_for(tables.size(), [this, &n_applied](std::size_t i) {
+      ITable &table = *tables[i];
+      std::size_t n = 0;
+      for (auto epoch = 0u; epoch < n_durable_epochs; epoch++) {
+        for (auto &log : records) {
+          for (auto &record : log[epoch][i]) {
+            const void *key = record.key.data();
+            auto &tid = table.search_metadata(key);
+            if (record.commit_ts > tid.load()) {
+              table.deserialize_value(key, record.value);
+              tid.store(record.commit_ts);
+              n++;
+            }
+          }
+        }
+      }
+      n_applied.fetch_add(n);
+    });
+
+    LOG(INFO) << "applied " << n_applied.load() << " log records.";
+  }
+
+  void take_checkpoints() {
+    parallel_for(tables.size(), [this](std::size_t i) {
+      auto filename = Checkpoint::file_name(
+          context.log_path, tables[i]->tableID(), tables[i]->partitionID());
+      Checkpoint::write(*tables[i], filename, 0);
+    });
+  }
+
+private:
+  std::size_t coordinator_id;
+  Database &db;
+  const Context &context;
+  std::unique_ptr<Partitioner> partitioner;
+  std::vector<ITable *> tables;
+  std::unordered_map<uint64_t, std::size_t> table_index;
+  std::vector<std::string> logs;
+  // records[log][epoch][table]
+  std::vector<std::vector<std::vector<std::vector<RedoLogRecord>>>> records;
+  std::size_t n_durable_epochs = 0;
+};
+} // namespace coco
@@ -0,0 +1,119 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/StringPiece.h"
+#include "core/Table.h"
+
+#include <boost/algorithm/string.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Epoch-based redo log -- format --
+ *
+ *  Each worker appends the write sets of the transactions it commits to its
+ *  own file, <log dir>/<coordinator id>_<worker id>.log. An epoch is one
+ *  group of group commit, and the epoch marker is appended (and the file is
+ *  synced) once the worker has stopped in that group. Everything before the
+ *  last epoch marker is durable; a torn tail is ignored, and so are zeros
+ *  left by preallocation or block padding (no record has an empty key).
+ *
+ *  --log_path is a list of directories separated by ',', e.g., one per
+ *  device, and the files are striped across them, worker i logs to the
+ *  directory i % n, see directory, so the files are synced by n devices in
+ *  parallel. An epoch is durable once it is in every file, see
+ *  group_commit::DurableWatermark.
+ *
+ *  record: [ table id (32) | partition id (32) | commit ts (64) |
+ *            key size (32) | value size (32) | key | serialized value ]
+ *  epoch:  [ EPOCH_MARKER (32) | 0 (32) | epoch (64) | 0 (32) | 0 (32) ]
+ */
+
+struct RedoLogRecord {
+  uint32_t table_id;
+  uint32_t partition_id;
+  uint64_t commit_ts;
+  StringPiece key;
+  StringPiece value;
+
+  static constexpr uint32_t EPOCH_MARKER = 0xffffffff;
+
+  // commit_ts holds the epoch of an epoch marker
+  bool is_epoch() const { return table_id == EPOCH_MARKER; }
+};
+
+class RedoLog {
+public:
+  static constexpr std::size_t HEADER_SIZE = sizeof(uint32_t) * 2 +
+                                             sizeof(uint64_t) +
+                                             sizeof(uint32_t) * 2;
+
+  // the directory of stream i in --log_path, taken round robin
+  static std::string directory(const std::string &log_path, std::size_t i) {
+    std::vector<std::string> dirs;
+    boost::algorithm::split(dirs, log_path, boost::is_any_of(","));
+    auto &dir = dirs[i % dirs.size()];
+    boost::algorithm::trim(dir);
+    return dir;
+  }
+
+  static std::string file_name(const std::string &log_path,
+                               std::size_t coordinator_id,
+                               std::size_t worker_id) {
+    return directory(log_path, worker_id) + "/" +
+           std::to_string(coordinator_id) + "_" + std::to_string(worker_id) +
+           ".log";
+  }
+
+  static void append_record(std::string &bytes, ITable &table, const void *key,
+                            const void *value, uint64_t commit_ts) {
+    Encoder enc(bytes);
+    uint32_t key_size = table.key_size();
+    enc << static_cast<uint32_t>(table.tableID())
+        << static_cast<uint32_t>(table.partitionID()) << commit_ts << key_size
+        << uint32_t(0);
+    // value size is patched once the value is serialized
+    auto value_size_offset = bytes.size() - sizeof(uint32_t);
+    enc.write_n_bytes(key, key_size);
+    auto value_offset = bytes.size();
+    table.serialize_value(enc, value);
+    uint32_t value_size = bytes.size() - value_offset;
+    memcpy(&bytes[value_size_offset], &value_size, sizeof(uint32_t));
+  }
+
+  static void append_epoch(std::string &bytes, uint64_t epoch) {
+    Encoder enc(bytes);
+    enc << uint32_t(RedoLogRecord::EPOCH_MARKER) << uint32_t(0) << epoch
+        << uint32_t(0) << uint32_t(0);
+  }
+
+  // returns false at the end of bytes or on a torn record
+  static bool next(StringPiece &bytes, RedoLogRecord &record) {
+    if (bytes.size() < HEADER_SIZE) {
+      return false;
+    }
+    uint32_t key_size, value_size;
+    Decoder dec(bytes);
+    dec >> record.table_id >> record.partition_id >> record.commit_ts >>
+        key_size >> value_size;
+    if (key_size == 0 && !record.is_epoch()) {
+      return false;
+    }
+    if (bytes.size() < HEADER_SIZE + key_size + value_size) {
+      return false;
+    }
+    const char *data = bytes.data() + HEADER_SIZE;
+    record.key = StringPiece(data, key_size);
+    record.value = StringPiece(data + key_size, value_size);
+    bytes.remove_prefix(HEADER_SIZE + key_size + value_size);
+    return true;
+  }
+};
+} // namespace coco
@@ -0,0 +1,329 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/LZ4.h"
+#include "common/RateLimiter.h"
+#include "core/Checkpoint.h"
+#include "core/Context.h"
+#include "core/ControlMessage.h"
+#include "core/Migrator.h"
+#include "core/Partitioner.h"
+#include "core/Table.h"
+#include "core/Worker.h"
+
+#include <chrono>
+#include <deque>
+#include <glog/logging.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Replica rebuild -- format --
+ *
+ *  A coordinator in --rebuild_replicas, e.g., one that replaces a backup,
+ *  does not generate the partitions it only replicates, see
+ *  Context::rebuilds_replicas, and its rebuilder requests each of them from
+ *  its master once the coordinators are connected. It takes part in the
+ *  replication from the first epoch on, so the writes to a partition arrive
+ *  while the partition is streamed.
+ *
+ *  The rebuilder of the master streams the rows of the partition, each row
+ *  read optimistically as in a checkpoint, in LZ4 compressed chunks of about
+ *  BATCH_BYTES behind the transactions in the async lane, at most
+ *  --migration_bandwidth MB/s, while the transactions keep committing. The
+ *  replica applies a row only if it is newer than its own, see
+ *  Migrator::apply_rows, so the stream and the replication can arrive in any
+ *  order, and once the done message of the partition arrives, the partition
+ *  is as recent as the replication stream, which it follows from then on.
+ *
+ *  request: ()
+ *  rows:    [ raw size (32) | LZ4 block of redo log records, see RedoLog ]
+ *  done:    [ rows (64) ]
+ *
+ *  Only the protocols whose replicas are only written by replication can
+ *  rebuild, see Macros.h.
+ */
+
+class ReplicaRebuilder : public Worker {
+public:
+  ReplicaRebuilder(std::size_t coordinator_id, std::size_t id,
+                   const Context &context,
+                   std::vector<std::vector<ITable *>> tables,
+                   std::atomic<bool> &stopFlag)
+      : Worker(coordinator_id, id), context(context), tables(std::move(tables)),
+        stopFlag(stopFlag),
+        partitioner(PartitionerFactory::create_partitioner(
+            context.partitioner, coordinator_id, context.coordinator_num)) {
+
+    for (auto i = 0u; i < context.coordinator_num; i++) {
+      messages.emplace_back(std::make_unique<Message>());
+      init_message(messages[i].get(), i);
+    }
+
+    if (context.rebuilds_replicas()) {
+      for (auto i = 0u; i < this->tables.size(); i++) {
+        if (partitioner->is_partition_replicated_on_me(i) &&
+            !partitioner->has_master_partition(i)) {
+          pending.push_back(i);
+        }
+      }
+    }
+  }
+
+  void start() override {
+
+    LOG(INFO) << "ReplicaRebuilder(worker id = " << id << ") starts, "
+              << pending.size() << " partitions to rebuild.";
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (auto partition_id : pending) {
+      new_request_message(
+          *messages[partitioner->master_coordinator(partition_id)],
+          partition_id);
+    }
+    flush_messages();
+
+    while (!stopFlag.load()) {
+      std::size_t n = process_request();
+      if (!streams.empty()) {
+        stream(streams.front().first, streams.front().second);
+        streams.pop_front();
+        n++;
+      }
+      if (!pending.empty() && n_rebuilt == pending.size()) {
+        LOG(INFO) << "ReplicaRebuilder rebuilt " << n_rebuilt
+                  << " partitions, " << n_received_rows << " rows in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - startTime)
+                         .count()
+                  << " ms.";
+        pending.clear();
+      }
+      if (n == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+
+    LOG(INFO) << "ReplicaRebuilder(worker id = " << id << ") exits, "
+              << n_sent_rows << " rows sent in " << n_sent_bytes
+              << " bytes, " << n_received_rows << " rows received.";
+  }
+
+  void push_message(Message *message) override { in_queue.push(message); }
+
+  Message *pop_message() override { return nullptr; }
+
+  // the rows go in the async lane, behind the transactions
+  Message *pop_async_message() override {
+    if (out_queue.empty())
+      return nullptr;
+
+    Message *message = out_queue.front();
+    bool ok = out_queue.pop();
+    CHECK(ok);
+    return message;
+  }
+
+  static std::size_t new_request_message(Message &message,
+                                         std::size_t partition_id) {
+    /*
+     * The structure of a rebuild request: ()
+     */
+
+    auto message_size = MessagePiece::get_header_size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::REBUILD_REQUEST), message_size, 0,
+        partition_id);
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    message.flush();
+    return message_size;
+  }
+
+  // compresses rows into a rows message of table, returns its size
+  static std::size_t new_rows_message(Message &message, ITable &table,
+                                      const std::string &rows,
+                                      std::string &block) {
+    /*
+     * The structure of a rebuild rows message: (raw size, LZ4 block)
+     */
+
+    block.resize(LZ4::compress_bound(rows.size()));
+    block.resize(LZ4::compress(rows.data(), rows.size(), &block[0]));
+
+    auto message_size =
+        MessagePiece::get_header_size() + sizeof(uint32_t) + block.size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::REBUILD_ROWS), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header << static_cast<uint32_t>(rows.size());
+    encoder.write_n_bytes(block.data(), block.size());
+    message.flush();
+    return message_size;
+  }
+
+  // applies the rows of a rows message that are newer than the table's,
+  // returns the number of rows in it
+  static std::size_t apply_rows_message(ITable &table, StringPiece bytes,
+                                        std::string &rows) {
+    uint32_t raw_size;
+    Decoder dec(bytes);
+    dec >> raw_size;
+    bytes.remove_prefix(sizeof(uint32_t));
+    rows.resize(raw_size);
+    CHECK(LZ4::decompress(bytes.data(), bytes.size(), &rows[0], raw_size))
+        << "a corrupted chunk of partition " << table.partitionID();
+    return Migrator::apply_rows(table, StringPiece(rows.data(), rows.size()));
+  }
+
+  static std::size_t new_done_message(Message &message,
+                                      std::size_t partition_id,
+                                      uint64_t n_rows) {
+    /*
+     * The structure of a rebuild done message: (rows)
+     */
+
+    auto message_size = MessagePiece::get_header_size() + sizeof(uint64_t);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::REBUILD_DONE), message_size, 0,
+        partition_id);
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header << n_rows;
+    message.flush();
+    return message_size;
+  }
+
+public:
+  // rows are sent in chunks of about this many bytes before compression
+  static constexpr std::size_t BATCH_BYTES = 256 * 1024;
+
+private:
+  void stream(std::size_t partition_id, std::size_t dest) {
+    RateLimiter limiter(context.migration_bandwidth * 1024 * 1024);
+    std::string rows, block;
+    uint64_t n_rows = 0;
+
+    for (auto table : tables[partition_id]) {
+      auto send = [&]() {
+        n_sent_bytes += new_rows_message(*messages[dest], *table, rows, block);
+        flush_messages();
+        limiter.consume(block.size());
+        rows.clear();
+      };
+      table->for_each_row([&](const void *key, ITable::MetaDataType &metadata,
+                              void *value) {
+        Checkpoint::append_row(rows, *table, key, metadata, value);
+        n_rows++;
+        if (rows.size() >= BATCH_BYTES) {
+          send();
+          // the other rebuilders stream to us as well
+          process_request();
+        }
+      });
+      if (!rows.empty()) {
+        send();
+      }
+    }
+
+    new_done_message(*messages[dest], partition_id, n_rows);
+    flush_messages();
+    n_sent_rows += n_rows;
+    LOG(INFO) << "ReplicaRebuilder streamed partition " << partition_id
+              << " to coordinator " << dest << ", " << n_rows << " rows.";
+  }
+
+  std::size_t process_request() {
+    std::size_t n = 0;
+
+    while (!in_queue.empty()) {
+      std::unique_ptr<Message> message(in_queue.front());
+      bool ok = in_queue.pop();
+      CHECK(ok);
+
+      for (auto it = message->begin(); it != message->end(); it++) {
+        MessagePiece messagePiece = *it;
+        auto type =
+            static_cast<ControlMessage>(messagePiece.get_message_type());
+        auto partition_id = messagePiece.get_partition_id();
+        switch (type) {
+        case ControlMessage::REBUILD_REQUEST:
+          CHECK(partitioner->has_master_partition(partition_id));
+          streams.emplace_back(partition_id, message->get_source_node_id());
+          break;
+        case ControlMessage::REBUILD_ROWS:
+          n_received_rows += apply_rows_message(
+              *find_table(messagePiece.get_table_id(), partition_id),
+              messagePiece.toStringPiece(), rows_buffer);
+          break;
+        case ControlMessage::REBUILD_DONE:
+          n_rebuilt++;
+          break;
+        default:
+          CHECK(false) << "Message type: " << static_cast<uint32_t>(type);
+          break;
+        }
+      }
+
+      n++;
+      incoming_message_pool.put(message.release());
+    }
+
+    return n;
+  }
+
+  ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    DCHECK(partition_id < tables.size());
+    for (auto table : tables[partition_id]) {
+      if (table->tableID() == table_id) {
+        return table;
+      }
+    }
+    CHECK(false) << "table " << table_id << " does not exist.";
+    return nullptr;
+  }
+
+  void flush_messages() {
+    for (auto i = 0u; i < messages.size(); i++) {
+      if (i == coordinator_id || messages[i]->get_message_count() == 0) {
+        continue;
+      }
+      auto message = messages[i].release();
+      push_outgoing(out_queue, message);
+      messages[i].reset(outgoing_message_pool.get());
+      init_message(messages[i].get(), i);
+    }
+  }
+
+  void init_message(Message *message, std::size_t dest_node_id) {
+    message->set_source_node_id(coordinator_id);
+    message->set_dest_node_id(dest_node_id);
+    message->set_worker_id(id);
+  }
+
+private:
+  const Context &context;
+  std::vector<std::vector<ITable *>> tables;
+  std::atomic<bool> &stopFlag;
+  std::unique_ptr<Partitioner> partitioner;
+  // the partitions this coordinator rebuilds, and the ones it streams
+  std::vector<std::size_t> pending;
+  std::deque<std::pair<std::size_t, std::size_t>> streams;
+  std::size_t n_rebuilt = 0;
+  std::size_t n_sent_rows = 0, n_sent_bytes = 0, n_received_rows = 0;
+  std::string rows_buffer;
+  std::vector<std::unique_ptr<Message>> messages;
+  LockfreeQueue<Message *> in_queue, out_queue;
+};
+} // namespace coco
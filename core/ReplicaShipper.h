@@ -0,0 +1,232 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/LZ4.h"
+#include "common/Socket.h"
+#include "common/StringPiece.h"
+#include "core/Context.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Replication stream of an async replica -- format --
+ *
+ *  Each coordinator ships its epochs of group commit, in order, over one
+ *  connection to --async_replica. A frame holds the redo log records (see
+ *  RedoLog) of an epoch of all workers, LZ4 compressed, and the wall clock
+ *  time the epoch was durable on the coordinator, from which the replica
+ *  computes its lag.
+ *
+ *  hello: [ coordinator id (64) | coordinator num (64) | partition num (64) ]
+ *  frame: [ epoch (64) | time in us (64) | raw size (32) | block size (32) |
+ *           block ]
+ */
+
+struct ReplicationFrame {
+  static constexpr std::size_t HEADER_SIZE =
+      sizeof(uint64_t) * 2 + sizeof(uint32_t) * 2;
+
+  uint64_t epoch = 0;
+  uint64_t time = 0;
+  std::string records;
+
+  // appends the frame of records to bytes
+  static void encode(std::string &bytes, uint64_t epoch, uint64_t time,
+                     const std::string &records) {
+    auto offset = bytes.size();
+    {
+      Encoder enc(bytes);
+      enc << epoch << time << static_cast<uint32_t>(records.size())
+          << uint32_t(0);
+    }
+    // block size is patched once the records are compressed
+    bytes.resize(offset + HEADER_SIZE + LZ4::compress_bound(records.size()));
+    uint32_t block_size = LZ4::compress(records.data(), records.size(),
+                                        &bytes[offset + HEADER_SIZE]);
+    bytes.resize(offset + HEADER_SIZE + block_size);
+    memcpy(&bytes[offset + HEADER_SIZE - sizeof(uint32_t)], &block_size,
+           sizeof(uint32_t));
+  }
+
+  // returns false at the end of bytes or on a torn frame
+  static bool decode(StringPiece &bytes, ReplicationFrame &frame) {
+    if (bytes.size() < HEADER_SIZE) {
+      return false;
+    }
+    uint32_t raw_size, block_size;
+    Decoder dec(bytes);
+    dec >> frame.epoch >> frame.time >> raw_size >> block_size;
+    if (bytes.size() < HEADER_SIZE + block_size) {
+      return false;
+    }
+    frame.records.resize(raw_size);
+    CHECK(LZ4::decompress(bytes.data() + HEADER_SIZE, block_size,
+                          &frame.records[0], raw_size))
+        << "epoch " << frame.epoch << " of the replication stream is corrupt.";
+    bytes.remove_prefix(HEADER_SIZE + block_size);
+    return true;
+  }
+
+  // returns false once the socket is closed
+  static bool read(Socket &socket, ReplicationFrame &frame) {
+    std::string bytes(HEADER_SIZE, 0);
+    if (socket.read_n_bytes(&bytes[0], HEADER_SIZE) == 0) {
+      return false;
+    }
+    uint32_t block_size;
+    memcpy(&block_size, &bytes[HEADER_SIZE - sizeof(uint32_t)],
+           sizeof(uint32_t));
+    bytes.resize(HEADER_SIZE + block_size);
+    CHECK(block_size == 0 ||
+          socket.read_n_bytes(&bytes[HEADER_SIZE], block_size) == block_size)
+        << "the replication stream is torn.";
+    StringPiece piece(bytes);
+    return decode(piece, frame);
+  }
+};
+
+/*
+ * A ReplicaShipper sends the epochs of a coordinator to --async_replica. The
+ * executors hand over the records of an epoch once it is durable, as they
+ * write their redo log, and the n-th epoch of each worker is the n-th epoch
+ * of group commit. The shipper has its own thread, so the replica is never
+ * in the barrier of group commit: epochs queue up while the link is slow, and
+ * the replica lags behind instead.
+ */
+
+class ReplicaShipper {
+public:
+  static ReplicaShipper &of(std::size_t coordinator_id) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<ReplicaShipper>> shippers;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &shipper = shippers[coordinator_id];
+    if (shipper == nullptr) {
+      shipper = std::make_unique<ReplicaShipper>();
+    }
+    return *shipper;
+  }
+
+  // connects to the replica, before the executors start
+  void connect(std::size_t coordinator_id, const Context &context) {
+    constexpr std::size_t retryLimit = 50;
+
+    std::vector<std::string> addressPort;
+    boost::algorithm::split(addressPort, context.async_replica,
+                            boost::is_any_of(":"));
+    CHECK(addressPort.size() == 2)
+        << "--async_replica is host:port, not " << context.async_replica;
+
+    for (auto k = 0u;; k++) {
+      Socket socket;
+      if (socket.connect(addressPort[0].c_str(),
+                         atoi(addressPort[1].c_str())) == 0) {
+        this->socket = std::move(socket);
+        break;
+      }
+      socket.close();
+      CHECK(k < retryLimit - 1) << "failed to connect to the async replica.";
+      LOG(INFO) << "Coordinator " << coordinator_id
+                << " failed to connect to the async replica ("
+                << context.async_replica << "), retry in 5 seconds.";
+      std::this_thread::sleep_for(std::chrono::seconds(5));
+    }
+    socket.write_number(coordinator_id);
+    socket.write_number(context.coordinator_num);
+    socket.write_number(context.partition_num);
+
+    this->coordinator_id = coordinator_id;
+    epochs.resize(context.worker_num);
+    stopFlag.store(false);
+    LOG(INFO) << "Coordinator " << coordinator_id
+              << " ships its epochs to the async replica "
+              << context.async_replica;
+  }
+
+  // called by worker worker_id once its part of the next epoch is durable
+  void ship(std::size_t worker_id, std::string records) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    std::lock_guard<std::mutex> guard(mutex);
+    epochs[worker_id].emplace_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(now).count(),
+        std::move(records));
+  }
+
+  void start() {
+    std::string records, bytes;
+    for (;;) {
+      // the epochs handed over before the stop are shipped
+      bool stop = stopFlag.load();
+      uint64_t time;
+      while (next_epoch(time, records)) {
+        bytes.clear();
+        ReplicationFrame::encode(bytes, n_epochs++, time, records);
+        socket.write_n_bytes(bytes.data(), bytes.size());
+        n_raw_bytes += records.size();
+        n_bytes += bytes.size();
+      }
+      if (stop) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    socket.close();
+
+    LOG(INFO) << "Coordinator " << coordinator_id << " shipped " << n_epochs
+              << " epochs to the async replica, " << n_raw_bytes
+              << " bytes compressed to " << n_bytes << " bytes.";
+  }
+
+  // called once the executors exit
+  void stop() { stopFlag.store(true); }
+
+private:
+  // the records of the next epoch once every worker has handed it over, and
+  // the time its last part was durable
+  bool next_epoch(uint64_t &time, std::string &records) {
+    std::lock_guard<std::mutex> guard(mutex);
+    for (auto &worker : epochs) {
+      if (worker.empty()) {
+        return false;
+      }
+    }
+    time = 0;
+    records.clear();
+    for (auto &worker : epochs) {
+      time = std::max(time, worker.front().first);
+      records += worker.front().second;
+      worker.pop_front();
+    }
+    return true;
+  }
+
+private:
+  std::size_t coordinator_id = 0;
+  Socket socket;
+  std::mutex mutex;
+  // the epochs of each worker that are not shipped yet
+  std::vector<std::deque<std::pair<uint64_t, std::string>>> epochs;
+  std::atomic<bool> stopFlag{false};
+  uint64_t n_epochs = 0;
+  std::size_t n_raw_bytes = 0, n_bytes = 0;
+};
+
+} // namespace coco
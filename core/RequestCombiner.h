@@ -0,0 +1,100 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "core/Table.h"
+
+#include <cstdint>
+#include <cstring>
+#include <glog/logging.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --request_combining and --coroutines, the transactions of a worker
+ * that read the same remote row at the same time share one search request.
+ * The first read of a row sends the request, and the reads of the row issued
+ * before its response arrives wait for it instead, see read. Once the
+ * response is handled for the first read, it is handed to the others, see
+ * respond. A read is identified by its coroutine and the offset of the key in
+ * the read set of its transaction.
+ *
+ * The reads of a row are only combined if they read the same fields, see
+ * FieldProjection. A combined read sees the row as of the first read, which
+ * is validated at commit like any other read.
+ */
+
+class RequestCombiner {
+public:
+  struct Read {
+    std::size_t coroutine_id;
+    uint32_t key_offset;
+  };
+
+  // true if the read sends a request, false if it waits for the one in flight
+  bool read(ITable &table, const void *key, uint64_t fields, Read r) {
+    auto k = row_key(table, key, fields);
+    auto it = in_flight.find(k);
+    if (it == in_flight.end()) {
+      in_flight.emplace(k, std::vector<Read>());
+      first_reads[id_of(r)] = std::move(k);
+      n_requests++;
+      return true;
+    }
+    it->second.push_back(r);
+    n_combined++;
+    return false;
+  }
+
+  // the response to the first read r arrived, calls func(read) on the reads
+  // combined with it
+  template <class Func> void respond(Read r, Func func) {
+    auto first = first_reads.find(id_of(r));
+    if (first == first_reads.end()) {
+      return;
+    }
+    auto it = in_flight.find(first->second);
+    DCHECK(it != in_flight.end());
+    for (auto &read : it->second) {
+      func(read);
+    }
+    in_flight.erase(it);
+    first_reads.erase(first);
+  }
+
+  // the # of rows in flight
+  std::size_t size() const { return in_flight.size(); }
+
+  uint64_t get_requests() const { return n_requests; }
+
+  uint64_t get_combined() const { return n_combined; }
+
+private:
+  static uint64_t id_of(Read r) {
+    return (static_cast<uint64_t>(r.coroutine_id) << 32) | r.key_offset;
+  }
+
+  static std::string row_key(ITable &table, const void *key, uint64_t fields) {
+    auto key_size = table.key_size();
+    std::string k(sizeof(uint64_t) * 2 + key_size, 0);
+    uint64_t id = (static_cast<uint64_t>(table.tableID()) << 32) |
+                  table.partitionID();
+    std::memcpy(&k[0], &id, sizeof(id));
+    std::memcpy(&k[sizeof(id)], &fields, sizeof(fields));
+    std::memcpy(&k[sizeof(id) * 2], key, key_size);
+    return k;
+  }
+
+private:
+  // the reads waiting for each row in flight
+  std::unordered_map<std::string, std::vector<Read>> in_flight;
+  // the row of each first read in flight
+  std::unordered_map<uint64_t, std::string> first_reads;
+  uint64_t n_requests = 0, n_combined = 0;
+};
+} // namespace coco
@@ -0,0 +1,85 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/StringPiece.h"
+#include "core/Table.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace coco {
+
+/*
+ * With --retry_cache, an executor keeps the remote rows its transaction
+ * read, i.e., the value and the tid of each search response, until the
+ * transaction commits or gives up. A retry reads them from the cache instead
+ * of sending the search requests again. A cached row may be stale by then,
+ * but its tid is validated at commit like any other read, see SiloGC, so a
+ * stale row only aborts the retry, and the row of the conflict is dropped
+ * before the next one, see erase.
+ */
+
+class RetryCache {
+public:
+  void put(ITable &table, const void *key, StringPiece value, uint64_t tid) {
+    auto &row = rows[row_key(table, key)];
+    row.tid = tid;
+    row.value.assign(value.data(), value.size());
+  }
+
+  // copies the cached row of key to value, false if there is none
+  bool get(ITable &table, const void *key, void *value, uint64_t &tid) {
+    auto it = rows.find(row_key(table, key));
+    if (it == rows.end()) {
+      n_misses++;
+      return false;
+    }
+    DCHECK(it->second.value.size() == table.value_size());
+    std::memcpy(value, it->second.value.data(), it->second.value.size());
+    tid = it->second.tid;
+    n_hits++;
+    return true;
+  }
+
+  void erase(ITable &table, const void *key) {
+    rows.erase(row_key(table, key));
+  }
+
+  void clear() {
+    if (!rows.empty()) {
+      rows.clear();
+    }
+  }
+
+  std::size_t size() const { return rows.size(); }
+
+  uint64_t get_hits() const { return n_hits; }
+
+  uint64_t get_misses() const { return n_misses; }
+
+private:
+  static std::string row_key(ITable &table, const void *key) {
+    auto key_size = table.key_size();
+    std::string k(sizeof(uint64_t) + key_size, 0);
+    uint64_t id = (static_cast<uint64_t>(table.tableID()) << 32) |
+                  table.partitionID();
+    std::memcpy(&k[0], &id, sizeof(id));
+    std::memcpy(&k[sizeof(id)], key, key_size);
+    return k;
+  }
+
+private:
+  struct Row {
+    uint64_t tid;
+    std::string value;
+  };
+
+  std::unordered_map<std::string, Row> rows;
+  uint64_t n_hits = 0, n_misses = 0;
+};
+} // namespace coco
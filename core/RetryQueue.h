@@ -0,0 +1,142 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Random.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <glog/logging.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * AbortHistory follows the aborts of the transaction a worker is running,
+ * i.e., how many times in a row it aborted on the same row.
+ */
+
+struct AbortHistory {
+  // called once the transaction aborts on row, empty if unknown
+  void abort(const std::string &row) {
+    n_aborts = (n_aborts > 0 && row == conflict) ? n_aborts + 1 : 1;
+    conflict = row;
+  }
+
+  // called when the worker starts a new transaction
+  void clear() {
+    n_aborts = 0;
+    conflict.clear();
+  }
+
+  std::size_t n_aborts = 0;
+  std::string conflict;
+};
+
+/*
+ * With --deferred_retries=n, an aborted transaction is not retried at once
+ * after a sleep. It waits in the RetryQueue of its worker, and the worker
+ * runs new transactions in the meantime. A transaction that aborted k times
+ * in a row on the same row waits for a random backoff of up to
+ * --retry_backoff * 2^(k - 1) us, at most --sleep_time us, so that the
+ * transactions colliding on a hot row spread out further on each collision.
+ * An abort on another row starts over at k = 1.
+ *
+ * At most n transactions wait. Once the queue is full, the worker runs no
+ * new transaction until the earliest backoff has passed. Of the transactions
+ * whose backoff passed, the ones of the highest priority class go first, see
+ * Priorities.
+ */
+
+template <class TransactionType> class RetryQueue {
+public:
+  using clock = std::chrono::steady_clock;
+
+  struct Retry {
+    std::unique_ptr<TransactionType> txn;
+    AbortHistory history;
+    clock::time_point ready;
+    uint32_t priority;
+  };
+
+  RetryQueue(std::size_t capacity, std::size_t backoff,
+             std::size_t max_backoff, uint64_t seed = 0)
+      : capacity(capacity), backoff(backoff),
+        max_backoff(std::max(backoff, max_backoff)), random(seed) {}
+
+  bool empty() const { return retries.empty(); }
+
+  // a queue of no capacity defers nothing and is never full
+  bool full() const { return capacity > 0 && retries.size() >= capacity; }
+
+  std::size_t size() const { return retries.size(); }
+
+  // the backoff limit of a transaction that aborted n_aborts times in a row
+  std::size_t max_delay(std::size_t n_aborts) const {
+    DCHECK(n_aborts > 0);
+    std::size_t delay = backoff;
+    for (auto i = 1u; i < n_aborts && delay < max_backoff; i++) {
+      delay *= 2;
+    }
+    return std::min(delay, max_backoff);
+  }
+
+  void defer(std::unique_ptr<TransactionType> txn,
+             const AbortHistory &history, uint32_t priority = 0) {
+    DCHECK(!full());
+    Retry retry;
+    retry.txn = std::move(txn);
+    retry.history = history;
+    retry.priority = priority;
+    retry.ready = clock::now() + std::chrono::microseconds(random.uniform_dist(
+                                     0, max_delay(history.n_aborts)));
+    retries.push_back(std::move(retry));
+    n_deferred++;
+  }
+
+  // moves the transaction of the highest class whose backoff passed the
+  // earliest into retry, returns false if no backoff has passed yet
+  bool pop(Retry &retry) {
+    auto now = clock::now();
+    auto it = retries.end();
+    for (auto r = retries.begin(); r != retries.end(); r++) {
+      if (r->ready <= now &&
+          (it == retries.end() || r->priority > it->priority ||
+           (r->priority == it->priority && r->ready < it->ready))) {
+        it = r;
+      }
+    }
+    if (it == retries.end()) {
+      return false;
+    }
+    retry = std::move(*it);
+    *it = std::move(retries.back());
+    retries.pop_back();
+    return true;
+  }
+
+  // drops the transactions still waiting, e.g., at the end of a group
+  template <class Func> void clear(Func &&func) {
+    for (auto &retry : retries) {
+      func(std::move(retry.txn));
+    }
+    n_dropped += retries.size();
+    retries.clear();
+  }
+
+  std::size_t deferred() const { return n_deferred; }
+
+  std::size_t dropped() const { return n_dropped; }
+
+private:
+  std::size_t capacity, backoff, max_backoff;
+  Random random;
+  std::vector<Retry> retries;
+  std::size_t n_deferred = 0, n_dropped = 0;
+};
+} // namespace coco
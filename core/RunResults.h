@@ -0,0 +1,190 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Context.h"
+#include "core/Statistics.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <glog/logging.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Run results -- format --
+ *
+ *  With --results_path, coordinator 0 writes one JSON document per run to
+ *  the file, so that the benchmark scripts do not scrape the log:
+ *
+ *  { "config": { <flag>: <value>, ... },
+ *    "coordinator_num": n,
+ *    "seconds": [ { "second": s, "measured": true, <statistics> }, ... ],
+ *    "total": { "seconds": s, "commit_per_second": x, <statistics> },
+ *    "phases": [ { "phase": i, "description": d, "seconds": s,
+ *                  "commit_per_second": x, <statistics> }, ... ],
+ *    "nodes": [ { "id": i, "commit_per_second": x }, ... ] }
+ *
+ *  The config holds every command line flag the Context is set up from,
+ *  with its type, see SETUP_CONTEXT. A second is the statistics of the
+ *  cluster in that second, see Coordinator::gather_statistics, the total
+ *  merges the measured seconds, i.e., past the warmup and before the
+ *  cooldown, a phase merges the measured seconds of a phase of --phases, see
+ *  WorkloadPhases, and a node is the commits per second it reported at the
+ *  end of the run, see Coordinator::gather. The statistics are
+ *
+ *  "commit", "abort", "abort_no_retry", "abort_lock",
+ *  "abort_read_validation", "local", "si_in_serializable", "network_size",
+ *  "queue_stall", "queue_stall_ns", "deferred_flush", "queue_occupancy",
+ *  "latency_us": { "p50", "p75", "p95", "p99", "p999" },
+ *  "phase_us": { "execute", "lock", "validate", "write",
+ *                "group_commit_wait" }
+ *
+ *  with the phases per committed transaction.
+ */
+
+class RunResults {
+public:
+  explicit RunResults(const Context &context) : context(context) {}
+
+  void add_second(std::size_t second, bool measured, const Statistics &s) {
+    std::ostringstream os;
+    os << "{\"second\":" << second
+       << ",\"measured\":" << (measured ? "true" : "false") << ",";
+    write_statistics(os, s);
+    os << "}";
+    seconds.push_back(os.str());
+  }
+
+  // the measured statistics of the cluster, over seconds seconds
+  void set_total(const Statistics &s, int seconds) {
+    std::ostringstream os;
+    os << "{\"seconds\":" << seconds << ",\"commit_per_second\":"
+       << number(seconds > 0 ? 1.0 * s.n_commit / seconds : 0) << ",";
+    write_statistics(os, s);
+    os << "}";
+    total = os.str();
+  }
+
+  // the measured statistics of a phase, over seconds seconds
+  void add_phase(std::size_t phase, const std::string &description,
+                 const Statistics &s, int seconds) {
+    std::ostringstream os;
+    os << "{\"phase\":" << phase << ",\"description\":" << quote(description)
+       << ",\"seconds\":" << seconds << ",\"commit_per_second\":"
+       << number(seconds > 0 ? 1.0 * s.n_commit / seconds : 0) << ",";
+    write_statistics(os, s);
+    os << "}";
+    phase_results.push_back(os.str());
+  }
+
+  // the commits per second of each coordinator, by id
+  void set_node_commits(const std::vector<double> &commits) {
+    node_commits = commits;
+  }
+
+  std::string to_json() const {
+    std::ostringstream os;
+    os << "{\"config\":{";
+    for (auto i = 0u; i < context.flags.size(); i++) {
+      auto &flag = context.flags[i];
+      os << (i == 0 ? "" : ",") << quote(flag.name) << ":";
+      if (flag.type == "string") {
+        os << quote(flag.value);
+      } else {
+        os << flag.value;
+      }
+    }
+    os << "},\"coordinator_num\":" << context.coordinator_num
+       << ",\n\"seconds\":[";
+    for (auto i = 0u; i < seconds.size(); i++) {
+      os << (i == 0 ? "\n" : ",\n") << seconds[i];
+    }
+    os << "],\n\"total\":" << (total.empty() ? "null" : total)
+       << ",\n\"phases\":[";
+    for (auto i = 0u; i < phase_results.size(); i++) {
+      os << (i == 0 ? "\n" : ",\n") << phase_results[i];
+    }
+    os << "],\n\"nodes\":[";
+    for (auto i = 0u; i < node_commits.size(); i++) {
+      os << (i == 0 ? "" : ",") << "{\"id\":" << i
+         << ",\"commit_per_second\":" << number(node_commits[i]) << "}";
+    }
+    os << "]}\n";
+    return os.str();
+  }
+
+  void write(const std::string &filename) const {
+    std::ofstream out(filename);
+    CHECK(out) << "failed to open " << filename;
+    out << to_json();
+  }
+
+  // a JSON string
+  static std::string quote(const std::string &s) {
+    std::string q = "\"";
+    for (auto c : s) {
+      if (c == '"' || c == '\\') {
+        q += '\\';
+        q += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+        q += buffer;
+      } else {
+        q += c;
+      }
+    }
+    return q + "\"";
+  }
+
+private:
+  // JSON has no NaN or infinity
+  static std::string number(double v) {
+    if (!std::isfinite(v)) {
+      return "null";
+    }
+    std::ostringstream os;
+    os << v;
+    return os.str();
+  }
+
+  static void write_statistics(std::ostream &os, const Statistics &s) {
+    os << "\"commit\":" << s.n_commit << ",\"abort\":" << s.n_abort()
+       << ",\"abort_no_retry\":" << s.n_abort_no_retry
+       << ",\"abort_lock\":" << s.n_abort_lock
+       << ",\"abort_read_validation\":" << s.n_abort_read_validation
+       << ",\"local\":" << s.n_local
+       << ",\"si_in_serializable\":" << s.n_si_in_serializable
+       << ",\"network_size\":" << s.n_network_size
+       << ",\"queue_stall\":" << s.n_queue_stall
+       << ",\"queue_stall_ns\":" << s.queue_stall_time
+       << ",\"deferred_flush\":" << s.n_deferred_flush
+       << ",\"queue_occupancy\":" << s.queue_occupancy
+       << ",\"latency_us\":{\"p50\":" << s.latency.nth(50)
+       << ",\"p75\":" << s.latency.nth(75) << ",\"p95\":" << s.latency.nth(95)
+       << ",\"p99\":" << s.latency.nth(99)
+       << ",\"p999\":" << s.latency.nth(99.9) << "},\"phase_us\":{";
+    static const char *phases[N_TRANSACTION_PHASES] = {
+        "execute", "lock", "validate", "write", "group_commit_wait"};
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      os << (i == 0 ? "" : ",") << "\"" << phases[i] << "\":"
+         << number(s.phase_us(static_cast<TransactionPhase>(i)));
+    }
+    os << "}";
+  }
+
+private:
+  const Context &context;
+  std::vector<std::string> seconds;
+  std::string total;
+  std::vector<std::string> phase_results;
+  std::vector<double> node_commits;
+};
+} // namespace coco
@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include "core/FieldLayout.h"
+
+#include <cstddef>
+
 // macros for code generation
 
 #define APPLY_X_AND_Y(x, y) x(y, y)
@@ -32,8 +36,46 @@
   if (this->name != other.name)                                                \
     return false;
 
+// keys are ordered lexicographically by their fields
+#define STRUCT_LT_X(type, name)                                                \
+  if (this->name != other.name)                                                \
+    return this->name < other.name;
+
 #define STRUCT_FIELDPOS_X(type, name) name##_field,
 
+#define STRUCT_OFFSET_X(type, name) offsetof(value, name),
+
+#define STRUCT_KEY_OFFSET_X(type, name) offsetof(key, name),
+
+#define STRUCT_SIZE_X(type, name) sizeof(type),
+
+#define STRUCT_NAME_X(type, name) #name,
+
+#define STRUCT_TYPE_X(type, name) coco::FieldTypeOf<type>::value,
+
+// the memory layout, the names and the types of the fields, see FieldLayout
+#define STRUCT_FIELD_LAYOUT(fields, offset_x)                                  \
+  static const std::size_t *field_offsets() {                                  \
+    static constexpr std::size_t offsets[] = {                                 \
+        APPLY_X_AND_Y(fields, offset_x)};                                      \
+    return offsets;                                                            \
+  }                                                                            \
+  static const std::size_t *field_sizes() {                                    \
+    static constexpr std::size_t sizes[] = {                                   \
+        APPLY_X_AND_Y(fields, STRUCT_SIZE_X)};                                 \
+    return sizes;                                                              \
+  }                                                                            \
+  static const char *const *field_names() {                                    \
+    static constexpr const char *names[] = {                                   \
+        APPLY_X_AND_Y(fields, STRUCT_NAME_X)};                                 \
+    return names;                                                              \
+  }                                                                            \
+  static const coco::FieldType *field_types() {                                \
+    static constexpr coco::FieldType types[] = {                               \
+        APPLY_X_AND_Y(fields, STRUCT_TYPE_X)};                                 \
+    return types;                                                              \
+  }
+
 // the main macro
 #define DO_STRUCT(name, keyfields, valuefields, namespacefields)               \
   namespacefields(NAMESPACE_OPEN) struct name {                                \
@@ -49,7 +91,12 @@
       bool operator!=(const struct key &other) const {                         \
         return !operator==(other);                                             \
       }                                                                        \
+      bool operator<(const struct key &other) const {                          \
+        APPLY_X_AND_Y(keyfields, STRUCT_LT_X)                                  \
+        return false;                                                          \
+      }                                                                        \
       enum { APPLY_X_AND_Y(keyfields, STRUCT_FIELDPOS_X) NFIELDS };            \
+      STRUCT_FIELD_LAYOUT(keyfields, STRUCT_KEY_OFFSET_X)                      \
     };                                                                         \
     struct value {                                                             \
       value() = default;                                                       \
@@ -64,6 +111,7 @@
         return !operator==(other);                                             \
       }                                                                        \
       enum { APPLY_X_AND_Y(valuefields, STRUCT_FIELDPOS_X) NFIELDS };          \
+      STRUCT_FIELD_LAYOUT(valuefields, STRUCT_OFFSET_X)                        \
     };                                                                         \
     static constexpr std::size_t tableID = __COUNTER__ - __BASE_COUNTER__;     \
   };                                                                           \
@@ -0,0 +1,85 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Table.h"
+
+#include <functional>
+#include <glog/logging.h>
+
+namespace coco {
+
+/*
+ * SecondaryIndex keeps an index table in step with a base table. extract
+ * maps each row of the base table to one entry of the index, e.g., a row of
+ * CUSTOMER to (C_W_ID, C_D_ID, C_LAST) -> C_ID. The entry is inserted with
+ * the row. Whenever a row is written, whether by a commit, a replication
+ * request or a recovery, the entry of the old value is replaced with the
+ * entry of the new one during that same write. So an index commits and
+ * replicates with its base table in all protocols, and its partitions live
+ * wherever the base partitions do.
+ *
+ * A unique index, one entry per index key, is a hash table and is read with
+ * point lookups. A non-unique index puts the primary key in the index key,
+ * so each entry belongs to one row. It is an ordered table and is read with
+ * range scans over the index key prefix. The index rows carry no protocol
+ * metadata, so readers treat an entry as a hint and read the base row it
+ * names through the protocol.
+ *
+ * The base partition and the index partition must outlive the index
+ * object. Neither may be an mvcc table.
+ */
+
+template <class KeyType, class ValueType, class IndexKeyType,
+          class IndexValueType>
+class SecondaryIndex : public ISecondaryIndex {
+public:
+  using ExtractFuncType =
+      std::function<void(const KeyType &, const ValueType &, IndexKeyType &,
+                         IndexValueType &)>;
+
+  SecondaryIndex(ITable &table, ITable &index, ExtractFuncType extract)
+      : index(index), extract(std::move(extract)) {
+    CHECK(table.key_size() == sizeof(KeyType) &&
+          table.value_size() == sizeof(ValueType))
+        << "table " << table.tableID() << " does not match the index.";
+    CHECK(index.key_size() == sizeof(IndexKeyType) &&
+          index.value_size() == sizeof(IndexValueType))
+        << "table " << index.tableID() << " is not an index of this type.";
+    table.add_index(this);
+  }
+
+  void insert(const void *key, const void *value) override {
+    IndexKeyType index_key;
+    IndexValueType index_value;
+    extract(*static_cast<const KeyType *>(key),
+            *static_cast<const ValueType *>(value), index_key, index_value);
+    index.insert(&index_key, &index_value);
+  }
+
+  void update(const void *key, const void *old_value,
+              const void *value) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    IndexKeyType old_index_key, index_key;
+    IndexValueType old_index_value, index_value;
+    extract(k, *static_cast<const ValueType *>(old_value), old_index_key,
+            old_index_value);
+    extract(k, *static_cast<const ValueType *>(value), index_key,
+            index_value);
+    if (old_index_key != index_key) {
+      index.remove(&old_index_key);
+      index.insert(&index_key, &index_value);
+    } else if (old_index_value != index_value) {
+      index.update(&index_key, &index_value);
+    }
+  }
+
+  ITable &get_index() { return index; }
+
+private:
+  ITable &index;
+  ExtractFuncType extract;
+};
+} // namespace coco
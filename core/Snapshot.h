@@ -0,0 +1,160 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/SnapshotVersions.h"
+#include "core/Table.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * Snapshot lets a long-running read-only query, e.g., an aggregate over whole
+ * partitions, read the tables of the partitions this coordinator masters as
+ * of an epoch boundary, while SiloSI and ScarSI keep committing on top of
+ * them. The query neither validates nor holds up the epochs.
+ *
+ * pin() waits for the manager to pin the snapshot at the next epoch boundary,
+ * when no transaction is running. From then on, the first write to each row
+ * saves the value the row had at the pin in the SnapshotVersions of its
+ * table, copy-on-write, and read() returns the saved value if there is one,
+ * or the row otherwise. Once the query calls unpin(), the saved values are
+ * dropped at the next boundary. Writers only check a pointer while no
+ * snapshot is pinned, and pay a lookup for each write to a row already
+ * written since the pin otherwise.
+ *
+ * There is one Snapshot per coordinator in a process, see of(). A query pins
+ * at most one snapshot at a time.
+ */
+
+class Snapshot {
+public:
+  static Snapshot &of(std::size_t coordinator_id) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<Snapshot>> snapshots;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &snapshot = snapshots[coordinator_id];
+    if (snapshot == nullptr) {
+      snapshot = std::make_unique<Snapshot>();
+    }
+    return *snapshot;
+  }
+
+  // the tables a snapshot covers, set before the executors start
+  void set_tables(std::vector<ITable *> tables) {
+    this->tables = std::move(tables);
+  }
+
+  const std::vector<ITable *> &get_tables() const { return tables; }
+
+  // returns the boundary the snapshot is pinned at, or -1 if stopFlag is set
+  // while waiting
+  int64_t pin(const std::atomic<bool> &stopFlag) {
+    // the last snapshot is dropped at a boundary first
+    while (released.load() && !stopFlag.load()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    CHECK(released.load() || !pinned.load())
+        << "the snapshot is pinned already.";
+    requested.store(true);
+    while (!pinned.load() || released.load()) {
+      if (stopFlag.load()) {
+        requested.store(false);
+        return -1;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return pin_boundary;
+  }
+
+  void unpin() {
+    DCHECK(pinned.load());
+    released.store(true);
+  }
+
+  bool is_pinned() const { return pinned.load(); }
+
+  /*
+   * Copies the value of key, a row of table, at the pin into value. The row
+   * is read before its saved value is looked up: a writer saves the value
+   * before it writes the row, so if the copy is torn or newer, the saved
+   * value is there by the time it is looked up.
+   */
+  void read(ITable &table, const void *key, void *value) {
+    DCHECK(pinned.load());
+    std::memcpy(value, table.search_value(key), table.value_size());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto versions = table.get_snapshot_versions();
+    DCHECK(versions != nullptr) << "table " << table.tableID()
+                                << " is not in the snapshot.";
+    versions->find(key, value);
+  }
+
+  // calls func(key, value) on every row of table at the pin, value is only
+  // valid during the call
+  template <class Func> void for_each_row(ITable &table, Func func) {
+    DCHECK(pinned.load());
+    auto versions = table.get_snapshot_versions();
+    DCHECK(versions != nullptr) << "table " << table.tableID()
+                                << " is not in the snapshot.";
+    std::vector<char> value(table.value_size());
+    table.for_each_row([&](const void *key, ITable::MetaDataType &metadata,
+                           void *row) {
+      std::memcpy(value.data(), row, value.size());
+      std::atomic_thread_fence(std::memory_order_acquire);
+      versions->find(key, value.data());
+      func(key, static_cast<const void *>(value.data()));
+    });
+  }
+
+  // the values saved in the pinned snapshot so far
+  std::size_t saved_versions() const {
+    std::size_t n = 0;
+    for (auto &versions : table_versions) {
+      n += versions->size();
+    }
+    return n;
+  }
+
+  // called by the manager at each epoch boundary, no transaction is running
+  void on_epoch_boundary() {
+    n_boundaries++;
+    if (released.load()) {
+      for (auto table : tables) {
+        table->set_snapshot_versions(nullptr);
+      }
+      table_versions.clear();
+      released.store(false);
+      pinned.store(false);
+    }
+    if (requested.load() && !pinned.load()) {
+      for (auto table : tables) {
+        table_versions.push_back(std::make_unique<SnapshotVersions>(
+            table->key_size(), table->value_size()));
+        table->set_snapshot_versions(table_versions.back().get());
+      }
+      pin_boundary = n_boundaries;
+      requested.store(false);
+      pinned.store(true);
+    }
+  }
+
+private:
+  std::vector<ITable *> tables;
+  std::vector<std::unique_ptr<SnapshotVersions>> table_versions;
+  std::atomic<bool> requested{false}, pinned{false}, released{false};
+  // touched by the manager only, and read by the query once pinned
+  int64_t n_boundaries = 0, pin_boundary = 0;
+};
+} // namespace coco
@@ -0,0 +1,200 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/RateLimiter.h"
+#include "core/ArrowWriter.h"
+#include "core/ColumnarSnapshot.h"
+#include "core/Context.h"
+#include "core/Snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <cstdint>
+#include <glog/logging.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --snapshot_interval, SnapshotQuery runs an analytical read-only query
+ * in the background each snapshot_interval seconds: it pins a snapshot and
+ * scans every row of the tables of the partitions this coordinator masters,
+ * counting the rows and hashing the values. The checksum is the same for any
+ * scan of the same snapshot no matter how long the scan takes.
+ *
+ * With --columnar_tables, the tables listed are also copied to a
+ * ColumnarSnapshot of the same pin and published for analytical queries
+ * before the scan.
+ *
+ * With --export_path, the tables listed in --export_tables, or all of them,
+ * are also written to <export_path>/<table>_<partition>.<boundary>.arrow for
+ * offline analytics, see ArrowWriter, at most --export_bandwidth MB/s. The
+ * snapshot stays pinned during the export, so the longer it takes, the more
+ * rows are copied on write.
+ */
+
+class SnapshotQuery {
+public:
+  SnapshotQuery(std::size_t coordinator_id, const Context &context,
+                std::atomic<bool> &stopFlag)
+      : coordinator_id(coordinator_id), interval(context.snapshot_interval),
+        columnar_tables(parse_tables(context.columnar_tables)),
+        export_path(context.export_path),
+        export_tables(parse_tables(context.export_tables)),
+        export_bandwidth(context.export_bandwidth), stopFlag(stopFlag),
+        snapshot(Snapshot::of(coordinator_id)) {}
+
+  void start() {
+    LOG(INFO) << "SnapshotQuery on coordinator " << coordinator_id
+              << " starts, " << snapshot.get_tables().size() << " tables.";
+
+    while (wait_for_next_query()) {
+      auto start = std::chrono::steady_clock::now();
+      auto boundary = snapshot.pin(stopFlag);
+      if (boundary < 0) {
+        break;
+      }
+      auto pinned = std::chrono::steady_clock::now();
+
+      if (!columnar_tables.empty()) {
+        auto columnar =
+            ColumnarSnapshot::build(snapshot, columnar_tables, boundary);
+        LOG(INFO) << "SnapshotQuery on coordinator " << coordinator_id
+                  << " copied " << columnar->size() << " rows of "
+                  << columnar->get_tables().size()
+                  << " tables to columns in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - pinned)
+                         .count()
+                  << " ms.";
+        ColumnarSnapshot::publish(coordinator_id, std::move(columnar));
+        pinned = std::chrono::steady_clock::now();
+      }
+
+      if (!export_path.empty()) {
+        export_snapshot(boundary);
+        pinned = std::chrono::steady_clock::now();
+      }
+
+      uint64_t n_rows = 0, checksum = 0;
+      for (auto table : snapshot.get_tables()) {
+        std::size_t value_size = table->value_size();
+        snapshot.for_each_row(*table, [&](const void *key, const void *value) {
+          n_rows++;
+          checksum += hash(value, value_size);
+        });
+      }
+      auto n_versions = snapshot.saved_versions();
+      snapshot.unpin();
+
+      LOG(INFO) << "SnapshotQuery on coordinator " << coordinator_id
+                << " read " << n_rows << " rows at epoch boundary " << boundary
+                << ", checksum: " << checksum << ", pinned in "
+                << std::chrono::duration_cast<std::chrono::microseconds>(
+                       pinned - start)
+                       .count()
+                << " us, scanned in "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - pinned)
+                       .count()
+                << " ms, " << n_versions << " rows copied on write.";
+    }
+
+    LOG(INFO) << "SnapshotQuery on coordinator " << coordinator_id
+              << " exits.";
+  }
+
+  // FNV-1a
+  static uint64_t hash(const void *data, std::size_t size) {
+    auto p = static_cast<const unsigned char *>(data);
+    uint64_t h = 14695981039346656037ull;
+    for (auto i = 0u; i < size; i++) {
+      h = (h ^ p[i]) * 1099511628211ull;
+    }
+    return h;
+  }
+
+private:
+  // e.g., 0,1
+  static std::vector<std::size_t> parse_tables(const std::string &list) {
+    std::vector<std::size_t> table_ids;
+    if (!list.empty()) {
+      std::vector<std::string> tables;
+      boost::algorithm::split(tables, list, boost::is_any_of(","));
+      for (auto &table : tables) {
+        table_ids.push_back(std::stoul(table));
+      }
+    }
+    return table_ids;
+  }
+
+  void export_snapshot(int64_t boundary) {
+    auto start = std::chrono::steady_clock::now();
+    RateLimiter limiter(export_bandwidth * 1024 * 1024);
+    std::size_t n_tables = 0, n_rows = 0, n_bytes = 0;
+    for (auto table : snapshot.get_tables()) {
+      if (stopFlag.load()) {
+        break;
+      }
+      if (!export_tables.empty() &&
+          std::find(export_tables.begin(), export_tables.end(),
+                    table->tableID()) == export_tables.end()) {
+        continue;
+      }
+      auto table_id = std::to_string(table->tableID()),
+           partition_id = std::to_string(table->partitionID());
+      ArrowWriter writer(export_path + "/" + table_id + "_" + partition_id +
+                             "." + std::to_string(boundary) + ".arrow",
+                         table->columns(),
+                         {{"coco.table", table_id},
+                          {"coco.partition", partition_id},
+                          {"coco.epoch_boundary", std::to_string(boundary)}},
+                         &limiter);
+      snapshot.for_each_row(*table, [&](const void *key, const void *value) {
+        writer.append(key, value);
+      });
+      writer.close();
+      n_tables++;
+      n_rows += writer.size();
+      n_bytes += writer.bytes();
+    }
+    LOG(INFO) << "SnapshotQuery on coordinator " << coordinator_id
+              << " exported " << n_rows << " rows of " << n_tables
+              << " tables (" << n_bytes << " bytes) in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count()
+              << " ms.";
+  }
+
+  // returns false if stopped while waiting
+  bool wait_for_next_query() {
+    auto start = std::chrono::steady_clock::now();
+    auto duration = std::chrono::seconds(interval);
+    while (!stopFlag.load()) {
+      if (std::chrono::steady_clock::now() - start >= duration) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+private:
+  std::size_t coordinator_id;
+  std::size_t interval;
+  std::vector<std::size_t> columnar_tables;
+  std::string export_path;
+  std::vector<std::size_t> export_tables;
+  std::size_t export_bandwidth;
+  std::atomic<bool> &stopFlag;
+  Snapshot &snapshot;
+};
+} // namespace coco
@@ -0,0 +1,79 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/SpinLock.h"
+
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace coco {
+
+/*
+ * SnapshotVersions is the side version store of a table partition while a
+ * snapshot is pinned, see Snapshot. The first write to a row since the pin
+ * saves the value the row had at the pin, so the table itself stays single
+ * versioned and writers never wait for a reader. Keys and values are kept as
+ * raw bytes in one of N_SHARDS hash maps, each behind a spin lock.
+ */
+
+class SnapshotVersions {
+public:
+  static constexpr std::size_t N_SHARDS = 64;
+
+  SnapshotVersions(std::size_t key_size, std::size_t value_size)
+      : key_size(key_size), value_size(value_size) {}
+
+  // called before value, the row of key, is overwritten. The caller is the
+  // only writer of the row, e.g., it holds the lock of the row.
+  void save(const void *key, const void *value) {
+    std::string k(static_cast<const char *>(key), key_size);
+    auto &shard = shards[std::hash<std::string>()(k) % N_SHARDS];
+    {
+      std::lock_guard<SpinLock> guard(shard.lock);
+      if (shard.versions.find(k) == shard.versions.end()) {
+        shard.versions.emplace(
+            std::move(k),
+            std::string(static_cast<const char *>(value), value_size));
+        n_versions.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    // the row is written after the version is visible, see Snapshot::read
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  // copies the value of key at the pin into value, returns false if the row
+  // has not been written since the pin
+  bool find(const void *key, void *value) {
+    std::string k(static_cast<const char *>(key), key_size);
+    auto &shard = shards[std::hash<std::string>()(k) % N_SHARDS];
+    std::lock_guard<SpinLock> guard(shard.lock);
+    auto it = shard.versions.find(k);
+    if (it == shard.versions.end()) {
+      return false;
+    }
+    std::memcpy(value, it->second.data(), value_size);
+    return true;
+  }
+
+  std::size_t size() const {
+    return n_versions.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Shard {
+    SpinLock lock;
+    std::unordered_map<std::string, std::string> versions;
+  };
+
+  std::size_t key_size, value_size;
+  Shard shards[N_SHARDS];
+  std::atomic<std::size_t> n_versions{0};
+};
+} // namespace coco
@@ -0,0 +1,128 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Message.h"
+#include "core/CommutativeUpdate.h"
+#include "core/FieldLayout.h"
+#include "core/Partitioner.h"
+#include "core/Table.h"
+
+#include <cstring>
+#include <glog/logging.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --split_threshold, the additions to a hot row are split into a slice
+ * per worker, as phase reconciliation in Doppel. A worker counts its
+ * additions to each row in a group, and a row it added to at least
+ * split_threshold times is split in the next group: the additions of its
+ * transactions only go to the worker's own slice, so they do not even share
+ * the cache line of the field. At the end of the group, the slices are merged
+ * into the rows, through CommutativeUpdate, before the group is replicated
+ * and acknowledged, see group_commit::Executor::stop_group. A row that is no
+ * longer hot is joined again.
+ *
+ * A read of a split field does not see the additions of the group, it sees
+ * the row as of the last merge.
+ */
+
+class SplitCounters {
+public:
+  explicit SplitCounters(std::size_t threshold) : threshold(threshold) {}
+
+  // returns true if addition goes to the slice of its row
+  bool add(const AdditionKey &addition, ITable &table) {
+    auto &slice = slices[slice_key(addition, table)];
+    slice.n_additions++;
+    if (!slice.split) {
+      return false;
+    }
+    if (slice.pending) {
+      slice.addition.addition.merge(addition.addition);
+    } else {
+      slice.addition = addition;
+      slice.pending = true;
+    }
+    return true;
+  }
+
+  // merges the slices into the rows, on coordinator_id directly and on the
+  // other replicas through messages, and splits the rows for the next group.
+  // Returns the size of the messages.
+  template <class DatabaseType>
+  std::size_t merge(std::size_t coordinator_id, DatabaseType &db,
+                    const Partitioner &partitioner,
+                    std::vector<std::unique_ptr<Message>> &messages) {
+    std::size_t network_size = 0;
+    for (auto it = slices.begin(); it != slices.end();) {
+      auto &slice = it->second;
+      if (slice.pending) {
+        auto addition = slice.addition;
+        addition.key = it->first.data() + KEY_OFFSET;
+        network_size += CommutativeUpdate::apply(addition, coordinator_id, db,
+                                                 partitioner, messages);
+        n_merged++;
+      }
+      if (slice.n_additions < threshold) {
+        it = slices.erase(it);
+        continue;
+      }
+      slice.split = true;
+      slice.pending = false;
+      slice.n_additions = 0;
+      ++it;
+    }
+    return network_size;
+  }
+
+  // the rows split in the current group
+  std::size_t n_split() const {
+    std::size_t n = 0;
+    for (auto &slice : slices) {
+      n += slice.second.split;
+    }
+    return n;
+  }
+
+  // the slices merged into rows so far
+  uint64_t get_merged() const { return n_merged; }
+
+private:
+  struct Slice {
+    // the sum of the additions in the group, its key is not set
+    AdditionKey addition;
+    uint64_t n_additions = 0;
+    bool split = false, pending = false;
+  };
+
+  // the table, the partition and the field, followed by the key
+  static constexpr std::size_t KEY_OFFSET =
+      sizeof(std::size_t) * 2 + sizeof(uint32_t);
+
+  static std::string slice_key(const AdditionKey &addition, ITable &table) {
+    auto key_size = table.key_size();
+    std::string key(KEY_OFFSET + key_size, 0);
+    char *p = &key[0];
+    std::memcpy(p, &addition.table_id, sizeof(std::size_t));
+    std::memcpy(p + sizeof(std::size_t), &addition.partition_id,
+                sizeof(std::size_t));
+    std::memcpy(p + sizeof(std::size_t) * 2, &addition.field,
+                sizeof(uint32_t));
+    std::memcpy(p + KEY_OFFSET, addition.key, key_size);
+    return key;
+  }
+
+private:
+  std::size_t threshold;
+  std::unordered_map<std::string, Slice> slices;
+  uint64_t n_merged = 0;
+};
+} // namespace coco
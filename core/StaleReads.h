@@ -0,0 +1,113 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "core/Partitioner.h"
+#include "core/Table.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace coco {
+
+/*
+ * StaleReads serves read-only lookups, e.g., of dashboards or caches, from
+ * the copy of a partition on this coordinator, master or replica, outside of
+ * any transaction. With --stale_reads, the group commit manager keeps two
+ * epoch counters per coordinator: the epochs started, and the epochs whose
+ * replication requests are all applied here. A replica is then at most
+ * started - applied epochs behind its master, see staleness, and a read with
+ * a bound below that is refused rather than answered from an older copy.
+ *
+ * A read takes no lock, is not validated and sends no message: it copies
+ * the row until its tid is unlocked and unchanged across the copy, so it
+ * never sees a row half written by a commit or a replication request. The
+ * row may be newer than the bound, never older. A coordinator with no copy of
+ * the partition refuses the read, the caller asks another one, see
+ * Partitioner::is_partition_replicated_on.
+ *
+ * Only the protocols whose tid has the lock bit at bit 63 are supported, i.e.,
+ * Silo, SiloGC, Scar and ScarGC.
+ */
+
+class StaleReads {
+public:
+  enum class Status {
+    OK,
+    STALE,          // the replica is more epochs behind than the bound
+    NOT_FOUND,      // the row is a tombstone
+    NOT_REPLICATED, // the partition has no copy on this coordinator
+  };
+
+  static constexpr uint64_t LOCK_BIT = 1ull << 63;
+
+  static StaleReads &of(std::size_t coordinator_id) {
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<StaleReads>> reads;
+    std::lock_guard<std::mutex> guard(mutex);
+    auto &r = reads[coordinator_id];
+    if (r == nullptr) {
+      r = std::make_unique<StaleReads>();
+    }
+    return *r;
+  }
+
+  // called by the manager as epoch starts
+  void start_epoch(uint64_t epoch) { n_started.store(epoch); }
+
+  // called by the manager once the replication requests of epoch are applied
+  void apply_epoch(uint64_t epoch) { n_applied.store(epoch); }
+
+  // the most epochs a replica on this coordinator is behind its master
+  uint64_t staleness() const {
+    uint64_t applied = n_applied.load(), started = n_started.load();
+    return started > applied ? started - applied : 0;
+  }
+
+  // copies the value of key in partition_id to value if this coordinator is
+  // at most max_staleness epochs behind, a master copy is never behind
+  template <class Database>
+  Status read(Database &db, const Partitioner &partitioner,
+              std::size_t table_id, std::size_t partition_id, const void *key,
+              void *value, uint64_t max_staleness) const {
+    bool master = partitioner.has_master_partition(partition_id);
+    if (!master && !partitioner.is_partition_replicated_on_me(partition_id)) {
+      return Status::NOT_REPLICATED;
+    }
+    if (!master && staleness() > max_staleness) {
+      return Status::STALE;
+    }
+
+    ITable *table = db.find_table(table_id, partition_id);
+    auto row = table->search(key);
+    std::atomic<uint64_t> &tid = *std::get<0>(row);
+    const void *src = std::get<1>(row);
+    auto size = table->value_size();
+    const Tombstone &tombstone = table->get_tombstone();
+    uint64_t lock_mask = tombstone.enabled() ? tombstone.lock_mask : LOCK_BIT;
+    for (;;) {
+      uint64_t tid_ = tid.load();
+      // a removed row stays locked
+      if (tombstone.is_absent(tid_)) {
+        return Status::NOT_FOUND;
+      }
+      if ((tid_ & lock_mask) != 0) {
+        continue;
+      }
+      std::memcpy(value, src, size);
+      if (tid_ == tid.load()) {
+        return Status::OK;
+      }
+    }
+  }
+
+private:
+  std::atomic<uint64_t> n_started{0}, n_applied{0};
+};
+} // namespace coco
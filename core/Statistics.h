@@ -0,0 +1,279 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/Histogram.h"
+#include "common/PerfCounters.h"
+#include "common/Probes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+
+namespace coco {
+
+enum class TransactionPhase {
+  EXECUTE,
+  LOCK,
+  VALIDATE,
+  WRITE,
+  GROUP_COMMIT_WAIT,
+  NFIELDS
+};
+
+static constexpr std::size_t N_TRANSACTION_PHASES =
+    static_cast<std::size_t>(TransactionPhase::NFIELDS);
+
+/*
+ * PhaseTimer splits the time of a transaction into phases. start() is called
+ * once the transaction is generated, and each end(phase) charges the time
+ * since the previous call to that phase. Phases a protocol does not have, e.g.,
+ * validation in 2PL, are left at 0, and the SI protocols validate and lock in
+ * one step, which is charged to VALIDATE. If the thread has PerfCounters,
+ * the hardware events since the previous call are charged as well.
+ */
+
+class PhaseTimer {
+public:
+  PhaseTimer() {
+    clear();
+    start();
+  }
+
+  void start() {
+    last = std::chrono::steady_clock::now();
+    counters = PerfCounters::thread_counters();
+    if (counters != nullptr) {
+      counters->read(last_events);
+    }
+  }
+
+  void end(TransactionPhase phase) {
+    auto now = std::chrono::steady_clock::now();
+    auto i = static_cast<std::size_t>(phase);
+    auto ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - last)
+            .count();
+    times[i] += ns;
+    COCO_PROBE2(txn_phase, i, ns);
+    last = now;
+    if (counters != nullptr) {
+      uint64_t now_events[N_PERF_EVENTS];
+      counters->read(now_events);
+      for (auto k = 0u; k < N_PERF_EVENTS; k++) {
+        events[i][k] += now_events[k] - last_events[k];
+        last_events[k] = now_events[k];
+      }
+    }
+  }
+
+  void clear() {
+    std::memset(times, 0, sizeof(times));
+    std::memset(events, 0, sizeof(events));
+  }
+
+  uint64_t times[N_TRANSACTION_PHASES];
+  // hardware events in each phase, see PerfCounters
+  uint64_t events[N_TRANSACTION_PHASES][N_PERF_EVENTS];
+
+private:
+  std::chrono::steady_clock::time_point last;
+  PerfCounters *counters;
+  uint64_t last_events[N_PERF_EVENTS];
+};
+
+/*
+ * Statistics of the transactions of one procedure, i.e., a transaction type
+ * such as NewOrder, see Statistics::procedures. A commit is counted with its
+ * latency.
+ */
+
+struct ProcedureStatistics {
+  uint64_t n_commit() const { return latency.size(); }
+
+  uint64_t n_abort() const {
+    return n_abort_no_retry + n_abort_lock + n_abort_read_validation;
+  }
+
+  void merge(const ProcedureStatistics &s) {
+    n_abort_no_retry += s.n_abort_no_retry;
+    n_abort_lock += s.n_abort_lock;
+    n_abort_read_validation += s.n_abort_read_validation;
+    latency.merge(s.latency);
+  }
+
+  // (aborts : uint64_t * 3, encoded latency histogram)
+  void encode(Encoder &encoder) const {
+    encoder << n_abort_no_retry << n_abort_lock << n_abort_read_validation;
+    latency.encode(encoder);
+  }
+
+  std::size_t encoded_size() const {
+    return sizeof(uint64_t) * 3 + latency.encoded_size();
+  }
+
+  void decode_and_merge(Decoder &dec) {
+    ProcedureStatistics s;
+    dec >> s.n_abort_no_retry >> s.n_abort_lock >> s.n_abort_read_validation;
+    s.latency.decode_and_merge(dec);
+    merge(s);
+  }
+
+  uint64_t n_abort_no_retry = 0, n_abort_lock = 0, n_abort_read_validation = 0;
+  // commit latencies in microseconds
+  Histogram latency;
+};
+
+/*
+ * Statistics of a coordinator over a period of time, collected from the
+ * workers every second. Coordinator 0 merges the statistics of all
+ * coordinators.
+ */
+
+class Statistics {
+public:
+  Statistics() { clear(); }
+
+  void clear() {
+    n_commit = n_abort_no_retry = n_abort_lock = n_abort_read_validation = 0;
+    n_local = n_si_in_serializable = n_network_size = 0;
+    n_queue_stall = queue_stall_time = n_deferred_flush = queue_occupancy = 0;
+    std::memset(phase_time, 0, sizeof(phase_time));
+    std::memset(phase_events, 0, sizeof(phase_events));
+    latency.clear();
+    procedures.clear();
+  }
+
+  void merge(const Statistics &s) {
+    n_commit += s.n_commit;
+    n_abort_no_retry += s.n_abort_no_retry;
+    n_abort_lock += s.n_abort_lock;
+    n_abort_read_validation += s.n_abort_read_validation;
+    n_local += s.n_local;
+    n_si_in_serializable += s.n_si_in_serializable;
+    n_network_size += s.n_network_size;
+    n_queue_stall += s.n_queue_stall;
+    queue_stall_time += s.queue_stall_time;
+    n_deferred_flush += s.n_deferred_flush;
+    queue_occupancy = std::max(queue_occupancy, s.queue_occupancy);
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      phase_time[i] += s.phase_time[i];
+      for (auto k = 0u; k < N_PERF_EVENTS; k++) {
+        phase_events[i][k] += s.phase_events[i][k];
+      }
+    }
+    latency.merge(s.latency);
+    for (auto &p : s.procedures) {
+      procedures[p.first].merge(p.second);
+    }
+  }
+
+  uint64_t n_abort() const {
+    return n_abort_no_retry + n_abort_lock + n_abort_read_validation;
+  }
+
+  // average time of a phase per committed transaction, in microseconds
+  double phase_us(TransactionPhase phase) const {
+    return n_commit == 0 ? 0
+                         : phase_time[static_cast<std::size_t>(phase)] /
+                               1000.0 / n_commit;
+  }
+
+  // average hardware events of a phase per committed transaction
+  double phase_events_per_txn(TransactionPhase phase, PerfEvent event) const {
+    auto i = static_cast<std::size_t>(phase);
+    auto k = static_cast<std::size_t>(event);
+    return n_commit == 0 ? 0 : 1.0 * phase_events[i][k] / n_commit;
+  }
+
+  /*
+   * The structure of encoded statistics: (counters : uint64_t * 11, phase
+   * times : uint64_t * N_TRANSACTION_PHASES, phase events : uint64_t *
+   * N_TRANSACTION_PHASES * N_PERF_EVENTS, encoded latency histogram, # of
+   * procedures : uint32_t, [procedure id : uint32_t, encoded procedure
+   * statistics] ...)
+   */
+
+  void encode(Encoder &encoder) const {
+    encoder << n_commit << n_abort_no_retry << n_abort_lock
+            << n_abort_read_validation << n_local << n_si_in_serializable
+            << n_network_size << n_queue_stall << queue_stall_time
+            << n_deferred_flush << queue_occupancy;
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      encoder << phase_time[i];
+    }
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      for (auto k = 0u; k < N_PERF_EVENTS; k++) {
+        encoder << phase_events[i][k];
+      }
+    }
+    latency.encode(encoder);
+    encoder << static_cast<uint32_t>(procedures.size());
+    for (auto &p : procedures) {
+      encoder << p.first;
+      p.second.encode(encoder);
+    }
+  }
+
+  std::size_t encoded_size() const {
+    std::size_t size = sizeof(uint64_t) *
+                           (11 + N_TRANSACTION_PHASES * (1 + N_PERF_EVENTS)) +
+                       latency.encoded_size() + sizeof(uint32_t);
+    for (auto &p : procedures) {
+      size += sizeof(uint32_t) + p.second.encoded_size();
+    }
+    return size;
+  }
+
+  // merges encoded statistics into this one
+  void decode_and_merge(Decoder &dec) {
+    Statistics s;
+    dec >> s.n_commit >> s.n_abort_no_retry >> s.n_abort_lock >>
+        s.n_abort_read_validation >> s.n_local >> s.n_si_in_serializable >>
+        s.n_network_size >> s.n_queue_stall >> s.queue_stall_time >>
+        s.n_deferred_flush >> s.queue_occupancy;
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      dec >> s.phase_time[i];
+    }
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      for (auto k = 0u; k < N_PERF_EVENTS; k++) {
+        dec >> s.phase_events[i][k];
+      }
+    }
+    s.latency.decode_and_merge(dec);
+    uint32_t n_procedures;
+    dec >> n_procedures;
+    for (auto i = 0u; i < n_procedures; i++) {
+      uint32_t procedure_id;
+      dec >> procedure_id;
+      s.procedures[procedure_id].decode_and_merge(dec);
+    }
+    merge(s);
+  }
+
+public:
+  uint64_t n_commit, n_abort_no_retry, n_abort_lock, n_abort_read_validation,
+      n_local, n_si_in_serializable, n_network_size;
+  // # of times a worker waited for room in an outgoing queue and the
+  // nanoseconds it waited, see Worker::push_outgoing
+  uint64_t n_queue_stall, queue_stall_time;
+  // # of asynchronous flushes deferred for credits, see AsyncCredits
+  uint64_t n_deferred_flush;
+  // the most messages seen in an outgoing queue
+  uint64_t queue_occupancy;
+  // nanoseconds spent in each phase
+  uint64_t phase_time[N_TRANSACTION_PHASES];
+  // hardware events in each phase, see PerfCounters
+  uint64_t phase_events[N_TRANSACTION_PHASES][N_PERF_EVENTS];
+  // commit latencies in microseconds
+  Histogram latency;
+  // by the procedure id a transaction is tagged with by the workload, e.g.,
+  // NewOrder (0) and Payment (1) in TPC-C, see Workload::make
+  std::map<uint32_t, ProcedureStatistics> procedures;
+};
+} // namespace coco
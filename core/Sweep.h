@@ -0,0 +1,285 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "core/RunResults.h"
+#include "core/Statistics.h"
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <cstdio>
+#include <fstream>
+#include <glog/logging.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Sweep -- format --
+ *
+ *  With --sweep, a bench binary runs once per point of a grid of flag values
+ *  instead of once, e.g.,
+ *
+ *    --sweep="threads=1..16;zipf=0,0.5,0.9;cross_ratio=0..100+25"
+ *
+ *  sweeps the flags separated by ';' over their values: a list separated by
+ *  ',', lo..hi, which doubles from lo up to hi, or lo..hi+step. The grid is
+ *  the product of the values, the last flag varies fastest. Every node runs
+ *  the same sweep, and each point is a run of its own: the flags are set, the
+ *  context is set up from them again, and a new coordinator connects to its
+ *  peers, warms up and runs --duration seconds. The database is loaded again
+ *  only if a flag the bench loads its tables with changes, see changes, so
+ *  sweeping the threads or the skew does not reload; the rows the runs before
+ *  inserted or updated stay.
+ *
+ *  Coordinator 0 collects the measured statistics of each run, see add_run,
+ *  and writes them to --sweep_path as JSON,
+ *
+ *  { "flags": [ <flag>, ... ],
+ *    "runs": [ { "point": { <flag>: <value>, ... }, "reloaded": b,
+ *                "seconds": s, "commit_per_second": x, "scaling": y,
+ *                "abort_rate": r,
+ *                "latency_us": { "p50", "p95", "p99", "p999" } }, ... ] }
+ *
+ *  and as a table to --sweep_path.txt, where scaling is the throughput of a
+ *  run over the throughput of the first one.
+ */
+
+class Sweep {
+public:
+  struct Parameter {
+    std::string flag;
+    std::vector<std::string> values;
+  };
+
+  struct Run {
+    std::size_t point;
+    bool reloaded;
+    int seconds;
+    double commit_per_second, abort_rate;
+    int64_t p50, p95, p99, p999;
+  };
+
+  explicit Sweep(const std::string &spec) {
+    std::vector<std::string> parameters_;
+    boost::algorithm::split(parameters_, spec, boost::is_any_of(";"));
+    for (auto &p : parameters_) {
+      boost::algorithm::trim(p);
+      if (p.empty()) {
+        continue;
+      }
+      auto k = p.find('=');
+      CHECK(k != std::string::npos && k > 0)
+          << "a swept flag is <flag>=<values>, not " << p;
+      Parameter parameter;
+      parameter.flag = p.substr(0, k);
+      parameter.values = expand(p.substr(k + 1));
+      parameters.push_back(std::move(parameter));
+    }
+  }
+
+  // the flags of Macros.h the tables are created or loaded with, a bench
+  // adds its own
+  static std::vector<std::string> load_flags() {
+    return {"servers", "id", "partition_num", "partitioner", "protocol",
+            "replica_group", "mvcc", "numa", "image_path", "anti_cache_path",
+            "anti_cache_tables", "pmem_path", "rebuild_replicas"};
+  }
+
+  bool enabled() const { return !parameters.empty(); }
+
+  const std::vector<Parameter> &get_parameters() const { return parameters; }
+
+  // the number of runs, one without a sweep
+  std::size_t size() const {
+    std::size_t n = 1;
+    for (auto &parameter : parameters) {
+      n *= parameter.values.size();
+    }
+    return n;
+  }
+
+  // the value of each flag at point i
+  std::vector<std::string> point(std::size_t i) const {
+    DCHECK(i < size());
+    std::vector<std::string> values(parameters.size());
+    for (auto k = parameters.size(); k-- > 0;) {
+      auto &v = parameters[k].values;
+      values[k] = v[i % v.size()];
+      i /= v.size();
+    }
+    return values;
+  }
+
+  // sets the flags of point i with set(flag, value), which returns an empty
+  // string if there is no such flag, e.g., google::SetCommandLineOption
+  template <class Set> void apply(std::size_t i, Set set) const {
+    auto values = point(i);
+    for (auto k = 0u; k < parameters.size(); k++) {
+      auto &flag = parameters[k].flag;
+      CHECK(!std::string(set(flag.c_str(), values[k].c_str())).empty())
+          << "--sweep sets " << flag << " to " << values[k]
+          << ", which is not a flag or not a value of it.";
+    }
+  }
+
+  // true if one of flags has another value at point i than at point i - 1
+  bool changes(std::size_t i, const std::vector<std::string> &flags) const {
+    if (i == 0) {
+      return true;
+    }
+    auto values = point(i), last = point(i - 1);
+    for (auto k = 0u; k < parameters.size(); k++) {
+      if (values[k] != last[k] &&
+          std::find(flags.begin(), flags.end(), parameters[k].flag) !=
+              flags.end()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // the measured statistics of the run of point i, over seconds seconds
+  void add_run(std::size_t i, bool reloaded, const Statistics &s,
+               int seconds) {
+    Run run;
+    run.point = i;
+    run.reloaded = reloaded;
+    run.seconds = seconds;
+    run.commit_per_second = seconds > 0 ? 1.0 * s.n_commit / seconds : 0;
+    auto n = s.n_commit + s.n_abort();
+    run.abort_rate = n > 0 ? 1.0 * s.n_abort() / n : 0;
+    run.p50 = s.latency.nth(50);
+    run.p95 = s.latency.nth(95);
+    run.p99 = s.latency.nth(99);
+    run.p999 = s.latency.nth(99.9);
+    runs.push_back(run);
+  }
+
+  std::string to_json() const {
+    std::ostringstream os;
+    os << "{\"flags\":[";
+    for (auto k = 0u; k < parameters.size(); k++) {
+      os << (k == 0 ? "" : ",") << RunResults::quote(parameters[k].flag);
+    }
+    os << "],\n\"runs\":[";
+    for (auto i = 0u; i < runs.size(); i++) {
+      auto &run = runs[i];
+      auto values = point(run.point);
+      os << (i == 0 ? "\n" : ",\n") << "{\"point\":{";
+      for (auto k = 0u; k < parameters.size(); k++) {
+        os << (k == 0 ? "" : ",") << RunResults::quote(parameters[k].flag)
+           << ":" << RunResults::quote(values[k]);
+      }
+      os << "},\"reloaded\":" << (run.reloaded ? "true" : "false")
+         << ",\"seconds\":" << run.seconds
+         << ",\"commit_per_second\":" << run.commit_per_second
+         << ",\"scaling\":" << scaling(run)
+         << ",\"abort_rate\":" << run.abort_rate
+         << ",\"latency_us\":{\"p50\":" << run.p50 << ",\"p95\":" << run.p95
+         << ",\"p99\":" << run.p99 << ",\"p999\":" << run.p999 << "}}";
+    }
+    os << "]}\n";
+    return os.str();
+  }
+
+  // a row per run, the columns aligned
+  std::string to_table() const {
+    std::vector<std::vector<std::string>> rows;
+    std::vector<std::string> header;
+    for (auto &parameter : parameters) {
+      header.push_back(parameter.flag);
+    }
+    for (auto column : {"reload", "commit/s", "scaling", "abort%", "p50_us",
+                        "p95_us", "p99_us", "p999_us"}) {
+      header.push_back(column);
+    }
+    rows.push_back(header);
+    for (auto &run : runs) {
+      auto row = point(run.point);
+      row.push_back(run.reloaded ? "yes" : "no");
+      row.push_back(format("%.0f", run.commit_per_second));
+      row.push_back(format("%.2f", scaling(run)));
+      row.push_back(format("%.2f", 100 * run.abort_rate));
+      for (auto p : {run.p50, run.p95, run.p99, run.p999}) {
+        row.push_back(std::to_string(p));
+      }
+      rows.push_back(row);
+    }
+
+    std::vector<std::size_t> widths(header.size());
+    for (auto &row : rows) {
+      for (auto k = 0u; k < row.size(); k++) {
+        widths[k] = std::max(widths[k], row[k].size());
+      }
+    }
+    std::ostringstream os;
+    for (auto &row : rows) {
+      for (auto k = 0u; k < row.size(); k++) {
+        os << (k == 0 ? "" : "  ") << row[k]
+           << std::string(k + 1 < row.size() ? widths[k] - row[k].size() : 0,
+                          ' ');
+      }
+      os << "\n";
+    }
+    return os.str();
+  }
+
+  // the JSON to filename, the table to filename.txt
+  void write(const std::string &filename) const {
+    std::ofstream json(filename), table(filename + ".txt");
+    CHECK(json && table) << "failed to open " << filename;
+    json << to_json();
+    table << to_table();
+  }
+
+  // the values of a flag, see the format
+  static std::vector<std::string> expand(const std::string &values) {
+    std::vector<std::string> result;
+    auto k = values.find("..");
+    if (k == std::string::npos) {
+      CHECK(!values.empty()) << "a swept flag has no values.";
+      boost::algorithm::split(result, values, boost::is_any_of(","));
+      for (auto &v : result) {
+        boost::algorithm::trim(v);
+      }
+      return result;
+    }
+
+    auto plus = values.find('+', k);
+    double lo = std::stod(values.substr(0, k));
+    double hi = std::stod(values.substr(k + 2, plus - k - 2));
+    double step = plus == std::string::npos ? 0 : std::stod(values.substr(plus));
+    CHECK(lo <= hi && (step > 0 || (plus == std::string::npos && lo > 0)))
+        << values << " is not a range lo..hi or lo..hi+step.";
+    // a step of a fraction may add up to a little more than hi
+    for (double v = lo; v <= hi + step * 1e-9;
+         v = step > 0 ? v + step : v * 2) {
+      std::ostringstream os;
+      os << v;
+      result.push_back(os.str());
+    }
+    return result;
+  }
+
+private:
+  double scaling(const Run &run) const {
+    auto base = runs.front().commit_per_second;
+    return base > 0 ? run.commit_per_second / base : 0;
+  }
+
+  static std::string format(const char *f, double v) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), f, v);
+    return buffer;
+  }
+
+private:
+  std::vector<Parameter> parameters;
+  std::vector<Run> runs;
+};
+} // namespace coco
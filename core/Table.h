@@ -4,20 +4,70 @@
 
 #pragma once
 
+#include "common/Arena.h"
+#include "common/BTree.h"
 #include "common/ClassOf.h"
+#include "common/ColdFile.h"
 #include "common/Encoder.h"
-#include "common/HashMap.h"
 #include "common/MVCCHashMap.h"
+#include "common/OpenHashMap.h"
+#include "common/PersistentMemory.h"
 #include "common/StringPiece.h"
+#include "core/FieldLayout.h"
+#include "core/PartitionGate.h"
+#include "core/SnapshotVersions.h"
+#include "core/Tombstone.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "core/Context.h"
 
 namespace coco {
 
+// keeps an index in step with the rows of a table, see SecondaryIndex
+class ISecondaryIndex {
+public:
+  virtual ~ISecondaryIndex() = default;
+
+  // called once the row of key is inserted with value
+  virtual void insert(const void *key, const void *value) = 0;
+
+  // called once the row of key is written from old_value to value
+  virtual void update(const void *key, const void *old_value,
+                      const void *value) = 0;
+};
+
+// the memory of a table partition, see ITable::memory_usage
+struct TableMemory {
+  std::size_t rows = 0;
+  std::size_t versions = 0; // more than rows in mvcc tables
+  std::size_t payload = 0;  // bytes of the keys and of the values of versions
+  std::size_t overhead = 0; // the other bytes of memory_size()
+
+  std::size_t total() const { return payload + overhead; }
+
+  void merge(const TableMemory &m) {
+    rows += m.rows;
+    versions += m.versions;
+    payload += m.payload;
+    overhead += m.overhead;
+  }
+};
+
 class ITable {
 public:
   using MetaDataType = std::atomic<uint64_t>;
+  using RowFuncType = std::function<void(const void *, MetaDataType &, void *)>;
+  // returns false to stop the scan
+  using ScanFuncType =
+      std::function<bool(const void *, MetaDataType &, void *)>;
+  // a node version and its value when it was read
+  using NodeSetType =
+      std::vector<std::tuple<const std::atomic<uint64_t> *, uint64_t>>;
 
   virtual ~ITable() = default;
 
@@ -26,6 +76,18 @@ public:
 
   virtual void *search_value(const void *key, uint64_t version = 0) = 0;
 
+  // rows[i] = search(keys[i]) for i < n, tables may overlap the lookups.
+  virtual void search_batch(const void *const *keys,
+                            std::tuple<MetaDataType *, void *> *rows,
+                            std::size_t n) {
+    for (auto i = 0u; i < n; i++) {
+      rows[i] = search(keys[i]);
+    }
+  }
+
+  // one step of a lookup of key that is coming, see OpenHashMap::prefetch
+  virtual void prefetch(const void *key, std::size_t level) {}
+
   virtual MetaDataType &search_metadata(const void *key,
                                         uint64_t version = 0) = 0;
 
@@ -43,13 +105,136 @@ public:
   virtual void update(const void *key, const void *value,
                       uint64_t version = 0) = 0;
 
+  // removes the row of key, e.g., a stale entry of a secondary index. Readers
+  // may still hold the row until the table is destroyed.
+  virtual void remove(const void *key) {
+    CHECK(false) << "table " << tableID() << " does not support removes.";
+  }
+
   virtual void garbage_collect(const void *key) = 0;
 
+  // remove the versions no snapshot from watermark on reads, only mvcc tables
+  // keep old versions, see VersionReclaimer. Tables with a tombstone remove
+  // the rows retired before the last call instead, see Tombstone.
+  virtual std::size_t reclaim(uint64_t watermark) { return 0; }
+
+  // called once a transaction deleted the row of key, i.e., the row is a
+  // tombstone, so that reclaim removes it later
+  virtual void retire(const void *key) {}
+
+  // writes the values of the rows not accessed since second to disk and
+  // reads back the evicted rows looked up since the last call, only evictable
+  // tables evict rows, see AntiCache.
+  virtual std::size_t evict(uint32_t second) { return 0; }
+
+  virtual std::size_t fetch() { return 0; }
+
+  // false while the value of the row of key is on disk
+  virtual bool is_resident(const void *key) { return true; }
+
+  // whether the rows were kept from a former run, so that the loader skips
+  // the table, and called once the table is loaded. Only persistent tables
+  // keep their rows, see PersistentTable.
+  virtual bool is_restored() { return false; }
+
+  virtual void set_loaded() {}
+
+  // hint the number of rows the loader is about to insert
+  virtual void reserve(std::size_t n) = 0;
+
+  // call func(key, metadata, value) on every row, or on the latest version of
+  // every row in a mvcc table.
+  virtual void for_each_row(const RowFuncType &func) = 0;
+
+  // call func(key, metadata, value) on the rows with start <= key < end in
+  // key order until it returns false. The versions of the index nodes visited
+  // are appended to node_set if it is not nullptr, so that a later insert or
+  // remove in the range can be detected. Only ordered tables support scans.
+  virtual void scan(const void *start, const void *end,
+                    const ScanFuncType &func, NodeSetType *node_set = nullptr) {
+    CHECK(false) << "table " << tableID() << " does not support scans.";
+  }
+
   virtual void deserialize_value(const void *key, StringPiece stringPiece,
                                  uint64_t version = 0) = 0;
 
   virtual void serialize_value(Encoder &enc, const void *value) = 0;
 
+  // a bit per field of value that differs from the row of key, tables without
+  // a field layout treat the value as a single field, see FieldLayout.
+  virtual uint64_t changed_fields(const void *key, const void *value) {
+    return std::memcmp(search_value(key), value, value_size()) != 0;
+  }
+
+  // the number of bytes serialize_fields writes for mask
+  virtual std::size_t fields_size(uint64_t mask) {
+    return mask & 1 ? value_size() : 0;
+  }
+
+  // writes the raw bytes of the fields of value in mask
+  virtual void serialize_fields(Encoder &enc, const void *value,
+                                uint64_t mask) {
+    if (mask & 1) {
+      enc.write_n_bytes(value, value_size());
+    }
+  }
+
+  // patches the fields in mask of the row of key
+  virtual void deserialize_fields(const void *key, StringPiece stringPiece,
+                                  uint64_t mask) {
+    DCHECK(stringPiece.size() == fields_size(mask));
+    if (mask & 1) {
+      save_snapshot_version(key, search_value(key));
+      std::memcpy(search_value(key), stringPiece.data(), value_size());
+    }
+  }
+
+  // the fields of a value as they are laid out in memory, tables without a
+  // field layout treat the value as a single field, see FieldLayout.
+  virtual std::size_t field_count() { return 1; }
+
+  virtual std::size_t field_offset(std::size_t i) { return 0; }
+
+  virtual std::size_t field_length(std::size_t i) { return value_size(); }
+
+  // the fields of the key and of the value with their names and types, see
+  // row_columns
+  virtual std::vector<Column> columns() {
+    return {Column{"key", FieldType::BYTES, true, 0, key_size()},
+            Column{"value", FieldType::BYTES, false, 0, value_size()}};
+  }
+
+  // the bytes of the fields in mask, tables without a field layout read the
+  // whole value, see FieldProjection.
+  virtual std::size_t projection_size(uint64_t mask) { return value_size(); }
+
+  // the fields in mask of value to projection_size(mask) bytes at dest
+  virtual void pack_fields(char *dest, const void *value, uint64_t mask) {
+    std::memcpy(dest, value, value_size());
+  }
+
+  // the fields in mask of value from projection_size(mask) bytes at src
+  virtual void unpack_fields(void *value, const char *src, uint64_t mask) {
+    std::memcpy(value, src, value_size());
+  }
+
+  // the fields in mask of the value at src to the value at dest
+  virtual void copy_fields(void *dest, const void *src, uint64_t mask) {
+    std::memcpy(dest, src, value_size());
+  }
+
+  // bytes of the rows and the index, 0 if the table does not count them
+  virtual std::size_t memory_size() { return 0; }
+
+  // the bytes of memory_size() on explicit huge pages, see Arena
+  virtual std::size_t huge_page_size() { return 0; }
+
+  // memory_size() split into the keys and values the rows hold and the
+  // overhead, e.g., the index, the metadata and the padding of the rows,
+  // and the rows allocated ahead of the inserts. Zeros if the table does not
+  // count its memory. It visits the whole table in mvcc tables.
+  virtual TableMemory memory_usage() { return TableMemory(); }
+
   virtual std::size_t key_size() = 0;
 
   virtual std::size_t value_size() = 0;
@@ -59,11 +244,130 @@ public:
   virtual std::size_t tableID() = 0;
 
   virtual std::size_t partitionID() = 0;
+
+  // with a pinned snapshot, a row keeps its value at the pin in versions
+  // before it is first overwritten, see Snapshot. Only set between epochs.
+  // Mvcc tables keep their own versions and do not support it.
+  void set_snapshot_versions(SnapshotVersions *versions) {
+    snapshot_versions = versions;
+  }
+
+  SnapshotVersions *get_snapshot_versions() const { return snapshot_versions; }
+
+  // the row of a missing key is created as a tombstone from now on, see
+  // Tombstone. Only Table and OrderedTable support tombstones, other tables
+  // create a missing row with metadata 0.
+  void set_tombstone(const Tombstone &t) { tombstone = t; }
+
+  const Tombstone &get_tombstone() const { return tombstone; }
+
+  // the gate of the partition of the table, nullptr without
+  // --partition_serial
+  void set_partition_gate(PartitionGate *gate) { partition_gate = gate; }
+
+  PartitionGate *get_partition_gate() const { return partition_gate; }
+
+  // the fields in mask only take additions from now on, writes of a row
+  // leave them as they are, see CommutativeUpdate
+  void set_additive_fields(uint64_t mask) {
+    CHECK(field_count() > 1) << "table " << tableID() << " has one field.";
+    additive_fields = mask;
+  }
+
+  uint64_t get_additive_fields() const { return additive_fields; }
+
+  // adds to field i of the row of key, it does not change the tid of the row
+  void add_to_field(const void *key, std::size_t i,
+                    const FieldAddition &addition) {
+    DCHECK(additive_fields >> i & 1);
+    DCHECK(addition.size() == field_length(i));
+    auto value = static_cast<char *>(search_value(key));
+    addition.apply(value + field_offset(i));
+  }
+
+  // index is updated in the same write as each row of the table from now on,
+  // so that it commits and replicates with the row. Mvcc tables do not
+  // maintain indexes.
+  virtual void add_index(ISecondaryIndex *index) { indexes.push_back(index); }
+
+protected:
+  // the memory_usage() of a table with rows rows and versions versions
+  TableMemory memory_usage_of(std::size_t rows, std::size_t versions) {
+    TableMemory m;
+    m.rows = rows;
+    m.versions = versions;
+    m.payload = rows * key_size() + versions * value_size();
+    auto size = memory_size();
+    m.overhead = size > m.payload ? size - m.payload : 0;
+    return m;
+  }
+
+  // called before value, the row of key, is overwritten
+  void save_snapshot_version(const void *key, const void *value) {
+    if (snapshot_versions != nullptr) {
+      snapshot_versions->save(key, value);
+    }
+  }
+
+  // the metadata of a row created for a missing key
+  template <class RowType> void init_row(RowType &row) {
+    std::get<0>(row).store(tombstone.absent_bit, std::memory_order_relaxed);
+  }
+
+  // marks a retired row removed unless it is inserted again or locked
+  bool mark_removed(MetaDataType &metadata) {
+    uint64_t value = metadata.load();
+    return tombstone.is_removable(value) &&
+           metadata.compare_exchange_strong(value, tombstone.removed(value));
+  }
+
+  void insert_indexes(const void *key, const void *value) {
+    for (auto index : indexes) {
+      index->insert(key, value);
+    }
+  }
+
+  // overwrites row, the value of key, with write(row)
+  template <class ValueType, class Func>
+  void write_row(const void *key, ValueType &row, Func write) {
+    save_snapshot_version(key, &row);
+    if (indexes.empty() && additive_fields == 0) {
+      write(row);
+      return;
+    }
+    ValueType old_value = row;
+    if (additive_fields == 0) {
+      write(row);
+    } else {
+      // the additive fields may take additions in the meantime
+      ValueType value = row;
+      write(value);
+      FieldProjection<ValueType>::copy(row, value, ~additive_fields);
+    }
+    for (auto index : indexes) {
+      index->update(key, &old_value, &row);
+    }
+  }
+
+  Tombstone tombstone;
+
+private:
+  uint64_t additive_fields = 0;
+  SnapshotVersions *snapshot_versions = nullptr;
+  PartitionGate *partition_gate = nullptr;
+  std::vector<ISecondaryIndex *> indexes;
 };
 
-/* parameter version is not used in Table. */
+/*
+ * parameter version is not used in Table.
+ *
+ * Table is final, so calls made through a Table reference (e.g., from a
+ * database's visit_table) are resolved at compile time and the hash probe and
+ * value copy can be inlined into the caller. ITable is kept for code that only
+ * knows the table id, such as message handlers.
+ */
 template <std::size_t N, class KeyType, class ValueType>
-class Table : public ITable {
+class Table final : public ITable {
 public:
   using MetaDataType = std::atomic<uint64_t>;
 
@@ -75,37 +379,52 @@ public:
   std::tuple<MetaDataType *, void *> search(const void *key,
                                             uint64_t version = 0) override {
     const auto &k = *static_cast<const KeyType *>(key);
-    auto &v = map_[k];
+    auto &v = find_row(k);
     return std::make_tuple(&std::get<0>(v), &std::get<1>(v));
   }
 
   void *search_value(const void *key, uint64_t version = 0) override {
     const auto &k = *static_cast<const KeyType *>(key);
-    return &std::get<1>(map_[k]);
+    return &std::get<1>(find_row(k));
+  }
+
+  void search_batch(const void *const *keys,
+                    std::tuple<MetaDataType *, void *> *rows,
+                    std::size_t n) override {
+    map_.find_batch(
+        reinterpret_cast<const KeyType *const *>(keys), n,
+        [rows](std::size_t i, std::tuple<MetaDataType, ValueType> &v) {
+          rows[i] = std::make_tuple(&std::get<0>(v), &std::get<1>(v));
+        },
+        [this](std::tuple<MetaDataType, ValueType> &v) { init_row(v); });
+  }
+
+  void prefetch(const void *key, std::size_t level) override {
+    map_.prefetch(*static_cast<const KeyType *>(key), level);
   }
 
   MetaDataType &search_metadata(const void *key,
                                 uint64_t version = 0) override {
     const auto &k = *static_cast<const KeyType *>(key);
-    return std::get<0>(map_[k]);
+    return std::get<0>(find_row(k));
   }
 
   std::tuple<MetaDataType *, void *> search_prev(const void *key,
                                                  uint64_t version) override {
     const auto &k = *static_cast<const KeyType *>(key);
-    auto &v = map_[k];
+    auto &v = find_row(k);
     return std::make_tuple(&std::get<0>(v), &std::get<1>(v));
   }
 
   void *search_value_prev(const void *key, uint64_t version) override {
     const auto &k = *static_cast<const KeyType *>(key);
-    return &std::get<1>(map_[k]);
+    return &std::get<1>(find_row(k));
   }
 
   MetaDataType &search_metadata_prev(const void *key,
                                      uint64_t version) override {
     const auto &k = *static_cast<const KeyType *>(key);
-    return std::get<0>(map_[k]);
+    return std::get<0>(find_row(k));
   }
 
   void insert(const void *key, const void *value,
@@ -113,33 +432,61 @@ public:
     const auto &k = *static_cast<const KeyType *>(key);
     const auto &v = *static_cast<const ValueType *>(value);
     DCHECK(map_.contains(k) == false);
-    auto &row = map_[k];
+    auto &row = find_row(k);
     std::get<0>(row).store(0);
     std::get<1>(row) = v;
+    insert_indexes(key, value);
   }
 
   void update(const void *key, const void *value,
               uint64_t version = 0) override {
     const auto &k = *static_cast<const KeyType *>(key);
     const auto &v = *static_cast<const ValueType *>(value);
-    auto &row = map_[k];
-    std::get<1>(row) = v;
+    auto &row = find_row(k);
+    write_row(key, std::get<1>(row), [&v](ValueType &row) { row = v; });
+  }
+
+  void remove(const void *key) override {
+    map_.remove(*static_cast<const KeyType *>(key));
   }
 
   void garbage_collect(const void *key) override {}
 
+  std::size_t reclaim(uint64_t watermark) override {
+    std::size_t n = 0;
+    for (auto &key : retired.take()) {
+      auto v = map_.lookup(key);
+      if (v != nullptr && mark_removed(std::get<0>(*v))) {
+        map_.remove(key);
+        n++;
+      }
+    }
+    return n;
+  }
+
+  void retire(const void *key) override {
+    retired.add(*static_cast<const KeyType *>(key));
+  }
+
+  void reserve(std::size_t n) override { map_.reserve(n); }
+
+  void for_each_row(const RowFuncType &func) override {
+    map_.for_each([&func](const KeyType &key,
+                          std::tuple<MetaDataType, ValueType> &row) {
+      func(&key, std::get<0>(row), &std::get<1>(row));
+    });
+  }
+
   void deserialize_value(const void *key, StringPiece stringPiece,
                          uint64_t version = 0) override {
 
-    std::size_t size = stringPiece.size();
     const auto &k = *static_cast<const KeyType *>(key);
-    auto &row = map_[k];
-    auto &v = std::get<1>(row);
-
-    Decoder dec(stringPiece);
-    dec >> v;
-
-    DCHECK(size - dec.size() == ClassOf<ValueType>::size());
+    auto &row = find_row(k);
+    write_row(key, std::get<1>(row), [stringPiece](ValueType &row) {
+      Decoder dec(stringPiece);
+      dec >> row;
+      DCHECK(stringPiece.size() - dec.size() == ClassOf<ValueType>::size());
+    });
   }
 
   void serialize_value(Encoder &enc, const void *value) override {
@@ -151,6 +498,73 @@ public:
     DCHECK(enc.size() - size == ClassOf<ValueType>::size());
   }
 
+  uint64_t changed_fields(const void *key, const void *value) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    return FieldDelta<ValueType>::changed_fields(
+        *static_cast<const ValueType *>(search_value(key)), v);
+  }
+
+  std::size_t fields_size(uint64_t mask) override {
+    return FieldDelta<ValueType>::size(mask);
+  }
+
+  void serialize_fields(Encoder &enc, const void *value,
+                        uint64_t mask) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    FieldDelta<ValueType>::serialize(enc, v, mask);
+  }
+
+  void deserialize_fields(const void *key, StringPiece stringPiece,
+                          uint64_t mask) override {
+    auto &v = *static_cast<ValueType *>(search_value(key));
+    write_row(key, v, [stringPiece, mask](ValueType &row) {
+      FieldDelta<ValueType>::deserialize(stringPiece, row, mask);
+    });
+  }
+
+  std::size_t projection_size(uint64_t mask) override {
+    return FieldProjection<ValueType>::size(mask);
+  }
+
+  void pack_fields(char *dest, const void *value, uint64_t mask) override {
+    FieldProjection<ValueType>::pack(
+        dest, *static_cast<const ValueType *>(value), mask);
+  }
+
+  void unpack_fields(void *value, const char *src, uint64_t mask) override {
+    FieldProjection<ValueType>::unpack(*static_cast<ValueType *>(value), src,
+                                       mask);
+  }
+
+  void copy_fields(void *dest, const void *src, uint64_t mask) override {
+    FieldProjection<ValueType>::copy(*static_cast<ValueType *>(dest),
+                                     *static_cast<const ValueType *>(src),
+                                     mask);
+  }
+
+  std::size_t memory_size() override { return map_.memory_size(); }
+
+  std::size_t huge_page_size() override { return map_.huge_page_size(); }
+
+  TableMemory memory_usage() override {
+    auto rows = map_.size();
+    return memory_usage_of(rows, rows);
+  }
+
+  std::size_t field_count() override { return FieldLayout<ValueType>::size(); }
+
+  std::size_t field_offset(std::size_t i) override {
+    return FieldLayout<ValueType>::offset(i);
+  }
+
+  std::size_t field_length(std::size_t i) override {
+    return FieldLayout<ValueType>::length(i);
+  }
+
+  std::vector<Column> columns() override {
+    return row_columns<KeyType, ValueType>();
+  }
+
   std::size_t key_size() override { return sizeof(KeyType); }
 
   std::size_t value_size() override { return sizeof(ValueType); }
@@ -162,7 +576,14 @@ public:
   std::size_t partitionID() override { return partitionID_; }
 
 private:
-  HashMap<N, KeyType, std::tuple<MetaDataType, ValueType>> map_;
+  std::tuple<MetaDataType, ValueType> &find_row(const KeyType &k) {
+    return map_.find_or_init(
+        k, [this](std::tuple<MetaDataType, ValueType> &v) { init_row(v); });
+  }
+
+private:
+  OpenHashMap<N, KeyType, std::tuple<MetaDataType, ValueType>> map_;
+  RetiredKeys<KeyType> retired;
   std::size_t tableID_;
   std::size_t partitionID_;
 };
@@ -254,8 +675,13 @@ public:
     CHECK(row_ptr != nullptr)
         << "key with version: " << version << " does not exist.";
     auto &row = *row_ptr;
-    std::get<0>(row).store(0);
+    // a version is readable once its metadata is 0, see BohmHelper
     std::get<1>(row) = v;
+    std::get<0>(row).store(0, std::memory_order_release);
+  }
+
+  void add_index(ISecondaryIndex *index) override {
+    CHECK(false) << "mvcc tables do not maintain secondary indexes.";
   }
 
   void garbage_collect(const void *key) override {
@@ -264,6 +690,21 @@ public:
     map_.vacuum_key_keep_latest(k);
   }
 
+  std::size_t reclaim(uint64_t watermark) override {
+    return map_.reclaim(watermark);
+  }
+
+  // versions are allocated on demand
+  void reserve(std::size_t n) override {}
+
+  void for_each_row(const RowFuncType &func) override {
+    map_.for_each_latest(
+        [&func](const KeyType &key, uint64_t version,
+                std::tuple<MetaDataType, ValueType> &row) {
+          func(&key, std::get<0>(row), &std::get<1>(row));
+        });
+  }
+
   void deserialize_value(const void *key, StringPiece stringPiece,
                          uint64_t version = 0) override {
 
@@ -288,6 +729,31 @@ public:
     DCHECK(enc.size() - size == ClassOf<ValueType>::size());
   }
 
+  // the values of the versions and the chains of the keys
+  std::size_t memory_size() override {
+    return map_.memory_size() + map_.index_size();
+  }
+
+  std::size_t huge_page_size() override { return map_.huge_page_size(); }
+
+  TableMemory memory_usage() override {
+    return memory_usage_of(map_.size(), map_.n_versions());
+  }
+
+  std::size_t field_count() override { return FieldLayout<ValueType>::size(); }
+
+  std::size_t field_offset(std::size_t i) override {
+    return FieldLayout<ValueType>::offset(i);
+  }
+
+  std::size_t field_length(std::size_t i) override {
+    return FieldLayout<ValueType>::length(i);
+  }
+
+  std::vector<Column> columns() override {
+    return row_columns<KeyType, ValueType>();
+  }
+
   std::size_t key_size() override { return sizeof(KeyType); }
 
   std::size_t value_size() override { return sizeof(ValueType); }
@@ -304,18 +770,1167 @@ private:
   std::size_t partitionID_;
 };
 
-class TableFactory {
+/*
+ * OrderedTable keeps its rows in a B+ tree, so that it supports range scans
+ * and phantom detection through node versions. parameter version is not used.
+ */
+template <class KeyType, class ValueType>
+class OrderedTable final : public ITable {
 public:
-  template <std::size_t N, class KeyType, class ValueType>
-  static std::unique_ptr<ITable> create_table(const Context &context,
-                                              std::size_t tableID,
-                                              std::size_t partitionID) {
-    if (context.mvcc) {
-      return std::make_unique<MVCCTable<N, KeyType, ValueType>>(tableID,
-                                                                partitionID);
-    } else {
-      return std::make_unique<Table<N, KeyType, ValueType>>(tableID,
-                                                            partitionID);
+  using MetaDataType = std::atomic<uint64_t>;
+
+  virtual ~OrderedTable() override = default;
+
+  OrderedTable(std::size_t tableID, std::size_t partitionID)
+      : tableID_(tableID), partitionID_(partitionID) {}
+
+  std::tuple<MetaDataType *, void *> search(const void *key,
+                                            uint64_t version = 0) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    auto &v = find_row(k);
+    return std::make_tuple(&std::get<0>(v), &std::get<1>(v));
+  }
+
+  void *search_value(const void *key, uint64_t version = 0) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    return &std::get<1>(find_row(k));
+  }
+
+  MetaDataType &search_metadata(const void *key,
+                                uint64_t version = 0) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    return std::get<0>(find_row(k));
+  }
+
+  std::tuple<MetaDataType *, void *> search_prev(const void *key,
+                                                 uint64_t version) override {
+    return search(key);
+  }
+
+  void *search_value_prev(const void *key, uint64_t version) override {
+    return search_value(key);
+  }
+
+  MetaDataType &search_metadata_prev(const void *key,
+                                     uint64_t version) override {
+    return search_metadata(key);
+  }
+
+  void insert(const void *key, const void *value,
+              uint64_t version = 0) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    const auto &v = *static_cast<const ValueType *>(value);
+    DCHECK(tree_.contains(k) == false);
+    auto &row = find_row(k);
+    std::get<0>(row).store(0);
+    std::get<1>(row) = v;
+    insert_indexes(key, value);
+  }
+
+  void update(const void *key, const void *value,
+              uint64_t version = 0) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    const auto &v = *static_cast<const ValueType *>(value);
+    auto &row = find_row(k);
+    write_row(key, std::get<1>(row), [&v](ValueType &row) { row = v; });
+  }
+
+  void remove(const void *key) override {
+    tree_.remove(*static_cast<const KeyType *>(key));
+  }
+
+  void garbage_collect(const void *key) override {}
+
+  std::size_t reclaim(uint64_t watermark) override {
+    std::size_t n = 0;
+    for (auto &key : retired.take()) {
+      auto v = tree_.find(key);
+      if (v != nullptr && mark_removed(std::get<0>(*v))) {
+        tree_.remove(key);
+        n++;
+      }
+    }
+    return n;
+  }
+
+  void retire(const void *key) override {
+    retired.add(*static_cast<const KeyType *>(key));
+  }
+
+  // nodes are allocated on demand
+  void reserve(std::size_t n) override {}
+
+  void for_each_row(const RowFuncType &func) override {
+    tree_.for_each(
+        [&func](const KeyType &key, std::tuple<MetaDataType, ValueType> &row) {
+          func(&key, std::get<0>(row), &std::get<1>(row));
+        });
+  }
+
+  void scan(const void *start, const void *end, const ScanFuncType &func,
+            NodeSetType *node_set = nullptr) override {
+    tree_.scan(
+        static_cast<const KeyType *>(start), static_cast<const KeyType *>(end),
+        [&func](const KeyType &key, std::tuple<MetaDataType, ValueType> &row) {
+          return func(&key, std::get<0>(row), &std::get<1>(row));
+        },
+        [node_set](const std::atomic<uint64_t> &node_version, uint64_t value) {
+          if (node_set != nullptr) {
+            node_set->emplace_back(&node_version, value);
+          }
+        });
+  }
+
+  void deserialize_value(const void *key, StringPiece stringPiece,
+                         uint64_t version = 0) override {
+
+    const auto &k = *static_cast<const KeyType *>(key);
+    auto &v = std::get<1>(find_row(k));
+    write_row(key, v, [stringPiece](ValueType &row) {
+      Decoder dec(stringPiece);
+      dec >> row;
+      DCHECK(stringPiece.size() - dec.size() == ClassOf<ValueType>::size());
+    });
+  }
+
+  void serialize_value(Encoder &enc, const void *value) override {
+
+    std::size_t size = enc.size();
+    const auto &v = *static_cast<const ValueType *>(value);
+    enc << v;
+
+    DCHECK(enc.size() - size == ClassOf<ValueType>::size());
+  }
+
+  // the value is a single field, see ITable::changed_fields
+  void deserialize_fields(const void *key, StringPiece stringPiece,
+                          uint64_t mask) override {
+    DCHECK(stringPiece.size() == fields_size(mask));
+    if (mask & 1) {
+      auto &v = std::get<1>(find_row(*static_cast<const KeyType *>(key)));
+      write_row(key, v, [stringPiece](ValueType &row) {
+        std::memcpy(&row, stringPiece.data(), sizeof(ValueType));
+      });
+    }
+  }
+
+  std::size_t memory_size() override { return tree_.memory_size(); }
+
+  TableMemory memory_usage() override {
+    auto rows = tree_.size();
+    return memory_usage_of(rows, rows);
+  }
+
+  std::size_t field_count() override { return FieldLayout<ValueType>::size(); }
+
+  std::size_t field_offset(std::size_t i) override {
+    return FieldLayout<ValueType>::offset(i);
+  }
+
+  std::size_t field_length(std::size_t i) override {
+    return FieldLayout<ValueType>::length(i);
+  }
+
+  std::vector<Column> columns() override {
+    return row_columns<KeyType, ValueType>();
+  }
+
+  std::size_t key_size() override { return sizeof(KeyType); }
+
+  std::size_t value_size() override { return sizeof(ValueType); }
+
+  std::size_t field_size() override { return ClassOf<ValueType>::size(); }
+
+  std::size_t tableID() override { return tableID_; }
+
+  std::size_t partitionID() override { return partitionID_; }
+
+private:
+  std::tuple<MetaDataType, ValueType> &find_row(const KeyType &k) {
+    return tree_.find_or_init(
+        k, [this](std::tuple<MetaDataType, ValueType> &v) { init_row(v); });
+  }
+
+private:
+  BTree<KeyType, std::tuple<MetaDataType, ValueType>> tree_;
+  RetiredKeys<KeyType> retired;
+  std::size_t tableID_;
+  std::size_t partitionID_;
+};
+
+/*
+ * ReferenceTable keeps the rows of a read-only table, e.g., the item table of
+ * TPC-C, in a flat array sorted by key. It is loaded on every node and never
+ * written once set_loaded() is called, so find() reads a row with a binary
+ * search and no metadata, and the reads are not validated. The rows share one
+ * metadata word, which is always 0, for the callers through ITable. parameter
+ * version is not used.
+ */
+template <class KeyType, class ValueType>
+class ReferenceTable final : public ITable {
+public:
+  using MetaDataType = std::atomic<uint64_t>;
+
+  virtual ~ReferenceTable() override = default;
+
+  ReferenceTable(std::size_t tableID, std::size_t partitionID)
+      : tableID_(tableID), partitionID_(partitionID) {}
+
+  // the value of key, nullptr if key does not exist
+  const ValueType *find(const KeyType &key) const {
+    DCHECK(loaded_);
+    auto it = std::lower_bound(
+        rows_.begin(), rows_.end(), key,
+        [](const Row &row, const KeyType &key) { return row.first < key; });
+    if (it == rows_.end() || it->first != key) {
+      return nullptr;
+    }
+    return &it->second;
+  }
+
+  std::tuple<MetaDataType *, void *> search(const void *key,
+                                            uint64_t version = 0) override {
+    return std::make_tuple(&metadata_, search_value(key));
+  }
+
+  void *search_value(const void *key, uint64_t version = 0) override {
+    auto value = find(*static_cast<const KeyType *>(key));
+    CHECK(value != nullptr) << "table " << tableID_ << " has no such key.";
+    return const_cast<ValueType *>(value);
+  }
+
+  MetaDataType &search_metadata(const void *key,
+                                uint64_t version = 0) override {
+    return metadata_;
+  }
+
+  std::tuple<MetaDataType *, void *> search_prev(const void *key,
+                                                 uint64_t version) override {
+    return search(key);
+  }
+
+  void *search_value_prev(const void *key, uint64_t version) override {
+    return search_value(key);
+  }
+
+  MetaDataType &search_metadata_prev(const void *key,
+                                     uint64_t version) override {
+    return metadata_;
+  }
+
+  // rows are appended while loading and sorted by set_loaded()
+  void insert(const void *key, const void *value,
+              uint64_t version = 0) override {
+    CHECK(!loaded_) << "table " << tableID_ << " is read-only.";
+    rows_.emplace_back(*static_cast<const KeyType *>(key),
+                       *static_cast<const ValueType *>(value));
+    insert_indexes(key, value);
+  }
+
+  void update(const void *key, const void *value,
+              uint64_t version = 0) override {
+    CHECK(false) << "table " << tableID_ << " is read-only.";
+  }
+
+  void garbage_collect(const void *key) override {}
+
+  void set_loaded() override {
+    if (loaded_) {
+      return;
+    }
+    std::sort(rows_.begin(), rows_.end(), [](const Row &a, const Row &b) {
+      return a.first < b.first;
+    });
+    rows_.shrink_to_fit();
+    loaded_ = true;
+  }
+
+  void reserve(std::size_t n) override { rows_.reserve(n); }
+
+  void for_each_row(const RowFuncType &func) override {
+    for (auto &row : rows_) {
+      func(&row.first, metadata_, &row.second);
+    }
+  }
+
+  void scan(const void *start, const void *end, const ScanFuncType &func,
+            NodeSetType *node_set = nullptr) override {
+    DCHECK(loaded_);
+    const auto &s = *static_cast<const KeyType *>(start);
+    const auto &e = *static_cast<const KeyType *>(end);
+    auto it = std::lower_bound(
+        rows_.begin(), rows_.end(), s,
+        [](const Row &row, const KeyType &key) { return row.first < key; });
+    for (; it != rows_.end() && it->first < e; it++) {
+      if (!func(&it->first, metadata_, &it->second)) {
+        break;
+      }
+    }
+  }
+
+  void deserialize_value(const void *key, StringPiece stringPiece,
+                         uint64_t version = 0) override {
+    CHECK(!loaded_) << "table " << tableID_ << " is read-only.";
+    ValueType value;
+    Decoder dec(stringPiece);
+    dec >> value;
+    DCHECK(stringPiece.size() - dec.size() == ClassOf<ValueType>::size());
+    rows_.emplace_back(*static_cast<const KeyType *>(key), value);
+  }
+
+  void serialize_value(Encoder &enc, const void *value) override {
+
+    std::size_t size = enc.size();
+    const auto &v = *static_cast<const ValueType *>(value);
+    enc << v;
+
+    DCHECK(enc.size() - size == ClassOf<ValueType>::size());
+  }
+
+  std::size_t memory_size() override { return rows_.capacity() * sizeof(Row); }
+
+  TableMemory memory_usage() override {
+    auto rows = rows_.size();
+    return memory_usage_of(rows, rows);
+  }
+
+  std::size_t field_count() override { return FieldLayout<ValueType>::size(); }
+
+  std::size_t field_offset(std::size_t i) override {
+    return FieldLayout<ValueType>::offset(i);
+  }
+
+  std::size_t field_length(std::size_t i) override {
+    return FieldLayout<ValueType>::length(i);
+  }
+
+  std::vector<Column> columns() override {
+    return row_columns<KeyType, ValueType>();
+  }
+
+  std::size_t key_size() override { return sizeof(KeyType); }
+
+  std::size_t value_size() override { return sizeof(ValueType); }
+
+  std::size_t field_size() override { return ClassOf<ValueType>::size(); }
+
+  std::size_t tableID() override { return tableID_; }
+
+  std::size_t partitionID() override { return partitionID_; }
+
+private:
+  using Row = std::pair<KeyType, ValueType>;
+
+  std::vector<Row> rows_;
+  MetaDataType metadata_{0};
+  bool loaded_ = false;
+  std::size_t tableID_;
+  std::size_t partitionID_;
+};
+
+// the second accesses are stamped with in evictable tables, see AntiCache
+class AccessClock {
+public:
+  static std::atomic<uint32_t> &now() {
+    static std::atomic<uint32_t> second{0};
+    return second;
+  }
+};
+
+/*
+ * EvictableTable is a hash table that keeps its cold rows on disk, so that it
+ * may grow past memory, see AntiCache. The key, the metadata and the second
+ * of the last access of every row stay in memory, and the value is kept out
+ * of line.
+ *
+ * evict() writes the values of the rows not accessed since a second to the
+ * ColdFile of the table in blocks and frees them. An evicted row is left
+ * locked with the lock bit of Silo, so that a transaction that reads or
+ * writes it aborts, and looking it up queues it for fetch(), which reads the
+ * value back and unlocks the row before the transaction is retried. Freed
+ * values are reused but never unmapped, a reader still copying one sees the
+ * row locked.
+ *
+ * Writes that do not lock the row, e.g., the loader, read an evicted row
+ * back first, and for_each_row() passes a copy of an evicted value. parameter
+ * version is not used.
+ */
+template <std::size_t N, class KeyType, class ValueType>
+class EvictableTable final : public ITable {
+public:
+  using MetaDataType = std::atomic<uint64_t>;
+
+  // see SiloHelper
+  static constexpr uint64_t LOCK_BIT = 1ull << 63;
+  // values written at once
+  static constexpr std::size_t BLOCK_SIZE = 64;
+
+  virtual ~EvictableTable() override = default;
+
+  EvictableTable(std::size_t tableID, std::size_t partitionID,
+                 const std::string &filename)
+      : tableID_(tableID), partitionID_(partitionID),
+        file_(filename, sizeof(ValueType)) {}
+
+  std::tuple<MetaDataType *, void *> search(const void *key,
+                                            uint64_t version = 0) override {
+    auto &row = find(key);
+    return std::make_tuple(&row.metadata, value_of(row));
+  }
+
+  void *search_value(const void *key, uint64_t version = 0) override {
+    return value_of(find(key));
+  }
+
+  MetaDataType &search_metadata(const void *key,
+                                uint64_t version = 0) override {
+    auto &row = find(key);
+    value_of(row);
+    return row.metadata;
+  }
+
+  std::tuple<MetaDataType *, void *> search_prev(const void *key,
+                                                 uint64_t version) override {
+    return search(key);
+  }
+
+  void *search_value_prev(const void *key, uint64_t version) override {
+    return search_value(key);
+  }
+
+  MetaDataType &search_metadata_prev(const void *key,
+                                     uint64_t version) override {
+    return search_metadata(key);
+  }
+
+  void insert(const void *key, const void *value,
+              uint64_t version = 0) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    const auto &v = *static_cast<const ValueType *>(value);
+    DCHECK(map_.contains(k) == false);
+    auto &row = map_[k];
+    row.metadata.store(0);
+    *resident_value(row) = v;
+    insert_indexes(key, value);
+  }
+
+  void update(const void *key, const void *value,
+              uint64_t version = 0) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    write_row(key, *resident_value(find(key)),
+              [&v](ValueType &row) { row = v; });
+  }
+
+  void remove(const void *key) override {
+    map_.remove(*static_cast<const KeyType *>(key));
+  }
+
+  void garbage_collect(const void *key) override {}
+
+  void reserve(std::size_t n) override { map_.reserve(n); }
+
+  void for_each_row(const RowFuncType &func) override {
+    ValueType copy;
+    map_.for_each([this, &func, &copy](const KeyType &key, Row &row) {
+      ValueType *value = row.value.load();
+      if (value == nullptr) {
+        std::lock_guard<SpinLock> guard(fetch_lock_);
+        value = row.value.load();
+        if (value == nullptr) {
+          file_.read(row.slot, &copy);
+          value = &copy;
+        }
+      }
+      func(&key, row.metadata, value);
+    });
+  }
+
+  void deserialize_value(const void *key, StringPiece stringPiece,
+                         uint64_t version = 0) override {
+    write_row(key, *resident_value(find(key)),
+              [stringPiece](ValueType &row) {
+                Decoder dec(stringPiece);
+                dec >> row;
+                DCHECK(stringPiece.size() - dec.size() ==
+                       ClassOf<ValueType>::size());
+              });
+  }
+
+  void serialize_value(Encoder &enc, const void *value) override {
+
+    std::size_t size = enc.size();
+    const auto &v = *static_cast<const ValueType *>(value);
+    enc << v;
+
+    DCHECK(enc.size() - size == ClassOf<ValueType>::size());
+  }
+
+  uint64_t changed_fields(const void *key, const void *value) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    return FieldDelta<ValueType>::changed_fields(*resident_value(find(key)),
+                                                 v);
+  }
+
+  std::size_t fields_size(uint64_t mask) override {
+    return FieldDelta<ValueType>::size(mask);
+  }
+
+  void serialize_fields(Encoder &enc, const void *value,
+                        uint64_t mask) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    FieldDelta<ValueType>::serialize(enc, v, mask);
+  }
+
+  void deserialize_fields(const void *key, StringPiece stringPiece,
+                          uint64_t mask) override {
+    write_row(key, *resident_value(find(key)),
+              [stringPiece, mask](ValueType &row) {
+                FieldDelta<ValueType>::deserialize(stringPiece, row, mask);
+              });
+  }
+
+  std::size_t projection_size(uint64_t mask) override {
+    return FieldProjection<ValueType>::size(mask);
+  }
+
+  void pack_fields(char *dest, const void *value, uint64_t mask) override {
+    FieldProjection<ValueType>::pack(
+        dest, *static_cast<const ValueType *>(value), mask);
+  }
+
+  void unpack_fields(void *value, const char *src, uint64_t mask) override {
+    FieldProjection<ValueType>::unpack(*static_cast<ValueType *>(value), src,
+                                       mask);
+  }
+
+  void copy_fields(void *dest, const void *src, uint64_t mask) override {
+    FieldProjection<ValueType>::copy(*static_cast<ValueType *>(dest),
+                                     *static_cast<const ValueType *>(src),
+                                     mask);
+  }
+
+  // evicts the unlocked rows last accessed before second, returns the number
+  // of rows evicted
+  std::size_t evict(uint32_t second) override {
+    std::vector<Row *> rows;
+    std::vector<char> block;
+    block.reserve(BLOCK_SIZE * sizeof(ValueType));
+    std::size_t n = 0;
+    map_.for_each([&](const KeyType &key, Row &row) {
+      ValueType *value = row.value.load();
+      if (value == nullptr || row.access.load() >= second) {
+        return;
+      }
+      uint64_t metadata = row.metadata.load();
+      if ((metadata & LOCK_BIT) ||
+          !row.metadata.compare_exchange_strong(metadata,
+                                                metadata | LOCK_BIT)) {
+        return;
+      }
+      auto size = block.size();
+      block.resize(size + sizeof(ValueType));
+      std::memcpy(block.data() + size, value, sizeof(ValueType));
+      rows.push_back(&row);
+      if (rows.size() == BLOCK_SIZE) {
+        n += write_block(rows, block);
+      }
+    });
+    return n + write_block(rows, block);
+  }
+
+  // reads back the evicted rows looked up since the last call, returns the
+  // number of rows read
+  std::size_t fetch() override {
+    std::vector<Row *> rows;
+    {
+      std::lock_guard<SpinLock> guard(queue_lock_);
+      rows.swap(queue_);
+    }
+    std::size_t n = 0;
+    for (auto row : rows) {
+      n += fetch_row(*row);
+    }
+    return n;
+  }
+
+  bool is_resident(const void *key) override {
+    const auto &k = *static_cast<const KeyType *>(key);
+    return map_[k].value.load() != nullptr;
+  }
+
+  // the rows, the values in memory and their pool
+  std::size_t memory_size() override {
+    return map_.memory_size() + values_.mapped();
+  }
+
+  // the versions are the values in memory
+  TableMemory memory_usage() override {
+    return memory_usage_of(map_.size(), n_resident_.load());
+  }
+
+  std::size_t field_count() override { return FieldLayout<ValueType>::size(); }
+
+  std::size_t field_offset(std::size_t i) override {
+    return FieldLayout<ValueType>::offset(i);
+  }
+
+  std::size_t field_length(std::size_t i) override {
+    return FieldLayout<ValueType>::length(i);
+  }
+
+  std::vector<Column> columns() override {
+    return row_columns<KeyType, ValueType>();
+  }
+
+  std::size_t key_size() override { return sizeof(KeyType); }
+
+  std::size_t value_size() override { return sizeof(ValueType); }
+
+  std::size_t field_size() override { return ClassOf<ValueType>::size(); }
+
+  std::size_t tableID() override { return tableID_; }
+
+  std::size_t partitionID() override { return partitionID_; }
+
+private:
+  struct Row {
+    MetaDataType metadata{0};
+    // the second of the last access, see AccessClock
+    std::atomic<uint32_t> access{0};
+    // nullptr once evicted
+    std::atomic<ValueType *> value{nullptr};
+    // the slot of the value in the file once evicted
+    uint64_t slot = 0;
+    std::atomic<bool> queued{false};
+    bool evicted = false;
+  };
+
+  Row &find(const void *key) {
+    auto &row = map_[*static_cast<const KeyType *>(key)];
+    auto now = AccessClock::now().load(std::memory_order_relaxed);
+    if (row.access.load(std::memory_order_relaxed) != now) {
+      row.access.store(now, std::memory_order_relaxed);
+    }
+    return row;
+  }
+
+  // the value of row, or scratch space while it is evicted
+  ValueType *value_of(Row &row) {
+    ValueType *value = row.value.load();
+    if (value != nullptr) {
+      return value;
+    }
+    if (!is_evicted(row)) {
+      return resident_value(row);
+    }
+    if (!row.queued.exchange(true)) {
+      std::lock_guard<SpinLock> guard(queue_lock_);
+      queue_.push_back(&row);
+    }
+    return &scratch_;
+  }
+
+  // the value of row, read back first if it is evicted
+  ValueType *resident_value(Row &row) {
+    ValueType *value = row.value.load();
+    if (value != nullptr) {
+      return value;
+    }
+    std::lock_guard<SpinLock> guard(fetch_lock_);
+    value = row.value.load();
+    if (value == nullptr) {
+      value = allocate_value();
+      if (row.evicted) {
+        file_.read(row.slot, value);
+        file_.free(row.slot);
+        row.evicted = false;
+        // a new tid, the readers of the scratch space fail their validation
+        row.metadata.store((row.metadata.load() & ~LOCK_BIT) + 1);
+      }
+      row.value.store(value);
+    }
+    return value;
+  }
+
+  bool is_evicted(Row &row) {
+    std::lock_guard<SpinLock> guard(fetch_lock_);
+    return row.evicted;
+  }
+
+  std::size_t fetch_row(Row &row) {
+    bool evicted = is_evicted(row);
+    row.queued.store(false);
+    if (evicted) {
+      resident_value(row);
+    }
+    return evicted;
+  }
+
+  // the rows are locked, their values are in block
+  std::size_t write_block(std::vector<Row *> &rows, std::vector<char> &block) {
+    std::size_t n = rows.size();
+    if (n == 0) {
+      return 0;
+    }
+    uint64_t slots[BLOCK_SIZE];
+    file_.write(block.data(), n, slots);
+    std::lock_guard<SpinLock> guard(fetch_lock_);
+    for (auto i = 0u; i < n; i++) {
+      rows[i]->slot = slots[i];
+      rows[i]->evicted = true;
+      free_value(rows[i]->value.exchange(nullptr));
+    }
+    rows.clear();
+    block.clear();
+    return n;
+  }
+
+  // fetch_lock_ must be held
+  ValueType *allocate_value() {
+    n_resident_++;
+    if (!free_values_.empty()) {
+      ValueType *value = free_values_.back();
+      free_values_.pop_back();
+      return value;
+    }
+    return new (values_.allocate(sizeof(ValueType), alignof(ValueType)))
+        ValueType();
+  }
+
+  // fetch_lock_ must be held
+  void free_value(ValueType *value) {
+    n_resident_--;
+    free_values_.push_back(value);
+  }
+
+private:
+  OpenHashMap<N, KeyType, Row> map_;
+  std::size_t tableID_;
+  std::size_t partitionID_;
+  ColdFile file_;
+  // guards the evicted state, the slots and the pool of the values
+  SpinLock fetch_lock_;
+  Arena values_;
+  std::vector<ValueType *> free_values_;
+  std::atomic<std::size_t> n_resident_{0};
+  ValueType scratch_;
+  SpinLock queue_lock_;
+  std::vector<Row *> queue_;
+};
+
+/*
+ * PersistentTable is a hash table whose rows and index are in a file on a
+ * DAX file system, see PersistentMemory, so that a restart maps the table
+ * again instead of loading it. The file is a header and a fixed array of
+ * rows, each with its metadata, key and value, probed linearly from the hash
+ * of the key. The capacity is set by reserve(), or the first insert, and
+ * does not grow.
+ *
+ * A write flushes the cache lines of its row. Outside of group commit, it
+ * waits for them with a fence before the row is unlocked; with group commit,
+ * the executors fence once per group, before the group is durable, see
+ * group_commit::Executor.
+ *
+ * The loader skips a table that is_restored(), i.e., was fully loaded by a
+ * former run with the same schema. After a clean shutdown it is only mapped;
+ * after a crash, the metadata of the rows is reset in one pass, since the
+ * locks of the writes in flight at the crash are held. Keys are hashed with
+ * std::hash, which is the same in every run of a binary. parameter version is
+ * not used.
+ */
+template <class KeyType, class ValueType>
+class PersistentTable final : public ITable {
+public:
+  using MetaDataType = std::atomic<uint64_t>;
+
+  static constexpr uint64_t MAGIC = 0x636f636f706d656dull;
+  static constexpr std::size_t MIN_CAPACITY = 1024;
+
+  virtual ~PersistentTable() override {
+    if (rows_.load() != nullptr) {
+      region_.sync();
+      header()->clean = 1;
+      persist(header(), sizeof(Header));
+    }
+  }
+
+  PersistentTable(std::size_t tableID, std::size_t partitionID,
+                  const std::string &filename, bool fence_writes)
+      : tableID_(tableID), partitionID_(partitionID), region_(filename),
+        fence_writes_(fence_writes) {
+    if (region_.size() < sizeof(Header)) {
+      return;
+    }
+    Header *h = header();
+    if (h->magic != MAGIC || h->key_size != sizeof(KeyType) ||
+        h->value_size != sizeof(ValueType) || h->loaded == 0 ||
+        region_.size() != region_size(h->capacity)) {
+      return;
+    }
+    capacity_ = h->capacity;
+    rows_.store(reinterpret_cast<Row *>(h + 1));
+    restored_ = true;
+    if (h->clean == 0) {
+      for (auto i = 0u; i < capacity_; i++) {
+        rows_.load()[i].metadata.store(0);
+      }
+    }
+    h->clean = 0;
+    persist(h, sizeof(Header));
+  }
+
+  std::tuple<MetaDataType *, void *> search(const void *key,
+                                            uint64_t version = 0) override {
+    auto &row = row_of(key);
+    return std::make_tuple(&row.metadata, &row.value);
+  }
+
+  void *search_value(const void *key, uint64_t version = 0) override {
+    return &row_of(key).value;
+  }
+
+  MetaDataType &search_metadata(const void *key,
+                                uint64_t version = 0) override {
+    return row_of(key).metadata;
+  }
+
+  std::tuple<MetaDataType *, void *> search_prev(const void *key,
+                                                 uint64_t version) override {
+    return search(key);
+  }
+
+  void *search_value_prev(const void *key, uint64_t version) override {
+    return search_value(key);
+  }
+
+  MetaDataType &search_metadata_prev(const void *key,
+                                     uint64_t version) override {
+    return search_metadata(key);
+  }
+
+  void insert(const void *key, const void *value,
+              uint64_t version = 0) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    DCHECK(find(*static_cast<const KeyType *>(key)) == nullptr);
+    auto &row = row_of(key);
+    row.value = v;
+    persist_row(row);
+    insert_indexes(key, value);
+  }
+
+  void update(const void *key, const void *value,
+              uint64_t version = 0) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    auto &row = row_of(key);
+    write_row(key, row.value, [&v](ValueType &row) { row = v; });
+    persist_row(row);
+  }
+
+  void remove(const void *key) override {
+    std::lock_guard<SpinLock> guard(insert_lock_);
+    Row *row = find(*static_cast<const KeyType *>(key));
+    if (row != nullptr) {
+      row->state.store(TOMBSTONE);
+      header()->n_rows--;
+      persist(&row->state, sizeof(row->state));
+      persist(header(), sizeof(Header));
+    }
+  }
+
+  void garbage_collect(const void *key) override {}
+
+  void reserve(std::size_t n) override { map(n + n / 4); }
+
+  void for_each_row(const RowFuncType &func) override {
+    Row *rows = rows_.load();
+    for (auto i = 0u; rows != nullptr && i < capacity_; i++) {
+      if (rows[i].state.load() == FULL) {
+        func(&rows[i].key, rows[i].metadata, &rows[i].value);
+      }
+    }
+  }
+
+  void deserialize_value(const void *key, StringPiece stringPiece,
+                         uint64_t version = 0) override {
+    auto &row = row_of(key);
+    write_row(key, row.value, [stringPiece](ValueType &row) {
+      Decoder dec(stringPiece);
+      dec >> row;
+      DCHECK(stringPiece.size() - dec.size() == ClassOf<ValueType>::size());
+    });
+    persist_row(row);
+  }
+
+  void serialize_value(Encoder &enc, const void *value) override {
+
+    std::size_t size = enc.size();
+    const auto &v = *static_cast<const ValueType *>(value);
+    enc << v;
+
+    DCHECK(enc.size() - size == ClassOf<ValueType>::size());
+  }
+
+  uint64_t changed_fields(const void *key, const void *value) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    return FieldDelta<ValueType>::changed_fields(row_of(key).value, v);
+  }
+
+  std::size_t fields_size(uint64_t mask) override {
+    return FieldDelta<ValueType>::size(mask);
+  }
+
+  void serialize_fields(Encoder &enc, const void *value,
+                        uint64_t mask) override {
+    const auto &v = *static_cast<const ValueType *>(value);
+    FieldDelta<ValueType>::serialize(enc, v, mask);
+  }
+
+  void deserialize_fields(const void *key, StringPiece stringPiece,
+                          uint64_t mask) override {
+    auto &row = row_of(key);
+    write_row(key, row.value, [stringPiece, mask](ValueType &row) {
+      FieldDelta<ValueType>::deserialize(stringPiece, row, mask);
+    });
+    persist_row(row);
+  }
+
+  std::size_t projection_size(uint64_t mask) override {
+    return FieldProjection<ValueType>::size(mask);
+  }
+
+  void pack_fields(char *dest, const void *value, uint64_t mask) override {
+    FieldProjection<ValueType>::pack(
+        dest, *static_cast<const ValueType *>(value), mask);
+  }
+
+  void unpack_fields(void *value, const char *src, uint64_t mask) override {
+    FieldProjection<ValueType>::unpack(*static_cast<ValueType *>(value), src,
+                                       mask);
+  }
+
+  void copy_fields(void *dest, const void *src, uint64_t mask) override {
+    FieldProjection<ValueType>::copy(*static_cast<ValueType *>(dest),
+                                     *static_cast<const ValueType *>(src),
+                                     mask);
+  }
+
+  bool is_restored() override { return restored_; }
+
+  // a later run maps the rows instead of loading them
+  void set_loaded() override {
+    map(MIN_CAPACITY);
+    region_.sync();
+    PersistentMemory::fence();
+    header()->loaded = 1;
+    persist(header(), sizeof(Header));
+    region_.sync();
+  }
+
+  // the rows and the header, allocated ahead of the inserts
+  std::size_t memory_size() override { return region_.size(); }
+
+  TableMemory memory_usage() override {
+    std::size_t n = rows_.load() == nullptr ? 0 : header()->n_rows;
+    return memory_usage_of(n, n);
+  }
+
+  std::size_t field_count() override { return FieldLayout<ValueType>::size(); }
+
+  std::size_t field_offset(std::size_t i) override {
+    return FieldLayout<ValueType>::offset(i);
+  }
+
+  std::size_t field_length(std::size_t i) override {
+    return FieldLayout<ValueType>::length(i);
+  }
+
+  std::vector<Column> columns() override {
+    return row_columns<KeyType, ValueType>();
+  }
+
+  std::size_t key_size() override { return sizeof(KeyType); }
+
+  std::size_t value_size() override { return sizeof(ValueType); }
+
+  std::size_t field_size() override { return ClassOf<ValueType>::size(); }
+
+  std::size_t tableID() override { return tableID_; }
+
+  std::size_t partitionID() override { return partitionID_; }
+
+private:
+  enum : uint32_t { EMPTY, FULL, TOMBSTONE };
+
+  struct alignas(64) Header {
+    uint64_t magic;
+    uint64_t key_size;
+    uint64_t value_size;
+    uint64_t capacity;
+    // the rows in use and the slots taken, including removed rows
+    uint64_t n_rows;
+    uint64_t n_slots;
+    // whether the loader is done, and whether the last run closed the file
+    uint64_t loaded;
+    uint64_t clean;
+  };
+
+  // zeros in a new file, i.e., an empty row
+  struct Row {
+    MetaDataType metadata;
+    std::atomic<uint32_t> state;
+    KeyType key;
+    ValueType value;
+  };
+
+  static std::size_t region_size(std::size_t capacity) {
+    return sizeof(Header) + capacity * sizeof(Row);
+  }
+
+  Header *header() { return reinterpret_cast<Header *>(region_.data()); }
+
+  // maps a new file with room for n rows, unless it is mapped
+  void map(std::size_t n) {
+    std::lock_guard<SpinLock> guard(insert_lock_);
+    if (rows_.load() != nullptr) {
+      return;
+    }
+    capacity_ = MIN_CAPACITY;
+    while (capacity_ < n) {
+      capacity_ *= 2;
+    }
+    region_.reset(region_size(capacity_));
+    Header *h = header();
+    h->magic = MAGIC;
+    h->key_size = sizeof(KeyType);
+    h->value_size = sizeof(ValueType);
+    h->capacity = capacity_;
+    persist(h, sizeof(Header));
+    rows_.store(reinterpret_cast<Row *>(h + 1));
+  }
+
+  // lookups do not take the lock, a row is published once its key is set
+  Row *find(const KeyType &key) {
+    Row *rows = rows_.load();
+    if (rows == nullptr) {
+      return nullptr;
+    }
+    std::size_t mask = capacity_ - 1;
+    for (auto i = hasher_(key) & mask, n = 0ul; n < capacity_;
+         i = (i + 1) & mask, n++) {
+      auto state = rows[i].state.load(std::memory_order_acquire);
+      if (state == EMPTY) {
+        return nullptr;
+      }
+      if (state == FULL && rows[i].key == key) {
+        return &rows[i];
+      }
+    }
+    return nullptr;
+  }
+
+  // the row of key, inserted if it is not there
+  Row &row_of(const void *key) {
+    const auto &k = *static_cast<const KeyType *>(key);
+    Row *row = find(k);
+    if (row != nullptr) {
+      return *row;
+    }
+    map(MIN_CAPACITY);
+    std::lock_guard<SpinLock> guard(insert_lock_);
+    row = find(k);
+    if (row != nullptr) {
+      return *row;
+    }
+    Header *h = header();
+    CHECK(h->n_slots < capacity_ - capacity_ / 8)
+        << "persistent table " << tableID_ << " of partition "
+        << partitionID_ << " is full, it has the rows reserve() was given.";
+    std::size_t mask = capacity_ - 1;
+    auto i = hasher_(k) & mask;
+    Row *rows = rows_.load();
+    while (rows[i].state.load() != EMPTY) {
+      i = (i + 1) & mask;
+    }
+    rows[i].metadata.store(0);
+    rows[i].key = k;
+    rows[i].value = ValueType();
+    persist(&rows[i], sizeof(Row));
+    rows[i].state.store(FULL, std::memory_order_release);
+    h->n_rows++;
+    h->n_slots++;
+    persist(&rows[i].state, sizeof(rows[i].state));
+    persist(h, sizeof(Header));
+    return rows[i];
+  }
+
+  void persist(const void *p, std::size_t n) {
+    if (region_.dax()) {
+      PersistentMemory::flush(p, n);
+      PersistentMemory::fence();
+    }
+  }
+
+  // the fence of a write comes with the group, see above
+  void persist_row(Row &row) {
+    if (region_.dax()) {
+      PersistentMemory::flush(&row, sizeof(Row));
+      if (fence_writes_) {
+        PersistentMemory::fence();
+      }
+    }
+  }
+
+private:
+  std::size_t tableID_;
+  std::size_t partitionID_;
+  PersistentMemory region_;
+  bool fence_writes_;
+  bool restored_ = false;
+  std::atomic<Row *> rows_{nullptr};
+  std::size_t capacity_ = 0;
+  // serializes the inserts, the removes and the mapping of the file
+  SpinLock insert_lock_;
+  std::hash<KeyType> hasher_;
+};
+
+class TableFactory {
+public:
+  template <std::size_t N, class KeyType, class ValueType>
+  static std::unique_ptr<ITable> create_table(const Context &context,
+                                              std::size_t tableID,
+                                              std::size_t partitionID) {
+    if (context.is_evictable(tableID)) {
+      return std::make_unique<EvictableTable<N, KeyType, ValueType>>(
+          tableID, partitionID, context.cold_file(tableID, partitionID));
+    }
+    if (!context.pmem_path.empty()) {
+      return std::make_unique<PersistentTable<KeyType, ValueType>>(
+          tableID, partitionID, context.pmem_file(tableID, partitionID),
+          !context.group_commit());
+    }
+    if (context.mvcc) {
+      return std::make_unique<MVCCTable<N, KeyType, ValueType>>(tableID,
+                                                                partitionID);
+    } else {
+      return std::make_unique<Table<N, KeyType, ValueType>>(tableID,
+                                                            partitionID);
+    }
+  }
+
+  // mvcc, evictable and persistent tables are hash tables only, they do not
+  // support scans. Ordered tables are loaded again in every run.
+  template <std::size_t N, class KeyType, class ValueType>
+  static std::unique_ptr<ITable> create_ordered_table(const Context &context,
+                                                      std::size_t tableID,
+                                                      std::size_t partitionID) {
+    CHECK(!context.is_evictable(tableID))
+        << "table " << tableID << " is ordered, only hash tables evict rows.";
+    if (context.mvcc) {
+      return std::make_unique<MVCCTable<N, KeyType, ValueType>>(tableID,
+                                                                partitionID);
+    } else {
+      return std::make_unique<OrderedTable<KeyType, ValueType>>(tableID,
+                                                                partitionID);
     }
   }
 };
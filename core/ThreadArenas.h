@@ -0,0 +1,70 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include <glog/logging.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+#ifdef COCO_HAS_JEMALLOC
+#include <jemalloc/jemalloc.h>
+#endif
+
+namespace coco {
+
+/*
+ * With --thread_arenas, each worker and i/o thread allocates from a jemalloc
+ * arena of its own, see bind, instead of the arenas jemalloc shares among
+ * threads, so that the messages, transactions and rows a thread allocates do
+ * not contend with the other threads on the arena locks. A message that
+ * another thread frees goes back to the arena of the thread that allocated
+ * it, through the thread cache of the one that frees it.
+ *
+ * MemoryReport logs the allocated, active and retained bytes of each arena,
+ * by the thread it is bound to.
+ */
+
+class ThreadArenas {
+public:
+#ifdef COCO_HAS_JEMALLOC
+  static constexpr bool available = true;
+
+  // creates an arena, binds the calling thread to it and returns it
+  static unsigned bind(const std::string &name) {
+    unsigned arena = 0;
+    std::size_t size = sizeof(arena);
+    CHECK(mallctl("arenas.create", &arena, &size, nullptr, 0) == 0);
+    CHECK(mallctl("thread.arena", nullptr, nullptr, &arena, sizeof(arena)) ==
+          0);
+    std::lock_guard<std::mutex> guard(mutex());
+    names()[arena] = name;
+    return arena;
+  }
+#else
+  static constexpr bool available = false;
+
+  static unsigned bind(const std::string &) { return 0; }
+#endif
+
+  // the thread an arena is bound to, empty for a shared arena
+  static std::string name(unsigned arena) {
+    std::lock_guard<std::mutex> guard(mutex());
+    auto it = names().find(arena);
+    return it == names().end() ? std::string() : it->second;
+  }
+
+private:
+  static std::mutex &mutex() {
+    static std::mutex m;
+    return m;
+  }
+
+  static std::map<unsigned, std::string> &names() {
+    static std::map<unsigned, std::string> m;
+    return m;
+  }
+};
+} // namespace coco
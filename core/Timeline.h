@@ -0,0 +1,182 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Defs.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <glog/logging.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --timeline_path, the managers and the executors record spans, e.g.,
+ * the epoch phases and the barriers they wait for, into a ring buffer per
+ * thread, which keeps the last CAPACITY spans. Once the coordinator exits,
+ * it writes the spans of its threads to <timeline_path>/<coordinator id>.json
+ * in the Chrome trace format, see chrome://tracing or ui.perfetto.dev. The
+ * coordinator id is the pid of a span, and the spans are timed with the
+ * system clock, so that the timelines of different nodes can be lined up.
+ */
+
+class Timeline {
+public:
+  static constexpr std::size_t CAPACITY = 1 << 16;
+
+  struct Span {
+    const char *name;
+    uint64_t begin, end; // microseconds since the epoch
+  };
+
+  static void enable() { enabled_flag().store(true); }
+
+  static bool enabled() {
+    return enabled_flag().load(std::memory_order_relaxed);
+  }
+
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // names the calling thread in the timeline of a coordinator
+  static void set_thread_name(std::size_t coordinator_id,
+                              const std::string &name) {
+    if (!enabled()) {
+      return;
+    }
+    auto &ring = thread_ring();
+    ring.coordinator_id = coordinator_id;
+    ring.name = name;
+  }
+
+  // name must outlive the timeline, e.g., a string literal
+  static void record(const char *name, uint64_t begin, uint64_t end) {
+    auto &ring = thread_ring();
+    ring.spans[ring.n++ % CAPACITY] = Span{name, begin, end};
+  }
+
+  // called once the threads of the coordinator are joined
+  static void dump(const std::string &filename, std::size_t coordinator_id) {
+    std::ofstream out(filename);
+    CHECK(out) << "failed to open " << filename;
+    out << "{\"traceEvents\":[";
+    const char *sep = "\n";
+    std::lock_guard<std::mutex> guard(registry_mutex());
+    auto &rings = registry();
+    for (auto tid = 0u; tid < rings.size(); tid++) {
+      auto &ring = *rings[tid];
+      if (ring.coordinator_id != coordinator_id) {
+        continue;
+      }
+      out << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":"
+          << coordinator_id << ",\"tid\":" << tid
+          << ",\"args\":{\"name\":\"" << ring.name << "\"}}";
+      sep = ",\n";
+      auto first = ring.n > CAPACITY ? ring.n - CAPACITY : 0;
+      for (auto i = first; i < ring.n; i++) {
+        auto &span = ring.spans[i % CAPACITY];
+        out << sep << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":"
+            << coordinator_id << ",\"tid\":" << tid << ",\"ts\":" << span.begin
+            << ",\"dur\":" << span.end - span.begin << "}";
+      }
+    }
+    out << "\n]}\n";
+  }
+
+private:
+  struct Ring {
+    std::size_t coordinator_id = 0;
+    std::string name;
+    std::vector<Span> spans = std::vector<Span>(CAPACITY);
+    std::size_t n = 0;
+  };
+
+  static std::atomic<bool> &enabled_flag() {
+    static std::atomic<bool> flag{false};
+    return flag;
+  }
+
+  // the rings are kept till the process exits, so that a thread can exit
+  // before its coordinator dumps
+  static Ring &thread_ring() {
+    thread_local Ring *ring = nullptr;
+    if (ring == nullptr) {
+      std::lock_guard<std::mutex> guard(registry_mutex());
+      registry().emplace_back(std::make_unique<Ring>());
+      ring = registry().back().get();
+    }
+    return *ring;
+  }
+
+  static std::mutex &registry_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::vector<std::unique_ptr<Ring>> &registry() {
+    static std::vector<std::unique_ptr<Ring>> rings;
+    return rings;
+  }
+};
+
+// records a span from its construction to end() or its destruction
+class TimelineSpan {
+public:
+  explicit TimelineSpan(const char *name)
+      : name(name), begin(Timeline::enabled() ? Timeline::now() : 0) {}
+
+  TimelineSpan(const TimelineSpan &) = delete;
+  TimelineSpan &operator=(const TimelineSpan &) = delete;
+
+  ~TimelineSpan() { end(); }
+
+  void end() {
+    if (begin != 0) {
+      Timeline::record(name, begin, Timeline::now());
+      begin = 0;
+    }
+  }
+
+private:
+  const char *name;
+  uint64_t begin;
+};
+
+inline const char *executor_status_name(ExecutorStatus status) {
+  static const char *names[] = {"START",
+                                "CLEANUP",
+                                "C_PHASE",
+                                "S_PHASE",
+                                "Analysis",
+                                "Execute",
+                                "Aria_READ",
+                                "Aria_COMMIT",
+                                "AriaFB_READ",
+                                "AriaFB_COMMIT",
+                                "AriaFB_Fallback_Prepare",
+                                "AriaFB_Fallback",
+                                "Bohm_Analysis",
+                                "Bohm_Insert",
+                                "Bohm_Execute",
+                                "Bohm_GC",
+                                "Pwv_Analysis",
+                                "Pwv_Execute",
+                                "STOP",
+                                "EXIT"};
+  static_assert(sizeof(names) / sizeof(names[0]) ==
+                    static_cast<std::size_t>(ExecutorStatus::EXIT) + 1,
+                "a name per status");
+  return names[static_cast<std::size_t>(status)];
+}
+} // namespace coco
@@ -0,0 +1,88 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/SpinLock.h"
+#include <cstdint>
+#include <vector>
+
+namespace coco {
+
+/*
+ * A tombstone is a row whose metadata has the absent bit of its protocol set,
+ * i.e., the key is not inserted yet or its row is deleted. The absent bit is
+ * a bit of the metadata the protocol does not use otherwise, so a tombstone
+ * is locked, validated and replicated as any other row: an insert writes a
+ * tombstone and clears the bit once it commits, and a delete sets the bit
+ * instead of writing the row.
+ *
+ * Once a protocol sets the tombstone of a table, see ITable::set_tombstone,
+ * the table creates the row of a missing key as a tombstone, so that a key
+ * that is never inserted reads as absent. A deleted row is retired by the
+ * transaction that deletes it, and the table removes it from its index a
+ * reclaim epoch later, see ITable::reclaim. The row is marked removed first,
+ * i.e., it is locked for good, so that a transaction that still holds it
+ * fails to lock or to validate it, and looks up the new row of the key once
+ * it is retried.
+ */
+
+struct Tombstone {
+  // 0 if the table has no tombstones
+  uint64_t absent_bit = 0;
+  // the bits that are set while the row is locked
+  uint64_t lock_mask = 0;
+  // the bit that marks a removed row
+  uint64_t lock_bit = 0;
+
+  bool enabled() const { return absent_bit != 0; }
+
+  bool is_absent(uint64_t metadata) const {
+    return (metadata & absent_bit) != 0;
+  }
+
+  // the row can be removed, i.e., it is absent and not locked
+  bool is_removable(uint64_t metadata) const {
+    return is_absent(metadata) && (metadata & lock_mask) == 0;
+  }
+
+  uint64_t removed(uint64_t metadata) const { return metadata | lock_bit; }
+
+  // sets the tombstone of every table of db
+  template <class Database>
+  static void set(Database &db, std::size_t partition_num,
+                  const Tombstone &tombstone) {
+    for (auto i = 0u; i < partition_num; i++) {
+      for (auto table : db.partition_tables(i)) {
+        table->set_tombstone(tombstone);
+      }
+    }
+  }
+};
+
+// the keys of the rows retired by deletes, see ITable::retire. Each call to
+// ITable::reclaim is a reclaim epoch.
+template <class KeyType> class RetiredKeys {
+public:
+  void add(const KeyType &key) {
+    lock.lock();
+    keys.push_back(key);
+    lock.unlock();
+  }
+
+  // the keys retired before the last call
+  std::vector<KeyType> take() {
+    std::vector<KeyType> oldest;
+    lock.lock();
+    oldest.swap(previous);
+    previous.swap(keys);
+    lock.unlock();
+    return oldest;
+  }
+
+private:
+  SpinLock lock;
+  std::vector<KeyType> keys, previous;
+};
+} // namespace coco
@@ -0,0 +1,55 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <memory>
+#include <typeinfo>
+#include <vector>
+
+namespace coco {
+
+/*
+ * TransactionPool keeps the transactions an executor is done with, at most
+ * one per type, so that the next transaction of the same type is renewed in
+ * place instead of allocated: its protocol state is reset, its query is drawn
+ * again, and its read and write sets keep their capacity. A pool belongs to
+ * the loop that runs the transactions, since a transaction refers to the
+ * context and the storage it was made with, see Workload::next_transaction.
+ */
+
+template <class TransactionType> class TransactionPool {
+public:
+  // a transaction of type T from the pool, or nullptr
+  template <class T> std::unique_ptr<TransactionType> take() {
+    for (auto i = 0u; i < free.size(); i++) {
+      if (free[i] != nullptr && typeid(*free[i]) == typeid(T)) {
+        n_reuses++;
+        return std::move(free[i]);
+      }
+    }
+    return nullptr;
+  }
+
+  void put(std::unique_ptr<TransactionType> txn) {
+    if (txn == nullptr) {
+      return;
+    }
+    for (auto &p : free) {
+      if (p == nullptr || typeid(*p) == typeid(*txn)) {
+        p = std::move(txn);
+        return;
+      }
+    }
+    free.push_back(std::move(txn));
+  }
+
+  std::size_t reuses() const { return n_reuses; }
+
+private:
+  // a slot per type, empty while its transaction is out
+  std::vector<std::unique_ptr<TransactionType>> free;
+  std::size_t n_reuses = 0;
+};
+} // namespace coco
@@ -0,0 +1,170 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/BufferedFileWriter.h"
+#include "common/Encoder.h"
+#include "common/Random.h"
+#include "common/StringPiece.h"
+#include "core/Context.h"
+
+#include <cstdint>
+#include <fstream>
+#include <glog/logging.h>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ *  Transaction stream -- format --
+ *
+ *  With --record_path, each executor appends an entry per transaction it
+ *  generates to <record_path>/<coordinator id>_<worker id>.stream. With
+ *  --replay_path, it reads its file back and generates the same
+ *  transactions in the same order, whatever the protocol or the build, since
+ *  a query is drawn from the random seed and the partition of its entry, see
+ *  Workload::next_transaction. A replay that runs longer than the recording
+ *  starts over from the first entry.
+ *
+ *  The workload flags, --partition_num and --threads must be the same as in
+ *  the recording, and only the partition number is checked.
+ *
+ *  header: [ magic (32) | partition num (32) ]
+ *  entry:  [ seed (64) | partition id (32) | hot row (32) ]
+ */
+
+struct TransactionStreamEntry {
+  uint64_t seed;
+  uint32_t partition_id;
+  uint32_t hot_row;
+};
+
+class TransactionStream {
+public:
+  static constexpr uint32_t MAGIC = 0x5354524d; // STRM
+  static constexpr std::size_t HEADER_SIZE = sizeof(uint32_t) * 2;
+  static constexpr std::size_t ENTRY_SIZE =
+      sizeof(uint64_t) + sizeof(uint32_t) * 2;
+
+  // records to file_name
+  TransactionStream(const std::string &file_name, std::size_t partition_num)
+      : writer(std::make_unique<BufferedFileWriter>(file_name.c_str())) {
+    Encoder enc(bytes);
+    enc << static_cast<uint32_t>(MAGIC)
+        << static_cast<uint32_t>(partition_num);
+    writer->write(bytes.data(), bytes.size());
+  }
+
+  // replays entries
+  explicit TransactionStream(std::vector<TransactionStreamEntry> entries)
+      : entries(std::move(entries)) {
+    CHECK(!this->entries.empty()) << "the transaction stream is empty.";
+  }
+
+  // nullptr unless --record_path or --replay_path is set
+  static std::unique_ptr<TransactionStream>
+  open(const Context &context, std::size_t coordinator_id,
+       std::size_t worker_id) {
+    if (!context.record_path.empty()) {
+      return std::make_unique<TransactionStream>(
+          file_name(context.record_path, coordinator_id, worker_id),
+          context.partition_num);
+    }
+    if (!context.replay_path.empty()) {
+      auto name = file_name(context.replay_path, coordinator_id, worker_id);
+      std::vector<TransactionStreamEntry> entries;
+      uint32_t partition_num = 0;
+      CHECK(read(name, partition_num, entries))
+          << "failed to read the transaction stream " << name;
+      CHECK(partition_num == context.partition_num)
+          << name << " is recorded with " << partition_num << " partitions.";
+      return std::make_unique<TransactionStream>(std::move(entries));
+    }
+    return nullptr;
+  }
+
+  static std::string file_name(const std::string &path,
+                               std::size_t coordinator_id,
+                               std::size_t worker_id) {
+    return path + "/" + std::to_string(coordinator_id) + "_" +
+           std::to_string(worker_id) + ".stream";
+  }
+
+  // called before a transaction is generated on partition_id. Records the
+  // seed of random, or replaces it, partition_id and hot_row with the next
+  // entry.
+  void next(Random &random, std::size_t &partition_id, std::size_t &hot_row) {
+    if (writer != nullptr) {
+      bytes.clear();
+      encode(bytes, {random.get_seed(), static_cast<uint32_t>(partition_id),
+                     static_cast<uint32_t>(hot_row)});
+      writer->write(bytes.data(), bytes.size());
+      return;
+    }
+
+    if (pos == entries.size()) {
+      LOG_IF(INFO, !replayed) << "the transaction stream starts over after "
+                              << entries.size() << " transactions.";
+      replayed = true;
+      pos = 0;
+    }
+    auto &entry = entries[pos++];
+    random.set_seed(entry.seed);
+    partition_id = entry.partition_id;
+    hot_row = entry.hot_row;
+  }
+
+  void close() {
+    if (writer != nullptr) {
+      writer->close();
+    }
+  }
+
+  static void encode(std::string &bytes, const TransactionStreamEntry &entry) {
+    Encoder enc(bytes);
+    enc << entry.seed << entry.partition_id << entry.hot_row;
+  }
+
+  // returns false if the file cannot be read or is not a stream
+  static bool read(const std::string &filename, uint32_t &partition_num,
+                   std::vector<TransactionStreamEntry> &entries) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    if (bytes.size() < HEADER_SIZE) {
+      return false;
+    }
+    StringPiece piece(bytes);
+    uint32_t magic;
+    Decoder header(piece);
+    header >> magic >> partition_num;
+    if (magic != MAGIC) {
+      return false;
+    }
+    piece.remove_prefix(HEADER_SIZE);
+    while (piece.size() >= ENTRY_SIZE) {
+      TransactionStreamEntry entry;
+      Decoder dec(piece);
+      dec >> entry.seed >> entry.partition_id >> entry.hot_row;
+      entries.push_back(entry);
+      piece.remove_prefix(ENTRY_SIZE);
+    }
+    return true;
+  }
+
+private:
+  std::unique_ptr<BufferedFileWriter> writer;
+  std::string bytes;
+  std::vector<TransactionStreamEntry> entries;
+  std::size_t pos = 0;
+  bool replayed = false;
+};
+} // namespace coco
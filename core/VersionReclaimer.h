@@ -0,0 +1,122 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <glog/logging.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+/*
+ * VersionReclaimer frees superseded versions of mvcc tables in the background
+ * with epoch-based reclamation.
+ *
+ * New versions are created at the current epoch, which only moves forward
+ * with advance(). A worker publishes the epoch of its snapshot with enter()
+ * before reading old versions and clears it with exit(). The watermark is the
+ * oldest published snapshot, or the current epoch if no worker is reading, so
+ * every version retired by a newer version below the watermark is never read
+ * again. Each reclaim interval, the reclaimer removes them from all tables in
+ * bulk. Writers only append the retired version to a per-bucket queue.
+ *
+ * The tables of the other protocols use the reclaim intervals as epochs to
+ * remove the rows deleted by transactions, see Tombstone.
+ */
+
+class VersionReclaimer {
+public:
+  static constexpr uint64_t IDLE = UINT64_MAX;
+  static constexpr int64_t RECLAIM_INTERVAL_MS = 100;
+
+  VersionReclaimer(std::size_t coordinator_id, std::vector<ITable *> tables,
+                   std::size_t worker_num, std::atomic<bool> &stopFlag)
+      : coordinator_id(coordinator_id), tables(std::move(tables)),
+        worker_num(worker_num), slots(new Slot[worker_num]),
+        stopFlag(stopFlag) {
+    current_epoch.store(0);
+  }
+
+  // returns the epoch of the snapshot worker_id reads until exit()
+  uint64_t enter(std::size_t worker_id) {
+    DCHECK(worker_id < worker_num);
+    for (;;) {
+      uint64_t epoch = current_epoch.load();
+      slots[worker_id].epoch.store(epoch);
+      // the reclaimer may have read the watermark before the store
+      if (current_epoch.load() == epoch) {
+        return epoch;
+      }
+    }
+  }
+
+  void exit(std::size_t worker_id) {
+    DCHECK(worker_id < worker_num);
+    slots[worker_id].epoch.store(IDLE);
+  }
+
+  // versions from now on are created at epoch or later
+  void advance(uint64_t epoch) {
+    uint64_t current = current_epoch.load();
+    while (current < epoch &&
+           !current_epoch.compare_exchange_weak(current, epoch)) {
+    }
+  }
+
+  uint64_t watermark() const {
+    uint64_t watermark = current_epoch.load();
+    for (auto i = 0u; i < worker_num; i++) {
+      watermark = std::min(watermark, slots[i].epoch.load());
+    }
+    return watermark;
+  }
+
+  // returns the number of versions removed
+  std::size_t reclaim() {
+    uint64_t w = watermark();
+    std::size_t n = 0;
+    for (auto table : tables) {
+      n += table->reclaim(w);
+    }
+    n_reclaimed += n;
+    return n;
+  }
+
+  void start() {
+    LOG(INFO) << "VersionReclaimer on coordinator " << coordinator_id
+              << " starts, " << tables.size() << " tables.";
+
+    while (!stopFlag.load()) {
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(RECLAIM_INTERVAL_MS));
+      reclaim();
+    }
+
+    LOG(INFO) << "VersionReclaimer on coordinator " << coordinator_id
+              << " reclaimed " << n_reclaimed << " versions, exits.";
+  }
+
+private:
+  // one cache line per worker
+  struct Slot {
+    std::atomic<uint64_t> epoch{IDLE};
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  std::size_t coordinator_id;
+  std::vector<ITable *> tables;
+  std::size_t worker_num;
+  std::unique_ptr<Slot[]> slots;
+  std::atomic<uint64_t> current_epoch;
+  std::atomic<bool> &stopFlag;
+  std::size_t n_reclaimed = 0;
+};
+} // namespace coco
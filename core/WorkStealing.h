@@ -0,0 +1,74 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace coco {
+
+/*
+ * With --work_stealing, the transactions [0, n) of a batch are still spread
+ * over the workers as i = id, id + worker_num, ..., but a worker that has
+ * run its own steals the next ones of the others before it reports the
+ * phase complete, so a skewed batch or a few long transactions do not leave
+ * the other workers idle at the barrier.
+ *
+ * The queue of a worker is a single word, (# of its transactions << 32 |
+ * the next one), in a cache line of its own. The owner and the thieves claim
+ * the next transaction with a fetch_add, and the owner resets its queue for
+ * a phase with a store. Until then the queue is empty from the last phase,
+ * the phases are separated by barriers, so no transaction runs twice.
+ */
+
+class WorkStealing {
+public:
+  static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+  explicit WorkStealing(std::size_t worker_num)
+      : worker_num(worker_num), slots(new Slot[worker_num]) {}
+
+  // worker_id starts a phase over the transactions [0, n)
+  void reset(std::size_t worker_id, std::size_t n) {
+    uint64_t count =
+        n > worker_id ? (n - worker_id + worker_num - 1) / worker_num : 0;
+    slots[worker_id].queue.store(count << 32);
+  }
+
+  // the next transaction of worker_id or one it steals, NONE once they are
+  // all claimed
+  std::size_t next(std::size_t worker_id) {
+    for (auto k = 0u; k < worker_num; k++) {
+      auto victim = (worker_id + k) % worker_num;
+      auto &queue = slots[victim].queue;
+      if (is_empty(queue.load(std::memory_order_relaxed))) {
+        continue;
+      }
+      auto value = queue.fetch_add(1);
+      if (!is_empty(value)) {
+        return victim + (value & NEXT_MASK) * worker_num;
+      }
+    }
+    return NONE;
+  }
+
+private:
+  static constexpr uint64_t NEXT_MASK = 0xffffffff;
+
+  static bool is_empty(uint64_t value) {
+    return (value & NEXT_MASK) >= (value >> 32);
+  }
+
+  // one cache line per worker
+  struct Slot {
+    std::atomic<uint64_t> queue{0};
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  std::size_t worker_num;
+  std::unique_ptr<Slot[]> slots;
+};
+} // namespace coco
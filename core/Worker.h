@@ -4,10 +4,23 @@
 
 #pragma once
 
+#include "common/Histogram.h"
 #include "common/LockfreeQueue.h"
 #include "common/Message.h"
+#include "common/MessagePool.h"
+#include "common/SpinLock.h"
+#include "common/Time.h"
+#include "core/ConflictProfile.h"
+#include "core/DirectConnections.h"
+#include "core/MessageStatistics.h"
+#include "core/Statistics.h"
+#include "core/WorkerStats.h"
+#include <algorithm>
 #include <atomic>
 #include <glog/logging.h>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
 
 namespace coco {
@@ -16,13 +29,8 @@ class Worker {
 public:
   Worker(std::size_t coordinator_id, std::size_t id)
       : coordinator_id(coordinator_id), id(id) {
-    n_commit.store(0);
-    n_abort_no_retry.store(0);
-    n_abort_lock.store(0);
-    n_abort_read_validation.store(0);
-    n_local.store(0);
-    n_si_in_serializable.store(0);
-    n_network_size.store(0);
+    queue_occupancy.store(0);
+    n_durable_epochs.store(0);
   }
 
   virtual ~Worker() = default;
@@ -35,11 +43,142 @@ public:
 
   virtual Message *pop_message() = 0;
 
+  /*
+   * Messages off the commit path, e.g., asynchronous replication. The
+   * outgoing dispatcher drains pop_message() of all workers before it sends
+   * them, so a large flush does not hold up lock and validation responses.
+   */
+  virtual Message *pop_async_message() { return nullptr; }
+
+  // called by the worker once a transaction of procedure_id commits, in
+  // microseconds
+  void record_latency(int64_t latency, uint32_t procedure_id) {
+    std::lock_guard<SpinLock> guard(latency_lock);
+    window_latency.add(latency);
+    window_procedures[procedure_id].latency.add(latency);
+  }
+
+  // called by the worker once a transaction of procedure_id aborts, reason is
+  // its counter, e.g., &ProcedureStatistics::n_abort_lock
+  void record_abort(uint32_t procedure_id,
+                    uint64_t ProcedureStatistics::*reason) {
+    std::lock_guard<SpinLock> guard(latency_lock);
+    window_procedures[procedure_id].*reason += 1;
+  }
+
+  // called by the worker once a transaction commits or aborts
+  void record_phases(const PhaseTimer &timer) {
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      if (timer.times[i] != 0) {
+        stats.add(WorkerStats::PHASE_TIME + i, timer.times[i]);
+      }
+      for (auto k = 0u; k < N_PERF_EVENTS; k++) {
+        if (timer.events[i][k] != 0) {
+          stats.add(WorkerStats::phase_events(i, k), timer.events[i][k]);
+        }
+      }
+    }
+  }
+
+  /*
+   * Pushes n messages into an outgoing queue. The worker waits while the
+   * queue is full, i.e., the outgoing dispatcher falls behind, and the time
+   * it waits and how full the queue gets are exported in the statistics.
+   * With direct connections, the messages are sent right away instead.
+   */
+  void push_outgoing(LockfreeQueue<Message *> &queue, Message *const *messages,
+                     std::size_t n) {
+    if (direct != nullptr) {
+      for (auto i = 0u; i < n; i++) {
+        direct->send(messages[i], [this](uint64_t worker_id) {
+          return alloc_direct_message(worker_id);
+        });
+        outgoing_message_pool.put(messages[i]);
+      }
+      return;
+    }
+
+    auto waited = queue.push_n(messages, n);
+    if (waited > 0) {
+      stats.add(WorkerStats::QUEUE_STALL);
+      stats.add(WorkerStats::QUEUE_STALL_TIME, waited);
+    }
+    uint64_t occupancy = queue.occupancy();
+    if (occupancy > queue_occupancy.load(std::memory_order_relaxed)) {
+      queue_occupancy.store(occupancy, std::memory_order_relaxed);
+    }
+  }
+
+  void push_outgoing(LockfreeQueue<Message *> &queue, Message *message) {
+    push_outgoing(queue, &message, 1);
+  }
+
+  // with direct connections, pushes the messages from the peers into the
+  // incoming queue of the worker, called by the worker before it handles them
+  std::size_t receive_direct() {
+    if (direct == nullptr) {
+      return 0;
+    }
+    return direct->receive(
+        [this](uint64_t worker_id) { return alloc_direct_message(worker_id); },
+        [this](Message *message) {
+          message->time = Clock::now();
+          push_message(message);
+        });
+  }
+
+  // called by the coordinator, moves the statistics recorded so far into s
+  void collect_statistics(Statistics &s) {
+    stats.collect(s);
+    s.queue_occupancy =
+        std::max(s.queue_occupancy, queue_occupancy.exchange(0));
+
+    std::lock_guard<SpinLock> guard(latency_lock);
+    s.latency.merge(window_latency);
+    window_latency.clear();
+    for (auto &p : window_procedures) {
+      s.procedures[p.first].merge(p.second);
+    }
+    window_procedures.clear();
+  }
+
 public:
   std::size_t coordinator_id;
   std::size_t id;
-  std::atomic<uint64_t> n_commit, n_abort_no_retry, n_abort_lock,
-      n_abort_read_validation, n_local, n_si_in_serializable, n_network_size;
+  // the counters of the statistics, written by this worker only
+  WorkerStats stats;
+
+  // the most messages seen in an outgoing queue, see Statistics
+  std::atomic<uint64_t> queue_occupancy;
+
+  // # of epochs this worker has made durable in the redo log
+  std::atomic<uint64_t> n_durable_epochs;
+
+  // the rows that abort transactions, see ConflictProfile
+  ConflictProfile conflicts;
+
+  // set by the executor with --message_latency
+  std::unique_ptr<MessageStatistics> message_statistics;
+
+  // set by the coordinator with --direct_connections
+  std::unique_ptr<DirectConnections> direct;
+
+  // allocated by the worker, returned by the outgoing dispatcher once sent
+  MessagePool outgoing_message_pool;
+  // allocated by the incoming dispatcher, returned by the worker once handled
+  MessagePool incoming_message_pool;
+
+private:
+  // a direct connection only carries the messages of this worker's id
+  Message *alloc_direct_message(uint64_t worker_id) {
+    DCHECK(worker_id == id);
+    return incoming_message_pool.get();
+  }
+
+private:
+  SpinLock latency_lock;
+  Histogram window_latency;
+  std::map<uint32_t, ProcedureStatistics> window_procedures;
 };
 
 } // namespace coco
@@ -0,0 +1,109 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Statistics.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <glog/logging.h>
+
+namespace coco {
+
+/*
+ * WorkerStats holds the counters of a worker. A counter is only written by
+ * its worker, so an increment is a plain load and store instead of a locked
+ * read-modify-write, and a counter is never reset: the coordinator takes a
+ * snapshot every second and adds the increments since its previous one, see
+ * collect(). The counters sit on cache lines of their own, apart from the
+ * snapshot and the other fields of the worker.
+ *
+ * A new metric is a slot, a field of Statistics and a line in collect().
+ */
+
+class WorkerStats {
+public:
+  enum Slot : std::size_t {
+    COMMIT,
+    ABORT_NO_RETRY,
+    ABORT_LOCK,
+    ABORT_READ_VALIDATION,
+    LOCAL,
+    SI_IN_SERIALIZABLE,
+    NETWORK_SIZE,
+    QUEUE_STALL,
+    QUEUE_STALL_TIME,
+    DEFERRED_FLUSH,
+    // nanoseconds spent in each phase, see PhaseTimer
+    PHASE_TIME,
+    // hardware events in each phase, see PerfCounters
+    PHASE_EVENTS = PHASE_TIME + N_TRANSACTION_PHASES,
+    N_SLOTS = PHASE_EVENTS + N_TRANSACTION_PHASES * N_PERF_EVENTS
+  };
+
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  WorkerStats() {
+    for (auto &counter : counters) {
+      counter.store(0, std::memory_order_relaxed);
+    }
+    std::memset(last, 0, sizeof(last));
+  }
+
+  // called by the worker only
+  void add(std::size_t slot, uint64_t n = 1) {
+    DCHECK(slot < N_SLOTS);
+    auto &counter = counters[slot];
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  static std::size_t phase_events(std::size_t phase, std::size_t event) {
+    return PHASE_EVENTS + phase * N_PERF_EVENTS + event;
+  }
+
+  // the value of slot so far
+  uint64_t get(std::size_t slot) const {
+    DCHECK(slot < N_SLOTS);
+    return counters[slot].load(std::memory_order_relaxed);
+  }
+
+  // called by the coordinator only, adds the increments since the previous
+  // call into s
+  void collect(Statistics &s) {
+    uint64_t delta[N_SLOTS];
+    for (auto i = 0u; i < N_SLOTS; i++) {
+      auto now = counters[i].load(std::memory_order_relaxed);
+      delta[i] = now - last[i];
+      last[i] = now;
+    }
+
+    s.n_commit += delta[COMMIT];
+    s.n_abort_no_retry += delta[ABORT_NO_RETRY];
+    s.n_abort_lock += delta[ABORT_LOCK];
+    s.n_abort_read_validation += delta[ABORT_READ_VALIDATION];
+    s.n_local += delta[LOCAL];
+    s.n_si_in_serializable += delta[SI_IN_SERIALIZABLE];
+    s.n_network_size += delta[NETWORK_SIZE];
+    s.n_queue_stall += delta[QUEUE_STALL];
+    s.queue_stall_time += delta[QUEUE_STALL_TIME];
+    s.n_deferred_flush += delta[DEFERRED_FLUSH];
+    for (auto i = 0u; i < N_TRANSACTION_PHASES; i++) {
+      s.phase_time[i] += delta[PHASE_TIME + i];
+      for (auto k = 0u; k < N_PERF_EVENTS; k++) {
+        s.phase_events[i][k] += delta[phase_events(i, k)];
+      }
+    }
+  }
+
+private:
+  char head_padding[CACHE_LINE_SIZE];
+  std::atomic<uint64_t> counters[N_SLOTS];
+  char tail_padding[CACHE_LINE_SIZE];
+  // the counters as of the previous collect()
+  uint64_t last[N_SLOTS];
+};
+} // namespace coco
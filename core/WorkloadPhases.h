@@ -0,0 +1,180 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Zipf.h"
+
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace coco {
+
+/*
+ * With --phases, the skew of the workload changes on a timeline, so that the
+ * adaptive parts of the system see a shift, e.g.,
+ *
+ *   "30:zipf=0.9;30:zipf=0.9,hot=0.5;30:zipf=0,cross=50"
+ *
+ * runs 30 seconds skewed around the first key, 30 seconds skewed around the
+ * middle of the key space, and uniform with 50% cross partition transactions
+ * from then on. A phase is its seconds and any of
+ *
+ *   zipf   the skew factor of the keys, 0 for uniform
+ *   hot    where the hottest key is, as a fraction of the key space
+ *   cross  the cross partition ratio, out of 100
+ *
+ * and the flags of the workload hold for the ones it does not set. The last
+ * phase lasts until the end of the run. The coordinator moves the phases at
+ * the seconds of its statistics and reports each phase on its own, see
+ * Coordinator::start.
+ *
+ * In YCSB, a phase sets the skew and the hotspot of the keys. In TPC-C, it
+ * sets the cross ratio of NewOrder and Payment, and with a skew, the remote
+ * warehouses are zipfian around the hotspot instead of uniform.
+ */
+
+struct WorkloadPhase {
+  std::size_t seconds = 0;
+  double zipf = -1; // unset if negative
+  double hot = 0;
+  int cross = -1; // unset if negative
+
+  std::string to_string() const {
+    std::ostringstream os;
+    os << seconds << "s";
+    if (zipf >= 0) {
+      os << " zipf=" << zipf;
+    }
+    os << " hot=" << hot;
+    if (cross >= 0) {
+      os << " cross=" << cross;
+    }
+    return os.str();
+  }
+};
+
+class WorkloadPhases {
+public:
+  // "seconds:key=value,...;..." as a list of phases, see above
+  static std::vector<WorkloadPhase> parse(const std::string &spec) {
+    std::vector<WorkloadPhase> result;
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ';')) {
+      WorkloadPhase phase;
+      auto colon = item.find(':');
+      phase.seconds = std::stoul(item.substr(0, colon));
+      CHECK(phase.seconds > 0) << "bad phase: " << item;
+      std::istringstream settings(
+          colon == std::string::npos ? "" : item.substr(colon + 1));
+      std::string setting;
+      while (std::getline(settings, setting, ',')) {
+        auto eq = setting.find('=');
+        CHECK(eq != std::string::npos) << "bad phase: " << item;
+        auto name = setting.substr(0, eq), value = setting.substr(eq + 1);
+        if (name == "zipf") {
+          phase.zipf = std::stod(value);
+          CHECK(phase.zipf >= 0 && phase.zipf < 1) << "bad phase: " << item;
+        } else if (name == "hot") {
+          phase.hot = std::stod(value);
+          CHECK(phase.hot >= 0 && phase.hot < 1) << "bad phase: " << item;
+        } else if (name == "cross") {
+          phase.cross = std::stoi(value);
+          CHECK(phase.cross >= 0 && phase.cross <= 100)
+              << "bad phase: " << item;
+        } else {
+          CHECK(false) << "bad phase: " << item;
+        }
+      }
+      result.push_back(phase);
+    }
+    return result;
+  }
+
+  // the skewed keys of a phase are in [0, n)
+  void init(const std::string &spec, uint64_t n) {
+    phases = parse(spec);
+    zipfs = std::vector<Zipf>(phases.size());
+    for (auto i = 0u; i < phases.size(); i++) {
+      if (phases[i].zipf > 0) {
+        zipfs[i].init(n, phases[i].zipf);
+      }
+    }
+    index.store(0);
+  }
+
+  bool enabled() const { return !phases.empty(); }
+
+  std::size_t size() const { return phases.size(); }
+
+  const WorkloadPhase &get(std::size_t i) const { return phases[i]; }
+
+  // the phase of a second of the run, counting from 1
+  std::size_t phase_of(std::size_t second) const {
+    std::size_t end = 0;
+    for (auto i = 0u; i + 1 < phases.size(); i++) {
+      end += phases[i].seconds;
+      if (second <= end) {
+        return i;
+      }
+    }
+    return phases.size() - 1;
+  }
+
+  // called by the coordinator before each second of the run
+  void set_second(std::size_t second) {
+    if (enabled()) {
+      index.store(phase_of(second), std::memory_order_relaxed);
+    }
+  }
+
+  // the settings below are the ones of the current phase, or the flags of
+  // the workload without phases
+
+  bool is_uniform(bool uniform) const {
+    if (!enabled()) {
+      return uniform;
+    }
+    auto &phase = phases[current()];
+    return phase.zipf < 0 ? uniform : phase.zipf == 0;
+  }
+
+  int cross_ratio(int ratio) const {
+    if (!enabled()) {
+      return ratio;
+    }
+    auto &phase = phases[current()];
+    return phase.cross < 0 ? ratio : phase.cross;
+  }
+
+  // a skewed key in [0, n), i.e., the zipf of the phase or zipf around the
+  // hotspot of the phase
+  uint64_t skewed(Zipf &zipf, uint64_t n, double u) {
+    if (!enabled()) {
+      return zipf.value(u);
+    }
+    auto i = current();
+    auto key = phases[i].zipf > 0 ? zipfs[i].value(u) : zipf.value(u);
+    return (key + static_cast<uint64_t>(phases[i].hot * n)) % n;
+  }
+
+  static WorkloadPhases &global() {
+    static WorkloadPhases p;
+    return p;
+  }
+
+private:
+  std::size_t current() const { return index.load(std::memory_order_relaxed); }
+
+private:
+  std::vector<WorkloadPhase> phases;
+  std::vector<Zipf> zipfs;
+  std::atomic<std::size_t> index{0};
+};
+} // namespace coco
@@ -7,49 +7,100 @@
 #include "core/Defs.h"
 #include "core/Executor.h"
 #include "core/Manager.h"
+#include "core/VersionReclaimer.h"
 
 #include "benchmark/tpcc/Workload.h"
 #include "benchmark/ycsb/Workload.h"
 
-#include "protocol/Scar/Scar.h"
-#include "protocol/Scar/ScarExecutor.h"
+#include "core/group_commit/Executor.h"
+#include "core/group_commit/Manager.h"
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SILO
 #include "protocol/Silo/Silo.h"
 #include "protocol/Silo/SiloExecutor.h"
-#include "protocol/TwoPL/TwoPL.h"
-#include "protocol/TwoPL/TwoPLExecutor.h"
+#endif
 
-#include "core/group_commit/Executor.h"
-#include "core/group_commit/Manager.h"
-#include "protocol/ScarGC/ScarGC.h"
-#include "protocol/ScarGC/ScarGCExecutor.h"
-#include "protocol/ScarSI/ScarSI.h"
-#include "protocol/ScarSI/ScarSIExecutor.h"
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SILOGC
 #include "protocol/SiloGC/SiloGC.h"
 #include "protocol/SiloGC/SiloGCExecutor.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SILOSI
 #include "protocol/SiloSI/SiloSI.h"
 #include "protocol/SiloSI/SiloSIExecutor.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SCAR
+#include "protocol/Scar/Scar.h"
+#include "protocol/Scar/ScarExecutor.h"
+#endif
 
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SCARGC
+#include "protocol/ScarGC/ScarGC.h"
+#include "protocol/ScarGC/ScarGCExecutor.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SCARSI
+#include "protocol/ScarSI/ScarSI.h"
+#include "protocol/ScarSI/ScarSIExecutor.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_TWOPL
+#include "protocol/TwoPL/TwoPL.h"
+#include "protocol/TwoPL/TwoPLExecutor.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_ARIA
 #include "protocol/Aria/Aria.h"
 #include "protocol/Aria/AriaExecutor.h"
 #include "protocol/Aria/AriaManager.h"
 #include "protocol/Aria/AriaTransaction.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_CALVIN
+#include "protocol/Calvin/Calvin.h"
+#include "protocol/Calvin/CalvinExecutor.h"
+#include "protocol/Calvin/CalvinManager.h"
+#include "protocol/Calvin/CalvinTransaction.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_STAR
+#include "protocol/Star/StarExecutor.h"
+#include "protocol/Star/StarManager.h"
+#endif
+
+#if !defined(COCO_PROTOCOL) || COCO_WITH_BOHM
+#include "protocol/Bohm/Bohm.h"
+#include "protocol/Bohm/BohmExecutor.h"
+#include "protocol/Bohm/BohmManager.h"
+#include "protocol/Bohm/BohmTransaction.h"
+#endif
 
 #include <unordered_set>
 
+/*
+ * A binary built with -DCOCO_PROTOCOL='"ScarGC"' -DCOCO_WITH_SCARGC=1 only
+ * instantiates the executor of that protocol, see the bench_tpcc_<protocol>
+ * targets in CMakeLists.txt, and --protocol defaults to it. Without
+ * COCO_PROTOCOL, every protocol is compiled in and chosen with --protocol.
+ */
+
 namespace coco {
 
-template <class Context> class InferType {};
+// the rows of a ycsb database are its ValueType, see --field_size
+template <class Context, class Database> class InferType {};
 
-template <> class InferType<coco::tpcc::Context> {
+template <class Database> class InferType<coco::tpcc::Context, Database> {
 public:
   template <class Transaction>
   using WorkloadType = coco::tpcc::Workload<Transaction>;
 };
 
-template <> class InferType<coco::ycsb::Context> {
+template <class Database> class InferType<coco::ycsb::Context, Database> {
 public:
   template <class Transaction>
-  using WorkloadType = coco::ycsb::Workload<Transaction>;
+  using WorkloadType =
+      coco::ycsb::Workload<Transaction, typename Database::ValueType>;
 };
 
 class WorkerFactory {
@@ -58,20 +109,46 @@ public:
   template <class Database, class Context>
   static std::vector<std::shared_ptr<Worker>>
   create_workers(std::size_t coordinator_id, Database &db,
-                 const Context &context, std::atomic<bool> &stop_flag) {
+                 const Context &context, std::atomic<bool> &stop_flag,
+                 VersionReclaimer *reclaimer = nullptr) {
 
-    std::unordered_set<std::string> protocols = {"Silo",  "SiloGC", "SiloSI",
-                                                 "Scar",  "ScarGC", "ScarSI",
-                                                 "TwoPL", "Aria"};
+    std::unordered_set<std::string> protocols = {
+        "Silo",  "SiloGC", "SiloSI", "Scar",   "ScarGC", "ScarSI",
+        "TwoPL", "Aria",   "AriaFB", "Calvin", "Star",   "Bohm"};
     CHECK(protocols.count(context.protocol) == 1);
+#ifdef COCO_PROTOCOL
+#if COCO_WITH_ARIA
+    CHECK(context.protocol == "Aria" || context.protocol == "AriaFB")
+#else
+    CHECK(context.protocol == COCO_PROTOCOL)
+#endif
+        << "protocol: " << context.protocol
+        << " is not built into this binary, which only runs " COCO_PROTOCOL;
+#endif
+
+    // the executors that poll their direct connections, see DirectConnections
+    std::unordered_set<std::string> direct_protocols = {
+        "Silo", "SiloGC", "SiloSI", "Scar", "ScarGC", "ScarSI", "TwoPL"};
+    CHECK(!context.direct_connections ||
+          direct_protocols.count(context.protocol) == 1)
+        << "protocol: " << context.protocol
+        << " does not support direct connections.";
+
+    CHECK(!context.work_stealing || context.protocol == "Aria" ||
+          context.protocol == "AriaFB")
+        << "protocol: " << context.protocol
+        << " does not support work stealing.";
 
     std::vector<std::shared_ptr<Worker>> workers;
 
-    if (context.protocol == "Silo") {
+    // the branches of the protocols compiled into this binary
+    if (false) {
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SILO
+    } else if (context.protocol == "Silo") {
 
       using TransactionType = coco::SiloTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       auto manager = std::make_shared<Manager>(
           coordinator_id, context.worker_num, context, stop_flag);
@@ -84,11 +161,13 @@ public:
 
       workers.push_back(manager);
 
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SILOGC
     } else if (context.protocol == "SiloGC") {
 
       using TransactionType = coco::SiloTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       auto manager = std::make_shared<group_commit::Manager>(
           coordinator_id, context.worker_num, context, stop_flag);
@@ -96,14 +175,17 @@ public:
       for (auto i = 0u; i < context.worker_num; i++) {
         workers.push_back(std::make_shared<SiloGCExecutor<WorkloadType>>(
             coordinator_id, i, db, context, manager->worker_status,
-            manager->n_completed_workers, manager->n_started_workers));
+            manager->n_completed_workers, manager->n_started_workers,
+            manager->epoch_counters));
       }
       workers.push_back(manager);
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SILOSI
     } else if (context.protocol == "SiloSI") {
 
       using TransactionType = coco::SiloTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       auto manager = std::make_shared<group_commit::Manager>(
           coordinator_id, context.worker_num, context, stop_flag);
@@ -111,15 +193,18 @@ public:
       for (auto i = 0u; i < context.worker_num; i++) {
         workers.push_back(std::make_shared<SiloSIExecutor<WorkloadType>>(
             coordinator_id, i, db, context, manager->worker_status,
-            manager->n_completed_workers, manager->n_started_workers));
+            manager->n_completed_workers, manager->n_started_workers,
+            manager->epoch_counters));
       }
       workers.push_back(manager);
 
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SCAR
     } else if (context.protocol == "Scar") {
 
       using TransactionType = coco::ScarTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       auto manager = std::make_shared<Manager>(
           coordinator_id, context.worker_num, context, stop_flag);
@@ -132,11 +217,13 @@ public:
 
       workers.push_back(manager);
 
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SCARGC
     } else if (context.protocol == "ScarGC") {
 
       using TransactionType = coco::ScarTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       auto manager = std::make_shared<group_commit::Manager>(
           coordinator_id, context.worker_num, context, stop_flag);
@@ -144,16 +231,19 @@ public:
       for (auto i = 0u; i < context.worker_num; i++) {
         workers.push_back(std::make_shared<ScarGCExecutor<WorkloadType>>(
             coordinator_id, i, db, context, manager->worker_status,
-            manager->n_completed_workers, manager->n_started_workers));
+            manager->n_completed_workers, manager->n_started_workers,
+            manager->epoch_counters));
       }
 
       workers.push_back(manager);
 
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_SCARSI
     } else if (context.protocol == "ScarSI") {
 
       using TransactionType = coco::ScarTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       auto manager = std::make_shared<group_commit::Manager>(
           coordinator_id, context.worker_num, context, stop_flag);
@@ -161,16 +251,19 @@ public:
       for (auto i = 0u; i < context.worker_num; i++) {
         workers.push_back(std::make_shared<ScarSIExecutor<WorkloadType>>(
             coordinator_id, i, db, context, manager->worker_status,
-            manager->n_completed_workers, manager->n_started_workers));
+            manager->n_completed_workers, manager->n_started_workers,
+            manager->epoch_counters));
       }
 
       workers.push_back(manager);
 
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_TWOPL
     } else if (context.protocol == "TwoPL") {
 
       using TransactionType = coco::TwoPLTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       auto manager = std::make_shared<Manager>(
           coordinator_id, context.worker_num, context, stop_flag);
@@ -182,11 +275,13 @@ public:
       }
 
       workers.push_back(manager);
-    } else if (context.protocol == "Aria") {
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_ARIA
+    } else if (context.protocol == "Aria" || context.protocol == "AriaFB") {
 
       using TransactionType = coco::AriaTransaction;
-      using WorkloadType =
-          typename InferType<Context>::template WorkloadType<TransactionType>;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
 
       // create manager
 
@@ -197,13 +292,82 @@ public:
 
       for (auto i = 0u; i < context.worker_num; i++) {
         workers.push_back(std::make_shared<AriaExecutor<WorkloadType>>(
+            coordinator_id, i, db, context, manager->transactions,
+            manager->storages, manager->next_transactions,
+            manager->next_storages, manager->epoch, manager->worker_status,
+            manager->total_abort, manager->lock_requests,
+            manager->n_completed_workers, manager->n_started_workers,
+            manager->work_stealing));
+      }
+
+      workers.push_back(manager);
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_CALVIN
+    } else if (context.protocol == "Calvin") {
+
+      using TransactionType = coco::CalvinTransaction;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
+
+      // create manager
+
+      auto manager = std::make_shared<CalvinManager<WorkloadType>>(
+          coordinator_id, context.worker_num, db, context, stop_flag);
+
+      // create lock managers and executors
+
+      for (auto i = 0u; i < context.worker_num; i++) {
+        workers.push_back(std::make_shared<CalvinExecutor<WorkloadType>>(
             coordinator_id, i, db, context, manager->transactions,
             manager->storages, manager->epoch, manager->worker_status,
-            manager->total_abort, manager->n_completed_workers,
+            manager->n_completed_workers, manager->n_started_workers));
+      }
+
+      workers.push_back(manager);
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_STAR
+    } else if (context.protocol == "Star") {
+
+      using TransactionType = coco::SiloTransaction;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
+
+      auto manager = std::make_shared<StarManager>(
+          coordinator_id, context.worker_num, context, stop_flag);
+
+      for (auto i = 0u; i < context.worker_num; i++) {
+        workers.push_back(std::make_shared<StarExecutor<WorkloadType>>(
+            coordinator_id, i, db, context, manager->batch_size,
+            manager->worker_status, manager->n_completed_workers,
             manager->n_started_workers));
       }
 
       workers.push_back(manager);
+#endif
+#if !defined(COCO_PROTOCOL) || COCO_WITH_BOHM
+    } else if (context.protocol == "Bohm") {
+
+      using TransactionType = coco::BohmTransaction;
+      using WorkloadType = typename InferType<
+          Context, Database>::template WorkloadType<TransactionType>;
+
+      // create manager
+
+      auto manager = std::make_shared<BohmManager<WorkloadType>>(
+          coordinator_id, context.worker_num, db, context, stop_flag,
+          reclaimer);
+
+      // create workers
+
+      for (auto i = 0u; i < context.worker_num; i++) {
+        workers.push_back(std::make_shared<BohmExecutor<WorkloadType>>(
+            coordinator_id, i, db, context, manager->transactions,
+            manager->storages, manager->epoch, manager->worker_status,
+            manager->n_completed_workers, manager->n_started_workers));
+      }
+
+      workers.push_back(manager);
+#endif
     } else {
       CHECK(false) << "protocol: " << context.protocol << " is not supported.";
     }
@@ -0,0 +1,131 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <glog/logging.h>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace coco {
+namespace group_commit {
+
+/*
+ * With --barrier=clock, the coordinators agree on the epochs through their
+ * clocks, e.g., synchronized with PTP, instead of a barrier of messages.
+ * Epoch e is [e * group_time, (e + 1) * group_time) microseconds since the
+ * Unix epoch. A coordinator stops its group at the end of an epoch by its own
+ * clock, and starts the next one --clock_skew microseconds after the end, the
+ * bound on the skew between two clocks, so that no coordinator starts the
+ * next epoch before all others have stopped this one.
+ *
+ * Once a group is durable, its coordinator seals the epoch, i.e., sends the
+ * epoch to all other coordinators, and a group is released once every
+ * coordinator has sealed its epoch or a later one. The seals arrive while the
+ * next group executes, so no manager waits for another one. A coordinator
+ * that overran an epoch skips to the current one, and one done with the run
+ * seals DONE.
+ */
+
+class ClockEpochs {
+public:
+  static constexpr uint64_t DONE = std::numeric_limits<uint64_t>::max();
+
+  ClockEpochs(std::size_t coordinator_id, std::size_t coordinator_num,
+              uint64_t group_time, uint64_t skew)
+      : coordinator_id(coordinator_id), group_time(group_time), skew(skew),
+        sealed(coordinator_num, 0) {
+    CHECK(group_time > 0);
+    CHECK(coordinator_id < coordinator_num);
+  }
+
+  // microseconds since the Unix epoch
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static void sleep_until(uint64_t time) {
+    std::this_thread::sleep_until(std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::microseconds(time))));
+  }
+
+  // the epoch to start after the one just stopped, or the first one
+  uint64_t next_epoch(uint64_t time) {
+    uint64_t next = time / group_time;
+    if (n_groups == 0) {
+      return next + 1;
+    }
+    if (next > last_epoch + 1) {
+      n_skipped += next - last_epoch - 1;
+      return next;
+    }
+    return last_epoch + 1;
+  }
+
+  uint64_t start_time(uint64_t epoch) const {
+    return epoch * group_time + skew;
+  }
+
+  uint64_t end_time(uint64_t epoch) const { return (epoch + 1) * group_time; }
+
+  // the group of this coordinator in epoch is durable
+  void seal(uint64_t epoch) {
+    DCHECK(n_groups == 0 || epoch > last_epoch);
+    sealed[coordinator_id] = epoch;
+    pending.push_back(epoch);
+    last_epoch = epoch;
+    n_groups++;
+  }
+
+  // a seal from coordinator i
+  void seal(std::size_t i, uint64_t epoch) {
+    DCHECK(i < sealed.size());
+    sealed[i] = std::max(sealed[i], epoch);
+  }
+
+  void done() { sealed[coordinator_id] = DONE; }
+
+  bool all_done() const {
+    return std::all_of(sealed.begin(), sealed.end(),
+                       [](uint64_t epoch) { return epoch == DONE; });
+  }
+
+  // the epochs up to it are sealed on all coordinators
+  uint64_t watermark() const {
+    return *std::min_element(sealed.begin(), sealed.end());
+  }
+
+  // returns the # of groups of this coordinator released so far
+  uint64_t release() {
+    auto mark = watermark();
+    while (!pending.empty() && pending.front() <= mark) {
+      pending.pop_front();
+      n_released++;
+    }
+    return n_released;
+  }
+
+  uint64_t get_groups() const { return n_groups; }
+
+  uint64_t get_skipped() const { return n_skipped; }
+
+private:
+  std::size_t coordinator_id;
+  uint64_t group_time, skew;
+  std::vector<uint64_t> sealed;
+  // the epochs of the groups sealed here but not released
+  std::deque<uint64_t> pending;
+  uint64_t last_epoch = 0, n_groups = 0, n_released = 0, n_skipped = 0;
+};
+
+} // namespace group_commit
+} // namespace coco
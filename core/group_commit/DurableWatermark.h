@@ -0,0 +1,66 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/Futex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <memory>
+
+namespace coco {
+namespace group_commit {
+
+/*
+ * The durable epoch of a coordinator with --log_path. Each executor has a log
+ * stream of its own, see RedoLog, which it syncs independently at the end of
+ * a group and then sets the epochs the stream holds. An epoch is durable once
+ * it is in every stream, i.e., the watermark is the least epoch over the
+ * streams, and the manager waits for it before the group is acknowledged,
+ * see Manager::durable_write.
+ */
+
+class DurableWatermark {
+public:
+  explicit DurableWatermark(std::size_t n_streams)
+      : n_streams(n_streams), epochs(new std::atomic<uint64_t>[n_streams]) {
+    for (auto i = 0u; i < n_streams; i++) {
+      epochs[i].store(0);
+    }
+    version.store(0);
+  }
+
+  // the first epoch epochs of stream are synced
+  void set(std::size_t stream, uint64_t epoch) {
+    DCHECK(stream < n_streams);
+    epochs[stream].store(epoch);
+    Futex::add_and_wake(version, 1);
+  }
+
+  // the # of epochs synced in every stream
+  uint64_t get() const {
+    uint64_t epoch = epochs[0].load();
+    for (auto i = 1u; i < n_streams; i++) {
+      epoch = std::min(epoch, epochs[i].load());
+    }
+    return epoch;
+  }
+
+  void wait(uint64_t epoch) {
+    Futex::wait_until(version,
+                      [this, epoch](uint32_t) { return get() >= epoch; });
+  }
+
+private:
+  std::size_t n_streams;
+  std::unique_ptr<std::atomic<uint64_t>[]> epochs;
+  // bumped on every set, the word a waiter parks on
+  std::atomic<uint32_t> version;
+};
+
+} // namespace group_commit
+} // namespace coco
@@ -0,0 +1,50 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/group_commit/DurableWatermark.h"
+#include "core/group_commit/ReplicationApplier.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace coco {
+namespace group_commit {
+
+// the counters a group commit manager shares with its executors
+
+class EpochCounters {
+public:
+  EpochCounters() {
+    n_commits.store(0);
+    n_cleanup_epochs.store(0);
+    n_released_epochs.store(0);
+    n_active_workers.store(0);
+    busy_ns.store(0);
+  }
+
+  // # of transactions committed in the current epoch
+  std::atomic<uint64_t> n_commits;
+
+  // with --pipelined_epochs, the # of epochs whose replication requests must
+  // be processed, and the # of epochs whose transactions can be released
+  std::atomic<uint64_t> n_cleanup_epochs, n_released_epochs;
+
+  // with --parallel_apply, the replication requests staged by the executors
+  std::unique_ptr<ReplicationApplier> applier;
+
+  // with --dynamic_workers, the # of executors that run transactions in the
+  // next group, and the ns the active ones were busy in the current one, see
+  // WorkerScaling
+  std::atomic<std::size_t> n_active_workers;
+  std::atomic<uint64_t> busy_ns;
+
+  // with --log_path, the epochs synced in the log streams of the executors
+  std::unique_ptr<DurableWatermark> durable;
+};
+
+} // namespace group_commit
+} // namespace coco
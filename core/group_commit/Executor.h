@@ -4,15 +4,39 @@
 
 #pragma once
 
-#include "common/Percentile.h"
+#include "common/ArrivalProcess.h"
+#include "common/BufferedFileWriter.h"
+#include "common/Futex.h"
+#include "common/Histogram.h"
+#include "common/PersistentMemory.h"
+#include "common/Probes.h"
+#include "common/Time.h"
+#include "core/AccessTrace.h"
+#include "core/AsyncCredits.h"
+#include "core/ConflictProfile.h"
+#include "core/ConflictRouter.h"
 #include "core/ControlMessage.h"
 #include "core/Defs.h"
-#include "core/Delay.h"
+#include "core/IngressServer.h"
+#include "core/MessageDispatch.h"
+#include "core/NumaPlacement.h"
 #include "core/Partitioner.h"
+#include "core/Priorities.h"
+#include "core/RedoLog.h"
+#include "core/ReplicaShipper.h"
+#include "core/RetryCache.h"
+#include "core/RetryQueue.h"
+#include "core/Timeline.h"
+#include "core/TransactionPool.h"
+#include "core/TransactionStream.h"
 #include "core/Worker.h"
+#include "core/group_commit/EpochCounters.h"
+#include "core/group_commit/FlushPolicy.h"
 #include "glog/logging.h"
 
 #include <chrono>
+#include <deque>
+#include <vector>
 
 namespace coco {
 namespace group_commit {
@@ -31,20 +55,44 @@ public:
 
   using StorageType = typename WorkloadType::StorageType;
 
+  // the maximum number of incoming messages handled before a flush
+  static constexpr std::size_t MESSAGE_BATCH_SIZE = 32;
+
+  // a transaction committed in a group that is not released yet, only its
+  // times are kept for its latency, and the request of a client transaction
+  // to answer, the transaction itself is reused
+  struct CommittedTransaction {
+    Clock::time_point startTime, commitTime;
+    IngressRequest *request;
+    uint32_t procedure_id;
+  };
+
   Executor(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
            const ContextType &context, std::atomic<uint32_t> &worker_status,
            std::atomic<uint32_t> &n_complete_workers,
-           std::atomic<uint32_t> &n_started_workers)
+           std::atomic<uint32_t> &n_started_workers,
+           EpochCounters &epoch_counters)
       : Worker(coordinator_id, id), db(db), context(context),
         worker_status(worker_status), n_complete_workers(n_complete_workers),
-        n_started_workers(n_started_workers),
+        n_started_workers(n_started_workers), epoch_counters(epoch_counters),
         partitioner(PartitionerFactory::create_partitioner(
             context.partitioner, coordinator_id, context.coordinator_num)),
         random(reinterpret_cast<uint64_t>(this)),
+        arrivals(context.arrival_rate, reinterpret_cast<uint64_t>(this) + 1),
         protocol(db, context, *partitioner),
         workload(coordinator_id, db, random, *partitioner),
-        delay(std::make_unique<SameDelay>(
-            coordinator_id, context.coordinator_num, context.delay_time)) {
+        router(id, context.worker_num, context.partition_num,
+               WorkloadType::hot_rows(context), context.conflict_routing,
+               *partitioner),
+        n_active(context.worker_num),
+        credits(context.coordinator_num,
+                (context.direct_connections || context.barrier != "all") &&
+                        context.async_credits == 0
+                    ? AsyncCredits::UNLIMITED
+                    : context.async_credits),
+        flush_policy(context.coordinator_num, context.flush_bytes,
+                     context.flush_age),
+        priorities(context.priorities, context.priority_slo) {
 
     for (auto i = 0u; i < context.coordinator_num; i++) {
       sync_messages.emplace_back(std::make_unique<Message>());
@@ -55,44 +103,101 @@ public:
     }
 
     messageHandlers = MessageHandlerType::get_message_handlers();
+    credits.set_message_handlers(messageHandlers);
     message_stats.resize(messageHandlers.size(), 0);
     message_sizes.resize(messageHandlers.size(), 0);
+    if (context.message_latency) {
+      message_statistics =
+          std::make_unique<MessageStatistics>(messageHandlers.size(), 1);
+    }
+
+    if (context.numa) {
+      numa_partitions =
+          NumaPlacement(context).local_partitions(id, *partitioner);
+    }
+
+    if (!context.log_path.empty()) {
+      logger = std::make_unique<BufferedFileWriter>(
+          RedoLog::file_name(context.log_path, coordinator_id, id).c_str(),
+          context.log_direct_io);
+    }
+    if (!context.async_replica.empty()) {
+      shipper = &ReplicaShipper::of(coordinator_id);
+    }
+    applier = epoch_counters.applier.get();
+    if (context.ingress_port > 0) {
+      ingress = &IngressServer::of(coordinator_id);
+    }
+    if (!context.trace_path.empty()) {
+      trace = std::make_unique<AccessTrace>(context.trace_path, coordinator_id,
+                                            id, context.trace_rate);
+    }
+    stream = TransactionStream::open(context, coordinator_id, id);
+    workload.set_stream(stream.get());
   }
 
   void start() override {
 
     LOG(INFO) << "Executor " << id << " starts.";
 
+    if (context.perf_counters) {
+      PerfCounters::open_thread_counters();
+    }
+    Timeline::set_thread_name(coordinator_id, "executor " + std::to_string(id));
+
     StorageType storage;
     uint64_t last_seed = 0;
 
+    TransactionPool<TransactionType> pool;
+    RetryQueue<TransactionType> retries(context.deferred_retries,
+                                        context.retry_backoff,
+                                        context.sleep_time, random.next());
+    typename RetryQueue<TransactionType>::Retry retry;
+    AbortHistory history;
+
     // transaction only commit in a single group
 
-    std::queue<std::unique_ptr<TransactionType>> q;
+    std::vector<CommittedTransaction> q;
+    // with --pipelined_epochs, the groups waiting for their barrier
+    std::deque<std::vector<CommittedTransaction>> pending;
+    uint64_t n_cleanup_epochs = 0, n_released_epochs = 0;
+    // the groups started, the same on all coordinators without pipelining
+    uint64_t n_groups = 0;
     std::size_t count = 0;
 
     for (;;) {
 
-      ExecutorStatus status;
-      do {
-        status = static_cast<ExecutorStatus>(worker_status.load());
+      auto start_or_exit = [](uint32_t s) {
+        return static_cast<ExecutorStatus>(s) == ExecutorStatus::START ||
+               static_cast<ExecutorStatus>(s) == ExecutorStatus::EXIT;
+      };
+
+      // other coordinators may still be executing the group
+      if (context.pipelined_epochs) {
+        Futex::wait_until(worker_status, start_or_exit,
+                          [this]() { return process_request(); });
+      } else {
+        Futex::wait_until(worker_status, start_or_exit);
+      }
 
-        if (status == ExecutorStatus::EXIT) {
-          LOG(INFO) << "Executor " << id << " exits.";
-          return;
-        }
-      } while (status != ExecutorStatus::START);
+      auto status = static_cast<ExecutorStatus>(worker_status.load());
+      if (status == ExecutorStatus::EXIT) {
+        release_staged();
+        LOG(INFO) << "Executor " << id << " exits.";
+        return;
+      }
 
-      while (!q.empty()) {
-        auto &ptr = q.front();
-        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
-                           std::chrono::steady_clock::now() - ptr->startTime)
-                           .count();
-        commit_latency.add(latency);
-        q.pop();
+      release(q);
+      // every executor applied the requests staged in the last epoch
+      release_staged();
+      start_group(++n_groups);
+      update_active();
+      if (flush_policy.enabled()) {
+        flush_policy.start_group(clock_us());
       }
 
-      n_started_workers.fetch_add(1);
+      Futex::add_and_wake(n_started_workers, 1);
+      TimelineSpan start_span("START");
 
       bool retry_transaction = false;
 
@@ -100,40 +205,97 @@ public:
 
         count++;
 
-        process_request();
+        if (context.pipelined_epochs) {
+          // the previous group's replication requests have arrived once the
+          // manager asks for a cleanup, one more pass handles them
+          uint64_t n = epoch_counters.n_cleanup_epochs.load();
+          process_request();
+          if (n > n_cleanup_epochs) {
+            n_cleanup_epochs = n;
+            Futex::add_and_wake(n_complete_workers, 1);
+          }
+          for (; n_released_epochs < epoch_counters.n_released_epochs.load();
+               n_released_epochs++) {
+            release(pending.front());
+            pending.pop_front();
+          }
+        } else {
+          process_request();
+        }
 
-        if (!partitioner->is_backup()) {
-          // backup node stands by for replication
+        // backup node stands by for replication, in open loop the worker
+        // also waits for the next transaction to arrive
+        // with --deferred_retries, a deferred transaction whose backoff
+        // passed goes first, and no new one starts while the queue is full
+        bool deferred = !retry_transaction && retries.pop(retry);
+        if (!partitioner->is_backup() &&
+            (retry_transaction || deferred ||
+             (!retries.full() && arrived(storage, pool)))) {
           last_seed = random.get_seed();
+          auto busy_start =
+              context.dynamic_workers ? Clock::now() : Clock::time_point();
+
+          // the cache only serves the retries of a transaction, see
+          // RetryCache
+          if (!retry_transaction) {
+            retry_cache.clear();
+          }
 
           if (retry_transaction) {
             transaction->reset();
+          } else if (deferred) {
+            pool.put(std::move(transaction));
+            transaction = std::move(retry.txn);
+            transaction->reset();
+            history = retry.history;
+          } else if (submitted != nullptr) {
+            history.clear();
+            pool.put(std::move(transaction));
+            transaction = std::move(submitted);
+            transaction->startTime = request->arrival;
+            transaction->priority = priorities.of(transaction->procedure_id);
+            setupHandlers(*transaction);
           } else {
 
-            auto partition_id = get_partition_id();
+            history.clear();
+            // with --conflict_routing, on a hot row of this worker
+            std::size_t partition_id, hot_row = 0;
+            if (!router.route(random, partition_id, hot_row)) {
+              partition_id = get_partition_id();
+            }
 
-            transaction =
-                workload.next_transaction(context, partition_id, storage);
+            pool.put(std::move(transaction));
+            transaction = workload.next_transaction(context, partition_id,
+                                                    storage, &pool, hot_row);
+            transaction->startTime = arrivals.pop();
+            transaction->priority = priorities.of(transaction->procedure_id);
             setupHandlers(*transaction);
           }
 
+          COCO_PROBE2(txn_begin, id, transaction->procedure_id);
+          transaction->phase_timer.start();
           auto result = transaction->execute(id);
+          transaction->phase_timer.end(TransactionPhase::EXECUTE);
           if (result == TransactionResult::READY_TO_COMMIT) {
             bool commit =
                 protocol.commit(*transaction, sync_messages, async_messages);
-            n_network_size.fetch_add(transaction->network_size);
+            record_phases(transaction->phase_timer);
+            transaction->phase_timer.clear();
+            stats.add(WorkerStats::NETWORK_SIZE, transaction->network_size);
             if (commit) {
-              n_commit.fetch_add(1);
+              stats.add(WorkerStats::COMMIT);
+              trace_access(*transaction, AccessOutcome::COMMIT);
               if (transaction->si_in_serializable) {
-                n_si_in_serializable.fetch_add(1);
+                stats.add(WorkerStats::SI_IN_SERIALIZABLE);
               }
               if (transaction->local_validated) {
-                n_local.fetch_add(1);
+                stats.add(WorkerStats::LOCAL);
               }
 
+              auto now = Clock::now();
               auto latency =
                   std::chrono::duration_cast<std::chrono::microseconds>(
-                      std::chrono::steady_clock::now() - transaction->startTime)
+                      now - transaction->startTime)
                       .count();
               write_latency.add(latency);
               if (transaction->distributed_transaction) {
@@ -142,49 +304,196 @@ public:
                 local_latency.add(latency);
               }
               retry_transaction = false;
-              q.push(std::move(transaction));
+              log_write_set(*transaction);
+              q.push_back({transaction->startTime, now, request,
+                           transaction->procedure_id});
+              request = nullptr;
+              pool.put(std::move(transaction));
             } else {
               if (transaction->abort_lock) {
-                n_abort_lock.fetch_add(1);
+                stats.add(WorkerStats::ABORT_LOCK);
+                record_abort(transaction->procedure_id,
+                             &ProcedureStatistics::n_abort_lock);
+                trace_access(*transaction, AccessOutcome::ABORT_LOCK);
+                COCO_PROBE3(txn_abort, id, transaction->procedure_id,
+                            static_cast<int>(ProbeAbort::LOCK));
               } else {
                 DCHECK(transaction->abort_read_validation);
-                n_abort_read_validation.fetch_add(1);
+                stats.add(WorkerStats::ABORT_READ_VALIDATION);
+                record_abort(transaction->procedure_id,
+                             &ProcedureStatistics::n_abort_read_validation);
+                trace_access(*transaction,
+                             AccessOutcome::ABORT_READ_VALIDATION);
+                COCO_PROBE3(txn_abort, id, transaction->procedure_id,
+                            static_cast<int>(ProbeAbort::READ_VALIDATION));
               }
-              if (context.sleep_on_retry) {
-                std::this_thread::sleep_for(std::chrono::microseconds(
-                    random.uniform_dist(0, context.sleep_time)));
+              if (context.deferred_retries > 0) {
+                history.abort(conflict_of(*transaction));
+                auto priority = transaction->priority;
+                retries.defer(std::move(transaction), history, priority);
+              } else {
+                if (context.sleep_on_retry && transaction->priority == 0) {
+                  std::this_thread::sleep_for(std::chrono::microseconds(
+                      random.uniform_dist(0, context.sleep_time)));
+                }
+                drop_conflict(*transaction);
+                random.set_seed(last_seed);
+                retry_transaction = true;
               }
-              random.set_seed(last_seed);
-              retry_transaction = true;
             }
           } else {
             protocol.abort(*transaction, sync_messages, async_messages);
-            n_abort_no_retry.fetch_add(1);
+            record_phases(transaction->phase_timer);
+            stats.add(WorkerStats::ABORT_NO_RETRY);
+            record_abort(transaction->procedure_id,
+                         &ProcedureStatistics::n_abort_no_retry);
+            trace_access(*transaction, AccessOutcome::ABORT_NO_RETRY);
+            COCO_PROBE3(txn_abort, id, transaction->procedure_id,
+                        static_cast<int>(ProbeAbort::NO_RETRY));
+            if (request != nullptr) {
+              ingress->notify(id, request, IngressStatus::ABORTED);
+              request = nullptr;
+            }
           }
 
-          if (count % context.batch_flush == 0) {
+          if (flush_policy.enabled() || count % context.batch_flush == 0) {
             flush_async_messages();
           }
+          if (context.dynamic_workers) {
+            busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           Clock::now() - busy_start)
+                           .count();
+          }
+        } else if (parked && !retry_transaction && retries.empty()) {
+          // only serves the requests of other coordinators till the group
+          // stops, see WorkerScaling
+          flush_async_messages();
+          Futex::wait_until(
+              worker_status,
+              [](uint32_t s) {
+                return static_cast<ExecutorStatus>(s) != ExecutorStatus::START;
+              },
+              [this]() { return process_request(); });
         }
 
         status = static_cast<ExecutorStatus>(worker_status.load());
       } while (status != ExecutorStatus::STOP);
+      start_span.end();
+      TimelineSpan stop_span("STOP");
+
+      // like a retry, a deferred transaction does not outlive its group
+      retries.clear([&pool](std::unique_ptr<TransactionType> txn) {
+        pool.put(std::move(txn));
+      });
+
+      stop_group();
+
+      // the group is not done until its replication is sent
+      flush_async_messages(true);
+      if (flush_policy.enabled()) {
+        flush_policy.stop_group(clock_us());
+      }
+      if (context.direct_connections || context.barrier != "all") {
+        wait_till_handled();
+      }
+
+      // the rows this executor wrote in the group are flushed, see
+      // PersistentTable
+      if (!context.pmem_path.empty()) {
+        PersistentMemory::fence();
+      }
+
+      // the manager waits for all workers, so the group is durable before it
+      // is acknowledged
+      persist_log();
+      ship_epoch();
 
-      flush_async_messages();
+      // transactions in q are committed in this epoch
+      epoch_counters.n_commits.fetch_add(q.size());
+      if (context.dynamic_workers) {
+        epoch_counters.busy_ns.fetch_add(busy_ns);
+        busy_ns = 0;
+      }
+
+      if (context.pipelined_epochs) {
+        // the next group starts right away, q is released once the barrier
+        // of this group is done
+        pending.push_back(std::move(q));
+        q.clear();
+        stop_span.end();
+        Futex::add_and_wake(n_complete_workers, 1);
+        continue;
+      }
 
-      n_complete_workers.fetch_add(1);
+      stop_span.end();
+      Futex::add_and_wake(n_complete_workers, 1);
 
       // once all workers are stop, we need to process the replication
       // requests
 
-      while (static_cast<ExecutorStatus>(worker_status.load()) !=
-             ExecutorStatus::CLEANUP) {
-        process_request();
-      }
+      TimelineSpan wait_span("wait4_cleanup");
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) == ExecutorStatus::CLEANUP;
+          },
+          [this]() { return process_request(); });
+      wait_span.end();
 
+      TimelineSpan cleanup_span("CLEANUP");
       process_request();
-      n_complete_workers.fetch_add(1);
+      apply_staged();
+      cleanup_span.end();
+      Futex::add_and_wake(n_complete_workers, 1);
+    }
+  }
+
+  // the transactions in q are committed
+  void release(std::vector<CommittedTransaction> &q) {
+    auto now = Clock::now();
+    uint64_t wait_time = 0;
+    for (auto &txn : q) {
+      auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                         now - txn.startTime)
+                         .count();
+      commit_latency.add(latency);
+      record_latency(latency, txn.procedure_id);
+      COCO_PROBE3(txn_commit, id, txn.procedure_id, latency);
+      if (txn.request != nullptr) {
+        ingress->notify(id, txn.request, IngressStatus::COMMITTED);
+      }
+      wait_time += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       now - txn.commitTime)
+                       .count();
+    }
+    if (wait_time != 0) {
+      stats.add(WorkerStats::PHASE_TIME +
+                    static_cast<std::size_t>(
+                        TransactionPhase::GROUP_COMMIT_WAIT),
+                wait_time);
+    }
+    q.clear();
+  }
+
+  // a new transaction arrived, with --ingress_port the next valid one a
+  // client submitted, the invalid ones are answered right away
+  bool arrived(StorageType &storage, TransactionPool<TransactionType> &pool) {
+    if (ingress == nullptr) {
+      return !parked && arrivals.arrived();
     }
+    while (submitted == nullptr) {
+      request = ingress->pop(id);
+      if (request == nullptr) {
+        return false;
+      }
+      submitted = workload.submitted_transaction(
+          context, request->procedure, request->args, storage, &pool);
+      if (submitted == nullptr) {
+        ingress->notify(id, request, IngressStatus::INVALID);
+        request = nullptr;
+      }
+    }
+    return true;
   }
 
   void onExit() override {
@@ -204,6 +513,35 @@ public:
               << local_latency.nth(95) << " us (95%) " << local_latency.nth(99)
               << " us (99%).";
 
+    if (context.retry_cache) {
+      LOG(INFO) << "Worker " << id << " retry cache: "
+                << retry_cache.get_hits() << " hits, "
+                << retry_cache.get_misses() << " misses.";
+    }
+
+    if (applier != nullptr) {
+      LOG(INFO) << "Worker " << id << " applied " << n_applied_requests
+                << " replication requests in " << n_staged_epochs
+                << " epochs.";
+    }
+
+    if (logger != nullptr) {
+      LOG(INFO) << "Worker " << id << " logged " << n_log_bytes
+                << " bytes in " << epoch
+                << " epochs, fsync latency: " << fsync_latency.nth(50)
+                << " us (50%) " << fsync_latency.nth(75) << " us (75%) "
+                << fsync_latency.nth(95) << " us (95%) "
+                << fsync_latency.nth(99) << " us (99%).";
+      logger->close();
+    }
+
+    if (trace != nullptr) {
+      trace->close();
+    }
+    if (stream != nullptr) {
+      stream->close();
+    }
+
     if (id == 0) {
       for (auto i = 0u; i < message_stats.size(); i++) {
         LOG(INFO) << "message stats, type: " << i
@@ -218,6 +556,18 @@ public:
 
     std::size_t partition_id;
 
+    if (!context.hash_placement()) {
+      return get_owned_partition_id();
+    }
+
+    // with --numa, only the partitions on the node of this worker
+    if (!numa_partitions.empty()) {
+      partition_id =
+          numa_partitions[random.uniform_dist(0, numa_partitions.size() - 1)];
+      CHECK(partitioner->has_master_partition(partition_id));
+      return partition_id;
+    }
+
     if (context.partitioner == "pb") {
       partition_id = random.uniform_dist(0, context.partition_num - 1);
     } else {
@@ -231,24 +581,38 @@ public:
     return partition_id;
   }
 
+  // the partitions are placed elsewhere than partition id % coordinator_num
+  // (see DynamicPartitioner and AffinityPartitioner), one of the partitions
+  // on this node, or any partition once the node has none
+  std::size_t get_owned_partition_id() {
+    std::size_t n = 0;
+    for (auto i = 0u; i < context.partition_num; i++) {
+      n += partitioner->has_master_partition(i);
+    }
+    if (n == 0) {
+      return random.uniform_dist(0, context.partition_num - 1);
+    }
+    std::size_t k = random.uniform_dist(0, n - 1);
+    for (auto i = 0u;; i++) {
+      if (partitioner->has_master_partition(i) && k-- == 0) {
+        return i;
+      }
+    }
+  }
+
   void push_message(Message *message) override { in_queue.push(message); }
 
-  Message *pop_message() override {
-    if (out_queue.empty())
-      return nullptr;
+  Message *pop_message() override { return pop_from(out_queue); }
 
-    Message *message = out_queue.front();
+  Message *pop_async_message() override { return pop_from(async_out_queue); }
 
-    if (delay->delay_enabled()) {
-      auto now = std::chrono::steady_clock::now();
-      if (std::chrono::duration_cast<std::chrono::microseconds>(now -
-                                                                message->time)
-              .count() < delay->message_delay()) {
-        return nullptr;
-      }
-    }
+  Message *pop_from(LockfreeQueue<Message *> &queue) {
+    if (queue.empty())
+      return nullptr;
+
+    Message *message = queue.front();
 
-    bool ok = out_queue.pop();
+    bool ok = queue.pop();
     CHECK(ok);
 
     return message;
@@ -257,28 +621,65 @@ public:
   std::size_t process_request() {
 
     std::size_t size = 0;
+    receive_direct();
+    if (!dispatch.is_bound()) {
+      dispatch.bind(messageHandlers);
+      dispatch.prefetch_keys(MessageHandlerType::get_keyed_messages(),
+                             context.prefetch_distance);
+    }
 
-    while (!in_queue.empty()) {
-      std::unique_ptr<Message> message(in_queue.front());
-      bool ok = in_queue.pop();
-      CHECK(ok);
+    // messages are handled in batches, and the responses to a batch are
+    // flushed together
+    Message *batch[MESSAGE_BATCH_SIZE];
+    std::size_t n;
+
+    while ((n = in_queue.pop_n(batch, MESSAGE_BATCH_SIZE)) > 0) {
+      for (auto i = 0u; i < n; i++) {
+        std::unique_ptr<Message> message(batch[i]);
+        bool staged = false;
+
+        dispatch.begin(db, *message);
+        for (auto it = message->begin(); it != message->end(); it++) {
+
+          dispatch.next(db);
+          MessagePiece messagePiece = *it;
+          auto type = messagePiece.get_message_type();
+          DCHECK(type < messageHandlers.size());
+          message_stats[type]++;
+          message_sizes[type] += messagePiece.get_message_length();
+
+          // applied in CLEANUP, see ReplicationApplier
+          if (applier != nullptr &&
+              MessageHandlerType::is_replication_request(type)) {
+            applier->stage(id, messagePiece);
+            staged = true;
+            continue;
+          }
 
-      for (auto it = message->begin(); it != message->end(); it++) {
+          ITable *table = dispatch.table(db, messagePiece);
 
-        MessagePiece messagePiece = *it;
-        auto type = messagePiece.get_message_type();
-        DCHECK(type < messageHandlers.size());
-        ITable *table = db.find_table(messagePiece.get_table_id(),
-                                      messagePiece.get_partition_id());
+          auto txn = transaction.get();
+          auto handle = [&]() {
+            dispatch(type, messagePiece,
+                     *sync_messages[message->get_source_node_id()], *table,
+                     txn);
+          };
+          if (message_statistics == nullptr) {
+            handle();
+          } else {
+            message_statistics->handle(
+                type, 0, message->time, txn ? &txn->pendingResponses : nullptr,
+                handle);
+          }
+        }
 
-        messageHandlers[type](messagePiece,
-                              *sync_messages[message->get_source_node_id()],
-                              *table, transaction.get());
-        message_stats[type]++;
-        message_sizes[type] += messagePiece.get_message_length();
+        size += message->get_message_count();
+        if (staged) {
+          staged_messages.push_back(message.release());
+        } else {
+          incoming_message_pool.put(message.release());
+        }
       }
-
-      size += message->get_message_count();
       flush_sync_messages();
     }
     return size;
@@ -287,7 +688,68 @@ public:
   virtual void setupHandlers(TransactionType &txn) = 0;
 
 protected:
-  void flush_messages(std::vector<std::unique_ptr<Message>> &messages) {
+  // the executor starts its n-th group
+  virtual void start_group(uint64_t n) {}
+
+  // the executor stops its group, the messages sent here are in the group
+  virtual void stop_group() {}
+
+  // with --dynamic_workers, whether this executor runs transactions in the
+  // group, see WorkerScaling. The hot rows of --conflict_routing and the
+  // arrivals of --arrival_rate are spread over the active executors, and a
+  // parked executor only drains the client requests dealt to it before.
+  void update_active() {
+    if (!context.dynamic_workers) {
+      return;
+    }
+    auto n = epoch_counters.n_active_workers.load();
+    parked = id >= n;
+    if (n == n_active) {
+      return;
+    }
+    n_active = n;
+    if (!parked) {
+      router = ConflictRouter(id, n, context.partition_num,
+                              WorkloadType::hot_rows(context),
+                              context.conflict_routing, *partitioner);
+      if (!arrivals.closed_loop()) {
+        arrivals.set_rate(context.arrival_rate * context.worker_num / n);
+      }
+    }
+  }
+
+  // with --trace_path, samples the rows txn accessed, see AccessTrace
+  void trace_access(TransactionType &txn, AccessOutcome outcome) {
+    if (trace != nullptr) {
+      trace->trace(db, txn, outcome);
+    }
+  }
+
+  // the row that aborted txn, see RetryQueue
+  // the retry reads the row of the conflict again, see RetryCache
+  void drop_conflict(TransactionType &txn) {
+    if (context.retry_cache && txn.conflict_key != nullptr) {
+      retry_cache.erase(
+          *db.find_table(txn.conflict_table_id, txn.conflict_partition_id),
+          txn.conflict_key);
+    }
+  }
+
+  std::string conflict_of(TransactionType &txn) {
+    if (txn.conflict_key == nullptr) {
+      return std::string();
+    }
+    auto table =
+        db.find_table(txn.conflict_table_id, txn.conflict_partition_id);
+    return ConflictProfile::key_of(*table, txn.conflict_key);
+  }
+
+  // ready(message) is called for each message to flush, a message is kept
+  // in messages if it returns false
+  template <class Func>
+  void flush_messages(std::vector<std::unique_ptr<Message>> &messages,
+                      LockfreeQueue<Message *> &queue, Func ready) {
+    flush_batch.clear();
     for (auto i = 0u; i < messages.size(); i++) {
       if (i == coordinator_id) {
         continue;
@@ -297,17 +759,160 @@ protected:
         continue;
       }
 
-      auto message = messages[i].release();
+      if (!ready(*messages[i])) {
+        continue;
+      }
 
-      out_queue.push(message);
-      messages[i] = std::make_unique<Message>();
+      flush_batch.push_back(messages[i].release());
+      messages[i].reset(outgoing_message_pool.get());
       init_message(messages[i].get(), i);
     }
+    // one update of the queue for all coordinators
+    push_outgoing(queue, flush_batch.data(), flush_batch.size());
+  }
+
+  // flushes the requests of the transaction, whose responses are timed with
+  // --message_latency
+  void flush_sync_requests() {
+    if (message_statistics != nullptr) {
+      message_statistics->on_flush(0);
+    }
+    flush_sync_messages();
+  }
+
+  void flush_sync_messages() {
+    flush_messages(sync_messages, out_queue,
+                   [](Message &message) { return true; });
+  }
+
+  void log_write_set(TransactionType &txn) {
+    if ((logger == nullptr && shipper == nullptr) || txn.writeSet.empty()) {
+      return;
+    }
+    log_buffer.clear();
+    for (auto &writeKey : txn.writeSet) {
+      ITable *table = db.find_table(writeKey.get_table_id(),
+                                    writeKey.get_partition_id());
+      RedoLog::append_record(log_buffer, *table, writeKey.get_key(),
+                             writeKey.get_value(), txn.get_commit_ts());
+    }
+    if (shipper != nullptr) {
+      ship_buffer += log_buffer;
+    }
+    if (logger == nullptr) {
+      return;
+    }
+    logger->write(log_buffer.data(), log_buffer.size());
+    n_log_bytes += log_buffer.size();
+  }
+
+  // close the current epoch and sync the log once per group
+  void persist_log() {
+    if (logger == nullptr) {
+      return;
+    }
+    log_buffer.clear();
+    RedoLog::append_epoch(log_buffer, epoch++);
+    logger->write(log_buffer.data(), log_buffer.size());
+    n_log_bytes += log_buffer.size();
+
+    auto now = Clock::now();
+    logger->sync();
+    fsync_latency.add(std::chrono::duration_cast<std::chrono::microseconds>(
+                          Clock::now() - now)
+                          .count());
+    n_durable_epochs.store(epoch);
+    epoch_counters.durable->set(id, epoch);
+  }
+
+  // the epoch goes to the async replica once it is durable, see ReplicaShipper
+  void ship_epoch() {
+    if (shipper == nullptr) {
+      return;
+    }
+    shipper->ship(id, std::move(ship_buffer));
+    ship_buffer.clear();
   }
 
-  void flush_sync_messages() { flush_messages(sync_messages); }
+  // applies the replication requests staged to the partitions of this
+  // executor once every executor has staged the ones of this epoch
+  void apply_staged() {
+    if (applier == nullptr) {
+      return;
+    }
+    applier->wait4_staged(++n_staged_epochs);
+    if (!dispatch.is_bound()) {
+      dispatch.bind(messageHandlers);
+      dispatch.prefetch_keys(MessageHandlerType::get_keyed_messages(),
+                             context.prefetch_distance);
+    }
+    n_applied_requests += applier->apply(id, [this](MessagePiece piece) {
+      ITable *table = dispatch.table(db, piece);
+      // replication requests have no response
+      dispatch(piece.get_message_type(), piece,
+               *sync_messages[coordinator_id], *table, nullptr);
+    });
+  }
 
-  void flush_async_messages() { flush_messages(async_messages); }
+  void release_staged() {
+    for (auto message : staged_messages) {
+      incoming_message_pool.put(message);
+    }
+    staged_messages.clear();
+  }
+
+  // with --flush_bytes, a message waits for the flush policy, and with
+  // --async_credits, for credits, unless force is set
+  void flush_async_messages(bool force = false) {
+    if (!credits.enabled() && !flush_policy.enabled()) {
+      flush_messages(async_messages, async_out_queue,
+                     [](Message &message) { return true; });
+      return;
+    }
+    uint64_t now = flush_policy.enabled() ? clock_us() : 0;
+    flush_messages(async_messages, async_out_queue,
+                   [this, force, now](Message &message) {
+                     if (flush_policy.enabled() && !force &&
+                         !flush_policy.ready(message, now)) {
+                       return false;
+                     }
+                     if (credits.enabled() &&
+                         !credits.acquire(message, force)) {
+                       stats.add(WorkerStats::DEFERRED_FLUSH);
+                       return false;
+                     }
+                     if (flush_policy.enabled()) {
+                       flush_policy.sent(message);
+                     }
+                     return true;
+                   });
+  }
+
+  static uint64_t clock_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               Clock::now().time_since_epoch())
+        .count();
+  }
+
+  /*
+   * With direct connections, the tree barrier or clock epochs, the messages
+   * of a group do not travel with the stop messages of the manager, if any,
+   * so a destination may see the stop first. Instead, a credit request is
+   * sent to each coordinator after them, and as a connection is in order, its
+   * credits are back once they are handled.
+   */
+  void wait_till_handled() {
+    for (auto i = 0u; i < async_messages.size(); i++) {
+      if (i != coordinator_id) {
+        credits.acquire(*async_messages[i], true);
+      }
+    }
+    flush_messages(async_messages, async_out_queue,
+                   [](Message &message) { return true; });
+    while (credits.in_flight()) {
+      process_request();
+    }
+  }
 
   void init_message(Message *message, std::size_t dest_node_id) {
     message->set_source_node_id(coordinator_id);
@@ -320,20 +925,54 @@ protected:
   const ContextType &context;
   std::atomic<uint32_t> &worker_status;
   std::atomic<uint32_t> &n_complete_workers, &n_started_workers;
+  EpochCounters &epoch_counters;
   std::unique_ptr<Partitioner> partitioner;
+  std::vector<std::size_t> numa_partitions;
   RandomType random;
+  ArrivalProcess arrivals;
   ProtocolType protocol;
   WorkloadType workload;
-  std::unique_ptr<Delay> delay;
-  Percentile<int64_t> commit_latency, write_latency;
-  Percentile<int64_t> dist_latency, local_latency;
+  ConflictRouter router;
+  // with --dynamic_workers, see update_active
+  std::size_t n_active;
+  bool parked = false;
+  uint64_t busy_ns = 0;
+  AsyncCredits credits;
+  FlushPolicy flush_policy;
+  Priorities priorities;
+  RetryCache retry_cache;
+  Histogram commit_latency, write_latency;
+  Histogram dist_latency, local_latency;
+  std::unique_ptr<BufferedFileWriter> logger;
+  std::unique_ptr<AccessTrace> trace;
+  std::unique_ptr<TransactionStream> stream;
+  std::string log_buffer;
+  ReplicationApplier *applier = nullptr;
+  // the messages of the requests staged to the applier in this epoch
+  std::vector<Message *> staged_messages;
+  uint64_t n_staged_epochs = 0;
+  std::size_t n_applied_requests = 0;
+  ReplicaShipper *shipper = nullptr;
+  IngressServer *ingress = nullptr;
+  // with --ingress_port, the request of the transaction that runs, and the
+  // transaction of the next one
+  IngressRequest *request = nullptr;
+  std::unique_ptr<TransactionType> submitted;
+  // the records of this epoch for the async replica
+  std::string ship_buffer;
+  uint64_t epoch = 0;
+  std::size_t n_log_bytes = 0;
+  Histogram fsync_latency;
   std::unique_ptr<TransactionType> transaction;
   std::vector<std::unique_ptr<Message>> sync_messages, async_messages;
   std::vector<
       std::function<void(MessagePiece, Message &, ITable &, TransactionType *)>>
       messageHandlers;
+  MessageDispatch<TransactionType *> dispatch;
   std::vector<std::size_t> message_stats, message_sizes;
-  LockfreeQueue<Message *> in_queue, out_queue;
+  LockfreeQueue<Message *> in_queue, out_queue, async_out_queue;
+  // messages released by flush_messages
+  std::vector<Message *> flush_batch;
 };
 } // namespace group_commit
 
@@ -0,0 +1,116 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "common/Message.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <glog/logging.h>
+#include <vector>
+
+namespace coco {
+namespace group_commit {
+
+/*
+ * FlushPolicy decides when an executor sends the async messages it buffers
+ * for a destination, instead of every --batch_flush transactions. With
+ * --flush_bytes, a message is sent once
+ *
+ *  - it holds the target bytes of its destination,
+ *  - its first piece is --flush_age microseconds old, or
+ *  - the group is within --flush_age of its expected stop, so that little is
+ *    left for the flush after the stop and CLEANUP stays short.
+ *
+ * The target of a destination follows its volume: once a group is done, it
+ * is the bytes the destination got in about --flush_age of the group,
+ * smoothed with an exponential moving average, within [MIN_BYTES,
+ * --flush_bytes]. A destination that gets little is sent a message per
+ * --flush_age, one that gets much is sent messages of about the same size
+ * at about the same rate, rather than a message of however many bytes
+ * batch_flush transactions wrote.
+ *
+ * The expected length of a group is the smoothed length of the groups
+ * before. All times are in microseconds.
+ */
+
+class FlushPolicy {
+public:
+  static constexpr std::size_t MIN_BYTES = 1024;
+
+  FlushPolicy(std::size_t coordinator_num, std::size_t max_bytes,
+              uint64_t max_age)
+      : max_bytes(std::max(max_bytes, std::size_t(MIN_BYTES))),
+        max_age(max_age), enabled_(max_bytes > 0),
+        target(coordinator_num, this->max_bytes),
+        first(coordinator_num, 0), group_bytes(coordinator_num, 0),
+        avg_bytes(coordinator_num, 0) {}
+
+  bool enabled() const { return enabled_; }
+
+  void start_group(uint64_t now) {
+    group_start = now;
+    std::fill(group_bytes.begin(), group_bytes.end(), 0);
+  }
+
+  // called once the messages of the group are sent
+  void stop_group(uint64_t now) {
+    auto length = std::max<uint64_t>(now - group_start, 1);
+    group_length = n_groups == 0
+                       ? length
+                       : ALPHA * length + (1 - ALPHA) * group_length;
+    for (auto i = 0u; i < target.size(); i++) {
+      avg_bytes[i] = n_groups == 0
+                         ? group_bytes[i]
+                         : ALPHA * group_bytes[i] + (1 - ALPHA) * avg_bytes[i];
+      auto bytes = avg_bytes[i] * std::min<double>(max_age, length) /
+                   group_length;
+      target[i] = std::max<std::size_t>(
+          std::size_t(MIN_BYTES), std::min<std::size_t>(bytes, max_bytes));
+    }
+    n_groups++;
+  }
+
+  // if message is sent now
+  bool ready(Message &message, uint64_t now) {
+    auto dest = message.get_dest_node_id();
+    DCHECK(dest < target.size());
+    if (first[dest] == 0) {
+      first[dest] = now;
+    }
+    return message.get_message_length() >= target[dest] ||
+           now - first[dest] >= max_age || near_stop(now);
+  }
+
+  // called once message is sent
+  void sent(Message &message) {
+    auto dest = message.get_dest_node_id();
+    DCHECK(dest < target.size());
+    first[dest] = 0;
+    group_bytes[dest] += message.get_message_length();
+  }
+
+  std::size_t get_target(std::size_t dest) const { return target[dest]; }
+
+private:
+  bool near_stop(uint64_t now) const {
+    return n_groups > 0 && now - group_start + max_age >= group_length;
+  }
+
+private:
+  static constexpr double ALPHA = 0.2;
+
+  std::size_t max_bytes;
+  uint64_t max_age;
+  bool enabled_;
+  std::vector<std::size_t> target;
+  std::vector<uint64_t> first, group_bytes;
+  std::vector<double> avg_bytes;
+  uint64_t group_start = 0, n_groups = 0;
+  double group_length = 0;
+};
+
+} // namespace group_commit
+} // namespace coco
@@ -0,0 +1,89 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Context.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace coco {
+namespace group_commit {
+
+/*
+ * GroupTimeController adjusts the epoch length at runtime, starting from
+ * --group_time.
+ *
+ * A transaction is released once the barrier of its epoch is done, so the
+ * p99 commit latency is about group time + barrier time. With
+ * --target_latency the group time moves toward target - barrier time.
+ *
+ * With --target_batch_size, the group time moves toward the time it takes to
+ * commit that many transactions on coordinator 0, based on its throughput
+ * during execution, i.e., each log flush covers about that many transactions.
+ *
+ * If both are set, the shorter group time wins so that the latency target is
+ * kept. The barrier time and the throughput are smoothed with an exponential
+ * moving average, and each update moves half way to the new group time.
+ */
+
+class GroupTimeController {
+public:
+  // in microseconds
+  static constexpr uint64_t MIN_GROUP_TIME = 100, MAX_GROUP_TIME = 1000000;
+
+  explicit GroupTimeController(const Context &context)
+      : target_latency(context.target_latency),
+        target_batch_size(context.target_batch_size),
+        group_time(clamp(1000.0 * context.group_time)) {}
+
+  bool enabled() const { return target_latency > 0 || target_batch_size > 0; }
+
+  // in microseconds
+  uint64_t get_group_time() const { return static_cast<uint64_t>(group_time); }
+
+  // called once an epoch is done, all times are in microseconds
+  void update(uint64_t epoch_group_time, uint64_t barrier_time,
+              uint64_t n_commit) {
+    if (n_epochs == 0) {
+      barrier = barrier_time;
+      throughput = 1.0 * n_commit / std::max<uint64_t>(epoch_group_time, 1);
+    } else {
+      barrier = ALPHA * barrier_time + (1 - ALPHA) * barrier;
+      throughput = ALPHA * n_commit / std::max<uint64_t>(epoch_group_time, 1) +
+                   (1 - ALPHA) * throughput;
+    }
+    n_epochs++;
+
+    double target = MAX_GROUP_TIME;
+    if (target_latency > 0) {
+      target = std::min(target, target_latency - barrier);
+    }
+    if (target_batch_size > 0 && throughput > 0) {
+      target = std::min(target, target_batch_size / throughput);
+    }
+    group_time = clamp(group_time + GAIN * (target - group_time));
+  }
+
+  // smoothed barrier time in microseconds
+  double get_barrier_time() const { return barrier; }
+
+private:
+  static double clamp(double t) {
+    return std::max<double>(MIN_GROUP_TIME,
+                            std::min<double>(t, MAX_GROUP_TIME));
+  }
+
+private:
+  static constexpr double ALPHA = 0.2, GAIN = 0.5;
+
+  double target_latency, target_batch_size;
+  double group_time;
+  double barrier = 0, throughput = 0; // txns per microsecond
+  uint64_t n_epochs = 0;
+};
+
+} // namespace group_commit
+} // namespace coco
@@ -5,7 +5,15 @@
 #pragma once
 
 #include "common/FastSleep.h"
+#include "core/IngressServer.h"
 #include "core/Manager.h"
+#include "core/Snapshot.h"
+#include "core/StaleReads.h"
+#include "core/group_commit/ClockEpochs.h"
+#include "core/group_commit/EpochCounters.h"
+#include "core/group_commit/GroupTimeController.h"
+#include "core/group_commit/ReplicaQuorum.h"
+#include "core/group_commit/WorkerScaling.h"
 
 namespace coco {
 namespace group_commit {
@@ -16,76 +24,302 @@ public:
 
   Manager(std::size_t coordinator_id, std::size_t id, const Context &context,
           std::atomic<bool> &stopFlag)
-      : base_type(coordinator_id, id, context, stopFlag) {}
+      : base_type(coordinator_id, id, context, stopFlag), scaling(context) {
+    epoch_counters.n_active_workers.store(context.worker_num);
+    if (context.supports_snapshots()) {
+      snapshot = &Snapshot::of(coordinator_id);
+    }
+    if (context.stale_reads) {
+      stale_reads = &StaleReads::of(coordinator_id);
+    }
+    if (context.replica_quorum > 0 && coordinator_id == 0) {
+      auto partitioner = PartitionerFactory::create_partitioner(
+          context.partitioner, coordinator_id, context.coordinator_num);
+      quorum = std::make_unique<ReplicaQuorum>(
+          coordinator_id, context.coordinator_num, context.partition_num,
+          context.replica_quorum, *partitioner);
+    }
+    if (context.parallel_apply) {
+      auto partitioner = PartitionerFactory::create_partitioner(
+          context.partitioner, coordinator_id, context.coordinator_num);
+      epoch_counters.applier = std::make_unique<ReplicationApplier>(
+          context.worker_num, context.partition_num, *partitioner);
+    }
+    if (!context.log_path.empty()) {
+      epoch_counters.durable =
+          std::make_unique<DurableWatermark>(context.worker_num);
+    }
+  }
 
   void coordinator_start() override {
 
+    if (context.barrier == "clock") {
+      clock_start();
+      return;
+    }
+
+    if (context.pipelined_epochs) {
+      pipelined_coordinator_start();
+      return;
+    }
+
     std::size_t n_workers = context.worker_num;
-    std::size_t n_coordinators = context.coordinator_num;
 
-    std::chrono::steady_clock::time_point start, end;
+    std::chrono::steady_clock::time_point start, running, stop, end;
     std::size_t group_time = 1000 * context.group_time,
                 total_time = 1000 * context.group_time;
+    GroupTimeController controller(context);
+    uint64_t n_epochs = 0;
 
     while (!stopFlag.load()) {
       start = std::chrono::steady_clock::now();
+      n_epochs++;
+      start_epoch(n_epochs);
 
       n_started_workers.store(0);
       n_completed_workers.store(0);
       signal_worker(ExecutorStatus::START);
       wait_all_workers_start();
-      group_time = get_group_time(group_time, total_time);
+      running = std::chrono::steady_clock::now();
+      if (controller.enabled()) {
+        group_time = controller.get_group_time();
+      } else {
+        group_time = get_group_time(group_time, total_time);
+      }
       std::this_thread::sleep_for(std::chrono::microseconds(group_time));
       set_worker_status(ExecutorStatus::STOP);
+      stop = std::chrono::steady_clock::now();
       wait_all_workers_finish();
-      broadcast_stop();
-      wait4_stop(n_coordinators - 1);
-      simulate_durable_write();
+      scale_workers(running, stop);
+      stop_barrier();
+      durable_write(n_epochs);
       // process replication
       n_completed_workers.store(0);
       set_worker_status(ExecutorStatus::CLEANUP);
       wait_all_workers_finish();
-      wait4_ack();
+      apply_epoch(n_epochs);
+      wait4_epoch_ack(n_epochs);
+      apply_migration_events();
+      apply_snapshot();
 
       end = std::chrono::steady_clock::now();
       total_time =
           std::chrono::duration_cast<std::chrono::microseconds>(end - start)
               .count();
+      if (controller.enabled()) {
+        controller.update(
+            std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+                .count(),
+            std::chrono::duration_cast<std::chrono::microseconds>(end - stop)
+                .count(),
+            epoch_counters.n_commits.exchange(0));
+      }
     }
 
+    wait4_late_acks();
+    log_group_time(controller);
+    log_worker_scaling();
+    log_replica_quorum();
+
     signal_worker(ExecutorStatus::EXIT);
   }
 
   void non_coordinator_start() override {
 
+    if (context.barrier == "clock") {
+      clock_start();
+      return;
+    }
+
+    if (context.pipelined_epochs) {
+      pipelined_non_coordinator_start();
+      return;
+    }
+
     std::size_t n_workers = context.worker_num;
-    std::size_t n_coordinators = context.coordinator_num;
+    uint64_t n_epochs = 0;
 
     for (;;) {
 
       ExecutorStatus status = wait4_signal();
       if (status == ExecutorStatus::EXIT) {
+        log_worker_scaling();
         set_worker_status(ExecutorStatus::EXIT);
         break;
       }
 
       DCHECK(status == ExecutorStatus::START);
+      n_epochs++;
+      start_epoch(n_epochs);
       n_completed_workers.store(0);
       n_started_workers.store(0);
       set_worker_status(ExecutorStatus::START);
       wait_all_workers_start();
-      wait4_stop(1);
-      simulate_durable_write();
+      auto running = std::chrono::steady_clock::now();
+      wait4_stop_trigger();
       set_worker_status(ExecutorStatus::STOP);
+      auto stop = std::chrono::steady_clock::now();
       wait_all_workers_finish();
-      broadcast_stop();
-      wait4_stop(n_coordinators - 2);
+      scale_workers(running, stop);
+      durable_write(n_epochs);
+      stop_barrier();
       // process replication
       n_completed_workers.store(0);
       set_worker_status(ExecutorStatus::CLEANUP);
       wait_all_workers_finish();
-      send_ack();
+      apply_epoch(n_epochs);
+      send_ack(n_epochs);
+      apply_migration_events();
+      apply_snapshot();
+    }
+  }
+
+  /*
+   * With --pipelined_epochs, a group starts once the previous one is stopped
+   * on all coordinators and its log is durable. The replication requests of
+   * the previous group are processed and acknowledged while the group
+   * executes, and its transactions are released once coordinator 0 has all
+   * acks. Coordinator 0 sends an ack back to each coordinator as the release.
+   */
+
+  void pipelined_coordinator_start() {
+
+    std::chrono::steady_clock::time_point start, stop, last_stop;
+    uint64_t n_epochs = 0, last_group_time = 0, last_commits = 0;
+    GroupTimeController controller(context);
+    std::size_t group_time = 1000 * context.group_time;
+
+    while (!stopFlag.load()) {
+      start_epoch(n_epochs + 1);
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      signal_worker(ExecutorStatus::START);
+      wait_all_workers_start();
+      start = std::chrono::steady_clock::now();
+
+      if (n_epochs > 0) {
+        cleanup_and_release(n_epochs);
+        if (controller.enabled()) {
+          controller.update(
+              last_group_time,
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - last_stop)
+                  .count(),
+              last_commits);
+        }
+      }
+
+      if (controller.enabled()) {
+        group_time = controller.get_group_time();
+      }
+      std::this_thread::sleep_until(start +
+                                    std::chrono::microseconds(group_time));
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      stop = std::chrono::steady_clock::now();
+      wait_all_workers_finish();
+      stop_barrier();
+      durable_write(n_epochs + 1);
+
+      n_epochs++;
+      last_stop = stop;
+      last_group_time =
+          std::chrono::duration_cast<std::chrono::microseconds>(stop - start)
+              .count();
+      last_commits = epoch_counters.n_commits.exchange(0);
+    }
+
+    wait4_late_acks();
+    signal_worker(ExecutorStatus::EXIT);
+    log_group_time(controller);
+    log_replica_quorum();
+  }
+
+  void pipelined_non_coordinator_start() {
+
+    uint64_t n_epochs = 0;
+
+    for (;;) {
+
+      ExecutorStatus status = wait4_signal();
+      if (status == ExecutorStatus::EXIT) {
+        set_worker_status(ExecutorStatus::EXIT);
+        break;
+      }
+
+      DCHECK(status == ExecutorStatus::START);
+      start_epoch(n_epochs + 1);
+      n_completed_workers.store(0);
+      n_started_workers.store(0);
+      set_worker_status(ExecutorStatus::START);
+      wait_all_workers_start();
+
+      if (n_epochs > 0) {
+        cleanup_and_release(n_epochs);
+      }
+
+      wait4_stop_trigger();
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      durable_write(n_epochs + 1);
+      stop_barrier();
+      n_epochs++;
+    }
+  }
+
+  /*
+   * With --barrier=clock, each coordinator runs the groups of the epochs on
+   * its own clock, see ClockEpochs. The executors are pipelined, and a group
+   * is released once the seals of all coordinators have arrived.
+   */
+
+  void clock_start() {
+
+    ClockEpochs epochs(coordinator_id, context.coordinator_num,
+                       1000 * context.group_time, context.clock_skew);
+    auto epoch = epochs.next_epoch(ClockEpochs::now());
+    ClockEpochs::sleep_until(epochs.start_time(epoch));
+    uint64_t n_groups = 0;
+
+    while (!stopFlag.load()) {
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::START);
+      wait_all_workers_start();
+
+      // the seals of the previous groups arrive while this one executes
+      auto end = epochs.end_time(epoch);
+      for (auto now = ClockEpochs::now(); now < end;
+           now = ClockEpochs::now()) {
+        receive_seals(epochs);
+        epoch_counters.n_released_epochs.store(epochs.release());
+        ClockEpochs::sleep_until(std::min(end, now + SEAL_POLL_US));
+      }
+
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      durable_write(++n_groups);
+      epochs.seal(epoch);
+      send_seals(epoch);
+      epoch_counters.n_released_epochs.store(epochs.release());
+
+      epoch = epochs.next_epoch(ClockEpochs::now());
+      ClockEpochs::sleep_until(epochs.start_time(epoch));
+    }
+
+    // the workers handle the requests of the others until they are done
+    epochs.done();
+    send_seals(ClockEpochs::DONE);
+    while (!epochs.all_done()) {
+      ack_in_queue.wait_till_non_empty();
+      receive_seals(epochs);
     }
+    epoch_counters.n_released_epochs.store(epochs.release());
+    set_worker_status(ExecutorStatus::EXIT);
+
+    LOG(INFO) << "clock epochs: " << epochs.get_groups() << " groups, "
+              << epochs.get_skipped() << " epochs skipped.";
   }
 
   // in microseconds.
@@ -106,12 +340,216 @@ public:
     }
   }
 
+public:
+  EpochCounters epoch_counters;
+
 protected:
-  void simulate_durable_write() {
+  // with --stale_reads, see StaleReads
+  void start_epoch(uint64_t n_epochs) {
+    if (stale_reads != nullptr) {
+      stale_reads->start_epoch(n_epochs);
+    }
+  }
+
+  void apply_epoch(uint64_t n_epochs) {
+    if (stale_reads != nullptr) {
+      stale_reads->apply_epoch(n_epochs);
+    }
+  }
+
+  // pins or drops the snapshot of a read-only query, no transaction is running
+  void apply_snapshot() {
+    if (snapshot != nullptr) {
+      snapshot->on_epoch_boundary();
+    }
+  }
+
+  // called while the group after epoch n_epochs executes
+  void cleanup_and_release(uint64_t n_epochs) {
+    epoch_counters.n_cleanup_epochs.store(n_epochs);
+    wait_all_workers_finish();
+    apply_epoch(n_epochs);
+    if (coordinator_id == 0) {
+      wait4_epoch_ack(n_epochs);
+      for (auto i : downstream) {
+        ControlMessageFactory::new_ack_message(*messages[i]);
+      }
+      flush_messages();
+    } else {
+      send_ack(n_epochs);
+      wait4_release();
+    }
+    epoch_counters.n_released_epochs.store(n_epochs);
+  }
+
+  // with --replica_quorum, the epoch may be done before all acks arrive, see
+  // ReplicaQuorum
+  void wait4_epoch_ack(uint64_t epoch) {
+    if (quorum == nullptr) {
+      wait4_ack();
+      return;
+    }
+
+    TimelineSpan span("wait4_ack");
+    quorum->start(epoch);
+
+    // the acks that already arrived are taken as well
+    bool done = quorum->done();
+    while (!done || !ack_in_queue.empty()) {
+      done = take_ack();
+    }
+    quorum->finish();
+  }
+
+  // the late acks of the last epoch, so that all replicas have it at exit
+  void wait4_late_acks() {
+    if (quorum == nullptr) {
+      return;
+    }
+    while (quorum->lagging() > 0) {
+      take_ack();
+    }
+  }
+
+  bool take_ack() {
+    ack_in_queue.wait_till_non_empty();
+
+    std::unique_ptr<Message> message(ack_in_queue.front());
+    bool ok = ack_in_queue.pop();
+    CHECK(ok);
+
+    CHECK(message->get_message_count() == 1);
+
+    MessagePiece messagePiece = *(message->begin());
+    auto type = static_cast<ControlMessage>(messagePiece.get_message_type());
+    CHECK(type == ControlMessage::ACK);
+
+    uint64_t epoch;
+    StringPiece stringPiece = messagePiece.toStringPiece();
+    Decoder dec(stringPiece);
+    dec >> epoch;
+    return quorum->ack(message->get_source_node_id(), epoch);
+  }
+
+  void log_replica_quorum() {
+    if (quorum != nullptr) {
+      LOG(INFO) << "replica quorum: " << quorum->partial_epochs()
+                << " epochs done without all acks, " << quorum->late_acks()
+                << " late acks, max lag: " << quorum->get_max_lag()
+                << " epochs.";
+    }
+  }
+
+  void wait4_release() {
+    TimelineSpan span("wait4_release");
+    ack_in_queue.wait_till_non_empty();
+
+    std::unique_ptr<Message> message(ack_in_queue.front());
+    bool ok = ack_in_queue.pop();
+    CHECK(ok);
+
+    CHECK(message->get_message_count() == 1);
+
+    MessagePiece messagePiece = *(message->begin());
+    auto type = static_cast<ControlMessage>(messagePiece.get_message_type());
+    CHECK(type == ControlMessage::ACK);
+
+    // the subtree of this coordinator in the barrier tree
+    for (auto i : downstream) {
+      ControlMessageFactory::new_ack_message(*messages[i]);
+    }
+    flush_messages();
+  }
+
+  void send_seals(uint64_t epoch) {
+    for (auto i = 0u; i < context.coordinator_num; i++) {
+      if (i != coordinator_id) {
+        ControlMessageFactory::new_ack_message(*messages[i], epoch);
+      }
+    }
+    flush_messages();
+  }
+
+  // the seals that already arrived, as acks of their epochs
+  void receive_seals(ClockEpochs &epochs) {
+    while (!ack_in_queue.empty()) {
+      std::unique_ptr<Message> message(ack_in_queue.front());
+      bool ok = ack_in_queue.pop();
+      CHECK(ok);
+
+      CHECK(message->get_message_count() == 1);
+
+      MessagePiece messagePiece = *(message->begin());
+      auto type = static_cast<ControlMessage>(messagePiece.get_message_type());
+      CHECK(type == ControlMessage::ACK);
+
+      uint64_t epoch;
+      StringPiece stringPiece = messagePiece.toStringPiece();
+      Decoder dec(stringPiece);
+      dec >> epoch;
+      epochs.seal(message->get_source_node_id(), epoch);
+    }
+  }
+
+  void log_group_time(const GroupTimeController &controller) {
+    if (controller.enabled()) {
+      LOG(INFO) << "group time: " << controller.get_group_time()
+                << " us, barrier time: " << controller.get_barrier_time()
+                << " us.";
+    }
+  }
+
+  // with --dynamic_workers, the executors of the next group, see
+  // WorkerScaling. A group ran from running to stop.
+  void scale_workers(std::chrono::steady_clock::time_point running,
+                     std::chrono::steady_clock::time_point stop) {
+    if (!scaling.enabled()) {
+      return;
+    }
+    auto n = scaling.get_n_active();
+    auto group_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(stop - running)
+            .count();
+    if (scaling.update(epoch_counters.busy_ns.exchange(0), group_ns) == n) {
+      return;
+    }
+    n = scaling.get_n_active();
+    epoch_counters.n_active_workers.store(n);
+    if (context.ingress_port > 0) {
+      IngressServer::of(coordinator_id).set_active(n);
+    }
+    LOG(INFO) << "Coordinator " << coordinator_id << " runs " << n
+              << " executors, utilization: " << scaling.get_utilization();
+  }
+
+  void log_worker_scaling() {
+    if (scaling.enabled()) {
+      LOG(INFO) << "Coordinator " << coordinator_id << " changed its active "
+                << "executors " << scaling.get_n_changes() << " times, "
+                << scaling.get_n_active() << " at the end.";
+    }
+  }
+
+  // the log of the n-th group of this coordinator is durable once it is
+  // synced in every stream, see DurableWatermark. Without a log, the cost of
+  // --durable_write_cost is simulated instead.
+  void durable_write(uint64_t n) {
+    if (epoch_counters.durable != nullptr) {
+      epoch_counters.durable->wait(n);
+      return;
+    }
     if (context.durable_write_cost > 0) {
       FastSleep::sleep_for(context.durable_write_cost);
     }
   }
+
+private:
+  static constexpr uint64_t SEAL_POLL_US = 100;
+
+  Snapshot *snapshot = nullptr;
+  StaleReads *stale_reads = nullptr;
+  std::unique_ptr<ReplicaQuorum> quorum;
+  WorkerScaling scaling;
 };
 
 } // namespace group_commit
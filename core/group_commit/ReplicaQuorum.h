@@ -0,0 +1,127 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Partitioner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <glog/logging.h>
+#include <set>
+#include <vector>
+
+namespace coco {
+namespace group_commit {
+
+/*
+ * With --replica_quorum=q, coordinator 0 completes an epoch once q replicas
+ * of each partition have it, instead of waiting for an ack from every
+ * coordinator. The master of a partition has the epoch once its stop has
+ * arrived, since its log is durable before the stop is sent, and so does
+ * coordinator 0 once its own replication requests are processed. A late
+ * replica still processes the replication of the epoch, in order, and its
+ * ack counts as late once it arrives.
+ */
+
+class ReplicaQuorum {
+public:
+  ReplicaQuorum(std::size_t coordinator_id, std::size_t coordinator_num,
+                std::size_t partition_num, std::size_t quorum,
+                const Partitioner &partitioner)
+      : coordinator_id(coordinator_id), quorum(quorum),
+        acked(coordinator_num, false), last_acks(coordinator_num, 0) {
+
+    // the partitions with the same replicas are 1 group
+    std::set<std::vector<std::size_t>> replicas;
+    for (auto i = 0u; i < partition_num; i++) {
+      std::vector<std::size_t> group;
+      // the master goes first
+      auto master = partitioner.master_coordinator(i);
+      group.push_back(master);
+      for (auto j = 0u; j < coordinator_num; j++) {
+        if (j != master && partitioner.is_partition_replicated_on(i, j)) {
+          group.push_back(j);
+        }
+      }
+      CHECK(quorum <= group.size())
+          << "partition " << i << " has " << group.size() << " replicas, "
+          << "fewer than a quorum of " << quorum << ".";
+      replicas.insert(group);
+    }
+    groups.assign(replicas.begin(), replicas.end());
+  }
+
+  // epoch starts to wait for the acks
+  void start(uint64_t epoch) {
+    this->epoch = epoch;
+    std::fill(acked.begin(), acked.end(), false);
+    acked[coordinator_id] = true;
+    last_acks[coordinator_id] = epoch;
+  }
+
+  // returns true once the current epoch is on a quorum of each group
+  bool ack(std::size_t coordinator_id, uint64_t epoch) {
+    DCHECK(epoch <= this->epoch);
+    last_acks[coordinator_id] = epoch;
+    if (epoch < this->epoch) {
+      n_late_acks++;
+    } else {
+      acked[coordinator_id] = true;
+    }
+    return done();
+  }
+
+  bool done() const {
+    for (auto &group : groups) {
+      std::size_t n = 1;
+      for (auto i = 1u; i < group.size(); i++) {
+        n += acked[group[i]];
+      }
+      if (n < quorum) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // called once the current epoch is done, before its late acks arrive
+  void finish() {
+    if (std::find(acked.begin(), acked.end(), false) != acked.end()) {
+      n_partial_epochs++;
+    }
+    for (auto last : last_acks) {
+      max_lag = std::max(max_lag, epoch - last);
+    }
+  }
+
+  // # of coordinators that have not acknowledged the current epoch yet
+  std::size_t lagging() const {
+    return std::count_if(last_acks.begin(), last_acks.end(),
+                         [this](uint64_t last) { return last < epoch; });
+  }
+
+  // # of epochs done without the ack of every coordinator
+  std::size_t partial_epochs() const { return n_partial_epochs; }
+
+  // # of acks that arrived after their epoch was done
+  std::size_t late_acks() const { return n_late_acks; }
+
+  // the most epochs a coordinator lagged behind when an epoch was done
+  uint64_t get_max_lag() const { return max_lag; }
+
+private:
+  std::size_t coordinator_id;
+  std::size_t quorum;
+  std::vector<std::vector<std::size_t>> groups;
+  uint64_t epoch = 0;
+  std::vector<bool> acked;
+  // the last epoch acknowledged by each coordinator
+  std::vector<uint64_t> last_acks;
+  std::size_t n_partial_epochs = 0, n_late_acks = 0;
+  uint64_t max_lag = 0;
+};
+
+} // namespace group_commit
+} // namespace coco
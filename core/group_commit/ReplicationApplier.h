@@ -0,0 +1,102 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Futex.h"
+#include "common/MessagePiece.h"
+#include "core/Partitioner.h"
+
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <vector>
+
+namespace coco {
+namespace group_commit {
+
+/*
+ * With --parallel_apply, the executors of a coordinator do not apply the
+ * replication requests they receive right away. Each executor stages them by
+ * partition, and in CLEANUP, once every executor has staged its requests of
+ * the epoch, each partition is applied by the executor that owns it. The
+ * replicated partitions are spread over the executors evenly, so an epoch of
+ * heavy replication to one executor does not stretch the barrier, and a row
+ * only has one writer, no transaction runs in CLEANUP.
+ *
+ * The requests of an executor are staged in the order they arrived, and a
+ * remote executor always sends to the same one, so the requests of a source
+ * are applied in order.
+ */
+
+class ReplicationApplier {
+public:
+  ReplicationApplier(std::size_t worker_num, std::size_t partition_num,
+                     const Partitioner &partitioner)
+      : worker_num(worker_num), owners(partition_num),
+        staged(worker_num, std::vector<std::vector<MessagePiece>>(
+                               partition_num)) {
+    n_staged_workers.store(0);
+    // the replicas go round robin, the other partitions are not replicated
+    // to this coordinator
+    std::size_t n_replicas = 0;
+    for (auto i = 0u; i < partition_num; i++) {
+      if (partitioner.is_partition_replicated_on_me(i) &&
+          !partitioner.has_master_partition(i)) {
+        owners[i] = n_replicas++ % worker_num;
+      } else {
+        owners[i] = i % worker_num;
+      }
+    }
+  }
+
+  // called by executor worker_id, piece lives until the next epoch starts
+  void stage(std::size_t worker_id, const MessagePiece &piece) {
+    DCHECK(piece.get_partition_id() < owners.size());
+    staged[worker_id][piece.get_partition_id()].push_back(piece);
+  }
+
+  // executor worker_id has staged the requests of the n-th epoch, waits for
+  // the other executors
+  void wait4_staged(uint64_t n) {
+    Futex::add_and_wake(n_staged_workers, 1);
+    Futex::wait_until(n_staged_workers, [this, n](uint32_t value) {
+      return value >= n * worker_num;
+    });
+  }
+
+  // calls func(piece) for the requests staged to the partitions of
+  // worker_id, returns the number of requests
+  template <class Func> std::size_t apply(std::size_t worker_id, Func &&func) {
+    std::size_t n = 0;
+    for (auto i = 0u; i < owners.size(); i++) {
+      if (owners[i] != worker_id) {
+        continue;
+      }
+      for (auto &worker : staged) {
+        for (auto &piece : worker[i]) {
+          func(piece);
+        }
+        n += worker[i].size();
+        worker[i].clear();
+      }
+    }
+    return n;
+  }
+
+  std::size_t owner(std::size_t partition_id) const {
+    return owners[partition_id];
+  }
+
+private:
+  std::size_t worker_num;
+  // the executor that applies each partition
+  std::vector<std::size_t> owners;
+  // staged[worker][partition]
+  std::vector<std::vector<std::vector<MessagePiece>>> staged;
+  std::atomic<uint32_t> n_staged_workers;
+};
+
+} // namespace group_commit
+} // namespace coco
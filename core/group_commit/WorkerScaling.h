@@ -0,0 +1,81 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include "core/Context.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace coco {
+namespace group_commit {
+
+/*
+ * WorkerScaling decides how many executors of a coordinator run transactions
+ * in the next group with --dynamic_workers, between --min_workers and
+ * --worker_num, starting from all of them.
+ *
+ * Once a group stops, the utilization of the active executors is the time
+ * they spent executing and committing transactions over the time the group
+ * ran, smoothed with an exponential moving average. Above SCALE_UP one more
+ * executor is activated, and one is parked if the work would keep one
+ * executor less below SCALE_DOWN, so an executor is only parked when it would
+ * not be activated again right away. It moves by one executor per group.
+ *
+ * The executors are activated in the order of their ids, i.e., the first n
+ * are active, see group_commit::Executor::start_group.
+ */
+
+class WorkerScaling {
+public:
+  static constexpr double SCALE_UP = 0.85, SCALE_DOWN = 0.6;
+
+  explicit WorkerScaling(const Context &context)
+      : enabled_(context.dynamic_workers), worker_num(context.worker_num),
+        min_workers(std::max<std::size_t>(1, context.min_workers)),
+        n_active(context.worker_num) {}
+
+  bool enabled() const { return enabled_; }
+
+  std::size_t get_n_active() const { return n_active; }
+
+  // the # of changes so far
+  uint64_t get_n_changes() const { return n_changes; }
+
+  // smoothed busy time per active executor over group time
+  double get_utilization() const { return utilization; }
+
+  // called once a group stops, busy_ns is the sum over the active executors,
+  // returns the # of active executors of the next group
+  std::size_t update(uint64_t busy_ns, uint64_t group_ns) {
+    double u = 1.0 * busy_ns / (n_active * std::max<uint64_t>(group_ns, 1));
+    utilization = n_groups == 0 ? u : ALPHA * u + (1 - ALPHA) * utilization;
+    n_groups++;
+
+    if (utilization > SCALE_UP && n_active < worker_num) {
+      // the load spreads over one executor more
+      utilization = utilization * n_active / (n_active + 1);
+      n_active++;
+      n_changes++;
+    } else if (n_active > min_workers &&
+               utilization * n_active / (n_active - 1) < SCALE_DOWN) {
+      utilization = utilization * n_active / (n_active - 1);
+      n_active--;
+      n_changes++;
+    }
+    return n_active;
+  }
+
+private:
+  static constexpr double ALPHA = 0.2;
+
+  bool enabled_;
+  std::size_t worker_num, min_workers, n_active;
+  double utilization = 0;
+  uint64_t n_groups = 0, n_changes = 0;
+};
+
+} // namespace group_commit
+} // namespace coco
@@ -0,0 +1,92 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Encoder.h"
+#include "common/Serialization.h"
+#include <benchmark/benchmark.h>
+#include <string>
+
+namespace {
+
+void BM_EncoderScalars(benchmark::State &state) {
+  std::string bytes;
+  for (auto _ : state) {
+    bytes.clear();
+    coco::Encoder encoder(bytes);
+    for (auto i = 0; i < 16; i++) {
+      encoder << uint64_t(i) << uint32_t(i);
+    }
+    benchmark::DoNotOptimize(bytes.data());
+  }
+  state.SetBytesProcessed(state.iterations() * 16 * 12);
+}
+BENCHMARK(BM_EncoderScalars);
+
+void BM_DecoderScalars(benchmark::State &state) {
+  std::string bytes;
+  coco::Encoder encoder(bytes);
+  for (auto i = 0; i < 16; i++) {
+    encoder << uint64_t(i) << uint32_t(i);
+  }
+  for (auto _ : state) {
+    coco::Decoder dec(encoder.toStringPiece());
+    uint64_t a;
+    uint32_t b;
+    for (auto i = 0; i < 16; i++) {
+      dec >> a >> b;
+    }
+    benchmark::DoNotOptimize(a + b);
+  }
+  state.SetBytesProcessed(state.iterations() * 16 * 12);
+}
+BENCHMARK(BM_DecoderScalars);
+
+void BM_EncoderBytes(benchmark::State &state) {
+  std::string value(state.range(0), 'a'), bytes;
+  for (auto _ : state) {
+    bytes.clear();
+    coco::Encoder encoder(bytes);
+    encoder.write_n_bytes(value.data(), value.size());
+    benchmark::DoNotOptimize(bytes.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncoderBytes)->Arg(100)->Arg(1000);
+
+void BM_SerializerString(benchmark::State &state) {
+  std::string value(state.range(0), 'a');
+  coco::Serializer<std::string> serializer;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(serializer(value));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializerString)->Arg(10)->Arg(100)->Arg(1000);
+
+// appends to a reused buffer instead of returning a new string
+void BM_SerializerStringAppend(benchmark::State &state) {
+  std::string value(state.range(0), 'a'), out;
+  coco::Serializer<std::string> serializer;
+  for (auto _ : state) {
+    out.clear();
+    serializer(value, out);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SerializerStringAppend)->Arg(10)->Arg(100)->Arg(1000);
+
+void BM_DeserializerString(benchmark::State &state) {
+  std::string bytes = coco::Serializer<std::string>()(
+      std::string(state.range(0), 'a'));
+  coco::Deserializer<std::string> deserializer;
+  std::string value;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        deserializer(coco::StringPiece(bytes.data(), bytes.size()), value));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DeserializerString)->Arg(10)->Arg(100)->Arg(1000);
+} // namespace
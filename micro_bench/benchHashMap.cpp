@@ -0,0 +1,107 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/HashMap.h"
+#include "common/MVCCHashMap.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr int N_KEYS = 1 << 16;
+
+void BM_HashMapLookup(benchmark::State &state) {
+  coco::HashMap<997, int, int> map;
+  for (auto i = 0; i < N_KEYS; i++) {
+    map[i] = i;
+  }
+  int key = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.contains(key));
+    key = (key + 7919) % N_KEYS;
+  }
+}
+BENCHMARK(BM_HashMapLookup);
+
+void BM_HashMapInsert(benchmark::State &state) {
+  coco::HashMap<997, int, int> map;
+  int key = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.insert(key, key));
+    if (++key == N_KEYS) {
+      state.PauseTiming();
+      map.clear();
+      key = 0;
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_HashMapInsert);
+
+// each thread updates its own key and looks up the key of another thread,
+// the threads contend for the lock of a bucket with N = 1
+template <std::size_t N> void BM_HashMapContention(benchmark::State &state) {
+  static coco::HashMap<N, int, int> map;
+  int key = state.thread_index(), other = (key + 1) % state.threads();
+  map.insert(key, 0);
+  for (auto _ : state) {
+    map[key]++;
+    benchmark::DoNotOptimize(map.contains(other));
+  }
+}
+BENCHMARK_TEMPLATE(BM_HashMapContention, 1)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_HashMapContention, 997)->ThreadRange(1, 8);
+
+void BM_MVCCHashMapLookup(benchmark::State &state) {
+  coco::MVCCHashMap<997, int, int> map;
+  auto versions = state.range(0);
+  for (auto i = 0; i < N_KEYS; i++) {
+    for (auto v = 1; v <= versions; v++) {
+      map.insert_key_version_holder(i, v) = i;
+    }
+  }
+  int key = 0;
+  for (auto _ : state) {
+    // the version before the latest, i.e., a read of an older snapshot
+    benchmark::DoNotOptimize(map.get_key_version_prev(key, versions));
+    key = (key + 7919) % N_KEYS;
+  }
+}
+BENCHMARK(BM_MVCCHashMapLookup)->Arg(1)->Arg(4)->Arg(16);
+
+void BM_MVCCHashMapInsert(benchmark::State &state) {
+  coco::MVCCHashMap<997, int, int> map;
+  int key = 0;
+  uint64_t version = 1;
+  for (auto _ : state) {
+    map.insert_key_version_holder(key, version) = key;
+    if (++key == N_KEYS) {
+      state.PauseTiming();
+      for (auto i = 0; i < N_KEYS; i++) {
+        map.vacuum_key_keep_latest(i);
+      }
+      key = 0;
+      version++;
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_MVCCHashMapInsert);
+
+template <std::size_t N>
+void BM_MVCCHashMapContention(benchmark::State &state) {
+  static coco::MVCCHashMap<N, int, int> map;
+  int key = state.thread_index(), other = (key + 1) % state.threads();
+  uint64_t version = 1;
+  // versions of a key increase, the key may be left by a previous run
+  map.remove_key(key);
+  for (auto _ : state) {
+    map.insert_key_version_holder(key, version++) = key;
+    // keeps the chain short
+    map.vacuum_key_keep_latest(key);
+    benchmark::DoNotOptimize(map.get_key_version_prev(other, UINT64_MAX));
+  }
+}
+BENCHMARK_TEMPLATE(BM_MVCCHashMapContention, 1)->ThreadRange(1, 8);
+BENCHMARK_TEMPLATE(BM_MVCCHashMapContention, 997)->ThreadRange(1, 8);
+} // namespace
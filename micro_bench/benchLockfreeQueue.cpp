@@ -0,0 +1,53 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/LockfreeQueue.h"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <thread>
+
+namespace {
+
+void BM_LockfreeQueuePushPop(benchmark::State &state) {
+  coco::LockfreeQueue<int> q;
+  for (auto _ : state) {
+    q.push(1);
+    benchmark::DoNotOptimize(q.front());
+    q.pop();
+  }
+}
+BENCHMARK(BM_LockfreeQueuePushPop);
+
+void BM_LockfreeQueueBatch(benchmark::State &state) {
+  coco::LockfreeQueue<int> q;
+  std::vector<int> values(state.range(0), 1), out(state.range(0));
+  for (auto _ : state) {
+    q.push_n(values.data(), values.size());
+    benchmark::DoNotOptimize(q.pop_n(out.data(), out.size()));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LockfreeQueueBatch)->Arg(8)->Arg(64);
+
+// a producer and a consumer on different threads, as a worker and a
+// dispatcher are
+void BM_LockfreeQueueProducerConsumer(benchmark::State &state) {
+  coco::LockfreeQueue<int> q;
+  std::atomic<bool> stop(false);
+  std::thread consumer([&]() {
+    while (!stop.load(std::memory_order_relaxed)) {
+      if (!q.empty()) {
+        q.pop();
+      }
+    }
+  });
+  for (auto _ : state) {
+    q.push(1);
+  }
+  stop.store(true);
+  consumer.join();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LockfreeQueueProducerConsumer)->UseRealTime();
+} // namespace
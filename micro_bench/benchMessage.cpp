@@ -0,0 +1,64 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Encoder.h"
+#include "common/Message.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+using coco::Encoder;
+using coco::Message;
+using coco::MessagePiece;
+
+void build(Message &message, int pieces) {
+  Encoder encoder(message.data);
+  for (auto i = 0; i < pieces; i++) {
+    auto header = MessagePiece::construct_message_piece_header(
+        1, MessagePiece::get_header_size() + sizeof(uint64_t) * 2, 0, i);
+    encoder << header << uint64_t(i) << uint64_t(i);
+    message.flush();
+  }
+}
+
+void BM_MessageBuild(benchmark::State &state) {
+  for (auto _ : state) {
+    Message message;
+    build(message, state.range(0));
+    benchmark::DoNotOptimize(message.get_message_length());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MessageBuild)->Arg(1)->Arg(16)->Arg(128);
+
+// reuses the buffer of the message like the message pools do
+void BM_MessageBuildReuse(benchmark::State &state) {
+  Message message;
+  for (auto _ : state) {
+    message.clear();
+    build(message, state.range(0));
+    benchmark::DoNotOptimize(message.get_message_length());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MessageBuildReuse)->Arg(1)->Arg(16)->Arg(128);
+
+void BM_MessageIterate(benchmark::State &state) {
+  Message message;
+  build(message, state.range(0));
+  for (auto _ : state) {
+    uint64_t sum = 0;
+    for (auto it = message.begin(); it != message.end(); it++) {
+      MessagePiece piece = *it;
+      coco::Decoder dec(piece.toStringPiece());
+      uint64_t a, b;
+      dec >> a >> b;
+      sum += a + b + piece.get_partition_id();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MessageIterate)->Arg(1)->Arg(16)->Arg(128);
+} // namespace
@@ -0,0 +1,51 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "protocol/Silo/SiloHelper.h"
+#include <benchmark/benchmark.h>
+#include <string>
+
+namespace {
+
+void BM_SiloHelperLockUnlock(benchmark::State &state) {
+  std::atomic<uint64_t> tid(0);
+  bool success;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(coco::SiloHelper::lock(tid, success));
+    coco::SiloHelper::unlock(tid);
+  }
+}
+BENCHMARK(BM_SiloHelperLockUnlock);
+
+// threads take turns on the same lock, a failed attempt retries at once
+std::atomic<uint64_t> contended_tid(0);
+
+void BM_SiloHelperLockContention(benchmark::State &state) {
+  bool success;
+  int64_t failures = 0;
+  for (auto _ : state) {
+    coco::SiloHelper::lock(contended_tid, success);
+    if (success) {
+      coco::SiloHelper::unlock(contended_tid);
+    } else {
+      failures++;
+    }
+  }
+  state.counters["failures"] =
+      benchmark::Counter(failures, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_SiloHelperLockContention)->ThreadRange(1, 8);
+
+void BM_SiloHelperRead(benchmark::State &state) {
+  std::atomic<uint64_t> tid(42);
+  std::string value(state.range(0), 'a'), dest(state.range(0), 0);
+  auto row = std::make_tuple(&tid, static_cast<void *>(&value[0]));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        coco::SiloHelper::read(row, &dest[0], dest.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SiloHelperRead)->Arg(8)->Arg(100)->Arg(1000);
+} // namespace
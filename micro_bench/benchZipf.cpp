@@ -0,0 +1,34 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Percentile.h"
+#include "common/Random.h"
+#include "common/Zipf.h"
+#include <benchmark/benchmark.h>
+
+namespace {
+
+void BM_ZipfValue(benchmark::State &state) {
+  coco::Zipf z;
+  z.init(state.range(0), 0.99);
+  coco::Random random;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(z.value(random.next_double()));
+  }
+}
+BENCHMARK(BM_ZipfValue)->Arg(1 << 16)->Arg(1 << 20);
+
+void BM_PercentileAdd(benchmark::State &state) {
+  coco::Percentile<int64_t> p;
+  int64_t v = 0;
+  for (auto _ : state) {
+    p.add(v++ % 1000);
+    // bounds the memory of long runs
+    if (v % (1 << 20) == 0) {
+      p.clear();
+    }
+  }
+}
+BENCHMARK(BM_PercentileAdd);
+} // namespace
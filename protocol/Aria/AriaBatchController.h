@@ -0,0 +1,96 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Context.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace coco {
+
+/*
+ * AriaBatchController adjusts the number of transactions in an Aria batch at
+ * runtime, between --aria_min_batch_size and --batch_size, starting from the
+ * latter.
+ *
+ * An epoch takes about barrier time + batch size x the time per transaction,
+ * so with --aria_target_latency the batch moves toward target latency / the
+ * average time per transaction of the last epochs, which converges to the
+ * size whose epoch takes the target, barriers included.
+ *
+ * The conflicting transactions of a batch grow with the square of its size,
+ * so the abort ratio is about proportional to the size, i.e., n_abort / n^2
+ * is the abort ratio per transaction. The batch also moves toward the size
+ * that would abort MAX_ABORT_RATIO of it, and the smaller size wins. Both the
+ * time and the abort ratio per transaction are smoothed with an exponential
+ * moving average, and each update moves half way to the new size, as in
+ * group_commit::GroupTimeController.
+ */
+
+class AriaBatchController {
+public:
+  static constexpr double MAX_ABORT_RATIO = 0.2;
+
+  explicit AriaBatchController(const Context &context)
+      : target_latency(context.aria_target_latency),
+        min_batch_size(std::max<std::size_t>(
+            1, std::min(context.aria_min_batch_size, context.batch_size))),
+        max_batch_size(std::max<std::size_t>(1, context.batch_size)),
+        batch_size(max_batch_size) {}
+
+  bool enabled() const { return target_latency > 0; }
+
+  std::size_t get_batch_size() const {
+    return static_cast<std::size_t>(batch_size);
+  }
+
+  // called once an epoch of n transactions is done, n_abort of them aborted,
+  // elapsed is in microseconds
+  void update(std::size_t n, std::size_t n_abort, uint64_t elapsed) {
+    if (n == 0) {
+      return;
+    }
+    double epoch_time_per_txn = 1.0 * std::max<uint64_t>(elapsed, 1) / n;
+    double epoch_abort_ratio = 1.0 * n_abort / n / n;
+    if (n_epochs == 0) {
+      time_per_txn = epoch_time_per_txn;
+      abort_ratio = epoch_abort_ratio;
+    } else {
+      time_per_txn = ALPHA * epoch_time_per_txn + (1 - ALPHA) * time_per_txn;
+      abort_ratio = ALPHA * epoch_abort_ratio + (1 - ALPHA) * abort_ratio;
+    }
+    n_epochs++;
+
+    double target = target_latency / time_per_txn;
+    if (abort_ratio > 0) {
+      target = std::min(target, MAX_ABORT_RATIO / abort_ratio);
+    }
+    batch_size = clamp(batch_size + GAIN * (target - batch_size));
+  }
+
+  // smoothed time per transaction in microseconds
+  double get_time_per_txn() const { return time_per_txn; }
+
+  // the abort ratio of a batch of the current size
+  double get_abort_ratio() const { return abort_ratio * batch_size; }
+
+private:
+  double clamp(double n) const {
+    return std::max<double>(min_batch_size,
+                            std::min<double>(n, max_batch_size));
+  }
+
+private:
+  static constexpr double ALPHA = 0.2, GAIN = 0.5;
+
+  double target_latency;
+  std::size_t min_batch_size, max_batch_size;
+  double batch_size;
+  double time_per_txn = 0, abort_ratio = 0;
+  uint64_t n_epochs = 0;
+};
+
+} // namespace coco
@@ -4,22 +4,55 @@
 
 #pragma once
 
+#include "common/Time.h"
+#include "core/MessageDispatch.h"
 #include "core/Partitioner.h"
 
-#include "common/Percentile.h"
-#include "core/Delay.h"
+#include "common/Futex.h"
+#include "common/Histogram.h"
+#include "core/AccessTrace.h"
+#include "core/CommandLog.h"
+#include "core/NumaPlacement.h"
+#include "core/Timeline.h"
+#include "core/TransactionStream.h"
 #include "core/Worker.h"
+#include "core/WorkStealing.h"
 #include "glog/logging.h"
 
 #include "protocol/Aria/Aria.h"
 #include "protocol/Aria/AriaHelper.h"
 #include "protocol/Aria/AriaMessage.h"
+#include "protocol/Aria/AriaStorage.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <thread>
 
 namespace coco {
 
+/*
+ * With AriaFB, the transactions that abort in the commit phase run again in
+ * the same batch. In the fallback prepare phase, each transaction sends a lock
+ * request for every row it accessed to the master of the row. In the fallback
+ * phase, the workers of a coordinator are lock managers [0,
+ * --ariaFB_lock_manager) and executors. A local row is locked by lock manager
+ * (partition id / coordinator num) % # of lock managers, which grants the
+ * locks in the order of the tids and sends the rows read to the coordinator of
+ * the transaction. An executor runs its transactions in the order of the batch
+ * once all their locks are granted, so there is no deadlock and every
+ * transaction of a batch commits.
+ *
+ * With --aria_generate_ahead, a worker generates the transactions of its
+ * slots of the next batch, see generate_ahead, once it has committed its
+ * transactions of the last one, i.e., while it waits for the other workers
+ * and coordinators to commit theirs and for the next read phase. The read phase
+ * still starts after the commit phase, so it reads the writes of the last
+ * batch, and the reservations are tagged by the epoch, see AriaHelper. Since
+ * the slots of a worker and its random draws stay in the same order, the
+ * batches are the same as without generating ahead.
+ */
+
 template <class Workload> class AriaExecutor : public Worker {
 public:
   using WorkloadType = Workload;
@@ -43,23 +76,28 @@ public:
   AriaExecutor(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
                const ContextType &context,
                std::vector<std::unique_ptr<TransactionType>> &transactions,
-               std::vector<StorageType> &storages, std::atomic<uint32_t> &epoch,
+               AriaStorage<StorageType> &storages,
+               std::vector<std::unique_ptr<TransactionType>> &next_transactions,
+               AriaStorage<StorageType> &next_storages,
+               std::atomic<uint32_t> &epoch,
                std::atomic<uint32_t> &worker_status,
                std::atomic<uint32_t> &total_abort,
+               std::vector<std::vector<AriaLockRequest>> &lock_requests,
                std::atomic<uint32_t> &n_complete_workers,
-               std::atomic<uint32_t> &n_started_workers)
+               std::atomic<uint32_t> &n_started_workers,
+               WorkStealing &work_stealing)
       : Worker(coordinator_id, id), db(db), context(context),
-        transactions(transactions), storages(storages), epoch(epoch),
+        transactions(transactions), storages(storages),
+        next_transactions(next_transactions), next_storages(next_storages),
+        epoch(epoch),
         worker_status(worker_status), total_abort(total_abort),
-        n_complete_workers(n_complete_workers),
-        n_started_workers(n_started_workers),
+        lock_requests(lock_requests), n_complete_workers(n_complete_workers),
+        n_started_workers(n_started_workers), work_stealing(work_stealing),
         partitioner(PartitionerFactory::create_partitioner(
             context.partitioner, coordinator_id, context.coordinator_num)),
         workload(coordinator_id, db, random, *partitioner),
         random(reinterpret_cast<uint64_t>(this)),
-        protocol(db, context, *partitioner),
-        delay(std::make_unique<SameDelay>(
-            coordinator_id, context.coordinator_num, context.delay_time)) {
+        protocol(db, context, *partitioner) {
 
     for (auto i = 0u; i < context.coordinator_num; i++) {
       messages.emplace_back(std::make_unique<Message>());
@@ -67,6 +105,61 @@ public:
     }
 
     messageHandlers = MessageHandlerType::get_message_handlers();
+
+    if (context.protocol == "AriaFB") {
+      n_lock_managers = context.ariaFB_lock_manager;
+      CHECK(n_lock_managers > 0 && n_lock_managers < context.worker_num)
+          << "the fallback needs lock managers and executors.";
+      messageHandlers[static_cast<int>(AriaMessage::FALLBACK_LOCK_REQUEST)] =
+          [this](MessagePiece inputPiece, Message &responseMessage,
+                 ITable &table,
+                 std::vector<std::unique_ptr<TransactionType>> &txns) {
+            MessageHandlerType::fallback_lock_request_handler(
+                inputPiece, responseMessage, table,
+                this->lock_requests[this->id]);
+          };
+    }
+
+    // with --aria_input_replication, the first replica group generates the
+    // batches and ships the inputs of its transactions, see
+    // TransactionStream, to the coordinator of the same rank in each other
+    // group. The other groups run the same batches in lockstep, since the
+    // outcome of a batch only depends on its transactions.
+    group_size = context.coordinator_num;
+    if (context.aria_input_replication) {
+      auto &groups = static_cast<CalvinPartitioner &>(*partitioner);
+      group_size = groups.replica_group_size();
+      if (groups.replica_group_id() == 0) {
+        for (auto g = 1u; g < groups.replica_num(); g++) {
+          input_replicas.push_back(groups.peer(g));
+        }
+      } else {
+        follows_inputs = true;
+      }
+      messageHandlers[static_cast<int>(AriaMessage::INPUT_REQUEST)] =
+          [this](MessagePiece inputPiece, Message &responseMessage,
+                 ITable &table,
+                 std::vector<std::unique_ptr<TransactionType>> &txns) {
+            MessageHandlerType::input_request_handler(
+                inputPiece, responseMessage, table, this->inputs);
+          };
+    }
+
+    if (context.numa) {
+      numa_partitions =
+          NumaPlacement(context).local_partitions(id, *partitioner);
+    }
+    if (context.aria_partition_affinity) {
+      deal_home_partitions();
+    }
+
+    if (!context.trace_path.empty()) {
+      trace = std::make_unique<AccessTrace>(context.trace_path, coordinator_id,
+                                            id, context.trace_rate);
+    }
+    stream = TransactionStream::open(context, coordinator_id, id);
+    workload.set_stream(stream.get());
+    command_log = CommandLog::open(context, coordinator_id, id);
   }
 
   ~AriaExecutor() = default;
@@ -74,45 +167,117 @@ public:
   void start() override {
 
     LOG(INFO) << "AriaExecutor " << id << " started. ";
+    Timeline::set_thread_name(coordinator_id, "executor " + std::to_string(id));
+
+    auto read_or_exit = [](uint32_t s) {
+      return static_cast<ExecutorStatus>(s) == ExecutorStatus::Aria_READ ||
+             static_cast<ExecutorStatus>(s) == ExecutorStatus::EXIT;
+    };
 
     for (;;) {
 
-      ExecutorStatus status;
-      do {
-        status = static_cast<ExecutorStatus>(worker_status.load());
+      if (context.aria_generate_ahead) {
+        Futex::wait_until(worker_status, read_or_exit,
+                          [this]() { return generate_ahead(); });
+      } else {
+        Futex::wait_until(worker_status, read_or_exit);
+      }
 
-        if (status == ExecutorStatus::EXIT) {
-          LOG(INFO) << "AriaExecutor " << id << " exits. ";
-          return;
-        }
-      } while (status != ExecutorStatus::Aria_READ);
+      if (static_cast<ExecutorStatus>(worker_status.load()) ==
+          ExecutorStatus::EXIT) {
+        LOG(INFO) << "AriaExecutor " << id << " exits, stole " << n_stolen
+                  << " transactions.";
+        return;
+      }
 
-      n_started_workers.fetch_add(1);
-      read_snapshot();
-      n_complete_workers.fetch_add(1);
-      // wait to Aria_READ
-      while (static_cast<ExecutorStatus>(worker_status.load()) ==
-             ExecutorStatus::Aria_READ) {
-        process_request();
+      Futex::add_and_wake(n_started_workers, 1);
+      {
+        TimelineSpan span("Aria_READ");
+        read_snapshot();
       }
+      Futex::add_and_wake(n_complete_workers, 1);
+      // wait to Aria_READ
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) != ExecutorStatus::Aria_READ;
+          },
+          [this]() { return process_request(); });
       process_request();
-      n_complete_workers.fetch_add(1);
+      Futex::add_and_wake(n_complete_workers, 1);
 
       // wait till Aria_COMMIT
-      while (static_cast<ExecutorStatus>(worker_status.load()) !=
-             ExecutorStatus::Aria_COMMIT) {
-        std::this_thread::yield();
+      Futex::wait_until(worker_status, [](uint32_t s) {
+        return static_cast<ExecutorStatus>(s) == ExecutorStatus::Aria_COMMIT;
+      });
+      Futex::add_and_wake(n_started_workers, 1);
+      {
+        TimelineSpan span("Aria_COMMIT");
+        commit_transactions();
       }
-      n_started_workers.fetch_add(1);
-      commit_transactions();
-      n_complete_workers.fetch_add(1);
+      Futex::add_and_wake(n_complete_workers, 1);
       // wait to Aria_COMMIT
-      while (static_cast<ExecutorStatus>(worker_status.load()) ==
-             ExecutorStatus::Aria_COMMIT) {
-        process_request();
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) !=
+                   ExecutorStatus::Aria_COMMIT;
+          },
+          [this]() { return process_request() + generate_ahead(); });
+      process_request();
+      Futex::add_and_wake(n_complete_workers, 1);
+
+      if (n_lock_managers == 0) {
+        continue;
+      }
+
+      // wait till AriaFB_Fallback_Prepare
+      Futex::wait_until(worker_status, [](uint32_t s) {
+        return static_cast<ExecutorStatus>(s) ==
+               ExecutorStatus::AriaFB_Fallback_Prepare;
+      });
+      Futex::add_and_wake(n_started_workers, 1);
+      {
+        TimelineSpan span("AriaFB_Fallback_Prepare");
+        prepare_fallback();
       }
+      Futex::add_and_wake(n_complete_workers, 1);
+      // wait to AriaFB_Fallback_Prepare
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) !=
+                   ExecutorStatus::AriaFB_Fallback_Prepare;
+          },
+          [this]() { return process_request(); });
       process_request();
-      n_complete_workers.fetch_add(1);
+      Futex::add_and_wake(n_complete_workers, 1);
+
+      // wait till AriaFB_Fallback
+      Futex::wait_until(worker_status, [](uint32_t s) {
+        return static_cast<ExecutorStatus>(s) ==
+               ExecutorStatus::AriaFB_Fallback;
+      });
+      Futex::add_and_wake(n_started_workers, 1);
+      {
+        TimelineSpan span("AriaFB_Fallback");
+        if (id < n_lock_managers) {
+          grant_locks();
+        } else {
+          run_fallback();
+        }
+      }
+      Futex::add_and_wake(n_complete_workers, 1);
+      // wait to AriaFB_Fallback
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) !=
+                   ExecutorStatus::AriaFB_Fallback;
+          },
+          [this]() { return process_request(); });
+      process_request();
+      Futex::add_and_wake(n_complete_workers, 1);
     }
   }
 
@@ -120,31 +285,101 @@ public:
 
     std::size_t partition_id;
 
-    CHECK(context.partition_num % context.coordinator_num == 0);
+    // with --aria_partition_affinity, only the home partitions of this worker
+    if (!home_partitions.empty()) {
+      return home_partitions[random.uniform_dist(0,
+                                                 home_partitions.size() - 1)];
+    }
+
+    // with --numa, only the partitions on the node of this worker
+    if (!numa_partitions.empty()) {
+      partition_id =
+          numa_partitions[random.uniform_dist(0, numa_partitions.size() - 1)];
+      CHECK(partitioner->has_master_partition(partition_id));
+      return partition_id;
+    }
+
+    CHECK(context.partition_num % group_size == 0);
 
-    auto partition_num_per_node =
-        context.partition_num / context.coordinator_num;
-    partition_id = random.uniform_dist(0, partition_num_per_node - 1) *
-                       context.coordinator_num +
-                   coordinator_id;
+    auto partition_num_per_node = context.partition_num / group_size;
+    partition_id =
+        random.uniform_dist(0, partition_num_per_node - 1) * group_size +
+        coordinator_id;
     CHECK(partitioner->has_master_partition(partition_id));
     return partition_id;
   }
 
+  // the local partitions, or the ones on the node of this worker with --numa,
+  // are dealt to the workers, so the slots of a worker hold the transactions
+  // of its home partitions. If there are fewer partitions than workers, the
+  // workers share them.
+  void deal_home_partitions() {
+    std::vector<std::size_t> partitions;
+    std::size_t rank = id, n_workers = context.worker_num;
+    if (context.numa) {
+      NumaPlacement placement(context);
+      partitions = numa_partitions;
+      rank = n_workers = 0;
+      for (auto i = 0u; i < context.worker_num; i++) {
+        if (placement.worker_node(i) == placement.worker_node(id)) {
+          rank += i < id;
+          n_workers++;
+        }
+      }
+    } else {
+      for (auto i = 0u; i < context.partition_num; i++) {
+        if (partitioner->has_master_partition(i)) {
+          partitions.push_back(i);
+        }
+      }
+    }
+
+    if (partitions.empty()) {
+      return;
+    }
+    if (partitions.size() < n_workers) {
+      home_partitions.push_back(partitions[rank % partitions.size()]);
+      return;
+    }
+    for (auto k = rank; k < partitions.size(); k += n_workers) {
+      home_partitions.push_back(partitions[k]);
+    }
+  }
+
   void read_snapshot() {
     // load epoch
     auto cur_epoch = epoch.load();
     auto n_abort = total_abort.load();
     std::size_t count = 0;
-    for (auto i = id; i < transactions.size(); i += context.worker_num) {
+    claimed.clear();
+    ahead = WorkStealing::NONE;
+    if (command_log != nullptr) {
+      command_log->begin_batch(transactions.size());
+    }
+    for (auto i = first_transaction(); i != WorkStealing::NONE;
+         i = next_transaction(i)) {
 
       process_request();
+      claimed.push_back(i);
 
       // if null, generate a new transaction, on this node.
       // else only reset the query
 
-      if (transactions[i] == nullptr || i >= n_abort) {
-        auto partition_id = get_partition_id();
+      if (context.aria_generate_ahead) {
+        // generated ahead while the last batch committed, or now
+        if (next_transactions[i] == nullptr) {
+          generate_ahead(i);
+        }
+        transactions[i] = std::move(next_transactions[i]);
+        storages.swap(i, next_storages);
+      } else if (transactions[i] == nullptr || i >= n_abort) {
+        auto partition_id =
+            follows_inputs ? next_input(i) : get_partition_id();
+        if (command_log != nullptr) {
+          std::size_t hot_row = 0;
+          command_log->next(i, random, partition_id, hot_row);
+        }
+        replicate_input(i, partition_id);
         transactions[i] =
             workload.next_transaction(context, partition_id, storages[i]);
       } else {
@@ -162,7 +397,7 @@ public:
 
       // run transactions
       auto result = transactions[i]->execute(id);
-      n_network_size.fetch_add(transactions[i]->network_size);
+      stats.add(WorkerStats::NETWORK_SIZE, transactions[i]->network_size);
       if (result == TransactionResult::ABORT_NORETRY) {
         transactions[i]->abort_no_retry = true;
       }
@@ -172,10 +407,13 @@ public:
       }
     }
     flush_messages();
+    if (command_log != nullptr) {
+      command_log->end_batch();
+    }
 
     // reserve
     count = 0;
-    for (auto i = id; i < transactions.size(); i += context.worker_num) {
+    for (auto i : claimed) {
 
       if (transactions[i]->abort_no_retry) {
         continue;
@@ -201,14 +439,82 @@ public:
     flush_messages();
   }
 
+  // generates transaction i of the next batch, see --aria_generate_ahead
+  void generate_ahead(std::size_t i) {
+    auto partition_id = get_partition_id();
+    next_transactions[i] =
+        workload.next_transaction(context, partition_id, next_storages[i]);
+  }
+
+  // generates the next transaction of the next batch, returns 1 if there was
+  // one left
+  std::size_t generate_ahead() {
+    if (ahead == WorkStealing::NONE) {
+      return 0;
+    }
+    generate_ahead(ahead);
+    ahead = next_transaction(ahead);
+    return 1;
+  }
+
+  // the replicas generate transaction i the same way, see
+  // --aria_input_replication
+  void replicate_input(std::size_t i, std::size_t partition_id) {
+    if (input_replicas.empty()) {
+      return;
+    }
+    TransactionStreamEntry entry{random.get_seed(),
+                                 static_cast<uint32_t>(partition_id), 0};
+    auto table = db.find_table(0, partition_id);
+    for (auto replica : input_replicas) {
+      stats.add(WorkerStats::NETWORK_SIZE,
+                MessageFactoryType::new_input_message(*messages[replica],
+                                                      *table, i, entry));
+    }
+  }
+
+  // waits for the input of transaction i from the first replica group,
+  // returns its partition
+  std::size_t next_input(std::size_t i) {
+    auto it = inputs.find(i);
+    while (it == inputs.end()) {
+      process_request();
+      it = inputs.find(i);
+    }
+    random.set_seed(it->second.seed);
+    std::size_t partition_id = it->second.partition_id;
+    inputs.erase(it);
+    return partition_id;
+  }
+
+  // the transactions of a phase are id, id + worker_num, ..., and with
+  // --work_stealing, the ones this worker steals, see WorkStealing
+  std::size_t first_transaction() {
+    if (!context.work_stealing) {
+      return id < transactions.size() ? id : WorkStealing::NONE;
+    }
+    work_stealing.reset(id, transactions.size());
+    return next_transaction(WorkStealing::NONE);
+  }
+
+  std::size_t next_transaction(std::size_t i) {
+    if (!context.work_stealing) {
+      i += context.worker_num;
+      return i < transactions.size() ? i : WorkStealing::NONE;
+    }
+    i = work_stealing.next(id);
+    n_stolen += i != WorkStealing::NONE && i % context.worker_num != id;
+    return i;
+  }
+
   void reserve_transaction(TransactionType &txn) {
 
     if (context.aria_read_only_optmization && txn.is_read_only()) {
       return;
     }
 
-    std::vector<AriaRWKey> &readSet = txn.readSet;
-    std::vector<AriaRWKey> &writeSet = txn.writeSet;
+    auto &readSet = txn.readSet;
+    auto &writeSet = txn.writeSet;
 
     // reserve reads;
     for (std::size_t i = 0u; i < readSet.size(); i++) {
@@ -257,8 +563,8 @@ public:
       return;
     }
 
-    const std::vector<AriaRWKey> &readSet = txn.readSet;
-    const std::vector<AriaRWKey> &writeSet = txn.writeSet;
+    const auto &readSet = txn.readSet;
+    const auto &writeSet = txn.writeSet;
 
     // analyze raw
 
@@ -279,13 +585,14 @@ public:
         DCHECK(epoch == txn.epoch);
         if (epoch == txn.epoch && wts < txn.id && wts != 0) {
           txn.raw = true;
+          txn.set_conflict(readKey);
           break;
         }
       } else {
         auto coordinatorID = this->partitioner->master_coordinator(partitionId);
         txn.network_size += MessageFactoryType::new_check_message(
             *(this->messages[coordinatorID]), *table, txn.id, txn.tid_offset,
-            readKey.get_key(), txn.epoch, false);
+            readKey.get_key(), txn.epoch, false, i);
         txn.pendingResponses++;
       }
     }
@@ -310,12 +617,13 @@ public:
         }
         if (epoch == txn.epoch && wts < txn.id && wts != 0) {
           txn.waw = true;
+          txn.set_conflict(writeKey);
         }
       } else {
         auto coordinatorID = this->partitioner->master_coordinator(partitionId);
         txn.network_size += MessageFactoryType::new_check_message(
             *(this->messages[coordinatorID]), *table, txn.id, txn.tid_offset,
-            writeKey.get_key(), txn.epoch, true);
+            writeKey.get_key(), txn.epoch, true, i);
         txn.pendingResponses++;
       }
     }
@@ -323,7 +631,10 @@ public:
 
   void commit_transactions() {
     std::size_t count = 0;
-    for (auto i = id; i < transactions.size(); i += context.worker_num) {
+    claimed.clear();
+    for (auto i = first_transaction(); i != WorkStealing::NONE;
+         i = next_transaction(i)) {
+      claimed.push_back(i);
       if (transactions[i]->abort_no_retry) {
         continue;
       }
@@ -338,9 +649,12 @@ public:
     flush_messages();
 
     count = 0;
-    for (auto i = id; i < transactions.size(); i += context.worker_num) {
+    for (auto i : claimed) {
       if (transactions[i]->abort_no_retry) {
-        n_abort_no_retry.fetch_add(1);
+        stats.add(WorkerStats::ABORT_NO_RETRY);
+        record_abort(transactions[i]->procedure_id,
+                     &ProcedureStatistics::n_abort_no_retry);
+        trace_access(*transactions[i], AccessOutcome::ABORT_NO_RETRY);
         continue;
       }
       count++;
@@ -352,57 +666,62 @@ public:
 
       if (context.aria_read_only_optmization &&
           transactions[i]->is_read_only()) {
-        n_commit.fetch_add(1);
+        stats.add(WorkerStats::COMMIT);
+        trace_access(*transactions[i], AccessOutcome::COMMIT);
         auto latency =
             std::chrono::duration_cast<std::chrono::microseconds>(
-                std::chrono::steady_clock::now() - transactions[i]->startTime)
+                Clock::now() - transactions[i]->startTime)
                 .count();
         percentile.add(latency);
+        record_latency(latency, transactions[i]->procedure_id);
         continue;
       }
 
       if (transactions[i]->waw) {
-        protocol.abort(*transactions[i], messages);
-        n_abort_lock.fetch_add(1);
+        abort(*transactions[i]);
         continue;
       }
 
       if (context.aria_snapshot_isolation) {
         protocol.commit(*transactions[i], messages);
-        n_commit.fetch_add(1);
+        stats.add(WorkerStats::COMMIT);
+        trace_access(*transactions[i], AccessOutcome::COMMIT);
         auto latency =
             std::chrono::duration_cast<std::chrono::microseconds>(
-                std::chrono::steady_clock::now() - transactions[i]->startTime)
+                Clock::now() - transactions[i]->startTime)
                 .count();
         percentile.add(latency);
+        record_latency(latency, transactions[i]->procedure_id);
       } else {
         if (context.aria_reordering_optmization) {
           if (transactions[i]->war == false || transactions[i]->raw == false) {
             protocol.commit(*transactions[i], messages);
-            n_commit.fetch_add(1);
+            stats.add(WorkerStats::COMMIT);
+            trace_access(*transactions[i], AccessOutcome::COMMIT);
             auto latency =
                 std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::steady_clock::now() -
+                    Clock::now() -
                     transactions[i]->startTime)
                     .count();
             percentile.add(latency);
+            record_latency(latency, transactions[i]->procedure_id);
           } else {
-            n_abort_lock.fetch_add(1);
-            protocol.abort(*transactions[i], messages);
+            abort(*transactions[i]);
           }
         } else {
           if (transactions[i]->raw) {
-            n_abort_lock.fetch_add(1);
-            protocol.abort(*transactions[i], messages);
+            abort(*transactions[i]);
           } else {
             protocol.commit(*transactions[i], messages);
-            n_commit.fetch_add(1);
+            stats.add(WorkerStats::COMMIT);
+            trace_access(*transactions[i], AccessOutcome::COMMIT);
             auto latency =
                 std::chrono::duration_cast<std::chrono::microseconds>(
-                    std::chrono::steady_clock::now() -
+                    Clock::now() -
                     transactions[i]->startTime)
                     .count();
             percentile.add(latency);
+            record_latency(latency, transactions[i]->procedure_id);
           }
         }
       }
@@ -412,6 +731,250 @@ public:
       }
     }
     flush_messages();
+
+    // the batch is released once its inputs are durable
+    if (command_log != nullptr) {
+      command_log->sync();
+    }
+
+    if (context.aria_generate_ahead) {
+      ahead = first_transaction();
+    }
+  }
+
+  // with --trace_path, samples the rows txn accessed, see AccessTrace
+  void trace_access(TransactionType &txn, AccessOutcome outcome) {
+    if (trace != nullptr) {
+      trace->trace(db, txn, outcome);
+    }
+  }
+
+  // with --conflict_profile, counts the row that aborted txn
+  void record_conflict(TransactionType &txn, bool lock) {
+    if (context.conflict_profile > 0 && txn.conflict_key != nullptr) {
+      auto table = db.find_table(txn.conflict_table_id,
+                                 txn.conflict_partition_id);
+      conflicts.record(*table, txn.conflict_key, lock);
+    }
+  }
+
+  void abort(TransactionType &txn) {
+    stats.add(WorkerStats::ABORT_LOCK);
+    record_abort(txn.procedure_id, &ProcedureStatistics::n_abort_lock);
+    trace_access(txn, AccessOutcome::ABORT_LOCK);
+    // a write-after-write is a lock conflict, a read-after-write a validation
+    record_conflict(txn, txn.waw);
+    protocol.abort(txn, messages);
+    txn.aborted = true;
+    // the transaction runs again in the fallback of this batch
+    txn.abort_lock = n_lock_managers > 0;
+  }
+
+  void prepare_fallback() {
+    // no lock request is processed before
+    lock_requests[id].clear();
+
+    std::size_t count = 0;
+    for (auto i = id; i < transactions.size(); i += context.worker_num) {
+      auto &txn = *transactions[i];
+      if (!txn.abort_lock) {
+        continue;
+      }
+
+      count++;
+      prepare_fallback_keys(txn);
+
+      for (auto &fallbackKey : txn.fallbackKeys) {
+        auto table =
+            db.find_table(fallbackKey.table_id, fallbackKey.partition_id);
+        if (partitioner->has_master_partition(fallbackKey.partition_id)) {
+          auto row = table->search(fallbackKey.key);
+          lock_requests[id].push_back(
+              {static_cast<uint32_t>(txn.id), coordinator_id,
+               static_cast<uint32_t>(txn.tid_offset), fallbackKey.key_offset,
+               fallbackKey.write_lock, std::get<0>(row), table,
+               std::get<1>(row)});
+        } else {
+          auto coordinatorID =
+              partitioner->master_coordinator(fallbackKey.partition_id);
+          txn.network_size += MessageFactoryType::new_fallback_lock_message(
+              *messages[coordinatorID], *table, fallbackKey.key,
+              static_cast<uint32_t>(txn.id),
+              static_cast<uint32_t>(txn.tid_offset), fallbackKey.key_offset,
+              fallbackKey.write_lock);
+        }
+      }
+
+      if (count % context.batch_flush == 0) {
+        flush_messages();
+      }
+    }
+    flush_messages();
+  }
+
+  // each row is locked once, with a write lock if it is written
+  void prepare_fallback_keys(TransactionType &txn) {
+    txn.fallbackKeys.clear();
+    txn.n_granted.store(0);
+
+    auto add_key = [this, &txn](const AriaRWKey &key, uint32_t key_offset,
+                                bool write_lock) {
+      auto table = db.find_table(key.get_table_id(), key.get_partition_id());
+      for (auto &fallbackKey : txn.fallbackKeys) {
+        if (fallbackKey.table_id == key.get_table_id() &&
+            fallbackKey.partition_id == key.get_partition_id() &&
+            std::memcmp(fallbackKey.key, key.get_key(), table->key_size()) ==
+                0) {
+          fallbackKey.write_lock |= write_lock;
+          if (fallbackKey.key_offset == AriaLockRequest::NO_READ) {
+            fallbackKey.key_offset = key_offset;
+          }
+          return;
+        }
+      }
+      txn.fallbackKeys.push_back({key.get_table_id(), key.get_partition_id(),
+                                  key.get_key(), key_offset, write_lock});
+    };
+
+    for (auto k = 0u; k < txn.readSet.size(); k++) {
+      if (!txn.readSet[k].get_local_index_read_bit()) {
+        add_key(txn.readSet[k], k, false);
+      }
+    }
+
+    for (auto &writeKey : txn.writeSet) {
+      add_key(writeKey, AriaLockRequest::NO_READ, true);
+    }
+  }
+
+  std::size_t lock_manager_id(std::size_t partition_id) const {
+    return partition_id / context.coordinator_num % n_lock_managers;
+  }
+
+  void grant_locks() {
+    std::vector<AriaLockRequest> requests;
+    for (auto &worker_requests : lock_requests) {
+      for (auto &request : worker_requests) {
+        if (lock_manager_id(request.table->partitionID()) == id) {
+          requests.push_back(request);
+        }
+      }
+    }
+    std::sort(requests.begin(), requests.end(),
+              [](const AriaLockRequest &a, const AriaLockRequest &b) {
+                return a.tid < b.tid;
+              });
+
+    for (auto &request : requests) {
+      request.lock->store(0);
+    }
+
+    std::size_t count = 0;
+    for (auto &request : requests) {
+      while (!(request.write_lock ? AriaHelper::write_lock(*request.lock)
+                                  : AriaHelper::read_lock(*request.lock))) {
+        flush_messages();
+        process_request();
+      }
+
+      if (request.coordinator_id == coordinator_id) {
+        transactions[request.tid_offset]->n_granted.fetch_add(
+            1, std::memory_order_release);
+        continue;
+      }
+
+      stats.add(WorkerStats::NETWORK_SIZE,
+                MessageFactoryType::new_fallback_grant_message(
+                    *messages[request.coordinator_id], *request.table,
+                    request));
+      if (++count % context.batch_flush == 0) {
+        flush_messages();
+      }
+    }
+    flush_messages();
+  }
+
+  void run_fallback() {
+    auto n_executors = context.worker_num - n_lock_managers;
+    for (auto i = id - n_lock_managers; i < transactions.size();
+         i += n_executors) {
+      auto &txn = *transactions[i];
+      if (!txn.abort_lock) {
+        continue;
+      }
+
+      // wait till all locks are granted
+      while (txn.n_granted.load(std::memory_order_acquire) <
+             txn.fallbackKeys.size()) {
+        process_request();
+      }
+
+      read_fallback_rows(txn);
+      txn.execution_phase = true;
+      txn.execute(id);
+      protocol.commit(txn, messages);
+      release_fallback_locks(txn);
+      flush_messages();
+
+      txn.abort_lock = false;
+      stats.add(WorkerStats::NETWORK_SIZE, txn.network_size);
+      stats.add(WorkerStats::COMMIT);
+      trace_access(txn, AccessOutcome::COMMIT);
+      auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                         Clock::now() - txn.startTime)
+                         .count();
+      percentile.add(latency);
+      record_latency(latency, txn.procedure_id);
+    }
+  }
+
+  // remote rows are sent with the locks, each once
+  void read_fallback_rows(TransactionType &txn) {
+    for (auto k = 0u; k < txn.readSet.size(); k++) {
+      auto &readKey = txn.readSet[k];
+      auto table =
+          db.find_table(readKey.get_table_id(), readKey.get_partition_id());
+
+      if (readKey.get_local_index_read_bit() ||
+          partitioner->has_master_partition(readKey.get_partition_id())) {
+        AriaHelper::read(table->search(readKey.get_key()), readKey.get_value(),
+                         table->value_size());
+        continue;
+      }
+
+      for (auto j = 0u; j < k; j++) {
+        auto &key = txn.readSet[j];
+        if (key.get_table_id() == readKey.get_table_id() &&
+            key.get_partition_id() == readKey.get_partition_id() &&
+            std::memcmp(key.get_key(), readKey.get_key(), table->key_size()) ==
+                0) {
+          std::memcpy(readKey.get_value(), key.get_value(),
+                      table->value_size());
+          break;
+        }
+      }
+    }
+  }
+
+  void release_fallback_locks(TransactionType &txn) {
+    for (auto &fallbackKey : txn.fallbackKeys) {
+      auto table =
+          db.find_table(fallbackKey.table_id, fallbackKey.partition_id);
+      if (partitioner->has_master_partition(fallbackKey.partition_id)) {
+        auto &lock = table->search_metadata(fallbackKey.key);
+        if (fallbackKey.write_lock) {
+          AriaHelper::write_lock_release(lock);
+        } else {
+          AriaHelper::read_lock_release(lock);
+        }
+      } else {
+        auto coordinatorID =
+            partitioner->master_coordinator(fallbackKey.partition_id);
+        txn.network_size += MessageFactoryType::new_fallback_release_message(
+            *messages[coordinatorID], *table, fallbackKey.key,
+            fallbackKey.write_lock);
+      }
+    }
   }
 
   void setupHandlers(TransactionType &txn) {
@@ -430,13 +993,16 @@ public:
         local_read = true;
       }
 
-      ITable *table = db.find_table(table_id, partition_id);
       if (local_read || local_index_read) {
         // set tid meta_data
-        auto row = table->search(key);
-        AriaHelper::set_key_tid(readKey, row);
-        AriaHelper::read(row, value, table->value_size());
+        db.visit_table(table_id, partition_id,
+                       [&readKey, key, value](auto &table) {
+                         auto row = table.search(key);
+                         AriaHelper::set_key_tid(readKey, row);
+                         AriaHelper::read(row, value, table.value_size());
+                       });
       } else {
+        ITable *table = db.find_table(table_id, partition_id);
         auto coordinatorID =
             this->partitioner->master_coordinator(partition_id);
         txn.network_size += MessageFactoryType::new_search_message(
@@ -456,6 +1022,16 @@ public:
               << " us (50%) " << percentile.nth(75) << " us (75%) "
               << percentile.nth(95) << " us (95%) " << percentile.nth(99)
               << " us (99%).";
+
+    if (trace != nullptr) {
+      trace->close();
+    }
+    if (stream != nullptr) {
+      stream->close();
+    }
+    if (command_log != nullptr) {
+      command_log->close();
+    }
   }
 
   void push_message(Message *message) override { in_queue.push(message); }
@@ -466,15 +1042,6 @@ public:
 
     Message *message = out_queue.front();
 
-    if (delay->delay_enabled()) {
-      auto now = std::chrono::steady_clock::now();
-      if (std::chrono::duration_cast<std::chrono::microseconds>(now -
-                                                                message->time)
-              .count() < delay->message_delay()) {
-        return nullptr;
-      }
-    }
-
     bool ok = out_queue.pop();
     CHECK(ok);
 
@@ -494,8 +1061,8 @@ public:
 
       auto message = messages[i].release();
 
-      out_queue.push(message);
-      messages[i] = std::make_unique<Message>();
+      push_outgoing(out_queue, message);
+      messages[i].reset(outgoing_message_pool.get());
       init_message(messages[i].get(), i);
     }
   }
@@ -509,25 +1076,31 @@ public:
   std::size_t process_request() {
 
     std::size_t size = 0;
+    if (!dispatch.is_bound()) {
+      dispatch.bind(messageHandlers);
+      dispatch.prefetch_keys(MessageHandlerType::get_keyed_messages(),
+                             context.prefetch_distance);
+    }
 
     while (!in_queue.empty()) {
       std::unique_ptr<Message> message(in_queue.front());
       bool ok = in_queue.pop();
       CHECK(ok);
 
+      dispatch.begin(db, *message);
       for (auto it = message->begin(); it != message->end(); it++) {
 
+        dispatch.next(db);
         MessagePiece messagePiece = *it;
         auto type = messagePiece.get_message_type();
         DCHECK(type < messageHandlers.size());
-        ITable *table = db.find_table(messagePiece.get_table_id(),
-                                      messagePiece.get_partition_id());
-        messageHandlers[type](messagePiece,
-                              *messages[message->get_source_node_id()], *table,
-                              transactions);
+        ITable *table = dispatch.table(db, messagePiece);
+        dispatch(type, messagePiece, *messages[message->get_source_node_id()],
+                 *table, transactions);
       }
 
       size += message->get_message_count();
+      incoming_message_pool.put(message.release());
       flush_messages();
     }
     return size;
@@ -537,20 +1110,41 @@ private:
   DatabaseType &db;
   const ContextType &context;
   std::vector<std::unique_ptr<TransactionType>> &transactions;
-  std::vector<StorageType> &storages;
+  AriaStorage<StorageType> &storages;
+  std::vector<std::unique_ptr<TransactionType>> &next_transactions;
+  AriaStorage<StorageType> &next_storages;
   std::atomic<uint32_t> &epoch, &worker_status, &total_abort;
+  std::vector<std::vector<AriaLockRequest>> &lock_requests;
   std::atomic<uint32_t> &n_complete_workers, &n_started_workers;
+  WorkStealing &work_stealing;
+  // the transactions this worker runs in a phase
+  std::vector<std::size_t> claimed;
+  std::size_t n_stolen = 0;
+  // the next slot of the next batch to generate ahead, see
+  // --aria_generate_ahead
+  std::size_t ahead = WorkStealing::NONE;
   std::unique_ptr<Partitioner> partitioner;
+  std::vector<std::size_t> numa_partitions, home_partitions;
+  // the coordinators the inputs are shipped to, and the inputs received
+  std::vector<std::size_t> input_replicas;
+  std::unordered_map<uint32_t, TransactionStreamEntry> inputs;
+  bool follows_inputs = false;
+  // the coordinators that hold a copy of the database
+  std::size_t group_size;
   WorkloadType workload;
   RandomType random;
   ProtocolType protocol;
-  std::unique_ptr<Delay> delay;
-  Percentile<int64_t> percentile;
+  Histogram percentile;
+  std::unique_ptr<AccessTrace> trace;
+  std::unique_ptr<TransactionStream> stream;
+  std::unique_ptr<CommandLog> command_log;
+  std::size_t n_lock_managers = 0;
   std::vector<std::unique_ptr<Message>> messages;
   std::vector<
       std::function<void(MessagePiece, Message &, ITable &,
                          std::vector<std::unique_ptr<TransactionType>> &)>>
       messageHandlers;
+  MessageDispatch<std::vector<std::unique_ptr<TransactionType>> &> dispatch;
   LockfreeQueue<Message *> in_queue, out_queue;
 };
 } // namespace coco
\ No newline at end of file
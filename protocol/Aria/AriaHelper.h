@@ -15,6 +15,22 @@
 
 namespace coco {
 
+// a lock on a local row in the fallback, see AriaExecutor
+struct AriaLockRequest {
+  static constexpr uint32_t NO_READ = 0xffffffff;
+
+  uint32_t tid;
+  // the coordinator of the transaction and its offset in the batch
+  std::size_t coordinator_id;
+  uint32_t tid_offset;
+  // the offset of the first read of the row in the read set, or NO_READ
+  uint32_t key_offset;
+  bool write_lock;
+  std::atomic<uint64_t> *lock;
+  ITable *table;
+  void *value;
+};
+
 class AriaHelper {
 
 public:
@@ -120,6 +136,50 @@ public:
     return (value & (~(WTS_MASK << WTS_OFFSET))) | (wts << WTS_OFFSET);
   }
 
+  /*
+   * In the fallback, the reservations of the batch are no longer read, so a
+   * lock manager clears the metadata of a row and locks it with
+   * [write lock bit (1) | read lock bits (9) -- 512 - 1 locks | unused (54)]
+   */
+
+  static bool is_read_locked(uint64_t value) {
+    return value & (READ_LOCK_BIT_MASK << READ_LOCK_BIT_OFFSET);
+  }
+
+  static bool is_write_locked(uint64_t value) {
+    return value & (WRITE_LOCK_BIT_MASK << WRITE_LOCK_BIT_OFFSET);
+  }
+
+  static bool read_lock(std::atomic<uint64_t> &a) {
+    uint64_t old_value = a.load();
+    if (is_write_locked(old_value) ||
+        ((old_value >> READ_LOCK_BIT_OFFSET) & READ_LOCK_BIT_MASK) ==
+            READ_LOCK_BIT_MASK) {
+      return false;
+    }
+    return a.compare_exchange_strong(
+        old_value, old_value + (1ull << READ_LOCK_BIT_OFFSET));
+  }
+
+  static bool write_lock(std::atomic<uint64_t> &a) {
+    uint64_t old_value = a.load();
+    if (is_read_locked(old_value) || is_write_locked(old_value)) {
+      return false;
+    }
+    return a.compare_exchange_strong(
+        old_value, old_value + (WRITE_LOCK_BIT_MASK << WRITE_LOCK_BIT_OFFSET));
+  }
+
+  static void read_lock_release(std::atomic<uint64_t> &a) {
+    DCHECK(is_read_locked(a.load()));
+    a.fetch_sub(1ull << READ_LOCK_BIT_OFFSET);
+  }
+
+  static void write_lock_release(std::atomic<uint64_t> &a) {
+    DCHECK(is_write_locked(a.load()));
+    a.fetch_sub(WRITE_LOCK_BIT_MASK << WRITE_LOCK_BIT_OFFSET);
+  }
+
 public:
   /*
    * [epoch (24) | read-rts  (20) | write-wts (20)]
@@ -134,6 +194,12 @@ public:
 
   static constexpr int WTS_OFFSET = 0;
   static constexpr uint64_t WTS_MASK = 0xfffffull;
+
+  static constexpr int READ_LOCK_BIT_OFFSET = 54;
+  static constexpr uint64_t READ_LOCK_BIT_MASK = 0x1ffull;
+
+  static constexpr int WRITE_LOCK_BIT_OFFSET = 63;
+  static constexpr uint64_t WRITE_LOCK_BIT_MASK = 0x1ull;
 };
 
 } // namespace coco
\ No newline at end of file
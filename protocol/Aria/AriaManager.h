@@ -6,12 +6,16 @@
 
 #include "core/Manager.h"
 #include "core/Partitioner.h"
+#include "core/WorkStealing.h"
 #include "protocol/Aria/Aria.h"
+#include "protocol/Aria/AriaBatchController.h"
 #include "protocol/Aria/AriaExecutor.h"
 #include "protocol/Aria/AriaHelper.h"
+#include "protocol/Aria/AriaStorage.h"
 #include "protocol/Aria/AriaTransaction.h"
 
 #include <atomic>
+#include <chrono>
 #include <thread>
 #include <vector>
 
@@ -34,10 +38,17 @@ public:
 
   AriaManager(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
               const ContextType &context, std::atomic<bool> &stopFlag)
-      : base_type(coordinator_id, id, context, stopFlag), db(db), epoch(0) {
+      : base_type(coordinator_id, id, context, stopFlag), db(db), epoch(0),
+        work_stealing(context.worker_num), batch_controller(context) {
 
-    storages.resize(context.batch_size);
-    transactions.resize(context.batch_size);
+    transactions.reserve(context.batch_size);
+    transactions.resize(batch_controller.get_batch_size());
+    storages.resize(transactions.size());
+    lock_requests.resize(context.worker_num);
+    if (context.aria_generate_ahead) {
+      next_transactions.resize(transactions.size());
+      next_storages.resize(transactions.size());
+    }
   }
 
   void coordinator_start() override {
@@ -82,9 +93,42 @@ public:
       wait_all_workers_finish();
       // wait for all machines until they finish the Aria_COMMIT phase.
       wait4_ack();
+
+      if (context.protocol != "AriaFB") {
+        continue;
+      }
+
+      // the aborted transactions send their lock requests
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      signal_worker(ExecutorStatus::AriaFB_Fallback_Prepare);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      // wait for all machines until they finish the fallback prepare phase.
+      wait4_ack();
+
+      // the aborted transactions run under the lock managers
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      signal_worker(ExecutorStatus::AriaFB_Fallback);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      // wait for all machines until they finish the fallback phase.
+      wait4_ack();
     }
 
     signal_worker(ExecutorStatus::EXIT);
+    log_batch_size();
   }
 
   void non_coordinator_start() override {
@@ -97,6 +141,7 @@ public:
       ExecutorStatus status = wait4_signal();
       if (status == ExecutorStatus::EXIT) {
         set_worker_status(ExecutorStatus::EXIT);
+        log_batch_size();
         break;
       }
 
@@ -133,28 +178,99 @@ public:
       set_worker_status(ExecutorStatus::STOP);
       wait_all_workers_finish();
       send_ack();
+
+      if (context.protocol != "AriaFB") {
+        continue;
+      }
+
+      status = wait4_signal();
+      DCHECK(status == ExecutorStatus::AriaFB_Fallback_Prepare);
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::AriaFB_Fallback_Prepare);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      send_ack();
+
+      status = wait4_signal();
+      DCHECK(status == ExecutorStatus::AriaFB_Fallback);
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::AriaFB_Fallback);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      send_ack();
     }
   }
 
   void cleanup_batch() {
-    std::size_t it = 0;
+    std::size_t it = 0, n_abort = 0;
     for (auto i = 0u; i < transactions.size(); i++) {
       if (transactions[i] == nullptr) {
         break;
       }
+      n_abort += transactions[i]->aborted;
       if (transactions[i]->abort_lock) {
+        storages.swap(it, i);
         transactions[it++].swap(transactions[i]);
       }
     }
     total_abort.store(it);
+    resize_batch(n_abort, it);
+  }
+
+  // with --aria_target_latency, each coordinator sizes its own next batch
+  // after the time and the aborts of the last one. The n_retry transactions
+  // moved to the front are rerun, so the batch never drops below n_retry.
+  void resize_batch(std::size_t n_abort, std::size_t n_retry) {
+    if (!batch_controller.enabled()) {
+      return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (epoch.load() > 1) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                         now - epoch_start)
+                         .count();
+      batch_controller.update(transactions.size(), n_abort, elapsed);
+    }
+    epoch_start = now;
+    transactions.resize(std::max(batch_controller.get_batch_size(), n_retry));
+    storages.resize(transactions.size());
+  }
+
+  void log_batch_size() {
+    if (batch_controller.enabled()) {
+      LOG(INFO) << "Aria batch size: " << batch_controller.get_batch_size()
+                << ", time per txn: " << batch_controller.get_time_per_txn()
+                << " us, abort ratio: " << batch_controller.get_abort_ratio();
+    }
   }
 
 public:
   RandomType random;
   DatabaseType &db;
   std::atomic<uint32_t> epoch;
-  std::vector<StorageType> storages;
+  AriaStorage<StorageType> storages;
   std::vector<std::unique_ptr<TransactionType>> transactions;
+  // the next batch generated ahead with --aria_generate_ahead, see AriaExecutor
+  AriaStorage<StorageType> next_storages;
+  std::vector<std::unique_ptr<TransactionType>> next_transactions;
   std::atomic<uint32_t> total_abort;
+  // the fallback lock requests received by each worker
+  std::vector<std::vector<AriaLockRequest>> lock_requests;
+  WorkStealing work_stealing;
+  AriaBatchController batch_controller;
+  std::chrono::steady_clock::time_point epoch_start;
 };
 } // namespace coco
\ No newline at end of file
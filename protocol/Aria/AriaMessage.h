@@ -9,9 +9,12 @@
 #include "common/MessagePiece.h"
 #include "core/ControlMessage.h"
 #include "core/Table.h"
+#include "core/TransactionStream.h"
 #include "protocol/Aria/AriaRWKey.h"
 #include "protocol/Aria/AriaTransaction.h"
 
+#include <unordered_map>
+
 namespace coco {
 
 enum class AriaMessage {
@@ -21,6 +24,10 @@ enum class AriaMessage {
   CHECK_REQUEST,
   CHECK_RESPONSE,
   WRITE_REQUEST,
+  FALLBACK_LOCK_REQUEST,
+  FALLBACK_LOCK_RESPONSE,
+  FALLBACK_RELEASE_REQUEST,
+  INPUT_REQUEST,
   NFIELDS
 };
 
@@ -77,17 +84,17 @@ public:
   static std::size_t new_check_message(Message &message, ITable &table,
                                        uint32_t tid, uint32_t tid_offset,
                                        const void *key, uint32_t epoch,
-                                       bool is_write) {
+                                       bool is_write, uint32_t key_offset) {
     /*
      * The structure of a check request: (primary key, tid, tid_offset, epoch,
-     * is_write)
+     * is_write, key offset)
      */
 
     auto key_size = table.key_size();
 
     auto message_size = MessagePiece::get_header_size() + key_size +
                         sizeof(uint32_t) + sizeof(uint32_t) + sizeof(epoch) +
-                        sizeof(bool);
+                        sizeof(bool) + sizeof(key_offset);
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(AriaMessage::CHECK_REQUEST), message_size,
         table.tableID(), table.partitionID());
@@ -95,7 +102,7 @@ public:
     Encoder encoder(message.data);
     encoder << message_piece_header;
     encoder.write_n_bytes(key, key_size);
-    encoder << tid << tid_offset << epoch << is_write;
+    encoder << tid << tid_offset << epoch << is_write << key_offset;
     message.flush();
     return message_size;
   }
@@ -122,6 +129,109 @@ public:
     message.flush();
     return message_size;
   }
+
+  static std::size_t new_fallback_lock_message(Message &message, ITable &table,
+                                               const void *key, uint32_t tid,
+                                               uint32_t tid_offset,
+                                               uint32_t key_offset,
+                                               bool write_lock) {
+
+    /*
+     * The structure of a fallback lock request: (primary key, tid,
+     * tid_offset, read key offset, write_lock)
+     */
+
+    auto key_size = table.key_size();
+
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        sizeof(tid) + sizeof(tid_offset) + sizeof(key_offset) +
+                        sizeof(write_lock);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(AriaMessage::FALLBACK_LOCK_REQUEST), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(key, key_size);
+    encoder << tid << tid_offset << key_offset << write_lock;
+    message.flush();
+    return message_size;
+  }
+
+  static std::size_t
+  new_fallback_grant_message(Message &message, ITable &table,
+                             const AriaLockRequest &request) {
+
+    /*
+     * The structure of a fallback lock response: (tid_offset, read key
+     * offset, value if the row is read)
+     */
+
+    auto value_size = request.key_offset == AriaLockRequest::NO_READ
+                          ? 0
+                          : table.value_size();
+
+    auto message_size = MessagePiece::get_header_size() +
+                        sizeof(request.tid_offset) +
+                        sizeof(request.key_offset) + value_size;
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(AriaMessage::FALLBACK_LOCK_RESPONSE),
+        message_size, table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder << request.tid_offset << request.key_offset;
+    encoder.write_n_bytes(request.value, value_size);
+    message.flush();
+    return message_size;
+  }
+
+  static std::size_t new_fallback_release_message(Message &message,
+                                                  ITable &table,
+                                                  const void *key,
+                                                  bool write_lock) {
+
+    /*
+     * The structure of a fallback release request: (primary key, write_lock)
+     */
+
+    auto key_size = table.key_size();
+
+    auto message_size =
+        MessagePiece::get_header_size() + key_size + sizeof(write_lock);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(AriaMessage::FALLBACK_RELEASE_REQUEST),
+        message_size, table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(key, key_size);
+    encoder << write_lock;
+    message.flush();
+    return message_size;
+  }
+
+  static std::size_t new_input_message(Message &message, ITable &table,
+                                       uint32_t tid_offset,
+                                       const TransactionStreamEntry &entry) {
+
+    /*
+     * The structure of an input request: (tid_offset, seed, partition id, hot
+     * row), the table is a table of the partition of the transaction
+     */
+
+    auto message_size = MessagePiece::get_header_size() + sizeof(tid_offset) +
+                        TransactionStream::ENTRY_SIZE;
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(AriaMessage::INPUT_REQUEST), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder << tid_offset << entry.seed << entry.partition_id << entry.hot_row;
+    message.flush();
+    return message_size;
+  }
 };
 
 class AriaMessageHandler {
@@ -285,17 +395,18 @@ public:
 
     /*
      * The structure of a check request: (primary key, tid, tid_offset,  epoch,
-     * is_write) The structure of a check response: (tid, tid_offset, is_write,
-     * waw, war, raw)
+     * is_write, key offset) The structure of a check response: (tid,
+     * tid_offset, is_write, key offset, waw, war, raw)
      */
 
     auto stringPiece = inputPiece.toStringPiece();
-    uint32_t tid, tid_offset, epoch;
+    uint32_t tid, tid_offset, epoch, key_offset;
     bool is_write;
 
     DCHECK(inputPiece.get_message_length() ==
            MessagePiece::get_header_size() + key_size + sizeof(tid) +
-               sizeof(tid_offset) + sizeof(epoch) + sizeof(is_write));
+               sizeof(tid_offset) + sizeof(epoch) + sizeof(is_write) +
+               sizeof(key_offset));
 
     // get row, tid and offset
     const void *key = stringPiece.data();
@@ -303,7 +414,7 @@ public:
 
     stringPiece.remove_prefix(key_size);
     coco::Decoder dec(stringPiece);
-    dec >> tid >> tid_offset >> epoch >> is_write;
+    dec >> tid >> tid_offset >> epoch >> is_write >> key_offset;
 
     DCHECK(dec.size() == 0);
 
@@ -336,14 +447,16 @@ public:
 
     // prepare response message header
     auto message_size = MessagePiece::get_header_size() + sizeof(tid) +
-                        sizeof(tid_offset) + sizeof(bool) * 4;
+                        sizeof(tid_offset) + sizeof(key_offset) +
+                        sizeof(bool) * 4;
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(AriaMessage::CHECK_RESPONSE), message_size,
         table_id, partition_id);
 
     coco::Encoder encoder(responseMessage.data);
     encoder << message_piece_header;
-    encoder << tid << tid_offset << is_write << waw << war << raw;
+    encoder << tid << tid_offset << is_write << key_offset << waw << war
+            << raw;
     responseMessage.flush();
   }
 
@@ -360,21 +473,21 @@ public:
     DCHECK(partition_id == table.partitionID());
 
     /*
-     * The structure of a check response: (tid, tid_offset, is_write, waw, war,
-     * raw)
+     * The structure of a check response: (tid, tid_offset, is_write, key
+     * offset, waw, war, raw)
      */
 
-    uint32_t tid, tid_offset;
+    uint32_t tid, tid_offset, key_offset;
     bool is_write;
     bool waw, war, raw;
 
     DCHECK(inputPiece.get_message_length() ==
            MessagePiece::get_header_size() + sizeof(tid) + sizeof(tid_offset) +
-               4 * sizeof(bool));
+               sizeof(key_offset) + 4 * sizeof(bool));
 
     StringPiece stringPiece = inputPiece.toStringPiece();
     Decoder dec(stringPiece);
-    dec >> tid >> tid_offset >> is_write >> waw >> war >> raw;
+    dec >> tid >> tid_offset >> is_write >> key_offset >> waw >> war >> raw;
 
     CHECK(tid_offset >= 0 && tid_offset < txns.size());
     CHECK(txns[tid_offset]->id == tid);
@@ -387,12 +500,14 @@ public:
       }
       if (waw) {
         txns[tid_offset]->waw = true;
+        txns[tid_offset]->set_conflict(txns[tid_offset]->writeSet[key_offset]);
       }
 
     } else {
       // analyze raw
       if (raw) {
         txns[tid_offset]->raw = true;
+        txns[tid_offset]->set_conflict(txns[tid_offset]->readSet[key_offset]);
       }
     }
 
@@ -431,6 +546,151 @@ public:
     table.deserialize_value(key, valueStringPiece);
   }
 
+  // the requests are kept by the worker that receives them, see AriaExecutor
+  static void
+  fallback_lock_request_handler(MessagePiece inputPiece,
+                                Message &responseMessage, ITable &table,
+                                std::vector<AriaLockRequest> &requests) {
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(AriaMessage::FALLBACK_LOCK_REQUEST));
+    auto table_id = inputPiece.get_table_id();
+    auto partition_id = inputPiece.get_partition_id();
+    DCHECK(table_id == table.tableID());
+    DCHECK(partition_id == table.partitionID());
+    auto key_size = table.key_size();
+
+    /*
+     * The structure of a fallback lock request: (primary key, tid,
+     * tid_offset, read key offset, write_lock)
+     */
+
+    AriaLockRequest request;
+
+    DCHECK(inputPiece.get_message_length() ==
+           MessagePiece::get_header_size() + key_size + sizeof(request.tid) +
+               sizeof(request.tid_offset) + sizeof(request.key_offset) +
+               sizeof(request.write_lock));
+
+    auto stringPiece = inputPiece.toStringPiece();
+    const void *key = stringPiece.data();
+    stringPiece.remove_prefix(key_size);
+
+    Decoder dec(stringPiece);
+    dec >> request.tid >> request.tid_offset >> request.key_offset >>
+        request.write_lock;
+
+    auto row = table.search(key);
+    request.coordinator_id = responseMessage.get_dest_node_id();
+    request.lock = std::get<0>(row);
+    request.table = &table;
+    request.value = std::get<1>(row);
+    requests.push_back(request);
+  }
+
+  static void fallback_lock_response_handler(
+      MessagePiece inputPiece, Message &responseMessage, ITable &table,
+      std::vector<std::unique_ptr<Transaction>> &txns) {
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(AriaMessage::FALLBACK_LOCK_RESPONSE));
+    auto table_id = inputPiece.get_table_id();
+    auto partition_id = inputPiece.get_partition_id();
+    DCHECK(table_id == table.tableID());
+    DCHECK(partition_id == table.partitionID());
+
+    /*
+     * The structure of a fallback lock response: (tid_offset, read key
+     * offset, value if the row is read)
+     */
+
+    uint32_t tid_offset, key_offset;
+
+    Decoder dec(inputPiece.toStringPiece());
+    dec >> tid_offset >> key_offset;
+
+    CHECK(tid_offset < txns.size());
+    auto &txn = *txns[tid_offset];
+
+    if (key_offset != AriaLockRequest::NO_READ) {
+      CHECK(key_offset < txn.readSet.size());
+      dec.read_n_bytes(txn.readSet[key_offset].get_value(),
+                       table.value_size());
+    }
+
+    // the transaction may be run by another worker
+    txn.n_granted.fetch_add(1, std::memory_order_release);
+  }
+
+  static void fallback_release_request_handler(
+      MessagePiece inputPiece, Message &responseMessage, ITable &table,
+      std::vector<std::unique_ptr<Transaction>> &txns) {
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(AriaMessage::FALLBACK_RELEASE_REQUEST));
+    auto table_id = inputPiece.get_table_id();
+    auto partition_id = inputPiece.get_partition_id();
+    DCHECK(table_id == table.tableID());
+    DCHECK(partition_id == table.partitionID());
+    auto key_size = table.key_size();
+
+    /*
+     * The structure of a fallback release request: (primary key, write_lock)
+     */
+
+    bool write_lock;
+
+    DCHECK(inputPiece.get_message_length() ==
+           MessagePiece::get_header_size() + key_size + sizeof(write_lock));
+
+    auto stringPiece = inputPiece.toStringPiece();
+    const void *key = stringPiece.data();
+    stringPiece.remove_prefix(key_size);
+
+    Decoder dec(stringPiece);
+    dec >> write_lock;
+
+    auto &lock = table.search_metadata(key);
+    if (write_lock) {
+      AriaHelper::write_lock_release(lock);
+    } else {
+      AriaHelper::read_lock_release(lock);
+    }
+  }
+
+  // the inputs are kept by the worker that receives them, see AriaExecutor
+  static void
+  input_request_handler(MessagePiece inputPiece, Message &responseMessage,
+                        ITable &table,
+                        std::unordered_map<uint32_t, TransactionStreamEntry>
+                            &inputs) {
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(AriaMessage::INPUT_REQUEST));
+    DCHECK(inputPiece.get_message_length() ==
+           MessagePiece::get_header_size() + sizeof(uint32_t) +
+               TransactionStream::ENTRY_SIZE);
+
+    /*
+     * The structure of an input request: (tid_offset, seed, partition id, hot
+     * row)
+     */
+
+    uint32_t tid_offset;
+    TransactionStreamEntry entry;
+
+    Decoder dec(inputPiece.toStringPiece());
+    dec >> tid_offset >> entry.seed >> entry.partition_id >> entry.hot_row;
+    inputs[tid_offset] = entry;
+  }
+
+  // the types whose pieces start with a key of their table, see
+  // MessageDispatch::prefetch_keys
+  static std::vector<uint32_t> get_keyed_messages() {
+    return {static_cast<uint32_t>(AriaMessage::SEARCH_REQUEST),
+            static_cast<uint32_t>(AriaMessage::RESERVE_REQUEST),
+            static_cast<uint32_t>(AriaMessage::CHECK_REQUEST),
+            static_cast<uint32_t>(AriaMessage::WRITE_REQUEST),
+            static_cast<uint32_t>(AriaMessage::FALLBACK_LOCK_REQUEST),
+            static_cast<uint32_t>(AriaMessage::FALLBACK_RELEASE_REQUEST)};
+  }
+
   static std::vector<
       std::function<void(MessagePiece, Message &, ITable &,
                          std::vector<std::unique_ptr<Transaction>> &)>>
@@ -446,6 +706,12 @@ public:
     v.push_back(check_request_handler);
     v.push_back(check_response_handler);
     v.push_back(write_request_handler);
+    // set by the executor, see fallback_lock_request_handler
+    v.push_back(nullptr);
+    v.push_back(fallback_lock_response_handler);
+    v.push_back(fallback_release_request_handler);
+    // set by the executor, see input_request_handler
+    v.push_back(nullptr);
     return v;
   }
 };
@@ -0,0 +1,71 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace coco {
+
+/*
+ * AriaStorage holds the storage of the transactions of an Aria batch, i.e.,
+ * the keys and values a transaction stages, see the StorageType of a
+ * workload. Transactions keep a reference to their storage, so a slot never
+ * moves once it is allocated.
+ *
+ * Slots are allocated CHUNK_SIZE at a time, only once a batch grows past the
+ * slots it already has, see resize, instead of --batch_size slots up front.
+ * A new batch reuses the slots of the last one as they are, nothing is
+ * cleared, since a transaction fills in its storage as it runs.
+ *
+ * The transaction at index i of the batch uses the slot of index i. The
+ * transactions that abort on a lock are moved to the front of the next
+ * batch, see AriaManager::cleanup_batch, and swap moves their slots along,
+ * so that a new transaction never takes the storage of one that is rerun.
+ *
+ * With --aria_generate_ahead, the transactions of the next batch are generated
+ * in the slots of a second AriaStorage, see AriaExecutor, and take the slot of
+ * index i over once transaction i of the last batch is done, see swap.
+ */
+
+template <class StorageType> class AriaStorage {
+public:
+  static constexpr std::size_t CHUNK_SIZE = 64;
+
+  // the storage of the transaction at index i
+  StorageType &operator[](std::size_t i) { return *slots[i]; }
+
+  // called before a batch of n transactions starts, not by the workers
+  void resize(std::size_t n) {
+    while (slots.size() < n) {
+      if (slots.size() == chunks.size() * CHUNK_SIZE) {
+        chunks.emplace_back(new StorageType[CHUNK_SIZE]);
+      }
+      slots.push_back(&chunks.back()[slots.size() % CHUNK_SIZE]);
+    }
+  }
+
+  // the transactions at index i and j are swapped
+  void swap(std::size_t i, std::size_t j) { std::swap(slots[i], slots[j]); }
+
+  // the slots of index i of this and that are swapped
+  void swap(std::size_t i, AriaStorage &that) {
+    std::swap(slots[i], that.slots[i]);
+  }
+
+  std::size_t size() const { return slots.size(); }
+
+  std::size_t memory_usage() const {
+    return chunks.size() * CHUNK_SIZE * sizeof(StorageType);
+  }
+
+private:
+  std::vector<std::unique_ptr<StorageType[]>> chunks;
+  std::vector<StorageType *> slots;
+};
+} // namespace coco
@@ -5,6 +5,8 @@
 #pragma once
 
 #include "common/Operation.h"
+#include "common/SmallVector.h"
+#include "common/Time.h"
 #include "core/Defs.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
@@ -21,10 +23,18 @@ class AriaTransaction {
 public:
   using MetaDataType = std::atomic<uint64_t>;
 
+  // a row locked in the fallback, key_offset is the offset of its first read
+  struct FallbackKey {
+    std::size_t table_id, partition_id;
+    const void *key;
+    uint32_t key_offset;
+    bool write_lock;
+  };
+
   AriaTransaction(std::size_t coordinator_id, std::size_t partition_id,
                   Partitioner &partitioner)
       : coordinator_id(coordinator_id), partition_id(partition_id),
-        startTime(std::chrono::steady_clock::now()), partitioner(partitioner) {
+        startTime(Clock::now()), partitioner(partitioner) {
     reset();
   }
 
@@ -32,6 +42,8 @@ public:
 
   void reset() {
     abort_lock = false;
+    aborted = false;
+    conflict_key = nullptr;
     abort_no_retry = false;
     abort_read_validation = false;
     distributed_transaction = false;
@@ -41,9 +53,11 @@ public:
     raw = false;
     pendingResponses = 0;
     network_size = 0;
+    n_granted.store(0);
     operation.clear();
     readSet.clear();
     writeSet.clear();
+    fallbackKeys.clear();
   }
 
   virtual TransactionResult execute(std::size_t worker_id) = 0;
@@ -90,6 +104,42 @@ public:
     add_to_read_set(readKey);
   }
 
+  // reads the whole value, the fields are a hint, see FieldProjection
+  template <class KeyType, class ValueType>
+  void search_for_read(std::size_t table_id, std::size_t partition_id,
+                       const KeyType &key, ValueType &value, uint64_t fields) {
+    search_for_read(table_id, partition_id, key, value);
+  }
+
+  // only Silo, Scar and TwoPL insert and delete rows, see Tombstone. The
+  // metadata of Aria is taken up by the epoch and the read and write
+  // reservations of the batch, so there is no bit left for a tombstone.
+  template <class KeyType, class ValueType>
+  bool insert(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key, const ValueType &value) {
+    CHECK(false) << "inserts are not supported.";
+    return false;
+  }
+
+  template <class KeyType>
+  void remove(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key) {
+    CHECK(false) << "deletes are not supported.";
+  }
+
+  bool is_absent(const void *key) { return false; }
+
+  // only Silo and SiloGC apply additions, see CommutativeUpdate
+  template <class KeyType, class T>
+  void add_to_field(std::size_t table_id, std::size_t partition_id,
+                    const KeyType &key, uint32_t field, T delta) {
+    CHECK(false) << "additions to fields are not supported.";
+  }
+
+  // only Silo repairs transactions, see Silo::repair
+  template <class KeyType>
+  void on_repair(const KeyType &key, std::function<void()> recompute) {}
+
   template <class KeyType, class ValueType>
   void search_for_update(std::size_t table_id, std::size_t partition_id,
                          const KeyType &key, ValueType &value) {
@@ -109,6 +159,13 @@ public:
     add_to_read_set(readKey);
   }
 
+  // scans need phantom protection, which is only implemented in Silo.
+  template <class KeyType, class ValueType, class Func>
+  void scan(std::size_t table_id, std::size_t partition_id,
+            const KeyType &start, const KeyType &end, Func func) {
+    CHECK(false) << "Aria does not support scans.";
+  }
+
   template <class KeyType, class ValueType>
   void update(std::size_t table_id, std::size_t partition_id,
               const KeyType &key, const ValueType &value) {
@@ -162,18 +219,37 @@ public:
 
   bool is_read_only() { return writeSet.size() == 0; }
 
+  // keeps the first row that aborts the transaction, see ConflictProfile
+  void set_conflict(const AriaRWKey &key) {
+    if (conflict_key == nullptr) {
+      conflict_key = key.get_key();
+      conflict_table_id = key.get_table_id();
+      conflict_partition_id = key.get_partition_id();
+    }
+  }
+
 public:
   std::size_t coordinator_id, partition_id, id, tid_offset;
   uint32_t epoch;
-  std::chrono::steady_clock::time_point startTime;
+  Clock::time_point startTime;
+  // the type of the transaction, see Statistics::procedures
+  uint32_t procedure_id = 0;
   std::size_t pendingResponses;
   std::size_t network_size;
 
   bool abort_lock, abort_no_retry, abort_read_validation;
+  // aborted in the commit phase of its batch, see AriaBatchController
+  bool aborted;
+  const void *conflict_key;
+  std::size_t conflict_table_id, conflict_partition_id;
   bool distributed_transaction;
   bool execution_phase;
   bool waw, war, raw;
 
+  // # of fallback locks granted, the lock managers add to it
+  std::atomic<uint32_t> n_granted;
+  std::vector<FallbackKey> fallbackKeys;
+
   // read_key, id, key_offset
   std::function<void(AriaRWKey &, std::size_t, std::size_t)> readRequestHandler;
 
@@ -184,6 +260,7 @@ public:
 
   Partitioner &partitioner;
   Operation operation; // never used
-  std::vector<AriaRWKey> readSet, writeSet;
+  SmallVector<AriaRWKey, N_INLINE_READ_KEYS> readSet;
+  SmallVector<AriaRWKey, N_INLINE_WRITE_KEYS> writeSet;
 };
 } // namespace coco
\ No newline at end of file
@@ -0,0 +1,64 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Partitioner.h"
+#include "core/Table.h"
+#include "protocol/Bohm/BohmHelper.h"
+#include "protocol/Bohm/BohmMessage.h"
+#include "protocol/Bohm/BohmTransaction.h"
+
+namespace coco {
+
+template <class Database> class Bohm {
+public:
+  using DatabaseType = Database;
+  using MetaDataType = std::atomic<uint64_t>;
+  using ContextType = typename DatabaseType::ContextType;
+  using MessageType = BohmMessage;
+  using TransactionType = BohmTransaction;
+
+  using MessageFactoryType = BohmMessageFactory;
+  using MessageHandlerType = BohmMessageHandler;
+
+  Bohm(DatabaseType &db, const ContextType &context, Partitioner &partitioner)
+      : db(db), context(context), partitioner(partitioner) {}
+
+  // the placeholders of a transaction are always written, see BohmExecutor
+  void abort(TransactionType &txn,
+             std::vector<std::unique_ptr<Message>> &messages) {
+    CHECK(false) << "Bohm does not abort in the execution phase.";
+  }
+
+  // fills the placeholders of version in the write set
+  bool commit(TransactionType &txn, uint64_t version,
+              std::vector<std::unique_ptr<Message>> &messages) {
+
+    auto &writeSet = txn.writeSet;
+    for (auto i = 0u; i < writeSet.size(); i++) {
+      auto &writeKey = writeSet[i];
+      auto tableId = writeKey.get_table_id();
+      auto partitionId = writeKey.get_partition_id();
+      auto table = db.find_table(tableId, partitionId);
+
+      if (partitioner.has_master_partition(partitionId)) {
+        table->update(writeKey.get_key(), writeKey.get_value(), version);
+      } else {
+        auto coordinatorID = partitioner.master_coordinator(partitionId);
+        txn.network_size += MessageFactoryType::new_write_message(
+            *messages[coordinatorID], *table, writeKey.get_key(),
+            writeKey.get_value(), version);
+      }
+    }
+
+    return true;
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  Partitioner &partitioner;
+};
+} // namespace coco
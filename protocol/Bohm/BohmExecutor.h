@@ -0,0 +1,448 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Time.h"
+#include "core/MessageDispatch.h"
+#include "core/Partitioner.h"
+
+#include "common/Futex.h"
+#include "common/Histogram.h"
+#include "core/CommandLog.h"
+#include "core/Worker.h"
+#include "glog/logging.h"
+
+#include "protocol/Bohm/Bohm.h"
+#include "protocol/Bohm/BohmHelper.h"
+#include "protocol/Bohm/BohmMessage.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace coco {
+
+/*
+ * Bohm runs a batch in three phases. In the Analysis phase, all coordinators
+ * generate the same batch and collect the read and write sets. Transaction i
+ * of batch e has version e * batch size + i. In the Insert phase, worker
+ * (partition id / coordinator num) % worker num inserts the placeholders of
+ * the versions that a local partition gets in the order of the batch. In the
+ * Execute phase, a transaction reads the latest version before its own, waits
+ * till the version is written and never aborts due to conflicts.
+ *
+ * A transaction is run by the same worker on all coordinators, i.e., worker i
+ * % worker num, or (partition id / coordinator num) % worker num with
+ * --bohm_local. The other coordinators send their local reads to the master
+ * of the partition of the transaction, which runs the transaction and sends
+ * the writes back. A worker serves these messages while waiting for a
+ * version, except with --bohm_single_spin on a single node. The read and
+ * write set must be known from the query, e.g., TPC-C with --payment_look_up
+ * is not supported.
+ */
+
+template <class Workload> class BohmExecutor : public Worker {
+public:
+  using WorkloadType = Workload;
+  using DatabaseType = typename WorkloadType::DatabaseType;
+  using StorageType = typename WorkloadType::StorageType;
+
+  using TransactionType = BohmTransaction;
+  static_assert(std::is_same<typename WorkloadType::TransactionType,
+                             TransactionType>::value,
+                "Transaction types do not match.");
+
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+
+  using ProtocolType = Bohm<DatabaseType>;
+
+  using MessageType = BohmMessage;
+  using MessageFactoryType = BohmMessageFactory;
+  using MessageHandlerType = BohmMessageHandler;
+
+  BohmExecutor(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
+               const ContextType &context,
+               std::vector<std::unique_ptr<TransactionType>> &transactions,
+               std::vector<StorageType> &storages,
+               std::atomic<uint32_t> &epoch,
+               std::atomic<uint32_t> &worker_status,
+               std::atomic<uint32_t> &n_complete_workers,
+               std::atomic<uint32_t> &n_started_workers)
+      : Worker(coordinator_id, id), db(db), context(context),
+        transactions(transactions), storages(storages), epoch(epoch),
+        worker_status(worker_status), n_complete_workers(n_complete_workers),
+        n_started_workers(n_started_workers),
+        partitioner(PartitionerFactory::create_partitioner(
+            context.partitioner, coordinator_id, context.coordinator_num)),
+        workload(coordinator_id, db, random, *partitioner),
+        random(reinterpret_cast<uint64_t>(this)),
+        protocol(db, context, *partitioner) {
+
+    CHECK(partitioner->replica_num() == 1) << "Bohm does not replicate.";
+
+    for (auto i = 0u; i < context.coordinator_num; i++) {
+      messages.emplace_back(std::make_unique<Message>());
+      init_message(messages[i].get(), i);
+    }
+
+    messageHandlers = MessageHandlerType::get_message_handlers();
+    command_log = CommandLog::open(context, coordinator_id, id);
+  }
+
+  ~BohmExecutor() = default;
+
+  void start() override {
+
+    LOG(INFO) << "BohmExecutor " << id << " started. ";
+
+    for (;;) {
+
+      Futex::wait_until(worker_status, [](uint32_t s) {
+        return static_cast<ExecutorStatus>(s) ==
+                   ExecutorStatus::Bohm_Analysis ||
+               static_cast<ExecutorStatus>(s) == ExecutorStatus::EXIT;
+      });
+
+      if (static_cast<ExecutorStatus>(worker_status.load()) ==
+          ExecutorStatus::EXIT) {
+        LOG(INFO) << "BohmExecutor " << id << " exits. ";
+        return;
+      }
+
+      run_phase(ExecutorStatus::Bohm_Analysis,
+                [this]() { generate_transactions(); });
+      run_phase(ExecutorStatus::Bohm_Insert,
+                [this]() { insert_placeholders(); });
+      run_phase(ExecutorStatus::Bohm_Execute, [this]() {
+        run_transactions();
+        // the batch is released once its inputs are durable
+        if (command_log != nullptr) {
+          command_log->sync();
+        }
+      });
+    }
+  }
+
+  template <class Func> void run_phase(ExecutorStatus status, Func func) {
+    Futex::wait_until(worker_status, [status](uint32_t s) {
+      return static_cast<ExecutorStatus>(s) == status;
+    });
+    Futex::add_and_wake(n_started_workers, 1);
+    func();
+    Futex::add_and_wake(n_complete_workers, 1);
+    // wait to the end of the phase
+    Futex::wait_until(
+        worker_status,
+        [status](uint32_t s) {
+          return static_cast<ExecutorStatus>(s) != status;
+        },
+        [this]() { return process_request(); });
+    process_request();
+    Futex::add_and_wake(n_complete_workers, 1);
+  }
+
+  void generate_transactions() {
+    auto cur_epoch = epoch.load();
+    if (command_log != nullptr) {
+      command_log->begin_batch(transactions.size());
+    }
+    for (auto i = id; i < transactions.size(); i += context.worker_num) {
+
+      // all coordinators generate the same batch
+      if (context.same_batch) {
+        random.init_seed(i);
+      } else {
+        random.init_seed(cur_epoch * transactions.size() + i);
+      }
+      std::size_t partition_id =
+          random.uniform_dist(0, context.partition_num - 1);
+      if (command_log != nullptr) {
+        std::size_t hot_row = 0;
+        command_log->next(i, random, partition_id, hot_row);
+      }
+      transactions[i] =
+          workload.next_transaction(context, partition_id, storages[i]);
+      transactions[i]->set_id(i);
+
+      // collect the read and write set
+      auto result = transactions[i]->execute(id);
+      if (result == TransactionResult::ABORT_NORETRY) {
+        transactions[i]->abort_no_retry = true;
+        continue;
+      }
+
+      merge_writes(*transactions[i]);
+      prepare_reads(*transactions[i]);
+    }
+    if (command_log != nullptr) {
+      command_log->end_batch();
+    }
+  }
+
+  // a row written twice by a transaction gets one version with the last write
+  void merge_writes(TransactionType &txn) {
+    auto &writeSet = txn.writeSet;
+    std::size_t kept = 0;
+    for (auto i = 0u; i < writeSet.size(); i++) {
+      auto table = db.find_table(writeSet[i].get_table_id(),
+                                 writeSet[i].get_partition_id());
+      bool overwritten = false;
+      for (auto j = i + 1; j < writeSet.size() && !overwritten; j++) {
+        overwritten =
+            writeSet[j].get_table_id() == writeSet[i].get_table_id() &&
+            writeSet[j].get_partition_id() == writeSet[i].get_partition_id() &&
+            std::memcmp(writeSet[j].get_key(), writeSet[i].get_key(),
+                        table->key_size()) == 0;
+      }
+      if (!overwritten) {
+        writeSet[kept++] = writeSet[i];
+      }
+    }
+    writeSet.resize(kept);
+  }
+
+  void prepare_reads(TransactionType &txn) {
+    if (!is_home(txn)) {
+      return;
+    }
+
+    // the reads other coordinators send to this one
+    for (auto &readKey : txn.readSet) {
+      if (readKey.get_local_index_read_bit()) {
+        continue;
+      }
+      if (!partitioner->has_master_partition(readKey.get_partition_id())) {
+        txn.distributed_transaction = true;
+        txn.pendingResponses++;
+      }
+    }
+  }
+
+  void insert_placeholders() {
+    auto cur_epoch = epoch.load();
+    for (auto i = 0u; i < transactions.size(); i++) {
+      auto &txn = *transactions[i];
+      if (txn.abort_no_retry) {
+        continue;
+      }
+
+      auto version = BohmHelper::get_version(cur_epoch, transactions.size(), i);
+      for (auto &writeKey : txn.writeSet) {
+        auto partitionId = writeKey.get_partition_id();
+        if (!partitioner->has_master_partition(partitionId) ||
+            partition_owner(partitionId) != id) {
+          continue;
+        }
+        auto table = db.find_table(writeKey.get_table_id(), partitionId);
+        table->insert(writeKey.get_key(), writeKey.get_value(), version);
+      }
+    }
+  }
+
+  void run_transactions() {
+    auto cur_epoch = epoch.load();
+    for (auto i = 0u; i < transactions.size(); i++) {
+      auto &txn = *transactions[i];
+      if (transaction_owner(txn) != id) {
+        continue;
+      }
+
+      if (txn.abort_no_retry) {
+        if (is_home(txn)) {
+          stats.add(WorkerStats::ABORT_NO_RETRY);
+          record_abort(txn.procedure_id,
+                       &ProcedureStatistics::n_abort_no_retry);
+        }
+        continue;
+      }
+
+      auto version = BohmHelper::get_version(cur_epoch, transactions.size(), i);
+      read_local_rows(txn, version);
+      flush_messages();
+
+      if (!is_home(txn)) {
+        continue;
+      }
+
+      // wait till all reads are received
+      while (txn.pendingResponses > 0) {
+        process_request();
+      }
+
+      txn.execution_phase = true;
+      auto result = txn.execute(id);
+      if (result == TransactionResult::ABORT_NORETRY) {
+        protocol.abort(txn, messages);
+      }
+
+      protocol.commit(txn, version, messages);
+      flush_messages();
+      stats.add(WorkerStats::NETWORK_SIZE, txn.network_size);
+      stats.add(WorkerStats::COMMIT);
+      auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                         Clock::now() - txn.startTime)
+                         .count();
+      percentile.add(latency);
+      record_latency(latency, txn.procedure_id);
+    }
+  }
+
+  void read_local_rows(TransactionType &txn, uint64_t version) {
+
+    auto home = partitioner->master_coordinator(txn.partition_id);
+
+    for (auto k = 0u; k < txn.readSet.size(); k++) {
+      auto &readKey = txn.readSet[k];
+      auto tableId = readKey.get_table_id();
+      auto partitionId = readKey.get_partition_id();
+      auto table = db.find_table(tableId, partitionId);
+
+      // read-only rows only have the version from the loader
+      if (readKey.get_local_index_read_bit()) {
+        if (home == coordinator_id) {
+          BohmHelper::read(table->search(readKey.get_key()),
+                           readKey.get_value(), table->value_size());
+        }
+        continue;
+      }
+
+      if (!partitioner->has_master_partition(partitionId)) {
+        continue;
+      }
+
+      auto row = table->search_prev(readKey.get_key(), version);
+      while (!BohmHelper::read(row, readKey.get_value(),
+                               table->value_size())) {
+        if (context.bohm_single_spin) {
+          __asm volatile("pause" : :);
+        } else {
+          process_request();
+        }
+      }
+
+      if (home != coordinator_id) {
+        txn.network_size += MessageFactoryType::new_read_result_message(
+            *messages[home], *table, txn.id, k, readKey.get_value());
+      }
+    }
+  }
+
+  // the master of the partition of a transaction runs it
+  bool is_home(const TransactionType &txn) const {
+    return partitioner->has_master_partition(txn.partition_id);
+  }
+
+  std::size_t partition_owner(std::size_t partition_id) const {
+    return partition_id / context.coordinator_num % context.worker_num;
+  }
+
+  std::size_t transaction_owner(const TransactionType &txn) const {
+    return context.bohm_local ? partition_owner(txn.partition_id)
+                              : txn.id % context.worker_num;
+  }
+
+  void onExit() override {
+    LOG(INFO) << "Worker " << id << " latency: " << percentile.nth(50)
+              << " us (50%) " << percentile.nth(75) << " us (75%) "
+              << percentile.nth(95) << " us (95%) " << percentile.nth(99)
+              << " us (99%).";
+
+    if (command_log != nullptr) {
+      command_log->close();
+    }
+  }
+
+  void push_message(Message *message) override { in_queue.push(message); }
+
+  Message *pop_message() override {
+    if (out_queue.empty())
+      return nullptr;
+
+    Message *message = out_queue.front();
+
+    bool ok = out_queue.pop();
+    CHECK(ok);
+
+    return message;
+  }
+
+  void flush_messages() {
+
+    for (auto i = 0u; i < messages.size(); i++) {
+      if (i == coordinator_id) {
+        continue;
+      }
+
+      if (messages[i]->get_message_count() == 0) {
+        continue;
+      }
+
+      auto message = messages[i].release();
+
+      push_outgoing(out_queue, message);
+      messages[i].reset(outgoing_message_pool.get());
+      init_message(messages[i].get(), i);
+    }
+  }
+
+  // a message is handled by the worker with the same id on the destination
+  void init_message(Message *message, std::size_t dest_node_id) {
+    message->set_source_node_id(coordinator_id);
+    message->set_dest_node_id(dest_node_id);
+    message->set_worker_id(id);
+  }
+
+  std::size_t process_request() {
+
+    std::size_t size = 0;
+    if (!dispatch.is_bound()) {
+      dispatch.bind(messageHandlers);
+    }
+
+    while (!in_queue.empty()) {
+      std::unique_ptr<Message> message(in_queue.front());
+      bool ok = in_queue.pop();
+      CHECK(ok);
+
+      for (auto it = message->begin(); it != message->end(); it++) {
+
+        MessagePiece messagePiece = *it;
+        auto type = messagePiece.get_message_type();
+        DCHECK(type < messageHandlers.size());
+        ITable *table = dispatch.table(db, messagePiece);
+        dispatch(type, messagePiece, *messages[message->get_source_node_id()],
+                 *table, transactions);
+      }
+
+      size += message->get_message_count();
+      incoming_message_pool.put(message.release());
+      flush_messages();
+    }
+    return size;
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  std::vector<std::unique_ptr<TransactionType>> &transactions;
+  std::vector<StorageType> &storages;
+  std::atomic<uint32_t> &epoch, &worker_status;
+  std::atomic<uint32_t> &n_complete_workers, &n_started_workers;
+  std::unique_ptr<Partitioner> partitioner;
+  WorkloadType workload;
+  RandomType random;
+  ProtocolType protocol;
+  Histogram percentile;
+  std::unique_ptr<CommandLog> command_log;
+  std::vector<std::unique_ptr<Message>> messages;
+  std::vector<
+      std::function<void(MessagePiece, Message &, ITable &,
+                         std::vector<std::unique_ptr<TransactionType>> &)>>
+      messageHandlers;
+  MessageDispatch<std::vector<std::unique_ptr<TransactionType>> &> dispatch;
+  LockfreeQueue<Message *> in_queue, out_queue;
+};
+} // namespace coco
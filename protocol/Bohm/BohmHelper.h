@@ -0,0 +1,45 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <glog/logging.h>
+#include <tuple>
+
+namespace coco {
+
+/*
+ * A version in an MVCCTable is a placeholder that holds its own version in
+ * the metadata until it is written, see MVCCTable::insert and
+ * MVCCTable::update. The versions loaded before the run are version 0.
+ */
+
+class BohmHelper {
+public:
+  using MetaDataType = std::atomic<uint64_t>;
+
+  static bool is_written(const MetaDataType &meta) {
+    return meta.load(std::memory_order_acquire) == 0;
+  }
+
+  // returns false if the version is not written yet
+  static bool read(const std::tuple<MetaDataType *, void *> &row, void *dest,
+                   std::size_t size) {
+    if (!is_written(*std::get<0>(row))) {
+      return false;
+    }
+    std::memcpy(dest, std::get<1>(row), size);
+    return true;
+  }
+
+  // versions of a batch follow the versions of the previous batches
+  static uint64_t get_version(uint64_t epoch, std::size_t batch_size,
+                              std::size_t i) {
+    DCHECK(epoch > 0 && i < batch_size);
+    return epoch * batch_size + i;
+  }
+};
+} // namespace coco
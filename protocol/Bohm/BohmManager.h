@@ -0,0 +1,134 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Manager.h"
+#include "core/Partitioner.h"
+#include "core/VersionReclaimer.h"
+#include "protocol/Bohm/Bohm.h"
+#include "protocol/Bohm/BohmExecutor.h"
+#include "protocol/Bohm/BohmHelper.h"
+#include "protocol/Bohm/BohmTransaction.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+template <class Workload> class BohmManager : public coco::Manager {
+public:
+  using base_type = coco::Manager;
+
+  using WorkloadType = Workload;
+  using DatabaseType = typename WorkloadType::DatabaseType;
+  using StorageType = typename WorkloadType::StorageType;
+
+  using TransactionType = BohmTransaction;
+  static_assert(std::is_same<typename WorkloadType::TransactionType,
+                             TransactionType>::value,
+                "Transaction types do not match.");
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+
+  BohmManager(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
+              const ContextType &context, std::atomic<bool> &stopFlag,
+              VersionReclaimer *reclaimer)
+      : base_type(coordinator_id, id, context, stopFlag), db(db), epoch(0),
+        reclaimer(reclaimer) {
+
+    storages.resize(context.batch_size);
+    transactions.resize(context.batch_size);
+  }
+
+  void coordinator_start() override {
+
+    while (!stopFlag.load()) {
+
+      // the sequencer: each worker generates the transactions of the batch
+      // with seeds that are the same on all coordinators, and collects their
+      // read and write sets.
+      epoch.fetch_add(1);
+      run_phase(ExecutorStatus::Bohm_Analysis);
+      // the concurrency control: placeholders of the versions are inserted
+      // in the order of the batch.
+      retire_versions();
+      run_phase(ExecutorStatus::Bohm_Insert);
+      // the execution: each transaction reads the versions right before its
+      // own and fills its placeholders.
+      run_phase(ExecutorStatus::Bohm_Execute);
+    }
+
+    signal_worker(ExecutorStatus::EXIT);
+  }
+
+  void non_coordinator_start() override {
+
+    for (;;) {
+      ExecutorStatus status = wait4_signal();
+      if (status == ExecutorStatus::EXIT) {
+        set_worker_status(ExecutorStatus::EXIT);
+        break;
+      }
+
+      DCHECK(status == ExecutorStatus::Bohm_Analysis);
+      epoch.fetch_add(1);
+      run_phase(status);
+
+      status = wait4_signal();
+      DCHECK(status == ExecutorStatus::Bohm_Insert);
+      retire_versions();
+      run_phase(status);
+
+      status = wait4_signal();
+      DCHECK(status == ExecutorStatus::Bohm_Execute);
+      run_phase(status);
+    }
+  }
+
+  // runs a phase on all coordinators, the coordinator signals the others.
+  void run_phase(ExecutorStatus status) {
+
+    std::size_t n_coordinators = context.coordinator_num;
+
+    n_started_workers.store(0);
+    n_completed_workers.store(0);
+    if (coordinator_id == 0) {
+      signal_worker(status);
+    } else {
+      set_worker_status(status);
+    }
+    wait_all_workers_start();
+    wait_all_workers_finish();
+    broadcast_stop();
+    wait4_stop(n_coordinators - 1);
+    n_completed_workers.store(0);
+    set_worker_status(ExecutorStatus::STOP);
+    wait_all_workers_finish();
+    // wait for all machines until they finish the phase.
+    if (coordinator_id == 0) {
+      wait4_ack();
+    } else {
+      send_ack();
+    }
+  }
+
+  // the versions of the last batches are the oldest ones still read
+  void retire_versions() {
+    if (reclaimer != nullptr) {
+      reclaimer->advance(BohmHelper::get_version(epoch.load(),
+                                                 transactions.size(), 0));
+    }
+  }
+
+public:
+  RandomType random;
+  DatabaseType &db;
+  std::atomic<uint32_t> epoch;
+  VersionReclaimer *reclaimer;
+  std::vector<StorageType> storages;
+  std::vector<std::unique_ptr<TransactionType>> transactions;
+};
+} // namespace coco
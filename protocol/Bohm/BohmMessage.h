@@ -0,0 +1,172 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/Message.h"
+#include "common/MessagePiece.h"
+#include "core/ControlMessage.h"
+#include "core/Table.h"
+#include "protocol/Bohm/BohmHelper.h"
+#include "protocol/Bohm/BohmRWKey.h"
+#include "protocol/Bohm/BohmTransaction.h"
+
+namespace coco {
+
+enum class BohmMessage {
+  READ_RESULT = static_cast<int>(ControlMessage::NFIELDS),
+  WRITE_REQUEST,
+  NFIELDS
+};
+
+class BohmMessageFactory {
+public:
+  static std::size_t new_read_result_message(Message &message, ITable &table,
+                                             uint32_t tid_offset,
+                                             uint32_t key_offset,
+                                             const void *value) {
+    /*
+     * The structure of a read result: (value, tid_offset, read key offset)
+     */
+
+    auto value_size = table.value_size();
+
+    auto message_size = MessagePiece::get_header_size() + value_size +
+                        sizeof(tid_offset) + sizeof(key_offset);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(BohmMessage::READ_RESULT), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(value, value_size);
+    encoder << tid_offset << key_offset;
+    message.flush();
+    return message_size;
+  }
+
+  static std::size_t new_write_message(Message &message, ITable &table,
+                                       const void *key, const void *value,
+                                       uint64_t version) {
+
+    /*
+     * The structure of a write request: (primary key, field value, version)
+     */
+
+    auto key_size = table.key_size();
+    auto field_size = table.field_size();
+
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        field_size + sizeof(version);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(BohmMessage::WRITE_REQUEST), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(key, key_size);
+    table.serialize_value(encoder, value);
+    encoder << version;
+    message.flush();
+    return message_size;
+  }
+};
+
+class BohmMessageHandler {
+  using Transaction = BohmTransaction;
+
+public:
+  static void
+  read_result_handler(MessagePiece inputPiece, Message &responseMessage,
+                      ITable &table,
+                      std::vector<std::unique_ptr<Transaction>> &txns) {
+
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(BohmMessage::READ_RESULT));
+    auto table_id = inputPiece.get_table_id();
+    auto partition_id = inputPiece.get_partition_id();
+    DCHECK(table_id == table.tableID());
+    DCHECK(partition_id == table.partitionID());
+    auto value_size = table.value_size();
+
+    /*
+     * The structure of a read result: (value, tid_offset, read key offset)
+     */
+
+    uint32_t tid_offset, key_offset;
+
+    DCHECK(inputPiece.get_message_length() ==
+           MessagePiece::get_header_size() + value_size + sizeof(tid_offset) +
+               sizeof(key_offset));
+
+    StringPiece stringPiece = inputPiece.toStringPiece();
+    stringPiece.remove_prefix(value_size);
+    Decoder dec(stringPiece);
+    dec >> tid_offset >> key_offset;
+
+    CHECK(tid_offset < txns.size());
+    CHECK(key_offset < txns[tid_offset]->readSet.size());
+
+    BohmRWKey &readKey = txns[tid_offset]->readSet[key_offset];
+    dec = Decoder(inputPiece.toStringPiece());
+    dec.read_n_bytes(readKey.get_value(), value_size);
+    txns[tid_offset]->pendingResponses--;
+    txns[tid_offset]->network_size += inputPiece.get_message_length();
+  }
+
+  static void
+  write_request_handler(MessagePiece inputPiece, Message &responseMessage,
+                        ITable &table,
+                        std::vector<std::unique_ptr<Transaction>> &txns) {
+
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(BohmMessage::WRITE_REQUEST));
+    auto table_id = inputPiece.get_table_id();
+    auto partition_id = inputPiece.get_partition_id();
+    DCHECK(table_id == table.tableID());
+    DCHECK(partition_id == table.partitionID());
+    auto key_size = table.key_size();
+    auto field_size = table.field_size();
+
+    /*
+     * The structure of a write request: (primary key, field value, version)
+     */
+
+    uint64_t version;
+
+    DCHECK(inputPiece.get_message_length() ==
+           MessagePiece::get_header_size() + key_size + field_size +
+               sizeof(version));
+
+    auto stringPiece = inputPiece.toStringPiece();
+
+    const void *key = stringPiece.data();
+    stringPiece.remove_prefix(key_size);
+
+    StringPiece versionPiece = stringPiece;
+    versionPiece.remove_prefix(field_size);
+    Decoder dec(versionPiece);
+    dec >> version;
+
+    // the placeholder of the version becomes readable
+    table.deserialize_value(key, stringPiece, version);
+    table.search_metadata(key, version).store(0, std::memory_order_release);
+  }
+
+  static std::vector<
+      std::function<void(MessagePiece, Message &, ITable &,
+                         std::vector<std::unique_ptr<Transaction>> &)>>
+  get_message_handlers() {
+    std::vector<
+        std::function<void(MessagePiece, Message &, ITable &,
+                           std::vector<std::unique_ptr<Transaction>> &)>>
+        v;
+    v.resize(static_cast<int>(ControlMessage::NFIELDS));
+    v.push_back(read_result_handler);
+    v.push_back(write_request_handler);
+    return v;
+  }
+};
+} // namespace coco
@@ -0,0 +1,187 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Operation.h"
+#include "common/SmallVector.h"
+#include "common/Time.h"
+#include "core/Defs.h"
+#include "core/Partitioner.h"
+#include "core/Table.h"
+#include "protocol/Bohm/BohmHelper.h"
+#include "protocol/Bohm/BohmRWKey.h"
+#include <atomic>
+#include <chrono>
+#include <glog/logging.h>
+#include <vector>
+
+namespace coco {
+
+class BohmTransaction {
+
+public:
+  using MetaDataType = std::atomic<uint64_t>;
+
+  BohmTransaction(std::size_t coordinator_id, std::size_t partition_id,
+                    Partitioner &partitioner)
+      : coordinator_id(coordinator_id), partition_id(partition_id),
+        startTime(Clock::now()), partitioner(partitioner) {
+    reset();
+  }
+
+  virtual ~BohmTransaction() = default;
+
+  void reset() {
+    abort_no_retry = false;
+    distributed_transaction = false;
+    execution_phase = false;
+    pendingResponses = 0;
+    network_size = 0;
+    operation.clear();
+    readSet.clear();
+    writeSet.clear();
+  }
+
+  virtual TransactionResult execute(std::size_t worker_id) = 0;
+
+  virtual void reset_query() = 0;
+
+  template <class KeyType, class ValueType>
+  void search_local_index(std::size_t table_id, std::size_t partition_id,
+                          const KeyType &key, ValueType &value) {
+    if (execution_phase) {
+      return;
+    }
+
+    BohmRWKey readKey;
+
+    readKey.set_table_id(table_id);
+    readKey.set_partition_id(partition_id);
+
+    readKey.set_key(&key);
+    readKey.set_value(&value);
+
+    readKey.set_local_index_read_bit();
+
+    add_to_read_set(readKey);
+  }
+
+  template <class KeyType, class ValueType>
+  void search_for_read(std::size_t table_id, std::size_t partition_id,
+                       const KeyType &key, ValueType &value) {
+    if (execution_phase) {
+      return;
+    }
+    BohmRWKey readKey;
+
+    readKey.set_table_id(table_id);
+    readKey.set_partition_id(partition_id);
+
+    readKey.set_key(&key);
+    readKey.set_value(&value);
+
+    add_to_read_set(readKey);
+  }
+
+  // reads the whole value, the fields are a hint, see FieldProjection
+  template <class KeyType, class ValueType>
+  void search_for_read(std::size_t table_id, std::size_t partition_id,
+                       const KeyType &key, ValueType &value, uint64_t fields) {
+    search_for_read(table_id, partition_id, key, value);
+  }
+
+  // only Silo, Scar and TwoPL insert and delete rows, see Tombstone
+  template <class KeyType, class ValueType>
+  bool insert(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key, const ValueType &value) {
+    CHECK(false) << "inserts are not supported.";
+    return false;
+  }
+
+  template <class KeyType>
+  void remove(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key) {
+    CHECK(false) << "deletes are not supported.";
+  }
+
+  bool is_absent(const void *key) { return false; }
+
+  // only Silo and SiloGC apply additions, see CommutativeUpdate
+  template <class KeyType, class T>
+  void add_to_field(std::size_t table_id, std::size_t partition_id,
+                    const KeyType &key, uint32_t field, T delta) {
+    CHECK(false) << "additions to fields are not supported.";
+  }
+
+  // only Silo repairs transactions, see Silo::repair
+  template <class KeyType>
+  void on_repair(const KeyType &key, std::function<void()> recompute) {}
+
+  template <class KeyType, class ValueType>
+  void search_for_update(std::size_t table_id, std::size_t partition_id,
+                         const KeyType &key, ValueType &value) {
+    search_for_read(table_id, partition_id, key, value);
+  }
+
+  // the read and write set of a transaction must be known before it runs.
+  template <class KeyType, class ValueType, class Func>
+  void scan(std::size_t table_id, std::size_t partition_id,
+            const KeyType &start, const KeyType &end, Func func) {
+    CHECK(false) << "Bohm does not support scans.";
+  }
+
+  template <class KeyType, class ValueType>
+  void update(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key, const ValueType &value) {
+    if (execution_phase) {
+      return;
+    }
+    BohmRWKey writeKey;
+
+    writeKey.set_table_id(table_id);
+    writeKey.set_partition_id(partition_id);
+
+    writeKey.set_key(&key);
+    // the object pointed by value will not be updated
+    writeKey.set_value(const_cast<ValueType *>(&value));
+
+    add_to_write_set(writeKey);
+  }
+
+  std::size_t add_to_read_set(const BohmRWKey &key) {
+    readSet.push_back(key);
+    return readSet.size() - 1;
+  }
+
+  std::size_t add_to_write_set(const BohmRWKey &key) {
+    writeSet.push_back(key);
+    return writeSet.size() - 1;
+  }
+
+  void set_id(std::size_t id) { this->id = id; }
+
+  // reads are done by the executor before the execution phase
+  bool process_requests(std::size_t worker_id) { return false; }
+
+  bool is_read_only() { return writeSet.size() == 0; }
+
+public:
+  std::size_t coordinator_id, partition_id, id;
+  Clock::time_point startTime;
+  // the type of the transaction, see Statistics::procedures
+  uint32_t procedure_id = 0;
+  std::size_t pendingResponses;
+  std::size_t network_size;
+
+  bool abort_no_retry;
+  bool distributed_transaction;
+  bool execution_phase;
+
+  Partitioner &partitioner;
+  Operation operation; // never used
+  SmallVector<BohmRWKey, N_INLINE_READ_KEYS> readSet;
+  SmallVector<BohmRWKey, N_INLINE_WRITE_KEYS> writeSet;
+};
+} // namespace coco
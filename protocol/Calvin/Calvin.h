@@ -0,0 +1,73 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Partitioner.h"
+#include "core/Table.h"
+#include "protocol/Calvin/CalvinHelper.h"
+#include "protocol/Calvin/CalvinMessage.h"
+#include "protocol/Calvin/CalvinTransaction.h"
+
+namespace coco {
+
+template <class Database> class Calvin {
+public:
+  using DatabaseType = Database;
+  using MetaDataType = std::atomic<uint64_t>;
+  using ContextType = typename DatabaseType::ContextType;
+  using MessageType = CalvinMessage;
+  using TransactionType = CalvinTransaction;
+
+  using MessageFactoryType = CalvinMessageFactory;
+  using MessageHandlerType = CalvinMessageHandler;
+
+  Calvin(DatabaseType &db, const ContextType &context, Partitioner &partitioner)
+      : db(db), context(context), partitioner(partitioner) {}
+
+  void abort(TransactionType &txn,
+             std::vector<std::unique_ptr<Message>> &messages) {
+    release_locks(txn);
+  }
+
+  bool commit(TransactionType &txn,
+              std::vector<std::unique_ptr<Message>> &messages) {
+
+    // every replica group runs the transaction, so only local writes are
+    // applied.
+
+    auto &writeSet = txn.writeSet;
+    for (auto i = 0u; i < writeSet.size(); i++) {
+      auto &writeKey = writeSet[i];
+      auto tableId = writeKey.get_table_id();
+      auto partitionId = writeKey.get_partition_id();
+      auto table = db.find_table(tableId, partitionId);
+
+      if (partitioner.has_master_partition(partitionId)) {
+        auto key = writeKey.get_key();
+        auto value = writeKey.get_value();
+        table->update(key, value);
+      }
+    }
+
+    release_locks(txn);
+    return true;
+  }
+
+  void release_locks(TransactionType &txn) {
+    for (auto &lockRequest : txn.lock_requests) {
+      if (lockRequest.write_lock) {
+        CalvinHelper::write_lock_release(*lockRequest.tid);
+      } else {
+        CalvinHelper::read_lock_release(*lockRequest.tid);
+      }
+    }
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  Partitioner &partitioner;
+};
+} // namespace coco
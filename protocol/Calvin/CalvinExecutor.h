@@ -0,0 +1,474 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Time.h"
+#include "core/MessageDispatch.h"
+#include "core/Partitioner.h"
+
+#include "common/Futex.h"
+#include "common/Histogram.h"
+#include "core/CommandLog.h"
+#include "core/Worker.h"
+#include "glog/logging.h"
+
+#include "protocol/Calvin/Calvin.h"
+#include "protocol/Calvin/CalvinHelper.h"
+#include "protocol/Calvin/CalvinMessage.h"
+
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace coco {
+
+/*
+ * The workers of a coordinator are lock managers [0, n_lock_managers) and
+ * executors [n_lock_managers, worker_num), n_lock_managers is the entry of its
+ * replica group in --lock_manager.
+ *
+ * A local row is locked by lock manager (partition id / group size) %
+ * n_lock_managers. Each lock manager walks through the batch in order, waits
+ * for the locks it grants and counts the transaction as granted. An executor
+ * runs its transactions in the order of the batch once all lock managers have
+ * gone past them, so a transaction never waits for a later one and there is no
+ * deadlock nor 2PC.
+ *
+ * Each coordinator of a replica group that a transaction touches reads its
+ * local rows and sends them to the coordinators that write, which run the
+ * transaction and apply their local writes. The read and write set must be
+ * known from the query, e.g., TPC-C with --payment_look_up is not supported.
+ */
+
+template <class Workload> class CalvinExecutor : public Worker {
+public:
+  using WorkloadType = Workload;
+  using DatabaseType = typename WorkloadType::DatabaseType;
+  using StorageType = typename WorkloadType::StorageType;
+
+  using TransactionType = CalvinTransaction;
+  static_assert(std::is_same<typename WorkloadType::TransactionType,
+                             TransactionType>::value,
+                "Transaction types do not match.");
+
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+
+  using ProtocolType = Calvin<DatabaseType>;
+
+  using MessageType = CalvinMessage;
+  using MessageFactoryType = CalvinMessageFactory;
+  using MessageHandlerType = CalvinMessageHandler;
+
+  CalvinExecutor(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
+                 const ContextType &context,
+                 std::vector<std::unique_ptr<TransactionType>> &transactions,
+                 std::vector<StorageType> &storages,
+                 std::atomic<uint32_t> &epoch,
+                 std::atomic<uint32_t> &worker_status,
+                 std::atomic<uint32_t> &n_complete_workers,
+                 std::atomic<uint32_t> &n_started_workers)
+      : Worker(coordinator_id, id), db(db), context(context),
+        transactions(transactions), storages(storages), epoch(epoch),
+        worker_status(worker_status), n_complete_workers(n_complete_workers),
+        n_started_workers(n_started_workers),
+        partitioner(std::make_unique<CalvinPartitioner>(
+            coordinator_id, context.coordinator_num, context.replica_group)),
+        workload(coordinator_id, db, random, *partitioner),
+        random(reinterpret_cast<uint64_t>(this)),
+        protocol(db, context, *partitioner) {
+
+    std::vector<std::string> lock_managers;
+    boost::algorithm::split(lock_managers, context.lock_manager,
+                            boost::is_any_of(","));
+    CHECK(lock_managers.size() == partitioner->replica_num())
+        << "one lock manager entry per replica group is required.";
+    n_lock_managers =
+        std::stoul(lock_managers[partitioner->replica_group_id()]);
+    CHECK(n_lock_managers > 0 && n_lock_managers < context.worker_num)
+        << "each replica group needs lock managers and executors.";
+    n_executors = context.worker_num - n_lock_managers;
+
+    for (auto i = 0u; i < context.coordinator_num; i++) {
+      messages.emplace_back(std::make_unique<Message>());
+      init_message(messages[i].get(), i);
+    }
+
+    messageHandlers = MessageHandlerType::get_message_handlers();
+    command_log = CommandLog::open(context, coordinator_id, id);
+  }
+
+  ~CalvinExecutor() = default;
+
+  void start() override {
+
+    LOG(INFO) << "CalvinExecutor " << id << " started. ";
+
+    for (;;) {
+
+      Futex::wait_until(worker_status, [](uint32_t s) {
+        return static_cast<ExecutorStatus>(s) == ExecutorStatus::Analysis ||
+               static_cast<ExecutorStatus>(s) == ExecutorStatus::EXIT;
+      });
+
+      if (static_cast<ExecutorStatus>(worker_status.load()) ==
+          ExecutorStatus::EXIT) {
+        LOG(INFO) << "CalvinExecutor " << id << " exits. ";
+        return;
+      }
+
+      Futex::add_and_wake(n_started_workers, 1);
+      generate_transactions();
+      Futex::add_and_wake(n_complete_workers, 1);
+      // wait to Analysis
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) != ExecutorStatus::Analysis;
+          },
+          [this]() { return process_request(); });
+      process_request();
+      Futex::add_and_wake(n_complete_workers, 1);
+
+      // wait till Execute
+      Futex::wait_until(worker_status, [](uint32_t s) {
+        return static_cast<ExecutorStatus>(s) == ExecutorStatus::Execute;
+      });
+      Futex::add_and_wake(n_started_workers, 1);
+      if (id < n_lock_managers) {
+        grant_locks();
+      } else {
+        run_transactions();
+      }
+      // the batch is released once its inputs are durable
+      if (command_log != nullptr) {
+        command_log->sync();
+      }
+      Futex::add_and_wake(n_complete_workers, 1);
+      // wait to Execute
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) != ExecutorStatus::Execute;
+          },
+          [this]() { return process_request(); });
+      process_request();
+      Futex::add_and_wake(n_complete_workers, 1);
+    }
+  }
+
+  void generate_transactions() {
+    auto cur_epoch = epoch.load();
+    if (command_log != nullptr) {
+      command_log->begin_batch(transactions.size());
+    }
+    for (auto i = id; i < transactions.size(); i += context.worker_num) {
+
+      // all coordinators generate the same batch
+      if (context.same_batch) {
+        random.init_seed(i);
+      } else {
+        random.init_seed(cur_epoch * transactions.size() + i);
+      }
+      std::size_t partition_id =
+          random.uniform_dist(0, context.partition_num - 1);
+      if (command_log != nullptr) {
+        std::size_t hot_row = 0;
+        command_log->next(i, random, partition_id, hot_row);
+      }
+      transactions[i] =
+          workload.next_transaction(context, partition_id, storages[i]);
+      transactions[i]->set_id(i);
+
+      // collect the read and write set
+      auto result = transactions[i]->execute(id);
+      if (result == TransactionResult::ABORT_NORETRY) {
+        transactions[i]->abort_no_retry = true;
+        continue;
+      }
+
+      prepare_lock_requests(*transactions[i]);
+    }
+    if (command_log != nullptr) {
+      command_log->end_batch();
+    }
+  }
+
+  void prepare_lock_requests(TransactionType &txn) {
+
+    auto group_size = partitioner->replica_group_size();
+    auto add_lock_request = [this, &txn,
+                             group_size](const CalvinRWKey &key,
+                                         bool write_lock) {
+      auto tableId = key.get_table_id();
+      auto partitionId = key.get_partition_id();
+      if (!partitioner->has_master_partition(partitionId)) {
+        return;
+      }
+      auto table = db.find_table(tableId, partitionId);
+      auto tid = std::get<0>(table->search(key.get_key()));
+      for (auto &lockRequest : txn.lock_requests) {
+        if (lockRequest.tid == tid) {
+          lockRequest.write_lock |= write_lock;
+          return;
+        }
+      }
+      txn.lock_requests.push_back(
+          {tid, partitionId / group_size % n_lock_managers, write_lock});
+    };
+
+    for (auto &readKey : txn.readSet) {
+      if (readKey.get_local_index_read_bit()) {
+        continue;
+      }
+      add_lock_request(readKey, false);
+    }
+
+    for (auto &writeKey : txn.writeSet) {
+      add_lock_request(writeKey, true);
+      auto coordinatorID =
+          partitioner->master_coordinator(writeKey.get_partition_id());
+      if (std::find(txn.active_coordinators.begin(),
+                    txn.active_coordinators.end(),
+                    coordinatorID) == txn.active_coordinators.end()) {
+        txn.active_coordinators.push_back(coordinatorID);
+      }
+    }
+
+    if (!is_active(txn)) {
+      return;
+    }
+
+    // the reads other coordinators send to this one
+    for (auto &readKey : txn.readSet) {
+      if (readKey.get_local_index_read_bit()) {
+        continue;
+      }
+      if (!partitioner->has_master_partition(readKey.get_partition_id())) {
+        txn.distributed_transaction = true;
+        txn.pendingResponses++;
+      }
+    }
+  }
+
+  bool is_active(const TransactionType &txn) const {
+    return std::find(txn.active_coordinators.begin(),
+                     txn.active_coordinators.end(),
+                     coordinator_id) != txn.active_coordinators.end();
+  }
+
+  void grant_locks() {
+    for (auto i = 0u; i < transactions.size(); i++) {
+      for (auto &lockRequest : transactions[i]->lock_requests) {
+        if (lockRequest.lock_manager_id != id) {
+          continue;
+        }
+        if (lockRequest.write_lock) {
+          CalvinHelper::write_lock(*lockRequest.tid);
+        } else {
+          CalvinHelper::read_lock(*lockRequest.tid);
+        }
+      }
+      transactions[i]->n_granted.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  void run_transactions() {
+    for (auto i = id - n_lock_managers; i < transactions.size();
+         i += n_executors) {
+      auto &txn = *transactions[i];
+
+      if (txn.abort_no_retry) {
+        if (is_recorder(txn)) {
+          stats.add(WorkerStats::ABORT_NO_RETRY);
+          record_abort(txn.procedure_id,
+                       &ProcedureStatistics::n_abort_no_retry);
+        }
+        continue;
+      }
+
+      // wait till all locks are granted
+      while (txn.n_granted.load(std::memory_order_acquire) < n_lock_managers) {
+        process_request();
+      }
+
+      read_local_rows(txn);
+      flush_messages();
+
+      if (is_active(txn)) {
+        // wait till all reads are received
+        while (txn.pendingResponses > 0) {
+          process_request();
+        }
+
+        txn.execution_phase = true;
+        auto result = txn.execute(id);
+        if (result == TransactionResult::ABORT_NORETRY) {
+          protocol.abort(txn, messages);
+          if (is_recorder(txn)) {
+            stats.add(WorkerStats::ABORT_NO_RETRY);
+            record_abort(txn.procedure_id,
+                         &ProcedureStatistics::n_abort_no_retry);
+          }
+          continue;
+        }
+      }
+
+      // only local writes are applied, a coordinator that does not write
+      // releases its read locks.
+      protocol.commit(txn, messages);
+      stats.add(WorkerStats::NETWORK_SIZE, txn.network_size);
+      if (is_recorder(txn)) {
+        stats.add(WorkerStats::COMMIT);
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                           Clock::now() - txn.startTime)
+                           .count();
+        percentile.add(latency);
+        record_latency(latency, txn.procedure_id);
+      }
+    }
+  }
+
+  void read_local_rows(TransactionType &txn) {
+
+    for (auto k = 0u; k < txn.readSet.size(); k++) {
+      auto &readKey = txn.readSet[k];
+      auto tableId = readKey.get_table_id();
+      auto partitionId = readKey.get_partition_id();
+      if (!readKey.get_local_index_read_bit() &&
+          !partitioner->has_master_partition(partitionId)) {
+        continue;
+      }
+
+      auto table = db.find_table(tableId, partitionId);
+      CalvinHelper::read(table->search(readKey.get_key()), readKey.get_value(),
+                         table->value_size());
+
+      if (readKey.get_local_index_read_bit()) {
+        continue;
+      }
+
+      for (auto coordinatorID : txn.active_coordinators) {
+        if (coordinatorID == coordinator_id) {
+          continue;
+        }
+        txn.network_size += MessageFactoryType::new_read_result_message(
+            *messages[coordinatorID], *table, txn.id, k, readKey.get_key());
+      }
+    }
+  }
+
+  // a transaction is counted once, by the master of its partition in the
+  // first replica group
+  bool is_recorder(const TransactionType &txn) const {
+    return partitioner->replica_group_id() == 0 &&
+           partitioner->has_master_partition(txn.partition_id);
+  }
+
+  void onExit() override {
+    LOG(INFO) << "Worker " << id << " latency: " << percentile.nth(50)
+              << " us (50%) " << percentile.nth(75) << " us (75%) "
+              << percentile.nth(95) << " us (95%) " << percentile.nth(99)
+              << " us (99%).";
+
+    if (command_log != nullptr) {
+      command_log->close();
+    }
+  }
+
+  void push_message(Message *message) override { in_queue.push(message); }
+
+  Message *pop_message() override {
+    if (out_queue.empty())
+      return nullptr;
+
+    Message *message = out_queue.front();
+
+    bool ok = out_queue.pop();
+    CHECK(ok);
+
+    return message;
+  }
+
+  void flush_messages() {
+
+    for (auto i = 0u; i < messages.size(); i++) {
+      if (i == coordinator_id) {
+        continue;
+      }
+
+      if (messages[i]->get_message_count() == 0) {
+        continue;
+      }
+
+      auto message = messages[i].release();
+
+      push_outgoing(out_queue, message);
+      messages[i].reset(outgoing_message_pool.get());
+      init_message(messages[i].get(), i);
+    }
+  }
+
+  // a message is handled by the worker with the same id on the destination
+  void init_message(Message *message, std::size_t dest_node_id) {
+    message->set_source_node_id(coordinator_id);
+    message->set_dest_node_id(dest_node_id);
+    message->set_worker_id(id);
+  }
+
+  std::size_t process_request() {
+
+    std::size_t size = 0;
+    if (!dispatch.is_bound()) {
+      dispatch.bind(messageHandlers);
+    }
+
+    while (!in_queue.empty()) {
+      std::unique_ptr<Message> message(in_queue.front());
+      bool ok = in_queue.pop();
+      CHECK(ok);
+
+      for (auto it = message->begin(); it != message->end(); it++) {
+
+        MessagePiece messagePiece = *it;
+        auto type = messagePiece.get_message_type();
+        DCHECK(type < messageHandlers.size());
+        ITable *table = dispatch.table(db, messagePiece);
+        dispatch(type, messagePiece, *messages[message->get_source_node_id()],
+                 *table, transactions);
+      }
+
+      size += message->get_message_count();
+      incoming_message_pool.put(message.release());
+      flush_messages();
+    }
+    return size;
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  std::vector<std::unique_ptr<TransactionType>> &transactions;
+  std::vector<StorageType> &storages;
+  std::atomic<uint32_t> &epoch, &worker_status;
+  std::atomic<uint32_t> &n_complete_workers, &n_started_workers;
+  std::unique_ptr<CalvinPartitioner> partitioner;
+  WorkloadType workload;
+  RandomType random;
+  ProtocolType protocol;
+  Histogram percentile;
+  std::unique_ptr<CommandLog> command_log;
+  std::size_t n_lock_managers, n_executors;
+  std::vector<std::unique_ptr<Message>> messages;
+  std::vector<
+      std::function<void(MessagePiece, Message &, ITable &,
+                         std::vector<std::unique_ptr<TransactionType>> &)>>
+      messageHandlers;
+  MessageDispatch<std::vector<std::unique_ptr<TransactionType>> &> dispatch;
+  LockfreeQueue<Message *> in_queue, out_queue;
+};
+} // namespace coco
@@ -0,0 +1,137 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Manager.h"
+#include "core/Partitioner.h"
+#include "protocol/Calvin/Calvin.h"
+#include "protocol/Calvin/CalvinExecutor.h"
+#include "protocol/Calvin/CalvinHelper.h"
+#include "protocol/Calvin/CalvinTransaction.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace coco {
+
+template <class Workload> class CalvinManager : public coco::Manager {
+public:
+  using base_type = coco::Manager;
+
+  using WorkloadType = Workload;
+  using DatabaseType = typename WorkloadType::DatabaseType;
+  using StorageType = typename WorkloadType::StorageType;
+
+  using TransactionType = CalvinTransaction;
+  static_assert(std::is_same<typename WorkloadType::TransactionType,
+                             TransactionType>::value,
+                "Transaction types do not match.");
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+
+  CalvinManager(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
+                const ContextType &context, std::atomic<bool> &stopFlag)
+      : base_type(coordinator_id, id, context, stopFlag), db(db), epoch(0) {
+
+    storages.resize(context.batch_size);
+    transactions.resize(context.batch_size);
+  }
+
+  void coordinator_start() override {
+
+    std::size_t n_workers = context.worker_num;
+    std::size_t n_coordinators = context.coordinator_num;
+
+    while (!stopFlag.load()) {
+
+      // the sequencer: each worker generates the transactions of the batch
+      // with seeds that are the same on all coordinators, and collects their
+      // read and write sets.
+      epoch.fetch_add(1);
+
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      signal_worker(ExecutorStatus::Analysis);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      // wait for all machines until they finish the Analysis phase.
+      wait4_ack();
+
+      // the lock managers grant locks in the order of the batch and the
+      // executors run transactions once all their locks are granted.
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      signal_worker(ExecutorStatus::Execute);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      // wait for all machines until they finish the Execute phase.
+      wait4_ack();
+    }
+
+    signal_worker(ExecutorStatus::EXIT);
+  }
+
+  void non_coordinator_start() override {
+
+    std::size_t n_workers = context.worker_num;
+    std::size_t n_coordinators = context.coordinator_num;
+
+    for (;;) {
+      ExecutorStatus status = wait4_signal();
+      if (status == ExecutorStatus::EXIT) {
+        set_worker_status(ExecutorStatus::EXIT);
+        break;
+      }
+
+      DCHECK(status == ExecutorStatus::Analysis);
+      epoch.fetch_add(1);
+
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::Analysis);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      send_ack();
+
+      status = wait4_signal();
+      DCHECK(status == ExecutorStatus::Execute);
+      n_started_workers.store(0);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::Execute);
+      wait_all_workers_start();
+      wait_all_workers_finish();
+      broadcast_stop();
+      wait4_stop(n_coordinators - 1);
+      n_completed_workers.store(0);
+      set_worker_status(ExecutorStatus::STOP);
+      wait_all_workers_finish();
+      send_ack();
+    }
+  }
+
+public:
+  RandomType random;
+  DatabaseType &db;
+  std::atomic<uint32_t> epoch;
+  std::vector<StorageType> storages;
+  std::vector<std::unique_ptr<TransactionType>> transactions;
+};
+} // namespace coco
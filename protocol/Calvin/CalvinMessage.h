@@ -0,0 +1,110 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Encoder.h"
+#include "common/Message.h"
+#include "common/MessagePiece.h"
+#include "core/ControlMessage.h"
+#include "core/Table.h"
+#include "protocol/Calvin/CalvinHelper.h"
+#include "protocol/Calvin/CalvinRWKey.h"
+#include "protocol/Calvin/CalvinTransaction.h"
+
+namespace coco {
+
+enum class CalvinMessage {
+  READ_RESULT = static_cast<int>(ControlMessage::NFIELDS),
+  NFIELDS
+};
+
+class CalvinMessageFactory {
+public:
+  static std::size_t new_read_result_message(Message &message, ITable &table,
+                                             uint32_t tid_offset,
+                                             uint32_t key_offset,
+                                             const void *key) {
+    /*
+     * The structure of a read result: (value, tid_offset, read key offset)
+     */
+
+    auto value_size = table.value_size();
+
+    auto message_size = MessagePiece::get_header_size() + value_size +
+                        sizeof(tid_offset) + sizeof(key_offset);
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(CalvinMessage::READ_RESULT), message_size,
+        table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+
+    // reserve size for read
+    message.data.append(value_size, 0);
+    void *dest = &message.data[0] + message.data.size() - value_size;
+    // read to message buffer
+    CalvinHelper::read(table.search(key), dest, value_size);
+    encoder << tid_offset << key_offset;
+    message.flush();
+    return message_size;
+  }
+};
+
+class CalvinMessageHandler {
+  using Transaction = CalvinTransaction;
+
+public:
+  static void
+  read_result_handler(MessagePiece inputPiece, Message &responseMessage,
+                      ITable &table,
+                      std::vector<std::unique_ptr<Transaction>> &txns) {
+
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(CalvinMessage::READ_RESULT));
+    auto table_id = inputPiece.get_table_id();
+    auto partition_id = inputPiece.get_partition_id();
+    DCHECK(table_id == table.tableID());
+    DCHECK(partition_id == table.partitionID());
+    auto value_size = table.value_size();
+
+    /*
+     * The structure of a read result: (value, tid_offset, read key offset)
+     */
+
+    uint32_t tid_offset, key_offset;
+
+    DCHECK(inputPiece.get_message_length() ==
+           MessagePiece::get_header_size() + value_size + sizeof(tid_offset) +
+               sizeof(key_offset));
+
+    StringPiece stringPiece = inputPiece.toStringPiece();
+    stringPiece.remove_prefix(value_size);
+    Decoder dec(stringPiece);
+    dec >> tid_offset >> key_offset;
+
+    CHECK(tid_offset < txns.size());
+    CHECK(key_offset < txns[tid_offset]->readSet.size());
+
+    CalvinRWKey &readKey = txns[tid_offset]->readSet[key_offset];
+    dec = Decoder(inputPiece.toStringPiece());
+    dec.read_n_bytes(readKey.get_value(), value_size);
+    txns[tid_offset]->pendingResponses--;
+    txns[tid_offset]->network_size += inputPiece.get_message_length();
+  }
+
+  static std::vector<
+      std::function<void(MessagePiece, Message &, ITable &,
+                         std::vector<std::unique_ptr<Transaction>> &)>>
+  get_message_handlers() {
+    std::vector<
+        std::function<void(MessagePiece, Message &, ITable &,
+                           std::vector<std::unique_ptr<Transaction>> &)>>
+        v;
+    v.resize(static_cast<int>(ControlMessage::NFIELDS));
+    v.push_back(read_result_handler);
+    return v;
+  }
+};
+} // namespace coco
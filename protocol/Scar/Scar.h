@@ -6,8 +6,14 @@
 
 #include <algorithm>
 #include <atomic>
+#include <string>
 #include <thread>
+#include <unordered_map>
 
+#include "core/BatchValidation.h"
+#include "core/EarlyValidation.h"
+#include "core/LockOrder.h"
+#include "core/OperationReplication.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
 #include "protocol/Scar/ScarHelper.h"
@@ -29,16 +35,20 @@ public:
   using MessageFactoryType = ScarMessageFactory;
   using MessageHandlerType = ScarMessageHandler;
 
+  // the rts extensions held for a coordinator before they go out anyway
+  static constexpr std::size_t RTS_BATCH_SIZE = 64;
+
   Scar(DatabaseType &db, const ContextType &context, Partitioner &partitioner)
-      : db(db), context(context), partitioner(partitioner) {}
+      : db(db), context(context), partitioner(partitioner),
+        rts_batches(partitioner.total_coordinators()) {}
 
   uint64_t search(std::size_t table_id, std::size_t partition_id,
                   const void *key, void *value) const {
 
-    ITable *table = db.find_table(table_id, partition_id);
-    auto value_bytes = table->value_size();
-    auto row = table->search(key);
-    return ScarHelper::read(row, value, value_bytes);
+    return db.visit_table(table_id, partition_id, [key, value](auto &table) {
+      auto row = table.search(key);
+      return ScarHelper::read(row, value, table.value_size());
+    });
   }
 
   void abort(TransactionType &txn,
@@ -84,6 +94,7 @@ public:
       abort(txn, messages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::LOCK);
 
     compute_commit_ts(txn);
 
@@ -92,16 +103,41 @@ public:
       abort(txn, messages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::VALIDATE);
 
     // write and replicate
     write_and_replicate(txn, messages);
 
     // release locks
     release_lock(txn, messages);
+    txn.phase_timer.end(TransactionPhase::WRITE);
 
     return true;
   }
 
+  // txn read no stale hot row so far, see EarlyValidation. The commit ts of
+  // txn is at least the wts of each read, so a read is stale once the row has
+  // a new version with a wts up to it.
+  bool validate_early(TransactionType &txn, EarlyValidation &validation) {
+    uint64_t min_commit_ts = 0;
+    for (auto i = 0u; i < txn.readSet.size(); i++) {
+      min_commit_ts = std::max(min_commit_ts,
+                               ScarHelper::get_wts(txn.readSet[i].get_tid()));
+    }
+    int stale = validation.validate(
+        db, partitioner, txn.readSet,
+        [min_commit_ts](const ScarRWKey &readKey, uint64_t latest_tid) {
+          auto wts = ScarHelper::get_wts(latest_tid);
+          return wts != ScarHelper::get_wts(readKey.get_tid()) &&
+                 wts <= min_commit_ts;
+        });
+    if (stale < 0) {
+      return true;
+    }
+    txn.set_conflict(txn.readSet[stale]);
+    return false;
+  }
+
 private:
   bool lock_write_set(TransactionType &txn,
                       std::vector<std::unique_ptr<Message>> &messages) {
@@ -109,7 +145,13 @@ private:
     auto &readSet = txn.readSet;
     auto &writeSet = txn.writeSet;
 
-    // lock records in any order. there might be dead lock.
+    // lock records in any order. there might be dead lock, so a held lock
+    // aborts txn. with --lock_ordering, locks are taken in a global order and
+    // may wait.
+    if (context.lock_ordering) {
+      lock_order.sort_and_prefetch(writeSet, db, partitioner);
+      txn.write_key_index.clear();
+    }
 
     for (auto i = 0u; i < writeSet.size(); i++) {
 
@@ -122,12 +164,16 @@ private:
       if (partitioner.has_master_partition(partitionId)) {
 
         auto key = writeKey.get_key();
-        std::atomic<uint64_t> &tid = table->search_metadata(key);
+        std::atomic<uint64_t> &tid = context.lock_ordering
+                                         ? lock_order.tid(i)
+                                         : table->search_metadata(key);
         bool success;
-        uint64_t latestTid = ScarHelper::lock(tid, success);
+        uint64_t latestTid = ScarHelper::lock(
+            tid, success, context.lock_ordering ? context.lock_spin : 0);
 
         if (!success) {
           txn.abort_lock = true;
+          txn.set_conflict(writeKey);
           break;
         }
 
@@ -140,6 +186,7 @@ private:
         uint64_t tidOnRead = readKeyPtr->get_tid();
         if (ScarHelper::get_wts(latestTid) != ScarHelper::get_wts(tidOnRead)) {
           txn.abort_lock = true;
+          txn.set_conflict(writeKey);
           break;
         }
 
@@ -180,64 +227,65 @@ private:
                          std::vector<std::unique_ptr<Message>> &messages) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
     bool use_local_validation = context.local_validation;
 
     uint64_t commit_ts = txn.commit_wts;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto needs_validation = [&txn](const ScarRWKey &readKey) {
+      // read only index does not need to validate, and a key in the write set
+      // is already validated in lock write set
+      return !readKey.get_local_index_read_bit() &&
+             txn.get_write_key(readKey.get_key()) == nullptr;
     };
 
-    for (auto i = 0u; i < readSet.size(); i++) {
-      auto &readKey = readSet[i];
-
-      if (readKey.get_local_index_read_bit()) {
-        continue; // read only index does not need to validate
-      }
-
-      bool in_write_set = isKeyInWriteSet(readKey.get_key());
-      if (in_write_set) {
-        continue; // already validated in lock write set
-      }
-
-      auto tableId = readKey.get_table_id();
-      auto partitionId = readKey.get_partition_id();
-      auto table = db.find_table(tableId, partitionId);
-      auto key = readKey.get_key();
-      uint64_t tid = readKey.get_tid();
-
-      if (partitioner.has_master_partition(partitionId)) {
+    auto is_local = [this, &readSet, &needs_validation](std::size_t i) {
+      return needs_validation(readSet[i]) &&
+             partitioner.has_master_partition(readSet[i].get_partition_id());
+    };
 
-        std::atomic<uint64_t> &latest_tid = table->search_metadata(key);
-        uint64_t written_ts = tid;
-        DCHECK(ScarHelper::is_locked(written_ts) == false);
-        if (ScarHelper::validate_read_key(latest_tid, tid, commit_ts,
-                                          written_ts)) {
+    // the local reads first, see BatchValidation
+    int conflict = BatchValidation::validate(
+        db, readSet, is_local,
+        [&readSet, commit_ts, lease = context.rts_lease](
+            std::size_t i, std::atomic<uint64_t> &latest_tid) {
+          auto &readKey = readSet[i];
+          uint64_t tid = readKey.get_tid();
+          uint64_t written_ts = tid;
+          DCHECK(ScarHelper::is_locked(written_ts) == false);
+          if (!ScarHelper::validate_read_key(latest_tid, tid, commit_ts,
+                                             written_ts, lease)) {
+            return false;
+          }
           readKey.set_read_validation_success_bit();
           if (ScarHelper::get_wts(written_ts) != ScarHelper::get_wts(tid)) {
             DCHECK(ScarHelper::get_wts(written_ts) > ScarHelper::get_wts(tid));
             readKey.set_wts_change_in_read_validation_bit();
             readKey.set_tid(written_ts);
           }
-        } else {
-          txn.abort_read_validation = true;
-          break;
-        }
-      } else {
+          return true;
+        });
+    if (conflict >= 0) {
+      txn.abort_read_validation = true;
+      txn.set_conflict(readSet[conflict]);
+    }
 
-        if (!use_local_validation || ScarHelper::get_rts(tid) < commit_ts) {
-          txn.pendingResponses++;
-          auto coordinatorID = partitioner.master_coordinator(partitionId);
-          txn.network_size += MessageFactoryType::new_read_validation_message(
-              *messages[coordinatorID], *table, key, i, tid, commit_ts);
-        }
+    for (auto i = 0u; i < readSet.size() && !txn.abort_read_validation; i++) {
+      auto &readKey = readSet[i];
+
+      if (!needs_validation(readKey) || is_local(i)) {
+        continue;
+      }
+
+      auto partitionId = readKey.get_partition_id();
+      auto table = db.find_table(readKey.get_table_id(), partitionId);
+      uint64_t tid = readKey.get_tid();
+      if (!use_local_validation || ScarHelper::get_rts(tid) < commit_ts) {
+        txn.pendingResponses++;
+        auto coordinatorID = partitioner.master_coordinator(partitionId);
+        txn.network_size += MessageFactoryType::new_read_validation_message(
+            *messages[coordinatorID], *table, readKey.get_key(), i, tid,
+            commit_ts, context.rts_lease);
       }
     }
 
@@ -258,6 +306,11 @@ private:
 
     uint64_t commit_wts = txn.commit_wts;
 
+    // with --operation_replication, the replicas replay the operation of txn
+    // instead of receiving the values, see OperationReplication.
+    bool replicate_operation =
+        OperationReplication::is_applicable(txn, partitioner);
+
     for (auto i = 0u; i < writeSet.size(); i++) {
       auto &writeKey = writeSet[i];
       auto tableId = writeKey.get_table_id();
@@ -269,7 +322,9 @@ private:
         auto key = writeKey.get_key();
         auto value = writeKey.get_value();
         std::atomic<uint64_t> &tid = table->search_metadata(key);
-        table->update(key, value);
+        if (!writeKey.get_delete_bit()) {
+          table->update(key, value);
+        }
       } else {
         txn.pendingResponses++;
         auto coordinatorID = partitioner.master_coordinator(partitionId);
@@ -278,10 +333,22 @@ private:
             writeKey.get_value());
       }
 
-      // value replicate
+      if (replicate_operation) {
+        continue;
+      }
+
+      // value replicate, a delete replicates the row as it is with a
+      // tombstone ts
 
-      replicate_record(txn, messages, tableId, partitionId, writeKey.get_key(),
-                       writeKey.get_value(), commit_wts);
+      replicate_record(
+          txn, messages, tableId, partitionId, writeKey.get_key(),
+          writeKey.get_value(),
+          ScarHelper::write_ts(commit_wts, writeKey.get_delete_bit()));
+    }
+
+    if (replicate_operation) {
+      OperationReplication::replicate(txn, commit_wts, partitioner, messages,
+                                      true);
     }
 
     replicate_read_set(txn, messages, true);
@@ -298,15 +365,9 @@ private:
                           bool skip_write_set) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto isKeyInWriteSet = [&txn](const void *key) {
+      return txn.get_write_key(key) != nullptr;
     };
 
     for (auto i = 0u; i < readSet.size(); i++) {
@@ -329,11 +390,19 @@ private:
     }
   }
 
+  /*
+   * The replicas extend the rts of the rows txn validated to the rts of the
+   * master. With --rts_lease, the master extends an rts to the commit ts plus
+   * the lease, so most reads see an rts past their commit ts and need no
+   * extension. The remaining extensions wait in rts_batches, the latest per
+   * row, and go out with the next message to the coordinator, e.g., a
+   * replication, or once RTS_BATCH_SIZE rows wait. A late extension only
+   * costs a replica a local validation, see --local_validation.
+   */
   void replicate_rts(TransactionType &txn,
                      std::vector<std::unique_ptr<Message>> &messages) {
 
     auto &readSet = txn.readSet;
-    uint64_t extend_rts = txn.commit_wts;
 
     for (auto i = 0u; i < readSet.size(); i++) {
       auto &readKey = readSet[i];
@@ -345,6 +414,8 @@ private:
         continue;
       }
 
+      uint64_t extend_rts = ScarHelper::lease_rts(
+          readKey.get_tid(), txn.commit_wts, context.rts_lease);
       if (extend_rts <= ScarHelper::get_rts(readKey.get_tid())) {
         continue;
       }
@@ -384,6 +455,13 @@ private:
           } else {
             ScarHelper::unlock(tid);
           }
+        } else if (context.rts_lease > 0) {
+          std::string row(reinterpret_cast<const char *>(&table),
+                          sizeof(table));
+          row.append(static_cast<const char *>(readKey.get_key()),
+                     table->key_size());
+          auto &ts = rts_batches[k][row];
+          ts = std::max(ts, compact_ts);
         } else {
           auto coordinatorID = k;
           txn.network_size += MessageFactoryType::new_rts_replication_message(
@@ -391,6 +469,22 @@ private:
         }
       }
     }
+
+    for (auto k = 0u; k < rts_batches.size(); k++) {
+      auto &batch = rts_batches[k];
+      if (batch.empty() || (messages[k]->get_message_count() == 0 &&
+                            batch.size() < RTS_BATCH_SIZE)) {
+        continue;
+      }
+      for (auto &row : batch) {
+        ITable *table;
+        std::memcpy(&table, row.first.data(), sizeof(table));
+        txn.network_size += MessageFactoryType::new_rts_replication_message(
+            *messages[k], *table, row.first.data() + sizeof(table),
+            row.second);
+      }
+      batch.clear();
+    }
   }
 
   void replicate_record(TransactionType &txn,
@@ -419,7 +513,8 @@ private:
       if (k == txn.coordinator_id) {
         std::atomic<uint64_t> &tid = table->search_metadata(key);
         uint64_t last_tid = ScarHelper::lock(tid);
-        DCHECK(ScarHelper::get_wts(last_tid) < commit_wts);
+        DCHECK(ScarHelper::get_wts(last_tid) <
+               ScarHelper::get_wts(commit_wts));
         table->update(key, value);
         ScarHelper::unlock(tid, commit_wts);
       } else {
@@ -430,7 +525,8 @@ private:
       }
     }
 
-    DCHECK(replicate_count == partitioner.replica_num() - 1);
+    DCHECK(replicate_count ==
+           partitioner.partition_replica_num(partition_id) - 1);
   }
 
   void release_lock(TransactionType &txn,
@@ -446,18 +542,25 @@ private:
       auto tableId = writeKey.get_table_id();
       auto partitionId = writeKey.get_partition_id();
       auto table = db.find_table(tableId, partitionId);
+      bool is_delete = writeKey.get_delete_bit();
+      uint64_t write_ts = ScarHelper::write_ts(commit_wts, is_delete);
 
       // write
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
         auto value = writeKey.get_value();
         std::atomic<uint64_t> &tid = table->search_metadata(key);
-        table->update(key, value);
-        ScarHelper::unlock(tid, commit_wts);
+        if (!is_delete) {
+          table->update(key, value);
+        }
+        ScarHelper::unlock(tid, write_ts);
+        if (is_delete) {
+          table->retire(key);
+        }
       } else {
         auto coordinatorID = partitioner.master_coordinator(partitionId);
         txn.network_size += MessageFactoryType::new_release_lock_message(
-            *messages[coordinatorID], *table, writeKey.get_key(), commit_wts);
+            *messages[coordinatorID], *table, writeKey.get_key(), write_ts);
       }
     }
 
@@ -476,7 +579,10 @@ private:
 private:
   DatabaseType &db;
   const ContextType &context;
+  LockOrder<ScarRWKey> lock_order;
   Partitioner &partitioner;
+  // row, i.e., table and key, to the latest rts extension per coordinator
+  std::vector<std::unordered_map<std::string, uint64_t>> rts_batches;
 };
 
 } // namespace coco
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "core/Executor.h"
+#include "core/OperationReplication.h"
 #include "protocol/Scar/Scar.h"
 
 namespace coco {
@@ -33,7 +34,12 @@ public:
                std::atomic<uint32_t> &n_complete_workers,
                std::atomic<uint32_t> &n_started_workers)
       : base_type(coordinator_id, id, db, context, worker_status,
-                  n_complete_workers, n_started_workers) {}
+                  n_complete_workers, n_started_workers) {
+    // inserts and deletes leave tombstones, see Tombstone
+    Tombstone::set(db, context.partition_num, ScarHelper::tombstone());
+    OperationReplication::set_message_handlers<ScarHelper>(
+        this->messageHandlers, db);
+  }
 
   ~ScarExecutor() = default;
 
@@ -67,8 +73,22 @@ public:
       }
     };
 
-    txn.remote_request_handler = [this]() { return this->process_request(); };
-    txn.message_flusher = [this]() { this->flush_messages(); };
+    txn.localTableHandler = [this](std::size_t table_id,
+                                   std::size_t partition_id) -> ITable * {
+      CHECK(this->partitioner->has_master_partition(partition_id))
+          << "inserts on partition " << partition_id << " are not local.";
+      return this->db.find_table(table_id, partition_id);
+    };
+
+    txn.remote_request_handler = [this]() {
+      return this->process_request_and_yield();
+    };
+    txn.message_flusher = [this]() { this->flush_requests(); };
+    if (this->early_validation != nullptr) {
+      txn.early_validator = [this, &txn]() {
+        return this->protocol.validate_early(txn, *this->early_validation);
+      };
+    }
   };
 };
 } // namespace coco
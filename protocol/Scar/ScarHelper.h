@@ -4,10 +4,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <tuple>
 
+#include "core/Tombstone.h"
 #include "glog/logging.h"
 
 namespace coco {
@@ -34,8 +36,11 @@ public:
     return remove_lock_bit(tid_);
   }
 
+  // with --rts_lease, the rts is extended to commit_ts + lease, so that the
+  // later reads of the row need no extension.
   static bool validate_read_key(std::atomic<uint64_t> &latest_tid, uint64_t tid,
-                                uint64_t commit_ts, uint64_t &written_ts) {
+                                uint64_t commit_ts, uint64_t &written_ts,
+                                uint64_t lease = 0) {
 
     uint64_t rts = get_rts(tid);
 
@@ -63,7 +68,7 @@ public:
       // extend the rts of the tuple
 
       if (get_rts(v1) < commit_ts) {
-        uint64_t v2 = set_rts(v1, commit_ts); // old_ts, new_ts
+        uint64_t v2 = set_rts(v1, lease_rts(v1, commit_ts, lease));
         success = latest_tid.compare_exchange_weak(v1, v2);
         if (success) {
           written_ts = remove_lock_bit(v2);
@@ -104,6 +109,18 @@ public:
     return oldValue;
   }
 
+  // the same as lock(a, success), but retries up to spins times while the
+  // lock is held by others
+  static uint64_t lock(std::atomic<uint64_t> &a, bool &success,
+                       std::size_t spins) {
+    uint64_t oldValue = lock(a, success);
+    for (auto i = 0u; !success && i < spins; i++) {
+      __asm volatile("pause" : :);
+      oldValue = lock(a, success);
+    }
+    return oldValue;
+  }
+
   static void unlock(std::atomic<uint64_t> &a) {
     uint64_t oldValue = a.load();
     DCHECK(is_locked(oldValue));
@@ -120,6 +137,20 @@ public:
     DCHECK(ok);
   }
 
+  // applies a replicated write of commit_ts, func writes the row unless it
+  // has a newer version already
+  template <class Func>
+  static void replicate(std::atomic<uint64_t> &a, uint64_t commit_ts,
+                        Func func) {
+    uint64_t last_tid = lock(a);
+    if (remove_absent_bit(commit_ts) > get_wts(last_tid)) {
+      func();
+      unlock(a, commit_ts);
+    } else {
+      unlock(a);
+    }
+  }
+
   static uint64_t remove_lock_bit(uint64_t value) {
     return value & ~(LOCK_BIT_MASK << LOCK_BIT_OFFSET);
   }
@@ -129,10 +160,29 @@ public:
   }
 
   static uint64_t set_wts(uint64_t value, uint64_t wts) {
-    DCHECK(wts < (1ull << 48));
+    DCHECK(wts < (1ull << 47));
     return (value & (~(WTS_MASK << WTS_OFFSET))) | (wts << WTS_OFFSET);
   }
 
+  /*
+   * A ts with the absent bit is a tombstone, see Tombstone. The bit is kept
+   * as the rts of the row is extended.
+   */
+
+  static bool is_absent(uint64_t value) {
+    return (value >> ABSENT_BIT_OFFSET) & ABSENT_BIT_MASK;
+  }
+
+  static uint64_t remove_absent_bit(uint64_t value) {
+    return value & ~(ABSENT_BIT_MASK << ABSENT_BIT_OFFSET);
+  }
+
+  // the ts a write of commit_ts leaves, a delete leaves a tombstone
+  static uint64_t write_ts(uint64_t commit_ts, bool is_delete) {
+    return is_delete ? commit_ts | (ABSENT_BIT_MASK << ABSENT_BIT_OFFSET)
+                     : commit_ts;
+  }
+
   static uint64_t get_delta(uint64_t value) {
     return (value >> DELTA_OFFSET) & DELTA_MASK;
   }
@@ -146,6 +196,14 @@ public:
     return get_wts(value) + get_delta(value);
   }
 
+  // the rts a read validated at commit_ts extends value to, commit_ts + lease
+  // as long as the delta does not overflow, i.e., the wts is kept
+  static uint64_t lease_rts(uint64_t value, uint64_t commit_ts,
+                            uint64_t lease) {
+    return std::max(commit_ts,
+                    std::min(commit_ts + lease, get_wts(value) + DELTA_MASK));
+  }
+
   static uint64_t set_rts(uint64_t value, uint64_t rts) {
     // handle data overflow
 
@@ -169,8 +227,17 @@ public:
   static constexpr int DELTA_OFFSET = 48;
   static constexpr uint64_t DELTA_MASK = 0x7fffull;
 
+  static constexpr int ABSENT_BIT_OFFSET = 47;
+  static constexpr uint64_t ABSENT_BIT_MASK = 0x1ull;
+
   static constexpr int WTS_OFFSET = 0;
-  static constexpr uint64_t WTS_MASK = 0xffffffffffffull;
+  static constexpr uint64_t WTS_MASK = 0x7fffffffffffull;
+
+  static constexpr Tombstone tombstone() {
+    return Tombstone{ABSENT_BIT_MASK << ABSENT_BIT_OFFSET,
+                     LOCK_BIT_MASK << LOCK_BIT_OFFSET,
+                     LOCK_BIT_MASK << LOCK_BIT_OFFSET};
+  }
 };
 
 } // namespace coco
\ No newline at end of file
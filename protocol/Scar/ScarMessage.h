@@ -63,21 +63,29 @@ public:
                                       const void *key, uint32_t key_offset) {
 
     /*
-     * The structure of a lock request: (primary key, write key offset)
+     * The structure of a lock request: (primary key, write key offset) per key
      */
 
     auto key_size = table.key_size();
 
-    auto message_size =
-        MessagePiece::get_header_size() + key_size + sizeof(key_offset);
+    auto entry_size = key_size + sizeof(key_offset);
+    auto message_size = MessagePiece::get_header_size() + entry_size;
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(ScarMessage::LOCK_REQUEST), message_size,
         table.tableID(), table.partitionID());
 
+    // the keys of the same table and partition share a piece
+    bool merge = message.can_merge(message_piece_header);
     Encoder encoder(message.data);
-    encoder << message_piece_header;
+    if (!merge) {
+      encoder << message_piece_header;
+    }
     encoder.write_n_bytes(key, key_size);
     encoder << key_offset;
+    if (merge) {
+      message.merge_into_last_piece();
+      return entry_size;
+    }
     message.flush();
     return message_size;
   }
@@ -86,25 +94,35 @@ public:
                                                  ITable &table, const void *key,
                                                  uint32_t key_offset,
                                                  uint64_t tid,
-                                                 uint64_t commit_ts) {
+                                                 uint64_t commit_ts,
+                                                 uint32_t lease) {
 
     /*
      * The structure of a read validation request: (primary key, read key
-     * offset, tid, commit_ts)
+     * offset, tid, commit_ts, lease) per key
      */
 
     auto key_size = table.key_size();
 
-    auto message_size = MessagePiece::get_header_size() + key_size +
-                        sizeof(key_offset) + sizeof(tid) + sizeof(commit_ts);
+    auto entry_size = key_size + sizeof(key_offset) + sizeof(tid) +
+                      sizeof(commit_ts) + sizeof(lease);
+    auto message_size = MessagePiece::get_header_size() + entry_size;
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(ScarMessage::READ_VALIDATION_REQUEST),
         message_size, table.tableID(), table.partitionID());
 
+    // the keys of the same table and partition share a piece
+    bool merge = message.can_merge(message_piece_header);
     Encoder encoder(message.data);
-    encoder << message_piece_header;
+    if (!merge) {
+      encoder << message_piece_header;
+    }
     encoder.write_n_bytes(key, key_size);
-    encoder << key_offset << tid << commit_ts;
+    encoder << key_offset << tid << commit_ts << lease;
+    if (merge) {
+      message.merge_into_last_piece();
+      return entry_size;
+    }
     message.flush();
     return message_size;
   }
@@ -336,39 +354,46 @@ public:
     auto key_size = table.key_size();
 
     /*
-     * The structure of a lock request: (primary key, write key offset)
-     * The structure of a lock response: (success?, tid, write key offset)
+     * The structure of a lock request: (primary key, write key offset) per key
+     * The structure of a lock response: (success?, tid, write key offset) per
+     * key
      */
 
     auto stringPiece = inputPiece.toStringPiece();
 
     uint32_t key_offset;
 
-    DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + key_size + sizeof(key_offset));
-
-    const void *key = stringPiece.data();
-    std::atomic<uint64_t> &tid = table.search_metadata(key);
-
-    bool success;
-    uint64_t latest_tid = ScarHelper::lock(tid, success);
-
-    stringPiece.remove_prefix(key_size);
-    Decoder dec(stringPiece);
-    dec >> key_offset;
-
-    DCHECK(dec.size() == 0);
+    auto entry_size = key_size + sizeof(key_offset);
+    DCHECK(stringPiece.size() % entry_size == 0);
+    auto n_keys = stringPiece.size() / entry_size;
 
     // prepare response message header
-    auto message_size = MessagePiece::get_header_size() + sizeof(bool) +
-                        sizeof(uint64_t) + sizeof(uint32_t);
+    auto message_size =
+        MessagePiece::get_header_size() +
+        n_keys * (sizeof(bool) + sizeof(uint64_t) + sizeof(uint32_t));
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(ScarMessage::LOCK_RESPONSE), message_size,
         table_id, partition_id);
 
     Encoder encoder(responseMessage.data);
     encoder << message_piece_header;
-    encoder << success << latest_tid << key_offset;
+
+    for (auto i = 0u; i < n_keys; i++) {
+      const void *key = stringPiece.data();
+      std::atomic<uint64_t> &tid = table.search_metadata(key);
+
+      bool success;
+      uint64_t latest_tid = ScarHelper::lock(tid, success);
+
+      stringPiece.remove_prefix(key_size);
+      Decoder dec(stringPiece);
+      dec >> key_offset;
+      stringPiece.remove_prefix(sizeof(key_offset));
+
+      encoder << success << latest_tid << key_offset;
+    }
+
+    DCHECK(stringPiece.size() == 0);
     responseMessage.flush();
   }
 
@@ -382,47 +407,51 @@ public:
     auto partition_id = inputPiece.get_partition_id();
     DCHECK(table_id == table.tableID());
     DCHECK(partition_id == table.partitionID());
-    auto key_size = table.key_size();
 
     /*
-     * The structure of a lock response: (success?, tid, write key offset)
+     * The structure of a lock response: (success?, tid, write key offset) per
+     * key
      */
 
     bool success;
     uint64_t latest_tid;
     uint32_t key_offset;
 
-    DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + sizeof(success) +
-               sizeof(latest_tid) + sizeof(key_offset));
-
     StringPiece stringPiece = inputPiece.toStringPiece();
+    DCHECK(stringPiece.size() %
+               (sizeof(success) + sizeof(latest_tid) + sizeof(key_offset)) ==
+           0);
     Decoder dec(stringPiece);
-    dec >> success >> latest_tid >> key_offset;
 
-    DCHECK(dec.size() == 0);
+    while (dec.size() > 0) {
+      dec >> success >> latest_tid >> key_offset;
 
-    ScarRWKey &writeKey = txn->writeSet[key_offset];
+      ScarRWKey &writeKey = txn->writeSet[key_offset];
 
-    if (success) {
+      if (success) {
 
-      ScarRWKey *readKey = txn->get_read_key(writeKey.get_key());
+        ScarRWKey *readKey = txn->get_read_key(writeKey.get_key());
 
-      DCHECK(readKey != nullptr);
+        DCHECK(readKey != nullptr);
 
-      uint64_t tid_on_read = readKey->get_tid();
+        uint64_t tid_on_read = readKey->get_tid();
 
-      if (ScarHelper::get_wts(latest_tid) != ScarHelper::get_wts(tid_on_read)) {
+        if (ScarHelper::get_wts(latest_tid) !=
+            ScarHelper::get_wts(tid_on_read)) {
+          txn->abort_lock = true;
+          txn->set_conflict(writeKey);
+        }
+
+        writeKey.set_tid(latest_tid);
+        writeKey.set_write_lock_bit();
+      } else {
         txn->abort_lock = true;
+        txn->set_conflict(writeKey);
       }
 
-      writeKey.set_tid(latest_tid);
-      writeKey.set_write_lock_bit();
-    } else {
-      txn->abort_lock = true;
+      txn->pendingResponses--;
     }
 
-    txn->pendingResponses--;
     txn->network_size += inputPiece.get_message_length();
   }
 
@@ -440,41 +469,51 @@ public:
 
     /*
      * The structure of a read validation request: (primary key, key offset,
-     *                                              tid, commit_ts)
+     *                                              tid, commit_ts, lease) per
+     *                                              key
      * The structure of a read validation response: (success?, written_ts,
-     *                                               key offset)
+     *                                               key offset) per key
      */
 
-    DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + key_size + sizeof(uint32_t) +
-               sizeof(uint64_t) + sizeof(uint64_t));
-
     auto stringPiece = inputPiece.toStringPiece();
-    const void *key = stringPiece.data();
-    std::atomic<uint64_t> &latest_tid = table.search_metadata(key);
-    stringPiece.remove_prefix(key_size);
 
-    uint32_t key_offset;
+    uint32_t key_offset, lease;
     uint64_t tid, commit_ts;
-    Decoder dec(stringPiece);
-    dec >> key_offset >> tid >> commit_ts;
-
-    uint64_t written_ts = tid;
-    DCHECK(ScarHelper::is_locked(written_ts) == false);
 
-    bool success =
-        ScarHelper::validate_read_key(latest_tid, tid, commit_ts, written_ts);
+    auto entry_size = key_size + sizeof(key_offset) + sizeof(tid) +
+                      sizeof(commit_ts) + sizeof(lease);
+    DCHECK(stringPiece.size() % entry_size == 0);
+    auto n_keys = stringPiece.size() / entry_size;
 
     // prepare response message header
-    auto message_size = MessagePiece::get_header_size() + sizeof(bool) +
-                        sizeof(uint64_t) + sizeof(uint32_t);
+    auto message_size =
+        MessagePiece::get_header_size() +
+        n_keys * (sizeof(bool) + sizeof(uint64_t) + sizeof(uint32_t));
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(ScarMessage::READ_VALIDATION_RESPONSE),
         message_size, table_id, partition_id);
 
     Encoder encoder(responseMessage.data);
     encoder << message_piece_header;
-    encoder << success << written_ts << key_offset;
+
+    for (auto i = 0u; i < n_keys; i++) {
+      const void *key = stringPiece.data();
+      std::atomic<uint64_t> &latest_tid = table.search_metadata(key);
+      stringPiece.remove_prefix(key_size);
+
+      Decoder dec(stringPiece);
+      dec >> key_offset >> tid >> commit_ts >> lease;
+      stringPiece.remove_prefix(sizeof(key_offset) + sizeof(tid) +
+                                sizeof(commit_ts) + sizeof(lease));
+
+      uint64_t written_ts = tid;
+      DCHECK(ScarHelper::is_locked(written_ts) == false);
+
+      bool success = ScarHelper::validate_read_key(latest_tid, tid, commit_ts,
+                                                   written_ts, lease);
+
+      encoder << success << written_ts << key_offset;
+    }
 
     responseMessage.flush();
   }
@@ -490,11 +529,10 @@ public:
     auto partition_id = inputPiece.get_partition_id();
     DCHECK(table_id == table.tableID());
     DCHECK(partition_id == table.partitionID());
-    auto key_size = table.key_size();
 
     /*
      * The structure of a read validation response: (success?, written_ts,
-     *                                               key offset)
+     *                                               key offset) per key
      */
 
     bool success;
@@ -503,27 +541,31 @@ public:
 
     Decoder dec(inputPiece.toStringPiece());
 
-    dec >> success >> written_ts >> key_offset;
+    while (dec.size() > 0) {
+      dec >> success >> written_ts >> key_offset;
 
-    ScarRWKey &readKey = txn->readSet[key_offset];
+      ScarRWKey &readKey = txn->readSet[key_offset];
 
-    if (success) {
-      readKey.set_read_validation_success_bit();
-      if (ScarHelper::get_wts(written_ts) !=
-          ScarHelper::get_wts(readKey.get_tid())) {
-        DCHECK(ScarHelper::get_wts(written_ts) >
-               ScarHelper::get_wts(readKey.get_tid()));
-        readKey.set_wts_change_in_read_validation_bit();
-        readKey.set_tid(written_ts);
+      if (success) {
+        readKey.set_read_validation_success_bit();
+        if (ScarHelper::get_wts(written_ts) !=
+            ScarHelper::get_wts(readKey.get_tid())) {
+          DCHECK(ScarHelper::get_wts(written_ts) >
+                 ScarHelper::get_wts(readKey.get_tid()));
+          readKey.set_wts_change_in_read_validation_bit();
+          readKey.set_tid(written_ts);
+        }
       }
-    }
 
-    txn->pendingResponses--;
-    txn->network_size += inputPiece.get_message_length();
+      txn->pendingResponses--;
 
-    if (!success) {
-      txn->abort_read_validation = true;
+      if (!success) {
+        txn->abort_read_validation = true;
+        txn->set_conflict(readKey);
+      }
     }
+
+    txn->network_size += inputPiece.get_message_length();
   }
 
   static void abort_request_handler(MessagePiece inputPiece,
@@ -654,7 +696,8 @@ public:
     std::atomic<uint64_t> &tid = table.search_metadata(key);
 
     uint64_t last_tid = ScarHelper::lock(tid);
-    if (commit_ts > ScarHelper::get_wts(last_tid)) {
+    if (ScarHelper::remove_absent_bit(commit_ts) >
+        ScarHelper::get_wts(last_tid)) {
       table.deserialize_value(key, valueStringPiece);
       ScarHelper::unlock(tid, commit_ts);
     } else {
@@ -723,6 +766,10 @@ public:
 
     std::atomic<uint64_t> &tid = table.search_metadata(key);
     ScarHelper::unlock(tid, commit_ts);
+    // the write deleted the row, see Tombstone
+    if (ScarHelper::is_absent(commit_ts)) {
+      table.retire(key);
+    }
   }
 
   static void rts_replication_request_handler(MessagePiece inputPiece,
@@ -771,6 +818,19 @@ public:
     }
   }
 
+  // the types whose pieces start with a key of their table, see
+  // MessageDispatch::prefetch_keys
+  static std::vector<uint32_t> get_keyed_messages() {
+    return {static_cast<uint32_t>(ScarMessage::SEARCH_REQUEST),
+            static_cast<uint32_t>(ScarMessage::LOCK_REQUEST),
+            static_cast<uint32_t>(ScarMessage::READ_VALIDATION_REQUEST),
+            static_cast<uint32_t>(ScarMessage::ABORT_REQUEST),
+            static_cast<uint32_t>(ScarMessage::WRITE_REQUEST),
+            static_cast<uint32_t>(ScarMessage::REPLICATION_REQUEST),
+            static_cast<uint32_t>(ScarMessage::RELEASE_LOCK_REQUEST),
+            static_cast<uint32_t>(ScarMessage::RTS_REPLICATION_REQUEST)};
+  }
+
   static std::vector<
       std::function<void(MessagePiece, Message &, ITable &, Transaction *)>>
   get_message_handlers() {
@@ -92,6 +92,32 @@ public:
            WTS_CHANGE_IN_READ_VALIDATION_BIT_MASK;
   }
 
+  // insert bit
+
+  void set_insert_bit() {
+    clear_insert_bit();
+    bitvec |= INSERT_BIT_MASK << INSERT_BIT_OFFSET;
+  }
+
+  void clear_insert_bit() { bitvec &= ~(INSERT_BIT_MASK << INSERT_BIT_OFFSET); }
+
+  bool get_insert_bit() const {
+    return (bitvec >> INSERT_BIT_OFFSET) & INSERT_BIT_MASK;
+  }
+
+  // delete bit
+
+  void set_delete_bit() {
+    clear_delete_bit();
+    bitvec |= DELETE_BIT_MASK << DELETE_BIT_OFFSET;
+  }
+
+  void clear_delete_bit() { bitvec &= ~(DELETE_BIT_MASK << DELETE_BIT_OFFSET); }
+
+  bool get_delete_bit() const {
+    return (bitvec >> DELETE_BIT_OFFSET) & DELETE_BIT_MASK;
+  }
+
   // table id
 
   void set_table_id(uint32_t table_id) {
@@ -140,10 +166,13 @@ private:
   /*
    * A bitvec is a 32-bit word.
    *
-   * [ table id (5) ] | partition id (16) | unused bit (6) |
-   * read validation success bit (1) | wts change in read validation bit (1)
-   * write lock bit(1) | read request bit (1) | local index read (1)  ]
+   * [ table id (5) ] | partition id (16) | unused bit (4) | delete bit (1) |
+   * insert bit (1) | read validation success bit (1) |
+   * wts change in read validation bit (1) | write lock bit(1) |
+   * read request bit (1) | local index read (1)  ]
    *
+   * delete bit is set when the write deletes the row.
+   * insert bit is set when the write inserts the row.
    * read validation success bit is set when read validation succeeds
    * wts change in read validation bit is set when wts changes,
    *  since delta may overflow in read validation rts extension
@@ -165,6 +194,12 @@ public:
   static constexpr uint32_t PARTITION_ID_MASK = 0xffff;
   static constexpr uint32_t PARTITION_ID_OFFSET = 11;
 
+  static constexpr uint32_t DELETE_BIT_MASK = 0x1;
+  static constexpr uint32_t DELETE_BIT_OFFSET = 6;
+
+  static constexpr uint32_t INSERT_BIT_MASK = 0x1;
+  static constexpr uint32_t INSERT_BIT_OFFSET = 5;
+
   static constexpr uint32_t READ_VALIDATION_SUCCESS_BIT_MASK = 0x1;
   static constexpr uint32_t READ_VALIDATION_SUCCESS_BIT_OFFSET = 4;
 
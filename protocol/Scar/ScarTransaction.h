@@ -6,9 +6,14 @@
 
 #include "common/Message.h"
 #include "common/Operation.h"
+#include "common/SmallVector.h"
+#include "common/Time.h"
 #include "core/Defs.h"
+#include "core/KeyIndex.h"
 #include "core/Partitioner.h"
+#include "core/Statistics.h"
 #include "core/Table.h"
+#include "protocol/Scar/ScarHelper.h"
 #include "protocol/Scar/ScarRWKey.h"
 #include <chrono>
 #include <glog/logging.h>
@@ -23,7 +28,7 @@ public:
   ScarTransaction(std::size_t coordinator_id, std::size_t partition_id,
                   Partitioner &partitioner)
       : coordinator_id(coordinator_id), partition_id(partition_id),
-        startTime(std::chrono::steady_clock::now()), partitioner(partitioner) {
+        startTime(Clock::now()), partitioner(partitioner) {
     reset();
   }
 
@@ -32,8 +37,10 @@ public:
   void reset() {
     pendingResponses = 0;
     network_size = 0;
+    phase_timer.clear();
     abort_lock = false;
     abort_read_validation = false;
+    conflict_key = nullptr;
     si_in_serializable = false;
     local_validated = false;
     distributed_transaction = false;
@@ -41,6 +48,8 @@ public:
     operation.clear();
     readSet.clear();
     writeSet.clear();
+    read_key_index.clear();
+    write_key_index.clear();
   }
 
   virtual TransactionResult execute(std::size_t worker_id) = 0;
@@ -81,6 +90,24 @@ public:
     add_to_read_set(readKey);
   }
 
+  // reads the whole value, the fields are a hint, see FieldProjection
+  template <class KeyType, class ValueType>
+  void search_for_read(std::size_t table_id, std::size_t partition_id,
+                       const KeyType &key, ValueType &value, uint64_t fields) {
+    search_for_read(table_id, partition_id, key, value);
+  }
+
+  // only Silo and SiloGC apply additions, see CommutativeUpdate
+  template <class KeyType, class T>
+  void add_to_field(std::size_t table_id, std::size_t partition_id,
+                    const KeyType &key, uint32_t field, T delta) {
+    CHECK(false) << "additions to fields are not supported.";
+  }
+
+  // only Silo repairs transactions, see Silo::repair
+  template <class KeyType>
+  void on_repair(const KeyType &key, std::function<void()> recompute) {}
+
   template <class KeyType, class ValueType>
   void search_for_update(std::size_t table_id, std::size_t partition_id,
                          const KeyType &key, ValueType &value) {
@@ -98,6 +125,13 @@ public:
     add_to_read_set(readKey);
   }
 
+  // scans need phantom protection, which is only implemented in Silo.
+  template <class KeyType, class ValueType, class Func>
+  void scan(std::size_t table_id, std::size_t partition_id,
+            const KeyType &start, const KeyType &end, Func func) {
+    CHECK(false) << "Scar does not support scans.";
+  }
+
   template <class KeyType, class ValueType>
   void update(std::size_t table_id, std::size_t partition_id,
               const KeyType &key, const ValueType &value) {
@@ -113,10 +147,79 @@ public:
     add_to_write_set(writeKey);
   }
 
+  // inserts value as the row of key of a local partition once the transaction
+  // commits, returns false if the key is present. The row is read as a
+  // tombstone right away, see Tombstone, so that an insert of the key by
+  // others in the meantime changes its wts and aborts the transaction.
+  template <class KeyType, class ValueType>
+  bool insert(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key, const ValueType &value) {
+    ITable *table = localTableHandler(table_id, partition_id);
+    uint64_t tid =
+        ScarHelper::remove_lock_bit(table->search_metadata(&key).load());
+    if (!ScarHelper::is_absent(tid)) {
+      return false;
+    }
+
+    ScarRWKey readKey;
+
+    readKey.set_table_id(table_id);
+    readKey.set_partition_id(partition_id);
+
+    readKey.set_key(&key);
+    readKey.set_value(const_cast<ValueType *>(&value));
+    readKey.set_tid(tid);
+
+    readKey.set_insert_bit();
+
+    add_to_read_set(readKey);
+
+    ScarRWKey writeKey = readKey;
+    writeKey.set_tid(0);
+    add_to_write_set(writeKey);
+    return true;
+  }
+
+  // deletes the row of key once the transaction commits, the row is read for
+  // update first. The row is left as a tombstone, see Tombstone.
+  template <class KeyType>
+  void remove(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key) {
+    auto readKey = get_read_key(&key);
+    CHECK(readKey != nullptr) << "a row is read before it is deleted.";
+
+    ScarRWKey writeKey;
+
+    writeKey.set_table_id(table_id);
+    writeKey.set_partition_id(partition_id);
+
+    writeKey.set_key(&key);
+    writeKey.set_value(readKey->get_value());
+
+    writeKey.set_delete_bit();
+
+    add_to_write_set(writeKey);
+  }
+
+  // the row of key read by the transaction is a tombstone, i.e., the key is
+  // not inserted or its row is deleted, once the reads are processed
+  bool is_absent(const void *key) {
+    auto readKey = get_read_key(key);
+    return readKey != nullptr && ScarHelper::is_absent(readKey->get_tid());
+  }
+
+  // the reads queued since the last call are issued together, i.e., the
+  // requests to a node go out in one message and the transaction waits for
+  // all responses at once
   bool process_requests(std::size_t worker_id) {
 
     // cannot use unsigned type in reverse iteration
     for (int i = int(readSet.size()) - 1; i >= 0; i--) {
+      // inserts are read right away
+      if (readSet[i].get_insert_bit()) {
+        continue;
+      }
+
       // early return
       if (!readSet[i].get_read_request_bit()) {
         break;
@@ -137,18 +240,23 @@ public:
         remote_request_handler();
       }
     }
+
+    // a stale read of a hot row aborts right away, see EarlyValidation
+    if (early_validator && !early_validator()) {
+      abort_read_validation = true;
+      return true;
+    }
     return false;
   }
 
   ScarRWKey *get_read_key(const void *key) {
+    auto i = read_key_index.find(readSet, key);
+    return i < 0 ? nullptr : &readSet[i];
+  }
 
-    for (auto i = 0u; i < readSet.size(); i++) {
-      if (readSet[i].get_key() == key) {
-        return &readSet[i];
-      }
-    }
-
-    return nullptr;
+  ScarRWKey *get_write_key(const void *key) {
+    auto i = write_key_index.find(writeSet, key);
+    return i < 0 ? nullptr : &writeSet[i];
   }
 
   std::size_t add_to_read_set(const ScarRWKey &key) {
@@ -161,13 +269,31 @@ public:
     return writeSet.size() - 1;
   }
 
+  uint64_t get_commit_ts() const { return commit_wts; }
+
+  // keeps the first row that aborts the transaction, see ConflictProfile
+  void set_conflict(const ScarRWKey &key) {
+    if (conflict_key == nullptr) {
+      conflict_key = key.get_key();
+      conflict_table_id = key.get_table_id();
+      conflict_partition_id = key.get_partition_id();
+    }
+  }
+
 public:
   std::size_t coordinator_id, partition_id;
-  std::chrono::steady_clock::time_point startTime;
+  Clock::time_point startTime;
+  // the type of the transaction, see Statistics::procedures
+  uint32_t procedure_id = 0;
+  // the priority class of the procedure, see Priorities
+  uint32_t priority = 0;
+  PhaseTimer phase_timer;
   std::size_t pendingResponses;
   std::size_t network_size;
   uint64_t commit_rts, commit_wts;
   bool abort_lock, abort_read_validation, local_validated, si_in_serializable;
+  const void *conflict_key;
+  std::size_t conflict_table_id, conflict_partition_id;
   bool distributed_transaction;
   bool execution_phase;
 
@@ -179,10 +305,16 @@ public:
   std::function<std::size_t(void)> remote_request_handler;
 
   std::function<void()> message_flusher;
+  // the table of a local partition, see insert
+  std::function<ITable *(std::size_t, std::size_t)> localTableHandler;
+  // the reads are not stale yet? optional
+  std::function<bool()> early_validator;
 
   Partitioner &partitioner;
   Operation operation;
-  std::vector<ScarRWKey> readSet, writeSet;
+  SmallVector<ScarRWKey, N_INLINE_READ_KEYS> readSet;
+  SmallVector<ScarRWKey, N_INLINE_WRITE_KEYS> writeSet;
+  KeyIndex read_key_index, write_key_index;
 };
 
 } // namespace coco
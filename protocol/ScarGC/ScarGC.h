@@ -8,6 +8,9 @@
 #include <atomic>
 #include <thread>
 
+#include "core/BatchValidation.h"
+#include "core/LockOrder.h"
+#include "core/OperationReplication.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
 #include "protocol/Scar/ScarHelper.h"
@@ -35,10 +38,10 @@ public:
   uint64_t search(std::size_t table_id, std::size_t partition_id,
                   const void *key, void *value) const {
 
-    ITable *table = db.find_table(table_id, partition_id);
-    auto value_bytes = table->value_size();
-    auto row = table->search(key);
-    return ScarHelper::read(row, value, value_bytes);
+    return db.visit_table(table_id, partition_id, [key, value](auto &table) {
+      auto row = table.search(key);
+      return ScarHelper::read(row, value, table.value_size());
+    });
   }
 
   void abort(TransactionType &txn,
@@ -86,6 +89,7 @@ public:
       abort(txn, syncMessages, asyncMessages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::LOCK);
 
     compute_commit_ts(txn);
 
@@ -94,9 +98,11 @@ public:
       abort(txn, syncMessages, asyncMessages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::VALIDATE);
 
     // write and replicate
     write_and_replicate(txn, syncMessages, asyncMessages);
+    txn.phase_timer.end(TransactionPhase::WRITE);
 
     return true;
   }
@@ -108,7 +114,13 @@ private:
     auto &readSet = txn.readSet;
     auto &writeSet = txn.writeSet;
 
-    // lock records in any order. there might be dead lock.
+    // lock records in any order. there might be dead lock, so a held lock
+    // aborts txn. with --lock_ordering, locks are taken in a global order and
+    // may wait.
+    if (context.lock_ordering) {
+      lock_order.sort_and_prefetch(writeSet, db, partitioner);
+      txn.write_key_index.clear();
+    }
 
     for (auto i = 0u; i < writeSet.size(); i++) {
 
@@ -121,11 +133,17 @@ private:
       if (partitioner.has_master_partition(partitionId)) {
 
         auto key = writeKey.get_key();
-        std::atomic<uint64_t> &tid = table->search_metadata(key);
+        std::atomic<uint64_t> &tid = context.lock_ordering
+                                         ? lock_order.tid(i)
+                                         : table->search_metadata(key);
+        // a transaction of a priority class waits, see Priorities
         bool success;
-        uint64_t latestTid = ScarHelper::lock(tid, success);
+        uint64_t latestTid = ScarHelper::lock(
+            tid, success,
+            context.lock_ordering || txn.priority > 0 ? context.lock_spin : 0);
 
         if (!success) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -138,6 +156,7 @@ private:
         DCHECK(readKeyPtr != nullptr);
         uint64_t tidOnRead = readKeyPtr->get_tid();
         if (ScarHelper::get_wts(latestTid) != ScarHelper::get_wts(tidOnRead)) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -179,64 +198,65 @@ private:
                          std::vector<std::unique_ptr<Message>> &messages) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
     bool use_local_validation = context.local_validation;
 
     uint64_t commit_ts = txn.commit_wts;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto needs_validation = [&txn](const ScarRWKey &readKey) {
+      // read only index does not need to validate, and a key in the write set
+      // is already validated in lock write set
+      return !readKey.get_local_index_read_bit() &&
+             txn.get_write_key(readKey.get_key()) == nullptr;
     };
 
-    for (auto i = 0u; i < readSet.size(); i++) {
-      auto &readKey = readSet[i];
-
-      if (readKey.get_local_index_read_bit()) {
-        continue; // read only index does not need to validate
-      }
-
-      bool in_write_set = isKeyInWriteSet(readKey.get_key());
-      if (in_write_set) {
-        continue; // already validated in lock write set
-      }
-
-      auto tableId = readKey.get_table_id();
-      auto partitionId = readKey.get_partition_id();
-      auto table = db.find_table(tableId, partitionId);
-      auto key = readKey.get_key();
-      uint64_t tid = readKey.get_tid();
-
-      if (partitioner.has_master_partition(partitionId)) {
+    auto is_local = [this, &readSet, &needs_validation](std::size_t i) {
+      return needs_validation(readSet[i]) &&
+             partitioner.has_master_partition(readSet[i].get_partition_id());
+    };
 
-        std::atomic<uint64_t> &latest_tid = table->search_metadata(key);
-        uint64_t written_ts = tid;
-        DCHECK(ScarHelper::is_locked(written_ts) == false);
-        if (ScarHelper::validate_read_key(latest_tid, tid, commit_ts,
-                                          written_ts)) {
+    // the local reads first, see BatchValidation
+    int conflict = BatchValidation::validate(
+        db, readSet, is_local,
+        [&readSet, commit_ts](std::size_t i,
+                              std::atomic<uint64_t> &latest_tid) {
+          auto &readKey = readSet[i];
+          uint64_t tid = readKey.get_tid();
+          uint64_t written_ts = tid;
+          DCHECK(ScarHelper::is_locked(written_ts) == false);
+          if (!ScarHelper::validate_read_key(latest_tid, tid, commit_ts,
+                                             written_ts)) {
+            return false;
+          }
           readKey.set_read_validation_success_bit();
           if (ScarHelper::get_wts(written_ts) != ScarHelper::get_wts(tid)) {
             DCHECK(ScarHelper::get_wts(written_ts) > ScarHelper::get_wts(tid));
             readKey.set_wts_change_in_read_validation_bit();
             readKey.set_tid(written_ts);
           }
-        } else {
-          txn.abort_read_validation = true;
-          break;
-        }
-      } else {
+          return true;
+        });
+    if (conflict >= 0) {
+      txn.abort_read_validation = true;
+      txn.set_conflict(readSet[conflict]);
+    }
 
-        if (!use_local_validation || ScarHelper::get_rts(tid) < commit_ts) {
-          txn.pendingResponses++;
-          auto coordinatorID = partitioner.master_coordinator(partitionId);
-          txn.network_size += MessageFactoryType::new_read_validation_message(
-              *messages[coordinatorID], *table, key, i, tid, commit_ts);
-        }
+    for (auto i = 0u; i < readSet.size() && !txn.abort_read_validation; i++) {
+      auto &readKey = readSet[i];
+
+      if (!needs_validation(readKey) || is_local(i)) {
+        continue;
+      }
+
+      auto partitionId = readKey.get_partition_id();
+      auto table = db.find_table(readKey.get_table_id(), partitionId);
+      uint64_t tid = readKey.get_tid();
+      if (!use_local_validation || ScarHelper::get_rts(tid) < commit_ts) {
+        txn.pendingResponses++;
+        auto coordinatorID = partitioner.master_coordinator(partitionId);
+        txn.network_size += MessageFactoryType::new_read_validation_message(
+            *messages[coordinatorID], *table, readKey.get_key(), i, tid,
+            commit_ts);
       }
     }
 
@@ -259,6 +279,11 @@ private:
 
     uint64_t commit_wts = txn.commit_wts;
 
+    // with --operation_replication, the replicas replay the operation of txn
+    // instead of receiving the values, see OperationReplication.
+    bool replicate_operation =
+        OperationReplication::is_applicable(txn, partitioner);
+
     for (auto i = 0u; i < writeSet.size(); i++) {
       auto &writeKey = writeSet[i];
       auto tableId = writeKey.get_table_id();
@@ -280,12 +305,21 @@ private:
             writeKey.get_value(), commit_wts);
       }
 
+      if (replicate_operation) {
+        continue;
+      }
+
       // value replicate
 
       replicate_record(txn, asyncMessages, tableId, partitionId,
                        writeKey.get_key(), writeKey.get_value(), commit_wts);
     }
 
+    if (replicate_operation) {
+      OperationReplication::replicate(txn, commit_wts, partitioner,
+                                      asyncMessages, false);
+    }
+
     replicate_read_set(txn, asyncMessages, true);
 
     if (context.rts_sync) {
@@ -300,15 +334,9 @@ private:
                           bool skip_write_set) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto isKeyInWriteSet = [&txn](const void *key) {
+      return txn.get_write_key(key) != nullptr;
     };
 
     for (auto i = 0u; i < readSet.size(); i++) {
@@ -432,7 +460,8 @@ private:
       }
     }
 
-    DCHECK(replicate_count == partitioner.replica_num() - 1);
+    DCHECK(replicate_count ==
+           partitioner.partition_replica_num(partition_id) - 1);
   }
 
   void sync_messages(TransactionType &txn, bool wait_response = true) {
@@ -447,6 +476,7 @@ private:
 private:
   DatabaseType &db;
   const ContextType &context;
+  LockOrder<ScarRWKey> lock_order;
   Partitioner &partitioner;
 };
 
@@ -390,12 +390,14 @@ public:
       uint64_t tid_on_read = readKey->get_tid();
 
       if (ScarHelper::get_wts(latest_tid) != ScarHelper::get_wts(tid_on_read)) {
+        txn->set_conflict(writeKey);
         txn->abort_lock = true;
       }
 
       writeKey.set_tid(latest_tid);
       writeKey.set_write_lock_bit();
     } else {
+      txn->set_conflict(writeKey);
       txn->abort_lock = true;
     }
 
@@ -499,6 +501,7 @@ public:
     txn->network_size += inputPiece.get_message_length();
 
     if (!success) {
+      txn->set_conflict(readKey);
       txn->abort_read_validation = true;
     }
   }
@@ -665,6 +668,25 @@ public:
     }
   }
 
+  // the requests a ReplicationApplier stages
+  static bool is_replication_request(uint64_t type) {
+    return type == static_cast<uint32_t>(ScarGCMessage::REPLICATION_REQUEST) ||
+           type ==
+               static_cast<uint32_t>(ScarGCMessage::RTS_REPLICATION_REQUEST);
+  }
+
+  // the types whose pieces start with a key of their table, see
+  // MessageDispatch::prefetch_keys
+  static std::vector<uint32_t> get_keyed_messages() {
+    return {static_cast<uint32_t>(ScarGCMessage::SEARCH_REQUEST),
+            static_cast<uint32_t>(ScarGCMessage::LOCK_REQUEST),
+            static_cast<uint32_t>(ScarGCMessage::READ_VALIDATION_REQUEST),
+            static_cast<uint32_t>(ScarGCMessage::ABORT_REQUEST),
+            static_cast<uint32_t>(ScarGCMessage::WRITE_REQUEST),
+            static_cast<uint32_t>(ScarGCMessage::REPLICATION_REQUEST),
+            static_cast<uint32_t>(ScarGCMessage::RTS_REPLICATION_REQUEST)};
+  }
+
   static std::vector<
       std::function<void(MessagePiece, Message &, ITable &, Transaction *)>>
   get_message_handlers() {
@@ -8,6 +8,7 @@
 #include <atomic>
 #include <thread>
 
+#include "core/LockOrder.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
 #include "protocol/Scar/ScarHelper.h"
@@ -34,10 +35,10 @@ public:
   uint64_t search(std::size_t table_id, std::size_t partition_id,
                   const void *key, void *value) const {
 
-    ITable *table = db.find_table(table_id, partition_id);
-    auto value_bytes = table->value_size();
-    auto row = table->search(key);
-    return ScarHelper::read(row, value, value_bytes);
+    return db.visit_table(table_id, partition_id, [key, value](auto &table) {
+      auto row = table.search(key);
+      return ScarHelper::read(row, value, table.value_size());
+    });
   }
 
   void abort(TransactionType &txn,
@@ -87,6 +88,7 @@ public:
       abort(txn, syncMessages, asyncMessages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::VALIDATE);
 
     compute_commit_wts(txn);
 
@@ -96,6 +98,7 @@ public:
 
     // write and replicate
     write_and_replicate(txn, syncMessages, asyncMessages);
+    txn.phase_timer.end(TransactionPhase::WRITE);
     return true;
   }
 
@@ -109,13 +112,8 @@ private:
     bool use_local_validation = context.local_validation;
     uint64_t commit_ts = txn.commit_rts;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto isKeyInWriteSet = [&txn](const void *key) {
+      return txn.get_write_key(key) != nullptr;
     };
 
     for (auto i = 0u; i < readSet.size(); i++) {
@@ -150,6 +148,7 @@ private:
             readKey.set_tid(written_ts);
           }
         } else {
+          txn.set_conflict(readKey);
           txn.abort_read_validation = true;
           break;
         }
@@ -172,7 +171,13 @@ private:
       sync_messages(txn);
     }
 
-    // lock records in any order. there might be dead lock.
+    // lock records in any order. there might be dead lock, so a held lock
+    // aborts txn. with --lock_ordering, locks are taken in a global order and
+    // may wait.
+    if (context.lock_ordering) {
+      lock_order.sort_and_prefetch(writeSet, db, partitioner);
+      txn.write_key_index.clear();
+    }
 
     for (auto i = 0u; i < writeSet.size(); i++) {
 
@@ -185,11 +190,17 @@ private:
       if (partitioner.has_master_partition(partitionId)) {
 
         auto key = writeKey.get_key();
-        std::atomic<uint64_t> &tid = table->search_metadata(key);
+        std::atomic<uint64_t> &tid = context.lock_ordering
+                                         ? lock_order.tid(i)
+                                         : table->search_metadata(key);
+        // a transaction of a priority class waits, see Priorities
         bool success;
-        uint64_t latestTid = ScarHelper::lock(tid, success);
+        uint64_t latestTid = ScarHelper::lock(
+            tid, success,
+            context.lock_ordering || txn.priority > 0 ? context.lock_spin : 0);
 
         if (!success) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -202,6 +213,7 @@ private:
         DCHECK(readKeyPtr != nullptr);
         uint64_t tidOnRead = readKeyPtr->get_tid();
         if (ScarHelper::get_wts(latestTid) != ScarHelper::get_wts(tidOnRead)) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -222,7 +234,6 @@ private:
   void compute_commit_rts(TransactionType &txn) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
     uint64_t ts = 0;
 
@@ -300,15 +311,9 @@ private:
                           bool skip_write_set) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto isKeyInWriteSet = [&txn](const void *key) {
+      return txn.get_write_key(key) != nullptr;
     };
 
     for (auto i = 0u; i < readSet.size(); i++) {
@@ -432,7 +437,8 @@ private:
       }
     }
 
-    DCHECK(replicate_count == partitioner.replica_num() - 1);
+    DCHECK(replicate_count ==
+           partitioner.partition_replica_num(partition_id) - 1);
   }
 
   void sync_messages(TransactionType &txn, bool wait_response = true) {
@@ -447,6 +453,7 @@ private:
 private:
   DatabaseType &db;
   const ContextType &context;
+  LockOrder<ScarRWKey> lock_order;
   Partitioner &partitioner;
 };
 
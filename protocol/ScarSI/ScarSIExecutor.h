@@ -34,9 +34,10 @@ public:
                  const ContextType &context,
                  std::atomic<uint32_t> &worker_status,
                  std::atomic<uint32_t> &n_complete_workers,
-                 std::atomic<uint32_t> &n_started_workers)
+                 std::atomic<uint32_t> &n_started_workers,
+                 group_commit::EpochCounters &epoch_counters)
       : base_type(coordinator_id, id, db, context, worker_status,
-                  n_complete_workers, n_started_workers) {}
+                  n_complete_workers, n_started_workers, epoch_counters) {}
 
   ~ScarSIExecutor() = default;
 
@@ -69,7 +70,7 @@ public:
     };
 
     txn.remote_request_handler = [this]() { return this->process_request(); };
-    txn.message_flusher = [this]() { this->flush_sync_messages(); };
+    txn.message_flusher = [this]() { this->flush_sync_requests(); };
   };
 };
 } // namespace coco
@@ -6,8 +6,16 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstring>
 #include <thread>
 
+#include "core/AdaptiveLocking.h"
+#include "core/BatchValidation.h"
+#include "core/CommutativeUpdate.h"
+#include "core/EarlyValidation.h"
+#include "core/HotKeys.h"
+#include "core/LockOrder.h"
+#include "core/OperationReplication.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
 #include "protocol/Silo/SiloHelper.h"
@@ -29,15 +37,40 @@ public:
   using MessageHandlerType = SiloMessageHandler;
 
   Silo(DatabaseType &db, const ContextType &context, Partitioner &partitioner)
-      : db(db), context(context), partitioner(partitioner) {}
+      : db(db), context(context), partitioner(partitioner),
+        hot_keys(HotKeys::of(context.coordinator_id, context.hot_keys)) {}
 
   uint64_t search(std::size_t table_id, std::size_t partition_id,
                   const void *key, void *value) const {
 
-    ITable *table = db.find_table(table_id, partition_id);
-    auto value_bytes = table->value_size();
-    auto row = table->search(key);
-    return SiloHelper::read(row, value, value_bytes);
+    return db.visit_table(table_id, partition_id, [key, value](auto &table) {
+      auto row = table.search(key);
+      return SiloHelper::read(row, value, table.value_size());
+    });
+  }
+
+  // reads the fields in mask only, see FieldProjection
+  uint64_t search(std::size_t table_id, std::size_t partition_id,
+                  const void *key, void *value, uint64_t fields) const {
+
+    return db.visit_table(table_id, partition_id, [=](auto &table) {
+      auto row = table.search(key);
+      return SiloHelper::read_fields(row, value, table, fields);
+    });
+  }
+
+  // tids[i] = search(table_id, partition_id, keys[i], values[i]) for i < n
+  void search_batch(std::size_t table_id, std::size_t partition_id,
+                    const void *const *keys, void *const *values,
+                    uint64_t *tids, std::size_t n) const {
+    db.visit_table(table_id, partition_id, [=](auto &table) {
+      std::tuple<MetaDataType *, void *> rows[TransactionType::MAX_BATCH_READS];
+      DCHECK(n <= TransactionType::MAX_BATCH_READS);
+      table.search_batch(keys, rows, n);
+      for (auto i = 0u; i < n; i++) {
+        tids[i] = SiloHelper::read(rows[i], values[i], table.value_size());
+      }
+    });
   }
 
   void abort(TransactionType &txn,
@@ -58,31 +91,63 @@ public:
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
         std::atomic<uint64_t> &tid = table->search_metadata(key);
-        SiloHelper::unlock(tid);
+        if (is_inside(txn, *table)) {
+          tid.store(SiloHelper::remove_lock_bit(tid.load()));
+        } else {
+          SiloHelper::unlock(tid, table->get_partition_gate());
+        }
       } else {
         auto coordinatorID = partitioner.master_coordinator(partitionId);
         txn.network_size += MessageFactoryType::new_abort_message(
             *messages[coordinatorID], *table, writeKey.get_key());
       }
     }
+    release_execution_locks(txn);
 
     sync_messages(txn, false);
+    leave_home_partition(txn);
+  }
+
+  // txn enters the gate of its home partition on its first access to it,
+  // see PartitionGate
+  void enter_home_partition(TransactionType &txn, std::size_t table_id,
+                            std::size_t partition_id) {
+    if (txn.serial_tried || partition_id != txn.partition_id) {
+      return;
+    }
+    txn.serial_tried = true;
+    auto gate = db.find_table(table_id, partition_id)->get_partition_gate();
+    if (gate != nullptr && gate->try_enter()) {
+      txn.serial_gate = gate;
+    }
   }
 
   bool commit(TransactionType &txn,
               std::vector<std::unique_ptr<Message>> &messages) {
 
+    // a hot row was held by others during execution, see lock_for_update
+    if (txn.abort_lock) {
+      abort(txn, messages);
+      return false;
+    }
+
+    if (txn.serial_gate != nullptr && txn.is_single_partition()) {
+      return commit_serial(txn, messages);
+    }
+
     // lock write set
     if (lock_write_set(txn, messages)) {
       abort(txn, messages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::LOCK);
 
     // commit phase 2, read validation
     if (!validate_read_set(txn, messages)) {
       abort(txn, messages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::VALIDATE);
 
     // generate tid
     uint64_t commit_tid = generate_tid(txn);
@@ -92,17 +157,154 @@ public:
 
     // release locks
     release_lock(txn, commit_tid, messages);
+    apply_additions(txn, messages);
+    txn.phase_timer.end(TransactionPhase::WRITE);
+    leave_home_partition(txn);
 
     return true;
   }
 
+  // txn read no stale hot row so far, see EarlyValidation. A read is stale
+  // once the tid of the row changed, its read validation fails.
+  bool validate_early(TransactionType &txn, EarlyValidation &validation) {
+    int stale = validation.validate(
+        db, partitioner, txn.readSet,
+        [](const SiloRWKey &readKey, uint64_t latest_tid) {
+          return SiloHelper::remove_lock_bit(latest_tid) != readKey.get_tid();
+        });
+    if (stale < 0) {
+      return true;
+    }
+    txn.set_conflict(txn.readSet[stale]);
+    return false;
+  }
+
+  /*
+   * With --adaptive_locking, a local hot row read for update is locked before
+   * it is read, see AdaptiveLocking. The lock is held till txn commits or
+   * aborts; lock_write_set takes it over if txn writes the row. A lock held
+   * by others is waited for lock_spin times, then txn aborts at commit.
+   */
+  void lock_for_update(TransactionType &txn, SiloRWKey &readKey,
+                       AdaptiveLocking &locking) {
+    auto table_id = readKey.get_table_id();
+    auto partition_id = readKey.get_partition_id();
+    if (readKey.get_local_index_read_bit() ||
+        !partitioner.has_master_partition(partition_id)) {
+      return;
+    }
+    enter_home_partition(txn, table_id, partition_id);
+    auto table = db.find_table(table_id, partition_id);
+    auto key = readKey.get_key();
+    // no other transaction locks the rows of the gate of txn
+    if (is_inside(txn, *table) || !locking.is_hot(*table, key)) {
+      return;
+    }
+    bool success;
+    SiloHelper::lock(table->search_metadata(key), success, context.lock_spin,
+                     table->get_partition_gate());
+    if (!success) {
+      txn.abort_lock = true;
+      txn.set_conflict(readKey);
+      return;
+    }
+    readKey.set_execution_lock_bit();
+    locking.on_lock();
+  }
+
 private:
+  // the rows locked during execution and not written, see lock_for_update
+  void release_execution_locks(TransactionType &txn) {
+    for (auto &readKey : txn.readSet) {
+      if (!readKey.get_execution_lock_bit()) {
+        continue;
+      }
+      auto table =
+          db.find_table(readKey.get_table_id(), readKey.get_partition_id());
+      SiloHelper::unlock(table->search_metadata(readKey.get_key()),
+                         table->get_partition_gate());
+      readKey.clear_execution_lock_bit();
+    }
+  }
+
+  /*
+   * txn has been inside the gate of its partition since its first read, so
+   * no row of the partition has been locked by others since, and the rows it
+   * read are still current. The rows are marked locked with plain stores for
+   * the readers, and no read is validated.
+   */
+  bool commit_serial(TransactionType &txn,
+                     std::vector<std::unique_ptr<Message>> &messages) {
+
+    for (auto i = 0u; i < txn.writeSet.size(); i++) {
+      auto &writeKey = txn.writeSet[i];
+      auto table =
+          db.find_table(writeKey.get_table_id(), writeKey.get_partition_id());
+      std::atomic<uint64_t> &tid = table->search_metadata(writeKey.get_key());
+      uint64_t latest_tid = tid.load();
+      DCHECK(SiloHelper::is_locked(latest_tid) == false);
+      tid.store(latest_tid |
+                (SiloHelper::LOCK_BIT_MASK << SiloHelper::LOCK_BIT_OFFSET));
+      writeKey.set_write_lock_bit();
+      writeKey.set_tid(latest_tid);
+    }
+    txn.phase_timer.end(TransactionPhase::LOCK);
+
+    // rows read by scans may be on other partitions
+    if (!txn.validate_scan_set([this, &txn](const MetaDataType *tid) {
+          return is_locked_by_me(txn, tid);
+        })) {
+      txn.abort_read_validation = true;
+      abort(txn, messages);
+      return false;
+    }
+    txn.local_validated = true;
+    txn.phase_timer.end(TransactionPhase::VALIDATE);
+
+    uint64_t commit_tid = generate_tid(txn);
+    write_and_replicate(txn, commit_tid, messages);
+    release_lock(txn, commit_tid, messages);
+    apply_additions(txn, messages);
+    txn.phase_timer.end(TransactionPhase::WRITE);
+    leave_home_partition(txn);
+
+    return true;
+  }
+
+  // once the locks are released, see CommutativeUpdate
+  void apply_additions(TransactionType &txn,
+                       std::vector<std::unique_ptr<Message>> &messages) {
+    if (!txn.additionSet.empty()) {
+      CommutativeUpdate::apply(txn, db, partitioner, messages);
+      sync_messages(txn, false);
+    }
+  }
+
+  // the rows of table are locked by txn alone, see PartitionGate
+  bool is_inside(const TransactionType &txn, ITable &table) const {
+    return txn.serial_gate != nullptr &&
+           table.get_partition_gate() == txn.serial_gate;
+  }
+
+  void leave_home_partition(TransactionType &txn) {
+    if (txn.serial_gate != nullptr) {
+      txn.serial_gate->leave();
+      txn.serial_gate = nullptr;
+    }
+  }
+
   bool lock_write_set(TransactionType &txn,
                       std::vector<std::unique_ptr<Message>> &messages) {
 
     auto &readSet = txn.readSet;
     auto &writeSet = txn.writeSet;
 
+    // with --lock_ordering, locks are taken in a global order and may wait
+    if (context.lock_ordering) {
+      lock_order.sort_and_prefetch(writeSet, db, partitioner);
+      txn.write_key_index.clear();
+    }
+
     for (auto i = 0u; i < writeSet.size(); i++) {
       auto &writeKey = writeSet[i];
       auto tableId = writeKey.get_table_id();
@@ -112,12 +314,27 @@ private:
       // lock local records
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
-        std::atomic<uint64_t> &tid = table->search_metadata(key);
+
+        // already locked during execution, see lock_for_update
+        auto lockedKeyPtr = txn.get_read_key(key);
+        if (lockedKeyPtr != nullptr && lockedKeyPtr->get_execution_lock_bit()) {
+          lockedKeyPtr->clear_execution_lock_bit();
+          writeKey.set_write_lock_bit();
+          writeKey.set_tid(lockedKeyPtr->get_tid());
+          continue;
+        }
+
+        std::atomic<uint64_t> &tid = context.lock_ordering
+                                         ? lock_order.tid(i)
+                                         : table->search_metadata(key);
         bool success;
-        uint64_t latestTid = SiloHelper::lock(tid, success);
+        uint64_t latestTid = SiloHelper::lock(
+            tid, success, context.lock_ordering ? context.lock_spin : 0,
+            is_inside(txn, *table) ? nullptr : table->get_partition_gate());
 
         if (!success) {
           txn.abort_lock = true;
+          txn.set_conflict(writeKey);
           break;
         }
 
@@ -128,8 +345,10 @@ private:
         // assume no blind write
         DCHECK(readKeyPtr != nullptr);
         uint64_t tidOnRead = readKeyPtr->get_tid();
-        if (latestTid != tidOnRead) {
+        if (latestTid != tidOnRead &&
+            !repair(txn, *table, *readKeyPtr, latestTid)) {
           txn.abort_lock = true;
+          txn.set_conflict(writeKey);
           break;
         }
 
@@ -146,57 +365,82 @@ private:
     return txn.abort_lock;
   }
 
+  /*
+   * With --repair, a local row in the write set that changed since txn read
+   * it is not an abort. txn holds the lock of the row, so the row is read
+   * again and stays as it is till txn commits, and the writes txn derived
+   * from the row are recomputed, see SiloTransaction::on_repair. Returns
+   * false if txn did not register a repair for the row.
+   */
+  bool repair(TransactionType &txn, ITable &table, SiloRWKey &readKey,
+              uint64_t latest_tid) {
+    if (!context.repair) {
+      return false;
+    }
+    auto recompute = txn.get_repair(readKey.get_key());
+    if (recompute == nullptr) {
+      return false;
+    }
+    std::memcpy(readKey.get_value(), table.search_value(readKey.get_key()),
+                table.value_size());
+    readKey.set_tid(latest_tid);
+    (*recompute)();
+    return true;
+  }
+
   bool validate_read_set(TransactionType &txn,
                          std::vector<std::unique_ptr<Message>> &messages) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto needs_validation = [&txn](const SiloRWKey &readKey) {
+      // read only index does not need to validate, a key in the write set
+      // is already validated in lock write set, and a row locked during
+      // execution has not changed since it was read
+      return !readKey.get_local_index_read_bit() &&
+             !readKey.get_execution_lock_bit() &&
+             txn.get_write_key(readKey.get_key()) == nullptr;
     };
 
-    for (auto i = 0u; i < readSet.size(); i++) {
-      auto &readKey = readSet[i];
+    auto is_local = [this, &readSet, &needs_validation](std::size_t i) {
+      return needs_validation(readSet[i]) &&
+             partitioner.has_master_partition(readSet[i].get_partition_id());
+    };
 
-      if (readKey.get_local_index_read_bit()) {
-        continue; // read only index does not need to validate
-      }
+    // the local reads first, see BatchValidation
+    int conflict = BatchValidation::validate(
+        db, readSet, is_local,
+        [&readSet](std::size_t i, std::atomic<uint64_t> &latest_tid) {
+          // the tid read has no lock bit, a locked row is locked by others
+          return latest_tid.load() == readSet[i].get_tid();
+        });
+    if (conflict >= 0) {
+      txn.abort_read_validation = true;
+      txn.set_conflict(readSet[conflict]);
+    }
+
+    for (auto i = 0u; i < readSet.size() && !txn.abort_read_validation; i++) {
+      auto &readKey = readSet[i];
 
-      bool in_write_set = isKeyInWriteSet(readKey.get_key());
-      if (in_write_set) {
-        continue; // already validated in lock write set
+      if (!needs_validation(readKey) || is_local(i)) {
+        continue;
       }
 
-      auto tableId = readKey.get_table_id();
       auto partitionId = readKey.get_partition_id();
-      auto table = db.find_table(tableId, partitionId);
-      auto key = readKey.get_key();
-      auto tid = readKey.get_tid();
-
-      if (partitioner.has_master_partition(partitionId)) {
-
-        uint64_t latest_tid = table->search_metadata(key).load();
-        if (SiloHelper::remove_lock_bit(latest_tid) != tid) {
-          txn.abort_read_validation = true;
-          break;
-        }
-        if (SiloHelper::is_locked(latest_tid)) { // must be locked by others
-          txn.abort_read_validation = true;
-          break;
-        }
-      } else {
+      auto table = db.find_table(readKey.get_table_id(), partitionId);
+      txn.pendingResponses++;
+      auto coordinatorID = partitioner.master_coordinator(partitionId);
+      txn.network_size += MessageFactoryType::new_read_validation_message(
+          *messages[coordinatorID], *table, readKey.get_key(), i,
+          readKey.get_tid());
+    }
 
-        txn.pendingResponses++;
-        auto coordinatorID = partitioner.master_coordinator(partitionId);
-        txn.network_size += MessageFactoryType::new_read_validation_message(
-            *messages[coordinatorID], *table, key, i, tid);
-      }
+    // rows and index nodes read by scans, all of them are local
+    if (!txn.abort_read_validation &&
+        !txn.validate_scan_set([this, &txn](const MetaDataType *tid) {
+          return is_locked_by_me(txn, tid);
+        })) {
+      txn.abort_read_validation = true;
     }
 
     if (txn.pendingResponses == 0) {
@@ -208,6 +452,30 @@ private:
     return !txn.abort_read_validation;
   }
 
+  // tid is a local row in the write set or a row locked during execution, so
+  // it is locked by txn
+  bool is_locked_by_me(TransactionType &txn, const MetaDataType *tid) {
+    for (auto &readKey : txn.readSet) {
+      if (readKey.get_execution_lock_bit() &&
+          &db.find_table(readKey.get_table_id(), readKey.get_partition_id())
+                   ->search_metadata(readKey.get_key()) == tid) {
+        return true;
+      }
+    }
+    for (auto &writeKey : txn.writeSet) {
+      auto partitionId = writeKey.get_partition_id();
+      if (!writeKey.get_write_lock_bit() ||
+          !partitioner.has_master_partition(partitionId)) {
+        continue;
+      }
+      auto table = db.find_table(writeKey.get_table_id(), partitionId);
+      if (&table->search_metadata(writeKey.get_key()) == tid) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   uint64_t generate_tid(TransactionType &txn) {
 
     auto &readSet = txn.readSet;
@@ -225,11 +493,13 @@ private:
     // larger than the TID of any record read or written by the transaction
 
     for (std::size_t i = 0; i < readSet.size(); i++) {
-      next_tid = std::max(next_tid, readSet[i].get_tid());
+      next_tid = std::max(
+          next_tid, SiloHelper::remove_absent_bit(readSet[i].get_tid()));
     }
 
     for (std::size_t i = 0; i < writeSet.size(); i++) {
-      next_tid = std::max(next_tid, writeSet[i].get_tid());
+      next_tid = std::max(
+          next_tid, SiloHelper::remove_absent_bit(writeSet[i].get_tid()));
     }
 
     // larger than the worker's most recent chosen TID
@@ -253,17 +523,38 @@ private:
     auto &readSet = txn.readSet;
     auto &writeSet = txn.writeSet;
 
+    // with --operation_replication, the replicas replay the operation of txn
+    // instead of receiving the values, see OperationReplication.
+    bool replicate_operation =
+        OperationReplication::is_applicable(txn, partitioner);
+
     for (auto i = 0u; i < writeSet.size(); i++) {
       auto &writeKey = writeSet[i];
       auto tableId = writeKey.get_table_id();
       auto partitionId = writeKey.get_partition_id();
       auto table = db.find_table(tableId, partitionId);
 
+      // with --delta_replication, replicas only receive the fields that
+      // differ from the row of the master. The master is locked and every
+      // earlier write of the row was synchronously replicated, so the copy
+      // of each replica is the same as the row before this update.
+      bool delta = false;
+      uint64_t changed_fields = 0;
+      // a delete replicates the row as it is with a tombstone tid
+      uint64_t write_tid =
+          SiloHelper::write_tid(commit_tid, writeKey.get_delete_bit());
+
       // write
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
         auto value = writeKey.get_value();
-        table->update(key, value);
+        if (context.delta_replication) {
+          delta = true;
+          changed_fields = table->changed_fields(key, value);
+        }
+        if (!writeKey.get_delete_bit()) {
+          table->update(key, value);
+        }
       } else {
         txn.pendingResponses++;
         auto coordinatorID = partitioner.master_coordinator(partitionId);
@@ -272,6 +563,10 @@ private:
             writeKey.get_value());
       }
 
+      if (replicate_operation) {
+        continue;
+      }
+
       // value replicate
 
       std::size_t replicate_count = 0;
@@ -297,20 +592,33 @@ private:
           std::atomic<uint64_t> &tid = table->search_metadata(key);
 
           uint64_t last_tid = SiloHelper::lock(tid);
-          DCHECK(last_tid < commit_tid);
+          DCHECK(SiloHelper::remove_absent_bit(last_tid) < commit_tid);
           table->update(key, value);
-          SiloHelper::unlock(tid, commit_tid);
+          SiloHelper::unlock(tid, write_tid);
 
         } else {
           txn.pendingResponses++;
           auto coordinatorID = k;
-          txn.network_size += MessageFactoryType::new_replication_message(
-              *messages[coordinatorID], *table, writeKey.get_key(),
-              writeKey.get_value(), commit_tid);
+          if (delta) {
+            txn.network_size +=
+                MessageFactoryType::new_delta_replication_message(
+                    *messages[coordinatorID], *table, writeKey.get_key(),
+                    writeKey.get_value(), changed_fields, write_tid);
+          } else {
+            txn.network_size += MessageFactoryType::new_replication_message(
+                *messages[coordinatorID], *table, writeKey.get_key(),
+                writeKey.get_value(), write_tid);
+          }
         }
       }
 
-      DCHECK(replicate_count == partitioner.replica_num() - 1);
+      DCHECK(replicate_count ==
+             partitioner.partition_replica_num(partitionId) - 1);
+    }
+
+    if (replicate_operation) {
+      OperationReplication::replicate(txn, commit_tid, partitioner, messages,
+                                      true);
     }
 
     sync_messages(txn);
@@ -327,20 +635,35 @@ private:
       auto tableId = writeKey.get_table_id();
       auto partitionId = writeKey.get_partition_id();
       auto table = db.find_table(tableId, partitionId);
+      bool is_delete = writeKey.get_delete_bit();
+      uint64_t write_tid = SiloHelper::write_tid(commit_tid, is_delete);
 
       // write
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
         auto value = writeKey.get_value();
         std::atomic<uint64_t> &tid = table->search_metadata(key);
-        table->update(key, value);
-        SiloHelper::unlock(tid, commit_tid);
+        if (!is_delete) {
+          table->update(key, value);
+        }
+        if (is_inside(txn, *table)) {
+          tid.store(write_tid);
+        } else {
+          SiloHelper::unlock(tid, write_tid, table->get_partition_gate());
+        }
+        if (is_delete) {
+          table->retire(key);
+        }
+        if (context.hot_keys > 0) {
+          hot_keys.on_write<SiloHelper>(*table, key, partitioner, messages);
+        }
       } else {
         auto coordinatorID = partitioner.master_coordinator(partitionId);
         txn.network_size += MessageFactoryType::new_release_lock_message(
-            *messages[coordinatorID], *table, writeKey.get_key(), commit_tid);
+            *messages[coordinatorID], *table, writeKey.get_key(), write_tid);
       }
     }
+    release_execution_locks(txn);
 
     sync_messages(txn, false);
   }
@@ -357,7 +680,9 @@ private:
 private:
   DatabaseType &db;
   const ContextType &context;
+  LockOrder<SiloRWKey> lock_order;
   Partitioner &partitioner;
+  HotKeys &hot_keys;
   uint64_t max_tid = 0;
 };
 
@@ -5,6 +5,9 @@
 #pragma once
 
 #include "core/Executor.h"
+#include "core/HotKeys.h"
+#include "core/OperationReplication.h"
+#include "core/RequestCombiner.h"
 #include "protocol/Silo/Silo.h"
 
 namespace coco {
@@ -33,7 +36,32 @@ public:
                std::atomic<uint32_t> &n_complete_workers,
                std::atomic<uint32_t> &n_started_workers)
       : base_type(coordinator_id, id, db, context, worker_status,
-                  n_complete_workers, n_started_workers) {}
+                  n_complete_workers, n_started_workers),
+        hot_keys(HotKeys::of(coordinator_id, context.hot_keys)) {
+    // inserts and deletes leave tombstones, see Tombstone
+    Tombstone::set(db, context.partition_num, SiloHelper::tombstone());
+    OperationReplication::set_message_handlers<SiloHelper>(
+        this->messageHandlers, db);
+    CommutativeUpdate::set_message_handlers(this->messageHandlers);
+    if (context.hot_keys > 0) {
+      HotKeys::set_message_handlers<SiloHelper>(
+          this->messageHandlers, hot_keys, *this->partitioner, this->messages,
+          static_cast<int>(SiloMessage::SEARCH_REQUEST),
+          static_cast<int>(SiloMessage::RELEASE_LOCK_REQUEST));
+    }
+
+    // with --request_combining, a search response is handed to the reads
+    // combined with it
+    if (context.request_combining) {
+      this->messageHandlers[static_cast<int>(MessageType::SEARCH_RESPONSE)] =
+          [this](MessagePiece inputPiece, Message &responseMessage,
+                 ITable &table, TransactionType *txn) {
+            MessageHandlerType::search_response_handler(
+                inputPiece, responseMessage, table, txn);
+            combine_search_response(inputPiece, table);
+          };
+    }
+  }
 
   ~
 
@@ -55,22 +83,122 @@ public:
         local_read = true;
       }
 
+      // a hot key is read from its copy, see HotKeys
+      if (!local_read && this->context.hot_keys > 0 &&
+          hot_keys.contains(*this->db.find_table(table_id, partition_id),
+                            key)) {
+        local_read = true;
+      }
+
       if (local_index_read || local_read) {
-        return this->protocol.search(table_id, partition_id, key, value);
+        this->protocol.enter_home_partition(txn, table_id, partition_id);
+        auto tid = this->protocol.search(table_id, partition_id, key, value,
+                                         txn.readSet[key_offset].get_fields());
+        // the row is on disk, the transaction is retried once it is back,
+        // see AntiCache. local index reads are not validated.
+        if (!this->context.anti_cache_path.empty() &&
+            !this->db.find_table(table_id, partition_id)->is_resident(key)) {
+          txn.abort_lock = true;
+        }
+        return tid;
       } else {
         ITable *table = this->db.find_table(table_id, partition_id);
+        auto fields = txn.readSet[key_offset].get_fields();
+        txn.pendingResponses++;
+        txn.distributed_transaction = true;
+        // another transaction of this worker is reading the row
+        RequestCombiner::Read read{MessagePiece::current_coroutine_id(),
+                                   key_offset};
+        if (this->context.request_combining &&
+            !combiner.read(*table, key, fields, read)) {
+          return 0;
+        }
         auto coordinatorID =
             this->partitioner->master_coordinator(partition_id);
         txn.network_size += MessageFactoryType::new_search_message(
-            *(this->messages[coordinatorID]), *table, key, key_offset);
-        txn.pendingResponses++;
-        txn.distributed_transaction = true;
+            *(this->messages[coordinatorID]), *table, key, key_offset, fields);
         return 0;
       }
     };
 
-    txn.remote_request_handler = [this]() { return this->process_request(); };
-    txn.message_flusher = [this]() { this->flush_messages(); };
+    txn.readBatchHandler =
+        [this, &txn](std::size_t table_id, std::size_t partition_id,
+                     const void *const *keys, void *const *values,
+                     uint64_t *tids, std::size_t n,
+                     bool local_index_read) -> bool {
+      if (!local_index_read &&
+          !this->partitioner->has_master_partition(partition_id) &&
+          !(this->partitioner->is_partition_replicated_on(
+                partition_id, this->coordinator_id) &&
+            this->context.read_on_replica)) {
+        return false;
+      }
+      this->protocol.enter_home_partition(txn, table_id, partition_id);
+      this->protocol.search_batch(table_id, partition_id, keys, values, tids,
+                                  n);
+      return true;
+    };
+
+    txn.localTableHandler = [this, &txn](std::size_t table_id,
+                                         std::size_t partition_id) -> ITable * {
+      CHECK(this->partitioner->has_master_partition(partition_id))
+          << "scans on partition " << partition_id << " are not local.";
+      this->protocol.enter_home_partition(txn, table_id, partition_id);
+      return this->db.find_table(table_id, partition_id);
+    };
+
+    txn.remote_request_handler = [this]() {
+      return this->process_request_and_yield();
+    };
+    txn.message_flusher = [this]() { this->flush_requests(); };
+    if (this->early_validation != nullptr) {
+      txn.early_validator = [this, &txn]() {
+        return this->protocol.validate_early(txn, *this->early_validation);
+      };
+    }
+    if (this->adaptive_locking != nullptr) {
+      txn.execution_locker = [this, &txn](SiloRWKey &readKey) {
+        this->protocol.lock_for_update(txn, readKey, *this->adaptive_locking);
+      };
+    }
   };
+
+  void onExit() override {
+    base_type::onExit();
+    if (this->context.request_combining) {
+      LOG(INFO) << "Worker " << this->id << " combined "
+                << combiner.get_combined() << " remote reads with "
+                << combiner.get_requests() << " search requests.";
+    }
+  }
+
+private:
+  // the reads of the row of a search response that were combined with the
+  // one it answers, see RequestCombiner
+  void combine_search_response(MessagePiece inputPiece, ITable &table) {
+    uint64_t tid;
+    uint32_t key_offset;
+    StringPiece stringPiece = inputPiece.toStringPiece();
+    auto value_size = stringPiece.size() - sizeof(tid) - sizeof(key_offset);
+    stringPiece.remove_prefix(value_size);
+    Decoder dec(stringPiece);
+    dec >> tid >> key_offset;
+
+    RequestCombiner::Read first{MessagePiece::current_coroutine_id(),
+                                key_offset};
+    combiner.respond(first, [&](RequestCombiner::Read read) {
+      auto &txn = *this->transactions[read.coroutine_id];
+      auto &readKey = txn.readSet[read.key_offset];
+      table.unpack_fields(readKey.get_value(),
+                          inputPiece.toStringPiece().data(),
+                          readKey.get_fields());
+      readKey.set_tid(tid);
+      txn.pendingResponses--;
+    });
+  }
+
+private:
+  HotKeys &hot_keys;
+  RequestCombiner combiner;
 };
 } // namespace coco
@@ -5,7 +5,11 @@
 #pragma once
 
 #include <atomic>
+#include <cstring>
+#include <tuple>
 
+#include "core/PartitionGate.h"
+#include "core/Tombstone.h"
 #include "glog/logging.h"
 
 namespace coco {
@@ -17,6 +21,13 @@ public:
 
   static uint64_t read(const std::tuple<MetaDataType *, void *> &row,
                        void *dest, std::size_t size) {
+    return remove_lock_bit(read_with_lock_bit(row, dest, size));
+  }
+
+  // the same as read, but the tid keeps the lock bit of the row
+  static uint64_t
+  read_with_lock_bit(const std::tuple<MetaDataType *, void *> &row,
+                     void *dest, std::size_t size) {
 
     MetaDataType &tid = *std::get<0>(row);
     void *src = std::get<1>(row);
@@ -29,6 +40,41 @@ public:
       std::memcpy(dest, src, size);
     } while (tid_ != tid.load());
 
+    return tid_;
+  }
+
+  // reads the fields in mask of row, see FieldProjection. The calls to a
+  // typed table are not virtual.
+  template <class TableType>
+  static uint64_t read_fields(const std::tuple<MetaDataType *, void *> &row,
+                              void *dest, TableType &table, uint64_t mask) {
+
+    MetaDataType &tid = *std::get<0>(row);
+    void *src = std::get<1>(row);
+
+    uint64_t tid_;
+    do {
+      tid_ = tid.load();
+      table.copy_fields(dest, src, mask);
+    } while (tid_ != tid.load());
+
+    return remove_lock_bit(tid_);
+  }
+
+  // packs the fields in mask of row to dest, see FieldProjection
+  template <class TableType>
+  static uint64_t pack_fields(const std::tuple<MetaDataType *, void *> &row,
+                              char *dest, TableType &table, uint64_t mask) {
+
+    MetaDataType &tid = *std::get<0>(row);
+    void *src = std::get<1>(row);
+
+    uint64_t tid_;
+    do {
+      tid_ = tid.load();
+      table.pack_fields(dest, src, mask);
+    } while (tid_ != tid.load());
+
     return remove_lock_bit(tid_);
   }
 
@@ -60,6 +106,48 @@ public:
     return oldValue;
   }
 
+  // the same as lock(a, success), but retries up to spins times while the
+  // lock is held by others
+  static uint64_t lock(std::atomic<uint64_t> &a, bool &success,
+                       std::size_t spins) {
+    uint64_t oldValue = lock(a, success);
+    for (auto i = 0u; !success && i < spins; i++) {
+      __asm volatile("pause" : :);
+      oldValue = lock(a, success);
+    }
+    return oldValue;
+  }
+
+  // the same as lock(a, success, spins) on a row of the partition of gate,
+  // fails while a transaction is inside the gate, see PartitionGate
+  static uint64_t lock(std::atomic<uint64_t> &a, bool &success,
+                       std::size_t spins, PartitionGate *gate) {
+    if (gate != nullptr && !gate->lock_row()) {
+      success = false;
+      return a.load();
+    }
+    uint64_t oldValue = lock(a, success, spins);
+    if (!success && gate != nullptr) {
+      gate->unlock_row();
+    }
+    return oldValue;
+  }
+
+  static void unlock(std::atomic<uint64_t> &a, PartitionGate *gate) {
+    unlock(a);
+    if (gate != nullptr) {
+      gate->unlock_row();
+    }
+  }
+
+  static void unlock(std::atomic<uint64_t> &a, uint64_t newValue,
+                     PartitionGate *gate) {
+    unlock(a, newValue);
+    if (gate != nullptr) {
+      gate->unlock_row();
+    }
+  }
+
   static void unlock(std::atomic<uint64_t> &a) {
     uint64_t oldValue = a.load();
     DCHECK(is_locked(oldValue));
@@ -76,13 +164,55 @@ public:
     DCHECK(ok);
   }
 
+  // applies a replicated write of commit_tid, func writes the row unless it
+  // has a newer version already
+  template <class Func>
+  static void replicate(std::atomic<uint64_t> &a, uint64_t commit_tid,
+                        Func func) {
+    uint64_t last_tid = lock(a);
+    if (remove_absent_bit(commit_tid) > remove_absent_bit(last_tid)) {
+      func();
+      unlock(a, commit_tid);
+    } else {
+      unlock(a);
+    }
+  }
+
   static uint64_t remove_lock_bit(uint64_t value) {
     return value & ~(LOCK_BIT_MASK << LOCK_BIT_OFFSET);
   }
 
+  /*
+   * A tid with the absent bit is a tombstone, see Tombstone. tids are ordered
+   * without the bit.
+   */
+
+  static bool is_absent(uint64_t value) {
+    return (value >> ABSENT_BIT_OFFSET) & ABSENT_BIT_MASK;
+  }
+
+  static uint64_t remove_absent_bit(uint64_t value) {
+    return value & ~(ABSENT_BIT_MASK << ABSENT_BIT_OFFSET);
+  }
+
+  // the tid a write of commit_tid leaves, a delete leaves a tombstone
+  static uint64_t write_tid(uint64_t commit_tid, bool is_delete) {
+    return is_delete ? commit_tid | (ABSENT_BIT_MASK << ABSENT_BIT_OFFSET)
+                     : commit_tid;
+  }
+
 public:
   static constexpr int LOCK_BIT_OFFSET = 63;
   static constexpr uint64_t LOCK_BIT_MASK = 0x1ull;
+
+  static constexpr int ABSENT_BIT_OFFSET = 62;
+  static constexpr uint64_t ABSENT_BIT_MASK = 0x1ull;
+
+  static constexpr Tombstone tombstone() {
+    return Tombstone{ABSENT_BIT_MASK << ABSENT_BIT_OFFSET,
+                     LOCK_BIT_MASK << LOCK_BIT_OFFSET,
+                     LOCK_BIT_MASK << LOCK_BIT_OFFSET};
+  }
 };
 
 } // namespace coco
\ No newline at end of file
@@ -29,6 +29,7 @@ enum class SiloMessage {
   REPLICATION_REQUEST,
   REPLICATION_RESPONSE,
   RELEASE_LOCK_REQUEST,
+  DELTA_REPLICATION_REQUEST,
   NFIELDS
 };
 
@@ -36,16 +37,19 @@ class SiloMessageFactory {
 
 public:
   static std::size_t new_search_message(Message &message, ITable &table,
-                                        const void *key, uint32_t key_offset) {
+                                        const void *key, uint32_t key_offset,
+                                        uint64_t fields = ~0ull) {
 
     /*
-     * The structure of a search request: (primary key, read key offset)
+     * The structure of a search request: (primary key, read key offset), and
+     * the fields read unless all of them are, see FieldProjection
      */
 
     auto key_size = table.key_size();
+    bool projected = fields != ~0ull;
 
-    auto message_size =
-        MessagePiece::get_header_size() + key_size + sizeof(key_offset);
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        sizeof(key_offset) + projected * sizeof(fields);
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(SiloMessage::SEARCH_REQUEST), message_size,
         table.tableID(), table.partitionID());
@@ -54,6 +58,9 @@ public:
     encoder << message_piece_header;
     encoder.write_n_bytes(key, key_size);
     encoder << key_offset;
+    if (projected) {
+      encoder << fields;
+    }
     message.flush();
     return message_size;
   }
@@ -62,21 +69,29 @@ public:
                                       const void *key, uint32_t key_offset) {
 
     /*
-     * The structure of a lock request: (primary key, write key offset)
+     * The structure of a lock request: (primary key, write key offset) per key
      */
 
     auto key_size = table.key_size();
 
-    auto message_size =
-        MessagePiece::get_header_size() + key_size + sizeof(key_offset);
+    auto entry_size = key_size + sizeof(key_offset);
+    auto message_size = MessagePiece::get_header_size() + entry_size;
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(SiloMessage::LOCK_REQUEST), message_size,
         table.tableID(), table.partitionID());
 
+    // the keys of the same table and partition share a piece
+    bool merge = message.can_merge(message_piece_header);
     Encoder encoder(message.data);
-    encoder << message_piece_header;
+    if (!merge) {
+      encoder << message_piece_header;
+    }
     encoder.write_n_bytes(key, key_size);
     encoder << key_offset;
+    if (merge) {
+      message.merge_into_last_piece();
+      return entry_size;
+    }
     message.flush();
     return message_size;
   }
@@ -88,21 +103,29 @@ public:
 
     /*
      * The structure of a read validation request: (primary key, read key
-     * offset, tid)
+     * offset, tid) per key
      */
 
     auto key_size = table.key_size();
 
-    auto message_size = MessagePiece::get_header_size() + key_size +
-                        sizeof(key_offset) + sizeof(tid);
+    auto entry_size = key_size + sizeof(key_offset) + sizeof(tid);
+    auto message_size = MessagePiece::get_header_size() + entry_size;
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(SiloMessage::READ_VALIDATION_REQUEST),
         message_size, table.tableID(), table.partitionID());
 
+    // the keys of the same table and partition share a piece
+    bool merge = message.can_merge(message_piece_header);
     Encoder encoder(message.data);
-    encoder << message_piece_header;
+    if (!merge) {
+      encoder << message_piece_header;
+    }
     encoder.write_n_bytes(key, key_size);
     encoder << key_offset << tid;
+    if (merge) {
+      message.merge_into_last_piece();
+      return entry_size;
+    }
     message.flush();
     return message_size;
   }
@@ -178,6 +201,36 @@ public:
     return message_size;
   }
 
+  static std::size_t new_delta_replication_message(Message &message,
+                                                   ITable &table,
+                                                   const void *key,
+                                                   const void *value,
+                                                   uint64_t mask,
+                                                   uint64_t commit_tid) {
+
+    /*
+     * The structure of a delta replication request: (primary key, commit_tid,
+     * changed fields mask, changed field values)
+     */
+
+    auto key_size = table.key_size();
+    auto fields_size = table.fields_size(mask);
+
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        sizeof(commit_tid) + sizeof(mask) + fields_size;
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(SiloMessage::DELTA_REPLICATION_REQUEST),
+        message_size, table.tableID(), table.partitionID());
+
+    Encoder encoder(message.data);
+    encoder << message_piece_header;
+    encoder.write_n_bytes(key, key_size);
+    encoder << commit_tid << mask;
+    table.serialize_fields(encoder, value, mask);
+    message.flush();
+    return message_size;
+  }
+
   static std::size_t new_release_lock_message(Message &message, ITable &table,
                                               const void *key,
                                               uint64_t commit_tid) {
@@ -216,18 +269,24 @@ public:
     DCHECK(table_id == table.tableID());
     DCHECK(partition_id == table.partitionID());
     auto key_size = table.key_size();
-    auto value_size = table.value_size();
 
     /*
-     * The structure of a read request: (primary key, read key offset)
-     * The structure of a read response: (value, tid, read key offset)
+     * The structure of a read request: (primary key, read key offset[,
+     * fields])
+     * The structure of a read response: (fields of value, tid, read key
+     * offset)
      */
 
     auto stringPiece = inputPiece.toStringPiece();
     uint32_t key_offset;
+    uint64_t fields = ~0ull;
 
     DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + key_size + sizeof(key_offset));
+               MessagePiece::get_header_size() + key_size +
+                   sizeof(key_offset) ||
+           inputPiece.get_message_length() ==
+               MessagePiece::get_header_size() + key_size +
+                   sizeof(key_offset) + sizeof(fields));
 
     // get row and offset
     const void *key = stringPiece.data();
@@ -236,8 +295,12 @@ public:
     stringPiece.remove_prefix(key_size);
     coco::Decoder dec(stringPiece);
     dec >> key_offset;
+    if (dec.size() > 0) {
+      dec >> fields;
+    }
 
     DCHECK(dec.size() == 0);
+    auto value_size = table.projection_size(fields);
 
     // prepare response message header
     auto message_size = MessagePiece::get_header_size() + value_size +
@@ -251,10 +314,10 @@ public:
 
     // reserve size for read
     responseMessage.data.append(value_size, 0);
-    void *dest =
+    char *dest =
         &responseMessage.data[0] + responseMessage.data.size() - value_size;
     // read to message buffer
-    auto tid = SiloHelper::read(row, dest, value_size);
+    auto tid = SiloHelper::pack_fields(row, dest, table, fields);
 
     encoder << tid << key_offset;
     responseMessage.flush();
@@ -269,28 +332,24 @@ public:
     auto partition_id = inputPiece.get_partition_id();
     DCHECK(table_id == table.tableID());
     DCHECK(partition_id == table.partitionID());
-    auto key_size = table.key_size();
-    auto value_size = table.value_size();
-
     /*
-     * The structure of a read response: (value, tid, read key offset)
+     * The structure of a read response: (fields of value, tid, read key
+     * offset)
      */
 
     uint64_t tid;
     uint32_t key_offset;
 
-    DCHECK(inputPiece.get_message_length() == MessagePiece::get_header_size() +
-                                                  value_size + sizeof(tid) +
-                                                  sizeof(key_offset));
-
     StringPiece stringPiece = inputPiece.toStringPiece();
+    auto value_size = stringPiece.size() - sizeof(tid) - sizeof(key_offset);
     stringPiece.remove_prefix(value_size);
     Decoder dec(stringPiece);
     dec >> tid >> key_offset;
 
     SiloRWKey &readKey = txn->readSet[key_offset];
-    dec = Decoder(inputPiece.toStringPiece());
-    dec.read_n_bytes(readKey.get_value(), value_size);
+    DCHECK(value_size == table.projection_size(readKey.get_fields()));
+    table.unpack_fields(readKey.get_value(), inputPiece.toStringPiece().data(),
+                        readKey.get_fields());
     readKey.set_tid(tid);
     txn->pendingResponses--;
     txn->network_size += inputPiece.get_message_length();
@@ -308,39 +367,47 @@ public:
     auto key_size = table.key_size();
 
     /*
-     * The structure of a lock request: (primary key, write key offset)
-     * The structure of a lock response: (success?, tid, write key offset)
+     * The structure of a lock request: (primary key, write key offset) per key
+     * The structure of a lock response: (success?, tid, write key offset) per
+     * key
      */
 
     auto stringPiece = inputPiece.toStringPiece();
 
     uint32_t key_offset;
 
-    DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + key_size + sizeof(key_offset));
-
-    const void *key = stringPiece.data();
-    std::atomic<uint64_t> &tid = table.search_metadata(key);
-
-    bool success;
-    uint64_t latest_tid = SiloHelper::lock(tid, success);
-
-    stringPiece.remove_prefix(key_size);
-    coco::Decoder dec(stringPiece);
-    dec >> key_offset;
-
-    DCHECK(dec.size() == 0);
+    auto entry_size = key_size + sizeof(key_offset);
+    DCHECK(stringPiece.size() % entry_size == 0);
+    auto n_keys = stringPiece.size() / entry_size;
 
     // prepare response message header
-    auto message_size = MessagePiece::get_header_size() + sizeof(bool) +
-                        sizeof(uint64_t) + sizeof(uint32_t);
+    auto message_size =
+        MessagePiece::get_header_size() +
+        n_keys * (sizeof(bool) + sizeof(uint64_t) + sizeof(uint32_t));
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(SiloMessage::LOCK_RESPONSE), message_size,
         table_id, partition_id);
 
     coco::Encoder encoder(responseMessage.data);
     encoder << message_piece_header;
-    encoder << success << latest_tid << key_offset;
+
+    for (auto i = 0u; i < n_keys; i++) {
+      const void *key = stringPiece.data();
+      std::atomic<uint64_t> &tid = table.search_metadata(key);
+
+      bool success;
+      uint64_t latest_tid =
+          SiloHelper::lock(tid, success, 0, table.get_partition_gate());
+
+      stringPiece.remove_prefix(key_size);
+      coco::Decoder dec(stringPiece);
+      dec >> key_offset;
+      stringPiece.remove_prefix(sizeof(key_offset));
+
+      encoder << success << latest_tid << key_offset;
+    }
+
+    DCHECK(stringPiece.size() == 0);
     responseMessage.flush();
   }
 
@@ -353,52 +420,54 @@ public:
     auto partition_id = inputPiece.get_partition_id();
     DCHECK(table_id == table.tableID());
     DCHECK(partition_id == table.partitionID());
-    auto key_size = table.key_size();
 
     /*
-     * The structure of a lock response: (success?, tid, write key offset)
+     * The structure of a lock response: (success?, tid, write key offset) per
+     * key
      */
 
     bool success;
     uint64_t latest_tid;
     uint32_t key_offset;
 
-    DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + sizeof(success) +
-               sizeof(latest_tid) + sizeof(key_offset));
-
     StringPiece stringPiece = inputPiece.toStringPiece();
+    DCHECK(stringPiece.size() %
+               (sizeof(success) + sizeof(latest_tid) + sizeof(key_offset)) ==
+           0);
     Decoder dec(stringPiece);
-    dec >> success >> latest_tid >> key_offset;
 
-    DCHECK(dec.size() == 0);
+    while (dec.size() > 0) {
+      dec >> success >> latest_tid >> key_offset;
 
-    SiloRWKey &writeKey = txn->writeSet[key_offset];
+      SiloRWKey &writeKey = txn->writeSet[key_offset];
 
-    bool tid_changed = false;
+      bool tid_changed = false;
 
-    if (success) {
+      if (success) {
 
-      SiloRWKey *readKey = txn->get_read_key(writeKey.get_key());
+        SiloRWKey *readKey = txn->get_read_key(writeKey.get_key());
 
-      DCHECK(readKey != nullptr);
+        DCHECK(readKey != nullptr);
 
-      uint64_t tid_on_read = readKey->get_tid();
+        uint64_t tid_on_read = readKey->get_tid();
 
-      if (latest_tid != tid_on_read) {
-        tid_changed = true;
+        if (latest_tid != tid_on_read) {
+          tid_changed = true;
+        }
+
+        writeKey.set_tid(latest_tid);
+        writeKey.set_write_lock_bit();
       }
 
-      writeKey.set_tid(latest_tid);
-      writeKey.set_write_lock_bit();
+      txn->pendingResponses--;
+
+      if (!success || tid_changed) {
+        txn->abort_lock = true;
+        txn->set_conflict(writeKey);
+      }
     }
 
-    txn->pendingResponses--;
     txn->network_size += inputPiece.get_message_length();
-
-    if (!success || tid_changed) {
-      txn->abort_lock = true;
-    }
   }
 
   static void read_validation_request_handler(MessagePiece inputPiece,
@@ -414,44 +483,50 @@ public:
 
     /*
      * The structure of a read validation request: (primary key, read key
-     * offset, tid) The structure of a read validation response: (success?, read
-     * key offset)
+     * offset, tid) per key. The structure of a read validation response:
+     * (success?, read key offset) per key
      */
 
-    DCHECK(inputPiece.get_message_length() == MessagePiece::get_header_size() +
-                                                  key_size + sizeof(uint32_t) +
-                                                  sizeof(uint64_t));
-
     auto stringPiece = inputPiece.toStringPiece();
-    const void *key = stringPiece.data();
-    auto latest_tid = table.search_metadata(key).load();
-    stringPiece.remove_prefix(key_size);
 
     uint32_t key_offset;
     uint64_t tid;
-    Decoder dec(stringPiece);
-    dec >> key_offset >> tid;
 
-    bool success = true;
-
-    if (SiloHelper::remove_lock_bit(latest_tid) != tid) {
-      success = false;
-    }
-
-    if (SiloHelper::is_locked(latest_tid)) { // must be locked by others
-      success = false;
-    }
+    auto entry_size = key_size + sizeof(key_offset) + sizeof(tid);
+    DCHECK(stringPiece.size() % entry_size == 0);
+    auto n_keys = stringPiece.size() / entry_size;
 
     // prepare response message header
-    auto message_size =
-        MessagePiece::get_header_size() + sizeof(bool) + sizeof(uint32_t);
+    auto message_size = MessagePiece::get_header_size() +
+                        n_keys * (sizeof(bool) + sizeof(uint32_t));
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(SiloMessage::READ_VALIDATION_RESPONSE),
         message_size, table_id, partition_id);
 
     coco::Encoder encoder(responseMessage.data);
     encoder << message_piece_header;
-    encoder << success << key_offset;
+
+    for (auto i = 0u; i < n_keys; i++) {
+      const void *key = stringPiece.data();
+      auto latest_tid = table.search_metadata(key).load();
+      stringPiece.remove_prefix(key_size);
+
+      Decoder dec(stringPiece);
+      dec >> key_offset >> tid;
+      stringPiece.remove_prefix(sizeof(key_offset) + sizeof(tid));
+
+      bool success = true;
+
+      if (SiloHelper::remove_lock_bit(latest_tid) != tid) {
+        success = false;
+      }
+
+      if (SiloHelper::is_locked(latest_tid)) { // must be locked by others
+        success = false;
+      }
+
+      encoder << success << key_offset;
+    }
 
     responseMessage.flush();
   }
@@ -466,10 +541,10 @@ public:
     auto partition_id = inputPiece.get_partition_id();
     DCHECK(table_id == table.tableID());
     DCHECK(partition_id == table.partitionID());
-    auto key_size = table.key_size();
 
     /*
-     * The structure of a read validation response: (success?, read key offset)
+     * The structure of a read validation response: (success?, read key
+     * offset) per key
      */
 
     bool success;
@@ -477,16 +552,18 @@ public:
 
     Decoder dec(inputPiece.toStringPiece());
 
-    dec >> success >> key_offset;
-
-    SiloRWKey &readKey = txn->readSet[key_offset];
+    while (dec.size() > 0) {
+      dec >> success >> key_offset;
 
-    txn->pendingResponses--;
-    txn->network_size += inputPiece.get_message_length();
+      txn->pendingResponses--;
 
-    if (!success) {
-      txn->abort_read_validation = true;
+      if (!success) {
+        txn->abort_read_validation = true;
+        txn->set_conflict(txn->readSet[key_offset]);
+      }
     }
+
+    txn->network_size += inputPiece.get_message_length();
   }
 
   static void abort_request_handler(MessagePiece inputPiece,
@@ -513,7 +590,7 @@ public:
     std::atomic<uint64_t> &tid = table.search_metadata(key);
 
     // unlock the key
-    SiloHelper::unlock(tid);
+    SiloHelper::unlock(tid, table.get_partition_gate());
   }
 
   static void write_request_handler(MessagePiece inputPiece,
@@ -613,7 +690,8 @@ public:
     std::atomic<uint64_t> &tid = table.search_metadata(key);
 
     uint64_t last_tid = SiloHelper::lock(tid);
-    DCHECK(last_tid < commit_tid);
+    DCHECK(SiloHelper::remove_absent_bit(last_tid) <
+           SiloHelper::remove_absent_bit(commit_tid));
     table.deserialize_value(key, valueStringPiece);
     SiloHelper::unlock(tid, commit_tid);
 
@@ -679,7 +757,75 @@ public:
     DCHECK(dec.size() == 0);
 
     std::atomic<uint64_t> &tid = table.search_metadata(key);
+    SiloHelper::unlock(tid, commit_tid, table.get_partition_gate());
+    // the write deleted the row, see Tombstone
+    if (SiloHelper::is_absent(commit_tid)) {
+      table.retire(key);
+    }
+  }
+
+  static void delta_replication_request_handler(MessagePiece inputPiece,
+                                                Message &responseMessage,
+                                                ITable &table,
+                                                Transaction *txn) {
+
+    DCHECK(inputPiece.get_message_type() ==
+           static_cast<uint32_t>(SiloMessage::DELTA_REPLICATION_REQUEST));
+    auto table_id = inputPiece.get_table_id();
+    auto partition_id = inputPiece.get_partition_id();
+    DCHECK(table_id == table.tableID());
+    DCHECK(partition_id == table.partitionID());
+    auto key_size = table.key_size();
+
+    /*
+     * The structure of a delta replication request: (primary key, commit_tid,
+     * changed fields mask, changed field values).
+     * The structure of a replication response: null
+     */
+
+    auto stringPiece = inputPiece.toStringPiece();
+
+    const void *key = stringPiece.data();
+    stringPiece.remove_prefix(key_size);
+
+    uint64_t commit_tid, mask;
+    Decoder dec(stringPiece);
+    dec >> commit_tid >> mask;
+    stringPiece.remove_prefix(sizeof(commit_tid) + sizeof(mask));
+
+    DCHECK(stringPiece.size() == table.fields_size(mask));
+
+    std::atomic<uint64_t> &tid = table.search_metadata(key);
+
+    // replicas apply the writes of a row in the order of the master
+    uint64_t last_tid = SiloHelper::lock(tid);
+    DCHECK(SiloHelper::remove_absent_bit(last_tid) <
+           SiloHelper::remove_absent_bit(commit_tid));
+    table.deserialize_fields(key, stringPiece, mask);
     SiloHelper::unlock(tid, commit_tid);
+
+    // prepare response message header
+    auto message_size = MessagePiece::get_header_size();
+    auto message_piece_header = MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(SiloMessage::REPLICATION_RESPONSE), message_size,
+        table_id, partition_id);
+
+    coco::Encoder encoder(responseMessage.data);
+    encoder << message_piece_header;
+    responseMessage.flush();
+  }
+
+  // the types whose pieces start with a key of their table, see
+  // MessageDispatch::prefetch_keys
+  static std::vector<uint32_t> get_keyed_messages() {
+    return {static_cast<uint32_t>(SiloMessage::SEARCH_REQUEST),
+            static_cast<uint32_t>(SiloMessage::LOCK_REQUEST),
+            static_cast<uint32_t>(SiloMessage::READ_VALIDATION_REQUEST),
+            static_cast<uint32_t>(SiloMessage::ABORT_REQUEST),
+            static_cast<uint32_t>(SiloMessage::WRITE_REQUEST),
+            static_cast<uint32_t>(SiloMessage::REPLICATION_REQUEST),
+            static_cast<uint32_t>(SiloMessage::RELEASE_LOCK_REQUEST),
+            static_cast<uint32_t>(SiloMessage::DELTA_REPLICATION_REQUEST)};
   }
 
   static std::vector<
@@ -701,6 +847,7 @@ public:
     v.push_back(replication_request_handler);
     v.push_back(replication_response_handler);
     v.push_back(release_lock_request_handler);
+    v.push_back(delta_replication_request_handler);
     return v;
   }
 };
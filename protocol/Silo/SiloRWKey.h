@@ -58,6 +58,60 @@ public:
     return (bitvec >> WRITE_LOCK_BIT_OFFSET) & WRITE_LOCK_BIT_MASK;
   }
 
+  // execution lock bit
+
+  void set_execution_lock_bit() {
+    clear_execution_lock_bit();
+    bitvec |= EXECUTION_LOCK_BIT_MASK << EXECUTION_LOCK_BIT_OFFSET;
+  }
+
+  void clear_execution_lock_bit() {
+    bitvec &= ~(EXECUTION_LOCK_BIT_MASK << EXECUTION_LOCK_BIT_OFFSET);
+  }
+
+  bool get_execution_lock_bit() const {
+    return (bitvec >> EXECUTION_LOCK_BIT_OFFSET) & EXECUTION_LOCK_BIT_MASK;
+  }
+
+  // update bit
+
+  void set_update_bit() {
+    clear_update_bit();
+    bitvec |= UPDATE_BIT_MASK << UPDATE_BIT_OFFSET;
+  }
+
+  void clear_update_bit() { bitvec &= ~(UPDATE_BIT_MASK << UPDATE_BIT_OFFSET); }
+
+  bool get_update_bit() const {
+    return (bitvec >> UPDATE_BIT_OFFSET) & UPDATE_BIT_MASK;
+  }
+
+  // insert bit
+
+  void set_insert_bit() {
+    clear_insert_bit();
+    bitvec |= INSERT_BIT_MASK << INSERT_BIT_OFFSET;
+  }
+
+  void clear_insert_bit() { bitvec &= ~(INSERT_BIT_MASK << INSERT_BIT_OFFSET); }
+
+  bool get_insert_bit() const {
+    return (bitvec >> INSERT_BIT_OFFSET) & INSERT_BIT_MASK;
+  }
+
+  // delete bit
+
+  void set_delete_bit() {
+    clear_delete_bit();
+    bitvec |= DELETE_BIT_MASK << DELETE_BIT_OFFSET;
+  }
+
+  void clear_delete_bit() { bitvec &= ~(DELETE_BIT_MASK << DELETE_BIT_OFFSET); }
+
+  bool get_delete_bit() const {
+    return (bitvec >> DELETE_BIT_OFFSET) & DELETE_BIT_MASK;
+  }
+
   // table id
 
   void set_table_id(uint32_t table_id) {
@@ -102,13 +156,24 @@ public:
 
   void *get_value() const { return value; }
 
+  // the fields read, see FieldProjection
+  void set_fields(uint64_t fields) { this->fields = fields; }
+
+  uint64_t get_fields() const { return fields; }
+
 private:
   /*
    * A bitvec is a 32-bit word.
    *
-   * [ table id (5) ] | partition id (16) | unused bit (8) |
+   * [ table id (5) ] | partition id (16) | unused bit (4) | delete bit (1) |
+   * insert bit (1) | update bit (1) | execution lock bit (1) |
    * write lock bit(1) | read request bit (1) | local index read (1)  ]
    *
+   * delete bit is set when the write deletes the row.
+   * insert bit is set when the write inserts the row.
+   * update bit is set when the row is read for update.
+   * execution lock bit is set when the row is locked during execution, see
+   * AdaptiveLocking.
    * write lock bit is set when a write lock is acquired.
    * read request bit is set when the read response is received.
    * local index read  is set when the read is from a local read only index.
@@ -119,6 +184,7 @@ private:
   uint64_t tid = 0;
   const void *key = nullptr;
   void *value = nullptr;
+  uint64_t fields = ~0ull;
 
 public:
   static constexpr uint32_t TABLE_ID_MASK = 0x1f;
@@ -127,6 +193,18 @@ public:
   static constexpr uint32_t PARTITION_ID_MASK = 0xffff;
   static constexpr uint32_t PARTITION_ID_OFFSET = 11;
 
+  static constexpr uint32_t DELETE_BIT_MASK = 0x1;
+  static constexpr uint32_t DELETE_BIT_OFFSET = 6;
+
+  static constexpr uint32_t INSERT_BIT_MASK = 0x1;
+  static constexpr uint32_t INSERT_BIT_OFFSET = 5;
+
+  static constexpr uint32_t UPDATE_BIT_MASK = 0x1;
+  static constexpr uint32_t UPDATE_BIT_OFFSET = 4;
+
+  static constexpr uint32_t EXECUTION_LOCK_BIT_MASK = 0x1;
+  static constexpr uint32_t EXECUTION_LOCK_BIT_OFFSET = 3;
+
   static constexpr uint32_t WRITE_LOCK_BIT_MASK = 0x1;
   static constexpr uint32_t WRITE_LOCK_BIT_OFFSET = 2;
 
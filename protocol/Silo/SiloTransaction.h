@@ -6,9 +6,15 @@
 
 #include "common/Message.h"
 #include "common/Operation.h"
+#include "common/SmallVector.h"
+#include "common/Time.h"
+#include "core/CommutativeUpdate.h"
 #include "core/Defs.h"
+#include "core/KeyIndex.h"
 #include "core/Partitioner.h"
+#include "core/Statistics.h"
 #include "core/Table.h"
+#include "protocol/Silo/SiloHelper.h"
 #include "protocol/Silo/SiloRWKey.h"
 #include <chrono>
 #include <glog/logging.h>
@@ -19,11 +25,13 @@ namespace coco {
 class SiloTransaction {
 public:
   using MetaDataType = std::atomic<uint64_t>;
+  // reads passed to readBatchHandler at once
+  static constexpr std::size_t MAX_BATCH_READS = 16;
 
   SiloTransaction(std::size_t coordinator_id, std::size_t partition_id,
                   Partitioner &partitioner)
       : coordinator_id(coordinator_id), partition_id(partition_id),
-        startTime(std::chrono::steady_clock::now()), partitioner(partitioner) {
+        startTime(Clock::now()), partitioner(partitioner) {
     reset();
   }
 
@@ -32,15 +40,43 @@ public:
   void reset() {
     pendingResponses = 0;
     network_size = 0;
+    phase_timer.clear();
     abort_lock = false;
     abort_read_validation = false;
+    conflict_key = nullptr;
     local_validated = false;
     si_in_serializable = false;
     distributed_transaction = false;
     execution_phase = true;
+    commit_tid = 0;
     operation.clear();
     readSet.clear();
     writeSet.clear();
+    additionSet.clear();
+    repairSet.clear();
+    read_key_index.clear();
+    write_key_index.clear();
+    scanSet.clear();
+    nodeSet.clear();
+    DCHECK(serial_gate == nullptr);
+    serial_tried = false;
+  }
+
+  // true if every row read or written is in the home partition
+  bool is_single_partition() const {
+    // local index reads are of read-only tables, e.g., ITEM of TPC-C
+    for (auto &readKey : readSet) {
+      if (!readKey.get_local_index_read_bit() &&
+          readKey.get_partition_id() != partition_id) {
+        return false;
+      }
+    }
+    for (auto &writeKey : writeSet) {
+      if (writeKey.get_partition_id() != partition_id) {
+        return false;
+      }
+    }
+    return true;
   }
 
   virtual TransactionResult execute(std::size_t worker_id) = 0;
@@ -67,6 +103,13 @@ public:
   template <class KeyType, class ValueType>
   void search_for_read(std::size_t table_id, std::size_t partition_id,
                        const KeyType &key, ValueType &value) {
+    search_for_read(table_id, partition_id, key, value, ~0ull);
+  }
+
+  // only the fields in mask of value are read, see FieldProjection
+  template <class KeyType, class ValueType>
+  void search_for_read(std::size_t table_id, std::size_t partition_id,
+                       const KeyType &key, ValueType &value, uint64_t fields) {
 
     SiloRWKey readKey;
 
@@ -75,6 +118,7 @@ public:
 
     readKey.set_key(&key);
     readKey.set_value(&value);
+    readKey.set_fields(fields);
 
     readKey.set_read_request_bit();
 
@@ -93,6 +137,7 @@ public:
     readKey.set_key(&key);
     readKey.set_value(&value);
 
+    readKey.set_update_bit();
     readKey.set_read_request_bit();
 
     add_to_read_set(readKey);
@@ -113,13 +158,165 @@ public:
     add_to_write_set(writeKey);
   }
 
+  // inserts value as the row of key of a local partition once the transaction
+  // commits, returns false if the key is present. The row is read as a
+  // tombstone right away, see Tombstone, and validated as a read at commit,
+  // so that an insert of the key by others in the meantime aborts it.
+  template <class KeyType, class ValueType>
+  bool insert(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key, const ValueType &value) {
+    ITable *table = localTableHandler(table_id, partition_id);
+    uint64_t tid =
+        SiloHelper::remove_lock_bit(table->search_metadata(&key).load());
+    if (!SiloHelper::is_absent(tid)) {
+      return false;
+    }
+
+    SiloRWKey readKey;
+
+    readKey.set_table_id(table_id);
+    readKey.set_partition_id(partition_id);
+
+    readKey.set_key(&key);
+    readKey.set_value(const_cast<ValueType *>(&value));
+    readKey.set_tid(tid);
+
+    readKey.set_insert_bit();
+
+    add_to_read_set(readKey);
+
+    SiloRWKey writeKey = readKey;
+    writeKey.set_tid(0);
+    add_to_write_set(writeKey);
+    return true;
+  }
+
+  // deletes the row of key once the transaction commits, the row is read for
+  // update first. The row is left as a tombstone, see Tombstone.
+  template <class KeyType>
+  void remove(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key) {
+    auto readKey = get_read_key(&key);
+    CHECK(readKey != nullptr) << "a row is read before it is deleted.";
+
+    SiloRWKey writeKey;
+
+    writeKey.set_table_id(table_id);
+    writeKey.set_partition_id(partition_id);
+
+    writeKey.set_key(&key);
+    writeKey.set_value(readKey->get_value());
+
+    writeKey.set_delete_bit();
+
+    add_to_write_set(writeKey);
+  }
+
+  // the row of key read by the transaction is a tombstone, i.e., the key is
+  // not inserted or its row is deleted
+  bool is_absent(const void *key) {
+    auto readKey = get_read_key(key);
+    return readKey != nullptr && SiloHelper::is_absent(readKey->get_tid());
+  }
+
+  // adds delta to field of the row of key once the transaction commits, the
+  // row is not read, see CommutativeUpdate
+  template <class KeyType, class T>
+  void add_to_field(std::size_t table_id, std::size_t partition_id,
+                    const KeyType &key, uint32_t field, T delta) {
+    additionSet.push_back(
+        {table_id, partition_id, &key, field, FieldAddition(delta)});
+  }
+
+  // with --repair, recompute redoes the writes derived from the read of key,
+  // a row the transaction also writes, once the row is read again at commit,
+  // see Silo::repair
+  template <class KeyType>
+  void on_repair(const KeyType &key, std::function<void()> recompute) {
+    repairSet.emplace_back(&key, std::move(recompute));
+  }
+
+  std::function<void()> *get_repair(const void *key) {
+    for (auto &repair : repairSet) {
+      if (repair.first == key) {
+        return &repair.second;
+      }
+    }
+    return nullptr;
+  }
+
+  // call func(key, value) on the rows with start <= key < end of a local
+  // partition until it returns false. Rows are read right away, the rows and
+  // the index nodes visited are validated at commit to detect phantoms.
+  template <class KeyType, class ValueType, class Func>
+  void scan(std::size_t table_id, std::size_t partition_id,
+            const KeyType &start, const KeyType &end, Func func) {
+    ITable *table = localTableHandler(table_id, partition_id);
+    ValueType value;
+    table->scan(
+        &start, &end,
+        [this, &func, &value](const void *key, MetaDataType &tid,
+                              void *row_value) {
+          uint64_t tid_ = SiloHelper::read(std::make_tuple(&tid, row_value),
+                                           &value, sizeof(ValueType));
+          scanSet.emplace_back(&tid, tid_);
+          // a tombstone is validated, but not visited
+          return SiloHelper::is_absent(tid_) ||
+                 func(*static_cast<const KeyType *>(key), value);
+        },
+        &nodeSet);
+  }
+
+  // the rows and the node versions read by scans are unchanged. a row may be
+  // locked only if is_locked_by_me(tid) is true.
+  template <class Func> bool validate_scan_set(Func is_locked_by_me) const {
+    for (auto &node : nodeSet) {
+      if (std::get<0>(node)->load() != std::get<1>(node)) {
+        return false;
+      }
+    }
+    for (auto &row : scanSet) {
+      uint64_t tid = std::get<0>(row)->load();
+      if (SiloHelper::remove_lock_bit(tid) != std::get<1>(row)) {
+        return false;
+      }
+      if (SiloHelper::is_locked(tid) && !is_locked_by_me(std::get<0>(row))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // the reads queued since the last call are issued together, i.e., the
+  // requests to a node go out in one message and the transaction waits for
+  // all responses at once
   bool process_requests(std::size_t worker_id) {
 
+    // the pending reads are at the end of the read set, among the inserts
+    int begin = int(readSet.size());
+    while (begin > 0 && (readSet[begin - 1].get_read_request_bit() ||
+                         readSet[begin - 1].get_insert_bit())) {
+      begin--;
+    }
+
+    // the hot rows read for update are locked before they are read, see
+    // AdaptiveLocking
+    if (execution_locker) {
+      for (int i = begin; i < int(readSet.size()) && !abort_lock; i++) {
+        if (readSet[i].get_read_request_bit() && readSet[i].get_update_bit()) {
+          execution_locker(readSet[i]);
+        }
+      }
+    }
+
+    if (readBatchHandler) {
+      process_batch_requests(begin);
+    }
+
     // cannot use unsigned type in reverse iteration
-    for (int i = int(readSet.size()) - 1; i >= 0; i--) {
-      // early return
+    for (int i = int(readSet.size()) - 1; i >= begin; i--) {
       if (!readSet[i].get_read_request_bit()) {
-        break;
+        continue;
       }
 
       const SiloRWKey &readKey = readSet[i];
@@ -137,18 +334,79 @@ public:
         remote_request_handler();
       }
     }
+
+    // a stale read of a hot row aborts right away, see EarlyValidation
+    if (early_validator && !early_validator()) {
+      abort_read_validation = true;
+      return true;
+    }
     return false;
   }
 
-  SiloRWKey *get_read_key(const void *key) {
+  /*
+   * The pending reads from begin on of the same table and partition are looked
+   * up together by readBatchHandler, which overlaps the cache misses of the
+   * rows. A group is left to readRequestHandler if the handler refuses it,
+   * e.g., the partition is remote.
+   */
+  void process_batch_requests(int begin) {
+    const void *keys[MAX_BATCH_READS];
+    void *values[MAX_BATCH_READS];
+    uint64_t tids[MAX_BATCH_READS];
+    int offsets[MAX_BATCH_READS];
+
+    for (int i = begin; i < int(readSet.size()); i++) {
+      if (!readSet[i].get_read_request_bit() || !is_batch_leader(begin, i)) {
+        continue;
+      }
+      const SiloRWKey &leader = readSet[i];
+      std::size_t n = 0;
+      for (int j = i; j < int(readSet.size()) && n < MAX_BATCH_READS; j++) {
+        if (readSet[j].get_read_request_bit() &&
+            is_same_batch(leader, readSet[j])) {
+          keys[n] = readSet[j].get_key();
+          values[n] = readSet[j].get_value();
+          offsets[n++] = j;
+        }
+      }
+      if (n < 2 || !readBatchHandler(leader.get_table_id(),
+                                     leader.get_partition_id(), keys, values,
+                                     tids, n,
+                                     leader.get_local_index_read_bit())) {
+        continue;
+      }
+      for (auto k = 0u; k < n; k++) {
+        readSet[offsets[k]].clear_read_request_bit();
+        readSet[offsets[k]].set_tid(tids[k]);
+      }
+    }
+  }
 
-    for (auto i = 0u; i < readSet.size(); i++) {
-      if (readSet[i].get_key() == key) {
-        return &readSet[i];
+  // no pending read before i is in the same batch as read i
+  bool is_batch_leader(int begin, int i) const {
+    for (int j = begin; j < i; j++) {
+      if (readSet[j].get_read_request_bit() &&
+          is_same_batch(readSet[j], readSet[i])) {
+        return false;
       }
     }
+    return true;
+  }
 
-    return nullptr;
+  static bool is_same_batch(const SiloRWKey &a, const SiloRWKey &b) {
+    return a.get_table_id() == b.get_table_id() &&
+           a.get_partition_id() == b.get_partition_id() &&
+           a.get_local_index_read_bit() == b.get_local_index_read_bit();
+  }
+
+  SiloRWKey *get_read_key(const void *key) {
+    auto i = read_key_index.find(readSet, key);
+    return i < 0 ? nullptr : &readSet[i];
+  }
+
+  SiloRWKey *get_write_key(const void *key) {
+    auto i = write_key_index.find(writeSet, key);
+    return i < 0 ? nullptr : &writeSet[i];
   }
 
   std::size_t add_to_read_set(const SiloRWKey &key) {
@@ -161,26 +419,68 @@ public:
     return writeSet.size() - 1;
   }
 
+  uint64_t get_commit_ts() const { return commit_tid; }
+
+  // keeps the first row that aborts the transaction, see ConflictProfile
+  void set_conflict(const SiloRWKey &key) {
+    if (conflict_key == nullptr) {
+      conflict_key = key.get_key();
+      conflict_table_id = key.get_table_id();
+      conflict_partition_id = key.get_partition_id();
+    }
+  }
+
 public:
   std::size_t coordinator_id, partition_id;
-  std::chrono::steady_clock::time_point startTime;
+  Clock::time_point startTime;
+  // the type of the transaction, see Statistics::procedures
+  uint32_t procedure_id = 0;
+  // the priority class of the procedure, see Priorities
+  uint32_t priority = 0;
+  PhaseTimer phase_timer;
   std::size_t pendingResponses;
   std::size_t network_size;
   bool abort_lock, abort_read_validation, local_validated, si_in_serializable;
+  const void *conflict_key;
+  std::size_t conflict_table_id, conflict_partition_id;
   bool distributed_transaction;
   bool execution_phase;
+  // set by group commit protocols, used by the redo log
+  uint64_t commit_tid;
+  // the gate of the home partition once entered, see PartitionGate
+  PartitionGate *serial_gate = nullptr;
+  bool serial_tried;
   // table id, partition id, key, value, local index read?
   std::function<uint64_t(std::size_t, std::size_t, uint32_t, const void *,
                          void *, bool)>
       readRequestHandler;
+  // table id, partition id, keys, values, tids, # of keys, local index read?
+  // returns false if the reads are not local, optional
+  std::function<bool(std::size_t, std::size_t, const void *const *,
+                     void *const *, uint64_t *, std::size_t, bool)>
+      readBatchHandler;
+  // the table of a local partition, used by scans
+  std::function<ITable *(std::size_t, std::size_t)> localTableHandler;
   // processed a request?
   std::function<std::size_t(void)> remote_request_handler;
 
   std::function<void()> message_flusher;
+  // the reads are not stale yet? optional
+  std::function<bool()> early_validator;
+  // locks a hot row read for update, sets abort_lock on failure, optional
+  std::function<void(SiloRWKey &)> execution_locker;
 
   Partitioner &partitioner;
   Operation operation;
-  std::vector<SiloRWKey> readSet, writeSet;
+  SmallVector<SiloRWKey, N_INLINE_READ_KEYS> readSet;
+  SmallVector<SiloRWKey, N_INLINE_WRITE_KEYS> writeSet;
+  KeyIndex read_key_index, write_key_index;
+  std::vector<AdditionKey> additionSet;
+  // the keys read again at commit and the writes to recompute, see on_repair
+  std::vector<std::pair<const void *, std::function<void()>>> repairSet;
+  // rows read by scans and their tids
+  std::vector<std::tuple<MetaDataType *, uint64_t>> scanSet;
+  ITable::NodeSetType nodeSet;
 };
 
 } // namespace coco
@@ -8,7 +8,12 @@
 #include <atomic>
 #include <thread>
 
+#include "core/BatchValidation.h"
+#include "core/CommutativeUpdate.h"
+#include "core/LockOrder.h"
+#include "core/OperationReplication.h"
 #include "core/Partitioner.h"
+#include "core/SplitCounters.h"
 #include "core/Table.h"
 #include "protocol/Silo/SiloHelper.h"
 #include "protocol/Silo/SiloTransaction.h"
@@ -29,17 +34,44 @@ public:
   using MessageHandlerType = SiloGCMessageHandler;
 
   SiloGC(DatabaseType &db, const ContextType &context, Partitioner &partitioner)
-      : db(db), context(context), partitioner(partitioner) {}
+      : db(db), context(context), partitioner(partitioner),
+        split_counters(context.split_threshold) {}
 
+  // with --snapshot_reads, the tid keeps the lock bit, see snapshot_commit
   uint64_t search(std::size_t table_id, std::size_t partition_id,
                   const void *key, void *value) const {
 
-    ITable *table = db.find_table(table_id, partition_id);
-    auto value_bytes = table->value_size();
-    auto row = table->search(key);
-    return SiloHelper::read(row, value, value_bytes);
+    bool lock_bit = context.snapshot_reads;
+    return db.visit_table(
+        table_id, partition_id, [key, value, lock_bit](auto &table) {
+          auto row = table.search(key);
+          return lock_bit ? SiloHelper::read_with_lock_bit(row, value,
+                                                           table.value_size())
+                          : SiloHelper::read(row, value, table.value_size());
+        });
   }
 
+  // tids[i] = search(table_id, partition_id, keys[i], values[i]) for i < n
+  void search_batch(std::size_t table_id, std::size_t partition_id,
+                    const void *const *keys, void *const *values,
+                    uint64_t *tids, std::size_t n) const {
+    db.visit_table(table_id, partition_id, [=](auto &table) {
+      std::tuple<MetaDataType *, void *> rows[TransactionType::MAX_BATCH_READS];
+      DCHECK(n <= TransactionType::MAX_BATCH_READS);
+      table.search_batch(keys, rows, n);
+      for (auto i = 0u; i < n; i++) {
+        tids[i] = context.snapshot_reads
+                      ? SiloHelper::read_with_lock_bit(rows[i], values[i],
+                                                       table.value_size())
+                      : SiloHelper::read(rows[i], values[i],
+                                         table.value_size());
+      }
+    });
+  }
+
+  // the executor starts the group of epoch, see generate_tid
+  void set_epoch(uint64_t epoch) { epoch_tid = epoch << EPOCH_OFFSET; }
+
   void abort(TransactionType &txn,
              std::vector<std::unique_ptr<Message>> &syncMessages,
              std::vector<std::unique_ptr<Message>> &asyncMessages) {
@@ -74,34 +106,100 @@ public:
               std::vector<std::unique_ptr<Message>> &syncMessages,
               std::vector<std::unique_ptr<Message>> &asyncMessages) {
 
+    if (context.snapshot_reads && snapshot_commit(txn)) {
+      return true;
+    }
+
     // lock write set
     if (lock_write_set(txn, syncMessages)) {
       abort(txn, syncMessages, asyncMessages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::LOCK);
 
     // commit phase 2, read validation
     if (!validate_read_set(txn, syncMessages)) {
       abort(txn, syncMessages, asyncMessages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::VALIDATE);
 
     // generate tid
     uint64_t commit_tid = generate_tid(txn);
+    txn.commit_tid = commit_tid;
 
     // write and replicate
     write_and_replicate(txn, commit_tid, syncMessages, asyncMessages);
+    // the local rows are unlocked, see CommutativeUpdate
+    if (context.split_threshold > 0) {
+      split_additions(txn, asyncMessages);
+    } else {
+      CommutativeUpdate::apply(txn, db, partitioner, asyncMessages);
+    }
+    txn.phase_timer.end(TransactionPhase::WRITE);
 
     return true;
   }
 
+  // the executor stops the group, the slices of the hot rows are merged, see
+  // SplitCounters
+  std::size_t merge_slices(std::size_t coordinator_id,
+                           std::vector<std::unique_ptr<Message>> &messages) {
+    return split_counters.merge(coordinator_id, db, partitioner, messages);
+  }
+
 private:
+  void split_additions(TransactionType &txn,
+                       std::vector<std::unique_ptr<Message>> &messages) {
+    for (auto &addition : txn.additionSet) {
+      auto table = db.find_table(addition.table_id, addition.partition_id);
+      if (!split_counters.add(addition, *table)) {
+        txn.network_size += CommutativeUpdate::apply(
+            addition, txn.coordinator_id, db, partitioner, messages);
+      }
+    }
+  }
+
+  /*
+   * With --snapshot_reads, a tid starts with the epoch of the group that
+   * wrote it, see generate_tid, and a local read keeps the lock bit of the
+   * row. A read-only transaction whose reads are local, unlocked and older
+   * than its epoch read the rows as of the end of the last group, which every
+   * coordinator finished before this one started. So it commits on that
+   * snapshot without validation or messages. Any other transaction commits
+   * as usual once the lock bits are dropped.
+   */
+  bool snapshot_commit(TransactionType &txn) {
+    auto &readSet = txn.readSet;
+
+    bool snapshot = txn.writeSet.empty() && txn.additionSet.empty() &&
+                    !txn.distributed_transaction && txn.scanSet.empty();
+    for (auto i = 0u; i < readSet.size() && snapshot; i++) {
+      // a locked tid is larger than any epoch
+      snapshot = readSet[i].get_tid() < epoch_tid;
+    }
+    if (snapshot) {
+      return true;
+    }
+
+    for (auto i = 0u; i < readSet.size(); i++) {
+      readSet[i].set_tid(SiloHelper::remove_lock_bit(readSet[i].get_tid()));
+    }
+    return false;
+  }
+
   bool lock_write_set(TransactionType &txn,
                       std::vector<std::unique_ptr<Message>> &messages) {
 
     auto &readSet = txn.readSet;
     auto &writeSet = txn.writeSet;
 
+    // with --lock_ordering, locks are taken in a global order and may wait
+    if (context.lock_ordering) {
+      lock_order.sort_and_prefetch(writeSet, db, partitioner);
+      txn.write_key_index.clear();
+    }
+
     for (auto i = 0u; i < writeSet.size(); i++) {
       auto &writeKey = writeSet[i];
       auto tableId = writeKey.get_table_id();
@@ -111,11 +209,17 @@ private:
       // lock local records
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
-        std::atomic<uint64_t> &tid = table->search_metadata(key);
+        std::atomic<uint64_t> &tid = context.lock_ordering
+                                         ? lock_order.tid(i)
+                                         : table->search_metadata(key);
+        // a transaction of a priority class waits, see Priorities
         bool success;
-        uint64_t latestTid = SiloHelper::lock(tid, success);
+        uint64_t latestTid = SiloHelper::lock(
+            tid, success,
+            context.lock_ordering || txn.priority > 0 ? context.lock_spin : 0);
 
         if (!success) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -127,6 +231,7 @@ private:
         DCHECK(readKeyPtr != nullptr);
         uint64_t tidOnRead = readKeyPtr->get_tid();
         if (latestTid != tidOnRead) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -149,51 +254,53 @@ private:
                          std::vector<std::unique_ptr<Message>> &messages) {
 
     auto &readSet = txn.readSet;
-    auto &writeSet = txn.writeSet;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto needs_validation = [&txn](const SiloRWKey &readKey) {
+      // read only index does not need to validate, and a key in the write set
+      // is already validated in lock write set
+      return !readKey.get_local_index_read_bit() &&
+             txn.get_write_key(readKey.get_key()) == nullptr;
     };
 
-    for (auto i = 0u; i < readSet.size(); i++) {
-      auto &readKey = readSet[i];
+    auto is_local = [this, &readSet, &needs_validation](std::size_t i) {
+      return needs_validation(readSet[i]) &&
+             partitioner.has_master_partition(readSet[i].get_partition_id());
+    };
 
-      if (readKey.get_local_index_read_bit()) {
-        continue; // read only index does not need to validate
-      }
+    // the local reads first, see BatchValidation
+    int conflict = BatchValidation::validate(
+        db, readSet, is_local,
+        [&readSet](std::size_t i, std::atomic<uint64_t> &latest_tid) {
+          // the tid read has no lock bit, a locked row is locked by others
+          return latest_tid.load() == readSet[i].get_tid();
+        });
+    if (conflict >= 0) {
+      txn.abort_read_validation = true;
+      txn.set_conflict(readSet[conflict]);
+    }
+
+    for (auto i = 0u; i < readSet.size() && !txn.abort_read_validation; i++) {
+      auto &readKey = readSet[i];
 
-      bool in_write_set = isKeyInWriteSet(readKey.get_key());
-      if (in_write_set) {
-        continue; // already validated in lock write set
+      if (!needs_validation(readKey) || is_local(i)) {
+        continue;
       }
 
-      auto tableId = readKey.get_table_id();
       auto partitionId = readKey.get_partition_id();
-      auto table = db.find_table(tableId, partitionId);
+      auto table = db.find_table(readKey.get_table_id(), partitionId);
+      txn.pendingResponses++;
+      auto coordinatorID = partitioner.master_coordinator(partitionId);
+      txn.network_size += MessageFactoryType::new_read_validation_message(
+          *messages[coordinatorID], *table, readKey.get_key(), i,
+          readKey.get_tid());
+    }
 
-      if (partitioner.has_master_partition(partitionId)) {
-        auto key = readKey.get_key();
-        uint64_t tid = table->search_metadata(key).load();
-        if (SiloHelper::remove_lock_bit(tid) != readKey.get_tid()) {
-          txn.abort_read_validation = true;
-          break;
-        }
-        if (SiloHelper::is_locked(tid)) { // must be locked by others
-          txn.abort_read_validation = true;
-          break;
-        }
-      } else {
-        txn.pendingResponses++;
-        auto coordinatorID = partitioner.master_coordinator(partitionId);
-        txn.network_size += MessageFactoryType::new_read_validation_message(
-            *messages[coordinatorID], *table, readKey.get_key(), i,
-            readKey.get_tid());
-      }
+    // rows and index nodes read by scans, all of them are local
+    if (!txn.abort_read_validation &&
+        !txn.validate_scan_set([this, &txn](const MetaDataType *tid) {
+          return is_locked_by_me(txn, tid);
+        })) {
+      txn.abort_read_validation = true;
     }
 
     if (txn.pendingResponses == 0) {
@@ -205,6 +312,22 @@ private:
     return !txn.abort_read_validation;
   }
 
+  // tid is a local row in the write set, so it is locked by txn
+  bool is_locked_by_me(TransactionType &txn, const MetaDataType *tid) {
+    for (auto &writeKey : txn.writeSet) {
+      auto partitionId = writeKey.get_partition_id();
+      if (!writeKey.get_write_lock_bit() ||
+          !partitioner.has_master_partition(partitionId)) {
+        continue;
+      }
+      auto table = db.find_table(writeKey.get_table_id(), partitionId);
+      if (&table->search_metadata(writeKey.get_key()) == tid) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   uint64_t generate_tid(TransactionType &txn) {
 
     auto &readSet = txn.readSet;
@@ -217,6 +340,9 @@ private:
      *  The most significant bit is the lock bit.
      *  The lower 63 bits are for transaction sequence id.
      *  [  lock bit (1)  |  id (63) ]
+     *
+     *  With --snapshot_reads, the id is at least the epoch of the group.
+     *  [  lock bit (1)  |  epoch (31)  |  id (32) ]
      */
 
     // larger than the TID of any record read or written by the transaction
@@ -233,6 +359,8 @@ private:
 
     next_tid = std::max(next_tid, max_tid);
 
+    next_tid = std::max(next_tid, epoch_tid);
+
     // increment
 
     next_tid++;
@@ -252,6 +380,11 @@ private:
     auto &readSet = txn.readSet;
     auto &writeSet = txn.writeSet;
 
+    // with --operation_replication, the replicas replay the operation of txn
+    // instead of receiving the values, see OperationReplication.
+    bool replicate_operation =
+        OperationReplication::is_applicable(txn, partitioner);
+
     for (auto i = 0u; i < writeSet.size(); i++) {
       auto &writeKey = writeSet[i];
       auto tableId = writeKey.get_table_id();
@@ -272,6 +405,10 @@ private:
             writeKey.get_value(), commit_tid);
       }
 
+      if (replicate_operation) {
+        continue;
+      }
+
       // value replicate
 
       std::size_t replicate_count = 0;
@@ -313,7 +450,13 @@ private:
         }
       }
 
-      DCHECK(replicate_count == partitioner.replica_num() - 1);
+      DCHECK(replicate_count ==
+             partitioner.partition_replica_num(partitionId) - 1);
+    }
+
+    if (replicate_operation) {
+      OperationReplication::replicate(txn, commit_tid, partitioner,
+                                      asyncMessages, false);
     }
 
     sync_messages(txn, false);
@@ -331,8 +474,13 @@ private:
 private:
   DatabaseType &db;
   const ContextType &context;
+  LockOrder<SiloRWKey> lock_order;
   Partitioner &partitioner;
   uint64_t max_tid = 0;
+  // the first tid of the current epoch with --snapshot_reads
+  uint64_t epoch_tid = 0;
+  SplitCounters split_counters;
+  static constexpr uint64_t EPOCH_OFFSET = 32;
 };
 
 } // namespace coco
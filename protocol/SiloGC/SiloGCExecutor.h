@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "core/OperationReplication.h"
 #include "core/group_commit/Executor.h"
 #include "protocol/SiloGC/SiloGC.h"
 
@@ -34,9 +35,25 @@ public:
                  const ContextType &context,
                  std::atomic<uint32_t> &worker_status,
                  std::atomic<uint32_t> &n_complete_workers,
-                 std::atomic<uint32_t> &n_started_workers)
+                 std::atomic<uint32_t> &n_started_workers,
+                 group_commit::EpochCounters &epoch_counters)
       : base_type(coordinator_id, id, db, context, worker_status,
-                  n_complete_workers, n_started_workers) {}
+                  n_complete_workers, n_started_workers, epoch_counters) {
+    OperationReplication::set_message_handlers<SiloHelper>(
+        this->messageHandlers, db);
+    CommutativeUpdate::set_message_handlers(this->messageHandlers);
+
+    // with --retry_cache, the remote rows read are kept for the retries
+    if (context.retry_cache) {
+      this->messageHandlers[static_cast<int>(MessageType::SEARCH_RESPONSE)] =
+          [this](MessagePiece inputPiece, Message &responseMessage,
+                 ITable &table, TransactionType *txn) {
+            MessageHandlerType::search_response_handler(
+                inputPiece, responseMessage, table, txn);
+            keep_search_response(inputPiece, table, *txn);
+          };
+    }
+  }
 
   ~SiloGCExecutor() = default;
 
@@ -61,6 +78,12 @@ public:
         return this->protocol.search(table_id, partition_id, key, value);
       } else {
         ITable *table = this->db.find_table(table_id, partition_id);
+        uint64_t tid;
+        if (this->context.retry_cache &&
+            this->retry_cache.get(*table, key, value, tid)) {
+          txn.distributed_transaction = true;
+          return tid;
+        }
         auto coordinatorID =
             this->partitioner->master_coordinator(partition_id);
         txn.network_size += MessageFactoryType::new_search_message(
@@ -71,8 +94,65 @@ public:
       }
     };
 
+    txn.readBatchHandler =
+        [this](std::size_t table_id, std::size_t partition_id,
+               const void *const *keys, void *const *values, uint64_t *tids,
+               std::size_t n, bool local_index_read) -> bool {
+      if (!local_index_read &&
+          !this->partitioner->has_master_partition(partition_id) &&
+          !(this->partitioner->is_partition_replicated_on(
+                partition_id, this->coordinator_id) &&
+            this->context.read_on_replica)) {
+        return false;
+      }
+      this->protocol.search_batch(table_id, partition_id, keys, values, tids,
+                                  n);
+      return true;
+    };
+
+    txn.localTableHandler = [this](std::size_t table_id,
+                                   std::size_t partition_id) -> ITable * {
+      CHECK(this->partitioner->has_master_partition(partition_id))
+          << "scans on partition " << partition_id << " are not local.";
+      return this->db.find_table(table_id, partition_id);
+    };
+
     txn.remote_request_handler = [this]() { return this->process_request(); };
-    txn.message_flusher = [this]() { this->flush_sync_messages(); };
+    txn.message_flusher = [this]() { this->flush_sync_requests(); };
   };
+
+protected:
+  // the value and the tid of a search response, see RetryCache
+  void keep_search_response(MessagePiece inputPiece, ITable &table,
+                            TransactionType &txn) {
+    uint32_t key_offset;
+    auto value_size = table.value_size();
+    StringPiece stringPiece = inputPiece.toStringPiece();
+    stringPiece.remove_prefix(value_size + sizeof(uint64_t));
+    Decoder dec(stringPiece);
+    dec >> key_offset;
+    auto &readKey = txn.readSet[key_offset];
+    this->retry_cache.put(
+        table, readKey.get_key(),
+        StringPiece(inputPiece.toStringPiece().data(), value_size),
+        readKey.get_tid());
+  }
+
+  // with --snapshot_reads, the tids start with the epoch, see SiloGC
+  void start_group(uint64_t n) override {
+    if (this->context.snapshot_reads) {
+      this->protocol.set_epoch(n);
+    }
+  }
+
+  // with --split_threshold, the slices of the hot rows are merged, see
+  // SplitCounters
+  void stop_group() override {
+    if (this->context.split_threshold > 0) {
+      this->stats.add(WorkerStats::NETWORK_SIZE,
+                      this->protocol.merge_slices(this->coordinator_id,
+                                                  this->async_messages));
+    }
+  }
 };
 } // namespace coco
\ No newline at end of file
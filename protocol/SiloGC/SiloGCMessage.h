@@ -373,6 +373,7 @@ public:
     txn->network_size += inputPiece.get_message_length();
 
     if (!success || tid_changed) {
+      txn->set_conflict(writeKey);
       txn->abort_lock = true;
     }
   }
@@ -461,6 +462,7 @@ public:
     txn->network_size += inputPiece.get_message_length();
 
     if (!success) {
+      txn->set_conflict(readKey);
       txn->abort_read_validation = true;
     }
   }
@@ -580,6 +582,22 @@ public:
     }
   }
 
+  // the requests a ReplicationApplier stages
+  static bool is_replication_request(uint64_t type) {
+    return type == static_cast<uint32_t>(SiloGCMessage::REPLICATION_REQUEST);
+  }
+
+  // the types whose pieces start with a key of their table, see
+  // MessageDispatch::prefetch_keys
+  static std::vector<uint32_t> get_keyed_messages() {
+    return {static_cast<uint32_t>(SiloGCMessage::SEARCH_REQUEST),
+            static_cast<uint32_t>(SiloGCMessage::LOCK_REQUEST),
+            static_cast<uint32_t>(SiloGCMessage::READ_VALIDATION_REQUEST),
+            static_cast<uint32_t>(SiloGCMessage::ABORT_REQUEST),
+            static_cast<uint32_t>(SiloGCMessage::WRITE_REQUEST),
+            static_cast<uint32_t>(SiloGCMessage::REPLICATION_REQUEST)};
+  }
+
   static std::vector<
       std::function<void(MessagePiece, Message &, ITable &, Transaction *)>>
   get_message_handlers() {
@@ -8,6 +8,7 @@
 #include <atomic>
 #include <thread>
 
+#include "core/LockOrder.h"
 #include "core/Partitioner.h"
 #include "core/Table.h"
 #include "protocol/Silo/SiloHelper.h"
@@ -34,10 +35,24 @@ public:
   uint64_t search(std::size_t table_id, std::size_t partition_id,
                   const void *key, void *value) const {
 
-    ITable *table = db.find_table(table_id, partition_id);
-    auto value_bytes = table->value_size();
-    auto row = table->search(key);
-    return SiloHelper::read(row, value, value_bytes);
+    return db.visit_table(table_id, partition_id, [key, value](auto &table) {
+      auto row = table.search(key);
+      return SiloHelper::read(row, value, table.value_size());
+    });
+  }
+
+  // tids[i] = search(table_id, partition_id, keys[i], values[i]) for i < n
+  void search_batch(std::size_t table_id, std::size_t partition_id,
+                    const void *const *keys, void *const *values,
+                    uint64_t *tids, std::size_t n) const {
+    db.visit_table(table_id, partition_id, [=](auto &table) {
+      std::tuple<MetaDataType *, void *> rows[TransactionType::MAX_BATCH_READS];
+      DCHECK(n <= TransactionType::MAX_BATCH_READS);
+      table.search_batch(keys, rows, n);
+      for (auto i = 0u; i < n; i++) {
+        tids[i] = SiloHelper::read(rows[i], values[i], table.value_size());
+      }
+    });
   }
 
   void abort(TransactionType &txn,
@@ -79,12 +94,15 @@ public:
       abort(txn, syncMessages, asyncMessages);
       return false;
     }
+    txn.phase_timer.end(TransactionPhase::VALIDATE);
 
     // generate tid
     uint64_t commit_tid = generate_tid(txn);
+    txn.commit_tid = commit_tid;
 
     // write and replicate
     write_and_replicate(txn, commit_tid, syncMessages, asyncMessages);
+    txn.phase_timer.end(TransactionPhase::WRITE);
 
     return true;
   }
@@ -96,13 +114,8 @@ private:
     auto &readSet = txn.readSet;
     auto &writeSet = txn.writeSet;
 
-    auto isKeyInWriteSet = [&writeSet](const void *key) {
-      for (auto &writeKey : writeSet) {
-        if (writeKey.get_key() == key) {
-          return true;
-        }
-      }
-      return false;
+    auto isKeyInWriteSet = [&txn](const void *key) {
+      return txn.get_write_key(key) != nullptr;
     };
 
     for (auto i = 0u; i < readSet.size(); i++) {
@@ -125,10 +138,12 @@ private:
         auto key = readKey.get_key();
         uint64_t tid = table->search_metadata(key).load();
         if (SiloHelper::remove_lock_bit(tid) != readKey.get_tid()) {
+          txn.set_conflict(readKey);
           txn.abort_read_validation = true;
           break;
         }
         if (SiloHelper::is_locked(tid)) { // must be locked by others
+          txn.set_conflict(readKey);
           txn.abort_read_validation = true;
           break;
         }
@@ -141,6 +156,12 @@ private:
       }
     }
 
+    // rows and index nodes read by scans, nothing is locked by txn yet
+    if (!txn.abort_read_validation &&
+        !txn.validate_scan_set([](const MetaDataType *) { return false; })) {
+      txn.abort_read_validation = true;
+    }
+
     if (txn.pendingResponses == 0) {
       txn.local_validated = true;
     }
@@ -149,6 +170,12 @@ private:
       sync_messages(txn);
     }
 
+    // with --lock_ordering, locks are taken in a global order and may wait
+    if (context.lock_ordering) {
+      lock_order.sort_and_prefetch(writeSet, db, partitioner);
+      txn.write_key_index.clear();
+    }
+
     for (auto i = 0u; i < writeSet.size(); i++) {
       auto &writeKey = writeSet[i];
       auto tableId = writeKey.get_table_id();
@@ -158,11 +185,17 @@ private:
       // lock local records
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
-        std::atomic<uint64_t> &tid = table->search_metadata(key);
+        std::atomic<uint64_t> &tid = context.lock_ordering
+                                         ? lock_order.tid(i)
+                                         : table->search_metadata(key);
+        // a transaction of a priority class waits, see Priorities
         bool success;
-        uint64_t latestTid = SiloHelper::lock(tid, success);
+        uint64_t latestTid = SiloHelper::lock(
+            tid, success,
+            context.lock_ordering || txn.priority > 0 ? context.lock_spin : 0);
 
         if (!success) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -174,6 +207,7 @@ private:
         DCHECK(readKeyPtr != nullptr);
         uint64_t tidOnRead = readKeyPtr->get_tid();
         if (latestTid != tidOnRead) {
+          txn.set_conflict(writeKey);
           txn.abort_lock = true;
           break;
         }
@@ -300,7 +334,8 @@ private:
         }
       }
 
-      DCHECK(replicate_count == partitioner.replica_num() - 1);
+      DCHECK(replicate_count ==
+             partitioner.partition_replica_num(partitionId) - 1);
     }
 
     sync_messages(txn, false);
@@ -318,6 +353,7 @@ private:
 private:
   DatabaseType &db;
   const ContextType &context;
+  LockOrder<SiloRWKey> lock_order;
   Partitioner &partitioner;
   uint64_t max_tid = 0;
 };
@@ -34,9 +34,10 @@ public:
                  const ContextType &context,
                  std::atomic<uint32_t> &worker_status,
                  std::atomic<uint32_t> &n_complete_workers,
-                 std::atomic<uint32_t> &n_started_workers)
+                 std::atomic<uint32_t> &n_started_workers,
+                 group_commit::EpochCounters &epoch_counters)
       : base_type(coordinator_id, id, db, context, worker_status,
-                  n_complete_workers, n_started_workers) {}
+                  n_complete_workers, n_started_workers, epoch_counters) {}
 
   ~SiloSIExecutor() = default;
 
@@ -69,8 +70,31 @@ public:
       }
     };
 
+    txn.readBatchHandler =
+        [this](std::size_t table_id, std::size_t partition_id,
+               const void *const *keys, void *const *values, uint64_t *tids,
+               std::size_t n, bool local_index_read) -> bool {
+      if (!local_index_read &&
+          !this->partitioner->has_master_partition(partition_id) &&
+          !(this->partitioner->is_partition_replicated_on(
+                partition_id, this->coordinator_id) &&
+            this->context.read_on_replica)) {
+        return false;
+      }
+      this->protocol.search_batch(table_id, partition_id, keys, values, tids,
+                                  n);
+      return true;
+    };
+
+    txn.localTableHandler = [this](std::size_t table_id,
+                                   std::size_t partition_id) -> ITable * {
+      CHECK(this->partitioner->has_master_partition(partition_id))
+          << "scans on partition " << partition_id << " are not local.";
+      return this->db.find_table(table_id, partition_id);
+    };
+
     txn.remote_request_handler = [this]() { return this->process_request(); };
-    txn.message_flusher = [this]() { this->flush_sync_messages(); };
+    txn.message_flusher = [this]() { this->flush_sync_requests(); };
   };
 };
 } // namespace coco
\ No newline at end of file
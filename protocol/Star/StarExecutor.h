@@ -0,0 +1,401 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "common/Futex.h"
+#include "common/Histogram.h"
+#include "common/Time.h"
+#include "core/Defs.h"
+#include "core/MessageDispatch.h"
+#include "core/Partitioner.h"
+#include "core/Worker.h"
+#include "glog/logging.h"
+
+#include "protocol/Silo/SiloHelper.h"
+#include "protocol/Silo/SiloTransaction.h"
+#include "protocol/SiloGC/SiloGC.h"
+#include "protocol/SiloGC/SiloGCMessage.h"
+#include "protocol/Star/StarQueryNum.h"
+
+#include <chrono>
+#include <queue>
+
+namespace coco {
+
+/*
+ * Star switches between two phases in each iteration.
+ *
+ * In the single-master phase (C_PHASE), coordinator 0 has a full replica and
+ * masters all partitions, it runs the cross-partition transactions with no
+ * remote reads and replicates the writes to the partitioned replica. The
+ * others only apply the replication.
+ *
+ * In the partitioned phase (S_PHASE), a partition is mastered by
+ * partition id % N as in StarSPartitioner and each coordinator runs the
+ * single-partition transactions on its partitions, replicating the writes to
+ * the other replica.
+ *
+ * Both phases run Silo with group commit, the replication is applied before
+ * the next phase starts and a transaction is released once its phase ends.
+ */
+
+template <class Workload> class StarExecutor : public Worker {
+public:
+  using WorkloadType = Workload;
+  using DatabaseType = typename WorkloadType::DatabaseType;
+  using StorageType = typename WorkloadType::StorageType;
+
+  using TransactionType = SiloTransaction;
+  static_assert(std::is_same<typename WorkloadType::TransactionType,
+                             TransactionType>::value,
+                "Transaction types do not match.");
+
+  using ContextType = typename DatabaseType::ContextType;
+  using RandomType = typename DatabaseType::RandomType;
+
+  using ProtocolType = SiloGC<DatabaseType>;
+
+  using MessageType = SiloGCMessage;
+  using MessageFactoryType = SiloGCMessageFactory;
+  using MessageHandlerType = SiloGCMessageHandler;
+
+  StarExecutor(std::size_t coordinator_id, std::size_t id, DatabaseType &db,
+               const ContextType &context, std::atomic<uint32_t> &batch_size,
+               std::atomic<uint32_t> &worker_status,
+               std::atomic<uint32_t> &n_complete_workers,
+               std::atomic<uint32_t> &n_started_workers)
+      : Worker(coordinator_id, id), db(db), context(context),
+        s_context(context.get_single_partition_context()),
+        c_context(context.get_cross_partition_context()),
+        batch_size(batch_size), worker_status(worker_status),
+        n_complete_workers(n_complete_workers),
+        n_started_workers(n_started_workers),
+        s_partitioner(std::make_unique<StarSPartitioner>(
+            coordinator_id, context.coordinator_num)),
+        c_partitioner(std::make_unique<StarCPartitioner>(
+            coordinator_id, context.coordinator_num)),
+        random(reinterpret_cast<uint64_t>(this)),
+        s_workload(coordinator_id, db, random, *s_partitioner),
+        c_workload(coordinator_id, db, random, *c_partitioner),
+        s_protocol(db, s_context, *s_partitioner),
+        c_protocol(db, c_context, *c_partitioner) {
+
+    CHECK(context.partition_num % context.coordinator_num == 0)
+        << "partitions must be evenly mastered in the partitioned phase.";
+
+    for (auto i = 0u; i < context.coordinator_num; i++) {
+      sync_messages.emplace_back(std::make_unique<Message>());
+      init_message(sync_messages[i].get(), i);
+
+      async_messages.emplace_back(std::make_unique<Message>());
+      init_message(async_messages[i].get(), i);
+    }
+
+    messageHandlers = MessageHandlerType::get_message_handlers();
+  }
+
+  ~StarExecutor() = default;
+
+  void start() override {
+
+    LOG(INFO) << "StarExecutor " << id << " started. ";
+
+    for (;;) {
+
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) == ExecutorStatus::C_PHASE ||
+                   static_cast<ExecutorStatus>(s) == ExecutorStatus::S_PHASE ||
+                   static_cast<ExecutorStatus>(s) == ExecutorStatus::EXIT;
+          },
+          [this]() { return process_request(); });
+
+      auto status = static_cast<ExecutorStatus>(worker_status.load());
+      if (status == ExecutorStatus::EXIT) {
+        LOG(INFO) << "StarExecutor " << id << " exits. ";
+        return;
+      }
+
+      // the transactions of the last phase are replicated
+      release(q);
+
+      Futex::add_and_wake(n_started_workers, 1);
+      if (status == ExecutorStatus::C_PHASE) {
+        if (coordinator_id == 0) {
+          run_transactions(c_context, c_workload, c_protocol, *c_partitioner,
+                           StarQueryNum<ContextType>::get_c_phase_query_num(
+                               context, batch_size.load()));
+        }
+      } else {
+        run_transactions(s_context, s_workload, s_protocol, *s_partitioner,
+                         StarQueryNum<ContextType>::get_s_phase_query_num(
+                             context, batch_size.load()));
+      }
+      flush_async_messages();
+      Futex::add_and_wake(n_complete_workers, 1);
+
+      // once all coordinators are done, the replication requests are
+      // processed
+      Futex::wait_until(
+          worker_status,
+          [](uint32_t s) {
+            return static_cast<ExecutorStatus>(s) == ExecutorStatus::CLEANUP;
+          },
+          [this]() { return process_request(); });
+      process_request();
+      Futex::add_and_wake(n_complete_workers, 1);
+    }
+  }
+
+  void run_transactions(const ContextType &phase_context,
+                        WorkloadType &workload, ProtocolType &protocol,
+                        Partitioner &partitioner, std::size_t query_num) {
+
+    uint64_t last_seed = 0;
+    bool retry_transaction = false;
+    bool is_c_phase = &partitioner == c_partitioner.get();
+
+    for (std::size_t count = 0; count < query_num;) {
+
+      process_request();
+      last_seed = random.get_seed();
+
+      if (retry_transaction) {
+        transaction->reset();
+      } else {
+        auto partition_id = get_partition_id(is_c_phase);
+        transaction =
+            workload.next_transaction(phase_context, partition_id, storage);
+        setupHandlers(*transaction, partitioner, protocol);
+      }
+
+      transaction->phase_timer.start();
+      auto result = transaction->execute(id);
+      transaction->phase_timer.end(TransactionPhase::EXECUTE);
+      if (result == TransactionResult::READY_TO_COMMIT) {
+        bool commit =
+            protocol.commit(*transaction, sync_messages, async_messages);
+        record_phases(transaction->phase_timer);
+        transaction->phase_timer.clear();
+        stats.add(WorkerStats::NETWORK_SIZE, transaction->network_size);
+        if (commit) {
+          stats.add(WorkerStats::COMMIT);
+          count++;
+          retry_transaction = false;
+          q.push(std::move(transaction));
+        } else {
+          if (transaction->abort_lock) {
+            stats.add(WorkerStats::ABORT_LOCK);
+            record_abort(transaction->procedure_id,
+                         &ProcedureStatistics::n_abort_lock);
+          } else {
+            DCHECK(transaction->abort_read_validation);
+            stats.add(WorkerStats::ABORT_READ_VALIDATION);
+            record_abort(transaction->procedure_id,
+                         &ProcedureStatistics::n_abort_read_validation);
+          }
+          random.set_seed(last_seed);
+          retry_transaction = true;
+        }
+      } else {
+        protocol.abort(*transaction, sync_messages, async_messages);
+        record_phases(transaction->phase_timer);
+        stats.add(WorkerStats::ABORT_NO_RETRY);
+        record_abort(transaction->procedure_id,
+                     &ProcedureStatistics::n_abort_no_retry);
+        count++;
+      }
+
+      // with --star_sync, the single-master phase replicates each
+      // transaction right away
+      if ((is_c_phase && context.star_sync_in_single_master_phase) ||
+          count % context.batch_flush == 0) {
+        flush_async_messages();
+      }
+    }
+  }
+
+  std::size_t get_partition_id(bool is_c_phase) {
+    if (is_c_phase) {
+      return random.uniform_dist(0, context.partition_num - 1);
+    }
+
+    auto partition_num_per_node =
+        context.partition_num / context.coordinator_num;
+    auto partition_id = random.uniform_dist(0, partition_num_per_node - 1) *
+                            context.coordinator_num +
+                        coordinator_id;
+    DCHECK(s_partitioner->has_master_partition(partition_id));
+    return partition_id;
+  }
+
+  void setupHandlers(TransactionType &txn, Partitioner &partitioner,
+                     ProtocolType &protocol) {
+
+    // the partitions of a transaction are mastered by this coordinator in
+    // both phases, so all reads are local
+    txn.readRequestHandler =
+        [&partitioner, &protocol](std::size_t table_id,
+                                  std::size_t partition_id,
+                                  uint32_t key_offset, const void *key,
+                                  void *value,
+                                  bool local_index_read) -> uint64_t {
+      CHECK(local_index_read || partitioner.has_master_partition(partition_id))
+          << "partition " << partition_id << " is not mastered locally.";
+      return protocol.search(table_id, partition_id, key, value);
+    };
+
+    txn.readBatchHandler =
+        [&partitioner, &protocol](std::size_t table_id,
+                                  std::size_t partition_id,
+                                  const void *const *keys, void *const *values,
+                                  uint64_t *tids, std::size_t n,
+                                  bool local_index_read) -> bool {
+      CHECK(local_index_read || partitioner.has_master_partition(partition_id))
+          << "partition " << partition_id << " is not mastered locally.";
+      protocol.search_batch(table_id, partition_id, keys, values, tids, n);
+      return true;
+    };
+
+    txn.localTableHandler = [this, &partitioner](
+                                std::size_t table_id,
+                                std::size_t partition_id) -> ITable * {
+      CHECK(partitioner.has_master_partition(partition_id))
+          << "scans on partition " << partition_id << " are not local.";
+      return this->db.find_table(table_id, partition_id);
+    };
+
+    txn.remote_request_handler = [this]() { return this->process_request(); };
+    txn.message_flusher = [this]() { this->flush_sync_messages(); };
+  }
+
+  // the transactions in q are committed
+  void release(std::queue<std::unique_ptr<TransactionType>> &q) {
+    while (!q.empty()) {
+      auto &ptr = q.front();
+      auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                         Clock::now() - ptr->startTime)
+                         .count();
+      percentile.add(latency);
+      record_latency(latency, ptr->procedure_id);
+      q.pop();
+    }
+  }
+
+  void onExit() override {
+    LOG(INFO) << "Worker " << id << " latency: " << percentile.nth(50)
+              << " us (50%) " << percentile.nth(75) << " us (75%) "
+              << percentile.nth(95) << " us (95%) " << percentile.nth(99)
+              << " us (99%).";
+  }
+
+  void push_message(Message *message) override { in_queue.push(message); }
+
+  Message *pop_message() override { return pop_from(out_queue); }
+
+  Message *pop_async_message() override { return pop_from(async_out_queue); }
+
+  Message *pop_from(LockfreeQueue<Message *> &queue) {
+    if (queue.empty())
+      return nullptr;
+
+    Message *message = queue.front();
+
+    bool ok = queue.pop();
+    CHECK(ok);
+
+    return message;
+  }
+
+  std::size_t process_request() {
+
+    std::size_t size = 0;
+    if (!dispatch.is_bound()) {
+      dispatch.bind(messageHandlers);
+      dispatch.prefetch_keys(MessageHandlerType::get_keyed_messages(),
+                             context.prefetch_distance);
+    }
+
+    while (!in_queue.empty()) {
+      std::unique_ptr<Message> message(in_queue.front());
+      bool ok = in_queue.pop();
+      CHECK(ok);
+
+      dispatch.begin(db, *message);
+      for (auto it = message->begin(); it != message->end(); it++) {
+
+        dispatch.next(db);
+        MessagePiece messagePiece = *it;
+        auto type = messagePiece.get_message_type();
+        DCHECK(type < messageHandlers.size());
+        ITable *table = dispatch.table(db, messagePiece);
+
+        dispatch(type, messagePiece,
+                 *sync_messages[message->get_source_node_id()], *table,
+                 transaction.get());
+      }
+
+      size += message->get_message_count();
+      incoming_message_pool.put(message.release());
+      flush_sync_messages();
+    }
+    return size;
+  }
+
+private:
+  void flush_messages(std::vector<std::unique_ptr<Message>> &messages,
+                      LockfreeQueue<Message *> &queue) {
+    for (auto i = 0u; i < messages.size(); i++) {
+      if (i == coordinator_id) {
+        continue;
+      }
+
+      if (messages[i]->get_message_count() == 0) {
+        continue;
+      }
+
+      auto message = messages[i].release();
+
+      push_outgoing(queue, message);
+      messages[i].reset(outgoing_message_pool.get());
+      init_message(messages[i].get(), i);
+    }
+  }
+
+  void flush_sync_messages() { flush_messages(sync_messages, out_queue); }
+
+  void flush_async_messages() {
+    flush_messages(async_messages, async_out_queue);
+  }
+
+  void init_message(Message *message, std::size_t dest_node_id) {
+    message->set_source_node_id(coordinator_id);
+    message->set_dest_node_id(dest_node_id);
+    message->set_worker_id(id);
+  }
+
+private:
+  DatabaseType &db;
+  const ContextType &context;
+  ContextType s_context, c_context;
+  std::atomic<uint32_t> &batch_size, &worker_status;
+  std::atomic<uint32_t> &n_complete_workers, &n_started_workers;
+  std::unique_ptr<Partitioner> s_partitioner, c_partitioner;
+  RandomType random;
+  WorkloadType s_workload, c_workload;
+  ProtocolType s_protocol, c_protocol;
+  Histogram percentile;
+  StorageType storage;
+  std::unique_ptr<TransactionType> transaction;
+  std::queue<std::unique_ptr<TransactionType>> q;
+  std::vector<std::unique_ptr<Message>> sync_messages, async_messages;
+  std::vector<
+      std::function<void(MessagePiece, Message &, ITable &, TransactionType *)>>
+      messageHandlers;
+  MessageDispatch<TransactionType *> dispatch;
+  LockfreeQueue<Message *> in_queue, out_queue, async_out_queue;
+};
+} // namespace coco
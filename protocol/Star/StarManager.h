@@ -0,0 +1,111 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "core/Manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <glog/logging.h>
+#include <thread>
+
+namespace coco {
+
+class StarManager : public coco::Manager {
+public:
+  using base_type = coco::Manager;
+
+  StarManager(std::size_t coordinator_id, std::size_t id,
+              const Context &context, std::atomic<bool> &stopFlag)
+      : base_type(coordinator_id, id, context, stopFlag),
+        batch_size(context.batch_size) {}
+
+  void coordinator_start() override {
+
+    while (!stopFlag.load()) {
+      // the single-master phase, then the partitioned phase
+      auto elapsed = run_phase(ExecutorStatus::C_PHASE);
+      elapsed += run_phase(ExecutorStatus::S_PHASE);
+
+      adjust_batch_size(elapsed);
+    }
+
+    signal_worker(ExecutorStatus::EXIT);
+    LOG(INFO) << "Star batch size: " << batch_size.load();
+  }
+
+  void non_coordinator_start() override {
+
+    for (;;) {
+      ExecutorStatus status = wait4_signal();
+      if (status == ExecutorStatus::EXIT) {
+        set_worker_status(ExecutorStatus::EXIT);
+        break;
+      }
+
+      DCHECK(status == ExecutorStatus::C_PHASE);
+      auto elapsed = run_phase(status);
+
+      status = wait4_signal();
+      DCHECK(status == ExecutorStatus::S_PHASE);
+      elapsed += run_phase(status);
+
+      adjust_batch_size(elapsed);
+    }
+  }
+
+  // returns the time in microseconds the workers took to run the phase
+  uint64_t run_phase(ExecutorStatus status) {
+
+    std::size_t n_coordinators = context.coordinator_num;
+
+    auto start = std::chrono::steady_clock::now();
+    n_started_workers.store(0);
+    n_completed_workers.store(0);
+    if (coordinator_id == 0) {
+      signal_worker(status);
+    } else {
+      set_worker_status(status);
+    }
+    wait_all_workers_start();
+    wait_all_workers_finish();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    broadcast_stop();
+    wait4_stop(n_coordinators - 1);
+    // process replication
+    n_completed_workers.store(0);
+    set_worker_status(ExecutorStatus::CLEANUP);
+    wait_all_workers_finish();
+    // wait for all machines until they finish the phase.
+    if (coordinator_id == 0) {
+      wait4_ack();
+    } else {
+      send_ack();
+    }
+    return elapsed;
+  }
+
+  // with --star_dynamic_batch_size, the workers of a coordinator take around
+  // --group_time ms to run both phases, the replication and the barriers
+  // are not counted. Each coordinator adjusts its own batch.
+  void adjust_batch_size(uint64_t elapsed) {
+    if (!context.star_dynamic_batch_size) {
+      return;
+    }
+
+    uint64_t target = 1000 * context.group_time;
+    uint64_t n = batch_size.load();
+    // move halfway to the size that meets the target, to damp the noise
+    n = (n + n * target / std::max<uint64_t>(1, elapsed)) / 2;
+    batch_size.store(std::max<uint64_t>(1, n));
+  }
+
+public:
+  std::atomic<uint32_t> batch_size;
+};
+} // namespace coco
@@ -0,0 +1,68 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "benchmark/tpcc/Context.h"
+#include "benchmark/ycsb/Context.h"
+
+namespace coco {
+
+/*
+ * The number of transactions a worker runs in each phase of Star, given that
+ * a worker on each coordinator has batch_size transactions per iteration.
+ * The cross-partition ones of all coordinators run in the single-master phase
+ * on coordinator 0, the others run where their partition is mastered.
+ */
+
+template <class Context> class StarQueryNum {};
+
+template <> class StarQueryNum<coco::tpcc::Context> {
+public:
+  static std::size_t get_s_phase_query_num(const coco::tpcc::Context &context,
+                                           std::size_t batch_size) {
+    return batch_size - batch_size * cross_partition_probability(context) / 100;
+  }
+
+  static std::size_t get_c_phase_query_num(const coco::tpcc::Context &context,
+                                           std::size_t batch_size) {
+    return context.coordinator_num * batch_size *
+           cross_partition_probability(context) / 100;
+  }
+
+  // out of 100
+  static std::size_t
+  cross_partition_probability(const coco::tpcc::Context &context) {
+    switch (context.workloadType) {
+    case coco::tpcc::TPCCWorkloadType::NEW_ORDER_ONLY:
+      return context.newOrderCrossPartitionProbability;
+    case coco::tpcc::TPCCWorkloadType::PAYMENT_ONLY:
+      return context.paymentCrossPartitionProbability;
+    case coco::tpcc::TPCCWorkloadType::MIXED:
+      return (context.newOrderCrossPartitionProbability +
+              context.paymentCrossPartitionProbability) /
+             2;
+    default:
+      // 45% NewOrder and 43% Payment, the others are single-partition
+      return (45 * context.newOrderCrossPartitionProbability +
+              43 * context.paymentCrossPartitionProbability) /
+             100;
+    }
+  }
+};
+
+template <> class StarQueryNum<coco::ycsb::Context> {
+public:
+  static std::size_t get_s_phase_query_num(const coco::ycsb::Context &context,
+                                           std::size_t batch_size) {
+    return batch_size - batch_size * context.crossPartitionProbability / 100;
+  }
+
+  static std::size_t get_c_phase_query_num(const coco::ycsb::Context &context,
+                                           std::size_t batch_size) {
+    return context.coordinator_num * batch_size *
+           context.crossPartitionProbability / 100;
+  }
+};
+} // namespace coco
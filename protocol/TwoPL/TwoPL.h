@@ -13,6 +13,7 @@
 #include "protocol/TwoPL/TwoPLHelper.h"
 #include "protocol/TwoPL/TwoPLMessage.h"
 #include "protocol/TwoPL/TwoPLTransaction.h"
+#include "protocol/TwoPL/TwoPLWait.h"
 #include <glog/logging.h>
 
 namespace coco {
@@ -34,10 +35,10 @@ public:
   uint64_t search(std::size_t table_id, std::size_t partition_id,
                   const void *key, void *value) const {
 
-    ITable *table = db.find_table(table_id, partition_id);
-    auto value_bytes = table->value_size();
-    auto row = table->search(key);
-    return TwoPLHelper::read(row, value, value_bytes);
+    return db.visit_table(table_id, partition_id, [key, value](auto &table) {
+      auto row = table.search(key);
+      return TwoPLHelper::read(row, value, table.value_size());
+    });
   }
 
   uint64_t generate_tid(TransactionType &txn) {
@@ -50,7 +51,8 @@ public:
     // larger than the TID of any record read or written by the transaction
 
     for (std::size_t i = 0; i < readSet.size(); i++) {
-      next_tid = std::max(next_tid, readSet[i].get_tid());
+      next_tid = std::max(next_tid,
+                          TwoPLHelper::remove_absent_bit(readSet[i].get_tid()));
     }
 
     // larger than the worker's most recent chosen TID
@@ -84,7 +86,11 @@ public:
           auto key = readKey.get_key();
           auto value = readKey.get_value();
           std::atomic<uint64_t> &tid = table->search_metadata(key);
-          TwoPLHelper::read_lock_release(tid);
+          if (readKey.get_biased_read_lock_bit()) {
+            TwoPLHelper::biased_read_lock_release(tid, txn.worker_id);
+          } else {
+            TwoPLHelper::read_lock_release(tid);
+          }
         } else {
           auto coordinatorID = partitioner.master_coordinator(partitionId);
           txn.network_size += MessageFactoryType::new_abort_message(
@@ -107,6 +113,7 @@ public:
     }
 
     sync_messages(txn, false);
+    TwoPLWait::heal(txn.wait_ts);
   }
 
   bool commit(TransactionType &txn,
@@ -127,6 +134,7 @@ public:
 
     // release locks
     release_lock(txn, commit_tid, messages);
+    txn.phase_timer.end(TransactionPhase::WRITE);
 
     return true;
   }
@@ -142,12 +150,17 @@ public:
       auto tableId = writeKey.get_table_id();
       auto partitionId = writeKey.get_partition_id();
       auto table = db.find_table(tableId, partitionId);
+      // a delete replicates the row as it is with a tombstone tid
+      uint64_t write_tid =
+          TwoPLHelper::write_tid(commit_tid, writeKey.get_delete_bit());
 
       // write
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
         auto value = writeKey.get_value();
-        table->update(key, value);
+        if (!writeKey.get_delete_bit()) {
+          table->update(key, value);
+        }
       } else {
         txn.pendingResponses++;
         auto coordinatorID = partitioner.master_coordinator(partitionId);
@@ -178,18 +191,25 @@ public:
         if (k == txn.coordinator_id) {
           auto key = writeKey.get_key();
           auto value = writeKey.get_value();
-          table->update(key, value);
+          if (writeKey.get_delete_bit()) {
+            std::atomic<uint64_t> &tid = table->search_metadata(key);
+            TwoPLHelper::write_lock(tid);
+            TwoPLHelper::write_lock_release(tid, write_tid);
+          } else {
+            table->update(key, value);
+          }
         } else {
 
           txn.pendingResponses++;
           auto coordinatorID = k;
           txn.network_size += MessageFactoryType::new_replication_message(
               *messages[coordinatorID], *table, writeKey.get_key(),
-              writeKey.get_value(), commit_tid);
+              writeKey.get_value(), write_tid);
         }
       }
 
-      DCHECK(replicate_count == partitioner.replica_num() - 1);
+      DCHECK(replicate_count ==
+             partitioner.partition_replica_num(partitionId) - 1);
     }
     sync_messages(txn);
   }
@@ -210,7 +230,11 @@ public:
           auto key = readKey.get_key();
           auto value = readKey.get_value();
           std::atomic<uint64_t> &tid = table->search_metadata(key);
-          TwoPLHelper::read_lock_release(tid);
+          if (readKey.get_biased_read_lock_bit()) {
+            TwoPLHelper::biased_read_lock_release(tid, txn.worker_id);
+          } else {
+            TwoPLHelper::read_lock_release(tid);
+          }
         } else {
           txn.pendingResponses++;
           auto coordinatorID = partitioner.master_coordinator(partitionId);
@@ -227,18 +251,25 @@ public:
       auto tableId = writeKey.get_table_id();
       auto partitionId = writeKey.get_partition_id();
       auto table = db.find_table(tableId, partitionId);
+      bool is_delete = writeKey.get_delete_bit();
+      uint64_t write_tid = TwoPLHelper::write_tid(commit_tid, is_delete);
       // write
       if (partitioner.has_master_partition(partitionId)) {
         auto key = writeKey.get_key();
         auto value = writeKey.get_value();
         std::atomic<uint64_t> &tid = table->search_metadata(key);
-        table->update(key, value);
-        TwoPLHelper::write_lock_release(tid, commit_tid);
+        if (!is_delete) {
+          table->update(key, value);
+        }
+        TwoPLHelper::write_lock_release(tid, write_tid);
+        if (is_delete) {
+          table->retire(key);
+        }
       } else {
         txn.pendingResponses++;
         auto coordinatorID = partitioner.master_coordinator(partitionId);
         txn.network_size += MessageFactoryType::new_release_write_lock_message(
-            *messages[coordinatorID], *table, writeKey.get_key(), commit_tid);
+            *messages[coordinatorID], *table, writeKey.get_key(), write_tid);
       }
     }
 
@@ -6,6 +6,10 @@
 
 #include "core/Executor.h"
 #include "protocol/TwoPL/TwoPL.h"
+#include "protocol/TwoPL/TwoPLWait.h"
+
+#include <boost/algorithm/string.hpp>
+#include <chrono>
 
 namespace coco {
 template <class Workload>
@@ -34,7 +38,22 @@ public:
                 std::atomic<uint32_t> &n_complete_workers,
                 std::atomic<uint32_t> &n_started_workers)
       : base_type(coordinator_id, id, db, context, worker_status,
-                  n_complete_workers, n_started_workers) {}
+                  n_complete_workers, n_started_workers),
+        wait_policy(TwoPLWait::policy(context.wait_policy)) {
+    // inserts and deletes leave tombstones, see Tombstone
+    Tombstone::set(db, context.partition_num, TwoPLHelper::tombstone());
+    if (!context.hot_tables.empty()) {
+      CHECK(id < TwoPLReaderIndicator::MAX_WORKERS);
+      std::vector<std::string> tables;
+      boost::algorithm::split(tables, context.hot_tables,
+                              boost::is_any_of(","));
+      for (auto &table : tables) {
+        auto table_id = std::stoul(table);
+        hot_tables.resize(std::max(hot_tables.size(), table_id + 1), false);
+        hot_tables[table_id] = true;
+      }
+    }
+  }
 
   ~
 
@@ -43,6 +62,8 @@ public:
   void setupHandlers(TransactionType &txn)
 
       override {
+    txn.worker_id = this->id;
+    txn.wait_ts = next_wait_ts();
     txn.lock_request_handler =
         [this, &txn](std::size_t table_id, std::size_t partition_id,
                      uint32_t key_offset, const void *key, void *value,
@@ -62,10 +83,25 @@ public:
 
         std::atomic<uint64_t> &tid = table->search_metadata(key);
 
-        if (write_lock) {
-          TwoPLHelper::write_lock(tid, success);
+        if (!write_lock && table_id < hot_tables.size() &&
+            hot_tables[table_id]) {
+          bool biased;
+          TwoPLHelper::biased_read_lock(tid, this->id, success, biased);
+          if (biased) {
+            txn.readSet[key_offset].set_biased_read_lock_bit();
+          }
+        } else if (wait_policy == TwoPLWaitPolicy::NO_WAIT) {
+          if (write_lock) {
+            TwoPLHelper::write_lock(tid, success);
+          } else {
+            TwoPLHelper::read_lock(tid, success);
+          }
         } else {
-          TwoPLHelper::read_lock(tid, success);
+          // an aborted transaction does not wait for more locks
+          auto spins = txn.abort_lock ? 0 : this->context.lock_spin;
+          TwoPLWait::lock(tid, write_lock, txn.wait_ts, wait_policy, spins,
+                          success,
+                          [this]() { this->process_request_and_yield(); });
         }
 
         if (success) {
@@ -81,20 +117,58 @@ public:
         auto coordinatorID =
             this->partitioner->master_coordinator(partition_id);
 
+        auto spins = wait_policy == TwoPLWaitPolicy::NO_WAIT || txn.abort_lock
+                         ? 0
+                         : this->context.lock_spin;
         if (write_lock) {
           txn.network_size += MessageFactoryType::new_write_lock_message(
-              *(this->messages[coordinatorID]), *table, key, key_offset);
+              *(this->messages[coordinatorID]), *table, key, key_offset,
+              txn.wait_ts, wait_policy, spins);
         } else {
           txn.network_size += MessageFactoryType::new_read_lock_message(
-              *(this->messages[coordinatorID]), *table, key, key_offset);
+              *(this->messages[coordinatorID]), *table, key, key_offset,
+              txn.wait_ts, wait_policy, spins);
         }
         txn.distributed_transaction = true;
         return 0;
       }
     };
 
-    txn.remote_request_handler = [this]() { return this->process_request(); };
-    txn.message_flusher = [this]() { this->flush_messages(); };
+    txn.localTableHandler = [this](std::size_t table_id,
+                                   std::size_t partition_id) -> ITable * {
+      CHECK(this->partitioner->has_master_partition(partition_id))
+          << "inserts on partition " << partition_id << " are not local.";
+      return this->db.find_table(table_id, partition_id);
+    };
+
+    txn.remote_request_handler = [this]() {
+      return this->process_request_and_yield();
+    };
+    txn.message_flusher = [this]() { this->flush_requests(); };
   };
+
+private:
+  // timestamps are in us with the worker in the lower bits, and a retried
+  // transaction keeps its timestamp to become the oldest one eventually
+  uint64_t next_wait_ts() {
+    uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    uint64_t worker =
+        this->coordinator_id * this->context.worker_num + this->id;
+    uint64_t ts = (now << WORKER_BITS) | (worker & ((1 << WORKER_BITS) - 1));
+    if (ts <= last_wait_ts) {
+      ts = last_wait_ts + (1 << WORKER_BITS);
+    }
+    last_wait_ts = ts;
+    return ts;
+  }
+
+private:
+  static constexpr int WORKER_BITS = 12;
+  TwoPLWaitPolicy wait_policy;
+  // read locks of rows in hot tables use TwoPLReaderIndicator
+  std::vector<bool> hot_tables;
+  uint64_t last_wait_ts = 0;
 };
 } // namespace coco
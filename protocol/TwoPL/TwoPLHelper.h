@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include "core/Tombstone.h"
+#include "protocol/TwoPL/TwoPLReaderIndicator.h"
+
 #include <atomic>
 #include <cstring>
 #include <glog/logging.h>
@@ -26,8 +29,11 @@ public:
   }
 
   /**
-   * [write lock bit (1) |  read lock bit (9) -- 512 - 1 locks | seq id  (54) ]
+   * [write lock bit (1) |  read lock bit (9) -- 512 - 1 locks | bias bit (1) |
+   *   absent bit (1) | seq id  (52) ]
    *
+   * the bias bit is set when the readers of a row use TwoPLReaderIndicator.
+   * the absent bit is set when the row is a tombstone, see Tombstone.
    */
 
   static bool is_read_locked(uint64_t value) {
@@ -42,6 +48,10 @@ public:
     return (value >> READ_LOCK_BIT_OFFSET) & READ_LOCK_BIT_MASK;
   }
 
+  static bool is_biased(uint64_t value) {
+    return value & (BIAS_BIT_MASK << BIAS_BIT_OFFSET);
+  }
+
   static uint64_t read_lock_max() { return READ_LOCK_BIT_MASK; }
 
   static uint64_t read_lock(std::atomic<uint64_t> &a, bool &success) {
@@ -59,6 +69,39 @@ public:
     return remove_lock_bit(old_value);
   }
 
+  /*
+   * A read lock on a row of a hot table. If the row is biased, the lock is
+   * published in the reader indicator of worker and biased is set, so that
+   * it is released by the same worker with biased_read_lock_release.
+   * Otherwise, the lock word is used and the bias may be set again.
+   */
+
+  static uint64_t biased_read_lock(std::atomic<uint64_t> &a, std::size_t worker,
+                                   bool &success, bool &biased) {
+    biased = false;
+    uint64_t value = a.load();
+    if (is_biased(value) && TwoPLReaderIndicator::publish(worker, a)) {
+      value = a.load();
+      if (is_biased(value) && !is_write_locked(value)) {
+        success = biased = true;
+        return remove_lock_bit(value);
+      }
+      TwoPLReaderIndicator::withdraw(worker, a);
+    }
+
+    uint64_t tid = read_lock(a, success);
+    // no writer holds the row until the read lock is released
+    if (success && !is_biased(a.load()) && TwoPLReaderIndicator::may_bias(a)) {
+      a.fetch_or(BIAS_BIT_MASK << BIAS_BIT_OFFSET);
+    }
+    return tid;
+  }
+
+  static void biased_read_lock_release(std::atomic<uint64_t> &a,
+                                       std::size_t worker) {
+    TwoPLReaderIndicator::withdraw(worker, a);
+  }
+
   static uint64_t write_lock(std::atomic<uint64_t> &a, bool &success) {
     uint64_t old_value = a.load();
     if (is_read_locked(old_value) || is_write_locked(old_value)) {
@@ -68,6 +111,9 @@ public:
     uint64_t new_value =
         old_value + (WRITE_LOCK_BIT_MASK << WRITE_LOCK_BIT_OFFSET);
     success = a.compare_exchange_strong(old_value, new_value);
+    if (success && is_biased(new_value)) {
+      success = revoke_bias(a, DRAIN_SPINS);
+    }
     return remove_lock_bit(old_value);
   }
 
@@ -82,9 +128,28 @@ public:
       new_value = old_value + (WRITE_LOCK_BIT_MASK << WRITE_LOCK_BIT_OFFSET);
 
     } while (!a.compare_exchange_weak(old_value, new_value));
+    if (is_biased(new_value)) {
+      revoke_bias(a, UINT64_MAX);
+    }
     return remove_lock_bit(old_value);
   }
 
+  /*
+   * Called with the write lock held. If the readers in the indicators do not
+   * leave in time, the bias is set back for them and the lock is released,
+   * so that a writer never waits for a reader that waits for it.
+   */
+
+  static bool revoke_bias(std::atomic<uint64_t> &a, uint64_t spins) {
+    a.fetch_and(~(BIAS_BIT_MASK << BIAS_BIT_OFFSET));
+    if (TwoPLReaderIndicator::drain(a, spins)) {
+      return true;
+    }
+    a.fetch_or(BIAS_BIT_MASK << BIAS_BIT_OFFSET);
+    write_lock_release(a);
+    return false;
+  }
+
   static void read_lock_release(std::atomic<uint64_t> &a) {
     uint64_t old_value, new_value;
     do {
@@ -117,7 +182,22 @@ public:
   }
 
   static uint64_t remove_lock_bit(uint64_t value) {
-    return value & ~(LOCK_BIT_MASK << LOCK_BIT_OFFSET);
+    return value & ~(LOCK_BIT_MASK << LOCK_BIT_OFFSET) &
+           ~(BIAS_BIT_MASK << BIAS_BIT_OFFSET);
+  }
+
+  static bool is_absent(uint64_t value) {
+    return (value >> ABSENT_BIT_OFFSET) & ABSENT_BIT_MASK;
+  }
+
+  static uint64_t remove_absent_bit(uint64_t value) {
+    return value & ~(ABSENT_BIT_MASK << ABSENT_BIT_OFFSET);
+  }
+
+  // the tid a write of commit_tid leaves, a delete leaves a tombstone
+  static uint64_t write_tid(uint64_t commit_tid, bool is_delete) {
+    return is_delete ? commit_tid | (ABSENT_BIT_MASK << ABSENT_BIT_OFFSET)
+                     : commit_tid;
   }
 
   static uint64_t remove_read_lock_bit(uint64_t value) {
@@ -137,5 +217,21 @@ public:
 
   static constexpr int WRITE_LOCK_BIT_OFFSET = 63;
   static constexpr uint64_t WRITE_LOCK_BIT_MASK = 0x1ull;
+
+  static constexpr int BIAS_BIT_OFFSET = 53;
+  static constexpr uint64_t BIAS_BIT_MASK = 0x1ull;
+
+  static constexpr int ABSENT_BIT_OFFSET = 52;
+  static constexpr uint64_t ABSENT_BIT_MASK = 0x1ull;
+
+  // a biased row may have readers in the reader indicators
+  static constexpr Tombstone tombstone() {
+    return Tombstone{
+        ABSENT_BIT_MASK << ABSENT_BIT_OFFSET,
+        (LOCK_BIT_MASK << LOCK_BIT_OFFSET) | (BIAS_BIT_MASK << BIAS_BIT_OFFSET),
+        WRITE_LOCK_BIT_MASK << WRITE_LOCK_BIT_OFFSET};
+  }
+
+  static constexpr uint64_t DRAIN_SPINS = 1 << 14;
 };
 } // namespace coco
\ No newline at end of file
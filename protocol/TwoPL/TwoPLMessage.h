@@ -13,6 +13,7 @@
 #include "protocol/TwoPL/TwoPLHelper.h"
 #include "protocol/TwoPL/TwoPLRWKey.h"
 #include "protocol/TwoPL/TwoPLTransaction.h"
+#include "protocol/TwoPL/TwoPLWait.h"
 
 namespace coco {
 
@@ -37,17 +38,22 @@ class TwoPLMessageFactory {
 
 public:
   static std::size_t new_read_lock_message(Message &message, ITable &table,
-                                           const void *key,
-                                           uint32_t key_offset) {
+                                           const void *key, uint32_t key_offset,
+                                           uint64_t wait_ts,
+                                           TwoPLWaitPolicy wait_policy,
+                                           uint64_t spins) {
 
     /*
-     * The structure of a read lock request: (primary key, key offset)
+     * The structure of a read lock request: (primary key, key offset, wait ts,
+     * wait policy, spins)
      */
 
     auto key_size = table.key_size();
+    auto policy = static_cast<uint32_t>(wait_policy);
 
-    auto message_size =
-        MessagePiece::get_header_size() + key_size + sizeof(key_offset);
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        sizeof(key_offset) + sizeof(wait_ts) + sizeof(policy) +
+                        sizeof(spins);
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(TwoPLMessage::READ_LOCK_REQUEST), message_size,
         table.tableID(), table.partitionID());
@@ -55,23 +61,29 @@ public:
     Encoder encoder(message.data);
     encoder << message_piece_header;
     encoder.write_n_bytes(key, key_size);
-    encoder << key_offset;
+    encoder << key_offset << wait_ts << policy << spins;
     message.flush();
     return message_size;
   }
 
   static std::size_t new_write_lock_message(Message &message, ITable &table,
                                             const void *key,
-                                            uint32_t key_offset) {
+                                            uint32_t key_offset,
+                                            uint64_t wait_ts,
+                                            TwoPLWaitPolicy wait_policy,
+                                            uint64_t spins) {
 
     /*
-     * The structure of a write lock request: (primary key, key offset)
+     * The structure of a write lock request: (primary key, key offset, wait ts,
+     * wait policy, spins)
      */
 
     auto key_size = table.key_size();
+    auto policy = static_cast<uint32_t>(wait_policy);
 
-    auto message_size =
-        MessagePiece::get_header_size() + key_size + sizeof(key_offset);
+    auto message_size = MessagePiece::get_header_size() + key_size +
+                        sizeof(key_offset) + sizeof(wait_ts) + sizeof(policy) +
+                        sizeof(spins);
     auto message_piece_header = MessagePiece::construct_message_piece_header(
         static_cast<uint32_t>(TwoPLMessage::WRITE_LOCK_REQUEST), message_size,
         table.tableID(), table.partitionID());
@@ -79,7 +91,7 @@ public:
     Encoder encoder(message.data);
     encoder << message_piece_header;
     encoder.write_n_bytes(key, key_size);
-    encoder << key_offset;
+    encoder << key_offset << wait_ts << policy << spins;
     message.flush();
     return message_size;
   }
@@ -220,16 +232,20 @@ public:
     auto value_size = table.value_size();
 
     /*
-     * The structure of a read lock request: (primary key, key offset)
+     * The structure of a read lock request: (primary key, key offset, wait ts,
+     * wait policy, spins)
      * The structure of a read lock response: (success?, key offset, value?,
      * tid?)
      */
 
     auto stringPiece = inputPiece.toStringPiece();
     uint32_t key_offset;
+    uint64_t wait_ts, spins;
+    uint32_t policy;
 
     DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + key_size + sizeof(key_offset));
+           MessagePiece::get_header_size() + key_size + sizeof(key_offset) +
+               sizeof(wait_ts) + sizeof(policy) + sizeof(spins));
 
     const void *key = stringPiece.data();
     auto row = table.search(key);
@@ -237,12 +253,15 @@ public:
 
     stringPiece.remove_prefix(key_size);
     coco::Decoder dec(stringPiece);
-    dec >> key_offset;
+    dec >> key_offset >> wait_ts >> policy >> spins;
 
     DCHECK(dec.size() == 0);
 
+    // the executor cannot process other requests while waiting here
     bool success;
-    uint64_t latest_tid = TwoPLHelper::read_lock(tid, success);
+    uint64_t latest_tid =
+        TwoPLWait::lock(tid, false, wait_ts,
+                        static_cast<TwoPLWaitPolicy>(policy), spins, success);
 
     // prepare response message header
     auto message_size =
@@ -314,6 +333,7 @@ public:
                  sizeof(key_offset));
 
       txn->abort_lock = true;
+      txn->set_conflict(txn->readSet[key_offset]);
     }
 
     txn->pendingResponses--;
@@ -334,16 +354,20 @@ public:
     auto value_size = table.value_size();
 
     /*
-     * The structure of a write lock request: (primary key, key offset)
+     * The structure of a write lock request: (primary key, key offset, wait ts,
+     * wait policy, spins)
      * The structure of a write lock response: (success?, key offset, value?,
      * tid?)
      */
 
     auto stringPiece = inputPiece.toStringPiece();
     uint32_t key_offset;
+    uint64_t wait_ts, spins;
+    uint32_t policy;
 
     DCHECK(inputPiece.get_message_length() ==
-           MessagePiece::get_header_size() + key_size + sizeof(key_offset));
+           MessagePiece::get_header_size() + key_size + sizeof(key_offset) +
+               sizeof(wait_ts) + sizeof(policy) + sizeof(spins));
 
     const void *key = stringPiece.data();
     auto row = table.search(key);
@@ -351,12 +375,15 @@ public:
 
     stringPiece.remove_prefix(key_size);
     coco::Decoder dec(stringPiece);
-    dec >> key_offset;
+    dec >> key_offset >> wait_ts >> policy >> spins;
 
     DCHECK(dec.size() == 0);
 
+    // the executor cannot process other requests while waiting here
     bool success;
-    uint64_t latest_tid = TwoPLHelper::write_lock(tid, success);
+    uint64_t latest_tid =
+        TwoPLWait::lock(tid, true, wait_ts,
+                        static_cast<TwoPLWaitPolicy>(policy), spins, success);
 
     // prepare response message header
     auto message_size =
@@ -428,6 +455,7 @@ public:
                  sizeof(key_offset));
 
       txn->abort_lock = true;
+      txn->set_conflict(txn->readSet[key_offset]);
     }
 
     txn->pendingResponses--;
@@ -564,7 +592,8 @@ public:
     std::atomic<uint64_t> &tid = table.search_metadata(key);
 
     uint64_t last_tid = TwoPLHelper::write_lock(tid);
-    DCHECK(last_tid < commit_tid);
+    DCHECK(TwoPLHelper::remove_absent_bit(last_tid) <
+           TwoPLHelper::remove_absent_bit(commit_tid));
     table.deserialize_value(key, valueStringPiece);
     TwoPLHelper::write_lock_release(tid, commit_tid);
 
@@ -692,6 +721,10 @@ public:
 
     std::atomic<uint64_t> &tid = table.search_metadata(key);
     TwoPLHelper::write_lock_release(tid, commit_tid);
+    // the write deleted the row, see Tombstone
+    if (TwoPLHelper::is_absent(commit_tid)) {
+      table.retire(key);
+    }
 
     // prepare response message header
     auto message_size = MessagePiece::get_header_size();
@@ -725,6 +758,18 @@ public:
   }
 
 public:
+  // the types whose pieces start with a key of their table, see
+  // MessageDispatch::prefetch_keys
+  static std::vector<uint32_t> get_keyed_messages() {
+    return {static_cast<uint32_t>(TwoPLMessage::READ_LOCK_REQUEST),
+            static_cast<uint32_t>(TwoPLMessage::WRITE_LOCK_REQUEST),
+            static_cast<uint32_t>(TwoPLMessage::ABORT_REQUEST),
+            static_cast<uint32_t>(TwoPLMessage::WRITE_REQUEST),
+            static_cast<uint32_t>(TwoPLMessage::REPLICATION_REQUEST),
+            static_cast<uint32_t>(TwoPLMessage::RELEASE_READ_LOCK_REQUEST),
+            static_cast<uint32_t>(TwoPLMessage::RELEASE_WRITE_LOCK_REQUEST)};
+  }
+
   static std::vector<
       std::function<void(MessagePiece, Message &, ITable &, Transaction *)>>
   get_message_handlers() {
@@ -91,6 +91,48 @@ public:
            WRITE_LOCK_REQUEST_BIT_MASK;
   }
 
+  // biased read lock bit
+
+  void set_biased_read_lock_bit() {
+    clear_biased_read_lock_bit();
+    bitvec |= BIASED_READ_LOCK_BIT_MASK << BIASED_READ_LOCK_BIT_OFFSET;
+  }
+
+  void clear_biased_read_lock_bit() {
+    bitvec &= ~(BIASED_READ_LOCK_BIT_MASK << BIASED_READ_LOCK_BIT_OFFSET);
+  }
+
+  uint32_t get_biased_read_lock_bit() const {
+    return (bitvec >> BIASED_READ_LOCK_BIT_OFFSET) &
+           BIASED_READ_LOCK_BIT_MASK;
+  }
+
+  // insert bit
+
+  void set_insert_bit() {
+    clear_insert_bit();
+    bitvec |= INSERT_BIT_MASK << INSERT_BIT_OFFSET;
+  }
+
+  void clear_insert_bit() { bitvec &= ~(INSERT_BIT_MASK << INSERT_BIT_OFFSET); }
+
+  bool get_insert_bit() const {
+    return (bitvec >> INSERT_BIT_OFFSET) & INSERT_BIT_MASK;
+  }
+
+  // delete bit
+
+  void set_delete_bit() {
+    clear_delete_bit();
+    bitvec |= DELETE_BIT_MASK << DELETE_BIT_OFFSET;
+  }
+
+  void clear_delete_bit() { bitvec &= ~(DELETE_BIT_MASK << DELETE_BIT_OFFSET); }
+
+  bool get_delete_bit() const {
+    return (bitvec >> DELETE_BIT_OFFSET) & DELETE_BIT_MASK;
+  }
+
   // table id
 
   void set_table_id(uint32_t table_id) {
@@ -139,7 +181,8 @@ private:
   /*
    * A bitvec is a 32-bit word.
    *
-   * [ table id (5) ] | partition id (16) | unused bit (6) |
+   * [ table id (5) ] | partition id (16) | unused bit (3) | delete bit (1) |
+   *   insert bit (1) | biased read lock bit (1) |
    *   write lock request bit (1) | read lock request bit (1)
    *   write lock bit(1) | read lock bit (1) | local index read (1)  ]
    *
@@ -149,6 +192,9 @@ private:
    * read lock bit is set when a read lock is acquired.
    * write lock request bit is set when a write lock request is needed.
    * read lock request bit is set when a read lock request is needed.
+   * biased read lock bit is set when a read lock is in a reader indicator.
+   * insert bit is set when the write inserts the row.
+   * delete bit is set when the write deletes the row.
    *
    */
 
@@ -164,6 +210,15 @@ public:
   static constexpr uint32_t PARTITION_ID_MASK = 0xffff;
   static constexpr uint32_t PARTITION_ID_OFFSET = 11;
 
+  static constexpr uint32_t DELETE_BIT_MASK = 0x1;
+  static constexpr uint32_t DELETE_BIT_OFFSET = 7;
+
+  static constexpr uint32_t INSERT_BIT_MASK = 0x1;
+  static constexpr uint32_t INSERT_BIT_OFFSET = 6;
+
+  static constexpr uint32_t BIASED_READ_LOCK_BIT_MASK = 0x1;
+  static constexpr uint32_t BIASED_READ_LOCK_BIT_OFFSET = 5;
+
   static constexpr uint32_t WRITE_LOCK_REQUEST_BIT_MASK = 0x1;
   static constexpr uint32_t WRITE_LOCK_REQUEST_BIT_OFFSET = 4;
 
@@ -0,0 +1,123 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <glog/logging.h>
+
+namespace coco {
+
+/*
+ * TwoPLReaderIndicator keeps the readers of read-mostly rows off the lock
+ * word, which otherwise bounces between all cores.
+ *
+ * While a row is biased to readers, a reader publishes the address of the
+ * lock word in a slot of its own worker, hashed by the address, and leaves
+ * the lock word untouched. A writer first takes the write lock, revokes the
+ * bias and then drains the slot of every worker for the row. Since a drain
+ * costs a load per worker, the bias is not set again for INHIBIT_FACTOR times
+ * as long as the drain took.
+ *
+ * A reader whose slot is taken by another row uses the lock word. The slots
+ * of a worker are only written by the worker itself, so a read lock taken
+ * this way must be released by the same worker.
+ */
+
+class TwoPLReaderIndicator {
+public:
+  static constexpr std::size_t MAX_WORKERS = 128;
+  static constexpr std::size_t SLOTS_PER_WORKER = 64;
+  static constexpr std::size_t INHIBIT_SLOTS = 1 << 12;
+  static constexpr uint64_t INHIBIT_FACTOR = 9;
+
+  // returns false if the slot of worker is taken by another row
+  static bool publish(std::size_t worker, const std::atomic<uint64_t> &a) {
+    DCHECK(worker < MAX_WORKERS);
+    auto &slot = slot_of(worker, a);
+    if (slot.load(std::memory_order_relaxed) != nullptr) {
+      return false;
+    }
+    slot.store(&a);
+    uint64_t n = n_workers().load(std::memory_order_relaxed);
+    while (n <= worker &&
+           !n_workers().compare_exchange_weak(n, worker + 1)) {
+    }
+    return true;
+  }
+
+  static void withdraw(std::size_t worker, const std::atomic<uint64_t> &a) {
+    auto &slot = slot_of(worker, a);
+    DCHECK(slot.load(std::memory_order_relaxed) == &a);
+    slot.store(nullptr, std::memory_order_release);
+  }
+
+  static bool is_published(std::size_t worker,
+                           const std::atomic<uint64_t> &a) {
+    return slot_of(worker, a).load(std::memory_order_relaxed) == &a;
+  }
+
+  // waits for at most spins rounds until no worker reads the row
+  static bool drain(const std::atomic<uint64_t> &a, uint64_t spins) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t n = n_workers().load();
+    bool drained = true;
+    for (auto worker = 0u; worker < n; worker++) {
+      auto &slot = slot_of(worker, a);
+      for (uint64_t i = 0; slot.load() == &a; i++) {
+        if (i >= spins) {
+          drained = false;
+          break;
+        }
+        __asm volatile("pause" : :);
+      }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    inhibit_until(a).store(
+        (start + elapsed * INHIBIT_FACTOR).time_since_epoch().count(),
+        std::memory_order_relaxed);
+    return drained;
+  }
+
+  // whether the bias of the row can be set again
+  static bool may_bias(const std::atomic<uint64_t> &a) {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    return now >= inhibit_until(a).load(std::memory_order_relaxed);
+  }
+
+private:
+  static std::atomic<const void *> &slot_of(std::size_t worker,
+                                            const std::atomic<uint64_t> &a) {
+    return slots()[worker * SLOTS_PER_WORKER + hash(&a) % SLOTS_PER_WORKER];
+  }
+
+  static std::atomic<int64_t> &inhibit_until(const std::atomic<uint64_t> &a) {
+    return inhibits()[hash(&a) % INHIBIT_SLOTS];
+  }
+
+  static uint64_t hash(const void *p) {
+    auto x = reinterpret_cast<uintptr_t>(p);
+    x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdull;
+    return x ^ (x >> 33);
+  }
+
+  static std::atomic<const void *> *slots() {
+    static auto slots =
+        new std::atomic<const void *>[MAX_WORKERS * SLOTS_PER_WORKER]();
+    return slots;
+  }
+
+  static std::atomic<int64_t> *inhibits() {
+    static auto inhibits = new std::atomic<int64_t>[INHIBIT_SLOTS]();
+    return inhibits;
+  }
+
+  static std::atomic<uint64_t> &n_workers() {
+    static std::atomic<uint64_t> n(0);
+    return n;
+  }
+};
+} // namespace coco
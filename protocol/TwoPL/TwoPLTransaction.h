@@ -6,9 +6,14 @@
 
 #include "common/Message.h"
 #include "common/Operation.h"
+#include "common/SmallVector.h"
+#include "common/Time.h"
 #include "core/Defs.h"
+#include "core/KeyIndex.h"
 #include "core/Partitioner.h"
+#include "core/Statistics.h"
 #include "core/Table.h"
+#include "protocol/TwoPL/TwoPLHelper.h"
 #include "protocol/TwoPL/TwoPLRWKey.h"
 #include <chrono>
 #include <glog/logging.h>
@@ -23,7 +28,7 @@ public:
   TwoPLTransaction(std::size_t coordinator_id, std::size_t partition_id,
                    Partitioner &partitioner)
       : coordinator_id(coordinator_id), partition_id(partition_id),
-        startTime(std::chrono::steady_clock::now()), partitioner(partitioner) {
+        startTime(Clock::now()), partitioner(partitioner) {
     reset();
   }
 
@@ -32,8 +37,10 @@ public:
   void reset() {
     pendingResponses = 0;
     network_size = 0;
+    phase_timer.clear();
     abort_lock = false;
     abort_read_validation = false;
+    conflict_key = nullptr;
     local_validated = false;
     si_in_serializable = false;
     distributed_transaction = false;
@@ -41,6 +48,8 @@ public:
     operation.clear();
     readSet.clear();
     writeSet.clear();
+    read_key_index.clear();
+    write_key_index.clear();
   }
 
   virtual TransactionResult execute(std::size_t worker_id) = 0;
@@ -85,6 +94,24 @@ public:
     add_to_read_set(readKey);
   }
 
+  // reads the whole value, the fields are a hint, see FieldProjection
+  template <class KeyType, class ValueType>
+  void search_for_read(std::size_t table_id, std::size_t partition_id,
+                       const KeyType &key, ValueType &value, uint64_t fields) {
+    search_for_read(table_id, partition_id, key, value);
+  }
+
+  // only Silo and SiloGC apply additions, see CommutativeUpdate
+  template <class KeyType, class T>
+  void add_to_field(std::size_t table_id, std::size_t partition_id,
+                    const KeyType &key, uint32_t field, T delta) {
+    CHECK(false) << "additions to fields are not supported.";
+  }
+
+  // only Silo repairs transactions, see Silo::repair
+  template <class KeyType>
+  void on_repair(const KeyType &key, std::function<void()> recompute) {}
+
   template <class KeyType, class ValueType>
   void search_for_update(std::size_t table_id, std::size_t partition_id,
                          const KeyType &key, ValueType &value) {
@@ -106,6 +133,13 @@ public:
     add_to_read_set(readKey);
   }
 
+  // scans need phantom protection, which is only implemented in Silo.
+  template <class KeyType, class ValueType, class Func>
+  void scan(std::size_t table_id, std::size_t partition_id,
+            const KeyType &start, const KeyType &end, Func func) {
+    CHECK(false) << "TwoPL does not support scans.";
+  }
+
   template <class KeyType, class ValueType>
   void update(std::size_t table_id, std::size_t partition_id,
               const KeyType &key, const ValueType &value) {
@@ -122,10 +156,89 @@ public:
     add_to_write_set(writeKey);
   }
 
+  // inserts value as the row of key of a local partition once the transaction
+  // commits, returns false if the key is present. The row is write locked
+  // right away as a tombstone, see Tombstone, and the transaction aborts if
+  // the lock is held by others.
+  template <class KeyType, class ValueType>
+  bool insert(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key, const ValueType &value) {
+    TwoPLRWKey readKey;
+
+    readKey.set_table_id(table_id);
+    readKey.set_partition_id(partition_id);
+
+    readKey.set_key(&key);
+    readKey.set_value(const_cast<ValueType *>(&value));
+
+    readKey.set_insert_bit();
+
+    ITable *table = localTableHandler(table_id, partition_id);
+    std::atomic<uint64_t> &tid = table->search_metadata(&key);
+    bool success;
+    uint64_t latest_tid = TwoPLHelper::write_lock(tid, success);
+    if (!success) {
+      abort_lock = true;
+      set_conflict(readKey);
+      return true;
+    }
+
+    if (!TwoPLHelper::is_absent(latest_tid)) {
+      TwoPLHelper::write_lock_release(tid);
+      return false;
+    }
+
+    readKey.set_tid(latest_tid);
+    readKey.set_write_lock_bit();
+    add_to_read_set(readKey);
+
+    TwoPLRWKey writeKey = readKey;
+    writeKey.clear_write_lock_bit();
+    writeKey.set_tid(0);
+    add_to_write_set(writeKey);
+    return true;
+  }
+
+  // deletes the row of key once the transaction commits, the row is read for
+  // update first. The row is left as a tombstone, see Tombstone.
+  template <class KeyType>
+  void remove(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key) {
+    auto readKey = get_read_key(&key);
+    CHECK(readKey != nullptr) << "a row is read before it is deleted.";
+
+    TwoPLRWKey writeKey;
+
+    writeKey.set_table_id(table_id);
+    writeKey.set_partition_id(partition_id);
+
+    writeKey.set_key(&key);
+    writeKey.set_value(readKey->get_value());
+
+    writeKey.set_delete_bit();
+
+    add_to_write_set(writeKey);
+  }
+
+  // the row of key read by the transaction is a tombstone, i.e., the key is
+  // not inserted or its row is deleted, once the locks are acquired
+  bool is_absent(const void *key) {
+    auto readKey = get_read_key(key);
+    return readKey != nullptr && TwoPLHelper::is_absent(readKey->get_tid());
+  }
+
+  // the reads queued since the last call are issued together, i.e., the
+  // requests to a node go out in one message and the transaction waits for
+  // all responses at once
   bool process_requests(std::size_t worker_id) {
 
     // cannot use unsigned type in reverse iteration
     for (int i = int(readSet.size()) - 1; i >= 0; i--) {
+      // inserts are locked right away
+      if (readSet[i].get_insert_bit()) {
+        continue;
+      }
+
       // early return
       if (!readSet[i].get_read_lock_request_bit() &&
           !readSet[i].get_write_lock_request_bit()) {
@@ -153,6 +266,7 @@ public:
           }
         } else {
           abort_lock = true;
+          set_conflict(readKey);
         }
       }
 
@@ -170,14 +284,13 @@ public:
   }
 
   TwoPLRWKey *get_read_key(const void *key) {
+    auto i = read_key_index.find(readSet, key);
+    return i < 0 ? nullptr : &readSet[i];
+  }
 
-    for (auto i = 0u; i < readSet.size(); i++) {
-      if (readSet[i].get_key() == key) {
-        return &readSet[i];
-      }
-    }
-
-    return nullptr;
+  TwoPLRWKey *get_write_key(const void *key) {
+    auto i = write_key_index.find(writeSet, key);
+    return i < 0 ? nullptr : &writeSet[i];
   }
 
   std::size_t add_to_read_set(const TwoPLRWKey &key) {
@@ -190,14 +303,32 @@ public:
     return writeSet.size() - 1;
   }
 
+  // keeps the first row that aborts the transaction, see ConflictProfile
+  void set_conflict(const TwoPLRWKey &key) {
+    if (conflict_key == nullptr) {
+      conflict_key = key.get_key();
+      conflict_table_id = key.get_table_id();
+      conflict_partition_id = key.get_partition_id();
+    }
+  }
+
 public:
   std::size_t coordinator_id, partition_id;
-  std::chrono::steady_clock::time_point startTime;
+  Clock::time_point startTime;
+  // the type of the transaction, see Statistics::procedures
+  uint32_t procedure_id = 0;
+  PhaseTimer phase_timer;
   std::size_t pendingResponses;
   std::size_t network_size;
   bool abort_lock, abort_read_validation, local_validated, si_in_serializable;
+  const void *conflict_key;
+  std::size_t conflict_table_id, conflict_partition_id;
   bool distributed_transaction;
   bool execution_phase;
+  // kept across retries, see TwoPLWait
+  uint64_t wait_ts = 0;
+  // releases read locks in the reader indicator of the worker
+  std::size_t worker_id = 0;
 
   // table id, partition id, key, value, local_index_read?, write_lock?,
   // success?, remote?
@@ -208,9 +339,13 @@ public:
   std::function<std::size_t(void)> remote_request_handler;
 
   std::function<void()> message_flusher;
+  // the table of a local partition, see insert
+  std::function<ITable *(std::size_t, std::size_t)> localTableHandler;
 
   Partitioner &partitioner;
   Operation operation;
-  std::vector<TwoPLRWKey> readSet, writeSet;
+  SmallVector<TwoPLRWKey, N_INLINE_READ_KEYS> readSet;
+  SmallVector<TwoPLRWKey, N_INLINE_WRITE_KEYS> writeSet;
+  KeyIndex read_key_index, write_key_index;
 };
 } // namespace coco
\ No newline at end of file
@@ -0,0 +1,170 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#pragma once
+
+#include "protocol/TwoPL/TwoPLHelper.h"
+
+#include <atomic>
+#include <cstdint>
+#include <glog/logging.h>
+#include <string>
+
+namespace coco {
+
+enum class TwoPLWaitPolicy { NO_WAIT, WAIT_DIE, WOUND_WAIT };
+
+/*
+ * TwoPLWait lets a transaction wait for a conflicting lock instead of aborting
+ * right away. Each transaction has a timestamp that is kept across retries, a
+ * smaller one is older.
+ *
+ * WAIT_DIE: an older transaction waits for a younger holder, a younger one
+ * aborts. WOUND_WAIT: an older transaction wounds a younger holder, which
+ * aborts the next time it requests a lock, and waits for it. A younger one
+ * waits for an older holder.
+ *
+ * The lock word of a row has no room for its holders, so the oldest holder is
+ * kept in a table of OWNER_SLOTS slots hashed by the address of the lock word.
+ * The first transaction that locks a free row sets the slot, later readers
+ * only lower it. Since rows may share a slot and a slot is not cleared on
+ * release, the recorded holder may be stale. Waiting is bounded by spins
+ * rounds, so that a wrong guess costs an abort rather than a deadlock.
+ *
+ * Wounds are kept in a table of the same kind by timestamp and only reach the
+ * transactions on the same node. Remote holders are waited for.
+ */
+
+class TwoPLWait {
+public:
+  static constexpr uint64_t NO_OWNER = UINT64_MAX;
+  static constexpr std::size_t OWNER_SLOTS = 1 << 20;
+  static constexpr std::size_t WOUND_SLOTS = 1 << 12;
+
+  static TwoPLWaitPolicy policy(const std::string &name) {
+    if (name == "no_wait") {
+      return TwoPLWaitPolicy::NO_WAIT;
+    } else if (name == "wait_die") {
+      return TwoPLWaitPolicy::WAIT_DIE;
+    } else if (name == "wound_wait") {
+      return TwoPLWaitPolicy::WOUND_WAIT;
+    } else {
+      CHECK(false) << "unknown wait policy: " << name;
+      return TwoPLWaitPolicy::NO_WAIT;
+    }
+  }
+
+  // whether a transaction with timestamp ts waits for a holder with owner_ts
+  static bool should_wait(TwoPLWaitPolicy policy, uint64_t ts,
+                          uint64_t owner_ts) {
+    switch (policy) {
+    case TwoPLWaitPolicy::WAIT_DIE:
+      return ts < owner_ts;
+    case TwoPLWaitPolicy::WOUND_WAIT:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  /*
+   * Acquires a read or a write lock on a row for a transaction with timestamp
+   * ts. On a conflict, the lock is retried for at most spins rounds as long as
+   * the policy allows, and work() runs between the rounds, e.g., to process
+   * the requests from other nodes.
+   */
+
+  template <class WorkFunc>
+  static uint64_t lock(std::atomic<uint64_t> &a, bool write_lock, uint64_t ts,
+                       TwoPLWaitPolicy policy, std::size_t spins,
+                       bool &success, WorkFunc &&work) {
+    std::atomic<uint64_t> &holder = owner(a);
+    for (std::size_t i = 0;; i++) {
+      uint64_t tid = write_lock ? TwoPLHelper::write_lock(a, success)
+                                : TwoPLHelper::read_lock(a, success);
+      if (success) {
+        if (policy != TwoPLWaitPolicy::NO_WAIT) {
+          acquired(a, holder, ts);
+        }
+        return tid;
+      }
+
+      uint64_t owner_ts = holder.load(std::memory_order_relaxed);
+      if (i >= spins || is_wounded(ts) || !should_wait(policy, ts, owner_ts)) {
+        return tid;
+      }
+      if (policy == TwoPLWaitPolicy::WOUND_WAIT && ts < owner_ts) {
+        wound(owner_ts);
+      }
+      work();
+    }
+  }
+
+  static uint64_t lock(std::atomic<uint64_t> &a, bool write_lock, uint64_t ts,
+                       TwoPLWaitPolicy policy, std::size_t spins,
+                       bool &success) {
+    return lock(a, write_lock, ts, policy, spins, success,
+                []() { __asm volatile("pause" : :); });
+  }
+
+  static std::atomic<uint64_t> &owner(const std::atomic<uint64_t> &a) {
+    return owners()[hash(reinterpret_cast<uintptr_t>(&a)) % OWNER_SLOTS];
+  }
+
+  static void wound(uint64_t ts) {
+    if (ts != NO_OWNER) {
+      wounds()[hash(ts) % WOUND_SLOTS].store(ts, std::memory_order_relaxed);
+    }
+  }
+
+  static bool is_wounded(uint64_t ts) {
+    return wounds()[hash(ts) % WOUND_SLOTS].load(std::memory_order_relaxed) ==
+           ts;
+  }
+
+  // called once an aborted transaction has released its locks
+  static void heal(uint64_t ts) {
+    uint64_t expected = ts;
+    wounds()[hash(ts) % WOUND_SLOTS].compare_exchange_strong(expected,
+                                                             NO_OWNER);
+  }
+
+private:
+  static void acquired(const std::atomic<uint64_t> &a,
+                       std::atomic<uint64_t> &holder, uint64_t ts) {
+    uint64_t value = a.load(std::memory_order_relaxed);
+    if (TwoPLHelper::is_write_locked(value) ||
+        TwoPLHelper::read_lock_num(value) == 1) {
+      holder.store(ts, std::memory_order_relaxed);
+      return;
+    }
+    uint64_t owner_ts = holder.load(std::memory_order_relaxed);
+    while (ts < owner_ts && !holder.compare_exchange_weak(owner_ts, ts)) {
+    }
+  }
+
+  static uint64_t hash(uint64_t x) {
+    x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdull;
+    return x ^ (x >> 33);
+  }
+
+  static std::atomic<uint64_t> *owners() {
+    static std::atomic<uint64_t> *slots = new_slots(OWNER_SLOTS);
+    return slots;
+  }
+
+  static std::atomic<uint64_t> *wounds() {
+    static std::atomic<uint64_t> *slots = new_slots(WOUND_SLOTS);
+    return slots;
+  }
+
+  static std::atomic<uint64_t> *new_slots(std::size_t n) {
+    auto slots = new std::atomic<uint64_t>[n];
+    for (auto i = 0u; i < n; i++) {
+      slots[i].store(NO_OWNER);
+    }
+    return slots;
+  }
+};
+} // namespace coco
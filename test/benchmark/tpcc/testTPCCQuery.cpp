@@ -39,4 +39,90 @@ TEST(TestTPCCQuery, TestPayment) {
       coco::tpcc::makePaymentQuery()(context, 1, random);
 
   EXPECT_EQ(query.W_ID, 1);
-}
\ No newline at end of file
+}
+TEST(TestTPCCQuery, TestReadOnlyAndDelivery) {
+
+  coco::tpcc::Context context;
+
+  context.partition_num = 10;
+  context.worker_num = 10;
+
+  coco::tpcc::Random random(reinterpret_cast<uint64_t>(&context));
+
+  coco::tpcc::DeliveryQuery delivery =
+      coco::tpcc::makeDeliveryQuery()(context, 1, random);
+  EXPECT_EQ(delivery.W_ID, 1);
+  EXPECT_GE(delivery.O_CARRIER_ID, 1);
+  EXPECT_LE(delivery.O_CARRIER_ID, 10);
+
+  coco::tpcc::OrderStatusQuery order_status =
+      coco::tpcc::makeOrderStatusQuery()(context, 1, random);
+  EXPECT_EQ(order_status.W_ID, 1);
+  EXPECT_LE(order_status.D_ID, context.n_district);
+
+  coco::tpcc::StockLevelQuery stock_level =
+      coco::tpcc::makeStockLevelQuery()(context, 1, random);
+  EXPECT_EQ(stock_level.W_ID, 1);
+  EXPECT_GE(stock_level.THRESHOLD, 10);
+  EXPECT_LE(stock_level.THRESHOLD, 20);
+}
+
+TEST(TestTPCCQuery, TestDecodeNewOrder) {
+
+  coco::tpcc::Context context;
+  context.partition_num = 2;
+
+  auto args = [](int32_t W_ID, std::vector<int32_t> items,
+                 int32_t OL_SUPPLY_W_ID) {
+    std::string bytes;
+    coco::Encoder enc(bytes);
+    enc << W_ID << int32_t(3) << int32_t(42)
+        << static_cast<int8_t>(items.size());
+    for (auto OL_I_ID : items) {
+      enc << OL_I_ID << OL_SUPPLY_W_ID << int8_t(5);
+    }
+    return bytes;
+  };
+
+  coco::tpcc::NewOrderQuery query;
+  coco::tpcc::decodeNewOrderQuery decode;
+  EXPECT_TRUE(decode(context, args(2, {7, 100000, 0}, 1), query));
+  EXPECT_EQ(query.W_ID, 2);
+  EXPECT_EQ(query.D_ID, 3);
+  EXPECT_EQ(query.C_ID, 42);
+  EXPECT_EQ(query.O_OL_CNT, 3);
+  EXPECT_EQ(query.INFO[1].OL_I_ID, 100000);
+  EXPECT_TRUE(query.isRemote());
+
+  EXPECT_FALSE(decode(context, args(3, {7}, 1), query));
+  EXPECT_FALSE(decode(context, args(1, {7}, 3), query));
+  EXPECT_FALSE(decode(context, args(1, {7, 7}, 1), query));
+  EXPECT_FALSE(decode(context, args(1, {100001}, 1), query));
+  EXPECT_FALSE(decode(context, args(1, {}, 1), query));
+  EXPECT_FALSE(decode(context, args(1, {7}, 1) + "x", query));
+}
+
+TEST(TestTPCCQuery, TestDecodePayment) {
+
+  coco::tpcc::Context context;
+  context.partition_num = 2;
+
+  auto args = [](int32_t C_ID, float H_AMOUNT) {
+    std::string bytes;
+    coco::Encoder enc(bytes);
+    enc << int32_t(1) << int32_t(2) << C_ID << int32_t(4) << int32_t(2)
+        << H_AMOUNT;
+    return bytes;
+  };
+
+  coco::tpcc::PaymentQuery query;
+  coco::tpcc::decodePaymentQuery decode;
+  EXPECT_TRUE(decode(context, args(3000, 10), query));
+  EXPECT_EQ(query.C_D_ID, 4);
+  EXPECT_EQ(query.C_W_ID, 2);
+  EXPECT_EQ(query.H_AMOUNT, 10);
+
+  // no look up by last name
+  EXPECT_FALSE(decode(context, args(0, 10), query));
+  EXPECT_FALSE(decode(context, args(1, 5001), query));
+}
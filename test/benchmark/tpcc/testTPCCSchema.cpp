@@ -117,4 +117,22 @@ TEST(TestTPCCSchema, TestStock) {
   EXPECT_EQ(value.S_YTD, value1.S_YTD);
   EXPECT_EQ(value.S_ORDER_CNT, value1.S_ORDER_CNT);
   EXPECT_EQ(value.S_REMOTE_CNT, value1.S_REMOTE_CNT);
-}
\ No newline at end of file
+}
+TEST(TestTPCCSchema, TestDictionary) {
+
+  using namespace coco::tpcc;
+
+  // the code of a last name is its number
+  Random random;
+  EXPECT_EQ(LastNames::get().size(), 1000u);
+  EXPECT_EQ(LastNames::get().encode(random.rand_last_name(123)), 123u);
+
+  EXPECT_EQ(DistInfos::get().size(), std::size_t(DistInfos::DIST_INFO_NUM));
+  coco::DictString<24, DistInfos> info;
+  info.assign(DistInfos::get().decode(7));
+  EXPECT_EQ(info.code(), 7u);
+
+  // any draw of S_DIST_xx can be stored
+  DistInfoString s;
+  s = coco::FixedString<24>(rand_dist_info(random));
+}
@@ -4,8 +4,10 @@
 
 #include "benchmark/tpcc/Database.h"
 #include "benchmark/tpcc/Transaction.h"
+#include "benchmark/tpcc/Workload.h"
 #include "protocol/Silo/Silo.h"
 #include <gtest/gtest.h>
+#include <set>
 
 TEST(TestTPCCTransaction, TestBasic) {
 
@@ -26,3 +28,213 @@ TEST(TestTPCCTransaction, TestBasic) {
                                                 partitioner, storage);
   EXPECT_EQ(true, true);
 }
+
+TEST(TestTPCCTransaction, TestScans) {
+
+  using DatabaseType = coco::tpcc::Database;
+
+  DatabaseType db;
+  coco::tpcc::Context context;
+  context.partition_num = 1;
+  context.worker_num = 1;
+  context.coordinator_num = 1;
+  context.partitioner = "hash";
+  db.initialize(context);
+
+  coco::tpcc::Random random;
+  coco::HashPartitioner partitioner(0, 1);
+  coco::tpcc::Storage storage;
+  coco::Silo<decltype(db)> silo(db, context, partitioner);
+
+  std::vector<std::unique_ptr<coco::Message>> messages;
+  messages.push_back(std::make_unique<coco::Message>());
+
+  auto run = [&](coco::SiloTransaction &txn) {
+    txn.readRequestHandler = [&silo](std::size_t table_id,
+                                     std::size_t partition_id, uint32_t,
+                                     const void *key, void *value, bool) {
+      return silo.search(table_id, partition_id, key, value);
+    };
+    txn.localTableHandler = [&db](std::size_t table_id,
+                                  std::size_t partition_id) {
+      return db.find_table(table_id, partition_id);
+    };
+    txn.remote_request_handler = []() { return std::size_t(0); };
+    txn.message_flusher = []() {};
+    EXPECT_EQ(txn.execute(0), coco::TransactionResult::READY_TO_COMMIT);
+    EXPECT_FALSE(txn.nodeSet.empty());
+    return silo.commit(txn, messages);
+  };
+
+  coco::tpcc::OrderStatus<coco::SiloTransaction> t1(0, 0, db, context, random,
+                                                    partitioner, storage);
+  EXPECT_TRUE(run(t1));
+  EXPECT_GE(t1.scanSet.size(), 3000u);
+
+  coco::tpcc::StockLevel<coco::SiloTransaction> t2(0, 0, db, context, random,
+                                                   partitioner, storage);
+  EXPECT_TRUE(run(t2));
+  EXPECT_GE(t2.readSet.size(), 2u);
+
+  coco::tpcc::Delivery<coco::SiloTransaction> t3(0, 0, db, context, random,
+                                                 partitioner, storage);
+  EXPECT_TRUE(run(t3));
+  EXPECT_EQ(storage.delivery_order_keys[0].O_ID, 2101);
+
+  // the oldest new order of district 1 is delivered
+  coco::tpcc::order::key order_key(1, 1, 2101);
+  auto &order_value = *static_cast<coco::tpcc::order::value *>(
+      db.find_table(coco::tpcc::order::tableID, 0)->search_value(&order_key));
+  EXPECT_NE(order_value.O_CARRIER_ID, 0);
+}
+
+TEST(TestTPCCTransaction, TestInsertsAndDeletes) {
+
+  using DatabaseType = coco::tpcc::Database;
+  using namespace coco::tpcc;
+
+  DatabaseType db;
+  coco::tpcc::Context context;
+  context.partition_num = 1;
+  context.worker_num = 1;
+  context.coordinator_num = 1;
+  context.partitioner = "hash";
+  db.initialize(context);
+  coco::Tombstone::set(db, 1, coco::SiloHelper::tombstone());
+
+  coco::tpcc::Random random;
+  coco::HashPartitioner partitioner(0, 1);
+  coco::tpcc::Storage storage;
+  coco::Silo<decltype(db)> silo(db, context, partitioner);
+
+  std::vector<std::unique_ptr<coco::Message>> messages;
+  messages.push_back(std::make_unique<coco::Message>());
+
+  auto run = [&](coco::SiloTransaction &txn) {
+    txn.readRequestHandler = [&silo](std::size_t table_id,
+                                     std::size_t partition_id, uint32_t,
+                                     const void *key, void *value, bool) {
+      return silo.search(table_id, partition_id, key, value);
+    };
+    txn.localTableHandler = [&db](std::size_t table_id,
+                                  std::size_t partition_id) {
+      return db.find_table(table_id, partition_id);
+    };
+    txn.remote_request_handler = []() { return std::size_t(0); };
+    txn.message_flusher = []() {};
+    EXPECT_EQ(txn.execute(0), coco::TransactionResult::READY_TO_COMMIT);
+    return silo.commit(txn, messages);
+  };
+
+  auto absent = [&db](std::size_t table_id, const void *key) {
+    auto table = db.find_table(table_id, 0);
+    return table->get_tombstone().is_absent(table->search_metadata(key));
+  };
+
+  // the order, the new order and the order lines are inserted
+  NewOrder<coco::SiloTransaction> t1(0, 0, db, context, random, partitioner,
+                                     storage);
+  EXPECT_TRUE(run(t1));
+  auto order_key = storage.order_key;
+  EXPECT_EQ(order_key.O_ID, 3001);
+  EXPECT_FALSE(absent(order::tableID, &order_key));
+  EXPECT_FALSE(absent(new_order::tableID, &storage.new_order_key));
+  auto order_value = *static_cast<order::value *>(
+      db.find_table(order::tableID, 0)->search_value(&order_key));
+  EXPECT_EQ(order_value.O_OL_CNT, storage.order_value.O_OL_CNT);
+  for (auto i = 0; i < order_value.O_OL_CNT; i++) {
+    EXPECT_FALSE(absent(order_line::tableID, &storage.order_line_keys[i]));
+  }
+
+  // the delivered new order is deleted, the next delivery takes the next one
+  Delivery<coco::SiloTransaction> t2(0, 0, db, context, random, partitioner,
+                                     storage);
+  EXPECT_TRUE(run(t2));
+  auto new_order_key = storage.delivery_new_order_keys[0];
+  EXPECT_EQ(new_order_key.NO_O_ID, 2101);
+  EXPECT_TRUE(absent(new_order::tableID, &new_order_key));
+
+  Delivery<coco::SiloTransaction> t3(0, 0, db, context, random, partitioner,
+                                     storage);
+  EXPECT_TRUE(run(t3));
+  EXPECT_EQ(storage.delivery_new_order_keys[0].NO_O_ID, 2102);
+}
+
+TEST(TestTPCCTransaction, TestPool) {
+
+  using DatabaseType = coco::tpcc::Database;
+  using WorkloadType = coco::tpcc::Workload<coco::SiloTransaction>;
+
+  DatabaseType db;
+  coco::tpcc::Context context;
+  context.partition_num = 4;
+  context.workloadType = coco::tpcc::TPCCWorkloadType::MIXED;
+  coco::tpcc::Random random;
+  coco::HashPartitioner partitioner(0, 1);
+  coco::tpcc::Storage storage;
+
+  WorkloadType workload(0, db, random, partitioner);
+  coco::TransactionPool<coco::SiloTransaction> pool;
+
+  std::unique_ptr<coco::SiloTransaction> txn;
+  std::set<coco::SiloTransaction *> made;
+  for (auto i = 0u; i < 100; i++) {
+    pool.put(std::move(txn));
+    txn = workload.next_transaction(context, i % 4, storage, &pool);
+    EXPECT_EQ(txn->partition_id, i % 4);
+    EXPECT_TRUE(txn->readSet.empty());
+    made.insert(txn.get());
+  }
+
+  // a NewOrder and a Payment at most, every other transaction is reused
+  EXPECT_LE(made.size(), 2u);
+  EXPECT_EQ(pool.reuses(), 100 - made.size());
+}
+
+TEST(TestTPCCTransaction, TestRepair) {
+
+  using DatabaseType = coco::tpcc::Database;
+
+  DatabaseType db;
+  coco::tpcc::Context context;
+  context.partition_num = 1;
+  context.worker_num = 1;
+  context.coordinator_num = 1;
+  context.partitioner = "hash";
+  context.repair = true;
+  db.initialize(context);
+
+  coco::tpcc::Random random;
+  coco::HashPartitioner partitioner(0, 1);
+  coco::tpcc::Storage storage;
+  coco::Silo<decltype(db)> silo(db, context, partitioner);
+
+  std::vector<std::unique_ptr<coco::Message>> messages;
+  messages.push_back(std::make_unique<coco::Message>());
+
+  coco::tpcc::Payment<coco::SiloTransaction> txn(0, 0, db, context, random,
+                                                 partitioner, storage);
+  txn.readRequestHandler = [&silo](std::size_t table_id,
+                                   std::size_t partition_id, uint32_t,
+                                   const void *key, void *value, bool) {
+    return silo.search(table_id, partition_id, key, value);
+  };
+  txn.remote_request_handler = []() { return std::size_t(0); };
+  txn.message_flusher = []() {};
+  EXPECT_EQ(txn.execute(0), coco::TransactionResult::READY_TO_COMMIT);
+
+  // another payment to the district commits in the meantime
+  auto district_key = storage.district_key;
+  auto district_table = db.find_table(coco::tpcc::district::tableID, 0);
+  auto &district_value = *static_cast<coco::tpcc::district::value *>(
+      district_table->search_value(&district_key));
+  float D_YTD = district_value.D_YTD;
+  district_value.D_YTD += 100;
+  district_table->search_metadata(&district_key).fetch_add(1);
+
+  // the district is read again and the payment added to it
+  EXPECT_TRUE(silo.commit(txn, messages));
+  EXPECT_EQ(district_value.D_YTD, storage.district_value.D_YTD);
+  EXPECT_GE(district_value.D_YTD, D_YTD + 100 + 1);
+  EXPECT_LE(district_value.D_YTD, D_YTD + 100 + 5000);
+}
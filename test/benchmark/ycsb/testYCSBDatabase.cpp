@@ -25,3 +25,131 @@ TEST(TestYCSBDatabase, TestBasic) {
 
   EXPECT_EQ(true, true);
 }
+
+TEST(TestYCSBDatabase, TestVisitTable) {
+
+  coco::ycsb::Context context;
+  context.strategy = coco::ycsb::PartitionStrategy::ROUND_ROBIN;
+  context.keysPerPartition = 20;
+  context.keysPerTransaction = 10;
+  context.partition_num = 4;
+  context.worker_num = 4;
+  context.coordinator_num = 1;
+  context.partitioner = "hash";
+  coco::ycsb::Database db;
+  db.initialize(context);
+
+  auto tableID = coco::ycsb::ycsb::tableID;
+  coco::ycsb::ycsb::key key(5);
+  void *value = db.visit_table(
+      tableID, 1, [&key](auto &table) { return table.search_value(&key); });
+
+  EXPECT_EQ(value, db.find_table(tableID, 1)->search_value(&key));
+}
+
+TEST(TestYCSBDatabase, TestKeySpace) {
+
+  coco::ycsb::KeySpace keys;
+  keys.init(2, 10, 3);
+
+  // before any insert, the latest keys are the loaded ones from the last
+  EXPECT_EQ(keys.latest(0, 0), 9u);
+  EXPECT_EQ(keys.latest(0, 9), 0u);
+
+  EXPECT_EQ(keys.insert(0), 10u);
+  EXPECT_EQ(keys.insert(0), 11u);
+  EXPECT_EQ(keys.latest(0, 0), 11u);
+  EXPECT_EQ(keys.latest(0, 1), 10u);
+  EXPECT_EQ(keys.latest(0, 2), 9u);
+  EXPECT_EQ(keys.latest(1, 0), 9u);
+
+  // the reserved rows are taken again once all of them are
+  EXPECT_EQ(keys.insert(0), 12u);
+  EXPECT_EQ(keys.insert(0), 10u);
+  EXPECT_EQ(keys.latest(0, 0), 10u);
+  EXPECT_EQ(keys.latest(0, 2), 11u);
+  EXPECT_EQ(keys.latest(0, 3), 9u);
+}
+
+TEST(TestYCSBDatabase, TestReservedRows) {
+
+  coco::ycsb::Context context;
+  context.strategy = coco::ycsb::PartitionStrategy::RANGE;
+  context.keysPerPartition = 20;
+  context.insertsPerPartition = 5;
+  context.partition_num = 2;
+  context.worker_num = 2;
+  context.coordinator_num = 1;
+  context.partitioner = "hash";
+  context.workload = coco::ycsb::YCSBWorkload::E;
+  coco::ycsb::Database db;
+  db.initialize(context);
+
+  // with range partitioning, partition 1 has keys in [25, 50), and an
+  // ordered table scans them in order
+  auto tableID = coco::ycsb::ycsb::tableID;
+  coco::ycsb::ycsb::key start(45), end(60);
+  std::vector<int64_t> keys;
+  db.find_table(tableID, 1)->scan(
+      &start, &end,
+      [&keys](const void *key, std::atomic<uint64_t> &, void *) {
+        keys.push_back(static_cast<const coco::ycsb::ycsb::key *>(key)->Y_KEY);
+        return true;
+      });
+  EXPECT_EQ(keys, std::vector<int64_t>({45, 46, 47, 48, 49}));
+  EXPECT_EQ(coco::ycsb::KeySpace::global().insert(1), 20u);
+}
+
+TEST(TestYCSBDatabase, TestRecordRows) {
+
+  coco::ycsb::Context context;
+  context.keysPerPartition = 20;
+  context.partition_num = 2;
+  context.worker_num = 2;
+  context.coordinator_num = 1;
+  context.partitioner = "hash";
+  coco::ycsb::BasicDatabase<coco::ycsb::value_4k> db;
+  db.initialize(context);
+
+  auto tableID = coco::ycsb::ycsb::tableID;
+  coco::ycsb::ycsb::key key(5);
+  auto &value = *static_cast<coco::ycsb::value_4k *>(
+      db.find_table(tableID, 1)->search_value(&key));
+  EXPECT_EQ(db.find_table(tableID, 1)->value_size(), 4000u);
+
+  // a read-modify-write shifts each field to the previous one
+  auto old = value;
+  decltype(db)::shift_fields(value);
+  EXPECT_EQ(std::string(value.field(0), 400), std::string(old.field(1), 400));
+  EXPECT_EQ(std::string(value.field(9), 400), std::string(old.field(0), 400));
+}
+
+TEST(TestYCSBDatabase, TestLoadThreads) {
+
+  // a partition of two chunks, the rows do not depend on the threads that
+  // load them
+  coco::ycsb::Context context;
+  context.keysPerPartition = coco::ycsb::Database::LOAD_CHUNK_KEYS + 10;
+  context.partition_num = 1;
+  context.worker_num = 1;
+  context.coordinator_num = 1;
+  context.partitioner = "hash";
+
+  coco::ycsb::Database one, four;
+  one.initialize(context);
+  context.loadThreads = 4;
+  four.initialize(context);
+
+  auto tableID = coco::ycsb::ycsb::tableID;
+  std::size_t rows = 0;
+  four.find_table(tableID, 0)->for_each_row(
+      [&rows](const void *, std::atomic<uint64_t> &, void *) { rows++; });
+  EXPECT_EQ(rows, context.keysPerPartition);
+  for (int64_t k : {0, 1, 65536, 65545}) {
+    coco::ycsb::ycsb::key key(k);
+    EXPECT_EQ(*static_cast<coco::ycsb::ycsb::value *>(
+                  one.find_table(tableID, 0)->search_value(&key)),
+              *static_cast<coco::ycsb::ycsb::value *>(
+                  four.find_table(tableID, 0)->search_value(&key)));
+  }
+}
@@ -50,4 +50,118 @@ TEST(TestYCSBQuery, TestBasic) {
   }
   EXPECT_GE(1.0 * readOnly / N, 0.8);
   EXPECT_LE(1.0 * reads / (reads + writes), 0.8);
-}
\ No newline at end of file
+}
+TEST(TestYCSBQuery, TestDecode) {
+
+  coco::ycsb::Context context;
+  context.keysPerPartition = 20;
+  context.partition_num = 2;
+
+  constexpr int M = 3;
+  auto args = [](std::vector<int64_t> keys) {
+    std::string bytes;
+    coco::Encoder enc(bytes);
+    for (auto i = 0u; i < keys.size(); i++) {
+      enc << keys[i] << static_cast<uint8_t>(i % 2);
+    }
+    return bytes;
+  };
+
+  coco::ycsb::YCSBQuery<M> q;
+  coco::ycsb::decodeYCSBQuery<M> decode;
+  EXPECT_TRUE(decode(context, args({3, 39, 0}), q));
+  EXPECT_EQ(q.Y_KEY[1], 39);
+  EXPECT_FALSE(q.UPDATE[0]);
+  EXPECT_TRUE(q.UPDATE[1]);
+
+  // the keys are distinct, in the database, and there are M of them
+  EXPECT_FALSE(decode(context, args({3, 39, 3}), q));
+  EXPECT_FALSE(decode(context, args({3, 40, 0}), q));
+  EXPECT_FALSE(decode(context, args({3, -1, 0}), q));
+  EXPECT_FALSE(decode(context, args({3, 39}), q));
+}
+
+TEST(TestYCSBQuery, TestCoreQuery) {
+
+  using namespace coco::ycsb;
+
+  Context context;
+  context.strategy = PartitionStrategy::ROUND_ROBIN;
+  context.keysPerPartition = 200;
+  context.insertsPerPartition = 20;
+  context.crossPartitionProbability = 0;
+  context.maxScanLength = 10;
+  context.partition_num = 4;
+  context.workload = YCSBWorkload::E;
+  KeySpace::global().init(4, 200, 20);
+
+  Random random(42);
+
+  constexpr int N = 1000, M = 10;
+  constexpr int partitionID = 1;
+
+  int scans = 0, inserts = 0;
+  for (auto i = 0; i < N; i++) {
+    auto q = makeYCSBCoreQuery<M>()(context, partitionID, random);
+    for (int k = 0; k < M; k++) {
+      EXPECT_EQ(context.getPartitionID(q.Y_KEY[k]), partitionID);
+      auto local = q.Y_KEY[k] / context.partition_num;
+      if (q.OP[k] == YCSBOperation::SCAN) {
+        scans++;
+        EXPECT_GE(q.SCAN_LENGTH[k], 1);
+        EXPECT_LE(q.SCAN_LENGTH[k], 10);
+        EXPECT_LE(local + q.SCAN_LENGTH[k], 220);
+      } else {
+        EXPECT_EQ(q.OP[k], YCSBOperation::INSERT);
+        inserts++;
+        EXPECT_GE(local, 200);
+        EXPECT_LT(local, 220);
+      }
+    }
+  }
+  EXPECT_EQ(scans + inserts, N * M);
+  EXPECT_NEAR(1.0 * inserts / (N * M), 0.05, 0.01);
+
+  // the proportions of the other workloads
+  EXPECT_EQ(makeYCSBCoreQuery<M>::operation(YCSBWorkload::A, 50),
+            YCSBOperation::READ);
+  EXPECT_EQ(makeYCSBCoreQuery<M>::operation(YCSBWorkload::A, 51),
+            YCSBOperation::UPDATE);
+  EXPECT_EQ(makeYCSBCoreQuery<M>::operation(YCSBWorkload::B, 96),
+            YCSBOperation::UPDATE);
+  EXPECT_EQ(makeYCSBCoreQuery<M>::operation(YCSBWorkload::C, 100),
+            YCSBOperation::READ);
+  EXPECT_EQ(makeYCSBCoreQuery<M>::operation(YCSBWorkload::D, 96),
+            YCSBOperation::INSERT);
+  EXPECT_EQ(makeYCSBCoreQuery<M>::operation(YCSBWorkload::F, 51),
+            YCSBOperation::READ_MODIFY_WRITE);
+}
+
+TEST(TestYCSBQuery, TestLargeKeySpace) {
+
+  using namespace coco::ycsb;
+
+  Context context;
+  context.keysPerPartition = 3000000000ull;
+  context.partition_num = 4;
+  context.isUniform = true;
+
+  for (auto strategy :
+       {PartitionStrategy::RANGE, PartitionStrategy::ROUND_ROBIN}) {
+    context.strategy = strategy;
+    auto key = context.getGlobalKeyID(2999999999ull, 3);
+    EXPECT_GT(key, 1ull << 32);
+    EXPECT_EQ(context.getPartitionID(key), 3u);
+  }
+
+  Random random(7);
+  int64_t max = 0;
+  for (auto i = 0; i < 100; i++) {
+    auto q = makeYCSBQuery<10>()(context, 3, random);
+    for (auto k = 0; k < 10; k++) {
+      EXPECT_EQ(context.getPartitionID(q.Y_KEY[k]), 3u);
+      max = std::max(max, q.Y_KEY[k]);
+    }
+  }
+  EXPECT_GT(max, 1ll << 32);
+}
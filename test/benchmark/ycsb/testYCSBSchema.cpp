@@ -3,6 +3,7 @@
 //
 
 #include "benchmark/ycsb/Schema.h"
+#include "core/FieldLayout.h"
 #include <gtest/gtest.h>
 
 TEST(TestYCSBSchema, TestYCSB) {
@@ -14,3 +15,30 @@ TEST(TestYCSBSchema, TestYCSB) {
   coco::ycsb::ycsb::key key_ = coco::ycsb::ycsb::key(1);
   EXPECT_EQ(key, key_);
 }
+
+TEST(TestYCSBSchema, TestRecord) {
+
+  using namespace coco;
+  using value_type = ycsb::value_1k;
+
+  EXPECT_EQ(sizeof(value_type), 1000u);
+  EXPECT_EQ(ClassOf<value_type>::size(), 1000u);
+  EXPECT_EQ(FieldLayout<value_type>::size(), 10u);
+  EXPECT_EQ(FieldLayout<value_type>::offset(3), 300u);
+  EXPECT_EQ(FieldLayout<value_type>::length(3), 100u);
+
+  value_type value;
+  for (auto i = 0u; i < sizeof(value.data); i++) {
+    value.data[i] = 'a' + i % 26;
+  }
+  std::string bytes;
+  Serializer<value_type>()(value, bytes);
+  EXPECT_EQ(bytes.size(), 1000u);
+
+  value_type copy;
+  EXPECT_EQ(Deserializer<value_type>()(StringPiece(bytes), copy), 1000u);
+  EXPECT_EQ(copy, value);
+  copy.field(9)[99] = '!';
+  EXPECT_NE(copy, value);
+  EXPECT_EQ(FieldDelta<value_type>::changed_fields(value, copy), 1u << 9);
+}
@@ -0,0 +1,68 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Arena.h"
+#include "common/OpenHashMap.h"
+#include <cstring>
+#include <gtest/gtest.h>
+
+TEST(TestArena, TestAllocate) {
+
+  using namespace coco;
+
+  Arena arena;
+  std::size_t region_size = Arena::MIN_REGION_SIZE;
+  EXPECT_EQ(arena.mapped(), 0u);
+
+  auto a = static_cast<char *>(arena.allocate(3, 1));
+  auto b = static_cast<char *>(arena.allocate(8, 8));
+  auto c = static_cast<char *>(arena.allocate(64, 64));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 8, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(c) % 64, 0u);
+  EXPECT_GE(b, a + 3);
+  EXPECT_GE(c, b + 8);
+  std::memset(a, 1, 3);
+  std::memset(b, 2, 8);
+  std::memset(c, 3, 64);
+  EXPECT_EQ(a[2], 1);
+  EXPECT_EQ(b[7], 2);
+
+  EXPECT_EQ(arena.allocated(), 75u);
+  EXPECT_EQ(arena.mapped(), region_size);
+
+  // the next region is twice as large
+  arena.allocate(region_size, 8);
+  EXPECT_EQ(arena.mapped(), 3 * region_size);
+
+  arena.clear();
+  EXPECT_EQ(arena.allocated(), 0u);
+  EXPECT_EQ(arena.mapped(), 0u);
+}
+
+TEST(TestArena, TestLargeAllocate) {
+
+  using namespace coco;
+
+  Arena arena;
+  std::size_t huge_page_size = Arena::HUGE_PAGE_SIZE;
+  std::size_t size = huge_page_size + 1;
+  auto p = static_cast<char *>(arena.allocate(size, 8));
+  std::memset(p, 7, size);
+  EXPECT_EQ(p[size - 1], 7);
+  EXPECT_EQ(arena.mapped(), 2 * huge_page_size);
+  EXPECT_LE(arena.huge_pages(), arena.mapped());
+}
+
+TEST(TestArena, TestHashMapMemory) {
+
+  using namespace coco;
+
+  OpenHashMap<16, int, int> map;
+  EXPECT_EQ(map.memory_size(), 0u);
+  for (auto i = 0; i < 10000; i++) {
+    map[i] = i;
+  }
+  EXPECT_GE(map.memory_size(), 10000 * sizeof(std::pair<int, int>));
+  EXPECT_EQ(map[42], 42);
+}
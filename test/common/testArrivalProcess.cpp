@@ -0,0 +1,38 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/ArrivalProcess.h"
+#include <gtest/gtest.h>
+
+TEST(TestArrivalProcess, TestClosedLoop) {
+
+  coco::ArrivalProcess arrivals(0, 1);
+  EXPECT_TRUE(arrivals.closed_loop());
+  EXPECT_TRUE(arrivals.arrived());
+  auto before = coco::Clock::now();
+  EXPECT_GE(arrivals.pop(), before);
+  EXPECT_TRUE(arrivals.arrived());
+}
+
+TEST(TestArrivalProcess, TestOpenLoop) {
+
+  double rate = 1000;
+  coco::ArrivalProcess arrivals(rate, 1);
+  EXPECT_FALSE(arrivals.closed_loop());
+  EXPECT_TRUE(arrivals.arrived());
+
+  // the gaps are exponential with a mean of 1 / rate
+  int n = 100000;
+  auto first = arrivals.pop(), last = first;
+  for (auto i = 1; i < n; i++) {
+    auto next = arrivals.pop();
+    EXPECT_GE(next, last);
+    last = next;
+  }
+  double mean = std::chrono::duration<double>(last - first).count() / (n - 1);
+  EXPECT_NEAR(mean, 1 / rate, 0.05 / rate);
+
+  // the next arrival is about 100 seconds away
+  EXPECT_FALSE(arrivals.arrived());
+}
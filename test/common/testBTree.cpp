@@ -0,0 +1,131 @@
+//
+// Created by Yi Lu on 3/24/19.
+//
+
+#include "common/BTree.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestBTree, TestConcurrent) {
+
+  constexpr int nThreads = 10, keys = 10000, totalKeys = nThreads * keys;
+
+  coco::BTree<int, int> tree;
+  std::vector<std::thread> v;
+
+  for (int i = 0; i < nThreads; i++) {
+    v.emplace_back(std::thread([i, &tree]() {
+      for (int j = i; j < totalKeys; j += nThreads) {
+        tree[j] = j;
+      }
+    }));
+  }
+  for (auto &t : v) {
+    t.join();
+  }
+
+  EXPECT_EQ(tree.size(), totalKeys);
+  int next = 0;
+  tree.for_each([&next](int key, int value) {
+    EXPECT_EQ(key, next++);
+    EXPECT_EQ(value, key);
+  });
+  EXPECT_EQ(next, totalKeys);
+}
+
+TEST(TestBTree, TestSerialized) {
+  coco::BTree<int, int> tree;
+  EXPECT_EQ(tree.size(), 0u);
+  EXPECT_EQ(tree.find(0), nullptr);
+  EXPECT_TRUE(tree.insert(0, 1));
+  EXPECT_FALSE(tree.insert(0, 2));
+  EXPECT_EQ(*tree.find(0), 1);
+  auto &v = tree[0];
+  v = 3;
+  EXPECT_EQ(tree[0], 3);
+  EXPECT_TRUE(tree.remove(0));
+  EXPECT_FALSE(tree.remove(0));
+  EXPECT_EQ(tree.size(), 0u);
+  // a removed row is kept alive
+  EXPECT_EQ(v, 3);
+}
+
+TEST(TestBTree, TestScan) {
+  coco::BTree<int, int> tree;
+  for (int i = 999; i >= 0; i--) {
+    tree[2 * i] = i;
+  }
+
+  int start = 101, end = 1001;
+  std::vector<int> keys;
+  std::size_t n_leaves = 0;
+  tree.scan(
+      &start, &end,
+      [&keys](int key, int value) {
+        EXPECT_EQ(value, key / 2);
+        keys.push_back(key);
+        return true;
+      },
+      [&n_leaves](const std::atomic<uint64_t> &, uint64_t) { n_leaves++; });
+  EXPECT_EQ(keys.size(), 450u);
+  EXPECT_EQ(keys.front(), 102);
+  EXPECT_EQ(keys.back(), 1000);
+  EXPECT_GT(n_leaves, 1u);
+
+  // stop early
+  keys.clear();
+  tree.scan(&start, nullptr, [&keys](int key, int value) {
+    keys.push_back(key);
+    return keys.size() < 10;
+  });
+  EXPECT_EQ(keys.size(), 10u);
+
+  // the versions of the leaves visited detect an insert into the range
+  std::vector<std::tuple<const std::atomic<uint64_t> *, uint64_t>> node_set;
+  int empty_start = 501, empty_end = 502;
+  tree.scan(
+      &empty_start, &empty_end, [](int, int) { return true; },
+      [&node_set](const std::atomic<uint64_t> &version, uint64_t value) {
+        node_set.emplace_back(&version, value);
+      });
+  EXPECT_FALSE(node_set.empty());
+  tree[empty_start] = 0;
+  bool changed = false;
+  for (auto &node : node_set) {
+    changed = changed || std::get<0>(node)->load() != std::get<1>(node);
+  }
+  EXPECT_TRUE(changed);
+}
+
+TEST(TestBTree, TestConcurrentScan) {
+  constexpr int totalKeys = 100000;
+  coco::BTree<int, int> tree;
+  for (int i = 0; i < totalKeys; i += 2) {
+    tree[i] = i;
+  }
+
+  // even keys are always there while odd keys are inserted and removed
+  std::atomic<bool> stop(false);
+  std::thread writer([&tree, &stop]() {
+    for (int i = 1; i < totalKeys; i += 2) {
+      tree[i] = i;
+    }
+    for (int i = 1; i < totalKeys; i += 2) {
+      tree.remove(i);
+    }
+    stop.store(true);
+  });
+
+  while (!stop.load()) {
+    int last = -1, n_even = 0;
+    tree.for_each([&last, &n_even](int key, int value) {
+      EXPECT_LT(last, key);
+      EXPECT_EQ(value, key);
+      last = key;
+      n_even += key % 2 == 0;
+    });
+    EXPECT_EQ(n_even, totalKeys / 2);
+  }
+  writer.join();
+  EXPECT_EQ(tree.size(), totalKeys / 2u);
+}
@@ -0,0 +1,71 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#include "common/BufferedFileWriter.h"
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string read_file(const std::string &filename) {
+  std::ifstream in(filename, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+std::string make_bytes(std::size_t size) {
+  std::string bytes(size, 0);
+  for (auto i = 0u; i < size; i++) {
+    bytes[i] = 'a' + i % 26;
+  }
+  return bytes;
+}
+
+void write_and_check(const std::string &filename, bool direct) {
+  std::size_t buffer_size = coco::BufferedFileWriter::BUFFER_SIZE;
+  std::string small = make_bytes(100), large = make_bytes(buffer_size + 5000);
+  std::string expected;
+
+  coco::BufferedFileWriter writer(filename.c_str(), direct);
+  writer.write(small.data(), small.size());
+  expected += small;
+  writer.sync();
+  EXPECT_EQ(read_file(filename).substr(0, expected.size()), expected);
+
+  // spans both buffers
+  writer.write(large.data(), large.size());
+  expected += large;
+  writer.write(small.data(), small.size());
+  expected += small;
+  writer.sync();
+  EXPECT_EQ(read_file(filename).substr(0, expected.size()), expected);
+
+  writer.close();
+  EXPECT_EQ(read_file(filename), expected);
+}
+} // namespace
+
+TEST(TestBufferedFileWriter, TestBuffered) {
+  std::string filename = "/tmp/coco_test_buffered_file_writer";
+  write_and_check(filename, false);
+  unlink(filename.c_str());
+}
+
+TEST(TestBufferedFileWriter, TestDirect) {
+  std::string filename = "/var/tmp/coco_test_buffered_file_writer";
+#ifdef O_DIRECT
+  // not every file system supports O_DIRECT, e.g., tmpfs
+  int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_DIRECT,
+                S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    return;
+  }
+  close(fd);
+  write_and_check(filename, true);
+  unlink(filename.c_str());
+#endif
+}
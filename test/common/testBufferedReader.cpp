@@ -0,0 +1,120 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/BufferedReader.h"
+#include "common/Encoder.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// message i has i + 1 pieces of a uint32_t each, which is i
+std::unique_ptr<coco::Message> new_message(uint32_t i) {
+  auto message = std::make_unique<coco::Message>();
+  message->set_worker_id(i % 7);
+  coco::Encoder encoder(message->data);
+  for (auto k = 0u; k <= i; k++) {
+    encoder << coco::MessagePiece::construct_message_piece_header(
+                   1, coco::MessagePiece::get_header_size() + sizeof(i), 0, 0)
+            << i;
+    message->flush();
+  }
+  return message;
+}
+
+void check_message(coco::Message &message, uint32_t i) {
+  EXPECT_TRUE(message.check_size());
+  EXPECT_EQ(message.get_worker_id(), i % 7);
+  EXPECT_EQ(message.get_message_count(), i + 1);
+  for (auto it = message.begin(); it != message.end(); it++) {
+    coco::Decoder dec((*it).toStringPiece());
+    uint32_t value;
+    dec >> value;
+    EXPECT_EQ(value, i);
+  }
+}
+
+void send_and_receive(bool zero_copy) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  coco::Socket in(fds[0]), out(fds[1]);
+
+  // more than a buffer in total, some messages are compressed
+  constexpr uint32_t n = 1000;
+  std::thread sender([&out]() {
+    std::string compressed;
+    for (auto i = 0u; i < n; i++) {
+      auto message = new_message(i);
+      if (i % 3 == 0 && message->compress_to(compressed)) {
+        out.write_n_bytes(compressed.data(), compressed.size());
+      } else {
+        auto offset = message->frame();
+        out.write_n_bytes(message->get_raw_ptr() + offset,
+                          message->data.size() - offset);
+      }
+    }
+  });
+
+  coco::BufferedReader reader(in, zero_copy);
+  std::vector<std::unique_ptr<coco::Message>> messages;
+  while (messages.size() < n) {
+    auto message = reader.next_message();
+    if (message != nullptr) {
+      messages.push_back(std::move(message));
+    }
+  }
+  sender.join();
+
+  // the messages stay valid while later ones are received
+  for (auto i = 0u; i < n; i++) {
+    check_message(*messages[i], i);
+  }
+  in.close();
+  out.close();
+}
+} // namespace
+
+TEST(TestBufferedReader, TestCopy) { send_and_receive(false); }
+
+TEST(TestBufferedReader, TestZeroCopy) { send_and_receive(true); }
+
+TEST(TestBufferedReader, TestLargeMessage) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  coco::Socket in(fds[0]), out(fds[1]);
+
+  // larger than the buffer of the reader
+  std::size_t size = coco::BufferedReader::BUFFER_SIZE + 1000;
+  coco::Message message;
+  coco::Encoder encoder(message.data);
+  encoder << coco::MessagePiece::construct_message_piece_header(
+      1, coco::MessagePiece::get_header_size() + size, 0, 0);
+  message.data.append(size, 'x');
+  message.flush();
+  std::string expected = message.data;
+
+  std::thread sender([&out, &message]() {
+    auto offset = message.frame();
+    out.write_n_bytes(message.get_raw_ptr() + offset,
+                      message.data.size() - offset);
+  });
+
+  coco::BufferedReader reader(in, true);
+  std::unique_ptr<coco::Message> received;
+  while (received == nullptr) {
+    received = reader.next_message();
+  }
+  sender.join();
+
+  EXPECT_TRUE(received->check_size());
+  auto pieces_size = coco::MessagePiece::get_header_size() + size;
+  EXPECT_EQ(received->get_pieces_size(), pieces_size);
+  EXPECT_EQ(std::string(received->get_pieces_ptr(), pieces_size),
+            expected.substr(coco::Message::get_prefix_size()));
+  in.close();
+  out.close();
+}
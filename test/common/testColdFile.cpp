@@ -0,0 +1,39 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/ColdFile.h"
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+TEST(TestColdFile, TestReadWrite) {
+  std::string filename = "/tmp/coco_test_cold_file";
+  {
+    coco::ColdFile file(filename, sizeof(uint64_t));
+
+    uint64_t values[] = {1, 2, 3}, slots[3];
+    file.write(reinterpret_cast<const char *>(values), 3, slots);
+    EXPECT_EQ(slots[0], 0u);
+    EXPECT_EQ(slots[2], 2u);
+    EXPECT_EQ(file.size(), 3u);
+
+    // the freed slot is written first
+    file.free(slots[1]);
+    EXPECT_EQ(file.size(), 2u);
+    uint64_t more[] = {4, 5};
+    file.write(reinterpret_cast<const char *>(more), 2, slots);
+    EXPECT_EQ(slots[0], 1u);
+    EXPECT_EQ(slots[1], 3u);
+    EXPECT_EQ(file.size(), 4u);
+
+    uint64_t value = 0;
+    file.read(0, &value);
+    EXPECT_EQ(value, 1u);
+    file.read(1, &value);
+    EXPECT_EQ(value, 4u);
+    file.read(3, &value);
+    EXPECT_EQ(value, 5u);
+  }
+  // removed once closed
+  EXPECT_NE(access(filename.c_str(), F_OK), 0);
+}
@@ -0,0 +1,33 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Coroutine.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(TestCoroutine, TestInterleave) {
+  std::vector<int> trace;
+  std::vector<std::unique_ptr<coco::Coroutine>> coroutines;
+  for (int i = 0; i < 2; i++) {
+    coroutines.emplace_back(
+        std::make_unique<coco::Coroutine>([&trace, i]() {
+          for (int j = 0; j < 3; j++) {
+            trace.push_back(i * 10 + j);
+            coco::Coroutine::yield();
+          }
+        }));
+  }
+
+  while (!coroutines[0]->done() || !coroutines[1]->done()) {
+    for (auto &coroutine : coroutines) {
+      if (!coroutine->done()) {
+        coroutine->resume();
+      }
+    }
+  }
+  EXPECT_EQ(trace, std::vector<int>({0, 10, 1, 11, 2, 12}));
+
+  // a yield outside of a coroutine returns right away
+  coco::Coroutine::yield();
+}
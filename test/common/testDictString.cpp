@@ -0,0 +1,62 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "common/DictString.h"
+#include "common/Encoder.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Colors {
+  static const coco::StringDictionary<8> &get() {
+    static coco::StringDictionary<8> dictionary({"RED", "GREEN", "BLUE",
+                                                 "RED"});
+    return dictionary;
+  }
+};
+} // namespace
+
+TEST(TestDictString, TestEncode) {
+
+  using namespace coco;
+
+  // duplicates keep their first code
+  EXPECT_EQ(Colors::get().size(), 3u);
+  EXPECT_EQ(Colors::get().encode(FixedString<8>("BLUE")), 2u);
+
+  DictString<8, Colors> s;
+  s.assign("GREEN");
+  EXPECT_EQ(s.code(), 1u);
+  EXPECT_EQ(s.decode(), FixedString<8>("GREEN"));
+  EXPECT_EQ(s.toString(), FixedString<8>("GREEN").toString());
+
+  // a read views the value in the dictionary
+  const FixedString<8> &v = s;
+  EXPECT_EQ(&v, &Colors::get().decode(1));
+
+  DictString<8, Colors> t(FixedString<8>("BLUE"));
+  EXPECT_NE(s, t);
+  EXPECT_TRUE(t < s);
+  t = FixedString<8>("GREEN");
+  EXPECT_EQ(s, t);
+  EXPECT_EQ(s.hash_code(), FixedString<8>("GREEN").hash_code());
+  EXPECT_EQ(sizeof(s), sizeof(uint32_t));
+}
+
+TEST(TestDictString, TestSerialization) {
+
+  using namespace coco;
+
+  DictString<8, Colors> s, t;
+  s.assign("BLUE");
+
+  std::string str;
+  Encoder enc(str);
+  enc << s;
+  EXPECT_EQ(str.size(), (ClassOf<DictString<8, Colors>>::size()));
+
+  Decoder dec(enc.toStringPiece());
+  dec >> t;
+  EXPECT_EQ(s, t);
+}
@@ -4,6 +4,7 @@
 
 #include "common/FixedString.h"
 #include <gtest/gtest.h>
+#include <random>
 
 TEST(TestCommonFixedString, TestHashCode) {
   using namespace coco;
@@ -18,3 +19,35 @@ TEST(TestCommonFixedString, TestHashCode) {
   EXPECT_EQ(s1, s3);
   EXPECT_EQ(s1.hash_code(), s3.hash_code());
 }
+
+TEST(TestCommonFixedString, TestCompare) {
+  using namespace coco;
+
+  // the same order as comparing char by char, for every length of the
+  // common prefix
+  auto naive = [](const std::string &a, const std::string &b) {
+    for (auto i = 0u; i < a.size(); i++) {
+      if (a[i] != b[i]) {
+        return a[i] < b[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  };
+
+  std::mt19937 rng(42);
+  for (auto i = 0; i < 10000; i++) {
+    std::string a(20, 'a');
+    for (auto &c : a) {
+      c = static_cast<char>(rng());
+    }
+    std::string b = a;
+    auto n = rng() % 21;
+    if (n < 20) {
+      b[n] = static_cast<char>(rng());
+    }
+    FixedString<20> s1(a), s2(b);
+    EXPECT_EQ(s1.compare(s2), naive(a, b));
+    EXPECT_EQ(s1 == s2, a == b);
+    EXPECT_EQ(s1 < s2, naive(a, b) < 0);
+  }
+}
@@ -0,0 +1,62 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Futex.h"
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(TestFutex, TestWaitUntil) {
+
+  std::atomic<uint32_t> word(0);
+  std::atomic<uint32_t> n_done(0);
+
+  std::vector<std::thread> threads;
+  for (auto i = 0; i < 4; i++) {
+    threads.emplace_back([&word, &n_done]() {
+      coco::Futex::wait_until(word, [](uint32_t v) { return v == 2; });
+      n_done.fetch_add(1);
+    });
+  }
+
+  // waiters park after spinning
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  coco::Futex::store_and_wake(word, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(n_done.load(), 0u);
+
+  coco::Futex::store_and_wake(word, 2);
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(n_done.load(), 4u);
+}
+
+TEST(TestFutex, TestWaitUntilWithWork) {
+
+  std::atomic<uint32_t> word(0);
+  std::atomic<uint32_t> n_work(0);
+
+  std::thread t([&word, &n_work]() {
+    coco::Futex::wait_until(word, [](uint32_t v) { return v >= 3; },
+                            [&n_work]() {
+                              n_work.fetch_add(1);
+                              return 0;
+                            });
+  });
+
+  // an idle waiter still works every IDLE_TIMEOUT_US
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  uint32_t n = n_work.load();
+  EXPECT_GT(n, 0u);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GT(n_work.load(), n);
+
+  for (auto i = 0; i < 3; i++) {
+    coco::Futex::add_and_wake(word, 1);
+  }
+  t.join();
+  EXPECT_EQ(word.load(), 3u);
+}
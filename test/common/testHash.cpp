@@ -0,0 +1,57 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/FixedString.h"
+#include "common/Hash.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+// the size of the fullest of n buckets
+template <class Func> std::size_t max_bucket(std::size_t n, Func hash_of) {
+  std::vector<std::size_t> buckets(n, 0);
+  for (auto i = 0u; i < 100 * n; i++) {
+    buckets[hash_of(i) % n]++;
+  }
+  return *std::max_element(buckets.begin(), buckets.end());
+}
+} // namespace
+
+TEST(TestHash, TestSpread) {
+
+  // the keys of an order line, (w_id, d_id, o_id, ol_number), in 997 buckets
+  auto order_line = [](uint32_t i) {
+    return coco::hash(int32_t(i % 7), int32_t(i % 10), int32_t(i / 150),
+                      int8_t(i % 15));
+  };
+  EXPECT_LT(max_bucket(997, order_line), 150u);
+  EXPECT_LT(max_bucket(997, [](uint32_t i) { return coco::hash(i); }), 150u);
+  // and in a power of two buckets
+  EXPECT_LT(max_bucket(1024, order_line), 150u);
+
+  auto name = [](uint32_t i) {
+    return coco::FixedString<16>(std::to_string(i)).hash_code();
+  };
+  EXPECT_LT(max_bucket(997, name), 150u);
+}
+
+TEST(TestHash, TestBytes) {
+
+  // every length hashes its bytes only
+  char a[64], b[64];
+  for (auto i = 0u; i < sizeof(a); i++) {
+    a[i] = b[i] = static_cast<char>(i);
+  }
+  for (auto n = 0u; n <= sizeof(a); n++) {
+    EXPECT_EQ(coco::hash_bytes(a, n), coco::hash_bytes(b, n));
+    if (n > 0) {
+      b[n - 1] ^= 1;
+      EXPECT_NE(coco::hash_bytes(a, n), coco::hash_bytes(b, n));
+      b[n - 1] ^= 1;
+      EXPECT_NE(coco::hash_bytes(a, n), coco::hash_bytes(a, n - 1));
+    }
+  }
+}
@@ -0,0 +1,99 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Histogram.h"
+#include "common/Percentile.h"
+#include <gtest/gtest.h>
+#include <random>
+
+TEST(TestHistogram, TestBasic) {
+
+  coco::Histogram h;
+  EXPECT_EQ(h.nth(50), 0);
+
+  std::vector<int> data = {15, 20, 35, 40, 50};
+  for (auto v : data) {
+    h.add(v);
+  }
+
+  EXPECT_EQ(h.size(), 5u);
+  EXPECT_EQ(h.nth(5), 15);
+  EXPECT_EQ(h.nth(30), 20);
+  EXPECT_EQ(h.nth(40), 20);
+  EXPECT_EQ(h.nth(50), 35);
+  EXPECT_EQ(h.nth(100), 50);
+
+  h.clear();
+  EXPECT_EQ(h.size(), 0u);
+  data = {3, 6, 7, 8, 8, 10, 13, 15, 16, 20};
+  for (auto v : data) {
+    h.add(v);
+  }
+
+  EXPECT_EQ(h.nth(25), 7);
+  EXPECT_EQ(h.nth(50), 8);
+  EXPECT_EQ(h.nth(75), 15);
+  EXPECT_EQ(h.nth(100), 20);
+}
+
+TEST(TestHistogram, TestBuckets) {
+
+  for (uint64_t v = 0; v < (1ull << 20); v += 7) {
+    auto i = coco::Histogram::index_of(v);
+    EXPECT_LE(coco::Histogram::lowest_of(i), v);
+    EXPECT_GE(coco::Histogram::highest_of(i), v);
+  }
+
+  uint64_t v = UINT64_MAX >> 1;
+  auto i = coco::Histogram::index_of(v);
+  std::size_t n = coco::Histogram::BUCKET_COUNT;
+  EXPECT_LT(i, n);
+  EXPECT_EQ(coco::Histogram::highest_of(i), v);
+}
+
+TEST(TestHistogram, TestAccuracy) {
+
+  std::mt19937 gen(1);
+  std::lognormal_distribution<double> dist(6, 1.5);
+
+  coco::Histogram h;
+  coco::Percentile<int64_t> p;
+  for (auto i = 0; i < 100000; i++) {
+    auto v = static_cast<int64_t>(dist(gen));
+    h.add(v);
+    p.add(v);
+  }
+
+  for (auto n : {50.0, 90.0, 99.0, 99.9, 100.0}) {
+    auto expected = p.nth(n);
+    EXPECT_GE(h.nth(n), expected);
+    EXPECT_LE(h.nth(n), expected + expected / 100);
+  }
+}
+
+TEST(TestHistogram, TestMerge) {
+
+  coco::Histogram a, b, all;
+  for (auto i = 0; i < 1000; i++) {
+    a.add(i);
+    all.add(i);
+    b.add(i * 100);
+    all.add(i * 100);
+  }
+
+  coco::Histogram merged;
+  merged.merge(a);
+  std::string bytes;
+  coco::Encoder encoder(bytes);
+  b.encode(encoder);
+  EXPECT_EQ(encoder.size(), b.encoded_size());
+  coco::Decoder dec(encoder.toStringPiece());
+  merged.decode_and_merge(dec);
+  EXPECT_EQ(dec.size(), 0u);
+
+  EXPECT_EQ(merged.size(), all.size());
+  for (auto n : {1.0, 25.0, 50.0, 75.0, 99.0, 100.0}) {
+    EXPECT_EQ(merged.nth(n), all.nth(n));
+  }
+}
@@ -0,0 +1,82 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Encoder.h"
+#include "common/LZ4.h"
+#include "common/Message.h"
+#include "common/Random.h"
+#include <gtest/gtest.h>
+
+namespace {
+std::string round_trip(const std::string &raw) {
+  std::string compressed(coco::LZ4::compress_bound(raw.size()), 0);
+  compressed.resize(
+      coco::LZ4::compress(raw.data(), raw.size(), &compressed[0]));
+
+  std::string decompressed(raw.size(), 0);
+  EXPECT_TRUE(coco::LZ4::decompress(compressed.data(), compressed.size(),
+                                    &decompressed[0], decompressed.size()));
+  // a wrong raw size is rejected
+  std::string longer(raw.size() + 1, 0);
+  EXPECT_FALSE(coco::LZ4::decompress(compressed.data(), compressed.size(),
+                                     &longer[0], longer.size()));
+  EXPECT_EQ(decompressed, raw);
+  return compressed;
+}
+} // namespace
+
+TEST(TestLZ4, TestRoundTrip) {
+  coco::Random random(reinterpret_cast<uint64_t>(&random));
+
+  round_trip("");
+  round_trip("coco");
+  round_trip(std::string(13, 'a'));
+
+  // incompressible data grows a little
+  std::string raw = random.a_string(100000, 100000);
+  EXPECT_LE(round_trip(raw).size(), coco::LZ4::compress_bound(raw.size()));
+
+  // repeated rows, long matches and offsets beyond 64KB
+  raw.clear();
+  for (auto i = 0u; i < 2000; i++) {
+    raw += random.a_string(50, 50) + std::string(300, 'x');
+    raw += raw.substr(random.uniform_dist(0, raw.size() - 1), 20);
+  }
+  EXPECT_LT(round_trip(raw).size(), raw.size() / 2);
+}
+
+TEST(TestLZ4, TestMessage) {
+  using coco::Message;
+  using coco::MessagePiece;
+
+  Message message;
+  message.set_source_node_id(1);
+  message.set_dest_node_id(2);
+  message.set_worker_id(3);
+
+  coco::Encoder encoder(message.data);
+  for (auto i = 0; i < 100; i++) {
+    encoder << MessagePiece::construct_message_piece_header(
+                   5, MessagePiece::get_header_size() + 100, 1, 2)
+            << std::string(100, 'a' + i % 3);
+    message.flush();
+  }
+
+  std::string buffer;
+  EXPECT_TRUE(message.compress_to(buffer));
+  EXPECT_LT(buffer.size(), message.data.size());
+  EXPECT_EQ(Message::get_wire_length(buffer.data()), buffer.size());
+
+  Message decompressed;
+  EXPECT_TRUE(decompressed.read_from(buffer.data(), buffer.size()));
+  EXPECT_TRUE(decompressed.check_deadbeef());
+  EXPECT_TRUE(decompressed.check_size());
+  EXPECT_EQ(decompressed.data, message.data);
+  EXPECT_EQ(decompressed.get_worker_id(), 3u);
+  EXPECT_EQ(decompressed.get_message_count(), 100u);
+
+  // a message that does not get smaller is sent as it is
+  Message small;
+  EXPECT_FALSE(small.compress_to(buffer));
+}
@@ -4,6 +4,7 @@
 
 #include "common/LockfreeQueue.h"
 #include <gtest/gtest.h>
+#include <thread>
 
 TEST(TestLockfreeQueue, TestInt) {
   coco::LockfreeQueue<int> q;
@@ -12,4 +13,41 @@ TEST(TestLockfreeQueue, TestInt) {
   q.pop();
 
   EXPECT_EQ(q.write_available(), q.capacity());
-}
\ No newline at end of file
+}
+TEST(TestLockfreeQueue, TestBatch) {
+  coco::LockfreeQueue<int, 8> q;
+  int values[5] = {1, 2, 3, 4, 5};
+  q.push_n(values, 5);
+
+  int out[8];
+  EXPECT_EQ(q.pop_n(out, 3), 3u);
+  EXPECT_EQ(out[0], 1);
+  EXPECT_EQ(out[2], 3);
+
+  // wraps around the end of the ring buffer
+  q.push_n(values, 5);
+  EXPECT_EQ(q.pop_n(out, 8), 7u);
+  EXPECT_EQ(out[0], 4);
+  EXPECT_EQ(out[1], 5);
+  EXPECT_EQ(out[2], 1);
+  EXPECT_EQ(out[6], 5);
+  EXPECT_EQ(q.pop_n(out, 8), 0u);
+}
+
+TEST(TestLockfreeQueue, TestStall) {
+  coco::LockfreeQueue<int, 8> q;
+  int values[8] = {};
+  EXPECT_EQ(q.push_n(values, 6), 0u);
+  EXPECT_EQ(q.occupancy(), 6u);
+  EXPECT_EQ(q.push(0), 0u);
+
+  // the producer waits until the consumer makes room
+  std::thread consumer([&q]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    int out[8];
+    q.pop_n(out, 8);
+  });
+  EXPECT_GT(q.push_n(values, 4), 0u);
+  consumer.join();
+  EXPECT_EQ(q.occupancy(), 3u);
+}
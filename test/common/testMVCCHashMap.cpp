@@ -5,6 +5,7 @@
 #include "common/MVCCHashMap.h"
 #include <gtest/gtest.h>
 #include <thread>
+#include <vector>
 
 TEST(TestHashMap, TestBasic) {
   coco::MVCCHashMap<10, int, int> map;
@@ -56,3 +57,40 @@ TEST(TestHashMap, TestBasic) {
   EXPECT_FALSE(map.contains_key_version(1, 900));
   EXPECT_TRUE(map.contains_key_version(1, 1000));
 }
+
+TEST(TestHashMap, TestStableVersions) {
+  coco::MVCCHashMap<10, int, int> map;
+
+  // references stay valid while newer versions are inserted
+  std::vector<int *> values;
+  for (auto i = 1; i <= 100; i++) {
+    auto &v = map.insert_key_version_holder(1, i);
+    v = i * 10;
+    values.push_back(&v);
+  }
+  EXPECT_EQ(map.version_count(1), 100);
+  for (auto i = 1; i <= 100; i++) {
+    EXPECT_EQ(map.get_key_version(1, i), values[i - 1]);
+    EXPECT_EQ(*values[i - 1], i * 10);
+  }
+  EXPECT_EQ(*map.get_key_version_prev(1, 51), 500);
+
+  // vacuumed values are reused and reset
+  EXPECT_EQ(map.vacuum_key_versions(1, 90), 90);
+  EXPECT_EQ(map.version_count(1), 10);
+  EXPECT_EQ(map.get_key_version(1, 90), nullptr);
+  // key 11 is in the same bucket as key 1
+  auto &v = map.insert_key_version_holder(11, 1);
+  EXPECT_EQ(v, 0);
+  EXPECT_EQ(*map.get_key_version(1, 91), 910);
+
+  // the latest version is removed, the next one becomes the latest
+  EXPECT_TRUE(map.remove_key_version(1, 100));
+  EXPECT_EQ(*map.get_key_version_prev(1, 1000), 990);
+  EXPECT_EQ(map.vacuum_key_keep_latest(1), 8);
+  EXPECT_EQ(map.version_count(1), 1);
+  EXPECT_TRUE(map.contains_key_version(1, 99));
+
+  EXPECT_EQ(map.vacuum_key_versions(1, 99), 1);
+  EXPECT_FALSE(map.contains_key(1));
+}
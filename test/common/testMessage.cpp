@@ -5,6 +5,7 @@
 #include "common/Encoder.h"
 #include "common/Message.h"
 #include <gtest/gtest.h>
+#include <memory>
 
 TEST(TestMessage, TestBasic) {
   using coco::Decoder;
@@ -43,9 +44,12 @@ TEST(TestMessage, TestBasic) {
   message.flush();
   EXPECT_TRUE(message.check_size());
 
+  // the second piece is sent by a coroutine
+  MessagePiece::current_coroutine_id() = 7;
   auto message_piece_header1 = MessagePiece::construct_message_piece_header(
       message_type, sizeof(int64_t) + MessagePiece::get_header_size(), table_id,
       partition_id);
+  MessagePiece::current_coroutine_id() = 0;
   encoder << message_piece_header1 << message_content1;
 
   EXPECT_FALSE(message.check_size());
@@ -54,8 +58,7 @@ TEST(TestMessage, TestBasic) {
 
   EXPECT_EQ(message.get_message_count(), 2);
   EXPECT_EQ(message.get_message_length(),
-            sizeof(Message::header_type) + sizeof(Message::deadbeef_type) +
-                2 * sizeof(MessagePiece::header_type) +
+            Message::get_prefix_size() + 2 * sizeof(MessagePiece::header_type) +
                 sizeof(message_content0) + sizeof(message_content1));
 
   EXPECT_EQ(message.get_message_length(), message.data.size());
@@ -75,6 +78,7 @@ TEST(TestMessage, TestBasic) {
   EXPECT_EQ(decoded_message_content0, message_content0);
   EXPECT_EQ((*it).get_message_length(),
             sizeof(MessagePiece::header_type) + sizeof(int32_t));
+  EXPECT_EQ((*it).get_coroutine_id(), 0);
 
   it++;
 
@@ -84,7 +88,124 @@ TEST(TestMessage, TestBasic) {
   EXPECT_EQ(decoded_message_content1, message_content1);
   EXPECT_EQ((*it).get_message_length(),
             sizeof(MessagePiece::header_type) + sizeof(int64_t));
+  EXPECT_EQ((*it).get_coroutine_id(), 7);
   ++it;
 
   EXPECT_EQ(it, message.end());
-}
\ No newline at end of file
+}
+TEST(TestMessage, TestMergePieces) {
+  using coco::Encoder;
+  using coco::Message;
+  using coco::MessagePiece;
+
+  Message message;
+  Encoder encoder(message.data);
+  auto header = [](std::size_t partition_id) {
+    return MessagePiece::construct_message_piece_header(
+        5, MessagePiece::get_header_size() + sizeof(int32_t), 1, partition_id);
+  };
+
+  EXPECT_FALSE(message.can_merge(header(2)));
+  encoder << header(2) << int32_t(1);
+  message.flush();
+
+  // the same table and partition share a piece
+  EXPECT_TRUE(message.can_merge(header(2)));
+  encoder << int32_t(2);
+  message.merge_into_last_piece();
+
+  EXPECT_FALSE(message.can_merge(header(3)));
+  encoder << header(3) << int32_t(3);
+  message.flush();
+
+  EXPECT_TRUE(message.check_size());
+  EXPECT_EQ(message.get_message_count(), 2);
+
+  auto it = message.begin();
+  EXPECT_EQ((*it).get_partition_id(), 2);
+  EXPECT_EQ((*it).get_message_length(),
+            MessagePiece::get_header_size() + 2 * sizeof(int32_t));
+  coco::Decoder dec((*it).toStringPiece());
+  int32_t first, second;
+  dec >> first >> second;
+  EXPECT_EQ(first, 1);
+  EXPECT_EQ(second, 2);
+
+  ++it;
+  EXPECT_EQ((*it).get_partition_id(), 3);
+  EXPECT_EQ((*it).get_message_length(),
+            MessagePiece::get_header_size() + sizeof(int32_t));
+  ++it;
+  EXPECT_EQ(it, message.end());
+}
+
+TEST(TestMessage, TestWireFormats) {
+  using coco::Message;
+  using coco::MessagePiece;
+
+  auto new_message = [](uint64_t worker_id, std::size_t n_pieces) {
+    auto message = std::make_unique<Message>();
+    message->set_source_node_id(1);
+    message->set_dest_node_id(2);
+    message->set_worker_id(worker_id);
+    coco::Encoder encoder(message->data);
+    for (auto i = 0u; i < n_pieces; i++) {
+      encoder << MessagePiece::construct_message_piece_header(
+                     5, MessagePiece::get_header_size() + sizeof(i), 1, 2)
+              << i;
+      message->flush();
+    }
+    return message;
+  };
+
+  auto read = [](const char *ptr, std::size_t length) {
+    EXPECT_TRUE(Message::is_deadbeef(Message::get_deadbeef(ptr)));
+    EXPECT_EQ(Message::get_wire_length(ptr), length);
+    Message message;
+    EXPECT_TRUE(message.read_from(ptr, length));
+    EXPECT_TRUE(message.check_deadbeef());
+    EXPECT_TRUE(message.check_size());
+    return message;
+  };
+
+  // worker 300 or 40000 pieces need the extended header
+  for (auto p : {std::make_pair(3, 10), std::make_pair(300, 10),
+                 std::make_pair(3, 40000)}) {
+    auto message = new_message(p.first, p.second);
+    auto expected = message->data;
+    bool compact = p.first < 256 && p.second < 32768;
+
+    std::string compressed;
+    if (message->compress_to(compressed)) {
+      EXPECT_TRUE(
+          Message::is_compressed(Message::get_deadbeef(&compressed[0])));
+      EXPECT_EQ(Message::get_wire_worker_id(&compressed[0]), p.first);
+      auto decompressed = read(&compressed[0], compressed.size());
+      EXPECT_EQ(decompressed.data, expected);
+    }
+
+    // the pieces differ by one in their last word only
+    std::string packed;
+    EXPECT_TRUE(message->pack_to(packed));
+    EXPECT_TRUE(Message::is_packed(Message::get_deadbeef(&packed[0])));
+    EXPECT_EQ(Message::get_wire_worker_id(&packed[0]), p.first);
+    EXPECT_EQ(read(&packed[0], packed.size()).data, expected);
+
+    auto offset = message->frame();
+    const char *ptr = message->get_raw_ptr() + offset;
+    auto deadbeef = Message::get_deadbeef(ptr);
+    EXPECT_EQ(Message::is_extended(deadbeef), !compact);
+    EXPECT_FALSE(Message::is_compressed(deadbeef));
+    EXPECT_EQ(Message::get_wire_prefix_size(ptr),
+              compact ? Message::get_compact_prefix_size()
+                      : Message::get_prefix_size());
+    EXPECT_EQ(Message::get_wire_worker_id(ptr), p.first);
+
+    auto received = read(ptr, message->data.size() - offset);
+    EXPECT_EQ(received.data, expected);
+    EXPECT_EQ(received.get_source_node_id(), 1);
+    EXPECT_EQ(received.get_dest_node_id(), 2);
+    EXPECT_EQ(received.get_worker_id(), p.first);
+    EXPECT_EQ(received.get_message_count(), p.second);
+  }
+}
@@ -0,0 +1,45 @@
+//
+// Created by Yi Lu on 8/29/18.
+//
+
+#include "common/MessagePool.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestMessagePool, TestRecycle) {
+  coco::MessagePool pool;
+  coco::Message *message = pool.get();
+  std::size_t reserved_size = coco::MessagePool::RESERVED_SIZE;
+  EXPECT_GE(message->data.capacity(), reserved_size);
+  message->set_worker_id(3);
+  message->data.append(100, 'x');
+  pool.put(message);
+
+  coco::Message *recycled = pool.get();
+  EXPECT_EQ(recycled, message);
+  EXPECT_EQ(recycled->data.size(), coco::Message::get_prefix_size());
+  EXPECT_EQ(recycled->get_worker_id(), 0);
+  EXPECT_TRUE(recycled->check_deadbeef());
+  EXPECT_TRUE(recycled->check_size());
+  pool.put(recycled);
+}
+
+TEST(TestMessagePool, TestConcurrent) {
+  constexpr int n = 100000;
+  coco::MessagePool pool;
+  coco::LockfreeQueue<coco::Message *> queue;
+
+  std::thread consumer([&]() {
+    for (int i = 0; i < n; i++) {
+      queue.wait_till_non_empty();
+      coco::Message *message = queue.front();
+      queue.pop();
+      pool.put(message);
+    }
+  });
+
+  for (int i = 0; i < n; i++) {
+    queue.push(pool.get());
+  }
+  consumer.join();
+}
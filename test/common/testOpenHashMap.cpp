@@ -0,0 +1,183 @@
+//
+// Created by Yi Lu on 7/14/18.
+//
+
+#include "common/OpenHashMap.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestOpenHashMap, TestConcurrent) {
+
+  constexpr int nThreads = 10, keys = 1000, totalKeys = nThreads * keys;
+
+  coco::OpenHashMap<nThreads, int, int> maps;
+  std::vector<std::thread> v;
+
+  for (int i = 0; i < nThreads; i++) {
+    v.emplace_back(std::thread([i, &maps]() {
+      for (int j = i; j < totalKeys; j += nThreads) {
+        maps[j] = j;
+      }
+    }));
+  }
+  for (auto &t : v) {
+    t.join();
+  }
+
+  EXPECT_EQ(maps.size(), totalKeys);
+  for (int i = 0; i < totalKeys; i++) {
+    EXPECT_EQ(maps[i], i);
+  }
+}
+
+TEST(TestOpenHashMap, TestSerialized) {
+  coco::OpenHashMap<1, int, int> maps;
+  EXPECT_EQ(maps.size(), 0);
+  maps[0] = 0;
+  EXPECT_EQ(maps.size(), 1);
+  auto &v = maps[0];
+  EXPECT_EQ(v, 0);
+  v = 1;
+  EXPECT_EQ(maps[0], 1);
+  EXPECT_FALSE(maps.contains(1));
+  EXPECT_TRUE(maps.contains(0));
+  EXPECT_FALSE(maps.insert(0, 2));
+  maps.remove(0);
+  EXPECT_EQ(maps.size(), 0);
+  EXPECT_TRUE(maps.insert(0, 2));
+  EXPECT_EQ(maps[0], 2);
+}
+
+TEST(TestOpenHashMap, TestStableReference) {
+  coco::OpenHashMap<3, int, int> maps;
+  maps.reserve(10);
+  int *first = &maps[0];
+  *first = 42;
+  for (int i = 1; i < 100000; i++) {
+    maps[i] = i;
+  }
+  EXPECT_EQ(first, &maps[0]);
+  EXPECT_EQ(maps[0], 42);
+  EXPECT_EQ(maps.size(), 100000);
+
+  for (int i = 0; i < 100000; i += 2) {
+    EXPECT_TRUE(maps.remove(i));
+  }
+  EXPECT_EQ(maps.size(), 50000);
+  for (int i = 0; i < 100000; i++) {
+    EXPECT_EQ(maps.contains(i), i % 2 == 1);
+  }
+
+  maps.clear();
+  EXPECT_EQ(maps.size(), 0);
+  EXPECT_FALSE(maps.contains(1));
+}
+
+TEST(TestOpenHashMap, TestConcurrentLookup) {
+  constexpr int nThreads = 4, keys = 100000;
+  coco::OpenHashMap<7, int, int> maps;
+  std::atomic<int> inserted(0);
+  std::vector<std::thread> v;
+
+  // readers never miss a key that has been published
+  v.emplace_back(std::thread([&]() {
+    for (int i = 0; i < keys; i++) {
+      maps.insert(i, i);
+      inserted.store(i + 1, std::memory_order_release);
+    }
+  }));
+  for (int i = 0; i < nThreads; i++) {
+    v.emplace_back(std::thread([&]() {
+      int n;
+      while ((n = inserted.load(std::memory_order_acquire)) < keys) {
+        if (n > 0) {
+          EXPECT_TRUE(maps.contains(n - 1));
+        }
+      }
+    }));
+  }
+  for (auto &t : v) {
+    t.join();
+  }
+  EXPECT_EQ(maps.size(), keys);
+}
+
+TEST(TestOpenHashMap, TestFindBatch) {
+  coco::OpenHashMap<7, int, int> maps;
+  for (int i = 0; i < 1000; i++) {
+    maps.insert(i, i * 2);
+  }
+
+  // more keys than a batch, including missing ones and duplicates
+  std::vector<int> keys;
+  for (int i = 0; i < 40; i++) {
+    keys.push_back(i * 37 % 1100);
+  }
+  keys.push_back(keys[0]);
+  std::vector<const int *> key_ptrs;
+  for (auto &key : keys) {
+    key_ptrs.push_back(&key);
+  }
+
+  std::vector<int *> values(keys.size(), nullptr);
+  maps.find_batch(key_ptrs.data(), key_ptrs.size(),
+                  [&values](std::size_t i, int &value) { values[i] = &value; });
+  for (auto i = 0u; i < keys.size(); i++) {
+    EXPECT_EQ(values[i], &maps[keys[i]]);
+    if (keys[i] < 1000) {
+      EXPECT_EQ(*values[i], keys[i] * 2);
+    }
+  }
+  EXPECT_EQ(values[0], values.back());
+  EXPECT_EQ(maps.size(), 1002u);
+}
+
+TEST(TestOpenHashMap, TestIncrementalGrowth) {
+  coco::OpenHashMap<1, int, int> maps;
+
+  // the rows inserted so far are found, and once removed are not, whether
+  // or not they are moved yet
+  for (int i = 0; i < 10000; i++) {
+    EXPECT_TRUE(maps.insert(i, i));
+    if (i % 2 == 1) {
+      EXPECT_TRUE(maps.remove(i / 2));
+      EXPECT_FALSE(maps.contains(i / 2));
+    }
+    EXPECT_TRUE(maps.contains(i));
+  }
+  for (int i = 5000; i < 10000; i++) {
+    EXPECT_TRUE(maps.contains(i));
+  }
+
+  std::size_t n = 0;
+  maps.for_each([&n](int key, int value) {
+    EXPECT_EQ(key, value);
+    n++;
+  });
+  EXPECT_EQ(n, maps.size());
+  EXPECT_EQ(maps.size(), 5000u);
+}
+
+TEST(TestOpenHashMap, TestLookupWhileGrowing) {
+  coco::OpenHashMap<1, int, int> maps;
+  constexpr int totalKeys = 100000;
+  std::atomic<int> inserted(0);
+
+  std::thread writer([&maps, &inserted]() {
+    for (int i = 0; i < totalKeys; i++) {
+      maps[i] = i;
+      inserted.store(i + 1, std::memory_order_release);
+    }
+  });
+
+  // a reader never misses a row inserted before, while the bucket grows
+  int misses = 0;
+  for (int n = 0; n < totalKeys;) {
+    n = inserted.load(std::memory_order_acquire);
+    for (int i = n - 1; i >= 0 && i >= n - 64; i--) {
+      misses += !maps.contains(i);
+    }
+  }
+  writer.join();
+  EXPECT_EQ(misses, 0);
+}
@@ -0,0 +1,105 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Encoder.h"
+#include "common/PieceCodec.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace {
+
+using coco::MessagePiece;
+using coco::PieceCodec;
+
+// a piece of type with key and tid, e.g., a lock request
+void add_piece(std::string &pieces, uint32_t type, std::size_t table_id,
+               std::size_t partition_id, uint64_t key, uint64_t tid) {
+  coco::Encoder encoder(pieces);
+  encoder << MessagePiece::construct_message_piece_header(
+                 type,
+                 MessagePiece::get_header_size() + sizeof(key) + sizeof(tid),
+                 table_id, partition_id)
+          << key << tid;
+}
+
+std::string round_trip(const std::string &pieces, std::string &packed) {
+  packed.clear();
+  PieceCodec::pack(pieces.data(), pieces.size(), packed);
+  std::string unpacked(pieces.size(), 0);
+  EXPECT_TRUE(
+      PieceCodec::unpack(packed.data(), packed.size(), &unpacked[0],
+                         unpacked.size()));
+  return unpacked;
+}
+} // namespace
+
+TEST(TestPieceCodec, TestVarint) {
+
+  std::string bytes;
+  for (uint64_t v : {0ull, 127ull, 128ull, 300ull, ~0ull}) {
+    PieceCodec::write_varint(bytes, v);
+  }
+  EXPECT_EQ(bytes.size(), 1u + 1 + 2 + 2 + 10);
+
+  auto ip = reinterpret_cast<const uint8_t *>(bytes.data());
+  auto end = ip + bytes.size();
+  for (uint64_t v : {0ull, 127ull, 128ull, 300ull, ~0ull}) {
+    uint64_t read;
+    ASSERT_TRUE(PieceCodec::read_varint(ip, end, read));
+    EXPECT_EQ(read, v);
+  }
+  uint64_t read;
+  EXPECT_FALSE(PieceCodec::read_varint(ip, end, read));
+}
+
+TEST(TestPieceCodec, TestPack) {
+
+  // a batch of lock requests to nearby keys with nearby tids, then a run of
+  // other pieces
+  std::string pieces, packed;
+  for (auto i = 0u; i < 100; i++) {
+    add_piece(pieces, 3, 1, 7, 1000 + 3 * i, (1ull << 40) + i);
+  }
+  for (auto i = 0u; i < 10; i++) {
+    add_piece(pieces, 4, 2, 300, 5000 - i, 1ull << 50);
+  }
+  add_piece(pieces, 3, 1, 7, ~0ull, 0);
+
+  EXPECT_EQ(round_trip(pieces, packed), pieces);
+  EXPECT_LT(packed.size(), pieces.size() / 4);
+
+  // random bodies are kept as they are, plus a tag and the ids
+  pieces.clear();
+  std::mt19937_64 rng(42);
+  for (auto i = 0u; i < 100; i++) {
+    add_piece(pieces, 3, 1, 7, rng(), rng());
+  }
+  EXPECT_EQ(round_trip(pieces, packed), pieces);
+  EXPECT_LE(packed.size(), pieces.size() - 100 * 6);
+}
+
+TEST(TestPieceCodec, TestMalformed) {
+
+  std::string pieces, packed;
+  add_piece(pieces, 3, 1, 7, 1, 2);
+  add_piece(pieces, 3, 1, 7, 3, 4);
+  round_trip(pieces, packed);
+
+  std::string unpacked(pieces.size(), 0);
+  // truncated, or of a different raw size
+  for (auto n = 0u; n < packed.size(); n++) {
+    EXPECT_FALSE(PieceCodec::unpack(packed.data(), n, &unpacked[0],
+                                    unpacked.size()));
+  }
+  EXPECT_FALSE(PieceCodec::unpack(packed.data(), packed.size(), &unpacked[0],
+                                  unpacked.size() - 1));
+  EXPECT_FALSE(PieceCodec::unpack(packed.data(), packed.size(), &unpacked[0],
+                                  unpacked.size() / 2));
+
+  // a run with no piece before it
+  std::string run;
+  PieceCodec::write_varint(run, 1);
+  EXPECT_FALSE(
+      PieceCodec::unpack(run.data(), run.size(), &unpacked[0], unpacked.size()));
+}
@@ -48,4 +48,16 @@ TEST(TestSerialization, TestFixedString) {
   EXPECT_EQ(serializedString.length(), 40);
   EXPECT_EQ(s1, s2);
   EXPECT_EQ(size, s1.size());
-}
\ No newline at end of file
+}
+TEST(TestSerialization, TestAppend) {
+  std::string out = "prefix";
+  int a1 = 0x1234;
+  std::string s1 = "helloworld";
+  coco::FixedString<10> f1 = "hello";
+  coco::Serializer<int>()(a1, out);
+  coco::Serializer<std::string>()(s1, out);
+  coco::Serializer<coco::FixedString<10>>()(f1, out);
+  EXPECT_EQ(out, "prefix" + coco::Serializer<int>()(a1) +
+                     coco::Serializer<std::string>()(s1) +
+                     coco::Serializer<coco::FixedString<10>>()(f1));
+}
@@ -0,0 +1,75 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "common/Socket.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+
+TEST(TestShmConnection, TestRing) {
+  const std::size_t capacity = 16;
+  std::unique_ptr<char[]> memory(new char[coco::ShmRing::bytes(capacity)]);
+  coco::ShmRing ring(memory.get(), capacity);
+  ring.init();
+
+  char buf[32];
+  EXPECT_EQ(ring.read(buf, sizeof(buf)), 0u);
+  EXPECT_EQ(ring.write("0123456789", 10), 10u);
+  EXPECT_EQ(ring.read(buf, 6), 6u);
+  EXPECT_EQ(std::string(buf, 6), "012345");
+
+  // wraps around, and a full ring takes no more
+  EXPECT_EQ(ring.write("abcdefghijklmnop", 16), 12u);
+  EXPECT_EQ(ring.write("x", 1), 0u);
+  EXPECT_EQ(ring.read(buf, sizeof(buf)), 16u);
+  EXPECT_EQ(std::string(buf, 16), "6789abcdefghijkl");
+}
+
+TEST(TestShmConnection, TestIsLocal) {
+  EXPECT_TRUE(coco::ShmConnection::is_local("127.0.0.1"));
+  EXPECT_FALSE(coco::ShmConnection::is_local("192.0.2.1"));
+  EXPECT_FALSE(coco::ShmConnection::is_local("localhost"));
+}
+
+TEST(TestShmConnection, TestSocket) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  coco::Socket a(fds[0]), b(fds[1]);
+
+  std::thread peer([&b]() {
+    b.begin_shm();
+    b.finish_shm();
+    b.wait_shm();
+  });
+  a.begin_shm();
+  a.finish_shm();
+  a.wait_shm();
+  peer.join();
+
+  // larger than a ring, the writer waits for the reader to drain it
+  std::string s1(coco::ShmConnection::CAPACITY * 3 / 2, 'a'), s2 = "hello";
+  std::thread writer([&]() {
+    iovec iov[2] = {{&s1[0], s1.size()}, {&s2[0], s2.size()}};
+    EXPECT_EQ(a.write_n_bytes_v(iov, 2), s1.size() + s2.size());
+  });
+
+  std::string result(s1.size() + s2.size(), 0);
+  long n;
+  while ((n = b.read_n_bytes_async(&result[0], result.size())) == -1) {
+  }
+  EXPECT_EQ(n, result.size());
+  writer.join();
+  EXPECT_EQ(result, s1 + s2);
+
+  // and the other way round
+  char c = 0;
+  EXPECT_EQ(a.read_async(&c, 1), -1);
+  EXPECT_EQ(b.write("x", 1), 1);
+  EXPECT_EQ(a.read_async(&c, 1), 1);
+  EXPECT_EQ(c, 'x');
+
+  a.close();
+  b.close();
+}
@@ -0,0 +1,85 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/SmallVector.h"
+#include <gtest/gtest.h>
+
+TEST(TestSmallVector, TestInline) {
+
+  using namespace coco;
+
+  SmallVector<int, 4> v;
+  EXPECT_TRUE(v.empty());
+  EXPECT_EQ(v.capacity(), 4u);
+
+  for (auto i = 0; i < 4; i++) {
+    v.push_back(i);
+  }
+  EXPECT_EQ(v.size(), 4u);
+  EXPECT_FALSE(v.spilled());
+  EXPECT_EQ(v.front(), 0);
+  EXPECT_EQ(v.back(), 3);
+
+  int sum = 0;
+  for (auto x : v) {
+    sum += x;
+  }
+  EXPECT_EQ(sum, 6);
+
+  v.pop_back();
+  v.emplace_back(7);
+  EXPECT_EQ(v[3], 7);
+}
+
+TEST(TestSmallVector, TestSpill) {
+
+  using namespace coco;
+
+  SmallVector<int, 2> v;
+  v.push_back(1);
+  v.push_back(2);
+  // the element pushed is an element of the vector
+  v.push_back(v[0]);
+  EXPECT_TRUE(v.spilled());
+  EXPECT_EQ(v.size(), 3u);
+  EXPECT_EQ(v.capacity(), 4u);
+  EXPECT_EQ(v[0], 1);
+  EXPECT_EQ(v[1], 2);
+  EXPECT_EQ(v[2], 1);
+
+  for (auto i = 0; i < 100; i++) {
+    v.push_back(i);
+  }
+  EXPECT_EQ(v.size(), 103u);
+  EXPECT_EQ(v[102], 99);
+
+  // clear keeps the capacity
+  auto capacity = v.capacity();
+  v.clear();
+  EXPECT_TRUE(v.empty());
+  EXPECT_EQ(v.capacity(), capacity);
+
+  v.resize(3);
+  EXPECT_EQ(v[2], 0);
+}
+
+TEST(TestSmallVector, TestCopy) {
+
+  using namespace coco;
+
+  SmallVector<int, 2> a, b;
+  a.push_back(1);
+  b = a;
+  EXPECT_FALSE(b.spilled());
+  EXPECT_EQ(b.size(), 1u);
+  EXPECT_NE(b.data(), a.data());
+
+  for (auto i = 0; i < 10; i++) {
+    a.push_back(i);
+  }
+  SmallVector<int, 2> c(a);
+  EXPECT_EQ(c.size(), 11u);
+  EXPECT_EQ(c[10], 9);
+  EXPECT_NE(c.data(), a.data());
+}
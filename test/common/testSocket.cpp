@@ -2,6 +2,7 @@
 // Created by Yi Lu on 7/24/18.
 //
 #include "common/Socket.h"
+#include <chrono>
 #include <gtest/gtest.h>
 #include <thread>
 
@@ -44,4 +45,74 @@ TEST(TestSocket, TestBasic) {
   for (std::size_t i = 0; i < v.size(); i++) {
     v[i].join();
   }
-}
\ No newline at end of file
+}
+TEST(TestSocket, TestWriteV) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  coco::Socket a(fds[0]), b(fds[1]);
+
+  // larger than the socket buffer, forces partial writes
+  std::string s1(1 << 20, 'a'), s2 = "hello", s3(1 << 19, 'c');
+  std::thread writer([&]() {
+    iovec iov[3] = {{&s1[0], s1.size()}, {&s2[0], s2.size()},
+                    {&s3[0], s3.size()}};
+    EXPECT_EQ(a.write_n_bytes_v(iov, 3), s1.size() + s2.size() + s3.size());
+  });
+
+  std::string result(s1.size() + s2.size() + s3.size(), 0);
+  EXPECT_EQ(b.read_n_bytes(&result[0], result.size()), result.size());
+  writer.join();
+  EXPECT_EQ(result, s1 + s2 + s3);
+
+  a.close();
+  b.close();
+}
+
+TEST(TestSocket, TestBusyPoll) {
+  coco::Socket s;
+#ifdef SO_BUSY_POLL
+  // up to net.core.busy_read without privileges
+  EXPECT_TRUE(s.set_busy_poll(0));
+#else
+  EXPECT_FALSE(s.set_busy_poll(0));
+#endif
+  s.close();
+}
+
+TEST(TestSocket, TestBufferSize) {
+  coco::Socket s;
+  EXPECT_TRUE(s.set_buffer_size(1 << 16));
+  int bytes = 0;
+  socklen_t len = sizeof(bytes);
+  ASSERT_EQ(getsockopt(s.get_fd(), SOL_SOCKET, SO_RCVBUF, &bytes, &len), 0);
+  // the kernel doubles the size
+  EXPECT_GE(bytes, 1 << 16);
+  s.close();
+}
+
+TEST(TestSocket, TestIncomingCpu) {
+  const int incoming_port = port + 1;
+  std::thread sender([]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    coco::Socket s;
+    ASSERT_EQ(s.connect("127.0.0.1", incoming_port), 0);
+    s.write_number(42);
+    s.close();
+  });
+
+  coco::Listener l("127.0.0.1", incoming_port, 1);
+  coco::Socket s = l.accept();
+  int n;
+  s.set_quick_ack_flag(true);
+  s.read_number(n);
+  EXPECT_EQ(n, 42);
+  // the cpu is known once a packet arrived
+#ifdef SO_INCOMING_CPU
+  EXPECT_GE(s.incoming_cpu(), 0);
+#else
+  EXPECT_EQ(s.incoming_cpu(), -1);
+#endif
+  sender.join();
+  s.close();
+  l.close();
+}
@@ -12,4 +12,35 @@ TEST(TestZipf, TestBasic) {
   std::this_thread::sleep_for(std::chrono::milliseconds(1));
   auto now2 = coco::Time::now();
   EXPECT_LE(now2 - now1, 1000000 * 1.5);
-}
\ No newline at end of file
+}
+
+TEST(TestTime, TestClock) {
+  auto now1 = coco::Clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  auto now2 = coco::Clock::now();
+  auto elapsed =
+      std::chrono::duration_cast<std::chrono::microseconds>(now2 - now1)
+          .count();
+  EXPECT_GE(elapsed, 9000);
+  EXPECT_LE(elapsed, 15000);
+}
+
+TEST(TestTime, TestDrift) {
+  // Clock stays close to steady_clock over 4 s, whether it is read often or
+  // not, a drift of 100 us per second would show up by the end
+  auto steady_start = std::chrono::steady_clock::now();
+  auto clock_start = coco::Clock::now();
+  auto last = clock_start;
+  for (auto i = 0; i < 12; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1 << i));
+    auto clock = coco::Clock::now() - clock_start;
+    auto steady = std::chrono::steady_clock::now() - steady_start;
+    EXPECT_LE(std::abs(std::chrono::duration_cast<std::chrono::microseconds>(
+                           clock - steady)
+                           .count()),
+              20);
+    auto now = coco::Clock::now();
+    EXPECT_GE(now, last);
+    last = now;
+  }
+}
@@ -28,4 +28,33 @@ TEST(TestZipf, TestBasic) {
 
   EXPECT_GE(1.0 * percentile[0] / M, 0.7);
   EXPECT_LE(1.0 * percentile[0] / M, 0.75);
-}
\ No newline at end of file
+}
+TEST(TestZipf, TestZeta) {
+
+  constexpr int N = 3 * coco::Zipf::EXACT_ZETA_LIMIT;
+  for (auto theta : {0.5, 0.9, 0.99}) {
+    double sum = 0;
+    for (auto i = 1; i <= N; i++) {
+      sum += std::pow(1.0 / i, theta);
+    }
+    // the tail beyond EXACT_ZETA_LIMIT is approximated
+    EXPECT_NEAR(coco::Zipf::zeta(N, theta), sum, sum * 1e-12);
+  }
+  EXPECT_DOUBLE_EQ(coco::Zipf::zeta(2, 0.5), 1 + std::pow(0.5, 0.5));
+}
+
+TEST(TestZipf, TestLargeKeySpace) {
+
+  // keys beyond 32 bits are drawn too
+  constexpr uint64_t N = 1ull << 33;
+  coco::Zipf z;
+  z.init(N, 0.99);
+  coco::Random random;
+  uint64_t max = 0;
+  for (auto i = 0; i < 10000; i++) {
+    auto k = z.value(random.next_double());
+    EXPECT_LT(k, N);
+    max = std::max(max, k);
+  }
+  EXPECT_GT(max, 1ull << 32);
+}
@@ -0,0 +1,84 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/AccessTrace.h"
+#include "protocol/Silo/SiloRWKey.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+struct TestDatabase {
+  coco::ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    return tables[partition_id];
+  }
+  std::vector<coco::ITable *> tables;
+};
+
+struct TestTransaction {
+  std::vector<coco::SiloRWKey> readSet, writeSet;
+};
+} // namespace
+
+TEST(TestAccessTrace, TestTrace) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+
+  auto table_id = ycsb::ycsb::tableID;
+  Table<7, key_type, value_type> table0(table_id, 0), table1(table_id, 1);
+  TestDatabase db;
+  db.tables = {&table0, &table1};
+
+  // reads key 1 of partition 0 and 1, writes the latter
+  key_type key(1);
+  value_type value;
+  TestTransaction txn;
+  for (auto partition_id = 0u; partition_id < 2; partition_id++) {
+    SiloRWKey rwKey;
+    rwKey.set_table_id(table_id);
+    rwKey.set_partition_id(partition_id);
+    rwKey.set_key(&key);
+    rwKey.set_value(&value);
+    txn.readSet.push_back(rwKey);
+    if (partition_id == 1) {
+      txn.writeSet.push_back(rwKey);
+    }
+  }
+
+  // 1 in 2 transactions is traced
+  {
+    AccessTrace trace("/tmp", 3, 5, 2);
+    trace.trace(db, txn, AccessOutcome::ABORT_LOCK);
+    trace.trace(db, txn, AccessOutcome::COMMIT);
+    trace.trace(db, txn, AccessOutcome::COMMIT);
+    trace.close();
+  }
+
+  auto filename = AccessTrace::file_name("/tmp", 3, 5);
+  EXPECT_EQ(filename, "/tmp/3_5.trace");
+  std::vector<AccessTraceRecord> records;
+  ASSERT_TRUE(AccessTrace::read(filename, records));
+  std::remove(filename.c_str());
+
+  ASSERT_EQ(records.size(), 6u);
+  auto hash = AccessTrace::key_hash(&key, sizeof(key));
+  for (auto i = 0u; i < records.size(); i++) {
+    auto &record = records[i];
+    EXPECT_EQ(record.coordinator_id, 3u);
+    EXPECT_EQ(record.worker_id, 5u);
+    EXPECT_EQ(record.transaction_id, i < 3 ? 0u : 2u);
+    EXPECT_EQ(record.table_id, table_id);
+    EXPECT_EQ(record.partition_id, i % 3 == 0 ? 0u : 1u);
+    EXPECT_EQ(record.key_hash, hash);
+    EXPECT_EQ(record.write, i % 3 == 2 ? 1u : 0u);
+    EXPECT_EQ(record.outcome,
+              static_cast<uint8_t>(i < 3 ? AccessOutcome::ABORT_LOCK
+                                         : AccessOutcome::COMMIT));
+  }
+  EXPECT_LE(records[0].timestamp, records[3].timestamp);
+}
@@ -0,0 +1,58 @@
+//
+// Created by Yi Lu on 3/24/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/AdaptiveLocking.h"
+#include <gtest/gtest.h>
+
+TEST(TestAdaptiveLocking, TestHotRows) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<10, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  warehouse::key hot(1), cold(2);
+
+  AdaptiveLocking locking(2);
+  EXPECT_FALSE(locking.is_hot(table, &hot));
+
+  locking.conflict(table, &hot);
+  locking.conflict(table, &cold);
+  EXPECT_FALSE(locking.is_hot(table, &hot));
+
+  locking.conflict(table, &hot);
+  EXPECT_TRUE(locking.is_hot(table, &hot));
+  EXPECT_FALSE(locking.is_hot(table, &cold));
+  EXPECT_EQ(locking.n_hot(), 1u);
+}
+
+TEST(TestAdaptiveLocking, TestThreshold) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<10, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  warehouse::key key(1);
+
+  AdaptiveLocking locking(2);
+  for (auto i = 0; i < 4; i++) {
+    locking.conflict(table, &key);
+  }
+
+  // a window with many aborts locks more rows
+  for (auto i = 0u; i < AdaptiveLocking::WINDOW; i++) {
+    locking.on_transaction(i % 2 == 0);
+  }
+  EXPECT_EQ(locking.get_threshold(), 1u);
+  // the score is halved
+  EXPECT_TRUE(locking.is_hot(table, &key));
+
+  // windows without aborts lock fewer rows, and the row cools down
+  for (auto i = 0u; i < 2 * AdaptiveLocking::WINDOW; i++) {
+    locking.on_transaction(true);
+  }
+  EXPECT_EQ(locking.get_threshold(), 3u);
+  EXPECT_FALSE(locking.is_hot(table, &key));
+  EXPECT_EQ(locking.n_hot(), 0u);
+}
@@ -0,0 +1,47 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "core/AdmissionControl.h"
+#include <gtest/gtest.h>
+
+TEST(TestAdmissionControl, TestDisabled) {
+
+  coco::AdmissionControl admission;
+  admission.init(2, 0, 100);
+  EXPECT_FALSE(admission.enabled());
+}
+
+TEST(TestAdmissionControl, TestStandingDelay) {
+
+  // a target of 10 us, an interval of 100 us
+  coco::AdmissionControl admission;
+  admission.init(2, 10, 100);
+  EXPECT_TRUE(admission.enabled());
+
+  // a burst above the target shorter than the interval
+  admission.on_pop(0, 50, 1000);
+  admission.on_pop(0, 50, 1050);
+  EXPECT_FALSE(admission.overloaded(0));
+  admission.on_pop(0, 5, 1090);
+  admission.on_pop(0, 50, 1150);
+  EXPECT_FALSE(admission.overloaded(0));
+
+  // above the target for the interval
+  admission.on_pop(0, 50, 1250);
+  EXPECT_TRUE(admission.overloaded(0));
+  EXPECT_FALSE(admission.overloaded(1));
+  admission.on_pop(0, 50, 1300);
+  EXPECT_EQ(admission.get_n_overloads(), 1u);
+
+  // the queue drains
+  admission.on_pop(0, 5, 1310);
+  EXPECT_FALSE(admission.overloaded(0));
+
+  admission.on_pop(1, 50, 2000);
+  admission.on_pop(1, 50, 2100);
+  EXPECT_TRUE(admission.overloaded(1));
+  admission.on_empty(1);
+  EXPECT_FALSE(admission.overloaded(1));
+  EXPECT_EQ(admission.get_n_overloads(), 2u);
+}
@@ -0,0 +1,107 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/ArrowWriter.h"
+#include "core/Table.h"
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+template <class T> T read(const std::string &buffer, std::size_t pos) {
+  T v;
+  std::memcpy(&v, &buffer[pos], sizeof(T));
+  return v;
+}
+
+// the position of field id of the flatbuffer table at pos, 0 if absent
+std::size_t field(const std::string &buffer, std::size_t table, uint16_t id) {
+  auto vtable = table - read<int32_t>(buffer, table);
+  if (read<uint16_t>(buffer, vtable) <= 4 + 2 * id) {
+    return 0;
+  }
+  auto offset = read<uint16_t>(buffer, vtable + 4 + 2 * id);
+  return offset == 0 ? 0 : table + offset;
+}
+
+std::size_t deref(const std::string &buffer, std::size_t pos) {
+  return pos + read<uint32_t>(buffer, pos);
+}
+
+} // namespace
+
+TEST(TestArrowWriter, TestWarehouse) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<997, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  auto columns = table.columns();
+  ASSERT_EQ(columns.size(), std::size_t(1 + warehouse::value::NFIELDS));
+  EXPECT_EQ(columns[0].name, "W_ID");
+  EXPECT_TRUE(columns[0].key);
+  EXPECT_EQ(columns[0].type, FieldType::INT);
+  EXPECT_EQ(columns[1].name, "W_NAME");
+  EXPECT_EQ(columns[1].type, FieldType::STRING);
+  EXPECT_EQ(columns.back().name, "W_YTD");
+  EXPECT_EQ(columns.back().type, FieldType::FLOAT);
+
+  std::string filename = "/tmp/coco_test_warehouse.arrow";
+  std::size_t n = ArrowWriter::BATCH_ROWS + 10;
+  ArrowWriter writer(filename, columns, {{"coco.epoch_boundary", "7"}});
+  for (auto i = 0u; i < n; i++) {
+    warehouse::key key(i);
+    warehouse::value value;
+    value.W_NAME.assign(std::to_string(i));
+    value.W_YTD = i;
+    writer.append(&key, &value);
+  }
+  writer.close();
+  EXPECT_EQ(writer.size(), n);
+
+  std::ifstream in(filename, std::ios::binary);
+  std::string file((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  EXPECT_EQ(file.size(), writer.bytes());
+  EXPECT_EQ(file.substr(0, 6), "ARROW1");
+  EXPECT_EQ(file.substr(file.size() - 6), "ARROW1");
+
+  auto footer_size = read<int32_t>(file, file.size() - 10);
+  auto footer = file.substr(file.size() - 10 - footer_size, footer_size);
+  auto root = deref(footer, 0);
+
+  // the schema has a field per column
+  auto schema = deref(footer, field(footer, root, 1));
+  auto fields = deref(footer, field(footer, schema, 1));
+  EXPECT_EQ(read<uint32_t>(footer, fields), columns.size());
+
+  // two batches, the first one full
+  auto blocks = deref(footer, field(footer, root, 3));
+  ASSERT_EQ(read<uint32_t>(footer, blocks), 2u);
+  auto block_offset = read<int64_t>(footer, blocks + 4);
+  auto metadata_size = read<int32_t>(footer, blocks + 12);
+  EXPECT_EQ(block_offset % 8, 0);
+  EXPECT_EQ(read<uint32_t>(file, block_offset), 0xFFFFFFFF);
+
+  // W_ID is the values buffer of the first column, W_NAME of the second
+  auto body = block_offset + metadata_size;
+  auto message = file.substr(block_offset + 8, metadata_size - 8);
+  auto batch = deref(message, field(message, deref(message, 0), 2));
+  EXPECT_EQ(read<int64_t>(message, field(message, batch, 0)),
+            int64_t(ArrowWriter::BATCH_ROWS));
+  auto buffers = deref(message, field(message, batch, 2));
+  auto ids = body + read<int64_t>(message, buffers + 4 + 16);
+  auto names = body + read<int64_t>(message, buffers + 4 + 48);
+  for (auto i = 0; i < 100; i++) {
+    EXPECT_EQ(read<int32_t>(file, ids + i * sizeof(int32_t)), i);
+    EXPECT_EQ(file.substr(names + i * 10, std::to_string(i).size()),
+              std::to_string(i));
+  }
+
+  std::remove(filename.c_str());
+}
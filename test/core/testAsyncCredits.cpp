@@ -0,0 +1,84 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/AsyncCredits.h"
+#include <gtest/gtest.h>
+
+namespace {
+struct TestTransaction {};
+
+using Handlers = std::vector<std::function<void(
+    coco::MessagePiece, coco::Message &, coco::ITable &, TestTransaction *)>>;
+
+void handle(Handlers &handlers, coco::Message &message,
+            coco::Message &response, coco::ITable &table) {
+  for (auto it = message.begin(); it != message.end(); it++) {
+    auto type = (*it).get_message_type();
+    if (handlers[type]) {
+      handlers[type](*it, response, table, nullptr);
+    }
+  }
+}
+} // namespace
+
+TEST(TestAsyncCredits, TestCredits) {
+
+  using namespace coco;
+
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> table(ycsb::ycsb::tableID, 0);
+
+  // node 0 sends to node 1, which returns the credits to node 0
+  AsyncCredits sender(2, 1000), receiver(2, 1000);
+  Handlers sender_handlers(static_cast<int>(ControlMessage::NFIELDS)),
+      receiver_handlers(static_cast<int>(ControlMessage::NFIELDS));
+  sender.set_message_handlers(sender_handlers);
+  receiver.set_message_handlers(receiver_handlers);
+  EXPECT_TRUE(sender.enabled());
+  EXPECT_FALSE(AsyncCredits(2, 0).enabled());
+
+  auto new_message = [](std::size_t size) {
+    auto message = std::make_unique<Message>();
+    message->set_source_node_id(0);
+    message->set_dest_node_id(1);
+    Encoder encoder(message->data);
+    encoder << MessagePiece::construct_message_piece_header(
+        static_cast<uint32_t>(ControlMessage::SIGNAL),
+        MessagePiece::get_header_size() + size, 0, 0);
+    message->data.append(size, 'x');
+    message->flush();
+    return message;
+  };
+
+  auto m1 = new_message(400), m2 = new_message(400), m3 = new_message(400);
+  EXPECT_TRUE(sender.acquire(*m1, false));
+  EXPECT_EQ(m1->get_message_count(), 2u);
+  EXPECT_TRUE(sender.acquire(*m2, false));
+  EXPECT_LT(sender.get_available(1), 400);
+
+  // m3 waits for the credits of m1, or is sent if forced
+  EXPECT_FALSE(sender.acquire(*m3, false));
+  EXPECT_EQ(m3->get_message_count(), 1u);
+
+  Message response, unused;
+  response.set_source_node_id(1);
+  response.set_dest_node_id(0);
+  handle(receiver_handlers, *m1, response, table);
+  EXPECT_EQ(response.get_message_count(), 1u);
+
+  // the sender handles responses in messages to node 1
+  unused.set_dest_node_id(1);
+  handle(sender_handlers, response, unused, table);
+  EXPECT_EQ(unused.get_message_count(), 0u);
+  EXPECT_TRUE(sender.acquire(*m3, false));
+
+  EXPECT_TRUE(sender.acquire(*new_message(400), true));
+  EXPECT_LT(sender.get_available(1), 0);
+
+  // a message larger than the credits is sent once nothing is in flight
+  AsyncCredits small(2, 100);
+  auto large = new_message(400);
+  EXPECT_TRUE(small.acquire(*large, false));
+  EXPECT_FALSE(small.acquire(*new_message(10), false));
+}
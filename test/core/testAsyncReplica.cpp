@@ -0,0 +1,121 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/AsyncReplica.h"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+
+namespace {
+
+using namespace coco;
+using key_type = ycsb::ycsb::key;
+using value_type = ycsb::ycsb::value;
+
+class TestDatabase {
+public:
+  TestDatabase() {
+    auto table_id = ycsb::ycsb::tableID;
+    for (auto i = 0u; i < 2; i++) {
+      tables.push_back(
+          std::make_unique<Table<7, key_type, value_type>>(table_id, i));
+    }
+  }
+
+  std::vector<ITable *> local_tables(const Partitioner &partitioner) {
+    std::vector<ITable *> result;
+    for (auto &table : tables) {
+      result.push_back(table.get());
+    }
+    return result;
+  }
+
+  std::vector<std::unique_ptr<ITable>> tables;
+};
+
+value_type make_value(const char *s) {
+  value_type v;
+  v.Y_F01.assign(s);
+  return v;
+}
+
+bool has_value(ITable &table, int k, const char *s) {
+  key_type key(k);
+  auto &value = *static_cast<value_type *>(table.search_value(&key));
+  return value.Y_F01 == make_value(s).Y_F01;
+}
+} // namespace
+
+TEST(TestAsyncReplica, TestFrame) {
+
+  TestDatabase db;
+  key_type k1(1);
+  auto v1 = make_value("v1");
+  std::string records, bytes;
+  for (auto i = 0; i < 100; i++) {
+    RedoLog::append_record(records, *db.tables[0], &k1, &v1, i);
+  }
+  ReplicationFrame::encode(bytes, 3, 42, records);
+  ReplicationFrame::encode(bytes, 4, 43, "");
+  // the records of a key compress well
+  EXPECT_LT(bytes.size(), records.size() / 4);
+
+  StringPiece piece(bytes);
+  ReplicationFrame frame;
+  ASSERT_TRUE(ReplicationFrame::decode(piece, frame));
+  EXPECT_EQ(frame.epoch, 3u);
+  EXPECT_EQ(frame.time, 42u);
+  EXPECT_EQ(frame.records, records);
+  ASSERT_TRUE(ReplicationFrame::decode(piece, frame));
+  EXPECT_EQ(frame.epoch, 4u);
+  EXPECT_TRUE(frame.records.empty());
+  EXPECT_FALSE(ReplicationFrame::decode(piece, frame));
+}
+
+TEST(TestAsyncReplica, TestReplicate) {
+
+  Context context;
+  context.partitioner = "hash";
+  context.coordinator_num = 1;
+  context.worker_num = 2;
+
+  TestDatabase primary, replica;
+  key_type k1(1), k2(2);
+  auto v1 = make_value("v1"), v2 = make_value("v2"), v3 = make_value("v3");
+
+  // coordinator 0 writes k1 in epoch 0 and 1, coordinator 1 writes k2 in
+  // epoch 0 and 2, which coordinator 0 never ships
+  std::string e0, e1, e2, bytes0, bytes1;
+  RedoLog::append_record(e0, *primary.tables[0], &k1, &v1, 5);
+  RedoLog::append_record(e1, *primary.tables[0], &k1, &v2, 8);
+  ReplicationFrame::encode(bytes0, 0, 1, e0);
+  ReplicationFrame::encode(bytes0, 1, 1, e1);
+  e0.clear();
+  RedoLog::append_record(e0, *primary.tables[1], &k2, &v2, 6);
+  // an older write of k1, shipped after the newer one
+  RedoLog::append_record(e1, *primary.tables[0], &k1, &v1, 7);
+  RedoLog::append_record(e2, *primary.tables[1], &k2, &v3, 9);
+  ReplicationFrame::encode(bytes1, 0, 1, e0);
+  ReplicationFrame::encode(bytes1, 1, 1, e1);
+  ReplicationFrame::encode(bytes1, 2, 1, e2);
+
+  std::vector<Socket> sources;
+  for (auto bytes : {&bytes0, &bytes1}) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    Socket out(fds[0]);
+    out.write_n_bytes(bytes->data(), bytes->size());
+    out.close();
+    sources.emplace_back(fds[1]);
+  }
+
+  AsyncReplica<TestDatabase> async_replica(replica, context);
+  async_replica.replicate(sources);
+
+  EXPECT_EQ(async_replica.applied_epochs(), 2u);
+  EXPECT_TRUE(has_value(*replica.tables[0], 1, "v2"));
+  EXPECT_EQ(replica.tables[0]->search_metadata(&k1).load(), 8u);
+  EXPECT_TRUE(has_value(*replica.tables[1], 2, "v2"));
+  EXPECT_EQ(replica.tables[1]->search_metadata(&k2).load(), 6u);
+}
@@ -0,0 +1,44 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/BarrierTree.h"
+#include <gtest/gtest.h>
+
+TEST(TestBarrierTree, TestTree) {
+
+  using namespace coco;
+
+  BarrierTree root(0, 10, 3);
+  EXPECT_TRUE(root.is_root());
+  EXPECT_EQ(root.parent(), 0u);
+  EXPECT_EQ(root.children(), std::vector<std::size_t>({1, 2, 3}));
+
+  BarrierTree inner(2, 10, 3);
+  EXPECT_FALSE(inner.is_root());
+  EXPECT_EQ(inner.parent(), 0u);
+  EXPECT_EQ(inner.children(), std::vector<std::size_t>({7, 8, 9}));
+
+  BarrierTree last(3, 10, 3);
+  EXPECT_EQ(last.children(), std::vector<std::size_t>());
+  EXPECT_EQ(BarrierTree(9, 10, 3).parent(), 2u);
+
+  // every coordinator is the child of one other
+  std::vector<int> parents(32, 0);
+  for (auto i = 0u; i < parents.size(); i++) {
+    BarrierTree tree(i, parents.size(), 4);
+    for (auto child : tree.children()) {
+      EXPECT_EQ(BarrierTree(child, parents.size(), 4).parent(), i);
+      parents[child]++;
+    }
+  }
+  for (auto i = 1u; i < parents.size(); i++) {
+    EXPECT_EQ(parents[i], 1);
+  }
+
+  EXPECT_EQ(BarrierTree::height(1, 4), 0u);
+  EXPECT_EQ(BarrierTree::height(5, 4), 1u);
+  EXPECT_EQ(BarrierTree::height(6, 4), 2u);
+  EXPECT_EQ(BarrierTree::height(32, 4), 3u);
+  EXPECT_EQ(BarrierTree::height(3, 1), 2u);
+}
@@ -0,0 +1,76 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/BatchValidation.h"
+#include "protocol/Silo/SiloRWKey.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+using namespace coco;
+using key_type = ycsb::ycsb::key;
+using value_type = ycsb::ycsb::value;
+
+class TestDatabase {
+public:
+  TestDatabase() {
+    for (auto i = 0u; i < 2; i++) {
+      tables.push_back(std::make_unique<Table<7, key_type, value_type>>(0, i));
+      for (auto k = 0; k < 100; k++) {
+        key_type key(k);
+        value_type value;
+        tables[i]->insert(&key, &value);
+        tables[i]->search_metadata(&key).store(k + 1);
+      }
+    }
+  }
+
+  ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    return tables[partition_id].get();
+  }
+
+  std::vector<std::unique_ptr<ITable>> tables;
+};
+} // namespace
+
+TEST(TestBatchValidation, TestValidate) {
+
+  // 40 reads of partition 0, then 20 of partition 1, then 10 of partition 0
+  TestDatabase db;
+  std::vector<key_type> keys;
+  std::vector<SiloRWKey> reads(70);
+  for (auto i = 0u; i < reads.size(); i++) {
+    keys.emplace_back(i % 50);
+  }
+  for (auto i = 0u; i < reads.size(); i++) {
+    reads[i].set_partition_id(i >= 40 && i < 60);
+    reads[i].set_key(&keys[i]);
+    reads[i].set_tid(i % 50 + 1);
+  }
+
+  // the odd reads are remote, the rest are checked in order
+  std::vector<std::size_t> checked;
+  auto is_local = [](std::size_t i) { return i % 2 == 0; };
+  auto check = [&](std::size_t i, std::atomic<uint64_t> &tid) {
+    checked.push_back(i);
+    return tid.load() == reads[i].get_tid();
+  };
+  EXPECT_EQ(BatchValidation::validate(db, reads, is_local, check), -1);
+  EXPECT_EQ(checked.size(), 35u);
+  for (auto i = 0u; i < checked.size(); i++) {
+    EXPECT_EQ(checked[i], 2 * i);
+  }
+
+  // the first conflict is returned
+  reads[44].set_tid(0);
+  reads[66].set_tid(0);
+  checked.clear();
+  EXPECT_EQ(BatchValidation::validate(db, reads, is_local, check), 44);
+  EXPECT_EQ(checked.back(), 44u);
+
+  reads[44].set_tid(45);
+  reads[45].set_tid(0);
+  EXPECT_EQ(BatchValidation::validate(db, reads, is_local, check), 66);
+}
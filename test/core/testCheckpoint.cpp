@@ -0,0 +1,63 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/Checkpoint.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestCheckpoint, TestFuzzy) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+
+  auto table_id = ycsb::ycsb::tableID;
+  Table<7, key_type, value_type> table(table_id, 0), loaded(table_id, 0);
+
+  for (auto i = 0; i < 100; i++) {
+    key_type key(i);
+    value_type value;
+    value.Y_F01.assign(std::to_string(i));
+    table.insert(&key, &value);
+    table.search_metadata(&key).store(i);
+  }
+
+  // a locked row is written once it is unlocked, without the lock bit and
+  // the read timestamp delta
+  key_type locked_key(42);
+  auto &tid = table.search_metadata(&locked_key);
+  tid.store(Checkpoint::LOCK_BIT | (3ull << 48) | 41);
+  std::thread writer([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    value_type value;
+    value.Y_F01.assign("updated");
+    table.update(&locked_key, &value);
+    tid.store((3ull << 48) | 43);
+  });
+
+  std::string filename = "/tmp/coco_test_checkpoint.ckpt";
+  RateLimiter limiter(1024 * 1024);
+  Checkpoint::write(table, filename, 5, &limiter);
+  writer.join();
+  EXPECT_GT(limiter.total_bytes(), 0u);
+
+  uint64_t epoch = 0;
+  EXPECT_TRUE(Checkpoint::load(loaded, filename, epoch));
+  EXPECT_EQ(epoch, 5u);
+
+  for (auto i = 0; i < 100; i++) {
+    key_type key(i);
+    auto &value = *static_cast<value_type *>(loaded.search_value(&key));
+    if (i == 42) {
+      EXPECT_EQ(loaded.search_metadata(&key).load(), 43u);
+      EXPECT_EQ(value.Y_F01, FixedString<ycsb::YCSB_FIELD_SIZE>("updated"));
+    } else {
+      EXPECT_EQ(loaded.search_metadata(&key).load(), uint64_t(i));
+      EXPECT_EQ(value.Y_F01,
+                FixedString<ycsb::YCSB_FIELD_SIZE>(std::to_string(i)));
+    }
+  }
+  unlink(filename.c_str());
+}
@@ -0,0 +1,57 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/group_commit/ClockEpochs.h"
+#include <gtest/gtest.h>
+
+TEST(TestClockEpochs, TestTimeline) {
+
+  // 10 ms epochs, clocks within 100 us
+  coco::group_commit::ClockEpochs epochs(0, 3, 10000, 100);
+
+  // the first epoch is the next whole one
+  EXPECT_EQ(epochs.next_epoch(25000), 3u);
+  EXPECT_EQ(epochs.start_time(3), 30100u);
+  EXPECT_EQ(epochs.end_time(3), 40000u);
+  epochs.seal(3);
+
+  // stopped in time, the next epoch starts after the skew
+  EXPECT_EQ(epochs.next_epoch(40050), 4u);
+  epochs.seal(4);
+
+  // overran epoch 5, skips to 6
+  EXPECT_EQ(epochs.next_epoch(61000), 6u);
+  EXPECT_EQ(epochs.get_skipped(), 1u);
+  EXPECT_EQ(epochs.get_groups(), 2u);
+}
+
+TEST(TestClockEpochs, TestRelease) {
+
+  coco::group_commit::ClockEpochs epochs(1, 3, 10000, 100);
+
+  epochs.seal(3);
+  epochs.seal(4);
+  EXPECT_EQ(epochs.release(), 0u);
+
+  epochs.seal(0, 3);
+  EXPECT_EQ(epochs.release(), 0u);
+
+  // a coordinator that skipped epochs seals the later one
+  epochs.seal(2, 5);
+  EXPECT_EQ(epochs.watermark(), 3u);
+  EXPECT_EQ(epochs.release(), 1u);
+
+  // seals arrive in order, an old one does not go back
+  epochs.seal(0, 4);
+  epochs.seal(2, 4);
+  EXPECT_EQ(epochs.release(), 2u);
+
+  epochs.seal(6);
+  epochs.done();
+  EXPECT_FALSE(epochs.all_done());
+  epochs.seal(0, coco::group_commit::ClockEpochs::DONE);
+  epochs.seal(2, coco::group_commit::ClockEpochs::DONE);
+  EXPECT_TRUE(epochs.all_done());
+  EXPECT_EQ(epochs.release(), 3u);
+}
@@ -0,0 +1,56 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/CoAccessGraph.h"
+#include <gtest/gtest.h>
+
+TEST(TestCoAccessGraph, TestPairs) {
+
+  // partitions 2i and 2i + 1 are accessed together, hashing places each pair
+  // apart on 2 parts
+  coco::CoAccessGraph graph;
+  for (auto i = 0; i < 10; i++) {
+    graph.add_transaction({0, 1, 1});
+    graph.add_transaction({3, 2});
+    graph.add_transaction({5, 4});
+    graph.add_transaction({6, 7});
+    graph.add_transaction({4});
+  }
+  graph.add_transaction({1, 2});
+
+  EXPECT_EQ(graph.partition_num(), 8u);
+  EXPECT_EQ(graph.transaction_num(), 51u);
+  EXPECT_EQ(graph.distributed_num(), 41u);
+  EXPECT_EQ(graph.weight(0, 1), 10u);
+  EXPECT_EQ(graph.weight(2, 1), 1u);
+  EXPECT_EQ(graph.weight(0, 2), 0u);
+  EXPECT_EQ(graph.cut({0, 1, 0, 1, 0, 1, 0, 1}), 41u);
+
+  auto parts = graph.partition(2);
+  ASSERT_EQ(parts.size(), 8u);
+  std::size_t on_first = 0;
+  for (auto i = 0u; i < parts.size(); i += 2) {
+    EXPECT_EQ(parts[i], parts[i + 1]);
+    on_first += parts[i] == 0;
+  }
+  EXPECT_EQ(on_first, 2u);
+  EXPECT_LE(graph.cut(parts), 1u);
+}
+
+TEST(TestCoAccessGraph, TestBalance) {
+
+  // a clique of 4 partitions on 2 parts is cut in half
+  coco::CoAccessGraph graph;
+  graph.add_transaction({0, 1, 2, 3});
+  auto parts = graph.partition(2);
+  std::size_t sizes[2] = {};
+  for (auto part : parts) {
+    sizes[part]++;
+  }
+  EXPECT_EQ(sizes[0], 2u);
+  EXPECT_EQ(sizes[1], 2u);
+  EXPECT_EQ(graph.cut(parts), 4u);
+
+  EXPECT_EQ(graph.partition(1), std::vector<std::size_t>(4, 0));
+}
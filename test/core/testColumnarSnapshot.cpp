@@ -0,0 +1,77 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/ColumnarSnapshot.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestColumnarSnapshot, TestStock) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<997, stock::key, stock::value> table(stock::tableID, 0),
+      other(item::tableID, 0);
+
+  EXPECT_EQ(table.field_count(), std::size_t(stock::value::NFIELDS));
+  EXPECT_EQ(table.field_length(stock::value::S_QUANTITY_field),
+            sizeof(int16_t));
+
+  for (auto i = 0; i < 100; i++) {
+    stock::key key(1, i);
+    stock::value value;
+    value.S_QUANTITY = i;
+    value.S_ORDER_CNT = 1;
+    table.insert(&key, &value);
+  }
+
+  Snapshot snapshot;
+  snapshot.set_tables({&table, &other});
+
+  std::atomic<bool> stopFlag(false), done(false);
+  std::thread manager([&]() {
+    while (!done.load()) {
+      snapshot.on_epoch_boundary();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  auto boundary = snapshot.pin(stopFlag);
+  done.store(true);
+  manager.join();
+
+  // the columns keep the values at the pin
+  for (auto i = 0; i < 10; i++) {
+    stock::key key(1, i);
+    stock::value value;
+    value.S_QUANTITY = 100;
+    value.S_ORDER_CNT = 2;
+    table.update(&key, &value);
+  }
+
+  auto columnar = ColumnarSnapshot::build(snapshot, {stock::tableID}, boundary);
+  snapshot.unpin();
+
+  EXPECT_EQ(columnar->get_boundary(), boundary);
+  EXPECT_EQ(columnar->get_tables().size(), 1u);
+  EXPECT_EQ(columnar->find_table(item::tableID, 0), nullptr);
+
+  auto columns = columnar->find_table(stock::tableID, 0);
+  ASSERT_NE(columns, nullptr);
+  EXPECT_EQ(columns->size(), 100u);
+  EXPECT_EQ(columns->count_if<int16_t>(stock::value::S_QUANTITY_field,
+                                       [](int16_t q) { return q < 20; }),
+            20u);
+  EXPECT_EQ(columns->sum<int32_t>(stock::value::S_ORDER_CNT_field), 100);
+
+  auto quantities = columns->column<int16_t>(stock::value::S_QUANTITY_field);
+  for (auto row = 0u; row < columns->size(); row++) {
+    auto &key = *static_cast<const stock::key *>(columns->key(row));
+    EXPECT_EQ(quantities[row], key.S_I_ID);
+  }
+
+  EXPECT_EQ(ColumnarSnapshot::latest(0), nullptr);
+  ColumnarSnapshot::publish(0, columnar);
+  EXPECT_EQ(ColumnarSnapshot::latest(0).get(), columnar.get());
+}
@@ -0,0 +1,127 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "core/CommandLog.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+TEST(TestCommandLog, TestReplay) {
+
+  using namespace coco;
+
+  char dir[] = "/tmp/coco_command_log_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+
+  Context context;
+  context.worker_num = 2;
+  context.log_path = dir;
+  context.command_log = true;
+
+  // two batches of 4 transactions, each worker generates every other one,
+  // and worker 0 logs a third batch worker 1 never does
+  std::vector<uint64_t> draws;
+  {
+    std::vector<std::unique_ptr<CommandLog>> logs;
+    std::vector<Random> randoms = {Random(1), Random(2)};
+    for (auto i = 0u; i < 2; i++) {
+      logs.push_back(CommandLog::open(context, 3, i));
+      ASSERT_NE(logs[i], nullptr);
+    }
+    for (auto k = 0u; k < 2; k++) {
+      for (auto &log : logs) {
+        log->begin_batch(4);
+        EXPECT_FALSE(log->is_replaying());
+      }
+      for (auto i = 0u; i < 4; i++) {
+        std::size_t partition_id = i, hot_row = 0;
+        logs[i % 2]->next(i, randoms[i % 2], partition_id, hot_row);
+        draws.push_back(randoms[i % 2].uniform_dist(0, 1000000));
+      }
+      for (auto &log : logs) {
+        log->end_batch();
+        log->sync();
+      }
+    }
+    logs[0]->begin_batch(4);
+    std::size_t partition_id = 0, hot_row = 0;
+    logs[0]->next(0, randoms[0], partition_id, hot_row);
+    logs[0]->end_batch();
+    for (auto &log : logs) {
+      log->close();
+    }
+  }
+
+  std::vector<CommandLog::Batch> batches;
+  ASSERT_TRUE(CommandLog::read(CommandLog::file_name(dir, 3, 0), batches));
+  EXPECT_EQ(batches.size(), 3u);
+  EXPECT_EQ(batches[1].entries.size(), 2u);
+
+  // a worker replays any transaction of the batch, then runs fresh ones
+  EXPECT_EQ(CommandLog::load(context, 3), 2u);
+  auto log = CommandLog::open(context, 3, 1);
+  Random other(7);
+  for (auto k = 0u; k < 2; k++) {
+    log->begin_batch(4);
+    EXPECT_TRUE(log->is_replaying());
+    for (auto i = 0u; i < 4; i++) {
+      std::size_t partition_id = 0, hot_row = 0;
+      log->next(i, other, partition_id, hot_row);
+      EXPECT_EQ(partition_id, i);
+      EXPECT_EQ(other.uniform_dist(0, 1000000), draws[k * 4 + i]);
+    }
+    log->end_batch();
+  }
+  log->begin_batch(4);
+  EXPECT_FALSE(log->is_replaying());
+  log->close();
+
+  for (auto i = 0u; i < 2; i++) {
+    std::remove(CommandLog::file_name(dir, 3, i).c_str());
+  }
+  rmdir(dir);
+}
+
+TEST(TestCommandLog, TestTornBatch) {
+
+  using namespace coco;
+
+  char dir[] = "/tmp/coco_command_log_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+
+  Context context;
+  context.log_path = dir;
+  context.command_log = true;
+
+  auto log = CommandLog::open(context, 0, 0);
+  Random random(1);
+  for (auto k = 0u; k < 2; k++) {
+    log->begin_batch(2);
+    for (auto i = 0u; i < 2; i++) {
+      std::size_t partition_id = i, hot_row = 0;
+      log->next(i, random, partition_id, hot_row);
+    }
+    log->end_batch();
+  }
+  log->close();
+
+  // the last entry of the second batch is cut short
+  auto file_name = CommandLog::file_name(dir, 0, 0);
+  ASSERT_EQ(truncate(file_name.c_str(), log->get_bytes() - 1), 0);
+
+  std::vector<CommandLog::Batch> batches;
+  ASSERT_TRUE(CommandLog::read(file_name, batches));
+  ASSERT_EQ(batches.size(), 1u);
+  EXPECT_EQ(batches[0].batch_size, 2u);
+  EXPECT_EQ(batches[0].entries.size(), 2u);
+
+  std::remove(file_name.c_str());
+  rmdir(dir);
+}
+
+TEST(TestCommandLog, TestDisabled) {
+
+  coco::Context context;
+  EXPECT_EQ(coco::CommandLog::open(context, 0, 0), nullptr);
+}
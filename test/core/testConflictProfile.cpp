@@ -0,0 +1,62 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/ConflictProfile.h"
+#include <gtest/gtest.h>
+
+TEST(TestConflictProfile, TestMerge) {
+
+  coco::HotKeySketch a(2), b(2);
+  for (auto i = 0; i < 10; i++) {
+    a.add("x", false);
+    b.add(i % 2 == 0 ? "x" : "y", false);
+  }
+  a.add("z", false);
+
+  a.merge(b);
+  EXPECT_EQ(a.total_num(), 21u);
+  auto top = a.top(2);
+  ASSERT_EQ(top.size(), 2u);
+  EXPECT_EQ(top[0].key, "x");
+  EXPECT_EQ(top[0].count, 15u);
+  EXPECT_EQ(top[1].key, "y");
+  EXPECT_EQ(a.top(1).size(), 1u);
+
+  a.clear();
+  EXPECT_EQ(a.total_num(), 0u);
+  EXPECT_TRUE(a.top(2).empty());
+}
+
+TEST(TestConflictProfile, TestCollect) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+
+  Table<7, key_type, value_type> table(ycsb::ycsb::tableID, 3);
+  key_type hot(42), cold(7);
+
+  ConflictProfile worker, coordinator;
+  for (auto i = 0; i < 3; i++) {
+    worker.record(table, &hot, true);
+  }
+  worker.record(table, &cold, false);
+
+  worker.collect(coordinator);
+  worker.record(table, &hot, true);
+  worker.collect(coordinator);
+  EXPECT_EQ(worker.lock_conflicts().total_num(), 0u);
+
+  auto locks = coordinator.lock_conflicts().top(ConflictProfile::TOP);
+  ASSERT_EQ(locks.size(), 1u);
+  EXPECT_EQ(locks[0].key, ConflictProfile::key_of(table, &hot));
+  EXPECT_EQ(locks[0].count, 4u);
+  EXPECT_EQ(coordinator.validation_conflicts().total_num(), 1u);
+
+  auto name = ConflictProfile::to_string(locks[0].key);
+  EXPECT_EQ(name.find("table 0 partition 3 key 0x"), 0u);
+  EXPECT_EQ(name.size(), std::string("table 0 partition 3 key 0x").size() +
+                             sizeof(key_type) * 2);
+}
@@ -0,0 +1,57 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/ConflictRouter.h"
+#include <gtest/gtest.h>
+#include <set>
+
+TEST(TestConflictRouter, TestRows) {
+
+  // partitions 1 and 3 of 4 on coordinator 1 of 2, with 10 hot rows each
+  coco::HashReplicatedPartitioner<1> partitioner(1, 2);
+  std::set<std::pair<std::size_t, std::size_t>> rows;
+  std::size_t n_rows = 0;
+  for (auto i = 0u; i < 3; i++) {
+    coco::ConflictRouter router(i, 3, 4, 10, 100, partitioner);
+    for (auto &row : router.get_rows()) {
+      EXPECT_TRUE(row.first == 1 || row.first == 3);
+      EXPECT_TRUE(row.second >= 1 && row.second <= 10);
+      rows.insert(row);
+    }
+    n_rows += router.get_rows().size();
+  }
+  EXPECT_EQ(n_rows, 20u);
+  EXPECT_EQ(rows.size(), 20u);
+}
+
+TEST(TestConflictRouter, TestRoute) {
+
+  coco::HashReplicatedPartitioner<1> partitioner(0, 1);
+  coco::Random random(42);
+  std::size_t partition_id, row;
+
+  coco::ConflictRouter router(1, 2, 2, 4, 100, partitioner);
+  std::set<std::pair<std::size_t, std::size_t>> own(
+      router.get_rows().begin(), router.get_rows().end());
+  for (auto i = 0; i < 100; i++) {
+    ASSERT_TRUE(router.route(random, partition_id, row));
+    EXPECT_EQ(own.count({partition_id, row}), 1u);
+  }
+  EXPECT_EQ(router.routed(), 100u);
+
+  coco::ConflictRouter none(1, 2, 2, 4, 0, partitioner);
+  EXPECT_FALSE(none.route(random, partition_id, row));
+
+  // no hot rows are declared, e.g., by YCSB
+  coco::ConflictRouter ycsb(1, 2, 2, 0, 100, partitioner);
+  EXPECT_FALSE(ycsb.route(random, partition_id, row));
+
+  coco::ConflictRouter half(1, 2, 2, 4, 50, partitioner);
+  std::size_t n = 0;
+  for (auto i = 0; i < 1000; i++) {
+    n += half.route(random, partition_id, row);
+  }
+  EXPECT_GT(n, 400u);
+  EXPECT_LT(n, 600u);
+}
@@ -0,0 +1,89 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "benchmark/ycsb/Schema.h"
+#include "core/DatabaseImage.h"
+#include <cstdio>
+#include <gtest/gtest.h>
+
+TEST(TestDatabaseImage, TestDumpLoad) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+
+  auto table_id = ycsb::ycsb::tableID;
+  Table<7, key_type, value_type> table(table_id, 3), loaded(table_id, 3);
+  MVCCTable<7, key_type, value_type> mvcc_loaded(table_id, 3);
+
+  for (auto i = 0; i < 1000; i++) {
+    key_type key(i);
+    value_type value;
+    value.Y_F01.assign(std::to_string(i));
+    value.Y_F10.assign(std::to_string(2 * i));
+    table.insert(&key, &value);
+    table.search_metadata(&key).store(i);
+  }
+
+  auto filename = DatabaseImage::file_name("/tmp", table_id, 3);
+  EXPECT_EQ(filename, "/tmp/" + std::to_string(table_id) + "_3.img");
+  std::remove(filename.c_str());
+  EXPECT_FALSE(DatabaseImage::load(loaded, filename));
+
+  std::vector<ITable *> tables = {&table};
+  DatabaseImage::dump_all(tables, "/tmp", 2, nullptr);
+
+  tables = {&loaded};
+  DatabaseImage::load_all(tables, "/tmp", 2, nullptr);
+  EXPECT_TRUE(DatabaseImage::load(mvcc_loaded, filename));
+  std::remove(filename.c_str());
+
+  for (auto i = 0; i < 1000; i++) {
+    key_type key(i);
+    for (ITable *t : {(ITable *)&loaded, (ITable *)&mvcc_loaded}) {
+      auto &value = *static_cast<value_type *>(t->search_value(&key));
+      EXPECT_EQ(value.Y_F01, std::to_string(i));
+      EXPECT_EQ(value.Y_F10, std::to_string(2 * i));
+      // the metadata is not kept
+      EXPECT_EQ(t->search_metadata(&key).load(), 0u);
+    }
+  }
+  int rows = 0;
+  loaded.for_each_row([&](const void *, ITable::MetaDataType &, void *) {
+    rows++;
+  });
+  EXPECT_EQ(rows, 1000);
+}
+
+TEST(TestDatabaseImage, TestOrderedTable) {
+
+  using namespace coco;
+  using key_type = tpcc::order_line::key;
+  using value_type = tpcc::order_line::value;
+
+  auto table_id = tpcc::order_line::tableID;
+  OrderedTable<key_type, value_type> table(table_id, 0), loaded(table_id, 0);
+  for (auto i = 1; i <= 100; i++) {
+    key_type key(1, 1, i, 1);
+    value_type value;
+    value.OL_AMOUNT = i;
+    table.insert(&key, &value);
+  }
+
+  auto filename = DatabaseImage::file_name("/tmp", table_id, 0);
+  DatabaseImage::dump(table, filename);
+  EXPECT_TRUE(DatabaseImage::load(loaded, filename));
+  std::remove(filename.c_str());
+
+  // the rows are in key order
+  key_type start(1, 1, 1, 1), end(1, 1, 101, 1);
+  int i = 0;
+  loaded.scan(&start, &end, [&](const void *, ITable::MetaDataType &,
+                                void *value) {
+    EXPECT_EQ(static_cast<value_type *>(value)->OL_AMOUNT, ++i);
+    return true;
+  });
+  EXPECT_EQ(i, 100);
+}
@@ -0,0 +1,70 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/Delay.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestDelay, TestLinkDelay) {
+
+  coco::LinkDelay delay(1, 3, 0, "0,100,200;100,0,50;200,50,0", "", 0);
+  EXPECT_TRUE(delay.delay_enabled());
+  EXPECT_EQ(delay.message_delay(0), 100);
+  EXPECT_EQ(delay.message_delay(2), 50);
+
+  coco::LinkDelay same(0, 2, 10, "", "", 0);
+  EXPECT_EQ(same.message_delay(1), 10);
+
+  // the tail is 20 us on average, and no delay is negative
+  coco::LinkDelay pareto(0, 2, 0, "", "pareto:20", 0),
+      normal(0, 2, 5, "", "normal:20", 0);
+  double sum = 0;
+  for (auto i = 0; i < 100000; i++) {
+    auto d = pareto.message_delay(1);
+    EXPECT_GE(d, 0);
+    sum += d;
+    EXPECT_GE(normal.message_delay(1), 0);
+  }
+  EXPECT_NEAR(sum / 100000, 20, 2);
+
+  coco::Context context;
+  context.coordinator_num = 2;
+  auto same_delay = coco::DelayFactory::create_delay(0, context, 0);
+  EXPECT_FALSE(same_delay->delay_enabled());
+}
+
+TEST(TestDelay, TestDelayLine) {
+
+  using clock = coco::Clock;
+
+  coco::DelayLine<int> line(
+      std::make_unique<coco::LinkDelay>(0, 3, 0, "0,100000,0;0,0,0;0,0,0", "",
+                                        0),
+      3, 0);
+  EXPECT_TRUE(line.enabled());
+
+  // a message held back does not hold back the ones to the other nodes
+  auto now = clock::now();
+  line.push(1, 1, 100, now);
+  line.push(2, 2, 100, now);
+  line.push(2, 3, 100, now);
+  std::vector<int> released;
+  auto release = [&released](std::size_t, int i) { released.push_back(i); };
+  EXPECT_EQ(line.release(release), 2u);
+  EXPECT_EQ(released, std::vector<int>({2, 3}));
+  EXPECT_FALSE(line.empty());
+
+  // 1 MB/s, i.e., 2 ms for 2000 bytes, and in the order they were sent
+  coco::DelayLine<int> slow(std::make_unique<coco::SameDelay>(0, 2, 0), 2, 1);
+  EXPECT_TRUE(slow.enabled());
+  now = clock::now();
+  slow.push(1, 4, 2000, now);
+  slow.push(1, 5, 1, now);
+  released.clear();
+  EXPECT_EQ(slow.release(release), 0u);
+  std::this_thread::sleep_for(std::chrono::milliseconds(3));
+  EXPECT_EQ(slow.release(release), 2u);
+  EXPECT_EQ(released, std::vector<int>({4, 5}));
+  EXPECT_TRUE(slow.empty());
+}
@@ -0,0 +1,74 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Encoder.h"
+#include "core/DirectConnections.h"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <thread>
+
+namespace {
+
+// coordinator id sends n messages to the other one while receiving its n
+void send_and_receive(coco::DirectConnections &connections, std::size_t id,
+                      std::size_t n, std::size_t size) {
+  std::size_t sent = 0, received = 0;
+  auto alloc = [](uint64_t worker_id) { return new coco::Message(); };
+  auto push = [&received, id](coco::Message *message) {
+    std::unique_ptr<coco::Message> ptr(message);
+    EXPECT_TRUE(ptr->check_size());
+    EXPECT_EQ(ptr->get_source_node_id(), 1 - id);
+    received++;
+  };
+
+  // the sends only go through if the messages of the other side are
+  // received in the meantime
+  for (; sent < n; sent++) {
+    coco::Message message;
+    message.set_source_node_id(id);
+    message.set_dest_node_id(1 - id);
+    coco::Encoder encoder(message.data);
+    encoder << coco::MessagePiece::construct_message_piece_header(
+        1, coco::MessagePiece::get_header_size() + size, 0, 0);
+    message.data.append(size, 'x');
+    message.flush();
+    connections.send(&message, alloc);
+  }
+
+  while (received < n) {
+    connections.receive(alloc, push);
+  }
+}
+} // namespace
+
+TEST(TestDirectConnections, TestSendToEachOther) {
+  int fds[2][2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds[0]), 0);
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds[1]), 0);
+
+  // fds[i][0] sends from coordinator i, fds[i][1] receives on 1 - i
+  std::vector<coco::Socket> in0(2), out0(2), in1(2), out1(2);
+  out0[1] = coco::Socket(fds[0][0]);
+  in1[0] = coco::Socket(fds[0][1]);
+  out1[0] = coco::Socket(fds[1][0]);
+  in0[1] = coco::Socket(fds[1][1]);
+
+  coco::Context context;
+  coco::DirectConnections c0(0, in0, out0, context), c1(1, in1, out1, context);
+
+  // both send much more than a socket buffer before they receive
+  constexpr std::size_t n = 200, size = 64 * 1024;
+  std::thread t([&c1]() { send_and_receive(c1, 1, n, size); });
+  send_and_receive(c0, 0, n, size);
+  t.join();
+
+  EXPECT_GE(c0.get_network_size(), n * size);
+  EXPECT_GE(c1.get_network_size(), n * size);
+
+  for (auto *sockets : {&in0, &out0, &in1, &out1}) {
+    for (auto &socket : *sockets) {
+      socket.close();
+    }
+  }
+}
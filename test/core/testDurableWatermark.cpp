@@ -0,0 +1,36 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "core/group_commit/DurableWatermark.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestDurableWatermark, TestMinimum) {
+
+  coco::group_commit::DurableWatermark durable(3);
+  EXPECT_EQ(durable.get(), 0u);
+
+  // an epoch is durable once every stream has synced it
+  durable.set(0, 2);
+  durable.set(2, 1);
+  EXPECT_EQ(durable.get(), 0u);
+  durable.set(1, 3);
+  EXPECT_EQ(durable.get(), 1u);
+  durable.set(2, 2);
+  EXPECT_EQ(durable.get(), 2u);
+}
+
+TEST(TestDurableWatermark, TestWait) {
+
+  coco::group_commit::DurableWatermark durable(2);
+  durable.set(0, 1);
+
+  std::thread stream([&durable]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    durable.set(1, 1);
+  });
+  durable.wait(1);
+  EXPECT_EQ(durable.get(), 1u);
+  stream.join();
+}
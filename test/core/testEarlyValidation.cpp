@@ -0,0 +1,77 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/EarlyValidation.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+struct RWKey {
+  uint32_t get_table_id() const { return table_id; }
+  uint32_t get_partition_id() const { return partition_id; }
+  const void *get_key() const { return key; }
+  bool get_local_index_read_bit() const { return false; }
+  uint64_t get_tid() const { return tid; }
+
+  uint32_t table_id, partition_id;
+  const void *key;
+  uint64_t tid;
+};
+
+struct Database {
+  coco::ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    return table;
+  }
+  coco::ITable *table;
+};
+
+} // namespace
+
+TEST(TestEarlyValidation, TestHotRows) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<10, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  Database db{&table};
+  std::vector<warehouse::key> keys;
+  for (auto i = 1; i <= 3; i++) {
+    keys.emplace_back(i);
+  }
+  warehouse::value value;
+  for (auto &key : keys) {
+    table.insert(&key, &value);
+  }
+
+  HashPartitioner partitioner(0, 1);
+  std::vector<RWKey> readSet;
+  for (auto &key : keys) {
+    readSet.push_back(RWKey{warehouse::tableID, 0, &key, 0});
+  }
+  auto stale = [](const RWKey &readKey, uint64_t latest_tid) {
+    return latest_tid != readKey.get_tid();
+  };
+
+  // all rows changed, but none is hot
+  for (auto &key : keys) {
+    table.search_metadata(&key).store(1);
+  }
+  EarlyValidation validation(2);
+  EXPECT_EQ(validation.validate(db, partitioner, readSet, stale), -1);
+  EXPECT_EQ(validation.get_checks(), 0u);
+
+  validation.conflict(table, &keys[1]);
+  EXPECT_EQ(validation.validate(db, partitioner, readSet, stale), 1);
+
+  // the last two conflicts are hot
+  validation.conflict(table, &keys[2]);
+  validation.conflict(table, &keys[2]);
+  EXPECT_EQ(validation.n_hot(), 1u);
+  EXPECT_EQ(validation.validate(db, partitioner, readSet, stale), 2);
+  readSet[2].tid = 1;
+  EXPECT_EQ(validation.validate(db, partitioner, readSet, stale), -1);
+  EXPECT_EQ(validation.get_checks(), 3u);
+  EXPECT_EQ(validation.get_aborts(), 2u);
+}
@@ -0,0 +1,87 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "common/Encoder.h"
+#include "core/group_commit/FlushPolicy.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+void append(coco::Message &message, std::size_t bytes) {
+  coco::Encoder encoder(message.data);
+  encoder.write_n_bytes(std::string(bytes, 'x').data(), bytes);
+  message.flush();
+}
+} // namespace
+
+TEST(TestFlushPolicy, TestDisabled) {
+
+  coco::group_commit::FlushPolicy policy(2, 0, 100);
+  EXPECT_FALSE(policy.enabled());
+}
+
+TEST(TestFlushPolicy, TestBytesAndAge) {
+
+  using namespace coco;
+  using group_commit::FlushPolicy;
+
+  FlushPolicy policy(2, 4096, 100);
+  EXPECT_TRUE(policy.enabled());
+  policy.start_group(1000);
+
+  Message message;
+  message.set_dest_node_id(1);
+  append(message, 100);
+  EXPECT_FALSE(policy.ready(message, 1000));
+  EXPECT_FALSE(policy.ready(message, 1050));
+
+  // the first piece is too old
+  EXPECT_TRUE(policy.ready(message, 1100));
+  policy.sent(message);
+
+  // the age starts over with the next message
+  Message next;
+  next.set_dest_node_id(1);
+  append(next, 100);
+  EXPECT_FALSE(policy.ready(next, 1150));
+  append(next, 4096);
+  EXPECT_TRUE(policy.ready(next, 1150));
+}
+
+TEST(TestFlushPolicy, TestAdaptive) {
+
+  using namespace coco;
+  using group_commit::FlushPolicy;
+
+  FlushPolicy policy(3, 65536, 100);
+
+  // groups of 1 ms, node 1 gets 100 KB, node 2 gets 5 KB
+  uint64_t now = 1000;
+  for (auto i = 0; i < 50; i++) {
+    policy.start_group(now);
+    Message m1, m2;
+    m1.set_dest_node_id(1);
+    m2.set_dest_node_id(2);
+    append(m1, 100000);
+    append(m2, 5000);
+    policy.sent(m1);
+    policy.sent(m2);
+    now += 1000;
+    policy.stop_group(now);
+  }
+
+  // a target is the bytes of 100 us of a group
+  EXPECT_NEAR(policy.get_target(1), 10000, 100);
+  auto min_bytes = FlushPolicy::MIN_BYTES;
+  EXPECT_EQ(policy.get_target(2), min_bytes);
+  EXPECT_EQ(policy.get_target(0), min_bytes);
+
+  // everything is sent within an age of the expected stop
+  policy.start_group(now);
+  Message message;
+  message.set_dest_node_id(2);
+  append(message, 10);
+  EXPECT_FALSE(policy.ready(message, now + 850));
+  EXPECT_TRUE(policy.ready(message, now + 900));
+}
@@ -0,0 +1,62 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/group_commit/GroupTimeController.h"
+#include <gtest/gtest.h>
+
+TEST(TestGroupTimeController, TestDisabled) {
+
+  coco::Context context;
+  context.group_time = 10;
+  coco::group_commit::GroupTimeController controller(context);
+  EXPECT_FALSE(controller.enabled());
+  EXPECT_EQ(controller.get_group_time(), 10000u);
+}
+
+TEST(TestGroupTimeController, TestTargetLatency) {
+
+  coco::Context context;
+  context.group_time = 10;
+  context.target_latency = 5000;
+  coco::group_commit::GroupTimeController controller(context);
+  EXPECT_TRUE(controller.enabled());
+
+  // a barrier of 2 ms leaves 3 ms for execution
+  for (auto i = 0; i < 100; i++) {
+    controller.update(controller.get_group_time(), 2000, 100);
+  }
+  EXPECT_NEAR(controller.get_group_time(), 3000, 10);
+
+  // the group time never drops below the minimum
+  for (auto i = 0; i < 100; i++) {
+    controller.update(controller.get_group_time(), 10000, 100);
+  }
+  uint64_t min_group_time =
+      coco::group_commit::GroupTimeController::MIN_GROUP_TIME;
+  EXPECT_EQ(controller.get_group_time(), min_group_time);
+}
+
+TEST(TestGroupTimeController, TestTargetBatchSize) {
+
+  coco::Context context;
+  context.group_time = 10;
+  context.target_batch_size = 1000;
+  coco::group_commit::GroupTimeController controller(context);
+
+  // 1 commit per us, 1000 commits take 1 ms
+  for (auto i = 0; i < 100; i++) {
+    auto group_time = controller.get_group_time();
+    controller.update(group_time, 500, group_time);
+  }
+  EXPECT_NEAR(controller.get_group_time(), 1000, 10);
+
+  // the latency target is kept if both are set
+  context.target_latency = 1200;
+  coco::group_commit::GroupTimeController both(context);
+  for (auto i = 0; i < 100; i++) {
+    auto group_time = both.get_group_time();
+    both.update(group_time, 500, group_time);
+  }
+  EXPECT_NEAR(both.get_group_time(), 700, 10);
+}
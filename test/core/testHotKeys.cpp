@@ -0,0 +1,128 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/HotKeys.h"
+#include "protocol/Silo/SiloHelper.h"
+#include <gtest/gtest.h>
+
+namespace {
+struct NoTransaction {};
+} // namespace
+
+TEST(TestHotKeys, TestSketch) {
+
+  coco::HotKeySketch sketch(8);
+
+  // key 0 is accessed 1 time in 4, the others once each
+  for (auto i = 0; i < 4000; i++) {
+    sketch.add(i % 4 == 0 ? "0" : std::to_string(i), i % 8 == 0);
+  }
+
+  auto counter = sketch.find("0");
+  ASSERT_TRUE(counter != nullptr);
+  EXPECT_GE(counter->count, 1000u);
+  EXPECT_LE(counter->count - counter->error, 1000u);
+  EXPECT_GE(counter->count - counter->error,
+            1000u - sketch.total_num() / 8);
+  EXPECT_GT(counter->writes, 0u);
+  EXPECT_LE(counter->writes, 500u);
+  EXPECT_EQ(sketch.total_num(), 4000u);
+}
+
+TEST(TestHotKeys, TestRecord) {
+
+  coco::HotKeys hot_keys(2);
+
+  // "write" is as hot as "read" but written half the time, "cold" is not hot
+  std::size_t n_hot = 0;
+  std::string hot;
+  for (auto i = 0; i < 4000; i++) {
+    std::string key = i % 4 == 0   ? "read"
+                      : i % 4 == 1 ? "write"
+                                   : "cold" + std::to_string(i);
+    bool write = i % 4 == 1 && i % 8 == 1;
+    if (hot_keys.record(key, write)) {
+      n_hot++;
+      hot = key;
+    }
+  }
+  EXPECT_EQ(n_hot, 1u);
+  EXPECT_EQ(hot, "read");
+
+  // at most 1 hot key
+  coco::HotKeys full(1);
+  n_hot = 0;
+  for (auto i = 0; i < 4000; i++) {
+    n_hot += full.record(i % 2 == 0 ? "a" : "b", false);
+  }
+  EXPECT_EQ(n_hot, 1u);
+}
+
+TEST(TestHotKeys, TestReplicateRow) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+  using HandlerType =
+      std::function<void(MessagePiece, Message &, ITable &, NoTransaction *)>;
+
+  auto table_id = ycsb::ycsb::tableID;
+  Table<7, key_type, value_type> master(table_id, 0), copy(table_id, 0);
+  HashPartitioner partitioner(0, 3);
+
+  key_type key(0);
+  value_type value;
+  value.Y_F01.assign("hot");
+  master.insert(&key, &value);
+  master.search_metadata(&key).store(20);
+
+  std::vector<std::unique_ptr<Message>> messages;
+  for (auto i = 0; i < 3; i++) {
+    messages.emplace_back(std::make_unique<Message>());
+  }
+
+  // a locked row is not sent
+  SiloHelper::lock(master.search_metadata(&key));
+  EXPECT_FALSE(HotKeys::replicate_row<SiloHelper>(master, &key, partitioner,
+                                                  messages));
+  SiloHelper::unlock(master.search_metadata(&key));
+  EXPECT_TRUE(HotKeys::replicate_row<SiloHelper>(master, &key, partitioner,
+                                                 messages));
+  EXPECT_EQ(messages[0]->get_message_count(), 0u);
+  EXPECT_EQ(messages[1]->get_message_count(), 1u);
+  EXPECT_EQ(messages[2]->get_message_count(), 1u);
+
+  HotKeys hot_keys(1);
+  std::vector<HandlerType> handlers(
+      static_cast<int>(ControlMessage::NFIELDS) + 2);
+  HotKeys::set_message_handlers<SiloHelper>(
+      handlers, hot_keys, partitioner, messages,
+      static_cast<int>(ControlMessage::NFIELDS),
+      static_cast<int>(ControlMessage::NFIELDS) + 1);
+
+  EXPECT_FALSE(hot_keys.contains(copy, &key));
+  Message response;
+  for (auto it = messages[1]->begin(); it != messages[1]->end(); it++) {
+    auto type = (*it).get_message_type();
+    EXPECT_EQ(type, static_cast<uint32_t>(ControlMessage::HOT_KEY_REQUEST));
+    handlers[type](*it, response, copy, nullptr);
+  }
+  EXPECT_TRUE(hot_keys.contains(copy, &key));
+  EXPECT_EQ(copy.search_metadata(&key).load(), 20u);
+  auto &copied = *static_cast<value_type *>(copy.search_value(&key));
+  EXPECT_EQ(copied.Y_F01, value.Y_F01);
+
+  // an older copy is not applied
+  value_type old_value;
+  old_value.Y_F01.assign("old");
+  Message old;
+  HotKeys::new_hot_key_message(old, master, &key, &old_value, 10);
+  for (auto it = old.begin(); it != old.end(); it++) {
+    handlers[(*it).get_message_type()](*it, response, copy, nullptr);
+  }
+  EXPECT_EQ(copy.search_metadata(&key).load(), 20u);
+  EXPECT_EQ(copied.Y_F01, value.Y_F01);
+  EXPECT_EQ(response.get_message_count(), 0u);
+}
@@ -0,0 +1,237 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/IngressServer.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace coco;
+
+namespace {
+
+// reads responses from fd until n of them are in, in the order they came
+std::vector<std::pair<uint64_t, IngressStatus>> receive(int fd,
+                                                        std::size_t n) {
+  std::vector<std::pair<uint64_t, IngressStatus>> responses;
+  std::string bytes;
+  char buffer[1024];
+  while (responses.size() < n) {
+    auto k = recv(fd, buffer, sizeof(buffer), 0);
+    if (k <= 0) {
+      break;
+    }
+    bytes.append(buffer, k);
+    StringPiece in(bytes), body;
+    while (IngressFrame::next(in, body)) {
+      uint64_t id;
+      IngressStatus status;
+      while (IngressFrame::read_response(body, id, status)) {
+        responses.emplace_back(id, status);
+      }
+    }
+    bytes.erase(0, bytes.size() - in.size());
+  }
+  return responses;
+}
+} // namespace
+
+TEST(TestIngressServer, TestFrame) {
+
+  std::string body, bytes;
+  IngressFrame::add_request(body, 7, 1, "abc");
+  IngressFrame::add_request(body, 8, 0, "");
+  IngressFrame::append(bytes, body);
+
+  // a torn frame is left for the next receive
+  StringPiece in(bytes.data(), bytes.size() - 1), frame;
+  EXPECT_FALSE(IngressFrame::next(in, frame));
+  EXPECT_EQ(in.size(), bytes.size() - 1);
+
+  in = StringPiece(bytes);
+  EXPECT_TRUE(IngressFrame::next(in, frame));
+  EXPECT_EQ(in.size(), 0u);
+
+  IngressRequest request;
+  EXPECT_TRUE(IngressFrame::read_request(frame, request));
+  EXPECT_EQ(request.id, 7u);
+  EXPECT_EQ(request.procedure, 1u);
+  EXPECT_EQ(request.args, "abc");
+  EXPECT_TRUE(IngressFrame::read_request(frame, request));
+  EXPECT_EQ(request.id, 8u);
+  EXPECT_EQ(request.args, "");
+  EXPECT_FALSE(IngressFrame::read_request(frame, request));
+
+  body.clear();
+  IngressFrame::add_response(body, 9, IngressStatus::REJECTED);
+  StringPiece responses(body);
+  uint64_t id;
+  IngressStatus status;
+  EXPECT_TRUE(IngressFrame::read_response(responses, id, status));
+  EXPECT_EQ(id, 9u);
+  EXPECT_EQ(status, IngressStatus::REJECTED);
+  EXPECT_FALSE(IngressFrame::read_response(responses, id, status));
+}
+
+TEST(TestIngressServer, TestServe) {
+
+  // two executors, and at most two requests in flight
+  IngressServer server;
+  server.listen(0, 2, 2);
+  server.start();
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(server.get_port());
+  ASSERT_EQ(connect(fd, (sockaddr *)&addr, sizeof(addr)), 0);
+
+  std::string body, bytes;
+  for (auto id = 1u; id <= 3; id++) {
+    IngressFrame::add_request(body, id, 0, "args");
+  }
+  IngressFrame::append(bytes, body);
+  ASSERT_EQ(send(fd, bytes.data(), bytes.size(), 0),
+            static_cast<ssize_t>(bytes.size()));
+
+  // the third one is over the limit
+  auto responses = receive(fd, 1);
+  ASSERT_EQ(responses.size(), 1u);
+  EXPECT_EQ(responses[0].first, 3u);
+  EXPECT_EQ(responses[0].second, IngressStatus::REJECTED);
+
+  // the other two are dealt round robin
+  IngressRequest *first = nullptr, *second = nullptr;
+  while (first == nullptr) {
+    first = server.pop(0);
+  }
+  while (second == nullptr) {
+    second = server.pop(1);
+  }
+  EXPECT_EQ(first->id, 1u);
+  EXPECT_EQ(second->id, 2u);
+  EXPECT_EQ(second->args, "args");
+  EXPECT_EQ(server.pop(0), nullptr);
+
+  server.notify(1, second, IngressStatus::INVALID);
+  server.notify(0, first, IngressStatus::COMMITTED);
+  responses = receive(fd, 2);
+  ASSERT_EQ(responses.size(), 2u);
+  std::sort(responses.begin(), responses.end());
+  EXPECT_EQ(responses[0].first, 1u);
+  EXPECT_EQ(responses[0].second, IngressStatus::COMMITTED);
+  EXPECT_EQ(responses[1].first, 2u);
+  EXPECT_EQ(responses[1].second, IngressStatus::INVALID);
+
+  close(fd);
+  server.stop();
+  EXPECT_EQ(server.get_n_admitted(), 2u);
+  EXPECT_EQ(server.get_n_rejected(), 1u);
+}
+
+TEST(TestIngressServer, TestPriority) {
+
+  // procedure 1 is in priority class 1
+  IngressServer server;
+  server.listen(0, 1, 10, Priorities("1:1", ""));
+  server.start();
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(server.get_port());
+  ASSERT_EQ(connect(fd, (sockaddr *)&addr, sizeof(addr)), 0);
+
+  std::string body, bytes;
+  IngressFrame::add_request(body, 1, 0, "");
+  IngressFrame::add_request(body, 2, 1, "");
+  IngressFrame::add_request(body, 3, 0, "");
+  IngressFrame::append(bytes, body);
+  ASSERT_EQ(send(fd, bytes.data(), bytes.size(), 0),
+            static_cast<ssize_t>(bytes.size()));
+  while (server.get_n_admitted() < 3) {
+    std::this_thread::yield();
+  }
+
+  // the request of class 1 goes first
+  std::vector<uint64_t> ids;
+  for (IngressRequest *request; (request = server.pop(0)) != nullptr;) {
+    ids.push_back(request->id);
+    delete request;
+  }
+  EXPECT_EQ(ids, std::vector<uint64_t>({2, 1, 3}));
+
+  close(fd);
+  server.stop();
+}
+
+TEST(TestIngressServer, TestShed) {
+
+  // a target delay of 1 ms, above it for 1 us is a standing delay
+  IngressServer server;
+  server.listen(0, 1, 10, Priorities("1:1", ""), 1000, 1);
+  server.start();
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(server.get_port());
+  ASSERT_EQ(connect(fd, (sockaddr *)&addr, sizeof(addr)), 0);
+
+  auto submit = [&](uint64_t id, uint32_t procedure) {
+    std::string body, bytes;
+    IngressFrame::add_request(body, id, procedure, "");
+    IngressFrame::append(bytes, body);
+    ASSERT_EQ(send(fd, bytes.data(), bytes.size(), 0),
+              static_cast<ssize_t>(bytes.size()));
+  };
+
+  // the executor pops two requests that waited above the target
+  submit(1, 0);
+  submit(2, 0);
+  submit(3, 0);
+  while (server.get_n_admitted() < 3) {
+    std::this_thread::yield();
+  }
+  for (auto i = 0; i < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    auto request = server.pop(0);
+    ASSERT_NE(request, nullptr);
+    server.notify(0, request, IngressStatus::COMMITTED);
+  }
+  EXPECT_EQ(server.get_n_overloads(), 1u);
+
+  // a request of class 0 is shed, one of class 1 is not
+  submit(4, 0);
+  submit(5, 1);
+  auto responses = receive(fd, 3);
+  ASSERT_EQ(responses.size(), 3u);
+  EXPECT_EQ(std::count(responses.begin(), responses.end(),
+                       std::make_pair(uint64_t(4), IngressStatus::REJECTED)),
+            1);
+  while (server.get_n_admitted() < 4) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(server.get_n_shed(), 1u);
+  EXPECT_EQ(server.get_n_rejected(), 0u);
+
+  std::vector<uint64_t> ids;
+  for (IngressRequest *request; (request = server.pop(0)) != nullptr;) {
+    ids.push_back(request->id);
+    delete request;
+  }
+  EXPECT_EQ(ids, std::vector<uint64_t>({5, 3}));
+
+  close(fd);
+  server.stop();
+}
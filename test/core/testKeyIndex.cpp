@@ -0,0 +1,44 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/KeyIndex.h"
+#include <gtest/gtest.h>
+
+namespace {
+struct RWKey {
+  const void *get_key() const { return key; }
+  const void *key;
+};
+} // namespace
+
+TEST(TestKeyIndex, TestFind) {
+
+  std::vector<int> rows(100);
+  std::vector<RWKey> keys;
+  coco::KeyIndex index;
+
+  int other = 0;
+  for (auto i = 0u; i < rows.size(); i++) {
+    keys.push_back(RWKey{&rows[i]});
+    // indexed once the set is large, appended keys are caught up with
+    for (auto j = 0u; j <= i; j++) {
+      EXPECT_EQ(index.find(keys, &rows[j]), static_cast<int64_t>(j));
+    }
+    EXPECT_EQ(index.find(keys, &other), -1);
+  }
+
+  // the first entry of a key is returned
+  keys.push_back(RWKey{&rows[10]});
+  EXPECT_EQ(index.find(keys, &rows[10]), 10);
+
+  keys.clear();
+  index.clear();
+  EXPECT_EQ(index.find(keys, &rows[0]), -1);
+  for (auto i = 0u; i < 20; i++) {
+    keys.push_back(RWKey{&rows[99 - i]});
+  }
+  EXPECT_EQ(index.find(keys, &rows[99]), 0);
+  EXPECT_EQ(index.find(keys, &rows[80]), 19);
+  EXPECT_EQ(index.find(keys, &rows[0]), -1);
+}
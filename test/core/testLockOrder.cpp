@@ -0,0 +1,75 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/LockOrder.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+struct RWKey {
+  uint32_t get_table_id() const { return table_id; }
+  uint32_t get_partition_id() const { return partition_id; }
+  const void *get_key() const { return key; }
+
+  uint32_t table_id, partition_id;
+  const void *key;
+};
+
+struct Database {
+  coco::ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    return tables[partition_id];
+  }
+  std::vector<coco::ITable *> tables;
+};
+
+} // namespace
+
+TEST(TestLockOrder, TestSortAndPrefetch) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<10, warehouse::key, warehouse::value> t0(warehouse::tableID, 0),
+      t1(warehouse::tableID, 1);
+  Database db;
+  db.tables = {&t0, &t1};
+
+  std::vector<warehouse::key> keys;
+  for (auto i = 1; i <= 10; i++) {
+    keys.emplace_back(i);
+  }
+  warehouse::value value;
+  for (auto &key : keys) {
+    t0.insert(&key, &value);
+    t1.insert(&key, &value);
+  }
+
+  // the same rows in different orders, with keys at different addresses
+  auto copies = keys;
+  std::vector<RWKey> a, b;
+  for (auto i = 0u; i < keys.size(); i++) {
+    a.push_back(RWKey{warehouse::tableID, i % 2, &keys[i]});
+    auto j = keys.size() - 1 - i;
+    b.push_back(
+        RWKey{warehouse::tableID, static_cast<uint32_t>(j % 2), &copies[j]});
+  }
+
+  HashPartitioner partitioner(0, 1);
+  LockOrder<RWKey> order_a, order_b;
+  order_a.sort_and_prefetch(a, db, partitioner);
+  order_b.sort_and_prefetch(b, db, partitioner);
+
+  for (auto i = 0u; i < a.size(); i++) {
+    EXPECT_EQ(a[i].get_partition_id(), b[i].get_partition_id());
+    EXPECT_EQ(*static_cast<const warehouse::key *>(a[i].get_key()),
+              *static_cast<const warehouse::key *>(b[i].get_key()));
+    EXPECT_EQ(&order_a.tid(i), &order_b.tid(i));
+    EXPECT_EQ(&order_a.tid(i), &db.find_table(0, a[i].get_partition_id())
+                                    ->search_metadata(a[i].get_key()));
+    if (i > 0) {
+      EXPECT_LE(a[i - 1].get_partition_id(), a[i].get_partition_id());
+    }
+  }
+}
@@ -0,0 +1,134 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/MessageDispatch.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Calls {
+  int function = 0, closure = 0;
+};
+
+void function_handler(coco::MessagePiece, coco::Message &, coco::ITable &,
+                      Calls *calls) {
+  calls->function++;
+}
+
+struct FakeDatabase {
+  coco::ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    lookups++;
+    return tables[partition_id];
+  }
+
+  std::vector<coco::ITable *> tables;
+  int lookups = 0;
+};
+} // namespace
+
+TEST(TestMessageDispatch, TestHandlers) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  MessageDispatch<Calls *> dispatch;
+  std::vector<MessageDispatch<Calls *>::HandlerType> handlers;
+  handlers.push_back(function_handler);
+  handlers.push_back([](MessagePiece, Message &, ITable &, Calls *calls) {
+    calls->closure++;
+  });
+
+  EXPECT_FALSE(dispatch.is_bound());
+  dispatch.bind(handlers);
+  EXPECT_TRUE(dispatch.is_bound());
+
+  Table<1, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  Message message;
+  Calls calls;
+  uint64_t header = MessagePiece::construct_message_piece_header(
+      0, MessagePiece::get_header_size(), warehouse::tableID, 0);
+  MessagePiece piece(StringPiece(reinterpret_cast<const char *>(&header),
+                                 sizeof(header)));
+  dispatch(0, piece, message, table, &calls);
+  dispatch(1, piece, message, table, &calls);
+  dispatch(0, piece, message, table, &calls);
+  EXPECT_EQ(calls.function, 2);
+  EXPECT_EQ(calls.closure, 1);
+}
+
+TEST(TestMessageDispatch, TestTable) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<1, warehouse::key, warehouse::value> table0(warehouse::tableID, 0),
+      table1(warehouse::tableID, 1);
+  FakeDatabase db;
+  db.tables = {&table0, &table1};
+
+  uint64_t headers[2];
+  std::vector<MessagePiece> pieces;
+  for (auto i = 0u; i < 2; i++) {
+    headers[i] = MessagePiece::construct_message_piece_header(
+        0, MessagePiece::get_header_size(), warehouse::tableID, i);
+    pieces.emplace_back(StringPiece(
+        reinterpret_cast<const char *>(&headers[i]), sizeof(headers[i])));
+  }
+
+  // the table is looked up once per run of pieces of the same partition
+  MessageDispatch<Calls *> dispatch;
+  EXPECT_EQ(dispatch.table(db, pieces[0]), &table0);
+  EXPECT_EQ(dispatch.table(db, pieces[0]), &table0);
+  EXPECT_EQ(db.lookups, 1);
+  EXPECT_EQ(dispatch.table(db, pieces[1]), &table1);
+  EXPECT_EQ(dispatch.table(db, pieces[0]), &table0);
+  EXPECT_EQ(db.lookups, 3);
+}
+
+TEST(TestMessageDispatch, TestPrefetch) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<1, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  FakeDatabase db;
+  db.tables = {&table};
+
+  // five pieces of type 0 keyed by a warehouse, then one of type 1
+  Message message;
+  Encoder encoder(message.data);
+  warehouse::value value;
+  for (auto i = 0u; i < 6; i++) {
+    warehouse::key key(i + 1);
+    table.insert(&key, &value);
+    auto type = i < 5 ? 0 : 1;
+    encoder << MessagePiece::construct_message_piece_header(
+                   type, MessagePiece::get_header_size() + sizeof(key),
+                   warehouse::tableID, 0)
+            << key;
+    message.flush();
+  }
+
+  MessageDispatch<Calls *> dispatch;
+  std::vector<MessageDispatch<Calls *>::HandlerType> handlers;
+  handlers.push_back(function_handler);
+  handlers.push_back(function_handler);
+  dispatch.bind(handlers);
+  dispatch.prefetch_keys({0}, 3);
+
+  Calls calls;
+  dispatch.begin(db, message);
+  EXPECT_EQ(db.lookups, 3);
+  for (auto it = message.begin(); it != message.end(); it++) {
+    dispatch.next(db);
+    MessagePiece piece = *it;
+    dispatch(piece.get_message_type(), piece, message, table, &calls);
+  }
+  EXPECT_EQ(calls.function, 6);
+
+  // each keyed piece is prefetched at each level, except the first two at
+  // the slot level and the first one at the row level
+  EXPECT_EQ(db.lookups, 12);
+}
@@ -0,0 +1,48 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/MessageStatistics.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestMessageStatistics, TestHandle) {
+
+  using namespace coco;
+
+  MessageStatistics worker(4, 2), coordinator(0, 0);
+  std::size_t pending = 2;
+
+  worker.on_flush(1);
+  auto received = Clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  // a request of type 0 leaves pending as it is
+  worker.handle(0, 1, received, &pending, []() {});
+  // a response of type 1 decrements it
+  worker.handle(1, 1, received, &pending, [&]() { pending--; });
+  // no transaction yet
+  worker.handle(1, 0, received, nullptr, []() {});
+
+  EXPECT_EQ(worker.find(2), nullptr);
+  EXPECT_EQ(worker.find(8), nullptr);
+  auto request = worker.find(0);
+  ASSERT_NE(request, nullptr);
+  EXPECT_EQ(request->handle.size(), 1u);
+  EXPECT_EQ(request->round_trip.size(), 0u);
+  EXPECT_GE(request->queue.nth(50), 1000000);
+
+  auto response = worker.find(1);
+  ASSERT_NE(response, nullptr);
+  EXPECT_EQ(response->handle.size(), 2u);
+  EXPECT_EQ(response->round_trip.size(), 1u);
+  EXPECT_GE(response->round_trip.nth(50), 1000000);
+
+  worker.collect(coordinator);
+  EXPECT_EQ(worker.find(1)->handle.size(), 0u);
+  ASSERT_NE(coordinator.find(1), nullptr);
+  EXPECT_EQ(coordinator.find(1)->handle.size(), 2u);
+  EXPECT_EQ(coordinator.find(1)->round_trip.size(), 1u);
+  EXPECT_EQ(coordinator.find(0)->queue.size(), 1u);
+  EXPECT_EQ(coordinator.find(2), nullptr);
+}
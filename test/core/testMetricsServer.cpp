@@ -0,0 +1,107 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/MetricsServer.h"
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::string http_get(int port, const std::string &path) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  EXPECT_EQ(connect(fd, (sockaddr *)&addr, sizeof(addr)), 0);
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: x\r\n\r\n";
+  EXPECT_EQ(send(fd, request.data(), request.size(), 0),
+            static_cast<ssize_t>(request.size()));
+  std::string response;
+  char buffer[1024];
+  ssize_t n;
+  while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, n);
+  }
+  close(fd);
+  return response;
+}
+} // namespace
+
+TEST(TestMetricsServer, TestText) {
+
+  using namespace coco;
+
+  MetricsServer metrics(3, 0);
+  EXPECT_NE(metrics.get_text().find("coco_commits_total{coordinator=\"3\"} 0"),
+            std::string::npos);
+
+  Statistics s;
+  s.n_commit = 12345678;
+  s.n_abort_lock = 2;
+  s.phase_time[static_cast<std::size_t>(TransactionPhase::LOCK)] = 1500000000;
+  s.queue_occupancy = 7;
+  s.latency.add(3);
+  s.latency.add(100);
+  metrics.update(s, 10, 20);
+  s.queue_occupancy = 5;
+  EXPECT_EQ(metrics.get_text().find("coco_ingress_requests_total"),
+            std::string::npos);
+  metrics.update_ingress(8, 1, 2);
+  metrics.update(s, 30, 40);
+
+  auto text = metrics.get_text();
+  auto has = [&](const std::string &line) {
+    return text.find(line + "\n") != std::string::npos;
+  };
+  EXPECT_TRUE(has("# TYPE coco_commits_total counter"));
+  EXPECT_TRUE(has("coco_commits_total{coordinator=\"3\"} 24691356"));
+  EXPECT_TRUE(has("coco_aborts_total{coordinator=\"3\",reason=\"lock\"} 4"));
+  EXPECT_TRUE(
+      has("coco_phase_seconds_total{coordinator=\"3\",phase=\"lock\"} 3"));
+  EXPECT_TRUE(
+      has("coco_network_bytes_total{coordinator=\"3\",direction=\"in\"} 30"));
+  EXPECT_TRUE(has("coco_outgoing_queue_max_occupancy{coordinator=\"3\"} 5"));
+  EXPECT_TRUE(
+      has("coco_commit_latency_us_bucket{coordinator=\"3\",le=\"2\"} 0"));
+  EXPECT_TRUE(
+      has("coco_commit_latency_us_bucket{coordinator=\"3\",le=\"4\"} 2"));
+  EXPECT_TRUE(
+      has("coco_commit_latency_us_bucket{coordinator=\"3\",le=\"128\"} 4"));
+  EXPECT_TRUE(
+      has("coco_commit_latency_us_bucket{coordinator=\"3\",le=\"+Inf\"} 4"));
+  EXPECT_TRUE(has("coco_commit_latency_us_sum{coordinator=\"3\"} 206"));
+  EXPECT_TRUE(has("coco_commit_latency_us_count{coordinator=\"3\"} 4"));
+  EXPECT_TRUE(has(
+      "coco_ingress_requests_total{coordinator=\"3\",outcome=\"shed\"} 2"));
+}
+
+TEST(TestMetricsServer, TestHttp) {
+
+  using namespace coco;
+
+  MetricsServer metrics(0, 0);
+  Statistics s;
+  s.n_commit = 42;
+  metrics.update(s, 0, 0);
+  metrics.start();
+
+  auto response = http_get(metrics.get_port(), "/metrics");
+  EXPECT_EQ(response.find("HTTP/1.1 200 OK\r\n"), 0u);
+  EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4\r\n"),
+            std::string::npos);
+  auto body = response.substr(response.find("\r\n\r\n") + 4);
+  EXPECT_EQ(body, metrics.get_text());
+  EXPECT_NE(body.find("coco_commits_total{coordinator=\"0\"} 42\n"),
+            std::string::npos);
+
+  response = http_get(metrics.get_port(), "/");
+  EXPECT_EQ(response.find("HTTP/1.1 404 Not Found\r\n"), 0u);
+
+  metrics.stop();
+}
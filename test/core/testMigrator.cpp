@@ -0,0 +1,70 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/Migrator.h"
+#include <gtest/gtest.h>
+
+TEST(TestMigrator, TestParse) {
+  auto migrations = coco::Migrator::parse_migrations("3:0,5:1");
+  ASSERT_EQ(migrations.size(), 2u);
+  EXPECT_EQ(migrations[0], std::make_pair(std::size_t(3), std::size_t(0)));
+  EXPECT_EQ(migrations[1], std::make_pair(std::size_t(5), std::size_t(1)));
+  EXPECT_TRUE(coco::Migrator::parse_migrations("").empty());
+}
+
+TEST(TestMigrator, TestApplyRows) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+
+  auto table_id = ycsb::ycsb::tableID;
+  Table<7, key_type, value_type> source(table_id, 0), target(table_id, 0);
+
+  for (auto i = 0; i < 10; i++) {
+    key_type key(i);
+    value_type value;
+    value.Y_F01.assign(std::to_string(i));
+    source.insert(&key, &value);
+    source.search_metadata(&key).store(10);
+  }
+
+  // row 3 is replicated to the target before the stream
+  key_type replicated_key(3);
+  value_type replicated;
+  replicated.Y_F01.assign("replicated");
+  target.insert(&replicated_key, &replicated);
+  target.search_metadata(&replicated_key).store(20);
+
+  std::string rows;
+  source.for_each_row(
+      [&](const void *key, ITable::MetaDataType &metadata, void *value) {
+        Checkpoint::append_row(rows, source, key, metadata, value);
+      });
+
+  Message message;
+  Migrator::new_rows_message(message, source, rows);
+  std::size_t n = 0;
+  for (auto it = message.begin(); it != message.end(); it++) {
+    EXPECT_EQ((*it).get_message_type(),
+              static_cast<uint32_t>(ControlMessage::MIGRATION_ROWS));
+    n += Migrator::apply_rows(target, (*it).toStringPiece());
+  }
+  EXPECT_EQ(n, 10u);
+
+  // the newer replicated row is kept
+  for (auto i = 0; i < 10; i++) {
+    key_type key(i);
+    auto &value = *static_cast<value_type *>(target.search_value(&key));
+    if (i == 3) {
+      EXPECT_EQ(target.search_metadata(&key).load(), 20u);
+      EXPECT_EQ(value.Y_F01, FixedString<ycsb::YCSB_FIELD_SIZE>("replicated"));
+    } else {
+      EXPECT_EQ(target.search_metadata(&key).load(), 10u);
+      EXPECT_EQ(value.Y_F01,
+                FixedString<ycsb::YCSB_FIELD_SIZE>(std::to_string(i)));
+    }
+  }
+}
@@ -0,0 +1,50 @@
+//
+// Created by Yi Lu on 8/29/18.
+//
+
+#include "core/NetworkEngine.h"
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+
+TEST(TestNetworkEngine, TestPoll) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  coco::Socket a(fds[0]), b(fds[1]);
+
+  auto engine = coco::NetworkEngineFactory::create_network_engine("poll");
+  engine->add(3, a);
+
+  std::vector<std::size_t> ready;
+  engine->wait_readable(ready);
+  EXPECT_EQ(ready, std::vector<std::size_t>({3}));
+
+  a.close();
+  b.close();
+}
+
+TEST(TestNetworkEngine, TestEpoll) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  coco::Socket a(fds[0]), b(fds[1]);
+
+  auto engine = coco::NetworkEngineFactory::create_network_engine("epoll");
+  engine->add(3, a);
+
+  std::vector<std::size_t> ready;
+  engine->wait_readable(ready);
+  EXPECT_TRUE(ready.empty());
+
+  int n = 42;
+  b.write_number(n);
+  engine->wait_readable(ready);
+  EXPECT_EQ(ready, std::vector<std::size_t>({3}));
+
+  int m = 0;
+  a.read_number(m);
+  EXPECT_EQ(n, m);
+  engine->wait_readable(ready);
+  EXPECT_TRUE(ready.empty());
+
+  a.close();
+  b.close();
+}
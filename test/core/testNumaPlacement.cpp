@@ -0,0 +1,68 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/NumaPlacement.h"
+#include <gtest/gtest.h>
+
+TEST(TestNumaPlacement, TestParseCpulist) {
+
+  EXPECT_EQ(coco::NumaTopology::parse_cpulist("0-3,8,10-11\n"),
+            std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(coco::NumaTopology::parse_cpulist("5"), std::vector<int>({5}));
+  EXPECT_TRUE(coco::NumaTopology::parse_cpulist("\n").empty());
+}
+
+TEST(TestNumaPlacement, TestPlacement) {
+
+  // two sockets with interleaved cpus
+  coco::NumaTopology topology({{0, 2, 4, 6}, {1, 3, 5, 7}});
+
+  coco::Context context;
+  context.worker_num = 4;
+  context.partition_num = 8;
+  context.coordinator_num = 2;
+  context.cpu_core_id = 2;
+
+  coco::NumaPlacement placement(context, topology);
+  EXPECT_EQ(placement.node_num(), 2u);
+  EXPECT_EQ(placement.cpus(0), std::vector<int>({2, 4, 6}));
+  EXPECT_EQ(placement.cpus(1), std::vector<int>({3, 5, 7}));
+
+  EXPECT_EQ(placement.worker_node(0), 0u);
+  EXPECT_EQ(placement.worker_node(1), 0u);
+  EXPECT_EQ(placement.worker_node(2), 1u);
+  EXPECT_EQ(placement.worker_node(3), 1u);
+  // the manager
+  EXPECT_EQ(placement.worker_node(4), 0u);
+
+  // coordinator 1 masters partitions 1, 3, 5 and 7
+  coco::HashPartitioner partitioner(1, 2);
+  EXPECT_EQ(placement.local_partitions(0, partitioner),
+            std::vector<std::size_t>({1, 3}));
+  EXPECT_EQ(placement.local_partitions(3, partitioner),
+            std::vector<std::size_t>({5, 7}));
+
+  EXPECT_EQ(placement.take_cpu(1), 3);
+  EXPECT_EQ(placement.take_cpu(1), 5);
+  EXPECT_EQ(placement.take_cpu(1), 7);
+  EXPECT_EQ(placement.take_cpu(1), 3);
+  EXPECT_EQ(placement.take_cpu(0), 2);
+}
+
+TEST(TestNumaPlacement, TestFewerWorkersThanNodes) {
+
+  coco::NumaTopology topology({{0, 1}, {2, 3}, {4, 5}, {6, 7}});
+
+  coco::Context context;
+  context.worker_num = 2;
+  context.partition_num = 4;
+  context.coordinator_num = 1;
+
+  coco::NumaPlacement placement(context, topology);
+  EXPECT_EQ(placement.node_num(), 2u);
+  EXPECT_EQ(placement.partition_node(0), 0u);
+  EXPECT_EQ(placement.partition_node(1), 0u);
+  EXPECT_EQ(placement.partition_node(2), 1u);
+  EXPECT_EQ(placement.partition_node(3), 1u);
+}
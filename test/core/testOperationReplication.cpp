@@ -0,0 +1,83 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/OperationReplication.h"
+#include "protocol/Silo/SiloHelper.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+// an operation sets rows[row] to value for each (row, value) in it
+class TestDatabase {
+public:
+  template <class Func>
+  void apply_operation(const coco::Operation &operation, Func write) {
+    coco::Decoder dec(operation.data);
+    while (dec.size() > 0) {
+      uint32_t row;
+      int32_t value;
+      dec >> row >> value;
+      write(tids[row], [this, row, value]() { values[row] = value; });
+    }
+  }
+
+  std::atomic<uint64_t> tids[2] = {};
+  int32_t values[2] = {};
+};
+
+struct TestTransaction {
+  std::size_t pendingResponses = 0;
+  std::size_t network_size = 0;
+};
+} // namespace
+
+TEST(TestOperationReplication, TestReplay) {
+
+  using namespace coco;
+
+  TestDatabase db;
+  TestTransaction txn;
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> table(ycsb::ycsb::tableID, 0);
+
+  std::vector<
+      std::function<void(MessagePiece, Message &, ITable &, TestTransaction *)>>
+      handlers(static_cast<int>(ControlMessage::NFIELDS));
+  OperationReplication::set_message_handlers<SiloHelper>(handlers, db);
+
+  auto replay = [&](uint64_t tid, uint32_t row, int32_t value) {
+    Operation operation;
+    operation.set_tid(tid);
+    Encoder encoder(operation.data);
+    encoder << row << value;
+
+    Message request, response;
+    OperationReplication::new_operation_message(request, operation, true);
+    for (auto it = request.begin(); it != request.end(); it++) {
+      handlers[(*it).get_message_type()](*it, response, table, &txn);
+    }
+
+    txn.pendingResponses++;
+    EXPECT_EQ(response.get_message_count(), 1u);
+    for (auto it = response.begin(); it != response.end(); it++) {
+      handlers[(*it).get_message_type()](*it, request, table, &txn);
+    }
+    EXPECT_EQ(txn.pendingResponses, 0u);
+  };
+
+  replay(10, 0, 1);
+  replay(20, 1, 2);
+  EXPECT_EQ(db.values[0], 1);
+  EXPECT_EQ(db.values[1], 2);
+  EXPECT_EQ(db.tids[1].load(), 20u);
+
+  // an operation older than the row is skipped
+  replay(15, 1, 3);
+  EXPECT_EQ(db.values[1], 2);
+  EXPECT_EQ(db.tids[1].load(), 20u);
+
+  replay(30, 1, 4);
+  EXPECT_EQ(db.values[1], 4);
+  EXPECT_EQ(db.tids[1].load(), 30u);
+}
@@ -0,0 +1,69 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/PartitionGate.h"
+#include "protocol/Silo/SiloHelper.h"
+#include <gtest/gtest.h>
+
+TEST(TestPartitionGate, TestEnter) {
+
+  coco::PartitionGate gate;
+
+  EXPECT_TRUE(gate.try_enter());
+  EXPECT_TRUE(gate.is_inside());
+  EXPECT_FALSE(gate.try_enter());
+
+  // no row is locked while a transaction is inside
+  EXPECT_FALSE(gate.lock_row());
+  EXPECT_EQ(gate.locked_rows(), 0u);
+
+  gate.leave();
+  EXPECT_FALSE(gate.is_inside());
+
+  EXPECT_TRUE(gate.lock_row());
+  EXPECT_TRUE(gate.lock_row());
+  EXPECT_EQ(gate.locked_rows(), 2u);
+  EXPECT_FALSE(gate.try_enter());
+
+  gate.unlock_row();
+  EXPECT_FALSE(gate.try_enter());
+  gate.unlock_row();
+  EXPECT_TRUE(gate.try_enter());
+  gate.leave();
+}
+
+TEST(TestPartitionGate, TestSiloLock) {
+
+  using coco::SiloHelper;
+
+  coco::PartitionGate gate;
+  std::atomic<uint64_t> tid(0x10);
+  bool success;
+
+  SiloHelper::lock(tid, success, 0, &gate);
+  EXPECT_TRUE(success);
+  EXPECT_TRUE(SiloHelper::is_locked(tid.load()));
+  EXPECT_EQ(gate.locked_rows(), 1u);
+
+  // a row locked by others is not counted twice
+  SiloHelper::lock(tid, success, 0, &gate);
+  EXPECT_FALSE(success);
+  EXPECT_EQ(gate.locked_rows(), 1u);
+
+  SiloHelper::unlock(tid, 0x20, &gate);
+  EXPECT_EQ(tid.load(), 0x20u);
+  EXPECT_EQ(gate.locked_rows(), 0u);
+
+  EXPECT_TRUE(gate.try_enter());
+  SiloHelper::lock(tid, success, 0, &gate);
+  EXPECT_FALSE(success);
+  EXPECT_FALSE(SiloHelper::is_locked(tid.load()));
+  gate.leave();
+
+  SiloHelper::lock(tid, success, 0, &gate);
+  EXPECT_TRUE(success);
+  SiloHelper::unlock(tid, &gate);
+  EXPECT_EQ(tid.load(), 0x20u);
+  EXPECT_EQ(gate.locked_rows(), 0u);
+}
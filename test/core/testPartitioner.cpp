@@ -3,6 +3,8 @@
 //
 
 #include "core/Partitioner.h"
+#include <cstdio>
+#include <fstream>
 #include <gtest/gtest.h>
 
 TEST(TestPartitioner, TestBasic) {
@@ -87,4 +89,137 @@ TEST(TestPartitioner, TestStarS) {
       }
     }
   }
-}
\ No newline at end of file
+}
+TEST(TestPartitioner, TestCalvin) {
+
+  // a replica group of coordinator 0 and one of coordinators 1 to 3
+  std::vector<std::vector<bool>> replicationPartitions = {
+      {true, true, false, false}, {true, false, true, false},
+      {true, false, false, true}, {true, true, false, false},
+      {true, false, true, false}, {true, false, false, true}};
+
+  std::size_t total_coordinator = 4, total_partitions = 6;
+  for (auto i = 0u; i < total_coordinator; i++) {
+    coco::CalvinPartitioner partitioner(i, total_coordinator, "1,3");
+    EXPECT_EQ(partitioner.replica_num(), 2u);
+    EXPECT_EQ(partitioner.replica_group_id(), i == 0 ? 0u : 1u);
+    for (auto k = 0u; k < total_partitions; k++) {
+      // the master of a partition is in the same replica group
+      EXPECT_TRUE(replicationPartitions[k][partitioner.master_coordinator(k)]);
+      EXPECT_EQ(partitioner.has_master_partition(k),
+                replicationPartitions[k][i]);
+      EXPECT_EQ(partitioner.master_coordinator(k) == 0, i == 0);
+
+      for (auto j = 0u; j < total_coordinator; j++) {
+        EXPECT_EQ(partitioner.is_partition_replicated_on(k, j),
+                  replicationPartitions[k][j]);
+      }
+    }
+  }
+}
+
+TEST(TestPartitioner, TestCalvinPeer) {
+
+  // two replica groups of two coordinators, the peers of a coordinator
+  // master the same partitions in their groups
+  std::size_t total_coordinator = 4, total_partitions = 8;
+  for (auto i = 0u; i < total_coordinator; i++) {
+    coco::CalvinPartitioner partitioner(i, total_coordinator, "2,2");
+    EXPECT_EQ(partitioner.peer(partitioner.replica_group_id()), i);
+    auto peer = partitioner.peer(1 - partitioner.replica_group_id());
+    coco::CalvinPartitioner other(peer, total_coordinator, "2,2");
+    EXPECT_EQ(other.peer(partitioner.replica_group_id()), i);
+    for (auto k = 0u; k < total_partitions; k++) {
+      EXPECT_EQ(partitioner.has_master_partition(k),
+                other.has_master_partition(k));
+    }
+  }
+}
+
+TEST(TestPartitioner, TestStarC) {
+
+  std::size_t total_coordinator = 4, total_partitions = 10;
+  for (auto i = 0u; i < total_coordinator; i++) {
+    coco::StarCPartitioner c_partitioner(i, total_coordinator);
+    coco::StarSPartitioner s_partitioner(i, total_coordinator);
+    for (auto k = 0u; k < total_partitions; k++) {
+      EXPECT_EQ(c_partitioner.master_coordinator(k), 0u);
+      EXPECT_EQ(c_partitioner.has_master_partition(k), i == 0);
+
+      // both phases of Star see the same replicas
+      for (auto j = 0u; j < total_coordinator; j++) {
+        EXPECT_EQ(c_partitioner.is_partition_replicated_on(k, j),
+                  s_partitioner.is_partition_replicated_on(k, j));
+      }
+    }
+  }
+}
+
+TEST(TestPartitioner, TestDynamic) {
+
+  std::size_t total_coordinator = 3;
+  coco::PartitionMap map(total_coordinator);
+  coco::DynamicPartitioner partitioner(1, total_coordinator, map);
+
+  // partition 4 is on coordinator 1 as with the hash partitioner
+  EXPECT_EQ(partitioner.master_coordinator(4), 1u);
+  EXPECT_TRUE(partitioner.has_master_partition(4));
+  EXPECT_EQ(partitioner.partition_replica_num(4), 1u);
+
+  // once the move begins, coordinator 2 is a replica
+  map.announce({4, 2, 1});
+  std::string bytes;
+  coco::PartitionMap::encode(bytes, map.take_announced());
+  EXPECT_TRUE(map.take_announced().empty());
+  std::vector<coco::MigrationEvent> events;
+  coco::PartitionMap::decode(bytes, events);
+  map.apply(events);
+
+  EXPECT_EQ(partitioner.master_coordinator(4), 1u);
+  EXPECT_EQ(partitioner.partition_replica_num(4), 2u);
+  EXPECT_TRUE(partitioner.is_partition_replicated_on(4, 1));
+  EXPECT_TRUE(partitioner.is_partition_replicated_on(4, 2));
+  EXPECT_FALSE(partitioner.is_partition_replicated_on(4, 0));
+
+  // once it finishes, coordinator 2 is the owner
+  map.apply({{4, 2, 0}});
+  EXPECT_EQ(partitioner.master_coordinator(4), 2u);
+  EXPECT_FALSE(partitioner.has_master_partition(4));
+  EXPECT_EQ(partitioner.partition_replica_num(4), 1u);
+  EXPECT_FALSE(partitioner.is_partition_replicated_on(4, 1));
+  EXPECT_TRUE(partitioner.is_partition_replicated_on(4, 2));
+
+  // the other partitions stay
+  EXPECT_EQ(partitioner.master_coordinator(5), 2u);
+  EXPECT_EQ(partitioner.master_coordinator(7), 1u);
+}
+
+TEST(TestPartitioner, TestAffinity) {
+
+  std::string trace = "/tmp/coco_test_affinity_trace.txt";
+  {
+    std::ofstream out(trace);
+    out << "# partitions 0 and 1 are accessed together\n";
+    for (auto i = 0; i < 10; i++) {
+      out << "0 1\n2 3\n";
+    }
+  }
+
+  std::size_t total_coordinator = 2;
+  coco::AffinityPartitioner p0(0, total_coordinator, trace),
+      p1(1, total_coordinator, trace);
+
+  for (auto k = 0u; k < 4; k++) {
+    EXPECT_EQ(p0.master_coordinator(k), p1.master_coordinator(k));
+    EXPECT_NE(p0.has_master_partition(k), p1.has_master_partition(k));
+    EXPECT_TRUE(p0.is_partition_replicated_on(k, p0.master_coordinator(k)));
+  }
+  EXPECT_EQ(p0.master_coordinator(0), p0.master_coordinator(1));
+  EXPECT_EQ(p0.master_coordinator(2), p0.master_coordinator(3));
+  EXPECT_NE(p0.master_coordinator(0), p0.master_coordinator(2));
+
+  // beyond the trace as with hashing
+  EXPECT_EQ(p0.master_coordinator(6), 0u);
+  EXPECT_EQ(p0.master_coordinator(7), 1u);
+  std::remove(trace.c_str());
+}
@@ -0,0 +1,34 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "core/Priorities.h"
+#include <gtest/gtest.h>
+
+TEST(TestPriorities, TestClasses) {
+
+  using namespace coco;
+
+  EXPECT_FALSE(Priorities().enabled());
+
+  Priorities priorities("1:1, 3:2", "1:2000");
+  EXPECT_TRUE(priorities.enabled());
+  EXPECT_EQ(priorities.of(0), 0u);
+  EXPECT_EQ(priorities.of(1), 1u);
+  EXPECT_EQ(priorities.of(3), 2u);
+  EXPECT_EQ(priorities.slo(1), 2000u);
+  EXPECT_EQ(priorities.slo(2), 0u);
+
+  // procedures 0 and 2 are both in class 0
+  Statistics s;
+  s.procedures[0].latency.add(10);
+  s.procedures[2].latency.add(20);
+  s.procedures[2].n_abort_lock = 3;
+  s.procedures[1].latency.add(3000);
+  auto classes = priorities.by_class(s);
+  ASSERT_EQ(classes.size(), 2u);
+  EXPECT_EQ(classes[0].n_commit(), 2u);
+  EXPECT_EQ(classes[0].n_abort(), 3u);
+  EXPECT_EQ(classes[1].n_commit(), 1u);
+  EXPECT_EQ(classes[1].latency.count_at_most(priorities.slo(1)), 0u);
+}
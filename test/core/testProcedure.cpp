@@ -0,0 +1,257 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Encoder.h"
+#include "common/Random.h"
+#include "core/Context.h"
+#include "core/Procedure.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+
+using namespace coco;
+
+namespace {
+
+// balances by key, the partition of a key is key % partition_num
+std::map<int32_t, int64_t> balances;
+
+// logs the calls of a procedure to its protocol, and reads the balances
+class TestTransaction {
+public:
+  TestTransaction(std::size_t coordinator_id, std::size_t partition_id,
+                  Partitioner &partitioner)
+      : partition_id(partition_id) {}
+
+  virtual ~TestTransaction() = default;
+
+  virtual TransactionResult execute(std::size_t worker_id) = 0;
+
+  virtual void reset_query() = 0;
+
+  void reset() { calls.clear(); }
+
+  template <class KeyType, class ValueType>
+  void search_for_read(std::size_t table_id, std::size_t partition_id,
+                       const KeyType &key, ValueType &value) {
+    calls += "r" + std::to_string(key) + " ";
+    pending.emplace_back(key, &value);
+  }
+
+  template <class KeyType, class ValueType>
+  void search_for_update(std::size_t table_id, std::size_t partition_id,
+                         const KeyType &key, ValueType &value) {
+    calls += "u" + std::to_string(key) + " ";
+    pending.emplace_back(key, &value);
+  }
+
+  template <class KeyType, class ValueType>
+  void update(std::size_t table_id, std::size_t partition_id,
+              const KeyType &key, const ValueType &value) {
+    calls += "w" + std::to_string(key) + "=" + std::to_string(value) + " ";
+  }
+
+  bool process_requests(std::size_t worker_id) {
+    calls += "p ";
+    for (auto &read : pending) {
+      *read.second = balances[read.first];
+    }
+    pending.clear();
+    return false;
+  }
+
+  std::size_t partition_id;
+  uint32_t procedure_id = 0;
+  Clock::time_point startTime;
+  std::string calls;
+  std::vector<std::pair<int32_t, int64_t *>> pending;
+};
+
+struct TestDatabase {
+  using ContextType = Context;
+  using RandomType = Random;
+};
+
+// moves amount from one key to another, unless the balance is too low
+struct Transfer {
+  static constexpr uint32_t id = FIRST_PROCEDURE_ID;
+
+  struct ArgsType {
+    int32_t from, to;
+    int64_t amount;
+  };
+
+  struct RowsType {
+    int32_t keys[2];
+    int64_t balances[2];
+  };
+
+  static bool decode(const Context &context, StringPiece bytes,
+                     ArgsType &args) {
+    if (bytes.size() != sizeof(int32_t) * 2 + sizeof(int64_t)) {
+      return false;
+    }
+    Decoder dec(bytes);
+    dec >> args.from >> args.to >> args.amount;
+    return args.from >= 0 && args.to >= 0 && args.from != args.to;
+  }
+
+  static void generate(const Context &context, std::size_t partition_id,
+                       Random &random, ArgsType &args) {
+    args.from = partition_id;
+    args.to = partition_id + context.partition_num;
+    args.amount = 1;
+  }
+
+  template <class Access>
+  static void declare(const Context &context, const ArgsType &args,
+                      RowsType &rows, Access &access) {
+    rows.keys[0] = args.from;
+    rows.keys[1] = args.to;
+    for (auto i = 0; i < 2; i++) {
+      access.write(0, rows.keys[i] % context.partition_num, rows.keys[i],
+                   rows.balances[i]);
+    }
+  }
+
+  static TransactionResult run(const Context &context, const ArgsType &args,
+                               RowsType &rows) {
+    if (rows.balances[0] < args.amount) {
+      return TransactionResult::ABORT_NORETRY;
+    }
+    rows.balances[0] -= args.amount;
+    rows.balances[1] += args.amount;
+    return TransactionResult::READY_TO_COMMIT;
+  }
+};
+
+// reads a key, and writes nothing
+struct Audit {
+  static constexpr uint32_t id = FIRST_PROCEDURE_ID + 2;
+
+  using ArgsType = int32_t;
+
+  struct RowsType {
+    int32_t key;
+    int64_t balance;
+  };
+
+  static bool decode(const Context &, StringPiece, ArgsType &) {
+    return false;
+  }
+
+  static void generate(const Context &, std::size_t partition_id, Random &,
+                       ArgsType &args) {
+    args = partition_id;
+  }
+
+  template <class Access>
+  static void declare(const Context &context, const ArgsType &args,
+                      RowsType &rows, Access &access) {
+    rows.key = args;
+    access.read(0, rows.key % context.partition_num, rows.key, rows.balance);
+  }
+
+  static TransactionResult run(const Context &, const ArgsType &,
+                               RowsType &) {
+    return TransactionResult::READY_TO_COMMIT;
+  }
+};
+
+using Registry = ProcedureRegistry<TestTransaction, TestDatabase>;
+
+std::string transfer_args(int32_t from, int32_t to, int64_t amount) {
+  std::string bytes;
+  Encoder enc(bytes);
+  enc << from << to << amount;
+  return bytes;
+}
+} // namespace
+
+namespace coco {
+template <> struct RegisterProcedures<Context> {
+  template <class Registry> static void apply(Registry &registry) {
+    registry.template add<Transfer>();
+    registry.template add<Audit>();
+  }
+};
+} // namespace coco
+
+TEST(TestProcedure, TestRegistry) {
+
+  Context context;
+  context.partition_num = 4;
+  Random random;
+  HashReplicatedPartitioner<1> partitioner(0, 2);
+  Registry registry(0, random, partitioner);
+
+  EXPECT_EQ(registry.size(), 2u);
+  EXPECT_TRUE(registry.contains(Transfer::id));
+  EXPECT_FALSE(registry.contains(Transfer::id + 1));
+  EXPECT_FALSE(registry.contains(0));
+
+  // the home partition is the one of the first row, 2 is on this node but
+  // 1 is not
+  auto txn = registry.submitted(context, Transfer::id, transfer_args(2, 5, 1));
+  ASSERT_NE(txn, nullptr);
+  EXPECT_EQ(txn->partition_id, 2u);
+  EXPECT_EQ(txn->procedure_id, uint32_t(Transfer::id));
+  EXPECT_EQ(registry.submitted(context, Transfer::id, transfer_args(5, 2, 1)),
+            nullptr);
+  EXPECT_EQ(registry.submitted(context, Transfer::id, transfer_args(2, 2, 1)),
+            nullptr);
+  EXPECT_EQ(registry.submitted(context, Transfer::id, "x"), nullptr);
+  EXPECT_EQ(registry.submitted(context, Transfer::id + 1, ""), nullptr);
+
+  txn = registry.generated(context, Audit::id, 3);
+  EXPECT_EQ(txn->partition_id, 3u);
+  EXPECT_EQ(txn->procedure_id, uint32_t(Audit::id));
+}
+
+TEST(TestProcedure, TestExecute) {
+
+  Context context;
+  context.partition_num = 4;
+  Random random;
+  HashReplicatedPartitioner<1> partitioner(0, 2);
+  Registry registry(0, random, partitioner);
+  balances = {{2, 10}, {5, 0}};
+
+  // the rows are read in one round, and the writes follow the procedure
+  auto txn = registry.submitted(context, Transfer::id, transfer_args(2, 5, 3));
+  EXPECT_EQ(txn->execute(0), TransactionResult::READY_TO_COMMIT);
+  EXPECT_EQ(txn->calls, "u2 u5 p w2=7 w5=3 ");
+
+  // a procedure that aborts writes nothing
+  txn = registry.submitted(context, Transfer::id, transfer_args(2, 5, 11));
+  EXPECT_EQ(txn->execute(0), TransactionResult::ABORT_NORETRY);
+  EXPECT_EQ(txn->calls, "u2 u5 p ");
+
+  txn = registry.generated(context, Audit::id, 2);
+  EXPECT_EQ(txn->execute(0), TransactionResult::READY_TO_COMMIT);
+  EXPECT_EQ(txn->calls, "r2 p ");
+}
+
+TEST(TestProcedure, TestPool) {
+
+  Context context;
+  context.partition_num = 4;
+  Random random;
+  HashReplicatedPartitioner<1> partitioner(0, 2);
+  Registry registry(0, random, partitioner);
+  TransactionPool<TestTransaction> pool;
+
+  // a transaction of the same procedure is renewed with the new args
+  auto txn = registry.generated(context, Transfer::id, 0, &pool);
+  txn->execute(0);
+  auto p = txn.get();
+  pool.put(std::move(txn));
+  txn = registry.generated(context, Transfer::id, 2, &pool);
+  EXPECT_EQ(txn.get(), p);
+  EXPECT_EQ(pool.reuses(), 1u);
+  EXPECT_EQ(txn->partition_id, 2u);
+  EXPECT_EQ(txn->calls, "");
+  txn->execute(0);
+  EXPECT_EQ(txn->calls.substr(0, 6), "u2 u6 ");
+}
@@ -0,0 +1,67 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "core/Profiler.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// burns the cpu of the calling thread for ms
+uint64_t spin(int ms) {
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+  volatile uint64_t x = 0;
+  while (std::chrono::steady_clock::now() < end) {
+    x = x + 1;
+  }
+  return x;
+}
+} // namespace
+
+TEST(TestProfiler, TestDump) {
+
+  using namespace coco;
+
+  // a thread that exits while profiled is no longer sampled
+  std::thread([]() {
+    Profiler::register_thread(7, "OutgoingDispatcher", 0);
+  }).join();
+
+  std::thread executor([]() {
+    Profiler::register_thread(7, "Executor", 3);
+    spin(300);
+  });
+  Profiler::start(1000);
+  EXPECT_TRUE(Profiler::running());
+  executor.join();
+  Profiler::stop();
+  EXPECT_FALSE(Profiler::running());
+
+  auto filename = "/tmp/coco_test_profile.pb";
+  Profiler::dump(filename, 7);
+  std::ifstream in(filename, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  auto profile = ss.str();
+  std::remove(filename);
+
+  // the labels are only interned for the samples
+  EXPECT_NE(profile.find("samples"), std::string::npos);
+  EXPECT_NE(profile.find("nanoseconds"), std::string::npos);
+  EXPECT_NE(profile.find("role"), std::string::npos);
+  EXPECT_NE(profile.find("Executor"), std::string::npos);
+  EXPECT_EQ(profile.find("OutgoingDispatcher"), std::string::npos);
+
+  // nothing of another coordinator
+  Profiler::dump(filename, 8);
+  std::ifstream other(filename, std::ios::binary);
+  std::stringstream os;
+  os << other.rdbuf();
+  EXPECT_EQ(os.str().find("role"), std::string::npos);
+  std::remove(filename);
+}
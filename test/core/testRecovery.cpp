@@ -0,0 +1,116 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "common/BufferedFileWriter.h"
+#include "core/Recovery.h"
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+namespace {
+
+using namespace coco;
+using key_type = ycsb::ycsb::key;
+using value_type = ycsb::ycsb::value;
+
+class TestDatabase {
+public:
+  TestDatabase() {
+    auto table_id = ycsb::ycsb::tableID;
+    for (auto i = 0u; i < 2; i++) {
+      tables.push_back(
+          std::make_unique<Table<7, key_type, value_type>>(table_id, i));
+    }
+  }
+
+  std::vector<ITable *> local_tables(const Partitioner &partitioner) {
+    std::vector<ITable *> result;
+    for (auto &table : tables) {
+      result.push_back(table.get());
+    }
+    return result;
+  }
+
+  std::vector<std::unique_ptr<ITable>> tables;
+};
+
+value_type make_value(const char *s) {
+  value_type v;
+  v.Y_F01.assign(s);
+  return v;
+}
+
+bool has_value(ITable &table, int k, const char *s) {
+  key_type key(k);
+  auto &value = *static_cast<value_type *>(table.search_value(&key));
+  return value.Y_F01 == make_value(s).Y_F01;
+}
+} // namespace
+
+TEST(TestRecovery, TestReplay) {
+
+  std::string log_path = "/tmp/coco_test_recovery";
+  mkdir(log_path.c_str(), 0755);
+
+  Context context;
+  context.log_path = log_path;
+  context.partitioner = "hash";
+  context.coordinator_num = 1;
+  context.worker_num = 2;
+
+  // the state before the crash
+  TestDatabase before;
+  key_type k1(1), k2(2), k3(3);
+  auto v1 = make_value("checkpoint"), v2 = make_value("v2"),
+       v3 = make_value("v3"), v4 = make_value("torn");
+  before.tables[0]->insert(&k1, &v1);
+  before.tables[0]->search_metadata(&k1).store(5);
+  Checkpoint::write(*before.tables[0],
+                    Checkpoint::file_name(log_path, ycsb::ycsb::tableID, 0),
+                    0);
+
+  std::string bytes;
+  // worker 0: an old write of k1, two epochs
+  RedoLog::append_record(bytes, *before.tables[0], &k1, &v2, 3);
+  RedoLog::append_record(bytes, *before.tables[1], &k2, &v2, 6);
+  RedoLog::append_epoch(bytes, 0);
+  RedoLog::append_record(bytes, *before.tables[1], &k2, &v3, 8);
+  RedoLog::append_epoch(bytes, 1);
+  BufferedFileWriter w0(RedoLog::file_name(log_path, 0, 0).c_str());
+  w0.write(bytes.data(), bytes.size());
+  w0.close();
+
+  bytes.clear();
+  // worker 1: the second epoch is not durable
+  RedoLog::append_record(bytes, *before.tables[1], &k2, &v2, 7);
+  RedoLog::append_record(bytes, *before.tables[0], &k3, &v3, 4);
+  RedoLog::append_epoch(bytes, 0);
+  RedoLog::append_record(bytes, *before.tables[0], &k1, &v4, 10);
+  BufferedFileWriter w1(RedoLog::file_name(log_path, 0, 1).c_str());
+  w1.write(bytes.data(), bytes.size());
+  w1.close();
+
+  TestDatabase after;
+  Recovery<TestDatabase>(0, after, context).run();
+
+  EXPECT_TRUE(has_value(*after.tables[0], 1, "checkpoint"));
+  EXPECT_EQ(after.tables[0]->search_metadata(&k1).load(), 5u);
+  EXPECT_TRUE(has_value(*after.tables[0], 3, "v3"));
+  EXPECT_TRUE(has_value(*after.tables[1], 2, "v2"));
+  EXPECT_EQ(after.tables[1]->search_metadata(&k2).load(), 7u);
+
+  // recovery leaves a checkpoint of what it recovered
+  TestDatabase reloaded;
+  uint64_t epoch;
+  EXPECT_TRUE(Checkpoint::load(
+      *reloaded.tables[1],
+      Checkpoint::file_name(log_path, ycsb::ycsb::tableID, 1), epoch));
+  EXPECT_TRUE(has_value(*reloaded.tables[1], 2, "v2"));
+
+  for (auto i = 0u; i < 2; i++) {
+    unlink(RedoLog::file_name(log_path, 0, i).c_str());
+    unlink(Checkpoint::file_name(log_path, ycsb::ycsb::tableID, i).c_str());
+  }
+  rmdir(log_path.c_str());
+}
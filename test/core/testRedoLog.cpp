@@ -0,0 +1,83 @@
+//
+// Created by Yi Lu on 3/21/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/RedoLog.h"
+#include <gtest/gtest.h>
+
+TEST(TestRedoLog, TestRecord) {
+
+  using namespace coco;
+  using namespace ycsb;
+
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> table(ycsb::ycsb::tableID, 3);
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> replayed(ycsb::ycsb::tableID, 3);
+
+  ycsb::ycsb::key k(42);
+  ycsb::ycsb::value v;
+  v.Y_F01.assign("hello");
+  v.Y_F10.assign("world");
+
+  std::string bytes;
+  RedoLog::append_record(bytes, table, &k, &v, 7);
+  RedoLog::append_epoch(bytes, 1);
+
+  StringPiece piece(bytes);
+  RedoLogRecord record;
+
+  EXPECT_TRUE(RedoLog::next(piece, record));
+  EXPECT_FALSE(record.is_epoch());
+  auto table_id = ycsb::ycsb::tableID;
+  EXPECT_EQ(record.table_id, table_id);
+  EXPECT_EQ(record.partition_id, 3u);
+  EXPECT_EQ(record.commit_ts, 7u);
+  EXPECT_EQ(record.key.size(), sizeof(ycsb::ycsb::key));
+  replayed.deserialize_value(record.key.data(), record.value);
+
+  auto &value = *static_cast<ycsb::ycsb::value *>(replayed.search_value(&k));
+  EXPECT_EQ(value.Y_F01, v.Y_F01);
+  EXPECT_EQ(value.Y_F10, v.Y_F10);
+
+  EXPECT_TRUE(RedoLog::next(piece, record));
+  EXPECT_TRUE(record.is_epoch());
+  EXPECT_EQ(record.commit_ts, 1u);
+
+  EXPECT_FALSE(RedoLog::next(piece, record));
+}
+
+TEST(TestRedoLog, TestTornTail) {
+
+  using namespace coco;
+  using namespace ycsb;
+
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> table(ycsb::ycsb::tableID, 0);
+
+  ycsb::ycsb::key k(1);
+  ycsb::ycsb::value v;
+
+  std::string bytes;
+  RedoLog::append_epoch(bytes, 0);
+  RedoLog::append_record(bytes, table, &k, &v, 1);
+  bytes.resize(bytes.size() - 1);
+
+  StringPiece piece(bytes);
+  RedoLogRecord record;
+
+  EXPECT_TRUE(RedoLog::next(piece, record));
+  EXPECT_TRUE(record.is_epoch());
+  EXPECT_FALSE(RedoLog::next(piece, record));
+}
+
+TEST(TestRedoLog, TestStriping) {
+
+  using coco::RedoLog;
+
+  EXPECT_EQ(RedoLog::file_name("/log", 1, 2), "/log/1_2.log");
+
+  // the streams are striped across the directories
+  std::string dirs = "/nvme0/log, /nvme1/log";
+  EXPECT_EQ(RedoLog::file_name(dirs, 0, 0), "/nvme0/log/0_0.log");
+  EXPECT_EQ(RedoLog::file_name(dirs, 0, 1), "/nvme1/log/0_1.log");
+  EXPECT_EQ(RedoLog::file_name(dirs, 0, 2), "/nvme0/log/0_2.log");
+}
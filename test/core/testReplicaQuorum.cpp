@@ -0,0 +1,57 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/group_commit/ReplicaQuorum.h"
+#include <gtest/gtest.h>
+
+TEST(TestReplicaQuorum, TestMajority) {
+
+  // partition i is on coordinators i % 5, i % 5 + 1 and i % 5 + 2
+  coco::HashReplicatedPartitioner<3> partitioner(0, 5);
+  coco::group_commit::ReplicaQuorum quorum(0, 5, 10, 2, partitioner);
+
+  quorum.start(1);
+  EXPECT_FALSE(quorum.done());
+  // {0, 1, 2} has its master only
+  EXPECT_FALSE(quorum.ack(3, 1));
+  EXPECT_TRUE(quorum.ack(1, 1));
+  quorum.finish();
+  EXPECT_EQ(quorum.partial_epochs(), 1u);
+  EXPECT_EQ(quorum.get_max_lag(), 1u);
+
+  // coordinators 2 and 4 are an epoch behind
+  quorum.start(2);
+  EXPECT_FALSE(quorum.ack(2, 1));
+  EXPECT_FALSE(quorum.ack(4, 1));
+  EXPECT_EQ(quorum.late_acks(), 2u);
+  EXPECT_FALSE(quorum.ack(2, 2));
+  EXPECT_TRUE(quorum.ack(4, 2));
+  quorum.finish();
+  EXPECT_EQ(quorum.partial_epochs(), 2u);
+  EXPECT_EQ(quorum.get_max_lag(), 1u);
+
+  // 1 and 3 are late
+  EXPECT_EQ(quorum.lagging(), 2u);
+  EXPECT_TRUE(quorum.ack(1, 2));
+  EXPECT_TRUE(quorum.ack(3, 2));
+  EXPECT_EQ(quorum.lagging(), 0u);
+}
+
+TEST(TestReplicaQuorum, TestAll) {
+
+  coco::HashReplicatedPartitioner<2> partitioner(0, 3);
+  coco::group_commit::ReplicaQuorum quorum(0, 3, 3, 2, partitioner);
+
+  quorum.start(1);
+  EXPECT_FALSE(quorum.ack(2, 1));
+  EXPECT_TRUE(quorum.ack(1, 1));
+  quorum.finish();
+  EXPECT_EQ(quorum.partial_epochs(), 0u);
+  EXPECT_EQ(quorum.get_max_lag(), 0u);
+
+  // 1 replica is the master alone
+  coco::group_commit::ReplicaQuorum master(0, 3, 3, 1, partitioner);
+  master.start(1);
+  EXPECT_TRUE(master.done());
+}
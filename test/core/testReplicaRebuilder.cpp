@@ -0,0 +1,76 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/ReplicaRebuilder.h"
+#include <gtest/gtest.h>
+
+TEST(TestReplicaRebuilder, TestRebuildsReplicas) {
+  coco::Context context;
+  EXPECT_FALSE(context.rebuilds_replicas());
+  context.rebuild_replicas = "1,12";
+  context.coordinator_id = 12;
+  EXPECT_TRUE(context.rebuilds_replicas());
+  context.coordinator_id = 2;
+  EXPECT_FALSE(context.rebuilds_replicas());
+}
+
+TEST(TestReplicaRebuilder, TestStreamRows) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+
+  auto table_id = ycsb::ycsb::tableID;
+  Table<7, key_type, value_type> master(table_id, 0), replica(table_id, 0);
+
+  for (auto i = 0; i < 1000; i++) {
+    key_type key(i);
+    value_type value;
+    value.Y_F01.assign(std::to_string(i));
+    master.insert(&key, &value);
+    master.search_metadata(&key).store(10);
+  }
+
+  // the replication of a commit to row 3 arrives before the stream
+  key_type replicated_key(3);
+  value_type replicated;
+  replicated.Y_F01.assign("replicated");
+  replica.insert(&replicated_key, &replicated);
+  replica.search_metadata(&replicated_key).store(20);
+
+  std::string rows, block;
+  master.for_each_row(
+      [&](const void *key, ITable::MetaDataType &metadata, void *value) {
+        Checkpoint::append_row(rows, master, key, metadata, value);
+      });
+
+  // the chunk is compressed
+  Message message;
+  auto size = ReplicaRebuilder::new_rows_message(message, master, rows, block);
+  EXPECT_LT(size, rows.size());
+
+  std::string buffer;
+  std::size_t n = 0;
+  for (auto it = message.begin(); it != message.end(); it++) {
+    EXPECT_EQ((*it).get_message_type(),
+              static_cast<uint32_t>(ControlMessage::REBUILD_ROWS));
+    n += ReplicaRebuilder::apply_rows_message(replica, (*it).toStringPiece(),
+                                              buffer);
+  }
+  EXPECT_EQ(n, 1000u);
+
+  for (auto i = 0; i < 1000; i++) {
+    key_type key(i);
+    auto &value = *static_cast<value_type *>(replica.search_value(&key));
+    if (i == 3) {
+      EXPECT_EQ(replica.search_metadata(&key).load(), 20u);
+      EXPECT_EQ(value.Y_F01, FixedString<ycsb::YCSB_FIELD_SIZE>("replicated"));
+    } else {
+      EXPECT_EQ(replica.search_metadata(&key).load(), 10u);
+      EXPECT_EQ(value.Y_F01,
+                FixedString<ycsb::YCSB_FIELD_SIZE>(std::to_string(i)));
+    }
+  }
+}
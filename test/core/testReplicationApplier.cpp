@@ -0,0 +1,86 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "common/Encoder.h"
+#include "common/Message.h"
+#include "core/group_commit/ReplicationApplier.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+namespace {
+
+// a request to partition_id that carries value
+void add_request(coco::Message &message, std::size_t partition_id,
+                 uint32_t value) {
+  coco::Encoder encoder(message.data);
+  encoder << coco::MessagePiece::construct_message_piece_header(
+                 1, coco::MessagePiece::get_header_size() + sizeof(value), 0,
+                 partition_id)
+          << value;
+  message.flush();
+}
+
+uint32_t value_of(coco::MessagePiece piece) {
+  uint32_t value;
+  coco::Decoder dec(piece.toStringPiece());
+  dec >> value;
+  return value;
+}
+} // namespace
+
+TEST(TestReplicationApplier, TestApply) {
+
+  // coordinator 0 masters partitions 0, 2 and 4, and replicates 1, 3 and 5
+  coco::HashReplicatedPartitioner<2> partitioner(0, 2);
+  coco::group_commit::ReplicationApplier applier(2, 6, partitioner);
+  EXPECT_EQ(applier.owner(1), 0u);
+  EXPECT_EQ(applier.owner(3), 1u);
+  EXPECT_EQ(applier.owner(5), 0u);
+
+  coco::Message m0, m1;
+  add_request(m0, 3, 1);
+  add_request(m0, 1, 2);
+  add_request(m0, 3, 3);
+  add_request(m1, 3, 4);
+  for (auto it = m0.begin(); it != m0.end(); it++) {
+    applier.stage(0, *it);
+  }
+  for (auto it = m1.begin(); it != m1.end(); it++) {
+    applier.stage(1, *it);
+  }
+
+  // the requests of a worker are in the order they were staged
+  std::vector<uint32_t> values;
+  auto apply = [&values](coco::MessagePiece piece) {
+    values.push_back(value_of(piece));
+  };
+  EXPECT_EQ(applier.apply(1, apply), 3u);
+  EXPECT_EQ(values, std::vector<uint32_t>({1, 3, 4}));
+  values.clear();
+  EXPECT_EQ(applier.apply(0, apply), 1u);
+  EXPECT_EQ(values, std::vector<uint32_t>({2}));
+  EXPECT_EQ(applier.apply(1, apply), 0u);
+}
+
+TEST(TestReplicationApplier, TestWaitStaged) {
+
+  coco::HashReplicatedPartitioner<2> partitioner(0, 2);
+  coco::group_commit::ReplicationApplier applier(4, 8, partitioner);
+
+  // no worker applies an epoch before every worker has staged it
+  std::atomic<int> n_staged(0);
+  std::vector<std::thread> workers;
+  for (auto i = 0; i < 4; i++) {
+    workers.emplace_back([&applier, &n_staged]() {
+      for (auto epoch = 1u; epoch <= 100; epoch++) {
+        n_staged.fetch_add(1);
+        applier.wait4_staged(epoch);
+        EXPECT_GE(n_staged.load(), static_cast<int>(epoch * 4));
+      }
+    });
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+}
@@ -0,0 +1,54 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/RequestCombiner.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(TestRequestCombiner, TestCombine) {
+
+  using namespace coco;
+
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> table(ycsb::ycsb::tableID, 3);
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> other(ycsb::ycsb::tableID, 4);
+
+  ycsb::ycsb::key k(42), l(43);
+  RequestCombiner combiner;
+
+  // the first read sends, the next ones of the row wait for it
+  EXPECT_TRUE(combiner.read(table, &k, ~0ull, {0, 5}));
+  EXPECT_FALSE(combiner.read(table, &k, ~0ull, {1, 2}));
+  EXPECT_FALSE(combiner.read(table, &k, ~0ull, {3, 0}));
+  // another row, another partition or other fields are not combined
+  EXPECT_TRUE(combiner.read(table, &l, ~0ull, {1, 3}));
+  EXPECT_TRUE(combiner.read(other, &k, ~0ull, {2, 0}));
+  EXPECT_TRUE(combiner.read(table, &k, 1, {2, 1}));
+  EXPECT_EQ(combiner.size(), 4u);
+  EXPECT_EQ(combiner.get_requests(), 4u);
+  EXPECT_EQ(combiner.get_combined(), 2u);
+
+  std::vector<std::pair<std::size_t, uint32_t>> reads;
+  auto collect = [&reads](RequestCombiner::Read r) {
+    reads.emplace_back(r.coroutine_id, r.key_offset);
+  };
+
+  // a read that is not the first one of its row has no response of its own
+  combiner.respond({1, 2}, collect);
+  EXPECT_TRUE(reads.empty());
+
+  combiner.respond({0, 5}, collect);
+  ASSERT_EQ(reads.size(), 2u);
+  EXPECT_EQ(reads[0], std::make_pair(std::size_t(1), 2u));
+  EXPECT_EQ(reads[1], std::make_pair(std::size_t(3), 0u));
+  EXPECT_EQ(combiner.size(), 3u);
+
+  // the row is no longer in flight, the next read sends again
+  EXPECT_TRUE(combiner.read(table, &k, ~0ull, {0, 6}));
+
+  reads.clear();
+  combiner.respond({1, 3}, collect);
+  EXPECT_TRUE(reads.empty());
+  EXPECT_EQ(combiner.size(), 3u);
+}
@@ -0,0 +1,43 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/RetryCache.h"
+#include <gtest/gtest.h>
+
+TEST(TestRetryCache, TestRows) {
+
+  using namespace coco;
+
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> table(ycsb::ycsb::tableID, 3);
+  Table<1, ycsb::ycsb::key, ycsb::ycsb::value> other(ycsb::ycsb::tableID, 4);
+
+  ycsb::ycsb::key k(42);
+  ycsb::ycsb::value v, read;
+  v.Y_F01.assign("hello");
+
+  RetryCache cache;
+  uint64_t tid = 0;
+  EXPECT_FALSE(cache.get(table, &k, &read, tid));
+
+  cache.put(table, &k,
+            StringPiece(reinterpret_cast<const char *>(&v), sizeof(v)), 7);
+  EXPECT_TRUE(cache.get(table, &k, &read, tid));
+  EXPECT_EQ(tid, 7u);
+  EXPECT_EQ(read.Y_F01, v.Y_F01);
+
+  // the same key of another partition is another row
+  EXPECT_FALSE(cache.get(other, &k, &read, tid));
+  EXPECT_EQ(cache.get_hits(), 1u);
+  EXPECT_EQ(cache.get_misses(), 2u);
+
+  // the row of a conflict is read again
+  cache.erase(table, &k);
+  EXPECT_FALSE(cache.get(table, &k, &read, tid));
+
+  cache.put(table, &k,
+            StringPiece(reinterpret_cast<const char *>(&v), sizeof(v)), 8);
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0u);
+}
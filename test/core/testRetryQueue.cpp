@@ -0,0 +1,88 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/RetryQueue.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestRetryQueue, TestBackoff) {
+
+  coco::RetryQueue<int> retries(4, 10, 100);
+
+  EXPECT_EQ(retries.max_delay(1), 10u);
+  EXPECT_EQ(retries.max_delay(2), 20u);
+  EXPECT_EQ(retries.max_delay(4), 80u);
+  EXPECT_EQ(retries.max_delay(5), 100u);
+  EXPECT_EQ(retries.max_delay(64), 100u);
+
+  coco::AbortHistory history;
+  history.abort("a");
+  history.abort("a");
+  EXPECT_EQ(history.n_aborts, 2u);
+  history.abort("b");
+  EXPECT_EQ(history.n_aborts, 1u);
+  history.clear();
+  history.abort("b");
+  EXPECT_EQ(history.n_aborts, 1u);
+
+  // without --deferred_retries, the worker never waits for the queue
+  coco::RetryQueue<int> none(0, 10, 100);
+  EXPECT_FALSE(none.full());
+}
+
+TEST(TestRetryQueue, TestDefer) {
+
+  coco::RetryQueue<int> retries(2, 1000, 1000);
+  coco::RetryQueue<int>::Retry retry;
+  coco::AbortHistory history;
+  history.abort("a");
+
+  EXPECT_FALSE(retries.pop(retry));
+  retries.defer(std::make_unique<int>(1), history);
+  retries.defer(std::make_unique<int>(2), history);
+  EXPECT_TRUE(retries.full());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  std::vector<int> popped;
+  while (retries.pop(retry)) {
+    popped.push_back(*retry.txn);
+    EXPECT_EQ(retry.history.n_aborts, 1u);
+    EXPECT_EQ(retry.history.conflict, "a");
+  }
+  std::sort(popped.begin(), popped.end());
+  EXPECT_EQ(popped, std::vector<int>({1, 2}));
+  EXPECT_TRUE(retries.empty());
+
+  // the transactions still waiting are dropped by clear
+  coco::RetryQueue<int> slow(1, 1000000, 1000000, 1);
+  for (auto i = 0; i < 20; i++) {
+    history.abort("a");
+  }
+  slow.defer(std::make_unique<int>(3), history);
+  std::size_t n = 0;
+  slow.clear([&n](std::unique_ptr<int> p) { n += *p; });
+  EXPECT_EQ(n, 3u);
+  EXPECT_EQ(slow.dropped(), 1u);
+  EXPECT_EQ(slow.deferred(), 1u);
+}
+
+TEST(TestRetryQueue, TestPriority) {
+
+  coco::RetryQueue<int> retries(0, 100, 100);
+  coco::RetryQueue<int>::Retry retry;
+  coco::AbortHistory history;
+  history.abort("a");
+
+  retries.defer(std::make_unique<int>(1), history);
+  retries.defer(std::make_unique<int>(2), history, 2);
+  retries.defer(std::make_unique<int>(3), history, 1);
+
+  // once their backoffs passed, the higher classes go first
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::vector<int> popped;
+  while (retries.pop(retry)) {
+    popped.push_back(*retry.txn);
+  }
+  EXPECT_EQ(popped, std::vector<int>({2, 3, 1}));
+}
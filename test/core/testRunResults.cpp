@@ -0,0 +1,53 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/RunResults.h"
+#include <gtest/gtest.h>
+
+TEST(TestRunResults, TestJson) {
+
+  using namespace coco;
+
+  Context context;
+  context.coordinator_num = 2;
+  context.flags = {{"protocol", "string", "Silo"},
+                   {"threads", "int32", "4"},
+                   {"numa", "bool", "false"}};
+
+  RunResults results(context);
+  Statistics s;
+  s.n_commit = 100;
+  s.n_abort_lock = 3;
+  s.latency.add(10);
+  results.add_second(1, false, s);
+  results.add_second(2, true, s);
+  results.set_total(s, 2);
+  results.add_phase(0, "1s hot=0.5", s, 1);
+  results.set_node_commits({30, 20});
+
+  auto json = results.to_json();
+  EXPECT_EQ(json.find("{\"config\":{\"protocol\":\"Silo\",\"threads\":4,"
+                      "\"numa\":false},\"coordinator_num\":2"),
+            0u);
+  EXPECT_NE(json.find("{\"second\":1,\"measured\":false,\"commit\":100,"
+                      "\"abort\":3,\"abort_no_retry\":0,\"abort_lock\":3,"),
+            std::string::npos);
+  EXPECT_NE(json.find("{\"second\":2,\"measured\":true,"), std::string::npos);
+  EXPECT_NE(json.find("\"total\":{\"seconds\":2,\"commit_per_second\":50,"),
+            std::string::npos);
+  EXPECT_NE(json.find("\"phases\":[\n{\"phase\":0,\"description\":\"1s "
+                      "hot=0.5\",\"seconds\":1,\"commit_per_second\":100,"),
+            std::string::npos);
+  EXPECT_NE(json.find("\"latency_us\":{\"p50\":10,"), std::string::npos);
+  EXPECT_NE(json.find("\"phase_us\":{\"execute\":0,"), std::string::npos);
+  EXPECT_NE(json.find("\"nodes\":[{\"id\":0,\"commit_per_second\":30},"
+                      "{\"id\":1,\"commit_per_second\":20}]}"),
+            std::string::npos);
+}
+
+TEST(TestRunResults, TestQuote) {
+
+  EXPECT_EQ(coco::RunResults::quote("a;b"), "\"a;b\"");
+  EXPECT_EQ(coco::RunResults::quote("\"\\\n"), "\"\\\"\\\\\\u000a\"");
+}
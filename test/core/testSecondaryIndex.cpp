@@ -0,0 +1,125 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/SecondaryIndex.h"
+#include <gtest/gtest.h>
+#include <tuple>
+
+namespace {
+
+using namespace coco;
+using namespace tpcc;
+
+customer::value make_customer(const std::string &first,
+                              const std::string &last) {
+  customer::value value;
+  value.C_FIRST.assign(first);
+  value.C_LAST.assign(last);
+  return value;
+}
+} // namespace
+
+TEST(TestSecondaryIndex, TestUnique) {
+
+  Table<997, customer::key, customer::value> table(customer::tableID, 0);
+  Table<997, customer_name_idx::key, customer_name_idx::value> index(
+      customer_name_idx::tableID, 0);
+
+  SecondaryIndex<customer::key, customer::value, customer_name_idx::key,
+                 customer_name_idx::value>
+      name_idx(table, index,
+               [](const customer::key &key, const customer::value &value,
+                  customer_name_idx::key &index_key,
+                  customer_name_idx::value &index_value) {
+                 index_key = customer_name_idx::key(key.C_W_ID, key.C_D_ID,
+                                                    value.C_LAST);
+                 index_value.C_ID = key.C_ID;
+               });
+
+  customer::key key(1, 1, 7);
+  auto value = make_customer("ALICE", "BARBAR");
+  table.insert(&key, &value);
+
+  customer_name_idx::key barbar(1, 1, value.C_LAST);
+  EXPECT_EQ(static_cast<customer_name_idx::value *>(index.search_value(&barbar))
+                ->C_ID,
+            7);
+
+  // a write of the other fields leaves the entry
+  value.C_BALANCE = 10;
+  table.update(&key, &value);
+  EXPECT_EQ(static_cast<customer_name_idx::value *>(index.search_value(&barbar))
+                ->C_ID,
+            7);
+
+  // the entry moves with the indexed field, including on replicas
+  auto renamed = make_customer("ALICE", "OUGHTABLE");
+  auto mask = table.changed_fields(&key, &renamed);
+  std::string bytes;
+  Encoder enc(bytes);
+  table.serialize_fields(enc, &renamed, mask);
+  table.deserialize_fields(&key, enc.toStringPiece(), mask);
+
+  customer_name_idx::key oughtable(1, 1, renamed.C_LAST);
+  EXPECT_EQ(
+      static_cast<customer_name_idx::value *>(index.search_value(&oughtable))
+          ->C_ID,
+      7);
+
+  std::size_t n_entries = 0;
+  index.for_each_row([&](const void *, ITable::MetaDataType &, void *) {
+    n_entries++;
+  });
+  EXPECT_EQ(n_entries, 1u);
+}
+
+TEST(TestSecondaryIndex, TestOrdered) {
+
+  // (C_W_ID, C_D_ID, C_LAST, C_FIRST, C_ID) -> C_ID
+  using IndexKeyType = std::tuple<int32_t, int32_t, FixedString<16>,
+                                  FixedString<16>, int32_t>;
+
+  Table<997, customer::key, customer::value> table(customer::tableID, 0);
+  OrderedTable<IndexKeyType, int32_t> index(customer_name_idx::tableID, 0);
+
+  SecondaryIndex<customer::key, customer::value, IndexKeyType, int32_t>
+      name_idx(table, index,
+               [](const customer::key &key, const customer::value &value,
+                  IndexKeyType &index_key, int32_t &index_value) {
+                 index_key = IndexKeyType(key.C_W_ID, key.C_D_ID, value.C_LAST,
+                                          value.C_FIRST, key.C_ID);
+                 index_value = key.C_ID;
+               });
+
+  const char *firsts[] = {"CAROL", "ALICE", "BOB"};
+  for (auto i = 0; i < 3; i++) {
+    customer::key key(1, 1, i + 1);
+    auto value = make_customer(firsts[i], "BARBAR");
+    table.insert(&key, &value);
+  }
+  customer::key other(1, 1, 4);
+  auto value = make_customer("DAVE", "ABLE");
+  table.insert(&other, &value);
+
+  auto customers = [&index](const std::string &last) {
+    FixedString<16> name(last), none, max(std::string(16, '~'));
+    IndexKeyType start(1, 1, name, none, 0), end(1, 1, name, max, 0);
+    std::vector<int32_t> ids;
+    index.scan(&start, &end,
+               [&ids](const void *, ITable::MetaDataType &, void *value) {
+                 ids.push_back(*static_cast<int32_t *>(value));
+                 return true;
+               });
+    return ids;
+  };
+
+  // ordered by first name
+  EXPECT_EQ(customers("BARBAR"), std::vector<int32_t>({2, 3, 1}));
+
+  value = make_customer("DAVE", "BARBAR");
+  table.update(&other, &value);
+  EXPECT_EQ(customers("BARBAR"), std::vector<int32_t>({2, 3, 1, 4}));
+  EXPECT_TRUE(customers("ABLE").empty());
+}
@@ -0,0 +1,96 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/ycsb/Schema.h"
+#include "core/Snapshot.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestSnapshot, TestVersions) {
+
+  using namespace coco;
+
+  SnapshotVersions versions(sizeof(int), sizeof(int));
+  int key = 1, value = 10, found = 0;
+  EXPECT_FALSE(versions.find(&key, &found));
+
+  // the first write since the pin wins
+  versions.save(&key, &value);
+  value = 20;
+  versions.save(&key, &value);
+  EXPECT_TRUE(versions.find(&key, &found));
+  EXPECT_EQ(found, 10);
+  EXPECT_EQ(versions.size(), 1u);
+}
+
+TEST(TestSnapshot, TestPin) {
+
+  using namespace coco;
+  using key_type = ycsb::ycsb::key;
+  using value_type = ycsb::ycsb::value;
+
+  auto table_id = ycsb::ycsb::tableID;
+  Table<7, key_type, value_type> table(table_id, 0);
+
+  for (auto i = 0; i < 100; i++) {
+    key_type key(i);
+    value_type value;
+    value.Y_F01.assign(std::to_string(i));
+    table.insert(&key, &value);
+  }
+
+  Snapshot snapshot;
+  snapshot.set_tables({&table});
+
+  // the manager pins the snapshot at a boundary
+  std::atomic<bool> stopFlag(false), done(false);
+  std::thread manager([&]() {
+    while (!done.load()) {
+      snapshot.on_epoch_boundary();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  auto boundary = snapshot.pin(stopFlag);
+  done.store(true);
+  manager.join();
+  EXPECT_GT(boundary, 0);
+  EXPECT_TRUE(snapshot.is_pinned());
+  EXPECT_NE(table.get_snapshot_versions(), nullptr);
+
+  // writers commit on top of the snapshot
+  for (auto i = 0; i < 100; i += 2) {
+    key_type key(i);
+    value_type value;
+    value.Y_F01.assign("updated");
+    table.update(&key, &value);
+    table.update(&key, &value);
+  }
+  EXPECT_EQ(snapshot.saved_versions(), 50u);
+
+  key_type key(42);
+  value_type value;
+  snapshot.read(table, &key, &value);
+  EXPECT_EQ(value.Y_F01, FixedString<ycsb::YCSB_FIELD_SIZE>("42"));
+  EXPECT_EQ(static_cast<value_type *>(table.search_value(&key))->Y_F01,
+            FixedString<ycsb::YCSB_FIELD_SIZE>("updated"));
+
+  std::size_t n_rows = 0;
+  snapshot.for_each_row(table, [&](const void *key, const void *value) {
+    auto i = static_cast<const key_type *>(key)->Y_KEY;
+    EXPECT_EQ(static_cast<const value_type *>(value)->Y_F01,
+              FixedString<ycsb::YCSB_FIELD_SIZE>(std::to_string(i)));
+    n_rows++;
+  });
+  EXPECT_EQ(n_rows, 100u);
+
+  // the saved values are dropped at the next boundary
+  snapshot.unpin();
+  snapshot.on_epoch_boundary();
+  EXPECT_FALSE(snapshot.is_pinned());
+  EXPECT_EQ(table.get_snapshot_versions(), nullptr);
+
+  // a query stops waiting for a pin once stopped
+  stopFlag.store(true);
+  EXPECT_EQ(snapshot.pin(stopFlag), -1);
+}
@@ -0,0 +1,66 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/SplitCounters.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Database {
+  coco::ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    return table;
+  }
+  coco::ITable *table;
+};
+
+} // namespace
+
+TEST(TestSplitCounters, TestSplitAndMerge) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<10, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  table.set_additive_fields(1ull << warehouse::value::W_YTD_field);
+  Database db{&table};
+
+  warehouse::key key(1);
+  warehouse::value value;
+  value.W_YTD = 300000;
+  table.insert(&key, &value);
+  auto &row = *static_cast<warehouse::value *>(table.search_value(&key));
+
+  HashPartitioner partitioner(0, 1);
+  std::vector<std::unique_ptr<Message>> messages;
+  messages.emplace_back(std::make_unique<Message>());
+
+  SplitCounters counters(2);
+  AdditionKey addition{warehouse::tableID, 0, &key,
+                       warehouse::value::W_YTD_field, FieldAddition(10.0f)};
+
+  // the row is not split yet, the caller applies the additions
+  EXPECT_FALSE(counters.add(addition, table));
+  EXPECT_FALSE(counters.add(addition, table));
+  EXPECT_EQ(counters.merge(0, db, partitioner, messages), 0u);
+  EXPECT_EQ(counters.n_split(), 1u);
+
+  // the next group adds to the slice, the row sees it once merged
+  warehouse::key copy(1);
+  addition.key = &copy;
+  EXPECT_TRUE(counters.add(addition, table));
+  EXPECT_TRUE(counters.add(addition, table));
+  EXPECT_TRUE(counters.add(addition, table));
+  EXPECT_EQ(row.W_YTD, 300000);
+  counters.merge(0, db, partitioner, messages);
+  EXPECT_EQ(row.W_YTD, 300030);
+  EXPECT_EQ(counters.get_merged(), 1u);
+
+  // a row no longer hot is joined
+  EXPECT_TRUE(counters.add(addition, table));
+  counters.merge(0, db, partitioner, messages);
+  EXPECT_EQ(row.W_YTD, 300040);
+  EXPECT_EQ(counters.n_split(), 0u);
+  EXPECT_FALSE(counters.add(addition, table));
+}
@@ -0,0 +1,95 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/StaleReads.h"
+#include "protocol/Silo/SiloHelper.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+struct FakeDatabase {
+  coco::ITable *find_table(std::size_t table_id, std::size_t partition_id) {
+    return tables[partition_id];
+  }
+
+  std::vector<coco::ITable *> tables;
+};
+} // namespace
+
+TEST(TestStaleReads, TestBound) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  // coordinator 0 of 3 masters partition 0, has a replica of partition 2 and
+  // no copy of partition 1
+  HashReplicatedPartitioner<2> partitioner(0, 3);
+  ASSERT_TRUE(partitioner.has_master_partition(0));
+  ASSERT_TRUE(partitioner.is_partition_replicated_on_me(2));
+  ASSERT_FALSE(partitioner.is_partition_replicated_on_me(1));
+
+  Table<1, warehouse::key, warehouse::value> table0(warehouse::tableID, 0),
+      table1(warehouse::tableID, 1), table2(warehouse::tableID, 2);
+  FakeDatabase db;
+  db.tables = {&table0, &table1, &table2};
+
+  warehouse::key key(1);
+  warehouse::value value, result;
+  value.W_YTD = 10;
+  table0.insert(&key, &value);
+  table2.insert(&key, &value);
+
+  StaleReads reads;
+  reads.start_epoch(5);
+  reads.apply_epoch(3);
+  EXPECT_EQ(reads.staleness(), 2u);
+
+  EXPECT_EQ(reads.read(db, partitioner, warehouse::tableID, 1, &key, &result,
+                       10),
+            StaleReads::Status::NOT_REPLICATED);
+  EXPECT_EQ(reads.read(db, partitioner, warehouse::tableID, 2, &key, &result,
+                       1),
+            StaleReads::Status::STALE);
+
+  // a master copy is never behind
+  EXPECT_EQ(reads.read(db, partitioner, warehouse::tableID, 0, &key, &result,
+                       0),
+            StaleReads::Status::OK);
+  EXPECT_EQ(result.W_YTD, 10);
+
+  result.W_YTD = 0;
+  EXPECT_EQ(reads.read(db, partitioner, warehouse::tableID, 2, &key, &result,
+                       2),
+            StaleReads::Status::OK);
+  EXPECT_EQ(result.W_YTD, 10);
+
+  reads.apply_epoch(5);
+  EXPECT_EQ(reads.staleness(), 0u);
+}
+
+TEST(TestStaleReads, TestTombstone) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  HashReplicatedPartitioner<2> partitioner(0, 3);
+  Table<1, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  table.set_tombstone(SiloHelper::tombstone());
+  FakeDatabase db;
+  db.tables = {&table};
+
+  StaleReads reads;
+  warehouse::key key(1);
+  warehouse::value result;
+  EXPECT_EQ(reads.read(db, partitioner, warehouse::tableID, 0, &key, &result,
+                       0),
+            StaleReads::Status::NOT_FOUND);
+
+  // once inserted, the row is read
+  table.search_metadata(&key).store(SiloHelper::write_tid(5, false));
+  EXPECT_EQ(reads.read(db, partitioner, warehouse::tableID, 0, &key, &result,
+                       0),
+            StaleReads::Status::OK);
+}
@@ -0,0 +1,127 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/Statistics.h"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(TestStatistics, TestEncodeAndMerge) {
+
+  coco::Statistics a, b;
+  a.n_commit = 10;
+  a.n_abort_lock = 3;
+  a.phase_time[static_cast<int>(coco::TransactionPhase::EXECUTE)] = 20000;
+  b.n_commit = 30;
+  b.n_abort_read_validation = 2;
+  b.n_network_size = 100;
+  b.phase_time[static_cast<int>(coco::TransactionPhase::EXECUTE)] = 60000;
+  b.phase_time[static_cast<int>(coco::TransactionPhase::WRITE)] = 40000;
+  b.phase_events[static_cast<int>(coco::TransactionPhase::LOCK)]
+                [static_cast<int>(coco::PerfEvent::CYCLES)] = 8000;
+  for (auto i = 0; i < 100; i++) {
+    a.latency.add(i);
+    b.latency.add(1000 + i);
+  }
+
+  std::string bytes;
+  coco::Encoder encoder(bytes);
+  b.encode(encoder);
+  EXPECT_EQ(encoder.size(), b.encoded_size());
+
+  coco::Decoder dec(encoder.toStringPiece());
+  a.decode_and_merge(dec);
+  EXPECT_EQ(dec.size(), 0u);
+
+  EXPECT_EQ(a.n_commit, 40u);
+  EXPECT_EQ(a.n_abort(), 5u);
+  EXPECT_EQ(a.n_network_size, 100u);
+  EXPECT_EQ(a.latency.size(), 200u);
+  EXPECT_EQ(a.latency.nth(50), 99);
+  EXPECT_DOUBLE_EQ(a.phase_us(coco::TransactionPhase::EXECUTE), 2.0);
+  EXPECT_DOUBLE_EQ(a.phase_us(coco::TransactionPhase::WRITE), 1.0);
+  EXPECT_DOUBLE_EQ(a.phase_us(coco::TransactionPhase::LOCK), 0.0);
+  EXPECT_DOUBLE_EQ(a.phase_events_per_txn(coco::TransactionPhase::LOCK,
+                                          coco::PerfEvent::CYCLES),
+                   200.0);
+  EXPECT_DOUBLE_EQ(a.phase_events_per_txn(coco::TransactionPhase::LOCK,
+                                          coco::PerfEvent::LLC_MISSES),
+                   0.0);
+}
+
+TEST(TestStatistics, TestPhaseTimer) {
+
+  coco::PhaseTimer timer;
+  timer.start();
+  timer.end(coco::TransactionPhase::EXECUTE);
+  timer.end(coco::TransactionPhase::LOCK);
+  EXPECT_EQ(timer.times[static_cast<int>(coco::TransactionPhase::VALIDATE)],
+            0u);
+
+  timer.clear();
+  for (auto i = 0u; i < coco::N_TRANSACTION_PHASES; i++) {
+    EXPECT_EQ(timer.times[i], 0u);
+    for (auto k = 0u; k < coco::N_PERF_EVENTS; k++) {
+      EXPECT_EQ(timer.events[i][k], 0u);
+    }
+  }
+}
+
+TEST(TestStatistics, TestPhaseEvents) {
+
+  coco::PerfCounters::open_thread_counters();
+  auto counters = coco::PerfCounters::thread_counters();
+  ASSERT_NE(counters, nullptr);
+  if (!counters->is_open()) {
+    // perf_event_open is not allowed here
+    return;
+  }
+
+  coco::PhaseTimer timer;
+  timer.start();
+  volatile uint64_t sum = 0;
+  for (auto i = 0; i < 1000000; i++) {
+    sum += i;
+  }
+  timer.end(coco::TransactionPhase::EXECUTE);
+
+  auto execute = static_cast<int>(coco::TransactionPhase::EXECUTE);
+  auto &events = timer.events[execute];
+  EXPECT_GT(events[static_cast<int>(coco::PerfEvent::CYCLES)], 0u);
+  EXPECT_GE(events[static_cast<int>(coco::PerfEvent::INSTRUCTIONS)], 1000000u);
+}
+
+TEST(TestStatistics, TestProcedures) {
+
+  coco::Statistics a, b;
+  a.procedures[0].n_abort_lock = 2;
+  b.procedures[0].n_abort_read_validation = 1;
+  b.procedures[16].n_abort_no_retry = 4;
+  for (auto i = 0; i < 10; i++) {
+    a.procedures[0].latency.add(10);
+    b.procedures[0].latency.add(20);
+    b.procedures[16].latency.add(1000);
+  }
+
+  std::string bytes;
+  coco::Encoder encoder(bytes);
+  b.encode(encoder);
+  EXPECT_EQ(encoder.size(), b.encoded_size());
+
+  coco::Decoder dec(encoder.toStringPiece());
+  a.decode_and_merge(dec);
+  EXPECT_EQ(dec.size(), 0u);
+
+  ASSERT_EQ(a.procedures.size(), 2u);
+  auto &new_order = a.procedures[0];
+  EXPECT_EQ(new_order.n_commit(), 20u);
+  EXPECT_EQ(new_order.n_abort(), 3u);
+  EXPECT_EQ(new_order.latency.nth(99), 20);
+  auto &procedure = a.procedures[16];
+  EXPECT_EQ(procedure.n_commit(), 10u);
+  EXPECT_EQ(procedure.n_abort_no_retry, 4u);
+  EXPECT_EQ(procedure.latency.nth(50), 1000);
+
+  a.clear();
+  EXPECT_TRUE(a.procedures.empty());
+}
@@ -0,0 +1,84 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "core/Sweep.h"
+#include <gtest/gtest.h>
+#include <map>
+
+TEST(TestSweep, TestExpand) {
+
+  using namespace coco;
+
+  EXPECT_EQ(Sweep::expand("1, 2,4"), (std::vector<std::string>{"1", "2", "4"}));
+  EXPECT_EQ(Sweep::expand("1..12"),
+            (std::vector<std::string>{"1", "2", "4", "8"}));
+  EXPECT_EQ(Sweep::expand("0..100+25"),
+            (std::vector<std::string>{"0", "25", "50", "75", "100"}));
+  EXPECT_EQ(Sweep::expand("0.5..0.9+0.2"),
+            (std::vector<std::string>{"0.5", "0.7", "0.9"}));
+}
+
+TEST(TestSweep, TestPoints) {
+
+  using namespace coco;
+
+  EXPECT_FALSE(Sweep("").enabled());
+  EXPECT_EQ(Sweep("").size(), 1u);
+
+  Sweep sweep("partition_num=2,4; threads=1..4");
+  EXPECT_TRUE(sweep.enabled());
+  ASSERT_EQ(sweep.size(), 6u);
+
+  // the last flag varies fastest
+  EXPECT_EQ(sweep.point(0), (std::vector<std::string>{"2", "1"}));
+  EXPECT_EQ(sweep.point(2), (std::vector<std::string>{"2", "4"}));
+  EXPECT_EQ(sweep.point(3), (std::vector<std::string>{"4", "1"}));
+
+  // the tables are loaded again once the partitions change
+  std::vector<std::string> load = {"partition_num"};
+  EXPECT_TRUE(sweep.changes(0, load));
+  EXPECT_FALSE(sweep.changes(1, load));
+  EXPECT_FALSE(sweep.changes(2, load));
+  EXPECT_TRUE(sweep.changes(3, load));
+  EXPECT_FALSE(sweep.changes(4, load));
+
+  std::map<std::string, std::string> flags;
+  sweep.apply(5, [&flags](const char *flag, const char *value) {
+    flags[flag] = value;
+    return std::string(value);
+  });
+  EXPECT_EQ(flags["partition_num"], "4");
+  EXPECT_EQ(flags["threads"], "4");
+}
+
+TEST(TestSweep, TestResults) {
+
+  using namespace coco;
+
+  Sweep sweep("threads=1,2");
+  Statistics s;
+  s.n_commit = 100;
+  s.n_abort_lock = 25;
+  s.latency.add(10);
+  sweep.add_run(0, true, s, 2);
+  s.n_commit = 300;
+  sweep.add_run(1, false, s, 2);
+
+  auto json = sweep.to_json();
+  EXPECT_EQ(json.find("{\"flags\":[\"threads\"],\n\"runs\":[\n"
+                      "{\"point\":{\"threads\":\"1\"},\"reloaded\":true,"
+                      "\"seconds\":2,\"commit_per_second\":50,\"scaling\":1,"
+                      "\"abort_rate\":0.2,\"latency_us\":{\"p50\":10,"),
+            0u);
+  EXPECT_NE(json.find("{\"point\":{\"threads\":\"2\"},\"reloaded\":false,"
+                      "\"seconds\":2,\"commit_per_second\":150,\"scaling\":3,"),
+            std::string::npos);
+
+  auto table = sweep.to_table();
+  EXPECT_EQ(table.substr(0, table.find('\n')),
+            "threads  reload  commit/s  scaling  abort%  p50_us  p95_us  "
+            "p99_us  p999_us");
+  EXPECT_NE(table.find("\n2        no      150       3.00     7.69    10"),
+            std::string::npos);
+}
@@ -3,8 +3,10 @@
 //
 
 #include "benchmark/tpcc/Schema.h"
+#include "core/MemoryReport.h"
 #include "core/Table.h"
 #include <gtest/gtest.h>
+#include <unistd.h>
 
 TEST(TestTable, TestTPCC) {
 
@@ -49,4 +51,430 @@ TEST(TestTable, TestTPCC) {
                                            sizeof(stock::value::S_YTD) +
                                            sizeof(stock::value::S_ORDER_CNT) +
                                            sizeof(stock::value::S_REMOTE_CNT));
-}
\ No newline at end of file
+}
+TEST(TestTable, TestOrderedTable) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  auto order_line_table_id = order_line::tableID;
+  std::unique_ptr<ITable> order_line_table =
+      std::make_unique<OrderedTable<order_line::key, order_line::value>>(
+          order_line_table_id, 0);
+
+  for (int32_t o_id = 1; o_id <= 100; o_id++) {
+    for (int32_t ol_number = 1; ol_number <= 10; ol_number++) {
+      order_line::key key(1, 1, o_id, ol_number);
+      order_line::value value;
+      value.OL_I_ID = o_id;
+      order_line_table->insert(&key, &value);
+    }
+  }
+
+  // the order lines of orders [91, 101)
+  order_line::key start(1, 1, 91, 0), end(1, 1, 101, 0);
+  ITable::NodeSetType node_set;
+  int n = 0;
+  order_line_table->scan(
+      &start, &end,
+      [&n](const void *key, ITable::MetaDataType &metadata, void *value) {
+        auto &k = *static_cast<const order_line::key *>(key);
+        auto &v = *static_cast<order_line::value *>(value);
+        EXPECT_EQ(v.OL_I_ID, k.OL_O_ID);
+        EXPECT_GE(k.OL_O_ID, 91);
+        n++;
+        return true;
+      },
+      &node_set);
+  EXPECT_EQ(n, 100);
+  EXPECT_FALSE(node_set.empty());
+
+  // a phantom changes one of the node versions
+  order_line::key phantom(1, 1, 95, 11);
+  order_line::value value;
+  order_line_table->insert(&phantom, &value);
+  bool changed = false;
+  for (auto &node : node_set) {
+    changed = changed || std::get<0>(node)->load() != std::get<1>(node);
+  }
+  EXPECT_TRUE(changed);
+}
+
+TEST(TestTable, TestMVCCTablePlaceholder) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  std::unique_ptr<ITable> warehouse_table =
+      std::make_unique<MVCCTable<1, warehouse::key, warehouse::value>>(
+          warehouse::tableID, 0);
+
+  warehouse::key key(1);
+  warehouse::value value;
+  value.W_YTD = 1;
+  warehouse_table->insert(&key, &value);
+  EXPECT_EQ(warehouse_table->search_metadata(&key).load(), 0u);
+
+  // a placeholder is not readable until it is written
+  warehouse_table->insert(&key, &value, 5);
+  EXPECT_EQ(warehouse_table->search_metadata(&key, 5).load(), 5u);
+
+  value.W_YTD = 2;
+  warehouse_table->update(&key, &value, 5);
+  EXPECT_EQ(warehouse_table->search_metadata(&key, 5).load(), 0u);
+
+  auto ytd = [](void *v) { return static_cast<warehouse::value *>(v)->W_YTD; };
+  EXPECT_EQ(ytd(warehouse_table->search_value_prev(&key, 5)), 1);
+  EXPECT_EQ(ytd(warehouse_table->search_value_prev(&key, 6)), 2);
+}
+
+TEST(TestTable, TestDeltaFields) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  std::unique_ptr<ITable> master =
+      std::make_unique<Table<1, district::key, district::value>>(
+          district::tableID, 0);
+  std::unique_ptr<ITable> replica =
+      std::make_unique<Table<1, district::key, district::value>>(
+          district::tableID, 0);
+
+  district::key key(1, 1);
+  district::value value;
+  value.D_NAME.assign("district");
+  value.D_TAX = 0.1;
+  value.D_YTD = 30000;
+  value.D_NEXT_O_ID = 3001;
+  master->insert(&key, &value);
+  replica->insert(&key, &value);
+
+  // a payment and a new order change two fields
+  value.D_YTD += 10;
+  value.D_NEXT_O_ID++;
+  uint64_t mask = master->changed_fields(&key, &value);
+  EXPECT_EQ(mask, (1ull << district::value::D_YTD_field) |
+                      (1ull << district::value::D_NEXT_O_ID_field));
+  EXPECT_EQ(master->fields_size(mask),
+            sizeof(value.D_YTD) + sizeof(value.D_NEXT_O_ID));
+
+  std::string bytes;
+  Encoder enc(bytes);
+  master->serialize_fields(enc, &value, mask);
+  EXPECT_EQ(bytes.size(), master->fields_size(mask));
+  master->update(&key, &value);
+  EXPECT_EQ(master->changed_fields(&key, &value), 0u);
+
+  replica->deserialize_fields(&key, StringPiece(bytes.data(), bytes.size()),
+                              mask);
+  auto &row = *static_cast<district::value *>(replica->search_value(&key));
+  EXPECT_EQ(row, value);
+}
+
+TEST(TestTable, TestProjection) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  std::unique_ptr<ITable> table =
+      std::make_unique<Table<1, customer::key, customer::value>>(
+          customer::tableID, 0);
+
+  customer::key key(1, 1, 1);
+  customer::value value;
+  value.C_FIRST.assign("first");
+  value.C_LAST.assign("last");
+  value.C_DISCOUNT = 0.25;
+  value.C_DATA.assign("data");
+  table->insert(&key, &value);
+
+  // the discount and the last name of a new order
+  uint64_t mask = (1ull << customer::value::C_DISCOUNT_field) |
+                  (1ull << customer::value::C_LAST_field);
+  EXPECT_EQ(table->projection_size(mask),
+            sizeof(value.C_DISCOUNT) + sizeof(value.C_LAST));
+  EXPECT_EQ(table->projection_size(~0ull), sizeof(value));
+
+  std::string bytes(table->projection_size(mask), 0);
+  table->pack_fields(&bytes[0], table->search_value(&key), mask);
+  customer::value remote, local;
+  table->unpack_fields(&remote, bytes.data(), mask);
+  table->copy_fields(&local, table->search_value(&key), mask);
+  for (auto v : {&remote, &local}) {
+    EXPECT_EQ(v->C_DISCOUNT, value.C_DISCOUNT);
+    EXPECT_EQ(v->C_LAST, value.C_LAST);
+    EXPECT_NE(v->C_FIRST, value.C_FIRST);
+    EXPECT_NE(v->C_DATA, value.C_DATA);
+  }
+
+  table->copy_fields(&local, table->search_value(&key), ~0ull);
+  EXPECT_EQ(local, value);
+}
+
+TEST(TestTable, TestAdditiveFields) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  std::unique_ptr<ITable> table =
+      std::make_unique<Table<1, district::key, district::value>>(
+          district::tableID, 0);
+  table->set_additive_fields(1ull << district::value::D_YTD_field);
+
+  district::key key(1, 1);
+  district::value value;
+  value.D_YTD = 30000;
+  value.D_NEXT_O_ID = 3001;
+  table->insert(&key, &value);
+
+  // two payments add to D_YTD, the tid stays the same
+  auto tid = table->search_metadata(&key).load();
+  table->add_to_field(&key, district::value::D_YTD_field,
+                      FieldAddition(10.0f));
+  table->add_to_field(&key, district::value::D_YTD_field,
+                      FieldAddition(5.0f));
+  auto &row = *static_cast<district::value *>(table->search_value(&key));
+  EXPECT_EQ(row.D_YTD, 30015);
+  EXPECT_EQ(table->search_metadata(&key).load(), tid);
+
+  // a new order read the row before the additions, its write keeps them
+  value.D_NEXT_O_ID++;
+  table->update(&key, &value);
+  EXPECT_EQ(row.D_YTD, 30015);
+  EXPECT_EQ(row.D_NEXT_O_ID, 3002);
+
+  std::string bytes;
+  Encoder enc(bytes);
+  enc << FieldAddition(int64_t(-7));
+  FieldAddition addition;
+  Decoder dec(StringPiece(bytes.data(), bytes.size()));
+  dec >> addition;
+  EXPECT_EQ(addition.size(), sizeof(int64_t));
+  int64_t counter = 10;
+  addition.apply(&counter);
+  EXPECT_EQ(counter, 3);
+}
+
+TEST(TestTable, TestMemoryUsage) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  auto usage = [](ITable &table) {
+    for (int32_t w_id = 1; w_id <= 100; w_id++) {
+      warehouse::key key(w_id);
+      warehouse::value value;
+      table.insert(&key, &value, 1);
+    }
+    auto m = table.memory_usage();
+    EXPECT_EQ(m.rows, 100u);
+    EXPECT_EQ(m.payload,
+              m.rows * sizeof(warehouse::key) +
+                  m.versions * sizeof(warehouse::value));
+    // the metadata of the rows at least
+    EXPECT_GE(m.overhead, m.rows * sizeof(ITable::MetaDataType));
+    EXPECT_EQ(m.total(), table.memory_size());
+    return m;
+  };
+
+  Table<1, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  EXPECT_EQ(usage(table).versions, 100u);
+
+  OrderedTable<warehouse::key, warehouse::value> ordered(warehouse::tableID,
+                                                         0);
+  EXPECT_EQ(usage(ordered).versions, 100u);
+
+  // a new version of each row
+  MVCCTable<1, warehouse::key, warehouse::value> mvcc(warehouse::tableID, 0);
+  usage(mvcc);
+  for (int32_t w_id = 1; w_id <= 100; w_id++) {
+    warehouse::key key(w_id);
+    warehouse::value value;
+    mvcc.insert(&key, &value, 2);
+  }
+  auto m = mvcc.memory_usage();
+  EXPECT_EQ(m.rows, 100u);
+  EXPECT_EQ(m.versions, 200u);
+
+  // the partitions of a table add up
+  auto memory = MemoryReport::collect({&table, &ordered, &mvcc});
+  ASSERT_EQ(memory.size(), 1u);
+  auto &m_warehouse = memory.begin()->second;
+  EXPECT_EQ(m_warehouse.first, 3u);
+  EXPECT_EQ(m_warehouse.second.rows, 300u);
+  EXPECT_EQ(m_warehouse.second.versions, 400u);
+}
+
+TEST(TestTable, TestEvictableTable) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  using TableType = EvictableTable<1, warehouse::key, warehouse::value>;
+  TableType table(warehouse::tableID, 0, "/tmp/coco_test_evictable_table");
+  auto &clock = AccessClock::now();
+  clock.store(1);
+  for (int32_t w_id = 1; w_id <= 100; w_id++) {
+    warehouse::key key(w_id);
+    warehouse::value value;
+    value.W_YTD = w_id;
+    table.insert(&key, &value);
+  }
+
+  // the rows accessed in second 2 stay
+  clock.store(2);
+  for (int32_t w_id = 1; w_id <= 10; w_id++) {
+    warehouse::key key(w_id);
+    table.search_value(&key);
+  }
+  EXPECT_EQ(table.evict(2), 90u);
+  EXPECT_EQ(table.evict(2), 0u);
+  EXPECT_EQ(table.memory_usage().rows, 100u);
+  EXPECT_EQ(table.memory_usage().versions, 10u);
+
+  warehouse::key hot(1), cold(50);
+  EXPECT_TRUE(table.is_resident(&hot));
+  EXPECT_FALSE(table.is_resident(&cold));
+
+  // an evicted row is locked and queued
+  auto row = table.search(&cold);
+  uint64_t tid = std::get<0>(row)->load();
+  EXPECT_NE(tid & TableType::LOCK_BIT, 0u);
+  EXPECT_EQ(table.fetch(), 1u);
+  EXPECT_EQ(table.fetch(), 0u);
+  EXPECT_TRUE(table.is_resident(&cold));
+
+  // read back unlocked with a new tid
+  row = table.search(&cold);
+  EXPECT_EQ(std::get<0>(row)->load(), (tid & ~TableType::LOCK_BIT) + 1);
+  EXPECT_EQ(static_cast<warehouse::value *>(std::get<1>(row))->W_YTD, 50);
+  EXPECT_EQ(table.memory_usage().versions, 11u);
+
+  // updates read an evicted row back first
+  warehouse::key other(60);
+  warehouse::value value;
+  value.W_YTD = 1;
+  table.update(&other, &value);
+  EXPECT_TRUE(table.is_resident(&other));
+  EXPECT_EQ(
+      static_cast<warehouse::value *>(table.search_value(&other))->W_YTD, 1);
+
+  std::size_t n = 0;
+  float ytd = 0;
+  table.for_each_row([&](const void *, ITable::MetaDataType &, void *value) {
+    n++;
+    ytd += static_cast<warehouse::value *>(value)->W_YTD;
+  });
+  EXPECT_EQ(n, 100u);
+  EXPECT_EQ(ytd, 5050 - 60 + 1);
+}
+
+TEST(TestTable, TestPersistentTable) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  using TableType = PersistentTable<district::key, district::value>;
+  std::string filename = "/tmp/coco_test_persistent_table";
+  unlink(filename.c_str());
+
+  auto key = [](int32_t d_id) { return district::key(1, d_id); };
+  {
+    TableType table(district::tableID, 0, filename, true);
+    EXPECT_FALSE(table.is_restored());
+    table.reserve(10);
+    for (int32_t d_id = 1; d_id <= 10; d_id++) {
+      district::value value;
+      value.D_NEXT_O_ID = d_id;
+      auto k = key(d_id);
+      table.insert(&k, &value);
+    }
+    EXPECT_EQ(table.memory_usage().rows, 10u);
+  }
+
+  // not loaded yet, the loader starts over
+  {
+    TableType table(district::tableID, 0, filename, true);
+    EXPECT_FALSE(table.is_restored());
+    for (int32_t d_id = 1; d_id <= 10; d_id++) {
+      district::value value;
+      value.D_NEXT_O_ID = d_id;
+      auto k = key(d_id);
+      table.insert(&k, &value);
+    }
+    table.set_loaded();
+    district::value value;
+    value.D_NEXT_O_ID = 100;
+    auto k = key(5);
+    table.update(&k, &value);
+  }
+
+  // a clean shutdown keeps the rows and their metadata
+  {
+    TableType table(district::tableID, 0, filename, true);
+    EXPECT_TRUE(table.is_restored());
+    EXPECT_EQ(table.memory_usage().rows, 10u);
+    auto k = key(5);
+    EXPECT_EQ(
+        static_cast<district::value *>(table.search_value(&k))->D_NEXT_O_ID,
+        100);
+    std::size_t n = 0;
+    table.for_each_row(
+        [&n](const void *, ITable::MetaDataType &, void *) { n++; });
+    EXPECT_EQ(n, 10u);
+    table.search_metadata(&k).store(42);
+  }
+
+  // a crash leaves the locks held, the crashed table is never closed
+  auto crashed = new TableType(district::tableID, 0, filename, true);
+  auto k = key(5);
+  EXPECT_EQ(crashed->search_metadata(&k).load(), 42u);
+  crashed->search_metadata(&k).store(1ull << 63);
+
+  TableType table(district::tableID, 0, filename, true);
+  EXPECT_TRUE(table.is_restored());
+  EXPECT_EQ(table.search_metadata(&k).load(), 0u);
+  EXPECT_EQ(
+      static_cast<district::value *>(table.search_value(&k))->D_NEXT_O_ID,
+      100);
+}
+
+TEST(TestTable, TestReferenceTable) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  ReferenceTable<item::key, item::value> table(item::tableID, 0);
+
+  // rows are loaded in any order
+  for (int32_t i_id = 100; i_id >= 1; i_id--) {
+    item::key key(i_id);
+    item::value value;
+    value.I_IM_ID = i_id * 2;
+    table.insert(&key, &value);
+  }
+  table.set_loaded();
+
+  for (int32_t i_id = 1; i_id <= 100; i_id++) {
+    auto value = table.find(item::key(i_id));
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(value->I_IM_ID, i_id * 2);
+  }
+  EXPECT_EQ(table.find(item::key(101)), nullptr);
+
+  // the rows share metadata that is never locked
+  item::key k(42);
+  EXPECT_EQ(table.search_metadata(&k).load(), 0u);
+  EXPECT_EQ(static_cast<item::value *>(table.search_value(&k))->I_IM_ID, 84);
+
+  item::key start(11), end(21);
+  int n = 0;
+  table.scan(&start, &end,
+             [&n](const void *key, ITable::MetaDataType &metadata,
+                  void *value) {
+               EXPECT_EQ(static_cast<const item::key *>(key)->I_ID, 11 + n);
+               n++;
+               return true;
+             });
+  EXPECT_EQ(n, 10);
+}
@@ -0,0 +1,65 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/Timeline.h"
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+
+TEST(TestTimeline, TestDump) {
+
+  using namespace coco;
+
+  // no span is recorded before the timeline is enabled
+  { TimelineSpan span("before"); }
+
+  Timeline::enable();
+  Timeline::set_thread_name(7, "manager");
+  {
+    TimelineSpan span("wait4_stop");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  std::thread worker([]() {
+    Timeline::set_thread_name(7, "executor 0");
+    TimelineSpan span("START");
+    span.end();
+    TimelineSpan ignored("STOP");
+  });
+  worker.join();
+  // a span of another coordinator
+  std::thread other([]() {
+    Timeline::set_thread_name(8, "manager");
+    TimelineSpan span("other");
+  });
+  other.join();
+
+  std::string filename = "/tmp/7.json";
+  Timeline::dump(filename, 7);
+  std::ifstream in(filename);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::remove(filename.c_str());
+  auto json = ss.str();
+
+  EXPECT_EQ(json.find("{\"traceEvents\":["), 0u);
+  EXPECT_EQ(json.find("before"), std::string::npos);
+  EXPECT_EQ(json.find("other"), std::string::npos);
+  EXPECT_NE(json.find("\"args\":{\"name\":\"manager\"}"), std::string::npos);
+  EXPECT_NE(json.find("\"args\":{\"name\":\"executor 0\"}"), std::string::npos);
+  EXPECT_NE(json.find("{\"name\":\"wait4_stop\",\"ph\":\"X\",\"pid\":7"),
+            std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"START\""), std::string::npos);
+  EXPECT_NE(json.find("\"name\":\"STOP\""), std::string::npos);
+
+  // the span is at least 2 ms
+  auto dur = json.find("\"dur\":", json.find("wait4_stop"));
+  ASSERT_NE(dur, std::string::npos);
+  EXPECT_GE(std::stoull(json.substr(dur + 6)), 2000u);
+
+  EXPECT_STREQ(executor_status_name(ExecutorStatus::Aria_COMMIT),
+               "Aria_COMMIT");
+  EXPECT_STREQ(executor_status_name(ExecutorStatus::EXIT), "EXIT");
+}
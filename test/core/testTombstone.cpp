@@ -0,0 +1,89 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/Table.h"
+#include "protocol/Silo/SiloHelper.h"
+#include <gtest/gtest.h>
+
+TEST(TestTombstone, TestMissingKey) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<1, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  warehouse::key key(1);
+
+  // without a tombstone, a missing key is an empty row
+  EXPECT_EQ(table.search_metadata(&key).load(), 0u);
+
+  table.set_tombstone(SiloHelper::tombstone());
+  warehouse::key missing(2);
+  EXPECT_TRUE(SiloHelper::is_absent(table.search_metadata(&missing).load()));
+
+  // an insert clears the bit
+  table.search_metadata(&missing).store(1);
+  EXPECT_FALSE(SiloHelper::is_absent(table.search_metadata(&missing).load()));
+}
+
+TEST(TestTombstone, TestReclaim) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  Table<1, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  table.set_tombstone(SiloHelper::tombstone());
+
+  warehouse::key key(1), locked(2);
+  warehouse::value value;
+  value.W_YTD = 10;
+  table.insert(&key, &value);
+  table.insert(&locked, &value);
+
+  std::atomic<uint64_t> *tid = &table.search_metadata(&key);
+  std::atomic<uint64_t> *locked_tid = &table.search_metadata(&locked);
+  tid->store(SiloHelper::write_tid(5, true));
+  locked_tid->store(SiloHelper::write_tid(5, true));
+  table.retire(&key);
+  table.retire(&locked);
+
+  // the rows are removed a reclaim epoch later
+  EXPECT_EQ(table.reclaim(0), 0u);
+  EXPECT_EQ(&table.search_metadata(&key), tid);
+
+  // a locked row is kept
+  SiloHelper::lock(*locked_tid);
+  EXPECT_EQ(table.reclaim(0), 1u);
+  EXPECT_TRUE(SiloHelper::is_locked(tid->load()));
+  EXPECT_EQ(&table.search_metadata(&locked), locked_tid);
+
+  // a later lookup finds a new tombstone
+  std::atomic<uint64_t> &new_tid = table.search_metadata(&key);
+  EXPECT_NE(&new_tid, tid);
+  EXPECT_TRUE(SiloHelper::is_absent(new_tid.load()));
+  EXPECT_FALSE(SiloHelper::is_locked(new_tid.load()));
+  EXPECT_EQ(table.reclaim(0), 0u);
+}
+
+TEST(TestTombstone, TestOrderedTable) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  OrderedTable<warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  table.set_tombstone(SiloHelper::tombstone());
+
+  warehouse::key key(1);
+  std::atomic<uint64_t> *tid = &table.search_metadata(&key);
+  EXPECT_TRUE(SiloHelper::is_absent(tid->load()));
+
+  tid->store(SiloHelper::write_tid(5, false));
+  EXPECT_FALSE(SiloHelper::is_absent(tid->load()));
+  tid->store(SiloHelper::write_tid(6, true));
+  table.retire(&key);
+
+  EXPECT_EQ(table.reclaim(0), 0u);
+  EXPECT_EQ(table.reclaim(0), 1u);
+  EXPECT_NE(&table.search_metadata(&key), tid);
+}
@@ -0,0 +1,68 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/TransactionStream.h"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+TEST(TestTransactionStream, TestRecordReplay) {
+
+  using namespace coco;
+
+  char dir[] = "/tmp/coco_stream_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+
+  Context context;
+  context.partition_num = 4;
+  context.record_path = dir;
+
+  // the seeds before each draw, and the partitions of the transactions
+  std::vector<uint64_t> seeds, draws;
+  Random random(42);
+  {
+    auto stream = TransactionStream::open(context, 1, 2);
+    ASSERT_NE(stream, nullptr);
+    for (auto i = 0u; i < 5; i++) {
+      std::size_t partition_id = i % 4, hot_row = i;
+      seeds.push_back(random.get_seed());
+      stream->next(random, partition_id, hot_row);
+      EXPECT_EQ(partition_id, i % 4);
+      draws.push_back(random.uniform_dist(0, 1000000));
+    }
+    stream->close();
+  }
+
+  uint32_t partition_num;
+  std::vector<TransactionStreamEntry> entries;
+  ASSERT_TRUE(TransactionStream::read(
+      TransactionStream::file_name(dir, 1, 2), partition_num, entries));
+  EXPECT_EQ(partition_num, 4u);
+  ASSERT_EQ(entries.size(), 5u);
+  EXPECT_EQ(entries[3].seed, seeds[3]);
+  EXPECT_EQ(entries[3].partition_id, 3u);
+
+  // the replay draws the same, whatever the state of random and the
+  // partition it is asked for, and starts over at the end
+  context.record_path.clear();
+  context.replay_path = dir;
+  auto stream = TransactionStream::open(context, 1, 2);
+  Random other(7);
+  for (auto i = 0u; i < 7; i++) {
+    std::size_t partition_id = 0, hot_row = 0;
+    stream->next(other, partition_id, hot_row);
+    EXPECT_EQ(partition_id, i % 5 % 4);
+    EXPECT_EQ(hot_row, i % 5);
+    EXPECT_EQ(other.uniform_dist(0, 1000000), draws[i % 5]);
+  }
+
+  std::remove(TransactionStream::file_name(dir, 1, 2).c_str());
+  rmdir(dir);
+}
+
+TEST(TestTransactionStream, TestDisabled) {
+
+  coco::Context context;
+  EXPECT_EQ(coco::TransactionStream::open(context, 0, 0), nullptr);
+}
@@ -0,0 +1,58 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "benchmark/tpcc/Schema.h"
+#include "core/VersionReclaimer.h"
+#include <gtest/gtest.h>
+
+TEST(TestVersionReclaimer, TestReclaim) {
+
+  using namespace coco;
+  using namespace tpcc;
+
+  MVCCTable<1, warehouse::key, warehouse::value> table(warehouse::tableID, 0);
+  std::atomic<bool> stopFlag(false);
+  VersionReclaimer reclaimer(0, {&table}, 2, stopFlag);
+
+  warehouse::key key(1);
+  warehouse::value value;
+  for (uint64_t version = 1; version <= 5; version++) {
+    value.W_YTD = version;
+    table.insert(&key, &value, version);
+  }
+
+  // worker 0 reads the snapshot at epoch 3, i.e., version 2
+  reclaimer.advance(3);
+  EXPECT_EQ(reclaimer.enter(0), 3u);
+  reclaimer.advance(6);
+  EXPECT_EQ(reclaimer.watermark(), 3u);
+
+  // the snapshot still reads version 2, only version 1 is removed
+  EXPECT_EQ(reclaimer.reclaim(), 1u);
+  auto *v = static_cast<warehouse::value *>(table.search_value_prev(&key, 3));
+  EXPECT_EQ(v->W_YTD, 2);
+
+  // once no snapshot is active, only the latest version is kept
+  reclaimer.exit(0);
+  EXPECT_EQ(reclaimer.watermark(), 6u);
+  EXPECT_EQ(reclaimer.reclaim(), 3u);
+  EXPECT_EQ(reclaimer.reclaim(), 0u);
+  v = static_cast<warehouse::value *>(table.search_value_prev(&key, 6));
+  EXPECT_EQ(v->W_YTD, 5);
+}
+
+TEST(TestVersionReclaimer, TestEnterIdle) {
+
+  std::atomic<bool> stopFlag(false);
+  coco::VersionReclaimer reclaimer(0, {}, 4, stopFlag);
+
+  reclaimer.advance(10);
+  reclaimer.advance(7);
+  EXPECT_EQ(reclaimer.watermark(), 10u);
+  EXPECT_EQ(reclaimer.enter(2), 10u);
+  reclaimer.advance(20);
+  EXPECT_EQ(reclaimer.watermark(), 10u);
+  reclaimer.exit(2);
+  EXPECT_EQ(reclaimer.watermark(), 20u);
+}
@@ -0,0 +1,80 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/WorkStealing.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+namespace {
+const std::size_t NONE = coco::WorkStealing::NONE;
+} // namespace
+
+TEST(TestWorkStealing, TestOwnFirst) {
+
+  // a worker runs its own transactions in the order of i += worker_num
+  // before it steals the ones of the others
+  coco::WorkStealing work_stealing(3);
+  for (auto id = 0u; id < 3; id++) {
+    work_stealing.reset(id, 8);
+  }
+  std::vector<std::size_t> claimed, expected = {1, 4, 7, 2, 5, 0, 3, 6};
+  for (auto i = work_stealing.next(1); i != NONE; i = work_stealing.next(1)) {
+    claimed.push_back(i);
+  }
+  EXPECT_EQ(claimed, expected);
+  EXPECT_EQ(work_stealing.next(0), NONE);
+}
+
+TEST(TestWorkStealing, TestEmpty) {
+
+  // the queues are empty until they are reset, and when a worker has no
+  // transaction
+  coco::WorkStealing work_stealing(4);
+  EXPECT_EQ(work_stealing.next(0), NONE);
+  work_stealing.reset(3, 2);
+  EXPECT_EQ(work_stealing.next(3), NONE);
+  work_stealing.reset(1, 2);
+  EXPECT_EQ(work_stealing.next(3), 1u);
+  EXPECT_EQ(work_stealing.next(3), NONE);
+}
+
+TEST(TestWorkStealing, TestClaimOnce) {
+
+  // every transaction of a phase is claimed by exactly one worker, phase
+  // after phase
+  const std::size_t n_workers = 4, n = 1000;
+  coco::WorkStealing work_stealing(n_workers);
+  for (auto phase = 0; phase < 10; phase++) {
+    std::vector<std::vector<std::size_t>> claimed(n_workers);
+    std::vector<std::thread> workers;
+    for (auto id = 0u; id < n_workers; id++) {
+      workers.emplace_back([&, id]() {
+        work_stealing.reset(id, n);
+        // the worker 0 is slow
+        if (id == 0) {
+          std::this_thread::yield();
+        }
+        for (auto i = work_stealing.next(id); i != NONE;
+             i = work_stealing.next(id)) {
+          claimed[id].push_back(i);
+        }
+      });
+    }
+    for (auto &t : workers) {
+      t.join();
+    }
+
+    std::vector<int> n_claims(n, 0);
+    for (auto &c : claimed) {
+      for (auto i : c) {
+        ASSERT_LT(i, n);
+        n_claims[i]++;
+      }
+    }
+    for (auto i = 0u; i < n; i++) {
+      EXPECT_EQ(n_claims[i], 1);
+    }
+  }
+}
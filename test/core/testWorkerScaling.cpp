@@ -0,0 +1,81 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "core/group_commit/WorkerScaling.h"
+#include <gtest/gtest.h>
+
+TEST(TestWorkerScaling, TestDisabled) {
+
+  coco::Context context;
+  context.worker_num = 8;
+  coco::group_commit::WorkerScaling scaling(context);
+  EXPECT_FALSE(scaling.enabled());
+  EXPECT_EQ(scaling.get_n_active(), 8u);
+}
+
+TEST(TestWorkerScaling, TestScaleDown) {
+
+  coco::Context context;
+  context.worker_num = 8;
+  context.dynamic_workers = true;
+  context.min_workers = 2;
+  coco::group_commit::WorkerScaling scaling(context);
+  EXPECT_TRUE(scaling.enabled());
+
+  // the work of 2.5 executors, 1 ms groups
+  for (auto i = 0; i < 100; i++) {
+    scaling.update(2500000, 1000000);
+  }
+  // 2.5 / 4 is below SCALE_DOWN, 2.5 / 3 is not
+  EXPECT_EQ(scaling.get_n_active(), 5u);
+
+  // almost idle, down to min_workers
+  for (auto i = 0; i < 100; i++) {
+    scaling.update(1000, 1000000);
+  }
+  EXPECT_EQ(scaling.get_n_active(), 2u);
+}
+
+TEST(TestWorkerScaling, TestScaleUp) {
+
+  coco::Context context;
+  context.worker_num = 8;
+  context.dynamic_workers = true;
+  coco::group_commit::WorkerScaling scaling(context);
+
+  for (auto i = 0; i < 100; i++) {
+    scaling.update(0, 1000000);
+  }
+  EXPECT_EQ(scaling.get_n_active(), 1u);
+
+  // the active executors are always busy, one more per group
+  std::size_t last = scaling.get_n_active();
+  for (auto i = 0; i < 100; i++) {
+    auto n = scaling.update(1000000 * last, 1000000);
+    EXPECT_LE(n, last + 1);
+    last = n;
+  }
+  EXPECT_EQ(scaling.get_n_active(), 8u);
+  EXPECT_EQ(scaling.get_n_changes(), 14u);
+}
+
+TEST(TestWorkerScaling, TestStable) {
+
+  coco::Context context;
+  context.worker_num = 8;
+  context.dynamic_workers = true;
+  coco::group_commit::WorkerScaling scaling(context);
+
+  // 3 executors of work at 75% each neither scales up nor down
+  for (auto i = 0; i < 100; i++) {
+    scaling.update(3000000, 1000000);
+  }
+  auto n = scaling.get_n_active();
+  auto changes = scaling.get_n_changes();
+  for (auto i = 0; i < 100; i++) {
+    scaling.update(3000000, 1000000);
+  }
+  EXPECT_EQ(scaling.get_n_active(), n);
+  EXPECT_EQ(scaling.get_n_changes(), changes);
+}
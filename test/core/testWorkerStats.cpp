@@ -0,0 +1,53 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/WorkerStats.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+TEST(TestWorkerStats, TestCollectDeltas) {
+
+  using namespace coco;
+
+  WorkerStats stats;
+  stats.add(WorkerStats::COMMIT);
+  stats.add(WorkerStats::COMMIT);
+  stats.add(WorkerStats::NETWORK_SIZE, 100);
+  stats.add(WorkerStats::phase_events(1, 2), 7);
+
+  Statistics s;
+  stats.collect(s);
+  EXPECT_EQ(s.n_commit, 2u);
+  EXPECT_EQ(s.n_network_size, 100u);
+  EXPECT_EQ(s.phase_events[1][2], 7u);
+
+  // the counters are never reset, the next collect only sees the increments
+  stats.add(WorkerStats::COMMIT);
+  s.clear();
+  stats.collect(s);
+  EXPECT_EQ(s.n_commit, 1u);
+  EXPECT_EQ(s.n_network_size, 0u);
+  EXPECT_EQ(stats.get(WorkerStats::COMMIT), 3u);
+}
+
+TEST(TestWorkerStats, TestConcurrentCollect) {
+
+  using namespace coco;
+
+  WorkerStats stats;
+  constexpr uint64_t n = 100000;
+  std::thread worker([&stats]() {
+    for (auto i = 0u; i < n; i++) {
+      stats.add(WorkerStats::ABORT_LOCK);
+    }
+  });
+
+  Statistics s;
+  while (s.n_abort_lock < n / 2) {
+    stats.collect(s);
+  }
+  worker.join();
+  stats.collect(s);
+  EXPECT_EQ(s.n_abort_lock, n);
+}
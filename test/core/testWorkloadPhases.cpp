@@ -0,0 +1,65 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "core/WorkloadPhases.h"
+#include <gtest/gtest.h>
+
+TEST(TestWorkloadPhases, TestParse) {
+
+  using namespace coco;
+
+  auto phases = WorkloadPhases::parse(
+      "30:zipf=0.9;10:zipf=0.9,hot=0.5;20:zipf=0,cross=50");
+  ASSERT_EQ(phases.size(), 3u);
+  EXPECT_EQ(phases[0].seconds, 30u);
+  EXPECT_EQ(phases[0].zipf, 0.9);
+  EXPECT_EQ(phases[0].hot, 0);
+  EXPECT_EQ(phases[0].cross, -1);
+  EXPECT_EQ(phases[1].hot, 0.5);
+  EXPECT_EQ(phases[2].zipf, 0);
+  EXPECT_EQ(phases[2].cross, 50);
+  EXPECT_EQ(phases[2].to_string(), "20s zipf=0 hot=0 cross=50");
+
+  EXPECT_EQ(WorkloadPhases::parse("5").size(), 1u);
+  EXPECT_TRUE(WorkloadPhases::parse("").empty());
+}
+
+TEST(TestWorkloadPhases, TestTimeline) {
+
+  using namespace coco;
+
+  WorkloadPhases phases;
+  EXPECT_FALSE(phases.enabled());
+  EXPECT_TRUE(phases.is_uniform(true));
+  EXPECT_EQ(phases.cross_ratio(10), 10);
+
+  phases.init("2:zipf=0.5,hot=0.5;1:cross=100;1:zipf=0", 100);
+  EXPECT_EQ(phases.phase_of(1), 0u);
+  EXPECT_EQ(phases.phase_of(2), 0u);
+  EXPECT_EQ(phases.phase_of(3), 1u);
+  EXPECT_EQ(phases.phase_of(4), 2u);
+  // the last phase lasts until the end of the run
+  EXPECT_EQ(phases.phase_of(100), 2u);
+
+  phases.set_second(1);
+  EXPECT_FALSE(phases.is_uniform(true));
+  EXPECT_EQ(phases.cross_ratio(10), 10);
+  // the hottest key of the phase is the middle one
+  Zipf zipf;
+  zipf.init(100, 0.5);
+  EXPECT_EQ(phases.skewed(zipf, 100, 0), 50u);
+  for (auto i = 0; i < 100; i++) {
+    EXPECT_LT(phases.skewed(zipf, 100, i / 100.0), 100u);
+  }
+
+  phases.set_second(3);
+  EXPECT_TRUE(phases.is_uniform(true));
+  EXPECT_FALSE(phases.is_uniform(false));
+  EXPECT_EQ(phases.cross_ratio(10), 100);
+  // the zipf of the workload without one of the phase
+  EXPECT_EQ(phases.skewed(zipf, 100, 0), zipf.value(0));
+
+  phases.set_second(4);
+  EXPECT_TRUE(phases.is_uniform(false));
+}
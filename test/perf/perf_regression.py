@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+#
+# Runs one configuration of the perf_regression tests and compares it with
+# its entry in the baseline, see COCO_PERF_REGRESSION in CMakeLists.txt.
+#
+#   perf_regression.py --baseline baseline.json --name ycsb_Silo \
+#       -- ./bench_ycsb --protocol=Silo ...
+#
+# A bench run is measured by the "commit_per_second" and the "p99_us" of the
+# total of its --results_path, see core/RunResults.h, a micro_bench run
+# (--micro) by the "real_time" of each benchmark. The run fails when a
+# throughput is lower than its baseline by more than the throughput
+# tolerance, or a latency or time is higher by more than the latency
+# tolerance. With COCO_PERF_UPDATE=1 in the environment, the entry of the
+# run in the baseline is replaced by its results instead.
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def measure(results, micro):
+    if micro:
+        return {b["name"]: b["real_time"] for b in results["benchmarks"]
+                if b.get("run_type", "iteration") == "iteration"}
+    total = results["total"]
+    return {"commit_per_second": total["commit_per_second"],
+            "p99_us": total["latency_us"]["p99"]}
+
+
+def run(command, micro):
+    with tempfile.TemporaryDirectory() as directory:
+        path = os.path.join(directory, "results.json")
+        if micro:
+            command = command + ["--benchmark_format=json",
+                                 "--benchmark_out=" + path]
+        else:
+            command = command + ["--results_path=" + path]
+        subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+        with open(path) as f:
+            return measure(json.load(f), micro)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--baseline", required=True)
+    parser.add_argument("--name", required=True)
+    parser.add_argument("--micro", action="store_true")
+    parser.add_argument("command", nargs=argparse.REMAINDER)
+    args = parser.parse_args()
+    command = args.command[1:] if args.command[:1] == ["--"] else args.command
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    metrics = run(command, args.micro)
+
+    if os.environ.get("COCO_PERF_UPDATE") == "1":
+        baseline["runs"][args.name] = metrics
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("%s: baseline updated" % args.name)
+        return 0
+
+    expected = baseline["runs"].get(args.name)
+    if expected is None:
+        print("%s: no baseline, build the perf_baseline target" % args.name)
+        return 0
+
+    regressions = []
+    for metric, value in sorted(metrics.items()):
+        if metric not in expected:
+            continue
+        base = expected[metric]
+        if metric.endswith("_per_second"):
+            tolerance = baseline["tolerance"]["throughput"]
+            regressed = value < base * (1 - tolerance)
+        else:
+            tolerance = baseline["tolerance"]["latency"]
+            regressed = value > base * (1 + tolerance)
+        print("%s: %s %g, baseline %g" % (args.name, metric, value, base))
+        if regressed:
+            regressions.append(metric)
+
+    if regressions:
+        print("%s: regressed %s" % (args.name, ", ".join(regressions)))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
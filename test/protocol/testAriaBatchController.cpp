@@ -0,0 +1,61 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "protocol/Aria/AriaBatchController.h"
+#include <gtest/gtest.h>
+
+TEST(TestAriaBatchController, TestDisabled) {
+
+  coco::Context context;
+  context.batch_size = 500;
+  coco::AriaBatchController controller(context);
+  EXPECT_FALSE(controller.enabled());
+  EXPECT_EQ(controller.get_batch_size(), 500u);
+}
+
+TEST(TestAriaBatchController, TestTargetLatency) {
+
+  coco::Context context;
+  context.batch_size = 10000;
+  context.aria_min_batch_size = 10;
+  context.aria_target_latency = 5000;
+  coco::AriaBatchController controller(context);
+  EXPECT_TRUE(controller.enabled());
+
+  // a barrier of 1 ms and 2 us per transaction leave 2000 transactions
+  for (auto i = 0; i < 200; i++) {
+    auto n = controller.get_batch_size();
+    controller.update(n, 0, 1000 + 2 * n);
+  }
+  EXPECT_NEAR(controller.get_batch_size(), 2000, 20);
+
+  // the batch never drops below the minimum
+  for (auto i = 0; i < 100; i++) {
+    controller.update(controller.get_batch_size(), 0, 100000);
+  }
+  EXPECT_EQ(controller.get_batch_size(), 10u);
+
+  // nor grows beyond --batch_size
+  for (auto i = 0; i < 100; i++) {
+    controller.update(controller.get_batch_size(), 0, 1);
+  }
+  EXPECT_EQ(controller.get_batch_size(), 10000u);
+}
+
+TEST(TestAriaBatchController, TestAbortRatio) {
+
+  coco::Context context;
+  context.batch_size = 10000;
+  context.aria_target_latency = 1000000;
+  coco::AriaBatchController controller(context);
+
+  // the abort ratio is n / 5000, so a batch of 1000 aborts 20% of it
+  for (auto i = 0; i < 200; i++) {
+    auto n = controller.get_batch_size();
+    controller.update(n, n * n / 5000, n);
+  }
+  EXPECT_NEAR(controller.get_batch_size(), 1000, 50);
+  EXPECT_NEAR(controller.get_abort_ratio(),
+              coco::AriaBatchController::MAX_ABORT_RATIO, 0.01);
+}
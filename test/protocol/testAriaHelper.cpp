@@ -0,0 +1,34 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "protocol/Aria/AriaHelper.h"
+#include <gtest/gtest.h>
+
+TEST(TestAriaHelper, TestFallbackLock) {
+
+  using namespace coco;
+  std::atomic<uint64_t> a(0);
+
+  AriaHelper::reserve_write(a, 1, 10);
+  EXPECT_EQ(AriaHelper::get_wts(a.load()), 10u);
+
+  // the lock manager clears the reservations before locking
+  a.store(0);
+  EXPECT_TRUE(AriaHelper::read_lock(a));
+  EXPECT_TRUE(AriaHelper::read_lock(a));
+  EXPECT_FALSE(AriaHelper::write_lock(a));
+  AriaHelper::read_lock_release(a);
+  AriaHelper::read_lock_release(a);
+
+  EXPECT_TRUE(AriaHelper::write_lock(a));
+  EXPECT_FALSE(AriaHelper::read_lock(a));
+  EXPECT_FALSE(AriaHelper::write_lock(a));
+  AriaHelper::write_lock_release(a);
+  EXPECT_EQ(a.load(), 0u);
+
+  // the next batch reserves the row again
+  EXPECT_TRUE(AriaHelper::reserve_read(a, 2, 5));
+  EXPECT_EQ(AriaHelper::get_epoch(a.load()), 2u);
+  EXPECT_EQ(AriaHelper::get_rts(a.load()), 5u);
+}
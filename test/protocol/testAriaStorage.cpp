@@ -0,0 +1,57 @@
+//
+// Created by Yi Lu on 3/25/19.
+//
+
+#include "benchmark/ycsb/Storage.h"
+#include "protocol/Aria/AriaStorage.h"
+#include <gtest/gtest.h>
+
+TEST(TestAriaStorage, TestResize) {
+
+  using coco::AriaStorage;
+  AriaStorage<coco::ycsb::Storage> storages;
+
+  storages.resize(10);
+  EXPECT_EQ(storages.size(), 10u);
+  EXPECT_EQ(storages.memory_usage(),
+            AriaStorage<coco::ycsb::Storage>::CHUNK_SIZE *
+                sizeof(coco::ycsb::Storage));
+
+  // the slots do not move as the batch grows
+  auto first = &storages[0];
+  storages.resize(AriaStorage<coco::ycsb::Storage>::CHUNK_SIZE + 1);
+  EXPECT_EQ(first, &storages[0]);
+  EXPECT_EQ(storages.memory_usage(),
+            2 * AriaStorage<coco::ycsb::Storage>::CHUNK_SIZE *
+                sizeof(coco::ycsb::Storage));
+
+  // a smaller batch keeps its slots
+  storages.resize(5);
+  EXPECT_EQ(storages.size(), AriaStorage<coco::ycsb::Storage>::CHUNK_SIZE + 1);
+}
+
+TEST(TestAriaStorage, TestSwap) {
+
+  coco::AriaStorage<coco::ycsb::Storage> storages;
+  storages.resize(3);
+
+  // the transaction at index 2 is moved to the front and keeps its storage
+  auto retried = &storages[2], committed = &storages[0];
+  storages.swap(0, 2);
+  EXPECT_EQ(&storages[0], retried);
+  EXPECT_EQ(&storages[2], committed);
+}
+
+TEST(TestAriaStorage, TestSwapNext) {
+
+  coco::AriaStorage<coco::ycsb::Storage> storages, next;
+  storages.resize(2);
+  next.resize(2);
+
+  // the transaction generated ahead at index 1 takes its slot over
+  auto generated = &next[1], done = &storages[1], other = &storages[0];
+  storages.swap(1, next);
+  EXPECT_EQ(&storages[1], generated);
+  EXPECT_EQ(&next[1], done);
+  EXPECT_EQ(&storages[0], other);
+}
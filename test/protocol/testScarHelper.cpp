@@ -50,4 +50,29 @@ TEST(TestTwoPLHelper, TestOverflow) {
   EXPECT_EQ(ScarHelper::get_rts(v4), rts3);
   EXPECT_EQ(ScarHelper::get_rts(v4),
             ScarHelper::get_wts(v4) + ScarHelper::get_delta(v4));
-}
\ No newline at end of file
+}
+
+TEST(TestTwoPLHelper, TestLease) {
+
+  using coco::ScarHelper;
+
+  uint64_t wts = 0x1234;
+  uint64_t v = ScarHelper::set_wts(0, wts);
+
+  // the rts is extended past the commit ts, and later reads need no extension
+  std::atomic<uint64_t> latest_tid(v);
+  uint64_t written_ts = v;
+  EXPECT_TRUE(
+      ScarHelper::validate_read_key(latest_tid, v, wts + 10, written_ts, 100));
+  EXPECT_EQ(ScarHelper::get_wts(latest_tid.load()), wts);
+  EXPECT_EQ(ScarHelper::get_rts(latest_tid.load()), wts + 110);
+  EXPECT_EQ(written_ts, latest_tid.load());
+
+  // the wts is kept
+  EXPECT_EQ(ScarHelper::lease_rts(v, wts + 10, 1ull << 20),
+            wts + ScarHelper::DELTA_MASK);
+  // no lease
+  EXPECT_EQ(ScarHelper::lease_rts(v, wts + 10, 0), wts + 10);
+  EXPECT_EQ(ScarHelper::lease_rts(v, wts + (1ull << 20), 100),
+            wts + (1ull << 20));
+}
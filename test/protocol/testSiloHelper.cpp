@@ -0,0 +1,29 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "protocol/Silo/SiloHelper.h"
+#include <gtest/gtest.h>
+
+TEST(TestSiloHelper, TestReadWithLockBit) {
+
+  using coco::SiloHelper;
+  std::atomic<uint64_t> tid(uint64_t(5) << 32 | 7);
+  uint64_t value = 42, dest = 0;
+  auto row = std::make_tuple(&tid, static_cast<void *>(&value));
+
+  EXPECT_EQ(SiloHelper::read(row, &dest, sizeof(value)), tid.load());
+  EXPECT_EQ(SiloHelper::read_with_lock_bit(row, &dest, sizeof(value)),
+            tid.load());
+  EXPECT_EQ(dest, 42u);
+
+  // a locked row reads as newer than any epoch
+  uint64_t latest = SiloHelper::lock(tid);
+  EXPECT_EQ(SiloHelper::read(row, &dest, sizeof(value)), latest);
+  uint64_t locked = SiloHelper::read_with_lock_bit(row, &dest, sizeof(value));
+  EXPECT_TRUE(SiloHelper::is_locked(locked));
+  EXPECT_GT(locked, uint64_t(6) << 32);
+  EXPECT_EQ(SiloHelper::remove_lock_bit(locked), latest);
+  SiloHelper::unlock(tid);
+  EXPECT_FALSE(SiloHelper::is_locked(tid.load()));
+}
@@ -85,3 +85,47 @@ TEST(TestTwoPLHelper, TestValue) {
   EXPECT_FALSE(success);
   TwoPLHelper::read_lock_release(a);
 }
+
+TEST(TestTwoPLHelper, TestBiasedReadLock) {
+
+  using coco::TwoPLHelper;
+  using coco::TwoPLReaderIndicator;
+  std::atomic<uint64_t> a(0x1234);
+
+  bool success, biased;
+
+  // the first reader uses the lock word and sets the bias
+  EXPECT_EQ(TwoPLHelper::biased_read_lock(a, 0, success, biased), 0x1234);
+  EXPECT_TRUE(success);
+  EXPECT_FALSE(biased);
+  EXPECT_TRUE(TwoPLHelper::is_biased(a.load()));
+  TwoPLHelper::read_lock_release(a);
+
+  // later readers only publish the row in their indicators
+  EXPECT_EQ(TwoPLHelper::biased_read_lock(a, 1, success, biased), 0x1234);
+  EXPECT_TRUE(success);
+  EXPECT_TRUE(biased);
+  TwoPLHelper::biased_read_lock(a, 2, success, biased);
+  EXPECT_TRUE(success && biased);
+  EXPECT_TRUE(TwoPLReaderIndicator::is_published(2, a));
+  EXPECT_FALSE(TwoPLHelper::is_read_locked(a.load()));
+
+  // a writer cannot drain the readers in time and lets go of the lock
+  TwoPLHelper::write_lock(a, success);
+  EXPECT_FALSE(success);
+  EXPECT_FALSE(TwoPLHelper::is_write_locked(a.load()));
+  EXPECT_TRUE(TwoPLHelper::is_biased(a.load()));
+
+  TwoPLHelper::biased_read_lock_release(a, 1);
+  TwoPLHelper::biased_read_lock_release(a, 2);
+  EXPECT_FALSE(TwoPLReaderIndicator::is_published(2, a));
+
+  // once drained, the bias is revoked
+  TwoPLHelper::write_lock(a, success);
+  EXPECT_TRUE(success);
+  EXPECT_FALSE(TwoPLHelper::is_biased(a.load()));
+  TwoPLHelper::biased_read_lock(a, 1, success, biased);
+  EXPECT_FALSE(success);
+  TwoPLHelper::write_lock_release(a, 0x1235);
+  EXPECT_EQ(TwoPLHelper::remove_lock_bit(a.load()), 0x1235);
+}
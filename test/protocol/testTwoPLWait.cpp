@@ -0,0 +1,95 @@
+//
+// Created by Yi Lu on 3/22/19.
+//
+
+#include "protocol/TwoPL/TwoPLWait.h"
+#include <gtest/gtest.h>
+
+TEST(TestTwoPLWait, TestPolicy) {
+
+  using namespace coco;
+
+  EXPECT_FALSE(TwoPLWait::should_wait(TwoPLWaitPolicy::NO_WAIT, 1, 2));
+  EXPECT_TRUE(TwoPLWait::should_wait(TwoPLWaitPolicy::WAIT_DIE, 1, 2));
+  EXPECT_FALSE(TwoPLWait::should_wait(TwoPLWaitPolicy::WAIT_DIE, 2, 1));
+  EXPECT_TRUE(TwoPLWait::should_wait(TwoPLWaitPolicy::WOUND_WAIT, 1, 2));
+  EXPECT_TRUE(TwoPLWait::should_wait(TwoPLWaitPolicy::WOUND_WAIT, 2, 1));
+  EXPECT_TRUE(TwoPLWait::policy("wait_die") == TwoPLWaitPolicy::WAIT_DIE);
+}
+
+TEST(TestTwoPLWait, TestWaitDie) {
+
+  using namespace coco;
+  std::atomic<uint64_t> a(0);
+  bool success;
+
+  TwoPLWait::lock(a, true, 10, TwoPLWaitPolicy::WAIT_DIE, 100, success);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(TwoPLWait::owner(a).load(), 10u);
+
+  // a younger transaction dies right away
+  int rounds = 0;
+  TwoPLWait::lock(a, false, 20, TwoPLWaitPolicy::WAIT_DIE, 100, success,
+                  [&rounds]() { rounds++; });
+  EXPECT_FALSE(success);
+  EXPECT_EQ(rounds, 0);
+
+  // an older transaction waits until the lock is released
+  TwoPLWait::lock(a, false, 5, TwoPLWaitPolicy::WAIT_DIE, 100, success,
+                  [&a, &rounds]() {
+                    if (++rounds == 3) {
+                      TwoPLHelper::write_lock_release(a);
+                    }
+                  });
+  EXPECT_TRUE(success);
+  EXPECT_EQ(rounds, 3);
+  EXPECT_EQ(TwoPLWait::owner(a).load(), 5u);
+
+  // readers only lower the oldest holder
+  TwoPLWait::lock(a, false, 7, TwoPLWaitPolicy::WAIT_DIE, 100, success);
+  EXPECT_TRUE(success);
+  EXPECT_EQ(TwoPLWait::owner(a).load(), 5u);
+
+  // waiting is bounded
+  rounds = 0;
+  TwoPLWait::lock(a, true, 1, TwoPLWaitPolicy::WAIT_DIE, 10, success,
+                  [&rounds]() { rounds++; });
+  EXPECT_FALSE(success);
+  EXPECT_EQ(rounds, 10);
+}
+
+TEST(TestTwoPLWait, TestWoundWait) {
+
+  using namespace coco;
+  std::atomic<uint64_t> a(0);
+  bool success;
+
+  TwoPLWait::lock(a, true, 200, TwoPLWaitPolicy::WOUND_WAIT, 100, success);
+  EXPECT_TRUE(success);
+
+  // a younger transaction waits
+  int rounds = 0;
+  TwoPLWait::lock(a, true, 300, TwoPLWaitPolicy::WOUND_WAIT, 10, success,
+                  [&rounds]() { rounds++; });
+  EXPECT_FALSE(success);
+  EXPECT_EQ(rounds, 10);
+  EXPECT_FALSE(TwoPLWait::is_wounded(200));
+
+  // an older transaction wounds the holder
+  TwoPLWait::lock(a, true, 100, TwoPLWaitPolicy::WOUND_WAIT, 10, success,
+                  [&rounds]() { rounds++; });
+  EXPECT_FALSE(success);
+  EXPECT_TRUE(TwoPLWait::is_wounded(200));
+
+  // the wounded transaction stops waiting for other locks
+  std::atomic<uint64_t> b(0);
+  TwoPLWait::lock(b, true, 50, TwoPLWaitPolicy::WOUND_WAIT, 100, success);
+  rounds = 0;
+  TwoPLWait::lock(b, true, 200, TwoPLWaitPolicy::WOUND_WAIT, 100, success,
+                  [&rounds]() { rounds++; });
+  EXPECT_FALSE(success);
+  EXPECT_EQ(rounds, 0);
+
+  TwoPLWait::heal(200);
+  EXPECT_FALSE(TwoPLWait::is_wounded(200));
+}
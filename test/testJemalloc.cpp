@@ -2,8 +2,10 @@
 // Created by Yi Lu on 8/29/18.
 //
 
+#include "core/ThreadArenas.h"
 #include "jemalloc/jemalloc.h"
 #include <gtest/gtest.h>
+#include <thread>
 
 TEST(TestJemalloc, TestBasic) {
 
@@ -13,4 +15,21 @@ TEST(TestJemalloc, TestBasic) {
   std::cout << j << std::endl;
 
   EXPECT_EQ(true, true);
-}
\ No newline at end of file
+}
+
+TEST(TestJemalloc, TestThreadArenas) {
+
+  using coco::ThreadArenas;
+
+  std::thread t([]() {
+    auto arena = ThreadArenas::bind("worker 0");
+    unsigned current = 0;
+    size_t s = sizeof(current);
+    mallctl("thread.arena", &current, &s, NULL, 0);
+    EXPECT_EQ(current, arena);
+    EXPECT_EQ(ThreadArenas::name(arena), "worker 0");
+  });
+  t.join();
+
+  EXPECT_EQ(ThreadArenas::name(0), "");
+}
@@ -0,0 +1,166 @@
+#include "core/AccessTrace.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <set>
+#include <vector>
+
+DEFINE_string(format, "summary",
+              "summary, records, or coaccess for --partitioner=affinity:");
+
+/*
+ * Reads the access traces written with --trace_path, e.g.,
+ *
+ *   trace_reader --format=coaccess trace/0_0.trace trace/1_0.trace
+ *
+ * summary prints the transactions by outcome and the accesses by table and by
+ * partition. records prints a record per line. coaccess prints the partitions
+ * of each committed transaction per line, see CoAccessGraph.
+ */
+
+namespace {
+
+const char *outcome_name(uint8_t outcome) {
+  switch (static_cast<coco::AccessOutcome>(outcome)) {
+  case coco::AccessOutcome::COMMIT:
+    return "commit";
+  case coco::AccessOutcome::ABORT_LOCK:
+    return "abort_lock";
+  case coco::AccessOutcome::ABORT_READ_VALIDATION:
+    return "abort_read_validation";
+  case coco::AccessOutcome::ABORT_NO_RETRY:
+    return "abort_no_retry";
+  }
+  return "unknown";
+}
+
+// calls func(begin, end) for the records of each transaction
+template <class Func>
+void for_each_transaction(const std::vector<coco::AccessTraceRecord> &records,
+                          Func func) {
+  auto begin = records.begin();
+  while (begin != records.end()) {
+    auto end = std::find_if(begin, records.end(), [&](auto &record) {
+      return record.transaction_id != begin->transaction_id ||
+             record.worker_id != begin->worker_id ||
+             record.coordinator_id != begin->coordinator_id;
+    });
+    func(begin, end);
+    begin = end;
+  }
+}
+
+void print_summary(const std::vector<coco::AccessTraceRecord> &records,
+                   std::size_t n_files) {
+  std::map<std::string, uint64_t> outcomes;
+  std::map<uint32_t, uint64_t> reads, writes, partitions;
+  std::set<std::pair<uint32_t, uint64_t>> keys;
+  uint64_t n_transactions = 0, n_distributed = 0;
+
+  for_each_transaction(records, [&](auto begin, auto end) {
+    n_transactions++;
+    outcomes[outcome_name(begin->outcome)]++;
+    std::set<uint32_t> accessed;
+    for (auto it = begin; it != end; it++) {
+      (it->write ? writes : reads)[it->table_id]++;
+      partitions[it->partition_id]++;
+      keys.emplace(it->table_id, it->key_hash);
+      accessed.insert(it->partition_id);
+    }
+    if (accessed.size() > 1) {
+      n_distributed++;
+    }
+  });
+
+  std::cout << n_files << " files, " << records.size() << " accesses, "
+            << n_transactions << " transactions, " << n_distributed
+            << " on more than one partition, " << keys.size()
+            << " distinct keys." << std::endl;
+  for (auto &outcome : outcomes) {
+    std::cout << "outcome " << outcome.first << ": " << outcome.second
+              << std::endl;
+  }
+  std::set<uint32_t> tables;
+  for (auto &read : reads) {
+    tables.insert(read.first);
+  }
+  for (auto &write : writes) {
+    tables.insert(write.first);
+  }
+  for (auto table_id : tables) {
+    std::cout << "table " << table_id << ": " << reads[table_id]
+              << " reads, " << writes[table_id] << " writes" << std::endl;
+  }
+  for (auto &partition : partitions) {
+    std::cout << "partition " << partition.first << ": " << partition.second
+              << " accesses" << std::endl;
+  }
+}
+
+void print_records(const std::vector<coco::AccessTraceRecord> &records) {
+  std::cout << "# timestamp coordinator worker transaction table partition "
+               "key_hash access outcome"
+            << std::endl;
+  for (auto &record : records) {
+    std::cout << record.timestamp << " " << record.coordinator_id << " "
+              << record.worker_id << " " << record.transaction_id << " "
+              << record.table_id << " " << record.partition_id << " "
+              << std::hex << record.key_hash << std::dec << " "
+              << (record.write ? "write" : "read") << " "
+              << outcome_name(record.outcome) << std::endl;
+  }
+}
+
+void print_coaccess(const std::vector<coco::AccessTraceRecord> &records) {
+  std::cout << "# the partitions of each committed transaction" << std::endl;
+  for_each_transaction(records, [&](auto begin, auto end) {
+    if (static_cast<coco::AccessOutcome>(begin->outcome) !=
+        coco::AccessOutcome::COMMIT) {
+      return;
+    }
+    std::set<uint32_t> accessed;
+    for (auto it = begin; it != end; it++) {
+      accessed.insert(it->partition_id);
+    }
+    const char *sep = "";
+    for (auto partition_id : accessed) {
+      std::cout << sep << partition_id;
+      sep = " ";
+    }
+    std::cout << std::endl;
+  });
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  CHECK(argc > 1) << "no trace file.";
+
+  // the records of a transaction are contiguous in a file
+  std::vector<coco::AccessTraceRecord> records;
+  for (auto i = 1; i < argc; i++) {
+    std::vector<coco::AccessTraceRecord> file_records;
+    CHECK(coco::AccessTrace::read(argv[i], file_records))
+        << "failed to read " << argv[i];
+    records.insert(records.end(), file_records.begin(), file_records.end());
+  }
+
+  if (FLAGS_format == "summary") {
+    print_summary(records, argc - 1);
+  } else if (FLAGS_format == "records") {
+    print_records(records);
+  } else if (FLAGS_format == "coaccess") {
+    print_coaccess(records);
+  } else {
+    CHECK(false) << "unknown format: " << FLAGS_format;
+  }
+  return 0;
+}